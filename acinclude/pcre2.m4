@@ -0,0 +1,74 @@
+dnl Check for PCRE2 Libraries
+dnl CHECK_PCRE2([ACTION-IF-FOUND [, ACTION-IF-NOT-FOUND]])
+dnl Sets:
+dnl  PCRE2_CFLAGS
+dnl  PCRE2_LDADD
+dnl  HAVE_PCRE2
+
+PCRE2_CONFIG=""
+PCRE2_VERSION=""
+PCRE2_CFLAGS=""
+PCRE2_LDADD=""
+
+AC_DEFUN([CHECK_PCRE2],
+[dnl
+
+test_paths="/usr/local /opt/local /opt /usr"
+
+AC_ARG_WITH(
+    pcre2,
+    [AC_HELP_STRING([--with-pcre2=PATH],[Path to pcre2 prefix or config script])],
+    [if test "${with_pcre2}" = "yes" ; then
+       require_pcre2="yes"
+     else
+       test_paths="${with_pcre2}"
+       require_pcre2="yes"
+     fi],
+    [require_pcre2="no"])
+
+HAVE_PCRE2=no
+
+AC_MSG_CHECKING([for libpcre2 config script])
+
+pcre2_path=""
+if test "${test_paths}" != "no"; then
+    for x in ${test_paths}; do
+        dnl # Determine if the script was specified and use it directly
+        if test ! -d "$x" -a -e "$x"; then
+            PCRE2_CONFIG=$x
+            pcre2_path="no"
+            break
+        fi
+
+        if test -e "${x}/bin/pcre2-config"; then
+            PCRE2_CONFIG="${x}/bin/pcre2-config"
+            pcre2_path="${x}/bin"
+            break
+        fi
+    done
+fi
+
+if test -n "${pcre2_path}"; then
+    AC_MSG_RESULT([${PCRE2_CONFIG}])
+    PCRE2_VERSION="`${PCRE2_CONFIG} --version`"
+    PCRE2_CFLAGS="`${PCRE2_CONFIG} --cflags`"
+    PCRE2_LDADD="`${PCRE2_CONFIG} --libs8`"
+    if test "$verbose_output" -eq 1; then AC_MSG_NOTICE(pcre2 VERSION: $PCRE2_VERSION); fi
+    HAVE_PCRE2=yes
+    AC_MSG_NOTICE([using pcre2 v${PCRE2_VERSION}])
+    ifelse([$1], , , $1)
+else
+    AC_MSG_RESULT([no])
+    dnl # Fail if the user asked for PCRE2 explicitly.
+    if test "${require_pcre2}" = "yes"; then
+        AC_MSG_ERROR([pcre2 not found])
+    fi
+    ifelse([$2], , , $2)
+fi
+
+AC_SUBST(PCRE2_CONFIG)
+AC_SUBST(PCRE2_VERSION)
+AC_SUBST(PCRE2_CFLAGS)
+AC_SUBST(PCRE2_LDADD)
+AC_SUBST(HAVE_PCRE2)
+])
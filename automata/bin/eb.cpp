@@ -0,0 +1,427 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Eudoxus Throughput Benchmark
+ *
+ * Measures the throughput of one or more Eudoxus automata on a fixed input.
+ * Unlike ee, the input is read into memory once and outputs are only
+ * counted, so that the timings reflect Eudoxus alone.  Each automata is run
+ * a number of times after warm up runs and the minimum, median and mean run
+ * times are reported along with the throughput of the median run.
+ */
+
+#include <ironautomata/eudoxus.h>
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#if __has_warning("-Wunused-local-typedef")
+#pragma clang diagnostic ignored "-Wunused-local-typedef"
+#endif
+#endif
+#include <boost/chrono.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+//! Clock we are using.
+typedef boost::chrono::high_resolution_clock clock_type;
+//! Milliseconds as double.
+typedef boost::chrono::duration<double, boost::milli> ms_t;
+
+//! Ways of handling outputs.
+enum output_mode_e {
+    //! Use ia_eudoxus_execute_without_output().
+    OUTPUT_NONE,
+    //! Use ia_eudoxus_execute() and count outputs.
+    OUTPUT_COUNT,
+    //! Use ia_eudoxus_execute() and stop at first output.
+    OUTPUT_FIRST
+};
+
+//! Benchmark parameters.
+struct parameters_t
+{
+    //! Output mode.
+    output_mode_e output_mode;
+    //! Execute in blocks of this size; 0 for entire input at once.
+    size_t block_size;
+    //! Number of streams to split the input into; 1 for no interleaving.
+    size_t streams;
+    //! Runs before timing.
+    size_t warmup;
+    //! Timed runs.
+    size_t runs;
+};
+
+extern "C" {
+
+//! Eudoxus callback: count outputs.
+ia_eudoxus_command_t count_callback(
+    ia_eudoxus_t*,
+    const char*,
+    size_t,
+    const uint8_t*,
+    void* data
+)
+{
+    ++*reinterpret_cast<size_t*>(data);
+    return IA_EUDOXUS_CMD_CONTINUE;
+}
+
+//! Eudoxus callback: count output and stop.
+ia_eudoxus_command_t first_callback(
+    ia_eudoxus_t*,
+    const char*,
+    size_t,
+    const uint8_t*,
+    void* data
+)
+{
+    ++*reinterpret_cast<size_t*>(data);
+    return IA_EUDOXUS_CMD_STOP;
+}
+
+}
+
+/**
+ * Throw if @a rc is not a result that ends a run normally.
+ *
+ * @param[in] eudoxus Engine, for error message.
+ * @param[in] rc      Result to check.
+ * @throw runtime_error on error.
+ */
+void check_result(ia_eudoxus_t* eudoxus, ia_eudoxus_result_t rc)
+{
+    if (rc == IA_EUDOXUS_OK || rc == IA_EUDOXUS_STOP || rc == IA_EUDOXUS_END) {
+        return;
+    }
+    const char* message = ia_eudoxus_error(eudoxus);
+    throw runtime_error(
+        (boost::format("Eudoxus execution failed (%d): %s") %
+            rc % (message ? message : "No message.")
+        ).str()
+    );
+}
+
+/**
+ * Execute @a eudoxus once on @a input.
+ *
+ * @param[in] eudoxus    Engine.
+ * @param[in] input      Input.
+ * @param[in] parameters Benchmark parameters.
+ * @return Number of outputs.
+ * @throw runtime_error on error.
+ */
+size_t run_once(
+    ia_eudoxus_t*          eudoxus,
+    const vector<uint8_t>& input,
+    const parameters_t&    parameters
+)
+{
+    size_t outputs = 0;
+    ia_eudoxus_callback_t callback =
+        parameters.output_mode == OUTPUT_FIRST ?
+        first_callback : count_callback;
+
+    vector<ia_eudoxus_state_t*> states(parameters.streams);
+    BOOST_FOREACH(ia_eudoxus_state_t*& state, states) {
+        ia_eudoxus_result_t rc = ia_eudoxus_create_state(
+            &state, eudoxus, callback, &outputs
+        );
+        if (rc != IA_EUDOXUS_OK) {
+            throw runtime_error("Could not create state.");
+        }
+    }
+
+    // Each stream gets a contiguous piece of the input.
+    size_t stream_length = input.size() / states.size();
+    size_t block_size =
+        parameters.block_size == 0 ? input.size() : parameters.block_size;
+
+    vector<const uint8_t*> inputs(states.size());
+    vector<size_t> lengths(states.size());
+    vector<ia_eudoxus_result_t> results(states.size(), IA_EUDOXUS_OK);
+
+    try {
+        for (size_t offset = 0; offset < stream_length; offset += block_size) {
+            size_t length = min(block_size, stream_length - offset);
+            if (states.size() == 1) {
+                const uint8_t* data = &input[offset];
+                if (parameters.output_mode == OUTPUT_NONE) {
+                    results[0] = ia_eudoxus_execute_without_output(
+                        states[0], data, length
+                    );
+                }
+                else {
+                    results[0] = ia_eudoxus_execute(states[0], data, length);
+                }
+            }
+            else {
+                // Only streams that have not stopped or ended continue.
+                vector<ia_eudoxus_state_t*> active;
+                vector<size_t> active_index;
+                for (size_t i = 0; i < states.size(); ++i) {
+                    if (results[i] == IA_EUDOXUS_OK) {
+                        active.push_back(states[i]);
+                        active_index.push_back(i);
+                        inputs[active.size() - 1] =
+                            &input[i * stream_length + offset];
+                        lengths[active.size() - 1] = length;
+                    }
+                }
+                vector<ia_eudoxus_result_t> active_results(active.size());
+                ia_eudoxus_execute_interleaved(
+                    &active[0], &inputs[0], &lengths[0], &active_results[0],
+                    active.size()
+                );
+                for (size_t i = 0; i < active.size(); ++i) {
+                    results[active_index[i]] = active_results[i];
+                }
+            }
+
+            bool all_done = true;
+            BOOST_FOREACH(ia_eudoxus_result_t rc, results) {
+                check_result(eudoxus, rc);
+                if (rc == IA_EUDOXUS_OK) {
+                    all_done = false;
+                }
+            }
+            if (all_done) {
+                break;
+            }
+        }
+    }
+    catch (...) {
+        BOOST_FOREACH(ia_eudoxus_state_t* state, states) {
+            ia_eudoxus_destroy_state(state);
+        }
+        throw;
+    }
+
+    BOOST_FOREACH(ia_eudoxus_state_t* state, states) {
+        ia_eudoxus_destroy_state(state);
+    }
+
+    return outputs;
+}
+
+/**
+ * Benchmark the automata at @a path and report to cout.
+ *
+ * @param[in] path       Path to automata.
+ * @param[in] input      Input.
+ * @param[in] parameters Benchmark parameters.
+ * @throw runtime_error on error.
+ */
+void benchmark(
+    const string&          path,
+    const vector<uint8_t>& input,
+    const parameters_t&    parameters
+)
+{
+    ia_eudoxus_t* eudoxus = NULL;
+    clock_type::time_point start = clock_type::now();
+    ia_eudoxus_result_t rc =
+        ia_eudoxus_create_from_path(&eudoxus, path.c_str());
+    if (rc != IA_EUDOXUS_OK) {
+        throw runtime_error("Could not load " + path + ".");
+    }
+    ms_t load_time = clock_type::now() - start;
+
+    size_t outputs = 0;
+    vector<double> times;
+    try {
+        for (size_t i = 0; i < parameters.warmup; ++i) {
+            run_once(eudoxus, input, parameters);
+        }
+        for (size_t i = 0; i < parameters.runs; ++i) {
+            start = clock_type::now();
+            outputs = run_once(eudoxus, input, parameters);
+            times.push_back(ms_t(clock_type::now() - start).count());
+        }
+    }
+    catch (...) {
+        ia_eudoxus_destroy(eudoxus);
+        throw;
+    }
+    ia_eudoxus_destroy(eudoxus);
+
+    sort(times.begin(), times.end());
+    double median = times[times.size() / 2];
+    double mean =
+        accumulate(times.begin(), times.end(), 0.0) / times.size();
+    double mb = double(input.size()) / (1024 * 1024);
+
+    cout << boost::format(
+        "%s: load=%.3fms runs=%d min=%.3fms median=%.3fms mean=%.3fms "
+        "throughput=%.1fMB/s outputs=%d\n"
+    ) % path % load_time.count() % times.size() % times.front() % median
+      % mean % (median > 0 ? mb / (median / 1000) : 0) % outputs;
+}
+
+}
+
+//! Main.
+int main(int argc, char **argv)
+{
+    namespace po = boost::program_options;
+
+    string input_s;
+    string output_mode_s("none");
+    vector<string> automata;
+    parameters_t parameters;
+    parameters.block_size = 0;
+    parameters.streams = 1;
+    parameters.warmup = 1;
+    parameters.runs = 10;
+
+    po::options_description desc("Options:");
+    desc.add_options()
+        ("help", "display help and exit")
+        ("input,i", po::value<string>(&input_s),
+            "where to read input from, defaults to STDIN"
+        )
+        ("automata,a", po::value<vector<string> >(&automata),
+            "automata to benchmark; required, but -a is optional"
+        )
+        ("output,o", po::value<string>(&output_mode_s),
+            "output handling: none, count, first; default is none"
+        )
+        ("size,s", po::value<size_t>(&parameters.block_size),
+            "input block size; 0 = entire input; default = 0"
+        )
+        ("streams,S", po::value<size_t>(&parameters.streams),
+            "split input into this many equal interleaved streams; default = 1"
+        )
+        ("warmup,w", po::value<size_t>(&parameters.warmup),
+            "number of untimed runs; default = 1"
+        )
+        ("num-runs,n", po::value<size_t>(&parameters.runs),
+            "number of timed runs; default = 10"
+        )
+        ;
+
+    po::positional_options_description pd;
+    pd.add("automata", -1);
+
+    po::variables_map vm;
+    po::store(
+        po::command_line_parser(argc, argv)
+            .options(desc)
+            .positional(pd)
+            .run(),
+        vm
+    );
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        cout << desc << endl;
+        return 1;
+    }
+
+    if (automata.empty()) {
+        cout << "automata is required." << endl;
+        cout << desc << endl;
+        return 1;
+    }
+
+    if (output_mode_s == "none") {
+        parameters.output_mode = OUTPUT_NONE;
+    }
+    else if (output_mode_s == "count") {
+        parameters.output_mode = OUTPUT_COUNT;
+    }
+    else if (output_mode_s == "first") {
+        parameters.output_mode = OUTPUT_FIRST;
+    }
+    else {
+        cout << "Error: Unknown output handling: " << output_mode_s << endl;
+        return 1;
+    }
+
+    if (parameters.runs == 0) {
+        cout << "Error: Need at least one run." << endl;
+        return 1;
+    }
+    if (parameters.streams == 0) {
+        cout << "Error: Need at least one stream." << endl;
+        return 1;
+    }
+    if (parameters.streams > 1 && parameters.output_mode == OUTPUT_NONE) {
+        // Interleaved execution always generates output.
+        parameters.output_mode = OUTPUT_COUNT;
+        output_mode_s = "count";
+    }
+
+    try {
+        vector<uint8_t> input;
+        if (input_s.empty()) {
+            input.assign(
+                istreambuf_iterator<char>(cin),
+                istreambuf_iterator<char>()
+            );
+        }
+        else {
+            ifstream in(input_s.c_str(), ios::binary);
+            if (! in) {
+                cout << "Error: Could not open " << input_s << " for reading."
+                     << endl;
+                return 1;
+            }
+            input.assign(
+                istreambuf_iterator<char>(in),
+                istreambuf_iterator<char>()
+            );
+        }
+        if (input.size() < parameters.streams) {
+            cout << "Error: Input is shorter than number of streams." << endl;
+            return 1;
+        }
+
+        cout << boost::format(
+            "input=%d bytes output=%s block=%d streams=%d\n"
+        ) % input.size() % output_mode_s % parameters.block_size
+          % parameters.streams;
+
+        BOOST_FOREACH(const string& path, automata) {
+            benchmark(path, input, parameters);
+        }
+    }
+    catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
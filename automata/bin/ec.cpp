@@ -58,6 +58,7 @@ int main(int argc, char **argv)
     size_t id_width = 0;
     size_t align_to = 1;
     double high_node_weight = 1.0;
+    bool no_byte_classes = false;
 
     po::options_description desc("Options:");
     desc.add_options()
@@ -80,6 +81,9 @@ int main(int argc, char **argv)
             "> 1 favors low nodes; < 1 favors high nodes; 1.0 = smallest; "
             "default 1.0"
         )
+        ("no-byte-classes", po::bool_switch(&no_byte_classes),
+            "do not use byte class nodes"
+        )
         ;
 
     po::positional_options_description pd;
@@ -152,6 +156,7 @@ int main(int argc, char **argv)
         configuration.id_width = id_width;
         configuration.align_to = align_to;
         configuration.high_node_weight = high_node_weight;
+        configuration.byte_classes = ! no_byte_classes;
         try {
             result = EudoxusCompiler::compile(automata, configuration);
         }
@@ -173,6 +178,8 @@ int main(int argc, char **argv)
         cout << "high_nodes_bytes = " << result.high_nodes_bytes << endl;
         cout << "pc_nodes         = " << result.pc_nodes << endl;
         cout << "pc_nodes_bytes   = " << result.pc_nodes_bytes << endl;
+        cout << "class_nodes      = " << result.class_nodes << endl;
+        cout << "class_nodes_bytes = " << result.class_nodes_bytes << endl;
 
         static const int c_id_widths[] = {1, 2, 4, 8};
         for (int i = 0; i < 4; ++i) {
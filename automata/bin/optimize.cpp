@@ -26,6 +26,7 @@
 
 #include <ironautomata/deduplicate_outputs.hpp>
 #include <ironautomata/intermediate.hpp>
+#include <ironautomata/minimize.hpp>
 #include <ironautomata/optimize_edges.hpp>
 #include <ironautomata/translate_nonadvancing.hpp>
 
@@ -50,6 +51,8 @@ int main(int argc, char **argv)
 
     size_t chunk_size = 0;
     bool do_deduplicate_outputs = false;
+    bool do_determinize = false;
+    bool do_minimize = false;
     bool do_optimize_edges = false;
     bool do_translate_nonadvancing_conservative = false;
     bool do_translate_nonadvancing_aggressive = false;
@@ -65,6 +68,12 @@ int main(int argc, char **argv)
             "set chunk size of output to X")
         ("deduplicate-outputs",
             po::bool_switch(&do_deduplicate_outputs))
+        ("determinize",
+            po::bool_switch(&do_determinize),
+            "convert non-deterministic automata to deterministic")
+        ("minimize",
+            po::bool_switch(&do_minimize),
+            "merge equivalent nodes [space]")
         ("optimize-edges",
             po::bool_switch(&do_optimize_edges))
         ("translate-nonadvancing-conservative",
@@ -96,6 +105,7 @@ int main(int argc, char **argv)
     }
     if (vm.count("space")) {
         do_translate_nonadvancing_structural = true;
+        do_minimize = true;
         do_deduplicate_outputs = true;
         do_optimize_edges = true;
     }
@@ -115,6 +125,12 @@ int main(int argc, char **argv)
 
         Intermediate::read_automata(automata, cin, logger);
 
+        if (do_determinize) {
+            cerr << "Determinize: ";
+            cerr.flush();
+            size_t num_nodes = Intermediate::determinize(automata);
+            cerr << num_nodes << endl;
+        }
         if (do_translate_nonadvancing_conservative) {
             cerr << "Translate Nonadvancing [conservative]: ";
             cerr.flush();
@@ -141,6 +157,12 @@ int main(int argc, char **argv)
             );
             cerr << num_fixes << endl;
         }
+        if (do_minimize) {
+            cerr << "Minimize: ";
+            cerr.flush();
+            size_t num_removes = Intermediate::minimize(automata);
+            cerr << num_removes << endl;
+        }
         if (do_deduplicate_outputs) {
             cerr << "Deduplicate Outputs: ";
             cerr.flush();
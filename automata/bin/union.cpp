@@ -0,0 +1,83 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Union of Automata
+ *
+ * Combine automata so that they run as one.  Writes the union of the
+ * automata given to standard out.
+ */
+
+#include <ironautomata/deduplicate_outputs.hpp>
+#include <ironautomata/intermediate.hpp>
+#include <ironautomata/optimize_edges.hpp>
+#include <ironautomata/union_automata.hpp>
+
+#include <fstream>
+
+using namespace std;
+using namespace IronAutomata;
+
+//! Main.
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <automata> <automata>..." << endl;
+        return 1;
+    }
+
+    try {
+        ostream_logger logger(cerr);
+        Intermediate::Automata automata;
+
+        for (int i = 1; i < argc; ++i) {
+            ifstream input(argv[i]);
+            if (! input) {
+                cerr << "Error opening " << argv[i] << " for reading." << endl;
+                return 1;
+            }
+
+            Intermediate::Automata other;
+            if (! Intermediate::read_automata(other, input, logger)) {
+                cerr << "Error reading " << argv[i] << "." << endl;
+                return 1;
+            }
+
+            if (i == 1) {
+                automata = other;
+            }
+            else {
+                size_t num_nodes =
+                    Intermediate::union_automata(automata, other);
+                cerr << "Union with " << argv[i] << ": " << num_nodes
+                     << " nodes" << endl;
+            }
+        }
+
+        Intermediate::breadth_first(automata, Intermediate::optimize_edges);
+        Intermediate::deduplicate_outputs(automata);
+
+        Intermediate::write_automata(automata, cout);
+    }
+    catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -52,8 +52,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Maximum number of bytes leaving the start node for the SSE2 skip loop.
+ *
+ * Start nodes with more exits use a table lookup loop instead.
+ */
+#define IA_EUDOXUS_SKIP_VECTOR_BYTES 4
+
+/**
+ * Size of a huge page.
+ *
+ * Automata at least this large are backed by transparent huge pages where
+ * the system supports them.
+ */
+#define IA_EUDOXUS_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
 struct ia_eudoxus_t
 {
     /**
@@ -80,6 +101,51 @@ struct ia_eudoxus_t
      * otherwise.
      */
     bool free_error_message;
+
+    /**
+     * Length of the mapping holding @c automata.
+     *
+     * If non-zero, @c automata is a read-only shared mapping of a file and
+     * is unmapped rather than freed on destroy.
+     */
+    size_t mapped_length;
+
+    /**
+     * Byte class table; NULL if the automata has none.
+     */
+    const ia_eudoxus_byte_classes_t *byte_classes;
+
+    /**
+     * Start node.
+     */
+    const ia_eudoxus_node_t *start_node;
+
+    /**
+     * Can execution skip input while at the start node?
+     *
+     * True if the start node has no outputs and advances back to itself on
+     * at least one byte.  Such a run of input can be skipped without
+     * visiting the start node once per byte.
+     *
+     * @sa ia_eudoxus_skip_start()
+     */
+    bool start_skip;
+
+    /**
+     * Number of bytes that leave the start node.
+     */
+    int num_start_exits;
+
+    /**
+     * Non-zero for every byte that leaves the start node.
+     */
+    uint8_t start_exit[256];
+
+    /**
+     * The first IA_EUDOXUS_SKIP_VECTOR_BYTES bytes that leave the start
+     * node; unused entries repeat the first.
+     */
+    uint8_t start_exit_bytes[IA_EUDOXUS_SKIP_VECTOR_BYTES];
 };
 
 struct ia_eudoxus_state_t
@@ -177,9 +243,112 @@ enum ia_eudoxus_extended_command_t
 };
 typedef enum ia_eudoxus_extended_command_t ia_eudoxus_extended_command_t;
 
-ia_eudoxus_result_t ia_eudoxus_create(
+static
+void ia_eudoxus_analyze_start(
+    ia_eudoxus_t *eudoxus
+);
+
+/**
+ * Number of bytes of @a input that the start node advances over in place.
+ *
+ * Only valid if @c eudoxus->start_skip is true.
+ *
+ * @param[in] eudoxus      Engine.
+ * @param[in] input        Input, starting at the start node.
+ * @param[in] input_length Length of @a input.
+ * @return Index of the first byte of @a input that leaves the start node or
+ *         @a input_length if there is none.
+ */
+static inline
+size_t ia_eudoxus_skip_start(
+    const ia_eudoxus_t *eudoxus,
+    const uint8_t      *input,
+    size_t              input_length
+)
+{
+    size_t i = 0;
+
+    if (eudoxus->num_start_exits == 0) {
+        return input_length;
+    }
+    if (eudoxus->num_start_exits == 1) {
+        const uint8_t *exit = (const uint8_t *)memchr(
+            input, eudoxus->start_exit_bytes[0], input_length
+        );
+        return exit == NULL ? input_length : (size_t)(exit - input);
+    }
+
+#ifdef __SSE2__
+    if (eudoxus->num_start_exits <= IA_EUDOXUS_SKIP_VECTOR_BYTES) {
+        const __m128i b0 = _mm_set1_epi8((char)eudoxus->start_exit_bytes[0]);
+        const __m128i b1 = _mm_set1_epi8((char)eudoxus->start_exit_bytes[1]);
+        const __m128i b2 = _mm_set1_epi8((char)eudoxus->start_exit_bytes[2]);
+        const __m128i b3 = _mm_set1_epi8((char)eudoxus->start_exit_bytes[3]);
+
+        for (; i + 16 <= input_length; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(input + i));
+            __m128i m = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, b0), _mm_cmpeq_epi8(v, b1)),
+                _mm_or_si128(_mm_cmpeq_epi8(v, b2), _mm_cmpeq_epi8(v, b3))
+            );
+            int mask = _mm_movemask_epi8(m);
+            if (mask != 0) {
+                return i + __builtin_ctz(mask);
+            }
+        }
+    }
+#endif
+
+    while (i < input_length && ! eudoxus->start_exit[input[i]]) {
+        ++i;
+    }
+
+    return i;
+}
+
+/**
+ * Ask for huge pages for the automata at @a data.
+ *
+ * Execution jumps between distant nodes, so a large automata spread over
+ * small pages spends much of its time on TLB misses.  This is advice only:
+ * without kernel support the automata stays on normal pages.
+ *
+ * @param[in] data   Automata; must be page aligned.
+ * @param[in] length Length of @a data.
+ */
+static
+void ia_eudoxus_advise_huge_pages(
+    void   *data,
+    size_t  length
+)
+{
+#ifdef MADV_HUGEPAGE
+    if (length >= IA_EUDOXUS_HUGE_PAGE_SIZE) {
+        madvise(data, length, MADV_HUGEPAGE);
+    }
+#else
+    (void)data;
+    (void)length;
+#endif
+}
+
+/**
+ * Create a Eudoxus engine for @a data.
+ *
+ * @param[out] out_eudoxus   Variable to hold pointer to created engine.
+ * @param[in]  data          Data holding automata.
+ * @param[in]  data_length   Length of @a data; 0 if unknown.
+ * @param[in]  mapped_length Length of mapping of @a data; 0 if @a data is
+ *                           heap allocated.
+ * @return As ia_eudoxus_create(), plus IA_EUDOXUS_EINVAL if @a data_length
+ *         is shorter than the automata.
+ */
+static
+ia_eudoxus_result_t ia_eudoxus_create_internal(
     ia_eudoxus_t **out_eudoxus,
-    char          *data
+    char          *data,
+    size_t         data_length,
+    size_t         mapped_length
 )
 {
     ia_eudoxus_t        *eudoxus = NULL;
@@ -189,14 +358,19 @@ ia_eudoxus_result_t ia_eudoxus_create(
         return IA_EUDOXUS_EINVAL;
     }
 
+    if (data_length > 0 && data_length < sizeof(ia_eudoxus_automata_t)) {
+        return IA_EUDOXUS_EINVAL;
+    }
+
     eudoxus = (ia_eudoxus_t *)malloc(sizeof(*eudoxus));
     if (eudoxus == NULL) {
-        return IA_EUDOXUS_EINVAL;
+        return IA_EUDOXUS_EALLOC;
     }
 
     eudoxus->automata           = (ia_eudoxus_automata_t *)data;
     eudoxus->error_message      = NULL;
     eudoxus->free_error_message = false;
+    eudoxus->mapped_length      = mapped_length;
 
     if (eudoxus->automata->version != IA_EUDOXUS_VERSION) {
         rc = IA_EUDOXUS_EINCOMPAT;
@@ -208,6 +382,29 @@ ia_eudoxus_result_t ia_eudoxus_create(
         goto finish;
     }
 
+    if (data_length > 0 && eudoxus->automata->data_length > data_length) {
+        rc = IA_EUDOXUS_EINVAL;
+        goto finish;
+    }
+
+    eudoxus->byte_classes = NULL;
+    if (eudoxus->automata->byte_class_index != 0) {
+        if (
+            eudoxus->automata->byte_class_index +
+                sizeof(ia_eudoxus_byte_classes_t) >
+            eudoxus->automata->data_length
+        ) {
+            rc = IA_EUDOXUS_EINVAL;
+            goto finish;
+        }
+        eudoxus->byte_classes = (const ia_eudoxus_byte_classes_t *)(
+            (const char *)eudoxus->automata +
+            eudoxus->automata->byte_class_index
+        );
+    }
+
+    ia_eudoxus_analyze_start(eudoxus);
+
 finish:
     if (rc != IA_EUDOXUS_OK) {
         if (eudoxus != NULL) {
@@ -221,6 +418,13 @@ finish:
     return rc;
 }
 
+ia_eudoxus_result_t ia_eudoxus_create(
+    ia_eudoxus_t **out_eudoxus,
+    char          *data
+)
+{
+    return ia_eudoxus_create_internal(out_eudoxus, data, 0, 0);
+}
 
 ia_eudoxus_result_t ia_eudoxus_create_from_file(
     ia_eudoxus_t **out_eudoxus,
@@ -229,14 +433,61 @@ ia_eudoxus_result_t ia_eudoxus_create_from_file(
 {
     char *buffer = NULL;
     size_t did_read = 0;
+    struct stat st;
+    ia_eudoxus_result_t rc;
+
+    if (out_eudoxus == NULL || fp == NULL) {
+        return IA_EUDOXUS_EINVAL;
+    }
+
+    /* Prefer a read-only shared mapping: the automata is then loaded on
+     * demand and its pages are shared by every process that loads the same
+     * file.  A mapped file rewritten in place changes under the engine, and
+     * truncating it makes access raise SIGBUS, so only files without write
+     * permission are mapped; others are copied. */
+    if (
+        fstat(fileno(fp), &st) == 0 &&
+        S_ISREG(st.st_mode) &&
+        (st.st_mode & (S_IWUSR | S_IWGRP | S_IWOTH)) == 0 &&
+        (size_t)st.st_size >= sizeof(ia_eudoxus_automata_t)
+    ) {
+        void *mapped = mmap(
+            NULL, st.st_size, PROT_READ, MAP_SHARED, fileno(fp), 0
+        );
+        if (mapped != MAP_FAILED) {
+            ia_eudoxus_advise_huge_pages(mapped, st.st_size);
+            rc = ia_eudoxus_create_internal(
+                out_eudoxus, (char *)mapped, st.st_size, st.st_size
+            );
+            if (rc != IA_EUDOXUS_OK) {
+                munmap(mapped, st.st_size);
+            }
+            return rc;
+        }
+        /* Fall back to reading the file. */
+    }
 
     off_t file_size = lseek(fileno(fp), 0, SEEK_END);
     lseek(fileno(fp), 0, SEEK_SET);
-    if (file_size < 0) {
+    if (file_size <= 0) {
         return IA_EUDOXUS_EINVAL;
     }
 
-    buffer = (char *)malloc(file_size);
+    if (file_size >= IA_EUDOXUS_HUGE_PAGE_SIZE) {
+        /* Align so that the whole automata can be on huge pages. */
+        void *aligned = NULL;
+        if (
+            posix_memalign(&aligned, IA_EUDOXUS_HUGE_PAGE_SIZE, file_size)
+            != 0
+        ) {
+            return IA_EUDOXUS_EALLOC;
+        }
+        buffer = (char *)aligned;
+        ia_eudoxus_advise_huge_pages(buffer, file_size);
+    }
+    else {
+        buffer = (char *)malloc(file_size);
+    }
     if (! buffer) {
         return IA_EUDOXUS_EALLOC;
     }
@@ -247,7 +498,12 @@ ia_eudoxus_result_t ia_eudoxus_create_from_file(
         return IA_EUDOXUS_EINVAL;
     }
 
-    return ia_eudoxus_create(out_eudoxus, buffer);
+    rc = ia_eudoxus_create_internal(out_eudoxus, buffer, file_size, 0);
+    if (rc != IA_EUDOXUS_OK) {
+        free(buffer);
+    }
+
+    return rc;
 }
 
 ia_eudoxus_result_t ia_eudoxus_create_from_path(
@@ -255,6 +511,10 @@ ia_eudoxus_result_t ia_eudoxus_create_from_path(
     const char    *path
 )
 {
+    if (path == NULL) {
+        return IA_EUDOXUS_EINVAL;
+    }
+
     FILE *fp = fopen(path, "r");
     if (! fp) {
         return IA_EUDOXUS_EINVAL;
@@ -278,7 +538,12 @@ void ia_eudoxus_destroy(
     /* Better to cast away const here than to not have const checks for
      * all uses. */
     if (eudoxus->automata) {
-        free((void *)eudoxus->automata);
+        if (eudoxus->mapped_length > 0) {
+            munmap((void *)eudoxus->automata, eudoxus->mapped_length);
+        }
+        else {
+            free((void *)eudoxus->automata);
+        }
     }
     if (eudoxus->error_message != NULL && eudoxus->free_error_message) {
         free((void *)eudoxus->error_message);
@@ -319,9 +584,7 @@ ia_eudoxus_result_t ia_eudoxus_create_state(
     state->callback       = callback;
     state->callback_data  = callback_data;
     state->input_location = NULL;
-    state->node           = (ia_eudoxus_node_t *)(
-        (char *)eudoxus->automata + eudoxus->automata->start_index
-    );
+    state->node           = eudoxus->start_node;
     state->byte_index     = 0;
 
     *out_state = state;
@@ -330,6 +593,23 @@ ia_eudoxus_result_t ia_eudoxus_create_state(
     return ia_eudoxus_execute(state, NULL, 0);
 }
 
+ia_eudoxus_result_t ia_eudoxus_reset_state(
+    ia_eudoxus_state_t *state
+)
+{
+    if (state == NULL) {
+        return IA_EUDOXUS_EINVAL;
+    }
+
+    state->input_location  = NULL;
+    state->remaining_bytes = 0;
+    state->node            = state->eudoxus->start_node;
+    state->byte_index      = 0;
+
+    /* Process outputs for start node. */
+    return ia_eudoxus_execute(state, NULL, 0);
+}
+
 void ia_eudoxus_destroy_state(
     ia_eudoxus_state_t *state
 )
@@ -442,6 +722,99 @@ void ia_eudoxus_set_error_printf(
 
 /* End Specific Subengine Code */
 
+/**
+ * Callback for the scratch state of ia_eudoxus_analyze_start().
+ *
+ * Never called, as outputs are not processed.
+ */
+static
+ia_eudoxus_command_t ia_eudoxus_analyze_start_callback(
+    ia_eudoxus_t  *engine,
+    const char    *output,
+    size_t         output_length,
+    const uint8_t *input,
+    void          *callback_data
+)
+{
+    return IA_EUDOXUS_CMD_CONTINUE;
+}
+
+/**
+ * Determine which bytes leave the start node of @a eudoxus.
+ *
+ * Steps a scratch state from the start node on every byte and sets
+ * @c start_skip, @c start_exit and @c start_exit_bytes accordingly.
+ *
+ * @param[in, out] eudoxus Engine to analyze.
+ */
+static
+void ia_eudoxus_analyze_start(
+    ia_eudoxus_t *eudoxus
+)
+{
+    assert(eudoxus           != NULL);
+    assert(eudoxus->automata != NULL);
+
+    ia_eudoxus_state_t state;
+    int c;
+
+    eudoxus->start_node = (const ia_eudoxus_node_t *)(
+        (const char *)eudoxus->automata + eudoxus->automata->start_index
+    );
+    eudoxus->start_skip      = false;
+    eudoxus->num_start_exits = 0;
+
+    /* Output would have to be emitted for every byte skipped. */
+    if (IA_EUDOXUS_FLAG(eudoxus->start_node->header, 0)) {
+        return;
+    }
+    if (IA_EUDOXUS_TYPE(eudoxus->start_node->header) == IA_EUDOXUS_PC) {
+        return;
+    }
+
+    state.eudoxus       = eudoxus;
+    state.callback      = ia_eudoxus_analyze_start_callback;
+    state.callback_data = NULL;
+
+    for (c = 0; c < 256; ++c) {
+        const uint8_t       input = (uint8_t)c;
+        ia_eudoxus_result_t rc;
+        bool                exits;
+
+        state.node            = eudoxus->start_node;
+        state.byte_index      = 0;
+        state.input_location  = &input;
+        state.remaining_bytes = 1;
+
+        switch (eudoxus->automata->id_width) {
+        case 8: rc = ia_eudoxus8_next(&state); break;
+        case 4: rc = ia_eudoxus4_next(&state); break;
+        case 2: rc = ia_eudoxus2_next(&state); break;
+        case 1: rc = ia_eudoxus1_next(&state); break;
+        default: return;
+        }
+
+        exits =
+            rc != IA_EUDOXUS_OK ||
+            state.node != eudoxus->start_node ||
+            state.remaining_bytes != 0;
+        eudoxus->start_exit[c] = exits;
+        if (exits) {
+            if (eudoxus->num_start_exits < IA_EUDOXUS_SKIP_VECTOR_BYTES) {
+                eudoxus->start_exit_bytes[eudoxus->num_start_exits] = input;
+            }
+            ++eudoxus->num_start_exits;
+        }
+    }
+    ia_eudoxus_set_error(eudoxus, NULL);
+
+    for (c = eudoxus->num_start_exits; c < IA_EUDOXUS_SKIP_VECTOR_BYTES; ++c) {
+        eudoxus->start_exit_bytes[c] = eudoxus->start_exit_bytes[0];
+    }
+
+    eudoxus->start_skip = eudoxus->num_start_exits < 256;
+}
+
 static
 ia_eudoxus_result_t ia_eudoxus_execute_impl(
     ia_eudoxus_state_t *state,
@@ -482,6 +855,135 @@ ia_eudoxus_result_t ia_eudoxus_execute_without_output(
     return ia_eudoxus_execute_impl(state, input, input_length, false);
 }
 
+/**
+ * Subengine begin and step functions for an engine.
+ */
+typedef struct {
+    /** Begin function. */
+    ia_eudoxus_result_t (*begin)(
+        ia_eudoxus_state_t *state,
+        const uint8_t      *input,
+        size_t              input_length
+    );
+
+    /** Step function. */
+    ia_eudoxus_result_t (*step)(
+        ia_eudoxus_state_t *state,
+        bool                with_output
+    );
+} ia_eudoxus_subengine_t;
+
+/**
+ * Look up the subengine functions for @a eudoxus.
+ *
+ * @param[in]  eudoxus   Engine.
+ * @param[out] subengine Subengine functions.
+ * @return true on success; false if @a eudoxus has an unknown id width.
+ */
+static
+bool ia_eudoxus_subengine(
+    const ia_eudoxus_t     *eudoxus,
+    ia_eudoxus_subengine_t *subengine
+)
+{
+    switch (eudoxus->automata->id_width) {
+    case 8:
+        subengine->begin = ia_eudoxus8_begin;
+        subengine->step  = ia_eudoxus8_step;
+        return true;
+    case 4:
+        subengine->begin = ia_eudoxus4_begin;
+        subengine->step  = ia_eudoxus4_step;
+        return true;
+    case 2:
+        subengine->begin = ia_eudoxus2_begin;
+        subengine->step  = ia_eudoxus2_step;
+        return true;
+    case 1:
+        subengine->begin = ia_eudoxus1_begin;
+        subengine->step  = ia_eudoxus1_step;
+        return true;
+    default:
+        return false;
+    }
+}
+
+ia_eudoxus_result_t ia_eudoxus_execute_interleaved(
+    ia_eudoxus_state_t  **states,
+    const uint8_t       **inputs,
+    const size_t         *input_lengths,
+    ia_eudoxus_result_t  *results,
+    size_t                num_states
+)
+{
+    ia_eudoxus_subengine_t subengines[IA_EUDOXUS_INTERLEAVE_MAX];
+    size_t                 active[IA_EUDOXUS_INTERLEAVE_MAX];
+    size_t                 base;
+
+    if (
+        states == NULL || inputs == NULL || input_lengths == NULL ||
+        results == NULL
+    ) {
+        return IA_EUDOXUS_EINVAL;
+    }
+
+    /* Interleave up to IA_EUDOXUS_INTERLEAVE_MAX states at a time. */
+    for (base = 0; base < num_states; base += IA_EUDOXUS_INTERLEAVE_MAX) {
+        size_t limit      = base + IA_EUDOXUS_INTERLEAVE_MAX;
+        size_t num_active = 0;
+        size_t i;
+
+        if (limit > num_states) {
+            limit = num_states;
+        }
+
+        for (i = base; i < limit; ++i) {
+            ia_eudoxus_state_t *state = states[i];
+
+            if (state == NULL) {
+                results[i] = IA_EUDOXUS_EINVAL;
+                continue;
+            }
+            if (
+                ! ia_eudoxus_subengine(state->eudoxus, &subengines[i - base])
+            ) {
+                results[i] = IA_EUDOXUS_EINCOMPAT;
+                continue;
+            }
+            results[i] = subengines[i - base].begin(
+                state, inputs[i], input_lengths[i]
+            );
+            if (results[i] == IA_EUDOXUS_OK && state->remaining_bytes > 0) {
+                active[num_active] = i;
+                ++num_active;
+            }
+        }
+
+        /* Step each active state in turn so that their memory accesses
+         * overlap. */
+        while (num_active > 0) {
+            size_t j = 0;
+            while (j < num_active) {
+                size_t              k      = active[j];
+                ia_eudoxus_state_t *state  = states[k];
+                ia_eudoxus_result_t result =
+                    subengines[k - base].step(state, true);
+
+                if (result != IA_EUDOXUS_OK || state->remaining_bytes == 0) {
+                    results[k] = result;
+                    --num_active;
+                    active[j] = active[num_active];
+                }
+                else {
+                    ++j;
+                }
+            }
+        }
+    }
+
+    return IA_EUDOXUS_OK;
+}
+
 ia_eudoxus_result_t ia_eudoxus_metadata(
     ia_eudoxus_t                   *eudoxus,
     ia_eudoxus_metadata_callback_t  callback,
@@ -39,6 +39,8 @@
 #pragma clang diagnostic pop
 #endif
 
+#include <algorithm>
+#include <bitset>
 #include <queue>
 #include <set>
 
@@ -47,7 +49,7 @@ using namespace std;
 namespace IronAutomata {
 namespace EudoxusCompiler {
 
-#define CPP_EUDOXUS_VERSION 10
+#define CPP_EUDOXUS_VERSION 11
 #if CPP_EUDOXUS_VERSION != IA_EUDOXUS_VERSION
 #error "Mismatch between compiler version and automata version."
 #endif
@@ -100,6 +102,8 @@ private:
     typedef typename traits_t::high_node_t   e_high_node_t;
     //! Eudoxus PC Node
     typedef typename traits_t::pc_node_t     e_pc_node_t;
+    //! Eudoxus Byte Class Node
+    typedef typename traits_t::class_node_t  e_class_node_t;
     //! Eudoxus Output List.
     typedef typename traits_t::output_list_t e_output_list_t;
 
@@ -120,9 +124,14 @@ private:
         //! use_ali will be set if num_consecutive > c_ali_threshold.
         static const size_t c_ali_threshold = 32;
 
-        //! Constructor.
-        explicit
-        NodeOracle(const Intermediate::node_p& node)
+        /**
+         * Constructor.
+         *
+         * @param[in] node        Node to answer questions about.
+         * @param[in] num_classes Number of byte classes; 0 if byte class
+         *                        nodes are disabled.
+         */
+        NodeOracle(const Intermediate::node_p& node, size_t num_classes)
         {
             has_nonadvancing = (
                 find_if(node->edges().begin(), node->edges().end(), is_nonadvancing)
@@ -196,6 +205,26 @@ private:
             else {
                 high_node_cost += sizeof(e_id_t) * out_degree;
             }
+
+            use_class = (num_classes > 0);
+            class_node_cost = 0;
+            if (use_class) {
+                class_node_cost += sizeof(e_class_node_t);
+                if (node->first_output()) {
+                    class_node_cost += sizeof(e_id_t);
+                }
+                if (node->default_target()) {
+                    class_node_cost += sizeof(e_id_t);
+                }
+                if (has_nonadvancing) {
+                    class_node_cost += (num_classes + 7) / 8;
+                }
+                class_node_cost += sizeof(e_id_t) * num_classes;
+
+                /* Prefer byte class nodes when no larger: lookup is faster
+                 * than for high nodes. */
+                use_class = (class_node_cost <= high_node_cost);
+            }
         }
 
         //! True if there are non-advancing edges (not including default).
@@ -218,6 +247,11 @@ private:
         size_t low_node_cost;
         //! Cost in bytes of representing with a high node.
         size_t high_node_cost;
+        //! Cost in bytes of representing with a byte class node.
+        size_t class_node_cost;
+
+        //! True if a byte class node should be used instead of a high node.
+        bool use_class;
 
         //! Targets by input map.
         Intermediate::Node::targets_by_input_t targets_by_input;
@@ -299,10 +333,10 @@ private:
         m_result.pc_nodes_bytes += m_assembler.size() - old_size;
     }
 
-    //! Compile node into a demux (high or low) node.
+    //! Compile node into a demux (high, byte class or low) node.
     void demux_node(const Intermediate::node_p& node)
     {
-        NodeOracle oracle(node);
+        NodeOracle oracle(node, m_num_classes);
 
         if (! oracle.deterministic) {
             throw runtime_error(
@@ -315,8 +349,14 @@ private:
         size_t* nodes_counter = NULL;
         size_t cost_prediction = 0;
 
+        size_t table_node_cost = (
+            oracle.use_class ?
+            oracle.class_node_cost :
+            oracle.high_node_cost
+        );
+
         if (
-            oracle.high_node_cost * m_configuration.high_node_weight
+            table_node_cost * m_configuration.high_node_weight
              > oracle.low_node_cost
         ) {
             cost_prediction = oracle.low_node_cost;
@@ -324,6 +364,12 @@ private:
             nodes_counter = &m_result.low_nodes;
             low_node(*node, oracle);
         }
+        else if (oracle.use_class) {
+            cost_prediction = oracle.class_node_cost;
+            bytes_counter = &m_result.class_nodes_bytes;
+            nodes_counter = &m_result.class_nodes;
+            class_node(*node, oracle);
+        }
         else {
             cost_prediction = oracle.high_node_cost;
             bytes_counter = &m_result.high_nodes_bytes;
@@ -555,6 +601,231 @@ private:
         }
     }
 
+    /**
+     * Compile @a node as a class_node.
+     *
+     * Appends a byte class node to the buffer representing @a node.
+     *
+     * @param[in] node Intermediate node to compile.
+     */
+    void class_node(
+        const Intermediate::Node& node,
+        const NodeOracle& oracle
+    )
+    {
+        {
+            e_class_node_t* header =
+                m_assembler.append_object(e_class_node_t());
+
+            header->header = IA_EUDOXUS_CLASS;
+            if (node.first_output()) {
+                header->header = ia_setbit8(header->header, 0 + IA_EUDOXUS_TYPE_WIDTH);
+            }
+            if (oracle.has_nonadvancing) {
+                header->header = ia_setbit8(header->header, 1 + IA_EUDOXUS_TYPE_WIDTH);
+            }
+            if (node.default_target()) {
+                header->header = ia_setbit8(header->header, 2 + IA_EUDOXUS_TYPE_WIDTH);
+            }
+            if (node.advance_on_default()) {
+                header->header = ia_setbit8(header->header, 3 + IA_EUDOXUS_TYPE_WIDTH);
+            }
+        }
+
+        if (node.first_output()) {
+            append_output_ref(node.first_output());
+            m_outputs.insert(node.first_output());
+        }
+
+        if (node.default_target()) {
+            append_node_ref(node.default_target());
+        }
+
+        if (oracle.has_nonadvancing) {
+            size_t advance_index = m_assembler.index(
+                m_assembler.template append_array<uint8_t>(
+                    (m_num_classes + 7) / 8
+                )
+            );
+            for (size_t k = 0; k < m_num_classes; ++k) {
+                const Intermediate::Node::target_info_list_t& targets =
+                    oracle.targets_by_input[m_class_representative[k]];
+                if (! targets.empty() && targets.front().second) {
+                    ia_setbitv(
+                        m_assembler.template ptr<uint8_t>(advance_index),
+                        k
+                    );
+                }
+            }
+        }
+
+        for (size_t k = 0; k < m_num_classes; ++k) {
+            const Intermediate::Node::target_info_list_t& targets =
+                oracle.targets_by_input[m_class_representative[k]];
+            if (
+                ! targets.empty() &&
+                targets.front().first != node.default_target()
+            ) {
+                append_node_ref(targets.front().first);
+            }
+            else {
+                m_assembler.append_object(e_id_t(0));
+                ++m_result.ids_used;
+            }
+        }
+    }
+
+    /**
+     * Calculate the byte classes of @a automata.
+     *
+     * Two inputs are in the same class iff they have the same targets, with
+     * the same advance behavior, at every node.  Sets @c m_classes,
+     * @c m_class_representative and @c m_num_classes.
+     *
+     * @param[in] automata Automata to calculate byte classes of.
+     */
+    void calculate_byte_classes(const Intermediate::Automata& automata)
+    {
+        m_classes.assign(256, 0);
+        breadth_first(
+            automata,
+            boost::bind(
+                refine_byte_classes,
+                boost::ref(m_classes),
+                _1
+            )
+        );
+
+        m_class_representative.clear();
+        for (int c = 0; c < 256; ++c) {
+            if (m_classes[c] == m_class_representative.size()) {
+                m_class_representative.push_back(c);
+            }
+        }
+        m_num_classes = m_class_representative.size();
+    }
+
+    /**
+     * Add bytes saved by compiling @a node as a byte class node to
+     * @a savings.
+     *
+     * Path compression is not taken into account, so this is an estimate.
+     *
+     * @param[in, out] savings Bytes saved.
+     * @param[in]      node    Node to estimate savings of.
+     */
+    void estimate_class_savings(
+        size_t&                     savings,
+        const Intermediate::node_p& node
+    ) const
+    {
+        if (node->edges().empty()) {
+            return;
+        }
+
+        double weight = m_configuration.high_node_weight;
+
+        // A byte class node needs an identifier per class, so a node with
+        // few edge values is a low node whatever its oracle says.  Checking
+        // that first avoids building an oracle for most nodes.
+        size_t max_out_degree = 0;
+        BOOST_FOREACH(const Intermediate::Edge& edge, node->edges()) {
+            max_out_degree += (edge.epsilon() ? 256 : edge.size());
+        }
+        max_out_degree = min(max_out_degree, size_t(256));
+        size_t max_low_node_cost =
+            sizeof(e_low_node_t) + 2 * sizeof(e_id_t) + sizeof(uint8_t) +
+            sizeof(e_low_edge_t) * max_out_degree + (max_out_degree + 7) / 8;
+        size_t min_class_node_cost =
+            sizeof(e_class_node_t) + sizeof(e_id_t) * m_num_classes;
+        if (min_class_node_cost * weight > max_low_node_cost) {
+            return;
+        }
+
+        NodeOracle oracle(node, m_num_classes);
+
+        if (
+            ! oracle.use_class ||
+            oracle.class_node_cost * weight > oracle.low_node_cost
+        ) {
+            return;
+        }
+
+        size_t cost = (
+            oracle.high_node_cost * weight > oracle.low_node_cost ?
+            oracle.low_node_cost :
+            oracle.high_node_cost
+        );
+        if (cost > oracle.class_node_cost) {
+            savings += cost - oracle.class_node_cost;
+        }
+    }
+
+    /**
+     * Refine @a classes by the targets of @a node.
+     *
+     * Classes are split by membership in the inputs of each distinct
+     * target/advance pair of @a node in turn, which gives the same partition
+     * as splitting by the full target list of each input without building
+     * one.  Classes are renumbered in order of their smallest input.
+     *
+     * @param[in, out] classes Class of each input.
+     * @param[in]      node    Node to refine by.
+     */
+    static
+    void refine_byte_classes(
+        vector<size_t>&             classes,
+        const Intermediate::node_p& node
+    )
+    {
+        typedef bitset<256> input_set_t;
+        typedef map<Intermediate::Node::target_info_t, input_set_t>
+            inputs_by_target_t;
+
+        inputs_by_target_t by_target;
+        input_set_t covered;
+        BOOST_FOREACH(const Intermediate::Edge& edge, node->edges()) {
+            input_set_t& inputs = by_target[
+                Intermediate::Node::target_info_t(
+                    edge.target(), edge.advance()
+                )
+            ];
+            if (edge.epsilon()) {
+                inputs.set();
+            }
+            else {
+                BOOST_FOREACH(uint8_t c, edge) {
+                    inputs.set(c);
+                }
+            }
+            covered |= inputs;
+        }
+        if (node->default_target()) {
+            by_target[
+                Intermediate::Node::target_info_t(
+                    node->default_target(), node->advance_on_default()
+                )
+            ] |= ~covered;
+        }
+
+        vector<size_t> renumber(2 * 256);
+        BOOST_FOREACH(const inputs_by_target_t::value_type& v, by_target) {
+            const input_set_t& inputs = v.second;
+            if (inputs.none() || inputs.count() == 256) {
+                continue;
+            }
+            fill(renumber.begin(), renumber.end(), size_t(-1));
+            size_t num_classes = 0;
+            for (int c = 0; c < 256; ++c) {
+                size_t& id = renumber[2 * classes[c] + inputs.test(c)];
+                if (id == size_t(-1)) {
+                    id = num_classes++;
+                }
+                classes[c] = id;
+            }
+        }
+    }
+
     /**
      * Go back over buffer and fill in the identifiers.
      *
@@ -799,6 +1070,13 @@ private:
     //! Set of all known outputs.
     output_set_t m_outputs;
 
+    //! Byte class of each input.
+    vector<size_t> m_classes;
+    //! Smallest input of each byte class.
+    vector<uint8_t> m_class_representative;
+    //! Number of byte classes; 0 if byte class nodes are disabled.
+    size_t m_num_classes;
+
     //! Maximum index of buffer based on id_width.
     const uint64_t m_max_index;
 };
@@ -812,6 +1090,7 @@ Compiler<id_width>::Compiler(
     m_configuration(configuration),
     m_assembler(result.buffer),
     m_e_automata_index(0),
+    m_num_classes(0),
     m_max_index(numeric_limits<e_id_t>::max())
 {
     // nop
@@ -831,6 +1110,8 @@ void Compiler<id_width>::compile(
     m_result.high_nodes_bytes = 0;
     m_result.pc_nodes = 0;
     m_result.pc_nodes_bytes = 0;
+    m_result.class_nodes = 0;
+    m_result.class_nodes_bytes = 0;
 
     // Header
     ia_eudoxus_automata_t* e_automata =
@@ -846,10 +1127,30 @@ void Compiler<id_width>::compile(
     e_automata->num_outputs      = 0;
     e_automata->num_output_lists = 0;
     e_automata->data_length      = 0;
+    e_automata->byte_class_index = 0;
 
     // Store index as it will likely move.
     m_e_automata_index = m_assembler.index(e_automata);
 
+    if (m_configuration.byte_classes) {
+        calculate_byte_classes(automata);
+
+        // Byte classes only pay off if they save more than the table.
+        size_t savings = 0;
+        breadth_first(
+            automata,
+            boost::bind(
+                &Compiler::estimate_class_savings,
+                this,
+                boost::ref(savings),
+                _1
+            )
+        );
+        if (savings <= sizeof(ia_eudoxus_byte_classes_t)) {
+            m_num_classes = 0;
+        }
+    }
+
     // Calculate Node Parents
     parent_map_t parents;
     breadth_first(
@@ -964,8 +1265,21 @@ void Compiler<id_width>::compile(
         );
     }
 
+    // Append byte class table if used.
+    size_t byte_class_index = 0;
+    if (m_result.class_nodes > 0) {
+        ia_eudoxus_byte_classes_t* e_byte_classes =
+            m_assembler.append_object(ia_eudoxus_byte_classes_t());
+        byte_class_index = m_assembler.index(e_byte_classes);
+        e_byte_classes->num_classes = m_num_classes;
+        for (int c = 0; c < 256; ++c) {
+            e_byte_classes->classes[c] = m_classes[c];
+        }
+    }
+
     // Recover pointer.
     e_automata = m_assembler.ptr<ia_eudoxus_automata_t>(m_e_automata_index);
+    e_automata->byte_class_index = byte_class_index;
     e_automata->num_nodes      = m_node_map.size();
     e_automata->num_outputs    = m_output_map.size();
     e_automata->num_metadata   = automata.metadata().size();
@@ -1027,7 +1341,8 @@ result_t compile_minimal(
 configuration_t::configuration_t() :
     id_width(0),
     align_to(1),
-    high_node_weight(1.0)
+    high_node_weight(1.0),
+    byte_classes(true)
 {
     // nop
 }
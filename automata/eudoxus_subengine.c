@@ -252,6 +252,94 @@ ia_eudoxus_result_t IA_EUDOXUS(next_high)(
     return IA_EUDOXUS_OK;
 }
 
+/* Byte Class Node */
+
+/**
+ * Next function for byte class nodes.
+ *
+ * @sa IA_EUDOXUS(next) for details.
+ */
+static
+ia_eudoxus_result_t IA_EUDOXUS(next_class)(
+    ia_eudoxus_state_t *state
+)
+{
+    if (state == NULL) {
+        return IA_EUDOXUS_EINSANE;
+    }
+
+    assert(state->eudoxus        != NULL);
+    assert(state->callback       != NULL);
+    assert(state->node           != NULL);
+    assert(state->input_location != NULL);
+
+    const ia_eudoxus_byte_classes_t *byte_classes =
+        state->eudoxus->byte_classes;
+    if (byte_classes == NULL) {
+        ia_eudoxus_set_error_cstr(
+            state->eudoxus,
+            "Byte class node in automata without byte classes."
+        );
+        return IA_EUDOXUS_EINVAL;
+    }
+
+    const uint8_t c = *(state->input_location);
+    const uint8_t byte_class = byte_classes->classes[c];
+    bool has_output         = IA_EUDOXUS_FLAG(state->node->header, 0);
+    bool has_nonadvancing   = IA_EUDOXUS_FLAG(state->node->header, 1);
+    bool has_default        = IA_EUDOXUS_FLAG(state->node->header, 2);
+    bool advance_on_default = IA_EUDOXUS_FLAG(state->node->header, 3);
+
+    const IA_EUDOXUS(class_node_t) *node
+        = (const IA_EUDOXUS(class_node_t) *)(state->node);
+
+    ia_vls_state_t vls;
+    IA_VLS_INIT(vls, node);
+    // Advance past first_output.
+    IA_VLS_ADVANCE_IF(vls, IA_EUDOXUS_ID_T, has_output);
+    IA_EUDOXUS_ID_T default_node = IA_VLS_IF(
+        vls,
+        IA_EUDOXUS_ID_T,
+        0,
+        has_default
+    );
+    const uint8_t *advance = IA_VLS_VARRAY_IF(
+        vls,
+        const uint8_t,
+        (byte_classes->num_classes + 7) / 8,
+        has_nonadvancing
+    );
+    const IA_EUDOXUS_ID_T *targets = IA_VLS_FINAL(vls, const IA_EUDOXUS_ID_T);
+
+    IA_EUDOXUS_ID_T next_node            = targets[byte_class];
+    bool            advance_on_next_node = true;
+
+    if (next_node != 0) {
+        if (has_nonadvancing) {
+            advance_on_next_node = ia_bitv(advance, byte_class);
+        }
+    }
+    else if (has_default) {
+        next_node            = default_node;
+        advance_on_next_node = advance_on_default;
+    }
+    else {
+        return IA_EUDOXUS_END;
+    }
+
+    if (advance_on_next_node) {
+        state->input_location  += 1;
+        state->remaining_bytes -= 1;
+    }
+
+    state->node = (const ia_eudoxus_node_t *)(
+        (const char *)(state->eudoxus->automata) + next_node
+    );
+    state->byte_index = 0;
+
+    return IA_EUDOXUS_OK;
+}
+
 /* Path Compression Node */
 
 /**
@@ -385,6 +473,9 @@ ia_eudoxus_result_t IA_EUDOXUS(next)(
     case IA_EUDOXUS_PC:
         result = IA_EUDOXUS(next_pc)(state);
         break;
+    case IA_EUDOXUS_CLASS:
+        result = IA_EUDOXUS(next_class)(state);
+        break;
     default:
         ia_eudoxus_set_error_printf(
             state->eudoxus,
@@ -471,6 +562,9 @@ ia_eudoxus_result_t IA_EUDOXUS(output)(
         case IA_EUDOXUS_PC:
             IA_VLS_INIT(vls, (IA_EUDOXUS(pc_node_t) *)(state->node));
             break;
+        case IA_EUDOXUS_CLASS:
+            IA_VLS_INIT(vls, (IA_EUDOXUS(class_node_t) *)(state->node));
+            break;
         default: return IA_EUDOXUS_EINSANE;
     }
     IA_EUDOXUS_ID_T output_list = IA_VLS_IF(
@@ -523,25 +617,21 @@ ia_eudoxus_result_t IA_EUDOXUS(output)(
 }
 
 /**
- * Execute function.  Process a block of input.
+ * Begin function.  Prepare @a state to process a block of input.
  *
- * This is the subengine specific version of ia_eudoxus_execute() and has the
- * same semantics.  It loops through the input, calling the appropriate
- * next and output functions.  If either ever returns a code other than
- * IA_EUDOXUS_OK, it will stop execution and return that code.
+ * Handles the NULL @a input special case of ia_eudoxus_execute() and
+ * otherwise sets the input of @a state.
  *
  * @param[in, out] state        State of automata.
  * @param[in]      input        Input to execute on.
  * @param[in]      input_length Length of input.
- * @param[in]      with_output  If true, generate output on transitions.
  * @return See ia_eudoxus_execute() for return codes meanings.
  */
 static
-ia_eudoxus_result_t IA_EUDOXUS(execute)(
+ia_eudoxus_result_t IA_EUDOXUS(begin)(
     ia_eudoxus_state_t *state,
     const uint8_t      *input,
-    size_t              input_length,
-    bool                with_output
+    size_t              input_length
 )
 {
     if (state == NULL) {
@@ -569,30 +659,101 @@ ia_eudoxus_result_t IA_EUDOXUS(execute)(
 
     if (state->input_location == NULL) {
         /* Probably state was just created. */
-        return IA_EUDOXUS_OK;
+        state->remaining_bytes = 0;
     }
 
-    while (state->remaining_bytes > 0) {
-        ia_eudoxus_result_t result = IA_EUDOXUS_OK;
+    return IA_EUDOXUS_OK;
+}
 
-        /* Update state, including state->remaining_bytes */
-        const uint8_t* old_input_location = state->input_location;
-        result = IA_EUDOXUS(next)(state);
-        if (result != IA_EUDOXUS_OK) {
-            return result;
+/**
+ * Step function.  Advance state by one transition and process its output.
+ *
+ * Must only be called if @c state->remaining_bytes is positive.
+ *
+ * @param[in, out] state       State of automata.
+ * @param[in]      with_output If true, generate output on transitions.
+ * @return See ia_eudoxus_execute() for return codes meanings.
+ */
+static
+ia_eudoxus_result_t IA_EUDOXUS(step)(
+    ia_eudoxus_state_t *state,
+    bool                with_output
+)
+{
+    assert(state                  != NULL);
+    assert(state->remaining_bytes >  0);
+
+    ia_eudoxus_result_t result = IA_EUDOXUS_OK;
+
+    /* Skip input the start node would consume without leaving. */
+    if (
+        state->node == state->eudoxus->start_node &&
+        state->eudoxus->start_skip
+    ) {
+        size_t skip = ia_eudoxus_skip_start(
+            state->eudoxus,
+            state->input_location,
+            state->remaining_bytes
+        );
+        state->input_location  += skip;
+        state->remaining_bytes -= skip;
+        if (state->remaining_bytes == 0) {
+            return IA_EUDOXUS_OK;
         }
+    }
 
-        /* Call callback. */
-        if (
-            with_output &&
-            state->callback != NULL &&
-            ( ! state->eudoxus->automata->no_advance_no_output ||
-              state->input_location != old_input_location )
-        ) {
-            result = IA_EUDOXUS(output)(state);
-            if (result != IA_EUDOXUS_OK) {
-                return result;
-            }
+    /* Update state, including state->remaining_bytes */
+    const uint8_t* old_input_location = state->input_location;
+    result = IA_EUDOXUS(next)(state);
+    if (result != IA_EUDOXUS_OK) {
+        return result;
+    }
+
+    /* Call callback. */
+    if (
+        with_output &&
+        state->callback != NULL &&
+        ( ! state->eudoxus->automata->no_advance_no_output ||
+          state->input_location != old_input_location )
+    ) {
+        result = IA_EUDOXUS(output)(state);
+    }
+
+    return result;
+}
+
+/**
+ * Execute function.  Process a block of input.
+ *
+ * This is the subengine specific version of ia_eudoxus_execute() and has the
+ * same semantics.  It loops through the input, calling the appropriate
+ * next and output functions.  If either ever returns a code other than
+ * IA_EUDOXUS_OK, it will stop execution and return that code.
+ *
+ * @param[in, out] state        State of automata.
+ * @param[in]      input        Input to execute on.
+ * @param[in]      input_length Length of input.
+ * @param[in]      with_output  If true, generate output on transitions.
+ * @return See ia_eudoxus_execute() for return codes meanings.
+ */
+static
+ia_eudoxus_result_t IA_EUDOXUS(execute)(
+    ia_eudoxus_state_t *state,
+    const uint8_t      *input,
+    size_t              input_length,
+    bool                with_output
+)
+{
+    ia_eudoxus_result_t result =
+        IA_EUDOXUS(begin)(state, input, input_length);
+    if (result != IA_EUDOXUS_OK) {
+        return result;
+    }
+
+    while (state->remaining_bytes > 0) {
+        result = IA_EUDOXUS(step)(state, with_output);
+        if (result != IA_EUDOXUS_OK) {
+            return result;
         }
     }
 
@@ -119,10 +119,23 @@ ia_eudoxus_result_t ia_eudoxus_create(
 /**
  * As above, but load from FILE.
  *
+ * If @a fp is a regular file without write permission, the automata is
+ * memory mapped read-only and shared rather than copied into memory.  Pages
+ * are then loaded on demand and shared between all processes that load the
+ * same file.  The mapping remains valid after @a fp is closed and is
+ * released by ia_eudoxus_destroy().  Other files, and files that can not be
+ * mapped, are read into memory instead.
+ *
+ * A mapped file must not be modified while an engine uses it: changes show
+ * through the mapping and truncation makes the engine raise SIGBUS.  Replace
+ * it by writing a new file and renaming it over the old one; engines keep
+ * the old file until they are destroyed.
+ *
  * @param[out] out_eudoxus Variable to hold pointer to created engine.
  * @param[in]  fp          @c FILE* to load from.
  * @return
- * - IA_EUDOXUS_EINVAL if @a out_eudoxus or @a fp is NULL or @a fp is not seekable.
+ * - IA_EUDOXUS_EINVAL if @a out_eudoxus or @a fp is NULL, @a fp is not
+ *   seekable, or the file is shorter than the automata it holds.
  * - IA_EUDOXUS_EINSANE on unexpected behavior of standard functions.
  * - Other codes as described in ia_eudoxus_create().
  *
@@ -299,6 +312,20 @@ ia_eudoxus_result_t ia_eudoxus_create_state(
     void                    *callback_data
 );
 
+/**
+ * Reset @a state to the start state of its automata.
+ *
+ * This is equivalent to destroying @a state and creating a new one with
+ * the same engine, callback and callback data, but does not allocate.
+ * The callback is called with any outputs of the start state.
+ *
+ * @param[in, out] state State to reset.
+ * @return As ia_eudoxus_create_state().
+ */
+ia_eudoxus_result_t ia_eudoxus_reset_state(
+    ia_eudoxus_state_t *state
+);
+
 /**
  * Destroy @a state and release associated memory.
  *
@@ -379,6 +406,49 @@ ia_eudoxus_result_t ia_eudoxus_execute_without_output(
     size_t              input_length
 );
 
+/**
+ * Maximum number of states ia_eudoxus_execute_interleaved() steps together.
+ *
+ * Larger batches are processed in groups of this many states.
+ */
+#define IA_EUDOXUS_INTERLEAVE_MAX 8
+
+/**
+ * Execute several states, each on its own input, interleaved.
+ *
+ * Equivalent to calling ia_eudoxus_execute() with @a states[i],
+ * @a inputs[i] and @a input_lengths[i] for each @c i and storing the result
+ * in @a results[i], except that the states are advanced one transition at a
+ * time in turn.  One state's automata lookups then overlap with the others'
+ * rather than stalling one stream at a time, which improves throughput when
+ * many independent inputs (e.g., several fields) are searched with large
+ * automata.
+ *
+ * Callbacks of different states are called interleaved; callbacks of a
+ * single state are called in order.  A state that stops, ends or fails does
+ * not affect the others.  The states may belong to different engines but
+ * must be distinct.
+ *
+ * @param[in,out] states        States of automata.
+ * @param[in]     inputs        Input for each state.  As for
+ *                              ia_eudoxus_execute(), a NULL input reruns
+ *                              the outputs of the current node.
+ * @param[in]     input_lengths Length of each input.
+ * @param[out]    results       Result of each state; see
+ *                              ia_eudoxus_execute().
+ * @param[in]     num_states    Number of elements in each array.
+ * @return
+ * - IA_EUDOXUS_OK if all states were executed; see @a results.
+ * - IA_EUDOXUS_EINVAL if any of the arrays is NULL.
+ */
+ia_eudoxus_result_t ia_eudoxus_execute_interleaved(
+    ia_eudoxus_state_t  **states,
+    const uint8_t       **inputs,
+    const size_t         *input_lengths,
+    ia_eudoxus_result_t  *results,
+    size_t                num_states
+);
+
 /**
  * Set error for @a eudoxus to @a message (claim ownership version).
  *
@@ -54,7 +54,7 @@ extern "C" {
  * This is checked by @c ia_eudoxus_create_ methods to insure that an automata
  * was generated for the current engine.
  */
-#define IA_EUDOXUS_VERSION 10
+#define IA_EUDOXUS_VERSION 11
 
 /**
  * A Eudoxus Automata.
@@ -156,6 +156,15 @@ struct ia_eudoxus_automata_t
 
     /** @} */
 
+    /**
+     * Index of byte class table or 0 if there is none.
+     *
+     * Required if the automata has any byte class nodes.
+     *
+     * @sa ia_eudoxus_byte_classes_t
+     */
+    uint64_t byte_class_index;
+
     /**
      * Remaining bytes of automata.
      *
@@ -199,12 +208,14 @@ enum ia_eudoxus_nodetype_t
     IA_EUDOXUS_PC = 2,
 
     /**
-     * Extended Node
+     * Byte Class Node
      *
-     * Current unsupported but may, in the future, indicate that additional
-     * data needs to be read to determine node type.
+     * A byte class node stores a target for every byte class of the
+     * automata and maps inputs to byte classes via the byte class table.
+     *
+     * @sa ia_eudoxus_byte_classes_t
      */
-    IA_EUDOXUS_EXTENDED = 3
+    IA_EUDOXUS_CLASS = 3
 };
 typedef enum ia_eudoxus_nodetype_t ia_eudoxus_nodetype_t;
 
@@ -252,6 +263,27 @@ struct ia_bitmap256_t
     uint64_t bits[4];
 } __attribute((packed));
 
+/**
+ * Byte class table.
+ *
+ * Inputs that lead to the same target with the same advance behavior at
+ * every node of the automata are in the same byte class.  Byte class nodes
+ * store one target per class rather than per input.
+ */
+typedef struct ia_eudoxus_byte_classes_t ia_eudoxus_byte_classes_t;
+struct ia_eudoxus_byte_classes_t
+{
+    /**
+     * Number of byte classes; at most 256.
+     */
+    uint16_t num_classes;
+
+    /**
+     * Byte class of each input.
+     */
+    uint8_t classes[256];
+} __attribute((packed));
+
 /**
  * Output
  */
@@ -52,6 +52,7 @@ struct configuration_t
      * - id_width = 0, i.e., minimal.
      * - align_to = 1, i.e., no alignment
      * - high_node_weight = 1.0, i.e., optimize space
+     * - byte_classes = true
      */
     configuration_t();
 
@@ -105,8 +106,20 @@ struct configuration_t
      * benefits and small space costs.  Eventually, smaller values will begin
      * penalizing performance as low degree nodes are both smaller and faster
      * for very low degree.
+     *
+     * This weight also applies to byte class nodes.
      */
     double high_node_weight;
+
+    /**
+     * Use byte class nodes.
+     *
+     * If true, inputs that behave identically at every node are grouped
+     * into byte classes and nodes may be compiled into byte class nodes,
+     * which store one target per class.  Byte class nodes are used in
+     * place of high nodes when they are no larger.
+     */
+    bool byte_classes;
 };
 
 /**
@@ -143,6 +156,12 @@ struct result_t
 
     //! Bytes of PC nodes.
     size_t pc_nodes_bytes;
+
+    //! Number of byte class nodes.
+    size_t class_nodes;
+
+    //! Bytes of byte class nodes.
+    size_t class_nodes_bytes;
 };
 
 /**
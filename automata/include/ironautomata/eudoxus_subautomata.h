@@ -187,6 +187,38 @@ struct IA_EUDOXUS(high_node_t)
      */
 } __attribute((packed));
 
+/**
+ * Eudoxus Byte Class Node
+ *
+ * Byte class nodes have one entry in their targets table for each byte class
+ * of the automata (see ia_eudoxus_byte_classes_t).  The target index of
+ * input @c c is its class; a target of 0 indicates that @c c has no
+ * non-default target.  Lookup is a table access with no population count
+ * and, when inputs fall into few classes, the node is smaller than a high
+ * degree node.
+ *
+ * The advance bitmap, if present, is indexed by class.
+ */
+typedef struct IA_EUDOXUS(class_node_t) IA_EUDOXUS(class_node_t);
+struct IA_EUDOXUS(class_node_t)
+{
+    /*
+     * type: 11
+     * flag0: has_output
+     * flag1: has_nonadvancing -- edges only; not including default
+     * flag2: has_default
+     * flag3: advance_on_default
+     */
+    uint8_t header;
+
+     /* variable:
+     IA_EUDOXUS_ID_T first_output               if has_output
+     IA_EUDOXUS_ID_T default_node               if has_default
+     uint8_t         advance[(num_classes+7)/8] if has_nonadvancing
+     IA_EUDOXUS_ID_T targets[num_classes]
+     */
+} __attribute((packed));
+
 /**
  * Eudoxus Path Compression (PC) Node
  *
@@ -244,6 +276,7 @@ struct subengine_traits<sizeof(IA_EUDOXUS_ID_T)>
     typedef IA_EUDOXUS(low_node_t)    low_node_t;
     typedef IA_EUDOXUS(high_node_t)   high_node_t;
     typedef IA_EUDOXUS(pc_node_t)     pc_node_t;
+    typedef IA_EUDOXUS(class_node_t)  class_node_t;
 };
 
 } // Eudoxus
@@ -670,8 +670,9 @@ bool read_automata(
  *
  * @param[in] automata   Automata to write.
  * @param[in] output     Stream to write to.
- * @param[in] chunk_size If non-0, no chunk will contain more than
- *                       @a chunk_size nodes and outputs.
+ * @param[in] chunk_size No chunk will contain more than @a chunk_size
+ *                       nodes and outputs.  If 0, a default of 1024 is
+ *                       used.
  * @throw runtime_error on write error.
  * @throw invalid_argument if @a automata is invalid.
  */
@@ -0,0 +1,80 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef _IA_MINIMIZE_HPP_
+#define _IA_MINIMIZE_HPP_
+
+/**
+ * @file
+ * @brief IronAutomata --- Determinize and Minimize
+ */
+
+#include <ironautomata/intermediate.hpp>
+
+namespace IronAutomata {
+namespace Intermediate {
+
+/**
+ * Convert a non-deterministic automata into a deterministic one.
+ *
+ * An automata is non-deterministic if some node has more than one target for
+ * some input.  Such automata are replaced by the equivalent deterministic
+ * automata via subset construction: each new node corresponds to a set of
+ * old nodes, has the outputs of all of them, and transitions to the set of
+ * all their targets.
+ *
+ * Deterministic automata are left untouched, whatever their edges.
+ * Non-deterministic automata must have only advancing edges as there is no
+ * deterministic equivalent of following several targets that disagree
+ * about advancing.
+ *
+ * The outputs of merged nodes are copied into new output lists, so
+ * deduplicate_outputs() is worth running afterwards.
+ *
+ * @param[in] automata Automata to process.
+ * @return Number of nodes in the new automata; 0 if @a automata was already
+ *         deterministic.
+ * @throw std::invalid_argument if @a automata is non-deterministic and has
+ *        a non-advancing edge.
+ */
+size_t determinize(Automata& automata);
+
+/**
+ * Merge equivalent nodes of a deterministic automata.
+ *
+ * Two nodes are equivalent if they have the same output contents and, for
+ * every input, both advance or both do not advance to equivalent nodes (or
+ * both have no target).  Equivalent nodes are found by partition refinement
+ * and every reference to a node is redirected to the first node of its
+ * class in breadth first order.
+ *
+ * The result is the smallest automata with the same behavior for the
+ * edge structure given: non-advancing edges are compared as-is, so running
+ * translate_nonadvancing() first can expose more merges.  Merging can leave
+ * a node with several edges to the same target; run optimize_edges()
+ * afterwards.
+ *
+ * @param[in] automata Automata to process.
+ * @return Number of nodes removed.
+ * @throw std::invalid_argument if @a automata is non-deterministic.
+ */
+size_t minimize(Automata& automata);
+
+} // Intermediate
+} // IronAutomata
+
+#endif
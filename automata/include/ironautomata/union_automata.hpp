@@ -0,0 +1,65 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef _IA_UNION_AUTOMATA_HPP_
+#define _IA_UNION_AUTOMATA_HPP_
+
+/**
+ * @file
+ * @brief IronAutomata --- Union of Automata
+ */
+
+#include <ironautomata/intermediate.hpp>
+
+namespace IronAutomata {
+namespace Intermediate {
+
+/**
+ * Combine @a other into @a automata.
+ *
+ * The result runs both automata at once: at every input location, it
+ * produces the outputs of @a automata followed by those of @a other, and it
+ * continues for as long as either would.  This allows, e.g., adding
+ * patterns to a large Aho-Corasick automata by generating an automata of
+ * just the new patterns and taking the union, rather than generating the
+ * whole automata again.
+ *
+ * The union is built by product construction: each node of the result
+ * corresponds to a pair of nodes, one of each automata (or none, once an
+ * automata has no target).  Both automata must be deterministic.
+ * Where both automata do not advance, neither does the result; where only
+ * one does not, its non-advancing edges are followed until an advancing
+ * edge.  That is only equivalent when non-advancing edges produce no
+ * output, so automata with non-advancing edges must be no-advance-no-output
+ * (as Aho-Corasick automata are), as is the result if it has any.
+ *
+ * Metadata of @a other is added to that of @a automata.
+ *
+ * @param[in] automata Automata to add to.
+ * @param[in] other    Automata to add.
+ * @return Number of nodes in the union.
+ * @throw std::invalid_argument if either automata is empty or
+ *        non-deterministic, has non-advancing edges but is not
+ *        no-advance-no-output, or has a cycle of non-advancing edges, or if
+ *        the two automata have different values for a metadata key.
+ */
+size_t union_automata(Automata& automata, const Automata& other);
+
+} // Intermediate
+} // IronAutomata
+
+#endif
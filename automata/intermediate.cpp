@@ -502,13 +502,23 @@ void write_chunk(ostream& output, PB::Chunk& chunk)
 
 namespace  {
 
+/**
+ * Chunk size used when write_automata() is given 0.
+ *
+ * Every chunk is separately compressed, so small chunks cost a compressor
+ * per node while a single chunk holds the entire automata in memory.
+ */
+const size_t c_default_chunk_size = 1024;
+
 class AutomataWriter
 {
 public:
     explicit
     AutomataWriter(ostream& output, size_t chunk_size = 0) :
         m_output(output),
-        m_pb_chunk_size(chunk_size),
+        m_pb_chunk_size(
+            chunk_size == 0 ? c_default_chunk_size : chunk_size
+        ),
         m_next_id(1)
     {
         // nop
@@ -0,0 +1,451 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronAutomata --- Determinize and Minimize Implementation
+ */
+
+#include <ironautomata/minimize.hpp>
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#if __has_warning("-Wunused-local-typedef")
+#pragma clang diagnostic ignored "-Wunused-local-typedef"
+#endif
+#endif
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/make_shared.hpp>
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+using namespace std;
+
+namespace IronAutomata {
+namespace Intermediate {
+
+namespace {
+
+//! Nodes in breadth first order.
+typedef vector<node_p> nodes_t;
+
+//! Map of node to its index in nodes_t.
+typedef map<node_p, size_t> node_index_t;
+
+//! Marker for no target.
+const size_t c_no_target = size_t(-1);
+
+/**
+ * Append @a node to @a nodes and record its index.
+ *
+ * @param[in] nodes Nodes to append to.
+ * @param[in] index Index to update.
+ * @param[in] node  Node to append.
+ */
+void index_node(nodes_t& nodes, node_index_t& index, const node_p& node)
+{
+    index[node] = nodes.size();
+    nodes.push_back(node);
+}
+
+/**
+ * Index all nodes of @a automata in breadth first order.
+ *
+ * The start node is always index 0.
+ *
+ * @param[in] nodes    Nodes to fill.
+ * @param[in] index    Index to fill.
+ * @param[in] automata Automata to index.
+ */
+void index_nodes(
+    nodes_t&        nodes,
+    node_index_t&   index,
+    const Automata& automata
+)
+{
+    breadth_first(
+        automata,
+        boost::bind(index_node, boost::ref(nodes), boost::ref(index), _1)
+    );
+}
+
+/**
+ * @name Determinize
+ * Helpers for determinize().
+ */
+///@{
+
+//! Set of old nodes, as sorted indices.
+typedef vector<size_t> subset_t;
+
+//! Map of subset to new node.
+typedef map<subset_t, node_p> subsets_t;
+
+//! Subsets that need their new node filled in.
+typedef list<subsets_t::value_type> subset_todo_t;
+
+/**
+ * Find or create the new node for @a subset.
+ *
+ * @param[in] subsets Subsets so far.
+ * @param[in] todo    Subsets to process; appended to if @a subset is new.
+ * @param[in] subset  Subset to find node for.
+ * @return New node for @a subset.
+ */
+node_p subset_node(
+    subsets_t&      subsets,
+    subset_todo_t&  todo,
+    const subset_t& subset
+)
+{
+    subsets_t::iterator i = subsets.find(subset);
+    if (i == subsets.end()) {
+        i = subsets.insert(make_pair(subset, boost::make_shared<Node>())).first;
+        todo.push_back(*i);
+    }
+    return i->second;
+}
+
+/**
+ * Construct the outputs of a subset.
+ *
+ * A subset of a single node shares that node's outputs.  Larger subsets
+ * receive a new output list of every distinct content of their nodes.
+ *
+ * @param[in] nodes  Old nodes.
+ * @param[in] subset Subset to construct outputs for.
+ * @return First output of @a subset.
+ */
+output_p subset_outputs(const nodes_t& nodes, const subset_t& subset)
+{
+    if (subset.size() == 1) {
+        return nodes[subset.front()]->first_output();
+    }
+
+    list<const byte_vector_t*> contents;
+    set<byte_vector_t> seen;
+    BOOST_FOREACH(size_t i, subset) {
+        output_p output = nodes[i]->first_output();
+        while (output) {
+            if (seen.insert(output->content()).second) {
+                contents.push_back(&output->content());
+            }
+            output = output->next_output();
+        }
+    }
+
+    output_p first_output;
+    for (
+        list<const byte_vector_t*>::const_reverse_iterator i =
+            contents.rbegin();
+        i != contents.rend();
+        ++i
+    ) {
+        first_output = boost::make_shared<Output>(**i, first_output);
+    }
+    return first_output;
+}
+
+///@}
+
+/**
+ * @name Minimize
+ * Helpers for minimize().
+ */
+///@{
+
+//! Target index (or c_no_target) and advance.
+typedef pair<size_t, bool> target_t;
+
+//! Last input of a run of inputs with same target.
+typedef pair<int, target_t> run_t;
+
+//! Targets of a node as runs of inputs.
+typedef vector<run_t> row_t;
+
+/**
+ * Append @a target for inputs up to @a last to @a row.
+ *
+ * Extends the last run if it has the same target so that equal rows are
+ * always represented the same way.
+ *
+ * @param[in] row    Row to append to.
+ * @param[in] last   Last input of the run.
+ * @param[in] target Target of the run.
+ */
+void append_run(row_t& row, int last, const target_t& target)
+{
+    if (! row.empty() && row.back().second == target) {
+        row.back().first = last;
+    }
+    else {
+        row.push_back(make_pair(last, target));
+    }
+}
+
+//! Output contents of a node.
+typedef vector<byte_vector_t> output_contents_t;
+
+/**
+ * Output contents of @a node.
+ *
+ * @param[in] node Node to find output contents of.
+ * @return Contents of every output of @a node, in order.
+ */
+output_contents_t output_contents(const node_p& node)
+{
+    output_contents_t result;
+    output_p output = node->first_output();
+    while (output) {
+        result.push_back(output->content());
+        output = output->next_output();
+    }
+    return result;
+}
+
+///@}
+
+}
+
+size_t determinize(Automata& automata)
+{
+    if (! automata.start_node()) {
+        return 0;
+    }
+
+    nodes_t nodes;
+    node_index_t index;
+    index_nodes(nodes, index, automata);
+
+    vector<Node::targets_by_input_t> targets;
+    targets.reserve(nodes.size());
+    bool deterministic = true;
+    bool advancing = true;
+    BOOST_FOREACH(const node_p& node, nodes) {
+        targets.push_back(node->build_targets_by_input());
+        BOOST_FOREACH(
+            const Node::target_info_list_t& infos,
+            targets.back()
+        ) {
+            if (infos.size() > 1) {
+                deterministic = false;
+            }
+            BOOST_FOREACH(const Node::target_info_t& info, infos) {
+                if (! info.second) {
+                    advancing = false;
+                }
+            }
+        }
+    }
+
+    if (deterministic) {
+        return 0;
+    }
+    if (! advancing) {
+        throw invalid_argument(
+            "Can not determinize automata with non-advancing edges."
+        );
+    }
+
+    subsets_t subsets;
+    subset_todo_t todo;
+    node_p start_node = subset_node(subsets, todo, subset_t(1, 0));
+
+    while (! todo.empty()) {
+        subset_t subset = todo.front().first;
+        node_p node = todo.front().second;
+        todo.pop_front();
+
+        node->first_output() = subset_outputs(nodes, subset);
+
+        typedef map<subset_t, list<uint8_t> > by_target_t;
+        by_target_t by_target;
+        for (int c = 0; c < 256; ++c) {
+            subset_t target;
+            BOOST_FOREACH(size_t i, subset) {
+                BOOST_FOREACH(const Node::target_info_t& info, targets[i][c]) {
+                    target.push_back(index[info.first]);
+                }
+            }
+            sort(target.begin(), target.end());
+            target.erase(unique(target.begin(), target.end()), target.end());
+            by_target[target].push_back(c);
+        }
+
+        // The most common target is the default unless some inputs have
+        // no target, as those would then follow the default.
+        by_target_t::const_iterator default_i = by_target.end();
+        if (by_target.count(subset_t()) == 0) {
+            for (
+                by_target_t::const_iterator i = by_target.begin();
+                i != by_target.end();
+                ++i
+            ) {
+                if (
+                    default_i == by_target.end() ||
+                    i->second.size() > default_i->second.size()
+                ) {
+                    default_i = i;
+                }
+            }
+        }
+
+        for (
+            by_target_t::const_iterator i = by_target.begin();
+            i != by_target.end();
+            ++i
+        ) {
+            if (i->first.empty()) {
+                continue;
+            }
+            node_p target = subset_node(subsets, todo, i->first);
+            if (i == default_i) {
+                node->default_target() = target;
+                node->advance_on_default() = true;
+            }
+            else {
+                Edge edge(target);
+                BOOST_FOREACH(uint8_t c, i->second) {
+                    edge.add(c);
+                }
+                node->edges().push_back(edge);
+            }
+        }
+    }
+
+    automata.start_node() = start_node;
+
+    return subsets.size();
+}
+
+size_t minimize(Automata& automata)
+{
+    if (! automata.start_node()) {
+        return 0;
+    }
+
+    nodes_t nodes;
+    node_index_t index;
+    index_nodes(nodes, index, automata);
+
+    const size_t num_nodes = nodes.size();
+
+    vector<row_t> rows(num_nodes);
+    for (size_t i = 0; i < num_nodes; ++i) {
+        Node::targets_by_input_t by_input = nodes[i]->build_targets_by_input();
+        for (int c = 0; c < 256; ++c) {
+            const Node::target_info_list_t& infos = by_input[c];
+            if (infos.size() > 1) {
+                throw invalid_argument(
+                    "Can not minimize non-deterministic automata."
+                );
+            }
+            target_t target(c_no_target, false);
+            if (! infos.empty()) {
+                target.first = index[infos.front().first];
+                target.second = infos.front().second;
+            }
+            append_run(rows[i], c, target);
+        }
+    }
+
+    // Initial partition: by output contents.
+    vector<size_t> node_class(num_nodes);
+    size_t num_classes;
+    {
+        typedef map<output_contents_t, size_t> ids_t;
+        ids_t ids;
+        for (size_t i = 0; i < num_nodes; ++i) {
+            node_class[i] = ids.insert(
+                make_pair(output_contents(nodes[i]), ids.size())
+            ).first->second;
+        }
+        num_classes = ids.size();
+    }
+
+    // Refine by class and targets' classes until stable.  Refinement only
+    // splits classes, so an unchanged count means an unchanged partition.
+    for (;;) {
+        typedef pair<size_t, row_t> signature_t;
+        typedef map<signature_t, size_t> ids_t;
+        ids_t ids;
+        vector<size_t> next_class(num_nodes);
+
+        for (size_t i = 0; i < num_nodes; ++i) {
+            signature_t signature;
+            signature.first = node_class[i];
+            BOOST_FOREACH(const run_t& run, rows[i]) {
+                target_t target = run.second;
+                if (target.first != c_no_target) {
+                    target.first = node_class[target.first];
+                }
+                append_run(signature.second, run.first, target);
+            }
+            next_class[i] = ids.insert(
+                make_pair(signature, ids.size())
+            ).first->second;
+        }
+
+        bool stable = (ids.size() == num_classes);
+        node_class.swap(next_class);
+        num_classes = ids.size();
+        if (stable) {
+            break;
+        }
+    }
+
+    if (num_classes == num_nodes) {
+        return 0;
+    }
+
+    // Redirect everything to the first node of each class.
+    nodes_t representative(num_classes);
+    for (size_t i = 0; i < num_nodes; ++i) {
+        if (! representative[node_class[i]]) {
+            representative[node_class[i]] = nodes[i];
+        }
+    }
+
+    for (size_t i = 0; i < num_nodes; ++i) {
+        const node_p& node = nodes[i];
+        if (representative[node_class[i]] != node) {
+            continue;
+        }
+        BOOST_FOREACH(Edge& edge, node->edges()) {
+            edge.target() =
+                representative[node_class[index[edge.target()]]];
+        }
+        if (node->default_target()) {
+            node->default_target() =
+                representative[node_class[index[node->default_target()]]];
+        }
+    }
+    automata.start_node() = representative[node_class[0]];
+
+    return num_nodes - num_classes;
+}
+
+} // Intermediate
+} // IronAutomata
@@ -36,8 +36,8 @@
 #pragma clang diagnostic pop
 #endif
 
+#include <bitset>
 #include <map>
-#include <set>
 
 using namespace std;
 
@@ -46,28 +46,39 @@ namespace Intermediate {
 
 void optimize_edges(const node_p& node)
 {
-    typedef set<uint8_t> input_set_t;
+    typedef bitset<256> input_set_t;
     typedef map<Node::target_info_t, input_set_t> inputs_by_target_t;
 
-    Node::targets_by_input_t by_input = node->build_targets_by_input();
+    // Invert edges directly rather than via build_targets_by_input(), which
+    // allocates a list per input and dominates on large automata.
     inputs_by_target_t by_target;
-
-    // Invert map.
-    for (int c = 0; c < 256; ++c) {
-        BOOST_FOREACH(const Node::target_info_t& info, by_input[c]) {
-            by_target[info].insert(c);
+    input_set_t covered;
+    BOOST_FOREACH(const Edge& edge, node->edges()) {
+        input_set_t& inputs =
+            by_target[Node::target_info_t(edge.target(), edge.advance())];
+        if (edge.epsilon()) {
+            inputs.set();
+        }
+        else {
+            BOOST_FOREACH(uint8_t c, edge) {
+                inputs.set(c);
+            }
         }
+        covered |= inputs;
+    }
+    if (node->default_target() && covered.count() != 256) {
+        by_target[
+            Node::target_info_t(
+                node->default_target(),
+                node->advance_on_default()
+            )
+        ] |= ~covered;
+        covered.set();
     }
 
     // Check for use default.  That is, every input has a target but no
     // target has every input.
-    bool is_complete = true;
-    for (int c = 0; c < 256; ++c) {
-        if (by_input[c].empty()) {
-            is_complete = false;
-            break;
-        }
-    }
+    bool is_complete = (covered.count() == 256);
 
     // Find biggest, this will also tell us if there is any epsilon.
     inputs_by_target_t::iterator biggest;
@@ -77,7 +88,7 @@ void optimize_edges(const node_p& node)
         i != by_target.end();
         ++i
     ) {
-        size_t s = i->second.size();
+        size_t s = i->second.count();
         if (s > biggest_size) {
             biggest_size = s;
             biggest = i;
@@ -102,9 +113,11 @@ void optimize_edges(const node_p& node)
         node->edges().push_back(Edge(v.first.first, v.first.second));
         Edge& edge = node->edges().back();
 
-        if (v.second.size() != 256) {
-            BOOST_FOREACH(uint8_t c, v.second) {
-                edge.add(c);
+        if (v.second.count() != 256) {
+            for (int c = 0; c < 256; ++c) {
+                if (v.second.test(c)) {
+                    edge.add(c);
+                }
             }
         }
         // Else Epsilon.
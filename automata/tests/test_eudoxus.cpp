@@ -0,0 +1,541 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronAutomata --- Eudoxus loading and execution test.
+ **/
+
+#include <ironautomata/deduplicate_outputs.hpp>
+#include <ironautomata/eudoxus.h>
+#include <ironautomata/eudoxus_compiler.hpp>
+#include <ironautomata/generator/aho_corasick.hpp>
+#include <ironautomata/intermediate.hpp>
+#include <ironautomata/optimize_edges.hpp>
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace IronAutomata;
+
+namespace {
+
+//! Compile an Aho-Corasick automata for @a words.
+EudoxusCompiler::result_t compile_words_result(
+    const vector<string>&                   words,
+    const EudoxusCompiler::configuration_t& configuration
+)
+{
+    Intermediate::Automata automata;
+
+    Generator::aho_corasick_begin(automata);
+    for (
+        vector<string>::const_iterator i = words.begin();
+        i != words.end();
+        ++i
+    ) {
+        Intermediate::byte_vector_t data(i->begin(), i->end());
+        Generator::aho_corasick_add_data(automata, *i, data);
+    }
+    Generator::aho_corasick_finish(automata);
+    Intermediate::breadth_first(automata, Intermediate::optimize_edges);
+    Intermediate::deduplicate_outputs(automata);
+
+    return EudoxusCompiler::compile(automata, configuration);
+}
+
+//! Compile an Aho-Corasick automata for @a words.
+vector<char> compile_words(
+    const vector<string>&                   words,
+    const EudoxusCompiler::configuration_t& configuration =
+        EudoxusCompiler::configuration_t()
+)
+{
+    EudoxusCompiler::result_t result =
+        compile_words_result(words, configuration);
+
+    return vector<char>(result.buffer.begin(), result.buffer.end());
+}
+
+//! Create an engine from a copy of @a data.
+ia_eudoxus_t* create_engine(const vector<char>& data)
+{
+    ia_eudoxus_t* eudoxus = NULL;
+    char* copy = reinterpret_cast<char*>(malloc(data.size()));
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy, &data[0], data.size());
+    if (ia_eudoxus_create(&eudoxus, copy) != IA_EUDOXUS_OK) {
+        free(copy);
+        return NULL;
+    }
+    return eudoxus;
+}
+
+//! Temporary file holding @a length bytes of @a data; removed on destruction.
+class TempFile
+{
+public:
+    TempFile(const char* data, size_t length)
+    {
+        char path[] = "test_eudoxus_XXXXXX";
+        int fd = mkstemp(path);
+        if (fd >= 0) {
+            m_path = path;
+            if (length > 0) {
+                EXPECT_EQ(ssize_t(length), write(fd, data, length));
+            }
+            close(fd);
+        }
+    }
+
+    ~TempFile()
+    {
+        if (! m_path.empty()) {
+            unlink(m_path.c_str());
+        }
+    }
+
+    const char* path() const
+    {
+        return m_path.c_str();
+    }
+
+    //! Remove write permission, so that the file is mapped.
+    void make_read_only()
+    {
+        EXPECT_EQ(0, chmod(m_path.c_str(), 0444));
+    }
+
+private:
+    string m_path;
+};
+
+extern "C" {
+
+ia_eudoxus_command_t collect_output(
+    ia_eudoxus_t*  engine,
+    const char*    output,
+    size_t         output_length,
+    const uint8_t* input_location,
+    void*          callback_data
+)
+{
+    vector<string>* outputs =
+        reinterpret_cast<vector<string>*>(callback_data);
+    outputs->push_back(string(output, output_length));
+
+    return IA_EUDOXUS_CMD_CONTINUE;
+}
+
+}
+
+//! Run @a eudoxus on @a input and return outputs.
+vector<string> run(ia_eudoxus_t* eudoxus, const string& input)
+{
+    vector<string> outputs;
+    ia_eudoxus_state_t* state = NULL;
+
+    EXPECT_EQ(
+        IA_EUDOXUS_OK,
+        ia_eudoxus_create_state(&state, eudoxus, collect_output, &outputs)
+    );
+    if (state != NULL) {
+        ia_eudoxus_result_t rc = ia_eudoxus_execute(
+            state,
+            reinterpret_cast<const uint8_t*>(input.data()),
+            input.length()
+        );
+        EXPECT_TRUE(rc == IA_EUDOXUS_OK || rc == IA_EUDOXUS_END);
+        ia_eudoxus_destroy_state(state);
+    }
+
+    return outputs;
+}
+
+//! Number of occurrences of each of @a words in @a input.
+size_t count_occurrences(const vector<string>& words, const string& input)
+{
+    size_t count = 0;
+    for (
+        vector<string>::const_iterator i = words.begin();
+        i != words.end();
+        ++i
+    ) {
+        for (
+            size_t at = input.find(*i);
+            at != string::npos;
+            at = input.find(*i, at + 1)
+        ) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+vector<string> example_words()
+{
+    vector<string> words;
+    words.push_back("he");
+    words.push_back("she");
+    words.push_back("his");
+    words.push_back("hers");
+    return words;
+}
+
+} // Anonymous
+
+TEST(TestEudoxus, FromPath)
+{
+    vector<char> data = compile_words(example_words());
+    ASSERT_FALSE(data.empty());
+    TempFile file(&data[0], data.size());
+
+    ia_eudoxus_t* eudoxus = NULL;
+    ASSERT_EQ(
+        IA_EUDOXUS_OK,
+        ia_eudoxus_create_from_path(&eudoxus, file.path())
+    );
+    ASSERT_TRUE(eudoxus);
+
+    vector<string> outputs = run(eudoxus, "ushers");
+    EXPECT_EQ(3UL, outputs.size());
+    EXPECT_NE(outputs.end(), find(outputs.begin(), outputs.end(), "she"));
+    EXPECT_NE(outputs.end(), find(outputs.begin(), outputs.end(), "he"));
+    EXPECT_NE(outputs.end(), find(outputs.begin(), outputs.end(), "hers"));
+
+    EXPECT_TRUE(run(eudoxus, "nothing").empty());
+
+    ia_eudoxus_destroy(eudoxus);
+}
+
+TEST(TestEudoxus, FromPathMatchesFromMemory)
+{
+    vector<char> data = compile_words(example_words());
+    ASSERT_FALSE(data.empty());
+    TempFile file(&data[0], data.size());
+
+    char* copy = reinterpret_cast<char*>(malloc(data.size()));
+    ASSERT_TRUE(copy);
+    memcpy(copy, &data[0], data.size());
+
+    ia_eudoxus_t* from_memory = NULL;
+    ia_eudoxus_t* from_path = NULL;
+    ASSERT_EQ(IA_EUDOXUS_OK, ia_eudoxus_create(&from_memory, copy));
+    ASSERT_EQ(
+        IA_EUDOXUS_OK,
+        ia_eudoxus_create_from_path(&from_path, file.path())
+    );
+
+    const char* inputs[] = { "ushers", "this is his", "hehehe", "x", "" };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); ++i) {
+        EXPECT_EQ(run(from_memory, inputs[i]), run(from_path, inputs[i]))
+            << "Input: " << inputs[i];
+    }
+
+    ia_eudoxus_destroy(from_memory);
+    ia_eudoxus_destroy(from_path);
+}
+
+TEST(TestEudoxus, FromPathWritableIsCopied)
+{
+    vector<char> data = compile_words(example_words());
+    ASSERT_FALSE(data.empty());
+    TempFile file(&data[0], data.size());
+
+    ia_eudoxus_t* eudoxus = NULL;
+    ASSERT_EQ(
+        IA_EUDOXUS_OK,
+        ia_eudoxus_create_from_path(&eudoxus, file.path())
+    );
+
+    // Rewriting a writable file in place does not affect the engine; were
+    // it mapped, running would raise SIGBUS.
+    ASSERT_EQ(0, truncate(file.path(), 0));
+    EXPECT_EQ(3UL, run(eudoxus, "ushers").size());
+
+    ia_eudoxus_destroy(eudoxus);
+}
+
+TEST(TestEudoxus, FromPathReadOnlyReplacedByRename)
+{
+    vector<char> data = compile_words(example_words());
+    ASSERT_FALSE(data.empty());
+    TempFile file(&data[0], data.size());
+    file.make_read_only();
+
+    ia_eudoxus_t* eudoxus = NULL;
+    ASSERT_EQ(
+        IA_EUDOXUS_OK,
+        ia_eudoxus_create_from_path(&eudoxus, file.path())
+    );
+    EXPECT_EQ(3UL, run(eudoxus, "ushers").size());
+
+    // Replace the file the documented way: write a new one and rename it.
+    vector<string> words;
+    words.push_back("us");
+    vector<char> new_data = compile_words(words);
+    ASSERT_FALSE(new_data.empty());
+    TempFile new_file(&new_data[0], new_data.size());
+    new_file.make_read_only();
+    ASSERT_EQ(0, rename(new_file.path(), file.path()));
+
+    // The engine keeps the old automata; loading again gets the new one.
+    EXPECT_EQ(3UL, run(eudoxus, "ushers").size());
+
+    ia_eudoxus_t* replaced = NULL;
+    ASSERT_EQ(
+        IA_EUDOXUS_OK,
+        ia_eudoxus_create_from_path(&replaced, file.path())
+    );
+    vector<string> outputs = run(replaced, "ushers");
+    ASSERT_EQ(1UL, outputs.size());
+    EXPECT_EQ("us", outputs[0]);
+
+    ia_eudoxus_destroy(replaced);
+    ia_eudoxus_destroy(eudoxus);
+}
+
+TEST(TestEudoxus, FromPathInvalid)
+{
+    ia_eudoxus_t* eudoxus = NULL;
+
+    EXPECT_EQ(
+        IA_EUDOXUS_EINVAL,
+        ia_eudoxus_create_from_path(&eudoxus, "does_not_exist.e")
+    );
+
+    {
+        TempFile empty(NULL, 0);
+        EXPECT_EQ(
+            IA_EUDOXUS_EINVAL,
+            ia_eudoxus_create_from_path(&eudoxus, empty.path())
+        );
+    }
+
+    vector<char> data = compile_words(example_words());
+    ASSERT_FALSE(data.empty());
+    {
+        /* Header is intact but the body is missing. */
+        TempFile truncated(&data[0], data.size() - 1);
+        EXPECT_EQ(
+            IA_EUDOXUS_EINVAL,
+            ia_eudoxus_create_from_path(&eudoxus, truncated.path())
+        );
+    }
+}
+
+TEST(TestEudoxus, StartSkip)
+{
+    static const char* c_sets[][6] = {
+        /* One byte leaves the start node. */
+        { "q", NULL },
+        /* Few enough for the vector loop. */
+        { "he", "she", "his", "hers", NULL },
+        /* Table loop. */
+        { "ab", "cd", "ef", "gh", "ij", NULL }
+    };
+
+    srand(1);
+    string input;
+    for (size_t i = 0; i < 1000; ++i) {
+        input += "abcdefghijqs xyz"[rand() % 16];
+    }
+
+    for (size_t set = 0; set < sizeof(c_sets) / sizeof(*c_sets); ++set) {
+        vector<string> words;
+        for (size_t i = 0; c_sets[set][i] != NULL; ++i) {
+            words.push_back(c_sets[set][i]);
+        }
+
+        vector<char> data = compile_words(words);
+        ASSERT_FALSE(data.empty());
+        char* copy = reinterpret_cast<char*>(malloc(data.size()));
+        ASSERT_TRUE(copy);
+        memcpy(copy, &data[0], data.size());
+
+        ia_eudoxus_t* eudoxus = NULL;
+        ASSERT_EQ(IA_EUDOXUS_OK, ia_eudoxus_create(&eudoxus, copy));
+
+        /* Every offset, so that matches fall on all block positions. */
+        for (size_t offset = 0; offset < 32; ++offset) {
+            string sub = input.substr(offset);
+            EXPECT_EQ(
+                count_occurrences(words, sub),
+                run(eudoxus, sub).size()
+            ) << "Set " << set << " offset " << offset;
+        }
+
+        ia_eudoxus_destroy(eudoxus);
+    }
+}
+
+TEST(TestEudoxus, Interleaved)
+{
+    vector<char> data = compile_words(example_words());
+    ASSERT_FALSE(data.empty());
+
+    static const char* c_inputs[] = {
+        "ushers", "", "this is his", "hehehe", "x", "she sells sea shells",
+        "hershey", "nothing", "he", "his hers she he", "sheshe"
+    };
+    static const size_t c_num_inputs = sizeof(c_inputs) / sizeof(*c_inputs);
+
+    char* copy = reinterpret_cast<char*>(malloc(data.size()));
+    ASSERT_TRUE(copy);
+    memcpy(copy, &data[0], data.size());
+    ia_eudoxus_t* eudoxus = NULL;
+    ASSERT_EQ(IA_EUDOXUS_OK, ia_eudoxus_create(&eudoxus, copy));
+
+    vector<vector<string> > outputs(c_num_inputs);
+    vector<ia_eudoxus_state_t*> states(c_num_inputs);
+    vector<const uint8_t*> inputs(c_num_inputs);
+    vector<size_t> input_lengths(c_num_inputs);
+    vector<ia_eudoxus_result_t> results(c_num_inputs);
+
+    for (size_t i = 0; i < c_num_inputs; ++i) {
+        ASSERT_EQ(
+            IA_EUDOXUS_OK,
+            ia_eudoxus_create_state(
+                &states[i], eudoxus, collect_output, &outputs[i]
+            )
+        );
+        inputs[i] = reinterpret_cast<const uint8_t*>(c_inputs[i]);
+        input_lengths[i] = strlen(c_inputs[i]);
+    }
+
+    ASSERT_EQ(
+        IA_EUDOXUS_OK,
+        ia_eudoxus_execute_interleaved(
+            &states[0], &inputs[0], &input_lengths[0], &results[0],
+            c_num_inputs
+        )
+    );
+
+    for (size_t i = 0; i < c_num_inputs; ++i) {
+        EXPECT_TRUE(
+            results[i] == IA_EUDOXUS_OK || results[i] == IA_EUDOXUS_END
+        );
+        EXPECT_EQ(run(eudoxus, c_inputs[i]), outputs[i])
+            << "Input: " << c_inputs[i];
+        ia_eudoxus_destroy_state(states[i]);
+    }
+
+    EXPECT_EQ(
+        IA_EUDOXUS_EINVAL,
+        ia_eudoxus_execute_interleaved(NULL, NULL, NULL, NULL, 0)
+    );
+
+    ia_eudoxus_destroy(eudoxus);
+}
+
+TEST(TestEudoxus, ResetState)
+{
+    ia_eudoxus_t* eudoxus = create_engine(compile_words(example_words()));
+    ASSERT_TRUE(eudoxus);
+
+    static const char* c_inputs[] = { "ushers", "x", "his hers she he" };
+
+    vector<string> outputs;
+    ia_eudoxus_state_t* state = NULL;
+    ASSERT_EQ(
+        IA_EUDOXUS_OK,
+        ia_eudoxus_create_state(&state, eudoxus, collect_output, &outputs)
+    );
+
+    /* Stop part way into a match, then reuse the state. */
+    ia_eudoxus_execute(state, reinterpret_cast<const uint8_t*>("hi"), 2);
+
+    for (size_t i = 0; i < sizeof(c_inputs) / sizeof(*c_inputs); ++i) {
+        outputs.clear();
+        ASSERT_EQ(IA_EUDOXUS_OK, ia_eudoxus_reset_state(state));
+        ia_eudoxus_result_t rc = ia_eudoxus_execute(
+            state,
+            reinterpret_cast<const uint8_t*>(c_inputs[i]),
+            strlen(c_inputs[i])
+        );
+        EXPECT_TRUE(rc == IA_EUDOXUS_OK || rc == IA_EUDOXUS_END);
+        EXPECT_EQ(run(eudoxus, c_inputs[i]), outputs)
+            << "Input: " << c_inputs[i];
+    }
+
+    EXPECT_EQ(IA_EUDOXUS_EINVAL, ia_eudoxus_reset_state(NULL));
+
+    ia_eudoxus_destroy_state(state);
+    ia_eudoxus_destroy(eudoxus);
+}
+
+TEST(TestEudoxus, ByteClasses)
+{
+    vector<string> words;
+    srand(2);
+    for (size_t n = 0; n < 30; ++n) {
+        string word;
+        for (size_t i = 0; i < 4; ++i) {
+            word += "abcehilrs"[rand() % 9];
+        }
+        words.push_back(word);
+    }
+
+    EudoxusCompiler::configuration_t configuration;
+    /* Prefer table nodes so that byte class nodes are used. */
+    configuration.high_node_weight = 0;
+
+    EudoxusCompiler::result_t with_classes =
+        compile_words_result(words, configuration);
+    EXPECT_LT(0UL, with_classes.class_nodes);
+
+    configuration.byte_classes = false;
+    EudoxusCompiler::result_t without_classes =
+        compile_words_result(words, configuration);
+    EXPECT_EQ(0UL, without_classes.class_nodes);
+    EXPECT_LT(0UL, without_classes.high_nodes);
+    EXPECT_LT(with_classes.buffer.size(), without_classes.buffer.size());
+
+    ia_eudoxus_t* a = create_engine(vector<char>(
+        with_classes.buffer.begin(), with_classes.buffer.end()
+    ));
+    ia_eudoxus_t* b = create_engine(vector<char>(
+        without_classes.buffer.begin(), without_classes.buffer.end()
+    ));
+    ASSERT_TRUE(a);
+    ASSERT_TRUE(b);
+
+    for (size_t n = 0; n < 20; ++n) {
+        string input;
+        for (size_t i = 0; i < 200; ++i) {
+            input += "abcehilrsABC \xff"[rand() % 16];
+        }
+        vector<string> outputs = run(a, input);
+        EXPECT_EQ(run(b, input), outputs);
+        EXPECT_EQ(count_occurrences(words, input), outputs.size());
+    }
+
+    ia_eudoxus_destroy(a);
+    ia_eudoxus_destroy(b);
+}
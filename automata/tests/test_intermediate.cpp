@@ -745,3 +745,44 @@ TEST(TestIntermediate, Writer)
     EXPECT_TRUE(node->advance_on_default());
     EXPECT_FALSE(node->first_output());
 }
+
+namespace {
+
+//! Write @a a with @a chunk_size and return number of chunks.
+size_t count_chunks(const Automata& a, size_t chunk_size, size_t max_nodes)
+{
+    stringstream s;
+    write_automata(a, s, chunk_size);
+
+    PB::Chunk chunk;
+    size_t num_chunks = 0;
+    size_t num_nodes = 0;
+    while (read_chunk(s, chunk)) {
+        ++num_chunks;
+        num_nodes += chunk.nodes_size();
+        EXPECT_GE(max_nodes, size_t(chunk.nodes_size()));
+    }
+    EXPECT_EQ(2500UL, num_nodes);
+
+    return num_chunks;
+}
+
+}
+
+TEST(TestIntermediate, WriterChunkSize)
+{
+    // Chain of 2500 nodes.
+    Automata a;
+    a.start_node() = boost::make_shared<Node>();
+    node_p node = a.start_node();
+    for (int i = 1; i < 2500; ++i) {
+        Edge edge(boost::make_shared<Node>());
+        edge.add('a');
+        node->edges().push_back(edge);
+        node = edge.target();
+    }
+
+    EXPECT_EQ(5UL, count_chunks(a, 500, 500));
+    // Default chunk size.
+    EXPECT_EQ(3UL, count_chunks(a, 0, 1024));
+}
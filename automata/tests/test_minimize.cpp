@@ -0,0 +1,217 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronAutomata --- Determinize and Minimize test.
+ **/
+
+#include <ironautomata/minimize.hpp>
+
+#include <ironautomata/generator/aho_corasick.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+
+using namespace std;
+using namespace IronAutomata::Intermediate;
+
+namespace {
+
+//! Run deterministic @a automata on @a input and return outputs.
+vector<string> run(const Automata& automata, const string& input)
+{
+    vector<string> result;
+    node_p node = automata.start_node();
+    string::const_iterator i = input.begin();
+    while (i != input.end()) {
+        Node::target_info_list_t targets = node->targets_for(*i);
+        if (targets.empty()) {
+            break;
+        }
+        EXPECT_EQ(1UL, targets.size());
+        node = targets.front().first;
+        if (targets.front().second) {
+            ++i;
+        }
+        for (
+            output_p output = node->first_output();
+            output;
+            output = output->next_output()
+        ) {
+            result.push_back(
+                string(output->content().begin(), output->content().end())
+            );
+        }
+    }
+    return result;
+}
+
+void count_node(size_t& count, const node_p&)
+{
+    ++count;
+}
+
+size_t count_nodes(const Automata& automata)
+{
+    size_t count = 0;
+    breadth_first(automata, boost::bind(count_node, boost::ref(count), _1));
+    return count;
+}
+
+void check_deterministic(const node_p& node)
+{
+    Node::targets_by_input_t targets = node->build_targets_by_input();
+    for (int c = 0; c < 256; ++c) {
+        EXPECT_GE(1UL, targets[c].size());
+    }
+}
+
+//! Nondeterministic automata for .*ab with output "ab".
+void build_any_ab(Automata& automata)
+{
+    node_p start = boost::make_shared<Node>();
+    node_p a = boost::make_shared<Node>();
+    node_p ab = boost::make_shared<Node>();
+
+    ab->first_output() = boost::make_shared<Output>(string("ab"));
+
+    Edge any(start);
+    start->edges().push_back(any);
+    Edge to_a(a);
+    to_a.add('a');
+    start->edges().push_back(to_a);
+    Edge to_ab(ab);
+    to_ab.add('b');
+    a->edges().push_back(to_ab);
+
+    automata.start_node() = start;
+}
+
+void build_ac(Automata& automata)
+{
+    static const char* words[] = {"he", "she", "his", "hers", "is", "s"};
+
+    IronAutomata::Generator::aho_corasick_begin(automata);
+    for (size_t i = 0; i < sizeof(words) / sizeof(*words); ++i) {
+        IronAutomata::Generator::aho_corasick_add_length(automata, words[i]);
+    }
+    IronAutomata::Generator::aho_corasick_finish(automata);
+}
+
+}
+
+TEST(TestMinimize, Determinize)
+{
+    Automata automata;
+    build_any_ab(automata);
+
+    EXPECT_LT(0UL, determinize(automata));
+    breadth_first(automata, check_deterministic);
+
+    EXPECT_EQ(0UL, run(automata, "xyz").size());
+    EXPECT_EQ(1UL, run(automata, "xxab").size());
+    EXPECT_EQ(1UL, run(automata, "aab").size());
+    EXPECT_EQ(2UL, run(automata, "abxab").size());
+    EXPECT_EQ("ab", run(automata, "ab").front());
+
+    // Already deterministic.
+    EXPECT_EQ(0UL, determinize(automata));
+}
+
+TEST(TestMinimize, DeterminizeNonAdvancing)
+{
+    Automata automata;
+    build_any_ab(automata);
+    automata.start_node()->edges().front().advance() = false;
+
+    EXPECT_THROW(determinize(automata), invalid_argument);
+}
+
+TEST(TestMinimize, Minimize)
+{
+    Automata automata;
+    node_p start = boost::make_shared<Node>();
+    node_p x = boost::make_shared<Node>();
+    node_p y = boost::make_shared<Node>();
+    node_p z = boost::make_shared<Node>();
+
+    x->first_output() = boost::make_shared<Output>(string("o"));
+    y->first_output() = boost::make_shared<Output>(string("o"));
+    z->first_output() = boost::make_shared<Output>(string("p"));
+
+    Edge edge(x);
+    edge.add('x');
+    start->edges().push_back(edge);
+    edge = Edge(y);
+    edge.add('y');
+    start->edges().push_back(edge);
+    edge = Edge(z);
+    edge.add('z');
+    start->edges().push_back(edge);
+
+    automata.start_node() = start;
+
+    EXPECT_EQ(1UL, minimize(automata));
+    EXPECT_EQ(3UL, count_nodes(automata));
+    EXPECT_EQ(start->targets_for('x'), start->targets_for('y'));
+    EXPECT_NE(start->targets_for('x'), start->targets_for('z'));
+    EXPECT_EQ(0UL, minimize(automata));
+}
+
+TEST(TestMinimize, MinimizeNonDeterministic)
+{
+    Automata automata;
+    build_any_ab(automata);
+
+    EXPECT_THROW(minimize(automata), invalid_argument);
+}
+
+TEST(TestMinimize, MinimizePreservesBehavior)
+{
+    Automata original;
+    Automata minimized;
+    build_ac(original);
+    build_ac(minimized);
+
+    minimize(minimized);
+    EXPECT_GE(count_nodes(original), count_nodes(minimized));
+
+    static const char* inputs[] = {
+        "ushers", "hishers", "she sells", "hhhehis", "", "sss"
+    };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); ++i) {
+        EXPECT_EQ(run(original, inputs[i]), run(minimized, inputs[i]));
+    }
+}
+
+TEST(TestMinimize, DeterminizeThenMinimize)
+{
+    Automata automata;
+    build_any_ab(automata);
+
+    determinize(automata);
+    minimize(automata);
+    breadth_first(automata, check_deterministic);
+
+    EXPECT_EQ(3UL, count_nodes(automata));
+    EXPECT_EQ(2UL, run(automata, "abaab").size());
+}
@@ -0,0 +1,173 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronAutomata --- Union of Automata test.
+ **/
+
+#include <ironautomata/union_automata.hpp>
+
+#include <ironautomata/generator/aho_corasick.hpp>
+
+#include <boost/make_shared.hpp>
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+using namespace IronAutomata::Intermediate;
+
+namespace {
+
+//! Run deterministic @a automata on @a input and return sorted outputs.
+vector<string> run(const Automata& automata, const string& input)
+{
+    vector<string> result;
+    node_p node = automata.start_node();
+    string::const_iterator i = input.begin();
+    while (i != input.end()) {
+        Node::target_info_list_t targets = node->targets_for(*i);
+        if (targets.empty()) {
+            break;
+        }
+        EXPECT_EQ(1UL, targets.size());
+        node = targets.front().first;
+        bool advance = targets.front().second;
+        if (advance) {
+            ++i;
+        }
+        if (! advance && automata.no_advance_no_output()) {
+            continue;
+        }
+        for (
+            output_p output = node->first_output();
+            output;
+            output = output->next_output()
+        ) {
+            result.push_back(
+                string(output->content().begin(), output->content().end()) +
+                "@" + string(input.begin(), i)
+            );
+        }
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
+
+void build_ac(
+    Automata&          automata,
+    const char* const* words,
+    size_t             num_words
+)
+{
+    IronAutomata::Generator::aho_corasick_begin(automata);
+    for (size_t i = 0; i < num_words; ++i) {
+        string word(words[i]);
+        IronAutomata::Generator::aho_corasick_add_data(
+            automata, word, byte_vector_t(word.begin(), word.end())
+        );
+    }
+    IronAutomata::Generator::aho_corasick_finish(automata);
+}
+
+const char* c_words[] = {"he", "she", "his", "hers", "is", "ushe"};
+
+}
+
+TEST(TestUnionAutomata, AhoCorasick)
+{
+    Automata all;
+    Automata first;
+    Automata second;
+    build_ac(all, c_words, 6);
+    build_ac(first, c_words, 3);
+    build_ac(second, c_words + 3, 3);
+
+    EXPECT_LT(0UL, union_automata(first, second));
+    EXPECT_TRUE(first.no_advance_no_output());
+
+    static const char* inputs[] = {
+        "ushers", "hishers", "she sells", "hhhehis", "", "ushe is his"
+    };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); ++i) {
+        EXPECT_EQ(run(all, inputs[i]), run(first, inputs[i]));
+    }
+}
+
+TEST(TestUnionAutomata, Ends)
+{
+    // a -> "a"; b -> "b"; each accepts a single input.
+    Automata a;
+    Automata b;
+    a.start_node() = boost::make_shared<Node>();
+    b.start_node() = boost::make_shared<Node>();
+    node_p to_a = boost::make_shared<Node>();
+    node_p to_b = boost::make_shared<Node>();
+    to_a->first_output() = boost::make_shared<Output>(string("a"));
+    to_b->first_output() = boost::make_shared<Output>(string("b"));
+    Edge edge(to_a);
+    edge.add('x');
+    a.start_node()->edges().push_back(edge);
+    edge = Edge(to_b);
+    edge.add('x');
+    edge.add('y');
+    b.start_node()->edges().push_back(edge);
+
+    union_automata(a, b);
+
+    vector<string> outputs = run(a, "x");
+    ASSERT_EQ(2UL, outputs.size());
+    EXPECT_EQ("a@x", outputs[0]);
+    EXPECT_EQ("b@x", outputs[1]);
+    EXPECT_EQ(1UL, run(a, "y").size());
+    EXPECT_TRUE(run(a, "z").empty());
+    // Both automata end after one input.
+    EXPECT_TRUE(a.start_node()->targets_for('x').front().first->edges().empty());
+}
+
+TEST(TestUnionAutomata, Metadata)
+{
+    Automata a;
+    Automata b;
+    build_ac(a, c_words, 1);
+    build_ac(b, c_words + 1, 1);
+    a.metadata()["Output-Type"] = "string";
+    b.metadata()["Output-Type"] = "length";
+
+    EXPECT_THROW(union_automata(a, b), invalid_argument);
+
+    b.metadata()["Output-Type"] = "string";
+    b.metadata()["Other"] = "value";
+    union_automata(a, b);
+    EXPECT_EQ("value", a.metadata()["Other"]);
+}
+
+TEST(TestUnionAutomata, Invalid)
+{
+    Automata a;
+    Automata b;
+    build_ac(a, c_words, 1);
+
+    EXPECT_THROW(union_automata(a, b), invalid_argument);
+
+    build_ac(b, c_words, 1);
+    b.no_advance_no_output() = false;
+    EXPECT_THROW(union_automata(a, b), invalid_argument);
+}
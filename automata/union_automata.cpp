@@ -0,0 +1,365 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronAutomata --- Union of Automata Implementation
+ */
+
+#include <ironautomata/union_automata.hpp>
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#if __has_warning("-Wunused-local-typedef")
+#pragma clang diagnostic ignored "-Wunused-local-typedef"
+#endif
+#endif
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/make_shared.hpp>
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <stdexcept>
+
+using namespace std;
+
+namespace IronAutomata {
+namespace Intermediate {
+
+namespace {
+
+//! Marker for no node.
+const size_t c_none = size_t(-1);
+
+//! Target index (or c_none) and advance.
+typedef pair<size_t, bool> target_t;
+
+//! Last input of a run of inputs with same target.
+typedef pair<int, target_t> run_t;
+
+//! Targets of a node as runs of inputs.
+typedef vector<run_t> row_t;
+
+//! Ordering of runs by last input.
+bool run_before(const run_t& run, int c)
+{
+    return run.first < c;
+}
+
+/**
+ * An automata prepared for product construction.
+ */
+class Component
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param[in] automata Automata to prepare.
+     * @throw invalid_argument if @a automata is unsuitable; see
+     *        union_automata().
+     */
+    explicit
+    Component(const Automata& automata)
+    {
+        if (! automata.start_node()) {
+            throw invalid_argument("Can not take union of empty automata.");
+        }
+
+        breadth_first(
+            automata,
+            boost::bind(&Component::index_node, this, _1)
+        );
+
+        m_rows.resize(m_nodes.size());
+        for (size_t i = 0; i < m_nodes.size(); ++i) {
+            Node::targets_by_input_t by_input =
+                m_nodes[i]->build_targets_by_input();
+            for (int c = 0; c < 256; ++c) {
+                const Node::target_info_list_t& infos = by_input[c];
+                if (infos.size() > 1) {
+                    throw invalid_argument(
+                        "Can not take union of non-deterministic automata."
+                    );
+                }
+                target_t target(c_none, true);
+                if (! infos.empty()) {
+                    target.first = m_index[infos.front().first];
+                    target.second = infos.front().second;
+                    if (! target.second && ! automata.no_advance_no_output()) {
+                        throw invalid_argument(
+                            "Can not take union of automata with "
+                            "non-advancing edges unless no advance no output."
+                        );
+                    }
+                }
+                if (! m_rows[i].empty() && m_rows[i].back().second == target) {
+                    m_rows[i].back().first = c;
+                }
+                else {
+                    m_rows[i].push_back(make_pair(c, target));
+                }
+            }
+        }
+    }
+
+    //! Node of index @a i.
+    const node_p& node(size_t i) const
+    {
+        return m_nodes[i];
+    }
+
+    /**
+     * Target of node @a i on input @a c.
+     *
+     * @param[in] i Index of node; may be c_none.
+     * @param[in] c Input.
+     * @return Target; index is c_none if there is none.
+     */
+    const target_t& target(size_t i, uint8_t c) const
+    {
+        static const target_t c_no_target(c_none, true);
+        if (i == c_none) {
+            return c_no_target;
+        }
+        const row_t& row = m_rows[i];
+        return lower_bound(row.begin(), row.end(), c, run_before)->second;
+    }
+
+    /**
+     * Node reached from node @a i by advancing on @a c.
+     *
+     * Follows non-advancing edges until an advancing one.
+     *
+     * @param[in] i Index of node; may be c_none.
+     * @param[in] c Input.
+     * @return Index of node or c_none if there is none.
+     * @throw invalid_argument on a non-advancing cycle.
+     */
+    size_t next(size_t i, uint8_t c) const
+    {
+        for (size_t steps = 0; i != c_none; ++steps) {
+            if (steps > m_nodes.size()) {
+                throw invalid_argument(
+                    "Can not take union of automata with non-advancing cycle."
+                );
+            }
+            const target_t& t = target(i, c);
+            if (t.second) {
+                return t.first;
+            }
+            i = t.first;
+        }
+        return c_none;
+    }
+
+private:
+    void index_node(const node_p& node)
+    {
+        m_index[node] = m_nodes.size();
+        m_nodes.push_back(node);
+    }
+
+    vector<node_p> m_nodes;
+    map<node_p, size_t> m_index;
+    vector<row_t> m_rows;
+};
+
+//! Node of each automata; c_none for none.
+typedef pair<size_t, size_t> pair_t;
+
+//! Target pair and advance.
+typedef pair<pair_t, bool> pair_target_t;
+
+//! Map of pair to new node.
+typedef map<pair_t, node_p> pairs_t;
+
+//! Pairs that need their new node filled in.
+typedef list<pairs_t::value_type> pair_todo_t;
+
+/**
+ * Find or create the new node for @a p.
+ *
+ * @param[in] pairs Pairs so far.
+ * @param[in] todo  Pairs to process; appended to if @a p is new.
+ * @param[in] p     Pair to find node for.
+ * @return New node for @a p.
+ */
+node_p pair_node(pairs_t& pairs, pair_todo_t& todo, const pair_t& p)
+{
+    pairs_t::iterator i = pairs.find(p);
+    if (i == pairs.end()) {
+        i = pairs.insert(make_pair(p, boost::make_shared<Node>())).first;
+        todo.push_back(*i);
+    }
+    return i->second;
+}
+
+/**
+ * Outputs of @a a followed by @a b.
+ *
+ * Copies the outputs of @a a unless either is empty; @a b is shared.
+ *
+ * @param[in] a First output list.
+ * @param[in] b Second output list.
+ * @return First output of combined list.
+ */
+output_p concatenate_outputs(const output_p& a, const output_p& b)
+{
+    if (! a) {
+        return b;
+    }
+    if (! b) {
+        return a;
+    }
+
+    output_p first = boost::make_shared<Output>(a->content());
+    output_p last = first;
+    for (
+        output_p current = a->next_output();
+        current;
+        current = current->next_output()
+    ) {
+        last->next_output() = boost::make_shared<Output>(current->content());
+        last = last->next_output();
+    }
+    last->next_output() = b;
+
+    return first;
+}
+
+}
+
+size_t union_automata(Automata& automata, const Automata& other)
+{
+    Component a(automata);
+    Component b(other);
+
+    typedef map<string, string> metadata_t;
+    BOOST_FOREACH(const metadata_t::value_type& v, other.metadata()) {
+        metadata_t::const_iterator i = automata.metadata().find(v.first);
+        if (i != automata.metadata().end() && i->second != v.second) {
+            throw invalid_argument(
+                "Can not take union of automata with different " +
+                v.first + " metadata."
+            );
+        }
+    }
+
+    pairs_t pairs;
+    pair_todo_t todo;
+    bool has_nonadvancing = false;
+    node_p start_node = pair_node(pairs, todo, pair_t(0, 0));
+
+    while (! todo.empty()) {
+        pair_t p = todo.front().first;
+        node_p node = todo.front().second;
+        todo.pop_front();
+
+        node->first_output() = concatenate_outputs(
+            p.first == c_none ? output_p() : a.node(p.first)->first_output(),
+            p.second == c_none ? output_p() : b.node(p.second)->first_output()
+        );
+
+        typedef map<pair_target_t, list<uint8_t> > by_target_t;
+        by_target_t by_target;
+        for (int c = 0; c < 256; ++c) {
+            const target_t& target_a = a.target(p.first, c);
+            const target_t& target_b = b.target(p.second, c);
+            // If both automata that have a target do not advance, neither
+            // does the union.  Otherwise, the one that does not advance is
+            // followed until it does.
+            if (
+                (target_a.first != c_none || target_b.first != c_none) &&
+                ! target_a.second && ! target_b.second
+            ) {
+                by_target[pair_target_t(
+                    pair_t(target_a.first, target_b.first), false
+                )].push_back(c);
+            }
+            else {
+                by_target[pair_target_t(
+                    pair_t(
+                        target_a.second ?
+                            target_a.first : a.next(p.first, c),
+                        target_b.second ?
+                            target_b.first : b.next(p.second, c)
+                    ),
+                    true
+                )].push_back(c);
+            }
+        }
+
+        // The most common target is the default unless some inputs have
+        // no target, as those would then follow the default.
+        const pair_target_t none(pair_t(c_none, c_none), true);
+        by_target_t::const_iterator default_i = by_target.end();
+        if (by_target.count(none) == 0) {
+            for (
+                by_target_t::const_iterator i = by_target.begin();
+                i != by_target.end();
+                ++i
+            ) {
+                if (
+                    default_i == by_target.end() ||
+                    i->second.size() > default_i->second.size()
+                ) {
+                    default_i = i;
+                }
+            }
+        }
+
+        for (
+            by_target_t::const_iterator i = by_target.begin();
+            i != by_target.end();
+            ++i
+        ) {
+            if (i->first == none) {
+                continue;
+            }
+            node_p target = pair_node(pairs, todo, i->first.first);
+            if (! i->first.second) {
+                has_nonadvancing = true;
+            }
+            if (i == default_i) {
+                node->default_target() = target;
+                node->advance_on_default() = i->first.second;
+            }
+            else {
+                Edge edge(target, i->first.second);
+                BOOST_FOREACH(uint8_t c, i->second) {
+                    edge.add(c);
+                }
+                node->edges().push_back(edge);
+            }
+        }
+    }
+
+    automata.start_node() = start_node;
+    automata.no_advance_no_output() = has_nonadvancing;
+    automata.metadata().insert(other.metadata().begin(), other.metadata().end());
+
+    return pairs.size();
+}
+
+} // Intermediate
+} // IronAutomata
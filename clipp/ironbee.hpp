@@ -65,13 +65,18 @@ private:
  * This consumer is as IronBeeConsumer except that it will spawn multiple
  * threads to feed data to IronBee.  It will wait until at least one thread
  * is free, and then pass on the input and return.
+ *
+ * If @a report_latency is true, the time each input waits for a thread and
+ * the time IronBee takes to process it are recorded, and a summary of
+ * them and of the throughput is written to standard out at the end.
  **/
 class IronBeeThreadedConsumer
 {
 public:
     IronBeeThreadedConsumer(
         const std::string& config_path,
-        size_t             num_inputs
+        size_t             num_inputs,
+        bool               report_latency = false
     );
 
     bool operator()(const Input::input_p& input);
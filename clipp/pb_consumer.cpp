@@ -250,12 +250,8 @@ PBConsumer::PBConsumer(ostream& out) :
     GOOGLE_PROTOBUF_VERIFY_VERSION;
 }
 
-bool PBConsumer::operator()(const Input::input_p& input)
+void serialize_pb_input(std::string& out, const Input::input_p& input)
 {
-    if (! m_state || ! *m_state->output) {
-        return false;
-    }
-
     PB::Input pb_input;
 
     if (! input->id.empty()) {
@@ -300,12 +296,22 @@ bool PBConsumer::operator()(const Input::input_p& input)
         event->dispatch(delegate);
     }
 
-    string buffer;
-    google::protobuf::io::StringOutputStream output(&buffer);
+    out.clear();
+    google::protobuf::io::StringOutputStream output(&out);
     google::protobuf::io::GzipOutputStream zipped_output(&output);
 
     pb_input.SerializeToZeroCopyStream(&zipped_output);
     zipped_output.Close();
+}
+
+bool PBConsumer::operator()(const Input::input_p& input)
+{
+    if (! m_state || ! *m_state->output) {
+        return false;
+    }
+
+    string buffer;
+    serialize_pb_input(buffer, input);
 
     uint32_t size = buffer.length();
     uint32_t nsize = htonl(size);
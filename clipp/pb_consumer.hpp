@@ -59,6 +59,16 @@ private:
     boost::shared_ptr<State> m_state;
 };
 
+/**
+ * Serialize @a input as a gzipped protobuf Input message.
+ *
+ * This is a message of the PBConsumer format without its size.
+ *
+ * @param[out] out   Message; replaced.
+ * @param[in]  input Input to serialize.
+ **/
+void serialize_pb_input(std::string& out, const Input::input_p& input);
+
 } // CLIPP
 } // IronBee
 
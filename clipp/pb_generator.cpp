@@ -49,6 +49,13 @@
 #include <fstream>
 #include <stdexcept>
 
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #if defined(HAVE_ARPA_INET_H)
 #include <arpa/inet.h>
 #elif defined(HAVE_NETINET_IN_H)
@@ -63,12 +70,36 @@ namespace CLIPP {
 struct PBGenerator::State
 {
     State(const std::string& path_) :
-        path(path_)
+        path(path_),
+        input(NULL),
+        map(NULL),
+        map_length(0),
+        offset(0)
     {
         if (path == "-") {
             input = &cin;
+            return;
+        }
+
+        // Map files, so inputs are parsed in place rather than read into a
+        // buffer each.  Fall back to reading anything that can not be
+        // mapped, e.g., a pipe.
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error("Could not open " + path + " for reading.");
         }
-        else {
+        struct stat sb;
+        if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size > 0) {
+            void* p = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                map = reinterpret_cast<const char*>(p);
+                map_length = sb.st_size;
+                madvise(p, map_length, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+
+        if (! map) {
             input = new ifstream(path.c_str(), ios::binary);
             if (! *input) {
                 throw runtime_error("Could not open " + path + " for reading.");
@@ -78,13 +109,19 @@ struct PBGenerator::State
 
     ~State()
     {
-        if (path != "-") {
+        if (map) {
+            munmap(const_cast<char*>(map), map_length);
+        }
+        else if (path != "-") {
             delete input;
         }
     }
 
-    string   path;
-    istream* input;
+    string      path;
+    istream*    input;
+    const char* map;
+    size_t      map_length;
+    size_t      offset;
 };
 
 PBGenerator::PBGenerator()
@@ -262,45 +299,32 @@ struct pb_to_event :
 
 }
 
-bool PBGenerator::operator()(Input::input_p& input)
+void parse_pb_input(
+    Input::input_p& input,
+    const char*     data,
+    size_t          length
+)
 {
-    if (! *m_state->input) {
-        return false;
-    }
-
     // Reset Input
     *input = Input::Input();
 
-    uint32_t raw_size;
-    uint32_t size;
-
-    m_state->input->read(reinterpret_cast<char*>(&raw_size), sizeof(uint32_t));
-    if (! *m_state->input) {
-        return false;
-    }
-    size = ntohl(raw_size);
+    boost::shared_ptr<data_t> pb_data = boost::make_shared<data_t>();
+    input->source = pb_data;
 
-    boost::shared_ptr<data_t> data = boost::make_shared<data_t>();
-    input->source = data;
-
-    boost::scoped_array<char> buffer(new char[size]);
-
-    m_state->input->read(buffer.get(), size);
-
-    google::protobuf::io::ArrayInputStream in(buffer.get(), size);
+    google::protobuf::io::ArrayInputStream in(data, length);
     google::protobuf::io::GzipInputStream unzipped_in(&in);
 
-    if (! data->pb_input.ParseFromZeroCopyStream(&unzipped_in)) {
+    if (! pb_data->pb_input.ParseFromZeroCopyStream(&unzipped_in)) {
         throw runtime_error("Failed to parse input.");
     }
 
     // Input
-    if (data->pb_input.has_id()) {
-        input->id = data->pb_input.id();
+    if (pb_data->pb_input.has_id()) {
+        input->id = pb_data->pb_input.id();
     }
 
     // Connection
-    const PB::Connection& pb_conn = data->pb_input.connection();
+    const PB::Connection& pb_conn = pb_data->pb_input.connection();
 
     transform(
         pb_conn.pre_transaction_event().begin(),
@@ -327,6 +351,45 @@ bool PBGenerator::operator()(Input::input_p& input)
         back_inserter(input->connection.post_transaction_events),
         pb_to_event()
     );
+}
+
+bool PBGenerator::operator()(Input::input_p& input)
+{
+    uint32_t raw_size;
+    uint32_t size;
+
+    if (m_state->map) {
+        if (m_state->map_length - m_state->offset < sizeof(uint32_t)) {
+            return false;
+        }
+        memcpy(&raw_size, m_state->map + m_state->offset, sizeof(uint32_t));
+        m_state->offset += sizeof(uint32_t);
+        size = ntohl(raw_size);
+        if (m_state->map_length - m_state->offset < size) {
+            throw runtime_error("Truncated input in " + m_state->path);
+        }
+
+        parse_pb_input(input, m_state->map + m_state->offset, size);
+        m_state->offset += size;
+
+        return true;
+    }
+
+    if (! *m_state->input) {
+        return false;
+    }
+
+    m_state->input->read(reinterpret_cast<char*>(&raw_size), sizeof(uint32_t));
+    if (! *m_state->input) {
+        return false;
+    }
+    size = ntohl(raw_size);
+
+    boost::scoped_array<char> buffer(new char[size]);
+
+    m_state->input->read(buffer.get(), size);
+
+    parse_pb_input(input, buffer.get(), size);
 
     return true;
 }
@@ -58,6 +58,23 @@ private:
     boost::shared_ptr<State> m_state;
 };
 
+/**
+ * Parse a single gzipped protobuf Input message into @a input.
+ *
+ * This is a message of the PBConsumer format without its size.  The data
+ * is copied, so need not outlive @a input.
+ *
+ * @param[in] input  Input to fill in; reset first.
+ * @param[in] data   Message.
+ * @param[in] length Length of @a data.
+ * @throw runtime_error if @a data can not be parsed.
+ **/
+void parse_pb_input(
+    Input::input_p& input,
+    const char*     data,
+    size_t          length
+);
+
 } // CLIPP
 } // IronBee
 
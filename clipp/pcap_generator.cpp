@@ -45,6 +45,7 @@
 
 #include <nids.h>
 
+#include <deque>
 #include <vector>
 
 #include <cstring>
@@ -67,6 +68,8 @@ namespace CLIPP {
 
 namespace {
 static const size_t c_ip_string_length = 16;
+//! Packets to process per call to nids_dispatch().
+static const int c_dispatch_batch = 256;
 
 struct data_t
 {
@@ -88,7 +91,8 @@ typedef boost::shared_ptr<data_t> data_p;
 
 struct PCAPGlobalState
 {
-    Input::input_p input;
+    //! Inputs completed but not yet produced.
+    deque<Input::input_p> inputs;
 
     size_t input_count;
     string path;
@@ -145,8 +149,8 @@ void nids_tcp(tcp_stream* ts, void** param)
     }
     case NIDS_CLOSE: {
         // Generate input.
-        s_global_state->input = boost::make_shared<Input::Input>();
-        Input::input_p input = s_global_state->input;
+        Input::input_p input = boost::make_shared<Input::Input>();
+        s_global_state->inputs.push_back(input);
         data_t* data = reinterpret_cast<data_t*>(*param);
 
         ++s_global_state->input_count;
@@ -235,10 +239,10 @@ PCAPGenerator::PCAPGenerator(
 //! Produce an input.
 bool PCAPGenerator::operator()(Input::input_p& input) const
 {
-    s_global_state->input.reset();
-
-    while (! s_global_state->input) {
-        int processed = nids_dispatch(1);
+    // Dispatch packets in batches, rather than one at a time, queueing the
+    // inputs they complete.
+    while (s_global_state->inputs.empty()) {
+        int processed = nids_dispatch(c_dispatch_batch);
         if (processed == -1) {
             throw runtime_error(
                 string("Error in nids_dispatch: ") + nids_errbuf
@@ -250,7 +254,8 @@ bool PCAPGenerator::operator()(Input::input_p& input) const
         }
     }
 
-    input.swap(s_global_state->input);
+    input.swap(s_global_state->inputs.front());
+    s_global_state->inputs.pop_front();
 
     ParseModifier()(input);
 
@@ -0,0 +1,129 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+/**
+ * @file
+ * @brief IronBee --- CLIPP Rate Modifier Implementation
+ */
+
+#include "rate_modifier.hpp"
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#if __has_warning("-Wunused-local-typedef")
+#pragma clang diagnostic ignored "-Wunused-local-typedef"
+#endif
+#endif
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/format.hpp>
+#include <boost/make_shared.hpp>
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+#include <iostream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace IronBee {
+namespace CLIPP {
+
+struct RateModifier::State
+{
+    State() :
+        count(0),
+        late(0),
+        max_lag_us(0)
+    {
+        // nop
+    }
+
+    ~State()
+    {
+        if (count > 0) {
+            cerr << boost::format(
+                "@rate: %d inputs at %g/s, %d late, at most %d us late\n"
+            ) % count % rate % late % max_lag_us;
+        }
+    }
+
+    //! Inputs per second.
+    double rate;
+
+    //! When the first input was passed on.
+    boost::posix_time::ptime start_at;
+
+    //! Inputs passed on.
+    size_t count;
+
+    //! Inputs passed on after they were due.
+    size_t late;
+
+    //! Most an input was passed on after it was due.
+    int64_t max_lag_us;
+};
+
+RateModifier::RateModifier(double rate) :
+    m_state(boost::make_shared<State>())
+{
+    if (! (rate > 0)) {
+        throw runtime_error("@rate requires a positive rate.");
+    }
+    m_state->rate = rate;
+}
+
+bool RateModifier::operator()(Input::input_p& input)
+{
+    if (! input) {
+        return true;
+    }
+
+    boost::posix_time::ptime now =
+        boost::posix_time::microsec_clock::universal_time();
+
+    if (m_state->count == 0) {
+        m_state->start_at = now;
+    }
+    else {
+        // Due time of this input from the start, not from the last input,
+        // so lateness does not accumulate into the schedule.
+        boost::posix_time::ptime due_at = m_state->start_at +
+            boost::posix_time::microseconds(
+                static_cast<int64_t>(m_state->count * 1e6 / m_state->rate)
+            );
+        int64_t wait_us = (due_at - now).total_microseconds();
+
+        if (wait_us > 0) {
+            usleep(useconds_t(wait_us));
+        }
+        else if (wait_us < 0) {
+            ++m_state->late;
+            if (-wait_us > m_state->max_lag_us) {
+                m_state->max_lag_us = -wait_us;
+            }
+        }
+    }
+
+    ++m_state->count;
+
+    return true;
+}
+
+} // CLIPP
+} // IronBee
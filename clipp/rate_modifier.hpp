@@ -0,0 +1,66 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+/**
+ * @file
+ * @brief IronBee --- CLIPP Rate Modifier
+ */
+
+#ifndef __IRONBEE__CLIPP__RATE_MODIFIER__
+#define __IRONBEE__CLIPP__RATE_MODIFIER__
+
+#include <clipp/input.hpp>
+
+#include <boost/shared_ptr.hpp>
+
+namespace IronBee {
+namespace CLIPP {
+
+/**
+ * Pass inputs on at a fixed rate.
+ *
+ * The schedule is open loop: the @e i th input is due @e i / @a rate
+ * seconds after the first, however long the rest of the chain took with
+ * earlier inputs.  An input that is due waits; one that is late, because
+ * the chain is slower than @a rate, goes on at once, and how late inputs
+ * ran is written to standard error at the end.  The chain is thus driven
+ * as a stream of independent clients would drive a server, rather than
+ * slowing down with it.
+ **/
+class RateModifier
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param[in] rate Inputs per second; must be positive.
+     * @throw runtime_error if @a rate is not positive.
+     **/
+    explicit
+    RateModifier(double rate);
+
+    //! Call operator.
+    bool operator()(Input::input_p& in_out);
+
+private:
+    struct State;
+    boost::shared_ptr<State> m_state;
+};
+
+} // CLIPP
+} // IronBee
+
+#endif
@@ -0,0 +1,107 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- CLIPP Shared Memory Ring Consumer Implementation
+ */
+
+#include "ironbee_config_auto.h"
+
+#include "shm_consumer.hpp"
+#include "shm_generator.hpp"
+#include "pb_consumer.hpp"
+
+#include <ironbeepp/memory_manager.hpp>
+#include <ironbeepp/memory_pool_lite.hpp>
+
+#include <ironbee/shm_ring.h>
+
+#include <boost/make_shared.hpp>
+
+#include <stdexcept>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace IronBee {
+namespace CLIPP {
+
+struct ShmConsumer::State
+{
+    explicit
+    State(const std::string& path)
+    {
+        ib_status_t rc = ib_shm_ring_open(
+            &ring,
+            MemoryManager(pool).ib(),
+            path.c_str(),
+            c_shm_ring_capacity
+        );
+        if (rc != IB_OK) {
+            throw runtime_error("Could not open ring " + path + ".");
+        }
+    }
+
+    ~State()
+    {
+        ib_shm_ring_close(ring);
+    }
+
+    ScopedMemoryPoolLite pool;
+    ib_shm_ring_t*       ring;
+    string               buffer;
+};
+
+ShmConsumer::ShmConsumer()
+{
+    // nop
+}
+
+ShmConsumer::ShmConsumer(const std::string& path) :
+    m_state(boost::make_shared<State>(path))
+{
+    // nop
+}
+
+bool ShmConsumer::operator()(const Input::input_p& input)
+{
+    if (! m_state) {
+        return false;
+    }
+
+    serialize_pb_input(m_state->buffer, input);
+
+    for (;;) {
+        ib_status_t rc = ib_shm_ring_push(
+            m_state->ring,
+            m_state->buffer.data(),
+            m_state->buffer.length()
+        );
+        if (rc == IB_OK) {
+            return true;
+        }
+        if (rc != IB_EAGAIN) {
+            throw runtime_error("Input too large for ring.");
+        }
+        usleep(c_shm_ring_poll_interval);
+    }
+}
+
+} // CLIPP
+} // IronBee
@@ -0,0 +1,70 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- CLIPP Shared Memory Ring Consumer
+ */
+
+#ifndef __IRONBEE_CLIPP__SHM_CONSUMER__
+#define __IRONBEE_CLIPP__SHM_CONSUMER__
+
+#include <clipp/input.hpp>
+
+#include <boost/shared_ptr.hpp>
+
+namespace IronBee {
+namespace CLIPP {
+
+/**
+ * CLIPP consumer that writes inputs to a shared memory ring.
+ *
+ * See ShmGenerator for the format.  The consumer waits for room in the
+ * ring while it is full, and closes the ring when destroyed.
+ *
+ * @sa ShmGenerator
+ **/
+class ShmConsumer
+{
+public:
+    //! Default Constructor.
+    /**
+     * Behavior except for assigning to is undefined.
+     **/
+    ShmConsumer();
+
+    /**
+     * Constructor.
+     *
+     * @param[in] path Path of the ring; created if it does not exist.
+     * @throw runtime_error if the ring can not be opened.
+     **/
+    explicit
+    ShmConsumer(const std::string& path);
+
+    //! Write @a input to the ring.
+    bool operator()(const Input::input_p& input);
+
+private:
+    struct State;
+    boost::shared_ptr<State> m_state;
+};
+
+} // CLIPP
+} // IronBee
+
+#endif
@@ -0,0 +1,105 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- CLIPP Shared Memory Ring Generator Implementation
+ */
+
+#include "ironbee_config_auto.h"
+
+#include "shm_generator.hpp"
+#include "pb_generator.hpp"
+
+#include <ironbeepp/memory_manager.hpp>
+#include <ironbeepp/memory_pool_lite.hpp>
+
+#include <ironbee/shm_ring.h>
+
+#include <boost/make_shared.hpp>
+
+#include <stdexcept>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace IronBee {
+namespace CLIPP {
+
+struct ShmGenerator::State
+{
+    explicit
+    State(const std::string& path)
+    {
+        ib_status_t rc = ib_shm_ring_open(
+            &ring,
+            MemoryManager(pool).ib(),
+            path.c_str(),
+            c_shm_ring_capacity
+        );
+        if (rc != IB_OK) {
+            throw runtime_error("Could not open ring " + path + ".");
+        }
+    }
+
+    ScopedMemoryPoolLite pool;
+    ib_shm_ring_t*       ring;
+};
+
+ShmGenerator::ShmGenerator()
+{
+    // nop
+}
+
+ShmGenerator::ShmGenerator(const std::string& path) :
+    m_state(boost::make_shared<State>(path))
+{
+    // nop
+}
+
+bool ShmGenerator::operator()(Input::input_p& input)
+{
+    const void* data;
+    size_t length;
+
+    for (;;) {
+        ib_status_t rc = ib_shm_ring_peek(m_state->ring, &data, &length);
+        if (rc == IB_ENOENT) {
+            return false;
+        }
+        if (rc == IB_OK) {
+            break;
+        }
+        usleep(c_shm_ring_poll_interval);
+    }
+
+    // The record is parsed in place, and released even if it is bad.
+    try {
+        parse_pb_input(input, static_cast<const char*>(data), length);
+    }
+    catch (...) {
+        ib_shm_ring_pop(m_state->ring);
+        throw;
+    }
+    ib_shm_ring_pop(m_state->ring);
+
+    return true;
+}
+
+} // CLIPP
+} // IronBee
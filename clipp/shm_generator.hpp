@@ -0,0 +1,81 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- CLIPP Shared Memory Ring Generator
+ */
+
+#ifndef __IRONBEE__CLIPP__SHM_GENERATOR__
+#define __IRONBEE__CLIPP__SHM_GENERATOR__
+
+#include <clipp/input.hpp>
+
+#include <boost/shared_ptr.hpp>
+
+namespace IronBee {
+namespace CLIPP {
+
+//! Capacity of rings created by ShmGenerator and ShmConsumer.
+const size_t c_shm_ring_capacity = 64 * 1024 * 1024;
+
+//! Microseconds ShmGenerator and ShmConsumer wait before trying again.
+const unsigned int c_shm_ring_poll_interval = 1000;
+
+/**
+ * Generator that reads from a shared memory ring.
+ *
+ * Each record of the ring (see ib_shm_ring_open()) is an Input as a
+ * gzipped protobuf message, i.e., as written by PBConsumer without the
+ * size.  This allows another process, e.g., a server, to hand traffic to
+ * a CLIPP running IronBee out of process, without a socket or file
+ * between them.  ShmConsumer writes such a ring.
+ *
+ * The generator waits for records until the producer closes the ring.
+ *
+ * @sa ShmConsumer
+ **/
+class ShmGenerator
+{
+public:
+    //! Default Constructor.
+    /**
+     * Behavior except for assigning to is undefined.
+     **/
+    ShmGenerator();
+
+    /**
+     * Constructor.
+     *
+     * @param[in] path Path of the ring; created if it does not exist.
+     * @throw runtime_error if the ring can not be opened.
+     **/
+    explicit
+    ShmGenerator(const std::string& path);
+
+    //! Produce an input.  See input_t and input_generator_t.
+    bool operator()(Input::input_p& out_input);
+
+private:
+    struct State;
+    boost::shared_ptr<State> m_state;
+};
+
+} // CLIPP
+} // IronBee
+
+#endif
@@ -223,6 +223,42 @@ class TestTesting < CLIPPTest::TestCase
     assert_log_match /CLIPP ANNOUNCE: A/
     assert_log_no_match /CLIPP ANNOUNCE: B/
   end
+  def test_site_selection_order
+    clipp(
+      :config => <<-EOS,
+        LoadModule "ibmod_htp.so"
+        <Site wildcard>
+          SiteId bf9b5c39-c94e-4d9c-89a6-8d17cfd92912
+          Service *:*
+          Hostname *.testsite.tld
+          Action id:1 phase:REQUEST_HEADER clipp_announce:A
+        </Site>
+        <Site exact>
+          SiteId bf9b5c39-c94e-4d9c-89a6-8d17cfd92913
+          Service *:*
+          Hostname other.testsite.tld
+          Hostname my.testsite.tld
+          Action id:2 phase:REQUEST_HEADER clipp_announce:B
+        </Site>
+      EOS
+      default_site_config: <<-EOS
+        Action id:3 phase:REQUEST_HEADER clipp_announce:C
+      EOS
+    ) do
+      transaction do |t|
+        t.request(
+          raw: "GET /foo HTTP/1.1",
+          headers: {
+            'Host'           => 'MY.testsite.tld',
+          }
+        )
+      end
+    end
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: A/
+    assert_log_no_match /CLIPP ANNOUNCE: B/
+    assert_log_no_match /CLIPP ANNOUNCE: C/
+  end
 
   def test_request_line_parsing
     clipp(
@@ -212,7 +212,11 @@ CANONICAL_INCLUDE_ORDER = [
   '<ironbee/ipset.h>',
   '<ironbee/json.h>',
   '<ironbee/kvstore.h>',
+  '<ironbee/kvstore_cache.h>',
   '<ironbee/kvstore_filesystem.h>',
+  '<ironbee/kvstore_log.h>',
+  '<ironbee/kvstore_shm.h>',
+  '<ironbee/kvstore_writebehind.h>',
   '<ironbee/list.h>',
   '<ironbee/lock.h>',
   '<ironbee/log.h>',
@@ -147,6 +147,23 @@ ib_status_t ib_capture_acquire(
     if (rc != IB_OK) {
         return rc;
     }
+
+    return ib_capture_acquire_source(tx, source, field);
+}
+
+ib_status_t ib_capture_acquire_source(
+    const ib_tx_t    *tx,
+    ib_var_source_t  *source,
+    ib_field_t      **field
+)
+{
+    assert(tx != NULL);
+    assert(tx->var_store != NULL);
+    assert(source != NULL);
+    assert(field != NULL);
+
+    ib_status_t rc;
+
     rc = ib_var_source_get(source, field, tx->var_store);
     if (
         rc == IB_ENOENT ||
@@ -94,6 +94,13 @@ static ib_status_t cpbuf_append(ib_cfgparser_t *cp, char c)
         return IB_EALLOC;
     }
 
+    /* Every character of every token passes through here; only go through
+     * the vector to grow the buffer. */
+    if (cp->buffer->len < cp->buffer->size) {
+        ((char *)cp->buffer->data)[cp->buffer->len++] = c;
+        return IB_OK;
+    }
+
     return ib_vector_append(cp->buffer, &c, 1);
 }
 
@@ -546,12 +553,35 @@ static parse_directive_entry_t parse_directive_table[] = {
     { NULL, NULL } /* Null termination. Do not remove. */
 };
 
+ib_status_t ib_cfgparser_parse_directive_process(
+    ib_cfgparser_t      *cp,
+    ib_cfgparser_node_t *node
+) {
+    assert(cp != NULL);
+    assert(node != NULL);
+    assert(node->directive != NULL);
+
+    ib_mm_t temp_mm = ib_engine_mm_temp_get(cp->ib);
+
+    for (int i = 0; parse_directive_table[i].directive != NULL; ++i) {
+        if (
+            strcasecmp(
+                parse_directive_table[i].directive,
+                node->directive) == 0
+        ) {
+            return (parse_directive_table[i].fn)(cp, temp_mm, node);
+        }
+    }
+
+    return IB_ENOENT;
+}
+
 
-#line 805 "config-parser.rl"
+#line 831 "config-parser.rl"
 
 
 
-#line 555 "config-parser.c"
+#line 585 "config-parser.c"
 static const char _ironbee_config_actions[] = {
 	0, 1, 0, 1, 3, 1, 6, 1, 
 	10, 1, 12, 1, 13, 1, 14, 1, 
@@ -713,7 +743,7 @@ static const int ironbee_config_en_endblock = 36;
 static const int ironbee_config_en_main = 25;
 
 
-#line 808 "config-parser.rl"
+#line 834 "config-parser.rl"
 
 ib_status_t ib_cfgparser_ragel_init(ib_cfgparser_t *cp) {
     assert(cp != NULL);
@@ -724,10 +754,10 @@ ib_status_t ib_cfgparser_ragel_init(ib_cfgparser_t *cp) {
 
     /* Access all ragel state variables via structure. */
     
-#line 818 "config-parser.rl"
+#line 844 "config-parser.rl"
 
     
-#line 731 "config-parser.c"
+#line 761 "config-parser.c"
 	{
 	 cp->fsm.cs = ironbee_config_start;
 	 cp->fsm.top = 0;
@@ -736,7 +766,7 @@ ib_status_t ib_cfgparser_ragel_init(ib_cfgparser_t *cp) {
 	 cp->fsm.act = 0;
 	}
 
-#line 820 "config-parser.rl"
+#line 846 "config-parser.rl"
 
     rc = ib_list_create(&(cp->fsm.plist), ib_mm_mpool(cp->mp));
     if (rc != IB_OK) {
@@ -874,16 +904,16 @@ ib_status_t ib_cfgparser_ragel_parse_chunk(
 
     /* Access all ragel state variables via structure. */
     
-#line 957 "config-parser.rl"
+#line 983 "config-parser.rl"
     
-#line 958 "config-parser.rl"
+#line 984 "config-parser.rl"
     
-#line 959 "config-parser.rl"
+#line 985 "config-parser.rl"
     
-#line 960 "config-parser.rl"
+#line 986 "config-parser.rl"
 
     
-#line 887 "config-parser.c"
+#line 917 "config-parser.c"
 	{
 	int _klen;
 	unsigned int _trans;
@@ -904,7 +934,7 @@ _resume:
 #line 1 "NONE"
 	{ cp->fsm.ts = ( fsm_vars.p);}
 	break;
-#line 908 "config-parser.c"
+#line 938 "config-parser.c"
 		}
 	}
 
@@ -971,7 +1001,7 @@ _eof_trans:
 		switch ( *_acts++ )
 		{
 	case 0:
-#line 560 "config-parser.rl"
+#line 590 "config-parser.rl"
 	{
         rc = IB_EOTHER;
         ib_cfg_log_error(
@@ -983,7 +1013,7 @@ _eof_trans:
     }
 	break;
 	case 1:
-#line 571 "config-parser.rl"
+#line 601 "config-parser.rl"
 	{
         tmp_str = qstrdup(cp, config_mm);
         if (tmp_str == NULL) {
@@ -995,7 +1025,7 @@ _eof_trans:
     }
 	break;
 	case 2:
-#line 580 "config-parser.rl"
+#line 610 "config-parser.rl"
 	{
         tmp_str = qstrdup(cp, config_mm);
         if (tmp_str == NULL) {
@@ -1007,13 +1037,13 @@ _eof_trans:
     }
 	break;
 	case 3:
-#line 590 "config-parser.rl"
+#line 620 "config-parser.rl"
 	{
         cp->curr->line += 1;
     }
 	break;
 	case 4:
-#line 595 "config-parser.rl"
+#line 625 "config-parser.rl"
 	{
         if (cp->buffer->len == 0) {
             ib_cfg_log_error(cp, "Directive name is 0 length.");
@@ -1029,7 +1059,7 @@ _eof_trans:
     }
 	break;
 	case 5:
-#line 608 "config-parser.rl"
+#line 638 "config-parser.rl"
 	{
         ib_cfgparser_node_t *node = NULL;
         rc = ib_cfgparser_node_create(&node, cp);
@@ -1039,10 +1069,8 @@ _eof_trans:
         }
         node->directive = cp->fsm.directive;
         cp->fsm.directive = NULL;
-        node->file = ib_mm_strdup(cp->mm, cp->curr->file);
-        if (node->file == NULL) {
-            return IB_EALLOC;
-        }
+        /* Nodes and file names share cp->mm; no need for a copy each. */
+        node->file = cp->curr->file;
         node->parent = cp->curr;
         node->line = cp->curr->line;
         node->type = IB_CFGPARSER_NODE_DIRECTIVE;
@@ -1078,7 +1106,7 @@ _eof_trans:
     }
 	break;
 	case 6:
-#line 655 "config-parser.rl"
+#line 683 "config-parser.rl"
 	{
         if (cpbuf_append(cp, *( fsm_vars.p)) != IB_OK) {
             return IB_EALLOC;
@@ -1086,7 +1114,7 @@ _eof_trans:
     }
 	break;
 	case 7:
-#line 662 "config-parser.rl"
+#line 690 "config-parser.rl"
 	{
         if (cp->buffer->len == 0) {
             ib_cfg_log_error(cp, "Block name is 0 length.");
@@ -1102,7 +1130,7 @@ _eof_trans:
     }
 	break;
 	case 8:
-#line 675 "config-parser.rl"
+#line 703 "config-parser.rl"
 	{
         ib_cfgparser_node_t *node = NULL;
         rc = ib_cfgparser_node_create(&node, cp);
@@ -1112,10 +1140,8 @@ _eof_trans:
         }
         node->directive = cp->fsm.blkname;
         /* NOTE: We do not clear blkname now. */
-        node->file = ib_mm_strdup(cp->mm, cp->curr->file);
-        if (node->file == NULL) {
-            return IB_EALLOC;
-        }
+        /* Nodes and file names share cp->mm; no need for a copy each. */
+        node->file = cp->curr->file;
         node->line = cp->curr->line;
         node->type = IB_CFGPARSER_NODE_BLOCK;
         ib_list_node_t *lst_node;
@@ -1134,7 +1160,7 @@ _eof_trans:
     }
 	break;
 	case 9:
-#line 704 "config-parser.rl"
+#line 730 "config-parser.rl"
 	{
         ib_cfgparser_pop_node(cp);
         cpbuf_clear(cp);
@@ -1142,17 +1168,17 @@ _eof_trans:
     }
 	break;
 	case 10:
-#line 741 "config-parser.rl"
+#line 767 "config-parser.rl"
 	{ ( fsm_vars.p)--; { cp->fsm.cs =  cp->fsm.stack[-- cp->fsm.top]; {
     }goto _again;} }
 	break;
 	case 11:
-#line 742 "config-parser.rl"
+#line 768 "config-parser.rl"
 	{ ( fsm_vars.p)--; { cp->fsm.cs =  cp->fsm.stack[-- cp->fsm.top]; {
     }goto _again;} }
 	break;
 	case 12:
-#line 752 "config-parser.rl"
+#line 778 "config-parser.rl"
 	{ ( fsm_vars.p)--; { cp->fsm.cs =  cp->fsm.stack[-- cp->fsm.top]; {
     }goto _again;} }
 	break;
@@ -1161,63 +1187,63 @@ _eof_trans:
 	{ cp->fsm.te = ( fsm_vars.p)+1;}
 	break;
 	case 16:
-#line 730 "config-parser.rl"
+#line 756 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;}
 	break;
 	case 17:
-#line 734 "config-parser.rl"
+#line 760 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;{ cpbuf_clear(cp); }}
 	break;
 	case 18:
-#line 736 "config-parser.rl"
+#line 762 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;{ { cp->fsm.cs =  cp->fsm.stack[-- cp->fsm.top]; {
     }goto _again;} }}
 	break;
 	case 19:
-#line 742 "config-parser.rl"
+#line 768 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p);( fsm_vars.p)--;}
 	break;
 	case 20:
-#line 742 "config-parser.rl"
+#line 768 "config-parser.rl"
 	{{( fsm_vars.p) = (( cp->fsm.te))-1;}}
 	break;
 	case 21:
-#line 746 "config-parser.rl"
+#line 772 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;}
 	break;
 	case 22:
-#line 747 "config-parser.rl"
+#line 773 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;}
 	break;
 	case 23:
-#line 749 "config-parser.rl"
+#line 775 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;{ { cp->fsm.cs =  cp->fsm.stack[-- cp->fsm.top]; {
     }goto _again;} }}
 	break;
 	case 24:
-#line 752 "config-parser.rl"
+#line 778 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p);( fsm_vars.p)--;}
 	break;
 	case 25:
-#line 752 "config-parser.rl"
+#line 778 "config-parser.rl"
 	{{( fsm_vars.p) = (( cp->fsm.te))-1;}}
 	break;
 	case 26:
-#line 756 "config-parser.rl"
+#line 782 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;}
 	break;
 	case 27:
-#line 758 "config-parser.rl"
+#line 784 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;{ ( fsm_vars.p)--; { cp->fsm.cs =  cp->fsm.stack[-- cp->fsm.top]; {
     }goto _again;} }}
 	break;
 	case 28:
-#line 760 "config-parser.rl"
+#line 786 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;{ ( fsm_vars.p)--; { cp->fsm.cs =  cp->fsm.stack[-- cp->fsm.top]; {
     }goto _again;} }}
 	break;
 	case 29:
-#line 764 "config-parser.rl"
+#line 790 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p);( fsm_vars.p)--;{ {
         if (cp->fsm.top >= 1023) {
             ib_cfg_log_error(cp, "Recursion too deep during parse.");
@@ -1226,7 +1252,7 @@ _eof_trans:
     { cp->fsm.stack[ cp->fsm.top++] =  cp->fsm.cs;  cp->fsm.cs = 31; goto _again;}} }}
 	break;
 	case 30:
-#line 764 "config-parser.rl"
+#line 790 "config-parser.rl"
 	{{( fsm_vars.p) = (( cp->fsm.te))-1;}{ {
         if (cp->fsm.top >= 1023) {
             ib_cfg_log_error(cp, "Recursion too deep during parse.");
@@ -1235,32 +1261,32 @@ _eof_trans:
     { cp->fsm.stack[ cp->fsm.top++] =  cp->fsm.cs;  cp->fsm.cs = 31; goto _again;}} }}
 	break;
 	case 31:
-#line 768 "config-parser.rl"
+#line 794 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;}
 	break;
 	case 32:
-#line 770 "config-parser.rl"
+#line 796 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;}
 	break;
 	case 33:
-#line 772 "config-parser.rl"
+#line 798 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;}
 	break;
 	case 34:
-#line 778 "config-parser.rl"
+#line 804 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;{ { cp->fsm.cs =  cp->fsm.stack[-- cp->fsm.top]; {
     }goto _again;} }}
 	break;
 	case 35:
-#line 776 "config-parser.rl"
+#line 802 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p);( fsm_vars.p)--;}
 	break;
 	case 36:
-#line 776 "config-parser.rl"
+#line 802 "config-parser.rl"
 	{{( fsm_vars.p) = (( cp->fsm.te))-1;}}
 	break;
 	case 37:
-#line 790 "config-parser.rl"
+#line 816 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;{ ( fsm_vars.p)--; {
         if (cp->fsm.top >= 1023) {
             ib_cfg_log_error(cp, "Recursion too deep during parse.");
@@ -1269,7 +1295,7 @@ _eof_trans:
     { cp->fsm.stack[ cp->fsm.top++] =  cp->fsm.cs;  cp->fsm.cs = 34; goto _again;}}}}
 	break;
 	case 38:
-#line 791 "config-parser.rl"
+#line 817 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;{        {
         if (cp->fsm.top >= 1023) {
             ib_cfg_log_error(cp, "Recursion too deep during parse.");
@@ -1278,19 +1304,19 @@ _eof_trans:
     { cp->fsm.stack[ cp->fsm.top++] =  cp->fsm.cs;  cp->fsm.cs = 36; goto _again;}}}}
 	break;
 	case 39:
-#line 794 "config-parser.rl"
+#line 820 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;}
 	break;
 	case 40:
-#line 795 "config-parser.rl"
+#line 821 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;}
 	break;
 	case 41:
-#line 796 "config-parser.rl"
+#line 822 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;}
 	break;
 	case 42:
-#line 797 "config-parser.rl"
+#line 823 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p)+1;{
                 ib_cfg_log_error(
                     cp,
@@ -1300,11 +1326,11 @@ _eof_trans:
             }}
 	break;
 	case 43:
-#line 782 "config-parser.rl"
+#line 808 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p);( fsm_vars.p)--;}
 	break;
 	case 44:
-#line 787 "config-parser.rl"
+#line 813 "config-parser.rl"
 	{ cp->fsm.te = ( fsm_vars.p);( fsm_vars.p)--;{ {
         if (cp->fsm.top >= 1023) {
             ib_cfg_log_error(cp, "Recursion too deep during parse.");
@@ -1313,7 +1339,7 @@ _eof_trans:
     { cp->fsm.stack[ cp->fsm.top++] =  cp->fsm.cs;  cp->fsm.cs = 28; goto _again;}} }}
 	break;
 	case 45:
-#line 787 "config-parser.rl"
+#line 813 "config-parser.rl"
 	{{( fsm_vars.p) = (( cp->fsm.te))-1;}{ {
         if (cp->fsm.top >= 1023) {
             ib_cfg_log_error(cp, "Recursion too deep during parse.");
@@ -1321,7 +1347,7 @@ _eof_trans:
         }
     { cp->fsm.stack[ cp->fsm.top++] =  cp->fsm.cs;  cp->fsm.cs = 28; goto _again;}} }}
 	break;
-#line 1325 "config-parser.c"
+#line 1351 "config-parser.c"
 		}
 	}
 
@@ -1334,7 +1360,7 @@ _again:
 #line 1 "NONE"
 	{ cp->fsm.ts = 0;}
 	break;
-#line 1338 "config-parser.c"
+#line 1364 "config-parser.c"
 		}
 	}
 
@@ -1354,7 +1380,7 @@ _again:
 	while ( __nacts-- > 0 ) {
 		switch ( *__acts++ ) {
 	case 0:
-#line 560 "config-parser.rl"
+#line 590 "config-parser.rl"
 	{
         rc = IB_EOTHER;
         ib_cfg_log_error(
@@ -1366,7 +1392,7 @@ _again:
     }
 	break;
 	case 1:
-#line 571 "config-parser.rl"
+#line 601 "config-parser.rl"
 	{
         tmp_str = qstrdup(cp, config_mm);
         if (tmp_str == NULL) {
@@ -1378,7 +1404,7 @@ _again:
     }
 	break;
 	case 5:
-#line 608 "config-parser.rl"
+#line 638 "config-parser.rl"
 	{
         ib_cfgparser_node_t *node = NULL;
         rc = ib_cfgparser_node_create(&node, cp);
@@ -1388,10 +1414,8 @@ _again:
         }
         node->directive = cp->fsm.directive;
         cp->fsm.directive = NULL;
-        node->file = ib_mm_strdup(cp->mm, cp->curr->file);
-        if (node->file == NULL) {
-            return IB_EALLOC;
-        }
+        /* Nodes and file names share cp->mm; no need for a copy each. */
+        node->file = cp->curr->file;
         node->parent = cp->curr;
         node->line = cp->curr->line;
         node->type = IB_CFGPARSER_NODE_DIRECTIVE;
@@ -1427,21 +1451,21 @@ _again:
     }
 	break;
 	case 10:
-#line 741 "config-parser.rl"
+#line 767 "config-parser.rl"
 	{ ( fsm_vars.p)--; { cp->fsm.cs =  cp->fsm.stack[-- cp->fsm.top]; {
     }goto _again;} }
 	break;
 	case 11:
-#line 742 "config-parser.rl"
+#line 768 "config-parser.rl"
 	{ ( fsm_vars.p)--; { cp->fsm.cs =  cp->fsm.stack[-- cp->fsm.top]; {
     }goto _again;} }
 	break;
 	case 12:
-#line 752 "config-parser.rl"
+#line 778 "config-parser.rl"
 	{ ( fsm_vars.p)--; { cp->fsm.cs =  cp->fsm.stack[-- cp->fsm.top]; {
     }goto _again;} }
 	break;
-#line 1445 "config-parser.c"
+#line 1469 "config-parser.c"
 		}
 	}
 	}
@@ -1449,7 +1473,7 @@ _again:
 	_out: {}
 	}
 
-#line 962 "config-parser.rl"
+#line 988 "config-parser.rl"
 
     assert(tmp_str == NULL && "tmp_str must be cleared after every use");
 
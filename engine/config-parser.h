@@ -80,6 +80,24 @@ ib_status_t DLL_PUBLIC ib_cfgparser_ragel_parse_chunk(
  */
 ib_status_t DLL_PUBLIC ib_cfgparser_ragel_init(ib_cfgparser_t *cp);
 
+/**
+ * Run the parse directive handler (e.g., Include) for a node.
+ *
+ * This is what the parser does when it reaches a parse directive. It is
+ * used to replay parse directives from a configuration snapshot.
+ *
+ * @param[in] cp Configuration parser.
+ * @param[in] node The parse directive node.
+ *
+ * @returns
+ * - IB_ENOENT if @c node->directive is not a parse directive.
+ * - The result of the parse directive handler otherwise.
+ */
+ib_status_t DLL_PUBLIC ib_cfgparser_parse_directive_process(
+    ib_cfgparser_t      *cp,
+    ib_cfgparser_node_t *node
+);
+
 /**
  * @} IronBeeConfigParser
  */
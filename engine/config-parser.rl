@@ -92,6 +92,13 @@ static ib_status_t cpbuf_append(ib_cfgparser_t *cp, char c)
         return IB_EALLOC;
     }
 
+    /* Every character of every token passes through here; only go through
+     * the vector to grow the buffer. */
+    if (cp->buffer->len < cp->buffer->size) {
+        ((char *)cp->buffer->data)[cp->buffer->len++] = c;
+        return IB_OK;
+    }
+
     return ib_vector_append(cp->buffer, &c, 1);
 }
 
@@ -544,6 +551,29 @@ static parse_directive_entry_t parse_directive_table[] = {
     { NULL, NULL } /* Null termination. Do not remove. */
 };
 
+ib_status_t ib_cfgparser_parse_directive_process(
+    ib_cfgparser_t      *cp,
+    ib_cfgparser_node_t *node
+) {
+    assert(cp != NULL);
+    assert(node != NULL);
+    assert(node->directive != NULL);
+
+    ib_mm_t temp_mm = ib_engine_mm_temp_get(cp->ib);
+
+    for (int i = 0; parse_directive_table[i].directive != NULL; ++i) {
+        if (
+            strcasecmp(
+                parse_directive_table[i].directive,
+                node->directive) == 0
+        ) {
+            return (parse_directive_table[i].fn)(cp, temp_mm, node);
+        }
+    }
+
+    return IB_ENOENT;
+}
+
 %%{
     machine ironbee_config;
 
@@ -614,10 +644,8 @@ static parse_directive_entry_t parse_directive_table[] = {
         }
         node->directive = cp->fsm.directive;
         cp->fsm.directive = NULL;
-        node->file = ib_mm_strdup(cp->mm, cp->curr->file);
-        if (node->file == NULL) {
-            return IB_EALLOC;
-        }
+        /* Nodes and file names share cp->mm; no need for a copy each. */
+        node->file = cp->curr->file;
         node->parent = cp->curr;
         node->line = cp->curr->line;
         node->type = IB_CFGPARSER_NODE_DIRECTIVE;
@@ -681,10 +709,8 @@ static parse_directive_entry_t parse_directive_table[] = {
         }
         node->directive = cp->fsm.blkname;
         /* NOTE: We do not clear blkname now. */
-        node->file = ib_mm_strdup(cp->mm, cp->curr->file);
-        if (node->file == NULL) {
-            return IB_EALLOC;
-        }
+        /* Nodes and file names share cp->mm; no need for a copy each. */
+        node->file = cp->curr->file;
         node->line = cp->curr->line;
         node->type = IB_CFGPARSER_NODE_BLOCK;
         ib_list_node_t *lst_node;
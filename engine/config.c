@@ -30,6 +30,7 @@
 #include "config-parser.h"
 #include "engine_private.h"
 
+#include <ironbee/artifact.h>
 #include <ironbee/context.h>
 #include <ironbee/flags.h>
 #include <ironbee/mm_mpool.h>
@@ -47,6 +48,7 @@
 #endif
 #include <inttypes.h>
 #include <libgen.h>
+#include <sys/stat.h>
 
 /* -- Internal -- */
 
@@ -205,6 +207,384 @@ ib_status_t ib_cfgparser_push_node(ib_cfgparser_t *cp,
     return rc;
 }
 
+/* -- Configuration snapshots -- */
+
+/** Artifact kind of configuration snapshots. */
+static const char *c_snapshot_kind = "cfgparser_snapshot";
+
+typedef struct cfgparser_snapshot_node_t cfgparser_snapshot_node_t;
+
+/**
+ * A parse node of a configuration snapshot.
+ */
+struct cfgparser_snapshot_node_t {
+    ib_cfgparser_node_type_t   type;           /**< Node type. */
+    const char                *directive;      /**< Directive. */
+    const char               **params;         /**< Parameters. */
+    size_t                     params_count;   /**< Number of parameters. */
+    size_t                     line;           /**< Line number. */
+    cfgparser_snapshot_node_t *children;       /**< Child nodes. */
+    size_t                     children_count; /**< Number of children. */
+};
+
+/**
+ * Configuration snapshot of a single file.
+ *
+ * A snapshot is the parse tree of a file that parsed without errors.  When
+ * an engine parses the same, unchanged, file again (typically on a reload
+ * while the previous engine is still alive) the tree is rebuilt from the
+ * snapshot instead of parsing the file.
+ *
+ * Parse directives are kept but the files they include are not: they are
+ * run again on replay, so included files are looked up and checked for
+ * changes independently.
+ */
+typedef struct {
+    ib_mpool_lite_t           *mp;   /**< Memory pool of the snapshot. */
+    cfgparser_snapshot_node_t  file; /**< File node. */
+} cfgparser_snapshot_t;
+
+/**
+ * Is the parser state machine between directives?
+ *
+ * Snapshots are only taken and replayed when a file starts and ends with
+ * the state machine idle, so that the file parses the same
+ * regardless of what was parsed before it.
+ *
+ * @param[in] cp Configuration parser.
+ *
+ * @returns true if no directive or block is partially parsed.
+ */
+static bool cfgparser_fsm_idle(const ib_cfgparser_t *cp)
+{
+    return
+        (cp->fsm.top == 0) &&
+        (cp->fsm.ts == NULL) &&
+        (cp->fsm.directive == NULL) &&
+        (cp->fsm.blkname == NULL);
+}
+
+/**
+ * Build the snapshot key of an open file.
+ *
+ * The key is the path together with the identity, size and modification
+ * time of the file, so that a changed file never matches.
+ *
+ * @param[in] mm Memory manager to allocate the key from.
+ * @param[in] file Path of the file.
+ * @param[in] fd Open file descriptor of @a file.
+ * @param[out] key The key.
+ * @param[out] key_length Length of @a key.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EINVAL if @a fd can not be stat'ed.
+ * - IB_EALLOC on allocation errors.
+ */
+static ib_status_t cfgparser_snapshot_key(
+    ib_mm_t      mm,
+    const char  *file,
+    int          fd,
+    char       **key,
+    size_t      *key_length
+)
+{
+    assert(file != NULL);
+    assert(key != NULL);
+    assert(key_length != NULL);
+
+    struct stat sb;
+    int         length;
+    char       *buf;
+
+    if (fstat(fd, &sb) != 0) {
+        return IB_EINVAL;
+    }
+
+    length = snprintf(NULL, 0, "%s:%ju:%ju:%jd:%jd",
+                      file,
+                      (uintmax_t)sb.st_dev,
+                      (uintmax_t)sb.st_ino,
+                      (intmax_t)sb.st_size,
+                      (intmax_t)sb.st_mtime);
+    if (length < 0) {
+        return IB_EINVAL;
+    }
+    buf = ib_mm_alloc(mm, length + 1);
+    if (buf == NULL) {
+        return IB_EALLOC;
+    }
+    snprintf(buf, length + 1, "%s:%ju:%ju:%jd:%jd",
+             file,
+             (uintmax_t)sb.st_dev,
+             (uintmax_t)sb.st_ino,
+             (intmax_t)sb.st_size,
+             (intmax_t)sb.st_mtime);
+
+    *key = buf;
+    *key_length = length;
+
+    return IB_OK;
+}
+
+/**
+ * Copy a parse node, and its children, into a snapshot node.
+ *
+ * @param[in] mm Memory manager of the snapshot.
+ * @param[out] snode The snapshot node.
+ * @param[in] node The parse node.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation errors.
+ */
+static ib_status_t cfgparser_snapshot_node_copy(
+    ib_mm_t                    mm,
+    cfgparser_snapshot_node_t *snode,
+    const ib_cfgparser_node_t *node
+)
+{
+    assert(snode != NULL);
+    assert(node != NULL);
+
+    const ib_list_node_t *list_node;
+    ib_status_t           rc;
+    size_t                i;
+
+    snode->type = node->type;
+    snode->line = node->line;
+    snode->directive = ib_mm_strdup(mm, node->directive);
+    if (snode->directive == NULL) {
+        return IB_EALLOC;
+    }
+
+    snode->params_count = ib_list_elements(node->params);
+    snode->params = ib_mm_alloc(
+        mm, (snode->params_count + 1) * sizeof(*snode->params));
+    if (snode->params == NULL) {
+        return IB_EALLOC;
+    }
+    i = 0;
+    IB_LIST_LOOP_CONST(node->params, list_node) {
+        snode->params[i] =
+            ib_mm_strdup(mm, (const char *)ib_list_node_data_const(list_node));
+        if (snode->params[i] == NULL) {
+            return IB_EALLOC;
+        }
+        ++i;
+    }
+
+    /* The files included by parse directives are not part of the
+     * snapshot; they are included again on replay. */
+    if (node->type == IB_CFGPARSER_NODE_PARSE_DIRECTIVE) {
+        snode->children = NULL;
+        snode->children_count = 0;
+        return IB_OK;
+    }
+
+    snode->children_count = ib_list_elements(node->children);
+    snode->children = ib_mm_calloc(
+        mm, snode->children_count + 1, sizeof(*snode->children));
+    if (snode->children == NULL) {
+        return IB_EALLOC;
+    }
+    i = 0;
+    IB_LIST_LOOP_CONST(node->children, list_node) {
+        rc = cfgparser_snapshot_node_copy(
+            mm,
+            &(snode->children[i]),
+            (const ib_cfgparser_node_t *)ib_list_node_data_const(list_node));
+        if (rc != IB_OK) {
+            return rc;
+        }
+        ++i;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Destroy a configuration snapshot.
+ *
+ * @param[in] artifact The snapshot (cfgparser_snapshot_t).
+ */
+static void cfgparser_snapshot_destroy(void *artifact)
+{
+    assert(artifact != NULL);
+
+    cfgparser_snapshot_t *snapshot = (cfgparser_snapshot_t *)artifact;
+
+    ib_mpool_lite_destroy(snapshot->mp);
+}
+
+/**
+ * Take a snapshot of a parsed file.
+ *
+ * @param[out] psnapshot The snapshot.
+ * @param[in] node The file node.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation errors.
+ */
+static ib_status_t cfgparser_snapshot_create(
+    cfgparser_snapshot_t      **psnapshot,
+    const ib_cfgparser_node_t  *node
+)
+{
+    assert(psnapshot != NULL);
+    assert(node != NULL);
+    assert(node->type == IB_CFGPARSER_NODE_FILE);
+
+    ib_mpool_lite_t      *mp;
+    ib_mm_t               mm;
+    cfgparser_snapshot_t *snapshot;
+    ib_status_t           rc;
+
+    rc = ib_mpool_lite_create(&mp);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    mm = ib_mm_mpool_lite(mp);
+
+    snapshot = ib_mm_alloc(mm, sizeof(*snapshot));
+    if (snapshot == NULL) {
+        ib_mpool_lite_destroy(mp);
+        return IB_EALLOC;
+    }
+    snapshot->mp = mp;
+
+    rc = cfgparser_snapshot_node_copy(mm, &(snapshot->file), node);
+    if (rc != IB_OK) {
+        ib_mpool_lite_destroy(mp);
+        return rc;
+    }
+
+    *psnapshot = snapshot;
+
+    return IB_OK;
+}
+
+/**
+ * Artifact creation callback for snapshots.
+ *
+ * Snapshots are looked up before a file is parsed and stored after a
+ * successful parse, so this only stores a snapshot that already exists.
+ *
+ * @param[out] artifact The snapshot.
+ * @param[in] cbdata Snapshot to store (cfgparser_snapshot_t) or NULL
+ *                   for a lookup.
+ *
+ * @returns
+ * - IB_OK if @a cbdata was stored.
+ * - IB_ENOENT on a lookup.
+ */
+static ib_status_t cfgparser_snapshot_artifact_create(
+    void **artifact,
+    void  *cbdata
+)
+{
+    assert(artifact != NULL);
+
+    if (cbdata == NULL) {
+        return IB_ENOENT;
+    }
+
+    *artifact = cbdata;
+
+    return IB_OK;
+}
+
+/**
+ * Rebuild the children of a parse node from a snapshot node.
+ *
+ * Parse directives are run as they would be by the parser.
+ *
+ * @param[in] cp Configuration parser.
+ * @param[in] node The parse node to add the children to.
+ * @param[in] snode The snapshot node.
+ * @param[in,out] error_count Incremented for each failed parse directive.
+ *
+ * @returns
+ * - IB_OK on success, even if parse directives failed.
+ * - IB_EALLOC on allocation errors.
+ */
+static ib_status_t cfgparser_snapshot_replay(
+    ib_cfgparser_t                  *cp,
+    ib_cfgparser_node_t             *node,
+    const cfgparser_snapshot_node_t *snode,
+    unsigned                        *error_count
+)
+{
+    assert(cp != NULL);
+    assert(node != NULL);
+    assert(snode != NULL);
+    assert(error_count != NULL);
+
+    ib_mm_t     config_mm = ib_engine_mm_config_get(cp->ib);
+    ib_status_t rc;
+
+    node->line = snode->line;
+
+    for (size_t i = 0; i < snode->children_count; ++i) {
+        const cfgparser_snapshot_node_t *schild = &(snode->children[i]);
+        ib_cfgparser_node_t             *child;
+
+        rc = ib_cfgparser_node_create(&child, cp);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        child->type = schild->type;
+        child->parent = node;
+        child->file = node->file;
+        child->line = schild->line;
+        child->directive = ib_mm_strdup(cp->mm, schild->directive);
+        if (child->directive == NULL) {
+            return IB_EALLOC;
+        }
+        for (size_t j = 0; j < schild->params_count; ++j) {
+            char *param = ib_mm_strdup(config_mm, schild->params[j]);
+            if (param == NULL) {
+                return IB_EALLOC;
+            }
+            rc = ib_list_push(child->params, param);
+            if (rc != IB_OK) {
+                return rc;
+            }
+        }
+        rc = ib_list_push(node->children, child);
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+        switch (child->type) {
+            case IB_CFGPARSER_NODE_PARSE_DIRECTIVE:
+                cp->curr = node;
+                rc = ib_cfgparser_parse_directive_process(cp, child);
+                if (rc != IB_OK) {
+                    ib_cfg_log_error(
+                        cp,
+                        "Parse directive %s failed.",
+                        child->directive);
+                    ++(*error_count);
+                }
+                break;
+            case IB_CFGPARSER_NODE_BLOCK:
+                rc = cfgparser_snapshot_replay(cp, child, schild, error_count);
+                if (rc != IB_OK) {
+                    return rc;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    cp->curr = node;
+
+    return IB_OK;
+}
+
 /// @todo Create a ib_cfgparser_parse_ex that can parse non-files (DBs, etc)
 
 
@@ -218,13 +598,16 @@ ib_status_t ib_cfgparser_parse_private(
 
     int ec             = 0;    /* Error code for sys calls. */
     int fd             = 0;    /* File to read. */
-    const size_t bufsz = 8192; /* Buffer size. */
+    const size_t bufsz = 65536; /* Buffer size. */
     size_t buflen      = 0;    /* Last char in buffer. */
     char *buf          = NULL; /* Buffer. */
     char *pathbuf;
     const char *save_cwd;      /* CWD, used to restore during cleanup  */
     ib_cfgparser_node_t *node; /* Parser node for this file. */
     ib_cfgparser_node_t *save_node = NULL; /* Previous current node. */
+    char *key = NULL;          /* Snapshot key of the file. */
+    size_t key_length = 0;     /* Length of key. */
+    cfgparser_snapshot_t *snapshot;
 
     ib_status_t rc = IB_OK;
     unsigned error_count = 0;
@@ -286,6 +669,35 @@ ib_status_t ib_cfgparser_parse_private(
     }
     cp->cur_cwd = dirname(pathbuf);
 
+    /* Rebuild the tree of an unchanged file from its snapshot. */
+    if (cfgparser_fsm_idle(cp)) {
+        rc = cfgparser_snapshot_key(local_mm, file, fd, &key, &key_length);
+        if (rc != IB_OK) {
+            key = NULL;
+        }
+    }
+    if (key != NULL) {
+        rc = ib_artifact_acquire(
+            (void **)&snapshot,
+            ib_engine_mm_main_get(cp->ib),
+            c_snapshot_kind,
+            key,
+            key_length,
+            cfgparser_snapshot_artifact_create,
+            NULL,
+            cfgparser_snapshot_destroy);
+        if (rc == IB_OK) {
+            ib_cfg_log_debug(cp, "Using snapshot of config file \"%s\"", file);
+            rc = cfgparser_snapshot_replay(
+                cp, node, &(snapshot->file), &error_count);
+            if (rc == IB_OK && error_count > 0) {
+                error_rc = IB_EOTHER;
+            }
+            goto cleanup;
+        }
+        rc = IB_OK;
+    }
+
     /* Fill the buffer, parse each line. Conditionally read another line. */
     do {
         buflen = read(fd, buf, bufsz);
@@ -318,6 +730,29 @@ ib_status_t ib_cfgparser_parse_private(
         }
     } while (buflen > 0);
 
+    /* Store a snapshot of a file that parsed cleanly. */
+    if (key != NULL &&
+        error_count == 0 &&
+        cp->curr == node &&
+        cfgparser_fsm_idle(cp) &&
+        cfgparser_snapshot_create(&snapshot, node) == IB_OK)
+    {
+        cfgparser_snapshot_t *stored = NULL;
+        ib_status_t           snapshot_rc;
+
+        snapshot_rc = ib_artifact_acquire(
+            (void **)&stored,
+            ib_engine_mm_main_get(cp->ib),
+            c_snapshot_kind,
+            key,
+            key_length,
+            cfgparser_snapshot_artifact_create,
+            snapshot,
+            cfgparser_snapshot_destroy);
+        if (snapshot_rc != IB_OK || stored != snapshot) {
+            cfgparser_snapshot_destroy(snapshot);
+        }
+    }
 
 cleanup:
 
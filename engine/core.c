@@ -212,6 +212,20 @@ static const char * const ib_uuid_default_str = "00000000-0000-0000-0000-0000000
 #define IB_PEOPT_ALL \
     ( IB_PEOPT_BLOCKING_MODE )
 
+/**
+ * Body inspection limit for a media type.
+ *
+ * Element of ib_core_cfg_t::request_body_inspect_limits and
+ * ib_core_cfg_t::response_body_inspect_limits.
+ */
+typedef struct {
+    const char *pattern;   /**< Directive argument, e.g., `text/html`. */
+    const char *type;      /**< Media type, or prefix if @a is_prefix. */
+    size_t      type_len;  /**< Length of @a type. */
+    bool        is_prefix; /**< Is @a type a prefix, e.g., `image/`? */
+    ssize_t     limit;     /**< Limit in bytes; < 0 for no limit. */
+} core_body_inspect_limit_t;
+
 /* -- Utilities -- */
 
 /**
@@ -314,9 +328,48 @@ static void core_logger_element(void *element, void *cbdata)
     fflush(cfg->log_fp);
 }
 
+/**
+ * Write a log record without flushing; used by the asynchronous writer.
+ *
+ * @param[in] element The @ref ib_logger_standard_msg_t.
+ * @param[in] cbdata The @ref ib_core_cfg_t.
+ */
+static void core_logger_element_batched(void *element, void *cbdata)
+{
+    assert(element != NULL);
+    assert(cbdata  != NULL);
+
+    ib_logger_standard_msg_t *msg = (ib_logger_standard_msg_t *)element;
+    ib_core_cfg_t            *cfg = (ib_core_cfg_t *)cbdata;
+
+    fprintf(
+        cfg->log_fp,
+        "%s %.*s\n",
+        msg->prefix,
+        (int)msg->msg_sz,
+        (char *)msg->msg);
+}
+
+/**
+ * Flush the log file after a batch of records.
+ *
+ * @param[in] cbdata The @ref ib_core_cfg_t.
+ */
+static void core_logger_flush(void *cbdata)
+{
+    assert(cbdata != NULL);
+
+    ib_core_cfg_t *cfg = (ib_core_cfg_t *)cbdata;
+
+    fflush(cfg->log_fp);
+}
+
 /**
  * Logger callback that writes log records to core's file descriptor.
  *
+ * With LogAsync enabled, the records are written by the asynchronous writer
+ * thread instead.
+ *
  * @param[in] logger The logger.
  * @param[in] writer The writer with the queued log messages.
  * @param[in] cbdata Callback data. The @ref ib_core_cfg_t.
@@ -327,6 +380,12 @@ static ib_status_t core_logger_record(
     void               *cbdata
 )
 {
+    ib_core_cfg_t *cfg = (ib_core_cfg_t *)cbdata;
+
+    if (cfg->log_async != NULL) {
+        return ib_logger_async_record(logger, writer, cfg->log_async);
+    }
+
     return ib_logger_dequeue(logger, writer, core_logger_element, cbdata);
 }
 
@@ -392,6 +451,14 @@ static void core_log_file_close(ib_engine_t *ib,
     assert(ib != NULL);
     assert(config != NULL);
 
+    ib_core_cfg_t *gcfg = (ib_core_cfg_t *)ib_core_module(ib)->gcdata;
+
+    /* Write out queued records before the file goes away. */
+    if (gcfg->log_async != NULL) {
+        ib_logger_async_stop(gcfg->log_async);
+        gcfg->log_async = NULL;
+    }
+
     if (config->log_fp == NULL) {
         config->log_fp = stderr;
     }
@@ -444,26 +511,15 @@ static ib_status_t audit_write_log(ib_engine_t *ib, ib_auditlog_t *log)
     /* Open the log if required. This is thread safe. */
     rc = core_audit_open(ib, log);
     if (rc != IB_OK) {
-        if (log->ctx->auditlog->index != NULL) {
-            ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
-        }
         return rc;
     }
 
-    /* Lock to write. */
-    if (log->ctx->auditlog->index != NULL) {
-        rc = ib_lock_lock(log->ctx->auditlog->index_fp_lock);
-        if (rc != IB_OK) {
-            ib_log_error(ib, "Failed to lock \"%s\" for write.",
-                         log->ctx->auditlog->index);
-            return rc;
-        }
-    }
-
-    /* Write the header if required. */
+    /* The audit log file belongs to this transaction, so it is written
+     * without a lock; only the index file is shared.
+     *
+     * Write the header if required. */
     rc = core_audit_write_header(ib, log);
     if (rc != IB_OK) {
-        ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
         return rc;
     }
 
@@ -481,17 +537,9 @@ static ib_status_t audit_write_log(ib_engine_t *ib, ib_auditlog_t *log)
     /* Write the footer if required. */
     rc = core_audit_write_footer(ib, log);
     if (rc != IB_OK) {
-        if (log->ctx->auditlog->index != NULL) {
-            ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
-        }
         return rc;
     }
 
-    /* Writing is done. Unlock. Close is thread-safe. */
-    if (log->ctx->auditlog->index != NULL) {
-        ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
-    }
-
     /* Close the audit log and write to the index file. */
     rc = core_audit_close(ib, log);
     if (rc != IB_OK) {
@@ -926,6 +974,20 @@ static size_t ib_auditlog_gen_json_events(ib_auditlog_part_t *part,
             goto failure;
         }
 
+        /* Count. */
+        yajl_status =
+            yajl_gen_string(yajl_handle, (unsigned char *)"count", 5);
+        if (yajl_status != yajl_gen_status_ok) {
+            ib_log_error_tx(tx, "Failed to add count.");
+            goto failure;
+        }
+
+        yajl_status = yajl_gen_integer(yajl_handle, e->count);
+        if (yajl_status != yajl_gen_status_ok) {
+            ib_log_error_tx(tx, "Failed to add count.");
+            goto failure;
+        }
+
         /* Tag List. */
         yajl_status =
             yajl_gen_string(yajl_handle, (unsigned char *)"tags", 4);
@@ -1998,6 +2060,128 @@ static ib_status_t core_initvar(ib_engine_t *ib,
     return rc;
 }
 
+/**
+ * Find the body inspection limit for the content type in @a headers.
+ *
+ * An exact media type is preferred to a type prefix, e.g., `image/` followed
+ * by `*`, which is preferred to `*`.  Media type parameters are ignored.
+ *
+ * @param[in] limits List of core_body_inspect_limit_t; may be NULL.
+ * @param[in] headers Request or response headers; may be NULL.
+ *
+ * @returns The limit, or -1 for no limit.
+ */
+static ssize_t core_body_inspect_limit(
+    const ib_list_t           *limits,
+    const ib_parsed_headers_t *headers
+)
+{
+    const ib_list_node_t            *node;
+    const ib_parsed_header_t        *header;
+    const core_body_inspect_limit_t *best = NULL;
+    const char                      *type = "";
+    size_t                           type_len = 0;
+
+    if (limits == NULL) {
+        return -1;
+    }
+
+    if (headers != NULL) {
+        for (header = headers->head; header != NULL; header = header->next) {
+            if (
+                ib_bytestr_length(header->name) ==
+                    sizeof("Content-Type") - 1 &&
+                strncasecmp(
+                    (const char *)ib_bytestr_const_ptr(header->name),
+                    "Content-Type",
+                    sizeof("Content-Type") - 1) == 0
+            )
+            {
+                type = (const char *)ib_bytestr_const_ptr(header->value);
+                type_len = ib_bytestr_length(header->value);
+                break;
+            }
+        }
+    }
+
+    /* Strip leading white space and any parameters. */
+    while (type_len > 0 && isspace((unsigned char)*type)) {
+        ++type;
+        --type_len;
+    }
+    for (size_t i = 0; i < type_len; ++i) {
+        if (type[i] == ';' || isspace((unsigned char)type[i])) {
+            type_len = i;
+            break;
+        }
+    }
+
+    IB_LIST_LOOP_CONST(limits, node) {
+        const core_body_inspect_limit_t *entry = ib_list_node_data_const(node);
+
+        if (entry->is_prefix) {
+            if (
+                type_len < entry->type_len ||
+                strncasecmp(type, entry->type, entry->type_len) != 0
+            ) {
+                continue;
+            }
+            if (
+                best == NULL ||
+                (best->is_prefix && best->type_len < entry->type_len)
+            ) {
+                best = entry;
+            }
+        }
+        else if (
+            type_len == entry->type_len &&
+            strncasecmp(type, entry->type, type_len) == 0
+        ) {
+            best = entry;
+            break;
+        }
+    }
+
+    return (best == NULL) ? -1 : best->limit;
+}
+
+/**
+ * Set the response body inspection limit of a transaction.
+ *
+ * @param ib Engine.
+ * @param tx Transaction.
+ * @param state State.
+ * @param cbdata Callback data.
+ *
+ * @returns Status code.
+ */
+static ib_status_t core_hook_response_header(ib_engine_t *ib,
+                                             ib_tx_t *tx,
+                                             ib_state_t state,
+                                             void *cbdata)
+{
+    assert(state == response_header_finished_state);
+
+    ib_core_cfg_t *corecfg;
+    ib_status_t rc;
+
+    rc = ib_core_context_config(tx->ctx, &corecfg);
+    if (rc != IB_OK) {
+        ib_log_alert_tx(tx,
+                        "Error accessing core module: %s",
+                        ib_status_to_string(rc));
+        return rc;
+    }
+
+    if (corecfg->response_body_inspect_limits != NULL) {
+        tx->limits.response_body_inspect_limit = core_body_inspect_limit(
+            corecfg->response_body_inspect_limits,
+            tx->response_header);
+    }
+
+    return IB_OK;
+}
+
 /**
  * Handle the transaction context selected
  *
@@ -2033,6 +2217,12 @@ static ib_status_t core_hook_context_tx(ib_engine_t *ib,
 
     /* Copy the configuration limits into the tx. */
     memcpy(&(tx->limits), &(corecfg->limits), sizeof(corecfg->limits));
+    ib_mpool_limit_set(
+        tx->mp,
+        (tx->limits.tx_memory_limit > 0) ? tx->limits.tx_memory_limit : 0);
+    tx->limits.request_body_inspect_limit = core_body_inspect_limit(
+        corecfg->request_body_inspect_limits,
+        tx->request_header);
 
     /* Copy config to transaction for potential runtime changes. */
     core_txdata =
@@ -2906,6 +3096,115 @@ static ib_status_t core_dir_site_list(ib_cfgparser_t *cp,
     return IB_EINVAL;
 }
 
+/**
+ * Handle on/off directives.
+ *
+ * @param cp Config parser
+ * @param name Directive name
+ * @param onoff On/off flag
+ * @param cbdata Callback data (from directive registration)
+ *
+ * @returns Status code
+ */
+static ib_status_t core_dir_onoff(ib_cfgparser_t *cp,
+                                  const char *name,
+                                  int onoff,
+                                  void *cbdata)
+{
+    assert(cp != NULL);
+    assert(cp->ib != NULL);
+    assert(name != NULL);
+
+    ib_context_t *ctx = cp->cur_ctx ? cp->cur_ctx : ib_context_main(cp->ib);
+
+    if (strcasecmp("RuleEngineProfile", name) == 0) {
+        return ib_context_set_num(ctx, "rule_profile", onoff ? 1 : 0);
+    }
+    else if (strcasecmp("RuleEngineCompare", name) == 0) {
+        return ib_context_set_num(ctx, "rule_compare", onoff ? 1 : 0);
+    }
+    else if (strcasecmp("RuleEngineLazyContexts", name) == 0) {
+        return ib_context_set_num(ctx, "rule_lazy_contexts", onoff ? 1 : 0);
+    }
+    else if (strcasecmp("AuditLogCompress", name) == 0) {
+#if defined(HAVE_LIBZ) && defined(HAVE_OPEN_MEMSTREAM)
+        return ib_context_set_num(ctx, "auditlog_compress", onoff ? 1 : 0);
+#else
+        ib_cfg_log_warning(cp,
+                           "Audit log compression is not supported on this "
+                           "platform; ignoring %s.",
+                           name);
+        return IB_OK;
+#endif
+    }
+    else if (strcasecmp("AuditLogAsync", name) == 0) {
+        /* The writer is engine wide and kept in the core module data. */
+        ib_core_module_data_t *core_data;
+        ib_status_t            rc;
+
+        rc = ib_core_module_data(cp->ib, NULL, &core_data);
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+        if (onoff && core_data->audit_writer == NULL) {
+            rc = core_audit_writer_create(
+                &(core_data->audit_writer),
+                cp->ib,
+                ib_engine_mm_main_get(cp->ib));
+            if (rc == IB_ENOTIMPL) {
+                ib_cfg_log_warning(cp,
+                                   "Asynchronous audit log writing is not "
+                                   "supported on this platform; ignoring %s.",
+                                   name);
+                return IB_OK;
+            }
+            if (rc != IB_OK) {
+                ib_cfg_log_error(cp, "Failed to start asynchronous audit log writer: %s",
+                                 ib_status_to_string(rc));
+            }
+            return rc;
+        }
+        else if (! onoff && core_data->audit_writer != NULL) {
+            core_audit_writer_t *writer = core_data->audit_writer;
+
+            core_data->audit_writer = NULL;
+            core_audit_writer_stop(writer);
+        }
+        return IB_OK;
+    }
+    else if (strcasecmp("LogAsync", name) == 0) {
+        /* The core logger is engine wide and uses the global config. */
+        ib_core_cfg_t *gcfg =
+            (ib_core_cfg_t *)ib_core_module(cp->ib)->gcdata;
+        ib_status_t    rc;
+
+        if (onoff && gcfg->log_async == NULL) {
+            rc = ib_logger_async_create(
+                &(gcfg->log_async),
+                ib_engine_logger_get(cp->ib),
+                core_logger_element_batched,
+                core_logger_flush,
+                gcfg);
+            if (rc != IB_OK) {
+                ib_cfg_log_error(cp, "Failed to start asynchronous log writer: %s",
+                                 ib_status_to_string(rc));
+            }
+            return rc;
+        }
+        else if (! onoff && gcfg->log_async != NULL) {
+            ib_logger_async_t *async = gcfg->log_async;
+
+            gcfg->log_async = NULL;
+            ib_logger_async_stop(async);
+        }
+        return IB_OK;
+    }
+
+    ib_cfg_log_error(cp, "Unhandled directive: %s", name);
+    return IB_EINVAL;
+}
+
 /**
  * Handle single parameter directives.
  *
@@ -2993,6 +3292,86 @@ static ib_status_t core_dir_param1(ib_cfgparser_t *cp,
                      p1_unescaped);
         return IB_EINVAL;
     }
+    else if (strcasecmp("RuleEngineOrdering", name) == 0) {
+        if (strcasecmp("Config", p1_unescaped) == 0) {
+            rc = ib_context_set_num(
+                ctx,
+                "rule_ordering",
+                IB_RULE_ORDERING_CONFIG);
+            return rc;
+        }
+        else if (strcasecmp("Adaptive", p1_unescaped) == 0) {
+            rc = ib_context_set_num(
+                ctx,
+                "rule_ordering",
+                IB_RULE_ORDERING_ADAPTIVE);
+            return rc;
+        }
+
+        ib_log_error(ib,
+                     "Failed to parse directive: %s \"%s\"",
+                     name,
+                     p1_unescaped);
+        return IB_EINVAL;
+    }
+    else if (strcasecmp("LogEventLimit", name) == 0) {
+        ib_num_t limit;
+        rc = ib_type_atoi(p1_unescaped, 10, &limit);
+        if ( (rc != IB_OK) || (limit < 0) ) {
+            ib_log_error(ib,
+                         "Invalid limit: %s \"%s\"",
+                         name,
+                         p1_unescaped);
+            return IB_EINVAL;
+        }
+        rc = ib_context_set_num(ctx, "logevent_limit", limit);
+        return rc;
+    }
+    else if (strcasecmp("RuleEngineStreamCoalesce", name) == 0) {
+        ib_num_t size;
+        rc = ib_type_atoi(p1_unescaped, 10, &size);
+        if ( (rc != IB_OK) || (size < 0) ) {
+            ib_log_error(ib,
+                         "Invalid size: %s \"%s\"",
+                         name,
+                         p1_unescaped);
+            return IB_EINVAL;
+        }
+        rc = ib_context_set_num(ctx, "rule_stream_coalesce", size);
+        return rc;
+    }
+    else if (strcasecmp("RuleEngineStreamOverlap", name) == 0) {
+        ib_num_t size;
+        rc = ib_type_atoi(p1_unescaped, 10, &size);
+        if ( (rc != IB_OK) || (size < 0) ) {
+            ib_log_error(ib,
+                         "Invalid size: %s \"%s\"",
+                         name,
+                         p1_unescaped);
+            return IB_EINVAL;
+        }
+        rc = ib_context_set_num(ctx, "rule_stream_overlap", size);
+        return rc;
+    }
+    else if ( (strcasecmp("RuleEngineParallelThreads", name) == 0) ||
+              (strcasecmp("RuleEngineParallelMinSize", name) == 0) )
+    {
+        ib_num_t num;
+        rc = ib_type_atoi(p1_unescaped, 10, &num);
+        if ( (rc != IB_OK) || (num < 0) ) {
+            ib_log_error(ib,
+                         "Invalid value: %s \"%s\"",
+                         name,
+                         p1_unescaped);
+            return IB_EINVAL;
+        }
+        rc = ib_context_set_num(
+            ctx,
+            (strcasecmp("RuleEngineParallelThreads", name) == 0) ?
+                "rule_parallel_threads" : "rule_parallel_min_size",
+            num);
+        return rc;
+    }
     else if (strcasecmp("AuditLogIndex", name) == 0) {
         /* "None" means do not use the index file at all. */
         if (strcasecmp("None", p1_unescaped) == 0) {
@@ -3003,6 +3382,19 @@ static ib_status_t core_dir_param1(ib_cfgparser_t *cp,
         rc = ib_context_set_auditlog_index(ctx, true, p1_unescaped);
         return rc;
     }
+    else if (strcasecmp("AuditLogIndexRotate", name) == 0) {
+        ib_num_t size;
+        rc = ib_type_atoi(p1_unescaped, 10, &size);
+        if ( (rc != IB_OK) || (size < 0) ) {
+            ib_log_error(ib,
+                         "Invalid size: %s \"%s\"",
+                         name,
+                         p1_unescaped);
+            return IB_EINVAL;
+        }
+        rc = ib_context_set_num(ctx, "auditlog_index_rotate", size);
+        return rc;
+    }
     else if (strcasecmp("AuditLogIndexFormat", name) == 0) {
         rc = ib_context_set_string(ctx, "auditlog_index_fmt", p1_unescaped);
         return rc;
@@ -3252,6 +3644,15 @@ static ib_status_t core_dir_param1(ib_cfgparser_t *cp,
 
         corecfg->limits.request_body_log_limit = atoll(p1_unescaped);
     }
+    else if (strcasecmp("TxMemoryLimit", name) == 0) {
+        rc = ib_core_context_config(ctx, &corecfg);
+        if (rc != IB_OK) {
+            ib_log_error(ib, "Could not fetch core module config.");
+            return rc;
+        }
+
+        corecfg->limits.tx_memory_limit = atoll(p1_unescaped);
+    }
     else {
         ib_log_error(ib, "Unhandled directive: %s %s", name, p1_unescaped);
         rc = IB_EINVAL;
@@ -3566,6 +3967,119 @@ static ib_status_t core_dir_param2(ib_cfgparser_t *cp,
     return IB_EINVAL;
 }
 
+/**
+ * Handle the RequestBodyInspectLimit and ResponseBodyInspectLimit directives.
+ *
+ * The list of limits is replaced by a copy with the new limit, so that the
+ * list of a parent context is never modified.  An earlier limit for the
+ * same media type is dropped.
+ *
+ * @param[in] cp Config parser
+ * @param[in] name Directive name
+ * @param[in] pattern Media type, type prefix followed by `*`, or `*`.
+ * @param[in] limit_str Limit in bytes; < 0 for no limit.
+ * @param[in] cbdata Callback data (unused)
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EINVAL If @a pattern or @a limit_str is invalid.
+ * - IB_EALLOC On allocation failure.
+ */
+static ib_status_t core_dir_body_inspect_limit(ib_cfgparser_t *cp,
+                                               const char *name,
+                                               const char *pattern,
+                                               const char *limit_str,
+                                               void *cbdata)
+{
+    assert(cp != NULL);
+    assert(cp->cur_ctx != NULL);
+
+    ib_mm_t                     mm = cp->cur_ctx->mm;
+    ib_core_cfg_t              *corecfg;
+    const ib_list_t           **plimits;
+    const ib_list_node_t       *node;
+    ib_list_t                  *limits;
+    core_body_inspect_limit_t  *entry;
+    size_t                      pattern_len = strlen(pattern);
+    ib_num_t                    limit;
+    ib_status_t                 rc;
+
+    rc = ib_core_context_config(cp->cur_ctx, &corecfg);
+    if (rc != IB_OK) {
+        ib_cfg_log_error(cp, "Could not fetch core module config.");
+        return rc;
+    }
+    plimits = (strcasecmp("RequestBodyInspectLimit", name) == 0) ?
+        &(corecfg->request_body_inspect_limits) :
+        &(corecfg->response_body_inspect_limits);
+
+    rc = ib_type_atoi(limit_str, 10, &limit);
+    if (rc != IB_OK) {
+        ib_cfg_log_error(cp, "%s: Invalid limit: %s", name, limit_str);
+        return IB_EINVAL;
+    }
+
+    entry = ib_mm_alloc(mm, sizeof(*entry));
+    if (entry == NULL) {
+        return IB_EALLOC;
+    }
+    entry->pattern = pattern;
+    entry->limit = (limit < 0) ? -1 : (ssize_t)limit;
+    if (strcmp(pattern, "*") == 0) {
+        entry->type = "";
+        entry->type_len = 0;
+        entry->is_prefix = true;
+    }
+    else if (
+        pattern_len > 2 &&
+        pattern[pattern_len - 2] == '/' &&
+        pattern[pattern_len - 1] == '*' &&
+        memchr(pattern, '/', pattern_len - 2) == NULL
+    ) {
+        entry->type = pattern;
+        entry->type_len = pattern_len - 1;
+        entry->is_prefix = true;
+    }
+    else if (
+        strchr(pattern, '/') != NULL &&
+        strchr(pattern, '*') == NULL &&
+        strchr(pattern, ';') == NULL
+    ) {
+        entry->type = pattern;
+        entry->type_len = pattern_len;
+        entry->is_prefix = false;
+    }
+    else {
+        ib_cfg_log_error(cp, "%s: Invalid media type: %s", name, pattern);
+        return IB_EINVAL;
+    }
+
+    rc = ib_list_create(&limits, mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    if (*plimits != NULL) {
+        IB_LIST_LOOP_CONST(*plimits, node) {
+            const core_body_inspect_limit_t *old =
+                ib_list_node_data_const(node);
+            if (strcasecmp(old->pattern, pattern) == 0) {
+                continue;
+            }
+            rc = ib_list_push(limits, (void *)old);
+            if (rc != IB_OK) {
+                return rc;
+            }
+        }
+    }
+    rc = ib_list_push(limits, entry);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    *plimits = limits;
+
+    return IB_OK;
+}
+
 /**
  * Implementation of LogWrite directive.
  *
@@ -4001,6 +4515,21 @@ static IB_DIRMAP_INIT_STRUCTURE(core_directive_map) = {
         core_dir_param1,
         NULL
     ),
+    IB_DIRMAP_INIT_PARAM1(
+        "TxMemoryLimit",
+        core_dir_param1,
+        NULL
+    ),
+    IB_DIRMAP_INIT_PARAM2(
+        "RequestBodyInspectLimit",
+        core_dir_body_inspect_limit,
+        NULL
+    ),
+    IB_DIRMAP_INIT_PARAM2(
+        "ResponseBodyInspectLimit",
+        core_dir_body_inspect_limit,
+        NULL
+    ),
 
     /* Blocking */
     IB_DIRMAP_INIT_PARAM1(
@@ -4025,6 +4554,26 @@ static IB_DIRMAP_INIT_STRUCTURE(core_directive_map) = {
         core_dir_param1,
         NULL
     ),
+    IB_DIRMAP_INIT_ONOFF(
+        "LogAsync",
+        core_dir_onoff,
+        NULL
+    ),
+    IB_DIRMAP_INIT_PARAM1(
+        "LogEventLimit",
+        core_dir_param1,
+        NULL
+    ),
+    IB_DIRMAP_INIT_ONOFF(
+        "AuditLogAsync",
+        core_dir_onoff,
+        NULL
+    ),
+    IB_DIRMAP_INIT_ONOFF(
+        "AuditLogCompress",
+        core_dir_onoff,
+        NULL
+    ),
 
     /* Config */
     IB_DIRMAP_INIT_SBLK1(
@@ -4104,6 +4653,11 @@ static IB_DIRMAP_INIT_STRUCTURE(core_directive_map) = {
         core_dir_param1,
         NULL
     ),
+    IB_DIRMAP_INIT_PARAM1(
+        "AuditLogIndexRotate",
+        core_dir_param1,
+        NULL
+    ),
     IB_DIRMAP_INIT_PARAM1(
         "AuditLogDirMode",
         core_dir_param1,
@@ -4157,6 +4711,46 @@ static IB_DIRMAP_INIT_STRUCTURE(core_directive_map) = {
         core_dir_loglevel,
         core_loglevels_map
     ),
+    IB_DIRMAP_INIT_PARAM1(
+        "RuleEngineOrdering",
+        core_dir_param1,
+        NULL
+    ),
+    IB_DIRMAP_INIT_ONOFF(
+        "RuleEngineLazyContexts",
+        core_dir_onoff,
+        NULL
+    ),
+    IB_DIRMAP_INIT_ONOFF(
+        "RuleEngineProfile",
+        core_dir_onoff,
+        NULL
+    ),
+    IB_DIRMAP_INIT_ONOFF(
+        "RuleEngineCompare",
+        core_dir_onoff,
+        NULL
+    ),
+    IB_DIRMAP_INIT_PARAM1(
+        "RuleEngineStreamCoalesce",
+        core_dir_param1,
+        NULL
+    ),
+    IB_DIRMAP_INIT_PARAM1(
+        "RuleEngineStreamOverlap",
+        core_dir_param1,
+        NULL
+    ),
+    IB_DIRMAP_INIT_PARAM1(
+        "RuleEngineParallelThreads",
+        core_dir_param1,
+        NULL
+    ),
+    IB_DIRMAP_INIT_PARAM1(
+        "RuleEngineParallelMinSize",
+        core_dir_param1,
+        NULL
+    ),
 
     /* TX DPI Initializers */
     IB_DIRMAP_INIT_PARAM2(
@@ -4389,6 +4983,20 @@ static ib_status_t core_ctx_destroy(ib_engine_t *ib,
     assert(state == context_destroy_state);
     assert(cbdata != NULL);
 
+    ib_core_module_data_t *core_data =
+        (ib_core_module_data_t *)((ib_module_t *)cbdata)->data;
+
+    /* Queued audit logs refer to the configuration of their context.  The
+     * engine context is destroyed last. */
+    if (core_data != NULL && core_data->audit_writer != NULL) {
+        if (ib_context_type_check(ctx, IB_CTYPE_ENGINE)) {
+            core_audit_writer_stop(core_data->audit_writer);
+        }
+        else {
+            core_audit_writer_flush(core_data->audit_writer);
+        }
+    }
+
     if (ib_context_type_check(ctx, IB_CTYPE_ENGINE)) {
 
         ib_core_cfg_t *config;
@@ -4440,6 +5048,7 @@ static ib_status_t core_init(ib_engine_t *ib,
 
     /* Set defaults */
     corecfg->log_fp               = stderr;
+    corecfg->log_async            = NULL;
     corecfg->log_uri              = "";
     corecfg->buffer_req           = 0;
     corecfg->buffer_res           = 0;
@@ -4447,6 +5056,8 @@ static ib_status_t core_init(ib_engine_t *ib,
     corecfg->auditlog_dmode       = 0700;
     corecfg->auditlog_fmode       = 0600;
     corecfg->auditlog_parts       = IB_ALPARTS_DEFAULT;
+    corecfg->auditlog_compress    = 0;
+    corecfg->auditlog_index_rotate = 0;
     corecfg->auditlog_dir         = "/var/log/ironbee";
     corecfg->auditlog_sdir_fmt    = "";
     corecfg->auditlog_index_fmt   = IB_LOGFORMAT_DEFAULT;
@@ -4458,6 +5069,15 @@ static ib_status_t core_init(ib_engine_t *ib,
     corecfg->rule_log_level       = IB_LOG_INFO;
     corecfg->rule_debug_str       = "error";
     corecfg->rule_debug_level     = IB_RULE_DLOG_ERROR;
+    corecfg->rule_ordering        = IB_RULE_ORDERING_CONFIG;
+    corecfg->rule_profile         = 0;
+    corecfg->rule_compare         = 0;
+    corecfg->rule_lazy_contexts   = 0;
+    corecfg->rule_stream_coalesce = 0;
+    corecfg->rule_stream_overlap = 0;
+    corecfg->rule_parallel_threads = 0;
+    corecfg->rule_parallel_min_size = 65536;
+    corecfg->logevent_limit       = 1000;
     corecfg->inspection_engine_options = IB_IEOPT_DEFAULT;
     corecfg->protection_engine_options = IB_PEOPT_DEFAULT;
 
@@ -4474,6 +5094,9 @@ static ib_status_t core_init(ib_engine_t *ib,
     corecfg->limits.response_body_buffer_limit_action = IB_BUFFER_LIMIT_ACTION_FLUSH_PARTIAL;
     corecfg->limits.request_body_log_limit            = -1;
     corecfg->limits.response_body_log_limit           = -1;
+    corecfg->limits.tx_memory_limit                   = -1;
+    corecfg->limits.request_body_inspect_limit        = -1;
+    corecfg->limits.response_body_inspect_limit       = -1;
 
     /* Initialize vars */
     corecfg->vars = ib_mm_calloc(mm, 1, sizeof(*corecfg->vars));
@@ -4494,6 +5117,8 @@ static ib_status_t core_init(ib_engine_t *ib,
     ib_hook_tx_register(ib, handle_context_tx_state,
                         core_hook_context_tx, NULL);
     ib_hook_conn_register(ib, conn_started_state, core_hook_conn_started, NULL);
+    ib_hook_tx_register(ib, response_header_finished_state,
+                        core_hook_response_header, NULL);
 
     /* Register postprocessing hooks. */
     ib_hook_tx_register(ib, handle_postprocess_state,
@@ -4631,6 +5256,60 @@ static IB_CFGMAP_INIT_STRUCTURE(core_config_map) = {
         ib_core_cfg_t,
         rule_debug_level
     ),
+    IB_CFGMAP_INIT_ENTRY(
+        "rule_ordering",
+        IB_FTYPE_NUM,
+        ib_core_cfg_t,
+        rule_ordering
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        "rule_profile",
+        IB_FTYPE_NUM,
+        ib_core_cfg_t,
+        rule_profile
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        "rule_compare",
+        IB_FTYPE_NUM,
+        ib_core_cfg_t,
+        rule_compare
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        "rule_lazy_contexts",
+        IB_FTYPE_NUM,
+        ib_core_cfg_t,
+        rule_lazy_contexts
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        "rule_stream_coalesce",
+        IB_FTYPE_NUM,
+        ib_core_cfg_t,
+        rule_stream_coalesce
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        "rule_stream_overlap",
+        IB_FTYPE_NUM,
+        ib_core_cfg_t,
+        rule_stream_overlap
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        "rule_parallel_threads",
+        IB_FTYPE_NUM,
+        ib_core_cfg_t,
+        rule_parallel_threads
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        "logevent_limit",
+        IB_FTYPE_NUM,
+        ib_core_cfg_t,
+        logevent_limit
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        "rule_parallel_min_size",
+        IB_FTYPE_NUM,
+        ib_core_cfg_t,
+        rule_parallel_min_size
+    ),
 
     /* Buffering */
     IB_CFGMAP_INIT_ENTRY(
@@ -4665,6 +5344,18 @@ static IB_CFGMAP_INIT_STRUCTURE(core_config_map) = {
         ib_core_cfg_t,
         auditlog_fmode
     ),
+    IB_CFGMAP_INIT_ENTRY(
+        "auditlog_compress",
+        IB_FTYPE_NUM,
+        ib_core_cfg_t,
+        auditlog_compress
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        "auditlog_index_rotate",
+        IB_FTYPE_NUM,
+        ib_core_cfg_t,
+        auditlog_index_rotate
+    ),
     IB_CFGMAP_INIT_ENTRY(
         "auditlog_parts",
         IB_FTYPE_NUM,
@@ -4718,6 +5409,10 @@ ib_module_t *ib_core_module(
     ib_module_t *module;
     ib_status_t  rc;
 
+    if (ib->core_module != NULL) {
+        return ib->core_module;
+    }
+
     /* If this fails, we're in bad shape.  Fail hard. */
     rc = ib_engine_module_get(ib, MODULE_NAME_STR, &module);
     assert(rc == IB_OK);
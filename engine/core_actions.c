@@ -163,6 +163,13 @@ struct setvar_data_t {
      */
     ib_field_t      *argument;        /**< The setvar argument. */
     ib_list_t       *transformations; /**< Names of tfns to apply to value. */
+    /**
+     * Source of a trivial target of a numeric operation with a constant
+     * argument and no transformations, else NULL.
+     *
+     * Such an operation changes the field of the source in place.
+     */
+    const ib_var_source_t *source;
     const char      *target_str;      /**< Used in error logging. */
     size_t           target_str_len;  /**< Used in error logging. */
 };
@@ -334,6 +341,91 @@ ib_status_t setvar_num_op(
     return IB_OK;
 }
 
+/**
+ * Perform a numeric setvar operation on the field of a source in place.
+ *
+ * This is the common case of a counter, e.g., `setvar:SCORE+=5`: there is
+ * no target to expand, no result list to build and no field to set back.
+ *
+ * @param[in] tx          Current transaction.
+ * @param[in] setvar_data Setvar data; its source is not NULL.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_DECLINED if the source is not set or of another type; the
+ *     general path handles it.
+ */
+static
+ib_status_t setvar_source_op(
+    ib_tx_t             *tx,
+    const setvar_data_t *setvar_data
+)
+{
+    assert(tx          != NULL);
+    assert(setvar_data != NULL);
+    assert(setvar_data->source != NULL);
+
+    ib_field_t *field;
+    ib_status_t rc;
+
+    rc = ib_var_source_get(setvar_data->source, &field, tx->var_store);
+    if (rc != IB_OK || field == NULL || ib_field_is_dynamic(field)) {
+        return IB_DECLINED;
+    }
+
+    switch (setvar_data->op) {
+    case SETVAR_NUMADD:
+    case SETVAR_NUMSUB:
+    case SETVAR_NUMMULT:
+    {
+        ib_num_t num1;
+        ib_num_t num2;
+
+        if (field->type != IB_FTYPE_NUM) {
+            return IB_DECLINED;
+        }
+        ib_field_value(field, ib_ftype_num_out(&num1));
+        ib_field_value(setvar_data->argument, ib_ftype_num_out(&num2));
+        if (setvar_data->op == SETVAR_NUMADD) {
+            setvar_num_add_op(num1, num2, &num1);
+        }
+        else if (setvar_data->op == SETVAR_NUMSUB) {
+            setvar_num_sub_op(num1, num2, &num1);
+        }
+        else {
+            setvar_num_mult_op(num1, num2, &num1);
+        }
+        return ib_field_setv(field, ib_ftype_num_in(&num1));
+    }
+
+    case SETVAR_FLOATADD:
+    case SETVAR_FLOATSUB:
+    case SETVAR_FLOATMULT:
+    {
+        ib_float_t flt1;
+        ib_float_t flt2;
+
+        if (field->type != IB_FTYPE_FLOAT) {
+            return IB_DECLINED;
+        }
+        ib_field_value(field, ib_ftype_float_out(&flt1));
+        ib_field_value(setvar_data->argument, ib_ftype_float_out(&flt2));
+        if (setvar_data->op == SETVAR_FLOATADD) {
+            setvar_float_add_op(flt1, flt2, &flt1);
+        }
+        else if (setvar_data->op == SETVAR_FLOATSUB) {
+            setvar_float_sub_op(flt1, flt2, &flt1);
+        }
+        else {
+            setvar_float_mult_op(flt1, flt2, &flt1);
+        }
+        return ib_field_setv(field, ib_ftype_float_in(&flt1));
+    }
+
+    default:
+        return IB_DECLINED;
+    }
+}
 
 /**
  * Create function for the setflags action.
@@ -727,6 +819,7 @@ static ib_status_t act_setvar_create(
     setvar_data->target_str = ib_mm_memdup(mm, parameters, nlen);
     setvar_data->target_str_len = nlen;
     setvar_data->transformations = NULL;
+    setvar_data->source = NULL;
 
     rc = ib_list_create(&tfns, mm);
     if (rc != IB_OK) {
@@ -869,6 +962,13 @@ static ib_status_t act_setvar_create(
     }
 
 success:
+    if (
+        mod != NULL &&
+        setvar_data->transformations == NULL &&
+        ib_var_target_is_trivial(setvar_data->target)
+    ) {
+        setvar_data->source = ib_var_target_source(setvar_data->target);
+    }
     *(void **)instance_data = setvar_data;
     return IB_OK;
 }
@@ -908,6 +1008,13 @@ static ib_status_t act_setvar_execute(
     const char          *ts          = setvar_data->target_str;
     int                  tslen       = (int)setvar_data->target_str_len;
 
+    if (setvar_data->source != NULL) {
+        rc = setvar_source_op(tx, setvar_data);
+        if (rc != IB_DECLINED) {
+            return rc;
+        }
+    }
+
     /* Expand target. */
     rc = ib_var_target_expand(
         setvar_data->target,
@@ -28,6 +28,7 @@
 #include "core_private.h"
 #include "engine_private.h"
 
+#include <ironbee/batch_writer.h>
 #include <ironbee/context.h>
 #include <ironbee/core.h>
 #include <ironbee/engine_types.h>
@@ -41,7 +42,11 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/types.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 
 /* POSIX doesn't define O_BINARY */
 #ifndef O_BINARY
@@ -56,10 +61,75 @@ typedef struct {
     const ib_site_t *site;
 } auditlog_callback_data_t;
 
+/**
+ * An audit log queued for the asynchronous writer.
+ *
+ * The record and its strings are a single allocation; the buffered audit log
+ * is allocated by open_memstream().
+ */
+typedef struct core_audit_record_t core_audit_record_t;
+struct core_audit_record_t {
+    ib_auditlog_cfg_t   *auditlog;  /**< Index config; NULL for no line. */
+    char                *full_path; /**< Audit log full path. */
+    char                *temp_path; /**< Path to write to before renaming. */
+    char                *data;      /**< Buffered audit log. */
+    size_t               data_len;  /**< Length of data. */
+    char                *line;      /**< Index line, including newline. */
+    size_t               line_len;  /**< Length of line. */
+    ib_num_t             dmode;     /**< Audit log dir create mode. */
+    ib_num_t             fmode;     /**< Audit log file create mode. */
+    ib_num_t             rotate;    /**< Index size to rotate at or 0. */
+    bool                 compress;  /**< Write the audit log compressed? */
+};
+
+/**
+ * See core_audit_writer_t.
+ */
+struct core_audit_writer_t {
+    ib_engine_t       *ib;    /**< Engine; used for logging. */
+    ib_batch_writer_t *batch; /**< Writes the records. */
+};
+
 /* The default shell to use for piped commands. */
 static const char * const ib_pipe_shell = "/bin/sh";
 static const size_t LOGFORMAT_MAX_LINE_LENGTH = 8192;
 
+/* Audit logs queued before transactions wait for the writer. */
+static const size_t AUDIT_WRITER_MAX_PENDING = 1024;
+
+/**
+ * Open @a cfg->fp on a memory buffer if the engine writes asynchronously or
+ * audit logs are compressed.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in] cfg The configuration.
+ * @param[in] corecfg The core configuration.
+ *
+ * @returns True if @a cfg->fp was opened.
+ */
+static bool core_audit_open_buffer(ib_engine_t *ib,
+                                   ib_core_audit_cfg_t *cfg,
+                                   const ib_core_cfg_t *corecfg)
+{
+#ifdef HAVE_OPEN_MEMSTREAM
+    ib_core_module_data_t *core_data;
+
+    if (! corecfg->auditlog_compress &&
+        (ib_core_module_data(ib, NULL, &core_data) != IB_OK ||
+         core_data->audit_writer == NULL))
+    {
+        return false;
+    }
+
+    cfg->fp = open_memstream(&(cfg->buf), &(cfg->buf_len));
+    cfg->buffered = (cfg->fp != NULL);
+
+    return cfg->buffered;
+#else
+    return false;
+#endif
+}
+
 ib_status_t core_audit_open_auditfile(ib_engine_t *ib,
                                       ib_auditlog_t *log,
                                       ib_core_audit_cfg_t *cfg,
@@ -79,6 +149,7 @@ ib_status_t core_audit_open_auditfile(ib_engine_t *ib,
     ib_status_t ib_rc;
     struct tm gmtime_result;
     const ib_site_t *site;
+    const char *ext = corecfg->auditlog_compress ? ".gz" : "";
 
     if (dtmp == NULL || dn == NULL) {
         if (dtmp != NULL) {
@@ -132,18 +203,19 @@ ib_status_t core_audit_open_auditfile(ib_engine_t *ib,
     /* Generate the full audit log filename. */
     if (site != NULL) {
         audit_filename_sz = strlen(dn) + strlen(cfg->tx->id) +
-            strlen(site->id) + 7;
+            strlen(site->id) + 7 + strlen(ext);
         audit_filename = (char *)ib_mm_alloc(cfg->tx->mm, audit_filename_sz);
         sys_rc = snprintf(audit_filename,
                           audit_filename_sz,
-                          "%s/%s_%s.log", dn, cfg->tx->id,site->id);
+                          "%s/%s_%s.log%s", dn, cfg->tx->id, site->id, ext);
     }
     else {
-        audit_filename_sz = strlen(dn) + strlen(cfg->tx->id) + 6;
+        audit_filename_sz = strlen(dn) + strlen(cfg->tx->id) + 6 +
+            strlen(ext);
         audit_filename = (char *)ib_mm_alloc(cfg->tx->mm, audit_filename_sz);
         sys_rc = snprintf(audit_filename,
                           audit_filename_sz,
-                          "%s/%s.log", dn, cfg->tx->id);
+                          "%s/%s.log%s", dn, cfg->tx->id, ext);
     }
     if (sys_rc >= (int)audit_filename_sz) {
         /// @todo Better error.
@@ -155,16 +227,6 @@ ib_status_t core_audit_open_auditfile(ib_engine_t *ib,
         return IB_EINVAL;
     }
 
-    ib_rc = ib_util_mkpath(dn, corecfg->auditlog_dmode);
-    if (ib_rc != IB_OK) {
-        ib_log_error(log->ib,
-                     "Failed to create audit log dir: %s", dn);
-        ib_rule_log_add_audit(cfg->tx->rule_exec, audit_filename, true);
-        free(dtmp);
-        free(dn);
-        return ib_rc;
-    }
-
     // Create temporary filename to use while writing the audit log
     temp_filename_sz = strlen(audit_filename) + 6;
     temp_filename = (char *)ib_mm_alloc(cfg->tx->mm, temp_filename_sz);
@@ -186,25 +248,39 @@ ib_status_t core_audit_open_auditfile(ib_engine_t *ib,
         return IB_EINVAL;
     }
 
-    /* Open the file.  Use open() & fdopen() to avoid chmod() */
-    fd = open(temp_filename,
-              (O_WRONLY|O_APPEND|O_CREAT|O_BINARY),
-              corecfg->auditlog_fmode);
-    if (fd >= 0) {
-        cfg->fp = fdopen(fd, "ab");
-        if (cfg->fp == NULL) {
-            close(fd);
+    /* Buffer the audit log for the asynchronous writer, which creates the
+     * directory and file, or for compression, if possible. */
+    if (! core_audit_open_buffer(ib, cfg, corecfg)) {
+        ib_rc = ib_util_mkpath(dn, corecfg->auditlog_dmode);
+        if (ib_rc != IB_OK) {
+            ib_log_error(log->ib,
+                         "Failed to create audit log dir: %s", dn);
+            ib_rule_log_add_audit(cfg->tx->rule_exec, audit_filename, true);
+            free(dtmp);
+            free(dn);
+            return ib_rc;
+        }
+
+        /* Open the file.  Use open() & fdopen() to avoid chmod() */
+        fd = open(temp_filename,
+                  (O_WRONLY|O_APPEND|O_CREAT|O_BINARY),
+                  corecfg->auditlog_fmode);
+        if (fd >= 0) {
+            cfg->fp = fdopen(fd, "ab");
+            if (cfg->fp == NULL) {
+                close(fd);
+            }
+        }
+        if ( (fd < 0) || (cfg->fp == NULL) ) {
+            sys_rc = errno;
+            ib_log_error(log->ib,
+                         "Error opening audit log \"%s\": %s (%d)",
+                         temp_filename, strerror(sys_rc), sys_rc);
+            ib_rule_log_add_audit(cfg->tx->rule_exec, audit_filename, true);
+            free(dtmp);
+            free(dn);
+            return IB_EINVAL;
         }
-    }
-    if ( (fd < 0) || (cfg->fp == NULL) ) {
-        sys_rc = errno;
-        ib_log_error(log->ib,
-                     "Error opening audit log \"%s\": %s (%d)",
-                     temp_filename, strerror(sys_rc), sys_rc);
-        ib_rule_log_add_audit(cfg->tx->rule_exec, audit_filename, true);
-        free(dtmp);
-        free(dn);
-        return IB_EINVAL;
     }
 
     /* Track the relative audit log filename. */
@@ -369,6 +445,13 @@ ib_status_t core_audit_open_auditindexfile(ib_engine_t *ib,
     else {
         /// @todo Use corecfg->auditlog_fmode as file mode for new file
         cfg->index_fp = fopen(index_file, "ab");
+
+        /* Keep the path to rotate the index file. */
+        if (cfg->index_fp != NULL) {
+            log->ctx->auditlog->index_path = ib_mm_strdup(
+                log->ctx->auditlog->owner->mm,
+                index_file);
+        }
         if (cfg->index_fp == NULL) {
             sys_rc = errno;
             ib_log_error(log->ib,
@@ -504,7 +587,6 @@ ib_status_t core_audit_write_header(ib_engine_t *ib,
         ib_log_error(ib,  "Failed to write audit log header.");
         return IB_EUNKNOWN;
     }
-    fflush(cfg->fp);
 
     return IB_OK;
 }
@@ -532,15 +614,11 @@ ib_status_t core_audit_write_part(ib_engine_t *ib,
     while((chunk_size = part->fn_gen(part, &chunk)) != 0) {
         if (fwrite(chunk, chunk_size, 1, cfg->fp) != 1) {
             ib_log_error(ib,  "Failed to write audit log part.");
-            fflush(cfg->fp);
             return IB_EUNKNOWN;
         }
         cfg->parts_written++;
     }
 
-    /* Finish the part. */
-    fflush(cfg->fp);
-
     return IB_OK;
 }
 
@@ -660,15 +738,418 @@ static ib_status_t core_audit_get_index_line(ib_engine_t *ib,
     return rc;
 }
 
+/**
+ * Rotate the index file of @a auditlog.
+ *
+ * The index file is renamed with the current time as a suffix and a new one
+ * is opened in its place.  The index lock must be held.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in] auditlog Audit log configuration of the index file.
+ */
+static void core_audit_rotate_index(ib_engine_t *ib,
+                                    ib_auditlog_cfg_t *auditlog)
+{
+    char *rotated;
+    size_t rotated_sz;
+    struct timeval tv;
+    struct tm tm;
+    int sys_rc;
+
+    rotated_sz = strlen(auditlog->index_path) + 24;
+    rotated = malloc(rotated_sz);
+    if (rotated == NULL) {
+        return;
+    }
+
+    gettimeofday(&tv, NULL);
+    gmtime_r(&(tv.tv_sec), &tm);
+    snprintf(rotated, rotated_sz, "%s.%04d%02d%02d-%02d%02d%02d.%06ld",
+             auditlog->index_path,
+             tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+             tm.tm_hour, tm.tm_min, tm.tm_sec, (long)tv.tv_usec);
+
+    fclose(auditlog->index_fp);
+    if (rename(auditlog->index_path, rotated) != 0) {
+        sys_rc = errno;
+        ib_log_error(ib,
+                     "Error rotating audit log index %s: %s (%d)",
+                     auditlog->index_path, strerror(sys_rc), sys_rc);
+    }
+    free(rotated);
+
+    auditlog->index_fp = fopen(auditlog->index_path, "ab");
+    if (auditlog->index_fp == NULL) {
+        sys_rc = errno;
+        ib_log_error(ib,
+                     "Error opening audit log index \"%s\": %s (%d)",
+                     auditlog->index_path, strerror(sys_rc), sys_rc);
+    }
+}
+
+/**
+ * Append a formatted index line to the index file of @a auditlog.
+ *
+ * If the write fails, the index file is closed.  The index file is rotated
+ * once it reaches @a rotate bytes, unless it is a pipe.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in] auditlog Audit log configuration of the index file.
+ * @param[in] line Line to write, including the newline.
+ * @param[in] len Length of @a line; 0 to only flush.
+ * @param[in] flush Flush the index file after writing?
+ * @param[in] rotate Size to rotate the index file at or 0 to never rotate.
+ *
+ * @returns
+ * - IB_OK On success or if the index file is closed.
+ * - IB_EOTHER If the write failed.
+ * - Other if the lock could not be taken.
+ */
+static ib_status_t core_audit_write_index_line(ib_engine_t *ib,
+                                               ib_auditlog_cfg_t *auditlog,
+                                               const char *line,
+                                               size_t len,
+                                               bool flush,
+                                               ib_num_t rotate)
+{
+    ib_status_t ib_rc;
+    int sys_rc;
+
+    ib_rc = ib_lock_lock(auditlog->index_fp_lock);
+    if (ib_rc != IB_OK) {
+        return ib_rc;
+    }
+
+    if (auditlog->index_fp == NULL) {
+        ib_lock_unlock(auditlog->index_fp_lock);
+        return IB_OK;
+    }
+
+    if ( (len > 0) && (fwrite(line, len, 1, auditlog->index_fp) == 0) ) {
+        sys_rc = errno;
+        ib_log_error(ib,
+                     "Error writing to audit log index: %s (%d)",
+                     strerror(sys_rc), sys_rc);
+
+        /// @todo Should retry (a piped logger may have died)
+        fclose(auditlog->index_fp);
+        auditlog->index_fp = NULL;
+
+        ib_lock_unlock(auditlog->index_fp_lock);
+        return IB_EOTHER;
+    }
+
+    if (flush) {
+        fflush(auditlog->index_fp);
+    }
+    if ( (rotate > 0) && (auditlog->index_path != NULL) &&
+         (ftell(auditlog->index_fp) >= rotate) )
+    {
+        core_audit_rotate_index(ib, auditlog);
+    }
+    ib_lock_unlock(auditlog->index_fp_lock);
+
+    return IB_OK;
+}
+
+/**
+ * Write the audit log of @a record to @a fd and close it.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in] record Record to write.
+ * @param[in] fd File to write to.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EOTHER On failure. See log file for details.
+ */
+static ib_status_t core_audit_write_plain(ib_engine_t *ib,
+                                          core_audit_record_t *record,
+                                          int fd)
+{
+    const char *cur = record->data;
+    size_t remain = record->data_len;
+    int sys_rc;
+
+    while (remain > 0) {
+        ssize_t written = write(fd, cur, remain);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            sys_rc = errno;
+            ib_log_error(ib,
+                         "Error writing audit log \"%s\": %s (%d)",
+                         record->temp_path, strerror(sys_rc), sys_rc);
+            close(fd);
+            return IB_EOTHER;
+        }
+        cur += written;
+        remain -= (size_t)written;
+    }
+    close(fd);
+
+    return IB_OK;
+}
+
+#ifdef HAVE_LIBZ
+/**
+ * Write the audit log of @a record compressed to @a fd and close it.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in] record Record to write.
+ * @param[in] fd File to write to.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EOTHER On failure. See log file for details.
+ */
+static ib_status_t core_audit_write_compressed(ib_engine_t *ib,
+                                               core_audit_record_t *record,
+                                               int fd)
+{
+    /* Largest chunk to pass to gzwrite(), which takes an unsigned length. */
+    static const size_t max_chunk = 1 << 30;
+    const char *cur = record->data;
+    size_t remain = record->data_len;
+    gzFile gz;
+    int errnum;
+
+    gz = gzdopen(fd, "wb");
+    if (gz == NULL) {
+        ib_log_error(ib,
+                     "Error compressing audit log \"%s\"",
+                     record->temp_path);
+        close(fd);
+        return IB_EOTHER;
+    }
+
+    while (remain > 0) {
+        unsigned chunk = (unsigned)(remain < max_chunk ? remain : max_chunk);
+        if (gzwrite(gz, cur, chunk) <= 0) {
+            ib_log_error(ib,
+                         "Error writing audit log \"%s\": %s",
+                         record->temp_path, gzerror(gz, &errnum));
+            gzclose(gz);
+            return IB_EOTHER;
+        }
+        cur += chunk;
+        remain -= chunk;
+    }
+
+    if (gzclose(gz) != Z_OK) {
+        ib_log_error(ib,
+                     "Error closing audit log \"%s\"",
+                     record->temp_path);
+        return IB_EOTHER;
+    }
+
+    return IB_OK;
+}
+#endif
+
+/**
+ * Write the audit log of @a record to its file and rename it into place.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in] record Record to write.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - Other on failure. See log file for details.
+ */
+static ib_status_t core_audit_write_record(ib_engine_t *ib,
+                                           core_audit_record_t *record)
+{
+    char *slash;
+    ib_status_t ib_rc;
+    int fd;
+    int sys_rc;
+
+    /* Create the directory of the audit log. */
+    slash = strrchr(record->full_path, '/');
+    if (slash != NULL) {
+        *slash = '\0';
+        ib_rc = ib_util_mkpath(record->full_path, record->dmode);
+        if (ib_rc != IB_OK) {
+            ib_log_error(ib,
+                         "Failed to create audit log dir: %s",
+                         record->full_path);
+            *slash = '/';
+            return ib_rc;
+        }
+        *slash = '/';
+    }
+
+    fd = open(record->temp_path,
+              (O_WRONLY|O_APPEND|O_CREAT|O_BINARY),
+              record->fmode);
+    if (fd < 0) {
+        sys_rc = errno;
+        ib_log_error(ib,
+                     "Error opening audit log \"%s\": %s (%d)",
+                     record->temp_path, strerror(sys_rc), sys_rc);
+        return IB_EINVAL;
+    }
+
+#ifdef HAVE_LIBZ
+    if (record->compress) {
+        ib_rc = core_audit_write_compressed(ib, record, fd);
+    }
+    else
+#endif
+    {
+        ib_rc = core_audit_write_plain(ib, record, fd);
+    }
+    if (ib_rc != IB_OK) {
+        return ib_rc;
+    }
+
+    // Rename temp to real
+    sys_rc = rename(record->temp_path, record->full_path);
+    if (sys_rc != 0) {
+        sys_rc = errno;
+        ib_log_error(ib,
+                     "Error renaming auditlog %s: %s (%d)",
+                     record->temp_path,
+                     strerror(sys_rc), sys_rc);
+        return IB_EOTHER;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Write a batch of records and free them.
+ *
+ * Each index file is flushed once, after its last line of the batch.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in] records Records of the batch.
+ * @param[in] n_records Number of @a records.
+ */
+static void core_audit_write_batch(ib_engine_t *ib,
+                                   void **records,
+                                   size_t n_records)
+{
+    ib_auditlog_cfg_t *unflushed = NULL;
+
+    for (size_t i = 0; i < n_records; ++i) {
+        core_audit_record_t *record = (core_audit_record_t *)records[i];
+        ib_status_t ib_rc;
+
+        ib_rc = core_audit_write_record(ib, record);
+        if (ib_rc == IB_OK && record->auditlog != NULL) {
+            if (unflushed != NULL && unflushed != record->auditlog) {
+                core_audit_write_index_line(ib, unflushed, NULL, 0, true, 0);
+            }
+            unflushed = record->auditlog;
+            core_audit_write_index_line(ib, record->auditlog,
+                                        record->line, record->line_len,
+                                        false, record->rotate);
+        }
+
+        free(record->data);
+        free(record);
+    }
+
+    if (unflushed != NULL) {
+        core_audit_write_index_line(ib, unflushed, NULL, 0, true, 0);
+    }
+}
+
+/**
+ * Write a batch of records for the asynchronous writer.
+ *
+ * @param[in] items Records of the batch.
+ * @param[in] n_items Number of @a items.
+ * @param[in] cbdata The @ref core_audit_writer_t.
+ */
+static void core_audit_writer_write(void **items,
+                                    size_t n_items,
+                                    void *cbdata)
+{
+    core_audit_writer_t *writer = (core_audit_writer_t *)cbdata;
+
+    core_audit_write_batch(writer->ib, items, n_items);
+}
+
+/**
+ * Hand a buffered audit log and its index line to the writer.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in] writer The writer or NULL to write synchronously.
+ * @param[in] log The audit log.
+ * @param[in] corecfg The core configuration.
+ * @param[in] line Index line, including the newline, or NULL.
+ * @param[in] len Length of @a line.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ */
+static ib_status_t core_audit_queue(ib_engine_t *ib,
+                                    core_audit_writer_t *writer,
+                                    ib_auditlog_t *log,
+                                    const ib_core_cfg_t *corecfg,
+                                    const char *line,
+                                    size_t len)
+{
+    ib_core_audit_cfg_t *cfg = (ib_core_audit_cfg_t *)log->cfg_data;
+    core_audit_record_t *record;
+    size_t full_path_sz = strlen(cfg->full_path) + 1;
+    size_t temp_path_sz = strlen(cfg->temp_path) + 1;
+    char *cur;
+
+    record = malloc(sizeof(*record) + full_path_sz + temp_path_sz + len);
+    if (record == NULL) {
+        free(cfg->buf);
+        cfg->buf = NULL;
+        return IB_EALLOC;
+    }
+
+    cur = (char *)(record + 1);
+    record->full_path = memcpy(cur, cfg->full_path, full_path_sz);
+    cur += full_path_sz;
+    record->temp_path = memcpy(cur, cfg->temp_path, temp_path_sz);
+    cur += temp_path_sz;
+    record->line = (line == NULL) ? NULL : memcpy(cur, line, len);
+    record->line_len = len;
+    record->auditlog = (line == NULL) ? NULL : log->ctx->auditlog;
+    record->data = cfg->buf;
+    record->data_len = cfg->buf_len;
+    record->dmode = corecfg->auditlog_dmode;
+    record->fmode = corecfg->auditlog_fmode;
+    record->rotate = corecfg->auditlog_index_rotate;
+    record->compress = (corecfg->auditlog_compress != 0);
+
+    /* The writer owns the buffer now. */
+    cfg->buf = NULL;
+    cfg->buf_len = 0;
+
+    if (writer != NULL) {
+        ib_batch_writer_submit(writer->batch, record);
+    }
+    else {
+        void *item = record;
+
+        core_audit_write_batch(ib, &item, 1);
+    }
+
+    return IB_OK;
+}
+
 ///! Close the auditlog and write to the index file.
 ib_status_t core_audit_close(ib_engine_t *ib, ib_auditlog_t *log)
 {
     ib_core_audit_cfg_t *cfg = (ib_core_audit_cfg_t *)log->cfg_data;
     ib_core_cfg_t *corecfg;
+    ib_core_module_data_t *core_data;
     ib_status_t ib_rc = IB_OK;
     int sys_rc;
     char *line = NULL;
     size_t len = 0;
+    bool write_index;
 
     line = malloc(LOGFORMAT_MAX_LINE_LENGTH + 2);
     if (line == NULL) {
@@ -694,9 +1175,38 @@ ib_status_t core_audit_close(ib_engine_t *ib, ib_auditlog_t *log)
         goto cleanup;
     }
 
+    /* Format the index line, if using one, outside of the index lock. */
+    write_index = (cfg->index_fp != NULL) && (cfg->parts_written > 0);
+    if (write_index) {
+        ib_rc = core_audit_get_index_line(ib, log, line,
+                                          LOGFORMAT_MAX_LINE_LENGTH,
+                                          &len);
+        if ( (ib_rc != IB_ETRUNC) && (ib_rc != IB_OK) ) {
+            goto cleanup;
+        }
+        line[len++] = '\n';
+        line[len] = '\0';
+        ib_rc = IB_OK;
+    }
+
     /* Close the audit log. */
     if (cfg->fp != NULL) {
         fclose(cfg->fp);
+        cfg->fp = NULL;
+
+        /* A buffered audit log is written by the asynchronous writer, if
+         * any, along with its index line. */
+        if (cfg->buffered) {
+            ib_rc = ib_core_module_data(ib, NULL, &core_data);
+            ib_rc = core_audit_queue(ib,
+                                     (ib_rc == IB_OK) ?
+                                         core_data->audit_writer : NULL,
+                                     log, corecfg,
+                                     write_index ? line : NULL,
+                                     write_index ? len : 0);
+            goto cleanup;
+        }
+
         // Rename temp to real
         sys_rc = rename(cfg->temp_path, cfg->full_path);
         if (sys_rc != 0) {
@@ -708,54 +1218,68 @@ ib_status_t core_audit_close(ib_engine_t *ib, ib_auditlog_t *log)
             ib_rc = IB_EOTHER;
             goto cleanup;
         }
-        cfg->fp = NULL;
     }
 
     /* Write to the index file if using one. */
-    if ((cfg->index_fp != NULL) && (cfg->parts_written > 0)) {
-        size_t written;
+    if (write_index) {
+        ib_rc = core_audit_write_index_line(ib, log->ctx->auditlog,
+                                            line, len, true,
+                                            corecfg->auditlog_index_rotate);
+        cfg->index_fp = log->ctx->auditlog->index_fp;
+    }
 
-        ib_rc = ib_lock_lock(log->ctx->auditlog->index_fp_lock);
-        if (ib_rc != IB_OK) {
-            goto cleanup;
-        }
+cleanup:
+    if (line != NULL) {
+        free(line);
+    }
+    return ib_rc;
+}
 
-        ib_rc = core_audit_get_index_line(ib, log, line,
-                                          LOGFORMAT_MAX_LINE_LENGTH,
-                                          &len);
-        line[len + 0] = '\n';
-        line[len + 1] = '\0';
+ib_status_t core_audit_writer_create(
+    core_audit_writer_t **writer,
+    ib_engine_t          *ib,
+    ib_mm_t               mm)
+{
+    assert(writer != NULL);
+    assert(ib != NULL);
 
-        if ( (ib_rc != IB_ETRUNC) && (ib_rc != IB_OK) ) {
-            ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
-            goto cleanup;
-        }
+    core_audit_writer_t *new_writer;
+    ib_status_t          rc;
 
-        written = fwrite(line, len, 1, cfg->index_fp);
+#ifndef HAVE_OPEN_MEMSTREAM
+    /* Audit logs are buffered with open_memstream(). */
+    return IB_ENOTIMPL;
+#endif
 
-        if (written == 0) {
-            sys_rc = errno;
-            ib_log_error(log->ib,
-                         "Error writing to audit log index: %s (%d)",
-                         strerror(sys_rc), sys_rc);
+    new_writer = ib_mm_calloc(mm, 1, sizeof(*new_writer));
+    if (new_writer == NULL) {
+        return IB_EALLOC;
+    }
 
-            /// @todo Should retry (a piped logger may have died)
-            fclose(cfg->index_fp);
-            cfg->index_fp = NULL;
+    new_writer->ib = ib;
 
-            log->ctx->auditlog->index_fp = cfg->index_fp;
+    rc = ib_batch_writer_create(&(new_writer->batch), mm,
+                                AUDIT_WRITER_MAX_PENDING,
+                                core_audit_writer_write, new_writer);
+    if (rc != IB_OK) {
+        return rc;
+    }
 
-            ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
-            goto cleanup;
-        }
+    *writer = new_writer;
 
-        fflush(cfg->index_fp);
-        ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
-    }
+    return IB_OK;
+}
 
-cleanup:
-    if (line != NULL) {
-        free(line);
-    }
-    return ib_rc;
+void core_audit_writer_flush(core_audit_writer_t *writer)
+{
+    assert(writer != NULL);
+
+    ib_batch_writer_flush(writer->batch);
+}
+
+void core_audit_writer_stop(core_audit_writer_t *writer)
+{
+    assert(writer != NULL);
+
+    ib_batch_writer_stop(writer->batch);
 }
@@ -85,8 +85,10 @@ ib_status_t core_audit_open(ib_engine_t *ib,
                             ib_auditlog_t *log);
 
 /**
- * Write audit log header. This is not thread-safe and should be protected
- * with a lock.
+ * Write audit log header.
+ *
+ * Only the audit log of @a log is written, so writing the audit logs of
+ * different transactions needs no lock.
  *
  * @param[in] ib IronBee engine.
  * @param[in] log The log record.
@@ -96,7 +98,7 @@ ib_status_t core_audit_write_header(ib_engine_t *ib,
                                     ib_auditlog_t *log);
 
 /**
- * Write part of a audit log. This call should be protected by a lock.
+ * Write part of a audit log.
  *
  * @param[in] ib IronBee engine.
  * @param[in] part The log record.
@@ -106,7 +108,7 @@ ib_status_t core_audit_write_part(ib_engine_t *ib,
                                   ib_auditlog_part_t *part);
 
 /**
- * Write an audit log footer. This call should be protected by a lock.
+ * Write an audit log footer.
  *
  * @param[in] ib IronBee engine.
  * @param[in] log The log record.
@@ -118,6 +120,9 @@ ib_status_t core_audit_write_footer(ib_engine_t *ib,
 /**
  * Close the audit log file and write to the index file.
  *
+ * If the engine has an asynchronous writer, the buffered audit log and its
+ * index line are handed to it instead.
+ *
  * @param[in] ib IronBee engine.
  * @param[in] log The audit log we've just written to a file.
  *
@@ -127,4 +132,56 @@ ib_status_t core_audit_write_footer(ib_engine_t *ib,
  */
 ib_status_t core_audit_close(ib_engine_t *ib, ib_auditlog_t *log);
 
+/**
+ * Asynchronous audit log writer.
+ *
+ * A dedicated thread that writes the audit logs buffered by transactions,
+ * renames them into place and appends their index lines.  Records are
+ * handled in batches: the index files are flushed once per batch.  Built on
+ * @ref ib_batch_writer_t, so the thread is started by the first audit log
+ * of each process.
+ */
+typedef struct core_audit_writer_t core_audit_writer_t;
+
+/**
+ * Create an asynchronous audit log writer.
+ *
+ * The thread is stopped when @a mm is destroyed if core_audit_writer_stop()
+ * has not been called before.
+ *
+ * @param[out] writer The writer.
+ * @param[in] ib IronBee engine; used for logging.
+ * @param[in] mm Memory manager for the writer.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ * - IB_EOTHER If the thread could not be initialized.
+ * - IB_ENOTIMPL If audit logs can not be buffered on this platform.
+ */
+ib_status_t core_audit_writer_create(
+    core_audit_writer_t **writer,
+    ib_engine_t          *ib,
+    ib_mm_t               mm);
+
+/**
+ * Wait until every queued audit log is written.
+ *
+ * Must be called before the configuration of a context with queued audit
+ * logs is destroyed.
+ *
+ * @param[in] writer The writer.
+ */
+void core_audit_writer_flush(core_audit_writer_t *writer);
+
+/**
+ * Write all queued audit logs and stop the writer.
+ *
+ * Audit logs handed to a stopped writer are written synchronously.  Calling
+ * this on a stopped writer does nothing.
+ *
+ * @param[in] writer The writer.
+ */
+void core_audit_writer_stop(core_audit_writer_t *writer);
+
 #endif // _IB_CORE_AUDIT_PRIVATE_H_
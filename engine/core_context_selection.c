@@ -37,6 +37,7 @@
 #include <ironbee/context.h>
 #include <ironbee/context_selection.h>
 #include <ironbee/field.h>
+#include <ironbee/hash.h>
 #include <ironbee/string.h>
 #include <ironbee/util.h>
 
@@ -106,6 +107,7 @@ typedef struct core_location_t {
 
 /** Core site selection data */
 typedef struct core_site_selector_t {
+    size_t                 index;        /**< Position in the selector list */
     const core_site_t     *site;         /**< Pointer to the site */
     const core_service_t  *service;      /**< Service (IP/Port) */
     const ib_list_t       *hosts;        /**< List of core_host_t* */
@@ -151,6 +153,7 @@ static const core_location_t *core_ctxsel_matchany_location(
  *
  * @param[in] ib IronBee engine
  * @param[in] tx Transaction to match
+ * @param[in] len Length of the host name of @a tx
  * @param[in] hosts List of ib_core_host_t
  * @param[out] match true if a match was found, else false
  *
@@ -159,6 +162,7 @@ static const core_location_t *core_ctxsel_matchany_location(
 static ib_status_t core_ctxsel_match_host(
     const ib_engine_t *ib,
     const ib_tx_t *tx,
+    size_t len,
     const ib_list_t *hosts,
     bool *match)
 {
@@ -167,7 +171,6 @@ static ib_status_t core_ctxsel_match_host(
     assert(match != NULL);
 
     const ib_list_node_t *node;
-    size_t len;
 
     /* If no hosts in the list, we have an automatic match */
     if (hosts == NULL) {
@@ -177,7 +180,6 @@ static ib_status_t core_ctxsel_match_host(
 
     /* Now, loop through the list of hostnames */
     if (tx->hostname != NULL) {
-        len = strlen(tx->hostname);
         IB_LIST_LOOP_CONST(hosts, node) {
             const core_host_t *core_host =
                 (const core_host_t *)ib_list_node_data_const(node);
@@ -229,6 +231,7 @@ static ib_status_t core_ctxsel_match_host(
  *
  * @param[in] ib IronBee engine
  * @param[in] tx Transaction to match
+ * @param[in] len Length of the path of @a tx
  * @param[in] locations List of ib_ctxsel_location_t
  * @param[out] match Pointer to matched location (or NULL)
  *
@@ -237,6 +240,7 @@ static ib_status_t core_ctxsel_match_host(
 static ib_status_t core_ctxsel_match_location(
     const ib_engine_t *ib,
     const ib_tx_t *tx,
+    size_t len,
     const ib_list_t *locations,
     const core_location_t **match)
 {
@@ -246,10 +250,8 @@ static ib_status_t core_ctxsel_match_location(
     assert(match != NULL);
 
     const ib_list_node_t *node;
-    size_t len;
 
     /* Now, loop through the list of locations */
-    len = strlen(tx->path);
     IB_LIST_LOOP_CONST(locations, node) {
         const core_location_t *core_location =
             (const core_location_t *)ib_list_node_data_const(node);
@@ -306,6 +308,7 @@ static ib_status_t core_create_site_selector(
     if (object == NULL) {
         return IB_EALLOC;
     }
+    object->index = ib_list_elements(core_data->selector_list);
     object->service = service;
     object->hosts = site->hosts;
     object->locations = site->locations;
@@ -323,6 +326,129 @@ static ib_status_t core_create_site_selector(
     return IB_OK;
 }
 
+/**
+ * Can a selector only match transactions by a full host name?
+ *
+ * @param[in] selector Site selector
+ *
+ * @returns true if all hosts of @a selector are full host names.
+ */
+static bool core_ctxsel_hostname_only(const core_site_selector_t *selector)
+{
+    assert(selector != NULL);
+
+    const ib_list_node_t *node;
+
+    if ( (selector->hosts == NULL) ||
+         (ib_list_elements(selector->hosts) == 0) )
+    {
+        return false;
+    }
+
+    IB_LIST_LOOP_CONST(selector->hosts, node) {
+        const core_host_t *core_host =
+            (const core_host_t *)ib_list_node_data_const(node);
+
+        if (core_host->match_any || (core_host->host.suffix != NULL)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Index the site selectors by host name.
+ *
+ * Selectors whose hosts are all full host names are added to the
+ * host name hash, once for each host name.  All others (no hosts, wildcard
+ * and suffix hosts) go to a separate list that is always checked.  Both keep
+ * the order of the selector list so that the first match is unchanged.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in,out] core_data Core module data
+ *
+ * @returns Status code
+ */
+static ib_status_t core_ctxsel_index_hosts(
+    const ib_engine_t *ib,
+    ib_core_module_data_t *core_data)
+{
+    assert(ib != NULL);
+    assert(core_data != NULL);
+    assert(core_data->selector_list != NULL);
+
+    ib_mm_t mm = ib_engine_mm_main_get(ib);
+    const ib_list_node_t *node;
+    ib_status_t rc;
+
+    if (core_data->selector_hosts == NULL) {
+        rc = ib_hash_create_nocase(&(core_data->selector_hosts), mm);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        rc = ib_list_create(&(core_data->selector_other), mm);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+    else {
+        ib_hash_clear(core_data->selector_hosts);
+        ib_list_clear(core_data->selector_other);
+    }
+
+    IB_LIST_LOOP_CONST(core_data->selector_list, node) {
+        const core_site_selector_t *selector =
+            (const core_site_selector_t *)ib_list_node_data_const(node);
+        const ib_list_node_t *host_node;
+
+        if (! core_ctxsel_hostname_only(selector)) {
+            rc = ib_list_push(core_data->selector_other, (void *)selector);
+            if (rc != IB_OK) {
+                return rc;
+            }
+            continue;
+        }
+
+        IB_LIST_LOOP_CONST(selector->hosts, host_node) {
+            const core_host_t *core_host =
+                (const core_host_t *)ib_list_node_data_const(host_node);
+            ib_list_t *selectors;
+
+            rc = ib_hash_get_ex(core_data->selector_hosts,
+                                &selectors,
+                                core_host->host.hostname,
+                                core_host->hostname_len);
+            if (rc == IB_ENOENT) {
+                rc = ib_list_create(&selectors, mm);
+                if (rc != IB_OK) {
+                    return rc;
+                }
+                rc = ib_hash_set_ex(core_data->selector_hosts,
+                                    core_host->host.hostname,
+                                    core_host->hostname_len,
+                                    selectors);
+            }
+            if (rc != IB_OK) {
+                return rc;
+            }
+
+            /* A site may list the same host name twice. */
+            if ( (ib_list_elements(selectors) > 0) &&
+                 (ib_list_node_data(ib_list_last(selectors)) == selector) )
+            {
+                continue;
+            }
+            rc = ib_list_push(selectors, (void *)selector);
+            if (rc != IB_OK) {
+                return rc;
+            }
+        }
+    }
+
+    return IB_OK;
+}
+
 /**
  * Finalize the core context selection.
  *
@@ -408,6 +534,13 @@ static ib_status_t core_ctxsel_finalize(
         }
     }
 
+    rc = core_ctxsel_index_hosts(ib, core_data);
+    if (rc != IB_OK) {
+        ib_log_error(ib, "Error indexing core site selectors: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
     return IB_OK;
 }
 
@@ -436,8 +569,11 @@ static ib_status_t core_ctxsel_select(
     assert(common_cb_data != NULL);
     assert(pctx != NULL);
 
-    const ib_list_node_t *node;
+    const ib_list_node_t *host_node = NULL;
+    const ib_list_node_t *other_node;
     size_t ip_len;
+    size_t host_len = 0;
+    size_t path_len;
     ib_status_t rc;
     ib_core_module_data_t *core_data = (ib_core_module_data_t *)common_cb_data;
 
@@ -456,22 +592,54 @@ static ib_status_t core_ctxsel_select(
         goto select_main_context;
     }
 
-    /* Get the length of the IP address string before the main loop */
+    /* Get the length of the strings before the main loop */
     ip_len = strlen(conn->local_ipstr);
+    path_len = (tx->path == NULL) ? 0 : strlen(tx->path);
+    if (tx->hostname != NULL) {
+        const ib_list_t *selectors;
+
+        host_len = strlen(tx->hostname);
+        rc = ib_hash_get_ex(core_data->selector_hosts,
+                            &selectors, tx->hostname, host_len);
+        if (rc == IB_OK) {
+            host_node = ib_list_first_const(selectors);
+        }
+    }
+    other_node = ib_list_first_const(core_data->selector_other);
 
     /*
-     * Walk through the list of site selectors, return when the first matching
-     * selector is found.  At any point in the loop if a non-match is found,
-     * we continue to the top of the loop, and try the next selector.
+     * Walk through the site selectors that may match the host name in order,
+     * return when the first matching selector is found.  These are the
+     * selectors indexed by the host name of the transaction merged with the
+     * selectors that are not indexed.  At any point in the loop if a
+     * non-match is found, we continue to the top of the loop, and try the
+     * next selector.
      */
-    IB_LIST_LOOP_CONST(core_data->selector_list, node) {
-        const core_site_selector_t *selector =
-            (const core_site_selector_t *)ib_list_node_data_const(node);
-        const core_service_t *service = selector->service;
+    while ( (host_node != NULL) || (other_node != NULL) ) {
+        const core_site_selector_t *selector;
+        const core_service_t *service;
         const core_location_t *location;
         ib_context_t *ctx;
         bool match;
 
+        if ( (other_node == NULL) ||
+             ( (host_node != NULL) &&
+               (((const core_site_selector_t *)
+                 ib_list_node_data_const(host_node))->index <
+                ((const core_site_selector_t *)
+                 ib_list_node_data_const(other_node))->index) ) )
+        {
+            selector = (const core_site_selector_t *)
+                ib_list_node_data_const(host_node);
+            host_node = ib_list_node_next_const(host_node);
+        }
+        else {
+            selector = (const core_site_selector_t *)
+                ib_list_node_data_const(other_node);
+            other_node = ib_list_node_next_const(other_node);
+        }
+        service = selector->service;
+
         ib_log_debug2(ib, "Looking for matching context against site=%s(%s)",
                       (selector->site ? selector->site->site.id : "none"),
                       (selector->site ? selector->site->site.name : "none"));
@@ -497,7 +665,7 @@ static ib_status_t core_ctxsel_select(
                       conn->local_ipstr, conn->local_port);
 
         /* Check if the hostname matches the transaction data. */
-        rc = core_ctxsel_match_host(ib, tx, selector->hosts, &match);
+        rc = core_ctxsel_match_host(ib, tx, host_len, selector->hosts, &match);
         if (rc != IB_OK) {
             /* todo: What is the right thing to do here? */
             continue;
@@ -507,7 +675,8 @@ static ib_status_t core_ctxsel_select(
         }
 
         /* Check if the location matches the transaction data. */
-        rc = core_ctxsel_match_location(ib, tx, selector->locations, &location);
+        rc = core_ctxsel_match_location(ib, tx, path_len,
+                                        selector->locations, &location);
         if (rc != IB_OK) {
             /* todo: What is the right thing to do here? */
             continue;
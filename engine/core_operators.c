@@ -303,6 +303,20 @@ struct numop_instance_data_t {
 };
 typedef struct numop_instance_data_t numop_instance_data_t;
 
+/**
+ * Instance data for the "str" family of operators.
+ *
+ * Parameters without var expansions are kept as constant strings so that
+ * they do not have to be expanded for every execution.
+ */
+struct strop_instance_data_t {
+    const ib_var_expand_t *expand;  /**< Expansion; NULL if constant. */
+    const char            *str;     /**< Constant string. */
+    size_t                 str_len; /**< Length of @a str. */
+    const ib_strsearch_t  *search;  /**< Precompiled search for @a str. */
+};
+typedef struct strop_instance_data_t strop_instance_data_t;
+
 /**
  * Create function for the "str" family of operators
  *
@@ -310,7 +324,8 @@ typedef struct numop_instance_data_t numop_instance_data_t;
  * @param[in]  mm Memory manager.
  * @param[in]  parameters Constant parameters
  * @param[out] instance_data Instance Data.
- * @param[in]  cbdata Callback data.
+ * @param[in]  cbdata Callback data; non-NULL to precompile a substring
+ *             search for constant parameters.
  *
  * @returns Status code
  */
@@ -331,6 +346,7 @@ ib_status_t strop_create(
     ib_status_t rc;
     char *str;
     size_t str_len;
+    strop_instance_data_t *data;
 
     if (parameters == NULL) {
         return IB_EINVAL;
@@ -341,23 +357,81 @@ ib_status_t strop_create(
         return rc;
     }
 
-    ib_var_expand_t *data;
-    // @todo Catch and report error_message and error_offset.
-    rc = ib_var_expand_acquire(
-        &data,
-        mm,
-        str, str_len,
-        ib_engine_var_config_get(ib)
-    );
-    if (rc != IB_OK) {
-        return rc;
+    data = ib_mm_calloc(mm, 1, sizeof(*data));
+    if (data == NULL) {
+        return IB_EALLOC;
     }
 
-    *(ib_var_expand_t **)instance_data = data;
+    if (ib_var_expand_test(str, str_len)) {
+        ib_var_expand_t *expand;
+        // @todo Catch and report error_message and error_offset.
+        rc = ib_var_expand_acquire(
+            &expand,
+            mm,
+            str, str_len,
+            ib_engine_var_config_get(ib)
+        );
+        if (rc != IB_OK) {
+            return rc;
+        }
+        data->expand = expand;
+    }
+    else {
+        data->str = str;
+        data->str_len = str_len;
+        if (cbdata != NULL) {
+            ib_strsearch_t *search;
+
+            rc = ib_strsearch_create(&search, mm, str, str_len);
+            if (rc != IB_OK) {
+                return rc;
+            }
+            data->search = search;
+        }
+    }
+
+    *(strop_instance_data_t **)instance_data = data;
 
     return IB_OK;
 }
 
+/**
+ * Get the string of a "str" family operator instance.
+ *
+ * @param[in]  tx Current transaction.
+ * @param[in]  data Instance data.
+ * @param[out] str The constant or expanded string.
+ * @param[out] str_len Length of @a str.
+ *
+ * @returns Status code
+ */
+static
+ib_status_t strop_string(
+    ib_tx_t                     *tx,
+    const strop_instance_data_t *data,
+    const char                 **str,
+    size_t                      *str_len
+)
+{
+    assert(tx != NULL);
+    assert(data != NULL);
+    assert(str != NULL);
+    assert(str_len != NULL);
+
+    if (data->expand == NULL) {
+        *str = data->str;
+        *str_len = data->str_len;
+        return IB_OK;
+    }
+
+    return ib_var_expand_execute(
+        data->expand,
+        str, str_len,
+        tx->mm,
+        tx->var_store
+    );
+}
+
 /**
  * Execute function for the "streq" operator
  *
@@ -393,11 +467,10 @@ ib_status_t op_streq_execute(
     size_t       expanded_length;
 
     /* Expand the string */
-    rc = ib_var_expand_execute(
-        (const ib_var_expand_t *)instance_data,
-        &expanded, &expanded_length,
-        tx->mm,
-        tx->var_store
+    rc = strop_string(
+        tx,
+        (const strop_instance_data_t *)instance_data,
+        &expanded, &expanded_length
     );
     if (rc != IB_OK) {
         return rc;
@@ -503,16 +576,13 @@ ib_status_t op_contains_execute(
 
     ib_status_t  rc = IB_OK;
 
+    const strop_instance_data_t *data =
+        (const strop_instance_data_t *)instance_data;
     const char  *expanded;
     size_t       expanded_length;
 
     /* Expand the string */
-    rc = ib_var_expand_execute(
-        (const ib_var_expand_t *)instance_data,
-        &expanded, &expanded_length,
-        tx->mm,
-        tx->var_store
-    );
+    rc = strop_string(tx, data, &expanded, &expanded_length);
     if (rc != IB_OK) {
         return rc;
     }
@@ -524,7 +594,11 @@ ib_status_t op_contains_execute(
             return rc;
         }
 
-        if (memmem(s, strlen(s), expanded, expanded_length) == NULL) {
+        if (data->search != NULL) {
+            *result =
+                (ib_strsearch_find(data->search, s, strlen(s)) != NULL);
+        }
+        else if (memmem(s, strlen(s), expanded, expanded_length) == NULL) {
             *result = 0;
         }
         else {
@@ -543,13 +617,24 @@ ib_status_t op_contains_execute(
             return IB_OK;
         }
 
-        *result = (
-            ib_strstr(
-                (const char *)ib_bytestr_const_ptr(str),
-                ib_bytestr_length(str),
-                expanded, expanded_length
-            ) != NULL
-        );
+        if (data->search != NULL) {
+            *result = (
+                ib_strsearch_find(
+                    data->search,
+                    (const char *)ib_bytestr_const_ptr(str),
+                    ib_bytestr_length(str)
+                ) != NULL
+            );
+        }
+        else {
+            *result = (
+                ib_strstr(
+                    (const char *)ib_bytestr_const_ptr(str),
+                    ib_bytestr_length(str),
+                    expanded, expanded_length
+                ) != NULL
+            );
+        }
     }
     else {
         return IB_EINVAL;
@@ -2030,7 +2115,8 @@ ib_status_t ib_core_operators_init(ib_engine_t *ib, ib_module_t *mod)
         NULL,
         ib,
         "streq",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_THREAD_SAFE |
+          IB_OP_CAPABILITY_SHAREABLE ),
         strop_create, NULL,
         NULL, NULL,
         op_streq_execute, NULL
@@ -2044,7 +2130,8 @@ ib_status_t ib_core_operators_init(ib_engine_t *ib, ib_module_t *mod)
         NULL,
         ib,
         "istreq",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_THREAD_SAFE |
+          IB_OP_CAPABILITY_SHAREABLE ),
         strop_create, NULL,
         NULL, NULL,
         op_streq_execute, (void *)1
@@ -2058,8 +2145,9 @@ ib_status_t ib_core_operators_init(ib_engine_t *ib, ib_module_t *mod)
         NULL,
         ib,
         "contains",
-        IB_OP_CAPABILITY_CAPTURE,
-        strop_create, NULL,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_THREAD_SAFE |
+          IB_OP_CAPABILITY_SHAREABLE ),
+        strop_create, (void *)1,
         NULL, NULL,
         op_contains_execute, NULL
     );
@@ -2072,7 +2160,7 @@ ib_status_t ib_core_operators_init(ib_engine_t *ib, ib_module_t *mod)
         NULL,
         ib,
         "match",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_SHAREABLE ),
         op_match_create, NULL,
         NULL, NULL,
         op_match_execute, NULL
@@ -2086,7 +2174,7 @@ ib_status_t ib_core_operators_init(ib_engine_t *ib, ib_module_t *mod)
         NULL,
         ib,
         "imatch",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_SHAREABLE ),
         op_match_create, (void *)1,
         NULL, NULL,
         op_match_execute, /* Note: same as above. */ NULL
@@ -2100,7 +2188,7 @@ ib_status_t ib_core_operators_init(ib_engine_t *ib, ib_module_t *mod)
         NULL,
         ib,
         "ipmatch",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_SHAREABLE ),
         op_ipmatch_create, NULL,
         NULL, NULL,
         op_ipmatch_execute, NULL
@@ -2114,7 +2202,7 @@ ib_status_t ib_core_operators_init(ib_engine_t *ib, ib_module_t *mod)
         NULL,
         ib,
         "ipmatch6",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_SHAREABLE ),
         op_ipmatch6_create, NULL,
         NULL, NULL,
         op_ipmatch6_execute, NULL
@@ -2132,7 +2220,7 @@ ib_status_t ib_core_operators_init(ib_engine_t *ib, ib_module_t *mod)
         NULL,
         ib,
         "eq",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_SHAREABLE ),
         op_numcmp_create, op_eq_execute,
         NULL, NULL,
         op_eq_execute, NULL
@@ -2146,7 +2234,7 @@ ib_status_t ib_core_operators_init(ib_engine_t *ib, ib_module_t *mod)
         NULL,
         ib,
         "ne",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_SHAREABLE ),
         op_numcmp_create, op_ne_execute,
         NULL, NULL,
         op_ne_execute, NULL
@@ -2160,7 +2248,7 @@ ib_status_t ib_core_operators_init(ib_engine_t *ib, ib_module_t *mod)
         NULL,
         ib,
         "gt",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_SHAREABLE ),
         op_numcmp_create, op_gt_execute,
         NULL, NULL,
         op_gt_execute, NULL
@@ -2174,7 +2262,7 @@ ib_status_t ib_core_operators_init(ib_engine_t *ib, ib_module_t *mod)
         NULL,
         ib,
         "lt",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_SHAREABLE ),
         op_numcmp_create, op_lt_execute,
         NULL, NULL,
         op_lt_execute, NULL
@@ -2188,7 +2276,7 @@ ib_status_t ib_core_operators_init(ib_engine_t *ib, ib_module_t *mod)
         NULL,
         ib,
         "ge",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_SHAREABLE ),
         op_numcmp_create, op_ge_execute,
         NULL, NULL,
         op_ge_execute, NULL
@@ -2202,7 +2290,7 @@ ib_status_t ib_core_operators_init(ib_engine_t *ib, ib_module_t *mod)
         NULL,
         ib,
         "le",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_SHAREABLE ),
         op_numcmp_create, op_le_execute,
         NULL, NULL,
         op_le_execute, NULL
@@ -45,9 +45,14 @@ typedef struct {
 typedef struct {
     ib_list_t            *site_list;      /**< List: ib_site_t */
     ib_list_t            *selector_list;  /**< List: core_site_selector_t */
+    ib_hash_t            *selector_hosts; /**< Hash: host name => ib_list_t
+                                               of core_site_selector_t */
+    ib_list_t            *selector_other; /**< List: core_site_selector_t not
+                                               indexed by host name */
     ib_context_t         *cur_ctx;        /**< Current context */
     ib_site_t            *cur_site;       /**< Current site */
     ib_site_location_t   *cur_location;   /**< Current location */
+    core_audit_writer_t  *audit_writer;   /**< AuditLogAsync writer or NULL */
 } ib_core_module_data_t;
 
 /** Core module transaction data */
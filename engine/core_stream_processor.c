@@ -34,11 +34,24 @@
 #include <ironbee/mm_mpool_lite.h>
 
 #include <assert.h>
+#include <string.h>
 
 static const char *CORE_PROCESSOR_NAME_REQ = "req_raw";
 static const char *CORE_PROCESSOR_NAME_RESP = "resp_raw";
 static const char *CORE_PROCESSOR_TYPE = "raw";
 
+/**
+ * Data segments shorter than this are copied into a buffer segment.
+ *
+ * Longer segments are referenced, without copying, for the life of the tx.
+ */
+#define CORE_PROCESSOR_COPY_MAX 512
+
+/**
+ * Size of the buffer segments that short data segments are copied into.
+ */
+#define CORE_PROCESSOR_SEGMENT_SIZE 8192
+
 /**
  * The configuration data for a filter.
  */
@@ -152,9 +165,14 @@ static ib_status_t processor_create_resp_fn(
  * extending of this processor's functionality by other
  * static functions.
  *
+ * Long segments are buffered without copying by referencing @a data. Short
+ * segments are copied into shared buffer segments instead, so that chunked
+ * bodies do not keep one IO segment and one stream node per chunk.
+ *
  * @sa processor_exec_fn()
  *
  * @param[in] tx The transaction. For logging.
+ * @param[in] inst Instance data.
  * @param[in] io_tx IO Transaction. Used to reference memory.
  * @param[in] data The data segment. This is referenced if the
  *            data is required to be kept around.
@@ -162,10 +180,6 @@ static ib_status_t processor_create_resp_fn(
  * @param[in] ptr_len Length of the data at @a ptr.
  * @param[in] type The type of @a data. Must be IB_STREAM_IO_DATA or
  *            this does nothing.
- * @param[in] limit The limit of the data to capture.
- * @param[in] stream The stream object to buffer the data into.
- *            Data is aliased by stream's api, so we must increase
- *            the reference count of @a data if we bufffer.
  *
  * @returns
  * - IB_OK On success.
@@ -173,16 +187,18 @@ static ib_status_t processor_create_resp_fn(
  */
 static ib_status_t apply_buffering_to_limit(
     ib_tx_t                    *tx,
+    inst_t                     *inst,
     ib_stream_io_tx_t          *io_tx,
     ib_stream_io_data_t        *data,
     uint8_t                    *ptr,
     size_t                      ptr_len,
-    ib_stream_io_type_t         type,
-    const size_t                limit,
-    ib_stream_t                *stream
+    ib_stream_io_type_t         type
 )
 {
-    ib_status_t rc;
+    ib_stream_t  *stream = inst->stream;
+    const size_t  limit = inst->limit;
+    size_t        len;
+    ib_status_t   rc;
 
     /* If we are handed empty or non-data data (FLUSH data), return OK. */
     if (ptr == NULL || ptr_len == 0 || type != IB_STREAM_IO_DATA) {
@@ -194,27 +210,32 @@ static ib_status_t apply_buffering_to_limit(
         /* Already at the limit. */
         ib_log_debug_tx(
             tx,
-            "Request body log limit (%zd) reached: Ignoring %zd bytes.",
+            "%s body log limit (%zd) reached: Ignoring %zd bytes.",
+            inst->is_request ? "Request" : "Response",
             limit,
             ptr_len);
         return IB_OK;
     }
-    else {
-        /* Check remaining space, adding only what will fit. */
-        const size_t remaining = limit - stream->slen;
 
+    /* Check remaining space, adding only what will fit. */
+    len = limit - stream->slen;
+    if (len > ptr_len) {
+        len = ptr_len;
+    }
+
+    if (len <= CORE_PROCESSOR_COPY_MAX) {
+        rc = ib_stream_append(stream, ptr, len,
+                              CORE_PROCESSOR_SEGMENT_SIZE);
+    }
+    else {
         /* "Say we want a copy of this data forever. */
         ib_stream_io_data_ref(io_tx, data);
 
-        rc = ib_stream_push(
-            stream,
-            IB_STREAM_DATA,
-            ptr,
-            (remaining >= ptr_len)?ptr_len : remaining);
-        if (rc != IB_OK) {
-            ib_log_alert_tx(tx, "Failed to add stream data to tx buffer.");
-            return rc;
-        }
+        rc = ib_stream_push(stream, IB_STREAM_DATA, ptr, len);
+    }
+    if (rc != IB_OK) {
+        ib_log_alert_tx(tx, "Failed to add stream data to tx buffer.");
+        return rc;
     }
 
     return IB_OK;
@@ -271,13 +292,12 @@ static ib_status_t processor_exec_fn(
         /* Buffer data into tx. */
         rc = apply_buffering_to_limit(
             tx,
+            inst,
             io_tx,
             data,
             ptr,
             len,
-            type,
-            inst->limit,
-            inst->stream
+            type
         );
         /* On error, pass the error back. */
         if (rc != IB_OK) {
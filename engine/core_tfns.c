@@ -45,6 +45,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <math.h>
+#include <string.h>
 
 /**
  * Function adapter for many string functions.
@@ -361,6 +362,184 @@ static ib_status_t tfn_wspc_compress(
     return rc;
 }
 
+/**
+ * In-place ASCII lowercase.
+ *
+ * @param[in,out] data Writable data.
+ * @param[in,out] dlen Length of @a data.
+ * @param[in] instdata Instance data. Unused.
+ * @param[in] fndata Callback data. Unused.
+ *
+ * @returns IB_OK.
+ */
+static ib_status_t inplace_lowercase(
+    uint8_t **data,
+    size_t   *dlen,
+    void     *instdata,
+    void     *fndata
+)
+{
+    ib_strlower_inplace(*data, *dlen);
+
+    return IB_OK;
+}
+
+/**
+ * In-place ASCII trim (left).
+ *
+ * @param[in,out] data Writable data.
+ * @param[in,out] dlen Length of @a data.
+ * @param[in] instdata Instance data. Unused.
+ * @param[in] fndata Callback data. Unused.
+ *
+ * @returns IB_OK if successful.
+ */
+static ib_status_t inplace_trim_left(
+    uint8_t **data,
+    size_t   *dlen,
+    void     *instdata,
+    void     *fndata
+)
+{
+    if (*dlen == 0) {
+        return IB_OK;
+    }
+
+    return ib_strtrim_left(*data, *dlen, (const uint8_t **)data, dlen);
+}
+
+/**
+ * In-place ASCII trim (right).
+ *
+ * @param[in,out] data Writable data.
+ * @param[in,out] dlen Length of @a data.
+ * @param[in] instdata Instance data. Unused.
+ * @param[in] fndata Callback data. Unused.
+ *
+ * @returns IB_OK if successful.
+ */
+static ib_status_t inplace_trim_right(
+    uint8_t **data,
+    size_t   *dlen,
+    void     *instdata,
+    void     *fndata
+)
+{
+    if (*dlen == 0) {
+        return IB_OK;
+    }
+
+    return ib_strtrim_right(*data, *dlen, (const uint8_t **)data, dlen);
+}
+
+/**
+ * In-place ASCII trim (both sides).
+ *
+ * @param[in,out] data Writable data.
+ * @param[in,out] dlen Length of @a data.
+ * @param[in] instdata Instance data. Unused.
+ * @param[in] fndata Callback data. Unused.
+ *
+ * @returns IB_OK if successful.
+ */
+static ib_status_t inplace_trim(
+    uint8_t **data,
+    size_t   *dlen,
+    void     *instdata,
+    void     *fndata
+)
+{
+    if (*dlen == 0) {
+        return IB_OK;
+    }
+
+    return ib_strtrim_lr(*data, *dlen, (const uint8_t **)data, dlen);
+}
+
+/**
+ * In-place whitespace removal.
+ *
+ * @param[in,out] data Writable data.
+ * @param[in,out] dlen Length of @a data.
+ * @param[in] instdata Instance data. Unused.
+ * @param[in] fndata Callback data. Unused.
+ *
+ * @returns IB_OK.
+ */
+static ib_status_t inplace_wspc_remove(
+    uint8_t **data,
+    size_t   *dlen,
+    void     *instdata,
+    void     *fndata
+)
+{
+    ib_str_whitespace_remove_inplace(*data, dlen);
+
+    return IB_OK;
+}
+
+/**
+ * In-place whitespace compression.
+ *
+ * @param[in,out] data Writable data.
+ * @param[in,out] dlen Length of @a data.
+ * @param[in] instdata Instance data. Unused.
+ * @param[in] fndata Callback data. Unused.
+ *
+ * @returns IB_OK.
+ */
+static ib_status_t inplace_wspc_compress(
+    uint8_t **data,
+    size_t   *dlen,
+    void     *instdata,
+    void     *fndata
+)
+{
+    ib_str_whitespace_compress_inplace(*data, dlen);
+
+    return IB_OK;
+}
+
+/**
+ * Create and register a transformation that can also execute in place.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in] name Name.
+ * @param[in] execute_fn Execute function.
+ * @param[in] inplace_fn In-place execute function.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ * - IB_EINVAL if a transformation with same name exists.
+ */
+static ib_status_t register_inplace_tfn(
+    ib_engine_t                    *ib,
+    const char                     *name,
+    ib_transformation_execute_fn_t  execute_fn,
+    ib_transformation_inplace_fn_t  inplace_fn
+)
+{
+    ib_transformation_t *tfn;
+    ib_status_t          rc;
+
+    rc = ib_transformation_create(
+        &tfn,
+        ib_engine_mm_main_get(ib),
+        name,
+        false,
+        NULL,       NULL,
+        NULL,       NULL,
+        execute_fn, NULL
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+    ib_transformation_inplace_set(tfn, inplace_fn, NULL);
+
+    return ib_transformation_register(ib, tfn);
+}
+
 /**
  * Length transformation
  *
@@ -743,6 +922,64 @@ static ib_status_t tfn_min(
     return rc;
 }
 
+/**
+ * Length of the prefix of @a data that URL decoding leaves unchanged.
+ *
+ * @param[in] data Data.
+ * @param[in] dlen Length of @a data.
+ *
+ * @returns Offset of the first '%' or '+' in @a data, or @a dlen if none.
+ */
+static size_t url_decode_skip(
+    const uint8_t *data,
+    size_t         dlen
+)
+{
+    size_t i;
+
+    for (i = 0; i < dlen; ++i) {
+        if (data[i] == '%' || data[i] == '+') {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/**
+ * In-place URL decode.
+ *
+ * @param[in,out] data Writable data.
+ * @param[in,out] dlen Length of @a data.
+ * @param[in] instdata Instance data. Unused.
+ * @param[in] fndata Callback data. Unused.
+ *
+ * @returns IB_OK if successful.
+ */
+static ib_status_t inplace_url_decode(
+    uint8_t **data,
+    size_t   *dlen,
+    void     *instdata,
+    void     *fndata
+)
+{
+    size_t      skip = url_decode_skip(*data, *dlen);
+    size_t      len;
+    ib_status_t rc;
+
+    if (skip == *dlen) {
+        return IB_OK;
+    }
+
+    rc = ib_util_decode_url(*data + skip, *dlen - skip, *data + skip, &len);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    *dlen = skip + len;
+
+    return IB_OK;
+}
+
 /**
  * URL Decode transformation
  *
@@ -777,6 +1014,7 @@ static ib_status_t tfn_url_decode(
         const uint8_t      *din;
         uint8_t            *dout;
         size_t              dlen;
+        size_t              skip;
 
         rc = ib_field_value(fin, ib_ftype_bytestr_out(&bs));
         if (rc != IB_OK) {
@@ -794,19 +1032,27 @@ static ib_status_t tfn_url_decode(
             return IB_OK;
         }
 
+        if (din == NULL) {
+            return IB_EINVAL;
+        }
+
+        /* Most values have nothing to decode; pass them through unchanged. */
+        skip = url_decode_skip(din, dlen);
+        if (skip == dlen) {
+            *fout = fin;
+            return IB_OK;
+        }
+
         dout = ib_mm_alloc(mm, dlen + 1);
         if (dout == NULL) {
             return IB_EALLOC;
         }
-        if (din == NULL && dlen > 0) {
-            return IB_EINVAL;
-        }
-        if (din != NULL) {
-            rc = ib_util_decode_url(din, dlen, dout, &dlen);
-            if (rc != IB_OK) {
-                return rc;
-            }
+        memcpy(dout, din, skip);
+        rc = ib_util_decode_url(din + skip, dlen - skip, dout + skip, &dlen);
+        if (rc != IB_OK) {
+            return rc;
         }
+        dlen += skip;
         rc = ib_field_create_bytestr_alias(&fnew, mm,
                                            fin->name, fin->nlen,
                                            dout, dlen);
@@ -1630,79 +1876,61 @@ ib_status_t ib_core_transformations_init(ib_engine_t *ib, ib_module_t *mod)
     }
 
     /* Define transformations. */
-    rc = ib_transformation_create_and_register(
-        NULL,
+    rc = register_inplace_tfn(
         ib,
         "lowercase",
-        false,
-        NULL,          NULL,
-        NULL,          NULL,
-        tfn_lowercase, NULL
+        tfn_lowercase,
+        inplace_lowercase
     );
     if (rc != IB_OK) {
         return rc;
     }
 
-    rc = ib_transformation_create_and_register(
-        NULL,
+    rc = register_inplace_tfn(
         ib,
         "trimLeft",
-        false,
-        NULL, NULL,
-        NULL, NULL,
-        tfn_trim_left, NULL
+        tfn_trim_left,
+        inplace_trim_left
     );
     if (rc != IB_OK) {
         return rc;
     }
 
-    rc = ib_transformation_create_and_register(
-        NULL,
+    rc = register_inplace_tfn(
         ib,
         "trimRight",
-        false,
-        NULL, NULL,
-        NULL, NULL,
-        tfn_trim_right, NULL
+        tfn_trim_right,
+        inplace_trim_right
     );
     if (rc != IB_OK) {
         return rc;
     }
 
-    rc = ib_transformation_create_and_register(
-        NULL,
+    rc = register_inplace_tfn(
         ib,
         "trim",
-        false,
-        NULL, NULL,
-        NULL, NULL,
-        tfn_trim, NULL
+        tfn_trim,
+        inplace_trim
     );
     if (rc != IB_OK) {
         return rc;
     }
 
-    rc = ib_transformation_create_and_register(
-        NULL,
+    rc = register_inplace_tfn(
         ib,
         "removeWhitespace",
-        false,
-        NULL, NULL,
-        NULL, NULL,
-        tfn_wspc_remove, NULL
+        tfn_wspc_remove,
+        inplace_wspc_remove
     );
     if (rc != IB_OK) {
         return rc;
     }
 
-    rc = ib_transformation_create_and_register(
-        NULL,
+    rc = register_inplace_tfn(
         ib,
         "compressWhitespace",
-        false,
-        NULL, NULL,
-        NULL, NULL,
-        tfn_wspc_compress, NULL
+        tfn_wspc_compress,
+        inplace_wspc_compress
     );
     if (rc != IB_OK) {
         return rc;
@@ -1760,14 +1988,11 @@ ib_status_t ib_core_transformations_init(ib_engine_t *ib, ib_module_t *mod)
         return rc;
     }
 
-    rc = ib_transformation_create_and_register(
-        NULL,
+    rc = register_inplace_tfn(
         ib,
         "urlDecode",
-        false,
-        NULL, NULL,
-        NULL, NULL,
-        tfn_url_decode, NULL
+        tfn_url_decode,
+        inplace_url_decode
     );
     if (rc != IB_OK) {
         return rc;
@@ -31,6 +31,7 @@
 
 #include "core_private.h"
 #include "module_private.h"
+#include "probes_private.h"
 #include "rule_engine_private.h"
 #include "state_notify_private.h"
 
@@ -54,6 +55,7 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -214,16 +216,38 @@ static ib_status_t ib_hook_register(
 
     ib_status_t           rc;
     ib_list_t            *list;
+    ib_hook_t            *table;
+    const ib_list_node_t *node;
+    size_t                i;
 
     list = ib->hooks[state];
     assert(list != NULL);
 
+    /* Hooks belong to the module being initialized, for profiling. */
+    hook->module = ib->module_initializing;
+
     /* Insert the hook at the end of the list */
     rc = ib_list_push(list, hook);
     if (rc != IB_OK) {
         return rc;
     }
 
+    /* Rebuild the flat table of the state.  The previous table is left
+     * alone as a notification may be iterating it. */
+    table = ib_mm_alloc(
+        ib_engine_mm_main_get(ib),
+        ib_list_elements(list) * sizeof(*table));
+    if (table == NULL) {
+        return IB_EALLOC;
+    }
+    i = 0;
+    IB_LIST_LOOP_CONST(list, node) {
+        table[i] = *(const ib_hook_t *)ib_list_node_data_const(node);
+        ++i;
+    }
+    ib->hook_tables[state] = table;
+    ib->hook_counts[state] = i;
+
     return IB_OK;
 }
 
@@ -485,6 +509,12 @@ ib_status_t ib_engine_create(ib_engine_t **pib,
         goto failed;
     }
 
+    /* Create a hash to hold shared operator instances */
+    rc = ib_hash_create(&(ib->operator_insts), mm);
+    if (rc != IB_OK) {
+        goto failed;
+    }
+
     /* Create a hash to hold actions by name */
     rc = ib_hash_create_nocase(&(ib->actions), mm);
     if (rc != IB_OK) {
@@ -499,6 +529,28 @@ ib_status_t ib_engine_create(ib_engine_t **pib,
         return rc;
     }
 
+    /* Create the lock of the connection pool cache. */
+    rc = ib_lock_create(&(ib->conn_pool_lock), mm);
+    if (rc != IB_OK) {
+        goto failed;
+    }
+
+    /* Create the lock guarding creation of the thread pool. */
+    rc = ib_lock_create(&(ib->thread_pool_lock), mm);
+    if (rc != IB_OK) {
+        goto failed;
+    }
+
+    /* Create the interned strings. */
+    rc = ib_lock_create(&(ib->strings_lock), mm);
+    if (rc != IB_OK) {
+        goto failed;
+    }
+    rc = ib_hash_create(&(ib->strings), mm);
+    if (rc != IB_OK) {
+        goto failed;
+    }
+
     /* Initialize the hook lists */
     for (state = conn_started_state; state < IB_STATE_NUM; ++state) {
         rc = ib_list_create(&(ib->hooks[state]), mm);
@@ -541,6 +593,11 @@ ib_status_t ib_engine_create(ib_engine_t **pib,
                      ib_status_to_string(rc));
         goto failed;
     }
+    rc = ib_engine_module_get(ib, ib_core_module_sym()->name,
+                              &(ib->core_module));
+    if (rc != IB_OK) {
+        goto failed;
+    }
 
     /* Initialize the rule engine */
     rc = ib_rule_engine_init(ib);
@@ -727,6 +784,27 @@ ib_status_t ib_engine_cfgparser_get(const ib_engine_t *ib,
 }
 
 
+void ib_engine_metrics_get(
+    const ib_engine_t   *ib,
+    ib_engine_metrics_t *metrics
+)
+{
+    assert(ib != NULL);
+    assert(metrics != NULL);
+
+#define METRIC_LOAD(counter) \
+    metrics->counter = __atomic_load_n(&(ib->metrics.counter), \
+                                       __ATOMIC_RELAXED)
+    METRIC_LOAD(conns_opened);
+    METRIC_LOAD(conns_closed);
+    METRIC_LOAD(txs_started);
+    METRIC_LOAD(txs_finished);
+    METRIC_LOAD(txs_blocked);
+    METRIC_LOAD(request_body_bytes);
+    METRIC_LOAD(response_body_bytes);
+#undef METRIC_LOAD
+}
+
 ib_mm_t ib_engine_mm_main_get(const ib_engine_t *ib)
 {
     return ib_mm_mpool(ib->mp);
@@ -945,6 +1023,10 @@ void ib_engine_destroy(ib_engine_t *ib)
 
     /// @todo Destroy filters
 
+    /* Queued tasks may use anything below, so finish them first. */
+    ib_thread_pool_destroy(ib->thread_pool);
+    ib->thread_pool = NULL;
+
     IB_LIST_LOOP_REVERSE(ib->contexts, node) {
         ib_context_t *ctx = (ib_context_t *)ib_list_node_data(node);
         if ( (ctx != ib->ctx) && (ctx != ib->ectx) ) {
@@ -971,6 +1053,12 @@ void ib_engine_destroy(ib_engine_t *ib)
     /* Close the loggers. */
     ib_logger_close(ib->logger);
 
+    /* Destroy the connection pools kept for reuse. */
+    for (idx = 0; idx < ib->conn_pool_count; ++idx) {
+        ib_mpool_destroy(ib->conn_pools[idx]);
+    }
+    ib->conn_pool_count = 0;
+
 #ifdef IB_DEBUG_MEMORY
     /* We can't use ib_engine_pool_destroy here as too little of the
      * the engine is left.
@@ -992,6 +1080,77 @@ void ib_engine_destroy(ib_engine_t *ib)
     return;
 }
 
+ib_status_t ib_engine_thread_pool_get(
+    ib_engine_t       *ib,
+    ib_thread_pool_t **pool
+)
+{
+    assert(ib != NULL);
+    assert(pool != NULL);
+
+    ib_thread_pool_t *thread_pool;
+    ib_status_t       rc = IB_OK;
+
+    thread_pool = __atomic_load_n(&(ib->thread_pool), __ATOMIC_ACQUIRE);
+    if (thread_pool == NULL) {
+        rc = ib_lock_lock(ib->thread_pool_lock);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        thread_pool = ib->thread_pool;
+        if (thread_pool == NULL) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+            rc = ib_thread_pool_create(&thread_pool,
+                                       (cpus > 0) ? (size_t)cpus : 1);
+            if (rc == IB_OK) {
+                __atomic_store_n(&(ib->thread_pool), thread_pool,
+                                 __ATOMIC_RELEASE);
+            }
+        }
+        ib_lock_unlock(ib->thread_pool_lock);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    *pool = thread_pool;
+
+    return IB_OK;
+}
+
+const char *ib_engine_intern(
+    ib_engine_t *ib,
+    const char  *str
+)
+{
+    assert(ib != NULL);
+
+    const char  *interned = NULL;
+    ib_status_t  rc;
+
+    if (str == NULL) {
+        return NULL;
+    }
+
+    if (ib_lock_lock(ib->strings_lock) != IB_OK) {
+        return NULL;
+    }
+    rc = ib_hash_get(ib->strings, &interned, str);
+    if (rc == IB_ENOENT) {
+        char *copy = ib_mm_strdup(ib_engine_mm_main_get(ib), str);
+
+        if ( (copy != NULL) &&
+             (ib_hash_set(ib->strings, copy, copy) == IB_OK) )
+        {
+            interned = copy;
+        }
+    }
+    ib_lock_unlock(ib->strings_lock);
+
+    return interned;
+}
+
 const char *ib_engine_instance_id(
     const ib_engine_t *ib)
 {
@@ -1007,18 +1166,30 @@ ib_status_t ib_conn_create(ib_engine_t *ib,
                            ib_conn_t **pconn,
                            void *server_ctx)
 {
-    ib_mpool_t *pool;
+    ib_mpool_t *pool = NULL;
     ib_status_t rc;
     char namebuf[64];
     ib_conn_t *conn = NULL;
     ib_mm_t mm;
 
-    /* Create a sub-pool for each connection and allocate from it */
+    /* Reuse the pool of a destroyed connection if there is one.  It keeps
+     * its pages and the released pools of its transactions. */
+    if (ib_lock_lock(ib->conn_pool_lock) == IB_OK) {
+        if (ib->conn_pool_count > 0) {
+            --ib->conn_pool_count;
+            pool = ib->conn_pools[ib->conn_pool_count];
+        }
+        ib_lock_unlock(ib->conn_pool_lock);
+    }
+
+    /* Otherwise create a pool for the connection and allocate from it */
     /// @todo Need to tune the pool size
-    rc = ib_mpool_create(&pool, "conn", NULL);
-    if (rc != IB_OK) {
-        rc = IB_EALLOC;
-        goto failed;
+    if (pool == NULL) {
+        rc = ib_mpool_create(&pool, "conn", NULL);
+        if (rc != IB_OK) {
+            rc = IB_EALLOC;
+            goto failed;
+        }
     }
     mm = ib_mm_mpool(pool);
 
@@ -1052,13 +1223,15 @@ ib_status_t ib_conn_create(ib_engine_t *ib,
     }
 
     *pconn = conn;
+    IB_ENGINE_METRIC_ADD(ib->metrics.conns_opened, 1);
+    IB_PROBE1(conn_create, conn->id);
 
     return IB_OK;
 
 failed:
     /* Make sure everything is cleaned up on failure */
-    if (conn != NULL) {
-        ib_engine_pool_destroy(ib, conn->mp);
+    if (pool != NULL) {
+        ib_engine_pool_destroy(ib, pool);
     }
     conn = NULL;
 
@@ -1100,12 +1273,68 @@ ib_status_t ib_conn_set_module_data(
   return rc;
 }
 
+/**
+ * Keep the memory pool of a destroyed connection for reuse.
+ *
+ * The pool is cleared, which runs its cleanups and those of its transaction
+ * pools but keeps their memory.
+ *
+ * @param[in] ib Engine.
+ * @param[in] mp Connection memory pool.
+ *
+ * @returns true if @a mp was kept, false if it must be destroyed.
+ */
+static bool conn_pool_recycle(ib_engine_t *ib, ib_mpool_t *mp)
+{
+    assert(ib != NULL);
+    assert(mp != NULL);
+
+#ifdef IB_DEBUG_MEMORY
+    /* Destroy pools so that their usage is always reported. */
+    return false;
+#else
+    bool kept = false;
+
+    if (ib_mpool_inuse(mp) > IB_CONN_POOL_CACHE_MAX_INUSE) {
+        return false;
+    }
+
+    /* Unlocked pre-check; checked again under the lock. */
+    if (ib->conn_pool_count >= IB_CONN_POOL_CACHE_SIZE) {
+        return false;
+    }
+
+    ib_mpool_clear(mp);
+
+    if (ib_lock_lock(ib->conn_pool_lock) != IB_OK) {
+        return false;
+    }
+    if (ib->conn_pool_count < IB_CONN_POOL_CACHE_SIZE) {
+        ib->conn_pools[ib->conn_pool_count] = mp;
+        ++ib->conn_pool_count;
+        kept = true;
+    }
+    ib_lock_unlock(ib->conn_pool_lock);
+
+    return kept;
+#endif
+}
+
 void ib_conn_destroy(ib_conn_t *conn)
 {
     /// @todo Probably need to update state???
     if ( conn != NULL && conn->mp != NULL ) {
-        ib_engine_pool_destroy(conn->ib, conn->mp);
-        /* Don't do this: conn->mp = NULL; conn is now freed memory! */
+        ib_engine_t *ib = conn->ib;
+        ib_mpool_t  *mp = conn->mp;
+
+        IB_ENGINE_METRIC_ADD(ib->metrics.conns_closed, 1);
+        IB_PROBE1(conn_destroy, conn->id);
+
+        /* Only pools without live transaction pools are reused.
+         * Don't use conn after this; it is freed memory! */
+        if ( (conn->tx_first != NULL) || ! conn_pool_recycle(ib, mp) ) {
+            ib_engine_pool_destroy(ib, mp);
+        }
     }
 }
 
@@ -1173,6 +1402,13 @@ ib_status_t ib_tx_create(ib_tx_t **ptx,
     tx->is_allowed = false;
     tx->block_applied = false;
 
+    /* The selected context may change the limit. */
+    if (corecfg->limits.tx_memory_limit > 0) {
+        ib_mpool_limit_set(pool, corecfg->limits.tx_memory_limit);
+    }
+    tx->limits.request_body_inspect_limit = -1;
+    tx->limits.response_body_inspect_limit = -1;
+
     ++conn->tx_count;
     ib_tx_generate_id(tx);
 
@@ -1251,6 +1487,9 @@ ib_status_t ib_tx_create(ib_tx_t **ptx,
         ib_tx_flags_set(tx, IB_TX_FPIPELINED);
     }
 
+    IB_ENGINE_METRIC_ADD(ib->metrics.txs_started, 1);
+    IB_PROBE2(tx_create, tx->id, conn->id);
+
     /* Only when we are successful, commit changes to output variable. */
     *ptx = tx;
 
@@ -1316,6 +1555,143 @@ ib_stream_pump_t *ib_tx_request_body_pump(ib_tx_t *tx) {
     return tx->request_body_pump;
 }
 
+/**
+ * Work started by ib_tx_async_start().
+ */
+struct ib_tx_async_t {
+    ib_tx_async_fn_t  fn;     /**< Work function. */
+    void             *cbdata; /**< Callback data for @ref fn. */
+    pthread_mutex_t   mutex;  /**< Guards @ref done and @ref status. */
+    pthread_cond_t    cond;   /**< Signals @ref done. */
+    bool              done;   /**< Has @ref fn returned? */
+    ib_status_t       status; /**< Return of @ref fn. */
+};
+
+/**
+ * Run the work of an ib_tx_async_t.
+ *
+ * @param[in] cbdata The ib_tx_async_t.
+ */
+static void tx_async_run(void *cbdata)
+{
+    assert(cbdata != NULL);
+
+    ib_tx_async_t *async = (ib_tx_async_t *)cbdata;
+    ib_status_t    rc;
+
+    rc = async->fn(async->cbdata);
+
+    pthread_mutex_lock(&(async->mutex));
+    async->status = rc;
+    async->done = true;
+    pthread_cond_broadcast(&(async->cond));
+    pthread_mutex_unlock(&(async->mutex));
+}
+
+/**
+ * Wait for the work of an ib_tx_async_t and destroy it.
+ *
+ * Registered as a cleanup of the transaction memory manager.
+ *
+ * @param[in] cbdata The ib_tx_async_t.
+ */
+static void tx_async_cleanup(void *cbdata)
+{
+    assert(cbdata != NULL);
+
+    ib_tx_async_t *async = (ib_tx_async_t *)cbdata;
+
+    ib_tx_async_wait(async);
+    pthread_cond_destroy(&(async->cond));
+    pthread_mutex_destroy(&(async->mutex));
+}
+
+ib_status_t ib_tx_async_start(
+    ib_tx_t           *tx,
+    ib_tx_async_fn_t   fn,
+    void              *cbdata,
+    ib_tx_async_t    **async
+)
+{
+    assert(tx != NULL);
+    assert(fn != NULL);
+    assert(async != NULL);
+
+    ib_tx_async_t    *new_async;
+    ib_thread_pool_t *pool;
+    ib_status_t       rc;
+
+    new_async = ib_mm_alloc(tx->mm, sizeof(*new_async));
+    if (new_async == NULL) {
+        return IB_EALLOC;
+    }
+    new_async->fn = fn;
+    new_async->cbdata = cbdata;
+    new_async->done = false;
+    new_async->status = IB_OK;
+
+    if (pthread_mutex_init(&(new_async->mutex), NULL) != 0) {
+        return IB_EOTHER;
+    }
+    if (pthread_cond_init(&(new_async->cond), NULL) != 0) {
+        pthread_mutex_destroy(&(new_async->mutex));
+        return IB_EOTHER;
+    }
+    rc = ib_mm_register_cleanup(tx->mm, tx_async_cleanup, new_async);
+    if (rc != IB_OK) {
+        pthread_cond_destroy(&(new_async->cond));
+        pthread_mutex_destroy(&(new_async->mutex));
+        return rc;
+    }
+
+    rc = ib_engine_thread_pool_get(tx->ib, &pool);
+    if (rc == IB_OK) {
+        rc = ib_thread_pool_submit(pool, tx_async_run, new_async);
+    }
+    if (rc != IB_OK) {
+        ib_log_debug_tx(tx, "Running asynchronous work synchronously: %s",
+                        ib_status_to_string(rc));
+        tx_async_run(new_async);
+    }
+
+    *async = new_async;
+
+    return IB_OK;
+}
+
+bool ib_tx_async_done(
+    ib_tx_async_t *async
+)
+{
+    assert(async != NULL);
+
+    bool done;
+
+    pthread_mutex_lock(&(async->mutex));
+    done = async->done;
+    pthread_mutex_unlock(&(async->mutex));
+
+    return done;
+}
+
+ib_status_t ib_tx_async_wait(
+    ib_tx_async_t *async
+)
+{
+    assert(async != NULL);
+
+    ib_status_t rc;
+
+    pthread_mutex_lock(&(async->mutex));
+    while (! async->done) {
+        pthread_cond_wait(&(async->cond), &(async->mutex));
+    }
+    rc = async->status;
+    pthread_mutex_unlock(&(async->mutex));
+
+    return rc;
+}
+
 ib_status_t ib_tx_server_error(
     ib_tx_t *tx,
     int status
@@ -1404,6 +1780,12 @@ void ib_tx_destroy(ib_tx_t *tx)
         }
     }
 
+    if (ib_mpool_limit_reached(tx->mp)) {
+        ib_log_notice_tx(tx,
+                         "Transaction memory limit of %zu bytes reached.",
+                         ib_mpool_limit(tx->mp));
+    }
+
     /* Find the tx in the list */
     for (curr = conn->tx_first; curr != NULL; curr = curr->next) {
         if (curr == tx) {
@@ -1428,6 +1810,17 @@ void ib_tx_destroy(ib_tx_t *tx)
         prev->next = tx->next;
     }
 
+    IB_ENGINE_METRIC_ADD(tx->ib->metrics.txs_finished, 1);
+    if (tx->is_blocked) {
+        IB_ENGINE_METRIC_ADD(tx->ib->metrics.txs_blocked, 1);
+    }
+    IB_ENGINE_METRIC_ADD(tx->ib->metrics.request_body_bytes,
+                         tx->request_body_len);
+    IB_ENGINE_METRIC_ADD(tx->ib->metrics.response_body_bytes,
+                         tx->response_body_len);
+    IB_PROBE4(tx_destroy, tx->id, tx->is_blocked,
+              tx->request_body_len, tx->response_body_len);
+
     /// @todo Probably need to update state???
     ib_engine_pool_release(tx->ib, tx->mp);
 }
@@ -1522,6 +1915,7 @@ ib_status_t ib_tx_block(ib_tx_t *tx)
     /* If we reach here, update the truths we know. */
     tx->is_blocked = true;
     tx->is_allowed = false;
+    IB_PROBE1(tx_block, tx->id);
 
     /* Update the flags for legacy use (advisory until it is applied). */
     ib_tx_flags_set(tx, IB_TX_FBLOCK_ADVISORY);
@@ -2196,12 +2590,6 @@ ib_status_t ib_context_create(ib_engine_t *ib,
         goto failed;
     }
 
-    /* Create an array to hold the module config data */
-    rc = ib_array_create(&(ctx->cfgdata), ctx->mm, 16, 8);
-    if (rc != IB_OK) {
-        goto failed;
-    }
-
     /* Create a list to hold the enabled filters */
     rc = ib_list_create(&(ctx->filters), ctx->mm);
     if (rc != IB_OK) {
@@ -2214,12 +2602,6 @@ ib_status_t ib_context_create(ib_engine_t *ib,
         goto failed;
     }
 
-    /* Create a hash to hold the module-specific data */
-    rc = ib_array_create(&(ctx->cfgdata), ctx->mm, 16, 8);
-    if (rc != IB_OK) {
-        goto failed;
-    }
-
     /* Add myself to my parent's child list */
     if (parent != NULL) {
         rc = ib_list_push(parent->children, ctx);
@@ -2664,14 +3046,13 @@ ib_status_t ib_context_module_config(const ib_context_t *ctx,
                                      void *pcfg)
 {
     ib_context_data_t *cfgdata;
-    ib_status_t rc;
 
-    rc = ib_array_get(ctx->cfgdata, m->idx, (void *)&cfgdata);
-    if (rc != IB_OK) {
+    if (m->idx >= ctx->cfgdata_size) {
         *(void **)pcfg = NULL;
-        return rc;
+        return IB_ENOENT;
     }
 
+    cfgdata = ctx->cfgdata[m->idx];
     if (cfgdata == NULL) {
         *(void **)pcfg = NULL;
         return IB_EINVAL;
@@ -44,14 +44,53 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 /* The manager's engine wrapper type */
 typedef struct ib_manager_engine_t ib_manager_engine_t;
 
+/**
+ * A named engine in a @ref manager_snapshot_t.
+ */
+struct manager_snapshot_name_t {
+    const char          *name;    /**< Engine name. */
+    ib_manager_engine_t *wrapper; /**< Current engine for @a name. */
+};
+typedef struct manager_snapshot_name_t manager_snapshot_name_t;
+
+/**
+ * Read-only view of the manager's engines used by acquire and release.
+ *
+ * Snapshots are built by the thread holding the manager lock and published
+ * by swapping ib_manager_t::snapshot.  Readers use them without taking the
+ * manager lock, inside a manager_read_lock()/manager_read_unlock() section.
+ * A replaced snapshot is freed only after all readers that could have seen it
+ * have left their sections; see manager_synchronize().
+ *
+ * The snapshot memory is a single malloc() block.
+ */
+struct manager_snapshot_t {
+    size_t                    name_count;   /**< Length of @a names. */
+    manager_snapshot_name_t  *names;        /**< Current named engines. */
+    size_t                    engine_count; /**< Length of @a engines. */
+    /**
+     * All managed engines.
+     *
+     * The engine pointers are stored here so that release can find its
+     * wrapper without dereferencing the wrappers of other, possibly
+     * destroyed, engines.
+     */
+    ib_engine_t             **engines;
+    ib_manager_engine_t     **wrappers;     /**< Wrappers for @a engines. */
+};
+typedef struct manager_snapshot_t manager_snapshot_t;
+
 /**
  * Struct to hold post config callback functions.
  */
@@ -98,6 +137,31 @@ struct ib_manager_t {
     size_t                max_engines;    /**< The maximum number of engines */
     ib_lock_t            *manager_lck;    /**< Protect access to the mgr. */
 
+    /**
+     * Serializes engine builds.
+     *
+     * Engines are built without ib_manager_t::manager_lck held, so that a
+     * build does not block the rest of the manager.
+     */
+    ib_lock_t            *build_lck;
+
+    /**
+     * Engines being built; they hold a reserved slot in the engine list.
+     *
+     * Protected by ib_manager_t::manager_lck.
+     */
+    size_t                engines_pending;
+
+    /**
+     * Number of background build threads.
+     *
+     * Protected by ib_manager_t::manager_lck.
+     */
+    size_t                builders;
+
+    /** Signaled with ib_manager_t::manager_lck when a builder exits. */
+    pthread_cond_t        builders_cond;
+
     /**
      * A mapping from a name (const char *) to an ib_manager_engine_t *.
      *
@@ -123,6 +187,51 @@ struct ib_manager_t {
 
     //! A list of @ref manager_engine_postconfig_t.
     ib_list_t *postconfig_functions;
+
+    /**
+     * Current engine snapshot, read without the manager lock.
+     *
+     * Written only by the holder of ib_manager_t::manager_lck.
+     */
+    manager_snapshot_t *snapshot;
+
+    /**
+     * Readers inside a read section, per epoch.
+     *
+     * @sa manager_read_lock()
+     */
+    size_t readers[2];
+
+    /** Current reader epoch; 0 or 1. */
+    unsigned int epoch;
+
+    /**
+     * Incremented each time a snapshot is published.
+     *
+     * Engine caches compare against this to tell that their engine may no
+     * longer be current.
+     */
+    size_t generation;
+
+    /**
+     * Has a retired engine lost its last reference?  Accessed atomically.
+     *
+     * @sa manager_reclaim()
+     */
+    bool reclaim;
+};
+
+/**
+ * A per-thread current engine.
+ *
+ * @sa ib_manager_engine_cache_create()
+ */
+struct ib_manager_engine_cache_t {
+    ib_manager_t        *manager;    /**< The manager. */
+    const char          *name;       /**< Engine name; owned by the cache. */
+    ib_manager_engine_t *wrapper;    /**< Cached engine or NULL. */
+    size_t               uses;       /**< Acquisitions not yet released. */
+    size_t               generation; /**< Generation @a wrapper is from. */
 };
 
 /**
@@ -140,6 +249,9 @@ struct ib_manager_engine_t {
      * represents the manager's use of that engine as the current engine.
      * Other engines may have a reference count as low as zero. If an
      * engine's reference count is zero, it may be cleaned up.
+     *
+     * Always accessed atomically: acquire and release do not take the
+     * manager lock.
      */
     size_t        ref_count;
 
@@ -147,8 +259,170 @@ struct ib_manager_engine_t {
      * When this engine was created. From this you can compute uptime.
      */
     ib_time_t     created;
+
+    /**
+     * Has another engine replaced this one?  Accessed atomically.
+     *
+     * @sa ib_manager_engine_retired()
+     */
+    bool          retired;
 };
 
+/**
+ * Enter a read section.
+ *
+ * While inside a read section the current ib_manager_t::snapshot and the
+ * engine wrappers it names are not freed.
+ *
+ * @param[in] manager The manager.
+ *
+ * @returns The epoch to pass to manager_read_unlock().
+ */
+static unsigned int manager_read_lock(ib_manager_t *manager)
+{
+    for (;;) {
+        unsigned int epoch = __atomic_load_n(&(manager->epoch),
+                                             __ATOMIC_SEQ_CST);
+
+        __atomic_add_fetch(&(manager->readers[epoch]), 1, __ATOMIC_SEQ_CST);
+
+        /* If a writer flipped the epoch meanwhile, it may not wait for us. */
+        if (__atomic_load_n(&(manager->epoch), __ATOMIC_SEQ_CST) == epoch) {
+            return epoch;
+        }
+
+        __atomic_sub_fetch(&(manager->readers[epoch]), 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+/**
+ * Leave a read section.
+ *
+ * @param[in] manager The manager.
+ * @param[in] epoch Value returned by manager_read_lock().
+ */
+static void manager_read_unlock(ib_manager_t *manager, unsigned int epoch)
+{
+    __atomic_sub_fetch(&(manager->readers[epoch]), 1, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Wait until all read sections that began before this call have ended.
+ *
+ * Readers entering after the epoch flip count against the new epoch, so a
+ * steady stream of readers can not starve the caller.  Read sections are a
+ * handful of instructions long, so yielding is enough.
+ *
+ * The caller must hold the manager lock.
+ *
+ * @param[in] manager The manager.
+ */
+static void manager_synchronize(ib_manager_t *manager)
+{
+    unsigned int epoch = manager->epoch;
+
+    __atomic_store_n(&(manager->epoch), epoch ^ 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&(manager->readers[epoch]), __ATOMIC_SEQ_CST) > 0) {
+        sched_yield();
+    }
+}
+
+/**
+ * Build and publish a snapshot of the engine list and name map.
+ *
+ * On return, no reader uses the previous snapshot and it has been freed.
+ *
+ * The caller must hold the manager lock.
+ *
+ * @param[in] manager The manager.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation errors. The previous snapshot stays current.
+ */
+static ib_status_t manager_publish(ib_manager_t *manager)
+{
+    assert(manager != NULL);
+
+    manager_snapshot_t *snapshot;
+    manager_snapshot_t *previous;
+    ib_hash_iterator_t *itr;
+    size_t              name_count = ib_hash_size(manager->name_to_engine);
+    size_t              names_len = 0;
+    size_t              size;
+    char               *name_buf;
+    size_t              i;
+
+    itr = ib_hash_iterator_create_malloc();
+    if (itr == NULL) {
+        return IB_EALLOC;
+    }
+
+    for (
+        ib_hash_iterator_first(itr, manager->name_to_engine);
+        ! ib_hash_iterator_at_end(itr);
+        ib_hash_iterator_next(itr)
+    ) {
+        size_t name_len;
+
+        ib_hash_iterator_fetch(NULL, &name_len, NULL, itr);
+        names_len += name_len + 1;
+    }
+
+    size = sizeof(*snapshot) +
+           name_count * sizeof(*(snapshot->names)) +
+           manager->engine_count * sizeof(*(snapshot->engines)) +
+           manager->engine_count * sizeof(*(snapshot->wrappers)) +
+           names_len;
+    snapshot = malloc(size);
+    if (snapshot == NULL) {
+        free(itr);
+        return IB_EALLOC;
+    }
+    snapshot->names = (manager_snapshot_name_t *)(snapshot + 1);
+    snapshot->engines = (ib_engine_t **)(snapshot->names + name_count);
+    snapshot->wrappers =
+        (ib_manager_engine_t **)(snapshot->engines + manager->engine_count);
+    name_buf = (char *)(snapshot->wrappers + manager->engine_count);
+
+    /* Copy the names; the hash does not own its keys. */
+    i = 0;
+    for (
+        ib_hash_iterator_first(itr, manager->name_to_engine);
+        ! ib_hash_iterator_at_end(itr);
+        ib_hash_iterator_next(itr)
+    ) {
+        const char          *name;
+        size_t               name_len;
+        ib_manager_engine_t *wrapper;
+
+        ib_hash_iterator_fetch(&name, &name_len, &wrapper, itr);
+        memcpy(name_buf, name, name_len);
+        name_buf[name_len] = '\0';
+        snapshot->names[i].name = name_buf;
+        snapshot->names[i].wrapper = wrapper;
+        name_buf += name_len + 1;
+        ++i;
+    }
+    snapshot->name_count = i;
+    free(itr);
+
+    for (i = 0; i < manager->engine_count; ++i) {
+        snapshot->engines[i] = manager->engine_list[i]->engine;
+        snapshot->wrappers[i] = manager->engine_list[i];
+    }
+    snapshot->engine_count = manager->engine_count;
+
+    previous = manager->snapshot;
+    __atomic_store_n(&(manager->snapshot), snapshot, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&(manager->generation), 1, __ATOMIC_SEQ_CST);
+
+    manager_synchronize(manager);
+    free(previous);
+
+    return IB_OK;
+}
+
 /**
  * Destroy IronBee engines with a reference count of zero.
  *
@@ -164,58 +438,39 @@ static void destroy_inactive_engines(
 {
     assert(manager != NULL);
     const size_t list_sz = manager->engine_count;
+    size_t       live = 0;
 
-    /* Destroy all non-current engines with zero reference count */
+    /* Partition the list: live engines first, then those with zero
+     * reference count. Unreferenced engines are never current, so no reader
+     * can acquire them; readers can only still see them in the snapshot. */
     for (size_t num = 0; num < list_sz; ++num) {
-
-        /* Get and check the wrapper for the IronBee engine. */
-        const ib_manager_engine_t *wrapper = manager->engine_list[num];
+        ib_manager_engine_t *wrapper = manager->engine_list[num];
         assert(wrapper != NULL);
+        assert(wrapper->engine != NULL);
 
-        /* Get and check the engine. */
-        ib_engine_t *engine = wrapper->engine;
-        assert(engine != NULL);
-
-        if ( wrapper->ref_count == 0) {
-            --(manager->engine_count);
-
-            /* Note: This will destroy the engine wrapper object, too */
-            ib_engine_destroy(engine);
-
-            /* NULL out it's place in the list -- we'll consolidate the
-             * list at the bottom */
-            manager->engine_list[num] = NULL;
+        if (__atomic_load_n(&(wrapper->ref_count), __ATOMIC_SEQ_CST) != 0) {
+            manager->engine_list[num] = manager->engine_list[live];
+            manager->engine_list[live] = wrapper;
+            ++live;
         }
     }
 
-    /* If any engines were destroyed, there is a NULL in the list
-     * where they where. Collapse the list, removing NULLs. */
-    if (list_sz > manager->engine_count) {
-
-        /* Iterator i walks the list.
-         *
-         * Non-null elements are copied to the iterator, j, which
-         * starts equal to i, but will lag behind i when the first
-         * NULL entry is seen.
-         *
-         * When i increases to and beyond new_engine_count, we know
-         * that those array slots will not be used in the new list
-         * and should be cleared.
-         */
-        for (size_t i = 0, j = 0; i < list_sz; ++i) {
-
-            /* If i is not null, copy it to j. */
-            if (manager->engine_list[i] != NULL) {
+    if (live == list_sz) {
+        return;
+    }
 
-                manager->engine_list[j] = manager->engine_list[i];
-                ++j;
+    /* Publish the list without the inactive engines before destroying
+     * them. If that fails, keep them until the next attempt. */
+    manager->engine_count = live;
+    if (manager_publish(manager) != IB_OK) {
+        manager->engine_count = list_sz;
+        return;
+    }
 
-                /* If is is beyond the new list, NULL the source elements. */
-                if (i >= manager->engine_count) {
-                    manager->engine_list[i] = NULL;
-                }
-            }
-        }
+    for (size_t num = live; num < list_sz; ++num) {
+        /* Note: This will destroy the engine wrapper object, too */
+        ib_engine_destroy(manager->engine_list[num]->engine);
+        manager->engine_list[num] = NULL;
     }
 }
 
@@ -295,6 +550,16 @@ static ib_status_t manager_run_postconfig_fn(
     return IB_OK;
 }
 
+/**
+ * Destroy a condition variable; memory manager cleanup function.
+ *
+ * @param[in] cbdata The pthread_cond_t.
+ */
+static void manager_cond_destroy(void *cbdata)
+{
+    pthread_cond_destroy((pthread_cond_t *)cbdata);
+}
+
 ib_status_t ib_manager_create(
     ib_manager_t      **pmanager,
     const ib_server_t  *server,
@@ -349,6 +614,20 @@ ib_status_t ib_manager_create(
     if (rc != IB_OK) {
         goto cleanup;
     }
+    rc = ib_lock_create(&(manager->build_lck), mm);
+    if (rc != IB_OK) {
+        goto cleanup;
+    }
+    if (pthread_cond_init(&(manager->builders_cond), NULL) != 0) {
+        rc = IB_EALLOC;
+        goto cleanup;
+    }
+    rc = ib_mm_register_cleanup(mm, manager_cond_destroy,
+                                &(manager->builders_cond));
+    if (rc != IB_OK) {
+        pthread_cond_destroy(&(manager->builders_cond));
+        goto cleanup;
+    }
 
     /* Create the name-to-engine map. */
     rc = ib_hash_create(&manager->name_to_engine, mm);
@@ -410,6 +689,13 @@ void ib_manager_destroy(
 {
     assert(manager != NULL);
 
+    /* Wait for background builds. */
+    ib_lock_lock(manager->manager_lck);
+    while (manager->builders > 0) {
+        pthread_cond_wait(&(manager->builders_cond), manager->manager_lck);
+    }
+    ib_lock_unlock(manager->manager_lck);
+
     /* Destroy engines */
     for (size_t num = 0; num < manager->engine_count; ++num) {
         const ib_manager_engine_t *manager_engine = manager->engine_list[num];
@@ -418,6 +704,8 @@ void ib_manager_destroy(
         ib_engine_destroy(manager_engine->engine);
     }
 
+    free(manager->snapshot);
+
     /* Destroy the manager by destroying it's memory pool. */
     ib_mpool_destroy(manager->mpool);
 
@@ -433,15 +721,23 @@ void ib_manager_destroy(
  * ib_manager_t::engine_count be less than ib_manager_t::max_engines.
  *
  * - Add @a engine to @a manager's engine list.
- * - Demote the current engine, removing the manager's reference count.
  * - Promote @a engine to current, adding a manager reference count.
+ * - Publish the new engine to readers.
+ * - Demote the current engine, removing the manager's reference count.
+ *
+ * The previous engine is demoted only once readers can no longer find it,
+ * so a current engine always has a non-zero reference count.
  *
  * @param[in] manager Engine manager.
  * @param[in] name The unique name of the engine being registered.
  * @param[in] engine Engine wrapper object.
  *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC If the engine could not be published. The previous engine
+ *   stays current and @a engine is left unreferenced.
  */
-static void register_engine(
+static ib_status_t register_engine(
     ib_manager_t        *manager,
     const char          *name,
     ib_manager_engine_t *engine
@@ -482,14 +778,38 @@ static void register_engine(
     }
     else {
         /* Add a reference count to the current engine for the manager. */
-        ++(engine->ref_count);
+        __atomic_add_fetch(&(engine->ref_count), 1, __ATOMIC_SEQ_CST);
+    }
+
+    rc = manager_publish(manager);
+    if (rc != IB_OK) {
+        ib_log_error(
+            engine->engine,
+            "Failed to publish this engine as the active one for name %s.",
+            name);
+
+        /* Restore the previous engine, if any. */
+        if (previous_engine != NULL) {
+            ib_hash_set(manager->name_to_engine, name, previous_engine);
+        }
+        else {
+            ib_hash_remove(manager->name_to_engine, NULL, name);
+        }
+        __atomic_store_n(&(engine->ref_count), 0, __ATOMIC_SEQ_CST);
+
+        return rc;
     }
 
     /* If there was a previous engine, clean it up. */
     if (previous_engine != NULL) {
 
         /* Remove the engine manager's reference to the engine. */
-        --(previous_engine->ref_count);
+        __atomic_store_n(&(previous_engine->retired), true, __ATOMIC_SEQ_CST);
+        if (__atomic_sub_fetch(&(previous_engine->ref_count), 1,
+                               __ATOMIC_SEQ_CST) == 0)
+        {
+            __atomic_store_n(&(manager->reclaim), true, __ATOMIC_SEQ_CST);
+        }
 
         /* Tell the engine that we would like to shut down. */
         rc = ib_state_notify_engine_shutdown_initiated(
@@ -500,6 +820,8 @@ static void register_engine(
                 "Failed to signal previous engine to shutdown.");
         }
     }
+
+    return IB_OK;
 }
 
 /**
@@ -520,12 +842,16 @@ static void register_engine(
 static ib_status_t has_engine_slots(ib_manager_t *manager)
 {
     /* Are we already at the max # of engines? */
-    if (manager->engine_count >= manager->max_engines) {
+    if (manager->engine_count + manager->engines_pending >=
+        manager->max_engines)
+    {
 
         /* Attempt to reclaim engine slots. */
         destroy_inactive_engines(manager);
 
-        if (manager->engine_count >= manager->max_engines) {
+        if (manager->engine_count + manager->engines_pending >=
+            manager->max_engines)
+        {
             return IB_DECLINED;
         }
     }
@@ -538,7 +864,8 @@ static ib_status_t has_engine_slots(ib_manager_t *manager)
  *
  * It is wrapped in a @ref ib_manager_engine_t.
  *
- * This requires the caller to hold the manager lock.
+ * This requires the caller to hold the build lock and to have reserved an
+ * engine slot.  The manager lock must not be held.
  *
  * @param[in] manager The manager to use for creation.
  * @param[in] config_file The configuration file to pass the engine.
@@ -681,44 +1008,154 @@ ib_status_t ib_manager_engine_create(
     ib_status_t          rc;
     ib_manager_engine_t *wrapper = NULL;
 
-    /* Grab the engine creation lock to serialize engine creation. */
     rc = ib_lock_lock(manager->manager_lck);
     if (rc != IB_OK) {
-        goto cleanup;
+        return rc;
     }
 
     /* Notice we do this check inside the critical section. */
     if (! manager->enabled) {
-        rc = IB_DECLINED;
-        goto cleanup;
+        ib_lock_unlock(manager->manager_lck);
+        return IB_DECLINED;
     }
 
-    /* Check for or make space. */
+    /* Check for or make space, and reserve it for the new engine. */
     rc = has_engine_slots(manager);
     if (rc != IB_OK) {
-        goto cleanup;
+        ib_lock_unlock(manager->manager_lck);
+        return rc;
     }
+    ++(manager->engines_pending);
 
-    /* If we have space, build an engine... */
-    rc = create_engine(manager, config_file, &wrapper);
-    if (rc != IB_OK) {
-        goto cleanup;
+    ib_lock_unlock(manager->manager_lck);
+
+    /* Build the engine. This is slow, so only builds wait for it. */
+    rc = ib_lock_lock(manager->build_lck);
+    if (rc == IB_OK) {
+        rc = create_engine(manager, config_file, &wrapper);
+        ib_lock_unlock(manager->build_lck);
     }
 
-    /* ... and register that engine with the manager. */
-    register_engine(manager, name, wrapper);
+    ib_lock_lock(manager->manager_lck);
 
-    /* Destroy any inactive engines. */
-    destroy_inactive_engines(manager);
+    --(manager->engines_pending);
 
-cleanup:
+    /* The manager may have been disabled while building. */
+    if (rc == IB_OK && ! manager->enabled) {
+        ib_engine_destroy(wrapper->engine);
+        rc = IB_DECLINED;
+    }
+    else if (rc == IB_OK) {
+        /* Register the engine with the manager. */
+        rc = register_engine(manager, name, wrapper);
+
+        /* Destroy any inactive engines. */
+        destroy_inactive_engines(manager);
+    }
 
-    /* Release any locks. */
     ib_lock_unlock(manager->manager_lck);
 
     return rc;
 }
 
+/**
+ * A background engine build.
+ */
+struct manager_build_t {
+    ib_manager_t                       *manager;     /**< The manager. */
+    char                               *name;        /**< Engine name. */
+    char                               *config_file; /**< Config file. */
+    ib_manager_engine_create_done_fn_t  done_fn;     /**< Completion. */
+    void                               *cbdata;      /**< For done_fn. */
+};
+typedef struct manager_build_t manager_build_t;
+
+/**
+ * Background engine build thread.
+ *
+ * @param[in] data The manager_build_t; freed by this function.
+ *
+ * @returns NULL
+ */
+static void *manager_build_thread(void *data)
+{
+    manager_build_t *build = (manager_build_t *)data;
+    ib_manager_t    *manager = build->manager;
+    ib_status_t      rc;
+
+    rc = ib_manager_engine_create(manager, build->name, build->config_file);
+
+    if (build->done_fn != NULL) {
+        build->done_fn(manager, build->name, rc, build->cbdata);
+    }
+
+    free(build->name);
+    free(build->config_file);
+    free(build);
+
+    ib_lock_lock(manager->manager_lck);
+    --(manager->builders);
+    pthread_cond_broadcast(&(manager->builders_cond));
+    ib_lock_unlock(manager->manager_lck);
+
+    return NULL;
+}
+
+ib_status_t ib_manager_engine_create_background(
+    ib_manager_t                       *manager,
+    const char                         *name,
+    const char                         *config_file,
+    ib_manager_engine_create_done_fn_t  done_fn,
+    void                               *cbdata
+)
+{
+    assert(manager != NULL);
+    assert(name != NULL);
+    assert(config_file != NULL);
+
+    manager_build_t *build;
+    pthread_attr_t   attr;
+    pthread_t        thread;
+    int              sys_rc;
+
+    build = calloc(1, sizeof(*build));
+    if (build == NULL) {
+        return IB_EALLOC;
+    }
+    build->manager     = manager;
+    build->name        = strdup(name);
+    build->config_file = strdup(config_file);
+    build->done_fn     = done_fn;
+    build->cbdata      = cbdata;
+    if (build->name == NULL || build->config_file == NULL) {
+        goto failure;
+    }
+
+    ib_lock_lock(manager->manager_lck);
+    ++(manager->builders);
+    ib_lock_unlock(manager->manager_lck);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    sys_rc = pthread_create(&thread, &attr, manager_build_thread, build);
+    pthread_attr_destroy(&attr);
+    if (sys_rc != 0) {
+        ib_lock_lock(manager->manager_lck);
+        --(manager->builders);
+        pthread_cond_broadcast(&(manager->builders_cond));
+        ib_lock_unlock(manager->manager_lck);
+        goto failure;
+    }
+
+    return IB_OK;
+
+failure:
+    free(build->name);
+    free(build->config_file);
+    free(build);
+    return IB_EALLOC;
+}
+
 ib_status_t ib_manager_enable(
     ib_manager_t *manager
 )
@@ -779,6 +1216,13 @@ ib_status_t ib_manager_disable(
      * which we must take care of, but we'll do that outside this loop. */
     ib_hash_clear(manager->name_to_engine);
 
+    /* Readers must not find the engines once their references go away. */
+    rc = manager_publish(manager);
+    if (rc != IB_OK) {
+        ib_list_clear(engines);
+        goto cleanup;
+    }
+
     /* The last thing we do before releasing the lock is flagging the
      * manager as disabled. */
     manager->enabled = false;
@@ -809,6 +1253,7 @@ cleanup:
         }
 
         /* Release the reference count of the engine manager to this engine. */
+        __atomic_store_n(&(mgr_eng->retired), true, __ATOMIC_SEQ_CST);
         rc = ib_manager_engine_release(manager, previous_engine);
         if (rc != IB_OK) {
             ib_log_error(
@@ -829,46 +1274,100 @@ cleanup:
 }
 
 /**
- * Return any live engine reference.
+ * Destroy retired engines that have lost their last reference.
  *
- * This function does not lock and must be protected.
+ * Releases only flag that there is work, since the released engine may
+ * still be on the caller's stack; the next acquisition does the work.  If
+ * another thread holds the manager lock, the work is left for a later
+ * acquisition.
  *
- * @param[in] manager The manager to interrogate.
- * @param[out] pengine The engine. Unchanged if none found.
+ * @param[in] manager The manager.
+ */
+static void manager_reclaim(ib_manager_t *manager)
+{
+    if (! __atomic_load_n(&(manager->reclaim), __ATOMIC_SEQ_CST)) {
+        return;
+    }
+    if (ib_lock_trylock(manager->manager_lck) != IB_OK) {
+        return;
+    }
+    __atomic_store_n(&(manager->reclaim), false, __ATOMIC_SEQ_CST);
+    destroy_inactive_engines(manager);
+    ib_lock_unlock(manager->manager_lck);
+}
+
+/**
+ * Take a reference to @a wrapper unless it is unreferenced.
  *
- * @returns
- * - IB_OK On success.
- * - IB_DECLINED If nothing found.
- * - IB_EALLOC If cannot malloc the hash iterator.
+ * Must be called inside a read section.
+ *
+ * @param[in] wrapper The engine wrapper.
+ *
+ * @returns true if a reference was taken.
  */
-static ib_status_t manager_engine_acquire_any(
+static bool manager_engine_ref(ib_manager_engine_t *wrapper)
+{
+    size_t ref_count = __atomic_load_n(&(wrapper->ref_count),
+                                       __ATOMIC_SEQ_CST);
+
+    while (ref_count > 0) {
+        if (__atomic_compare_exchange_n(&(wrapper->ref_count),
+                                        &ref_count, ref_count + 1,
+                                        false,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Acquire the engine named @a name and return its wrapper.
+ *
+ * @param[in] manager The manager.
+ * @param[in] name Engine name or @ref IB_MANAGER_ENGINE_NAME_ANY.
+ * @param[out] pwrapper The wrapper of the acquired engine.
+ *
+ * @returns As ib_manager_engine_acquire().
+ */
+static ib_status_t manager_engine_acquire(
     ib_manager_t         *manager,
-    ib_manager_engine_t **pengine
+    const char           *name,
+    ib_manager_engine_t **pwrapper
 )
 {
-    ib_hash_iterator_t  *itr = ib_hash_iterator_create_malloc();
-    const char          *name;
-    size_t               name_len;
-    ib_status_t          rc;
+    assert(manager != NULL);
+    assert(manager->name_to_engine != NULL);
+    assert(pwrapper != NULL);
 
-    if (itr == NULL) {
-        return IB_EALLOC;
-    }
+    ib_status_t               rc = IB_DECLINED;
+    const manager_snapshot_t *snapshot;
+    unsigned int              epoch;
 
-    ib_hash_iterator_first(itr, manager->name_to_engine);
+    /* Acquire is the hot path: it takes no lock. */
+    epoch = manager_read_lock(manager);
 
-    if (ib_hash_iterator_at_end(itr)) {
-        rc = IB_DECLINED;
-        goto cleanup;
-    }
-    else {
-        rc = IB_OK;
+    snapshot = __atomic_load_n(&(manager->snapshot), __ATOMIC_SEQ_CST);
+    if (snapshot != NULL) {
+        bool any = (strcmp(name, IB_MANAGER_ENGINE_NAME_ANY) == 0);
+
+        for (size_t i = 0; i < snapshot->name_count; ++i) {
+            ib_manager_engine_t *wrapper = snapshot->names[i].wrapper;
+
+            if (any || strcmp(name, snapshot->names[i].name) == 0) {
+                if (manager_engine_ref(wrapper)) {
+                    *pwrapper = wrapper;
+                    rc = IB_OK;
+                }
+                break;
+            }
+        }
     }
 
-    ib_hash_iterator_fetch(&name, &name_len, pengine, itr);
+    manager_read_unlock(manager, epoch);
 
-cleanup:
-    free(itr);
     return rc;
 }
 
@@ -879,38 +1378,18 @@ ib_status_t ib_manager_engine_acquire(
 )
 {
     assert(manager != NULL);
-    assert(manager->name_to_engine != NULL);
     assert(pengine != NULL);
 
+    ib_manager_engine_t *wrapper;
     ib_status_t          rc;
-    ib_manager_engine_t *engine = NULL;
 
-    /* Grab the engine list lock */
-    rc = ib_lock_lock(manager->manager_lck);
-    if (rc != IB_OK) {
-        return rc;
-    }
-
-    if (strcmp(name, IB_MANAGER_ENGINE_NAME_ANY) == 0) {
-        rc = manager_engine_acquire_any(manager, &engine);
-    }
-    else {
-        rc = ib_hash_get(manager->name_to_engine, &engine, name);
-    }
+    manager_reclaim(manager);
 
+    rc = manager_engine_acquire(manager, name, &wrapper);
     if (rc == IB_OK) {
-
-        /* Increment and return the engine. */
-        ++(engine->ref_count);
-        *pengine = engine->engine;
-
-        rc = IB_OK;
-    }
-    else {
-        rc = IB_DECLINED;
+        *pengine = wrapper->engine;
     }
 
-    ib_lock_unlock(manager->manager_lck);
     return rc;
 }
 
@@ -922,49 +1401,224 @@ ib_status_t ib_manager_engine_release(
     assert(manager != NULL);
     assert(engine != NULL);
 
-    ib_status_t          rc;
-    ib_manager_engine_t *managed_engine = NULL;
+    ib_status_t               rc = IB_EINVAL;
+    const manager_snapshot_t *snapshot;
+    unsigned int              epoch;
+
+    epoch = manager_read_lock(manager);
+
+    /* Find the engine that's being released. */
+    snapshot = __atomic_load_n(&(manager->snapshot), __ATOMIC_SEQ_CST);
+    if (snapshot != NULL) {
+        for (size_t num = 0; num < snapshot->engine_count; ++num) {
+            if (engine == snapshot->engines[num]) {
+                ib_manager_engine_t *wrapper = snapshot->wrappers[num];
+
+                /* Quick sanity check. Never release an unowned engine. */
+                assert(__atomic_load_n(&(wrapper->ref_count),
+                                       __ATOMIC_SEQ_CST) > 0);
+
+                /* Release the engine. */
+                if (__atomic_sub_fetch(&(wrapper->ref_count), 1,
+                                       __ATOMIC_SEQ_CST) == 0 &&
+                    __atomic_load_n(&(wrapper->retired), __ATOMIC_SEQ_CST))
+                {
+                    __atomic_store_n(&(manager->reclaim), true,
+                                     __ATOMIC_SEQ_CST);
+                }
 
-    /* Grab the engine list lock */
-    rc = ib_lock_lock(manager->manager_lck);
-    if (rc != IB_OK) {
-        return rc;
+                rc = IB_OK;
+
+                /* Leave the loop as we won't find engine a second time. */
+                break;
+            }
+        }
     }
 
-    /* Find an old engine that's being released. */
-    for (size_t num = 0; num < manager->engine_count; ++num) {
-        ib_manager_engine_t *cur = manager->engine_list[num];
+    manager_read_unlock(manager, epoch);
+
+    return rc;
+}
 
-        /* Decrement the reference count if the engine matches. */
-        if (engine == cur->engine) {
-            managed_engine = cur;
+bool ib_manager_engine_retired(
+    ib_manager_t      *manager,
+    const ib_engine_t *engine
+)
+{
+    assert(manager != NULL);
+    assert(engine != NULL);
 
-            /* Leave the loop as we won't find engine a second time. */
-            break;
+    const manager_snapshot_t *snapshot;
+    unsigned int              epoch;
+    bool                      retired = false;
+
+    epoch = manager_read_lock(manager);
+
+    snapshot = __atomic_load_n(&(manager->snapshot), __ATOMIC_SEQ_CST);
+    if (snapshot != NULL) {
+        for (size_t num = 0; num < snapshot->engine_count; ++num) {
+            if (engine == snapshot->engines[num]) {
+                retired = __atomic_load_n(&(snapshot->wrappers[num]->retired),
+                                          __ATOMIC_SEQ_CST);
+                break;
+            }
         }
     }
 
-    /* Found the engine in this manager. Release it. */
-    if (managed_engine != NULL) {
+    manager_read_unlock(manager, epoch);
 
-        /* Quick sanity check. Never release an unowned engine. */
-        assert(managed_engine->ref_count > 0);
+    return retired;
+}
+
+/**
+ * Hand the cache's reference and outstanding uses back to the manager.
+ *
+ * The engine gets one manager reference per outstanding use, which are
+ * released with ib_manager_engine_release().
+ *
+ * @param[in] cache The cache.
+ */
+static void manager_engine_cache_drop(ib_manager_engine_cache_t *cache)
+{
+    assert(cache != NULL);
 
-        /* Release the engine. */
-        --(managed_engine->ref_count);
+    ib_manager_engine_t *wrapper = cache->wrapper;
 
-        rc = IB_OK;
+    if (wrapper == NULL) {
+        return;
     }
 
-    /* The user passed us an engine not from this manager. */
+    /* The cache holds one reference for all its uses. */
+    if (cache->uses == 0) {
+        if (__atomic_sub_fetch(&(wrapper->ref_count), 1,
+                               __ATOMIC_SEQ_CST) == 0 &&
+            __atomic_load_n(&(wrapper->retired), __ATOMIC_SEQ_CST))
+        {
+            __atomic_store_n(&(cache->manager->reclaim), true,
+                             __ATOMIC_SEQ_CST);
+        }
+    }
+    else if (cache->uses > 1) {
+        __atomic_add_fetch(&(wrapper->ref_count), cache->uses - 1,
+                           __ATOMIC_SEQ_CST);
+    }
+
+    cache->wrapper = NULL;
+    cache->uses = 0;
+}
+
+ib_status_t ib_manager_engine_cache_create(
+    ib_manager_t               *manager,
+    const char                 *name,
+    ib_manager_engine_cache_t **pcache
+)
+{
+    assert(manager != NULL);
+    assert(name != NULL);
+    assert(pcache != NULL);
+
+    ib_manager_engine_cache_t *cache;
+    size_t                     name_len = strlen(name) + 1;
+
+    cache = malloc(sizeof(*cache) + name_len);
+    if (cache == NULL) {
+        return IB_EALLOC;
+    }
+    memcpy(cache + 1, name, name_len);
+
+    cache->manager = manager;
+    cache->name = (const char *)(cache + 1);
+    cache->wrapper = NULL;
+    cache->uses = 0;
+    cache->generation = 0;
+
+    *pcache = cache;
+
+    return IB_OK;
+}
+
+void ib_manager_engine_cache_destroy(
+    ib_manager_engine_cache_t *cache
+)
+{
+    if (cache == NULL) {
+        return;
+    }
+
+    manager_engine_cache_drop(cache);
+    free(cache);
+}
+
+void ib_manager_engine_cache_flush(
+    ib_manager_engine_cache_t *cache
+)
+{
+    assert(cache != NULL);
+
+    manager_engine_cache_drop(cache);
+}
+
+ib_status_t ib_manager_engine_cache_acquire(
+    ib_manager_engine_cache_t  *cache,
+    ib_engine_t               **pengine
+)
+{
+    assert(cache != NULL);
+    assert(pengine != NULL);
+
+    ib_manager_t        *manager = cache->manager;
+    ib_manager_engine_t *wrapper;
+    size_t               generation;
+    ib_status_t          rc;
+
+    manager_reclaim(manager);
+
+    generation = __atomic_load_n(&(manager->generation), __ATOMIC_SEQ_CST);
+
+    /* No snapshot published since the engine was cached: still current. */
+    if (cache->wrapper != NULL && cache->generation == generation) {
+        ++cache->uses;
+        *pengine = cache->wrapper->engine;
+        return IB_OK;
+    }
+
+    rc = manager_engine_acquire(manager, cache->name, &wrapper);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    if (wrapper == cache->wrapper) {
+        /* Still current; the cache already holds a reference. */
+        __atomic_sub_fetch(&(wrapper->ref_count), 1, __ATOMIC_SEQ_CST);
+    }
     else {
-        rc = IB_EINVAL;
+        manager_engine_cache_drop(cache);
+        cache->wrapper = wrapper;
     }
+    cache->generation = generation;
 
-    /* Release the lock. */
-    ib_lock_unlock(manager->manager_lck);
+    ++cache->uses;
+    *pengine = wrapper->engine;
 
-    return rc;
+    return IB_OK;
+}
+
+ib_status_t ib_manager_engine_cache_release(
+    ib_manager_engine_cache_t *cache,
+    ib_engine_t               *engine
+)
+{
+    assert(cache != NULL);
+    assert(engine != NULL);
+
+    if (cache->wrapper != NULL && cache->wrapper->engine == engine) {
+        assert(cache->uses > 0);
+        --cache->uses;
+        return IB_OK;
+    }
+
+    /* Acquired before the cache moved on to another engine. */
+    return ib_manager_engine_release(cache->manager, engine);
 }
 
 ib_status_t ib_manager_engine_cleanup(
@@ -1103,7 +1757,7 @@ ib_status_t DLL_PUBLIC ib_manager_engine_status(
 
         es->id        = ib_engine_instance_id(e->engine);
         es->uptime    = IB_CLOCK_SECS(time_now - e->created);
-        es->ref_count = e->ref_count;
+        es->ref_count = __atomic_load_n(&(e->ref_count), __ATOMIC_SEQ_CST);
 
         // FIXME - this is useless information.
         es->current   = false;
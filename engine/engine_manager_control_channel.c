@@ -26,11 +26,16 @@
 
 #include <ironbee/engine_manager_control_channel.h>
 
+#include <ironbee/engine.h>
 #include <ironbee/engine_manager.h>
+#include <ironbee/engine_state.h>
 #include <ironbee/hash.h>
 #include <ironbee/mm.h>
 #include <ironbee/mm_mpool_lite.h>
+#include <ironbee/module.h>
 #include <ironbee/mpool_lite.h>
+#include <ironbee/rule_engine.h>
+#include <ironbee/string_assembly.h>
 
 #ifdef HAVE_VALGRIND
 #include <valgrind/memcheck.h>
@@ -39,6 +44,8 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/socket.h>
@@ -462,6 +469,473 @@ static ib_status_t manager_cmd_engine_status(
     return rc;
 }
 
+/**
+ * Report the counters of an engine as JSON.
+ *
+ * @param[in] mm Memory manager for allocations of @a result and other
+ *            allocations that should live until the response is sent.
+ * @param[in] name The name this command is called by.
+ * @param[in] args The name of the engine; the default engine if empty.
+ * @param[out] result The counters as a JSON object.
+ * @param[in] cbdata The @ref ib_manager_t * to act on.
+ *
+ * @sa ib_engine_metrics_get()
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_DECLINED If there is no current engine by that name.
+ * - IB_EALLOC On failure to allocate from @a mm a @a result.
+ * - Other on an unexpected error.
+ */
+static ib_status_t manager_cmd_engine_metrics(
+    ib_mm_t      mm,
+    const char  *name,
+    const char  *args,
+    const char **result,
+    void        *cbdata
+)
+{
+    assert(args != NULL);
+    assert(cbdata != NULL);
+
+    ib_manager_t        *manager = (ib_manager_t *)cbdata;
+    const char          *engine_name = args;
+    ib_engine_t         *engine;
+    ib_engine_metrics_t  metrics;
+    ib_status_t          rc;
+    char                *answer;
+    size_t               answer_len;
+
+    engine_name += strspn(engine_name, " \t");
+    if (*engine_name == '\0') {
+        engine_name = IB_MANAGER_ENGINE_NAME_DEFAULT;
+    }
+
+    rc = ib_manager_engine_acquire(manager, engine_name, &engine);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    ib_engine_metrics_get(engine, &metrics);
+    rc = ib_manager_engine_release(manager, engine);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_snprintf(
+        mm,
+        &answer,
+        &answer_len,
+        "{ \"engine\": \"%s\", "
+        "\"conns_opened\": %" PRIu64 ", "
+        "\"conns_active\": %" PRIu64 ", "
+        "\"txs_started\": %" PRIu64 ", "
+        "\"txs_active\": %" PRIu64 ", "
+        "\"txs_blocked\": %" PRIu64 ", "
+        "\"request_body_bytes\": %" PRIu64 ", "
+        "\"response_body_bytes\": %" PRIu64 " }\n",
+        engine_name,
+        metrics.conns_opened,
+        metrics.conns_opened - metrics.conns_closed,
+        metrics.txs_started,
+        metrics.txs_started - metrics.txs_finished,
+        metrics.txs_blocked,
+        metrics.request_body_bytes,
+        metrics.response_body_bytes
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    *result = answer;
+
+    return IB_OK;
+}
+
+/**
+ * Number of rules reported by rule_profile report by default.
+ */
+#define RULE_PROFILE_REPORT_DEFAULT 20
+
+/**
+ * Report the rule profiles of an engine as JSON.
+ *
+ * @param[in] mm Memory manager for allocations of @a result.
+ * @param[in] engine Engine to report on.
+ * @param[in] limit Maximum number of rules to report.
+ * @param[out] result The report as a JSON object.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On failure to allocate from @a mm a @a result.
+ */
+static ib_status_t rule_profile_json(
+    ib_mm_t       mm,
+    ib_engine_t  *engine,
+    size_t        limit,
+    const char  **result
+)
+{
+    assert(engine != NULL);
+    assert(result != NULL);
+
+    ib_list_t            *profiles;
+    const ib_list_node_t *node;
+    ib_sa_t              *sa;
+    char                 *s;
+    size_t                s_len;
+    const char           *sep = "";
+    size_t                answer_len;
+    ib_status_t           rc;
+
+    rc = ib_rule_profile_hot(engine, mm, limit, &profiles);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_sa_begin(&sa);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_snprintf(
+        mm, &s, &s_len, "{ \"enabled\": %s, \"rules\": [",
+        ib_rule_profile_enabled(engine) ? "true" : "false");
+    if (rc != IB_OK) {
+        goto failure;
+    }
+    rc = ib_sa_append(sa, s, s_len);
+    if (rc != IB_OK) {
+        goto failure;
+    }
+
+    IB_LIST_LOOP_CONST(profiles, node) {
+        const ib_rule_profile_t *profile =
+            (const ib_rule_profile_t *)ib_list_node_data_const(node);
+
+        rc = ib_snprintf(
+            mm,
+            &s,
+            &s_len,
+            "%s { \"id\": \"%s\", "
+            "\"evaluations\": %" PRIu64 ", "
+            "\"matches\": %" PRIu64 ", "
+            "\"total_us\": %" PRIu64 ", "
+            "\"mean_us\": %" PRIu64 ", "
+            "\"p50_us\": %" PRIu64 ", "
+            "\"p99_us\": %" PRIu64 ", "
+            "\"max_us\": %" PRIu64 " }",
+            sep,
+            ib_rule_id(profile->rule),
+            profile->evaluations,
+            profile->matches,
+            profile->time,
+            profile->time / profile->evaluations,
+            ib_rule_profile_quantile(profile, 0.50),
+            ib_rule_profile_quantile(profile, 0.99),
+            profile->max_time
+        );
+        if (rc != IB_OK) {
+            goto failure;
+        }
+        rc = ib_sa_append(sa, s, s_len);
+        if (rc != IB_OK) {
+            goto failure;
+        }
+        sep = ",";
+    }
+
+    rc = ib_sa_append(sa, " ] }\n", 5);
+    if (rc != IB_OK) {
+        goto failure;
+    }
+
+    return ib_sa_finish(&sa, result, &answer_len, mm);
+
+failure:
+    ib_sa_abort(&sa);
+    return rc;
+}
+
+/**
+ * Turn rule profiling of the current engine on or off, or report it.
+ *
+ * The arguments are one of:
+ * - on - Profile the rules of all contexts.
+ * - off - Stop profiling rules, except where RuleEngineProfile is on.
+ * - reset - Discard the rule profiles.
+ * - report [\<n\>] - Report the @a n rules that used the most time as
+ *   JSON.  The default is @ref RULE_PROFILE_REPORT_DEFAULT.
+ *
+ * Only the current engine is changed: an engine created afterwards starts
+ * with profiling off.
+ *
+ * @param[in] mm Memory manager for allocations of @a result and other
+ *            allocations that should live until the response is sent.
+ * @param[in] name The name this command is called by.
+ * @param[in] args The subcommand and its arguments.
+ * @param[out] result The report for report; unchanged otherwise.
+ * @param[in] cbdata The @ref ib_manager_t * to act on.
+ *
+ * @sa ib_rule_profile_set()
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EINVAL If @a args is not a subcommand.
+ * - IB_DECLINED If there is no current engine.
+ * - IB_EALLOC On allocation failure.
+ * - Other on an unexpected error.
+ */
+static ib_status_t manager_cmd_rule_profile(
+    ib_mm_t      mm,
+    const char  *name,
+    const char  *args,
+    const char **result,
+    void        *cbdata
+)
+{
+    assert(args != NULL);
+    assert(cbdata != NULL);
+
+    ib_manager_t  *manager = (ib_manager_t *)cbdata;
+    ib_engine_t   *engine;
+    const char    *cmd = args + strspn(args, " \t");
+    size_t         cmd_len = strcspn(cmd, " \t");
+    const char    *arg = cmd + cmd_len + strspn(cmd + cmd_len, " \t");
+    size_t         limit = RULE_PROFILE_REPORT_DEFAULT;
+    ib_status_t    rc;
+    ib_status_t    release_rc;
+
+#define RULE_PROFILE_CMD_IS(s) \
+    ((cmd_len == sizeof(s) - 1) && (strncmp(cmd, (s), cmd_len) == 0))
+
+    if (RULE_PROFILE_CMD_IS("report")) {
+        if (*arg != '\0') {
+            char *end;
+
+            errno = 0;
+            limit = strtoul(arg, &end, 10);
+            if (errno != 0 || end == arg || *end != '\0') {
+                return IB_EINVAL;
+            }
+        }
+    }
+    else if (
+        ! RULE_PROFILE_CMD_IS("on") &&
+        ! RULE_PROFILE_CMD_IS("off") &&
+        ! RULE_PROFILE_CMD_IS("reset")
+    ) {
+        return IB_EINVAL;
+    }
+
+    rc = ib_manager_engine_acquire(
+        manager, IB_MANAGER_ENGINE_NAME_DEFAULT, &engine);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    if (RULE_PROFILE_CMD_IS("on")) {
+        rc = ib_rule_profile_set(engine, true);
+    }
+    else if (RULE_PROFILE_CMD_IS("off")) {
+        rc = ib_rule_profile_set(engine, false);
+    }
+    else if (RULE_PROFILE_CMD_IS("reset")) {
+        ib_rule_profile_reset(engine);
+    }
+    else {
+        rc = rule_profile_json(mm, engine, limit, result);
+    }
+
+#undef RULE_PROFILE_CMD_IS
+
+    release_rc = ib_manager_engine_release(manager, engine);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    return release_rc;
+}
+
+/**
+ * Report the hook profiles of an engine as JSON.
+ *
+ * @param[in] mm Memory manager for allocations of @a result.
+ * @param[in] engine Engine to report on.
+ * @param[out] result The report as a JSON object.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On failure to allocate from @a mm a @a result.
+ */
+static ib_status_t hook_profile_json(
+    ib_mm_t       mm,
+    ib_engine_t  *engine,
+    const char  **result
+)
+{
+    assert(engine != NULL);
+    assert(result != NULL);
+
+    ib_list_t            *profiles;
+    const ib_list_node_t *node;
+    ib_sa_t              *sa;
+    char                 *s;
+    size_t                s_len;
+    const char           *sep = "";
+    size_t                answer_len;
+    ib_status_t           rc;
+
+    rc = ib_hook_profile_get(engine, mm, &profiles);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_sa_begin(&sa);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_snprintf(
+        mm, &s, &s_len, "{ \"enabled\": %s, \"hooks\": [",
+        ib_hook_profile_enabled(engine) ? "true" : "false");
+    if (rc != IB_OK) {
+        goto failure;
+    }
+    rc = ib_sa_append(sa, s, s_len);
+    if (rc != IB_OK) {
+        goto failure;
+    }
+
+    IB_LIST_LOOP_CONST(profiles, node) {
+        const ib_hook_profile_t *profile =
+            (const ib_hook_profile_t *)ib_list_node_data_const(node);
+
+        rc = ib_snprintf(
+            mm,
+            &s,
+            &s_len,
+            "%s { \"module\": \"%s\", "
+            "\"state\": \"%s\", "
+            "\"calls\": %" PRIu64 ", "
+            "\"total_us\": %" PRIu64 " }",
+            sep,
+            (profile->module == NULL) ? "engine" : profile->module->name,
+            ib_state_name(profile->state),
+            profile->calls,
+            profile->time
+        );
+        if (rc != IB_OK) {
+            goto failure;
+        }
+        rc = ib_sa_append(sa, s, s_len);
+        if (rc != IB_OK) {
+            goto failure;
+        }
+        sep = ",";
+    }
+
+    rc = ib_sa_append(sa, " ] }\n", 5);
+    if (rc != IB_OK) {
+        goto failure;
+    }
+
+    return ib_sa_finish(&sa, result, &answer_len, mm);
+
+failure:
+    ib_sa_abort(&sa);
+    return rc;
+}
+
+/**
+ * Turn hook profiling of the current engine on or off, or report it.
+ *
+ * The arguments are one of:
+ * - on - Time the hooks of all states.
+ * - off - Stop timing hooks.
+ * - reset - Discard the hook profiles.
+ * - report - Report the time of the hooks of each module and state, by
+ *   decreasing time, as JSON.
+ *
+ * Only the current engine is changed: an engine created afterwards starts
+ * with profiling off.
+ *
+ * @param[in] mm Memory manager for allocations of @a result and other
+ *            allocations that should live until the response is sent.
+ * @param[in] name The name this command is called by.
+ * @param[in] args The subcommand.
+ * @param[out] result The report for report; unchanged otherwise.
+ * @param[in] cbdata The @ref ib_manager_t * to act on.
+ *
+ * @sa ib_hook_profile_set()
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EINVAL If @a args is not a subcommand.
+ * - IB_DECLINED If there is no current engine.
+ * - IB_EALLOC On allocation failure.
+ * - Other on an unexpected error.
+ */
+static ib_status_t manager_cmd_hook_profile(
+    ib_mm_t      mm,
+    const char  *name,
+    const char  *args,
+    const char **result,
+    void        *cbdata
+)
+{
+    assert(args != NULL);
+    assert(cbdata != NULL);
+
+    ib_manager_t  *manager = (ib_manager_t *)cbdata;
+    ib_engine_t   *engine;
+    const char    *cmd = args + strspn(args, " \t");
+    size_t         cmd_len = strcspn(cmd, " \t");
+    ib_status_t    rc = IB_OK;
+    ib_status_t    release_rc;
+
+#define HOOK_PROFILE_CMD_IS(s) \
+    ((cmd_len == sizeof(s) - 1) && (strncmp(cmd, (s), cmd_len) == 0))
+
+    if (
+        (cmd[cmd_len + strspn(cmd + cmd_len, " \t")] != '\0') || (
+            ! HOOK_PROFILE_CMD_IS("on") &&
+            ! HOOK_PROFILE_CMD_IS("off") &&
+            ! HOOK_PROFILE_CMD_IS("reset") &&
+            ! HOOK_PROFILE_CMD_IS("report")
+        )
+    ) {
+        return IB_EINVAL;
+    }
+
+    rc = ib_manager_engine_acquire(
+        manager, IB_MANAGER_ENGINE_NAME_DEFAULT, &engine);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    if (HOOK_PROFILE_CMD_IS("on")) {
+        rc = ib_hook_profile_set(engine, true);
+    }
+    else if (HOOK_PROFILE_CMD_IS("off")) {
+        rc = ib_hook_profile_set(engine, false);
+    }
+    else if (HOOK_PROFILE_CMD_IS("reset")) {
+        ib_hook_profile_reset(engine);
+    }
+    else {
+        rc = hook_profile_json(mm, engine, result);
+    }
+
+#undef HOOK_PROFILE_CMD_IS
+
+    release_rc = ib_manager_engine_release(manager, engine);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    return release_rc;
+}
+
 /**
  * Call ib_manager_engine_cleanup().
  *
@@ -683,6 +1157,67 @@ ib_status_t ib_engine_manager_control_ready(
     return IB_EAGAIN;
 }
 
+/**
+ * Send @a result to the client at @a src_addr.
+ *
+ * A response longer than @ref IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ
+ * is sent as messages of that size, followed by a shorter, possibly empty,
+ * message.  A response that fits is sent as one message, as before, so
+ * clients that read one message still get the start of a long response.
+ *
+ * @param[in] channel The channel.
+ * @param[in] result The response.
+ * @param[in] src_addr Client address.
+ * @param[in] addrlen Length of @a src_addr.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EOTHER If a message could not be sent.
+ */
+static ib_status_t send_response(
+    ib_engine_manager_control_channel_t *channel,
+    const char                          *result,
+    const struct sockaddr_un            *src_addr,
+    socklen_t                            addrlen
+)
+{
+    assert(channel != NULL);
+    assert(result != NULL);
+    assert(src_addr != NULL);
+
+    size_t result_len = strlen(result);
+
+    for (;;) {
+        size_t  piece_len = result_len;
+        ssize_t written;
+
+        if (piece_len > IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ) {
+            piece_len = IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ;
+        }
+
+        written = sendto(
+            channel->sock,
+            (const void *)result,
+            piece_len,
+            0,
+            (const struct sockaddr *)src_addr,
+            addrlen);
+        if (written == -1) {
+            log_socket_error(
+                channel,
+                "write result response to",
+                strerror(errno));
+            return IB_EOTHER;
+        }
+
+        if (piece_len < IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ) {
+            return IB_OK;
+        }
+        result += piece_len;
+        result_len -= piece_len;
+    }
+}
+
 /**
  * Process the command received and send a reply.
  *
@@ -724,7 +1259,6 @@ static ib_status_t handle_command(
     char            *name;
     char            *args;
     size_t           name_len;
-    ssize_t          written;
 
     rc = ib_mpool_lite_create(&mp);
     if (rc != IB_OK) {
@@ -736,6 +1270,7 @@ static ib_status_t handle_command(
     /* Copy the cmdline so we can modify it freely. */
     name = ib_mm_strdup(mm, (const char *)cmdline);
     if (name == NULL) {
+        ib_mpool_lite_destroy(mp);
         return IB_EALLOC;
     }
 
@@ -748,6 +1283,7 @@ static ib_status_t handle_command(
             channel,
             "with invalid command on",
             "Command name is entirely whitespace.");
+        ib_mpool_lite_destroy(mp);
         return IB_EINVAL;
     }
 
@@ -793,26 +1329,14 @@ static ib_status_t handle_command(
     }
 
     /* Only send a reply if we were given a valid reply address. */
+    rc = IB_OK;
     if (addrlen > 0) {
-        written = sendto(
-            channel->sock,
-            (void *)result,
-            strlen(result),
-            0,
-            (const struct sockaddr *)src_addr,
-            addrlen);
-        if (written == -1) {
-            log_socket_error(
-                channel,
-                "write result response to",
-                strerror(errno));
-            return IB_EOTHER;
-        }
+        rc = send_response(channel, result, src_addr, addrlen);
     }
 
     ib_mpool_lite_destroy(mp);
 
-    return IB_OK;
+    return rc;
 }
 
 ib_status_t ib_engine_manager_control_recv(
@@ -970,6 +1494,8 @@ ib_status_t ib_engine_manager_control_send(
     int                sysrc;
     ssize_t            ssz;
     char              *resp; /* Our copy of response. */
+    size_t             resp_len = 0;
+    size_t             resp_sz;
 
     /* The message is too long. */
     if (message_len > IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ) {
@@ -1044,26 +1570,46 @@ ib_status_t ib_engine_manager_control_send(
     /* Allocate after sending the message to the server.
      * It is more likely that the server is down, so we defer allocating mem as
      * that should almost always succeed. */
-    resp = ib_mm_alloc(mm, IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ+1);
+    resp_sz = IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ + 1;
+    resp = ib_mm_alloc(mm, resp_sz);
     if (resp == NULL) {
         rc = IB_EALLOC;
         goto cleanup;
     }
 
-    ssz = recvfrom(
-        sock,
-        resp,
-        IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ,
-        0,
-        NULL,
-        NULL);
-    if (ssz == -1) {
-        rc = IB_EOTHER;
-        goto cleanup;
-    }
+    /* A full-size message means more of the response follows. */
+    do {
+        if (resp_len + IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ >=
+            resp_sz)
+        {
+            char *new_resp;
+
+            resp_sz *= 2;
+            new_resp = ib_mm_alloc(mm, resp_sz);
+            if (new_resp == NULL) {
+                rc = IB_EALLOC;
+                goto cleanup;
+            }
+            memcpy(new_resp, resp, resp_len);
+            resp = new_resp;
+        }
+
+        ssz = recvfrom(
+            sock,
+            resp + resp_len,
+            IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ,
+            0,
+            NULL,
+            NULL);
+        if (ssz == -1) {
+            rc = IB_EOTHER;
+            goto cleanup;
+        }
+        resp_len += (size_t)ssz;
+    } while (ssz == IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ);
 
     /* Ensure this is null-terminated. */
-    resp[ssz] = '\0';
+    resp[resp_len] = '\0';
     *response = resp;
 
 cleanup:
@@ -1133,12 +1679,15 @@ ib_status_t ib_engine_manager_control_manager_ctrl_register(
         const char                                 *name;
         ib_engine_manager_control_channel_cmd_fn_t  fn;
     } cmds[] = {
-        { "enable",        manager_cmd_enable },
-        { "disable",       manager_cmd_disable },
-        { "cleanup",       manager_cmd_cleanup },
-        { "engine_create", manager_cmd_engine_create },
-        { "engine_status", manager_cmd_engine_status },
-        { NULL,            NULL }
+        { "enable",         manager_cmd_enable },
+        { "disable",        manager_cmd_disable },
+        { "cleanup",        manager_cmd_cleanup },
+        { "engine_create",  manager_cmd_engine_create },
+        { "engine_status",  manager_cmd_engine_status },
+        { "engine_metrics", manager_cmd_engine_metrics },
+        { "rule_profile",   manager_cmd_rule_profile },
+        { "hook_profile",   manager_cmd_hook_profile },
+        { NULL,             NULL }
     };
 
     for (int i = 0; cmds[i].name != NULL; ++i) {
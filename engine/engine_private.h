@@ -32,6 +32,7 @@
 #include <ironbee/lock.h>
 #include <ironbee/logger.h>
 #include <ironbee/stream_typedef.h>
+#include <ironbee/thread_pool.h>
 
 #include <stdio.h>
 
@@ -55,6 +56,8 @@ struct ib_auditlog_cfg_t {
     bool          index_enabled; /**< Index file enabled? */
     bool          index_default; /**< Index file is default? */
     char         *index;         /**< Index file name. */
+    char         *index_path;    /**< Path of open index file; NULL if
+                                      not open or a pipe. */
     FILE         *index_fp;      /**< Index file pointer. */
     ib_lock_t    *index_fp_lock; /**< Lock to protect index_fp. */
     ib_context_t *owner;         /**< Owning context. Only owner should edit. */
@@ -141,6 +144,16 @@ struct ib_block_post_hook_t
 };
 typedef struct ib_block_post_hook_t ib_block_post_hook_t;
 
+/** Maximum number of cleared connection memory pools kept for reuse. */
+#define IB_CONN_POOL_CACHE_SIZE 32
+
+/**
+ * Connection memory pools with more than this many bytes allocated are
+ * destroyed instead of kept for reuse, so that a single large connection
+ * does not keep its memory forever.
+ */
+#define IB_CONN_POOL_CACHE_MAX_INUSE (256 * 1024)
+
 /**
  * Engine handle.
  */
@@ -162,11 +175,13 @@ struct ib_engine_t {
     /// @todo Only these should be private
     const ib_server_t     *server;          /**< Info about the server */
     ib_array_t            *modules;         /**< Array tracking modules */
+    ib_module_t           *core_module;     /**< Core module */
     ib_list_t             *contexts;        /**< Configuration contexts */
     ib_hash_t             *dirmap;          /**< Hash tracking directive map */
     ib_hash_t             *tfns;            /**< Hash tracking transforms */
     ib_hash_t             *operators;       /**< Operators by name */
     ib_hash_t             *stream_operators;/**< Stream operators by name*/
+    ib_hash_t             *operator_insts;  /**< Shared operator instances */
     ib_hash_t             *actions;         /**< Hash tracking rules */
     ib_rule_engine_t      *rule_engine;     /**< Rule engine data */
     ib_logger_t           *logger;          /**< The engine log object. */
@@ -175,8 +190,37 @@ struct ib_engine_t {
     /* Hooks */
     ib_list_t *hooks[IB_STATE_NUM + 1]; /**< Registered hook callbacks */
 
+    /**
+     * Registered hook callbacks of each state as flat arrays.
+     *
+     * These are copies of @ref hooks that state notification iterates
+     * without chasing list nodes.  Each registration replaces the array of
+     * its state; old arrays stay valid for the lifetime of the engine.
+     */
+    const ib_hook_t *hook_tables[IB_STATE_NUM + 1];
+    size_t           hook_counts[IB_STATE_NUM + 1]; /**< Sizes of hook_tables */
+
+    /* Hook profiling; see ib_hook_profile_set(). */
+    const ib_module_t *module_initializing; /**< Module registering hooks */
+    bool               hook_profile;        /**< Profile hooks? */
+    ib_hook_profile_t *hook_profiles;       /**< By module, then state */
+    size_t             hook_profiles_size;  /**< Elements in hook_profiles */
+
     ib_list_t *logevent_handlers; /**< List of ib_logevent_t callbacks. */
 
+    /* Connection memory pool recycling; see ib_conn_destroy(). */
+    ib_lock_t  *conn_pool_lock;  /**< Protects conn_pools. */
+    ib_mpool_t *conn_pools[IB_CONN_POOL_CACHE_SIZE]; /**< Cleared pools */
+    size_t      conn_pool_count; /**< Number of pools in conn_pools. */
+
+    /* Worker threads; see ib_engine_thread_pool_get(). */
+    ib_lock_t        *thread_pool_lock; /**< Protects thread_pool creation. */
+    ib_thread_pool_t *thread_pool;      /**< Created on first use. */
+
+    /* Interned strings; see ib_engine_intern(). */
+    ib_lock_t *strings_lock; /**< Protects strings. */
+    ib_hash_t *strings;      /**< Interned strings, keyed by themselves. */
+
     /* Context selection function registration; both active and core */
     ib_ctxsel_registration_t act_ctxsel;  /**< Active context selection reg. */
     ib_ctxsel_registration_t core_ctxsel; /**< Core context selection reg. */
@@ -192,8 +236,21 @@ struct ib_engine_t {
 
     /* Where stream processor definitions are stored. */
     ib_stream_processor_registry_t *stream_processor_registry;
+
+    /* Counters; see ib_engine_metrics_get().  Updated atomically, as
+     * connections and transactions are handled on many threads. */
+    ib_engine_metrics_t metrics;
 };
 
+/**
+ * Add @a n to the engine counter @a counter.
+ *
+ * @param[in] counter Member of @ref ib_engine_metrics_t.
+ * @param[in] n Amount to add.
+ */
+#define IB_ENGINE_METRIC_ADD(counter, n) \
+    __atomic_fetch_add(&(counter), (n), __ATOMIC_RELAXED)
+
 /**
  * Configuration context data.
  */
@@ -221,7 +278,14 @@ struct ib_context_t {
     ib_mpool_t           *mp;          /**< Memory pool */
     ib_mm_t               mm;          /**< Memory manager */
     ib_cfgmap_t          *cfg;         /**< Config map */
-    ib_array_t           *cfgdata;     /**< Config data */
+    /**
+     * Config data of each module, indexed by module index.
+     *
+     * A flat table, so that looking up the config of a module, which
+     * every transaction does many times, is a single load.
+     */
+    ib_context_data_t   **cfgdata;
+    size_t                cfgdata_size; /**< Number of slots of cfgdata */
     ib_context_t         *parent;      /**< Parent context */
     ib_list_t            *children;    /**< Child contexts */
     ib_ctype_t            ctype;       /**< Context type */
@@ -25,7 +25,7 @@
 #include "ironbee_config_auto.h"
 
 #include <ironbee/logevent.h>
-#include <ironbee/mm_mpool_lite.h>
+#include <ironbee/core.h>
 #include <ironbee/state_notify.h>
 
 #include <assert.h>
@@ -36,6 +36,7 @@
 #endif
 #include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
 
 /** Log Event Types */
 static const char *ib_logevent_type_str[] = {
@@ -120,29 +121,14 @@ ib_status_t ib_logevent_create(ib_logevent_t **ple,
      */
 #define IB_LEVENT_MSG_BUF_SIZE 1024
 
-    ib_mpool_lite_t *mpl;
-    ib_mm_t mpl_mm;
-    char *buf;
+    char buf[IB_LEVENT_MSG_BUF_SIZE];
     va_list ap;
     int len = 0;
     ib_status_t rc;
 
-    rc = ib_mpool_lite_create(&mpl);
-    if (rc != IB_OK) {
-        return rc;
-    }
-    mpl_mm = ib_mm_mpool_lite(mpl);
-
-    buf = ib_mm_alloc(mpl_mm, IB_LEVENT_MSG_BUF_SIZE);
-    if (buf == NULL) {
-        rc = IB_EALLOC;
-        goto return_rc;
-    }
-
     *ple = (ib_logevent_t *)ib_mm_calloc(mm, 1, sizeof(**ple));
     if (*ple == NULL) {
-        rc = IB_EALLOC;
-        goto return_rc;
+        return IB_EALLOC;
     }
 
     (*ple)->event_id   = 0;
@@ -153,15 +139,15 @@ ib_status_t ib_logevent_create(ib_logevent_t **ple,
     (*ple)->confidence = confidence;
     (*ple)->severity   = severity;
     (*ple)->suppress   = IB_LEVENT_SUPPRESS_NONE;
+    (*ple)->count      = 1;
 
     if ((*ple)->rule_id == NULL) {
-        rc = IB_EALLOC;
-        goto return_rc;
+        return IB_EALLOC;
     }
 
     rc = ib_list_create(&((*ple)->tags), mm);
     if (rc != IB_OK) {
-        goto return_rc;
+        return rc;
     }
 
     /*
@@ -172,15 +158,20 @@ ib_status_t ib_logevent_create(ib_logevent_t **ple,
     len = vsnprintf(buf, IB_LEVENT_MSG_BUF_SIZE, fmt, ap);
     if (len >= IB_LEVENT_MSG_BUF_SIZE) {
         memcpy(buf + (IB_LEVENT_MSG_BUF_SIZE - 4), "...", 3);
+        len = IB_LEVENT_MSG_BUF_SIZE - 1;
     }
     va_end(ap);
+    if (len < 0) {
+        return IB_EINVAL;
+    }
 
     /* Copy the formatted message. */
-    (*ple)->msg = ib_mm_strdup(mm, buf);
+    (*ple)->msg = ib_mm_memdup_to_str(mm, buf, len);
+    if ((*ple)->msg == NULL) {
+        return IB_EALLOC;
+    }
 
-return_rc:
-    ib_mpool_lite_destroy(mpl);
-    return rc;
+    return IB_OK;
 }
 
 ib_status_t ib_logevent_tag_add(ib_logevent_t *le,
@@ -219,18 +210,67 @@ ib_status_t ib_logevent_data_set(ib_logevent_t *le,
 }
 
 
+/**
+ * Is @a e a duplicate of @a other?
+ *
+ * @param[in] e     Event being added.
+ * @param[in] other Event already added.
+ *
+ * @returns True if @a other stands for @a e.
+ */
+static bool logevent_is_duplicate(
+    const ib_logevent_t *e,
+    const ib_logevent_t *other
+)
+{
+    return
+        (other->suppress   == IB_LEVENT_SUPPRESS_NONE) &&
+        (other->type       == e->type) &&
+        (other->rec_action == e->rec_action) &&
+        (other->confidence == e->confidence) &&
+        (other->severity   == e->severity) &&
+        (strcmp(other->rule_id, e->rule_id) == 0) &&
+        (strcmp(other->msg, e->msg) == 0);
+}
+
 ib_status_t ib_logevent_add(ib_tx_t       *tx,
                             ib_logevent_t *e)
 {
     ib_status_t rc;
+    ib_core_cfg_t *corecfg;
+    ib_list_node_t *node;
+    size_t num_events;
 
     if (tx == NULL || e == NULL) {
         return IB_EINVAL;
     }
 
+    /* A rule firing once per value repeats the same event; keep one. */
+    IB_LIST_LOOP(tx->logevents, node) {
+        ib_logevent_t *other = (ib_logevent_t *)ib_list_node_data(node);
+        if (logevent_is_duplicate(e, other)) {
+            ++other->count;
+            return IB_OK;
+        }
+    }
+
+    num_events = ib_list_elements(tx->logevents);
+    rc = ib_core_context_config(tx->ctx, &corecfg);
+    if (
+        (rc == IB_OK) &&
+        (corecfg->logevent_limit > 0) &&
+        (num_events >= (size_t)corecfg->logevent_limit)
+    ) {
+        ib_log_debug_tx(tx,
+                        "Dropping event from rule %s: "
+                        "limit of %" PRId64 " events reached.",
+                        e->rule_id, corecfg->logevent_limit);
+        return IB_OK;
+    }
+
     /* Ensure there is an event ID and it is unique to this list. */
     if (e->event_id == 0) {
-        e->event_id = (uint32_t)ib_list_elements(tx->logevents); /* truncated */
+        e->event_id = (uint32_t)num_events; /* truncated */
     }
 
     rc = ib_list_push(tx->logevents, e);
@@ -30,7 +30,61 @@
 #include <ironbee/type_convert.h>
 
 #include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Number of records a @ref ib_logger_writer_t can hold.  Must be a power of 2.
+ */
+#define LOGGER_RING_SIZE 1024
+
+/**
+ * Times a producer yields to the writer when its ring is full before it
+ * sleeps between retries.
+ */
+#define LOGGER_RING_YIELDS 100
+
+/**
+ * A slot in a @ref logger_ring_t.
+ */
+struct logger_ring_slot_t {
+    /**
+     * Position this slot is ready for.
+     *
+     * A slot at index @c i is free for the producer of position @c p when
+     * @c sequence is @c p and holds the record of position @c p when
+     * @c sequence is @c p+1.
+     */
+    size_t  sequence;
+    void   *record;   /**< The record. */
+};
+typedef struct logger_ring_slot_t logger_ring_slot_t;
+
+/**
+ * Bounded lock-free queue of formatted records.
+ *
+ * Any number of threads may push records without locking.  Records are
+ * popped by one thread at a time; ib_logger_dequeue() serializes consumers
+ * with a lock that producers never take.
+ */
+struct logger_ring_t {
+    logger_ring_slot_t *slots;       /**< LOGGER_RING_SIZE slots. */
+    size_t              enqueue_pos; /**< Next position to push. */
+    size_t              dequeue_pos; /**< Next position to pop. */
+    /**
+     * Records pushed but not yet accounted for by the consumer.
+     *
+     * A producer that raises this from 0 signals the writer.
+     */
+    long                pending;
+};
+typedef struct logger_ring_t logger_ring_t;
 
 /**
  * A collection of callbacks and function pointer that implement a logger.
@@ -45,8 +99,9 @@ struct ib_logger_writer_t {
     ib_logger_format_t    *format;      /**< Format a message.  */
     ib_logger_record_fn_t  record_fn;   /**< Signal a record is ready. */
     void                  *record_data; /**< Callback data. */
-    ib_queue_t            *records;     /**< Records for the log writer. */
-    ib_lock_t             *records_lck; /**< Guard the queue. */
+    pid_t                  record_pid;  /**< Process that last signaled. */
+    logger_ring_t          records;     /**< Records for the log writer. */
+    ib_lock_t             *records_lck; /**< Serialize consumers. */
 };
 
 //! Identify the type of a logger callback function.
@@ -203,20 +258,113 @@ typedef struct logger_write_cbdata_t {
 } logger_write_cbdata_t;
 
 /**
- * The maximum depth of a message queue in a @ref ib_logger_writer_t.
+ * Initialize a ring.
+ *
+ * @param[out] ring The ring.
+ * @param[in] mm Memory manager to allocate slots from.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
  */
-static const size_t MAX_QUEUE_DEPTH = 1000;
+static ib_status_t logger_ring_init(logger_ring_t *ring, ib_mm_t mm)
+{
+    assert(ring != NULL);
+
+    ring->slots = ib_mm_alloc(mm, LOGGER_RING_SIZE * sizeof(*ring->slots));
+    if (ring->slots == NULL) {
+        return IB_EALLOC;
+    }
+    for (size_t i = 0; i < LOGGER_RING_SIZE; ++i) {
+        ring->slots[i].sequence = i;
+        ring->slots[i].record   = NULL;
+    }
+    ring->enqueue_pos = 0;
+    ring->dequeue_pos = 0;
+    ring->pending     = 0;
+
+    return IB_OK;
+}
+
+/**
+ * Push a record onto a ring.  Safe to call from any number of threads.
+ *
+ * @param[in] ring The ring.
+ * @param[in] record The record.
+ *
+ * @returns True on success, false if the ring is full.
+ */
+static bool logger_ring_push(logger_ring_t *ring, void *record)
+{
+    logger_ring_slot_t *slot;
+    size_t pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+
+    for (;;) {
+        size_t   sequence;
+        intptr_t diff;
+
+        slot     = &ring->slots[pos & (LOGGER_RING_SIZE - 1)];
+        sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        diff     = (intptr_t)sequence - (intptr_t)pos;
+
+        if (diff == 0) {
+            /* On failure, pos is updated to the current position. */
+            if (__atomic_compare_exchange_n(
+                    &ring->enqueue_pos, &pos, pos + 1, true,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            /* The slot still holds a record a full lap behind. */
+            return false;
+        }
+        else {
+            pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->record = record;
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/**
+ * Pop a record from a ring.  Only one thread may pop at a time.
+ *
+ * @param[in] ring The ring.
+ * @param[out] record The record.
+ *
+ * @returns True on success, false if the ring is empty.
+ */
+static bool logger_ring_pop(logger_ring_t *ring, void **record)
+{
+    size_t              pos  = ring->dequeue_pos;
+    logger_ring_slot_t *slot = &ring->slots[pos & (LOGGER_RING_SIZE - 1)];
+
+    if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != pos + 1) {
+        return false;
+    }
+
+    *record = slot->record;
+    __atomic_store_n(
+        &slot->sequence, pos + LOGGER_RING_SIZE, __ATOMIC_RELEASE);
+    ring->dequeue_pos = pos + 1;
+
+    return true;
+}
 
 /**
  * The implementation for logger_log().
  *
  * This function will
  * - Format the message stored in @a cbdata as a @ref logger_write_cbdata_t.
- * - Lock the message queue.
- * - Enqueue the formatted message.
- * - If the message is the only message in the queue,
- *   ib_logger_writer_t::record_fn is called to signal the
- *   writer that at least one record is available.
+ * - Push the formatted message onto the writer's ring without locking.
+ * - If the ring was empty, or this is the first record of this process,
+ *   ib_logger_writer_t::record_fn is called to signal the writer that at
+ *   least one record is available.
  *
  * @param[in] logger The logger.
  * @param[in] writer The logger writer to send the message to.
@@ -234,6 +382,8 @@ static ib_status_t logger_write(
 {
     ib_status_t rc;
     void *rec = NULL;
+    pid_t pid;
+    int waits;
     logger_write_cbdata_t *logger_write_data = (logger_write_cbdata_t *)cbdata;
 
     if (writer->format == NULL) {
@@ -258,43 +408,35 @@ static ib_status_t logger_write(
         return rc;
     }
 
-    rc = ib_lock_lock(writer->records_lck);
-    if (rc != IB_OK) {
-        return rc;
-    }
-
     /* Busy-wait until the queue has space available.
-     * This is emergency code to avoid a crash at the cost of a slowdown. */
-    while (ib_queue_size(writer->records) >= MAX_QUEUE_DEPTH) {
-        rc = ib_lock_unlock(writer->records_lck);
-        if (rc != IB_OK) {
-            return rc;
-        }
-
+     * This is emergency code to avoid a crash at the cost of a slowdown.
+     * A draining writer frees slots within microseconds, so yield first and
+     * only sleep if it stays full. */
+    for (waits = 0; ! logger_ring_push(&(writer->records), rec); ++waits) {
         /* TODO - The number of times we need to sleep should be
          *        audited. It is a good indicator of excessive logging or
          *        proxy load. */
-        sleep(1);
-        rc = ib_lock_lock(writer->records_lck);
-        if (rc != IB_OK) {
-            return rc;
+        if (waits < LOGGER_RING_YIELDS) {
+            sched_yield();
+        }
+        else {
+            usleep(1000);
         }
     }
 
-    rc = ib_queue_push_front(writer->records, rec);
-    if (rc != IB_OK) {
-        return rc;
-    }
-
-    /* If the queue is size=1, unlock and notify writers. */
-    if (ib_queue_size(writer->records) == 1) {
-        ib_lock_unlock(writer->records_lck);
-        rc = writer->record_fn(logger, writer, writer->record_data);
-        return rc;
+    /* If the queue was empty, notify writers.  A child of fork() inherits
+     * the pending count of its parent but not a thread the parent signaled,
+     * so the first record of each process also notifies. */
+    pid = getpid();
+    if (__atomic_fetch_add(&(writer->records.pending), 1, __ATOMIC_SEQ_CST)
+        == 0 ||
+        __atomic_load_n(&(writer->record_pid), __ATOMIC_RELAXED) != pid)
+    {
+        __atomic_store_n(&(writer->record_pid), pid, __ATOMIC_RELAXED);
+        return writer->record_fn(logger, writer, writer->record_data);
     }
 
-    ib_lock_unlock(writer->records_lck);
-    return rc;
+    return IB_OK;
 }
 
 /**
@@ -688,7 +830,8 @@ ib_status_t ib_logger_writer_add(
     writer->format      = format;
     writer->record_fn   = record_fn;
     writer->record_data = record_data;
-    rc = ib_queue_create(&(writer->records), logger->mm, IB_QUEUE_NEVER_SHRINK);
+    writer->record_pid  = 0;
+    rc = logger_ring_init(&(writer->records), logger->mm);
     if (rc != IB_OK) {
         return rc;
     }
@@ -872,9 +1015,10 @@ ib_status_t ib_logger_dequeue(
 {
     assert(logger != NULL);
     assert(writer != NULL);
-    assert(writer->records != NULL);
+    assert(writer->records.slots != NULL);
 
     ib_status_t rc;
+    long        remaining;
     logger_handler_cbdata_t logger_handler_cbdata = {
         .logger    = logger,
         .user_fn   = handler,
@@ -888,16 +1032,246 @@ ib_status_t ib_logger_dequeue(
         return rc;
     }
 
-    rc = ib_queue_dequeue_all_to_function(
-        writer->records,
-        logger_handler,
-        &logger_handler_cbdata);
+    /* Records pushed while draining did not signal the writer as pending
+     * was not yet 0, so keep draining until every counted record is gone. */
+    for (;;) {
+        void *record;
+        long  popped = 0;
 
-    ib_lock_unlock(writer->records_lck);
+        while (logger_ring_pop(&(writer->records), &record)) {
+            logger_handler(record, &logger_handler_cbdata);
+            ++popped;
+        }
+        remaining = __atomic_sub_fetch(
+            &(writer->records.pending), popped, __ATOMIC_SEQ_CST);
+        if (remaining <= 0) {
+            break;
+        }
+
+        /* A producer has claimed the next slot but not yet filled it; let
+         * it run rather than spin against it. */
+        if (popped == 0) {
+            sched_yield();
+        }
+    }
+
+    rc = ib_lock_unlock(writer->records_lck);
+
+    return rc;
+}
+
+/**
+ * See ib_logger_async_t.
+ */
+struct ib_logger_async_t {
+    ib_logger_t                *logger;   /**< The logger. */
+    ib_logger_writer_t         *writer;   /**< Writer to drain; set on record. */
+    ib_queue_element_fn_t       handler;  /**< Record handler. */
+    ib_logger_async_flush_fn_t  flush_fn; /**< Batch flush function. */
+    void                       *cbdata;   /**< Callback data. */
+    pthread_t                   thread;   /**< Writer thread. */
+    pthread_mutex_t             mutex;    /**< Guards the fields below. */
+    pthread_cond_t              cond;     /**< Signals the writer thread. */
+    bool                        signaled; /**< Records are waiting. */
+    bool                        stop;     /**< Stopped; write synchronously. */
+    /**
+     * Process that started @a thread or 0 if none has.
+     *
+     * Threads do not survive fork(), so the thread is started by the first
+     * record of each process.
+     */
+    pid_t                       pid;
+};
+
+/**
+ * Write the queued records of @a writer and flush them.
+ *
+ * @param[in] async The asynchronous writer.
+ * @param[in] writer The writer with queued records.
+ *
+ * @returns Result of ib_logger_dequeue().
+ */
+static ib_status_t logger_async_drain(
+    ib_logger_async_t  *async,
+    ib_logger_writer_t *writer
+)
+{
+    ib_status_t rc;
+
+    rc = ib_logger_dequeue(async->logger, writer, async->handler,
+                           async->cbdata);
+    if (async->flush_fn != NULL) {
+        async->flush_fn(async->cbdata);
+    }
 
     return rc;
 }
 
+/**
+ * Body of the asynchronous writer thread.
+ *
+ * @param[in] data The @ref ib_logger_async_t.
+ *
+ * @returns NULL
+ */
+static void *logger_async_thread(void *data)
+{
+    assert(data != NULL);
+
+    ib_logger_async_t *async = (ib_logger_async_t *)data;
+
+    pthread_mutex_lock(&(async->mutex));
+    for (;;) {
+        ib_logger_writer_t *writer;
+
+        while (! async->signaled && ! async->stop) {
+            pthread_cond_wait(&(async->cond), &(async->mutex));
+        }
+        /* Drain before honoring a stop request. */
+        if (! async->signaled) {
+            break;
+        }
+        async->signaled = false;
+        writer = async->writer;
+        pthread_mutex_unlock(&(async->mutex));
+
+        if (writer != NULL) {
+            logger_async_drain(async, writer);
+        }
+
+        pthread_mutex_lock(&(async->mutex));
+    }
+    pthread_mutex_unlock(&(async->mutex));
+
+    return NULL;
+}
+
+/**
+ * Memory manager cleanup function that stops an asynchronous writer.
+ *
+ * @param[in] data The @ref ib_logger_async_t.
+ */
+static void logger_async_cleanup(void *data)
+{
+    ib_logger_async_stop((ib_logger_async_t *)data);
+}
+
+ib_status_t ib_logger_async_create(
+    ib_logger_async_t          **async,
+    ib_logger_t                 *logger,
+    ib_queue_element_fn_t        handler,
+    ib_logger_async_flush_fn_t   flush_fn,
+    void                        *cbdata
+)
+{
+    assert(async != NULL);
+    assert(logger != NULL);
+    assert(handler != NULL);
+
+    ib_logger_async_t *new_async;
+    ib_status_t        rc;
+
+    new_async = ib_mm_calloc(logger->mm, 1, sizeof(*new_async));
+    if (new_async == NULL) {
+        return IB_EALLOC;
+    }
+
+    new_async->logger   = logger;
+    new_async->handler  = handler;
+    new_async->flush_fn = flush_fn;
+    new_async->cbdata   = cbdata;
+
+    if (pthread_mutex_init(&(new_async->mutex), NULL) != 0) {
+        return IB_EOTHER;
+    }
+    if (pthread_cond_init(&(new_async->cond), NULL) != 0) {
+        pthread_mutex_destroy(&(new_async->mutex));
+        return IB_EOTHER;
+    }
+
+    rc = ib_mm_register_cleanup(logger->mm, logger_async_cleanup, new_async);
+    if (rc != IB_OK) {
+        pthread_cond_destroy(&(new_async->cond));
+        pthread_mutex_destroy(&(new_async->mutex));
+        return rc;
+    }
+
+    *async = new_async;
+
+    return IB_OK;
+}
+
+ib_status_t ib_logger_async_record(
+    ib_logger_t        *logger,
+    ib_logger_writer_t *writer,
+    void               *data
+)
+{
+    assert(logger != NULL);
+    assert(writer != NULL);
+    assert(data != NULL);
+
+    ib_logger_async_t *async = (ib_logger_async_t *)data;
+    pid_t              pid   = getpid();
+
+    pthread_mutex_lock(&(async->mutex));
+    if (async->stop) {
+        /* Stopped; write synchronously. */
+        pthread_mutex_unlock(&(async->mutex));
+        return logger_async_drain(async, writer);
+    }
+    if (async->pid != pid) {
+        /* The condition still counts the thread of the parent as a
+         * waiter, which would take the signals meant for ours. */
+        if (async->pid != 0) {
+            pthread_cond_init(&(async->cond), NULL);
+        }
+        if (pthread_create(&(async->thread), NULL,
+                           logger_async_thread, async) != 0)
+        {
+            pthread_mutex_unlock(&(async->mutex));
+            return logger_async_drain(async, writer);
+        }
+        async->pid = pid;
+    }
+    async->writer   = writer;
+    async->signaled = true;
+    pthread_cond_signal(&(async->cond));
+    pthread_mutex_unlock(&(async->mutex));
+
+    return IB_OK;
+}
+
+void ib_logger_async_stop(
+    ib_logger_async_t *async
+)
+{
+    assert(async != NULL);
+
+    ib_logger_writer_t *writer;
+
+    pthread_mutex_lock(&(async->mutex));
+    if (async->stop) {
+        pthread_mutex_unlock(&(async->mutex));
+        return;
+    }
+    async->stop = true;
+    writer = async->writer;
+
+    if (async->pid == getpid()) {
+        pthread_cond_signal(&(async->cond));
+        pthread_mutex_unlock(&(async->mutex));
+        pthread_join(async->thread, NULL);
+        return;
+    }
+    pthread_mutex_unlock(&(async->mutex));
+
+    /* No thread of this process; write what is queued here. */
+    if (writer != NULL) {
+        logger_async_drain(async, writer);
+    }
+}
+
 size_t ib_logger_writer_count(ib_logger_t *logger) {
     assert(logger != NULL);
     assert(logger->writers != NULL);
@@ -946,107 +1320,105 @@ void ib_logger_standard_msg_free(
     }
 }
 
-ib_status_t ib_logger_standard_formatter_notime(
-    ib_logger_t           *logger,
-    const ib_logger_rec_t *rec,
-    const uint8_t         *log_msg,
-    const size_t           log_msg_sz,
-    void                  *writer_record,
-    void                  *data
-)
-{
-    assert(logger != NULL);
-    assert(rec != NULL);
-    assert(log_msg != NULL);
-    assert(writer_record != NULL);
-
-    ib_logger_standard_msg_t *msg;
-
-    if (rec->type != IB_LOGGER_ERRORLOG_TYPE) {
-        return IB_DECLINED;
-    }
-
-    msg = malloc(sizeof(*msg));
-    if (msg == NULL) {
-        goto out_of_mem;
-    }
-
-    msg->prefix = NULL;
-    msg->msg = NULL;
+/**
+ * Length of the time of the standard formatter, with NUL.
+ */
+#define LOGGER_TIME_SIZE (32 + 1)
 
-    /* 100 is more than sufficient. */
-    msg->prefix = (char *)malloc(100);
-    if (msg->prefix == NULL) {
-        goto out_of_mem;
-    }
+/**
+ * The time of the standard formatter, formatted once a second per thread.
+ *
+ * Formatting the time is most of the work of formatting the prefix of a
+ * message, and every message of the same second has the same one.
+ */
+typedef struct {
+    time_t second;                 /**< Time of @c text. */
+    char   text[LOGGER_TIME_SIZE]; /**< Formatted time. */
+} logger_time_cache_t;
+
+/** Key of the time cache of the current thread. */
+static pthread_key_t s_time_cache_key;
+/** Whether s_time_cache_key was created. */
+static bool s_time_cache_key_valid = false;
+/** Creates s_time_cache_key once. */
+static pthread_once_t s_time_cache_once = PTHREAD_ONCE_INIT;
 
-    sprintf(
-        msg->prefix,
-        "%-10s- ",
-        ib_logger_level_to_string(rec->level));
+/**
+ * Create s_time_cache_key.
+ */
+static void logger_time_cache_init(void)
+{
+    s_time_cache_key_valid =
+        (pthread_key_create(&s_time_cache_key, free) == 0);
+}
 
-    /* Add the file name and line number if available and log level >= DEBUG */
-    if ( (rec->file != NULL) &&
-         (rec->line_number > 0) &&
-         (logger->level >= IB_LOG_DEBUG) )
-    {
-        const char *file = rec->file;
-        size_t flen;
-        while (strncmp(file, "../", 3) == 0) {
-            file += 3;
-        }
-        flen = strlen(file);
-        if (flen > 23) {
-            file += (flen - 23);
+/**
+ * Format the current local time.
+ *
+ * @param[out] buf Buffer of LOGGER_TIME_SIZE bytes to write it to.
+ */
+static void logger_format_time(char *buf)
+{
+    logger_time_cache_t *cache = NULL;
+    time_t               timet = time(NULL);
+    struct tm            tminfo;
+
+    pthread_once(&s_time_cache_once, logger_time_cache_init);
+    if (s_time_cache_key_valid) {
+        cache = (logger_time_cache_t *)pthread_getspecific(s_time_cache_key);
+        if (cache == NULL) {
+            cache = (logger_time_cache_t *)calloc(1, sizeof(*cache));
+            if (
+                cache != NULL &&
+                pthread_setspecific(s_time_cache_key, cache) != 0
+            ) {
+                free(cache);
+                cache = NULL;
+            }
         }
-
-        static const size_t c_line_info_length = 35;
-        char line_info[c_line_info_length];
-        snprintf(
-            line_info,
-            c_line_info_length,
-            "(%23s:%-5d) ",
-            file,
-            (int)rec->line_number
-        );
-        strcat(msg->prefix, line_info);
-    }
-
-    /* If this is a transaction, add the TX id */
-    if (rec->tx != NULL) {
-        static const size_t c_line_info_size = 43;
-        char                line_info[c_line_info_size];
-
-        strcpy(line_info, "[tx:");
-        strcat(line_info, rec->tx->id);
-        strcat(line_info, "] ");
-        strcat(msg->prefix, line_info);
     }
 
-    msg->msg_sz = log_msg_sz;
-    msg->msg = malloc(log_msg_sz);
-    if (msg->msg == NULL) {
-        goto out_of_mem;
+    if (cache != NULL && cache->text[0] != '\0' && cache->second == timet) {
+        memcpy(buf, cache->text, LOGGER_TIME_SIZE);
+        return;
     }
-    memcpy(msg->msg, log_msg, log_msg_sz);
 
-    *(ib_logger_standard_msg_t **)writer_record = msg;
-    return IB_OK;
+    localtime_r(&timet, &tminfo);
+    strftime(buf, LOGGER_TIME_SIZE - 1, "%Y%m%d.%Hh%Mm%Ss", &tminfo);
 
-out_of_mem:
-    if (msg != NULL) {
-        ib_logger_standard_msg_free(logger, msg, data);
+    if (cache != NULL) {
+        cache->second = timet;
+        memcpy(cache->text, buf, LOGGER_TIME_SIZE);
     }
-    return IB_EALLOC;
 }
 
-ib_status_t ib_logger_standard_formatter(
+/**
+ * Implement ib_logger_standard_formatter() and its notime variant.
+ *
+ * The prefix is written in one pass, tracking its length, rather than
+ * appended to piece by piece.
+ *
+ * @param[in] logger The logger.
+ * @param[in] rec The record.
+ * @param[in] log_msg The message.
+ * @param[in] log_msg_sz Length of @a log_msg.
+ * @param[out] writer_record The @ref ib_logger_standard_msg_t.
+ * @param[in] data Callback data.
+ * @param[in] with_time Start the prefix with the time?
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_DECLINED If @a rec is not of the error log.
+ * - IB_EALLOC On allocation failure.
+ */
+static ib_status_t logger_standard_format(
     ib_logger_t           *logger,
     const ib_logger_rec_t *rec,
     const uint8_t         *log_msg,
     const size_t           log_msg_sz,
     void                  *writer_record,
-    void                  *data
+    void                  *data,
+    bool                   with_time
 )
 {
     assert(logger != NULL);
@@ -1054,10 +1426,12 @@ ib_status_t ib_logger_standard_formatter(
     assert(log_msg != NULL);
     assert(writer_record != NULL);
 
-    char                      time_info[32 + 1];
-    struct tm                *tminfo;
-    time_t                    timet;
+    /* Time, level, file and line and tx id all fit. */
+    static const size_t       c_prefix_size = LOGGER_TIME_SIZE + 100;
+    char                      time_info[LOGGER_TIME_SIZE];
     ib_logger_standard_msg_t *msg;
+    char                     *prefix;
+    int                       len = 0;
 
     if (rec->type != IB_LOGGER_ERRORLOG_TYPE) {
         return IB_DECLINED;
@@ -1071,21 +1445,31 @@ ib_status_t ib_logger_standard_formatter(
     msg->prefix = NULL;
     msg->msg = NULL;
 
-    timet = time(NULL);
-    tminfo = localtime(&timet);
-    strftime(time_info, sizeof(time_info)-1, "%Y%m%d.%Hh%Mm%Ss", tminfo);
-
-    /* 100 is more than sufficient. */
-    msg->prefix = (char *)malloc(strlen(time_info) + 100);
+    msg->prefix = (char *)malloc(c_prefix_size);
     if (msg->prefix == NULL) {
         goto out_of_mem;
     }
+    prefix = msg->prefix;
 
-    sprintf(
-        msg->prefix,
-        "%s %-10s- ",
-        time_info,
-        ib_logger_level_to_string(rec->level));
+    if (with_time) {
+        logger_format_time(time_info);
+        len = snprintf(
+            prefix,
+            c_prefix_size,
+            "%s %-10s- ",
+            time_info,
+            ib_logger_level_to_string(rec->level));
+    }
+    else {
+        len = snprintf(
+            prefix,
+            c_prefix_size,
+            "%-10s- ",
+            ib_logger_level_to_string(rec->level));
+    }
+    if (len < 0 || (size_t)len >= c_prefix_size) {
+        len = 0;
+    }
 
     /* Add the file name and line number if available and log level >= DEBUG */
     if ( (rec->file != NULL) &&
@@ -1102,27 +1486,25 @@ ib_status_t ib_logger_standard_formatter(
             file += (flen - 23);
         }
 
-        static const size_t c_line_info_length = 35;
-        char line_info[c_line_info_length];
-        snprintf(
-            line_info,
-            c_line_info_length,
+        len += snprintf(
+            prefix + len,
+            c_prefix_size - len,
             "(%23s:%-5d) ",
             file,
             (int)rec->line_number
         );
-        strcat(msg->prefix, line_info);
+        if ((size_t)len >= c_prefix_size) {
+            len = c_prefix_size - 1;
+        }
     }
 
     /* If this is a transaction, add the TX id */
     if (rec->tx != NULL) {
-        static const size_t c_line_info_size = 43;
-        char                line_info[c_line_info_size];
-
-        strcpy(line_info, "[tx:");
-        strcat(line_info, rec->tx->id);
-        strcat(line_info, "] ");
-        strcat(msg->prefix, line_info);
+        snprintf(
+            prefix + len,
+            c_prefix_size - len,
+            "[tx:%s] ",
+            rec->tx->id);
     }
 
     msg->msg_sz = log_msg_sz;
@@ -1142,6 +1524,32 @@ out_of_mem:
     return IB_EALLOC;
 }
 
+ib_status_t ib_logger_standard_formatter_notime(
+    ib_logger_t           *logger,
+    const ib_logger_rec_t *rec,
+    const uint8_t         *log_msg,
+    const size_t           log_msg_sz,
+    void                  *writer_record,
+    void                  *data
+)
+{
+    return logger_standard_format(
+        logger, rec, log_msg, log_msg_sz, writer_record, data, false);
+}
+
+ib_status_t ib_logger_standard_formatter(
+    ib_logger_t           *logger,
+    const ib_logger_rec_t *rec,
+    const uint8_t         *log_msg,
+    const size_t           log_msg_sz,
+    void                  *writer_record,
+    void                  *data
+)
+{
+    return logger_standard_format(
+        logger, rec, log_msg, log_msg_sz, writer_record, data, true);
+}
+
 static void default_log_writer(void *record, void *cbdata) {
     assert(record != NULL);
     assert(cbdata != NULL);
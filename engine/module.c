@@ -38,6 +38,7 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
 
 /**
  * Context open hook
@@ -136,7 +137,12 @@ ib_status_t ib_module_register(const ib_module_t *mod, ib_engine_t *ib)
 
     /* Init and register the module */
     if (m->fn_init != NULL) {
+        const ib_module_t *initializing = ib->module_initializing;
+
+        /* Modules may register other modules as they initialize. */
+        ib->module_initializing = m;
         rc = m->fn_init(ib, m, m->cbdata_init);
+        ib->module_initializing = initializing;
         if (rc != IB_OK) {
             ib_log_error(ib, "Error initializing module %s: %s",
                          m->name, ib_status_to_string(rc));
@@ -297,6 +303,67 @@ void ib_module_unload(ib_module_t *m)
     }
 }
 
+/**
+ * Store the config data of a module in the table of a context.
+ *
+ * @param[in] ctx     Context.
+ * @param[in] idx     Module index.
+ * @param[in] cfgdata Config data.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static ib_status_t context_cfgdata_set(
+    ib_context_t      *ctx,
+    size_t             idx,
+    ib_context_data_t *cfgdata
+)
+{
+    assert(ctx != NULL);
+
+    if (idx >= ctx->cfgdata_size) {
+        size_t              size = (ctx->cfgdata_size == 0) ?
+                                   16 : ctx->cfgdata_size;
+        ib_context_data_t **table;
+
+        while (idx >= size) {
+            size *= 2;
+        }
+        table = ib_mm_calloc(ctx->mm, size, sizeof(*table));
+        if (table == NULL) {
+            return IB_EALLOC;
+        }
+        if (ctx->cfgdata_size > 0) {
+            memcpy(table, ctx->cfgdata,
+                   ctx->cfgdata_size * sizeof(*table));
+        }
+        ctx->cfgdata = table;
+        ctx->cfgdata_size = size;
+    }
+
+    ctx->cfgdata[idx] = cfgdata;
+    return IB_OK;
+}
+
+/**
+ * Get the config data of a module from the table of a context.
+ *
+ * @param[in] ctx Context.
+ * @param[in] idx Module index.
+ *
+ * @returns Config data or NULL if there is none.
+ */
+static ib_context_data_t *context_cfgdata_get(
+    const ib_context_t *ctx,
+    size_t              idx
+)
+{
+    assert(ctx != NULL);
+
+    return (idx < ctx->cfgdata_size) ? ctx->cfgdata[idx] : NULL;
+}
+
 ib_status_t ib_module_register_context(ib_module_t *m,
                                        ib_context_t *ctx)
 {
@@ -317,8 +384,8 @@ ib_status_t ib_module_register_context(ib_module_t *m,
     cfgdata->module = m;
 
     if (p_ctx != NULL) {
-        rc = ib_array_get(p_ctx->cfgdata, m->idx, &p_cfgdata);
-        if (rc == IB_OK) {
+        p_cfgdata = context_cfgdata_get(p_ctx, m->idx);
+        if (p_cfgdata != NULL) {
             src_data = p_cfgdata->data;
             src_length = p_cfgdata->data_length;
         }
@@ -357,7 +424,7 @@ ib_status_t ib_module_register_context(ib_module_t *m,
     /* Keep track of module specific context data using the
      * module index as the key so that the location is deterministic.
      */
-    rc = ib_array_setn(ctx->cfgdata, m->idx, cfgdata);
+    rc = context_cfgdata_set(ctx, m->idx, cfgdata);
     return rc;
 }
 
@@ -369,14 +436,13 @@ ib_status_t ib_module_config_initialize(
     assert(module);
     assert(module->ib);
 
-    ib_status_t rc;
     ib_context_t *main_context = ib_context_main(module->ib);
     ib_context_data_t *main_cfgdata = NULL;
 
     assert(main_context);
 
-    rc = ib_array_get(main_context->cfgdata, module->idx, &main_cfgdata);
-    if (rc != IB_OK || main_cfgdata->data != NULL) {
+    main_cfgdata = context_cfgdata_get(main_context, module->idx);
+    if (main_cfgdata == NULL || main_cfgdata->data != NULL) {
         return IB_EINVAL;
     }
     main_cfgdata->data        = cfg;
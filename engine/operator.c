@@ -28,7 +28,16 @@
 
 #include "engine_private.h"
 
+#include <ironbee/context.h>
+#include <ironbee/engine.h>
+#include <ironbee/escape.h>
+#include <ironbee/flags.h>
+#include <ironbee/hash.h>
+#include <ironbee/var.h>
+
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
 
 struct ib_operator_t {
     /*! Name of the operator. */
@@ -54,6 +63,12 @@ struct ib_operator_t {
 
     /*! Execute callback data. */
     void *execute_cbdata;
+
+    /*! Instance batch execution function (or NULL). */
+    ib_operator_execute_batch_fn_t execute_batch_fn;
+
+    /*! Batch execute callback data. */
+    void *execute_batch_cbdata;
 };
 
 struct ib_operator_inst_t
@@ -64,6 +79,9 @@ struct ib_operator_inst_t
     /*! Parameters. */
     const char *parameters;
 
+    /*! Capabilities of this instance; see ib_operator_inst_capabilities(). */
+    ib_flags_t capabilities;
+
     /*! Instance data. */
     void *instance_data;
 };
@@ -100,12 +118,26 @@ ib_status_t ib_operator_create(
     local_op->destroy_cbdata = destroy_cbdata;
     local_op->execute_fn     = execute_fn;
     local_op->execute_cbdata = execute_cbdata;
+    local_op->execute_batch_fn     = NULL;
+    local_op->execute_batch_cbdata = NULL;
 
     *op = local_op;
 
     return IB_OK;
 }
 
+void ib_operator_set_execute_batch(
+    ib_operator_t                  *op,
+    ib_operator_execute_batch_fn_t  execute_batch_fn,
+    void                           *execute_batch_cbdata
+)
+{
+    assert(op != NULL);
+
+    op->execute_batch_fn     = execute_batch_fn;
+    op->execute_batch_cbdata = execute_batch_cbdata;
+}
+
 ib_status_t ib_operator_register(
     ib_engine_t         *ib,
     const ib_operator_t *op
@@ -280,6 +312,15 @@ ib_flags_t ib_operator_capabilities(
     return op->capabilities;
 }
 
+bool ib_operator_has_execute_batch(
+    const ib_operator_t *op
+)
+{
+    assert(op != NULL);
+
+    return op->execute_batch_fn != NULL;
+}
+
 /*! Cleanup function to destroy operator. */
 static
 void cleanup_op(
@@ -302,6 +343,44 @@ void cleanup_op(
 }
 
 
+/**
+ * Do operator parameters contain a var expansion?
+ *
+ * Operators unescape their parameters before testing them for an
+ * expansion, so the unescaped form is tested as well.
+ *
+ * @param[in] mm Memory manager for the unescaped copy.
+ * @param[in] parameters Parameters to test.
+ *
+ * @returns true if @a parameters may be expanded at execution.
+ */
+static bool parameters_expand(ib_mm_t mm, const char *parameters)
+{
+    assert(parameters != NULL);
+
+    const size_t len = strlen(parameters);
+    char        *unesc;
+    size_t       unesc_len;
+
+    if (ib_var_expand_test(parameters, len)) {
+        return true;
+    }
+    if (strchr(parameters, '\\') == NULL) {
+        return false;
+    }
+
+    unesc = ib_mm_alloc(mm, len + 1);
+    if (
+        (unesc == NULL) ||
+        (ib_util_unescape_string(unesc, &unesc_len, parameters, len) != IB_OK)
+    ) {
+        /* Assume the worst. */
+        return true;
+    }
+
+    return ib_var_expand_test(unesc, unesc_len);
+}
+
 ib_status_t ib_operator_inst_create(
     ib_operator_inst_t  **op_inst,
     ib_mm_t               mm,
@@ -343,6 +422,18 @@ ib_status_t ib_operator_inst_create(
     }
     local_op_inst->op = op;
 
+    /* Expanding parameters reads the transaction vars, which may index
+     * the var store and call getters that cache into the transaction. */
+    local_op_inst->capabilities = op->capabilities;
+    if (
+        ib_flags_all(op->capabilities, IB_OP_CAPABILITY_THREAD_SAFE) &&
+        (local_op_inst->parameters != NULL) &&
+        parameters_expand(mm, local_op_inst->parameters)
+    ) {
+        ib_flags_clear(local_op_inst->capabilities,
+                       IB_OP_CAPABILITY_THREAD_SAFE);
+    }
+
     if (op->create_fn == NULL) {
         local_op_inst->instance_data = NULL;
     }
@@ -373,6 +464,85 @@ ib_status_t ib_operator_inst_create(
 }
 
 
+ib_status_t ib_operator_inst_acquire(
+    ib_operator_inst_t  **op_inst,
+    ib_context_t         *ctx,
+    const ib_operator_t  *op,
+    ib_flags_t            required_capabilities,
+    const char           *parameters
+)
+{
+    assert(op_inst != NULL);
+    assert(ctx != NULL);
+    assert(op != NULL);
+
+    ib_engine_t        *ib = ib_context_get_engine(ctx);
+    ib_mm_t             mm = ib_engine_mm_main_get(ib);
+    ib_operator_inst_t *local_op_inst;
+    char                buf[256];
+    char               *key = buf;
+    int                 key_len;
+    ib_status_t         rc;
+
+    if (! ib_flags_all(op->capabilities, IB_OP_CAPABILITY_SHAREABLE)) {
+        return ib_operator_inst_create(op_inst, mm, ctx, op,
+                                       required_capabilities, parameters);
+    }
+    if (
+        (op->capabilities & required_capabilities) !=
+        required_capabilities
+    ) {
+        return IB_EINVAL;
+    }
+
+    /* Instances are keyed by operator, context and parameters. */
+    key_len = snprintf(buf, sizeof(buf), "%p %p %s", (const void *)op,
+                       (void *)ctx, (parameters == NULL) ? "" : parameters);
+    if (key_len < 0) {
+        return IB_EOTHER;
+    }
+    if ((size_t)key_len >= sizeof(buf)) {
+        key = ib_mm_alloc(mm, key_len + 1);
+        if (key == NULL) {
+            return IB_EALLOC;
+        }
+        snprintf(key, key_len + 1, "%p %p %s", (const void *)op,
+                 (void *)ctx, (parameters == NULL) ? "" : parameters);
+    }
+
+    /* NULL and empty parameters are told apart. */
+    if (parameters == NULL) {
+        --key_len;
+    }
+
+    rc = ib_hash_get_ex(ib->operator_insts, &local_op_inst, key, key_len);
+    if (rc == IB_OK) {
+        *op_inst = local_op_inst;
+        return IB_OK;
+    }
+
+    rc = ib_operator_inst_create(&local_op_inst, mm, ctx, op,
+                                 required_capabilities, parameters);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    if (key == buf) {
+        key = ib_mm_memdup(mm, buf, key_len);
+        if (key == NULL) {
+            return IB_EALLOC;
+        }
+    }
+    rc = ib_hash_set_ex(ib->operator_insts, key, key_len, local_op_inst);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    *op_inst = local_op_inst;
+
+    return IB_OK;
+}
+
 const ib_operator_t *ib_operator_inst_operator(
     const ib_operator_inst_t *op_inst
 )
@@ -391,6 +561,15 @@ const char *ib_operator_inst_parameters(
     return op_inst->parameters;
 }
 
+ib_flags_t ib_operator_inst_capabilities(
+    const ib_operator_inst_t *op_inst
+)
+{
+    assert(op_inst != NULL);
+
+    return op_inst->capabilities;
+}
+
 void *ib_operator_inst_data(
     const ib_operator_inst_t *op_inst
 )
@@ -430,3 +609,53 @@ ib_status_t ib_operator_inst_execute(
         );
     }
 }
+
+ib_status_t ib_operator_inst_execute_batch(
+    const ib_operator_inst_t *op_inst,
+    ib_tx_t                  *tx,
+    const ib_field_t * const *inputs,
+    size_t                    count,
+    uint8_t                  *matches
+)
+{
+    assert(op_inst != NULL);
+    assert(matches != NULL);
+    assert(inputs != NULL || count == 0);
+
+    const ib_operator_t *op = ib_operator_inst_operator(op_inst);
+    size_t               i;
+
+    assert(op != NULL);
+
+    memset(matches, 0, IB_OPERATOR_BATCH_BITMAP_SIZE(count));
+
+    if (count == 0) {
+        return IB_OK;
+    }
+
+    if (op->execute_batch_fn != NULL) {
+        return op->execute_batch_fn(
+            tx,
+            inputs,
+            count,
+            matches,
+            ib_operator_inst_data(op_inst),
+            op->execute_batch_cbdata
+        );
+    }
+
+    for (i = 0; i < count; ++i) {
+        ib_num_t    result;
+        ib_status_t rc;
+
+        rc = ib_operator_inst_execute(op_inst, tx, inputs[i], NULL, &result);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        if (result != 0) {
+            IB_OPERATOR_BATCH_SET(matches, i);
+        }
+    }
+
+    return IB_OK;
+}
@@ -0,0 +1,68 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef _IB_PROBES_PRIVATE_H_
+#define _IB_PROBES_PRIVATE_H_
+
+/**
+ * @file
+ * @brief IronBee --- Engine Static Probes
+ *
+ * USDT static probes of the provider @c ironbee, for bpftrace, perf,
+ * SystemTap and the like.  They are only built when IronBee is configured
+ * with @c --enable-probes, and then cost a no-op instruction until a tool
+ * attaches to them.  Without it, the macros expand to nothing and their
+ * arguments are not evaluated.
+ *
+ * The probes, by name as the tools list them, and their arguments:
+ * - conn_create(conn_id) - A connection was created.
+ * - conn_destroy(conn_id) - A connection is being destroyed.
+ * - conn_state(state_name, conn_id) - A connection state is notified.
+ * - tx_create(tx_id, conn_id) - A transaction was created.
+ * - tx_state(state_name, tx_id) - A transaction state is notified.
+ * - tx_block(tx_id) - A transaction is being blocked.
+ * - tx_destroy(tx_id, is_blocked, request_body_len, response_body_len) -
+ *   A transaction is being destroyed.
+ *
+ * All ids and names are NUL-terminated strings.  The time from tx_create
+ * to tx_destroy is the life of a transaction, and the time from one
+ * tx_state to the next the time spent in the hooks of a state.
+ */
+
+#ifdef IB_PROBES
+
+#include <sys/sdt.h>
+
+/** Fire probe @a name with one argument. */
+#define IB_PROBE1(name, a1) \
+    DTRACE_PROBE1(ironbee, name, a1)
+/** Fire probe @a name with two arguments. */
+#define IB_PROBE2(name, a1, a2) \
+    DTRACE_PROBE2(ironbee, name, a1, a2)
+/** Fire probe @a name with four arguments. */
+#define IB_PROBE4(name, a1, a2, a3, a4) \
+    DTRACE_PROBE4(ironbee, name, a1, a2, a3, a4)
+
+#else
+
+#define IB_PROBE1(name, a1)
+#define IB_PROBE2(name, a1, a2)
+#define IB_PROBE4(name, a1, a2, a3, a4)
+
+#endif /* IB_PROBES */
+
+#endif /* _IB_PROBES_PRIVATE_H_ */
@@ -33,6 +33,7 @@
 #include <ironbee/action.h>
 #include <ironbee/bytestr.h>
 #include <ironbee/capture.h>
+#include <ironbee/clock.h>
 #include <ironbee/config.h>
 #include <ironbee/context.h>
 #include <ironbee/core.h>
@@ -40,15 +41,22 @@
 #include <ironbee/escape.h>
 #include <ironbee/field.h>
 #include <ironbee/flags.h>
+#include <ironbee/hash.h>
+#include <ironbee/lock.h>
 #include <ironbee/mm.h>
+#include <ironbee/mm_mpool_lite.h>
+#include <ironbee/mpool_lite.h>
 #include <ironbee/operator.h>
 #include <ironbee/rule_logger.h>
 #include <ironbee/string.h>
+#include <ironbee/thread_pool.h>
 #include <ironbee/transformation.h>
 #include <ironbee/util.h>
 
 #include <assert.h>
 #include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
 
 /**
  * Phase Flags
@@ -320,17 +328,47 @@ typedef struct {
     ib_rule_enable_fn_t    rule_enable_fn;
     //! Callback data for rule_enable_fn.
     void                  *rule_enable_cbdata;
+    /**
+     * Rules, by rule index, that rule_enable_fn has been called for.
+     *
+     * Enable items are shared by all contexts that inherit them, and
+     * rule_enable_fn is called at most once per rule, no matter how many
+     * location contexts the rule appears in.
+     */
+    uint64_t              *known;
+    //! Rules, by rule index, that rule_enable_fn matched.
+    uint64_t              *matched;
+    //! Number of words in known and matched.
+    size_t                 words;
 } ib_rule_enable_t;
 
+/**
+ * Number of 64 bit words in a rule bitmap covering @a limit rule indices.
+ */
+#define RULE_BITMAP_WORDS(limit) ((limit) / 64 + 1)
+
+/**
+ * Set the bit of rule index @a i in rule bitmap @a bits.
+ */
+#define RULE_BITMAP_SET(bits, i) \
+    ((bits)[(i) / 64] |= (UINT64_C(1) << ((i) % 64)))
+
+/**
+ * True iff the bit of rule index @a i in rule bitmap @a bits is set.
+ */
+#define RULE_BITMAP_ISSET(bits, i) \
+    (((bits)[(i) / 64] & (UINT64_C(1) << ((i) % 64))) != 0)
+
 /**
  * Items on the rule execution object stack
  */
-typedef struct {
+typedef struct ib_rule_exec_frame_t rule_exec_stack_frame_t;
+struct ib_rule_exec_frame_t {
     ib_rule_t              *rule;        /**< The currently rule */
     ib_rule_log_exec_t     *exec_log;    /**< Rule execution logging object */
     ib_rule_target_t       *target;      /**< The current rule target */
     ib_num_t                result;      /**< Rule execution result */
-} rule_exec_stack_frame_t;
+};
 
 /**
  * The rule engine uses recursion to walk through lists and chains.  These
@@ -339,6 +377,53 @@ typedef struct {
 #define MAX_LIST_RECURSION   (5)       /**< Max list recursion limit */
 #define MAX_CHAIN_RECURSION  (10)      /**< Max chain recursion limit */
 
+/**
+ * Initial sizes of the rule execution object stacks.  The rule stack is deep
+ * enough for the longest chain; both grow if ever needed.
+ */
+#define RULE_STACK_SIZE      (MAX_CHAIN_RECURSION + 1)
+#define VALUE_STACK_SIZE     (2 * MAX_LIST_RECURSION + 2)
+
+/**
+ * Adaptive rule ordering limits.
+ */
+#define RULE_ORDER_PERIOD      (1024)  /**< Phase executions per reorder */
+#define RULE_ORDER_MIN_EVALS   (32)    /**< Executions before a rule moves */
+#define RULE_ORDER_GENERATIONS (16)    /**< Max reorders per phase */
+
+/**
+ * Number of rules in the rule profile report logged at shutdown.
+ */
+#define RULE_PROFILE_REPORT_LIMIT (20)
+
+/**
+ * Adaptive ordering state for a single phase of a context.
+ *
+ * Each reorder publishes a new rule array and program by replacing the
+ * pointers of the phase.  Transactions take a snapshot of the program
+ * pointer when the phase starts, so programs are never modified once
+ * published; they are kept until the context is destroyed.
+ */
+struct ib_rule_order_t {
+    ib_lock_t        *lock;         /**< Serializes reordering */
+    size_t            executions;   /**< Phase executions since reorder */
+    size_t            generations;  /**< Number of published arrays */
+    const ib_rule_t **generation[RULE_ORDER_GENERATIONS]; /**< Arrays */
+    const ib_rule_insn_t *program[RULE_ORDER_GENERATIONS]; /**< Programs */
+    struct rule_order_item_t *items; /**< Sort scratch (rule_count) */
+};
+
+/**
+ * Sort item used when reordering a phase.
+ */
+typedef struct rule_order_item_t {
+    const ib_rule_t *rule;         /**< The rule */
+    size_t           position;     /**< Position in current rule array */
+    double           rank;         /**< Expected cost per match */
+    bool             movable;      /**< May this rule be moved? */
+    ib_rule_order_stats_t stats;   /**< Snapshot of the rule statistics */
+} rule_order_item_t;
+
 ib_status_t ib_rule_set_invert(ib_rule_t *rule, bool invert)
 {
     assert(rule != NULL);
@@ -518,11 +603,20 @@ static ib_field_t *get_capture(ib_rule_exec_t *rule_exec)
         ib_flags_all(rule_exec->rule->flags, IB_RULE_FLAG_CAPTURE)
     )
     {
-        rc = ib_capture_acquire(
-            rule_exec->tx,
-            rule_exec->rule->capture_collection,
-            &capture
-        );
+        if (rule_exec->rule->capture_source != NULL) {
+            rc = ib_capture_acquire_source(
+                rule_exec->tx,
+                rule_exec->rule->capture_source,
+                &capture
+            );
+        }
+        else {
+            rc = ib_capture_acquire(
+                rule_exec->tx,
+                rule_exec->rule->capture_collection,
+                &capture
+            );
+        }
         if (rc != IB_OK) {
             ib_rule_log_error(rule_exec,
                 "Failed to create capture collection: %s",
@@ -559,12 +653,14 @@ ib_status_t ib_rule_exec_create(ib_tx_t *tx, ib_rule_exec_t **rule_exec)
     exec->tx = tx;
 
     /* Create the rule stack */
-    rc = ib_list_create(&(exec->rule_stack), tx->mm);
-    if (rc != IB_OK) {
-        ib_rule_log_tx_error(tx, "Failed to create rule stack: %s",
-                             ib_status_to_string(rc));
-        return rc;
+    exec->rule_stack = ib_mm_alloc(
+        tx->mm, RULE_STACK_SIZE * sizeof(*(exec->rule_stack)));
+    if (exec->rule_stack == NULL) {
+        ib_rule_log_tx_error(tx, "Failed to create rule stack");
+        return IB_EALLOC;
     }
+    exec->rule_stack_depth = 0;
+    exec->rule_stack_size = RULE_STACK_SIZE;
 
     /* Create the phase rule list */
     rc = ib_list_create(&(exec->phase_rules), tx->mm);
@@ -575,12 +671,47 @@ ib_status_t ib_rule_exec_create(ib_tx_t *tx, ib_rule_exec_t **rule_exec)
     }
 
     /* Create the value stack */
-    rc = ib_list_create(&(exec->value_stack), tx->mm);
+    exec->value_stack = ib_mm_alloc(
+        tx->mm, VALUE_STACK_SIZE * sizeof(*(exec->value_stack)));
+    if (exec->value_stack == NULL) {
+        ib_rule_log_tx_error(tx, "Failed to create value stack");
+        return IB_EALLOC;
+    }
+    exec->value_stack_depth = 0;
+    exec->value_stack_size = VALUE_STACK_SIZE;
+
+    /* Create the transformation cache */
+    rc = ib_hash_create(&(exec->tfn_cache), tx->mm);
     if (rc != IB_OK) {
-        ib_rule_log_tx_error(tx, "Failed to create value stack: %s",
+        ib_rule_log_tx_error(tx, "Failed to create transformation cache: %s",
                              ib_status_to_string(rc));
         return rc;
     }
+    exec->tfn_cache_hits = 0;
+    exec->tfn_cache_misses = 0;
+    exec->stream_buffer[0] = NULL;
+    exec->stream_buffer[1] = NULL;
+    exec->stream_buffer_length[0] = 0;
+    exec->stream_buffer_length[1] = 0;
+    exec->stream_overlap[0] = NULL;
+    exec->stream_overlap[1] = NULL;
+    exec->stream_overlap_length[0] = 0;
+    exec->stream_overlap_length[1] = 0;
+    exec->stream_window[0] = NULL;
+    exec->stream_window[1] = NULL;
+    exec->stream_window_size[0] = 0;
+    exec->stream_window_size[1] = 0;
+    exec->parallel_results = NULL;
+    exec->parallel_hits = 0;
+
+    /* Alternate the transactions between the arms of RuleEngineCompare. */
+    if (tx->ib->rule_engine->compare_profiles != NULL) {
+        exec->compare_arm = __atomic_fetch_add(
+            &(tx->ib->rule_engine->compare_next), 1, __ATOMIC_RELAXED) % 2;
+    }
+    else {
+        exec->compare_arm = 0;
+    }
 
     /* Create the TX log object */
     rc = ib_rule_log_tx_create(exec, &(exec->tx_log));
@@ -613,6 +744,44 @@ ib_status_t ib_rule_exec_create(ib_tx_t *tx, ib_rule_exec_t **rule_exec)
     return IB_OK;
 }
 
+/**
+ * Make room for one more element on a rule execution object stack.
+ *
+ * @param[in] mm Memory manager to grow the stack with
+ * @param[in,out] stack Stack array
+ * @param[in,out] size Number of elements allocated in @a stack
+ * @param[in] depth Number of elements in use in @a stack
+ * @param[in] elem_size Size of an element of @a stack
+ *
+ * @returns true if there is room for another element, false on allocation
+ *          failure
+ */
+static bool rule_exec_stack_reserve(ib_mm_t mm,
+                                    void **stack,
+                                    size_t *size,
+                                    size_t depth,
+                                    size_t elem_size)
+{
+    assert(stack != NULL);
+    assert(size != NULL);
+
+    void *grown;
+
+    if (depth < *size) {
+        return true;
+    }
+
+    grown = ib_mm_alloc(mm, 2 * (*size) * elem_size);
+    if (grown == NULL) {
+        return false;
+    }
+    memcpy(grown, *stack, (*size) * elem_size);
+    *stack = grown;
+    *size *= 2;
+
+    return true;
+}
+
 /**
  * Push a rule onto the rule execution object's rule stack
  *
@@ -638,26 +807,25 @@ static ib_status_t rule_exec_push_rule(ib_rule_exec_t *rule_exec,
     rule_exec->rule_status = IB_OK;
     rule_exec->rule_result = 0;
 
-    /* Create a new stack frame */
-    frame = ib_mm_alloc(rule_exec->tx->mm, sizeof(*frame));
-    if (frame == NULL) {
+    /* Grow the stack if it is full */
+    if (! rule_exec_stack_reserve(rule_exec->tx->mm,
+                                  (void **)&(rule_exec->rule_stack),
+                                  &(rule_exec->rule_stack_size),
+                                  rule_exec->rule_stack_depth,
+                                  sizeof(*(rule_exec->rule_stack))))
+    {
         ib_rule_log_error(rule_exec,
                           "Rule engine: Failed to allocate stack frame");
         return IB_EALLOC;
     }
 
     /* Fill in the stack frame from the current state and push it */
+    frame = &(rule_exec->rule_stack[rule_exec->rule_stack_depth]);
     frame->rule = rule_exec->rule;
     frame->exec_log = rule_exec->exec_log;
     frame->target = rule_exec->target;
     frame->result = rule_exec->rule_result;
-    rc = ib_list_push(rule_exec->rule_stack, frame);
-    if (rc != IB_OK) {
-        ib_rule_log_error(rule_exec,
-                          "Rule engine: Failed to add rule to rule stack: %s",
-                          ib_status_to_string(rc));
-        return rc;
-    }
+    ++rule_exec->rule_stack_depth;
 
     /* Add the rule to the object *before* creating the rule exec logger */
     rule_exec->rule = (ib_rule_t *)rule;
@@ -686,16 +854,16 @@ static ib_status_t rule_exec_pop_rule(ib_rule_exec_t *rule_exec)
 {
     assert(rule_exec != NULL);
 
-    ib_status_t              rc;
-    rule_exec_stack_frame_t *frame;
+    const rule_exec_stack_frame_t *frame;
 
-    rc = ib_list_pop(rule_exec->rule_stack, &frame);
-    if (rc != IB_OK) {
+    if (rule_exec->rule_stack_depth == 0) {
         ib_rule_log_error(rule_exec,
                           "Rule engine: Failed to pop rule from stack: %s",
-                          ib_status_to_string(rc));
-        return rc;
+                          ib_status_to_string(IB_ENOENT));
+        return IB_ENOENT;
     }
+    --rule_exec->rule_stack_depth;
+    frame = &(rule_exec->rule_stack[rule_exec->rule_stack_depth]);
 
     /* Copy the items from the stack frame into the rule execution object */
     rule_exec->rule = frame->rule;
@@ -718,15 +886,20 @@ static bool rule_exec_push_value(ib_rule_exec_t *rule_exec,
                                  const ib_field_t *value)
 {
     assert(rule_exec != NULL);
-    ib_status_t rc;
 
-    rc = ib_list_push(rule_exec->value_stack, (ib_field_t *)value);
-    if (rc != IB_OK) {
+    if (! rule_exec_stack_reserve(rule_exec->tx->mm,
+                                  (void **)&(rule_exec->value_stack),
+                                  &(rule_exec->value_stack_size),
+                                  rule_exec->value_stack_depth,
+                                  sizeof(*(rule_exec->value_stack))))
+    {
         ib_rule_log_warn(rule_exec,
                          "Failed to push value onto value stack: %s",
-                         ib_status_to_string(rc));
+                         ib_status_to_string(IB_EALLOC));
         return false;
     }
+    rule_exec->value_stack[rule_exec->value_stack_depth] = value;
+    ++rule_exec->value_stack_depth;
     return true;
 }
 
@@ -741,17 +914,17 @@ static void rule_exec_pop_value(ib_rule_exec_t *rule_exec,
                                 bool pushed)
 {
     assert(rule_exec != NULL);
-    ib_status_t rc;
 
     if (! pushed) {
         return;
     }
-    rc = ib_list_pop(rule_exec->value_stack, NULL);
-    if (rc != IB_OK) {
+    if (rule_exec->value_stack_depth == 0) {
         ib_rule_log_warn(rule_exec,
                          "Failed to pop value from value stack: %s",
-                         ib_status_to_string(rc));
+                         ib_status_to_string(IB_ENOENT));
+        return;
     }
+    --rule_exec->value_stack_depth;
     return;
 }
 
@@ -808,16 +981,250 @@ static ib_status_t execute_tfn_single(const ib_rule_exec_t  *rule_exec,
     return IB_OK;
 }
 
+/**
+ * Key of the transformation cache of a rule execution object.
+ *
+ * A source value is identified by its field and the storage and length of
+ * its value, so that fields given a new value (e.g. by setvar) are not
+ * served stale results.
+ */
+typedef struct {
+    const ib_field_t *field;    /**< Source field */
+    const void       *data;     /**< Source value storage */
+    uint64_t          value;    /**< Source value length or number */
+    size_t            chain_id; /**< Transformation chain id */
+} tfn_cache_key_t;
+
+/**
+ * Entry in the transformation cache of a rule execution object.
+ *
+ * Bytes may also be rewritten in the same storage, so string entries keep
+ * a digest of the contents they were computed from, which is checked when
+ * the key matches.
+ */
+typedef struct {
+    tfn_cache_key_t   key;      /**< Key; the hash references this */
+    uint32_t          digest;   /**< Digest of string contents */
+    const ib_field_t *result;   /**< Result of the transformation chain */
+} tfn_cache_entry_t;
+
+/**
+ * Digest of the string contents of a transformation cache key.
+ *
+ * @param[in] key The key
+ *
+ * @returns Digest of the contents, or 0 if @a key is not of a string.
+ */
+static uint32_t tfn_cache_digest(const tfn_cache_key_t *key)
+{
+    assert(key != NULL);
+
+    if (key->data == NULL) {
+        return 0;
+    }
+    return ib_hashfunc_djb2((const char *)key->data, key->value, 0, NULL);
+}
+
+/**
+ * Build the transformation cache key of a value.
+ *
+ * @param[in] target Rule target (provides the transformation chain id)
+ * @param[in] value The value to transform
+ * @param[out] key The key
+ *
+ * @returns true if the result of transforming @a value may be cached
+ */
+static bool tfn_cache_key(const ib_rule_target_t *target,
+                          const ib_field_t *value,
+                          tfn_cache_key_t *key)
+{
+    assert(target != NULL);
+    assert(value != NULL);
+    assert(key != NULL);
+
+    ib_status_t rc;
+
+    if ( (target->tfn_chain_id == 0) || ib_field_is_dynamic(value) ) {
+        return false;
+    }
+
+    memset(key, 0, sizeof(*key));
+    key->field = value;
+    key->chain_id = target->tfn_chain_id;
+
+    switch (value->type) {
+    case IB_FTYPE_BYTESTR: {
+        const ib_bytestr_t *bs;
+        rc = ib_field_value(value, ib_ftype_bytestr_out(&bs));
+        if (rc != IB_OK) {
+            return false;
+        }
+        if (ib_bytestr_const_ptr(bs) == NULL) {
+            return false;
+        }
+        key->data = ib_bytestr_const_ptr(bs);
+        key->value = ib_bytestr_length(bs);
+        return true;
+    }
+    case IB_FTYPE_NULSTR: {
+        const char *str;
+        rc = ib_field_value(value, ib_ftype_nulstr_out(&str));
+        if ( (rc != IB_OK) || (str == NULL) ) {
+            return false;
+        }
+        key->data = str;
+        key->value = strlen(str);
+        return true;
+    }
+    case IB_FTYPE_NUM: {
+        ib_num_t num;
+        rc = ib_field_value(value, ib_ftype_num_out(&num));
+        if (rc != IB_OK) {
+            return false;
+        }
+        key->value = (uint64_t)num;
+        return true;
+    }
+    default:
+        /* Lists may have their elements replaced in place; not cached. */
+        return false;
+    }
+}
+
+/**
+ * Count the transformations that can execute in place, starting at a node.
+ *
+ * @param[in] node First transformation list node
+ *
+ * @returns Length of the run of in-place transformations at @a node
+ */
+static size_t tfn_inplace_run(const ib_list_node_t *node)
+{
+    size_t count = 0;
+
+    for (; node != NULL; node = ib_list_node_next_const(node)) {
+        const ib_transformation_inst_t *tfn_inst =
+            (const ib_transformation_inst_t *)ib_list_node_data_const(node);
+
+        if (! ib_transformation_has_inplace(
+                ib_transformation_inst_transformation(tfn_inst)))
+        {
+            break;
+        }
+        ++count;
+    }
+
+    return count;
+}
+
+/**
+ * Execute a run of in-place transformations on a byte string value.
+ *
+ * The value is copied once and every transformation of the run is applied to
+ * the copy, so only a single output field is created for the whole run.
+ *
+ * @param[in] rule_exec The rule execution object
+ * @param[in] node First transformation of the run
+ * @param[in] count Number of transformations in the run
+ * @param[in] value Byte string value to transform
+ * @param[out] result Pointer to field in which to store the result
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ *   - IB_EINVAL if @a value is not a valid byte string.
+ *   - Error status of a transformation.
+ */
+static ib_status_t execute_tfns_inplace(const ib_rule_exec_t *rule_exec,
+                                        const ib_list_node_t *node,
+                                        size_t count,
+                                        const ib_field_t *value,
+                                        const ib_field_t **result)
+{
+    assert(rule_exec != NULL);
+    assert(rule_exec->tx != NULL);
+    assert(value != NULL);
+    assert(value->type == IB_FTYPE_BYTESTR);
+    assert(result != NULL);
+
+    ib_mm_t             mm = rule_exec->tx->mm;
+    const ib_bytestr_t *bs;
+    ib_field_t         *fnew;
+    uint8_t            *data;
+    size_t              dlen;
+    ib_status_t         rc;
+    size_t              i;
+
+    rc = ib_field_value(value, ib_ftype_bytestr_out(&bs));
+    if (rc != IB_OK) {
+        return rc;
+    }
+    if (bs == NULL) {
+        return IB_EINVAL;
+    }
+    dlen = ib_bytestr_length(bs);
+    if (dlen == 0) {
+        *result = value;
+        return IB_OK;
+    }
+    if (ib_bytestr_const_ptr(bs) == NULL) {
+        return IB_EINVAL;
+    }
+
+    data = ib_mm_memdup(mm, ib_bytestr_const_ptr(bs), dlen);
+    if (data == NULL) {
+        return IB_EALLOC;
+    }
+
+    for (i = 0; i < count; ++i, node = ib_list_node_next_const(node)) {
+        const ib_transformation_inst_t *tfn_inst =
+            (const ib_transformation_inst_t *)ib_list_node_data_const(node);
+
+        ib_rule_log_trace(
+            rule_exec,
+            "Executing transformation %s in place",
+            ib_transformation_name(
+                ib_transformation_inst_transformation(tfn_inst)
+            ));
+        rc = ib_transformation_inst_execute_inplace(tfn_inst, &data, &dlen);
+        if (rc != IB_OK) {
+            ib_rule_log_error(
+                rule_exec,
+                "Error executing target transformation %s: %s",
+                ib_transformation_name(
+                    ib_transformation_inst_transformation(tfn_inst)
+                ),
+                ib_status_to_string(rc)
+            );
+            return rc;
+        }
+    }
+
+    rc = ib_field_create_bytestr_alias(&fnew, mm,
+                                       value->name, value->nlen,
+                                       data, dlen);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    *result = fnew;
+    return IB_OK;
+}
+
 /**
  * Execute list of transformations on a target.
  *
+ * Results are cached for the duration of the phase, so targets of different
+ * rules applying the same transformation chain to the same value only
+ * transform it once.
+ *
  * @param[in] rule_exec The rule execution object
  * @param[in] value Initial value of the target field
  * @param[out] result Pointer to field in which to store the result
  *
  * @returns Status code
  */
-static ib_status_t execute_tfns(const ib_rule_exec_t *rule_exec,
+static ib_status_t execute_tfns(ib_rule_exec_t *rule_exec,
                                 const ib_field_t *value,
                                 const ib_field_t **result)
 {
@@ -828,6 +1235,8 @@ static ib_status_t execute_tfns(const ib_rule_exec_t *rule_exec,
     const ib_list_node_t *node = NULL;
     const ib_field_t     *in_field;
     const ib_field_t     *out = NULL;
+    tfn_cache_key_t       key;
+    bool                  cacheable;
 
     /* No transformations?  Do nothing. */
     if (value == NULL) {
@@ -840,6 +1249,24 @@ static ib_status_t execute_tfns(const ib_rule_exec_t *rule_exec,
         return IB_OK;
     }
 
+    /* Has this chain already been run on this value in this phase? */
+    cacheable = tfn_cache_key(rule_exec->target, value, &key);
+    if (cacheable) {
+        const tfn_cache_entry_t *entry;
+
+        rc = ib_hash_get_ex(rule_exec->tfn_cache, &entry,
+                            (const char *)&key, sizeof(key));
+        if ( (rc == IB_OK) && (tfn_cache_digest(&key) == entry->digest) ) {
+            ++rule_exec->tfn_cache_hits;
+            ib_rule_log_trace(rule_exec,
+                              "Using cached result of %zd transformations",
+                              ib_list_elements(rule_exec->target->tfn_list));
+            *result = entry->result;
+            return IB_OK;
+        }
+        ++rule_exec->tfn_cache_misses;
+    }
+
     ib_rule_log_trace(rule_exec, "Executing %zd transformations",
                       ib_list_elements(rule_exec->target->tfn_list));
 
@@ -847,10 +1274,32 @@ static ib_status_t execute_tfns(const ib_rule_exec_t *rule_exec,
      * Loop through all of the target's transformations.
      */
     in_field = value;
-    IB_LIST_LOOP_CONST(rule_exec->target->tfn_list, node) {
+    node = ib_list_first_const(rule_exec->target->tfn_list);
+    while (node != NULL) {
         const ib_transformation_inst_t  *tfn_inst =
             (const ib_transformation_inst_t *)ib_list_node_data_const(node);
 
+        /* Fuse runs of in-place transformations of a byte string, unless
+         * each transformation is being logged. */
+        if ( (in_field->type == IB_FTYPE_BYTESTR) &&
+             ! ib_rule_log_exec_tfn_enabled(rule_exec->exec_log) )
+        {
+            size_t count = tfn_inplace_run(node);
+
+            if (count > 1) {
+                rc = execute_tfns_inplace(rule_exec, node, count,
+                                          in_field, &out);
+                if (rc != IB_OK) {
+                    return rc;
+                }
+                while (count-- > 0) {
+                    node = ib_list_node_next_const(node);
+                }
+                in_field = out;
+                continue;
+            }
+        }
+
         /* Run it */
         ib_rule_log_trace(
             rule_exec,
@@ -891,11 +1340,33 @@ static ib_status_t execute_tfns(const ib_rule_exec_t *rule_exec,
 
         /* The output of the operator is now input for the next field op. */
         in_field = out;
+        node = ib_list_node_next_const(node);
     }
 
     /* The output of the final operator is the result */
     *result = out;
 
+    /* Remember the result for the rest of the phase. */
+    if (cacheable) {
+        tfn_cache_entry_t *entry;
+
+        entry = ib_mm_alloc(rule_exec->tx->mm, sizeof(*entry));
+        if (entry != NULL) {
+            entry->key = key;
+            entry->digest = tfn_cache_digest(&key);
+            entry->result = out;
+            rc = ib_hash_set_ex(rule_exec->tfn_cache,
+                                (const char *)&(entry->key),
+                                sizeof(entry->key),
+                                entry);
+            if (rc != IB_OK) {
+                ib_rule_log_warn(rule_exec,
+                                 "Failed to cache transformation result: %s",
+                                 ib_status_to_string(rc));
+            }
+        }
+    }
+
     /* Done. */
     return IB_OK;
 }
@@ -1224,7 +1695,8 @@ static ib_status_t set_target_fields(ib_rule_exec_t *rule_exec,
     ib_field_t           *fld_field;           /* The field FIELD. */
     ib_field_t           *fld_field_name;      /* The field FIELD_NAME. */
     ib_field_t           *fld_field_name_full; /* The field FIELD_NAME_FULL. */
-    const ib_list_node_t *node;                /* Temporary list node. */
+    const ib_field_t     *current;             /* Top of the value stack. */
+    size_t                i;                   /* Value stack index. */
     size_t                namelen;             /* FIELD_NAME_FULL tmp value. */
     size_t                nameoff;             /* FIELD_NAME_FULL tmp value. */
     int                   names;               /* FIELD_NAME_FULL tmp value. */
@@ -1239,10 +1711,12 @@ static ib_status_t set_target_fields(ib_rule_exec_t *rule_exec,
     ib_rule_log_trace(rule_exec, "Creating target fields");
 
     /* The current value is the top of the stack */
-    node = ib_list_last_const(rule_exec->value_stack);
-    if ( (node == NULL) || (ib_list_node_data_const(node) == NULL) ) {
+    if ( (rule_exec->value_stack_depth == 0) ||
+         (rule_exec->value_stack[rule_exec->value_stack_depth - 1] == NULL) )
+    {
         return IB_OK;       /* Do nothing for now */
     }
+    current = rule_exec->value_stack[rule_exec->value_stack_depth - 1];
 
     /* Get or create all fields. */
     trc = get_or_create_field(tx, re->source.field, &fld_field);
@@ -1255,7 +1729,7 @@ static ib_status_t set_target_fields(ib_rule_exec_t *rule_exec,
     }
     else {
         /* Shallow copy the field. */
-        *fld_field = *(const ib_field_t *)ib_list_node_data_const(node);
+        *fld_field = *current;
     }
 
     /* Create FIELD_TFN */
@@ -1350,8 +1824,8 @@ static ib_status_t set_target_fields(ib_rule_exec_t *rule_exec,
     /* Step 1: Calculate the buffer size & allocate */
     namelen = 0;
     names = 0;
-    IB_LIST_LOOP_CONST(rule_exec->value_stack, node) {
-        ib_field_t *fld_tmp = (ib_field_t *)ib_list_node_data_const(node);
+    for (i = 0; i < rule_exec->value_stack_depth; ++i) {
+        const ib_field_t *fld_tmp = rule_exec->value_stack[i];
         if (fld_tmp != NULL && fld_tmp->name != NULL && fld_tmp->nlen > 0) {
             ++names;
             if (fld_tmp->nlen > 0) {
@@ -1371,8 +1845,8 @@ static ib_status_t set_target_fields(ib_rule_exec_t *rule_exec,
     /* Step 2: Populate the name buffer. */
     nameoff = 0;
     n = 0;
-    IB_LIST_LOOP_CONST(rule_exec->value_stack, node) {
-        ib_field_t *fld_tmp = (ib_field_t *)ib_list_node_data_const(node);
+    for (i = 0; i < rule_exec->value_stack_depth; ++i) {
+        const ib_field_t *fld_tmp = rule_exec->value_stack[i];
         if (fld_tmp != NULL) {
             if (fld_tmp->nlen > 0) {
                 memcpy(name+nameoff, fld_tmp->name, fld_tmp->nlen);
@@ -1491,30 +1965,250 @@ static void exe_op_trace_values(ib_rule_exec_t *rule_exec,
 }
 
 /**
- * Execute a phase rule operator on a list of values
+ * Get the data of a value for parallel rule execution.
  *
- * @param[in] rule_exec Rule execution object
- * @param[in] value Field value to operate on
- * @param[in] recursion Recursion limit -- won't recurse if recursion is zero
+ * @param[in] value Value
+ * @param[out] data Data of @a value
+ * @param[out] length Length of @a data
  *
- * @returns Status code
+ * @returns true if @a value is a non-dynamic string, otherwise false
  */
-static ib_status_t execute_phase_operator(ib_rule_exec_t *rule_exec,
-                                          const ib_field_t *value,
-                                          int recursion)
+static bool rule_parallel_value_data(const ib_field_t *value,
+                                     const uint8_t **data,
+                                     size_t *length)
 {
-    assert(rule_exec != NULL);
-    assert(rule_exec->rule != NULL);
-    assert(rule_exec->rule->opinst != NULL);
-    assert(rule_exec->target != NULL);
-
-    ib_status_t rc;
-    const ib_rule_operator_inst_t *opinst = rule_exec->rule->opinst;
-    const ib_rule_target_t   *target = rule_exec->target;
+    assert(value != NULL);
+    assert(data != NULL);
+    assert(length != NULL);
 
-    /* This if-block is only to log operator values when tracing. */
-    if (ib_rule_dlog_level(rule_exec->tx->ctx) >= IB_RULE_DLOG_TRACE) {
-        exe_op_trace_values(rule_exec, opinst, target, value);
+    if (ib_field_is_dynamic(value)) {
+        return false;
+    }
+
+    if (value->type == IB_FTYPE_BYTESTR) {
+        const ib_bytestr_t *bs;
+
+        if ( (ib_field_value(value, ib_ftype_bytestr_out(&bs)) != IB_OK) ||
+             (bs == NULL) ||
+             (ib_bytestr_const_ptr(bs) == NULL) )
+        {
+            return false;
+        }
+        *data = ib_bytestr_const_ptr(bs);
+        *length = ib_bytestr_length(bs);
+        return true;
+    }
+    else if (value->type == IB_FTYPE_NULSTR) {
+        const char *str;
+
+        if ( (ib_field_value(value, ib_ftype_nulstr_out(&str)) != IB_OK) ||
+             (str == NULL) )
+        {
+            return false;
+        }
+        *data = (const uint8_t *)str;
+        *length = strlen(str);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Take the operator result computed by parallel rule execution for the
+ * current rule, if any.
+ *
+ * The result is only used if it was computed on @a value and the data of
+ * @a value is unchanged: same storage, length and digest of its contents.
+ * The digest is computed by the worker that executed the operator, so the
+ * phase thread only pays for hashing the value.
+ *
+ * @param[in] rule_exec Rule execution object
+ * @param[in] value Value the operator is to be executed on
+ * @param[out] op_rc Operator status
+ * @param[out] result Operator result
+ *
+ * @returns true if a result was taken, otherwise false
+ */
+static bool rule_parallel_take(ib_rule_exec_t *rule_exec,
+                               const ib_field_t *value,
+                               ib_status_t *op_rc,
+                               ib_num_t *result)
+{
+    assert(rule_exec != NULL);
+    assert(rule_exec->rule != NULL);
+    assert(op_rc != NULL);
+    assert(result != NULL);
+
+    ib_rule_parallel_result_t *presult;
+    const uint8_t             *data;
+    size_t                     length;
+
+    if ( (rule_exec->parallel_results == NULL) || (value == NULL) ) {
+        return false;
+    }
+    if (rule_exec->rule->meta.index >=
+        rule_exec->ib->rule_engine->index_limit)
+    {
+        return false;
+    }
+
+    presult = &(rule_exec->parallel_results[rule_exec->rule->meta.index]);
+    if (presult->value != value) {
+        return false;
+    }
+    presult->value = NULL;
+
+    if ( (! rule_parallel_value_data(value, &data, &length)) ||
+         (data != presult->data) ||
+         (length != presult->length) )
+    {
+        return false;
+    }
+
+    /* An earlier rule may have rewritten the data in place. */
+    if (ib_hashfunc_djb2((const char *)data, length, 0, NULL) != presult->digest) {
+        return false;
+    }
+
+    *op_rc = presult->status;
+    *result = presult->result;
+    ++rule_exec->parallel_hits;
+    return true;
+}
+
+/**
+ * Execute a phase rule operator on a single (non-list) value
+ *
+ * Sets up the FIELD* fields, runs the operator hooks, stores the result and
+ * executes the rule's actions.
+ *
+ * @param[in] rule_exec Rule execution object
+ * @param[in] value Field value to operate on
+ * @param[in] batch_result Operator result if the operator was already
+ *                         executed on @a value as part of a batch, or NULL
+ *                         to execute it here
+ *
+ * @returns Status code
+ */
+static ib_status_t execute_phase_operator_value(ib_rule_exec_t *rule_exec,
+                                                const ib_field_t *value,
+                                                const ib_num_t *batch_result)
+{
+    assert(rule_exec != NULL);
+    assert(rule_exec->rule != NULL);
+    assert(rule_exec->rule->opinst != NULL);
+
+    const ib_rule_operator_inst_t *opinst = rule_exec->rule->opinst;
+    ib_num_t                       result = 0;
+    ib_status_t                    op_rc = IB_OK;
+    ib_status_t                    rc;
+
+    /* Fill in the FIELD* fields */
+    rc = set_target_fields(rule_exec, value);
+    if (rc != IB_OK) {
+        ib_rule_log_error(rule_exec,
+                          "Error creating one or more FIELD* fields: %s",
+                          ib_status_to_string(rc));
+    }
+
+    {
+        ib_list_node_t *node;
+        IB_LIST_LOOP(rule_exec->ib->rule_engine->hooks.pre_operator, node) {
+            const ib_rule_pre_operator_hook_t *hook =
+                (const ib_rule_pre_operator_hook_t *)
+                    ib_list_node_data_const(node);
+            hook->fn(
+                rule_exec,
+                opinst->opinst,
+                opinst->invert,
+                value,
+                hook->data
+            );
+        }
+    }
+
+    if (batch_result != NULL) {
+        /* Already executed as part of a batch. */
+        result = *batch_result;
+    }
+    else if (! rule_parallel_take(rule_exec, value, &op_rc, &result)) {
+        /* @todo remove the cast-away of the constness of value */
+        op_rc = ib_operator_inst_execute(
+            opinst->opinst,
+            rule_exec->tx,
+            (ib_field_t *)value,
+            get_capture(rule_exec),
+            &result
+        );
+    }
+    if (op_rc != IB_OK) {
+        ib_rule_log_warn(rule_exec, "Operator returned an error: %s",
+                         ib_status_to_string(op_rc));
+    }
+
+    {
+        ib_list_node_t *node;
+        IB_LIST_LOOP(rule_exec->ib->rule_engine->hooks.post_operator, node) {
+            const ib_rule_post_operator_hook_t *hook =
+                (const ib_rule_post_operator_hook_t *)
+                    ib_list_node_data_const(node);
+            hook->fn(
+                rule_exec,
+                opinst->opinst,
+                opinst->invert,
+                value,
+                op_rc,
+                result,
+                get_capture(rule_exec),
+                hook->data
+            );
+        }
+    }
+
+    rc = ib_rule_log_exec_op(rule_exec->exec_log, opinst, op_rc);
+    if (rc != IB_OK) {
+        ib_rule_log_error(rule_exec, "Failed to log operator execution: %s",
+                          ib_status_to_string(rc));
+    }
+
+    /* Store the results */
+    store_results(rule_exec, value, op_rc, result);
+
+    /* Execute any and all actions. */
+    execute_rule_actions(rule_exec);
+
+    /* Done. */
+    clear_target_fields(rule_exec);
+
+    return rc;
+}
+
+/**
+ * Execute a phase rule operator on a list of values
+ *
+ * @param[in] rule_exec Rule execution object
+ * @param[in] value Field value to operate on
+ * @param[in] recursion Recursion limit -- won't recurse if recursion is zero
+ *
+ * @returns Status code
+ */
+static ib_status_t execute_phase_operator(ib_rule_exec_t *rule_exec,
+                                          const ib_field_t *value,
+                                          int recursion)
+{
+    assert(rule_exec != NULL);
+    assert(rule_exec->rule != NULL);
+    assert(rule_exec->rule->opinst != NULL);
+    assert(rule_exec->target != NULL);
+
+    ib_status_t rc;
+    const ib_rule_operator_inst_t *opinst = rule_exec->rule->opinst;
+    const ib_rule_target_t   *target = rule_exec->target;
+
+    /* This if-block is only to log operator values when tracing. */
+    if (ib_rule_dlog_level(rule_exec->tx->ctx) >= IB_RULE_DLOG_TRACE) {
+        exe_op_trace_values(rule_exec, opinst, target, value);
     }
 
     /* Limit recursion */
@@ -1562,82 +2256,107 @@ static ib_status_t execute_phase_operator(ib_rule_exec_t *rule_exec,
 
     /* No recursion required, handle it here */
     else {
-        ib_num_t    result = 0;
-        ib_status_t op_rc = IB_OK;
+        rc = execute_phase_operator_value(rule_exec, value, NULL);
+    }
 
-        /* Fill in the FIELD* fields */
-        rc = set_target_fields(rule_exec, value);
-        if (rc != IB_OK) {
-            ib_rule_log_error(rule_exec,
-                              "Error creating one or more FIELD* fields: %s",
-                              ib_status_to_string(rc));
-        }
+    return rc;
+}
 
-        {
-            ib_list_node_t *node;
-            IB_LIST_LOOP(rule_exec->ib->rule_engine->hooks.pre_operator, node) {
-                const ib_rule_pre_operator_hook_t *hook =
-                    (const ib_rule_pre_operator_hook_t *)
-                        ib_list_node_data_const(node);
-                hook->fn(
-                    rule_exec,
-                    opinst->opinst,
-                    opinst->invert,
-                    value,
-                    hook->data
-                );
-            }
-        }
+/**
+ * Execute a phase rule operator on all elements of a list in one batch
+ *
+ * Only possible if the operator has a batch execute function, the rule does
+ * not capture and no element is itself a list.  The results are then
+ * processed in order, exactly as if the operator had been executed on each
+ * element individually.
+ *
+ * @param[in] rule_exec Rule execution object
+ * @param[in] value_list List of values to operate on
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_DECLINED if the list can not be executed as a batch; the caller
+ *     should execute the operator on each element.
+ *   - Other on error.
+ */
+static ib_status_t execute_phase_operator_batch(ib_rule_exec_t *rule_exec,
+                                                const ib_list_t *value_list)
+{
+    assert(rule_exec != NULL);
+    assert(rule_exec->rule != NULL);
+    assert(rule_exec->rule->opinst != NULL);
+    assert(value_list != NULL);
 
-        /* @todo remove the cast-away of the constness of value */
-        op_rc = ib_operator_inst_execute(
-            opinst->opinst,
-            rule_exec->tx,
-            (ib_field_t *)value,
-            get_capture(rule_exec),
-            &result
-        );
-        if (op_rc != IB_OK) {
-            ib_rule_log_warn(rule_exec, "Operator returned an error: %s",
-                             ib_status_to_string(op_rc));
+    const ib_rule_operator_inst_t *opinst = rule_exec->rule->opinst;
+    const ib_field_t             **inputs;
+    uint8_t                       *matches;
+    const ib_list_node_t          *node;
+    size_t                         count = ib_list_elements(value_list);
+    size_t                         n = 0;
+    ib_status_t                    rc;
+
+    if (! ib_operator_has_execute_batch(
+              ib_operator_inst_operator(opinst->opinst)) ||
+        ib_flags_all(rule_exec->rule->flags, IB_RULE_FLAG_CAPTURE) ||
+        (count < 2) )
+    {
+        return IB_DECLINED;
+    }
+
+    inputs = ib_mm_alloc(rule_exec->tx->mm, count * sizeof(*inputs));
+    matches = ib_mm_alloc(rule_exec->tx->mm,
+                          IB_OPERATOR_BATCH_BITMAP_SIZE(count));
+    if ( (inputs == NULL) || (matches == NULL) ) {
+        return IB_EALLOC;
+    }
+
+    IB_LIST_LOOP_CONST(value_list, node) {
+        const ib_field_t *input =
+            (const ib_field_t *)ib_list_node_data_const(node);
+
+        if ( (input == NULL) || (input->type == IB_FTYPE_LIST) ) {
+            return IB_DECLINED;
         }
+        inputs[n] = input;
+        ++n;
+    }
 
-        {
-            ib_list_node_t *node;
-            IB_LIST_LOOP(rule_exec->ib->rule_engine->hooks.post_operator, node) {
-                const ib_rule_post_operator_hook_t *hook =
-                    (const ib_rule_post_operator_hook_t *)
-                        ib_list_node_data_const(node);
-                hook->fn(
-                    rule_exec,
-                    opinst->opinst,
-                    opinst->invert,
-                    value,
-                    op_rc,
-                    result,
-                    get_capture(rule_exec),
-                    hook->data
-                );
-            }
+    rc = ib_operator_inst_execute_batch(opinst->opinst,
+                                        rule_exec->tx,
+                                        inputs, count,
+                                        matches);
+    if (rc != IB_OK) {
+        /* Let the per-value execution report the error. */
+        ib_rule_log_debug(rule_exec,
+                          "Batch operator execution failed: %s",
+                          ib_status_to_string(rc));
+        return IB_DECLINED;
+    }
+
+    for (n = 0; n < count; ++n) {
+        ib_num_t result = IB_OPERATOR_BATCH_ISSET(matches, n) ? 1 : 0;
+        bool     pushed;
+
+        if (ib_rule_dlog_level(rule_exec->tx->ctx) >= IB_RULE_DLOG_TRACE) {
+            exe_op_trace_values(rule_exec, opinst, rule_exec->target,
+                                inputs[n]);
         }
 
-        rc = ib_rule_log_exec_op(rule_exec->exec_log, opinst, op_rc);
+        pushed = rule_exec_push_value(rule_exec, inputs[n]);
+        rc = execute_phase_operator_value(rule_exec, inputs[n], &result);
         if (rc != IB_OK) {
-            ib_rule_log_error(rule_exec, "Failed to log operator execution: %s",
+            ib_rule_log_error(rule_exec,
+                              "Operator returned an error: %s",
                               ib_status_to_string(rc));
+            rule_exec_pop_value(rule_exec, pushed);
+            return rc;
         }
-
-        /* Store the results */
-        store_results(rule_exec, value, op_rc, result);
-
-        /* Execute any and all actions. */
-        execute_rule_actions(rule_exec);
-
-        /* Done. */
-        clear_target_fields(rule_exec);
+        ib_rule_log_trace(rule_exec, "Operator result => %" PRId64,
+                          rule_exec->rule_result);
+        rule_exec_pop_value(rule_exec, pushed);
     }
 
-    return rc;
+    return IB_OK;
 }
 
 /**
@@ -1905,25 +2624,35 @@ static ib_status_t execute_phase_rule_targets(ib_rule_exec_t *rule_exec)
                                   target->target_str);
             }
 
-            /* Run operations on each list element. */
-            IB_LIST_LOOP(value_list, value_node) {
-                ib_field_t *node_value = (ib_field_t *)
-                    ib_list_node_data(value_node);
-                bool lpushed;
-
-                lpushed = rule_exec_push_value(rule_exec, node_value);
-
-                rc = execute_phase_operator(rule_exec, node_value,
-                                            MAX_LIST_RECURSION);
-                if (rc != IB_OK) {
-                    ib_rule_log_error(rule_exec,
-                                      "Operator returned an error: %s",
-                                      ib_status_to_string(rc));
-                    return rc;
+            /* Run the operator on all list elements at once if possible,
+             * otherwise run operations on each list element. */
+            rc = execute_phase_operator_batch(rule_exec, value_list);
+            if (rc == IB_DECLINED) {
+                rc = IB_OK;
+                IB_LIST_LOOP(value_list, value_node) {
+                    ib_field_t *node_value = (ib_field_t *)
+                        ib_list_node_data(value_node);
+                    bool lpushed;
+
+                    lpushed = rule_exec_push_value(rule_exec, node_value);
+
+                    rc = execute_phase_operator(rule_exec, node_value,
+                                                MAX_LIST_RECURSION);
+                    if (rc != IB_OK) {
+                        ib_rule_log_error(rule_exec,
+                                          "Operator returned an error: %s",
+                                          ib_status_to_string(rc));
+                        return rc;
+                    }
+                    ib_rule_log_trace(rule_exec, "Operator result => %" PRId64,
+                                      rule_exec->rule_result);
+                    rule_exec_pop_value(rule_exec, lpushed);
                 }
-                ib_rule_log_trace(rule_exec, "Operator result => %" PRId64,
-                                  rule_exec->rule_result);
-                rule_exec_pop_value(rule_exec, lpushed);
+            }
+            else if (rc != IB_OK) {
+                rule_exec_pop_value(rule_exec, pushed);
+                rule_exec_pop_value(rule_exec, pop_target);
+                return rc;
             }
         }
         else {
@@ -1962,12 +2691,14 @@ static ib_status_t execute_phase_rule_targets(ib_rule_exec_t *rule_exec)
  * @param[in] rule_exec Rule execution object
  * @param[in] rule Rule to execute
  * @param[in] recursion Recursion limit
+ * @param[out] result Result of @a rule (or NULL)
  *
  * @returns Status code
  */
 static ib_status_t execute_phase_rule(ib_rule_exec_t *rule_exec,
                                       const ib_rule_t *rule,
-                                      int recursion)
+                                      int recursion,
+                                      ib_num_t *result)
 {
     ib_status_t         rc = IB_OK;
     ib_status_t         trc;          /* Temporary status code */
@@ -1980,6 +2711,10 @@ static ib_status_t execute_phase_rule(ib_rule_exec_t *rule_exec,
     assert(rule != NULL);
     assert(! rule->phase_meta->is_stream);
 
+    if (result != NULL) {
+        *result = 0;
+    }
+
     --recursion;
     if (recursion <= 0) {
         ib_rule_log_error(rule_exec,
@@ -2047,7 +2782,8 @@ static ib_status_t execute_phase_rule(ib_rule_exec_t *rule_exec,
         ib_rule_log_debug(rule_exec,
                           "Chaining to rule \"%s\"",
                           ib_rule_id(rule->chained_rule));
-        trc = execute_phase_rule(rule_exec, rule->chained_rule, recursion);
+        trc = execute_phase_rule(rule_exec, rule->chained_rule, recursion,
+                                 NULL);
 
         if (trc != IB_OK) {
             ib_rule_log_error(rule_exec,
@@ -2058,6 +2794,10 @@ static ib_status_t execute_phase_rule(ib_rule_exec_t *rule_exec,
         }
     }
 
+    if (result != NULL) {
+        *result = rule_exec->rule_result;
+    }
+
     /* Pop the rule from the execution object */
 cleanup:
     trc = rule_exec_pop_rule(rule_exec);
@@ -2079,46 +2819,237 @@ cleanup:
 }
 
 /**
- * Check if the current rule is runnable
+ * Number of instructions needed to compile a phase program.
  *
- * @param[in] ctx_rule Context rule data
+ * @param[in] rule_array Rules of the phase
+ * @param[in] rule_count Elements in @a rule_array
  *
- * @returns true if the rule is runnable, otherwise false
+ * @returns Program length
  */
-static bool rule_is_runnable(const ib_rule_ctx_data_t *ctx_rule)
+static size_t phase_program_length(const ib_rule_t * const *rule_array,
+                                   size_t rule_count)
 {
-    /* Skip invalid / disabled rules */
-    if (! ib_flags_all(ctx_rule->flags, IB_RULECTX_FLAG_ENABLED)) {
-        return false;
-    }
-    if (! ib_flags_all(ctx_rule->rule->flags, IB_RULE_FLAG_VALID)) {
-        return false;
+    size_t length = 0;
+    size_t i;
+
+    for (i = 0; i < rule_count; ++i) {
+        const ib_rule_t *rule;
+
+        for (rule = rule_array[i]; rule != NULL; rule = rule->chained_rule) {
+            ++length;
+        }
     }
 
-    return true;
+    return length;
 }
 
 /**
- * Check if allow affects the current rule
- *
- * @param[in] tx Transaction
- * @param[in] meta Rule's phase meta-data
- * @param[in] check_phase Check if ALLOW_PHASE is set
+ * Compile a phase program.
  *
- * @returns true if the rule is affected, otherwise false
+ * @param[in] rule_array Rules of the phase
+ * @param[in] rule_count Elements in @a rule_array
+ * @param[out] program Program of phase_program_length() instructions
  */
-static bool rule_allow(const ib_tx_t *tx,
-                       const ib_rule_phase_meta_t *meta,
-                       bool check_phase)
+static void phase_program_compile(const ib_rule_t * const *rule_array,
+                                  size_t rule_count,
+                                  ib_rule_insn_t *program)
 {
-    /* Check if the transaction was already blocked. */
-    if (ib_tx_is_blocked(tx)) {
-        return false;
+    assert(program != NULL || rule_count == 0);
+
+    size_t pc = 0;
+    size_t i;
+
+    for (i = 0; i < rule_count; ++i) {
+        ib_rule_insn_t  *insn = &(program[pc]);
+        const ib_rule_t *rule;
+
+        insn->opcode = IB_RULE_INSN_RULE;
+        insn->rule = rule_array[i];
+        insn->chain_length = 0;
+        ++pc;
+
+        for (rule = rule_array[i]->chained_rule;
+             rule != NULL;
+             rule = rule->chained_rule)
+        {
+            program[pc].opcode = IB_RULE_INSN_CHAIN;
+            program[pc].rule = rule;
+            program[pc].chain_length = 0;
+            ++insn->chain_length;
+            ++pc;
+        }
     }
+}
 
-    /* Check the ALLOW_ALL flag */
-    if ( (meta->phase_num != IB_PHASE_POSTPROCESS) &&
-         (meta->phase_num != IB_PHASE_LOGGING) &&
+/**
+ * Execute a phase program rule instruction and its chain instructions.
+ *
+ * This is the iterative equivalent of execute_phase_rule(): each rule of the
+ * chain is pushed onto the execution stack in turn and executed while the
+ * previous rule matched, then the stack is unwound.
+ *
+ * @param[in] rule_exec Rule execution object
+ * @param[in] insn IB_RULE_INSN_RULE instruction, followed by its chain
+ * @param[out] result Result of the rule of @a insn
+ *
+ * @returns Status code
+ */
+static ib_status_t execute_phase_insn(ib_rule_exec_t *rule_exec,
+                                      const ib_rule_insn_t *insn,
+                                      ib_num_t *result)
+{
+    assert(rule_exec != NULL);
+    assert(insn != NULL);
+    assert(insn->opcode == IB_RULE_INSN_RULE);
+    assert(result != NULL);
+
+    const ib_rule_engine_t *re = rule_exec->ib->rule_engine;
+    ib_status_t             rc = IB_OK;
+    ib_status_t             trc;
+    size_t                  depth = 0;
+    size_t                  i;
+#ifdef IB_RULE_TRACE
+    ib_time_t pre_time;
+    ib_time_t post_time;
+#endif
+
+    *result = 0;
+
+    for (i = 0; i <= insn->chain_length; ++i) {
+        const ib_rule_t *rule = insn[i].rule;
+        ib_list_node_t  *node;
+
+        assert(! rule->phase_meta->is_stream);
+
+        if (i >= MAX_CHAIN_RECURSION - 1) {
+            ib_rule_log_error(rule_exec,
+                              "Rule engine: Phase chain recursion limit reached");
+            rc = IB_EOTHER;
+            break;
+        }
+
+        if (i > 0) {
+            ib_rule_log_debug(rule_exec,
+                              "Chaining to rule \"%s\"",
+                              ib_rule_id(rule));
+        }
+
+        IB_LIST_LOOP(re->hooks.pre_rule, node) {
+            const ib_rule_pre_rule_hook_t *hook =
+                (const ib_rule_pre_rule_hook_t *)
+                    ib_list_node_data_const(node);
+            hook->fn(rule_exec, hook->data);
+        }
+
+        /* Set the rule in the execution object */
+        trc = rule_exec_push_rule(rule_exec, rule);
+        if (trc != IB_OK) {
+            ib_rule_log_error(rule_exec,
+                              "Rule engine: "
+                              "Failed to set rule in execution object: %s",
+                              ib_status_to_string(trc));
+            rc = trc;
+            break;
+        }
+        ++depth;
+
+#ifdef IB_RULE_TRACE
+        if (rule->flags & IB_RULE_FLAG_TRACE) {
+            pre_time = ib_clock_get_time();
+        }
+#endif
+        trc = execute_phase_rule_targets(rule_exec);
+#ifdef IB_RULE_TRACE
+        if ( (trc == IB_OK) && (rule->flags & IB_RULE_FLAG_TRACE) ) {
+            post_time = ib_clock_get_time();
+            rule_exec->traces[rule->meta.index].rule = rule;
+            rule_exec->traces[rule->meta.index].evaluation_time +=
+                (post_time - pre_time);
+            ++rule_exec->traces[rule->meta.index].evaluation_n;
+        }
+#endif
+        if (trc != IB_OK) {
+            if (i > 0) {
+                ib_rule_log_error(rule_exec,
+                                  "Error executing chained rule \"%s\": %s",
+                                  ib_rule_id(rule),
+                                  ib_status_to_string(trc));
+            }
+            rc = trc;
+            break;
+        }
+        if (i == 0) {
+            *result = rule_exec->rule_result;
+        }
+
+        /* Only continue the chain if this rule matched. */
+        if (rule_exec->rule_result == 0) {
+            break;
+        }
+    }
+
+    /* Unwind the execution stack. */
+    while (depth > 0) {
+        ib_list_node_t *node;
+
+        trc = rule_exec_pop_rule(rule_exec);
+        if (trc != IB_OK) {
+            /* Do nothing */
+        }
+
+        IB_LIST_LOOP(re->hooks.post_rule, node) {
+            const ib_rule_post_rule_hook_t *hook =
+                (const ib_rule_post_rule_hook_t *)
+                    ib_list_node_data_const(node);
+            hook->fn(rule_exec, hook->data);
+        }
+        --depth;
+    }
+
+    return rc;
+}
+
+/**
+ * Check if the current rule is runnable
+ *
+ * @param[in] ctx_rule Context rule data
+ *
+ * @returns true if the rule is runnable, otherwise false
+ */
+static bool rule_is_runnable(const ib_rule_ctx_data_t *ctx_rule)
+{
+    /* Skip invalid / disabled rules */
+    if (! ib_flags_all(ctx_rule->flags, IB_RULECTX_FLAG_ENABLED)) {
+        return false;
+    }
+    if (! ib_flags_all(ctx_rule->rule->flags, IB_RULE_FLAG_VALID)) {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Check if allow affects the current rule
+ *
+ * @param[in] tx Transaction
+ * @param[in] meta Rule's phase meta-data
+ * @param[in] check_phase Check if ALLOW_PHASE is set
+ *
+ * @returns true if the rule is affected, otherwise false
+ */
+static bool rule_allow(const ib_tx_t *tx,
+                       const ib_rule_phase_meta_t *meta,
+                       bool check_phase)
+{
+    /* Check if the transaction was already blocked. */
+    if (ib_tx_is_blocked(tx)) {
+        return false;
+    }
+
+    /* Check the ALLOW_ALL flag */
+    if ( (meta->phase_num != IB_PHASE_POSTPROCESS) &&
+         (meta->phase_num != IB_PHASE_LOGGING) &&
          (ib_flags_all(tx->flags, IB_TX_FALLOW_ALL) == 1) )
     {
         ib_log_debug_tx(tx,
@@ -2241,548 +3172,853 @@ static ib_status_t inject_rules(const ib_engine_t *ib,
 }
 
 /**
- * Append context rules onto the rule execution object's phase rule list
+ * Fetch the next rule to execute in the current phase.
  *
- * @param[in] ib IronBee engine
- * @param[in] phase_meta Phase meta data
- * @param[in] rule_list List of context rules to append
- * @param[in,out] rule_exec Rule execution object
+ * Injected rules, held in the rule execution object's phase rule list, are
+ * returned first, followed by the context's precompiled phase rule array.
  *
- * @returns Status code
+ * @param[in] rule_array Snapshot of the phase rule array
+ * @param[in] rule_count Elements in @a rule_array
+ * @param[in,out] node Next injected rule list node (NULL when exhausted)
+ * @param[in,out] index Next index into @a rule_array
+ *
+ * @returns Next rule to execute, or NULL if there are no more rules.
  */
-static ib_status_t append_context_rules(const ib_engine_t *ib,
-                                        const ib_rule_phase_meta_t *phase_meta,
-                                        const ib_list_t *rule_list,
-                                        ib_rule_exec_t *rule_exec)
+static const ib_rule_t *next_phase_rule(
+    const ib_rule_t * const  *rule_array,
+    size_t                    rule_count,
+    const ib_list_node_t    **node,
+    size_t                   *index)
 {
-    assert(ib != NULL);
-    assert(phase_meta != NULL);
-    assert(rule_exec != NULL);
-    assert(rule_list != NULL);
+    assert(node != NULL);
+    assert(index != NULL);
 
-    const ib_list_node_t *node;
+    const ib_rule_t *rule;
 
-    IB_LIST_LOOP_CONST(rule_list, node) {
-        const ib_rule_ctx_data_t *ctx_rule =
-            (const ib_rule_ctx_data_t *)ib_list_node_data_const(node);
+    if (*node != NULL) {
+        rule = (const ib_rule_t *)ib_list_node_data_const(*node);
+        *node = ib_list_node_next_const(*node);
+        return rule;
+    }
 
-        if (rule_is_runnable(ctx_rule)) {
-            ib_list_push(rule_exec->phase_rules, ctx_rule->rule);
-        }
+    if (*index < rule_count) {
+        rule = rule_array[*index];
+        ++(*index);
+        return rule;
     }
 
-    return IB_OK;
+    return NULL;
 }
 
 /**
- * Run a set of phase rules.
+ * Actions that may be true actions of rules moved by adaptive ordering.
  *
- * @param[in] ib Engine.
- * @param[in,out] tx Transaction.
- * @param[in] state State.
- * @param[in] cbdata Callback data (actually phase_rule_cbdata_t).
+ * These change no state that another rule can read: events are only
+ * recorded for logging.
+ */
+static const char *rule_order_actions[] = {
+    "event",
+    NULL
+};
+
+/**
+ * Can a rule be moved by adaptive rule ordering?
  *
- * @returns
- *   - IB_OK on success.
- *   - IB_DECLINED if the httpd plugin declines to block the traffic.
+ * Only rules without side effects that other rules can observe are moved:
+ * rules whose true actions are all listed in rule_order_actions.  Chains,
+ * external rules, rules that capture, rules that execute actions regardless
+ * of their result and rules with any other true action (setvar, setflag,
+ * block, ...) stay where they are configured and act as barriers that other
+ * rules are never moved across.  A moved rule can therefore neither write
+ * state nor read state written by a rule it is moved across.
+ *
+ * @param[in] rule Rule to check
+ *
+ * @returns true if @a rule may be reordered, otherwise false
  */
-static ib_status_t run_phase_rules(ib_engine_t *ib,
-                                   ib_tx_t *tx,
-                                   ib_state_t state,
-                                   void *cbdata)
+static bool rule_is_reorderable(const ib_rule_t *rule)
 {
-    assert(ib != NULL);
-    assert(tx != NULL);
-    assert(tx->ctx != NULL);
-    assert(cbdata != NULL);
+    assert(rule != NULL);
 
-    /* If this is an empty request, ignore the transaction */
-    if (! ib_flags_any(tx->flags, IB_TX_FREQ_HAS_DATA | IB_TX_FRES_HAS_DATA)) {
-        return IB_OK;
+    const ib_list_node_t *node;
+
+    if (ib_flags_any(rule->flags,
+                     IB_RULE_FLAG_EXTERNAL | IB_RULE_FLAG_CHAIN |
+                     IB_RULE_FLAG_CAPTURE | IB_RULE_FLAG_ACTION))
+    {
+        return false;
+    }
+    if (rule->chained_rule != NULL) {
+        return false;
+    }
+    if ( (rule->false_actions != NULL) &&
+         (ib_list_elements(rule->false_actions) != 0) )
+    {
+        return false;
+    }
+    if ( (rule->aux_actions != NULL) &&
+         (ib_list_elements(rule->aux_actions) != 0) )
+    {
+        return false;
+    }
+    if (rule->true_actions == NULL) {
+        return true;
     }
 
-    /* The rule execution object isn't created if tx_started never notified.
-     * This can happen if a connection is created to ATS, but no data
-     * is actually pushed through the connection. */
-    if (tx->rule_exec == NULL) {
-        if (! ib_flags_all(tx->flags, IB_TX_FREQ_STARTED) ) {
-            return IB_OK;
+    IB_LIST_LOOP_CONST(rule->true_actions, node) {
+        const ib_action_inst_t *inst =
+            (const ib_action_inst_t *)ib_list_node_data_const(node);
+        const char             *name =
+            ib_action_name(ib_action_inst_action(inst));
+        const char            **allowed;
+
+        for (allowed = rule_order_actions; *allowed != NULL; ++allowed) {
+            if (strcasecmp(name, *allowed) == 0) {
+                break;
+            }
+        }
+        if (*allowed == NULL) {
+            return false;
         }
-        ib_log_alert_tx(tx, "Rule execution object not created @ %s",
-                        ib_state_name(state));
-        return IB_EUNKNOWN;
     }
 
-    const ib_rule_phase_meta_t *meta = (const ib_rule_phase_meta_t *) cbdata;
-    ib_context_t               *ctx = tx->ctx;
-    const ib_ruleset_phase_t   *ruleset_phase;
-    ib_rule_exec_t             *rule_exec = tx->rule_exec;
-    const ib_list_t            *rules;
-    const ib_list_node_t       *node = NULL;
-    ib_status_t                 rc = IB_OK;
+    return true;
+}
 
-    ruleset_phase = &(ctx->rules->ruleset.phases[meta->phase_num]);
-    assert(ruleset_phase != NULL);
-    rules = ruleset_phase->rule_list;
-    assert(rules != NULL);
+/**
+ * Record the execution of a rule for adaptive rule ordering.
+ *
+ * @param[in] rule_engine Rule engine
+ * @param[in] rule Executed rule
+ * @param[in] elapsed Execution time (microseconds)
+ * @param[in] result Rule result
+ */
+static void rule_order_record(ib_rule_engine_t *rule_engine,
+                              const ib_rule_t *rule,
+                              ib_time_t elapsed,
+                              ib_num_t result)
+{
+    assert(rule_engine != NULL);
+    assert(rule != NULL);
 
-    /* Log the transaction event start */
-    ib_rule_log_tx_event_start(rule_exec, state);
-    ib_rule_log_phase(rule_exec,
-                      meta->phase_num, phase_name(meta),
-                      ib_list_elements(rules));
+    ib_rule_order_stats_t *stats;
 
-    /* Check if this phase should be skipped. */
-    if (rule_allow(tx, meta, true)) {
-        rc = IB_OK;
-        goto finish;
+    /* Rules registered after the statistics were sized are not tracked. */
+    if (rule->meta.index >= rule_engine->order_stats_size) {
+        return;
     }
 
-    /* If we're blocking, skip processing */
-    if (ib_flags_any(tx->flags, IB_TX_FBLOCK_PHASE | IB_TX_FBLOCK_IMMEDIATE) &&
-        (ib_flags_any(meta->flags, PHASE_FLAG_FORCE) == false) )
-    {
-        /* Report blocking. */
-        rc = ib_tx_block(rule_exec->tx);
-        if (rc != IB_OK && rc != IB_DECLINED) {
-            ib_rule_log_error(rule_exec, "Failed to block: %s",
-                              ib_status_to_string(rc));
-        }
-        else {
-            if (rc == IB_DECLINED) {
-                ib_rule_log_info(rule_exec, "Declined to block.");
-            }
-            ib_log_debug_tx(tx,
-                            "Not executing rules for phase %d/\"%s\" "
-                            "in context \"%s\": transaction was blocked.",
-                            meta->phase_num, phase_name(meta),
-                            ib_context_full_get(ctx));
-            rc = IB_OK;
-            goto finish;
-        }
+    /* Every server thread records into the same statistics. */
+    stats = &(rule_engine->order_stats[rule->meta.index]);
+    __atomic_fetch_add(&(stats->time), elapsed, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(stats->evals), 1, __ATOMIC_RELAXED);
+    if (result != 0) {
+        __atomic_fetch_add(&(stats->matches), 1, __ATOMIC_RELAXED);
     }
+}
 
-    /* Clear the phase allow flag since we are processing a new phase. */
-    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+/**
+ * Add the execution of a rule to a profile.
+ *
+ * @param[in,out] profile Profile
+ * @param[in] rule Executed rule
+ * @param[in] elapsed Execution time (microseconds)
+ * @param[in] result Rule result
+ */
+static void rule_profile_add(ib_rule_profile_t *profile,
+                             const ib_rule_t *rule,
+                             ib_time_t elapsed,
+                             ib_num_t result)
+{
+    assert(profile != NULL);
+    assert(rule != NULL);
 
-    /* Sanity check */
-    if (ruleset_phase->phase_num != meta->phase_num) {
-        ib_rule_log_tx_error(tx,
-                             "Rule engine: Phase %d/\"%s\" is %d",
-                             meta->phase_num, phase_name(meta),
-                             ruleset_phase->phase_num);
-        rc = IB_EINVAL;
-        goto finish;
+    size_t    bucket = 0;
+    ib_time_t bound = 1;
+    uint64_t  max_time;
+
+    while ( (elapsed >= bound) && (bucket < IB_RULE_PROFILE_BUCKETS - 1) ) {
+        ++bucket;
+        bound <<= 1;
     }
 
-    /* Setup for rule execution */
-    rule_exec->phase = meta->phase_num;
-    rule_exec->is_stream = false;
-    ib_list_clear(rule_exec->phase_rules);
+    /* Every server thread records into the same profile. */
+    __atomic_store_n(&(profile->rule), rule, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(profile->evaluations), 1, __ATOMIC_RELAXED);
+    if (result != 0) {
+        __atomic_fetch_add(&(profile->matches), 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&(profile->time), elapsed, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(profile->histogram[bucket]), 1, __ATOMIC_RELAXED);
 
-    /* Invoke all of the rule injectors */
-    rc = inject_rules(ib, meta, rule_exec);
-    if (rc != IB_OK) {
-        return IB_EINVAL;
+    max_time = __atomic_load_n(&(profile->max_time), __ATOMIC_RELAXED);
+    while ( ((uint64_t)elapsed > max_time) &&
+            ! __atomic_compare_exchange_n(&(profile->max_time), &max_time,
+                                          (uint64_t)elapsed, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+    {
+        /* max_time now holds the current maximum; try again. */
     }
+}
 
-    /* Add all of the enabled "normal" rules to the list */
-    rc = append_context_rules(ib, meta, rules, rule_exec);
-    if (rc != IB_OK) {
-        return IB_EINVAL;
+/**
+ * Record the execution of a rule in its profile.
+ *
+ * @param[in] rule_engine Rule engine
+ * @param[in] rule Executed rule
+ * @param[in] elapsed Execution time (microseconds)
+ * @param[in] result Rule result
+ */
+static void rule_profile_record(ib_rule_engine_t *rule_engine,
+                                const ib_rule_t *rule,
+                                ib_time_t elapsed,
+                                ib_num_t result)
+{
+    assert(rule_engine != NULL);
+    assert(rule != NULL);
+
+    ib_rule_profile_t *profiles;
+
+    /* Rules registered after the profiles were sized are not tracked.  The
+     * profiles may be sized while rules run; see rule_profiles_grow(). */
+    if (rule->meta.index >= __atomic_load_n(&(rule_engine->profiles_size),
+                                            __ATOMIC_ACQUIRE))
+    {
+        return;
     }
+    profiles = __atomic_load_n(&(rule_engine->profiles), __ATOMIC_ACQUIRE);
 
-    /* Walk through the rules & execute them */
-    if (ib_list_elements(rule_exec->phase_rules) == 0) {
-        ib_rule_log_tx_debug(tx,
-                             "No rules for phase %d/\"%s\" in context \"%s\"",
-                             meta->phase_num, phase_name(meta),
-                             ib_context_full_get(ctx));
-        rc = IB_OK;
-        goto finish;
+    rule_profile_add(&(profiles[rule->meta.index]), rule, elapsed, result);
+}
+
+/**
+ * Record the execution of a rule in its RuleEngineCompare profile.
+ *
+ * @param[in] rule_engine Rule engine
+ * @param[in] arm Arm the transaction runs in
+ * @param[in] rule Executed rule
+ * @param[in] elapsed Execution time (microseconds)
+ * @param[in] result Rule result
+ */
+static void rule_compare_record(ib_rule_engine_t *rule_engine,
+                                size_t arm,
+                                const ib_rule_t *rule,
+                                ib_time_t elapsed,
+                                ib_num_t result)
+{
+    assert(rule_engine != NULL);
+    assert(arm < 2);
+    assert(rule != NULL);
+
+    ib_rule_profile_t *profiles;
+
+    /* As for rule_profile_record(). */
+    if (rule->meta.index >=
+        __atomic_load_n(&(rule_engine->compare_profiles_size),
+                        __ATOMIC_ACQUIRE))
+    {
+        return;
     }
-    ib_rule_log_tx_debug(tx,
-                         "Executing %zd rules for phase %d/\"%s\" "
-                         "in context \"%s\"",
-                         ib_list_elements(rule_exec->phase_rules),
-                         meta->phase_num, phase_name(meta),
-                         ib_context_full_get(ctx));
+    profiles = __atomic_load_n(&(rule_engine->compare_profiles),
+                               __ATOMIC_ACQUIRE);
 
-    /*
-     * Loop through all of the rules for this phase, execute them.
-     *
-     * @todo The current behavior is to keep running even after rule execution
-     * returns an error.  This needs further discussion to determine what the
-     * correct behavior should be.
-     */
-    IB_LIST_LOOP_CONST(rule_exec->phase_rules, node) {
-        const ib_rule_t *rule =
-            (const ib_rule_t *)ib_list_node_data_const(node);
-        ib_status_t      rule_rc;
+    rule_profile_add(&(profiles[2 * rule->meta.index + arm]),
+                     rule, elapsed, result);
+}
 
-        assert(
-            rule->meta.phase == meta->phase_num ||
-            rule->meta.phase == IB_PHASE_NONE
-        );
+/**
+ * Compare two rule order items by rank, keeping configuration order for
+ * equal ranks.
+ *
+ * @param[in] a First item
+ * @param[in] b Second item
+ *
+ * @returns qsort() style comparison
+ */
+static int rule_order_compare(const void *a, const void *b)
+{
+    const rule_order_item_t *item_a = (const rule_order_item_t *)a;
+    const rule_order_item_t *item_b = (const rule_order_item_t *)b;
 
-        /* Allow (skip) this phase? */
-        if (rule_allow(tx, meta, true)) {
-            break;
+    if (item_a->rank < item_b->rank) {
+        return -1;
+    }
+    if (item_a->rank > item_b->rank) {
+        return 1;
+    }
+    if (item_a->position < item_b->position) {
+        return -1;
+    }
+    if (item_a->position > item_b->position) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Reorder the rules of a phase based on their statistics.
+ *
+ * Runs of movable rules are sorted by expected cost per match so that cheap,
+ * selective rules run first.  A new rule array is published only if the order
+ * changed.  The caller must hold the order lock.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in] ctx Context of @a ruleset_phase
+ * @param[in,out] ruleset_phase Phase to reorder
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC if the new rule array can not be allocated.
+ */
+static ib_status_t rule_order_phase(ib_engine_t *ib,
+                                    const ib_context_t *ctx,
+                                    ib_ruleset_phase_t *ruleset_phase)
+{
+    assert(ib != NULL);
+    assert(ctx != NULL);
+    assert(ruleset_phase != NULL);
+    assert(ruleset_phase->order != NULL);
+
+    ib_rule_engine_t  *rule_engine = ib->rule_engine;
+    ib_rule_order_t   *order = ruleset_phase->order;
+    rule_order_item_t *items = order->items;
+    size_t             count = ruleset_phase->rule_count;
+    const ib_rule_t  **rule_array;
+    ib_rule_insn_t    *program;
+    bool               changed = false;
+    size_t             i;
+
+    for (i = 0; i < count; ++i) {
+        const ib_rule_t       *rule = ruleset_phase->rule_array[i];
+        ib_rule_order_stats_t *stats = &(items[i].stats);
+
+        /* Transactions keep recording while the statistics are read. */
+        memset(stats, 0, sizeof(*stats));
+        if (rule->meta.index < rule_engine->order_stats_size) {
+            const ib_rule_order_stats_t *shared =
+                &(rule_engine->order_stats[rule->meta.index]);
+
+            stats->time = __atomic_load_n(&(shared->time), __ATOMIC_RELAXED);
+            stats->evals =
+                __atomic_load_n(&(shared->evals), __ATOMIC_RELAXED);
+            stats->matches =
+                __atomic_load_n(&(shared->matches), __ATOMIC_RELAXED);
+        }
+
+        items[i].rule = rule;
+        items[i].position = i;
+        items[i].movable =
+            (stats->evals >= RULE_ORDER_MIN_EVALS) &&
+            rule_is_reorderable(rule);
+        if (items[i].movable) {
+            /* Mean cost divided by the (smoothed) match probability. */
+            double cost = (double)stats->time / (double)stats->evals;
+            double selectivity =
+                ((double)stats->matches + 1.0) /
+                ((double)stats->evals + 2.0);
+            items[i].rank = cost / selectivity;
         }
+        else {
+            items[i].rank = 0.0;
+        }
+    }
 
-        /* Execute the rule, it's actions and chains */
-        rule_rc = execute_phase_rule(rule_exec, rule, MAX_CHAIN_RECURSION);
+    /* Sort each run of movable rules. */
+    i = 0;
+    while (i < count) {
+        size_t end;
 
-        /* Handle block/allow actions. */
-        if (ib_flags_all(tx->flags, IB_TX_FALLOW_ALL) ) {
-            bool allow_rc;
-            ib_rule_log_debug(rule_exec,
-                              "Rule resulted in allow "
-                              "(aborting rule processing): %s",
-                              ib_status_to_string(rule_rc));
-            allow_rc = ib_tx_allow(rule_exec->tx);
-            if (allow_rc != IB_OK && allow_rc != IB_DECLINED) {
-                ib_rule_log_error(rule_exec, "Failed to allow: %s",
-                                  ib_status_to_string(allow_rc));
-                if (rule_rc == IB_OK) {
-                    rule_rc = allow_rc;
-                }
-            }
-            else {
-                if (allow_rc == IB_DECLINED) {
-                    ib_rule_log_info(rule_exec, "Declined to allow.");
-                }
-                goto finish;
-            }
+        if (! items[i].movable) {
+            ++i;
+            continue;
         }
-        else if (ib_flags_all(tx->flags, IB_TX_FBLOCK_IMMEDIATE) ) {
-            bool block_rc;
-            ib_rule_log_debug(rule_exec,
-                              "Rule resulted in immediate block "
-                              "(aborting rule processing): %s",
-                              ib_status_to_string(rule_rc));
-            block_rc = ib_tx_block(rule_exec->tx);
-            if (block_rc != IB_OK && block_rc != IB_DECLINED) {
-                ib_rule_log_error(rule_exec, "Failed to block: %s",
-                                  ib_status_to_string(block_rc));
-                if (rule_rc == IB_OK) {
-                    rule_rc = block_rc;
-                }
-            }
-            else {
-                if (block_rc == IB_DECLINED) {
-                    ib_rule_log_info(rule_exec, "Declined to block.");
-                }
-                goto finish;
-            }
+        for (end = i; (end < count) && items[end].movable; ++end) {
+            /* Find the end of the run. */
         }
-        else if (ib_flags_any(tx->flags, IB_TX_FALLOW_PHASE | IB_TX_FALLOW_REQUEST) ) {
-            ib_rule_log_debug(rule_exec,
-                              "Rule resulted in temporary allow "
-                              "(aborting rule processing for this phase): %s",
-                              ib_status_to_string(rule_rc));
-            break;
+        qsort(items + i, end - i, sizeof(*items), rule_order_compare);
+        i = end;
+    }
+
+    for (i = 0; i < count; ++i) {
+        if (items[i].position != i) {
+            changed = true;
         }
 
-        if ( (rc == IB_OK) && (rule_rc != IB_OK) ) {
-            rc = rule_rc;
+        /* Decay the statistics so that the order keeps adapting.  Half of
+         * the snapshot is subtracted, so executions recorded since then are
+         * kept in full. */
+        if (items[i].movable) {
+            ib_rule_order_stats_t *stats =
+                &(rule_engine->order_stats[items[i].rule->meta.index]);
+            __atomic_fetch_sub(&(stats->time), items[i].stats.time / 2,
+                               __ATOMIC_RELAXED);
+            __atomic_fetch_sub(&(stats->evals), items[i].stats.evals / 2,
+                               __ATOMIC_RELAXED);
+            __atomic_fetch_sub(&(stats->matches), items[i].stats.matches / 2,
+                               __ATOMIC_RELAXED);
         }
     }
+    if (! changed) {
+        return IB_OK;
+    }
 
-    if (ib_flags_all(tx->flags, IB_TX_FBLOCK_PHASE) ) {
-        ib_rule_log_tx_debug(tx, "Rule(s) resulted in phase block");
-        rc = ib_tx_block(rule_exec->tx);
-        if (rc == IB_DECLINED) {
-            ib_rule_log_info(rule_exec, "Declined to block.");
-            rc = IB_OK;
-        }
-        else if (rc != IB_OK) {
-            ib_rule_log_tx_error(tx,
-                                 "Failed to block phase: %s",
-                                 ib_status_to_string(rc));
-        }
+    rule_array = malloc(count * sizeof(*rule_array));
+    if (rule_array == NULL) {
+        return IB_EALLOC;
+    }
+    for (i = 0; i < count; ++i) {
+        rule_array[i] = items[i].rule;
     }
+    program = malloc(ruleset_phase->program_length * sizeof(*program));
+    if (program == NULL) {
+        free(rule_array);
+        return IB_EALLOC;
+    }
+    phase_program_compile(rule_array, count, program);
 
-    /* Log the end of the tx event */
-finish:
-    ib_rule_log_tx_event_end(rule_exec, state);
+    /* Publish the new order; running transactions keep their snapshot. */
+    order->generation[order->generations] = rule_array;
+    order->program[order->generations] = program;
+    __atomic_store_n(&(order->generations), order->generations + 1,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&(ruleset_phase->rule_array), rule_array,
+                     __ATOMIC_RELEASE);
+    __atomic_store_n(&(ruleset_phase->program), program, __ATOMIC_RELEASE);
 
-    /* Clear the phase allow flag. */
-    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+    ib_log_debug(ib,
+                 "Reordered %zd rules for phase %d/\"%s\" in context \"%s\"",
+                 count,
+                 ruleset_phase->phase_num,
+                 phase_name(ruleset_phase->phase_meta),
+                 ib_context_full_get(ctx));
 
-    /*
-     * @todo Eat errors for now.  Unless something Really Bad(TM) has
-     * occurred, return IB_OK to the engine.  A bigger discussion of if / how
-     * such errors should be propagated needs to occur.
-     */
-    return rc;
+    return IB_OK;
 }
 
 /**
- * Execute a single stream operator, and it's actions
- *
- * @param[in] rule_exec Rule execution object
- * @param[in] value Value to pass to the operator
+ * Count a phase execution and reorder the phase if it is due.
  *
- * @returns Status code
+ * @param[in] ib IronBee engine
+ * @param[in] ctx Context of @a ruleset_phase
+ * @param[in,out] ruleset_phase Phase being executed
  */
-static ib_status_t execute_stream_operator(ib_rule_exec_t *rule_exec,
-                                           ib_field_t *value)
+static void rule_order_update(ib_engine_t *ib,
+                              const ib_context_t *ctx,
+                              ib_ruleset_phase_t *ruleset_phase)
 {
-    assert(rule_exec != NULL);
-    assert(rule_exec->rule != NULL);
-    assert(value != NULL);
+    assert(ib != NULL);
+    assert(ruleset_phase != NULL);
+    assert(ruleset_phase->order != NULL);
 
+    ib_rule_order_t *order = ruleset_phase->order;
     ib_status_t      rc;
-    const ib_rule_t *rule = rule_exec->rule;
-    bool             pushed = rule_exec_push_value(rule_exec, value);
-    ib_num_t         result = 0;
-    ib_status_t      op_rc;
 
-    /* Add a target execution result to the log object */
-    ib_rule_log_exec_add_stream_tgt(rule_exec->ib, rule_exec->exec_log, value);
+    if (__atomic_load_n(&(order->generations), __ATOMIC_RELAXED) >=
+        RULE_ORDER_GENERATIONS)
+    {
+        return;
+    }
 
-    /* Fill in the FIELD* fields */
-    rc = set_target_fields(rule_exec, value);
-    if (rc != IB_OK) {
-        ib_rule_log_error(rule_exec,
-                          "Error creating one or more FIELD* fields: %s",
-                          ib_status_to_string(rc));
+    /* Unlocked pre-check; the count is checked again under the lock. */
+    if (__atomic_add_fetch(&(order->executions), 1, __ATOMIC_RELAXED) <
+        RULE_ORDER_PERIOD)
+    {
+        return;
     }
 
-    /* Execute the rule operator */
-    op_rc = ib_operator_inst_execute(
-        rule->opinst->opinst,
-        rule_exec->tx,
-        value,
-        get_capture(rule_exec),
-        &result
-    );
-    if (op_rc != IB_OK) {
-        ib_rule_log_error(rule_exec, "Operator returned an error: %s",
-                          ib_status_to_string(op_rc));
-        return op_rc;
+    if (ib_lock_lock(order->lock) != IB_OK) {
+        return;
     }
-    rc = ib_rule_log_exec_op(rule_exec->exec_log, rule->opinst, rc);
-    if (rc != IB_OK) {
-        ib_rule_log_error(rule_exec, "Failed to log operator execution: %s",
-                          ib_status_to_string(rc));
+    if ( (__atomic_load_n(&(order->executions), __ATOMIC_RELAXED) >=
+          RULE_ORDER_PERIOD) &&
+         (order->generations < RULE_ORDER_GENERATIONS) )
+    {
+        __atomic_store_n(&(order->executions), 0, __ATOMIC_RELAXED);
+        rc = rule_order_phase(ib, ctx, ruleset_phase);
+        if (rc != IB_OK) {
+            ib_log_error(ib,
+                         "Error reordering rules for phase %d/\"%s\": %s",
+                         ruleset_phase->phase_num,
+                         phase_name(ruleset_phase->phase_meta),
+                         ib_status_to_string(rc));
+        }
     }
-    ib_rule_log_trace(rule_exec, "Operator => %" PRId64, result);
+    ib_lock_unlock(order->lock);
+}
 
-    rule_exec_pop_value(rule_exec, pushed);
+/**
+ * Operator execution scheduled by parallel rule execution.
+ */
+typedef struct {
+    const ib_rule_t  *rule;   /**< Rule whose operator to execute */
+    const ib_field_t *value;  /**< Value to execute on */
+    const uint8_t    *data;   /**< Data of @a value */
+    size_t            length; /**< Length of @a data */
+    uint32_t          digest; /**< Digest of @a data */
+    bool              done;   /**< Has the operator been executed? */
+    ib_status_t       status; /**< Operator status */
+    ib_num_t          result; /**< Operator result */
+} rule_parallel_job_t;
 
-    /* Store the results */
-    store_results(rule_exec, value, op_rc, result);
+/**
+ * Work shared by the threads of parallel rule execution.
+ */
+typedef struct {
+    const ib_tx_t       *tx;    /**< Transaction */
+    ib_lock_t           *lock;  /**< Protects @a next */
+    rule_parallel_job_t *jobs;  /**< Jobs */
+    size_t               count; /**< Elements in @a jobs */
+    size_t               next;  /**< Index of next job to execute */
+} rule_parallel_work_t;
 
-    /* Execute any and all actions. */
-    execute_rule_actions(rule_exec);
+/**
+ * Execute parallel rule execution jobs until none are left.
+ *
+ * Each thread executes operators on a copy of the transaction with its own
+ * memory manager, as transaction memory pools are not thread safe.
+ *
+ * The copy is shallow: it shares the var store, connection, context and all
+ * other data of the transaction.  That is safe because
+ * - only operator instances with IB_OP_CAPABILITY_THREAD_SAFE are
+ *   scheduled, and they only read their input and instance data;
+ * - instances whose parameters contain a var expansion lose that capability
+ *   (see ib_operator_inst_capabilities()), as expanding indexes the var
+ *   store from the store's own pool and runs dynamic getters, e.g., for
+ *   request cookies, that allocate from and cache into the transaction;
+ * - capture is rejected by rule_is_parallel(), so nothing is written to the
+ *   transaction's vars;
+ * - the phase thread waits in ib_thread_pool_share() until every started
+ *   worker returns, and runs no rule or action meanwhile, so the shared
+ *   data neither changes nor is freed while a copy is in use;
+ * - anything an operator allocates comes from the worker's own pool, which
+ *   is destroyed here, and results are plain numbers.
+ *
+ * @param[in] arg Work (rule_parallel_work_t)
+ */
+static void rule_parallel_worker(void *arg)
+{
+    assert(arg != NULL);
 
-    /* Allow/Block if required */
-    if (ib_flags_all(rule_exec->tx->flags, IB_TX_FALLOW_ALL) ) {
-        ib_rule_log_debug(rule_exec,
-                          "Rule resulted in allow "
-                          "(aborting rule processing): %s",
-                          ib_status_to_string(rc));
-        rc = ib_tx_allow(rule_exec->tx);
-        if (rc == IB_DECLINED) {
-            ib_rule_log_info(rule_exec, "Declined to allow.");
-            rc = IB_OK;
+    rule_parallel_work_t *work = (rule_parallel_work_t *)arg;
+    ib_mpool_lite_t      *mp;
+    ib_tx_t               tx;
+
+    if (ib_mpool_lite_create(&mp) != IB_OK) {
+        return;
+    }
+    tx = *(work->tx);
+    tx.mm = ib_mm_mpool_lite(mp);
+
+    for (;;) {
+        rule_parallel_job_t *job;
+
+        if (ib_lock_lock(work->lock) != IB_OK) {
+            break;
         }
-        else if (rc != IB_OK) {
-            ib_rule_log_error(rule_exec, "Failed to allow: %s",
-                              ib_status_to_string(rc));
+        if (work->next >= work->count) {
+            ib_lock_unlock(work->lock);
+            break;
         }
+        job = &(work->jobs[work->next]);
+        ++work->next;
+        ib_lock_unlock(work->lock);
+
+        /* @todo remove the cast-away of the constness of value */
+        job->status = ib_operator_inst_execute(job->rule->opinst->opinst,
+                                               &tx,
+                                               (ib_field_t *)job->value,
+                                               NULL,
+                                               &(job->result));
+        job->digest = ib_hashfunc_djb2((const char *)job->data, job->length,
+                                       0, NULL);
+        job->done = true;
     }
-    else if (ib_flags_all(rule_exec->tx->flags, IB_TX_FBLOCK_IMMEDIATE) ) {
-        ib_rule_log_debug(rule_exec,
-                          "Rule resulted in immediate block "
-                          "(aborting rule processing): %s",
-                          ib_status_to_string(rc));
-        rc = ib_tx_block(rule_exec->tx);
-        if (rc == IB_DECLINED) {
-            ib_rule_log_info(rule_exec, "Declined to block.");
-            rc = IB_OK;
-        }
-        else if (rc != IB_OK) {
-            ib_rule_log_error(rule_exec, "Failed to block: %s",
-                              ib_status_to_string(rc));
-        }
-    }
-
-    ib_rule_log_execution(rule_exec);
-    clear_target_fields(rule_exec);
 
-    return rc;
+    ib_mpool_lite_destroy(mp);
 }
 
 /**
- * Execute a single stream txdata rule, and it's actions
+ * Execute the operators of the parallel candidate rules of a phase ahead of
+ * time.
  *
- * @param[in] rule_exec   Rule execution object
- * @param[in] data        Transaction data.
- * @param[in] data_length Length of @a data.
+ * The target of each candidate rule is fetched; the operators of rules whose
+ * value is at least the configured minimum size are executed by threads of
+ * the engine thread pool and the calling thread.  The results are picked up by
+ * rule_parallel_take() when the rules are executed in order, so the
+ * rules' actions still run sequentially in configuration order.
  *
- * @returns Status code
+ * @param[in] rule_exec Rule execution object
+ * @param[in] parallel Parallel execution state of the phase
  */
-static
-ib_status_t execute_stream_txdata_rule(
-    ib_rule_exec_t *rule_exec,
-    const char     *data,
-    size_t          data_length
-)
+static void rule_parallel_run(ib_rule_exec_t *rule_exec,
+                              const ib_rule_parallel_t *parallel)
 {
-    ib_status_t    rc = IB_OK;
-    ib_field_t    *value = NULL;
-
     assert(rule_exec != NULL);
-    assert(rule_exec->rule != NULL);
-    assert(rule_exec->rule->phase_meta->is_stream);
-    assert(data != NULL);
+    assert(parallel != NULL);
 
+    ib_tx_t              *tx = rule_exec->tx;
+    ib_rule_engine_t     *rule_engine = rule_exec->ib->rule_engine;
+    rule_parallel_job_t  *jobs;
+    rule_parallel_work_t  work;
+    ib_thread_pool_t     *pool;
+    size_t                num_threads = 0;
+    size_t                count = 0;
+    size_t                i;
+
+    jobs = ib_mm_alloc(tx->mm, parallel->count * sizeof(*jobs));
+    if (jobs == NULL) {
+        return;
+    }
 
-    /*
-     * Execute the rule operator.
-     *
-     * @todo The current behavior is to keep running even after action(s)
-     * returns an error.  This needs further discussion to determine what the
-     * correct behavior should be.
-     */
+    for (i = 0; i < parallel->count; ++i) {
+        const ib_rule_t        *rule = parallel->rules[i];
+        const ib_rule_target_t *target =
+            ib_list_node_data_const(ib_list_first_const(rule->target_fields));
+        const ib_list_t        *result;
+        const ib_field_t       *value;
+        rule_parallel_job_t    *job = &(jobs[count]);
 
-    /* Create a field to hold the data */
-    rc = ib_field_create_bytestr_alias(&value,
-                                       rule_exec->tx->mm,
-                                       "txdata", 3,
-                                       (const uint8_t *)data, data_length);
-    if (rc != IB_OK) {
-        ib_rule_log_error(rule_exec,
-                          "Error creating field for stream "
-                          "txdata rule data: %s",
-                          ib_status_to_string(rc));
-        return rc;
+        if (rule->meta.index >= rule_engine->index_limit) {
+            continue;
+        }
+        if (ib_var_target_get(target->target, &result,
+                              tx->mm, tx->var_store) != IB_OK)
+        {
+            continue;
+        }
+        if (ib_list_elements(result) != 1) {
+            continue;
+        }
+
+        value = ib_list_node_data_const(ib_list_first_const(result));
+        if ( (value == NULL) ||
+             (! rule_parallel_value_data(value, &(job->data), &(job->length))) ||
+             (job->length < parallel->min_size) )
+        {
+            continue;
+        }
+
+        job->rule = rule;
+        job->value = value;
+        job->done = false;
+        ++count;
     }
 
-    rc = execute_stream_operator(rule_exec, value);
+    /* Not worth it for a single operator. */
+    if (count < 2) {
+        return;
+    }
 
-    return rc;
+    if (rule_exec->parallel_results == NULL) {
+        rule_exec->parallel_results = ib_mm_calloc(
+            tx->mm,
+            rule_engine->index_limit,
+            sizeof(*(rule_exec->parallel_results)));
+        if (rule_exec->parallel_results == NULL) {
+            return;
+        }
+    }
+
+    work.tx = tx;
+    work.jobs = jobs;
+    work.count = count;
+    work.next = 0;
+    if (ib_lock_create(&(work.lock), tx->mm) != IB_OK) {
+        return;
+    }
+
+    /* The calling thread works too. */
+    if (ib_engine_thread_pool_get(rule_exec->ib, &pool) == IB_OK) {
+        num_threads = ib_thread_pool_share(
+            pool,
+            rule_parallel_worker,
+            &work,
+            (parallel->threads < count - 1) ? parallel->threads : count - 1);
+    }
+    else {
+        rule_parallel_worker(&work);
+    }
+
+    for (i = 0; i < count; ++i) {
+        const rule_parallel_job_t *job = &(jobs[i]);
+        ib_rule_parallel_result_t *presult;
+
+        if (! job->done) {
+            continue;
+        }
+
+        presult = &(rule_exec->parallel_results[job->rule->meta.index]);
+        presult->value = job->value;
+        presult->data = job->data;
+        presult->length = job->length;
+        presult->digest = job->digest;
+        presult->status = job->status;
+        presult->result = job->result;
+    }
+
+    ib_rule_log_tx_debug(tx,
+                         "Executed %zd operators on %zd threads ahead of time",
+                         count, num_threads + 1);
 }
 
 /**
- * Execute a single stream header rule, and it's actions
+ * Discard parallel rule execution results left over by a phase.
  *
  * @param[in] rule_exec Rule execution object
- * @param[in] header Parsed header
- *
- * @returns Status code
+ * @param[in] parallel Parallel execution state of the phase
  */
-static ib_status_t execute_stream_header_rule(ib_rule_exec_t *rule_exec,
-                                              ib_parsed_header_t *header)
+static void rule_parallel_clear(ib_rule_exec_t *rule_exec,
+                                const ib_rule_parallel_t *parallel)
 {
-    ib_status_t          rc = IB_OK;
-    ib_field_t          *value;
-    ib_parsed_header_t *nvpair;
-
     assert(rule_exec != NULL);
-    assert(header != NULL);
-
-    /*
-     * Execute the rule operator.
-     *
-     * @todo The current behavior is to keep running even after action(s)
-     * returns an error.  This needs further discussion to determine what the
-     * correct behavior should be.
-     */
-    for (nvpair = header;  nvpair != NULL;  nvpair = nvpair->next) {
+    assert(parallel != NULL);
 
-        /* Create a field to hold the data */
-        ib_rule_log_debug(rule_exec,
-                          "nvpair: \"%.*s\"=\"%.*s\"\n",
-                          (int)ib_bytestr_length(nvpair->name),
-                          (const char *)ib_bytestr_const_ptr(nvpair->name),
-                          (int)ib_bytestr_length(nvpair->value),
-                          (const char *)ib_bytestr_const_ptr(nvpair->value));
-        rc = ib_field_create(&value,
-                             rule_exec->tx->mm,
-                             (const char *)ib_bytestr_const_ptr(nvpair->name),
-                             ib_bytestr_length(nvpair->name),
-                             IB_FTYPE_BYTESTR,
-                             ib_ftype_bytestr_in(nvpair->value));
-        if (rc != IB_OK) {
-            ib_rule_log_error(rule_exec,
-                              "Error creating field for "
-                              "header stream rule data: %s",
-                              ib_status_to_string(rc));
-            return rc;
-        }
+    size_t i;
 
-        rc = execute_stream_operator(rule_exec, value);
+    if (rule_exec->parallel_results == NULL) {
+        return;
     }
 
-    return rc;
+    for (i = 0; i < parallel->count; ++i) {
+        const ib_rule_t *rule = parallel->rules[i];
+
+        if (rule->meta.index < rule_exec->ib->rule_engine->index_limit) {
+            rule_exec->parallel_results[rule->meta.index].value = NULL;
+        }
+    }
 }
 
+/* Defined with the context close handling below. */
+static ib_status_t rule_engine_ctx_ready(ib_engine_t *ib,
+                                         ib_context_t *ctx);
+
 /**
- * Run a set of stream rules.
+ * Run a set of phase rules.
  *
  * @param[in] ib Engine.
- * @param[in] tx Transaction.
+ * @param[in,out] tx Transaction.
  * @param[in] state State.
- * @param[in] data Transaction data (or NULL)
- * @param[in] data_length Length of @a data.
- * @param[in] header Parsed header (or NULL)
- * @param[in] meta Phase meta data
+ * @param[in] cbdata Callback data (actually phase_rule_cbdata_t).
  *
  * @returns
- *   - Status code IB_OK
+ *   - IB_OK on success.
+ *   - IB_DECLINED if the httpd plugin declines to block the traffic.
  */
-static ib_status_t run_stream_rules(ib_engine_t *ib,
-                                    ib_tx_t *tx,
-                                    ib_state_t state,
-                                    const char *data,
-                                    size_t data_length,
-                                    ib_parsed_header_t *header,
-                                    const ib_rule_phase_meta_t *meta)
+static ib_status_t run_phase_rules(ib_engine_t *ib,
+                                   ib_tx_t *tx,
+                                   ib_state_t state,
+                                   void *cbdata)
 {
     assert(ib != NULL);
     assert(tx != NULL);
-    assert(tx->rule_exec != NULL);
-    assert( (data != NULL) || (header != NULL) );
-    assert(meta != NULL);
-    assert( (meta->hook_type != IB_STATE_HOOK_TXDATA) || (data != NULL) );
-    assert( (meta->hook_type != IB_STATE_HOOK_HEADER) || (header != NULL) );
+    assert(tx->ctx != NULL);
+    assert(cbdata != NULL);
 
-    ib_context_t             *ctx = tx->ctx;
-    const ib_ruleset_phase_t *ruleset_phase =
-        &(ctx->rules->ruleset.phases[meta->phase_num]);
-    ib_list_t                *rules = ruleset_phase->rule_list;
-    const ib_list_node_t     *node = NULL;
-    ib_rule_exec_t           *rule_exec = tx->rule_exec;
-    ib_status_t               rc;
+    /* If this is an empty request, ignore the transaction */
+    if (! ib_flags_any(tx->flags, IB_TX_FREQ_HAS_DATA | IB_TX_FRES_HAS_DATA)) {
+        return IB_OK;
+    }
+
+    /* The rule execution object isn't created if tx_started never notified.
+     * This can happen if a connection is created to ATS, but no data
+     * is actually pushed through the connection. */
+    if (tx->rule_exec == NULL) {
+        if (! ib_flags_all(tx->flags, IB_TX_FREQ_STARTED) ) {
+            return IB_OK;
+        }
+        ib_log_alert_tx(tx, "Rule execution object not created @ %s",
+                        ib_state_name(state));
+        return IB_EUNKNOWN;
+    }
+
+    const ib_rule_phase_meta_t *meta = (const ib_rule_phase_meta_t *) cbdata;
+    ib_context_t               *ctx = tx->ctx;
+    ib_ruleset_phase_t         *ruleset_phase;
+    ib_rule_exec_t             *rule_exec = tx->rule_exec;
+    const ib_rule_t            *rule;
+    const ib_rule_insn_t       *program;
+    size_t                      program_length;
+    size_t                      pc = 0;
+    const ib_list_node_t       *node = NULL;
+    size_t                      num_rules;
+    bool                        profile;
+    size_t                      arm = 0;
+    bool                        timed;
+    ib_time_t                   start = 0;
+    ib_status_t                 rc = IB_OK;
+
+    /* A context with a deferred rule set runs no rules if building it
+     * failed; the failure has been logged. */
+    if (rule_engine_ctx_ready(ib, ctx) != IB_OK) {
+        return IB_OK;
+    }
+
+    ruleset_phase = &(ctx->rules->ruleset.phases[meta->phase_num]);
+    assert(ruleset_phase != NULL);
+    profile = ruleset_phase->profile ||
+        __atomic_load_n(&(ib->rule_engine->profile_all), __ATOMIC_RELAXED);
+    if (ruleset_phase->compare) {
+        arm = rule_exec->compare_arm;
+    }
+    timed = (ruleset_phase->order != NULL) || profile ||
+        ruleset_phase->compare;
 
     /* Log the transaction event start */
     ib_rule_log_tx_event_start(rule_exec, state);
     ib_rule_log_phase(rule_exec,
                       meta->phase_num, phase_name(meta),
-                      ib_list_elements(rules));
+                      ruleset_phase->rule_count);
 
-    /* Allow (skip) this phase? Perhaps the whole TX is allowed? */
-    if (rule_allow(tx, meta, false)) {
-        return IB_OK;
+    /* Check if this phase should be skipped. */
+    if (rule_allow(tx, meta, true)) {
+        rc = IB_OK;
+        goto finish;
+    }
+
+    /* If we're blocking, skip processing */
+    if (ib_flags_any(tx->flags, IB_TX_FBLOCK_PHASE | IB_TX_FBLOCK_IMMEDIATE) &&
+        (ib_flags_any(meta->flags, PHASE_FLAG_FORCE) == false) )
+    {
+        /* Report blocking. */
+        rc = ib_tx_block(rule_exec->tx);
+        if (rc != IB_OK && rc != IB_DECLINED) {
+            ib_rule_log_error(rule_exec, "Failed to block: %s",
+                              ib_status_to_string(rc));
+        }
+        else {
+            if (rc == IB_DECLINED) {
+                ib_rule_log_info(rule_exec, "Declined to block.");
+            }
+            ib_log_debug_tx(tx,
+                            "Not executing rules for phase %d/\"%s\" "
+                            "in context \"%s\": transaction was blocked.",
+                            meta->phase_num, phase_name(meta),
+                            ib_context_full_get(ctx));
+            rc = IB_OK;
+            goto finish;
+        }
     }
 
+    /* Clear the phase allow flag since we are processing a new phase. */
+    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+
     /* Sanity check */
     if (ruleset_phase->phase_num != meta->phase_num) {
-        ib_rule_log_error(rule_exec,
-                          "Rule engine: Stream %d/\"%s\" is %d",
-                          meta->phase_num, phase_name(meta),
-                          ruleset_phase->phase_num);
-        return IB_EINVAL;
+        ib_rule_log_tx_error(tx,
+                             "Rule engine: Phase %d/\"%s\" is %d",
+                             meta->phase_num, phase_name(meta),
+                             ruleset_phase->phase_num);
+        rc = IB_EINVAL;
+        goto finish;
     }
 
     /* Setup for rule execution */
     rule_exec->phase = meta->phase_num;
-    rule_exec->is_stream = true;
+    rule_exec->is_stream = false;
     ib_list_clear(rule_exec->phase_rules);
+    if (ib_hash_size(rule_exec->tfn_cache) > 0) {
+        ib_hash_clear(rule_exec->tfn_cache);
+    }
 
     /* Invoke all of the rule injectors */
     rc = inject_rules(ib, meta, rule_exec);
@@ -2790,26 +4026,47 @@ static ib_status_t run_stream_rules(ib_engine_t *ib,
         return IB_EINVAL;
     }
 
-    /* Add all of the enabled "normal" rules to the list */
-    rc = append_context_rules(ib, meta, rules, rule_exec);
-    if (rc != IB_OK) {
-        return IB_EINVAL;
+    /* Adaptive ordering may publish a new program; use a snapshot.  Arm B
+     * of RuleEngineCompare runs the rules in configuration order. */
+    if (arm == 0) {
+        if (ruleset_phase->order != NULL) {
+            rule_order_update(ib, ctx, ruleset_phase);
+        }
+        /* Pairs with the release in rule_order_phase(). */
+        program = __atomic_load_n(&(ruleset_phase->program),
+                                  __ATOMIC_ACQUIRE);
     }
-
-    /* Are there any rules?  If not, do a quick exit */
-    if (ib_list_elements(rule_exec->phase_rules) == 0) {
-        ib_rule_log_debug(rule_exec,
-                          "No rules for stream %d/\"%s\" in context \"%s\"",
-                          meta->phase_num, phase_name(meta),
-                          ib_context_full_get(ctx));
-        return IB_OK;
+    else {
+        program = ruleset_phase->base_program;
     }
-    ib_rule_log_debug(rule_exec,
-                      "Executing %zd rules for stream %d/\"%s\" "
-                      "in context \"%s\"",
-                      ib_list_elements(rule_exec->phase_rules),
-                      meta->phase_num, phase_name(meta),
-                      ib_context_full_get(ctx));
+    program_length = ruleset_phase->program_length;
+
+    /* Execute the operators of independent rules on large values ahead of
+     * time, on several threads. */
+    if ( (ruleset_phase->parallel != NULL) && (arm == 0) ) {
+        rule_parallel_run(rule_exec, ruleset_phase->parallel);
+    }
+
+    /* Injected rules run first, followed by the context's program. */
+    num_rules =
+        ib_list_elements(rule_exec->phase_rules) + ruleset_phase->rule_count;
+    node = ib_list_first_const(rule_exec->phase_rules);
+
+    /* Walk through the rules & execute them */
+    if (num_rules == 0) {
+        ib_rule_log_tx_debug(tx,
+                             "No rules for phase %d/\"%s\" in context \"%s\"",
+                             meta->phase_num, phase_name(meta),
+                             ib_context_full_get(ctx));
+        rc = IB_OK;
+        goto finish;
+    }
+    ib_rule_log_tx_debug(tx,
+                         "Executing %zd rules for phase %d/\"%s\" "
+                         "in context \"%s\"",
+                         num_rules,
+                         meta->phase_num, phase_name(meta),
+                         ib_context_full_get(ctx));
 
     /*
      * Loop through all of the rules for this phase, execute them.
@@ -2818,388 +4075,1706 @@ static ib_status_t run_stream_rules(ib_engine_t *ib,
      * returns an error.  This needs further discussion to determine what the
      * correct behavior should be.
      */
-    IB_LIST_LOOP_CONST(rule_exec->phase_rules, node) {
-        const ib_rule_t    *rule =
-            (const ib_rule_t *)ib_list_node_data_const(node);
-        ib_status_t         trc;
+    for (;;) {
+        const ib_rule_insn_t *insn = NULL;
+        ib_status_t           rule_rc;
+        ib_num_t              result;
 
-        /* Reset status */
-        rc = IB_OK;
+        if (node != NULL) {
+            rule = (const ib_rule_t *)ib_list_node_data_const(node);
+            node = ib_list_node_next_const(node);
+        }
+        else if (pc < program_length) {
+            insn = &(program[pc]);
+            assert(insn->opcode == IB_RULE_INSN_RULE);
+            rule = insn->rule;
+            pc += insn->chain_length + 1;
+        }
+        else {
+            break;
+        }
+
+        assert(
+            rule->meta.phase == meta->phase_num ||
+            rule->meta.phase == IB_PHASE_NONE
+        );
 
         /* Allow (skip) this phase? */
         if (rule_allow(tx, meta, true)) {
             break;
         }
 
-        /* Push onto the rule execution stack */
-        trc = rule_exec_push_rule(rule_exec, rule);
-        if (trc != IB_OK) {
-            break;
+        /* Execute the rule, it's actions and chains */
+        if (timed) {
+            start = ib_clock_precise_get_time();
         }
-
-        /*
-         * Execute the rule
-         *
-         * @todo The current behavior is to keep running even after an
-         * operator returns an error.  This needs further discussion to
-         * determine what the correct behavior should be.
-         */
-        if (data != NULL) {
-            rc = execute_stream_txdata_rule(rule_exec, data, data_length);
+        if (insn != NULL) {
+            rule_rc = execute_phase_insn(rule_exec, insn, &result);
         }
-        else if (header != NULL) {
-            rc = execute_stream_header_rule(rule_exec, header);
+        else {
+            rule_rc = execute_phase_rule(rule_exec, rule, MAX_CHAIN_RECURSION,
+                                         &result);
         }
-        if (rc != IB_OK) {
-            ib_rule_log_error(rule_exec, "Error executing rule: %s",
-                              ib_status_to_string(rc));
+        if (timed) {
+            ib_time_t elapsed = ib_clock_precise_get_time() - start;
+
+            if ( (ruleset_phase->order != NULL) && (arm == 0) ) {
+                rule_order_record(ib->rule_engine, rule, elapsed, result);
+            }
+            if (profile) {
+                rule_profile_record(ib->rule_engine, rule, elapsed, result);
+            }
+            if (ruleset_phase->compare) {
+                rule_compare_record(ib->rule_engine, arm,
+                                    rule, elapsed, result);
+            }
         }
 
-        ib_rule_log_execution(rule_exec);
-        rc = rule_exec_pop_rule(rule_exec);
-        if (rc != IB_OK) {
+        /* Handle block/allow actions. */
+        if (ib_flags_all(tx->flags, IB_TX_FALLOW_ALL) ) {
+            bool allow_rc;
+            ib_rule_log_debug(rule_exec,
+                              "Rule resulted in allow "
+                              "(aborting rule processing): %s",
+                              ib_status_to_string(rule_rc));
+            allow_rc = ib_tx_allow(rule_exec->tx);
+            if (allow_rc != IB_OK && allow_rc != IB_DECLINED) {
+                ib_rule_log_error(rule_exec, "Failed to allow: %s",
+                                  ib_status_to_string(allow_rc));
+                if (rule_rc == IB_OK) {
+                    rule_rc = allow_rc;
+                }
+            }
+            else {
+                if (allow_rc == IB_DECLINED) {
+                    ib_rule_log_info(rule_exec, "Declined to allow.");
+                }
+                goto finish;
+            }
+        }
+        else if (ib_flags_all(tx->flags, IB_TX_FBLOCK_IMMEDIATE) ) {
+            bool block_rc;
+            ib_rule_log_debug(rule_exec,
+                              "Rule resulted in immediate block "
+                              "(aborting rule processing): %s",
+                              ib_status_to_string(rule_rc));
+            block_rc = ib_tx_block(rule_exec->tx);
+            if (block_rc != IB_OK && block_rc != IB_DECLINED) {
+                ib_rule_log_error(rule_exec, "Failed to block: %s",
+                                  ib_status_to_string(block_rc));
+                if (rule_rc == IB_OK) {
+                    rule_rc = block_rc;
+                }
+            }
+            else {
+                if (block_rc == IB_DECLINED) {
+                    ib_rule_log_info(rule_exec, "Declined to block.");
+                }
+                goto finish;
+            }
+        }
+        else if (ib_flags_any(tx->flags, IB_TX_FALLOW_PHASE | IB_TX_FALLOW_REQUEST) ) {
+            ib_rule_log_debug(rule_exec,
+                              "Rule resulted in temporary allow "
+                              "(aborting rule processing for this phase): %s",
+                              ib_status_to_string(rule_rc));
             break;
         }
+
+        if ( (rc == IB_OK) && (rule_rc != IB_OK) ) {
+            rc = rule_rc;
+        }
     }
 
     if (ib_flags_all(tx->flags, IB_TX_FBLOCK_PHASE) ) {
+        ib_rule_log_tx_debug(tx, "Rule(s) resulted in phase block");
         rc = ib_tx_block(rule_exec->tx);
         if (rc == IB_DECLINED) {
             ib_rule_log_info(rule_exec, "Declined to block.");
+            rc = IB_OK;
         }
         else if (rc != IB_OK) {
-            ib_rule_log_error(rule_exec, "Failed to block: %s",
-                              ib_status_to_string(rc));
+            ib_rule_log_tx_error(tx,
+                                 "Failed to block phase: %s",
+                                 ib_status_to_string(rc));
         }
     }
 
+    /* Log the end of the tx event */
+finish:
+    if (ruleset_phase->parallel != NULL) {
+        rule_parallel_clear(rule_exec, ruleset_phase->parallel);
+    }
+    ib_rule_log_tx_event_end(rule_exec, state);
+
+    /* Clear the phase allow flag. */
+    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+
     /*
      * @todo Eat errors for now.  Unless something Really Bad(TM) has
      * occurred, return IB_OK to the engine.  A bigger discussion of if / how
      * such errors should be propagated needs to occur.
      */
-    rule_exec->phase = IB_PHASE_NONE;
-    return IB_OK;
+    return rc;
 }
 
 /**
- * Run stream header rules
+ * Execute a single stream operator, and it's actions
  *
- * @param[in] ib Engine.
- * @param[in] tx Transaction.
- * @param[in] state State.
- * @param[in] header Parsed header
- * @param[in] cbdata Callback data (actually phase_rule_cbdata_t)
+ * @param[in] rule_exec Rule execution object
+ * @param[in] value Value to pass to the operator
  *
  * @returns Status code
  */
-static ib_status_t run_stream_header_rules(ib_engine_t *ib,
-                                           ib_tx_t *tx,
-                                           ib_state_t state,
-                                           ib_parsed_header_t *header,
-                                           void *cbdata)
+static ib_status_t execute_stream_operator(ib_rule_exec_t *rule_exec,
+                                           ib_field_t *value)
 {
-    assert(ib != NULL);
-    assert(cbdata != NULL);
+    assert(rule_exec != NULL);
+    assert(rule_exec->rule != NULL);
+    assert(value != NULL);
 
-    const ib_rule_phase_meta_t *meta = (const ib_rule_phase_meta_t *) cbdata;
-    ib_status_t rc = IB_OK;
+    ib_status_t      rc;
+    const ib_rule_t *rule = rule_exec->rule;
+    bool             pushed = rule_exec_push_value(rule_exec, value);
+    ib_num_t         result = 0;
+    ib_status_t      op_rc;
 
-    if (header != NULL) {
-        ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
-        rc = run_stream_rules(ib, tx, state, NULL, 0, header, meta);
-        ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+    /* Add a target execution result to the log object */
+    ib_rule_log_exec_add_stream_tgt(rule_exec->ib, rule_exec->exec_log, value);
+
+    /* Fill in the FIELD* fields */
+    rc = set_target_fields(rule_exec, value);
+    if (rc != IB_OK) {
+        ib_rule_log_error(rule_exec,
+                          "Error creating one or more FIELD* fields: %s",
+                          ib_status_to_string(rc));
+    }
+
+    /* Execute the rule operator */
+    op_rc = ib_operator_inst_execute(
+        rule->opinst->opinst,
+        rule_exec->tx,
+        value,
+        get_capture(rule_exec),
+        &result
+    );
+    if (op_rc != IB_OK) {
+        ib_rule_log_error(rule_exec, "Operator returned an error: %s",
+                          ib_status_to_string(op_rc));
+        return op_rc;
     }
+    rc = ib_rule_log_exec_op(rule_exec->exec_log, rule->opinst, rc);
+    if (rc != IB_OK) {
+        ib_rule_log_error(rule_exec, "Failed to log operator execution: %s",
+                          ib_status_to_string(rc));
+    }
+    ib_rule_log_trace(rule_exec, "Operator => %" PRId64, result);
+
+    rule_exec_pop_value(rule_exec, pushed);
+
+    /* Store the results */
+    store_results(rule_exec, value, op_rc, result);
+
+    /* Execute any and all actions. */
+    execute_rule_actions(rule_exec);
+
+    /* Allow/Block if required */
+    if (ib_flags_all(rule_exec->tx->flags, IB_TX_FALLOW_ALL) ) {
+        ib_rule_log_debug(rule_exec,
+                          "Rule resulted in allow "
+                          "(aborting rule processing): %s",
+                          ib_status_to_string(rc));
+        rc = ib_tx_allow(rule_exec->tx);
+        if (rc == IB_DECLINED) {
+            ib_rule_log_info(rule_exec, "Declined to allow.");
+            rc = IB_OK;
+        }
+        else if (rc != IB_OK) {
+            ib_rule_log_error(rule_exec, "Failed to allow: %s",
+                              ib_status_to_string(rc));
+        }
+    }
+    else if (ib_flags_all(rule_exec->tx->flags, IB_TX_FBLOCK_IMMEDIATE) ) {
+        ib_rule_log_debug(rule_exec,
+                          "Rule resulted in immediate block "
+                          "(aborting rule processing): %s",
+                          ib_status_to_string(rc));
+        rc = ib_tx_block(rule_exec->tx);
+        if (rc == IB_DECLINED) {
+            ib_rule_log_info(rule_exec, "Declined to block.");
+            rc = IB_OK;
+        }
+        else if (rc != IB_OK) {
+            ib_rule_log_error(rule_exec, "Failed to block: %s",
+                              ib_status_to_string(rc));
+        }
+    }
+
+    ib_rule_log_execution(rule_exec);
+    clear_target_fields(rule_exec);
+
     return rc;
 }
 
 /**
- * Run stream TXDATA rules
+ * Execute a single stream txdata rule, and it's actions
  *
- * @param[in] ib Engine.
- * @param[in] tx Transaction.
- * @param[in] state State.
- * @param[in] data Transaction data.
+ * @param[in] rule_exec   Rule execution object
+ * @param[in] data        Transaction data.
  * @param[in] data_length Length of @a data.
- * @param[in] cbdata Callback data (actually phase_rule_cbdata_t)
  *
  * @returns Status code
  */
-static ib_status_t run_stream_txdata_rules(ib_engine_t *ib,
-                                           ib_tx_t *tx,
-                                           ib_state_t state,
-                                           const char *data,
-                                           size_t data_length,
-                                           void *cbdata)
+static
+ib_status_t execute_stream_txdata_rule(
+    ib_rule_exec_t *rule_exec,
+    const char     *data,
+    size_t          data_length
+)
 {
-    assert(ib != NULL);
-    assert(cbdata != NULL);
+    ib_status_t    rc = IB_OK;
+    ib_field_t    *value = NULL;
 
-    if (data == NULL) {
-        return IB_OK;
+    assert(rule_exec != NULL);
+    assert(rule_exec->rule != NULL);
+    assert(rule_exec->rule->phase_meta->is_stream);
+    assert(data != NULL);
+
+
+    /*
+     * Execute the rule operator.
+     *
+     * @todo The current behavior is to keep running even after action(s)
+     * returns an error.  This needs further discussion to determine what the
+     * correct behavior should be.
+     */
+
+    /* Create a field to hold the data */
+    rc = ib_field_create_bytestr_alias(&value,
+                                       rule_exec->tx->mm,
+                                       "txdata", 3,
+                                       (const uint8_t *)data, data_length);
+    if (rc != IB_OK) {
+        ib_rule_log_error(rule_exec,
+                          "Error creating field for stream "
+                          "txdata rule data: %s",
+                          ib_status_to_string(rc));
+        return rc;
     }
-    const ib_rule_phase_meta_t *meta = (const ib_rule_phase_meta_t *)cbdata;
-    ib_status_t rc;
 
-    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
-    rc = run_stream_rules(ib, tx, state, data, data_length, NULL, meta);
-    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+    rc = execute_stream_operator(rule_exec, value);
+
     return rc;
 }
 
 /**
- * Run stream TX rules (aka request header)
+ * Execute a single stream header rule, and it's actions
+ *
+ * @param[in] rule_exec Rule execution object
+ * @param[in] header Parsed header
+ *
+ * @returns Status code
+ */
+static ib_status_t execute_stream_header_rule(ib_rule_exec_t *rule_exec,
+                                              ib_parsed_header_t *header)
+{
+    ib_status_t          rc = IB_OK;
+    ib_field_t          *value;
+    ib_parsed_header_t *nvpair;
+
+    assert(rule_exec != NULL);
+    assert(header != NULL);
+
+    /*
+     * Execute the rule operator.
+     *
+     * @todo The current behavior is to keep running even after action(s)
+     * returns an error.  This needs further discussion to determine what the
+     * correct behavior should be.
+     */
+    for (nvpair = header;  nvpair != NULL;  nvpair = nvpair->next) {
+
+        /* Create a field to hold the data */
+        ib_rule_log_debug(rule_exec,
+                          "nvpair: \"%.*s\"=\"%.*s\"\n",
+                          (int)ib_bytestr_length(nvpair->name),
+                          (const char *)ib_bytestr_const_ptr(nvpair->name),
+                          (int)ib_bytestr_length(nvpair->value),
+                          (const char *)ib_bytestr_const_ptr(nvpair->value));
+        rc = ib_field_create(&value,
+                             rule_exec->tx->mm,
+                             (const char *)ib_bytestr_const_ptr(nvpair->name),
+                             ib_bytestr_length(nvpair->name),
+                             IB_FTYPE_BYTESTR,
+                             ib_ftype_bytestr_in(nvpair->value));
+        if (rc != IB_OK) {
+            ib_rule_log_error(rule_exec,
+                              "Error creating field for "
+                              "header stream rule data: %s",
+                              ib_status_to_string(rc));
+            return rc;
+        }
+
+        rc = execute_stream_operator(rule_exec, value);
+    }
+
+    return rc;
+}
+
+/**
+ * Does the operator of a stream rule keep state across the data of a stream?
+ *
+ * @param[in] rule Rule to check
+ *
+ * @returns true if the operator of @a rule has IB_OP_CAPABILITY_STREAM
+ */
+static bool rule_keeps_stream_state(const ib_rule_t *rule)
+{
+    assert(rule != NULL);
+
+    if ( (rule->opinst == NULL) || (rule->opinst->opinst == NULL) ) {
+        return false;
+    }
+
+    return ib_flags_all(
+        ib_operator_capabilities(
+            ib_operator_inst_operator(rule->opinst->opinst)),
+        IB_OP_CAPABILITY_STREAM);
+}
+
+/**
+ * Run a set of stream rules.
  *
  * @param[in] ib Engine.
  * @param[in] tx Transaction.
  * @param[in] state State.
- * @param[in] cbdata Callback data (actually phase_rule_cbdata_t)
+ * @param[in] data Transaction data (or NULL)
+ * @param[in] data_length Length of @a data.
+ * @param[in] data_overlap Length of the start of @a data that was already
+ *                         given to the rules (RuleEngineStreamOverlap).
+ *                         Rules whose operator keeps stream state do not
+ *                         see it again.
+ * @param[in] header Parsed header (or NULL)
+ * @param[in] meta Phase meta data
  *
- * @returns Status code
+ * @returns
+ *   - Status code IB_OK
  */
-static ib_status_t run_stream_tx_rules(ib_engine_t *ib,
-                                       ib_tx_t *tx,
-                                       ib_state_t state,
-                                       void *cbdata)
+static ib_status_t run_stream_rules(ib_engine_t *ib,
+                                    ib_tx_t *tx,
+                                    ib_state_t state,
+                                    const char *data,
+                                    size_t data_length,
+                                    size_t data_overlap,
+                                    ib_parsed_header_t *header,
+                                    const ib_rule_phase_meta_t *meta)
 {
-    ib_parsed_headers_t *hdrs;
-    ib_status_t rc;
-
     assert(ib != NULL);
     assert(tx != NULL);
-    assert(cbdata != NULL);
+    assert(tx->rule_exec != NULL);
+    assert( (data != NULL) || (header != NULL) );
+    assert(meta != NULL);
+    assert( (meta->hook_type != IB_STATE_HOOK_TXDATA) || (data != NULL) );
+    assert( (meta->hook_type != IB_STATE_HOOK_HEADER) || (header != NULL) );
+    assert(data_overlap <= data_length);
 
-    const ib_rule_phase_meta_t *meta = (const ib_rule_phase_meta_t *) cbdata;
+    ib_context_t             *ctx = tx->ctx;
+    const ib_ruleset_phase_t *ruleset_phase =
+        &(ctx->rules->ruleset.phases[meta->phase_num]);
+    const ib_rule_t          *rule;
+    const ib_list_node_t     *node = NULL;
+    size_t                    index = 0;
+    size_t                    num_rules;
+    ib_rule_exec_t           *rule_exec = tx->rule_exec;
+    ib_status_t               rc;
 
-    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+    if (rule_engine_ctx_ready(ib, ctx) != IB_OK) {
+        return IB_OK;
+    }
 
-    /* Wrap up the request line */
-    rc = ib_parsed_headers_create(&hdrs, tx->mm);
-    if (rc != IB_OK) {
-        ib_log_error_tx(tx, "Error creating name/value pair list: %s",
-                        ib_status_to_string(rc));
-        return rc;
+    /* Log the transaction event start */
+    ib_rule_log_tx_event_start(rule_exec, state);
+    ib_rule_log_phase(rule_exec,
+                      meta->phase_num, phase_name(meta),
+                      ruleset_phase->rule_count);
+
+    /* Allow (skip) this phase? Perhaps the whole TX is allowed? */
+    if (rule_allow(tx, meta, false)) {
+        return IB_OK;
     }
-    if ( (tx->request_line != NULL) &&
-         (tx->request_line->method != NULL) &&
-         (ib_bytestr_const_ptr(tx->request_line->method) != NULL) )
-    {
-        rc = ib_parsed_headers_add(
-            hdrs,
-            "method", 6,
-            (const char *)ib_bytestr_const_ptr(tx->request_line->method),
-            ib_bytestr_length(tx->request_line->method));
-        if (rc != IB_OK) {
-            ib_rule_log_tx_error(tx,
-                                 "Error adding method to "
-                                 "name/value pair list: %s",
-                                 ib_status_to_string(rc));
-            return rc;
-        }
+
+    /* Sanity check */
+    if (ruleset_phase->phase_num != meta->phase_num) {
+        ib_rule_log_error(rule_exec,
+                          "Rule engine: Stream %d/\"%s\" is %d",
+                          meta->phase_num, phase_name(meta),
+                          ruleset_phase->phase_num);
+        return IB_EINVAL;
     }
 
-    if ( (tx->request_line != NULL) &&
-         (tx->request_line->uri != NULL) &&
-         (ib_bytestr_const_ptr(tx->request_line->uri) != NULL) )
-    {
-        rc = ib_parsed_headers_add(
-            hdrs,
-            "uri", 3,
-            (const char *)ib_bytestr_const_ptr(tx->request_line->uri),
-            ib_bytestr_length(tx->request_line->uri));
-        if (rc != IB_OK) {
-            ib_rule_log_tx_error(tx,
-                                 "Error adding uri to name/value pair list: %s",
-                                 ib_status_to_string(rc));
-            return rc;
-        }
+    /* Setup for rule execution */
+    rule_exec->phase = meta->phase_num;
+    rule_exec->is_stream = true;
+    ib_list_clear(rule_exec->phase_rules);
+
+    /* Each invocation sees new data; cached results would only pile up. */
+    if (ib_hash_size(rule_exec->tfn_cache) > 0) {
+        ib_hash_clear(rule_exec->tfn_cache);
     }
 
-    if ( (tx->request_line != NULL) &&
-         (tx->request_line->protocol != NULL) &&
-         (ib_bytestr_const_ptr(tx->request_line->protocol) != NULL) )
-    {
-        rc = ib_parsed_headers_add(
-            hdrs,
-            "protocol", 8,
-            (const char *)ib_bytestr_const_ptr(tx->request_line->protocol),
-            ib_bytestr_length(tx->request_line->protocol));
-        if (rc != IB_OK) {
-            ib_rule_log_tx_error(tx,
-                                 "Error adding protocol to name/value "
-                                 "pair list: %s",
-                                 ib_status_to_string(rc));
-            return rc;
-        }
+    /* Invoke all of the rule injectors */
+    rc = inject_rules(ib, meta, rule_exec);
+    if (rc != IB_OK) {
+        return IB_EINVAL;
     }
 
-    /* Now, process the request line */
-    if ( (hdrs != NULL) && (hdrs->head != NULL) ) {
-        ib_rule_log_tx_trace(tx, "Running header line through stream header");
-        rc = run_stream_rules(ib, tx, state, NULL, 0, hdrs->head, meta);
-        if (rc != IB_OK) {
-            ib_rule_log_tx_error(tx,
-                                 "Error processing tx request line: %s",
-                                 ib_status_to_string(rc));
-            return rc;
-        }
+    /* Injected rules run first, followed by the context's rules. */
+    num_rules =
+        ib_list_elements(rule_exec->phase_rules) + ruleset_phase->rule_count;
+    node = ib_list_first_const(rule_exec->phase_rules);
+
+    /* Are there any rules?  If not, do a quick exit */
+    if (num_rules == 0) {
+        ib_rule_log_debug(rule_exec,
+                          "No rules for stream %d/\"%s\" in context \"%s\"",
+                          meta->phase_num, phase_name(meta),
+                          ib_context_full_get(ctx));
+        return IB_OK;
     }
+    ib_rule_log_debug(rule_exec,
+                      "Executing %zd rules for stream %d/\"%s\" "
+                      "in context \"%s\"",
+                      num_rules,
+                      meta->phase_num, phase_name(meta),
+                      ib_context_full_get(ctx));
 
-    /* Process the request header */
-    if ( (tx->request_header != NULL) && (tx->request_header->head != NULL) ) {
-        ib_rule_log_tx_trace(tx, "Running header through stream header");
-        rc = run_stream_rules(
-            ib, tx, state, NULL, 0, tx->request_header->head, meta);
-        if (rc != IB_OK) {
-            ib_rule_log_tx_error(tx,
-                                 "Error processing tx request line: %s",
+    /*
+     * Loop through all of the rules for this phase, execute them.
+     *
+     * @todo The current behavior is to keep running even after rule execution
+     * returns an error.  This needs further discussion to determine what the
+     * correct behavior should be.
+     */
+    while ((rule = next_phase_rule(ruleset_phase->rule_array,
+                                   ruleset_phase->rule_count,
+                                   &node, &index)) != NULL)
+    {
+        ib_status_t trc;
+
+        /* Reset status */
+        rc = IB_OK;
+
+        /* Allow (skip) this phase? */
+        if (rule_allow(tx, meta, true)) {
+            break;
+        }
+
+        /* Push onto the rule execution stack */
+        trc = rule_exec_push_rule(rule_exec, rule);
+        if (trc != IB_OK) {
+            break;
+        }
+
+        /*
+         * Execute the rule
+         *
+         * @todo The current behavior is to keep running even after an
+         * operator returns an error.  This needs further discussion to
+         * determine what the correct behavior should be.
+         */
+        if (data != NULL) {
+            size_t skip = rule_keeps_stream_state(rule) ? data_overlap : 0;
+
+            rc = execute_stream_txdata_rule(rule_exec,
+                                            data + skip,
+                                            data_length - skip);
+        }
+        else if (header != NULL) {
+            rc = execute_stream_header_rule(rule_exec, header);
+        }
+        if (rc != IB_OK) {
+            ib_rule_log_error(rule_exec, "Error executing rule: %s",
+                              ib_status_to_string(rc));
+        }
+
+        ib_rule_log_execution(rule_exec);
+        rc = rule_exec_pop_rule(rule_exec);
+        if (rc != IB_OK) {
+            break;
+        }
+    }
+
+    if (ib_flags_all(tx->flags, IB_TX_FBLOCK_PHASE) ) {
+        rc = ib_tx_block(rule_exec->tx);
+        if (rc == IB_DECLINED) {
+            ib_rule_log_info(rule_exec, "Declined to block.");
+        }
+        else if (rc != IB_OK) {
+            ib_rule_log_error(rule_exec, "Failed to block: %s",
+                              ib_status_to_string(rc));
+        }
+    }
+
+    /*
+     * @todo Eat errors for now.  Unless something Really Bad(TM) has
+     * occurred, return IB_OK to the engine.  A bigger discussion of if / how
+     * such errors should be propagated needs to occur.
+     */
+    rule_exec->phase = IB_PHASE_NONE;
+    return IB_OK;
+}
+
+/**
+ * Run stream header rules
+ *
+ * @param[in] ib Engine.
+ * @param[in] tx Transaction.
+ * @param[in] state State.
+ * @param[in] header Parsed header
+ * @param[in] cbdata Callback data (actually phase_rule_cbdata_t)
+ *
+ * @returns Status code
+ */
+static ib_status_t run_stream_header_rules(ib_engine_t *ib,
+                                           ib_tx_t *tx,
+                                           ib_state_t state,
+                                           ib_parsed_header_t *header,
+                                           void *cbdata)
+{
+    assert(ib != NULL);
+    assert(cbdata != NULL);
+
+    const ib_rule_phase_meta_t *meta = (const ib_rule_phase_meta_t *) cbdata;
+    ib_status_t rc = IB_OK;
+
+    if (header != NULL) {
+        ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+        rc = run_stream_rules(ib, tx, state, NULL, 0, 0, header, meta);
+        ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+    }
+    return rc;
+}
+
+/**
+ * Index of the coalescing buffer of a body stream phase.
+ *
+ * @param[in] meta Phase meta data
+ *
+ * @returns Index into ib_rule_exec_t::stream_buffer
+ */
+static size_t stream_buffer_index(const ib_rule_phase_meta_t *meta)
+{
+    assert(meta != NULL);
+
+    return ib_flags_all(meta->flags, PHASE_FLAG_REQUEST) ? 0 : 1;
+}
+
+/**
+ * Run stream TXDATA rules on @a data, preceded by the overlap kept from the
+ * data of the phase before it.
+ *
+ * If RuleEngineStreamOverlap is set for the context, the last bytes the
+ * rules of a phase were given are passed again in front of the next data.
+ * Operators without stream state can then match patterns that span two
+ * fragments, as long as they are no longer than the overlap plus one byte.
+ * Rules whose operator has IB_OP_CAPABILITY_STREAM already see across
+ * fragments and are given only the new data.
+ *
+ * @param[in] ib Engine.
+ * @param[in] tx Transaction.
+ * @param[in] meta Phase meta data
+ * @param[in] data Transaction data.
+ * @param[in] data_length Length of @a data.
+ *
+ * @returns Status code
+ */
+static ib_status_t run_stream_data_rules(ib_engine_t *ib,
+                                         ib_tx_t *tx,
+                                         const ib_rule_phase_meta_t *meta,
+                                         const char *data,
+                                         size_t data_length)
+{
+    assert(ib != NULL);
+    assert(tx != NULL);
+    assert(tx->rule_exec != NULL);
+    assert(meta != NULL);
+    assert(data != NULL);
+
+    ib_rule_exec_t *rule_exec = tx->rule_exec;
+    ib_core_cfg_t  *corecfg;
+    size_t          idx = stream_buffer_index(meta);
+    size_t          overlap = 0;
+    size_t          kept;
+    size_t          total;
+    const char     *window;
+    ib_status_t     rc;
+
+    rc = ib_core_context_config(tx->ctx, &corecfg);
+    if ( (rc == IB_OK) && (corecfg->rule_stream_overlap > 0) ) {
+        overlap = (size_t)corecfg->rule_stream_overlap;
+    }
+    if (overlap == 0) {
+        return run_stream_rules(ib, tx, meta->state, data, data_length, 0,
+                                NULL, meta);
+    }
+
+    /* Put the kept bytes and the data side by side. */
+    kept = rule_exec->stream_overlap_length[idx];
+    total = kept + data_length;
+    if (kept == 0) {
+        window = data;
+    }
+    else {
+        if (rule_exec->stream_window_size[idx] < total) {
+            size_t size = rule_exec->stream_window_size[idx] * 2;
+
+            if (size < total) {
+                size = total;
+            }
+            rule_exec->stream_window[idx] = ib_mm_alloc(tx->mm, size);
+            if (rule_exec->stream_window[idx] == NULL) {
+                rule_exec->stream_window_size[idx] = 0;
+                return IB_EALLOC;
+            }
+            rule_exec->stream_window_size[idx] = size;
+        }
+        memcpy(rule_exec->stream_window[idx],
+               rule_exec->stream_overlap[idx], kept);
+        memcpy(rule_exec->stream_window[idx] + kept, data, data_length);
+        window = rule_exec->stream_window[idx];
+    }
+
+    rc = run_stream_rules(ib, tx, meta->state, window, total, kept, NULL,
+                          meta);
+
+    /* Keep the end of the window for the next data. */
+    if (rule_exec->stream_overlap[idx] == NULL) {
+        rule_exec->stream_overlap[idx] = ib_mm_alloc(tx->mm, overlap);
+        if (rule_exec->stream_overlap[idx] == NULL) {
+            return IB_EALLOC;
+        }
+    }
+    kept = (total < overlap) ? total : overlap;
+    memcpy(rule_exec->stream_overlap[idx], window + total - kept, kept);
+    rule_exec->stream_overlap_length[idx] = kept;
+
+    return rc;
+}
+
+/**
+ * Run stream TXDATA rules on the data coalesced for a phase, if any.
+ *
+ * @param[in] ib Engine.
+ * @param[in] tx Transaction.
+ * @param[in] meta Phase meta data
+ *
+ * @returns Status code
+ */
+static ib_status_t flush_stream_buffer(ib_engine_t *ib,
+                                       ib_tx_t *tx,
+                                       const ib_rule_phase_meta_t *meta)
+{
+    assert(ib != NULL);
+    assert(tx != NULL);
+    assert(tx->rule_exec != NULL);
+    assert(meta != NULL);
+
+    ib_rule_exec_t *rule_exec = tx->rule_exec;
+    size_t          idx = stream_buffer_index(meta);
+    size_t          length = rule_exec->stream_buffer_length[idx];
+
+    if (length == 0) {
+        return IB_OK;
+    }
+    rule_exec->stream_buffer_length[idx] = 0;
+
+    return run_stream_data_rules(ib, tx, meta,
+                                 rule_exec->stream_buffer[idx], length);
+}
+
+/**
+ * Run stream TXDATA rules
+ *
+ * If RuleEngineStreamCoalesce is set for the context, fragments smaller than
+ * the configured size are copied into a per-transaction buffer and the rules
+ * run once the buffer is full, when a larger fragment arrives or when the
+ * body is finished (see flush_stream_txdata_rules()).  The rules' actions,
+ * blocking included, are delayed with them, so fragments may already have
+ * been passed on by the server when a rule blocks.
+ *
+ * @param[in] ib Engine.
+ * @param[in] tx Transaction.
+ * @param[in] state State.
+ * @param[in] data Transaction data.
+ * @param[in] data_length Length of @a data.
+ * @param[in] cbdata Callback data (actually phase_rule_cbdata_t)
+ *
+ * @returns Status code
+ */
+static ib_status_t run_stream_txdata_rules(ib_engine_t *ib,
+                                           ib_tx_t *tx,
+                                           ib_state_t state,
+                                           const char *data,
+                                           size_t data_length,
+                                           void *cbdata)
+{
+    assert(ib != NULL);
+    assert(cbdata != NULL);
+
+    if (data == NULL) {
+        return IB_OK;
+    }
+    const ib_rule_phase_meta_t *meta = (const ib_rule_phase_meta_t *)cbdata;
+    ib_rule_exec_t             *rule_exec = tx->rule_exec;
+    ib_core_cfg_t              *corecfg;
+    size_t                      limit = 0;
+    ib_status_t                 rc;
+
+    /* Data of an allowed transaction is not coalesced; its rules would
+     * not run anyway. */
+    if (rule_allow(tx, meta, false)) {
+        return IB_OK;
+    }
+
+    rc = ib_core_context_config(tx->ctx, &corecfg);
+    if ( (rc == IB_OK) && (corecfg->rule_stream_coalesce > 0) ) {
+        limit = (size_t)corecfg->rule_stream_coalesce;
+    }
+
+    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+    if ( (limit > 0) && (rule_exec != NULL) ) {
+        size_t idx = stream_buffer_index(meta);
+
+        /* Large fragments run as is, after any pending data. */
+        if (data_length >= limit) {
+            rc = flush_stream_buffer(ib, tx, meta);
+            if (rc == IB_OK) {
+                rc = run_stream_data_rules(ib, tx, meta, data, data_length);
+            }
+            ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+            return rc;
+        }
+
+        if (rule_exec->stream_buffer[idx] == NULL) {
+            rule_exec->stream_buffer[idx] = ib_mm_alloc(tx->mm, limit);
+            if (rule_exec->stream_buffer[idx] == NULL) {
+                return IB_EALLOC;
+            }
+        }
+        if (rule_exec->stream_buffer_length[idx] + data_length > limit) {
+            rc = flush_stream_buffer(ib, tx, meta);
+            if (rc != IB_OK) {
+                ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+                return rc;
+            }
+        }
+        memcpy(rule_exec->stream_buffer[idx] +
+               rule_exec->stream_buffer_length[idx],
+               data, data_length);
+        rule_exec->stream_buffer_length[idx] += data_length;
+
+        if (rule_exec->stream_buffer_length[idx] == limit) {
+            rc = flush_stream_buffer(ib, tx, meta);
+        }
+        ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+        return rc;
+    }
+
+    rc = run_stream_data_rules(ib, tx, meta, data, data_length);
+    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+    return rc;
+}
+
+/**
+ * Run stream TXDATA rules on the data still coalesced when a body finishes.
+ *
+ * @param[in] ib Engine.
+ * @param[in] tx Transaction.
+ * @param[in] state State.
+ * @param[in] cbdata Callback data (actually phase_rule_cbdata_t)
+ *
+ * @returns Status code
+ */
+static ib_status_t flush_stream_txdata_rules(ib_engine_t *ib,
+                                             ib_tx_t *tx,
+                                             ib_state_t state,
+                                             void *cbdata)
+{
+    assert(ib != NULL);
+    assert(tx != NULL);
+    assert(cbdata != NULL);
+
+    const ib_rule_phase_meta_t *meta = (const ib_rule_phase_meta_t *)cbdata;
+    ib_status_t                 rc;
+
+    if (tx->rule_exec == NULL) {
+        return IB_OK;
+    }
+
+    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+    rc = flush_stream_buffer(ib, tx, meta);
+    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+    return rc;
+}
+
+/**
+ * Run stream TX rules (aka request header)
+ *
+ * @param[in] ib Engine.
+ * @param[in] tx Transaction.
+ * @param[in] state State.
+ * @param[in] cbdata Callback data (actually phase_rule_cbdata_t)
+ *
+ * @returns Status code
+ */
+static ib_status_t run_stream_tx_rules(ib_engine_t *ib,
+                                       ib_tx_t *tx,
+                                       ib_state_t state,
+                                       void *cbdata)
+{
+    ib_parsed_headers_t *hdrs;
+    ib_status_t rc;
+
+    assert(ib != NULL);
+    assert(tx != NULL);
+    assert(cbdata != NULL);
+
+    const ib_rule_phase_meta_t *meta = (const ib_rule_phase_meta_t *) cbdata;
+
+    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+
+    /* Wrap up the request line */
+    rc = ib_parsed_headers_create(&hdrs, tx->mm);
+    if (rc != IB_OK) {
+        ib_log_error_tx(tx, "Error creating name/value pair list: %s",
+                        ib_status_to_string(rc));
+        return rc;
+    }
+    if ( (tx->request_line != NULL) &&
+         (tx->request_line->method != NULL) &&
+         (ib_bytestr_const_ptr(tx->request_line->method) != NULL) )
+    {
+        rc = ib_parsed_headers_add(
+            hdrs,
+            "method", 6,
+            (const char *)ib_bytestr_const_ptr(tx->request_line->method),
+            ib_bytestr_length(tx->request_line->method));
+        if (rc != IB_OK) {
+            ib_rule_log_tx_error(tx,
+                                 "Error adding method to "
+                                 "name/value pair list: %s",
+                                 ib_status_to_string(rc));
+            return rc;
+        }
+    }
+
+    if ( (tx->request_line != NULL) &&
+         (tx->request_line->uri != NULL) &&
+         (ib_bytestr_const_ptr(tx->request_line->uri) != NULL) )
+    {
+        rc = ib_parsed_headers_add(
+            hdrs,
+            "uri", 3,
+            (const char *)ib_bytestr_const_ptr(tx->request_line->uri),
+            ib_bytestr_length(tx->request_line->uri));
+        if (rc != IB_OK) {
+            ib_rule_log_tx_error(tx,
+                                 "Error adding uri to name/value pair list: %s",
+                                 ib_status_to_string(rc));
+            return rc;
+        }
+    }
+
+    if ( (tx->request_line != NULL) &&
+         (tx->request_line->protocol != NULL) &&
+         (ib_bytestr_const_ptr(tx->request_line->protocol) != NULL) )
+    {
+        rc = ib_parsed_headers_add(
+            hdrs,
+            "protocol", 8,
+            (const char *)ib_bytestr_const_ptr(tx->request_line->protocol),
+            ib_bytestr_length(tx->request_line->protocol));
+        if (rc != IB_OK) {
+            ib_rule_log_tx_error(tx,
+                                 "Error adding protocol to name/value "
+                                 "pair list: %s",
+                                 ib_status_to_string(rc));
+            return rc;
+        }
+    }
+
+    /* Now, process the request line */
+    if ( (hdrs != NULL) && (hdrs->head != NULL) ) {
+        ib_rule_log_tx_trace(tx, "Running header line through stream header");
+        rc = run_stream_rules(ib, tx, state, NULL, 0, 0, hdrs->head, meta);
+        if (rc != IB_OK) {
+            ib_rule_log_tx_error(tx,
+                                 "Error processing tx request line: %s",
                                  ib_status_to_string(rc));
             return rc;
         }
     }
 
-    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+    /* Process the request header */
+    if ( (tx->request_header != NULL) && (tx->request_header->head != NULL) ) {
+        ib_rule_log_tx_trace(tx, "Running header through stream header");
+        rc = run_stream_rules(
+            ib, tx, state, NULL, 0, 0, tx->request_header->head, meta);
+        if (rc != IB_OK) {
+            ib_rule_log_tx_error(tx,
+                                 "Error processing tx request line: %s",
+                                 ib_status_to_string(rc));
+            return rc;
+        }
+    }
+
+    ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
+
+    return IB_OK;
+}
+
+/**
+ * Initialize rule set objects.
+ *
+ * @param[in] ib Engine
+ * @param[in] mm Memory manager to use for allocations
+ * @param[in,out] ctx_rules Context's rules
+ *
+ * @returns Status code
+ */
+static ib_status_t init_ruleset(ib_engine_t *ib,
+                                ib_mm_t mm,
+                                ib_rule_context_t *ctx_rules)
+{
+    ib_status_t rc;
+    ib_rule_phase_num_t    phase_num;
+
+    /* Initialize the phase rules */
+    for (phase_num = IB_PHASE_NONE;
+         phase_num < IB_RULE_PHASE_COUNT;
+         ++phase_num)
+    {
+        ib_ruleset_phase_t *ruleset_phase =
+            &(ctx_rules->ruleset.phases[phase_num]);
+        ruleset_phase->phase_num = (ib_rule_phase_num_t)phase_num;
+        rc = find_phase_meta(phase_num, &(ruleset_phase->phase_meta));
+        if (rc != IB_OK) {
+            ib_log_error(ib,
+                         "Error finding phase meta data: %s",
+                         ib_status_to_string(rc));
+            return rc;
+        }
+
+        rc = ib_list_create(&(ruleset_phase->rule_list), mm);
+        if (rc != IB_OK) {
+            ib_log_error(ib,
+                         "Error creating phase ruleset list: %s",
+                         ib_status_to_string(rc));
+            return rc;
+        }
+    }
+
+    /* Create a hash to hold rules indexed by ID */
+    rc = ib_hash_create_nocase(&(ctx_rules->rule_hash), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error creating ruleset hash: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Register rules callbacks
+ *
+ * @param[in] ib Engine
+ * @param[in] mm Memory manager to use for allocations
+ * @param[in,out] rule_engine Rule engine
+ *
+ * @returns Status code
+ */
+static ib_status_t register_callbacks(ib_engine_t *ib,
+                                      ib_mm_t mm,
+                                      ib_rule_engine_t *rule_engine)
+{
+    const ib_rule_phase_meta_t *meta;
+    const char                 *hook_type = NULL;
+    ib_status_t                 rc = IB_OK;
+
+
+
+    /* Register specific handlers for specific states, and a
+     * generic handler for the rest */
+    for (meta = rule_phase_meta; meta->phase_num != IB_PHASE_INVALID; ++meta) {
+        if (meta->state == (ib_state_t) -1) {
+            continue;
+        }
+
+        /* Phase rules (non-stream rules) all use the same callback */
+        if (! meta->is_stream) {
+            rc = ib_hook_tx_register(
+                ib,
+                meta->state,
+                run_phase_rules,
+                (void *)meta);
+            hook_type = "tx";
+        }
+        else {
+            switch (meta->hook_type) {
+
+            case IB_STATE_HOOK_TX:
+                rc = ib_hook_tx_register(
+                    ib,
+                    meta->state,
+                    run_stream_tx_rules,
+                    (void *)meta);
+                hook_type = "stream-tx";
+                break;
+
+            case IB_STATE_HOOK_TXDATA:
+                rc = ib_hook_txdata_register(
+                    ib,
+                    meta->state,
+                    run_stream_txdata_rules,
+                    (void *)meta);
+                hook_type = "txdata";
+                if (rc != IB_OK) {
+                    break;
+                }
+
+                /* Run rules on coalesced data when the body finishes. */
+                rc = ib_hook_tx_register(
+                    ib,
+                    ib_flags_all(meta->flags, PHASE_FLAG_REQUEST) ?
+                        request_finished_state : response_finished_state,
+                    flush_stream_txdata_rules,
+                    (void *)meta);
+                break;
+
+            case IB_STATE_HOOK_HEADER:
+                rc = ib_hook_parsed_header_data_register(
+                    ib,
+                    meta->state,
+                    run_stream_header_rules,
+                    (void *)meta);
+                hook_type = "header";
+                break;
+
+            default:
+                ib_log_error(ib,
+                             "Unknown hook registration type %d for "
+                             "phase %d/\"%s\"",
+                             meta->phase_num, meta->state,
+                             phase_description(meta));
+                return IB_EINVAL;
+            }
+        }
+
+        /* OK */
+        if (rc != IB_OK) {
+            ib_log_error(ib,
+                         "Error registering hook \"%s\" for phase "
+                         "%d/%d/\"%s\": %s",
+                         hook_type, meta->phase_num, meta->state,
+                         phase_description(meta),
+                         ib_status_to_string(rc));
+            return rc;
+        }
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Initialize a rule engine object.
+ *
+ * @param[in] ib Engine
+ * @param[in] mm Memory manager to use for allocations
+ * @param[out] p_rule_engine Pointer to new rule engine object
+ *
+ * @returns Status code
+ */
+static ib_status_t create_rule_engine(const ib_engine_t *ib,
+                                      ib_mm_t mm,
+                                      ib_rule_engine_t **p_rule_engine)
+{
+    ib_rule_engine_t    *rule_engine;
+    ib_status_t          rc;
+    ib_rule_phase_num_t  phase;
+
+    /* Create the rule object */
+    rule_engine =
+        (ib_rule_engine_t *)ib_mm_calloc(mm, 1, sizeof(*rule_engine));
+    if (rule_engine == NULL) {
+        return IB_EALLOC;
+    }
+
+    /* Indices start at 0 */
+    rule_engine->index_limit = 0;
+
+    /* Create the rule list */
+    rc = ib_list_create(&(rule_engine->rule_list), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error creating rule engine rule list: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    /* Create the main rule hash, used to index rules by ID */
+    rc = ib_hash_create_nocase(&(rule_engine->rule_hash), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error creating rule engine rule hash: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    /* Create the transformation chain hash; chain id 0 means "none" */
+    rc = ib_hash_create(&(rule_engine->tfn_chains), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error creating rule engine transformation chain hash: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+    rule_engine->tfn_chain_limit = 1;
+
+    /* Create the external drivers hash */
+    rc = ib_hash_create(&(rule_engine->external_drivers), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error creating rule engine external rules hash: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    /* Create the ownership cb list */
+    rc = ib_list_create(&(rule_engine->ownership_cbs), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error creating rule engine ownership callback list: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    /* Create the lock for deferred context rule set builds */
+    rc = ib_lock_create(&(rule_engine->lazy_lock), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error creating rule engine lazy context lock: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    /* Create the injection cb lists */
+    for (phase = IB_PHASE_NONE; phase < IB_RULE_PHASE_COUNT; ++phase) {
+        rc = ib_list_create(&(rule_engine->injection_cbs[phase]), mm);
+        if (rc != IB_OK) {
+            ib_log_error(ib,
+                         "Error creating rule engine injection callback list: %s",
+                         ib_status_to_string(rc));
+            return rc;
+        }
+    }
+
+    /* Setup hook lists */
+    rc = ib_list_create(&(rule_engine->hooks.pre_rule), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+            "Error creating rule engine pre rule hook callback list: %s",
+            ib_status_to_string(rc)
+        );
+        return rc;
+    }
+    rc = ib_list_create(&(rule_engine->hooks.post_rule), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+            "Error creating rule engine post rule hook callback list: %s",
+            ib_status_to_string(rc)
+        );
+        return rc;
+    }
+    rc = ib_list_create(&(rule_engine->hooks.pre_operator), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+            "Error creating rule engine pre operator hook callback list: %s",
+            ib_status_to_string(rc)
+        );
+        return rc;
+    }
+    rc = ib_list_create(&(rule_engine->hooks.post_operator), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+            "Error creating rule engine post operator hook callback list: %s",
+            ib_status_to_string(rc)
+        );
+        return rc;
+    }
+    rc = ib_list_create(&(rule_engine->hooks.pre_action), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+            "Error creating rule engine pre action hook callback list: %s",
+            ib_status_to_string(rc)
+        );
+        return rc;
+    }
+    rc = ib_list_create(&(rule_engine->hooks.post_action), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+            "Error creating rule engine post action hook callback list: %s",
+            ib_status_to_string(rc)
+        );
+        return rc;
+    }
+
+    *p_rule_engine = rule_engine;
+    return IB_OK;
+}
+
+/**
+ * Initialize a context's rule object.
+ *
+ * @param[in] ib Engine
+ * @param[in] mm Memory manager to use for allocations
+ * @param[out] p_ctx_rules Pointer to new rule context object
+ *
+ * @returns Status code
+ */
+static ib_status_t create_rule_context(const ib_engine_t *ib,
+                                       ib_mm_t mm,
+                                       ib_rule_context_t **p_ctx_rules)
+{
+    assert(ib != NULL);
+    assert(p_ctx_rules != NULL);
+
+    ib_rule_context_t *ctx_rules;
+    ib_status_t        rc;
+
+    /* Create the rule object */
+    ctx_rules =
+        (ib_rule_context_t *)ib_mm_calloc(mm, 1, sizeof(*ctx_rules));
+    if (ctx_rules == NULL) {
+        return IB_EALLOC;
+    }
+
+    /* Create the rule list */
+    rc = ib_list_create(&(ctx_rules->rule_list), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error initializing rule engine rule list: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    /* Create the rule enable/disable lists */
+    rc = ib_list_create(&(ctx_rules->enable_list), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error initializing rule engine rule enable list: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    *p_ctx_rules = ctx_rules;
+    return IB_OK;
+}
+
+/**
+ * Copy a list of rules from one list to another
+ *
+ * @param[in] src_list List of items to copy
+ * @param[in,out] dest_list List to copy items into
+ *
+ * @returns Status code
+ */
+static ib_status_t copy_rule_list(const ib_list_t *src_list,
+                                  ib_list_t *dest_list)
+{
+    assert(src_list != NULL);
+    assert(dest_list != NULL);
+
+    return ib_list_copy_nodes(src_list, dest_list);
+}
+
+/**
+ * Copy all rules from @a src_hash to @a dest_hash.
+ *
+ * @param[in] ctx Provides access to the IronBee engine temp
+ *                mpool and logging.
+ * @param[in] src_hash Hash of rules to copy
+ * @param[in,out] dest_hash Hash to copy rules into
+ *
+ * @returns
+ *   - IB_OK on success, including if the @a src_hash is size 0.
+ *   - IB_EALLOC if a temporary list cannot be made.
+ */
+static ib_status_t copy_rule_hash(const ib_context_t *ctx,
+                                  const ib_hash_t *src_hash,
+                                  ib_hash_t *dest_hash)
+{
+    assert(src_hash != NULL);
+    assert(dest_hash != NULL);
+    ib_status_t rc;
+    ib_hash_iterator_t *iterator;
+
+    if (ib_hash_size(src_hash) == 0) {
+        return IB_OK;
+    }
+    iterator = ib_hash_iterator_create(ib_engine_mm_temp_get(ctx->ib));
+    if (iterator == NULL) {
+        return IB_EALLOC;
+    }
+    ib_hash_iterator_first(iterator, src_hash);
+
+    while (! ib_hash_iterator_at_end(iterator)) {
+        const ib_rule_t *rule;
+        ib_hash_iterator_fetch(NULL, NULL, &rule, iterator);
+
+        assert(rule != NULL);
+
+        rc = ib_hash_set(dest_hash, rule->meta.id, (void *)rule);
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+        ib_hash_iterator_next(iterator);
+    }
+    return IB_OK;
+}
+
+/**
+ * Import a rule's context from it's parent
+ *
+ * The parent's rule list, rule hash and enable list are shared rather than
+ * copied.  Both contexts mark them as shared, and whichever context modifies
+ * them first takes a private copy (see unshare_rules() and
+ * unshare_enables()), so the child still sees the parent's rules as of the
+ * time it was opened.
+ *
+ * @param[in] ctx Context being imported to
+ * @param[in,out] parent_rules Parent's rule context object
+ * @param[in,out] ctx_rules Rule context object
+ *
+ * @returns Status code
+ */
+static ib_status_t import_rule_context(const ib_context_t *ctx,
+                                       ib_rule_context_t *parent_rules,
+                                       ib_rule_context_t *ctx_rules)
+{
+    assert(ctx != NULL);
+    assert(parent_rules != NULL);
+    assert(ctx_rules != NULL);
+
+    ctx_rules->rule_list = parent_rules->rule_list;
+    ctx_rules->rule_hash = parent_rules->rule_hash;
+    ctx_rules->enable_list = parent_rules->enable_list;
+
+    ib_flags_set(parent_rules->shared,
+                 IB_RULECTX_SHARED_RULES | IB_RULECTX_SHARED_ENABLES);
+    ib_flags_set(ctx_rules->shared,
+                 IB_RULECTX_SHARED_RULES | IB_RULECTX_SHARED_ENABLES);
+
+    return IB_OK;
+}
+
+/**
+ * Take a private copy of a context's rule list and rule hash if shared.
+ *
+ * @param[in] ctx Context (provides the memory manager for the copies)
+ * @param[in,out] ctx_rules Rule context object of @a ctx
+ *
+ * @returns Status code
+ */
+static ib_status_t unshare_rules(const ib_context_t *ctx,
+                                 ib_rule_context_t *ctx_rules)
+{
+    assert(ctx != NULL);
+    assert(ctx_rules != NULL);
+
+    ib_list_t   *rule_list;
+    ib_hash_t   *rule_hash;
+    ib_status_t  rc;
+
+    if (! ib_flags_all(ctx_rules->shared, IB_RULECTX_SHARED_RULES)) {
+        return IB_OK;
+    }
+
+    rc = ib_list_create(&rule_list, ctx->mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = copy_rule_list(ctx_rules->rule_list, rule_list);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_hash_create_nocase(&rule_hash, ctx->mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = copy_rule_hash(ctx, ctx_rules->rule_hash, rule_hash);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    ctx_rules->rule_list = rule_list;
+    ctx_rules->rule_hash = rule_hash;
+    ib_flags_clear(ctx_rules->shared, IB_RULECTX_SHARED_RULES);
+
+    return IB_OK;
+}
+
+/**
+ * Take a private copy of a context's enable list if shared.
+ *
+ * @param[in] ctx Context (provides the memory manager for the copy)
+ * @param[in,out] ctx_rules Rule context object of @a ctx
+ *
+ * @returns Status code
+ */
+static ib_status_t unshare_enables(const ib_context_t *ctx,
+                                   ib_rule_context_t *ctx_rules)
+{
+    assert(ctx != NULL);
+    assert(ctx_rules != NULL);
+
+    ib_list_t   *enable_list;
+    ib_status_t  rc;
+
+    if (! ib_flags_all(ctx_rules->shared, IB_RULECTX_SHARED_ENABLES)) {
+        return IB_OK;
+    }
+
+    rc = ib_list_create(&enable_list, ctx->mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = copy_rule_list(ctx_rules->enable_list, enable_list);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    ctx_rules->enable_list = enable_list;
+    ib_flags_clear(ctx_rules->shared, IB_RULECTX_SHARED_ENABLES);
+
+    return IB_OK;
+}
+
+
+/* Rule enable functions. */
+static ib_status_t rule_enable_all(const ib_rule_t *rule, void *cbdata) {
+    assert(rule != NULL);
+    return IB_OK;
+}
+
+static ib_status_t rule_enable_by_tag(const ib_rule_t *rule, void *cbdata) {
+    assert(rule != NULL);
+    assert(cbdata != NULL);
+
+    if (ib_rule_tag_match(rule, (const char *)cbdata)) {
+        return IB_OK;
+    }
+
+    return IB_DECLINED;
+}
+
+static ib_status_t rule_enable_by_id(const ib_rule_t *rule, void *cbdata) {
+    assert(rule != NULL);
+    assert(cbdata != NULL);
+
+    if (ib_rule_id_match(rule, (const char *)cbdata)) {
+        return IB_OK;
+    }
+
+    return IB_DECLINED;
+}
+
+static ib_status_t rule_enable_by_id_prefix(
+    const ib_rule_t *rule,
+    void            *cbdata
+)
+{
+    assert(rule != NULL);
+    assert(cbdata != NULL);
+
+    const char *id     = (const char *)cbdata;
+    size_t      id_len = strlen(id);
+
+    /* First match the rule's ID and full ID */
+    if ( (strncasecmp(id, rule->meta.id, id_len) == 0) ||
+         (strncasecmp(id, rule->meta.full_id, id_len) == 0) )
+    {
+        return IB_OK;
+    }
+
+    /* Check parent rules. */
+    for (
+        ib_rule_t *parent = rule->chained_from;
+        parent != NULL;
+        parent = parent->chained_from
+    )
+    {
+        if ( (strncasecmp(id, parent->meta.id, id_len) == 0) ||
+             (strncasecmp(id, parent->meta.full_id, id_len) == 0) )
+        {
+            return IB_OK;
+        }
+    }
+
+    /* Check child rules. */
+    for (
+        ib_rule_t *child = rule->chained_rule;
+        child != NULL;
+        child = child->chained_rule
+    )
+    {
+        if ( (strncasecmp(id, child->meta.id, id_len) == 0) ||
+             (strncasecmp(id, child->meta.full_id, id_len) == 0) )
+        {
+            return IB_OK;
+        }
+    }
 
-    return IB_OK;
+    /* Finally, no match */
+    return IB_DECLINED;
 }
 
-/**
- * Initialize rule set objects.
- *
- * @param[in] ib Engine
- * @param[in] mm Memory manager to use for allocations
- * @param[in,out] ctx_rules Context's rules
- *
- * @returns Status code
- */
-static ib_status_t init_ruleset(ib_engine_t *ib,
-                                ib_mm_t mm,
-                                ib_rule_context_t *ctx_rules)
+static ib_status_t rule_enable_by_tag_prefix(
+    const ib_rule_t *rule,
+    void            *cbdata
+)
 {
-    ib_status_t rc;
-    ib_rule_phase_num_t    phase_num;
+    assert(rule != NULL);
+    assert(cbdata != NULL);
 
-    /* Initialize the phase rules */
-    for (phase_num = IB_PHASE_NONE;
-         phase_num < IB_RULE_PHASE_COUNT;
-         ++phase_num)
-    {
-        ib_ruleset_phase_t *ruleset_phase =
-            &(ctx_rules->ruleset.phases[phase_num]);
-        ruleset_phase->phase_num = (ib_rule_phase_num_t)phase_num;
-        rc = find_phase_meta(phase_num, &(ruleset_phase->phase_meta));
-        if (rc != IB_OK) {
-            ib_log_error(ib,
-                         "Error finding phase meta data: %s",
-                         ib_status_to_string(rc));
-            return rc;
+    const char *tag = (const char *)cbdata;
+    size_t      tag_len = strlen(tag);
+
+    const ib_list_node_t *node;
+
+    /* First match the rule's tags */
+    IB_LIST_LOOP_CONST(rule->meta.tags, node) {
+        const char *ruletag = (const char *)ib_list_node_data_const(node);
+        if (strncasecmp(tag, ruletag, tag_len) == 0) {
+            return IB_OK;
         }
+    }
 
-        rc = ib_list_create(&(ruleset_phase->rule_list), mm);
-        if (rc != IB_OK) {
-            ib_log_error(ib,
-                         "Error creating phase ruleset list: %s",
-                         ib_status_to_string(rc));
-            return rc;
+    /* Check parent rules. */
+    for (
+        ib_rule_t *parent = rule->chained_from;
+        parent != NULL;
+        parent = parent->chained_from
+    )
+    {
+        IB_LIST_LOOP_CONST(parent->meta.tags, node) {
+            const char *ruletag = (const char *)ib_list_node_data_const(node);
+            if (strncasecmp(tag, ruletag, tag_len) == 0) {
+                return IB_OK;
+            }
         }
     }
 
-    /* Create a hash to hold rules indexed by ID */
-    rc = ib_hash_create_nocase(&(ctx_rules->rule_hash), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-                     "Error creating ruleset hash: %s",
-                     ib_status_to_string(rc));
-        return rc;
+    /* Check child rules. */
+    for (
+        ib_rule_t *child = rule->chained_rule;
+        child != NULL;
+        child = child->chained_rule
+    )
+    {
+        IB_LIST_LOOP_CONST(child->meta.tags, node) {
+            const char *ruletag = (const char *)ib_list_node_data_const(node);
+            if (strncasecmp(tag, ruletag, tag_len) == 0) {
+                return IB_OK;
+            }
+        }
     }
 
-    return IB_OK;
+    /* Finally, no match */
+    return IB_DECLINED;
 }
 
+
+
+/* End Rule enable functions. */
+
 /**
- * Register rules callbacks
+ * Bring the match cache of an enable item up to date.
  *
- * @param[in] ib Engine
- * @param[in] mm Memory manager to use for allocations
- * @param[in,out] rule_engine Rule engine
+ * Calls the item's rule_enable_fn for every rule of @a ctx_rule_list that
+ * it has not been called for yet.
  *
- * @returns Status code
+ * @param[in] ib IronBee engine
+ * @param[in,out] match Enable match data
+ * @param[in] present Bitmap of the rules of @a ctx_rule_list
+ * @param[in] words Number of words in @a present
+ * @param[in] ctx_rule_list List of rules of the context being closed
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
  */
-static ib_status_t register_callbacks(ib_engine_t *ib,
-                                      ib_mm_t mm,
-                                      ib_rule_engine_t *rule_engine)
+static ib_status_t enable_cache_update(
+    ib_engine_t      *ib,
+    ib_rule_enable_t *match,
+    const uint64_t   *present,
+    size_t            words,
+    const ib_list_t  *ctx_rule_list
+)
 {
-    const ib_rule_phase_meta_t *meta;
-    const char                 *hook_type = NULL;
-    ib_status_t                 rc = IB_OK;
+    assert(ib != NULL);
+    assert(match != NULL);
+    assert(present != NULL);
+    assert(ctx_rule_list != NULL);
 
+    const ib_list_node_t *node;
+    bool                  missing = false;
+    size_t                w;
 
+    /* Rules have been created since the cache was last grown. */
+    if (match->words < words) {
+        ib_mm_t   mm = ib_engine_mm_main_get(ib);
+        uint64_t *known   = ib_mm_calloc(mm, words, sizeof(*known));
+        uint64_t *matched = ib_mm_calloc(mm, words, sizeof(*matched));
 
-    /* Register specific handlers for specific states, and a
-     * generic handler for the rest */
-    for (meta = rule_phase_meta; meta->phase_num != IB_PHASE_INVALID; ++meta) {
-        if (meta->state == (ib_state_t) -1) {
-            continue;
+        if (known == NULL || matched == NULL) {
+            return IB_EALLOC;
         }
-
-        /* Phase rules (non-stream rules) all use the same callback */
-        if (! meta->is_stream) {
-            rc = ib_hook_tx_register(
-                ib,
-                meta->state,
-                run_phase_rules,
-                (void *)meta);
-            hook_type = "tx";
+        if (match->words > 0) {
+            memcpy(known, match->known, match->words * sizeof(*known));
+            memcpy(matched, match->matched, match->words * sizeof(*matched));
         }
-        else {
-            switch (meta->hook_type) {
-
-            case IB_STATE_HOOK_TX:
-                rc = ib_hook_tx_register(
-                    ib,
-                    meta->state,
-                    run_stream_tx_rules,
-                    (void *)meta);
-                hook_type = "stream-tx";
-                break;
+        match->known   = known;
+        match->matched = matched;
+        match->words   = words;
+    }
 
-            case IB_STATE_HOOK_TXDATA:
-                rc = ib_hook_txdata_register(
-                    ib,
-                    meta->state,
-                    run_stream_txdata_rules,
-                    (void *)meta);
-                hook_type = "txdata";
-                break;
+    for (w = 0; w < words; ++w) {
+        if ((present[w] & ~match->known[w]) != 0) {
+            missing = true;
+            break;
+        }
+    }
+    if (! missing) {
+        return IB_OK;
+    }
 
-            case IB_STATE_HOOK_HEADER:
-                rc = ib_hook_parsed_header_data_register(
-                    ib,
-                    meta->state,
-                    run_stream_header_rules,
-                    (void *)meta);
-                hook_type = "header";
-                break;
+    IB_LIST_LOOP_CONST(ctx_rule_list, node) {
+        const ib_rule_ctx_data_t *ctx_rule =
+            (const ib_rule_ctx_data_t *)ib_list_node_data_const(node);
+        size_t index = ctx_rule->rule->meta.index;
 
-            default:
-                ib_log_error(ib,
-                             "Unknown hook registration type %d for "
-                             "phase %d/\"%s\"",
-                             meta->phase_num, meta->state,
-                             phase_description(meta));
-                return IB_EINVAL;
-            }
+        if (RULE_BITMAP_ISSET(match->known, index)) {
+            continue;
         }
-
-        /* OK */
-        if (rc != IB_OK) {
-            ib_log_error(ib,
-                         "Error registering hook \"%s\" for phase "
-                         "%d/%d/\"%s\": %s",
-                         hook_type, meta->phase_num, meta->state,
-                         phase_description(meta),
-                         ib_status_to_string(rc));
-            return rc;
+        RULE_BITMAP_SET(match->known, index);
+        if (match->rule_enable_fn(ctx_rule->rule,
+                                  match->rule_enable_cbdata) == IB_OK)
+        {
+            RULE_BITMAP_SET(match->matched, index);
         }
     }
 
@@ -3207,542 +5782,745 @@ static ib_status_t register_callbacks(ib_engine_t *ib,
 }
 
 /**
- * Initialize a rule engine object.
+ * Enable rules that match tag / id
  *
- * @param[in] ib Engine
- * @param[in] mm Memory manager to use for allocations
- * @param[out] p_rule_engine Pointer to new rule engine object
+ * The enable state of the rules of the context is kept in the bitmap
+ * @a enabled, indexed by rule index, and the item is applied to it a word at
+ * a time.  "All" items need no matching at all.
  *
- * @returns Status code
- */
-static ib_status_t create_rule_engine(const ib_engine_t *ib,
-                                      ib_mm_t mm,
-                                      ib_rule_engine_t **p_rule_engine)
-{
-    ib_rule_engine_t    *rule_engine;
-    ib_status_t          rc;
-    ib_rule_phase_num_t  phase;
-
-    /* Create the rule object */
-    rule_engine =
-        (ib_rule_engine_t *)ib_mm_calloc(mm, 1, sizeof(*rule_engine));
-    if (rule_engine == NULL) {
-        return IB_EALLOC;
-    }
-
-    /* Indices start at 0 */
-    rule_engine->index_limit = 0;
-
-    /* Create the rule list */
-    rc = ib_list_create(&(rule_engine->rule_list), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-                     "Error creating rule engine rule list: %s",
-                     ib_status_to_string(rc));
-        return rc;
-    }
-
-    /* Create the main rule hash, used to index rules by ID */
-    rc = ib_hash_create_nocase(&(rule_engine->rule_hash), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-                     "Error creating rule engine rule hash: %s",
-                     ib_status_to_string(rc));
-        return rc;
-    }
-
-    /* Create the external drivers hash */
-    rc = ib_hash_create(&(rule_engine->external_drivers), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-                     "Error creating rule engine external rules hash: %s",
-                     ib_status_to_string(rc));
-        return rc;
-    }
+ * @param[in] ib IronBee engine
+ * @param[in] ctx Current IronBee context
+ * @param[in,out] match Enable match data
+ * @param[in] present Bitmap of the rules of @a ctx_rule_list
+ * @param[in,out] enabled Bitmap of the enabled rules of @a ctx_rule_list
+ * @param[in] words Number of words in @a present and @a enabled
+ * @param[in] ctx_rule_list List of rules to search for matches to @a enable
+ *
+ * @returns Status code
+ */
+static ib_status_t enable_rules(
+    ib_engine_t      *ib,
+    ib_context_t     *ctx,
+    ib_rule_enable_t *match,
+    const uint64_t   *present,
+    uint64_t         *enabled,
+    size_t            words,
+    const ib_list_t  *ctx_rule_list
+)
+{
+    assert(ib != NULL);
+    assert(ctx != NULL);
+    assert(match != NULL);
+    assert(present != NULL);
+    assert(enabled != NULL);
+    assert(ctx_rule_list != NULL);
 
-    /* Create the ownership cb list */
-    rc = ib_list_create(&(rule_engine->ownership_cbs), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-                     "Error creating rule engine ownership callback list: %s",
-                     ib_status_to_string(rc));
-        return rc;
-    }
+    unsigned int    matches = 0;
+    const char     *lcname = match->enable ? "enable" : "disable";
+    bool            all = (match->rule_enable_fn == rule_enable_all);
+    size_t          w;
+    ib_status_t     rc;
 
-    /* Create the injection cb lists */
-    for (phase = IB_PHASE_NONE; phase < IB_RULE_PHASE_COUNT; ++phase) {
-        rc = ib_list_create(&(rule_engine->injection_cbs[phase]), mm);
+    if (! all) {
+        rc = enable_cache_update(ib, match, present, words, ctx_rule_list);
         if (rc != IB_OK) {
-            ib_log_error(ib,
-                         "Error creating rule engine injection callback list: %s",
-                         ib_status_to_string(rc));
             return rc;
         }
     }
 
-    /* Setup hook lists */
-    rc = ib_list_create(&(rule_engine->hooks.pre_rule), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-            "Error creating rule engine pre rule hook callback list: %s",
-            ib_status_to_string(rc)
-        );
-        return rc;
-    }
-    rc = ib_list_create(&(rule_engine->hooks.post_rule), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-            "Error creating rule engine post rule hook callback list: %s",
-            ib_status_to_string(rc)
-        );
-        return rc;
-    }
-    rc = ib_list_create(&(rule_engine->hooks.pre_operator), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-            "Error creating rule engine pre operator hook callback list: %s",
-            ib_status_to_string(rc)
-        );
-        return rc;
-    }
-    rc = ib_list_create(&(rule_engine->hooks.post_operator), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-            "Error creating rule engine post operator hook callback list: %s",
-            ib_status_to_string(rc)
-        );
-        return rc;
+    for (w = 0; w < words; ++w) {
+        uint64_t bits = all ? present[w] : (present[w] & match->matched[w]);
+
+        matches += __builtin_popcountll(bits);
+        if (match->enable) {
+            enabled[w] |= bits;
+        }
+        else {
+            enabled[w] &= ~bits;
+        }
     }
-    rc = ib_list_create(&(rule_engine->hooks.pre_action), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-            "Error creating rule engine pre action hook callback list: %s",
-            ib_status_to_string(rc)
+
+    if (match->require_match && matches == 0) {
+
+        ib_cfg_log_notice_ex(
+            ib,
+            match->file,
+            match->lineno,
+            "Failed to %s any rules with %s.",
+            lcname,
+            match->name
         );
-        return rc;
+        return IB_ENOENT;
     }
-    rc = ib_list_create(&(rule_engine->hooks.post_action), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-            "Error creating rule engine post action hook callback list: %s",
-            ib_status_to_string(rc)
+    else {
+        ib_cfg_log_debug_ex(
+            ib,
+            match->file,
+            match->lineno,
+            "Enabled %u rules by %s.",
+            matches,
+            match->name
         );
-        return rc;
     }
 
-    *p_rule_engine = rule_engine;
     return IB_OK;
 }
 
+bool ib_rule_is_chained(const ib_rule_t *rule) {
+    return ib_flags_any(rule->flags, IB_RULE_FLAG_CHCHILD);
+}
+
+bool ib_rule_is_marked(const ib_rule_t *rule) {
+    return ib_flags_any(rule->flags, IB_RULE_FLAG_MARK);
+}
+
 /**
- * Initialize a context's rule object.
+ * Build the precompiled phase rule arrays for a context.
  *
- * @param[in] ib Engine
- * @param[in] mm Memory manager to use for allocations
- * @param[out] p_ctx_rules Pointer to new rule context object
+ * The rule list of each phase is flattened into an array that holds only
+ * the runnable rules, so that the per-transaction cost of selecting the rules
+ * of a phase does not depend on the number of configured rules.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in,out] ctx IronBee context
  *
  * @returns Status code
  */
-static ib_status_t create_rule_context(const ib_engine_t *ib,
-                                       ib_mm_t mm,
-                                       ib_rule_context_t **p_ctx_rules)
+static ib_status_t build_phase_rule_arrays(ib_engine_t *ib,
+                                           ib_context_t *ctx)
 {
     assert(ib != NULL);
-    assert(p_ctx_rules != NULL);
+    assert(ctx != NULL);
+    assert(ctx->rules != NULL);
 
-    ib_rule_context_t *ctx_rules;
-    ib_status_t        rc;
+    ib_rule_phase_num_t phase_num;
 
-    /* Create the rule object */
-    ctx_rules =
-        (ib_rule_context_t *)ib_mm_calloc(mm, 1, sizeof(*ctx_rules));
-    if (ctx_rules == NULL) {
-        return IB_EALLOC;
-    }
+    for (phase_num = IB_PHASE_NONE;
+         phase_num < IB_RULE_PHASE_COUNT;
+         ++phase_num)
+    {
+        ib_ruleset_phase_t   *ruleset_phase =
+            &(ctx->rules->ruleset.phases[phase_num]);
+        const ib_list_node_t *node;
+        size_t                count = 0;
+
+        ruleset_phase->rule_array = NULL;
+        ruleset_phase->rule_count = 0;
+        ruleset_phase->program = NULL;
+        ruleset_phase->program_length = 0;
+        ruleset_phase->base_program = NULL;
+
+        if (ib_list_elements(ruleset_phase->rule_list) == 0) {
+            continue;
+        }
 
-    /* Create the rule list */
-    rc = ib_list_create(&(ctx_rules->rule_list), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-                     "Error initializing rule engine rule list: %s",
-                     ib_status_to_string(rc));
-        return rc;
-    }
+        ruleset_phase->rule_array = ib_mm_alloc(
+            ctx->mm,
+            ib_list_elements(ruleset_phase->rule_list) *
+                sizeof(*(ruleset_phase->rule_array)));
+        if (ruleset_phase->rule_array == NULL) {
+            return IB_EALLOC;
+        }
 
-    /* Create the rule enable/disable lists */
-    rc = ib_list_create(&(ctx_rules->enable_list), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-                     "Error initializing rule engine rule enable list: %s",
-                     ib_status_to_string(rc));
-        return rc;
+        IB_LIST_LOOP_CONST(ruleset_phase->rule_list, node) {
+            const ib_rule_ctx_data_t *ctx_rule =
+                (const ib_rule_ctx_data_t *)ib_list_node_data_const(node);
+
+            if (rule_is_runnable(ctx_rule)) {
+                ruleset_phase->rule_array[count] = ctx_rule->rule;
+                ++count;
+            }
+        }
+        ruleset_phase->rule_count = count;
+
+        /* Stream rules are not chained and execute from the rule array. */
+        if ( (count > 0) && (! ruleset_phase->phase_meta->is_stream) ) {
+            ib_rule_insn_t *program;
+            size_t          length;
+
+            length = phase_program_length(ruleset_phase->rule_array, count);
+            program = ib_mm_alloc(ctx->mm, length * sizeof(*program));
+            if (program == NULL) {
+                return IB_EALLOC;
+            }
+            phase_program_compile(ruleset_phase->rule_array, count, program);
+            ruleset_phase->program = program;
+            ruleset_phase->program_length = length;
+            ruleset_phase->base_program = program;
+        }
+
+        ib_log_debug2(ib,
+                      "Compiled %zd of %zd rules for phase %d/\"%s\" "
+                      "in context \"%s\"",
+                      count, ib_list_elements(ruleset_phase->rule_list),
+                      phase_num, phase_name(ruleset_phase->phase_meta),
+                      ib_context_full_get(ctx));
     }
 
-    *p_ctx_rules = ctx_rules;
     return IB_OK;
 }
 
 /**
- * Copy a list of rules from one list to another
- *
- * @param[in] src_list List of items to copy
- * @param[in,out] dest_list List to copy items into
+ * Free the rule arrays and programs published by adaptive rule ordering.
  *
- * @returns Status code
+ * @param[in] cbdata Rule ordering state (ib_rule_order_t)
  */
-static ib_status_t copy_rule_list(const ib_list_t *src_list,
-                                  ib_list_t *dest_list)
+static void rule_order_cleanup(void *cbdata)
 {
-    assert(src_list != NULL);
-    assert(dest_list != NULL);
+    assert(cbdata != NULL);
 
-    return ib_list_copy_nodes(src_list, dest_list);
+    ib_rule_order_t *order = (ib_rule_order_t *)cbdata;
+    size_t           i;
+
+    for (i = 0; i < order->generations; ++i) {
+        free((void *)order->generation[i]);
+        free((void *)order->program[i]);
+    }
+    order->generations = 0;
 }
 
 /**
- * Copy all rules from @a src_hash to @a dest_hash.
+ * Size the adaptive ordering statistics for all rules registered so far.
  *
- * @param[in] ctx Provides access to the IronBee engine temp
- *                mpool and logging.
- * @param[in] src_hash Hash of rules to copy
- * @param[in,out] dest_hash Hash to copy rules into
+ * @param[in] ib IronBee engine
  *
  * @returns
- *   - IB_OK on success, including if the @a src_hash is size 0.
- *   - IB_EALLOC if a temporary list cannot be made.
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
  */
-static ib_status_t copy_rule_hash(const ib_context_t *ctx,
-                                  const ib_hash_t *src_hash,
-                                  ib_hash_t *dest_hash)
+static ib_status_t rule_order_stats_size(ib_engine_t *ib)
 {
-    assert(src_hash != NULL);
-    assert(dest_hash != NULL);
-    ib_status_t rc;
-    ib_hash_iterator_t *iterator;
+    assert(ib != NULL);
 
-    if (ib_hash_size(src_hash) == 0) {
+    ib_rule_engine_t      *rule_engine = ib->rule_engine;
+    ib_rule_order_stats_t *stats;
+
+    if (rule_engine->order_stats_size >= rule_engine->index_limit) {
         return IB_OK;
     }
-    iterator = ib_hash_iterator_create(ib_engine_mm_temp_get(ctx->ib));
-    if (iterator == NULL) {
+
+    stats = ib_mm_calloc(ib_engine_mm_main_get(ib),
+                         rule_engine->index_limit, sizeof(*stats));
+    if (stats == NULL) {
         return IB_EALLOC;
     }
-    ib_hash_iterator_first(iterator, src_hash);
+    if (rule_engine->order_stats != NULL) {
+        memcpy(stats, rule_engine->order_stats,
+               rule_engine->order_stats_size * sizeof(*stats));
+    }
+    rule_engine->order_stats = stats;
+    rule_engine->order_stats_size = rule_engine->index_limit;
 
-    while (! ib_hash_iterator_at_end(iterator)) {
-        const ib_rule_t *rule;
-        ib_hash_iterator_fetch(NULL, NULL, &rule, iterator);
+    return IB_OK;
+}
 
-        assert(rule != NULL);
+/**
+ * Set up adaptive rule ordering for a context.
+ *
+ * Does nothing unless the context has RuleEngineOrdering set to "Adaptive".
+ *
+ * @param[in] ib IronBee engine
+ * @param[in,out] ctx IronBee context
+ *
+ * @returns Status code
+ */
+static ib_status_t rule_order_init(ib_engine_t *ib,
+                                   ib_context_t *ctx)
+{
+    assert(ib != NULL);
+    assert(ctx != NULL);
+    assert(ctx->rules != NULL);
 
-        rc = ib_hash_set(dest_hash, rule->meta.id, (void *)rule);
+    ib_core_cfg_t       *corecfg;
+    ib_rule_phase_num_t  phase_num;
+    ib_status_t          rc;
+
+    rc = ib_core_context_config(ctx, &corecfg);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    if (corecfg->rule_ordering != IB_RULE_ORDERING_ADAPTIVE) {
+        return IB_OK;
+    }
+
+    rc = rule_order_stats_size(ib);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    for (phase_num = IB_PHASE_NONE;
+         phase_num < IB_RULE_PHASE_COUNT;
+         ++phase_num)
+    {
+        ib_ruleset_phase_t *ruleset_phase =
+            &(ctx->rules->ruleset.phases[phase_num]);
+        ib_rule_order_t    *order;
+
+        /* Stream rules and phases with a single rule keep their order. */
+        if ( (ruleset_phase->phase_meta == NULL) ||
+             ruleset_phase->phase_meta->is_stream ||
+             (ruleset_phase->rule_count < 2) )
+        {
+            continue;
+        }
+
+        order = ib_mm_calloc(ctx->mm, 1, sizeof(*order));
+        if (order == NULL) {
+            return IB_EALLOC;
+        }
+        order->items = ib_mm_alloc(
+            ctx->mm, ruleset_phase->rule_count * sizeof(*(order->items)));
+        if (order->items == NULL) {
+            return IB_EALLOC;
+        }
+        rc = ib_lock_create(&(order->lock), ctx->mm);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        rc = ib_mm_register_cleanup(ctx->mm, rule_order_cleanup, order);
         if (rc != IB_OK) {
             return rc;
         }
 
-        ib_hash_iterator_next(iterator);
+        ruleset_phase->order = order;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Size an array of rule profiles for all rules registered so far.
+ *
+ * Rules may be recording profiles while this runs, once profiling is
+ * turned on at runtime or a deferred rule set is built, so the larger
+ * array is published before its size and the old one is left in place for
+ * any rule still using it.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in,out] profiles Profile array
+ * @param[in,out] size Number of rules of @a profiles
+ * @param[in] per_rule Profiles per rule
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t rule_profiles_grow(ib_engine_t *ib,
+                                      ib_rule_profile_t **profiles,
+                                      size_t *size,
+                                      size_t per_rule)
+{
+    assert(ib != NULL);
+    assert(profiles != NULL);
+    assert(size != NULL);
+
+    size_t             limit = ib->rule_engine->index_limit;
+    ib_rule_profile_t *grown;
+
+    if (*size >= limit) {
+        return IB_OK;
+    }
+
+    grown = ib_mm_calloc(ib_engine_mm_main_get(ib),
+                         limit * per_rule, sizeof(*grown));
+    if (grown == NULL) {
+        return IB_EALLOC;
     }
+    if (*profiles != NULL) {
+        memcpy(grown, *profiles, *size * per_rule * sizeof(*grown));
+    }
+    __atomic_store_n(profiles, grown, __ATOMIC_RELEASE);
+    __atomic_store_n(size, limit, __ATOMIC_RELEASE);
+
     return IB_OK;
 }
 
 /**
- * Import a rule's context from it's parent
+ * Size the rule profiles for all rules registered so far.
  *
- * @param[in] ctx Context being imported to
- * @param[in] parent_rules Parent's rule context object
- * @param[in,out] ctx_rules Rule context object
+ * @param[in] ib IronBee engine
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t rule_profile_size(ib_engine_t *ib)
+{
+    assert(ib != NULL);
+
+    return rule_profiles_grow(ib,
+                              &(ib->rule_engine->profiles),
+                              &(ib->rule_engine->profiles_size),
+                              1);
+}
+
+/**
+ * Set up rule profiling for a context.
+ *
+ * Does nothing unless the context has RuleEngineProfile enabled.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in,out] ctx IronBee context
  *
  * @returns Status code
  */
-static ib_status_t import_rule_context(const ib_context_t *ctx,
-                                       const ib_rule_context_t *parent_rules,
-                                       ib_rule_context_t *ctx_rules)
+static ib_status_t rule_profile_init(ib_engine_t *ib,
+                                     ib_context_t *ctx)
 {
-    assert(parent_rules != NULL);
-    assert(ctx_rules != NULL);
-    ib_status_t rc;
+    assert(ib != NULL);
+    assert(ctx != NULL);
+    assert(ctx->rules != NULL);
+
+    ib_core_cfg_t       *corecfg;
+    ib_rule_phase_num_t  phase_num;
+    ib_status_t          rc;
 
-    /* Copy rules list */
-    rc = copy_rule_list(parent_rules->rule_list, ctx_rules->rule_list);
+    rc = ib_core_context_config(ctx, &corecfg);
     if (rc != IB_OK) {
         return rc;
     }
+    if (corecfg->rule_profile == 0) {
+        return IB_OK;
+    }
 
-    /* Copy enable list */
-    rc = copy_rule_list(parent_rules->enable_list, ctx_rules->enable_list);
+    rc = rule_profile_size(ib);
     if (rc != IB_OK) {
         return rc;
     }
 
-    /* Copy rule hash */
-    rc = copy_rule_hash(ctx, parent_rules->rule_hash, ctx_rules->rule_hash);
-    if (rc != IB_OK) {
-        return rc;
+    for (phase_num = IB_PHASE_NONE;
+         phase_num < IB_RULE_PHASE_COUNT;
+         ++phase_num)
+    {
+        ib_ruleset_phase_t *ruleset_phase =
+            &(ctx->rules->ruleset.phases[phase_num]);
+
+        if ( (ruleset_phase->phase_meta != NULL) &&
+             (! ruleset_phase->phase_meta->is_stream) )
+        {
+            ruleset_phase->profile = true;
+        }
     }
+
     return IB_OK;
 }
 
-
 /**
- * Enable/disable an individual rule
+ * Set up A/B comparison of rule execution for a context.
+ *
+ * Does nothing unless the context has RuleEngineCompare enabled.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in,out] ctx IronBee context
  *
- * @param[in] enable true:Enable, false:Disable
- * @param[in,out] ctx_rule Context rule to enable/disable
+ * @returns Status code
  */
-static void set_rule_enable(bool enable,
-                            ib_rule_ctx_data_t *ctx_rule)
+static ib_status_t rule_compare_init(ib_engine_t *ib,
+                                     ib_context_t *ctx)
 {
-    assert(ctx_rule != NULL);
-
-    if (enable) {
-        ib_flags_set(ctx_rule->flags, IB_RULECTX_FLAG_ENABLED);
-    }
-    else {
-        ib_flags_clear(ctx_rule->flags, IB_RULECTX_FLAG_ENABLED);
-    }
-    return;
-}
-
-/* Rule enable functions. */
-static ib_status_t rule_enable_all(const ib_rule_t *rule, void *cbdata) {
-    assert(rule != NULL);
-    return IB_OK;
-}
+    assert(ib != NULL);
+    assert(ctx != NULL);
+    assert(ctx->rules != NULL);
 
-static ib_status_t rule_enable_by_tag(const ib_rule_t *rule, void *cbdata) {
-    assert(rule != NULL);
-    assert(cbdata != NULL);
+    ib_core_cfg_t       *corecfg;
+    ib_rule_phase_num_t  phase_num;
+    ib_status_t          rc;
 
-    if (ib_rule_tag_match(rule, (const char *)cbdata)) {
+    rc = ib_core_context_config(ctx, &corecfg);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    if (corecfg->rule_compare == 0) {
         return IB_OK;
     }
 
-    return IB_DECLINED;
-}
+    rc = rule_profiles_grow(ib,
+                            &(ib->rule_engine->compare_profiles),
+                            &(ib->rule_engine->compare_profiles_size),
+                            2);
+    if (rc != IB_OK) {
+        return rc;
+    }
 
-static ib_status_t rule_enable_by_id(const ib_rule_t *rule, void *cbdata) {
-    assert(rule != NULL);
-    assert(cbdata != NULL);
+    for (phase_num = IB_PHASE_NONE;
+         phase_num < IB_RULE_PHASE_COUNT;
+         ++phase_num)
+    {
+        ib_ruleset_phase_t *ruleset_phase =
+            &(ctx->rules->ruleset.phases[phase_num]);
 
-    if (ib_rule_id_match(rule, (const char *)cbdata)) {
-        return IB_OK;
+        if ( (ruleset_phase->phase_meta != NULL) &&
+             (! ruleset_phase->phase_meta->is_stream) )
+        {
+            ruleset_phase->compare = true;
+        }
     }
 
-    return IB_DECLINED;
+    return IB_OK;
 }
 
-static ib_status_t rule_enable_by_id_prefix(
-    const ib_rule_t *rule,
-    void            *cbdata
-)
+/**
+ * Can the operator of a rule be executed ahead of time by parallel rule
+ * execution?
+ *
+ * @param[in] rule Rule to check
+ *
+ * @returns true if @a rule is a parallel rule execution candidate
+ */
+static bool rule_is_parallel(const ib_rule_t *rule)
 {
     assert(rule != NULL);
-    assert(cbdata != NULL);
 
-    const char *id     = (const char *)cbdata;
-    size_t      id_len = strlen(id);
+    const ib_rule_target_t *target;
+    ib_flags_t              capabilities;
 
-    /* First match the rule's ID and full ID */
-    if ( (strncasecmp(id, rule->meta.id, id_len) == 0) ||
-         (strncasecmp(id, rule->meta.full_id, id_len) == 0) )
+    if (ib_flags_any(rule->flags,
+                     IB_RULE_FLAG_EXTERNAL | IB_RULE_FLAG_NO_TGT |
+                     IB_RULE_FLAG_CAPTURE))
     {
-        return IB_OK;
+        return false;
     }
-
-    /* Check parent rules. */
-    for (
-        ib_rule_t *parent = rule->chained_from;
-        parent != NULL;
-        parent = parent->chained_from
-    )
+    if ( (rule->chained_rule != NULL) ||
+         (rule->opinst == NULL) ||
+         (rule->opinst->opinst == NULL) )
     {
-        if ( (strncasecmp(id, rule->meta.id, id_len) == 0) ||
-             (strncasecmp(id, rule->meta.full_id, id_len) == 0) )
-        {
-            return IB_OK;
-        }
+        return false;
     }
 
-    /* Check child rules. */
-    for (
-        ib_rule_t *child = rule->chained_rule;
-        child != NULL;
-        child = child->chained_rule
-    )
+    capabilities = ib_operator_inst_capabilities(rule->opinst->opinst);
+    if (! ib_flags_all(capabilities, IB_OP_CAPABILITY_THREAD_SAFE)) {
+        return false;
+    }
+
+    if (ib_list_elements(rule->target_fields) != 1) {
+        return false;
+    }
+    target = ib_list_node_data_const(ib_list_first_const(rule->target_fields));
+    if ( (target->target == NULL) ||
+         ( (target->tfn_list != NULL) &&
+           (ib_list_elements(target->tfn_list) != 0) ) )
     {
-        if ( (strncasecmp(id, rule->meta.id, id_len) == 0) ||
-             (strncasecmp(id, rule->meta.full_id, id_len) == 0) )
-        {
-            return IB_OK;
-        }
+        return false;
     }
 
-    /* Finally, no match */
-    return IB_DECLINED;
+    return true;
 }
 
-static ib_status_t rule_enable_by_tag_prefix(
-    const ib_rule_t *rule,
-    void            *cbdata
-)
+/**
+ * Set up parallel rule execution for a context.
+ *
+ * Does nothing unless the context has RuleEngineParallelThreads set.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in,out] ctx IronBee context
+ *
+ * @returns Status code
+ */
+static ib_status_t rule_parallel_init(ib_engine_t *ib,
+                                      ib_context_t *ctx)
 {
-    assert(rule != NULL);
-    assert(cbdata != NULL);
-
-    const char *tag = (const char *)cbdata;
-    size_t      tag_len = strlen(tag);
+    assert(ib != NULL);
+    assert(ctx != NULL);
+    assert(ctx->rules != NULL);
 
-    const ib_list_node_t *node;
+    ib_core_cfg_t       *corecfg;
+    ib_rule_phase_num_t  phase_num;
+    ib_status_t          rc;
 
-    /* First match the rule's tags */
-    IB_LIST_LOOP_CONST(rule->meta.tags, node) {
-        const char *ruletag = (const char *)ib_list_node_data_const(node);
-        if (strncasecmp(tag, ruletag, tag_len) == 0) {
-            return IB_OK;
-        }
+    rc = ib_core_context_config(ctx, &corecfg);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    if (corecfg->rule_parallel_threads <= 0) {
+        return IB_OK;
     }
 
-    /* Check parent rules. */
-    for (
-        ib_rule_t *parent = rule->chained_from;
-        parent != NULL;
-        parent = parent->chained_from
-    )
+    for (phase_num = IB_PHASE_NONE;
+         phase_num < IB_RULE_PHASE_COUNT;
+         ++phase_num)
     {
-        IB_LIST_LOOP_CONST(parent->meta.tags, node) {
-            const char *ruletag = (const char *)ib_list_node_data_const(node);
-            if (strncasecmp(tag, ruletag, tag_len) == 0) {
-                return IB_OK;
+        ib_ruleset_phase_t *ruleset_phase =
+            &(ctx->rules->ruleset.phases[phase_num]);
+        ib_rule_parallel_t *parallel;
+        size_t              count = 0;
+        size_t              i;
+
+        if ( (ruleset_phase->phase_meta == NULL) ||
+             ruleset_phase->phase_meta->is_stream ||
+             (ruleset_phase->rule_count < 2) )
+        {
+            continue;
+        }
+
+        for (i = 0; i < ruleset_phase->rule_count; ++i) {
+            if (rule_is_parallel(ruleset_phase->rule_array[i])) {
+                ++count;
             }
         }
-    }
+        if (count < 2) {
+            continue;
+        }
 
-    /* Check child rules. */
-    for (
-        ib_rule_t *child = rule->chained_rule;
-        child != NULL;
-        child = child->chained_rule
-    )
-    {
-        IB_LIST_LOOP_CONST(child->meta.tags, node) {
-            const char *ruletag = (const char *)ib_list_node_data_const(node);
-            if (strncasecmp(tag, ruletag, tag_len) == 0) {
-                return IB_OK;
+        parallel = ib_mm_alloc(ctx->mm, sizeof(*parallel));
+        if (parallel == NULL) {
+            return IB_EALLOC;
+        }
+        parallel->rules = ib_mm_alloc(ctx->mm,
+                                      count * sizeof(*(parallel->rules)));
+        if (parallel->rules == NULL) {
+            return IB_EALLOC;
+        }
+        parallel->count = 0;
+        for (i = 0; i < ruleset_phase->rule_count; ++i) {
+            if (rule_is_parallel(ruleset_phase->rule_array[i])) {
+                parallel->rules[parallel->count] =
+                    ruleset_phase->rule_array[i];
+                ++parallel->count;
             }
         }
+        parallel->threads = (size_t)corecfg->rule_parallel_threads;
+        parallel->min_size = (size_t)corecfg->rule_parallel_min_size;
+
+        ruleset_phase->parallel = parallel;
     }
 
-    /* Finally, no match */
-    return IB_DECLINED;
+    return IB_OK;
 }
 
+/**
+ * Re-acquire a var source if it has been registered since it was acquired.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in,out] source Source to resolve.
+ */
+static void resolve_var_source(
+    ib_engine_t      *ib,
+    ib_var_source_t **source
+)
+{
+    assert(ib != NULL);
+    assert(source != NULL);
+
+    const char      *name;
+    size_t           name_length;
+    ib_var_source_t *indexed;
 
+    if (*source == NULL || ib_var_source_is_indexed(*source)) {
+        return;
+    }
 
-/* End Rule enable functions. */
+    ib_var_source_name(*source, &name, &name_length);
+    if (ib_var_source_acquire(&indexed, IB_MM_NULL,
+                              ib_engine_var_config_get_const(ib),
+                              name, name_length) == IB_OK)
+    {
+        *source = indexed;
+    }
+}
 
 /**
- * Enable rules that match tag / id
+ * Resolve the var sources of a rule and of the rules chained to it.
+ *
+ * Targets and capture collections are acquired when the rule is parsed.  A
+ * var that is registered later, e.g., by a module loaded after the rule,
+ * is then only known by name to the rule: it would be looked up by name on
+ * every execution and would not see values stored under its index.  Such
+ * targets are acquired again, once per rule, when the first location context
+ * using the rule is closed, and keep the index from then on.
  *
  * @param[in] ib IronBee engine
- * @param[in] ctx Current IronBee context
- * @param[in] match Enable match data
- * @param[in,out] ctx_rule_list List of rules to search for matches to @a enable
+ * @param[in,out] rule Rule to resolve.
  *
- * @returns Status code
+ * @returns
+ * - IB_OK On success.
+ * - Other on failure to acquire a target.
  */
-static ib_status_t enable_rules(
-    ib_engine_t            *ib,
-    ib_context_t           *ctx,
-    const ib_rule_enable_t *match,
-    ib_list_t              *ctx_rule_list
+static ib_status_t resolve_rule_targets(
+    ib_engine_t *ib,
+    ib_rule_t   *rule
 )
 {
     assert(ib != NULL);
-    assert(ctx != NULL);
-    assert(match != NULL);
-    assert(ctx_rule_list != NULL);
+    assert(rule != NULL);
 
-    ib_list_node_t *node;
-    unsigned int    matches = 0;
-    const char     *lcname = match->enable ? "enable" : "disable";
+    for (; rule != NULL; rule = rule->chained_rule) {
+        ib_list_node_t *node;
 
-    IB_LIST_LOOP(ctx_rule_list, node) {
-        ib_rule_ctx_data_t *ctx_rule;
-        ctx_rule = (ib_rule_ctx_data_t *)ib_list_node_data(node);
-        ib_status_t rc;
-        rc = match->rule_enable_fn(ctx_rule->rule, match->rule_enable_cbdata);
+        if (ib_flags_all(rule->flags, IB_RULE_FLAG_RESOLVED)) {
+            continue;
+        }
+
+        IB_LIST_LOOP(rule->target_fields, node) {
+            ib_rule_target_t *target =
+                (ib_rule_target_t *)ib_list_node_data(node);
+            ib_var_target_t  *resolved;
+            ib_status_t       rc;
+
+            if ( (target->target == NULL) ||
+                 ib_var_source_is_indexed(
+                     ib_var_target_source(target->target)) )
+            {
+                continue;
+            }
 
-        if (rc == IB_OK) {
-            matches++;
-            set_rule_enable(match->enable, ctx_rule);
+            rc = ib_var_target_acquire_from_string(
+                &resolved,
+                ib_rule_mm(ib),
+                ib_engine_var_config_get_const(ib),
+                IB_S2SL(target->target_str)
+            );
+            if (rc != IB_OK) {
+                ib_log_error(ib, "Error resolving target \"%s\": %s",
+                             target->target_str, ib_status_to_string(rc));
+                return rc;
+            }
+            if (ib_var_source_is_indexed(ib_var_target_source(resolved))) {
+                target->target = resolved;
+            }
         }
-    }
-
-    if (match->require_match && matches == 0) {
+        resolve_var_source(ib, &rule->capture_source);
 
-        ib_cfg_log_notice_ex(
-            ib,
-            match->file,
-            match->lineno,
-            "Failed to %s any rules with %s.",
-            lcname,
-            match->name
-        );
-        return IB_ENOENT;
-    }
-    else {
-        ib_cfg_log_debug_ex(
-            ib,
-            match->file,
-            match->lineno,
-            "Enabled %u rules by %s.",
-            matches,
-            match->name
-        );
+        ib_flags_set(rule->flags, IB_RULE_FLAG_RESOLVED);
     }
 
     return IB_OK;
 }
 
-bool ib_rule_is_chained(const ib_rule_t *rule) {
-    return ib_flags_any(rule->flags, IB_RULE_FLAG_CHCHILD);
-}
-
-bool ib_rule_is_marked(const ib_rule_t *rule) {
-    return ib_flags_any(rule->flags, IB_RULE_FLAG_MARK);
-}
-
 /**
- * Close a context for the rule engine.
+ * Build the rule set of a location context.
  *
- * Called when a context is closed; performs rule engine rule fixups.
+ * Collects the rules of @a ctx and the first @a main_rules rules of the
+ * main context, applies the enable/disable directives of @a ctx and builds
+ * the per-phase rules of @a ctx.
  *
+ * Apart from resolving rule targets, nothing outside of @a ctx is modified,
+ * so that this may run after configuration is finished; see
+ * rule_engine_ctx_ready().
  *
- * @param[in,out] ib IronBee object
+ * @param[in] ib IronBee engine
  * @param[in,out] ctx IronBee context
- * @param[in] state State
- * @param[in] cbdata Callback data (unused)
+ * @param[in] main_rules Number of main context rules to consider.
+ *
+ * @returns Status code
  */
-static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
-                                         ib_context_t *ctx,
-                                         ib_state_t state,
-                                         void *cbdata)
+static ib_status_t rule_context_build(ib_engine_t *ib,
+                                      ib_context_t *ctx,
+                                      size_t main_rules)
 {
     assert(ib != NULL);
     assert(ctx != NULL);
-    assert(state == context_close_state);
-    assert(cbdata == NULL);
+    assert(ctx->ctype == IB_CTYPE_LOCATION);
 
     ib_list_t      *all_rules;
     ib_list_node_t *node;
     ib_context_t   *main_ctx = ib_context_main(ib);
+    uint64_t       *marked;
+    uint64_t       *present;
+    uint64_t       *enabled;
+    size_t          words;
+    size_t          seen = 0;
     ib_status_t     rc;
 
-    /* Don't enable rules for non-location contexts */
-    if (ctx->ctype != IB_CTYPE_LOCATION) {
-        return IB_OK;
-    }
-
     /* Create the list of all rules */
     rc = ib_list_create(&all_rules, ctx->mm);
     if (rc != IB_OK) {
@@ -3752,10 +6530,12 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
         return rc;
     }
 
-    /* Step 1: Unmark all rules in the context's rule list */
-    IB_LIST_LOOP(ctx->rules->rule_list, node) {
-        ib_rule_t    *rule = (ib_rule_t *)ib_list_node_data(node);
-        ib_flags_clear(rule->flags, IB_RULE_FLAG_MARK);
+    /* Step 1: Create the bitmap, indexed by rule index, of the context's
+     * rules already added by the main context. */
+    words = RULE_BITMAP_WORDS(ib->rule_engine->index_limit);
+    marked = ib_mm_calloc(ctx->mm, words, sizeof(*marked));
+    if (marked == NULL) {
+        return IB_EALLOC;
     }
 
     /* Step 2: Loop through all of the rules in the main context, add them
@@ -3765,6 +6545,11 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
         ib_rule_t          *rule = NULL;
         ib_rule_ctx_data_t *ctx_rule = NULL;
 
+        /* Ignore rules added to the main context after this one closed */
+        if (seen++ == main_rules) {
+            break;
+        }
+
         /* If it's a chained rule, skip it */
         if (ib_rule_is_chained(ref)) {
             continue;
@@ -3786,7 +6571,7 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
         ctx_rule->rule = rule;
         if (! ib_flags_all(rule->flags, IB_RULE_FLAG_MAIN_CTX)) {
             ctx_rule->flags = IB_RULECTX_FLAG_ENABLED;
-            ib_flags_set(rule->flags, IB_RULE_FLAG_MARK);
+            RULE_BITMAP_SET(marked, rule->meta.index);
         }
         else {
             ctx_rule->flags = IB_RULECTX_FLAG_NONE;
@@ -3804,7 +6589,9 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
         ib_rule_ctx_data_t *ctx_rule;
 
         /* If the rule is chained or marked */
-        if (ib_rule_is_chained(rule) || ib_rule_is_marked(rule)) {
+        if ( ib_rule_is_chained(rule) ||
+             RULE_BITMAP_ISSET(marked, rule->meta.index) )
+        {
             continue;
         }
 
@@ -3821,12 +6608,30 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
         }
     }
 
-    /* Step 4: Enable / Disable rules. */
+    /* Step 4: Enable / Disable rules, using bitmaps indexed by rule index
+     * for the rules of the context and for their enable state. */
+    present = ib_mm_calloc(ctx->mm, words, sizeof(*present));
+    enabled = ib_mm_calloc(ctx->mm, words, sizeof(*enabled));
+    if (present == NULL || enabled == NULL) {
+        return IB_EALLOC;
+    }
+    IB_LIST_LOOP(all_rules, node) {
+        const ib_rule_ctx_data_t *ctx_rule =
+            (const ib_rule_ctx_data_t *)ib_list_node_data(node);
+
+        RULE_BITMAP_SET(present, ctx_rule->rule->meta.index);
+        if (ib_flags_all(ctx_rule->flags, IB_RULECTX_FLAG_ENABLED)) {
+            RULE_BITMAP_SET(enabled, ctx_rule->rule->meta.index);
+        }
+    }
     IB_LIST_LOOP(ctx->rules->enable_list, node) {
-        const ib_rule_enable_t *enable;
-        enable = (const ib_rule_enable_t *)ib_list_node_data(node);
+        ib_rule_enable_t *enable;
+        enable = (ib_rule_enable_t *)ib_list_node_data(node);
 
-        rc = enable_rules(ib, ctx, enable, all_rules);
+        rc = enable_rules(ib, ctx, enable, present, enabled, words, all_rules);
+        if (rc == IB_EALLOC) {
+            return rc;
+        }
         if (rc != IB_OK) {
             ib_cfg_log_notice_ex(ib, enable->file, enable->lineno,
                                  "Error apply rule enable/disable "
@@ -3834,6 +6639,17 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
                                  ib_context_full_get(ctx));
         }
     }
+    IB_LIST_LOOP(all_rules, node) {
+        ib_rule_ctx_data_t *ctx_rule =
+            (ib_rule_ctx_data_t *)ib_list_node_data(node);
+
+        if (RULE_BITMAP_ISSET(enabled, ctx_rule->rule->meta.index)) {
+            ib_flags_set(ctx_rule->flags, IB_RULECTX_FLAG_ENABLED);
+        }
+        else {
+            ib_flags_clear(ctx_rule->flags, IB_RULECTX_FLAG_ENABLED);
+        }
+    }
 
     /* Step 5: Add all enabled rules to the appropriate execution list */
     IB_LIST_LOOP(all_rules, node) {
@@ -3855,6 +6671,11 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
             continue;
         }
 
+        rc = resolve_rule_targets(ib, rule);
+        if (rc != IB_OK) {
+            return rc;
+        }
+
         phase_num = rule->meta.phase;
 
         /* Give the ownership functions a shot at the rule */
@@ -3944,7 +6765,163 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
                      ib_context_full_get(ctx));
     }
 
-    /* Initialize var sources */
+    /* Step 6: Build the per-phase arrays of rules to execute */
+    rc = build_phase_rule_arrays(ib, ctx);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error building phase rule arrays for context \"%s\": %s",
+                     ib_context_full_get(ctx),
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    /* Step 7: Set up adaptive rule ordering */
+    rc = rule_order_init(ib, ctx);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error setting up rule ordering for context \"%s\": %s",
+                     ib_context_full_get(ctx),
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    /* Step 8: Set up rule profiling */
+    rc = rule_profile_init(ib, ctx);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error setting up rule profiling for context \"%s\": %s",
+                     ib_context_full_get(ctx),
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    /* Step 9: Set up parallel rule execution */
+    rc = rule_parallel_init(ib, ctx);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error setting up parallel rule execution "
+                     "for context \"%s\": %s",
+                     ib_context_full_get(ctx),
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    /* Step 10: Set up A/B comparison of rule execution */
+    rc = rule_compare_init(ib, ctx);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error setting up rule comparison for context \"%s\": %s",
+                     ib_context_full_get(ctx),
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Make sure the rule set of a context is built.
+ *
+ * Builds the rule set of a context whose build was deferred by
+ * RuleEngineLazyContexts.  The first transaction to use the context builds
+ * it; concurrent ones wait for the build.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in,out] ctx IronBee context
+ *
+ * @returns
+ * - IB_OK if the rule set of @a ctx is ready.
+ * - Other if building it failed.
+ */
+static ib_status_t rule_engine_ctx_ready(ib_engine_t *ib,
+                                         ib_context_t *ctx)
+{
+    assert(ib != NULL);
+    assert(ctx != NULL);
+    assert(ctx->rules != NULL);
+
+    ib_rule_context_t *ctx_rules = ctx->rules;
+    ib_status_t        rc;
+
+    if (! __atomic_load_n(&(ctx_rules->lazy), __ATOMIC_ACQUIRE)) {
+        return ctx_rules->lazy_status;
+    }
+
+    rc = ib_lock_lock(ib->rule_engine->lazy_lock);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    if (ctx_rules->lazy) {
+        rc = rule_context_build(ib, ctx, ctx_rules->lazy_main_rules);
+        if (rc != IB_OK) {
+            ib_log_error(ib,
+                         "Error building rules of context \"%s\"; "
+                         "running none: %s",
+                         ib_context_full_get(ctx),
+                         ib_status_to_string(rc));
+        }
+        else {
+            ib_rule_log_flags_dump(ib, ctx);
+        }
+        ctx_rules->lazy_status = rc;
+        __atomic_store_n(&(ctx_rules->lazy), false, __ATOMIC_RELEASE);
+    }
+    ib_lock_unlock(ib->rule_engine->lazy_lock);
+
+    return ctx_rules->lazy_status;
+}
+
+/**
+ * Prepare the rule engine for deferred context rule set builds.
+ *
+ * Called when the main context is closed, after all other contexts.  Does
+ * the engine-wide work of rule_context_build() for all rules up front, so
+ * that deferred builds only modify their own context: rule targets are
+ * resolved and the ordering statistics and rule profiles are sized.
+ *
+ * @param[in] ib IronBee engine
+ *
+ * @returns Status code
+ */
+static ib_status_t rule_engine_lazy_prepare(ib_engine_t *ib)
+{
+    assert(ib != NULL);
+
+    ib_rule_engine_t *rule_engine = ib->rule_engine;
+    ib_list_node_t   *node;
+    ib_status_t       rc;
+
+    if (! rule_engine->lazy_contexts) {
+        return IB_OK;
+    }
+
+    /* Failures are reported again by the build of any context using the
+     * rule. */
+    IB_LIST_LOOP(rule_engine->rule_list, node) {
+        resolve_rule_targets(ib, (ib_rule_t *)ib_list_node_data(node));
+    }
+
+    rc = rule_order_stats_size(ib);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    return rule_profile_size(ib);
+}
+
+/**
+ * Initialize the var sources of the rule engine.
+ *
+ * @param[in] ib IronBee engine
+ *
+ * @returns Status code
+ */
+static ib_status_t rule_engine_sources_init(ib_engine_t *ib)
+{
+    assert(ib != NULL);
+
+    ib_status_t rc;
+
     {
         ib_rule_engine_t *re = ib->rule_engine;
         const ib_var_config_t *config =  ib_engine_var_config_get(ib);
@@ -3977,6 +6954,74 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
 #undef RE_SOURCE
     }
 
+    return IB_OK;
+}
+
+/**
+ * Close a context for the rule engine.
+ *
+ * Called when a context is closed; performs rule engine rule fixups.
+ *
+ *
+ * @param[in,out] ib IronBee object
+ * @param[in,out] ctx IronBee context
+ * @param[in] state State
+ * @param[in] cbdata Callback data (unused)
+ */
+static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
+                                         ib_context_t *ctx,
+                                         ib_state_t state,
+                                         void *cbdata)
+{
+    assert(ib != NULL);
+    assert(ctx != NULL);
+    assert(state == context_close_state);
+    assert(cbdata == NULL);
+
+    ib_rule_engine_t *rule_engine = ib->rule_engine;
+    ib_core_cfg_t    *corecfg;
+    size_t            main_rules;
+    ib_status_t       rc;
+
+    /* The main context closes last */
+    if (ctx->ctype == IB_CTYPE_MAIN) {
+        return rule_engine_lazy_prepare(ib);
+    }
+
+    /* Don't enable rules for other non-location contexts */
+    if (ctx->ctype != IB_CTYPE_LOCATION) {
+        return IB_OK;
+    }
+
+    rc = rule_engine_sources_init(ib);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_core_context_config(ctx, &corecfg);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    main_rules = ib_list_elements(ib_context_main(ib)->rules->rule_list);
+
+    /* Defer building the rule set to its first use, unless ownership
+     * callbacks need to see the rules of the context now. */
+    if ( (corecfg->rule_lazy_contexts != 0) &&
+         (ib_list_elements(rule_engine->ownership_cbs) == 0) )
+    {
+        ctx->rules->lazy_main_rules = main_rules;
+        ctx->rules->lazy = true;
+        rule_engine->lazy_contexts = true;
+        ib_log_debug(ib, "Deferring rules of context \"%s\" to first use.",
+                     ib_context_full_get(ctx));
+        return IB_OK;
+    }
+
+    rc = rule_context_build(ib, ctx, main_rules);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
     ib_rule_log_flags_dump(ib, ctx);
 
     return IB_OK;
@@ -4099,26 +7144,51 @@ static ib_status_t rule_engine_tx_started(ib_engine_t *ib,
                                           void *cbdata)
 {
     assert(ib != NULL);
-    assert(tx != NULL);
-    assert(state == tx_started_state);
-    assert(cbdata == NULL);
-
-    ib_status_t rc;
-    ib_rule_exec_t *rule_exec;
+    assert(tx != NULL);
+    assert(state == tx_started_state);
+    assert(cbdata == NULL);
+
+    ib_status_t rc;
+    ib_rule_exec_t *rule_exec;
+
+    /* Don't allow the user to create a second rule exec object */
+    if (tx->rule_exec != NULL) {
+        return IB_EINVAL;
+    }
+    /* Create the rule engine execution environment object */
+    rc = ib_rule_exec_create(tx, &rule_exec);
+    if (rc != IB_OK) {
+        ib_rule_log_tx_error(tx,
+                             "Failed to create rule execution object: %s",
+                             ib_status_to_string(rc));
+        return rc;
+    }
+    tx->rule_exec = rule_exec;
+
+    return IB_OK;
+}
+
+/**
+ * Log the rule profile report when the engine shuts down.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in] state State
+ * @param[in] cbdata Callback data (unused)
+ *
+ * @returns IB_OK
+ */
+static ib_status_t rule_engine_shutdown(ib_engine_t *ib,
+                                        ib_state_t state,
+                                        void *cbdata)
+{
+    assert(ib != NULL);
 
-    /* Don't allow the user to create a second rule exec object */
-    if (tx->rule_exec != NULL) {
-        return IB_EINVAL;
+    if (ib->rule_engine->profiles != NULL) {
+        ib_rule_profile_report(ib, RULE_PROFILE_REPORT_LIMIT);
     }
-    /* Create the rule engine execution environment object */
-    rc = ib_rule_exec_create(tx, &rule_exec);
-    if (rc != IB_OK) {
-        ib_rule_log_tx_error(tx,
-                             "Failed to create rule execution object: %s",
-                             ib_status_to_string(rc));
-        return rc;
+    if (ib->rule_engine->compare_profiles != NULL) {
+        ib_rule_compare_report(ib, RULE_PROFILE_REPORT_LIMIT);
     }
-    tx->rule_exec = rule_exec;
 
     return IB_OK;
 }
@@ -4156,6 +7226,13 @@ ib_status_t ib_rule_engine_init(ib_engine_t *ib)
         return rc;
     }
 
+    /* Report rule profiles at shutdown */
+    rc = ib_hook_null_register(ib, engine_shutdown_initiated_state,
+                               rule_engine_shutdown, NULL);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
     /* Register the context open callback -- it'll register the
      * context close handler at the open of the main context. */
     rc = ib_hook_context_register(ib, context_open_state,
@@ -4172,6 +7249,358 @@ ib_mm_t ib_rule_mm(ib_engine_t *ib)
     return ib_engine_mm_config_get(ib);
 }
 
+ib_status_t ib_rule_profile_get(
+    const ib_engine_t        *ib,
+    const ib_rule_t          *rule,
+    const ib_rule_profile_t **profile)
+{
+    assert(ib != NULL);
+    assert(rule != NULL);
+    assert(profile != NULL);
+
+    const ib_rule_engine_t *rule_engine = ib->rule_engine;
+
+    if ( (rule->meta.index >= rule_engine->profiles_size) ||
+         (rule_engine->profiles[rule->meta.index].evaluations == 0) )
+    {
+        return IB_ENOENT;
+    }
+
+    *profile = &(rule_engine->profiles[rule->meta.index]);
+    return IB_OK;
+}
+
+ib_status_t ib_rule_profile_set(
+    ib_engine_t *ib,
+    bool         enabled)
+{
+    assert(ib != NULL);
+
+    ib_status_t rc;
+
+    if (enabled) {
+        rc = rule_profile_size(ib);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+    __atomic_store_n(&(ib->rule_engine->profile_all), enabled,
+                     __ATOMIC_RELAXED);
+
+    return IB_OK;
+}
+
+bool ib_rule_profile_enabled(
+    const ib_engine_t *ib)
+{
+    assert(ib != NULL);
+
+    return __atomic_load_n(&(ib->rule_engine->profile_all),
+                           __ATOMIC_RELAXED);
+}
+
+void ib_rule_profile_reset(
+    ib_engine_t *ib)
+{
+    assert(ib != NULL);
+
+    ib_rule_engine_t *rule_engine = ib->rule_engine;
+
+    if (rule_engine->profiles != NULL) {
+        memset(rule_engine->profiles, 0,
+               rule_engine->profiles_size * sizeof(*rule_engine->profiles));
+    }
+}
+
+/**
+ * Compare two rule profiles by decreasing total time.
+ *
+ * @param[in] a First profile (const ib_rule_profile_t **)
+ * @param[in] b Second profile (const ib_rule_profile_t **)
+ *
+ * @returns qsort() style comparison
+ */
+static int rule_profile_compare(const void *a, const void *b)
+{
+    const ib_rule_profile_t *profile_a = *(const ib_rule_profile_t **)a;
+    const ib_rule_profile_t *profile_b = *(const ib_rule_profile_t **)b;
+
+    if (profile_a->time > profile_b->time) {
+        return -1;
+    }
+    if (profile_a->time < profile_b->time) {
+        return 1;
+    }
+    return 0;
+}
+
+ib_status_t ib_rule_profile_hot(
+    const ib_engine_t  *ib,
+    ib_mm_t             mm,
+    size_t              limit,
+    ib_list_t         **profiles)
+{
+    assert(ib != NULL);
+    assert(profiles != NULL);
+
+    const ib_rule_engine_t   *rule_engine = ib->rule_engine;
+    const ib_rule_profile_t **sorted;
+    size_t                    count = 0;
+    size_t                    i;
+    ib_list_t                *list;
+    ib_status_t               rc;
+
+    rc = ib_list_create(&list, mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    *profiles = list;
+
+    if (rule_engine->profiles_size == 0) {
+        return IB_OK;
+    }
+
+    sorted = ib_mm_alloc(mm, rule_engine->profiles_size * sizeof(*sorted));
+    if (sorted == NULL) {
+        return IB_EALLOC;
+    }
+    for (i = 0; i < rule_engine->profiles_size; ++i) {
+        if (rule_engine->profiles[i].evaluations != 0) {
+            sorted[count] = &(rule_engine->profiles[i]);
+            ++count;
+        }
+    }
+    qsort(sorted, count, sizeof(*sorted), rule_profile_compare);
+
+    if ( (limit != 0) && (count > limit) ) {
+        count = limit;
+    }
+    for (i = 0; i < count; ++i) {
+        rc = ib_list_push(list, (void *)sorted[i]);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    return IB_OK;
+}
+
+uint64_t ib_rule_profile_quantile(
+    const ib_rule_profile_t *profile,
+    double                   quantile)
+{
+    assert(profile != NULL);
+
+    uint64_t target;
+    uint64_t seen = 0;
+    size_t   bucket;
+
+    if (profile->evaluations == 0) {
+        return 0;
+    }
+
+    target = (uint64_t)(quantile * (double)profile->evaluations);
+    if (target >= profile->evaluations) {
+        target = profile->evaluations - 1;
+    }
+
+    for (bucket = 0; bucket < IB_RULE_PROFILE_BUCKETS - 1; ++bucket) {
+        seen += profile->histogram[bucket];
+        if (seen > target) {
+            return (uint64_t)1 << bucket;
+        }
+    }
+
+    return profile->max_time;
+}
+
+void ib_rule_profile_report(
+    ib_engine_t *ib,
+    size_t       limit)
+{
+    assert(ib != NULL);
+
+    ib_mpool_lite_t      *mp;
+    ib_list_t            *profiles;
+    const ib_list_node_t *node;
+    ib_status_t           rc;
+
+    rc = ib_mpool_lite_create(&mp);
+    if (rc != IB_OK) {
+        return;
+    }
+
+    rc = ib_rule_profile_hot(ib, ib_mm_mpool_lite(mp), limit, &profiles);
+    if (rc != IB_OK) {
+        ib_log_error(ib, "Error building rule profile report: %s",
+                     ib_status_to_string(rc));
+        ib_mpool_lite_destroy(mp);
+        return;
+    }
+
+    if (ib_list_elements(profiles) > 0) {
+        ib_log_info(ib, "Rule profile: %zd rules by total time",
+                    ib_list_elements(profiles));
+    }
+    IB_LIST_LOOP_CONST(profiles, node) {
+        const ib_rule_profile_t *profile =
+            (const ib_rule_profile_t *)ib_list_node_data_const(node);
+
+        ib_log_info(ib,
+                    "Rule profile: rule=\"%s\" evaluations=%" PRIu64
+                    " matches=%" PRIu64 " total=%" PRIu64 "us"
+                    " mean=%" PRIu64 "us p50<=%" PRIu64 "us"
+                    " p99<=%" PRIu64 "us max=%" PRIu64 "us",
+                    ib_rule_id(profile->rule),
+                    profile->evaluations,
+                    profile->matches,
+                    profile->time,
+                    profile->time / profile->evaluations,
+                    ib_rule_profile_quantile(profile, 0.50),
+                    ib_rule_profile_quantile(profile, 0.99),
+                    profile->max_time);
+    }
+
+    ib_mpool_lite_destroy(mp);
+}
+
+ib_status_t ib_rule_compare_get(
+    const ib_engine_t        *ib,
+    const ib_rule_t          *rule,
+    const ib_rule_profile_t **profile_a,
+    const ib_rule_profile_t **profile_b)
+{
+    assert(ib != NULL);
+    assert(rule != NULL);
+    assert(profile_a != NULL);
+    assert(profile_b != NULL);
+
+    const ib_rule_engine_t  *rule_engine = ib->rule_engine;
+    const ib_rule_profile_t *pair;
+
+    if (rule->meta.index >= rule_engine->compare_profiles_size) {
+        return IB_ENOENT;
+    }
+    pair = &(rule_engine->compare_profiles[2 * rule->meta.index]);
+    if ( (pair[0].evaluations == 0) && (pair[1].evaluations == 0) ) {
+        return IB_ENOENT;
+    }
+
+    *profile_a = &(pair[0]);
+    *profile_b = &(pair[1]);
+    return IB_OK;
+}
+
+/**
+ * Compare two pairs of RuleEngineCompare profiles by decreasing total time
+ * of both arms.
+ *
+ * @param[in] a First pair (const ib_rule_profile_t **)
+ * @param[in] b Second pair (const ib_rule_profile_t **)
+ *
+ * @returns qsort() style comparison
+ */
+static int rule_compare_pair_compare(const void *a, const void *b)
+{
+    const ib_rule_profile_t *pair_a = *(const ib_rule_profile_t **)a;
+    const ib_rule_profile_t *pair_b = *(const ib_rule_profile_t **)b;
+    uint64_t                 time_a = pair_a[0].time + pair_a[1].time;
+    uint64_t                 time_b = pair_b[0].time + pair_b[1].time;
+
+    if (time_a > time_b) {
+        return -1;
+    }
+    if (time_a < time_b) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Mean execution time of a rule profile.
+ *
+ * @param[in] profile Rule profile
+ *
+ * @returns Mean time (microseconds), 0 if never executed.
+ */
+static double rule_profile_mean(const ib_rule_profile_t *profile)
+{
+    assert(profile != NULL);
+
+    if (profile->evaluations == 0) {
+        return 0.0;
+    }
+    return (double)profile->time / (double)profile->evaluations;
+}
+
+void ib_rule_compare_report(
+    ib_engine_t *ib,
+    size_t       limit)
+{
+    assert(ib != NULL);
+
+    const ib_rule_engine_t   *rule_engine = ib->rule_engine;
+    const ib_rule_profile_t **sorted;
+    size_t                    count = 0;
+    size_t                    i;
+
+    if (rule_engine->compare_profiles_size == 0) {
+        return;
+    }
+
+    sorted = malloc(rule_engine->compare_profiles_size * sizeof(*sorted));
+    if (sorted == NULL) {
+        ib_log_error(ib, "Error building rule comparison report: %s",
+                     ib_status_to_string(IB_EALLOC));
+        return;
+    }
+    for (i = 0; i < rule_engine->compare_profiles_size; ++i) {
+        const ib_rule_profile_t *pair = &(rule_engine->compare_profiles[2 * i]);
+
+        if ( (pair[0].evaluations != 0) || (pair[1].evaluations != 0) ) {
+            sorted[count] = pair;
+            ++count;
+        }
+    }
+    qsort(sorted, count, sizeof(*sorted), rule_compare_pair_compare);
+
+    if ( (limit != 0) && (count > limit) ) {
+        count = limit;
+    }
+    if (count > 0) {
+        ib_log_info(ib, "Rule comparison: %zd rules by total time; "
+                    "A as configured, B in configuration order without "
+                    "parallel execution", count);
+    }
+    for (i = 0; i < count; ++i) {
+        const ib_rule_profile_t *a = &(sorted[i][0]);
+        const ib_rule_profile_t *b = &(sorted[i][1]);
+        double                   mean_a = rule_profile_mean(a);
+        double                   mean_b = rule_profile_mean(b);
+        char                     change[32] = "n/a";
+
+        if ( (a->evaluations > 0) && (b->evaluations > 0) && (mean_a > 0) ) {
+            snprintf(change, sizeof(change), "%+.1f%%",
+                     100.0 * (mean_b - mean_a) / mean_a);
+        }
+
+        ib_log_info(ib,
+                    "Rule comparison: rule=\"%s\""
+                    " a_evaluations=%" PRIu64 " a_mean=%.2fus"
+                    " a_p99<=%" PRIu64 "us"
+                    " b_evaluations=%" PRIu64 " b_mean=%.2fus"
+                    " b_p99<=%" PRIu64 "us b_change=%s",
+                    ib_rule_id((a->rule != NULL) ? a->rule : b->rule),
+                    a->evaluations, mean_a,
+                    ib_rule_profile_quantile(a, 0.99),
+                    b->evaluations, mean_b,
+                    ib_rule_profile_quantile(b, 0.99),
+                    change);
+    }
+
+    free(sorted);
+}
+
 
 /**
  * Calculate a rule's position in a chain.
@@ -4293,7 +7722,7 @@ ib_status_t ib_rule_create(
     rule->phase_meta       = phase_meta;
     rule->meta.phase       = IB_PHASE_NONE;
     rule->meta.revision    = 1;
-    rule->meta.config_file = ib_mm_strdup(mm, file);
+    rule->meta.config_file = ib_engine_intern(ib, file);
     rule->meta.config_line = lineno;
     rule->meta.index       = ib->rule_engine->index_limit;
     rule->ctx              = ctx;
@@ -4370,6 +7799,14 @@ ib_status_t ib_rule_create(
         rule_set_as_child(rule, previous);
     }
 
+    /* The rule will be added to the context's own rule list. */
+    rc = unshare_rules(ctx, context_rules);
+    if (rc != IB_OK) {
+        ib_log_error(ib, "Error copying shared rule list: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
     /* Good */
     rule->parent_rlist = ctx->rules->rule_list;
     *prule = rule;
@@ -4600,6 +8037,104 @@ static ib_status_t gen_full_id(ib_engine_t *ib,
     return IB_OK;
 }
 
+/**
+ * Assign transformation chain ids to all of a rule's targets.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in,out] rule Rule whose targets to update
+ *
+ * @returns Status code
+ */
+static ib_status_t assign_tfn_chain_ids(ib_engine_t *ib,
+                                        ib_rule_t *rule)
+{
+    assert(ib != NULL);
+    assert(rule != NULL);
+
+    ib_rule_engine_t *re = ib->rule_engine;
+    ib_mm_t           mm = ib_rule_mm(ib);
+    ib_list_node_t   *node;
+
+    IB_LIST_LOOP(rule->target_fields, node) {
+        ib_rule_target_t     *target =
+            (ib_rule_target_t *)ib_list_node_data(node);
+        const ib_list_node_t *tfn_node;
+        const size_t         *chain_id;
+        char                 *chain;
+        size_t                chain_len = 0;
+        size_t                chain_used;
+        ib_status_t           rc;
+
+        if (ib_list_elements(target->tfn_list) == 0) {
+            target->tfn_chain_id = 0;
+            continue;
+        }
+
+        /* Build the chain string from length-prefixed names and parameters
+         * so that no parameter can make two chains look alike.  A NULL
+         * parameter is written as "-". */
+        IB_LIST_LOOP_CONST(target->tfn_list, tfn_node) {
+            const ib_transformation_inst_t *tfn_inst =
+                (const ib_transformation_inst_t *)
+                    ib_list_node_data_const(tfn_node);
+            const char *param = ib_transformation_inst_parameters(tfn_inst);
+
+            /* Room for two lengths of up to 20 digits and separators. */
+            chain_len += 44 + strlen(ib_transformation_name(
+                ib_transformation_inst_transformation(tfn_inst)));
+            chain_len += (param == NULL) ? 0 : strlen(param);
+        }
+        chain = ib_mm_alloc(mm, chain_len + 1);
+        if (chain == NULL) {
+            return IB_EALLOC;
+        }
+        chain_used = 0;
+        IB_LIST_LOOP_CONST(target->tfn_list, tfn_node) {
+            const ib_transformation_inst_t *tfn_inst =
+                (const ib_transformation_inst_t *)
+                    ib_list_node_data_const(tfn_node);
+            const char *name = ib_transformation_name(
+                ib_transformation_inst_transformation(tfn_inst));
+            const char *param = ib_transformation_inst_parameters(tfn_inst);
+
+            chain_used += snprintf(chain + chain_used,
+                                   chain_len + 1 - chain_used,
+                                   "%zd:%s", strlen(name), name);
+            if (param == NULL) {
+                chain_used += snprintf(chain + chain_used,
+                                       chain_len + 1 - chain_used, "-");
+            }
+            else {
+                chain_used += snprintf(chain + chain_used,
+                                       chain_len + 1 - chain_used,
+                                       "%zd:%s", strlen(param), param);
+            }
+        }
+        assert(chain_used <= chain_len);
+
+        /* Look up or assign the chain's id. */
+        rc = ib_hash_get(re->tfn_chains, &chain_id, chain);
+        if (rc == IB_ENOENT) {
+            size_t *new_id = ib_mm_alloc(mm, sizeof(*new_id));
+            if (new_id == NULL) {
+                return IB_EALLOC;
+            }
+            *new_id = re->tfn_chain_limit++;
+            rc = ib_hash_set(re->tfn_chains, chain, new_id);
+            if (rc != IB_OK) {
+                return rc;
+            }
+            chain_id = new_id;
+        }
+        else if (rc != IB_OK) {
+            return rc;
+        }
+        target->tfn_chain_id = *chain_id;
+    }
+
+    return IB_OK;
+}
+
 ib_status_t ib_rule_register(ib_engine_t *ib,
                              ib_context_t *ctx,
                              ib_rule_t *rule)
@@ -4689,6 +8224,15 @@ ib_status_t ib_rule_register(ib_engine_t *ib,
         return rc;
     }
 
+    /* Identify the target transformation chains for result caching */
+    rc = assign_tfn_chain_ids(ib, rule);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error identifying transformation chains of rule \"%s\": %s",
+                     ib_rule_id(rule), ib_status_to_string(rc));
+        return rc;
+    }
+
     /* Get the rule engine and previous rule */
     context_rules = ctx->rules;
 
@@ -4754,6 +8298,18 @@ ib_status_t ib_rule_register(ib_engine_t *ib,
         return IB_EEXIST;
     }
 
+    /* The hash and list are about to be modified. */
+    rc = unshare_rules(ctx, context_rules);
+    if (rc != IB_OK) {
+        ib_cfg_log_error_ex(ib,
+                            rule->meta.config_file,
+                            rule->meta.config_line,
+                            "Error copying shared rules of context=\"%s\": %s",
+                            ib_context_full_get(ctx),
+                            ib_status_to_string(rc));
+        return rc;
+    }
+
     /* Remove the old version from the hash */
     if (lookup != NULL) {
         ib_hash_remove(context_rules->rule_hash, NULL, rule->meta.id);
@@ -4861,8 +8417,20 @@ ib_status_t ib_rule_enable(
     item->lineno = lineno;
     item->rule_enable_fn = enable_fn;
     item->rule_enable_cbdata = enable_data;
+    item->known = NULL;
+    item->matched = NULL;
+    item->words = 0;
 
     /* Add the item to the appropriate list */
+    rc = unshare_enables(ctx, ctx->rules);
+    if (rc != IB_OK) {
+        ib_cfg_log_error_ex(ib, file, lineno,
+                            "Error copying shared enable list "
+                            "of context=\"%s\": %s",
+                            ib_context_full_get(ctx),
+                            ib_status_to_string(rc));
+        return rc;
+    }
     rc = ib_list_push(ctx->rules->enable_list, item);
     if (rc != IB_OK) {
         ib_cfg_log_error_ex(ib, file, lineno,
@@ -5360,8 +8928,7 @@ ib_status_t ib_rule_create_target(ib_engine_t *ib,
             return IB_EOTHER;
         }
 
-        (*target)->target_str =
-            (char *)ib_mm_strdup(ib_rule_mm(ib), str);
+        (*target)->target_str = ib_engine_intern(ib, str);
         if ((*target)->target_str == NULL) {
             return IB_EALLOC;
         }
@@ -5647,6 +9214,9 @@ ib_status_t ib_rule_set_capture(
     ib_rule_t   *rule,
     const char  *capture_collection)
 {
+    ib_status_t  rc;
+    const char  *name;
+
     if ( (ib == NULL) || (rule == NULL) ) {
         return IB_EINVAL;
     }
@@ -5675,6 +9245,19 @@ ib_status_t ib_rule_set_capture(
         }
     }
 
+    /* Acquire the collection source now rather than on every execution. */
+    name = (rule->capture_collection != NULL) ?
+        rule->capture_collection : IB_TX_CAPTURE;
+    rc = ib_var_source_acquire(
+        &rule->capture_source,
+        ib_rule_mm(ib),
+        ib_engine_var_config_get(ib),
+        IB_S2SL(name)
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+
     return IB_OK;
 }
 
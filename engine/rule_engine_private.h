@@ -28,6 +28,7 @@
  */
 
 #include <ironbee/clock.h>
+#include <ironbee/lock.h>
 #include <ironbee/rule_engine.h>
 #include <ironbee/types.h>
 
@@ -40,14 +41,95 @@ typedef struct {
     ib_flags_t  flags; /**< Rule flags (IB_RULECTX_FLAG_xx) */
 } ib_rule_ctx_data_t;
 
+/**
+ * Phase program instruction opcodes.
+ */
+typedef enum {
+    IB_RULE_INSN_RULE,    /**< Execute a rule */
+    IB_RULE_INSN_CHAIN,   /**< Execute a chained rule if the previous matched */
+} ib_rule_opcode_t;
+
+/**
+ * Phase program instruction.
+ *
+ * A phase program is a flat array of instructions.  Each runnable rule of
+ * the phase is an IB_RULE_INSN_RULE instruction followed by one
+ * IB_RULE_INSN_CHAIN instruction for each rule chained to it, so that a
+ * chain is executed by walking forward instead of recursing.
+ */
+typedef struct {
+    ib_rule_opcode_t  opcode;       /**< Instruction opcode */
+    const ib_rule_t  *rule;         /**< Rule to execute */
+    size_t            chain_length; /**< Number of CHAIN instructions after
+                                     *   a RULE instruction; 0 for CHAIN */
+} ib_rule_insn_t;
+
+/**
+ * Adaptive ordering state for a single phase (defined in rule_engine.c).
+ */
+typedef struct ib_rule_order_t ib_rule_order_t;
+
+/**
+ * Adaptive ordering statistics of a single rule.
+ *
+ * These are updated by all transactions with relaxed atomic operations and
+ * decayed while reordering; they are heuristics only, so the fields need
+ * not be consistent with each other.
+ */
+typedef struct {
+    uint64_t time;     /**< Total execution time (microseconds) */
+    uint64_t evals;    /**< Number of executions */
+    uint64_t matches;  /**< Number of executions with a true result */
+} ib_rule_order_stats_t;
+
+/**
+ * Parallel rule execution state for a single phase.
+ *
+ * Rules of @a rules have a single untransformed target and a thread safe,
+ * non-capturing operator; their operators may be executed ahead of time on
+ * large values by worker threads.
+ */
+typedef struct {
+    const ib_rule_t **rules;    /**< Candidate rules */
+    size_t            count;    /**< Elements in rules */
+    size_t            threads;  /**< Worker threads to use */
+    size_t            min_size; /**< Minimum value length for workers */
+} ib_rule_parallel_t;
+
+/**
+ * Operator result computed ahead of time by parallel rule execution.
+ */
+typedef struct ib_rule_parallel_result_t ib_rule_parallel_result_t;
+struct ib_rule_parallel_result_t {
+    const ib_field_t *value;   /**< Value operated on; NULL if unused */
+    const uint8_t    *data;    /**< Data of @a value when executed */
+    size_t            length;  /**< Length of @a value when executed */
+    uint32_t          digest;  /**< Digest of @a data when executed */
+    ib_status_t       status;  /**< Operator status */
+    ib_num_t          result;  /**< Operator result */
+};
+
 /**
  * Ruleset for a single phase.
  *  rule_list is a list of pointers to ib_rule_ctx_data_t objects.
+ *  rule_array is built from rule_list when the context is closed and holds
+ *  only the runnable (enabled and valid) rules, in execution order.
+ *  program is compiled from rule_array for non-stream phases.
  */
 typedef struct {
     ib_rule_phase_num_t         phase_num;   /**< Phase number */
     const ib_rule_phase_meta_t *phase_meta;  /**< Rule phase meta-data */
     ib_list_t                  *rule_list;   /**< Rules to execute in phase */
+    const ib_rule_t           **rule_array;  /**< Runnable rules in phase */
+    size_t                      rule_count;  /**< Elements in rule_array */
+    const ib_rule_insn_t       *program;     /**< Compiled rule_array */
+    size_t                      program_length; /**< Elements in program */
+    const ib_rule_insn_t       *base_program; /**< Program in configuration
+                                               *   order */
+    ib_rule_order_t            *order;       /**< Adaptive ordering or NULL */
+    bool                        profile;     /**< Profile rule execution? */
+    bool                        compare;     /**< Compare A/B execution? */
+    ib_rule_parallel_t         *parallel;    /**< Parallel execution or NULL */
 } ib_ruleset_phase_t;
 
 /**
@@ -67,8 +149,28 @@ struct ib_rule_context_t {
     ib_hash_t             *rule_hash;    /**< Hash of rules (by rule-id) */
     ib_list_t             *enable_list;  /**< Enable All/IDs/tags */
     ib_rule_parser_data_t  parser_data;  /**< Rule parser specific data */
+    ib_flags_t             shared;       /**< Shared (copy-on-write) members
+                                          *   (IB_RULECTX_SHARED_xx) */
+
+    /**
+     * Is building the rule set deferred to its first use?
+     *
+     * Set when the context is closed with RuleEngineLazyContexts on, and
+     * cleared, with ib_rule_engine_t::lazy_lock held, once the rule set is
+     * built.  Read with acquire semantics.
+     */
+    bool                   lazy;
+    size_t                 lazy_main_rules; /**< Main context rules at close */
+    ib_status_t            lazy_status;  /**< Result of the deferred build */
 };
 
+/**
+ * Rule context members shared with a parent or child context.  Shared members
+ * are never modified; they are copied before the first modification.
+ */
+#define IB_RULECTX_SHARED_RULES   (1 << 0) /**< rule_list and rule_hash */
+#define IB_RULECTX_SHARED_ENABLES (1 << 1) /**< enable_list */
+
 /**
  * Rule target fields
  */
@@ -76,6 +178,14 @@ struct ib_rule_target_t {
     ib_var_target_t *target;
     const char      *target_str; /**< The target string */
     ib_list_t       *tfn_list;   /**< List of transformations */
+    /**
+     * Engine-wide identifier of the transformation chain in @a tfn_list.
+     *
+     * Targets with identical transformation chains (by name and parameter)
+     * share an identifier.  This is assigned when the rule is registered and
+     * is 0 if the chain is empty or was never assigned.
+     */
+    size_t           tfn_chain_id;
 };
 
 
@@ -88,6 +198,50 @@ struct ib_rule_engine_t {
     ib_hash_t *external_drivers; /**< Drivers for external rules. */
     ib_list_t *ownership_cbs;    /**< List of ownership callbacks. */
     size_t     index_limit;      /**< One more than highest rule index. */
+    ib_hash_t *tfn_chains;       /**< Transformation chain ids by chain. */
+    size_t     tfn_chain_limit;  /**< One more than highest chain id. */
+
+    /**
+     * Adaptive ordering statistics, indexed by rule index.
+     *
+     * Only allocated if some context uses adaptive rule ordering.
+     */
+    ib_rule_order_stats_t *order_stats;
+    size_t                 order_stats_size; /**< Elements in order_stats. */
+
+    /**
+     * Rule profiles, indexed by rule index.
+     *
+     * Only allocated if some context enables RuleEngineProfile.
+     */
+    ib_rule_profile_t     *profiles;
+    size_t                 profiles_size;    /**< Elements in profiles. */
+
+    /**
+     * Profile rules of all contexts; see ib_rule_profile_set().
+     */
+    bool                   profile_all;
+
+    /**
+     * Rule profiles of the two arms of RuleEngineCompare, indexed by twice
+     * the rule index plus the arm.
+     *
+     * Only allocated if some context enables RuleEngineCompare.
+     */
+    ib_rule_profile_t     *compare_profiles;
+    size_t                 compare_profiles_size; /**< Rules in
+                                                   *   compare_profiles. */
+    size_t                 compare_next; /**< Transactions assigned an arm. */
+
+    /**
+     * Serializes deferred rule set builds; see RuleEngineLazyContexts.
+     */
+    ib_lock_t             *lazy_lock;
+
+    /**
+     * Was the rule set build of any context deferred?
+     */
+    bool                   lazy_contexts;
 
     /**
      * Rule injection callbacks.
@@ -359,6 +359,26 @@ static ib_status_t ib_field_format_escape(
     return IB_OK;
 }
 
+/**
+ * Would a message of @a log_level for @a tx be written by the logger?
+ *
+ * Rule execution logging is checked against this before anything is
+ * formatted or recorded, so that it costs next to nothing while the logger
+ * level drops it.
+ *
+ * @param[in] tx Transaction information
+ * @param[in] log_level Log level of the message
+ *
+ * @returns true if the message would be written.
+ */
+static bool rule_log_writes(
+    const ib_tx_t *tx,
+    ib_logger_level_t log_level
+)
+{
+    return log_level <= ib_logger_level_get(ib_engine_logger_get(tx->ib));
+}
+
 /**
  * Generic Logger for rules.
  *
@@ -404,6 +424,7 @@ static void rule_vlog_tx(
     va_list ap
 )
 {
+    char prefixed[256];
     char *fmtbuf = NULL;
     size_t fmtlen;
     void *freeptr = NULL;
@@ -411,7 +432,7 @@ static void rule_vlog_tx(
         (tx->ctx == NULL) ? IB_RULE_DLOG_INFO : ib_rule_dlog_level(tx->ctx);
 
     /* Ignore this message? */
-    if (rule_log_level > dlog_level) {
+    if ( (rule_log_level > dlog_level) || ! rule_log_writes(tx, log_level) ) {
         return;
     }
 
@@ -423,7 +444,13 @@ static void rule_vlog_tx(
         const char *id = ib_rule_id(rule);
         fmtlen = strlen(fmt) + strlen(id) + 24;
     }
-    fmtbuf = malloc(fmtlen);
+    if (fmtlen <= sizeof(prefixed)) {
+        fmtbuf = prefixed;
+    }
+    else {
+        fmtbuf = malloc(fmtlen);
+        freeptr = fmtbuf;
+    }
 
     if (fmtbuf != NULL) {
         if (rule == NULL) {
@@ -435,7 +462,6 @@ static void rule_vlog_tx(
         }
         strcat(fmtbuf, fmt);
         fmt = fmtbuf;
-        freeptr = fmtbuf;
     }
 
     ib_log_tx_vex(tx, log_level, file, func, line, fmt, ap);
@@ -742,6 +768,11 @@ ib_status_t ib_rule_log_exec_create(const ib_rule_exec_t *rule_exec,
         return IB_OK;
     }
 
+    /* Record nothing if none of it would be written. */
+    if (! rule_log_writes(rule_exec->tx, tx_log->level)) {
+        return IB_OK;
+    }
+
     /* Allocate the object */
     new = ib_mm_calloc(tx_log->mm, sizeof(*new), 1);
     if (new == NULL) {
@@ -786,7 +817,9 @@ void ib_rule_log_fatal_ex(
     ib_logger_level_t log_level =
         (rule_exec->tx_log == NULL) ? IB_LOG_INFO : rule_exec->tx_log->level;
 
-    ib_flags_set(exec_log->flags, IB_RULE_EXEC_FATAL);
+    if (exec_log != NULL) {
+        ib_flags_set(exec_log->flags, IB_RULE_EXEC_FATAL);
+    }
 
     va_start(ap, fmt);
     rule_vlog_tx(IB_RULE_DLOG_ERROR, log_level,
@@ -909,6 +942,15 @@ ib_status_t ib_rule_log_exec_add_stream_tgt(ib_engine_t *ib,
     return rc;
 }
 
+bool ib_rule_log_exec_tfn_enabled(const ib_rule_log_exec_t *exec_log)
+{
+    if (exec_log == NULL) {
+        return false;
+    }
+
+    return (exec_log->tgt_cur != NULL) && (exec_log->tgt_cur->tfn_list != NULL);
+}
+
 ib_status_t ib_rule_log_exec_tfn_inst_add(ib_rule_log_exec_t *exec_log,
                                           const ib_transformation_inst_t *tfn_inst)
 {
@@ -1222,6 +1264,13 @@ static void log_tx_end(
     const ib_rule_exec_t *rule_exec
 )
 {
+    if ( (ib_flags_all(rule_exec->tx_log->flags, IB_RULE_LOG_FLAG_TFN)) &&
+         (!rule_exec->tx_log->empty_tx) )
+    {
+        rule_log_exec(rule_exec, "TFN_CACHE hits=%zd misses=%zd",
+                      rule_exec->tfn_cache_hits,
+                      rule_exec->tfn_cache_misses);
+    }
     if ( (ib_flags_all(rule_exec->tx_log->flags, IB_RULE_LOG_FLAG_TX)) &&
          (!rule_exec->tx_log->empty_tx) )
     {
@@ -1331,7 +1380,10 @@ static void log_tx_body(
     ib_sdata_t *sdata;
     ib_status_t rc;
 
-    if (body == NULL) {
+    /* Don't escape a body nobody will see. */
+    if ( (body == NULL) ||
+         ! rule_log_writes(rule_exec->tx, rule_exec->tx_log->level) )
+    {
         return;
     }
     rc = ib_stream_peek(body, &sdata);
@@ -1894,21 +1946,21 @@ void ib_rule_log_execution(
     ib_mm_t           mpl_mm;
     ib_status_t       rc;
 
-    rc = ib_mpool_lite_create(&mpl);
-    if (rc != IB_OK) {
-        return;
-    }
-    mpl_mm = ib_mm_mpool_lite(mpl);
-
     if ( (exec_log == NULL) || (exec_log->rule == NULL) ) {
-        goto cleanup;
+        return;
     }
 
     tx_log = rule_exec->tx_log;
     if (filter(exec_log, &exec_log->counts) == false) {
-        goto cleanup;
+        return;
     }
 
+    rc = ib_mpool_lite_create(&mpl);
+    if (rc != IB_OK) {
+        return;
+    }
+    mpl_mm = ib_mm_mpool_lite(mpl);
+
     rule = exec_log->rule;
 
     /*
@@ -1977,7 +2029,6 @@ void ib_rule_log_execution(
         assert(0 && "Fatal rule execution error");
     }
 
-cleanup:
     ib_mpool_lite_destroy(mpl);
     return;
 }
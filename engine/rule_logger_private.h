@@ -317,6 +317,16 @@ ib_status_t ib_rule_log_exec_add_stream_tgt(
     ib_rule_log_exec_t         *exec_log,
     const ib_field_t           *field);
 
+/**
+ * Are transformations of the current target being logged?
+ *
+ * @param[in] exec_log The execution logging object (may be NULL).
+ *
+ * @returns true if transformations and their values are logged.
+ */
+bool ib_rule_log_exec_tfn_enabled(
+    const ib_rule_log_exec_t   *exec_log);
+
 /**
  * Add a transformation to a rule execution log.
  *
@@ -26,18 +26,25 @@
 #include "state_notify_private.h"
 
 #include "engine_private.h"
+#include "probes_private.h"
 
+#include <ironbee/array.h>
+#include <ironbee/clock.h>
 #include <ironbee/context.h>
 #include <ironbee/dso.h>
 #include <ironbee/engine.h>
 #include <ironbee/engine_state.h>
 #include <ironbee/field.h>
 #include <ironbee/flags.h>
+#include <ironbee/list.h>
 #include <ironbee/log.h>
 #include <ironbee/mm_mpool_lite.h>
+#include <ironbee/module.h>
 #include <ironbee/stream_pump.h>
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
 /**
  * Generate and log a message about a hook function returning an error.
@@ -110,6 +117,201 @@ no_mm_log:
     );
 }
 
+/**
+ * Number of hook profiles of each module.
+ */
+#define HOOK_PROFILE_STATES (IB_STATE_NUM + 1)
+
+/**
+ * Start timing a hook if hook profiling is on.
+ *
+ * @param[in] ib The engine.
+ *
+ * @returns The time, or 0 if hook profiling is off.
+ */
+static inline ib_time_t hook_profile_start(const ib_engine_t *ib)
+{
+    if (! __atomic_load_n(&(ib->hook_profile), __ATOMIC_RELAXED)) {
+        return 0;
+    }
+    return ib_clock_precise_get_time();
+}
+
+/**
+ * Add the time since @a start to the profile of @a hook.
+ *
+ * Hooks run on many threads at once, so the counters are updated
+ * atomically.
+ *
+ * @param[in] ib The engine.
+ * @param[in] state The state being processed.
+ * @param[in] hook The hook called.
+ * @param[in] start Return of hook_profile_start() before the call.
+ */
+static inline void hook_profile_record(
+    ib_engine_t     *ib,
+    ib_state_t       state,
+    const ib_hook_t *hook,
+    ib_time_t        start
+)
+{
+    ib_hook_profile_t *profiles;
+    size_t             index;
+
+    if (start == 0) {
+        return;
+    }
+
+    index = state;
+    if (hook->module != NULL) {
+        index += HOOK_PROFILE_STATES * (hook->module->idx + 1);
+    }
+    /* The profiles may be sized while hooks run; see ib_hook_profile_set(). */
+    if (index >= __atomic_load_n(&(ib->hook_profiles_size),
+                                 __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+    profiles = __atomic_load_n(&(ib->hook_profiles), __ATOMIC_ACQUIRE);
+
+    __atomic_fetch_add(&(profiles[index].calls), 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(profiles[index].time),
+                       ib_clock_precise_get_time() - start,
+                       __ATOMIC_RELAXED);
+}
+
+ib_status_t ib_hook_profile_set(
+    ib_engine_t *ib,
+    bool         enabled
+)
+{
+    assert(ib != NULL);
+
+    ib_hook_profile_t *profiles;
+    size_t             modules;
+    size_t             size;
+    size_t             i;
+
+    modules = ib_array_elements(ib->modules);
+    size = HOOK_PROFILE_STATES * (modules + 1);
+    if (enabled && ib->hook_profiles_size < size) {
+        profiles = ib_mm_calloc(ib_engine_mm_main_get(ib),
+                                size, sizeof(*profiles));
+        if (profiles == NULL) {
+            return IB_EALLOC;
+        }
+        for (i = 0; i < size; ++i) {
+            const ib_module_t *module = NULL;
+
+            if (i >= HOOK_PROFILE_STATES) {
+                ib_array_get(ib->modules,
+                             i / HOOK_PROFILE_STATES - 1,
+                             &module);
+            }
+            profiles[i].module = module;
+            profiles[i].state = i % HOOK_PROFILE_STATES;
+        }
+        if (ib->hook_profiles != NULL) {
+            for (i = 0; i < ib->hook_profiles_size; ++i) {
+                profiles[i].calls = ib->hook_profiles[i].calls;
+                profiles[i].time = ib->hook_profiles[i].time;
+            }
+        }
+        /* Publish the array before its size; the old one is left in place
+         * for any hook still using it. */
+        __atomic_store_n(&(ib->hook_profiles), profiles, __ATOMIC_RELEASE);
+        __atomic_store_n(&(ib->hook_profiles_size), size, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&(ib->hook_profile), enabled, __ATOMIC_RELAXED);
+
+    return IB_OK;
+}
+
+bool ib_hook_profile_enabled(
+    const ib_engine_t *ib
+)
+{
+    assert(ib != NULL);
+
+    return __atomic_load_n(&(ib->hook_profile), __ATOMIC_RELAXED);
+}
+
+/**
+ * Compare two hook profiles by decreasing total time.
+ */
+static int hook_profile_compare(const void *a, const void *b)
+{
+    const ib_hook_profile_t *profile_a = *(const ib_hook_profile_t * const *)a;
+    const ib_hook_profile_t *profile_b = *(const ib_hook_profile_t * const *)b;
+
+    if (profile_a->time > profile_b->time) {
+        return -1;
+    }
+    if (profile_a->time < profile_b->time) {
+        return 1;
+    }
+    return 0;
+}
+
+ib_status_t ib_hook_profile_get(
+    const ib_engine_t  *ib,
+    ib_mm_t             mm,
+    ib_list_t         **profiles
+)
+{
+    assert(ib != NULL);
+    assert(profiles != NULL);
+
+    const ib_hook_profile_t **sorted;
+    size_t                    count = 0;
+    size_t                    i;
+    ib_list_t                *list;
+    ib_status_t               rc;
+
+    rc = ib_list_create(&list, mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    *profiles = list;
+
+    if (ib->hook_profiles_size == 0) {
+        return IB_OK;
+    }
+
+    sorted = ib_mm_alloc(mm, ib->hook_profiles_size * sizeof(*sorted));
+    if (sorted == NULL) {
+        return IB_EALLOC;
+    }
+    for (i = 0; i < ib->hook_profiles_size; ++i) {
+        if (ib->hook_profiles[i].calls != 0) {
+            sorted[count] = &(ib->hook_profiles[i]);
+            ++count;
+        }
+    }
+    qsort(sorted, count, sizeof(*sorted), hook_profile_compare);
+
+    for (i = 0; i < count; ++i) {
+        rc = ib_list_push(list, (void *)sorted[i]);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    return IB_OK;
+}
+
+void ib_hook_profile_reset(
+    ib_engine_t *ib
+)
+{
+    assert(ib != NULL);
+
+    for (size_t i = 0; i < ib->hook_profiles_size; ++i) {
+        ib->hook_profiles[i].calls = 0;
+        ib->hook_profiles[i].time = 0;
+    }
+}
+
 static ib_status_t ib_state_notify_null(
     ib_engine_t *ib,
     ib_state_t state
@@ -117,7 +319,9 @@ static ib_status_t ib_state_notify_null(
 {
     assert(ib != NULL);
 
-    const ib_list_node_t *node;
+    const ib_hook_t *hooks;
+    size_t hook_count;
+    ib_time_t start;
     ib_status_t rc = ib_hook_check(ib, state, IB_STATE_HOOK_NULL);
     if (rc != IB_OK) {
         ib_log_error(ib, "Error checking hook for \"%s\": %s",
@@ -128,10 +332,13 @@ static ib_status_t ib_state_notify_null(
 
     ib_log_debug3(ib, "NULL EVENT: %s", ib_state_name(state));
 
-    IB_LIST_LOOP_CONST(ib->hooks[state], node) {
-        const ib_hook_t *hook =
-            (const ib_hook_t *)ib_list_node_data_const(node);
+    hooks = ib->hook_tables[state];
+    hook_count = ib->hook_counts[state];
+    for (size_t i = 0; i < hook_count; ++i) {
+        const ib_hook_t *hook = &(hooks[i]);
+        start = hook_profile_start(ib);
         rc = hook->callback.null(ib, state, hook->cbdata);
+        hook_profile_record(ib, state, hook, start);
         if (rc == IB_DECLINED) {
             ib_log_debug(ib, "Hook declined: %s", ib_state_name(state));
         }
@@ -153,7 +360,9 @@ static ib_status_t ib_state_notify_context(
     assert(ib != NULL);
     assert(ctx != NULL);
 
-    const ib_list_node_t *node;
+    const ib_hook_t *hooks;
+    size_t hook_count;
+    ib_time_t start;
     ib_status_t rc = ib_hook_check(ib, state, IB_STATE_HOOK_CTX);
     if (rc != IB_OK) {
         ib_log_error(ib, "Error checking hook for \"%s\": %s",
@@ -164,10 +373,13 @@ static ib_status_t ib_state_notify_context(
 
     ib_log_debug3(ib, "CTX EVENT: %s", ib_state_name(state));
 
-    IB_LIST_LOOP_CONST(ib->hooks[state], node) {
-        const ib_hook_t *hook =
-            (const ib_hook_t *)ib_list_node_data_const(node);
+    hooks = ib->hook_tables[state];
+    hook_count = ib->hook_counts[state];
+    for (size_t i = 0; i < hook_count; ++i) {
+        const ib_hook_t *hook = &(hooks[i]);
+        start = hook_profile_start(ib);
         rc = hook->callback.ctx(ib, ctx, state, hook->cbdata);
+        hook_profile_record(ib, state, hook, start);
         if (rc == IB_DECLINED) {
             ib_log_debug(ib, "Hook declined: %s", ib_state_name(state));
         }
@@ -190,7 +402,9 @@ static ib_status_t ib_state_notify_conn(
     assert(ib->cfg_state == CFG_FINISHED);
     assert(conn != NULL);
 
-    const ib_list_node_t *node;
+    const ib_hook_t *hooks;
+    size_t hook_count;
+    ib_time_t start;
     ib_status_t rc = ib_hook_check(ib, state, IB_STATE_HOOK_CONN);
     if (rc != IB_OK) {
         ib_log_error(ib, "Error checking hook for \"%s\": %s",
@@ -200,15 +414,19 @@ static ib_status_t ib_state_notify_conn(
     }
 
     ib_log_debug3(ib, "CONN EVENT: %s", ib_state_name(state));
+    IB_PROBE2(conn_state, ib_state_name(state), conn->id);
 
     if (conn->ctx == NULL) {
         ib_log_notice(ib, "Connection context is null.");
     }
 
-    IB_LIST_LOOP_CONST(ib->hooks[state], node) {
-        const ib_hook_t *hook =
-            (const ib_hook_t *)ib_list_node_data_const(node);
+    hooks = ib->hook_tables[state];
+    hook_count = ib->hook_counts[state];
+    for (size_t i = 0; i < hook_count; ++i) {
+        const ib_hook_t *hook = &(hooks[i]);
+        start = hook_profile_start(ib);
         rc = hook->callback.conn(ib, conn, state, hook->cbdata);
+        hook_profile_record(ib, state, hook, start);
         if (rc == IB_DECLINED) {
             ib_log_debug(ib, "Hook declined: %s", ib_state_name(state));
         }
@@ -236,7 +454,9 @@ static ib_status_t ib_state_notify_req_line(
     assert(line->uri != NULL);
     assert(line->protocol != NULL);
 
-    const ib_list_node_t *node;
+    const ib_hook_t *hooks;
+    size_t hook_count;
+    ib_time_t start;
     ib_status_t rc;
 
     rc = ib_hook_check(ib, state, IB_STATE_HOOK_REQLINE);
@@ -259,10 +479,15 @@ static ib_status_t ib_state_notify_req_line(
         ib_log_notice_tx(tx, "Connection context is null.");
     }
 
-    IB_LIST_LOOP_CONST(ib->hooks[state], node) {
-        const ib_hook_t *hook =
-            (const ib_hook_t *)ib_list_node_data_const(node);
+    IB_PROBE2(tx_state, ib_state_name(state), tx->id);
+
+    hooks = ib->hook_tables[state];
+    hook_count = ib->hook_counts[state];
+    for (size_t i = 0; i < hook_count; ++i) {
+        const ib_hook_t *hook = &(hooks[i]);
+        start = hook_profile_start(ib);
         rc = hook->callback.requestline(ib, tx, state, line, hook->cbdata);
+        hook_profile_record(ib, state, hook, start);
         if (rc == IB_DECLINED) {
             ib_log_debug_tx(tx, "Hook declined: %s",
                             ib_state_name(state));
@@ -288,7 +513,9 @@ static ib_status_t ib_state_notify_resp_line(ib_engine_t *ib,
     assert((line == NULL) || (line->status != NULL));
     assert((line == NULL) || (line->msg != NULL));
 
-    const ib_list_node_t *node;
+    const ib_hook_t *hooks;
+    size_t hook_count;
+    ib_time_t start;
     ib_status_t rc;
 
     rc = ib_hook_check(ib, state, IB_STATE_HOOK_RESPLINE);
@@ -324,10 +551,15 @@ static ib_status_t ib_state_notify_resp_line(ib_engine_t *ib,
         ib_log_notice_tx(tx, "Connection context is null.");
     }
 
-    IB_LIST_LOOP_CONST(ib->hooks[state], node) {
-        const ib_hook_t *hook =
-            (const ib_hook_t *)ib_list_node_data_const(node);
+    IB_PROBE2(tx_state, ib_state_name(state), tx->id);
+
+    hooks = ib->hook_tables[state];
+    hook_count = ib->hook_counts[state];
+    for (size_t i = 0; i < hook_count; ++i) {
+        const ib_hook_t *hook = &(hooks[i]);
+        start = hook_profile_start(ib);
         rc = hook->callback.responseline(ib, tx, state, line, hook->cbdata);
+        hook_profile_record(ib, state, hook, start);
         if (rc == IB_DECLINED) {
             ib_log_debug_tx(tx, "Hook declined: %s",
                             ib_state_name(state));
@@ -348,13 +580,16 @@ static ib_status_t ib_state_notify_tx(ib_engine_t *ib,
     assert(ib->cfg_state == CFG_FINISHED);
     assert(tx != NULL);
 
-    const ib_list_node_t *node;
+    const ib_hook_t *hooks;
+    size_t hook_count;
+    ib_time_t start;
     ib_status_t rc = ib_hook_check(ib, state, IB_STATE_HOOK_TX);
     if (rc != IB_OK) {
         return rc;
     }
 
     ib_log_debug3_tx(tx, "TX EVENT: %s", ib_state_name(state));
+    IB_PROBE2(tx_state, ib_state_name(state), tx->id);
 
     /* This transaction is now the current (for pipelined). */
     tx->conn->tx = tx;
@@ -363,10 +598,13 @@ static ib_status_t ib_state_notify_tx(ib_engine_t *ib,
         ib_log_notice_tx(tx, "Connection context is null.");
     }
 
-    IB_LIST_LOOP_CONST(ib->hooks[state], node) {
-        const ib_hook_t *hook =
-            (const ib_hook_t *)ib_list_node_data_const(node);
+    hooks = ib->hook_tables[state];
+    hook_count = ib->hook_counts[state];
+    for (size_t i = 0; i < hook_count; ++i) {
+        const ib_hook_t *hook = &(hooks[i]);
+        start = hook_profile_start(ib);
         rc = hook->callback.tx(ib, tx, state, hook->cbdata);
+        hook_profile_record(ib, state, hook, start);
         if (rc == IB_DECLINED) {
             ib_log_debug_tx(tx, "Hook declined: %s",
                             ib_state_name(state));
@@ -575,7 +813,9 @@ static ib_status_t ib_state_notify_header_data(ib_engine_t *ib,
     assert(tx != NULL);
     assert(header != NULL);
 
-    const ib_list_node_t *node;
+    const ib_hook_t *hooks;
+    size_t hook_count;
+    ib_time_t start;
     ib_status_t rc = ib_hook_check(ib, state, IB_STATE_HOOK_HEADER);
     if (rc != IB_OK) {
         ib_log_error_tx(tx, "Error checking hook for \"%s\": %s",
@@ -585,16 +825,20 @@ static ib_status_t ib_state_notify_header_data(ib_engine_t *ib,
     }
 
     ib_log_debug3_tx(tx, "HEADER EVENT: %s", ib_state_name(state));
+    IB_PROBE2(tx_state, ib_state_name(state), tx->id);
 
     if (tx->ctx == NULL) {
         ib_log_notice_tx(tx, "Connection context is null.");
     }
 
-    IB_LIST_LOOP_CONST(ib->hooks[state], node) {
-        const ib_hook_t *hook =
-            (const ib_hook_t *)ib_list_node_data_const(node);
+    hooks = ib->hook_tables[state];
+    hook_count = ib->hook_counts[state];
+    for (size_t i = 0; i < hook_count; ++i) {
+        const ib_hook_t *hook = &(hooks[i]);
+        start = hook_profile_start(ib);
         rc = hook->callback.headerdata(ib, tx, state,
                                        header->head, hook->cbdata);
+        hook_profile_record(ib, state, hook, start);
         if (rc == IB_DECLINED) {
             ib_log_debug_tx(tx, "Hook declined: %s",
                             ib_state_name(state));
@@ -618,7 +862,9 @@ static ib_status_t ib_state_notify_txdata(ib_engine_t *ib,
     assert(tx != NULL);
     assert(data != NULL);
 
-    const ib_list_node_t *node;
+    const ib_hook_t *hooks;
+    size_t hook_count;
+    ib_time_t start;
     ib_status_t rc = ib_hook_check(ib, state, IB_STATE_HOOK_TXDATA);
     if (rc != IB_OK) {
         ib_log_error_tx(tx, "Error checking hook for \"%s\": %s",
@@ -638,10 +884,15 @@ static ib_status_t ib_state_notify_txdata(ib_engine_t *ib,
         ib_log_notice_tx(tx, "Connection context is null.");
     }
 
-    IB_LIST_LOOP_CONST(ib->hooks[state], node) {
-        const ib_hook_t *hook =
-            (const ib_hook_t *)ib_list_node_data_const(node);
+    IB_PROBE2(tx_state, ib_state_name(state), tx->id);
+
+    hooks = ib->hook_tables[state];
+    hook_count = ib->hook_counts[state];
+    for (size_t i = 0; i < hook_count; ++i) {
+        const ib_hook_t *hook = &(hooks[i]);
+        start = hook_profile_start(ib);
         rc = hook->callback.txdata(ib, tx, state, data, data_length, hook->cbdata);
+        hook_profile_record(ib, state, hook, start);
         if (rc == IB_DECLINED) {
             ib_log_debug_tx(tx, "Hook declined: %s",
                             ib_state_name(state));
@@ -846,6 +1097,21 @@ ib_status_t ib_state_notify_request_body_data(ib_engine_t *ib,
         tx->request_body_len += data_length;
     }
 
+    /* Data past the inspection limit is not processed. */
+    if (tx->limits.request_body_inspect_limit >= 0) {
+        size_t limit = (size_t)tx->limits.request_body_inspect_limit;
+        size_t seen = tx->request_body_len - data_length;
+
+        if (seen >= limit) {
+            return IB_OK;
+        }
+        if (data_length > limit - seen) {
+            ib_log_debug_tx(tx, "Request body inspection limit %zu reached.",
+                            limit);
+            data_length = limit - seen;
+        }
+    }
+
     /* Notify the engine and any callbacks of the data. */
     rc = ib_state_notify_txdata(ib, tx, request_body_data_state, data, data_length);
     if (rc != IB_OK) {
@@ -1176,6 +1442,21 @@ ib_status_t ib_state_notify_response_body_data(ib_engine_t *ib,
         tx->response_body_len += data_length;
     }
 
+    /* Data past the inspection limit is not processed. */
+    if (tx->limits.response_body_inspect_limit >= 0) {
+        size_t limit = (size_t)tx->limits.response_body_inspect_limit;
+        size_t seen = tx->response_body_len - data_length;
+
+        if (seen >= limit) {
+            return IB_OK;
+        }
+        if (data_length > limit - seen) {
+            ib_log_debug_tx(tx, "Response body inspection limit %zu reached.",
+                            limit);
+            data_length = limit - seen;
+        }
+    }
+
     /* Notify the engine and any callbacks of the data. */
     rc = ib_state_notify_txdata(ib, tx, response_body_data_state, data, data_length);
     if (rc != IB_OK) {
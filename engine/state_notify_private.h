@@ -49,6 +49,7 @@ struct ib_hook_t {
         ib_state_ctx_hook_fn_t      ctx;
     } callback;
     void               *cbdata;            /**< Data passed to the callback */
+    const ib_module_t  *module;            /**< Registering module or NULL */
 };
 
 /**
@@ -29,10 +29,12 @@
 #include <ironbee/mm_mpool_lite.h>
 #include <ironbee/mpool_freeable.h>
 #include <ironbee/mpool_lite.h>
+#include <ironbee/queue.h>
 #include <ironbee/stream_io.h>
 #include <ironbee/stream_pump.h>
 
 #include <assert.h>
+#include <stdbool.h>
 
 //! A list of processors and a context to execute them.
 struct ib_stream_pump_t {
@@ -45,11 +47,23 @@ struct ib_stream_pump_t {
     //! Processor to execute.
     ib_list_t *processors;
 
+    /**
+     * Data held for each processor, parallel to @c processors.
+     *
+     * Each element is an @ref ib_queue_t of the @ref ib_stream_io_data_t
+     * the processor left unconsumed in its input. The data is returned to
+     * the processor's input the next time data is pumped.
+     */
+    ib_list_t *held;
+
     //! The transaction for this pump.
     ib_tx_t *tx;
 
     //! IO System for handling data ownership.
     ib_stream_io_t *io;
+
+    //! IO transaction, reused for every call that pumps data.
+    ib_stream_io_tx_t *io_tx;
 };
 
 ib_status_t ib_stream_pump_create(
@@ -78,12 +92,24 @@ ib_status_t ib_stream_pump_create(
         return rc;
     }
 
+    rc = ib_list_create(&tmp_pump->held, mm);
+    if (rc != IB_OK) {
+        ib_log_alert_tx(tx, "Failed to create held data list in pump.");
+        return rc;
+    }
+
     rc = ib_stream_io_create(&tmp_pump->io, mm);
     if (rc != IB_OK) {
         ib_log_alert_tx(tx, "Failed to create pump io system.");
         return rc;
     }
 
+    rc = ib_stream_io_tx_create(&tmp_pump->io_tx, tmp_pump->io);
+    if (rc != IB_OK) {
+        ib_log_alert_tx(tx, "Failed to create io transaction.");
+        return rc;
+    }
+
     tmp_pump->mm       = mm;
     tmp_pump->registry = registry;
     tmp_pump->tx       = tx;
@@ -95,10 +121,16 @@ ib_status_t ib_stream_pump_create(
 /**
  * Execute all the pumps and cleanup @a io_tx.
  *
+ * Data that a processor leaves in its input is held and given back to
+ * that processor, ahead of new data, the next time the pump runs. Once
+ * the stream is closed nothing more will arrive, so data left after a
+ * close is released.
+ *
  * @param[in] pump The pump.
  * @param[in] io_tx IO Transaction.
  * @param[in] mm_eval A memory manager that is freed when pump
  *            evaluation concludes.
+ * @param[in] is_close True if @a io_tx carries the close of the stream.
  *
  * @returns
  * - IB_OK On success.
@@ -107,7 +139,8 @@ ib_status_t ib_stream_pump_create(
 static ib_status_t stream_pump_process(
     ib_stream_pump_t  *pump,
     ib_stream_io_tx_t *io_tx,
-    ib_mm_t            mm_eval
+    ib_mm_t            mm_eval,
+    bool               is_close
 )
 {
     assert(pump != NULL);
@@ -116,10 +149,21 @@ static ib_status_t stream_pump_process(
 
     ib_status_t     rc;
     ib_list_node_t *node;
+    ib_list_node_t *held_node = ib_list_first(pump->held);
 
     IB_LIST_LOOP(pump->processors, node) {
         ib_stream_processor_t *processor =
             (ib_stream_processor_t *)ib_list_node_data(node);
+        ib_queue_t            *held =
+            (ib_queue_t *)ib_list_node_data(held_node);
+
+        held_node = ib_list_node_next(held_node);
+
+        /* Give back what the processor did not consume last time. */
+        rc = ib_stream_io_tx_unhold(io_tx, held);
+        if (rc != IB_OK) {
+            goto cleanup;
+        }
 
         /* Execute a processor on an IO transaction. */
         rc = ib_stream_processor_execute(processor, pump->tx, mm_eval, io_tx);
@@ -127,20 +171,28 @@ static ib_status_t stream_pump_process(
         /* If evaluation of a processor is OK, the tx may be reused. */
         if (rc == IB_OK) {
 
-            /* Warn if the input queue is not empty. */
+            /* Hold unconsumed input until more data arrives. */
             if (ib_stream_io_data_depth(io_tx)) {
-                ib_log_warning_tx(
-                    pump->tx,
-                    "Streaming data input queue was not fully "
-                        "consumed by processor %s.",
-                    ib_stream_processor_name(processor)
-                );
+                if (is_close) {
+                    ib_log_warning_tx(
+                        pump->tx,
+                        "Streaming data input queue was not fully "
+                            "consumed by processor %s.",
+                        ib_stream_processor_name(processor)
+                    );
+                }
+                else {
+                    rc = ib_stream_io_tx_hold(io_tx, held);
+                    if (rc != IB_OK) {
+                        goto cleanup;
+                    }
+                }
             }
 
             /* Exchange input and output queues, clear the output queue. */
             rc = ib_stream_io_tx_reuse(io_tx);
             if (rc != IB_OK) {
-                return rc;
+                goto cleanup;
             }
         }
         /* Not OK. Not declined. Failure. */
@@ -172,6 +224,7 @@ cleanup:
  *
  * @param[in] pump The pump.
  * @param[in] io_tx IO Transaction.
+ * @param[in] is_close True if @a io_tx carries the close of the stream.
  *
  * @returns
  * - IB_OK On success.
@@ -179,7 +232,8 @@ cleanup:
  */
 static ib_status_t stream_pump_process_setup_and_run(
     ib_stream_pump_t  *pump,
-    ib_stream_io_tx_t *io_tx
+    ib_stream_io_tx_t *io_tx,
+    bool               is_close
 )
 {
     assert(pump != NULL);
@@ -194,13 +248,14 @@ static ib_status_t stream_pump_process_setup_and_run(
     rc = ib_mpool_lite_create(&mp_eval);
     if (rc != IB_OK) {
         ib_log_alert_tx(pump->tx, "Failed to create eval memory pool.");
+        ib_stream_io_tx_cleanup(io_tx);
         return rc;
     }
     /* Wrap the mpool in a memory manager. */
     mm_eval = ib_mm_mpool_lite(mp_eval);
 
     /* After the above setup, do the actual processing. */
-    rc = stream_pump_process(pump, io_tx, mm_eval);
+    rc = stream_pump_process(pump, io_tx, mm_eval, is_close);
     if (rc != IB_OK) {
         goto exit_label;
     }
@@ -229,20 +284,17 @@ ib_status_t ib_stream_pump_process(
         return IB_OK;
     }
 
-    rc = ib_stream_io_tx_create(&io_tx, pump->io);
-    if (rc != IB_OK) {
-        ib_log_alert_tx(pump->tx, "Failed to create io transaction.");
-        return rc;
-    }
+    io_tx = pump->io_tx;
 
     rc = ib_stream_io_tx_data_add(io_tx, data, data_len);
     if (rc != IB_OK) {
         ib_log_alert_tx(pump->tx, "Failed to add data to io transaction.");
+        ib_stream_io_tx_cleanup(io_tx);
         return rc;
     }
 
     /* Setup and run the processor. */
-    rc = stream_pump_process_setup_and_run(pump, io_tx);
+    rc = stream_pump_process_setup_and_run(pump, io_tx, false);
     if (rc != IB_OK) {
         ib_log_alert_tx(pump->tx, "Failed to setup and run pump.");
         return rc;
@@ -260,20 +312,17 @@ ib_status_t ib_stream_pump_flush(
     ib_status_t                 rc;
     ib_stream_io_tx_t          *io_tx;
 
-    rc = ib_stream_io_tx_create(&io_tx, pump->io);
-    if (rc != IB_OK) {
-        ib_log_alert_tx(pump->tx, "Failed to create io transaction.");
-        return rc;
-    }
+    io_tx = pump->io_tx;
 
     rc = ib_stream_io_tx_flush_add(io_tx);
     if (rc != IB_OK) {
         ib_log_alert_tx(pump->tx, "Failed to add flush to io transaction.");
+        ib_stream_io_tx_cleanup(io_tx);
         return rc;
     }
 
     /* Setup and run the processor. */
-    rc = stream_pump_process_setup_and_run(pump, io_tx);
+    rc = stream_pump_process_setup_and_run(pump, io_tx, false);
     if (rc != IB_OK) {
         ib_log_alert_tx(pump->tx, "Failed to setup and run pump.");
         return rc;
@@ -291,20 +340,17 @@ ib_status_t ib_stream_pump_close(
     ib_status_t                 rc;
     ib_stream_io_tx_t          *io_tx;
 
-    rc = ib_stream_io_tx_create(&io_tx, pump->io);
-    if (rc != IB_OK) {
-        ib_log_alert_tx(pump->tx, "Failed to create io transaction.");
-        return rc;
-    }
+    io_tx = pump->io_tx;
 
     rc = ib_stream_io_tx_close_add(io_tx);
     if (rc != IB_OK) {
         ib_log_alert_tx(pump->tx, "Failed to add flush to io transaction.");
+        ib_stream_io_tx_cleanup(io_tx);
         return rc;
     }
 
     /* Setup and run the processor. */
-    rc = stream_pump_process_setup_and_run(pump, io_tx);
+    rc = stream_pump_process_setup_and_run(pump, io_tx, true);
     if (rc != IB_OK) {
         ib_log_alert_tx(pump->tx, "Failed to setup and run pump.");
         return rc;
@@ -325,20 +371,17 @@ ib_status_t ib_stream_pump_error(
     ib_status_t                 rc;
     ib_stream_io_tx_t          *io_tx;
 
-    rc = ib_stream_io_tx_create(&io_tx, pump->io);
-    if (rc != IB_OK) {
-        ib_log_alert_tx(pump->tx, "Failed to create io transaction.");
-        return rc;
-    }
+    io_tx = pump->io_tx;
 
     rc = ib_stream_io_tx_error_add(io_tx, msg, len);
     if (rc != IB_OK) {
         ib_log_alert_tx(pump->tx, "Failed to add flush to io transaction.");
+        ib_stream_io_tx_cleanup(io_tx);
         return rc;
     }
 
     /* Setup and run the processor. */
-    rc = stream_pump_process_setup_and_run(pump, io_tx);
+    rc = stream_pump_process_setup_and_run(pump, io_tx, false);
     if (rc != IB_OK) {
         ib_log_alert_tx(pump->tx, "Failed to setup and run pump.");
         return rc;
@@ -359,6 +402,7 @@ ib_status_t ib_stream_pump_processor_add(
 
     ib_status_t            rc;
     ib_stream_processor_t *processor;
+    ib_queue_t            *held;
 
     rc = ib_stream_processor_registry_processor_create(
         pump->registry,
@@ -371,6 +415,18 @@ ib_status_t ib_stream_pump_processor_add(
         return rc;
     }
 
+    rc = ib_queue_create(&held, pump->mm, IB_QUEUE_NONE);
+    if (rc != IB_OK) {
+        ib_log_alert_tx(pump->tx, "Failed to add processor \"%s\"", name);
+        return rc;
+    }
+
+    rc = ib_list_push(pump->held, held);
+    if (rc != IB_OK) {
+        ib_log_alert_tx(pump->tx, "Failed to add processor \"%s\"", name);
+        return rc;
+    }
+
     rc = ib_list_push(pump->processors, processor);
     if (rc != IB_OK) {
         ib_log_alert_tx(pump->tx, "Failed to add processor \"%s\"", name);
@@ -393,6 +449,7 @@ ib_status_t ib_stream_pump_processor_insert(
 
     ib_status_t            rc;
     ib_stream_processor_t *processor;
+    ib_queue_t            *held;
 
     rc = ib_stream_processor_registry_processor_create(
         pump->registry,
@@ -405,6 +462,18 @@ ib_status_t ib_stream_pump_processor_insert(
         return rc;
     }
 
+    rc = ib_queue_create(&held, pump->mm, IB_QUEUE_NONE);
+    if (rc != IB_OK) {
+        ib_log_alert_tx(pump->tx, "Failed to add processor \"%s\"", name);
+        return rc;
+    }
+
+    rc = ib_list_insert(pump->held, held, idx);
+    if (rc != IB_OK) {
+        ib_log_alert_tx(pump->tx, "Failed to add processor \"%s\"", name);
+        return rc;
+    }
+
     rc = ib_list_insert(pump->processors, processor, idx);
     if (rc != IB_OK) {
         ib_log_alert_tx(pump->tx, "Failed to add processor \"%s\"", name);
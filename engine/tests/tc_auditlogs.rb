@@ -1,3 +1,5 @@
+require 'zlib'
+
 class TestAuditLogs < CLIPPTest::TestCase
   include CLIPPTest
 
@@ -30,6 +32,89 @@ class TestAuditLogs < CLIPPTest::TestCase
     assert(event =~ /"tags": \[\n\s*"tag1",\n\s*"tag2"\n\s*\],/m)
   end
 
+  def test_auditlog_async
+    ib_index_log = File.join(BUILDDIR, "ironbee-index.log")
+    File.unlink(ib_index_log) if File.exists?(ib_index_log)
+
+    clipp(
+      :input_hashes => [
+        simple_hash("GET /foobar/a\n"),
+        simple_hash("GET /foobar/b\n")
+      ],
+      :config => [
+        "AuditEngine EventsOnly",
+        "AuditLogBaseDir " + BUILDDIR,
+        "AuditLogAsync On",
+      ].join("\n"),
+      :default_site_config => <<-EOS
+        Rule REQUEST_METHOD @match "GET HEAD" id:1 phase:REQUEST_HEADER tag:tag1 event
+      EOS
+    )
+    assert_no_issues
+
+    # The engine writes queued audit logs before it is destroyed.
+    index = File.open(ib_index_log).read.split("\n")
+    assert_equal(2, index.size)
+    index.each do |line|
+      event_file = File.join(BUILDDIR, line.split(/\s+/)[-1])
+      assert(File.exists?(event_file), "Missing event file #{event_file}")
+      assert(File.open(event_file).read =~ /"tags": \[\n\s*"tag1"\n\s*\],/m)
+    end
+  end
+
+  def test_auditlog_compress
+    ib_index_log = File.join(BUILDDIR, "ironbee-index.log")
+    File.unlink(ib_index_log) if File.exists?(ib_index_log)
+
+    clipp(
+      :input_hashes => [simple_hash("GET /foobar/a\n")],
+      :config => [
+        "AuditEngine EventsOnly",
+        "AuditLogBaseDir " + BUILDDIR,
+        "AuditLogCompress On",
+      ].join("\n"),
+      :default_site_config => <<-EOS
+        Rule REQUEST_METHOD @match "GET HEAD" id:1 phase:REQUEST_HEADER tag:tag1 event
+      EOS
+    )
+    assert_no_issues
+    event_file = File.join(
+      BUILDDIR,
+      File.open(ib_index_log).
+        read.split("\n")[-1].
+        split(/\s+/)[-1]
+    )
+    assert(event_file =~ /\.log\.gz$/, "Event file is not compressed")
+
+    event = Zlib::GzipReader.open(event_file) { |gz| gz.read }
+    assert(event =~ /"tags": \[\n\s*"tag1"\n\s*\],/m)
+  end
+
+  def test_auditlog_index_rotate
+    ib_index_log = File.join(BUILDDIR, "ironbee-index.log")
+    Dir.glob(ib_index_log + "*").each { |f| File.unlink(f) }
+
+    clipp(
+      :input_hashes => (1..3).map { |i| simple_hash("GET /foobar/#{i}\n") },
+      :config => [
+        "AuditEngine EventsOnly",
+        "AuditLogBaseDir " + BUILDDIR,
+        "AuditLogIndexRotate 1",
+      ].join("\n"),
+      :default_site_config => <<-EOS
+        Rule REQUEST_METHOD @match "GET HEAD" id:1 phase:REQUEST_HEADER event
+      EOS
+    )
+    assert_no_issues
+
+    # Every line fills the index, so each is rotated out on its own.
+    rotated = Dir.glob(ib_index_log + ".*")
+    assert_equal(3, rotated.size)
+    rotated.each do |f|
+      assert_equal(1, File.open(f).read.split("\n").size)
+    end
+  end
+
   def test_log_auditlogs
     clipp(
       :input_hashes => [simple_hash("GET /foobar/a\n")],
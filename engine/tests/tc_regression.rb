@@ -106,6 +106,23 @@ class TestRegression < CLIPPTest::TestCase
     assert_no_issues
   end
 
+  def test_rule_engine_log_below_log_level
+    clipp(
+      input_hashes: [simple_hash("GET / HTTP/1.1\nHost: foo.bar\n\n")],
+      input: "pb:INPUT_PATH @parse @fillbody",
+      config:  "
+        RuleEngineLogData +all
+        RuleEngineLogLevel Debug
+      ",
+      default_site_config: <<-EOS
+        Rule REQUEST_METHOD @streq GET id:1 rev:1 phase:REQUEST_HEADER clipp_announce:below_log_level
+      EOS
+    )
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: below_log_level/
+    assert_log_no_match /RULE_START|TX_START|REQ_LINE/
+  end
+
   def test_parse_http09
     request = <<-EOS
       POST /
@@ -414,6 +431,173 @@ Content-Length: 1234
     assert_match /^S\r$/m, auditlog
   end
 
+  def test_core_request_body_inspect_limit
+    clipp(
+      modhtp: true,
+      config: """
+        RequestBodyInspectLimit * -1
+        RequestBodyInspectLimit application/x-www-form-urlencoded 3
+      """,
+      default_site_config: '''
+        Rule ARGS:a @clipp_print "a" id:1 rev:1 phase:REQUEST
+        Rule ARGS:b @clipp_print "b" id:2 rev:1 phase:REQUEST
+      '''
+    ) do
+      transaction {|t|
+        t.request(
+          raw: 'POST / HTTP/1.1',
+          headers: {
+            'Host' => 'www.myhost.com',
+            'Content-Type' => 'application/x-www-form-urlencoded; charset=utf-8',
+            'Content-Length' => 7
+          },
+          body: "a=1&b=2"
+        )
+      }
+    end
+
+    assert_no_issues
+    assert_log_match /clipp_print \[a\]: 1/
+    assert_log_no_match /clipp_print \[b\]: 2/
+  end
+
+  def test_core_rule_stream_coalesce_limit
+    clipp(
+      consumer: 'ironbee:IRONBEE_CONFIG @splitdata:4',
+      input_hashes: [
+        simple_hash(
+          "GET / HTTP/1.1\nHost: foo.bar\n\n",
+          "HTTP/1.1 200 OK\n\naaaabbbbcccc"
+        )
+      ],
+      config: """
+        ResponseBuffering On
+        InspectionEngineOptions all
+      """,
+      default_site_config: <<-EOS
+        RuleEngineStreamCoalesce 8
+        StreamInspect RESPONSE_BODY_STREAM @clipp_print "chunk" id:1 rev:1
+      EOS
+    )
+
+    # Rules run once the buffer is full and on the rest at the end.
+    assert_no_issues
+    assert_log_match /clipp_print \[chunk\]: aaaabbbb$/
+    assert_log_match /clipp_print \[chunk\]: cccc$/
+    assert_log_no_match /clipp_print \[chunk\]: aaaa$/
+  end
+
+  def test_core_rule_stream_coalesce_finish
+    clipp(
+      consumer: 'ironbee:IRONBEE_CONFIG @splitdata:4',
+      input_hashes: [
+        simple_hash(
+          "GET / HTTP/1.1\nHost: foo.bar\n\n",
+          "HTTP/1.1 200 OK\n\naaaabbbbcccc"
+        )
+      ],
+      config: """
+        ResponseBuffering On
+        InspectionEngineOptions all
+      """,
+      default_site_config: <<-EOS
+        RuleEngineStreamCoalesce 1024
+        StreamInspect RESPONSE_BODY_STREAM @clipp_print "chunk" id:1 rev:1
+      EOS
+    )
+
+    # The buffer never fills; all of the body is flushed when it finishes.
+    assert_no_issues
+    assert_log_match /clipp_print \[chunk\]: aaaabbbbcccc$/
+    assert_log_no_match /clipp_print \[chunk\]: aaaa$/
+  end
+
+  def test_core_rule_stream_overlap
+    clipp(
+      consumer: 'ironbee:IRONBEE_CONFIG @splitdata:4',
+      input_hashes: [
+        simple_hash(
+          "GET / HTTP/1.1\nHost: foo.bar\n\n",
+          "HTTP/1.1 200 OK\n\n--abcdef--\n\n"
+        )
+      ],
+      modules: %w(pcre),
+      config: """
+        ResponseBuffering On
+        InspectionEngineOptions all
+      """,
+      default_site_config: <<-EOS
+        RuleEngineStreamOverlap 8
+        StreamInspect RESPONSE_BODY_STREAM @rx "abcdef" id:1 rev:1 clipp_announce:overlap_match
+      EOS
+    )
+
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: overlap_match/
+  end
+
+  def test_core_rule_stream_overlap_dfa
+    clipp(
+      consumer: 'ironbee:IRONBEE_CONFIG @splitdata:4',
+      input_hashes: [
+        simple_hash(
+          "GET / HTTP/1.1\nHost: foo.bar\n\n",
+          "HTTP/1.1 200 OK\n\n--abcd--\n\n"
+        )
+      ],
+      modules: %w(pcre),
+      config: """
+        ResponseBuffering On
+        InspectionEngineOptions all
+      """,
+      default_site_config: <<-EOS
+        RuleEngineStreamOverlap 2
+        StreamInspect RESPONSE_BODY_STREAM @dfa "abcd" id:1 rev:1 clipp_announce:dfa_match
+        StreamInspect RESPONSE_BODY_STREAM @dfa "abab" id:2 rev:1 clipp_announce:dfa_repeat
+      EOS
+    )
+
+    # @dfa keeps its own state, so it is not given the overlap twice.
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: dfa_match/
+    assert_log_no_match /CLIPP ANNOUNCE: dfa_repeat/
+  end
+
+  def test_core_rule_lazy_contexts
+    clipp(
+      config: '''
+        RuleEngineLazyContexts On
+        InitVar A1 1
+        InitVar A2 2
+        Rule A1 @clipp_print "A1" id:r1 rev:1 tag:lazy/1 phase:REQUEST
+        Rule A2 @clipp_print "A2" id:r2 rev:1 tag:lazy/2 phase:REQUEST
+      ''',
+      default_site_config: <<-EOS,
+        RuleEnable "tag:lazy/1"
+        Rule A2 @clipp_print "S2" id:s2 rev:1 phase:REQUEST
+      EOS
+      config_trailer: <<-EOS
+        Rule A1 @clipp_print "A3" id:r3 rev:1 tag:lazy/1 phase:REQUEST
+      EOS
+    ) do
+      transaction do |t|
+        t.request(raw: "GET / HTTP/1.1\nHost: foo.bar\n\n")
+        t.response(raw: "HTTP/1.1 200 OK")
+      end
+      transaction do |t|
+        t.request(raw: "GET / HTTP/1.1\nHost: foo.bar\n\n")
+        t.response(raw: "HTTP/1.1 200 OK")
+      end
+    end
+
+    assert_no_issues
+    assert_log_match /clipp_print \[A1\]: 1/
+    assert_log_no_match /clipp_print \[A2\]/
+    assert_log_match /clipp_print \[S2\]: 2/
+    # Rules added to the main context after the site are not enabled in it.
+    assert_log_no_match /clipp_print \[A3\]/
+  end
+
   def test_core_logwrite_dir
     clipp(
       input: 'echo:',
@@ -22,14 +22,19 @@
 
 #include <gtest/gtest.h>
 #include <config-parser.h>
+#include <ironbee/artifact.h>
 #include <ironbee/config.h>
 #include <ironbee/mm_mpool_lite.h>
 #include "base_fixture.h"
 #include "mock_module.h"
 
+#include <cstdio>
+#include <sstream>
 #include <string>
 #include <utility>
 
+#include <unistd.h>
+
 using std::string;
 
 /////////////////////////////// Fixture ///////////////////////////////
@@ -210,6 +215,131 @@ INSTANTIATE_TEST_CASE_P(
         "Huge.config"
     ));
 
+/////////////////////////////// Snapshots ///////////////////////////////
+
+class SnapshotTest : public TestConfig
+{
+    public:
+
+    /**
+     * Assert that two parse trees have the same directives.
+     */
+    static void ExpectSameTree(
+        const ib_cfgparser_node_t *a,
+        const ib_cfgparser_node_t *b
+    )
+    {
+        const ib_list_node_t *node_a;
+        const ib_list_node_t *node_b;
+
+        EXPECT_EQ(a->type, b->type);
+        EXPECT_STREQ(a->directive, b->directive);
+        EXPECT_STREQ(a->file, b->file);
+        EXPECT_EQ(a->line, b->line);
+        ASSERT_EQ(ib_list_elements(a->params), ib_list_elements(b->params));
+        for (
+            node_a = ib_list_first_const(a->params),
+            node_b = ib_list_first_const(b->params);
+            node_a != NULL;
+            node_a = ib_list_node_next_const(node_a),
+            node_b = ib_list_node_next_const(node_b)
+        )
+        {
+            EXPECT_STREQ(
+                reinterpret_cast<const char *>(
+                    ib_list_node_data_const(node_a)),
+                reinterpret_cast<const char *>(
+                    ib_list_node_data_const(node_b)));
+        }
+        ASSERT_EQ(
+            ib_list_elements(a->children),
+            ib_list_elements(b->children));
+        for (
+            node_a = ib_list_first_const(a->children),
+            node_b = ib_list_first_const(b->children);
+            node_a != NULL;
+            node_a = ib_list_node_next_const(node_a),
+            node_b = ib_list_node_next_const(node_b)
+        )
+        {
+            ExpectSameTree(
+                reinterpret_cast<const ib_cfgparser_node_t *>(
+                    ib_list_node_data_const(node_a)),
+                reinterpret_cast<const ib_cfgparser_node_t *>(
+                    ib_list_node_data_const(node_b)));
+        }
+    }
+};
+
+TEST_F(SnapshotTest, ReparseUsesSnapshot) {
+    size_t count = ib_artifact_count();
+
+    ASSERT_EQ(IB_OK, configFile("Huge.config"));
+    ASSERT_EQ(count + 1, ib_artifact_count());
+
+    ASSERT_EQ(IB_OK, configFile("Huge.config"));
+    ASSERT_EQ(count + 1, ib_artifact_count());
+
+    const ib_list_t *files = GetParseTree()->children;
+    ASSERT_EQ(2U, ib_list_elements(files));
+    ExpectSameTree(
+        reinterpret_cast<const ib_cfgparser_node_t *>(
+            ib_list_node_data_const(ib_list_first_const(files))),
+        reinterpret_cast<const ib_cfgparser_node_t *>(
+            ib_list_node_data_const(ib_list_last_const(files))));
+}
+
+/////////////////////////////// Large Files ///////////////////////////////
+
+/* Tokens crossing read buffer boundaries, one node per directive. */
+TEST_F(TestConfig, LargeFile) {
+    const size_t directives = 4000;
+    char path[] = "/tmp/ironbee_config_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(-1, fd);
+
+    std::ostringstream text;
+    for (size_t i = 0; i < directives; ++i) {
+        text << "Directive" << i << " \"" << string(i % 97, 'x') << "\" "
+             << i << "\n";
+    }
+    const string s = text.str();
+    ASSERT_LT(2U * 65536U, s.length());
+    ASSERT_EQ(ssize_t(s.length()), write(fd, s.data(), s.length()));
+    close(fd);
+
+    ib_status_t rc = configFile(path);
+    unlink(path);
+    ASSERT_EQ(IB_OK, rc);
+
+    const ib_cfgparser_node_t *file =
+        reinterpret_cast<const ib_cfgparser_node_t *>(
+            ib_list_node_data_const(
+                ib_list_last_const(GetParseTree()->children)));
+    ASSERT_EQ(directives, ib_list_elements(file->children));
+
+    size_t i = 0;
+    const ib_list_node_t *node;
+    IB_LIST_LOOP_CONST(file->children, node) {
+        const ib_cfgparser_node_t *directive =
+            reinterpret_cast<const ib_cfgparser_node_t *>(
+                ib_list_node_data_const(node));
+        std::ostringstream name;
+        name << "Directive" << i;
+
+        EXPECT_EQ(name.str(), directive->directive);
+        EXPECT_EQ(i + 1, directive->line);
+        EXPECT_EQ(file->file, directive->file);
+        ASSERT_EQ(2U, ib_list_elements(directive->params));
+        EXPECT_EQ(
+            string(i % 97, 'x'),
+            reinterpret_cast<const char *>(
+                ib_list_node_data_const(
+                    ib_list_first_const(directive->params))));
+        ++i;
+    }
+}
+
 /////////////////////////////// Failing Parses ///////////////////////////////
 
 class FailingParseTest :
@@ -25,6 +25,7 @@
 #include <ironbee/action.h>
 #include <ironbee/server.h>
 #include <ironbee/engine.h>
+#include <ironbee/logevent.h>
 #include <ironbee/mm.h>
 #include <ironbee/string.h>
 #include <ironbee/var.h>
@@ -173,6 +174,24 @@ TEST_F(CoreActionTest, setVarMult) {
     ASSERT_EQ(2, n);
 }
 
+TEST_F(CoreActionTest, setVarCounter) {
+    ib_field_t *f;
+    ib_num_t n;
+    ib_float_t flt;
+
+    f = getVar("n");
+    ASSERT_TRUE(f);
+    ASSERT_EQ(IB_FTYPE_NUM, f->type);
+    ib_field_value(f, ib_ftype_num_out(&n));
+    ASSERT_EQ(2, n);
+
+    f = getVar("f");
+    ASSERT_TRUE(f);
+    ASSERT_EQ(IB_FTYPE_FLOAT, f->type);
+    ib_field_value(f, ib_ftype_float_out(&flt));
+    ASSERT_DOUBLE_EQ(4.5, flt);
+}
+
 /**
  * Do a larger integration test.
  */
@@ -216,3 +235,27 @@ TEST_F(CoreActionTest, DoubleUnSetFlag) {
     ASSERT_EQ(IB_OK, ib_tx_flags_unset(ib_tx, IB_TX_FINSPECT_RESBODY));
     ASSERT_FALSE(ib_tx->flags & IB_TX_FINSPECT_RESBODY);
 }
+
+TEST_F(CoreActionTest, logEventLimit) {
+    ib_list_t     *events;
+    ib_logevent_t *first;
+    ib_logevent_t *e;
+
+    ASSERT_EQ(IB_OK, ib_logevent_get_all(ib_tx, &events));
+    ASSERT_EQ(2U, ib_list_elements(events));
+    first = (ib_logevent_t *)ib_list_node_data(ib_list_first(events));
+    ASSERT_STREQ("First", first->msg);
+    ASSERT_EQ(1U, first->count);
+
+    /* A duplicate only counts; it does not take a slot. */
+    ASSERT_EQ(
+        IB_OK,
+        ib_logevent_create(
+            &e, ib_tx->mm, first->rule_id, first->type, first->rec_action,
+            first->confidence, first->severity, "%s", "First"
+        )
+    );
+    ASSERT_EQ(IB_OK, ib_logevent_add(ib_tx, e));
+    ASSERT_EQ(2U, ib_list_elements(events));
+    ASSERT_EQ(2U, first->count);
+}
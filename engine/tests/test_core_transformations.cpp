@@ -32,6 +32,8 @@
 
 #include "gtest/gtest.h"
 
+#include <string>
+
 #include "base_fixture.h"
 
 class TransformationTest : public BaseTransactionFixture
@@ -121,3 +123,138 @@ INSTANTIATE_TEST_CASE_P(
         "normalizePathWin"
     )
 );
+
+class TransformationInplaceTest :
+    public TransformationTest,
+    public ::testing::WithParamInterface<const char*>
+{
+};
+
+TEST_P(TransformationInplaceTest, MatchesExecute) {
+    static const char *inputs[] = {
+        "Hello World",
+        "  \t Mixed CASE \r\n spaces \t ",
+        "nospaces",
+        " \n\t ",
+        "A\t\tB  C\n\nD",
+        "a%20b+c%zz%4",
+        "%41+%4a%"
+    };
+    const char* tfn_name = GetParam();
+    const ib_transformation_t *tfn;
+    ib_transformation_inst_t  *tfn_inst;
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_transformation_lookup(ib_engine, IB_S2SL(tfn_name), &tfn)
+    );
+    ASSERT_TRUE(ib_transformation_has_inplace(tfn));
+    ASSERT_EQ(
+        IB_OK,
+        ib_transformation_inst_create(&tfn_inst, MainMM(), tfn, NULL)
+    );
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); ++i) {
+        ib_field_t         *fin;
+        const ib_field_t   *fout;
+        const ib_bytestr_t *bs;
+        std::string         buf(inputs[i]);
+        uint8_t            *data = reinterpret_cast<uint8_t *>(&buf[0]);
+        size_t              dlen = buf.length();
+
+        ASSERT_EQ(
+            IB_OK,
+            ib_field_create_bytestr_alias(
+                &fin,
+                MainMM(),
+                IB_S2SL("in"),
+                reinterpret_cast<const uint8_t *>(inputs[i]),
+                strlen(inputs[i])
+            )
+        );
+        ASSERT_EQ(
+            IB_OK,
+            ib_transformation_inst_execute(tfn_inst, MainMM(), fin, &fout)
+        );
+        ASSERT_EQ(IB_OK, ib_field_value(fout, ib_ftype_bytestr_out(&bs)));
+
+        ASSERT_EQ(
+            IB_OK,
+            ib_transformation_inst_execute_inplace(tfn_inst, &data, &dlen)
+        );
+        EXPECT_EQ(
+            std::string(
+                reinterpret_cast<const char *>(ib_bytestr_const_ptr(bs)),
+                ib_bytestr_length(bs)
+            ),
+            std::string(reinterpret_cast<const char *>(data), dlen)
+        ) << tfn_name << " of \"" << inputs[i] << "\"";
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(
+    InplaceTransformations,
+    TransformationInplaceTest,
+    ::testing::Values(
+        "lowercase",
+        "trimLeft",
+        "trimRight",
+        "trim",
+        "removeWhitespace",
+        "compressWhitespace",
+        "urlDecode"
+    )
+);
+
+TEST_F(TransformationTest, UrlDecodeNothingToDecode) {
+    const ib_transformation_t *tfn;
+    ib_transformation_inst_t  *tfn_inst;
+    ib_field_t                *fin;
+    const ib_field_t          *fout;
+    const ib_bytestr_t        *bs;
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_transformation_lookup(ib_engine, IB_S2SL("urlDecode"), &tfn)
+    );
+    ASSERT_EQ(
+        IB_OK,
+        ib_transformation_inst_create(&tfn_inst, MainMM(), tfn, NULL)
+    );
+
+    /* Values without escapes are passed through without a copy. */
+    ASSERT_EQ(
+        IB_OK,
+        ib_field_create_bytestr_alias(
+            &fin, MainMM(), IB_S2SL("in"),
+            reinterpret_cast<const uint8_t *>("/plain/path"), 11
+        )
+    );
+    ASSERT_EQ(
+        IB_OK,
+        ib_transformation_inst_execute(tfn_inst, MainMM(), fin, &fout)
+    );
+    EXPECT_EQ(fin, fout);
+
+    /* The prefix before the first escape is kept. */
+    ASSERT_EQ(
+        IB_OK,
+        ib_field_create_bytestr_alias(
+            &fin, MainMM(), IB_S2SL("in"),
+            reinterpret_cast<const uint8_t *>("/a/b%2Fc+d"), 10
+        )
+    );
+    ASSERT_EQ(
+        IB_OK,
+        ib_transformation_inst_execute(tfn_inst, MainMM(), fin, &fout)
+    );
+    ASSERT_NE(fin, fout);
+    ASSERT_EQ(IB_OK, ib_field_value(fout, ib_ftype_bytestr_out(&bs)));
+    EXPECT_EQ(
+        std::string("/a/b/c d"),
+        std::string(
+            reinterpret_cast<const char *>(ib_bytestr_const_ptr(bs)),
+            ib_bytestr_length(bs)
+        )
+    );
+}
@@ -312,3 +312,179 @@ TEST_F(TestIronBee, test_module_data)
     ASSERT_EQ(IB_OK, ib_tx_set_module_data(tx, module, NULL));
     ASSERT_EQ(IB_ENOENT, ib_tx_get_module_data(tx, module, &data));
 }
+
+TEST_F(TestIronBee, test_conn_pool_reuse)
+{
+    ib_conn_t *conn = NULL;
+    ib_tx_t *tx = NULL;
+    ib_mpool_t *mp;
+
+    ASSERT_EQ(IB_OK, ib_conn_create(ib_engine, &conn, NULL));
+    mp = conn->mp;
+    ASSERT_EQ(IB_OK, ib_tx_create(&tx, conn, NULL));
+    ib_tx_destroy(tx);
+    ib_conn_destroy(conn);
+    ASSERT_EQ(1U, ib_engine->conn_pool_count);
+
+    /* The pool of the destroyed connection is reused. */
+    ASSERT_EQ(IB_OK, ib_conn_create(ib_engine, &conn, NULL));
+    ASSERT_EQ(mp, conn->mp);
+    ASSERT_EQ(0U, ib_engine->conn_pool_count);
+    ASSERT_EQ(0U, conn->tx_count);
+    ASSERT_TRUE(conn->tx_first == NULL);
+
+    /* But not if it still has transactions. */
+    ASSERT_EQ(IB_OK, ib_tx_create(&tx, conn, NULL));
+    ib_conn_destroy(conn);
+    ASSERT_EQ(0U, ib_engine->conn_pool_count);
+}
+
+static ib_status_t count_conn_hook(
+    ib_engine_t *ib,
+    ib_conn_t   *conn,
+    ib_state_t   state,
+    void        *cbdata
+)
+{
+    ++*static_cast<int *>(cbdata);
+    return IB_OK;
+}
+
+TEST_F(TestIronBee, test_hook_profile)
+{
+    ib_conn_t               *conn = NULL;
+    ib_list_t               *profiles;
+    const ib_list_node_t    *node;
+    const ib_hook_profile_t *found = NULL;
+    int                      count = 0;
+
+    configureIronBee();
+    ASSERT_EQ(
+        IB_OK,
+        ib_hook_conn_register(
+            ib_engine, conn_opened_state, count_conn_hook, &count)
+    );
+
+    ASSERT_FALSE(ib_hook_profile_enabled(ib_engine));
+    ASSERT_EQ(IB_OK, ib_hook_profile_set(ib_engine, true));
+    ASSERT_TRUE(ib_hook_profile_enabled(ib_engine));
+
+    ASSERT_EQ(IB_OK, ib_conn_create(ib_engine, &conn, NULL));
+    ASSERT_EQ(IB_OK, ib_state_notify_conn_opened(ib_engine, conn));
+    ASSERT_EQ(1, count);
+    ASSERT_EQ(IB_OK, ib_hook_profile_set(ib_engine, false));
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_hook_profile_get(
+            ib_engine, ib_engine_mm_main_get(ib_engine), &profiles)
+    );
+    IB_LIST_LOOP_CONST(profiles, node) {
+        const ib_hook_profile_t *profile =
+            static_cast<const ib_hook_profile_t *>(
+                ib_list_node_data_const(node));
+        if (profile->module == NULL && profile->state == conn_opened_state) {
+            found = profile;
+        }
+    }
+    ASSERT_TRUE(found);
+    EXPECT_LE(1U, found->calls);
+
+    ib_hook_profile_reset(ib_engine);
+    ASSERT_EQ(
+        IB_OK,
+        ib_hook_profile_get(
+            ib_engine, ib_engine_mm_main_get(ib_engine), &profiles)
+    );
+    EXPECT_EQ(0U, ib_list_elements(profiles));
+
+    ib_conn_destroy(conn);
+}
+
+TEST_F(TestIronBee, test_engine_metrics)
+{
+    ib_conn_t *conn = NULL;
+    ib_tx_t *tx = NULL;
+    ib_engine_metrics_t metrics;
+
+    ib_engine_metrics_get(ib_engine, &metrics);
+    ASSERT_EQ(0U, metrics.conns_opened);
+    ASSERT_EQ(0U, metrics.txs_started);
+
+    ASSERT_EQ(IB_OK, ib_conn_create(ib_engine, &conn, NULL));
+    ASSERT_EQ(IB_OK, ib_tx_create(&tx, conn, NULL));
+    ib_engine_metrics_get(ib_engine, &metrics);
+    ASSERT_EQ(1U, metrics.conns_opened);
+    ASSERT_EQ(0U, metrics.conns_closed);
+    ASSERT_EQ(1U, metrics.txs_started);
+    ASSERT_EQ(0U, metrics.txs_finished);
+
+    tx->request_body_len = 10;
+    tx->response_body_len = 20;
+    tx->is_blocked = true;
+    ib_tx_destroy(tx);
+    ib_conn_destroy(conn);
+    ib_engine_metrics_get(ib_engine, &metrics);
+    ASSERT_EQ(1U, metrics.conns_closed);
+    ASSERT_EQ(1U, metrics.txs_finished);
+    ASSERT_EQ(1U, metrics.txs_blocked);
+    ASSERT_EQ(10U, metrics.request_body_bytes);
+    ASSERT_EQ(20U, metrics.response_body_bytes);
+}
+
+static ib_status_t async_work(void *cbdata)
+{
+    ++*static_cast<int *>(cbdata);
+    return IB_EAGAIN;
+}
+
+TEST_F(TestIronBee, test_tx_async)
+{
+    ib_conn_t *conn = NULL;
+    ib_tx_t *tx = NULL;
+    ib_tx_async_t *async = NULL;
+    ib_tx_async_t *pending = NULL;
+    int count = 0;
+    int *pending_count;
+
+    ASSERT_EQ(IB_OK, ib_conn_create(ib_engine, &conn, NULL));
+    ASSERT_EQ(IB_OK, ib_tx_create(&tx, conn, NULL));
+
+    ASSERT_EQ(IB_OK, ib_tx_async_start(tx, async_work, &count, &async));
+    ASSERT_EQ(IB_EAGAIN, ib_tx_async_wait(async));
+    ASSERT_TRUE(ib_tx_async_done(async));
+    ASSERT_EQ(IB_EAGAIN, ib_tx_async_wait(async));
+    ASSERT_EQ(1, count);
+
+    /* Work not waited for is finished before the transaction is gone. */
+    pending_count = static_cast<int *>(ib_mm_calloc(conn->mm, 1, sizeof(int)));
+    ASSERT_TRUE(pending_count);
+    ASSERT_EQ(
+        IB_OK,
+        ib_tx_async_start(tx, async_work, pending_count, &pending)
+    );
+    ib_tx_destroy(tx);
+    ASSERT_EQ(1, *pending_count);
+
+    ib_conn_destroy(conn);
+}
+
+TEST_F(TestIronBee, test_engine_intern)
+{
+    char buf[] = "tag/one";
+    const char *one = ib_engine_intern(ib_engine, "tag/one");
+    const char *two = ib_engine_intern(ib_engine, "tag/two");
+
+    ASSERT_TRUE(one);
+    ASSERT_TRUE(two);
+    EXPECT_STREQ("tag/one", one);
+    EXPECT_STREQ("tag/two", two);
+    EXPECT_NE(one, two);
+
+    /* Equal strings are the same copy, whatever they were interned from. */
+    EXPECT_EQ(one, ib_engine_intern(ib_engine, buf));
+    EXPECT_NE(static_cast<const char *>(buf), one);
+    EXPECT_EQ(two, ib_engine_intern(ib_engine, two));
+
+    EXPECT_FALSE(ib_engine_intern(ib_engine, NULL));
+}
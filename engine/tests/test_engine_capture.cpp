@@ -249,3 +249,44 @@ TEST_F(CaptureTest, collection_type)
     ASSERT_EQ(6U, ib_bytestr_length(bs));
     ASSERT_EQ(0, memcmp("value0", ib_bytestr_const_ptr(bs), 6));
 }
+
+TEST_F(CaptureTest, acquire_source)
+{
+    ib_status_t           rc;
+    ib_field_t           *ifield;
+    ib_field_t           *cfield;
+    ib_field_t           *sfield;
+    const ib_field_t     *tfield;
+    ib_var_source_t      *source;
+
+    rc = ib_var_source_acquire(
+        &source,
+        MainMM(),
+        ib_engine_var_config_get(ib_engine),
+        IB_S2SL(CAP_NAME)
+    );
+    ASSERT_EQ(IB_OK, rc);
+
+    rc = ib_capture_acquire_source(ib_tx, source, &sfield);
+    ASSERT_EQ(IB_OK, rc);
+    ASSERT_EQ(IB_FTYPE_LIST, sfield->type);
+
+    rc = CaptureBytestr(CAP_NAME, 0, "value0", &ifield);
+    ASSERT_EQ(IB_OK, rc);
+    rc = ib_capture_acquire(ib_tx, CAP_NAME, &cfield);
+    ASSERT_EQ(IB_OK, rc);
+    ASSERT_EQ(sfield, cfield);
+
+    /* Clearing and refilling reuses the collection. */
+    for (int i = 0; i < 3; ++i) {
+        rc = ib_capture_clear(sfield);
+        ASSERT_EQ(IB_OK, rc);
+        tfield = CaptureGet(CAP_NAME, 0);
+        ASSERT_FALSE(tfield);
+
+        rc = CaptureBytestr(CAP_NAME, 0, "value0", &ifield);
+        ASSERT_EQ(IB_OK, rc);
+        tfield = CaptureGet(CAP_NAME, 0);
+        ASSERT_EQ(ifield, tfield);
+    }
+}
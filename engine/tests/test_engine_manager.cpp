@@ -27,6 +27,9 @@
 
 #include <fstream>
 
+#include <pthread.h>
+#include <unistd.h>
+
 #include <ironbee/engine_manager.h>
 
 /**
@@ -200,3 +203,216 @@ TEST_F(EngineManager, MaxEngines)
 
     ib_manager_destroy(m_manager);
 }
+
+namespace {
+
+//! Shared state of AcquireWhileCreating threads.
+struct acquire_test_t {
+    ib_manager_t *manager;
+    volatile bool stop;
+    volatile int  failures;
+};
+
+extern "C" void *acquire_release_loop(void *data)
+{
+    acquire_test_t *test = reinterpret_cast<acquire_test_t *>(data);
+
+    while (! test->stop) {
+        ib_engine_t *engine;
+
+        if (ib_manager_engine_acquire(
+                test->manager,
+                IB_MANAGER_ENGINE_NAME_DEFAULT,
+                &engine) != IB_OK)
+        {
+            __sync_add_and_fetch(&(test->failures), 1);
+            continue;
+        }
+        if (ib_manager_engine_release(test->manager, engine) != IB_OK) {
+            __sync_add_and_fetch(&(test->failures), 1);
+        }
+    }
+
+    return NULL;
+}
+
+}
+
+TEST_F(EngineManager, AcquireWhileCreating)
+{
+    acquire_test_t test = { m_manager, false, 0 };
+    pthread_t      threads[4];
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_manager_engine_create(
+            m_manager,
+            IB_MANAGER_ENGINE_NAME_DEFAULT,
+            createIronBeeConfig().c_str()));
+
+    for (size_t i = 0; i < sizeof(threads) / sizeof(*threads); ++i) {
+        ASSERT_EQ(
+            0,
+            pthread_create(&threads[i], NULL, acquire_release_loop, &test));
+    }
+
+    /* Replace the engine while the threads acquire and release it. */
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT_EQ(
+            IB_OK,
+            ib_manager_engine_create(
+                m_manager,
+                IB_MANAGER_ENGINE_NAME_DEFAULT,
+                createIronBeeConfig().c_str()));
+    }
+
+    test.stop = true;
+    for (size_t i = 0; i < sizeof(threads) / sizeof(*threads); ++i) {
+        ASSERT_EQ(0, pthread_join(threads[i], NULL));
+    }
+    EXPECT_EQ(0, test.failures);
+
+    /* Only the current engine is left once the old ones are released. */
+    ASSERT_EQ(IB_OK, ib_manager_engine_cleanup(m_manager));
+    EXPECT_EQ(1U, ib_manager_engine_count(m_manager));
+
+    ib_manager_destroy(m_manager);
+}
+
+namespace {
+
+extern "C" void background_done(
+    ib_manager_t *manager,
+    const char   *name,
+    ib_status_t   rc,
+    void         *cbdata
+)
+{
+    __atomic_store_n(reinterpret_cast<int *>(cbdata), 1 + rc,
+                     __ATOMIC_SEQ_CST);
+}
+
+}
+
+TEST_F(EngineManager, CreateBackground)
+{
+    int          result = 0;
+    ib_engine_t *engine;
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_manager_engine_create_background(
+            m_manager,
+            IB_MANAGER_ENGINE_NAME_DEFAULT,
+            createIronBeeConfig().c_str(),
+            background_done,
+            &result));
+
+    while (__atomic_load_n(&result, __ATOMIC_SEQ_CST) == 0) {
+        usleep(1000);
+    }
+    ASSERT_EQ(1 + IB_OK, result);
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_manager_engine_acquire(
+            m_manager,
+            IB_MANAGER_ENGINE_NAME_DEFAULT,
+            &engine));
+    ASSERT_EQ(IB_OK, ib_manager_engine_release(m_manager, engine));
+
+    ib_manager_destroy(m_manager);
+}
+
+TEST_F(EngineManager, EngineCache)
+{
+    ib_manager_engine_cache_t *cache;
+    ib_engine_t               *engine1;
+    ib_engine_t               *engine2;
+    ib_engine_t               *engine3;
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_manager_engine_cache_create(
+            m_manager,
+            IB_MANAGER_ENGINE_NAME_DEFAULT,
+            &cache));
+    ASSERT_EQ(IB_DECLINED, ib_manager_engine_cache_acquire(cache, &engine1));
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_manager_engine_create(
+            m_manager,
+            IB_MANAGER_ENGINE_NAME_DEFAULT,
+            createIronBeeConfig().c_str()));
+    ASSERT_EQ(IB_OK, ib_manager_engine_cache_acquire(cache, &engine1));
+    ASSERT_EQ(IB_OK, ib_manager_engine_cache_acquire(cache, &engine2));
+    EXPECT_EQ(engine1, engine2);
+
+    /* A new engine is picked up; the old one stays until released. */
+    ASSERT_EQ(
+        IB_OK,
+        ib_manager_engine_create(
+            m_manager,
+            IB_MANAGER_ENGINE_NAME_DEFAULT,
+            createIronBeeConfig().c_str()));
+    ASSERT_EQ(IB_OK, ib_manager_engine_cache_acquire(cache, &engine3));
+    EXPECT_NE(engine1, engine3);
+    ASSERT_EQ(IB_OK, ib_manager_engine_cleanup(m_manager));
+    EXPECT_EQ(2U, ib_manager_engine_count(m_manager));
+
+    ASSERT_EQ(IB_OK, ib_manager_engine_cache_release(cache, engine1));
+    ASSERT_EQ(IB_OK, ib_manager_engine_cleanup(m_manager));
+    EXPECT_EQ(2U, ib_manager_engine_count(m_manager));
+    ASSERT_EQ(IB_OK, ib_manager_engine_cache_release(cache, engine2));
+    ASSERT_EQ(IB_OK, ib_manager_engine_cleanup(m_manager));
+    EXPECT_EQ(1U, ib_manager_engine_count(m_manager));
+
+    ASSERT_EQ(IB_OK, ib_manager_engine_cache_release(cache, engine3));
+    ib_manager_engine_cache_destroy(cache);
+
+    ib_manager_destroy(m_manager);
+}
+
+TEST_F(EngineManager, RetiredEngine)
+{
+    ib_engine_t *engine1;
+    ib_engine_t *engine2;
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_manager_engine_create(
+            m_manager,
+            IB_MANAGER_ENGINE_NAME_DEFAULT,
+            createIronBeeConfig().c_str()));
+    ASSERT_EQ(
+        IB_OK,
+        ib_manager_engine_acquire(
+            m_manager,
+            IB_MANAGER_ENGINE_NAME_DEFAULT,
+            &engine1));
+    EXPECT_FALSE(ib_manager_engine_retired(m_manager, engine1));
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_manager_engine_create(
+            m_manager,
+            IB_MANAGER_ENGINE_NAME_DEFAULT,
+            createIronBeeConfig().c_str()));
+    EXPECT_TRUE(ib_manager_engine_retired(m_manager, engine1));
+
+    /* The next acquisition destroys the released, retired engine. */
+    ASSERT_EQ(IB_OK, ib_manager_engine_release(m_manager, engine1));
+    EXPECT_EQ(2U, ib_manager_engine_count(m_manager));
+    ASSERT_EQ(
+        IB_OK,
+        ib_manager_engine_acquire(
+            m_manager,
+            IB_MANAGER_ENGINE_NAME_DEFAULT,
+            &engine2));
+    EXPECT_EQ(1U, ib_manager_engine_count(m_manager));
+    EXPECT_FALSE(ib_manager_engine_retired(m_manager, engine2));
+    ASSERT_EQ(IB_OK, ib_manager_engine_release(m_manager, engine2));
+
+    ib_manager_destroy(m_manager);
+}
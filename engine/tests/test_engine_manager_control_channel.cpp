@@ -282,3 +282,95 @@ TEST_F(EngMgrCtrlChanTest, diag_version)
 
     ASSERT_FALSE(boost::filesystem::exists("./tmp.sock"));
 }
+
+namespace {
+
+extern "C" ib_status_t long_cmd(
+    ib_mm_t      mm,
+    const char  *name,
+    const char  *args,
+    const char **result,
+    void        *cbdata
+)
+{
+    *result = reinterpret_cast<const char *>(cbdata);
+    return IB_OK;
+}
+
+}
+
+TEST_F(EngMgrCtrlChanTest, send_long_response)
+{
+    ib_engine_manager_control_channel_t* channel;
+    const char* response;
+
+    /* Responses of exactly one and of several message sizes. */
+    const size_t lengths[] = {
+        IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ,
+        IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ * 5 + 17
+    };
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_engine_manager_control_channel_create(
+            &channel,
+            MainMM(),
+            EngineManager()
+        )
+    );
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_engine_manager_control_channel_socket_path_set(channel, "./tmp.sock")
+    );
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_engine_manager_control_channel_start(channel)
+    );
+
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(*lengths); ++i) {
+        std::string expected(lengths[i], 'x');
+        expected[lengths[i] - 1] = 'y';
+
+        ASSERT_EQ(
+            IB_OK,
+            ib_engine_manager_control_cmd_register(
+                channel,
+                "long",
+                long_cmd,
+                const_cast<char *>(expected.c_str())
+            )
+        );
+
+        boost::packaged_task<ib_status_t> pt(
+            boost::bind(
+                ib_engine_manager_control_send,
+                "./tmp.sock",
+                "long",
+                MainMM(),
+                &response
+            )
+        );
+        boost::shared_future<ib_status_t> fut(pt.get_future());
+        boost::thread thr(boost::move(pt));
+
+        ASSERT_EQ(
+            IB_OK,
+            ib_engine_manager_control_recv(
+                channel,
+                true
+            )
+        );
+
+        thr.join();
+        ASSERT_EQ(IB_OK, fut.get());
+
+        EXPECT_EQ(expected, std::string(response));
+    }
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_engine_manager_control_channel_stop(channel)
+    );
+}
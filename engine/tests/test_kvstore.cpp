@@ -25,18 +25,27 @@ extern "C" {
 
 #include "util/kvstore_private.h"
 #include <ironbee/kvstore.h>
+#include <ironbee/kvstore_cache.h>
 #include <ironbee/kvstore_filesystem.h>
+#include <ironbee/kvstore_log.h>
+#include <ironbee/kvstore_shm.h>
+#include <ironbee/kvstore_writebehind.h>
 #include <ironbee/mm.h>
 #include <ironbee/util.h>
 #include <ironbee/uuid.h>
 #include <ironbee/mm_mpool.h>
 
 #include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 }
 
 #include "gtest/gtest.h"
 
+#include <string>
+
 
 class TestKVStore : public testing::Test
 {
@@ -170,3 +179,389 @@ TEST_F(TestKVStore, test_removes) {
 
     ASSERT_FALSE(result);
 }
+
+class TestKVStoreLog : public testing::Test
+{
+    public:
+
+    ib_kvstore_t kvstore;
+    ib_mpool_t *mp;
+    ib_mm_t mm;
+
+    virtual void SetUp() {
+        unlink("TestKVStoreLog.log");
+        ASSERT_EQ(IB_OK, ib_kvstore_log_init(&kvstore, "TestKVStoreLog.log"));
+        ASSERT_EQ(IB_OK, ib_kvstore_connect(&kvstore));
+        ib_mpool_create(&mp, "TestKVStoreLog", NULL);
+        mm = ib_mm_mpool(mp);
+    }
+
+    virtual void TearDown() {
+        ib_kvstore_destroy(&kvstore);
+        ib_mpool_destroy(mp);
+    }
+
+    ib_kvstore_key_t *key(const char *k) {
+        ib_kvstore_key_t *kv_key;
+
+        EXPECT_EQ(
+            IB_OK,
+            ib_kvstore_key_create(
+                &kv_key,
+                mm,
+                reinterpret_cast<const uint8_t *>(k), strlen(k)));
+        return kv_key;
+    }
+
+    ib_status_t set(ib_kvstore_t *store, const char *k, const char *v) {
+        ib_kvstore_value_t *val;
+
+        EXPECT_EQ(IB_OK, ib_kvstore_value_create(&val, mm));
+        ib_kvstore_value_value_set(
+            val,
+            reinterpret_cast<const uint8_t *>(v),
+            strlen(v));
+        ib_kvstore_value_type_set(val, "txt", 3);
+        ib_kvstore_value_expiration_set(val, 10 * 1000000LU);
+
+        return ib_kvstore_set(store, NULL, key(k), val);
+    }
+
+    std::string get(ib_kvstore_t *store, const char *k) {
+        ib_kvstore_value_t *result;
+        const uint8_t      *data;
+        size_t              data_length;
+
+        if (ib_kvstore_get(store, NULL, mm, key(k), &result) != IB_OK) {
+            return "";
+        }
+        ib_kvstore_value_value_get(result, &data, &data_length);
+        return std::string(reinterpret_cast<const char *>(data), data_length);
+    }
+};
+
+TEST_F(TestKVStoreLog, test_reads) {
+    ASSERT_EQ(IB_OK, set(&kvstore, "k1", "A key"));
+    ASSERT_EQ(IB_OK, set(&kvstore, "k1", "Another key"));
+    ASSERT_EQ(IB_OK, set(&kvstore, "k2", "B key"));
+
+    ASSERT_EQ("Another key", get(&kvstore, "k1"));
+    ASSERT_EQ("B key", get(&kvstore, "k2"));
+    ASSERT_EQ("", get(&kvstore, "k3"));
+}
+
+TEST_F(TestKVStoreLog, test_removes) {
+    ib_kvstore_value_t *result;
+
+    ASSERT_EQ(IB_OK, set(&kvstore, "k1", "A key"));
+    ASSERT_EQ(IB_OK, ib_kvstore_remove(&kvstore, key("k1")));
+    ASSERT_EQ(IB_ENOENT, ib_kvstore_get(&kvstore, NULL, mm, key("k1"), &result));
+    ASSERT_FALSE(result);
+}
+
+TEST_F(TestKVStoreLog, test_shared) {
+    ib_kvstore_t other;
+
+    ASSERT_EQ(IB_OK, ib_kvstore_log_init(&other, "TestKVStoreLog.log"));
+    ASSERT_EQ(IB_OK, ib_kvstore_connect(&other));
+
+    ASSERT_EQ(IB_OK, set(&kvstore, "k1", "A key"));
+    ASSERT_EQ("A key", get(&other, "k1"));
+    ASSERT_EQ(IB_OK, set(&other, "k1", "Another key"));
+    ASSERT_EQ("Another key", get(&kvstore, "k1"));
+
+    ib_kvstore_destroy(&other);
+}
+
+TEST_F(TestKVStoreLog, test_compaction) {
+    ib_kvstore_t other;
+    struct stat  sb;
+    char         value[64];
+
+    ASSERT_EQ(IB_OK, ib_kvstore_log_init(&other, "TestKVStoreLog.log"));
+    ASSERT_EQ(IB_OK, ib_kvstore_connect(&other));
+
+    /* Enough overwrites to make the log mostly dead several times. */
+    for (int i = 0; i < 50000; ++i) {
+        snprintf(value, sizeof(value), "value %d", i);
+        ASSERT_EQ(IB_OK, set(&kvstore, (i % 2 == 0) ? "k1" : "k2", value));
+    }
+
+    ASSERT_EQ(0, stat("TestKVStoreLog.log", &sb));
+    ASSERT_GT(1024 * 1024 * 2, sb.st_size);
+
+    /* The other store follows the log to its compacted replacement. */
+    ASSERT_EQ("value 49998", get(&other, "k1"));
+    ASSERT_EQ("value 49999", get(&other, "k2"));
+
+    ib_kvstore_destroy(&other);
+}
+
+class TestKVStoreCache : public TestKVStoreLog
+{
+    public:
+
+    ib_kvstore_t cache;
+
+    virtual void SetUp() {
+        TestKVStoreLog::SetUp();
+        ASSERT_EQ(IB_OK, ib_kvstore_cache_init(&cache, &kvstore, 2, 0));
+        ASSERT_EQ(IB_OK, ib_kvstore_connect(&cache));
+    }
+
+    virtual void TearDown() {
+        ib_kvstore_destroy(&cache);
+        TestKVStoreLog::TearDown();
+    }
+};
+
+TEST_F(TestKVStoreCache, test_write_through) {
+    ASSERT_EQ(IB_OK, set(&cache, "k1", "A key"));
+    ASSERT_EQ("A key", get(&kvstore, "k1"));
+    ASSERT_EQ("A key", get(&cache, "k1"));
+    ASSERT_EQ(IB_OK, set(&cache, "k1", "Another key"));
+    ASSERT_EQ("Another key", get(&cache, "k1"));
+
+    ASSERT_EQ(IB_OK, ib_kvstore_remove(&cache, key("k1")));
+    ASSERT_EQ("", get(&cache, "k1"));
+    ASSERT_EQ("", get(&kvstore, "k1"));
+}
+
+TEST_F(TestKVStoreCache, test_cached_until_evicted) {
+    ASSERT_EQ(IB_OK, set(&kvstore, "k1", "A key"));
+    ASSERT_EQ("A key", get(&cache, "k1"));
+    ASSERT_EQ("", get(&cache, "k2"));
+
+    /* Writes behind the cache's back are not seen... */
+    ASSERT_EQ(IB_OK, set(&kvstore, "k1", "Another key"));
+    ASSERT_EQ(IB_OK, set(&kvstore, "k2", "B key"));
+    ASSERT_EQ("A key", get(&cache, "k1"));
+    ASSERT_EQ("", get(&cache, "k2"));
+
+    /* ...until the least recently used key is evicted: k1, then k2. */
+    ASSERT_EQ("", get(&cache, "k3"));
+    ASSERT_EQ("Another key", get(&cache, "k1"));
+    ASSERT_EQ("B key", get(&cache, "k2"));
+}
+
+TEST_F(TestKVStoreCache, test_max_age) {
+    ib_kvstore_t aged;
+
+    ASSERT_EQ(IB_OK, ib_kvstore_cache_init(&aged, &kvstore, 2, 1));
+    ASSERT_EQ(IB_OK, set(&kvstore, "k1", "A key"));
+    ASSERT_EQ("A key", get(&aged, "k1"));
+    ASSERT_EQ(IB_OK, set(&kvstore, "k1", "Another key"));
+    usleep(10);
+    ASSERT_EQ("Another key", get(&aged, "k1"));
+
+    ib_kvstore_destroy(&aged);
+}
+
+class TestKVStoreWriteBehind : public TestKVStoreLog
+{
+    public:
+
+    ib_kvstore_t writebehind;
+
+    virtual void SetUp() {
+        TestKVStoreLog::SetUp();
+        ASSERT_EQ(IB_OK, ib_kvstore_writebehind_init(&writebehind, &kvstore, 4));
+        ASSERT_EQ(IB_OK, ib_kvstore_connect(&writebehind));
+    }
+
+    virtual void TearDown() {
+        ib_kvstore_destroy(&writebehind);
+        TestKVStoreLog::TearDown();
+    }
+};
+
+TEST_F(TestKVStoreWriteBehind, test_reads_queued) {
+    ASSERT_EQ(IB_OK, set(&writebehind, "k1", "A key"));
+    ASSERT_EQ("A key", get(&writebehind, "k1"));
+    ASSERT_EQ(IB_OK, ib_kvstore_remove(&writebehind, key("k1")));
+    ASSERT_EQ("", get(&writebehind, "k1"));
+    ASSERT_EQ(IB_OK, set(&writebehind, "k1", "Another key"));
+    ASSERT_EQ("Another key", get(&writebehind, "k1"));
+
+    ib_kvstore_writebehind_flush(&writebehind);
+    ASSERT_EQ("Another key", get(&kvstore, "k1"));
+}
+
+TEST_F(TestKVStoreWriteBehind, test_many_writes) {
+    char value[64];
+
+    /* More writes than may be queued, so writers wait for the thread. */
+    for (int i = 0; i < 1000; ++i) {
+        snprintf(value, sizeof(value), "value %d", i);
+        ASSERT_EQ(IB_OK, set(&writebehind, (i % 3 == 0) ? "k1" : "k2", value));
+    }
+    ASSERT_EQ(IB_OK, ib_kvstore_remove(&writebehind, key("k3")));
+
+    ASSERT_EQ("value 999", get(&writebehind, "k1"));
+    ASSERT_EQ("value 998", get(&writebehind, "k2"));
+
+    ib_kvstore_writebehind_flush(&writebehind);
+    ASSERT_EQ("value 999", get(&kvstore, "k1"));
+    ASSERT_EQ("value 998", get(&kvstore, "k2"));
+    ASSERT_EQ("", get(&kvstore, "k3"));
+}
+
+TEST_F(TestKVStoreWriteBehind, test_destroy_writes) {
+    ib_kvstore_t other;
+
+    ASSERT_EQ(IB_OK, ib_kvstore_writebehind_init(&other, &kvstore, 16));
+    ASSERT_EQ(IB_OK, set(&other, "k1", "A key"));
+    ib_kvstore_destroy(&other);
+
+    ASSERT_EQ("A key", get(&kvstore, "k1"));
+}
+
+TEST_F(TestKVStoreWriteBehind, test_fork) {
+    pid_t pid;
+    int   status;
+
+    /* Start the writer thread in this process and let it go idle. */
+    ASSERT_EQ(IB_OK, set(&writebehind, "k1", "A key"));
+    ib_kvstore_writebehind_flush(&writebehind);
+
+    pid = fork();
+    ASSERT_LE(0, pid);
+    if (pid == 0) {
+        /* The child writes with a thread of its own. */
+        alarm(30);
+        for (int i = 0; i < 100; ++i) {
+            if (set(&writebehind, "k2", "B key") != IB_OK) {
+                _exit(1);
+            }
+        }
+        ib_kvstore_writebehind_flush(&writebehind);
+        _exit(get(&kvstore, "k2") == "B key" ? 0 : 1);
+    }
+
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(0, WEXITSTATUS(status));
+
+    ASSERT_EQ(IB_OK, set(&writebehind, "k1", "Another key"));
+    ib_kvstore_writebehind_flush(&writebehind);
+    ASSERT_EQ("Another key", get(&kvstore, "k1"));
+}
+
+class TestKVStoreShm : public TestKVStoreLog
+{
+    public:
+
+    ib_kvstore_t shm;
+
+    virtual void SetUp() {
+        TestKVStoreLog::SetUp();
+        unlink("TestKVStoreShm.shm");
+        ASSERT_EQ(
+            IB_OK,
+            ib_kvstore_shm_init(&shm, "TestKVStoreShm.shm", 64, 128));
+        ASSERT_EQ(IB_OK, ib_kvstore_connect(&shm));
+    }
+
+    virtual void TearDown() {
+        ib_kvstore_destroy(&shm);
+        TestKVStoreLog::TearDown();
+    }
+};
+
+TEST_F(TestKVStoreShm, test_reads) {
+    ASSERT_EQ(IB_OK, set(&shm, "k1", "A key"));
+    ASSERT_EQ(IB_OK, set(&shm, "k1", "Another key"));
+    ASSERT_EQ(IB_OK, set(&shm, "k2", "B key"));
+    ASSERT_EQ(IB_OK, set(&shm, "k3", ""));
+
+    ASSERT_EQ("Another key", get(&shm, "k1"));
+    ASSERT_EQ("B key", get(&shm, "k2"));
+    ASSERT_EQ("", get(&shm, "k3"));
+    ASSERT_EQ("", get(&shm, "k4"));
+}
+
+TEST_F(TestKVStoreShm, test_removes) {
+    ib_kvstore_value_t *result;
+
+    ASSERT_EQ(IB_OK, set(&shm, "k1", "A key"));
+    ASSERT_EQ(IB_OK, ib_kvstore_remove(&shm, key("k1")));
+    ASSERT_EQ(IB_ENOENT, ib_kvstore_get(&shm, NULL, mm, key("k1"), &result));
+    ASSERT_FALSE(result);
+    ASSERT_EQ(IB_OK, ib_kvstore_remove(&shm, key("k2")));
+}
+
+TEST_F(TestKVStoreShm, test_shared) {
+    ib_kvstore_t other;
+
+    /* The geometry of the existing table is used. */
+    ASSERT_EQ(
+        IB_OK,
+        ib_kvstore_shm_init(&other, "TestKVStoreShm.shm", 1, 64));
+    ASSERT_EQ(IB_OK, ib_kvstore_connect(&other));
+
+    ASSERT_EQ(IB_OK, set(&shm, "k1", "A key"));
+    ASSERT_EQ("A key", get(&other, "k1"));
+    ASSERT_EQ(IB_OK, set(&other, "k1", "Another key"));
+    ASSERT_EQ("Another key", get(&shm, "k1"));
+    ASSERT_EQ(IB_OK, set(&other, "k2", "A value too long for slots of 64"));
+    ASSERT_EQ("A value too long for slots of 64", get(&shm, "k2"));
+
+    ib_kvstore_destroy(&other);
+}
+
+TEST_F(TestKVStoreShm, test_eviction) {
+    ib_kvstore_t small;
+    std::string  large(200, 'x');
+
+    unlink("TestKVStoreShm.small.shm");
+    ASSERT_EQ(
+        IB_OK,
+        ib_kvstore_shm_init(&small, "TestKVStoreShm.small.shm", 1, 128));
+    ASSERT_EQ(IB_OK, ib_kvstore_connect(&small));
+
+    /* A single slot holds only the latest key. */
+    ASSERT_EQ(IB_OK, set(&small, "k1", "A key"));
+    ASSERT_EQ(IB_OK, set(&small, "k2", "B key"));
+    ASSERT_EQ("", get(&small, "k1"));
+    ASSERT_EQ("B key", get(&small, "k2"));
+
+    /* Values that do not fit are rejected. */
+    ASSERT_EQ(IB_EINVAL, set(&small, "k3", large.c_str()));
+    ASSERT_EQ("B key", get(&small, "k2"));
+
+    ib_kvstore_destroy(&small);
+    unlink("TestKVStoreShm.small.shm");
+}
+
+TEST_F(TestKVStoreShm, test_concurrent_process) {
+    char  value[64];
+    pid_t pid;
+    int   status;
+
+    ASSERT_EQ(IB_OK, set(&shm, "k1", "value 0"));
+
+    pid = fork();
+    ASSERT_LE(0, pid);
+    if (pid == 0) {
+        for (int i = 1; i <= 20000; ++i) {
+            snprintf(value, sizeof(value), "value %d", i);
+            if (set(&shm, "k1", value) != IB_OK) {
+                _exit(1);
+            }
+        }
+        _exit(0);
+    }
+
+    /* Every read sees some whole value the other process wrote. */
+    for (int i = 0; i < 20000; ++i) {
+        std::string result = get(&shm, "k1");
+        ASSERT_LE(6U, result.length());
+        snprintf(value, sizeof(value), "value %d", atoi(result.c_str() + 6));
+        ASSERT_EQ(value, result);
+    }
+
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(0, WEXITSTATUS(status));
+    ASSERT_EQ("value 20000", get(&shm, "k1"));
+}
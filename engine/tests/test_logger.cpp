@@ -0,0 +1,390 @@
+//////////////////////////////////////////////////////////////////////////////
+// Licensed to Qualys, Inc. (QUALYS) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.
+// QUALYS licenses this file to You under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+/// @file
+/// @brief IronBee --- Logger Tests
+//////////////////////////////////////////////////////////////////////////////
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/logger.h>
+#include <ironbee/mm_mpool_lite.h>
+
+#include "gtest/gtest.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+//! Records written by a handler.
+struct written_t {
+    pthread_mutex_t          mutex;
+    std::vector<std::string> records;
+    int                      flushes;
+};
+
+extern "C" {
+    //! Format a record as a copy of its message.
+    ib_status_t copy_format(
+        ib_logger_t           *logger,
+        const ib_logger_rec_t *rec,
+        const uint8_t         *log_msg,
+        const size_t           log_msg_sz,
+        void                  *writer_record,
+        void                  *data
+    )
+    {
+        char *copy = strndup(reinterpret_cast<const char *>(log_msg),
+                             log_msg_sz);
+
+        if (copy == NULL) {
+            return IB_EALLOC;
+        }
+        *reinterpret_cast<char **>(writer_record) = copy;
+
+        return IB_OK;
+    }
+
+    //! Free a record made by copy_format().
+    void copy_free(ib_logger_t *logger, void *writer_record, void *data)
+    {
+        free(writer_record);
+    }
+
+    //! Append a record to a written_t.
+    void append_handler(void *element, void *cbdata)
+    {
+        written_t *written = reinterpret_cast<written_t *>(cbdata);
+
+        pthread_mutex_lock(&written->mutex);
+        written->records.push_back(reinterpret_cast<char *>(element));
+        pthread_mutex_unlock(&written->mutex);
+    }
+
+    //! Remember the writer to drain by hand; the data is its address.
+    ib_status_t hold_record(
+        ib_logger_t        *logger,
+        ib_logger_writer_t *writer,
+        void               *data
+    )
+    {
+        *reinterpret_cast<ib_logger_writer_t **>(data) = writer;
+
+        return IB_OK;
+    }
+
+    //! Count a flush of a written_t.
+    void count_flush(void *cbdata)
+    {
+        written_t *written = reinterpret_cast<written_t *>(cbdata);
+
+        pthread_mutex_lock(&written->mutex);
+        ++written->flushes;
+        pthread_mutex_unlock(&written->mutex);
+    }
+}
+
+//! A logger with one writer, asynchronous if requested.
+class LoggerTest : public ::testing::Test
+{
+public:
+    LoggerTest() :
+        m_mpl(NULL), m_logger(NULL), m_async(NULL), m_held(NULL)
+    {
+        pthread_mutex_init(&m_written.mutex, NULL);
+        m_written.flushes = 0;
+    }
+
+    ~LoggerTest()
+    {
+        if (m_mpl != NULL) {
+            ib_mpool_lite_destroy(m_mpl);
+        }
+        pthread_mutex_destroy(&m_written.mutex);
+    }
+
+    void SetUp()
+    {
+        ASSERT_EQ(IB_OK, ib_mpool_lite_create(&m_mpl));
+        ASSERT_EQ(
+            IB_OK,
+            ib_logger_create(&m_logger, IB_LOG_DEBUG,
+                             ib_mm_mpool_lite(m_mpl)));
+        ASSERT_EQ(
+            IB_OK,
+            ib_logger_format_create(m_logger, &m_format,
+                                    copy_format, NULL, copy_free, NULL));
+    }
+
+    //! Add a writer whose records are written by an ib_logger_async_t.
+    void addAsyncWriter()
+    {
+        ASSERT_EQ(
+            IB_OK,
+            ib_logger_async_create(&m_async, m_logger,
+                                   append_handler, count_flush, &m_written));
+        ASSERT_EQ(
+            IB_OK,
+            ib_logger_writer_add(m_logger, NULL, NULL, NULL, NULL, NULL, NULL,
+                                 m_format, ib_logger_async_record, m_async));
+    }
+
+    //! Add a writer whose records are only written by drain().
+    void addHeldWriter()
+    {
+        ASSERT_EQ(
+            IB_OK,
+            ib_logger_writer_add(m_logger, NULL, NULL, NULL, NULL, NULL, NULL,
+                                 m_format, hold_record, &m_held));
+    }
+
+    //! Write the records queued for the writer of addHeldWriter().
+    ib_status_t drain()
+    {
+        return ib_logger_dequeue(m_logger, m_held, append_handler,
+                                 &m_written);
+    }
+
+    //! Log the message @a i.
+    void log(int i)
+    {
+        ib_logger_log_va(m_logger, IB_LOGGER_ERRORLOG_TYPE,
+                         __FILE__, __func__, __LINE__,
+                         NULL, NULL, NULL, NULL, IB_LOG_INFO, "%d", i);
+    }
+
+    //! Log the message @a t:@a i.
+    void log(int t, int i)
+    {
+        ib_logger_log_va(m_logger, IB_LOGGER_ERRORLOG_TYPE,
+                         __FILE__, __func__, __LINE__,
+                         NULL, NULL, NULL, NULL, IB_LOG_INFO, "%d:%d", t, i);
+    }
+
+    //! Number of records written so far.
+    size_t written()
+    {
+        size_t n;
+
+        pthread_mutex_lock(&m_written.mutex);
+        n = m_written.records.size();
+        pthread_mutex_unlock(&m_written.mutex);
+
+        return n;
+    }
+
+protected:
+    ib_mpool_lite_t    *m_mpl;
+    ib_logger_t        *m_logger;
+    ib_logger_format_t *m_format;
+    ib_logger_async_t  *m_async;
+    ib_logger_writer_t *m_held;
+    written_t           m_written;
+};
+
+//! Number of records a writer can queue; LOGGER_RING_SIZE in logger.c.
+const int c_ring_size = 1024;
+
+//! A thread logging records through a LoggerTest.
+struct producer_t {
+    LoggerTest *test;   //!< Test to log through.
+    int         id;     //!< Prefix of the records.
+    int         count;  //!< Number of records to log.
+    volatile bool done; //!< Set once every record is logged.
+};
+
+extern "C" {
+    //! Log the records of a producer_t.
+    void *produce(void *data)
+    {
+        producer_t *producer = reinterpret_cast<producer_t *>(data);
+
+        for (int i = 0; i < producer->count; ++i) {
+            producer->test->log(producer->id, i);
+        }
+        producer->done = true;
+
+        return NULL;
+    }
+}
+
+} // Anonymous namespace
+
+TEST_F(LoggerTest, dequeue_order)
+{
+    addHeldWriter();
+
+    for (int i = 0; i < 10; ++i) {
+        log(i);
+    }
+    ASSERT_EQ(IB_OK, drain());
+
+    // Records come out in the order they were logged.
+    ASSERT_EQ(10U, m_written.records.size());
+    for (int i = 0; i < 10; ++i) {
+        char expected[16];
+
+        snprintf(expected, sizeof(expected), "%d", i);
+        EXPECT_EQ(expected, m_written.records[i]);
+    }
+
+    // Nothing is left to drain.
+    ASSERT_EQ(IB_OK, drain());
+    EXPECT_EQ(10U, m_written.records.size());
+}
+
+TEST_F(LoggerTest, dequeue_full)
+{
+    pthread_t  thread;
+    producer_t producer = { this, 1, 1, false };
+
+    addHeldWriter();
+
+    for (int i = 0; i < c_ring_size; ++i) {
+        log(i);
+    }
+
+    // The ring is full, so the next record waits for space.
+    ASSERT_EQ(0, pthread_create(&thread, NULL, produce, &producer));
+    usleep(100000);
+    EXPECT_FALSE(producer.done);
+
+    ASSERT_EQ(IB_OK, drain());
+    ASSERT_EQ(0, pthread_join(thread, NULL));
+    EXPECT_TRUE(producer.done);
+    ASSERT_EQ(IB_OK, drain());
+
+    // Nothing was lost and the waiting record came last.
+    ASSERT_EQ(c_ring_size + 1U, m_written.records.size());
+    for (int i = 0; i < c_ring_size; ++i) {
+        char expected[16];
+
+        snprintf(expected, sizeof(expected), "%d", i);
+        ASSERT_EQ(expected, m_written.records[i]);
+    }
+    EXPECT_EQ("1:0", m_written.records[c_ring_size]);
+}
+
+TEST_F(LoggerTest, async_producers)
+{
+    static const int c_producers = 8;
+    static const int c_records   = 2000;
+
+    pthread_t  threads[c_producers];
+    producer_t producers[c_producers];
+    int        next[c_producers] = { 0 };
+
+    addAsyncWriter();
+
+    for (int t = 0; t < c_producers; ++t) {
+        producer_t producer = { this, t, c_records, false };
+
+        producers[t] = producer;
+        ASSERT_EQ(0, pthread_create(&threads[t], NULL, produce,
+                                    &producers[t]));
+    }
+    for (int t = 0; t < c_producers; ++t) {
+        ASSERT_EQ(0, pthread_join(threads[t], NULL));
+    }
+    ib_logger_async_stop(m_async);
+
+    // Every record is written once, and each producer's in order.
+    ASSERT_EQ(size_t(c_producers * c_records), m_written.records.size());
+    for (size_t n = 0; n < m_written.records.size(); ++n) {
+        int t;
+        int i;
+
+        ASSERT_EQ(2, sscanf(m_written.records[n].c_str(), "%d:%d", &t, &i));
+        ASSERT_LE(0, t);
+        ASSERT_GT(c_producers, t);
+        ASSERT_EQ(next[t], i);
+        ++next[t];
+    }
+}
+
+TEST_F(LoggerTest, async)
+{
+    addAsyncWriter();
+
+    for (int i = 0; i < 3000; ++i) {
+        log(i);
+    }
+    ib_logger_async_stop(m_async);
+
+    // Stopping writes every queued record, in order.
+    ASSERT_EQ(3000U, m_written.records.size());
+    for (int i = 0; i < 3000; ++i) {
+        char expected[16];
+
+        snprintf(expected, sizeof(expected), "%d", i);
+        ASSERT_EQ(expected, m_written.records[i]);
+    }
+    EXPECT_LT(0, m_written.flushes);
+
+    // Once stopped, records are written by the caller.
+    log(3000);
+    EXPECT_EQ(3001U, m_written.records.size());
+}
+
+TEST_F(LoggerTest, async_fork)
+{
+    pid_t pid;
+    int   status;
+
+    addAsyncWriter();
+
+    // Start the writer thread in this process and let it go idle.
+    log(0);
+    for (int i = 0; i < 1000 && written() == 0; ++i) {
+        usleep(1000);
+    }
+    ASSERT_EQ(1U, written());
+
+    pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+        // The child has no thread of its own until it logs.  More records
+        // than a writer queue holds must not block it.
+        alarm(30);
+        m_written.records.clear();
+        for (int i = 0; i < 3000; ++i) {
+            log(i);
+        }
+        ib_logger_async_stop(m_async);
+        _exit(m_written.records.size() == 3000 ? 0 : 1);
+    }
+
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+
+    // The parent's thread is unaffected.
+    log(1);
+    ib_logger_async_stop(m_async);
+    EXPECT_EQ(2U, m_written.records.size());
+}
@@ -29,6 +29,7 @@
 #include <ironbee/engine.h>
 #include <ironbee/mm.h>
 #include <ironbee/field.h>
+#include <ironbee/var.h>
 #include "gtest/gtest.h"
 
 
@@ -163,6 +164,181 @@ TEST_F(OperatorTest, OperatorCallTest)
 }
 
 
+ib_status_t test_execute_batch_fn(
+    ib_tx_t                  *tx,
+    const ib_field_t * const *inputs,
+    size_t                    count,
+    uint8_t                  *matches,
+    void                     *instance_data,
+    void                     *cbdata
+)
+{
+    size_t *calls = (size_t *)cbdata;
+
+    ++*calls;
+    for (size_t i = 0; i < count; ++i) {
+        ib_num_t result;
+        ib_status_t rc;
+
+        rc = test_execute_fn(tx, inputs[i], NULL, &result, instance_data, NULL);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        if (result != 0) {
+            IB_OPERATOR_BATCH_SET(matches, i);
+        }
+    }
+
+    return IB_OK;
+}
+
+TEST_F(OperatorTest, OperatorBatchCallTest)
+{
+    ib_status_t status;
+    ib_operator_inst_t *opinst;
+    ib_operator_t *op;
+    size_t calls = 0;
+    ib_mm_t mm = ib_engine_mm_main_get(ib_engine);
+    const char *values[] = {
+        "data matching string",
+        "non matching string",
+        "more data",
+        "nothing",
+        "nothing",
+        "nothing",
+        "nothing",
+        "nothing",
+        "last data"
+    };
+    const size_t count = sizeof(values) / sizeof(*values);
+    const ib_field_t *inputs[count];
+    uint8_t matches[IB_OPERATOR_BATCH_BITMAP_SIZE(count)];
+
+    ASSERT_EQ(2UL, sizeof(matches));
+
+    for (size_t i = 0; i < count; ++i) {
+        ib_field_t *field;
+        status = ib_field_create(
+            &field,
+            mm,
+            IB_S2SL("testfield"),
+            IB_FTYPE_NULSTR,
+            ib_ftype_nulstr_in(values[i])
+        );
+        ASSERT_EQ(IB_OK, status);
+        inputs[i] = field;
+    }
+
+    status = ib_operator_create_and_register(
+        &op,
+        ib_engine,
+        "test_batch_op",
+        IB_OP_CAPABILITY_NONE,
+        test_create_fn, NULL,
+        NULL, NULL,
+        test_execute_fn, NULL
+    );
+    ASSERT_EQ(IB_OK, status);
+
+    status = ib_operator_inst_create(
+        &opinst,
+        mm,
+        ib_context_main(ib_engine),
+        op,
+        IB_OP_CAPABILITY_NONE,
+        "data"
+    );
+    ASSERT_EQ(IB_OK, status);
+
+    /* Without a batch function, each input is executed in turn. */
+    ASSERT_FALSE(ib_operator_has_execute_batch(op));
+    memset(matches, 0xff, sizeof(matches));
+    status = ib_operator_inst_execute_batch(
+        opinst, ib_tx, inputs, count, matches);
+    ASSERT_EQ(IB_OK, status);
+    EXPECT_EQ(0x05, matches[0]);
+    EXPECT_EQ(0x01, matches[1]);
+
+    /* With a batch function, it is called once for all inputs. */
+    ib_operator_set_execute_batch(op, test_execute_batch_fn, &calls);
+    ASSERT_TRUE(ib_operator_has_execute_batch(op));
+    memset(matches, 0xff, sizeof(matches));
+    status = ib_operator_inst_execute_batch(
+        opinst, ib_tx, inputs, count, matches);
+    ASSERT_EQ(IB_OK, status);
+    EXPECT_EQ(1UL, calls);
+    EXPECT_TRUE(IB_OPERATOR_BATCH_ISSET(matches, 0));
+    EXPECT_FALSE(IB_OPERATOR_BATCH_ISSET(matches, 1));
+    EXPECT_TRUE(IB_OPERATOR_BATCH_ISSET(matches, 2));
+    EXPECT_FALSE(IB_OPERATOR_BATCH_ISSET(matches, 7));
+    EXPECT_TRUE(IB_OPERATOR_BATCH_ISSET(matches, 8));
+
+    /* Errors are passed through. */
+    ib_field_t *num_field;
+    ib_num_t num = 5;
+    status = ib_field_create(
+        &num_field, mm, IB_S2SL("num"), IB_FTYPE_NUM, ib_ftype_num_in(&num));
+    ASSERT_EQ(IB_OK, status);
+    inputs[1] = num_field;
+    status = ib_operator_inst_execute_batch(
+        opinst, ib_tx, inputs, count, matches);
+    EXPECT_EQ(IB_EINVAL, status);
+}
+
+TEST_F(OperatorTest, OperatorAcquireTest)
+{
+    ib_operator_t *shared_op;
+    ib_operator_t *op;
+    ib_operator_inst_t *a;
+    ib_operator_inst_t *b;
+    ib_context_t *ctx = ib_context_main(ib_engine);
+
+    ASSERT_EQ(IB_OK, ib_operator_create_and_register(
+        &shared_op,
+        ib_engine,
+        "test_shared_op",
+        IB_OP_CAPABILITY_SHAREABLE,
+        test_create_fn, NULL,
+        NULL, NULL,
+        test_execute_fn, NULL
+    ));
+    ASSERT_EQ(IB_OK, ib_operator_create_and_register(
+        &op,
+        ib_engine,
+        "test_unshared_op",
+        IB_OP_CAPABILITY_NONE,
+        test_create_fn, NULL,
+        NULL, NULL,
+        test_execute_fn, NULL
+    ));
+
+    /* Equal parameters share an instance. */
+    ASSERT_EQ(IB_OK, ib_operator_inst_acquire(
+        &a, ctx, shared_op, IB_OP_CAPABILITY_NONE, "data"));
+    ASSERT_EQ(IB_OK, ib_operator_inst_acquire(
+        &b, ctx, shared_op, IB_OP_CAPABILITY_NONE, "data"));
+    EXPECT_EQ(a, b);
+    EXPECT_STREQ("data", ib_operator_inst_parameters(a));
+
+    ASSERT_EQ(IB_OK, ib_operator_inst_acquire(
+        &b, ctx, shared_op, IB_OP_CAPABILITY_NONE, "other"));
+    EXPECT_NE(a, b);
+    EXPECT_STREQ("other", ib_operator_inst_parameters(b));
+
+    /* Capabilities and create errors are still checked. */
+    EXPECT_EQ(IB_EINVAL, ib_operator_inst_acquire(
+        &b, ctx, shared_op, IB_OP_CAPABILITY_CAPTURE, "data"));
+    EXPECT_EQ(IB_EINVAL, ib_operator_inst_acquire(
+        &b, ctx, shared_op, IB_OP_CAPABILITY_NONE, "INVALID"));
+
+    /* Other operators get an instance each time. */
+    ASSERT_EQ(IB_OK, ib_operator_inst_acquire(
+        &a, ctx, op, IB_OP_CAPABILITY_NONE, "data"));
+    ASSERT_EQ(IB_OK, ib_operator_inst_acquire(
+        &b, ctx, op, IB_OP_CAPABILITY_NONE, "data"));
+    EXPECT_NE(a, b);
+}
+
 class CoreOperatorsTest : public BaseTransactionFixture
 {
     void SetUp()
@@ -218,6 +394,83 @@ TEST_F(CoreOperatorsTest, ContainsTest)
     EXPECT_EQ(0, call_result);
 }
 
+TEST_F(CoreOperatorsTest, ContainsExpansionTest)
+{
+    ib_status_t status;
+    ib_num_t call_result;
+    const ib_operator_t *op;
+    ib_operator_inst_t *constinst;
+    ib_operator_inst_t *expandinst;
+    ib_var_source_t *source;
+    ib_field_t *var;
+    ib_field_t *field;
+
+    status = ib_operator_lookup(ib_engine, IB_S2SL("contains"), &op);
+    ASSERT_EQ(IB_OK, status);
+
+    status = ib_operator_inst_create(
+        &constinst,
+        ib_engine_mm_main_get(ib_engine),
+        ib_context_main(ib_engine),
+        op,
+        IB_OP_CAPABILITY_NONE,
+        "needle"
+    );
+    ASSERT_EQ(IB_OK, status);
+    status = ib_operator_inst_create(
+        &expandinst,
+        ib_engine_mm_main_get(ib_engine),
+        ib_context_main(ib_engine),
+        op,
+        IB_OP_CAPABILITY_NONE,
+        "%{test_needle}"
+    );
+    ASSERT_EQ(IB_OK, status);
+
+    status = ib_var_source_acquire(
+        &source,
+        ib_tx->mm,
+        ib_engine_var_config_get(ib_engine),
+        IB_S2SL("test_needle")
+    );
+    ASSERT_EQ(IB_OK, status);
+    status = ib_field_create_bytestr_alias(
+        &var, ib_tx->mm, IB_S2SL("test_needle"),
+        reinterpret_cast<const uint8_t *>("needle"), 6
+    );
+    ASSERT_EQ(IB_OK, status);
+    status = ib_var_source_set(source, ib_tx->var_store, var);
+    ASSERT_EQ(IB_OK, status);
+
+    status = ib_field_create_bytestr_alias(
+        &field, ib_tx->mm, IB_S2SL("testfield"),
+        reinterpret_cast<const uint8_t *>("haystack with a needle"), 22
+    );
+    ASSERT_EQ(IB_OK, status);
+
+    status = ib_operator_inst_execute(
+        constinst, ib_tx, field, NULL, &call_result);
+    ASSERT_EQ(IB_OK, status);
+    EXPECT_EQ(1, call_result);
+    status = ib_operator_inst_execute(
+        expandinst, ib_tx, field, NULL, &call_result);
+    ASSERT_EQ(IB_OK, status);
+    EXPECT_EQ(1, call_result);
+
+    /* The expansion is evaluated for every execution. */
+    status = ib_field_create_bytestr_alias(
+        &var, ib_tx->mm, IB_S2SL("test_needle"),
+        reinterpret_cast<const uint8_t *>("pin"), 3
+    );
+    ASSERT_EQ(IB_OK, status);
+    status = ib_var_source_set(source, ib_tx->var_store, var);
+    ASSERT_EQ(IB_OK, status);
+    status = ib_operator_inst_execute(
+        expandinst, ib_tx, field, NULL, &call_result);
+    ASSERT_EQ(IB_OK, status);
+    EXPECT_EQ(0, call_result);
+}
+
 TEST_F(CoreOperatorsTest, EqTest)
 {
     ib_status_t status;
@@ -0,0 +1,452 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+/**
+ * @file
+ * @brief IronBee --- Rule Engine Execution Tests
+ */
+
+#include "gtest/gtest.h"
+#include "base_fixture.h"
+
+#include "engine_private.h"
+#include "rule_engine_private.h"
+
+#include <ironbee/action.h>
+#include <ironbee/bytestr.h>
+#include <ironbee/hash.h>
+#include <ironbee/list.h>
+#include <ironbee/rule_engine.h>
+
+#include <ctype.h>
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+//! Action that lowercases the byte string value of its rule in place.
+ib_status_t lowercase_value(
+    const ib_rule_exec_t *rule_exec,
+    void                 *instance_data,
+    void                 *cbdata
+)
+{
+    const ib_bytestr_t *bs;
+    uint8_t            *data;
+    ib_status_t         rc;
+
+    rc = ib_field_value(rule_exec->cur_value, ib_ftype_bytestr_out(&bs));
+    if (rc != IB_OK) {
+        return rc;
+    }
+    data = ib_bytestr_ptr(const_cast<ib_bytestr_t *>(bs));
+    for (size_t i = 0; i < ib_bytestr_length(bs); ++i) {
+        data[i] = tolower(data[i]);
+    }
+
+    return IB_OK;
+}
+
+//! Rules executed by test_program.
+struct program_trace_t
+{
+    //! Ids of the rules whose "trace" action ran, in order.
+    std::vector<std::string> ids;
+
+    //! Inject the context's rules, so they run without the program?
+    bool inject;
+};
+
+//! Action that records the id of its rule in a program_trace_t.
+ib_status_t trace_rule(
+    const ib_rule_exec_t *rule_exec,
+    void                 *instance_data,
+    void                 *cbdata
+)
+{
+    static_cast<program_trace_t *>(cbdata)->ids.push_back(
+        rule_exec->rule->meta.id);
+
+    return IB_OK;
+}
+
+/**
+ * Injection function that injects the runnable rules of the context, so
+ * that they are executed one by one instead of by the phase program.
+ */
+ib_status_t inject_context_rules(
+    const ib_engine_t    *ib,
+    const ib_rule_exec_t *rule_exec,
+    ib_list_t            *rule_list,
+    void                 *cbdata
+)
+{
+    const ib_ruleset_phase_t *phase;
+
+    if (! static_cast<program_trace_t *>(cbdata)->inject) {
+        return IB_OK;
+    }
+
+    phase = &(rule_exec->tx->ctx->rules->ruleset.phases[rule_exec->phase]);
+    for (size_t i = 0; i < phase->rule_count; ++i) {
+        ib_status_t rc = ib_list_push(
+            rule_list, const_cast<ib_rule_t *>(phase->rule_array[i]));
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    return IB_OK;
+}
+
+}
+
+class RuleExecTest : public BaseTransactionFixture
+{
+public:
+    /**
+     * Rule @a id, from the first context that registered it.
+     *
+     * ib_rule_lookup() only falls back to the main context, but the test
+     * rules are registered in sites and locations.
+     */
+    ib_rule_t *rule(const char *id)
+    {
+        const ib_list_node_t *node;
+
+        IB_LIST_LOOP_CONST(ib_engine->contexts, node) {
+            const ib_context_t *ctx =
+                static_cast<const ib_context_t *>(ib_list_node_data_const(node));
+            ib_rule_t          *rule;
+
+            if (
+                (ctx->rules != NULL) &&
+                (ib_hash_get(ctx->rules->rule_hash, &rule, id) == IB_OK)
+            ) {
+                return rule;
+            }
+        }
+        throw std::runtime_error("Failed to look up rule.");
+    }
+
+    //! Transformation chain id of the first target of rule @a id.
+    size_t tfnChainId(const char *id)
+    {
+        const ib_rule_target_t *target;
+
+        target = static_cast<const ib_rule_target_t *>(
+            ib_list_node_data_const(
+                ib_list_first_const(rule(id)->target_fields)));
+        return target->tfn_chain_id;
+    }
+
+    //! Set the adaptive ordering statistics of rule @a id.
+    void setOrderStats(const char *id, uint64_t time, uint64_t evals)
+    {
+        ib_rule_engine_t *rule_engine = ib_engine->rule_engine;
+        size_t            index = rule(id)->meta.index;
+
+        ASSERT_LT(index, rule_engine->order_stats_size);
+        rule_engine->order_stats[index].time = time;
+        rule_engine->order_stats[index].evals = evals;
+        rule_engine->order_stats[index].matches = 0;
+    }
+
+    /**
+     * The program of a phase as rule ids, with a "+" for each chained rule.
+     *
+     * Also checks that the rule array is in the same order.
+     */
+    std::string programOrder(const ib_ruleset_phase_t *phase)
+    {
+        std::ostringstream order;
+        size_t             rule_num = 0;
+
+        for (size_t i = 0; i < phase->program_length; ++i) {
+            const ib_rule_insn_t *insn = &(phase->program[i]);
+
+            if (i > 0) {
+                order << " ";
+            }
+            if (insn->opcode == IB_RULE_INSN_CHAIN) {
+                order << "+";
+                continue;
+            }
+            EXPECT_EQ(phase->rule_array[rule_num], insn->rule);
+            ++rule_num;
+            order << insn->rule->meta.id;
+        }
+        EXPECT_EQ(phase->rule_count, rule_num);
+
+        return order.str();
+    }
+
+    /**
+     * The runnable rules of phase @a phase_num of @a ctx as sorted
+     * "id:revision" strings.
+     */
+    std::string phaseRules(const ib_context_t *ctx,
+                           ib_rule_phase_num_t phase_num)
+    {
+        const ib_ruleset_phase_t *phase =
+            &(ctx->rules->ruleset.phases[phase_num]);
+        std::set<std::string>     rules;
+        std::string               result;
+
+        for (size_t i = 0; i < phase->rule_count; ++i) {
+            std::ostringstream rule;
+
+            rule << phase->rule_array[i]->meta.id << ":"
+                 << phase->rule_array[i]->meta.revision;
+            rules.insert(rule.str());
+        }
+        for (
+            std::set<std::string>::const_iterator i = rules.begin();
+            i != rules.end();
+            ++i
+        ) {
+            if (! result.empty()) {
+                result += " ";
+            }
+            result += *i;
+        }
+
+        return result;
+    }
+
+    /**
+     * Send the request and check the results of the parallel test rules.
+     *
+     * @returns Operator results used from parallel rule execution.
+     */
+    size_t parallelHits()
+    {
+        size_t hits;
+
+        ib_conn = buildIronBeeConnection();
+        ib_tx = buildIronBeeTransaction(ib_conn);
+        sendRequest();
+
+        // Results are the same however the operators were executed.
+        EXPECT_TRUE(getVar("hit1"));
+        EXPECT_TRUE(getVar("hit2"));
+        EXPECT_TRUE(getVar("hit4"));
+        EXPECT_THROW(getVar("miss"), std::runtime_error);
+
+        if (ib_tx->rule_exec == NULL) {
+            throw std::runtime_error("No rule execution object.");
+        }
+        hits = ib_tx->rule_exec->parallel_hits;
+
+        sendResponse();
+        ib_state_notify_conn_closed(ib_engine, ib_conn);
+
+        return hits;
+    }
+};
+
+TEST_F(RuleExecTest, test_tfn_cache)
+{
+    configureIronBee();
+
+    // Identical chains share an id; different chains do not.
+    EXPECT_NE(0UL, tfnChainId("1"));
+    EXPECT_EQ(tfnChainId("1"), tfnChainId("2"));
+    EXPECT_NE(tfnChainId("1"), tfnChainId("3"));
+
+    ib_conn = buildIronBeeConnection();
+    ib_tx = buildIronBeeTransaction(ib_conn);
+    sendRequest();
+
+    // Rule 2 reuses the result of rule 1; rule 3 runs its own chain.
+    ASSERT_TRUE(ib_tx->rule_exec);
+    EXPECT_EQ(1UL, ib_tx->rule_exec->tfn_cache_hits);
+    EXPECT_EQ(2UL, ib_tx->rule_exec->tfn_cache_misses);
+
+    sendResponse();
+    ib_state_notify_conn_closed(ib_engine, ib_conn);
+}
+
+TEST_F(RuleExecTest, test_program)
+{
+    static const ib_rule_phase_num_t phases[] = {
+        IB_PHASE_REQUEST_HEADER,
+        IB_PHASE_REQUEST
+    };
+    program_trace_t          trace;
+    std::vector<std::string> program_ids;
+    ib_ruleset_phase_t      *ruleset_phases[2];
+    size_t                   program_lengths[2];
+
+    trace.inject = false;
+    ASSERT_EQ(IB_OK, ib_action_create_and_register(
+        NULL, ib_engine, "trace",
+        NULL, NULL, NULL, NULL, trace_rule, &trace));
+    for (size_t i = 0; i < 2; ++i) {
+        ASSERT_EQ(IB_OK, ib_rule_register_injection_fn(
+            ib_engine, "test_program", phases[i],
+            inject_context_rules, &trace));
+    }
+    configureIronBee();
+
+    // With the phase programs.
+    performTx();
+    program_ids.swap(trace.ids);
+
+    // Without: the same rules are injected and executed one at a time with
+    // execute_phase_rule(), which recurses through chains.
+    for (size_t i = 0; i < 2; ++i) {
+        ruleset_phases[i] = &(rule("1")->ctx->rules->ruleset.phases[phases[i]]);
+        program_lengths[i] = ruleset_phases[i]->program_length;
+        ruleset_phases[i]->program_length = 0;
+    }
+    trace.inject = true;
+    performTx();
+    for (size_t i = 0; i < 2; ++i) {
+        ruleset_phases[i]->program_length = program_lengths[i];
+    }
+
+    EXPECT_EQ(trace.ids, program_ids);
+
+    // The stream rule ran, the chain of rule 2 ran to its end, the chain
+    // of rule 3 stopped after its first rule, rule 4 did not match and the
+    // immediate block of rule 6 ended the phase.
+    static const char *ran[] = { "s1", "1", "2/1", "2/2", "5", "6" };
+    static const char *skipped[] = { "3/2", "4", "7" };
+    for (size_t i = 0; i < sizeof(ran) / sizeof(*ran); ++i) {
+        EXPECT_NE(program_ids.end(),
+                  std::find(program_ids.begin(), program_ids.end(), ran[i]))
+            << ran[i];
+    }
+    for (size_t i = 0; i < sizeof(skipped) / sizeof(*skipped); ++i) {
+        EXPECT_EQ(program_ids.end(),
+                  std::find(program_ids.begin(), program_ids.end(),
+                            skipped[i]))
+            << skipped[i];
+    }
+    EXPECT_EQ("6", program_ids.back());
+}
+
+TEST_F(RuleExecTest, test_context_rules)
+{
+    configureIronBee();
+
+    ib_context_t *site = rule("1")->ctx;
+    ib_context_t *child = rule("4")->ctx;
+    ib_rule_t    *lookup;
+
+    ASSERT_NE(site, child);
+
+    // The child took its own copies when it changed its rules.
+    EXPECT_NE(site->rules->rule_list, child->rules->rule_list);
+    EXPECT_NE(site->rules->rule_hash, child->rules->rule_hash);
+    EXPECT_NE(site->rules->enable_list, child->rules->enable_list);
+
+    // The site is unchanged by the rules added, disabled and replaced by
+    // the child.
+    EXPECT_EQ("1:1 2:1 3:1", phaseRules(site, IB_PHASE_REQUEST_HEADER));
+    EXPECT_EQ(IB_ENOENT, ib_rule_lookup(ib_engine, site, "4", &lookup));
+    ASSERT_EQ(IB_OK, ib_rule_lookup(ib_engine, site, "3", &lookup));
+    EXPECT_EQ(1, lookup->meta.revision);
+
+    // The child sees its own edits on top of the site's rules.
+    EXPECT_EQ("1:1 3:2 4:1", phaseRules(child, IB_PHASE_REQUEST_HEADER));
+    EXPECT_EQ(IB_OK, ib_rule_lookup(ib_engine, child, "4", &lookup));
+    ASSERT_EQ(IB_OK, ib_rule_lookup(ib_engine, child, "3", &lookup));
+    EXPECT_EQ(2, lookup->meta.revision);
+}
+
+TEST_F(RuleExecTest, test_ordering)
+{
+    configureIronBee();
+
+    const ib_ruleset_phase_t *phase =
+        &(rule("1")->ctx->rules->ruleset.phases[IB_PHASE_REQUEST_HEADER]);
+    const ib_rule_insn_t     *program = phase->program;
+
+    ASSERT_TRUE(phase->order);
+    EXPECT_EQ("1 2 3 4 5/1 + 6 7", programOrder(phase));
+
+    // Rules 1 and 6 are far more expensive than 2 and 7.  None match, and
+    // each has the same match rate.
+    setOrderStats("1", 1000000000, 1000);
+    setOrderStats("2", 1000, 1000);
+    setOrderStats("6", 1000000000, 1000);
+    setOrderStats("7", 1000, 1000);
+
+    for (size_t i = 0; (i < 4096) && (phase->program == program); ++i) {
+        performTx();
+    }
+    ASSERT_NE(program, phase->program);
+
+    // Cheap rules move ahead of expensive ones, but not across rule 3,
+    // which sets a var, or the chain of rule 5, which stays in one piece.
+    EXPECT_EQ("2 1 3 4 5/1 + 7 6", programOrder(phase));
+    EXPECT_TRUE(rule("5/1")->chained_rule);
+}
+
+TEST_F(RuleExecTest, test_parallel)
+{
+    configureIronBee();
+
+    // The Host rules are executed ahead of time; REQUEST_METHOD is shorter
+    // than RuleEngineParallelMinSize.
+    EXPECT_EQ(3UL, parallelHits());
+}
+
+TEST_F(RuleExecTest, test_parallel_expand)
+{
+    configureIronBee();
+
+    // Rule 2 expands a var, so it is not executed ahead of time.
+    EXPECT_EQ(2UL, parallelHits());
+}
+
+TEST_F(RuleExecTest, test_parallel_min_size)
+{
+    configureIronBee();
+
+    // No value reaches RuleEngineParallelMinSize.
+    EXPECT_EQ(0UL, parallelHits());
+}
+
+TEST_F(RuleExecTest, test_parallel_rewrite)
+{
+    ASSERT_EQ(IB_OK, ib_action_create_and_register(
+        NULL, ib_engine, "lowercase_value",
+        NULL, NULL, NULL, NULL, lowercase_value, NULL));
+    configureIronBee();
+
+    ib_conn = buildIronBeeConnection();
+    ib_tx = buildIronBeeTransaction(ib_conn);
+    sendRequest();
+
+    // Rule 1 rewrites the Host header in place, so the results computed
+    // ahead of time for rules 2 and 3 are not used.
+    EXPECT_TRUE(getVar("hit1"));
+    EXPECT_THROW(getVar("hit2"), std::runtime_error);
+    EXPECT_THROW(getVar("miss"), std::runtime_error);
+    EXPECT_TRUE(getVar("hit4"));
+    ASSERT_TRUE(ib_tx->rule_exec);
+    EXPECT_EQ(1UL, ib_tx->rule_exec->parallel_hits);
+
+    sendResponse();
+    ib_state_notify_conn_closed(ib_engine, ib_conn);
+}
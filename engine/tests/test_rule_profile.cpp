@@ -0,0 +1,149 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Rule Engine Profile Tests
+ */
+
+#include "gtest/gtest.h"
+#include "base_fixture.h"
+
+#include <ironbee/list.h>
+#include <ironbee/rule_engine.h>
+
+class RuleProfileTest : public BaseTransactionFixture
+{
+};
+
+TEST_F(RuleProfileTest, test_profile)
+{
+    ib_list_t               *profiles;
+    const ib_rule_profile_t *profile;
+    const ib_rule_profile_t *lookup;
+    uint64_t                 count = 0;
+    size_t                   i;
+
+    configureIronBee();
+    performTx();
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_rule_profile_hot(
+            ib_engine, ib_engine_mm_main_get(ib_engine), 0, &profiles)
+    );
+    ASSERT_EQ(1UL, ib_list_elements(profiles));
+
+    profile = static_cast<const ib_rule_profile_t *>(
+        ib_list_node_data_const(ib_list_first_const(profiles)));
+    ASSERT_TRUE(profile->rule);
+    EXPECT_STREQ("1", profile->rule->meta.id);
+    EXPECT_EQ(1UL, profile->evaluations);
+    EXPECT_EQ(1UL, profile->matches);
+    EXPECT_LE(profile->max_time, ib_rule_profile_quantile(profile, 1.0));
+
+    for (i = 0; i < IB_RULE_PROFILE_BUCKETS; ++i) {
+        count += profile->histogram[i];
+    }
+    EXPECT_EQ(profile->evaluations, count);
+
+    ASSERT_EQ(IB_OK, ib_rule_profile_get(ib_engine, profile->rule, &lookup));
+    EXPECT_EQ(profile, lookup);
+
+    ASSERT_EQ(IB_OK, ib_rule_profile_hot(ib_engine, ib_engine_mm_main_get(ib_engine), 1, &profiles));
+    EXPECT_EQ(1UL, ib_list_elements(profiles));
+}
+
+TEST_F(RuleProfileTest, test_runtime)
+{
+    ib_list_t               *profiles;
+    const ib_rule_profile_t *profile;
+
+    configureIronBee();
+
+    // Not profiled until profiling is turned on.
+    EXPECT_FALSE(ib_rule_profile_enabled(ib_engine));
+    performTx();
+    ASSERT_EQ(
+        IB_OK,
+        ib_rule_profile_hot(
+            ib_engine, ib_engine_mm_main_get(ib_engine), 0, &profiles)
+    );
+    EXPECT_EQ(0UL, ib_list_elements(profiles));
+
+    ASSERT_EQ(IB_OK, ib_rule_profile_set(ib_engine, true));
+    EXPECT_TRUE(ib_rule_profile_enabled(ib_engine));
+    performTx();
+    ASSERT_EQ(IB_OK, ib_rule_profile_set(ib_engine, false));
+    performTx();
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_rule_profile_hot(
+            ib_engine, ib_engine_mm_main_get(ib_engine), 0, &profiles)
+    );
+    ASSERT_EQ(1UL, ib_list_elements(profiles));
+    profile = static_cast<const ib_rule_profile_t *>(
+        ib_list_node_data_const(ib_list_first_const(profiles)));
+    EXPECT_STREQ("1", profile->rule->meta.id);
+    EXPECT_EQ(1UL, profile->evaluations);
+
+    ib_rule_profile_reset(ib_engine);
+    ASSERT_EQ(
+        IB_OK,
+        ib_rule_profile_hot(
+            ib_engine, ib_engine_mm_main_get(ib_engine), 0, &profiles)
+    );
+    EXPECT_EQ(0UL, ib_list_elements(profiles));
+}
+
+TEST_F(RuleProfileTest, test_compare)
+{
+    ib_list_t               *profiles;
+    const ib_rule_profile_t *profile_a;
+    const ib_rule_profile_t *profile_b;
+    ib_rule_t               *rule;
+
+    configureIronBee();
+
+    // Transactions alternate between the two arms.
+    performTx();
+    performTx();
+    performTx();
+
+    ASSERT_EQ(IB_OK, ib_rule_lookup(ib_engine, NULL, "1", &rule));
+    ASSERT_EQ(
+        IB_OK,
+        ib_rule_compare_get(ib_engine, rule, &profile_a, &profile_b)
+    );
+    EXPECT_EQ(2UL, profile_a->evaluations);
+    EXPECT_EQ(2UL, profile_a->matches);
+    EXPECT_EQ(1UL, profile_b->evaluations);
+    EXPECT_EQ(1UL, profile_b->matches);
+    EXPECT_EQ(rule, profile_a->rule);
+    EXPECT_EQ(rule, profile_b->rule);
+
+    // Comparison does not turn on ordinary profiling.
+    ASSERT_EQ(
+        IB_OK,
+        ib_rule_profile_hot(
+            ib_engine, ib_engine_mm_main_get(ib_engine), 0, &profiles)
+    );
+    EXPECT_EQ(0UL, ib_list_elements(profiles));
+
+    ib_rule_compare_report(ib_engine, 0);
+}
@@ -535,6 +535,7 @@ TEST(TestVar, Target)
 
     rc = ib_var_target_acquire_from_string(&target, mm, config, "data:fooa", 9);
     ASSERT_EQ(IB_OK, rc);
+    EXPECT_FALSE(ib_var_target_is_trivial(target));
 
     rc = ib_var_target_get(target, &result, mm, store);
     ASSERT_EQ(IB_OK, rc);
@@ -544,6 +545,7 @@ TEST(TestVar, Target)
 
     rc = ib_var_target_acquire_from_string(&target, mm, config, "data", 4);
     ASSERT_EQ(IB_OK, rc);
+    EXPECT_TRUE(ib_var_target_is_trivial(target));
     rc = ib_var_target_get(target, &result, mm, store);
     ASSERT_EQ(IB_OK, rc);
     result_list = field_clist_t(result);
@@ -558,6 +560,86 @@ TEST(TestVar, Target)
     EXPECT_EQ("fooA", result_list.front().name_as_s());
 }
 
+TEST(TestVar, TargetFilterIndex)
+{
+    using namespace IronBee;
+
+    ScopedMemoryPool smp;
+    ib_status_t rc;
+    ib_mm_t mm = ib_mm_mpool(MemoryPool(smp).ib());
+    typedef List<IronBee::Field> field_list_t;
+    typedef ConstList<IronBee::Field> field_clist_t;
+    field_list_t data_list = field_list_t::create(smp);
+
+    /* Large enough to be indexed; every name appears twice. */
+    static const char *names[] = {
+        "key0", "key1", "key2", "key3", "key4",
+        "key5", "key6", "key7", "key8", "key9"
+    };
+    for (int i = 0; i < 20; ++i) {
+        data_list.push_back(
+            Field::create_number(smp, names[i % 10], 4, i)
+        );
+    }
+
+    Field data_field =
+        Field::create_no_copy_list<Field>(smp, "data", 4, data_list);
+
+    ib_var_config_t *config = make_config(mm);
+    ASSERT_TRUE(config);
+    ib_var_source_t *source = make_source(config, "data");
+    ASSERT_TRUE(source);
+    ib_var_store_t *store = make_store(config);
+    rc = ib_var_source_set(source, store, data_field.ib());
+    ASSERT_EQ(IB_OK, rc);
+
+    ib_var_target_t *target;
+    ib_var_target_t *target_none;
+    const ib_list_t *result = NULL;
+    field_clist_t result_list;
+
+    rc = ib_var_target_acquire_from_string(&target, mm, config, "data:KEY3", 9);
+    ASSERT_EQ(IB_OK, rc);
+    rc = ib_var_target_acquire_from_string(
+        &target_none, mm, config, "data:nokey", 10
+    );
+    ASSERT_EQ(IB_OK, rc);
+
+    /* Repeated lookups give the same answer, in list order. */
+    for (int i = 0; i < 3; ++i) {
+        rc = ib_var_target_get(target, &result, mm, store);
+        ASSERT_EQ(IB_OK, rc);
+        result_list = field_clist_t(result);
+        ASSERT_EQ(2UL, result_list.size());
+        EXPECT_EQ(3, result_list.front().value_as_number());
+        EXPECT_EQ(13, result_list.back().value_as_number());
+
+        rc = ib_var_target_get(target_none, &result, mm, store);
+        ASSERT_EQ(IB_OK, rc);
+        EXPECT_EQ(0UL, ib_list_elements(result));
+    }
+
+    /* Changes to the collection are seen by the next lookup. */
+    data_list.push_back(Field::create_number(smp, "Key3", 4, 20));
+    rc = ib_var_target_get(target, &result, mm, store);
+    ASSERT_EQ(IB_OK, rc);
+    result_list = field_clist_t(result);
+    ASSERT_EQ(3UL, result_list.size());
+    EXPECT_EQ(20, result_list.back().value_as_number());
+
+    rc = ib_var_target_get(target, &result, mm, store);
+    ASSERT_EQ(IB_OK, rc);
+    EXPECT_EQ(3UL, ib_list_elements(result));
+    rc = ib_var_target_get(target, &result, mm, store);
+    ASSERT_EQ(IB_OK, rc);
+    EXPECT_EQ(3UL, ib_list_elements(result));
+
+    data_list.clear();
+    rc = ib_var_target_get(target, &result, mm, store);
+    ASSERT_EQ(IB_OK, rc);
+    EXPECT_EQ(0UL, ib_list_elements(result));
+}
+
 TEST(TestVar, TargetRemoveTrivial)
 {
     using namespace IronBee;
@@ -1060,6 +1142,31 @@ TEST(TestVar, Expand)
         string(result, result_length)
     );
 
+    /* Lone targets. */
+    static const char *c_lone[][2] = {
+        { "%{a}", "17" },
+        { "%{c}", "foo" },
+        { "%{d}", "5, 6" },
+        { "%{d:fooB}", "6" }
+    };
+    for (size_t i = 0; i < sizeof(c_lone) / sizeof(*c_lone); ++i) {
+        expand = NULL;
+        rc = ib_var_expand_acquire(
+            &expand, mm, c_lone[i][0], strlen(c_lone[i][0]), config
+        );
+        ASSERT_EQ(IB_OK, rc);
+
+        result = NULL;
+        rc = ib_var_expand_execute(
+            expand,
+            &result, &result_length,
+            mm,
+            store
+        );
+        ASSERT_EQ(IB_OK, rc);
+        EXPECT_EQ(c_lone[i][1], string(result, result_length));
+    }
+
     expand = NULL;
     rc = ib_var_expand_acquire(&expand, mm, "", 0, config);
     ASSERT_EQ(IB_OK, rc);
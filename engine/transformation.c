@@ -65,6 +65,12 @@ struct ib_transformation_t {
 
     /*! Execute callback data. */
     void *execute_cbdata;
+
+    /*! In-place execution function; may be NULL. */
+    ib_transformation_inplace_fn_t inplace_fn;
+
+    /*! In-place callback data. */
+    void *inplace_cbdata;
 };
 
 struct ib_transformation_inst_t
@@ -113,12 +119,27 @@ ib_status_t ib_transformation_create(
     local_tfn->destroy_cbdata = destroy_cbdata;
     local_tfn->execute_fn     = execute_fn;
     local_tfn->execute_cbdata = execute_cbdata;
+    local_tfn->inplace_fn     = NULL;
+    local_tfn->inplace_cbdata = NULL;
 
     *tfn = local_tfn;
 
     return IB_OK;
 }
 
+void ib_transformation_inplace_set(
+    ib_transformation_t            *tfn,
+    ib_transformation_inplace_fn_t  inplace_fn,
+    void                           *inplace_cbdata
+)
+{
+    assert(tfn        != NULL);
+    assert(inplace_fn != NULL);
+
+    tfn->inplace_fn     = inplace_fn;
+    tfn->inplace_cbdata = inplace_cbdata;
+}
+
 ib_status_t ib_transformation_register(
     ib_engine_t               *ib,
     const ib_transformation_t *tfn
@@ -216,6 +237,15 @@ bool ib_transformation_handle_list(
     return tfn->handle_list;
 }
 
+bool ib_transformation_has_inplace(
+    const ib_transformation_t *tfn
+)
+{
+    assert(tfn != NULL);
+
+    return tfn->inplace_fn != NULL;
+}
+
 /*! Cleanup function to destroy transformation. */
 static
 void cleanup_tfn(
@@ -414,3 +444,30 @@ ib_status_t ib_transformation_inst_execute(
 
     return IB_OK;
 }
+
+ib_status_t ib_transformation_inst_execute_inplace(
+    const ib_transformation_inst_t  *tfn_inst,
+    uint8_t                        **data,
+    size_t                          *dlen
+)
+{
+    assert(tfn_inst != NULL);
+    assert(data     != NULL);
+    assert(dlen     != NULL);
+
+    const ib_transformation_t *tfn =
+        ib_transformation_inst_transformation(tfn_inst);
+
+    assert(tfn != NULL);
+
+    if (tfn->inplace_fn == NULL) {
+        return IB_ENOTIMPL;
+    }
+
+    return tfn->inplace_fn(
+        data,
+        dlen,
+        ib_transformation_inst_data(tfn_inst),
+        tfn->inplace_cbdata
+    );
+}
@@ -37,6 +37,33 @@
 
 /* types */
 
+/**
+ * Minimum number of elements of a collection before
+ * ib_var_target_get() indexes it for filters.
+ **/
+#define VAR_FILTER_INDEX_MIN 16
+
+/**
+ * Filter index of an indexed source value.
+ *
+ * The index maps subkeys of a (non-dynamic) collection to lists of the
+ * matching fields.  It is built on the second filtered lookup of an
+ * unchanged collection and discarded as soon as the collection changes.
+ **/
+typedef struct var_filter_index_t
+{
+    /** Value the index was built for. */
+    const ib_field_t *field;
+    /** List of @ref field when the index was built. */
+    const ib_list_t *list;
+    /** ib_list_version() of @ref list when the index was built. */
+    size_t version;
+    /** Subkey to matching fields.  NULL until built. Value: `ib_list_t *` */
+    ib_hash_t *hash;
+    /** Result for subkeys with no match.  NULL until needed. */
+    ib_list_t *empty;
+} var_filter_index_t;
+
 struct ib_var_config_t
 {
     /** Memory manager */
@@ -59,6 +86,10 @@ struct ib_var_store_t
     ib_hash_t *hash;
     /** Array of source index to value.  Value: `ib_field_t *` */
     ib_array_t *array;
+    /** Source index to filter index.  NULL until needed. */
+    var_filter_index_t **filter_index;
+    /** Number of elements of @ref filter_index. */
+    size_t filter_index_size;
 };
 
 struct ib_var_source_t
@@ -149,6 +180,13 @@ struct ib_var_expand_t
     size_t prefix_length;
     /** Target after prefix.  May be NULL. */
     const ib_var_target_t *target;
+    /**
+     * Source of @ref target if it is a trivial target (no filter).
+     *
+     * Trivial targets are read directly from the source at execution,
+     * without building a result list.
+     **/
+    const ib_var_source_t *source;
     /** Next expansion chunk. */
     ib_var_expand_t *next;
 };
@@ -282,8 +320,10 @@ ib_status_t ib_var_store_acquire(
         return IB_EALLOC;
     }
 
-    local_store->config = config;
-    local_store->mm     = mm;
+    local_store->config            = config;
+    local_store->mm                = mm;
+    local_store->filter_index      = NULL;
+    local_store->filter_index_size = 0;
 
     rc = ib_hash_create_nocase(&local_store->hash, mm);
     if (rc != IB_OK) {
@@ -952,6 +992,15 @@ ib_var_source_t *ib_var_target_source(
     return target->source;
 }
 
+bool ib_var_target_is_trivial(
+    const ib_var_target_t *target
+)
+{
+    assert(target != NULL);
+
+    return target->expand == NULL && target->filter == NULL;
+}
+
 ib_status_t ib_var_target_acquire_from_string(
     ib_var_target_t       **target,
     ib_mm_t                 mm,
@@ -1099,6 +1148,156 @@ ib_status_t ib_var_target_type(
     return IB_OK;
 }
 
+/**
+ * Apply a filter to the value of an indexed source using its filter index.
+ *
+ * The result is owned by @a store and must not be modified.  It remains
+ * valid, with the contents at the time of the call, for the lifetime of
+ * @a store.
+ *
+ * @param[in]  store  Var store.
+ * @param[in]  source Source of @a field.
+ * @param[in]  field  Value of @a source.
+ * @param[in]  filter Filter to apply.
+ * @param[out] result Fields of @a field matching @a filter.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_DECLINED if @a field is not (yet) indexed; use
+ *   ib_var_filter_apply().
+ * - IB_EALLOC on allocation failure.
+ **/
+static
+ib_status_t var_filter_index_apply(
+    ib_var_store_t         *store,
+    const ib_var_source_t  *source,
+    const ib_field_t       *field,
+    const ib_var_filter_t  *filter,
+    const ib_list_t       **result
+)
+{
+    assert(store  != NULL);
+    assert(source != NULL);
+    assert(field  != NULL);
+    assert(filter != NULL);
+    assert(result != NULL);
+
+    ib_status_t           rc;
+    const ib_list_t      *list;
+    var_filter_index_t   *index;
+    ib_list_t            *matches;
+    const ib_list_node_t *node;
+
+    if (
+        ! source->is_indexed ||
+        field->type != IB_FTYPE_LIST ||
+        ib_field_is_dynamic(field)
+    ) {
+        return IB_DECLINED;
+    }
+
+    rc = ib_field_value(field, ib_ftype_list_out(&list));
+    if (rc != IB_OK) {
+        return IB_DECLINED;
+    }
+    if (ib_list_elements(list) < VAR_FILTER_INDEX_MIN) {
+        return IB_DECLINED;
+    }
+
+    if (store->filter_index == NULL) {
+        store->filter_index = ib_mm_calloc(
+            store->mm,
+            store->config->next_index,
+            sizeof(*store->filter_index)
+        );
+        if (store->filter_index == NULL) {
+            return IB_EALLOC;
+        }
+        store->filter_index_size = store->config->next_index;
+    }
+    if (source->index >= store->filter_index_size) {
+        return IB_DECLINED;
+    }
+
+    index = store->filter_index[source->index];
+    if (index == NULL) {
+        index = ib_mm_calloc(store->mm, 1, sizeof(*index));
+        if (index == NULL) {
+            return IB_EALLOC;
+        }
+        store->filter_index[source->index] = index;
+    }
+
+    /* First lookup of this collection state: remember it, but do not build
+     * an index that may never be used again. */
+    if (
+        index->field   != field ||
+        index->list    != list  ||
+        index->version != ib_list_version(list)
+    ) {
+        index->field   = field;
+        index->list    = list;
+        index->version = ib_list_version(list);
+        index->hash    = NULL;
+        return IB_DECLINED;
+    }
+
+    if (index->hash == NULL) {
+        ib_hash_t *hash;
+
+        rc = ib_hash_create_nocase(&hash, store->mm);
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+        IB_LIST_LOOP_CONST(list, node) {
+            const ib_field_t *f =
+                (const ib_field_t *)ib_list_node_data_const(node);
+
+            rc = ib_hash_get_ex(hash, &matches, f->name, f->nlen);
+            if (rc == IB_ENOENT) {
+                rc = ib_list_create(&matches, store->mm);
+                if (rc != IB_OK) {
+                    return rc;
+                }
+                rc = ib_hash_set_ex(hash, f->name, f->nlen, matches);
+            }
+            if (rc != IB_OK) {
+                return rc;
+            }
+
+            /* Discard const because lists are const-generic. */
+            rc = ib_list_push(matches, (void *)f);
+            if (rc != IB_OK) {
+                return rc;
+            }
+        }
+
+        index->hash = hash;
+    }
+
+    rc = ib_hash_get_ex(
+        index->hash,
+        &matches,
+        filter->filter_string, filter->filter_string_length
+    );
+    if (rc == IB_ENOENT) {
+        if (index->empty == NULL) {
+            rc = ib_list_create(&index->empty, store->mm);
+            if (rc != IB_OK) {
+                return rc;
+            }
+        }
+        matches = index->empty;
+    }
+    else if (rc != IB_OK) {
+        return rc;
+    }
+
+    *result = matches;
+    return IB_OK;
+}
+
 ib_status_t ib_var_target_get(
     ib_var_target_t  *target,
     const ib_list_t **result,
@@ -1135,13 +1334,22 @@ ib_status_t ib_var_target_get(
     }
 
     if (filter != NULL) {
-        /* Filter list field. */
-        rc = ib_var_filter_apply(
+        /* Filter list field, by index if possible. */
+        rc = var_filter_index_apply(
+            store,
+            target->source,
+            field,
             filter,
-            &local_result,
-            mm,
-            field
+            &local_result
         );
+        if (rc == IB_DECLINED) {
+            rc = ib_var_filter_apply(
+                filter,
+                &local_result,
+                mm,
+                field
+            );
+        }
         if (rc != IB_OK) {
             return rc;
         }
@@ -1646,6 +1854,9 @@ ib_status_t ib_var_expand_acquire(
                 return rc;
             }
             current->target = target;
+            if (target->expand == NULL && target->filter == NULL) {
+                current->source = target->source;
+            }
 
             suffix = b + 1;
         }
@@ -1656,6 +1867,37 @@ ib_status_t ib_var_expand_acquire(
     return IB_OK;
 }
 
+/**
+ * Create the temporary memory pool of an expansion if not yet done.
+ *
+ * @param[in,out] mpl    Temporary memory pool; created if NULL.
+ * @param[out]    mpl_mm Memory manager of @a mpl.
+ *
+ * @return
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ **/
+static
+ib_status_t expand_temp_mm(
+    ib_mpool_lite_t **mpl,
+    ib_mm_t          *mpl_mm
+)
+{
+    assert(mpl    != NULL);
+    assert(mpl_mm != NULL);
+
+    if (*mpl == NULL) {
+        ib_status_t rc = ib_mpool_lite_create(mpl);
+        if (rc != IB_OK) {
+            assert(rc == IB_EALLOC);
+            return IB_EALLOC;
+        }
+        *mpl_mm = ib_mm_mpool_lite(*mpl);
+    }
+
+    return IB_OK;
+}
+
 ib_status_t ib_var_expand_execute(
     const ib_var_expand_t  *expand,
     const char            **dst,
@@ -1670,7 +1912,9 @@ ib_status_t ib_var_expand_execute(
     assert(store      != NULL);
 
     ib_status_t rc;
-    ib_sa_t *sa;
+    ib_sa_t *sa = NULL;
+    ib_mpool_lite_t *mpl = NULL;
+    ib_mm_t mpl_mm = IB_MM_NULL;
 
     /* Check for trivial case. */
     if (expand->next == NULL && expand->target == NULL) {
@@ -1679,22 +1923,40 @@ ib_status_t ib_var_expand_execute(
         return IB_OK;
     }
 
-    rc = ib_sa_begin(&sa);
-    if (rc != IB_OK) {
-        assert(rc == IB_EALLOC);
-        return IB_EALLOC;
+    /* A lone trivial target of a single value is converted directly. */
+    if (
+        expand->next == NULL &&
+        expand->prefix == NULL &&
+        expand->source != NULL
+    ) {
+        const ib_field_t *field;
+
+        rc = ib_var_source_get_const(expand->source, &field, store);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        if (field->type != IB_FTYPE_LIST) {
+            const char *value;
+            size_t value_length;
+
+            field_to_string(&value, &value_length, field, mm);
+            if (field->type == IB_FTYPE_BYTESTR && value_length > 0) {
+                value = ib_mm_memdup(mm, value, value_length);
+                if (value == NULL) {
+                    return IB_EALLOC;
+                }
+            }
+            *dst = value;
+            *dst_length = value_length;
+            return IB_OK;
+        }
     }
 
-    /* Construct temporary memory pool. */
-    ib_mpool_lite_t *mpl;
-    ib_mm_t mpl_mm;
-    rc = ib_mpool_lite_create(&mpl);
+    rc = ib_sa_begin(&sa);
     if (rc != IB_OK) {
         assert(rc == IB_EALLOC);
-        ib_sa_abort(&sa);
         return IB_EALLOC;
     }
-    mpl_mm = ib_mm_mpool_lite(mpl);
 
     for (
         const ib_var_expand_t *current = expand;
@@ -1706,16 +1968,50 @@ ib_status_t ib_var_expand_execute(
             if (rc != IB_OK) {goto finish_ealloc;}
         }
         if (current->target != NULL) {
-            const ib_list_t *result;
+            const ib_list_t *result = NULL;
+            const ib_field_t *single = NULL;
 
-            rc = ib_var_target_get_const(
-                current->target,
-                &result,
-                mpl_mm,
-                store
-            );
-            if (rc != IB_OK) {
-                goto finish;
+            /* Temporary allocations go to a pool created on first use;
+             * trivial targets of bytestrings never need it. */
+            if (current->source != NULL) {
+                rc = ib_var_source_get_const(current->source, &single, store);
+                if (rc != IB_OK) {
+                    goto finish;
+                }
+                if (single->type == IB_FTYPE_LIST) {
+                    rc = ib_field_value(single, ib_ftype_list_out(&result));
+                    if (rc != IB_OK) {
+                        goto finish;
+                    }
+                    single = NULL;
+                }
+            }
+            else {
+                rc = expand_temp_mm(&mpl, &mpl_mm);
+                if (rc != IB_OK) {goto finish_ealloc;}
+                rc = ib_var_target_get_const(
+                    current->target,
+                    &result,
+                    mpl_mm,
+                    store
+                );
+                if (rc != IB_OK) {
+                    goto finish;
+                }
+            }
+
+            if (single != NULL) {
+                const char *value;
+                size_t value_length;
+
+                if (single->type != IB_FTYPE_BYTESTR) {
+                    rc = expand_temp_mm(&mpl, &mpl_mm);
+                    if (rc != IB_OK) {goto finish_ealloc;}
+                }
+                field_to_string(&value, &value_length, single, mpl_mm);
+                rc = ib_sa_append(sa, value, value_length);
+                if (rc != IB_OK) {goto finish_ealloc;}
+                continue;
             }
 
             bool first = true;
@@ -1724,6 +2020,10 @@ ib_status_t ib_var_expand_execute(
                 const char *value;
                 size_t value_length;
                 const ib_field_t *field = ib_list_node_data_const(node);
+                if (field->type != IB_FTYPE_BYTESTR) {
+                    rc = expand_temp_mm(&mpl, &mpl_mm);
+                    if (rc != IB_OK) {goto finish_ealloc;}
+                }
                 field_to_string(&value, &value_length, field, mpl_mm);
                 if (first) {
                     first = false;
@@ -1751,7 +2051,9 @@ finish:
     if (sa != NULL) {
         ib_sa_abort(&sa);
     }
-    ib_mpool_lite_destroy(mpl);
+    if (mpl != NULL) {
+        ib_mpool_lite_destroy(mpl);
+    }
     return rc;
 }
 
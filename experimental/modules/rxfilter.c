@@ -19,21 +19,38 @@
  * @file
  * @brief Ironbee - regexp-based edits on Request and Response data streams
  *
- * NOTE: Although this module notionally supports unlimited
- *       numbers of regexps, it will collapse in an ungainly
- *       heap if different regexps produce overlapping matches.
- *       This should be fixed in due course!
+ * Each body chunk is appended to a window holding the unresolved end of
+ * the previous chunks.  Every regexp is run over the window with partial
+ * matching, so a match that may continue in the next chunk is held back
+ * rather than missed or cut short.  The full matches of all regexps are
+ * sorted by position, overlapping matches are dropped in favour of the
+ * earlier one, and the edits are passed to the server in stream order.
+ * Only the window from the earliest partial match on is kept, up to
+ * @ref MAX_BUFFER bytes; matches longer than that are not found.  At the
+ * end of the body the rest of the window is matched without partial
+ * matching.
+ *
+ * Replacement strings are split into literals and `$n` group references
+ * when the configuration is read.  Empty matches are ignored.
  */
 
-#include <assert.h>
-#include <ctype.h>
-#include <regex.h>
+#include "ironbee_config_auto.h"
+
+#include <ironbee/context.h>
 #include <ironbee/engine_state.h>
-#include <ironbee/array.h>
 #include <ironbee/module.h>
-#include <ironbee/context.h>
+#include <ironbee/server.h>
+
+#include <pcre.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
 
+/** Most bytes of unresolved data kept between chunks. */
 #define MAX_BUFFER 4096
+/** Number of capture groups, including the whole match. */
 #define MAX_RX_MATCH 10
 
 /** Module name. */
@@ -41,6 +58,9 @@
 /** Stringified version of MODULE_NAME */
 #define MODULE_NAME_STR    IB_XSTRINGIFY(MODULE_NAME)
 
+/* Regexp op definition */
+typedef struct rxop_t rxop_t;
+
 /* Configuration: array of regexp ops to apply to request and response data */
 typedef struct rxfilter_cfg_t rxfilter_cfg_t;
 struct rxfilter_cfg_t {
@@ -49,11 +69,25 @@ struct rxfilter_cfg_t {
     int flags;
 };
 
-/* Context for our filter: position, data buffer, error status */
+/* An edit found in the window, not yet passed to the server */
+typedef struct rxedit_t rxedit_t;
+struct rxedit_t {
+    size_t so;                      /* Start of match in window */
+    size_t eo;                      /* End of match in window */
+    size_t n;                       /* Index of the op; orders equal starts */
+    const rxop_t *rx;               /* The op */
+    int ovector[3 * MAX_RX_MATCH];  /* Groups of the match */
+};
+
+/* Context for our filter: window, edits, error status */
 typedef struct rxfilter_buffer_t rxfilter_buffer_t;
 struct rxfilter_buffer_t {
-    size_t offs;
-    ib_bytestr_t *data;
+    off_t offs;                 /* Stream offset of window[0] */
+    char *window;               /* Unresolved data and the current chunk */
+    size_t len;                 /* Bytes in window */
+    size_t size;                /* Bytes allocated for window */
+    rxedit_t *edits;            /* Scratch space for edits */
+    size_t edits_size;          /* Entries allocated for edits */
     ib_status_t errnum;
 };
 
@@ -64,89 +98,386 @@ struct rxfilter_ctx_t {
     rxfilter_buffer_t respbuf;
 };
 
-/* Regexp op definition */
-typedef struct rxop_t rxop_t;
+/* Piece of a replacement: a literal or, if len is 0, a group */
+typedef struct rxrepl_t rxrepl_t;
+struct rxrepl_t {
+    const char *lit;
+    size_t len;
+    int group;
+};
+
 struct rxop_t {
     enum { RX_SUBS, RX_AFTER, RX_BEFORE, RX_DELETE } rxtype;
-    regex_t rx;
-    const char *repl;
+    pcre *rx;
+    pcre_extra *extra;
+    rxrepl_t *repl;             /* Pieces of the replacement */
+    size_t nrepl;               /* Number of pieces */
 };
 
-/** Construct the replacement string for a regexp edit op
+/** Split a replacement string template into pieces
+ *
+ * `$n` refers to group n; a backslash escapes the next character.
  *
- * @param[in] mm - memory pool
- * @param[in] src - source data
- * @param[in] pmatch - regexp match
+ * @param[in] mm - memory manager
  * @param[in] repl - replacement string template
- * @param[out] repl_len - length of replacement string
- * @return replacement string
+ * @param[out] pieces - pieces of @a repl
+ * @param[out] npieces - number of pieces
+ * @return success or allocation error
  */
-static char *rx_repl(ib_mm_t mm, const char *src, regmatch_t pmatch[],
-                     const char *repl, size_t *repl_len)
+static ib_status_t rx_repl_parse(ib_mm_t mm, const char *repl,
+                                 rxrepl_t **pieces, size_t *npieces)
 {
+    rxrepl_t *ret;
+    size_t n = 0;
     const char *p;
-    char c;
+    char *lit;
+
+    /* There are at most as many pieces as characters */
+    ret = ib_mm_alloc(mm, (strlen(repl) + 1) * sizeof(*ret));
+    lit = ib_mm_alloc(mm, strlen(repl) + 1);
+    if (ret == NULL || lit == NULL) {
+        return IB_EALLOC;
+    }
+
+    for (p = repl; *p != '\0'; ++p) {
+        if (*p == '$' && isdigit(p[1])) {
+            ++p;
+            ret[n].lit = NULL;
+            ret[n].len = 0;
+            ret[n].group = *p - '0';
+            ++n;
+            continue;
+        }
+        if (*p == '\\' && p[1] != '\0') {
+            ++p;
+        }
+        if (n == 0 || ret[n - 1].len == 0) {
+            ret[n].lit = lit;
+            ret[n].len = 0;
+            ret[n].group = -1;
+            ++n;
+        }
+        *lit++ = *p;
+        ++ret[n - 1].len;
+    }
+
+    *pieces = ret;
+    *npieces = n;
+    return IB_OK;
+}
+
+/** Construct the replacement string for a regexp edit op
+ *
+ * @param[in] mm - memory manager
+ * @param[in] src - window the match is in
+ * @param[in] edit - the edit
+ * @param[out] repl_len - length of replacement string
+ * @return replacement string, or NULL on allocation error
+ */
+static char *rx_repl(ib_mm_t mm, const char *src, const rxedit_t *edit,
+                     size_t *repl_len)
+{
+    const rxop_t *rx = edit->rx;
+    const int *ov = edit->ovector;
     size_t len = 0;
-    int ch;
+    size_t i;
     char *ret;
     char *retp;
 
-    /* calculate length */
-    p = repl;
-    while (c = *p++, c != '\0') {
-        if (c == '$' && isdigit(*p)) {
-            ch = *p++ - '0';
+    for (i = 0; i < rx->nrepl; ++i) {
+        const rxrepl_t *r = &rx->repl[i];
+        if (r->len > 0) {
+            len += r->len;
         }
-        else {
-            ch = MAX_RX_MATCH;
+        else if (ov[2 * r->group] >= 0) {
+            len += ov[2 * r->group + 1] - ov[2 * r->group];
         }
+    }
+
+    /* Allocate at least one byte; the server gets a pointer either way */
+    retp = ret = ib_mm_alloc(mm, len + 1);
+    if (ret == NULL) {
+        return NULL;
+    }
 
-        if (ch < MAX_RX_MATCH) {
-            len += pmatch[ch].rm_eo - pmatch[ch].rm_so;
+    for (i = 0; i < rx->nrepl; ++i) {
+        const rxrepl_t *r = &rx->repl[i];
+        if (r->len > 0) {
+            memcpy(retp, r->lit, r->len);
+            retp += r->len;
         }
-        else {
-            if (c == '\\' && *p) {
-                ++p;
-            }
-            ++len;
+        else if (ov[2 * r->group] >= 0) {
+            size_t glen = ov[2 * r->group + 1] - ov[2 * r->group];
+            memcpy(retp, src + ov[2 * r->group], glen);
+            retp += glen;
         }
     }
+
     *repl_len = len;
-    retp = ret = ib_mm_alloc(mm, len);
+    return ret;
+}
 
-    /* now fill the buffer we just allocated */
-    p = repl;
-    while (c = *p++, c != '\0') {
-        if (c == '$' && isdigit(*p)) {
-            ch = *p++ - '0';
+/** Order edits by start, then by op */
+static int rxedit_cmp(const void *a, const void *b)
+{
+    const rxedit_t *ea = (const rxedit_t *)a;
+    const rxedit_t *eb = (const rxedit_t *)b;
+
+    if (ea->so != eb->so) {
+        return ea->so < eb->so ? -1 : 1;
+    }
+    if (ea->n != eb->n) {
+        return ea->n < eb->n ? -1 : 1;
+    }
+    return 0;
+}
+
+/** Add an edit to the scratch space, growing it if need be
+ *
+ * @param[in] mm - memory manager
+ * @param[in] rxbuf - filter context
+ * @param[in] nedits - edits already in @a rxbuf
+ * @return the new edit, or NULL on allocation error
+ */
+static rxedit_t *rxedit_add(ib_mm_t mm, rxfilter_buffer_t *rxbuf,
+                            size_t nedits)
+{
+    if (nedits == rxbuf->edits_size) {
+        size_t size = rxbuf->edits_size ? 2 * rxbuf->edits_size : 16;
+        rxedit_t *edits = ib_mm_alloc(mm, size * sizeof(*edits));
+        if (edits == NULL) {
+            return NULL;
         }
-        else {
-            ch = MAX_RX_MATCH;
+        if (nedits > 0) {
+            memcpy(edits, rxbuf->edits, nedits * sizeof(*edits));
+        }
+        rxbuf->edits = edits;
+        rxbuf->edits_size = size;
+    }
+    return &rxbuf->edits[nedits];
+}
+
+/**
+ * Match, edit and trim the window of one direction
+ *
+ * @param[in] tx - the transaction
+ * @param[in] dir - direction
+ * @param[in] rxbuf - filter context of @a dir
+ * @param[in] regexps - ops of @a dir
+ * @param[in] final - true at the end of the body
+ * @return success or error
+ */
+static ib_status_t rxfilter_window(ib_tx_t *tx,
+                                   ib_server_direction_t dir,
+                                   rxfilter_buffer_t *rxbuf,
+                                   ib_array_t *regexps,
+                                   bool final)
+{
+    const ib_server_t *svr = ib_engine_server_get(tx->ib);
+    const char *buf = rxbuf->window;
+    size_t len = rxbuf->len;
+    size_t keep = len;   /* Start of the data to keep for the next chunk */
+    size_t done = 0;     /* End of the last edit passed to the server */
+    size_t nedits = 0;
+    size_t nelts;
+    size_t i;
+    int options = PCRE_NOTEMPTY | (final ? 0 : PCRE_PARTIAL_HARD);
+    ib_status_t rc;
+
+    /* Find the full matches of every op and the earliest partial one */
+    nelts = ib_array_elements(regexps);
+    for (i = 0; i < nelts; ++i) {
+        const rxop_t *rx;
+        size_t pos = 0;
+
+        rc = ib_array_get(regexps, i, &rx);
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+        while (pos < len) {
+            rxedit_t *edit = rxedit_add(tx->mm, rxbuf, nedits);
+            int rv;
+
+            if (edit == NULL) {
+                return IB_EALLOC;
+            }
+            rv = pcre_exec(rx->rx, rx->extra, buf, len, pos, options,
+                           edit->ovector, 3 * MAX_RX_MATCH);
+            if (rv == PCRE_ERROR_PARTIAL) {
+                if ((size_t)edit->ovector[0] < keep) {
+                    keep = edit->ovector[0];
+                }
+                break;
+            }
+            if (rv == PCRE_ERROR_NOMATCH) {
+                break;
+            }
+            if (rv < 0) {
+                ib_log_error_tx(tx, "regexp error: %d", rv);
+                break;
+            }
+            if (rv == 0) {
+                /* More groups than fit; the rest are unset */
+                rv = MAX_RX_MATCH;
+            }
+            for (; rv < MAX_RX_MATCH; ++rv) {
+                edit->ovector[2 * rv] = edit->ovector[2 * rv + 1] = -1;
+            }
+
+            edit->so = edit->ovector[0];
+            edit->eo = edit->ovector[1];
+            edit->n = i;
+            edit->rx = rx;
+            ++nedits;
+            pos = edit->eo;
         }
+    }
+
+    /* Hold back data a partial match may need, but no more than
+     * MAX_BUFFER bytes of it */
+    if (len - keep > MAX_BUFFER) {
+        keep = len - MAX_BUFFER;
+    }
 
-        if (ch < MAX_RX_MATCH) {
-            len = pmatch[ch].rm_eo - pmatch[ch].rm_so;
-            memcpy(retp, src + pmatch[ch].rm_so, len);
-            retp += len;
+    /* Pass edits to the server in stream order.  Matches starting in the
+     * kept data are found again with the next chunk; matches overlapping
+     * an earlier edit are dropped. */
+    qsort(rxbuf->edits, nedits, sizeof(*rxbuf->edits), rxedit_cmp);
+    for (i = 0; i < nedits; ++i) {
+        const rxedit_t *edit = &rxbuf->edits[i];
+        const char *repl = NULL;
+        size_t repl_len = 0;
+        off_t start;
+        size_t delbytes;
+
+        if (edit->so >= keep) {
+            break;
         }
-        else {
-            if (c == '\\' && *p) {
-                c = *++p;
+        if (edit->so < done) {
+            continue;
+        }
+
+        if (edit->rx->rxtype != RX_DELETE) {
+            repl = rx_repl(tx->mm, buf, edit, &repl_len);
+            if (repl == NULL) {
+                return IB_EALLOC;
             }
-            *retp++ = c;
         }
+        if (edit->rx->rxtype == RX_AFTER) {
+            start = rxbuf->offs + edit->eo;
+        }
+        else {
+            start = rxbuf->offs + edit->so;
+        }
+        if (edit->rx->rxtype == RX_AFTER || edit->rx->rxtype == RX_BEFORE) {
+            delbytes = 0;
+        }
+        else {
+            delbytes = edit->eo - edit->so;
+        }
+
+        rc = ib_server_body_edit(svr, tx, dir, start, delbytes,
+                                 repl, repl_len);
+        if (rc != IB_OK) {
+            /* FIXME - should probably be nonfatal.
+             * But we want to avoid huge reams of NOTIMPL
+             */
+            ib_log_error_tx(tx, "Edit error %d - aborting", rc);
+            return rc;
+        }
+        done = edit->eo;
     }
 
-    return ret;
+    /* The kept data may not reach back into an edit already made */
+    if (done > keep) {
+        keep = done;
+    }
+    if (final) {
+        keep = len;
+    }
+
+    /* Now forget keep bytes, keep the rest for the next chunk */
+    memmove(rxbuf->window, rxbuf->window + keep, len - keep);
+    rxbuf->len = len - keep;
+    rxbuf->offs += keep;
+
+    return IB_OK;
+}
+
+/**
+ * Get the filter context of @a tx, creating it on first use
+ *
+ * @param[in] tx - the transaction
+ * @param[in] m - this module
+ * @return filter context, or NULL on allocation error
+ */
+static rxfilter_ctx_t *rxfilter_ctx_get(ib_tx_t *tx, const ib_module_t *m)
+{
+    rxfilter_ctx_t *ctx = NULL;
+    ib_status_t rc;
+
+    /* returns ENOENT if module data not set */
+    rc = ib_tx_get_module_data(tx, m, &ctx);
+    if (rc == IB_ENOENT || ctx == NULL) {
+        ctx = ib_mm_calloc(tx->mm, 1, sizeof(rxfilter_ctx_t));
+        if (ctx == NULL) {
+            return NULL;
+        }
+        ctx->reqbuf.errnum = ctx->respbuf.errnum = IB_OK;
+        rc = ib_tx_set_module_data(tx, m, ctx);
+        if (rc != IB_OK) {
+            return NULL;
+        }
+    }
+
+    return ctx;
+}
+
+/**
+ * Select the direction, filter context and ops for @a state
+ *
+ * @param[in] ctx - filter context of the transaction
+ * @param[in] cfg - module configuration
+ * @param[in] state - body data or finished state
+ * @param[out] dir - direction
+ * @param[out] rxbuf - filter context of @a dir
+ * @param[out] regexps - ops of @a dir
+ * @return success, or IB_EINVAL for any other state
+ */
+static ib_status_t rxfilter_select(rxfilter_ctx_t *ctx,
+                                   const rxfilter_cfg_t *cfg,
+                                   ib_state_t state,
+                                   ib_server_direction_t *dir,
+                                   rxfilter_buffer_t **rxbuf,
+                                   ib_array_t **regexps)
+{
+    switch (state) {
+      case request_body_data_state:
+      case request_finished_state:
+        *dir = IB_SERVER_REQUEST;
+        *rxbuf = &ctx->reqbuf;
+        *regexps = cfg->req_edits;
+        return IB_OK;
+      case response_body_data_state:
+      case response_finished_state:
+        *dir = IB_SERVER_RESPONSE;
+        *rxbuf = &ctx->respbuf;
+        *regexps = cfg->resp_edits;
+        return IB_OK;
+      default:
+        return IB_EINVAL;
+    }
 }
 
 /**
  * Ironbee filter function to apply regexp edits
  * @param[in] ib - the engine
  * @param[in] tx - the transaction
- * @param[in] state - Request Data or Response Data stte
+ * @param[in] state - Request Data or Response Data state
  * @param[in] data - data to process
  * @param[in] data_length - data length in bytes
+ * @param[in] cbdata - this module
  * @return success or error
  */
 static ib_status_t rxfilter(ib_engine_t *ib,
@@ -157,63 +488,27 @@ static ib_status_t rxfilter(ib_engine_t *ib,
                             void *cbdata
 )
 {
-    const ib_server_t *svr;
+    const ib_module_t *m = (const ib_module_t *)cbdata;
     rxfilter_cfg_t *cfg;
     rxfilter_ctx_t *ctx;
     rxfilter_buffer_t *rxbuf;
     ib_array_t *regexps;
-    rxop_t *rx;
     ib_server_direction_t dir;
-    char *buf;
-    const char *p;
-    size_t len;
-    size_t hwm = 0;
-    unsigned int i;
-    size_t nelts;
     ib_status_t rc;
-    int rv;
-    regmatch_t pmatch[MAX_RX_MATCH];
-    const char *repl;
-    size_t repl_len;
-    off_t start;
-    size_t delbytes;
-    ib_module_t *m;
-
-    /* retrieve svr, ctx and cfg; initialise ctx if first call */
-    svr = ib_engine_server_get(ib);
-
-    rc = ib_engine_module_get(ib, MODULE_NAME_STR, &m);
-    assert((rc == IB_OK) && (m != NULL));
 
     rc = ib_context_module_config(ib_context_main(ib), m, &cfg);
     assert((rc == IB_OK) && (cfg != NULL));
 
-    /* returns ENOENT if module data not set */
-    rc = ib_tx_get_module_data(tx, m, &ctx);
-    if (rc == IB_ENOENT || ctx == NULL) {
-        ctx = ib_mm_alloc(tx->mm, sizeof(rxfilter_ctx_t));
-        ctx->reqbuf.offs = ctx->respbuf.offs = 0;
-        ctx->reqbuf.errnum = ctx->respbuf.errnum = IB_OK;
-        ctx->reqbuf.data = ctx->respbuf.data = NULL;
-        rc = ib_tx_set_module_data(tx, m, ctx);
-        assert (rc == IB_OK);
-    }
-
-    /* Select the req or resp fields according to event */
-    switch (event) {
-      case request_body_data_event:
-        dir = IB_SERVER_REQUEST;
-        rxbuf = &ctx->reqbuf;
-        regexps = cfg->req_edits;
-        break;
-      case response_body_data_event:
-        dir = IB_SERVER_RESPONSE;
-        rxbuf = &ctx->respbuf;
-        regexps = cfg->resp_edits;
-        break;
-      default:
+    ctx = rxfilter_ctx_get(tx, m);
+    if (ctx == NULL) {
+        ib_log_error_tx(tx, "Error in rxfilter - aborting");
+        return IB_EALLOC;
+    }
+
+    rc = rxfilter_select(ctx, cfg, state, &dir, &rxbuf, &regexps);
+    if (rc != IB_OK) {
         ib_log_error_tx(tx, "Bogus call to rxfilter");
-        return IB_EINVAL;
+        return rc;
     }
 
     if (rxbuf->errnum != IB_OK) {
@@ -225,123 +520,101 @@ static ib_status_t rxfilter(ib_engine_t *ib,
         rxbuf->offs += data_length;
         return IB_OK;
     }
-    if (rxbuf->data == NULL) {
-        /* first call.  No existing data */
-        rc = ib_bytestr_dup_mem(&rxbuf->data, tx->mm, (const uint8_t*)data, data_length + 1);
-    }
-    else {
-        /* merge with any buffered data and null-terminate */
-        rc = ib_bytestr_append_mem(rxbuf->data, (const uint8_t*)data, data_length + 1);
+
+    /* Append the chunk to the window, growing it if need be */
+    if (rxbuf->len + data_length > rxbuf->size) {
+        size_t size = rxbuf->size ? rxbuf->size : MAX_BUFFER;
+        char *window;
+
+        while (size < rxbuf->len + data_length) {
+            size *= 2;
+        }
+        window = ib_mm_alloc(tx->mm, size);
+        if (window == NULL) {
+            rxbuf->errnum = IB_EALLOC;
+            ib_log_error_tx(tx, "Error in rxfilter - aborting");
+            return IB_EALLOC;
+        }
+        if (rxbuf->len > 0) {
+            memcpy(window, rxbuf->window, rxbuf->len);
+        }
+        rxbuf->window = window;
+        rxbuf->size = size;
     }
+    memcpy(rxbuf->window + rxbuf->len, data, data_length);
+    rxbuf->len += data_length;
+
+    rc = rxfilter_window(tx, dir, rxbuf, regexps, false);
     if (rc != IB_OK) {
         rxbuf->errnum = rc;
         ib_log_error_tx(tx, "Error in rxfilter - aborting");
-        return rc;
     }
-    buf = (char*) ib_bytestr_ptr(rxbuf->data);
-    len = ib_bytestr_length(rxbuf->data) - 1;
-    buf[len] = '\0';
+    return rc;
+}
 
-    /* apply regexps; keep high water mark */
-    nelts = ib_array_elements(regexps);
-    for (i = 0; i < nelts; ++i) {
-        rc = ib_array_get(regexps, i, &rx);
-        if (rc != IB_OK) {
-            rxbuf->errnum = rc;
-            ib_log_error_tx(tx, "Error in rxfilter - aborting");
-            return rc;
-        }
-        p = buf;
-        for (rv = regexec(&rx->rx, p, MAX_RX_MATCH, pmatch, 0);
-             rv != REG_NOMATCH;
-             rv = regexec(&rx->rx, p, MAX_RX_MATCH, pmatch, 0)) {
-            if (rv != 0) {
-                char ebuf[256];
-                regerror(rv, &rx->rx, ebuf, 256);
-                ib_log_error_tx(tx, "regexp error: %s", ebuf);
-                break;
-            }
-            if (rx->rxtype == RX_DELETE) {
-                repl = NULL;
-                repl_len = 0;
-            }
-            else {
-                repl = rx_repl(tx->mm, p, pmatch, rx->repl, &repl_len);
-            }
-            if (rx->rxtype == RX_AFTER) {
-                start = rxbuf->offs + (p-buf) + pmatch[0].rm_eo;
-            }
-            else {
-                start = rxbuf->offs + (p-buf) + pmatch[0].rm_so;
-            }
-            if (rx->rxtype == RX_AFTER || rx->rxtype == RX_BEFORE) {
-                delbytes = 0;
-            }
-            else {
-                delbytes = pmatch[0].rm_eo - pmatch[0].rm_so;
-            }
-            rc = svr->body_edit_fn(tx, dir, start, delbytes, repl, repl_len, NULL);
-            if (rc != IB_OK) {
-                /* FIXME - should probably be nonfatal.
-                 * But we want to avoid huge reams of NOTIMPL
-                 */
-                rxbuf->errnum = rc;
-                ib_log_error_tx(tx, "Edit error %d - aborting", rc);
-                return rc;
-            }
-            p += pmatch[0].rm_eo;
-            if ((size_t)(p - buf) > hwm) {
-                hwm = p - buf;
-            }
-        }
-    }
+/**
+ * End of a body: resolve matches held back for more data
+ * @param[in] ib - the engine
+ * @param[in] tx - the transaction
+ * @param[in] state - Request or Response finished state
+ * @param[in] cbdata - this module
+ * @return success or error
+ */
+static ib_status_t rxfinish(ib_engine_t *ib, ib_tx_t *tx, ib_state_t state,
+                            void *cbdata)
+{
+    const ib_module_t *m = (const ib_module_t *)cbdata;
+    rxfilter_cfg_t *cfg;
+    rxfilter_ctx_t *ctx = NULL;
+    rxfilter_buffer_t *rxbuf;
+    ib_array_t *regexps;
+    ib_server_direction_t dir;
+    ib_status_t rc;
 
-    /* Buffer any dangling data */
-    /* Definition of dangling is the smallest of:
-     *  1.  Data after the last regexp edit we just applied
-     *  2.  Data after the last lineend (excludes matches that span lineends)
-     *  3.  Max byte amount: FIXME - where to limit it?
-     */
-    p = strrchr(buf, '\n');
-    if (p) {
-        i = p - buf;
-        if (i > hwm) {
-            hwm = i;  /* or i+1? */
-        }
+    rc = ib_tx_get_module_data(tx, m, &ctx);
+    if (rc != IB_OK || ctx == NULL) {
+        /* No body data seen */
+        return IB_OK;
     }
-    if (len - hwm > MAX_BUFFER) {
-        hwm = len - MAX_BUFFER;
+
+    rc = ib_context_module_config(ib_context_main(ib), m, &cfg);
+    assert((rc == IB_OK) && (cfg != NULL));
+
+    rc = rxfilter_select(ctx, cfg, state, &dir, &rxbuf, &regexps);
+    assert(rc == IB_OK);
+
+    if (rxbuf->errnum != IB_OK || regexps == NULL || rxbuf->len == 0) {
+        return IB_OK;
     }
-    /* Now forget hwm bytes, buffer the rest */
-    rxbuf->offs += hwm;
-    rc = ib_bytestr_setv(rxbuf->data, (uint8_t*)&buf[hwm], len - hwm);
+
+    rc = rxfilter_window(tx, dir, rxbuf, regexps, true);
     if (rc != IB_OK) {
         rxbuf->errnum = rc;
         ib_log_error_tx(tx, "Error in rxfilter - aborting");
-        return rc;
     }
-
-    return IB_OK;
+    return rc;
 }
 
-static ib_status_t rxnotify(ib_engine_t *ib, ib_tx_t *tx, ib_state_t state, void *x)
+static ib_status_t rxnotify(ib_engine_t *ib, ib_tx_t *tx, ib_state_t state,
+                            void *cbdata)
 {
-    ib_status_t rc;
-    ib_module_t *m;
-    ib_server_t *svr;
+    const ib_module_t *m = (const ib_module_t *)cbdata;
+    const ib_server_t *svr;
     rxfilter_cfg_t *cfg;
+    ib_status_t rc;
 
     /* retrieve svr and cfg */
     svr = ib_engine_server_get(ib);
 
-    rc = ib_engine_module_get(ib, MODULE_NAME_STR, &m);
-    assert((rc == IB_OK) && (m != NULL));
-
     rc = ib_context_module_config(ib_context_main(ib), m, &cfg);
     assert((rc == IB_OK) && (cfg != NULL));
 
+    if (svr->body_edit_init_fn == NULL) {
+        return IB_OK;
+    }
+
     /* Tell the server what if anything we're going to edit */
-    return svr->body_edit_init_fn(tx, cfg->flags, NULL);
+    return svr->body_edit_init_fn(tx, cfg->flags, svr->body_init_data);
 }
 
 /**
@@ -349,26 +622,43 @@ static ib_status_t rxnotify(ib_engine_t *ib, ib_tx_t *tx, ib_state_t state, void
  *
  * @param[in] ib - the engine
  * @param[in] m - the module
+ * @param[in] cbdata - unused
  * @return - Success
  */
 static ib_status_t rxfilter_init(ib_engine_t *ib, ib_module_t *m, void *cbdata)
 {
     ib_status_t rc;
-    rc = ib_hook_txdata_register(ib, request_body_data_state, rxfilter, NULL);
+    rc = ib_hook_txdata_register(ib, request_body_data_state, rxfilter, m);
+    assert(rc == IB_OK);
+    rc = ib_hook_txdata_register(ib, response_body_data_state, rxfilter, m);
+    assert(rc == IB_OK);
+    rc = ib_hook_tx_register(ib, request_finished_state, rxfinish, m);
     assert(rc == IB_OK);
-    rc = ib_hook_txdata_register(ib, response_body_data_state, rxfilter, NULL);
+    rc = ib_hook_tx_register(ib, response_finished_state, rxfinish, m);
     assert(rc == IB_OK);
-    rc = ib_hook_tx_register(ib, request_header_finished_state, rxnotify, NULL);
+    rc = ib_hook_tx_register(ib, request_header_finished_state, rxnotify, m);
     assert(rc == IB_OK);
     return rc;
 }
 
+/** Free a compiled regexp; cleanup function */
+static void rxop_free(void *data)
+{
+    rxop_t *rxop = (rxop_t *)data;
+
+    if (rxop->extra != NULL) {
+        pcre_free_study(rxop->extra);
+    }
+    pcre_free(rxop->rx);
+}
+
 /**
  * Parse a regexp op from ironbee.conf to internal rxop_t
  *
  * @param[in] cp - Configuration parser
  * @param[in] name - directive name
  * @param[in] param - directive value
+ * @param[in] dummy - unused
  * @return success or parse or regcomp error
  */
 static ib_status_t rxop_conf(ib_cfgparser_t *cp, const char *name,
@@ -378,13 +668,18 @@ static ib_status_t rxop_conf(ib_cfgparser_t *cp, const char *name,
     rxfilter_cfg_t *cfg;
     ib_status_t rc;
     int rxflags;
+    const char *errptr;
+    int erroffset;
 
     const char *startp;
     const char *endp;
     const char *rxstr;
     char sep;
 
-    rxop_t *rxop = ib_mm_alloc(cp->mm, sizeof(rxop_t));
+    rxop_t *rxop = ib_mm_calloc(cp->mm, 1, sizeof(rxop_t));
+    if (rxop == NULL) {
+        return IB_EALLOC;
+    }
 
     /* parse regex expr */
 
@@ -413,34 +708,45 @@ static ib_status_t rxop_conf(ib_cfgparser_t *cp, const char *name,
     rxstr = ib_mm_memdup_to_str(cp->mm, startp, endp-startp);
 
     /* Unless it's a DELETE, there's a replacement string next */
-    if (rxop->rxtype == RX_DELETE) {
-        rxop->repl = NULL;
-    }
-    else {
+    if (rxop->rxtype != RX_DELETE) {
+        const char *repl;
+
         startp = endp + 1;
         endp = strchr(startp, sep);
         if (!endp || startp == endp) {
             ib_log_error(cp->ib, "Failed to parse %s as rx rule", param);
             return IB_EINVAL;
         }
-        rxop->repl = ib_mm_memdup_to_str(cp->mm, startp, endp-startp);
+        repl = ib_mm_memdup_to_str(cp->mm, startp, endp-startp);
+        rc = rx_repl_parse(cp->mm, repl, &rxop->repl, &rxop->nrepl);
+        if (rc != IB_OK) {
+            return rc;
+        }
     }
 
     /* Flags after the last separator */
-    rxflags = REG_EXTENDED;
+    rxflags = 0;
     startp = endp + 1;
     if (strchr(startp, 'i')) {
-        rxflags |= REG_ICASE;
+        rxflags |= PCRE_CASELESS;
     }
 
-    if (regcomp (&rxop->rx, rxstr, rxflags) == 0) {
-        rc = ib_mm_register_cleanup(cp->mm, (ib_mm_cleanup_fn_t)regfree, &rxop->rx);
-        assert(rc == IB_OK);
-    }
-    else {
-        ib_log_error(cp->ib, "Failed to compile '%s' as regexp", rxstr);
+    rxop->rx = pcre_compile(rxstr, rxflags, &errptr, &erroffset, NULL);
+    if (rxop->rx == NULL) {
+        ib_log_error(cp->ib, "Failed to compile '%s' as regexp: %s",
+                     rxstr, errptr);
         return IB_EINVAL;
     }
+#ifdef PCRE_STUDY_JIT_COMPILE
+    rxop->extra = pcre_study(rxop->rx, PCRE_STUDY_JIT_COMPILE, &errptr);
+#else
+    rxop->extra = pcre_study(rxop->rx, 0, &errptr);
+#endif
+    rc = ib_mm_register_cleanup(cp->mm, rxop_free, rxop);
+    if (rc != IB_OK) {
+        rxop_free(rxop);
+        return rc;
+    }
 
     rc = ib_engine_module_get(cp->ib, MODULE_NAME_STR, &m);
     assert((rc == IB_OK) && (m != NULL));
@@ -448,11 +754,12 @@ static ib_status_t rxop_conf(ib_cfgparser_t *cp, const char *name,
     assert((rc == IB_OK) && (cfg != NULL));
 
     /* add it to {direction} list */
-    /* FIXME - these asserts need to be replaced */
     if (!strcasecmp(name, "RxOpRequest")) {
         if (!cfg->req_edits) {
             rc = ib_array_create(&cfg->req_edits, cp->mm, 4, 4);
-            assert((rc == IB_OK) && (cfg->req_edits != NULL));
+            if (rc != IB_OK) {
+                return rc;
+            }
             cfg->flags |= IB_SERVER_REQUEST;
         }
         rc = ib_array_appendn(cfg->req_edits, rxop);
@@ -460,14 +767,15 @@ static ib_status_t rxop_conf(ib_cfgparser_t *cp, const char *name,
     else if (!strcasecmp(name, "RxOpResponse")) {
         if (!cfg->resp_edits) {
             rc = ib_array_create(&cfg->resp_edits, cp->mm, 4, 4);
-            assert((rc == IB_OK) && (cfg->resp_edits != NULL));
+            if (rc != IB_OK) {
+                return rc;
+            }
             cfg->flags |= IB_SERVER_RESPONSE;
         }
         rc = ib_array_appendn(cfg->resp_edits, rxop);
     }
-    assert(rc == IB_OK);
 
-    return IB_OK;
+    return rc;
 }
 
 /* Declare directives to edit a Request or Response */
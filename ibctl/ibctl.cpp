@@ -28,6 +28,8 @@
 #include <string>
 #include <vector>
 
+#include <unistd.h>
+
 #ifdef __clang__
 #pragma clang diagnostic push
 #if __has_warning("-Wunused-local-typedef")
@@ -58,6 +60,8 @@ namespace {
 struct parsed_options_t {
     std::vector<std::string> cmd;       /**< Command to send to the server. */
     std::string              sock_path; /**< Server socket path. */
+    unsigned int             interval;  /**< Seconds between sends. */
+    unsigned int             count;     /**< Times to send; 0 is forever. */
 };
 
 /**
@@ -125,6 +129,17 @@ void parse_options(
             "    If name is omitted the default is used instead.\n"
             "  engine_status\n"
             "    Return the current status of all engines in JSON.\n"
+            "  engine_metrics [<name>]\n"
+            "    Return the connection, transaction and data counters\n"
+            "    of the current engine in JSON.\n"
+            "  rule_profile on|off|reset|report [<n>]\n"
+            "    Turn rule profiling of the current engine on or off,\n"
+            "    discard the profiles or return the n rules, 20 by default,\n"
+            "    that used the most time in JSON.\n"
+            "  hook_profile on|off|reset|report\n"
+            "    Turn hook profiling of the current engine on or off,\n"
+            "    discard the profiles or return the time spent in the\n"
+            "    hooks of each module and state in JSON.\n"
             "Options"
         );
 
@@ -133,6 +148,11 @@ void parse_options(
         desc_visible.add_options()
             ("help,h", "Print this screen.")
             ("sock,s", po::value<std::string>(), "Socket path")
+            ("interval,i", po::value<unsigned int>(),
+             "Send the command every this many seconds.")
+            ("count,n", po::value<unsigned int>(),
+             "With --interval, send the command this many times; "
+             "forever if 0 (the default).")
         ;
 
         desc_hidden.add_options()
@@ -163,6 +183,19 @@ void parse_options(
         if (vm.count("sock") > 0) {
             parsed_options.sock_path = vm["sock"].as<std::string>();
         }
+
+        parsed_options.interval = 0;
+        if (vm.count("interval") > 0) {
+            parsed_options.interval = vm["interval"].as<unsigned int>();
+        }
+
+        parsed_options.count = 1;
+        if (vm.count("count") > 0) {
+            parsed_options.count = vm["count"].as<unsigned int>();
+        }
+        else if (parsed_options.interval > 0) {
+            parsed_options.count = 0;
+        }
     }
     catch (const boost::program_options::multiple_occurrences& err)
     {
@@ -172,6 +205,10 @@ void parse_options(
     {
         BOOST_THROW_EXCEPTION(exit_exception(err.what()));
     }
+    catch (const boost::program_options::invalid_option_value& err)
+    {
+        BOOST_THROW_EXCEPTION(exit_exception(err.what()));
+    }
 }
 
 /**
@@ -237,6 +274,26 @@ void send_cmd(const parsed_options_t& opts)
     std::cout << response << std::endl;
 }
 
+/**
+ * Send a command once, or every @c interval seconds.
+ *
+ * Each response is written out as it arrives, so that monitoring can read
+ * a stream of results from one process rather than starting one per query.
+ *
+ * @param[in] opts The parsed program options that specify what to send.
+ *
+ * @throws IronBee::error on API errors.
+ */
+void send_cmds(const parsed_options_t& opts)
+{
+    for (unsigned int i = 0; opts.count == 0 || i < opts.count; ++i) {
+        if (i > 0) {
+            sleep(opts.interval);
+        }
+        send_cmd(opts);
+    }
+}
+
 } // anon namespace
 
 int main(int argc, const char** argv)
@@ -252,7 +309,7 @@ int main(int argc, const char** argv)
 
         ib_util_initialize();
 
-        send_cmd(parsed_options);
+        send_cmds(parsed_options);
 
         ib_util_shutdown();
     }
@@ -55,7 +55,9 @@ typedef struct ib_array_t ib_array_t;
  * The array will be extended by "ninit" elements when more room is required.
  * Up to "nextents" extents will be performed.  If more than this number of
  * extents is required, then "nextents" will be doubled and the array will
- * be reorganized.
+ * be reorganized.  Only the extents that are written to are allocated, so
+ * skipped indexes cost no memory; they read as NULL.  A power of 2 for
+ * "ninit" makes access faster.
  *
  * @param parr Address which new array is written
  * @param mm Memory manager to use
@@ -0,0 +1,123 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef _IB_ARTIFACT_H_
+#define _IB_ARTIFACT_H_
+
+/**
+ * @file
+ * @brief IronBee --- Shared Artifact Cache
+ */
+
+#include <ironbee/build.h>
+#include <ironbee/mm.h>
+#include <ironbee/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup IronBeeUtilArtifact Shared Artifact Cache
+ * @ingroup IronBeeUtil
+ *
+ * Process wide cache of expensive, immutable objects.
+ *
+ * Artifacts, such as loaded automata or compiled patterns, are identified by
+ * a kind and a key and are reference counted.  Each user holds a reference
+ * for the lifetime of a memory manager.  When the engine manager builds a
+ * new engine on reload while the previous engine is still alive, the new
+ * engine finds the artifacts of the previous one and reuses them instead of
+ * building them again.
+ *
+ * The key must identify the artifact completely: two requests with the same
+ * kind and key must be satisfied by the same object.
+ *
+ * @{
+ */
+
+/**
+ * Create an artifact.
+ *
+ * @param[out] artifact The artifact created.
+ * @param[in] cbdata Callback data.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - Other on error; passed back to the caller of ib_artifact_acquire().
+ */
+typedef ib_status_t (*ib_artifact_create_fn_t)(
+    void **artifact,
+    void  *cbdata
+);
+
+/**
+ * Destroy an artifact once nothing references it.
+ *
+ * @param[in] artifact The artifact.
+ */
+typedef void (*ib_artifact_destroy_fn_t)(void *artifact);
+
+/**
+ * Acquire a shared artifact, creating it if needed.
+ *
+ * A reference is held until @a mm is destroyed.  The artifact must not be
+ * modified and may be used by several threads at once.
+ *
+ * @param[out] artifact The artifact.
+ * @param[in] mm Memory manager whose lifetime the reference lasts for.
+ * @param[in] kind Kind of artifact; a NUL terminated string that
+ *                 separates the key spaces of different users.
+ * @param[in] key Key of the artifact within @a kind.
+ * @param[in] key_length Length of @a key.
+ * @param[in] create_fn Creates the artifact if it is not cached.
+ * @param[in] create_cbdata Callback data for @a create_fn.
+ * @param[in] destroy_fn Destroys the artifact created by @a create_fn.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation errors.
+ * - Other if @a create_fn fails.
+ */
+ib_status_t DLL_PUBLIC ib_artifact_acquire(
+    void                     **artifact,
+    ib_mm_t                    mm,
+    const char                *kind,
+    const char                *key,
+    size_t                     key_length,
+    ib_artifact_create_fn_t    create_fn,
+    void                      *create_cbdata,
+    ib_artifact_destroy_fn_t   destroy_fn
+)
+NONNULL_ATTRIBUTE(1, 3, 4, 6, 8);
+
+/**
+ * Number of artifacts currently cached.
+ *
+ * @returns Number of artifacts with at least one reference.
+ */
+size_t DLL_PUBLIC ib_artifact_count(void);
+
+/**
+ * @} IronBeeUtilArtifact
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IB_ARTIFACT_H_ */
@@ -0,0 +1,148 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef _IB_BATCH_WRITER_H_
+#define _IB_BATCH_WRITER_H_
+
+/**
+ * @file
+ * @brief IronBee --- Batch Writer Utility Functions
+ */
+
+#include <ironbee/build.h>
+#include <ironbee/mm.h>
+#include <ironbee/types.h>
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup IronBeeUtilBatchWriter Batch Writer
+ * @ingroup IronBeeUtil
+ *
+ * A thread that writes items queued by other threads, in batches.
+ *
+ * Threads that produce output (audit logs, dumps, captures) submit items and
+ * return; the writer thread passes every item queued since it last woke to
+ * the write function at once, so per-write costs such as flushing a file
+ * are paid once per batch.  Submitting threads wait only while the queue is
+ * full.
+ *
+ * Threads do not survive fork(), so the thread is started by the first
+ * submit of each process rather than on creation.  A writer created while a
+ * server reads its configuration thus has a thread in each worker process
+ * that submits.  Items queued in a process when it forks are left to it: a
+ * child drops them unwritten.
+ *
+ * @{
+ */
+
+typedef struct ib_batch_writer_t ib_batch_writer_t;
+
+/**
+ * Write a batch of items.
+ *
+ * Called on the writer thread, or on a submitting thread once the writer is
+ * stopped or its thread could not be started.  The function takes ownership
+ * of the items.
+ *
+ * @param[in] items   Items, in the order submitted.
+ * @param[in] n_items Number of @a items; at least 1.
+ * @param[in] cbdata  Callback data.
+ */
+typedef void (*ib_batch_writer_fn_t)(
+    void   **items,
+    size_t   n_items,
+    void    *cbdata
+);
+
+/**
+ * Create a batch writer.
+ *
+ * The writer is stopped, writing its queued items, when @a mm is destroyed
+ * if ib_batch_writer_stop() has not been called before.
+ *
+ * @param[out] writer      The writer.
+ * @param[in]  mm          Memory manager to allocate from.
+ * @param[in]  max_pending Items queued before submitters wait; at least 1.
+ * @param[in]  write_fn    Writes each batch.
+ * @param[in]  cbdata      Callback data for @a write_fn.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EINVAL if @a max_pending is 0.
+ * - IB_EALLOC on allocation failure.
+ * - IB_EOTHER if the thread could not be initialized.
+ */
+ib_status_t DLL_PUBLIC ib_batch_writer_create(
+    ib_batch_writer_t    **writer,
+    ib_mm_t                mm,
+    size_t                 max_pending,
+    ib_batch_writer_fn_t   write_fn,
+    void                  *cbdata
+)
+NONNULL_ATTRIBUTE(1, 4);
+
+/**
+ * Queue @a item to be written.
+ *
+ * Starts the thread if this process has none and waits while
+ * @a max_pending items are queued.  If the writer is stopped or the thread
+ * can not be started, @a item is written before this returns.
+ *
+ * @param[in] writer The writer.
+ * @param[in] item   Item to write.
+ */
+void DLL_PUBLIC ib_batch_writer_submit(
+    ib_batch_writer_t *writer,
+    void              *item
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Wait until the items queued in this process are written.
+ *
+ * @param[in] writer The writer.
+ */
+void DLL_PUBLIC ib_batch_writer_flush(
+    ib_batch_writer_t *writer
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Write all queued items and stop the thread of this process.
+ *
+ * Items submitted afterwards are written by the submitting thread.  Calling
+ * this on a stopped writer does nothing.
+ *
+ * @param[in] writer The writer.
+ */
+void DLL_PUBLIC ib_batch_writer_stop(
+    ib_batch_writer_t *writer
+)
+NONNULL_ATTRIBUTE(1);
+
+/** @} IronBeeUtilBatchWriter */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IB_BATCH_WRITER_H_ */
@@ -76,6 +76,28 @@ ib_status_t DLL_PUBLIC ib_capture_acquire(
     ib_field_t    **field
 );
 
+/**
+ * Fetch appropriate data field given a source, creating if necessary.
+ *
+ * This is ib_capture_acquire() for a capture collection source acquired
+ * ahead of time, e.g., at configuration time.  It does not allocate unless
+ * the collection has to be created.
+ *
+ * @param[in] tx Transaction
+ * @param[in] source Source of the capture collection.
+ * @param[out] field Where to write result to.
+ * @returns
+ * - IB_OK: All ok
+ * - IB_EALLOC: Allocation error.
+ * - IB_EINVAL: Unexpected error replacing existing non-list field.
+ * - Other on unexpected error.
+ **/
+ib_status_t DLL_PUBLIC ib_capture_acquire_source(
+    const ib_tx_t    *tx,
+    ib_var_source_t  *source,
+    ib_field_t      **field
+);
+
 /**
  * Clear data capture fields
  *
@@ -139,6 +139,11 @@ ib_clock_type_t DLL_PUBLIC ib_clock_type(void);
  * This is to be used for time deltas, and the value may or may not be related
  * to the value returned by time(3) (i.e. seconds since epoch).
  *
+ * Where available, this is a coarse clock, only as precise as the kernel
+ * tick (a few milliseconds), but the cheapest to read: use it for the
+ * timestamps of hot paths, e.g., of every transaction state, and
+ * ib_clock_precise_get_time() to time short intervals.
+ *
  * @note This is not monotonic nor wall time on all platforms.
  *
  * @returns Microsecond time value
@@ -152,6 +157,9 @@ ib_time_t DLL_PUBLIC ib_clock_get_time(void);
  * This is to be used for time deltas, and the value may or may not be related
  * to the value returned by time(3) (i.e. seconds since epoch).
  *
+ * The clock is chosen to be cheap to read as well, as rules and hooks are
+ * timed with it, but it costs several times ib_clock_get_time().
+ *
  * @note This is not monotonic nor wall time on all platforms.
  *
  * @returns Microsecond time value
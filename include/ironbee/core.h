@@ -30,6 +30,7 @@
 #include <ironbee/build.h>
 #include <ironbee/engine_types.h>
 #include <ironbee/logformat.h>
+#include <ironbee/logger.h>
 #include <ironbee/module.h>
 #include <ironbee/rule_defs.h>
 #include <ironbee/types.h>
@@ -83,6 +84,9 @@ struct ib_core_audit_cfg_t {
     const char          *boundary;      /**< Audit log boundary */
     ib_tx_t             *tx;            /**< Transaction being logged */
     const ib_core_cfg_t *core_cfg;      /**< Core configuration */
+    bool                 buffered;      /**< fp writes to buf (AuditLogAsync) */
+    char                *buf;           /**< Buffered audit log, if buffered */
+    size_t               buf_len;       /**< Length of buf */
 };
 
 /** Audit Log */
@@ -172,6 +176,7 @@ typedef ib_status_t (*ib_core_auditlog_fn_t)(
 struct ib_core_cfg_t {
     const char       *log_uri;           /**< Log URI */
     FILE             *log_fp;            /**< File pointer for log. */
+    ib_logger_async_t *log_async;        /**< Async log writer or NULL. */
     const char       *logevent;          /**< Active logevent provider key */
     ib_list_t        *initvar_list;      /**< List of ib_core_initvar_t for InitVar */
     ib_num_t          buffer_req;        /**< Request buffering options */
@@ -180,6 +185,8 @@ struct ib_core_cfg_t {
     ib_num_t          auditlog_dmode;    /**< Audit log dir create mode */
     ib_num_t          auditlog_fmode;    /**< Audit log file create mode */
     ib_num_t          auditlog_parts;    /**< Audit log parts */
+    ib_num_t          auditlog_compress; /**< Compress audit logs? */
+    ib_num_t          auditlog_index_rotate; /**< Index rotate size or 0 */
     const char       *auditlog_index_fmt;/**< Audit log index format string */
     const ib_logformat_t *auditlog_index_hp; /**< Audit log index fmt helper */
     const char       *auditlog_dir;      /**< Audit log base directory */
@@ -194,6 +201,16 @@ struct ib_core_cfg_t {
      * containers.
      */
     ib_list_t        *auditlog_handlers;
+    /**
+     * Request body inspection limits by media type.
+     *
+     * Set with RequestBodyInspectLimit.  The elements are private to core.
+     * The list is replaced, not modified, when a directive changes it, so
+     * that child contexts may share it.
+     */
+    const ib_list_t  *request_body_inspect_limits;
+    /** Response body inspection limits by media type; as above. */
+    const ib_list_t  *response_body_inspect_limits;
     const char       *audit;             /**< Active audit provider key */
     const char       *data;              /**< Active data provider key */
     const char       *module_base_path;  /**< Module base path. */
@@ -202,6 +219,15 @@ struct ib_core_cfg_t {
     ib_num_t          rule_log_level;    /**< Rule execution logging level */
     const char       *rule_debug_str;    /**< Rule debug logging level */
     ib_num_t          rule_debug_level;  /**< Rule debug logging level */
+    ib_num_t          rule_ordering;     /**< Rule ordering (ib_rule_ordering_t) */
+    ib_num_t          rule_profile;      /**< Profile rule execution? */
+    ib_num_t          rule_compare;      /**< Compare A/B rule execution? */
+    ib_num_t          rule_lazy_contexts; /**< Build rule sets on use? */
+    ib_num_t          rule_stream_coalesce; /**< Stream coalesce size */
+    ib_num_t          rule_stream_overlap;  /**< Stream overlap size */
+    ib_num_t          rule_parallel_threads;  /**< Parallel worker threads */
+    ib_num_t          rule_parallel_min_size; /**< Parallel minimum size */
+    ib_num_t          logevent_limit;    /**< Max events per transaction */
     ib_num_t inspection_engine_options; /**< Inspection engine options */
     ib_num_t protection_engine_options; /**< Protection engine options */
     ib_tx_limits_t    limits;            /**< Limits used by this core. */
@@ -38,6 +38,7 @@
 #include <ironbee/server.h>
 #include <ironbee/stream.h>
 #include <ironbee/strval.h>
+#include <ironbee/thread_pool.h>
 #include <ironbee/uuid.h>
 
 #include <stdarg.h>
@@ -119,6 +120,84 @@ uint32_t DLL_PUBLIC ib_engine_abi_number(void);
 ib_status_t DLL_PUBLIC ib_engine_create(ib_engine_t **pib,
                                         const ib_server_t *server);
 
+/**
+ * Counters of the work an engine has done.
+ *
+ * Each counts from the creation of the engine and only ever increases, so
+ * rates come from the difference of two samples.
+ */
+typedef struct ib_engine_metrics_t {
+    uint64_t conns_opened;        /**< Connections created. */
+    uint64_t conns_closed;        /**< Connections destroyed. */
+    uint64_t txs_started;         /**< Transactions created. */
+    uint64_t txs_finished;        /**< Transactions destroyed. */
+    uint64_t txs_blocked;         /**< Finished transactions blocked. */
+    uint64_t request_body_bytes;  /**< Request body of finished txs. */
+    uint64_t response_body_bytes; /**< Response body of finished txs. */
+} ib_engine_metrics_t;
+
+/**
+ * Read the counters of @a ib.
+ *
+ * The counters are read one at a time while other threads may be updating
+ * them, so they are each up to date but not necessarily consistent with
+ * one another, e.g., a transaction may be counted as started but its
+ * connection not yet as opened.
+ *
+ * @param[in]  ib      Engine.
+ * @param[out] metrics Counters.
+ */
+void DLL_PUBLIC ib_engine_metrics_get(
+    const ib_engine_t   *ib,
+    ib_engine_metrics_t *metrics
+)
+NONNULL_ATTRIBUTE(1, 2);
+
+/**
+ * Get the worker thread pool of @a ib.
+ *
+ * The pool is shared by the engine and all modules, for work that is worth
+ * doing on other threads but not worth starting threads for, e.g., see
+ * ib_thread_pool_share().  It is created on first use, with one thread per
+ * online CPU, and destroyed first thing by ib_engine_destroy(), after
+ * running any queued tasks.  Modules must therefore not queue tasks that
+ * outlive the engine.
+ *
+ * @param[in]  ib   Engine.
+ * @param[out] pool The thread pool.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - Any return of ib_thread_pool_create() if creating the pool fails.
+ */
+ib_status_t DLL_PUBLIC ib_engine_thread_pool_get(
+    ib_engine_t       *ib,
+    ib_thread_pool_t **pool
+)
+NONNULL_ATTRIBUTE(1, 2);
+
+/**
+ * Intern a string in @a ib.
+ *
+ * Returns the single copy of @a str kept by @a ib, allocated from its main
+ * memory manager on first use.  Equal strings interned in the same engine
+ * are the same pointer, so that strings repeated throughout a large
+ * configuration, such as rule tags, targets and configuration file names,
+ * are stored once.  The copy lives as long as @a ib and must not be
+ * modified.  May be called from any thread.
+ *
+ * @param[in] ib  Engine.
+ * @param[in] str String to intern; may be NULL.
+ *
+ * @returns Interned copy of @a str, or NULL if @a str is NULL or on
+ *          allocation failure.
+ */
+const char DLL_PUBLIC *ib_engine_intern(
+    ib_engine_t *ib,
+    const char  *str
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Return the server object for an engine.
  *
@@ -652,6 +731,81 @@ ib_status_t DLL_PUBLIC ib_tx_server_header(
  */
 void DLL_PUBLIC ib_tx_destroy(ib_tx_t *tx) NONNULL_ATTRIBUTE(1);
 
+/**
+ * Work started by ib_tx_async_start().
+ */
+typedef struct ib_tx_async_t ib_tx_async_t;
+
+/**
+ * Work run by ib_tx_async_start() on another thread.
+ *
+ * The function must not use the transaction, its memory manager or any
+ * other engine facility that is not thread safe; it may only use
+ * @a cbdata, e.g., to do blocking I/O into a buffer allocated beforehand.
+ *
+ * @param[in] cbdata Callback data.
+ *
+ * @returns Status code, returned by ib_tx_async_wait().
+ */
+typedef ib_status_t (*ib_tx_async_fn_t)(void *cbdata);
+
+/**
+ * Run @a fn for @a tx on the engine thread pool.
+ *
+ * This lets a module start slow work, e.g., a lookup in a remote service,
+ * in an early state and only wait for it in the state that needs the
+ * result, so that the work overlaps with parsing and inspection.  The
+ * calling thread is only suspended by ib_tx_async_wait(), and only if the
+ * work is not done yet.
+ *
+ * The work is always waited for before the memory of @a tx is released,
+ * so @a cbdata may be allocated from @a tx.  If the thread pool is not
+ * available, @a fn is run before returning.
+ *
+ * @param[in]  tx     Transaction.
+ * @param[in]  fn     Work.
+ * @param[in]  cbdata Callback data for @a fn.
+ * @param[out] async  Handle for ib_tx_async_wait().
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ * - IB_EOTHER if the synchronization objects could not be created.
+ */
+ib_status_t DLL_PUBLIC ib_tx_async_start(
+    ib_tx_t           *tx,
+    ib_tx_async_fn_t   fn,
+    void              *cbdata,
+    ib_tx_async_t    **async
+)
+NONNULL_ATTRIBUTE(1, 2, 4);
+
+/**
+ * Is the work of @a async done?
+ *
+ * @param[in] async Work.
+ *
+ * @returns true if ib_tx_async_wait() would not block.
+ */
+bool DLL_PUBLIC ib_tx_async_done(
+    ib_tx_async_t *async
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Wait for the work of @a async to be done.
+ *
+ * May be called any number of times.
+ *
+ * @param[in] async Work.
+ *
+ * @returns Status returned by the work function.
+ */
+ib_status_t DLL_PUBLIC ib_tx_async_wait(
+    ib_tx_async_t *async
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * @} IronBeeEngineEvent
  */
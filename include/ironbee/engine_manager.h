@@ -187,6 +187,10 @@ typedef ib_status_t (* ib_manager_engine_preconfig_fn_t)(
 /**
  * A function called after @a ib has been configured.
  *
+ * Postconfig functions run before the engine is made current and without
+ * the manager lock held, so they are also the place to warm up a new
+ * engine, e.g., by running requests through it.
+ *
  * @param[in] manager The engine manager.
  * @param[in] ib The ironbee engine.
  * @param[in] cbdata The callback data provided when this function was
@@ -203,6 +207,21 @@ typedef ib_status_t (* ib_manager_engine_postconfig_fn_t)(
     void         *cbdata
 );
 
+/**
+ * A function called when a background engine build completes.
+ *
+ * @param[in] manager The engine manager.
+ * @param[in] name The name the engine was built for.
+ * @param[in] rc The result of ib_manager_engine_create().
+ * @param[in] cbdata The callback data provided with the build request.
+ */
+typedef void (* ib_manager_engine_create_done_fn_t)(
+    ib_manager_t *manager,
+    const char   *name,
+    ib_status_t   rc,
+    void         *cbdata
+);
+
 
 /**
  * Add a callback to run on an engine before it is to be configured.
@@ -264,6 +283,10 @@ NONNULL_ATTRIBUTE(1);
  * made to find and destroy engines with nothing referencing them.
  * If the cleanup attempt fails, then this returns @c IB_DECLINED.
  *
+ * The engine is built and configured without holding the manager lock:
+ * only other engine builds wait for it.  The previous engine stays current
+ * until the new one is completely configured.
+ *
  * @param[in] manager IronBee engine manager
  * @parma[in] name The name this engine should service.
  * @param[in] config_file Configuration file path
@@ -286,6 +309,34 @@ ib_status_t DLL_PUBLIC ib_manager_engine_create(
 )
 NONNULL_ATTRIBUTE(1,2);
 
+/**
+ * Create a new named IronBee engine in a background thread.
+ *
+ * This calls ib_manager_engine_create() from a new thread and returns
+ * immediately; the calling thread, e.g., a server's event thread handling a
+ * reload request, is not blocked while the configuration is parsed.
+ * ib_manager_destroy() waits for background builds to complete.
+ *
+ * @param[in] manager IronBee engine manager
+ * @param[in] name The name this engine should service.
+ * @param[in] config_file Configuration file path
+ * @param[in] done_fn Called from the build thread with the result. May be
+ *            NULL.
+ * @param[in] cbdata Callback data for @a done_fn.
+ *
+ * @returns Status code
+ * - IB_OK The build was started.
+ * - IB_EALLOC If the build thread could not be started.
+ */
+ib_status_t DLL_PUBLIC ib_manager_engine_create_background(
+    ib_manager_t                       *manager,
+    const char                         *name,
+    const char                         *config_file,
+    ib_manager_engine_create_done_fn_t  done_fn,
+    void                               *cbdata
+)
+NONNULL_ATTRIBUTE(1,2,3);
+
 /**
  * Re-enable an manager after a call to ib_manager_disable().
  *
@@ -347,6 +398,9 @@ NONNULL_ATTRIBUTE(1);
  * Any engine provided by this interface must have
  * ib_manager_engine_release() called on it.
  *
+ * Neither this function nor ib_manager_engine_release() takes the manager
+ * lock, so they never wait for an engine to be created or destroyed.
+ *
  * @param[in] manager IronBee engine manager
  * @param[in] name The name of the engine to fetch.
  * @param[out] pengine Pointer to the current engine
@@ -388,6 +442,130 @@ ib_status_t DLL_PUBLIC ib_manager_engine_release(
 )
 NONNULL_ATTRIBUTE(1,2);
 
+/**
+ * Has @a engine been replaced by another engine?
+ *
+ * An engine is retired once ib_manager_engine_create() replaces it or
+ * ib_manager_disable() removes it; the manager destroys it once its last
+ * reference is released.  Connections that keep a retired engine for many
+ * transactions delay that, so servers should drain them: use this when a
+ * transaction starts and, if true, close the connection once the
+ * transaction is done, e.g., by disabling keep-alive for it.
+ *
+ * Retired engines that have lost their last reference are destroyed by the
+ * next ib_manager_engine_acquire() or ib_manager_engine_cache_acquire()
+ * that finds the manager unlocked, or by ib_manager_engine_cleanup().
+ *
+ * @param[in] manager IronBee engine manager.
+ * @param[in] engine Engine acquired from @a manager.
+ *
+ * @returns True if @a engine is retired; false if it is current or unknown
+ *          to @a manager.
+ */
+bool DLL_PUBLIC ib_manager_engine_retired(
+    ib_manager_t      *manager,
+    const ib_engine_t *engine
+)
+NONNULL_ATTRIBUTE(1, 2);
+
+/**
+ * A cache of the current engine for one thread.
+ *
+ * Every ib_manager_engine_acquire() and ib_manager_engine_release()
+ * updates the reference count of the engine, which all threads share.  A
+ * thread that acquires an engine for each connection or transaction can
+ * instead keep a cache: the cache holds one reference to the current
+ * engine, and acquiring and releasing through it only counts uses in the
+ * cache until the manager publishes a change to its engines.
+ *
+ * A cache must only be used by one thread at a time.  It keeps its engine
+ * from being destroyed until the next acquisition after the engine is
+ * replaced, or until ib_manager_engine_cache_flush() or
+ * ib_manager_engine_cache_destroy(), so a thread that stops acquiring
+ * engines should flush its cache.
+ */
+typedef struct ib_manager_engine_cache_t ib_manager_engine_cache_t;
+
+/**
+ * Create an engine cache for engine @a name.
+ *
+ * The cache is allocated with malloc() and destroyed with
+ * ib_manager_engine_cache_destroy(), which must be called before
+ * @a manager is destroyed.
+ *
+ * @param[in] manager IronBee engine manager.
+ * @param[in] name The name of the engine to cache.
+ * @param[out] pcache The created cache.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ */
+ib_status_t DLL_PUBLIC ib_manager_engine_cache_create(
+    ib_manager_t               *manager,
+    const char                 *name,
+    ib_manager_engine_cache_t **pcache
+)
+NONNULL_ATTRIBUTE(1, 2, 3);
+
+/**
+ * Flush and destroy @a cache.
+ *
+ * Engines acquired through @a cache and not yet released must be released
+ * with ib_manager_engine_release().  Does nothing if @a cache is NULL.
+ *
+ * @param[in] cache The cache.
+ */
+void DLL_PUBLIC ib_manager_engine_cache_destroy(
+    ib_manager_engine_cache_t *cache
+);
+
+/**
+ * Give the engine held by @a cache back to the manager.
+ *
+ * Engines acquired through @a cache and not yet released may still be
+ * released through it.
+ *
+ * @param[in] cache The cache.
+ */
+void DLL_PUBLIC ib_manager_engine_cache_flush(
+    ib_manager_engine_cache_t *cache
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Acquire the current engine through @a cache.
+ *
+ * As ib_manager_engine_acquire(), but the engine must be released with
+ * ib_manager_engine_cache_release() on the same cache.
+ *
+ * @param[in] cache The cache.
+ * @param[out] pengine The current engine.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_DECLINED No current IronBee engine exists for the cache's name.
+ */
+ib_status_t DLL_PUBLIC ib_manager_engine_cache_acquire(
+    ib_manager_engine_cache_t  *cache,
+    ib_engine_t               **pengine
+)
+NONNULL_ATTRIBUTE(1, 2);
+
+/**
+ * Release an engine acquired with ib_manager_engine_cache_acquire().
+ *
+ * @param[in] cache The cache @a engine was acquired through.
+ * @param[in] engine The engine to release.
+ *
+ * @returns As ib_manager_engine_release().
+ */
+ib_status_t DLL_PUBLIC ib_manager_engine_cache_release(
+    ib_manager_engine_cache_t *cache,
+    ib_engine_t               *engine
+)
+NONNULL_ATTRIBUTE(1, 2);
+
 /**
  * Destroy any inactive engines.
  *
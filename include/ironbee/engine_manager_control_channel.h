@@ -243,6 +243,15 @@ NONNULL_ATTRIBUTE(1);
  * - cleanup - cleanup old IronBee engines in the manager.
  * - engine_create \<config file\> - Create a new engine.
  *   IronBee must not be disabled for this to succeed.
+ * - engine_status - Report the engines of the manager as JSON.
+ * - engine_metrics [\<name\>] - Report the counters of the current
+ *   engine, or of the engine called @a name, as JSON.
+ * - rule_profile on|off|reset|report [\<n\>] - Turn rule profiling of the
+ *   current engine on or off, discard its rule profiles, or report the
+ *   @a n rules that used the most time as JSON.
+ * - hook_profile on|off|reset|report - Turn hook profiling of the current
+ *   engine on or off, discard its hook profiles, or report the time of the
+ *   hooks of each module and state as JSON.
  *
  * @param[in] channel The channel to register this command with.
  *
@@ -319,6 +328,9 @@ NONNULL_ATTRIBUTE(1,2);
  * an @ref ib_engine_manager_control_channel_t and so only the path to the
  * socket is required.
  *
+ * Responses longer than @ref IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ
+ * arrive as several messages and are joined into one @a response.
+ *
  * @param[in] sock_path Path to the unix domain socket the channel is at.
  * @param[in] message The C-string message to send to the server.
  * @param[in] mm The memory manager used to allocate @a response from.
@@ -29,6 +29,7 @@
 
 #include <ironbee/build.h>
 #include <ironbee/engine_types.h>
+#include <ironbee/list.h>
 #include <ironbee/parsed_content.h>
 
 #ifdef __cplusplus
@@ -670,6 +671,83 @@ ib_status_t DLL_PUBLIC ib_hook_context_register(
     void *cbdata
 );
 
+/**
+ * Hook profile
+ *
+ * Time spent in the hooks a module registered for a state while hook
+ * profiling is on; see ib_hook_profile_set().  A hook belongs to the module
+ * whose initialization registered it; hooks registered otherwise belong to
+ * the engine.  Times are the sum of differences of microsecond clock
+ * readings, so hooks shorter than a microsecond are only accurate over many
+ * calls.
+ */
+typedef struct {
+    const ib_module_t *module; /**< Module; NULL for the engine */
+    ib_state_t         state;  /**< State */
+    uint64_t           calls;  /**< Number of hook calls */
+    uint64_t           time;   /**< Total time (microseconds) */
+} ib_hook_profile_t;
+
+/**
+ * Turn hook profiling on or off.
+ *
+ * While it is on, state notification times each hook it calls and adds the
+ * time to the profile of the module and state of the hook.  It may be
+ * called while transactions are running, but not from more than one
+ * thread at a time, and not before configuration is finished.  Profiles
+ * are kept when it is turned off; see ib_hook_profile_reset().
+ *
+ * @param[in] ib IronBee engine
+ * @param[in] enabled Profile hooks?
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ */
+ib_status_t DLL_PUBLIC ib_hook_profile_set(
+    ib_engine_t *ib,
+    bool         enabled)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Is hook profiling on?
+ *
+ * @param[in] ib IronBee engine
+ *
+ * @returns true if ib_hook_profile_set() turned hook profiling on.
+ */
+bool DLL_PUBLIC ib_hook_profile_enabled(
+    const ib_engine_t *ib)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Get the hook profiles with any calls, by decreasing total time.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in] mm Memory manager to allocate the list from
+ * @param[out] profiles List of const ib_hook_profile_t
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ */
+ib_status_t DLL_PUBLIC ib_hook_profile_get(
+    const ib_engine_t  *ib,
+    ib_mm_t             mm,
+    ib_list_t         **profiles)
+NONNULL_ATTRIBUTE(1, 3);
+
+/**
+ * Discard all hook profiles.
+ *
+ * Hooks running at the same time may leave a partial record.
+ *
+ * @param[in] ib IronBee engine
+ */
+void DLL_PUBLIC ib_hook_profile_reset(
+    ib_engine_t *ib)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * @}
  */
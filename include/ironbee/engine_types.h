@@ -249,6 +249,29 @@ struct ib_tx_limits_t {
      * A value of < 0 indicates no limit.
      */
     ssize_t response_body_log_limit;
+
+    /**
+     * Limit the memory allocated from the transaction memory pool, in bytes.
+     *
+     * Allocations past the limit fail.  A value of <= 0 indicates no limit.
+     */
+    ssize_t tx_memory_limit;
+
+    /**
+     * Limit the size of the request body inspected, in bytes.
+     *
+     * Request body data past the limit is not passed to modules or
+     * rules.  Set per transaction from the content type of the request.
+     * A value of < 0 indicates no limit.
+     */
+    ssize_t request_body_inspect_limit;
+
+    /**
+     * Limit the size of the response body inspected, in bytes.
+     *
+     * As @ref request_body_inspect_limit, but for the response.
+     */
+    ssize_t response_body_inspect_limit;
 };
 typedef struct ib_tx_limits_t ib_tx_limits_t;
 
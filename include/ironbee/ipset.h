@@ -27,6 +27,7 @@
 
 #include <ironbee/build.h>
 #include <ironbee/ip.h>
+#include <ironbee/mm.h>
 #include <ironbee/types.h>
 
 #include <string.h>
@@ -63,6 +64,11 @@ extern "C" {
  * the number of negative networks, P is the number of positive networks, and
  * K is the number of matching positive entries.
  *
+ * For large sets, ib_ipset4_index() and ib_ipset6_index() build a compressed
+ * multibit trie of the set.  Queries of an indexed set take a number of steps
+ * bounded by the address length (6 bits per step), independent of the
+ * number of networks.
+ *
  * The API is divided into v4 and v6 versions.  Besides the number of bytes in
  * the network address, the semantics are identical.
  *
@@ -127,6 +133,13 @@ typedef struct ib_ipset6_t ib_ipset6_t;
 
 /** @cond internal */
 
+/**
+ * Trie index of an IP set.  Opaque datastructure.
+ *
+ * @sa ib_ipset4_index()
+ */
+typedef struct ib_ipset_index_t ib_ipset_index_t;
+
 /**
  * IP Set of IPv4 addresses.
  *
@@ -166,10 +179,11 @@ typedef struct ib_ipset6_t ib_ipset6_t;
  */
 struct ib_ipset4_t
 {
-    ib_ipset4_entry_t *positive;
-    size_t             num_positive;
-    ib_ipset4_entry_t *negative;
-    size_t             num_negative;
+    ib_ipset4_entry_t      *positive;
+    size_t                  num_positive;
+    ib_ipset4_entry_t      *negative;
+    size_t                  num_negative;
+    const ib_ipset_index_t *index;
 };
 
 /**
@@ -179,10 +193,11 @@ struct ib_ipset4_t
  */
 struct ib_ipset6_t
 {
-    ib_ipset6_entry_t *positive;
-    size_t             num_positive;
-    ib_ipset6_entry_t *negative;
-    size_t             num_negative;
+    ib_ipset6_entry_t      *positive;
+    size_t                  num_positive;
+    ib_ipset6_entry_t      *negative;
+    size_t                  num_negative;
+    const ib_ipset_index_t *index;
 };
 
 /** @endcond */
@@ -225,6 +240,32 @@ ib_status_t ib_ipset4_init(
     size_t             num_positive
 );
 
+/**
+ * Build a trie index of an IPv4 set.
+ *
+ * Optional; an indexed set answers queries by descending a compressed
+ * multibit trie (a Poptrie: six bits per level with bitmaps and popcounts
+ * instead of child pointers) rather than by binary search.  Worthwhile for
+ * sets of many networks that are queried often.
+ *
+ * The index holds the most specific and most general positive entry for
+ * every address, so ib_ipset4_query() of an indexed set reports the true
+ * most specific and most general containing entries.  The index refers to
+ * the entries of @a set, which must not be modified afterwards.
+ *
+ * @param[in,out] set Set to index; must be initialized.
+ * @param[in]     mm  Memory manager to allocate the index from.
+ *
+ * @return
+ * - IB_OK on success.
+ * - IB_EINVAL if @a set is NULL.
+ * - IB_EALLOC on allocation failure.
+ */
+ib_status_t ib_ipset4_index(
+    ib_ipset4_t *set,
+    ib_mm_t      mm
+);
+
 /**
  * Query @a set for @a ip.
  *
@@ -245,6 +286,7 @@ ib_status_t ib_ipset4_init(
  *   @a out_general_entry == NULL.
  * - \f$O(\log N + \log P + K)\f$ if K > 0 and either @a out_specific_entry or
  *   @a out_general_entry is not NULL.
+ * - \f$O(32 / 6)\f$ if @a set is indexed (see ib_ipset4_index()).
  *
  * @param[in]  set                IP set to query.
  * @param[in]  ip                 IP to query.
@@ -283,6 +325,18 @@ ib_status_t ib_ipset6_init(
     size_t             num_positive
 );
 
+/**
+ * As ib_ipset4_index() except for v6 addresses.
+ *
+ * See ib_ipset4_index() for documentation.
+ *
+ * @sa ib_ipset4_index()
+ */
+ib_status_t ib_ipset6_index(
+    ib_ipset6_t *set,
+    ib_mm_t      mm
+);
+
 /**
  * As ib_ipset4_query() except for v6 addresses.
  *
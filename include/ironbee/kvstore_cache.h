@@ -0,0 +1,74 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef __IRONBEE__KVSTORE_CACHE_H
+#define __IRONBEE__KVSTORE_CACHE_H
+
+#include <ironbee/clock.h>
+#include <ironbee/kvstore.h>
+#include <ironbee/types.h>
+
+/**
+ * @file
+ * @brief IronBee --- Key-Value Caching Store Interface
+ *
+ * A key-value store that keeps recently read values of another store in
+ * memory.
+ *
+ * Gets are served from a least recently used cache, and only go to the
+ * backing store on a miss.  The absence of a key is cached as well.
+ * Sets and removes are written through to the backing store and drop the
+ * cached value of the key, so the next get reads it back.
+ *
+ * Writes by other users of the backing store, such as other processes
+ * sharing a file, are not seen until a cached value is evicted or older
+ * than the maximum age given to ib_kvstore_cache_init().
+ */
+
+/**
+ * @addtogroup IronBeeKeyValueStore
+ * @ingroup IronBeeUtil
+ * @{
+ */
+
+/**
+ * Initializes a kvstore that caches the values of @a backing.
+ *
+ * Connecting and disconnecting @a kvstore connects and disconnects
+ * @a backing.  Destroying @a kvstore does not destroy @a backing, which
+ * must outlive it.
+ *
+ * @param[out] kvstore Initialized with kvserver and some defaults.
+ * @param[in] backing The store whose values are cached.
+ * @param[in] capacity The number of keys cached; must be positive.
+ * @param[in] max_age Cached values older than this (in usec) are read
+ *            again from @a backing.  0 for no limit.
+ * @returns
+ *   - IB_OK on success
+ *   - IB_EINVAL if @a capacity is 0.
+ *   - IB_EALLOC on memory allocation failure using malloc.
+ */
+ib_status_t ib_kvstore_cache_init(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_t *backing,
+    size_t        capacity,
+    ib_time_t     max_age);
+
+ /**
+  * @}
+  */
+#endif /* __IRONBEE__KVSTORE_CACHE_H */
@@ -0,0 +1,75 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef __IRONBEE__KVSTORE_LOG_H
+#define __IRONBEE__KVSTORE_LOG_H
+
+#include <ironbee/kvstore.h>
+#include <ironbee/types.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/**
+ * @file
+ * @brief IronBee --- Key-Value Log Store Interface
+ *
+ * A key-value store that appends every write to a single file and reads
+ * values from a memory map of that file.
+ *
+ * Each set or remove appends one record, so a write costs one @c write()
+ * instead of the directory and file creation of the filesystem store.
+ * An in-memory index maps each key to its latest record.  Processes
+ * sharing the file pick up each other's records by scanning the tail of
+ * the file on every operation.  When more than half of the file is
+ * superseded, removed or expired records, it is compacted into a new file
+ * that replaces the old one.
+ */
+
+/**
+ * @addtogroup IronBeeKeyValueStore
+ * @ingroup IronBeeUtil
+ * @{
+ */
+
+/**
+ * Initializes a kvstore that writes to the log file @a path.
+ *
+ * The file is created, if necessary, by ib_kvstore_connect(), which must
+ * be called before any other operation.
+ *
+ * @param[out] kvstore Initialized with kvserver and some defaults.
+ * @param[in] path The file we will store this data in.
+ * @returns
+ *   - IB_OK on success
+ *   - IB_EALLOC on memory allocation failure using malloc.
+ */
+ib_status_t ib_kvstore_log_init(
+    ib_kvstore_t *kvstore,
+    const char *path);
+
+/**
+ * Set the file mode which the log file is created with.
+ * @param[in] kvstore Key-Value store.
+ * @param[in] mode The mode.
+ */
+void ib_kvstore_log_set_file_mode(ib_kvstore_t *kvstore, mode_t mode);
+
+ /**
+  * @}
+  */
+#endif /* __IRONBEE__KVSTORE_LOG_H */
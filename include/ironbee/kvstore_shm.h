@@ -0,0 +1,78 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef __IRONBEE__KVSTORE_SHM_H
+#define __IRONBEE__KVSTORE_SHM_H
+
+#include <ironbee/kvstore.h>
+#include <ironbee/types.h>
+
+#include <stddef.h>
+
+/**
+ * @file
+ * @brief IronBee --- Key-Value Shared Memory Store Interface
+ *
+ * A key-value store kept in a fixed-size hash table in a memory-mapped
+ * file, such as one in @c /dev/shm, shared by every process that maps it.
+ *
+ * Each key occupies one slot of a fixed size, so the table needs no
+ * allocator and values are read and written in place.  Reads take no lock:
+ * writers mark a slot while changing it, and readers retry if a slot
+ * changed while they copied it.  Writers are serialized by a lock on the
+ * file.
+ *
+ * Keys are searched for in a bounded window of slots.  If the window of a
+ * new key is full, the value in it that expires first is evicted, so the
+ * store behaves as a cache when it holds too many keys.  Values that do
+ * not fit in a slot are rejected.
+ */
+
+/**
+ * @addtogroup IronBeeKeyValueStore
+ * @ingroup IronBeeUtil
+ * @{
+ */
+
+/**
+ * Initializes a kvstore in the shared file @a path.
+ *
+ * The file is created and sized, if necessary, by ib_kvstore_connect(),
+ * which must be called before any other operation.  The size of an
+ * existing file is used rather than @a slots and @a slot_size.
+ *
+ * @param[out] kvstore Initialized with kvserver and some defaults.
+ * @param[in] path The file the table is kept in.
+ * @param[in] slots Number of slots of a new table.
+ * @param[in] slot_size Size of each slot of a new table in bytes; the
+ *            key, type and value of an entry must fit in it along with a
+ *            small header.
+ * @returns
+ *   - IB_OK on success
+ *   - IB_EINVAL if @a slots is 0 or @a slot_size is too small.
+ *   - IB_EALLOC on memory allocation failure using malloc.
+ */
+ib_status_t ib_kvstore_shm_init(
+    ib_kvstore_t *kvstore,
+    const char   *path,
+    size_t        slots,
+    size_t        slot_size);
+
+ /**
+  * @}
+  */
+#endif /* __IRONBEE__KVSTORE_SHM_H */
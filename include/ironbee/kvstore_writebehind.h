@@ -0,0 +1,82 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef __IRONBEE__KVSTORE_WRITEBEHIND_H
+#define __IRONBEE__KVSTORE_WRITEBEHIND_H
+
+#include <ironbee/kvstore.h>
+#include <ironbee/types.h>
+
+/**
+ * @file
+ * @brief IronBee --- Key-Value Write-Behind Store Interface
+ *
+ * A key-value store that queues sets and removes and writes them to
+ * another store from a background thread.
+ *
+ * Sets and removes return once the write is queued, so the caller does not
+ * wait for the backing store.  Repeated writes of a key that is still
+ * queued replace the queued write, so only the last one reaches the
+ * backing store.  Gets see queued writes.
+ *
+ * The writer thread is started by the first write in a process, so a
+ * store created before a server forks writes from each child.  Queued
+ * writes are lost if the process exits without destroying the store.
+ * Errors of the backing store are logged, as there is no caller to
+ * return them to.
+ */
+
+/**
+ * @addtogroup IronBeeKeyValueStore
+ * @ingroup IronBeeUtil
+ * @{
+ */
+
+/**
+ * Initializes a kvstore that writes to @a backing in the background.
+ *
+ * Connecting @a kvstore connects @a backing.  Disconnecting @a kvstore
+ * waits for queued writes and disconnects @a backing.  Destroying
+ * @a kvstore waits for queued writes and stops the writer thread, but does
+ * not destroy @a backing, which must outlive it.
+ *
+ * @param[out] kvstore Initialized with kvserver and some defaults.
+ * @param[in] backing The store written to.
+ * @param[in] max_pending The number of writes that may be queued before
+ *            writers wait for the backing store; must be positive.
+ * @returns
+ *   - IB_OK on success
+ *   - IB_EINVAL if @a max_pending is 0.
+ *   - IB_EALLOC on memory allocation failure using malloc.
+ *   - IB_EOTHER if a mutex or condition can not be created.
+ */
+ib_status_t ib_kvstore_writebehind_init(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_t *backing,
+    size_t        max_pending);
+
+/**
+ * Wait until every write queued to @a kvstore is written.
+ *
+ * @param[in] kvstore A store initialized by ib_kvstore_writebehind_init().
+ */
+void ib_kvstore_writebehind_flush(ib_kvstore_t *kvstore);
+
+ /**
+  * @}
+  */
+#endif /* __IRONBEE__KVSTORE_WRITEBEHIND_H */
@@ -64,6 +64,8 @@ struct ib_list_node_t {
  */
 struct ib_list_t {
     ib_mm_t mm;
+    size_t version;                               /* Modification count */
+    ib_list_node_t *spare;                        /* Unused nodes */
     IB_LIST_GEN_REQ_FIELDS(ib_list_node_t);       /* Required fields */
 };
 /** @endcond */
@@ -154,6 +156,11 @@ ib_status_t DLL_PUBLIC ib_list_shift(ib_list_t *list, void *pdata);
  * @note This does not destroy any element, but instead disassociates
  *       the elements with the list.
  *
+ * The nodes of the list are kept and reused by later insertions, so that
+ * a list that is repeatedly cleared and refilled stops allocating once it
+ * has reached its largest size.  Nodes obtained before the clear must not
+ * be used after the list is modified again.
+ *
  * @param list List
  */
 void DLL_PUBLIC ib_list_clear(ib_list_t *list);
@@ -167,6 +174,20 @@ void DLL_PUBLIC ib_list_clear(ib_list_t *list);
  */
 size_t DLL_PUBLIC ib_list_elements(const ib_list_t *list);
 
+/**
+ * Return the modification count of the list.
+ *
+ * The count changes whenever an element is added to or removed from the
+ * list, which allows callers to cache information derived from the list
+ * contents.  Replacing the data of a node with ib_list_node_data_set()
+ * does not change the count.
+ *
+ * @param list List
+ *
+ * @returns Modification count of the list
+ */
+size_t DLL_PUBLIC ib_list_version(const ib_list_t *list);
+
 /**
  * Return first node in the list or NULL if there are no elements.
  *
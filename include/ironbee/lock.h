@@ -47,9 +47,18 @@ extern "C" {
  */
 typedef pthread_mutex_t ib_lock_t;
 
+/**
+ * @brief The reader-writer lock type for ironbee locks.
+ */
+typedef pthread_rwlock_t ib_rwlock_t;
+
 /**
  * Create a new lock using the given memory manager.
  *
+ * Where the platform supports it, the lock is adaptive: a thread that finds
+ * the lock held spins briefly before sleeping, which avoids a context switch
+ * for the short critical sections that are typical in IronBee.
+ *
  * Locks exist only as pointers because it is invalid to copy a lock.
  * To put this another way, doing
  * @code
@@ -72,6 +81,18 @@ ib_status_t DLL_PUBLIC ib_lock_create(ib_lock_t **lock, ib_mm_t mm);
  */
 ib_status_t DLL_PUBLIC ib_lock_lock(ib_lock_t *lock);
 
+/**
+ * Acquire @a lock if it is not held.
+ *
+ * @param[in] lock The lock.
+ *
+ * @returns
+ * - IB_OK If the lock was acquired.
+ * - IB_DECLINED If the lock is held.
+ * - IB_EUNKNOWN On any other error.
+ */
+ib_status_t DLL_PUBLIC ib_lock_trylock(ib_lock_t *lock);
+
 /**
  * @param[in] lock The lock.
  */
@@ -95,6 +116,64 @@ ib_status_t DLL_PUBLIC ib_lock_create_malloc(ib_lock_t **lock);
  */
 void DLL_PUBLIC ib_lock_destroy_malloc(ib_lock_t *lock);
 
+/**
+ * Create a new reader-writer lock using the given memory manager.
+ *
+ * Any number of readers may hold the lock at once; a writer holds it alone.
+ * Writers are preferred where the platform supports it, so that a steady
+ * stream of readers can not starve a writer.
+ *
+ * As with @ref ib_lock_t, reader-writer locks exist only as pointers.
+ *
+ * @param[in] lock The lock.
+ * @param[in] mm The memory manager.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC If the lock cannot be allocated or initialized.
+ * - IB_EOTHER If the lock cannot be schedule for destruction in @a mm.
+ */
+ib_status_t DLL_PUBLIC ib_rwlock_create(ib_rwlock_t **lock, ib_mm_t mm);
+
+/**
+ * Create a reader-writer lock when there is no memory manager available.
+ *
+ * @param[in] lock The lock.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC If the lock cannot be allocated or initialized.
+ */
+ib_status_t DLL_PUBLIC ib_rwlock_create_malloc(ib_rwlock_t **lock);
+
+/**
+ * Destroy a lock created by ib_rwlock_create_malloc().
+ *
+ * @param[in] lock The lock.
+ */
+void DLL_PUBLIC ib_rwlock_destroy_malloc(ib_rwlock_t *lock);
+
+/**
+ * Acquire @a lock for reading.
+ *
+ * @param[in] lock The lock.
+ */
+ib_status_t DLL_PUBLIC ib_rwlock_rdlock(ib_rwlock_t *lock);
+
+/**
+ * Acquire @a lock for writing.
+ *
+ * @param[in] lock The lock.
+ */
+ib_status_t DLL_PUBLIC ib_rwlock_wrlock(ib_rwlock_t *lock);
+
+/**
+ * Release @a lock, held for either reading or writing.
+ *
+ * @param[in] lock The lock.
+ */
+ib_status_t DLL_PUBLIC ib_rwlock_unlock(ib_rwlock_t *lock);
+
 /**
  * @} IronBeeUtilLocking Locking
  */
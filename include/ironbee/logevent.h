@@ -83,13 +83,20 @@ struct ib_logevent_t {
     size_t                   data_len;   /**< Event data size */
     uint8_t                  confidence; /**< Event confidence (percent) */
     uint8_t                  severity;   /**< Event severity (0-100?) */
+    uint32_t                 count;      /**< Times the event was added */
 };
 
 /**
  * Add an event to be logged.
  *
- * @note This function generates a logevent event.
- * see ib_engine_notify_logevent().
+ * An event with the same rule ID, message, type, recommended action,
+ * confidence and severity as an unsuppressed event already added to @a tx
+ * is not added again; the @c count of the existing event is incremented
+ * instead.  Once @a tx holds as many events as the core `LogEventLimit`
+ * of its context, further events are dropped.
+ *
+ * @note This function generates a logevent event unless @a le is a
+ * duplicate or is dropped.  see ib_engine_notify_logevent().
  *
  * @param[in,out] tx Transaction
  * @param[in] le Event
@@ -85,10 +85,24 @@ typedef struct ib_logformat_item_t {
     } item;
 } ib_logformat_item_t;
 
+/**
+ * A step of a parsed format: a literal, or a field if @c str is NULL.
+ *
+ * ib_logformat_parse() compiles the items into an array of these, so that
+ * formatting a line walks an array and copies literals of known length.
+ */
+typedef struct ib_logformat_op_t {
+    const char                 *str;   /* Literal or NULL */
+    size_t                      len;   /* Length of str */
+    const ib_logformat_field_t *field; /* Field if str is NULL */
+} ib_logformat_op_t;
+
 struct ib_logformat_t {
-    ib_mm_t      mm;
-    char        *format;
-    ib_list_t   *items;          /* List of pointers to ib_logformat_item_t */
+    ib_mm_t            mm;
+    char              *format;
+    ib_list_t         *items;    /* List of pointers to ib_logformat_item_t */
+    ib_logformat_op_t *ops;      /* items compiled by ib_logformat_parse() */
+    size_t             ops_len;  /* Number of ops */
 };
 
 /**
@@ -545,6 +545,9 @@ ib_status_t ib_logger_reopen(
  * This API must be called by a user to remove messages produced by
  * @ref ib_logger_format_fn_t, write them to a log store, and free them.
  *
+ * Messages are handled in the order they were logged.  A writer queues at
+ * most 1024 messages; threads that log wait while its queue is full.
+ *
  * @param[in] logger The logger.
  * @param[in] writer The logger writer.
  * @param[in] handler Callback function that handles the pointer to a
@@ -555,7 +558,7 @@ ib_status_t ib_logger_reopen(
  *
  * @returns
  * - IB_OK On success.
- * - Other On failure.
+ * - IB_EUNKNOWN if the writer's lock could not be taken or released.
  */
 ib_status_t DLL_PUBLIC ib_logger_dequeue(
     ib_logger_t           *logger,
@@ -564,6 +567,90 @@ ib_status_t DLL_PUBLIC ib_logger_dequeue(
     void                  *cbdata
 );
 
+/**
+ * An asynchronous log writer.
+ *
+ * A dedicated thread that dequeues and writes the records of a writer so that
+ * threads that log never perform I/O.  Use ib_logger_async_record() as the
+ * writer's @ref ib_logger_record_fn_t with the ib_logger_async_t as its data.
+ *
+ * Records are handled in batches: every record queued since the thread last
+ * woke is passed to the handler, then the flush function is called once.
+ *
+ * Threads do not survive fork(), so the thread is started by the first
+ * record of each process rather than on creation.  A writer created before
+ * the server forks its workers thus has a thread in each worker that logs.
+ * Records queued but not yet written when a process forks are written by
+ * both processes.
+ */
+typedef struct ib_logger_async_t ib_logger_async_t;
+
+/**
+ * Called by the asynchronous writer thread after each batch of records.
+ *
+ * @param[in] cbdata Callback data.
+ */
+typedef void (*ib_logger_async_flush_fn_t)(void *cbdata);
+
+/**
+ * Create an asynchronous log writer.
+ *
+ * The thread is started by ib_logger_async_record().  It is stopped when the
+ * logger's memory manager is destroyed if ib_logger_async_stop() has not been
+ * called before.
+ *
+ * @param[out] async The asynchronous writer.
+ * @param[in] logger The logger.
+ * @param[in] handler Handles each record, as for ib_logger_dequeue().
+ * @param[in] flush_fn Called after each batch.  May be NULL.
+ * @param[in] cbdata Callback data for @a handler and @a flush_fn.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ * - IB_EOTHER If the thread could not be initialized.
+ */
+ib_status_t DLL_PUBLIC ib_logger_async_create(
+    ib_logger_async_t          **async,
+    ib_logger_t                 *logger,
+    ib_queue_element_fn_t        handler,
+    ib_logger_async_flush_fn_t   flush_fn,
+    void                        *cbdata
+);
+
+/**
+ * Record function that wakes an asynchronous writer.
+ *
+ * Starts the thread if this process has none.  If the writer is stopped or
+ * the thread can not be started, the records are written by the caller.
+ *
+ * @param[in] logger The logger.
+ * @param[in] writer The writer with queued records.
+ * @param[in] data The @ref ib_logger_async_t.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - Result of ib_logger_dequeue() if the records are written by the caller.
+ */
+ib_status_t DLL_PUBLIC ib_logger_async_record(
+    ib_logger_t        *logger,
+    ib_logger_writer_t *writer,
+    void               *data
+);
+
+/**
+ * Write all queued records and stop an asynchronous writer.
+ *
+ * Must be called before the resources used by the handler are released.
+ * In a process without a thread, the queued records are written by the
+ * caller.  Calling this on a stopped writer does nothing.
+ *
+ * @param[in] async The asynchronous writer.
+ */
+void DLL_PUBLIC ib_logger_async_stop(
+    ib_logger_async_t *async
+);
+
 /**
  * A standard logger log message format.
  *
@@ -147,6 +147,14 @@ typedef ib_status_t (*ib_module_fn_cfg_copy_t)(
  *
  * This is called when the module is loaded.
  *
+ * Modules are initialized one at a time, in the order they are loaded, on
+ * the thread parsing the configuration.  An init function may register
+ * directives, hooks, operators, actions and vars without locking, and may
+ * use anything registered by modules loaded before it.  Expensive work
+ * that does not touch the engine, e.g. loading a data file, may be done on
+ * threads of the module's own, as long as it is finished by the time the
+ * module's configuration is used.
+ *
  * @param[in] ib     Engine handle
  * @param[in] m      Module
  * @param[in] cbdata Callback data
@@ -29,6 +29,7 @@
 #include <ironbee/build.h>
 #include <ironbee/types.h>
 
+#include <stdbool.h>
 #include <string.h>
 
 #ifdef __cplusplus
@@ -215,6 +216,45 @@ size_t DLL_PUBLIC ib_mpool_inuse(
     const ib_mpool_t* mp
 );
 
+/**
+ * Limit the memory in use by a memory pool.
+ *
+ * Once ib_mpool_inuse() of @a mp would exceed @a limit, allocations from
+ * @a mp fail as if out of memory.  Descendants of @a mp are not counted and
+ * have limits of their own.  The limit is kept when @a mp is cleared.
+ *
+ * @param[in] mp    Memory pool to limit.
+ * @param[in] limit Most bytes in use; 0 means no limit.
+ */
+void DLL_PUBLIC ib_mpool_limit_set(
+    ib_mpool_t *mp,
+    size_t      limit
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Get the limit of a memory pool.
+ *
+ * @param[in] mp Memory pool to query.
+ * @returns Limit set by ib_mpool_limit_set(); 0 if none.
+ */
+size_t DLL_PUBLIC ib_mpool_limit(
+    const ib_mpool_t *mp
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Has an allocation from a memory pool failed because of its limit?
+ *
+ * @param[in] mp Memory pool to query.
+ * @returns true if an allocation was refused since @a mp was created or
+ *          last cleared.
+ */
+bool DLL_PUBLIC ib_mpool_limit_reached(
+    const ib_mpool_t *mp
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Assure that at least @a pages pages are preallocated in the free pages list.
  *
@@ -45,8 +45,11 @@ extern "C" {
  * @ref ib_mpool_t.  However, it has lower memory overhead, especially
  * for small numbers of allocations.
  *
- * A lite mpool uses `2+3C+N` pointers where `C` is the number of cleanup
- * functions and `N` is the number of allocations.
+ * Allocations of up to 256 bytes are carved from slabs, so that many small
+ * allocations cost few calls to malloc().  The first slab of a pool is
+ * 1 KiB, and each further slab doubles in size up to 16 KiB.  Memory from
+ * a slab is aligned to 16 bytes.  Larger allocations cost one call to
+ * malloc() and one pointer each.
  *
  * To keep this code minimal, malloc() and free() are used.  There is no
  * support for alternative allocators.
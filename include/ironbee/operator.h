@@ -125,6 +125,73 @@ typedef ib_status_t (* ib_operator_execute_fn_t)(
 )
 NONNULL_ATTRIBUTE(1, 2, 4);
 
+/**
+ * Size in bytes of a batch match bitmap for @a count inputs.
+ *
+ * @param[in] count Number of inputs.
+ */
+#define IB_OPERATOR_BATCH_BITMAP_SIZE(count) (((count) + 7) / 8)
+
+/**
+ * Mark input @a i as matching in batch match bitmap @a bitmap.
+ *
+ * @param[in] bitmap Batch match bitmap (uint8_t *).
+ * @param[in] i      Index of input.
+ */
+#define IB_OPERATOR_BATCH_SET(bitmap, i) \
+    ((bitmap)[(i) / 8] |= (uint8_t)(1 << ((i) % 8)))
+
+/**
+ * True iff input @a i is marked as matching in batch match bitmap @a bitmap.
+ *
+ * @param[in] bitmap Batch match bitmap (const uint8_t *).
+ * @param[in] i      Index of input.
+ */
+#define IB_OPERATOR_BATCH_ISSET(bitmap, i) \
+    (((bitmap)[(i) / 8] & (1 << ((i) % 8))) != 0)
+
+/**
+ * Operator instance batch execution callback type.
+ *
+ * Optional companion of @ref ib_operator_execute_fn_t that executes the
+ * operator on several inputs in one call, which allows an operator to do
+ * its per-call setup once for all values of a collection.
+ *
+ * The same rules as for @ref ib_operator_execute_fn_t apply.  In addition:
+ * -# The result for each input must be the same as the result of the
+ *    execute function on that input.
+ * -# There is no capture; the rule engine only uses batch execution for
+ *    rules that do not capture.
+ * -# Results are computed before the actions of any input run, so the
+ *    result must not depend on state that actions may modify.
+ *
+ * @param[in]  tx            Current transaction.
+ * @param[in]  inputs        The fields to operate on.
+ * @param[in]  count         Number of elements of @a inputs.
+ * @param[out] matches       Match bitmap of
+ *                           IB_OPERATOR_BATCH_BITMAP_SIZE(@a count) bytes,
+ *                           zeroed by the caller.  Set the bit of each
+ *                           input with a true result with
+ *                           IB_OPERATOR_BATCH_SET().
+ * @param[in]  instance_data Instance data.
+ * @param[in]  cbdata        Callback data.
+ *
+ * @return
+ * - IB_OK on success.
+ * - IB_EALLOC on memory allocation errors.
+ * - IB_EINVAL if an input field type is incompatible.
+ * - IB_EOTHER something unexpected happened.
+ */
+typedef ib_status_t (* ib_operator_execute_batch_fn_t)(
+    ib_tx_t                  *tx,
+    const ib_field_t * const *inputs,
+    size_t                    count,
+    uint8_t                  *matches,
+    void                     *instance_data,
+    void                     *cbdata
+)
+NONNULL_ATTRIBUTE(1, 2, 4);
+
 /* Operator capabilities */
 /*! No capabilities */
 #define IB_OP_CAPABILITY_NONE        (0x0)
@@ -132,6 +199,21 @@ NONNULL_ATTRIBUTE(1, 2, 4);
 #define IB_OP_CAPABILITY_ALLOW_NULL  (1 << 0)
 /*! Supports capture */
 #define IB_OP_CAPABILITY_CAPTURE     (1 << 3)
+/*! Execute may run concurrently on copies of the transaction that differ
+ *  only in their memory manager, given a NULL capture collection.  The
+ *  operator must not modify the transaction, its vars or its instance data.
+ *  Instances whose parameters contain a var expansion do not have this
+ *  capability; see ib_operator_inst_capabilities(). */
+#define IB_OP_CAPABILITY_THREAD_SAFE (1 << 4)
+/*! Instances with equal parameters in the same context may be shared by
+ *  rules; see ib_operator_inst_acquire().  The instance data must not be
+ *  modified after creation or used to tell rules apart, e.g., as a key of
+ *  per-transaction state. */
+#define IB_OP_CAPABILITY_SHAREABLE   (1 << 5)
+/*! Stream operator that keeps state across the data of a transaction, so
+ *  it must be given each byte once; RuleEngineStreamOverlap is not applied
+ *  to its rules. */
+#define IB_OP_CAPABILITY_STREAM      (1 << 6)
 
 /**
  * Create an operator.
@@ -168,6 +250,23 @@ ib_status_t DLL_PUBLIC ib_operator_create(
 )
 NONNULL_ATTRIBUTE(1, 3);
 
+/**
+ * Set the batch execute function of an operator.
+ *
+ * Should be called before any instance of @a op is executed, usually right
+ * after the operator is created.
+ *
+ * @param[in] op                   Operator.
+ * @param[in] execute_batch_fn     Batch execute function; NULL to remove.
+ * @param[in] execute_batch_cbdata Batch execute callback data.
+ */
+void DLL_PUBLIC ib_operator_set_execute_batch(
+    ib_operator_t                  *op,
+    ib_operator_execute_batch_fn_t  execute_batch_fn,
+    void                           *execute_batch_cbdata
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Register non-stream operator with engine.
  *
@@ -338,6 +437,17 @@ ib_flags_t DLL_PUBLIC ib_operator_capabilities(
 )
 NONNULL_ATTRIBUTE(1);
 
+/**
+ * Does an operator have a batch execute function?
+ *
+ * @param[in] op Operator.
+ * @return true iff a batch execute function was set for @a op.
+ */
+bool DLL_PUBLIC ib_operator_has_execute_batch(
+    const ib_operator_t *op
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Create an operator instance.
  *
@@ -367,6 +477,36 @@ ib_status_t DLL_PUBLIC ib_operator_inst_create(
 )
 NONNULL_ATTRIBUTE(1, 3, 4);
 
+/**
+ * Acquire an operator instance, sharing it if possible.
+ *
+ * If @a op has @ref IB_OP_CAPABILITY_SHAREABLE, returns the instance
+ * previously acquired for @a op with the same @a parameters in @a ctx, if
+ * any, so that rules applying the same operator and parameters do not each
+ * create, e.g., compile, their own instance.  Otherwise, or on first use,
+ * this is ib_operator_inst_create() with the main memory manager of the
+ * engine of @a ctx.
+ *
+ * Shared instances are shared by rules, so they must not be modified.  This
+ * may only be called during configuration.
+ *
+ * @param[out] op_inst               The operator instance.
+ * @param[in]  ctx                   Current IronBee context
+ * @param[in]  op                    Operator to create instance of.
+ * @param[in]  required_capabilities Required operator capabilities.
+ * @param[in]  parameters            Parameters used to create the instance.
+ *
+ * @return As ib_operator_inst_create().
+ */
+ib_status_t DLL_PUBLIC ib_operator_inst_acquire(
+    ib_operator_inst_t  **op_inst,
+    ib_context_t         *ctx,
+    const ib_operator_t  *op,
+    ib_flags_t            required_capabilities,
+    const char           *parameters
+)
+NONNULL_ATTRIBUTE(1, 2, 3);
+
 /**
  * Get the operator of an operator instance.
  *
@@ -391,6 +531,22 @@ const char DLL_PUBLIC *ib_operator_inst_parameters(
 )
 NONNULL_ATTRIBUTE(1);
 
+/**
+ * Get the capabilities of an operator instance.
+ *
+ * These are the capabilities of its operator, except that
+ * @ref IB_OP_CAPABILITY_THREAD_SAFE is cleared if the parameters contain
+ * a var expansion (see ib_var_expand_test()).
+ *
+ * @param[in] op_inst Operator instance to access.
+ *
+ * @return Capabilities of operator instance.
+ */
+ib_flags_t DLL_PUBLIC ib_operator_inst_capabilities(
+    const ib_operator_inst_t *op_inst
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Get the instance data of an operator instance.
  *
@@ -426,6 +582,32 @@ ib_status_t DLL_PUBLIC ib_operator_inst_execute(
 )
 NONNULL_ATTRIBUTE(1, 5);
 
+/**
+ * Execute operator on several inputs.
+ *
+ * Uses the batch execute function of the operator if it has one, otherwise
+ * executes the operator on each input in turn.  Inversion is not applied.
+ *
+ * @param[in]  op_inst Operator instance.
+ * @param[in]  tx      Current transaction.
+ * @param[in]  inputs  Inputs.
+ * @param[in]  count   Number of elements of @a inputs.
+ * @param[out] matches Match bitmap of IB_OPERATOR_BATCH_BITMAP_SIZE(@a count)
+ *                     bytes.  Cleared and then set for each matching input.
+ * @return
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ * - Other on other failure.
+ */
+ib_status_t DLL_PUBLIC ib_operator_inst_execute_batch(
+    const ib_operator_inst_t *op_inst,
+    ib_tx_t                  *tx,
+    const ib_field_t * const *inputs,
+    size_t                    count,
+    uint8_t                  *matches
+)
+NONNULL_ATTRIBUTE(1, 5);
+
 #ifdef __cplusplus
 }
 #endif
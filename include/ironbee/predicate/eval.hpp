@@ -250,6 +250,24 @@ public:
         return m_value;
     }
 
+    /**
+     * Version of value.
+     *
+     * Increases whenever the value, finished state, or forwarding of the
+     * node changes, including when an aliased list grows.  Nodes whose
+     * results depend only on the values of other nodes may use this to
+     * avoid recalculating when those values did not change.
+     *
+     * @warning Not relevant if forwarding. See GraphEvalState::version().
+     **/
+    size_t version() const
+    {
+        if (is_aliased() && m_value.type() == Value::LIST) {
+            return m_version + m_value.as_list().size();
+        }
+        return m_version;
+    }
+
     ///@}
 
     /**
@@ -282,6 +300,8 @@ private:
     boost::any m_state;
     //! Last phase evaluated at.
     ib_rule_phase_num_t m_phase;
+    //! Number of changes made via the value modifiers.
+    size_t m_version;
 };
 
 /**
@@ -359,6 +379,11 @@ struct GraphEvalProfileData {
  * 3. Use values() and is_finished() as necessary.  Both of these are only
  *    updated by eval(), so it is generally advisable to call eval() at each
  *    phase before any calls to values() or is_finished().
+ * 4. Optionally, call reset() and start again at 2 for a new transaction.
+ *
+ * A single GraphEvalState may thus be reused for many transactions.  The
+ * cost of reset() is proportional to the number of nodes touched since the
+ * last reset rather than to the size of the graph.
  **/
 class GraphEvalState
 {
@@ -408,6 +433,7 @@ public:
      */
     NodeEvalState& node_eval_state(size_t idx)
     {
+        m_touched.set(idx);
         return m_vector[idx];
     }
 
@@ -482,6 +508,19 @@ public:
      **/
     ib_rule_phase_num_t phase(const Node* node, EvalContext context);
 
+    /**
+     * Version of node.
+     *
+     * Combines NodeEvalState::version() of every node in the forwarding
+     * chain.  If the value or finished state of node, as seen through
+     * forwarding, changes, then so does the result.
+     *
+     * @param[in] node    Node to find version of.
+     * @param[in] context Evaluation context.
+     * @return Version of node.
+     **/
+    size_t version(const Node* node, EvalContext context);
+
     ///@}
 
     /**
@@ -513,6 +552,19 @@ public:
      **/
     void eval(const Node* node, EvalContext context);
 
+    /**
+     * Return to the state just after construction.
+     *
+     * Every node touched since construction or the last reset() is returned
+     * to a default NodeEvalState and marked uninitialized.  Profiling data
+     * is cleared; whether profiling is enabled is unchanged.
+     *
+     * Any values held by the state, e.g., those allocated from a
+     * transaction memory manager, are released; reset() must be called
+     * before reusing the state for a different transaction.
+     **/
+    void reset();
+
     /**
      * @name Profiling
      * Methods to access and control graph profiling information.
@@ -560,14 +612,15 @@ private:
     //! Has a node in m_vector and m_graph been initialized.
     boost::dynamic_bitset<> m_initialized;
 
+    //! Has a node in m_vector been accessed since the last reset().
+    boost::dynamic_bitset<> m_touched;
+
     //! If true, eval() profiles node evaluation.
     bool m_profile;
 
     //! List of all node profiling execution timings.
     profiler_data_list_t m_profile_data;
 
-    std::list<Node*> m_empty_tag_list;
-
     /**
      * At the start of a call eval(), this points at the parent profile data.
      *
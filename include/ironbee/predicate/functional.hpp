@@ -181,7 +181,8 @@ public:
      *
      * See Node::pre_eval().
      *
-     * Calls Base::setup().
+     * Calls Base::setup() and records the dynamic arguments, so that
+     * evaluation need not search children for them.
      **/
     virtual
     void pre_eval(
@@ -216,11 +217,29 @@ public:
         EvalContext     context
     ) const;
 
+    //! Non-literal argument and its index.
+    typedef std::pair<const Node*, size_t> arg_with_index_t;
+    //! Vector of @ref arg_with_index_t.
+    typedef std::vector<arg_with_index_t> arg_vec_t;
+
 private:
+    /**
+     * Non-literal arguments with their indices, in order.
+     *
+     * @param[out] scratch Filled with arguments if pre_eval() has not run.
+     * @return Arguments recorded by pre_eval(); or @a scratch if pre_eval()
+     *         has not run.
+     **/
+    const arg_vec_t& dynamic_args(arg_vec_t& scratch) const;
+
     //! Pointer to Base delegate.
     base_p m_base;
     //! Name.
     const std::string m_name;
+    //! Has pre_eval() recorded @ref m_dynamic_args.
+    bool m_prepared;
+    //! Non-literal arguments; valid if @ref m_prepared.
+    arg_vec_t m_dynamic_args;
 };
 
 } // Impl
@@ -297,6 +316,11 @@ public:
     /**
      * Evaluate.
      *
+     * Called at most once per phase, and only at the first evaluation or
+     * when the value or finished state of a dynamic argument changed since
+     * the previous call.  Thus, implementations must depend only on their
+     * arguments and @a substate.
+     *
      * @param[in] mm               Memory manager defining lifetime of any
      *                             new values.
      * @param[in] me               Node being evaluated.
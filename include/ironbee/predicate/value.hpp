@@ -36,6 +36,11 @@ namespace Predicate {
 /**
  * A Value in Predicate.
  *
+ * A Value is a single pointer to a field and is as cheap to copy and store,
+ * e.g., in lists of values, as the pointer.  The accessors used in
+ * evaluation, such as type() and truthiness, are inline and read the field
+ * directly.
+ *
  * This class is based on and similar to Field and ConstField.  In contrast
  * to Field, it provides the subset of functionality useful to Predicate and
  * some additional, Predicate  specific functionality: namely truthiness and
@@ -265,7 +270,14 @@ public:
      *
      * @return Iff value should be treated as truthy.
      **/
-    operator unspecified_bool_type() const;
+    operator unspecified_bool_type() const
+    {
+        // Intentionally inline.
+        return (
+            ib() &&
+            (ib()->type != IB_FTYPE_LIST || list_is_nonempty())
+        ) ? unspecified_bool : NULL;
+    }
 
     /**
      * Is null?
@@ -273,7 +285,11 @@ public:
      * Note that an empty list is a falsy non-null value.
      * @return True iff value is the NULL value.
      **/
-    bool is_null() const;
+    bool is_null() const
+    {
+        // Intentionally inline.
+        return ! ib();
+    }
 
     /**
      * Convert to sexpr.
@@ -301,18 +317,31 @@ public:
 
     //@}
 
+    // Intentionally inline.
     //! Name.
-    const char* name() const;
+    const char* name() const
+    {
+        return ib()->name;
+    }
     //! Length of name.
-    size_t name_length() const;
+    size_t name_length() const
+    {
+        return ib()->nlen;
+    }
 
     //! Type of value.
-    type_e type() const;
+    type_e type() const
+    {
+        return static_cast<type_e>(ib()->type);
+    }
 
 private:
     // Used for unspecified_bool_type.
     static void unspecified_bool(Value***) {};
 
+    //! True iff list value is not empty.  Value must be a list.
+    bool list_is_nonempty() const;
+
     //! Underlying field.
     ConstField m_field;
 };
@@ -175,11 +175,14 @@ ib_status_t DLL_PUBLIC ib_resource_acquire(
  * Return the given resource to its resource pool.
  *
  * This resource will be put in the free queue or, possibly,
- * destroyed if its use count is too high.
+ * destroyed if its use count is too high.  If destroying it leaves fewer
+ * resources than the minimum, a replacement is created immediately so that
+ * the pool stays pre-created.
  *
  * @param[in] resource The resource to return.
  * @returns
  * - IB_OK On success.
+ * - Other if the user create function fails when creating a replacement.
  */
 ib_status_t DLL_PUBLIC ib_resource_release(
     ib_resource_t *resource
@@ -252,6 +255,30 @@ ib_status_t DLL_PUBLIC ib_resource_pool_set_max(
 )
 NONNULL_ATTRIBUTE(1);
 
+/**
+ * Give each thread a cache of up to @a size free resources.
+ *
+ * Resources released by a thread are kept in its cache and handed back to it
+ * by the next ib_resource_acquire(), without touching the shared free queue.
+ * Once enabled, the pool is also safe to use from multiple threads without
+ * external locking.  Resources cached by a thread return to the pool when the
+ * thread exits or the pool is flushed.
+ *
+ * This must be called before the pool is used by more than one thread.
+ *
+ * @param[in] resource_pool The resource pool.
+ * @param[in] size Maximum number of resources cached per thread.
+ * @return
+ * - IB_OK On success.
+ * - IB_EINVAL If @a size is 0 or caching is already enabled.
+ * - IB_EALLOC On allocation errors.
+ */
+ib_status_t DLL_PUBLIC ib_resource_pool_thread_cache(
+    ib_resource_pool_t *resource_pool,
+    size_t              size
+)
+NONNULL_ATTRIBUTE(1);
+
 /** @} IronBeeUtilResourcePool */
 
 #ifdef __cplusplus
@@ -87,6 +87,7 @@ typedef enum {
 #define IB_RULE_FLAG_ACTION   (IB_RULE_FLAG_NO_TGT)
 #define IB_RULE_FLAG_FIELDS   (1 << 9) /**< Create FIELD_xxx fields */
 #define IB_RULE_FLAG_TRACE    (1 << 10) /**< Trace rule */
+#define IB_RULE_FLAG_RESOLVED (1 << 11) /**< Var sources resolved */
 
 /**
  * Rule execution flags
@@ -181,6 +182,14 @@ typedef enum {
     IB_RULE_DLOG_TRACE,             /**< Reserved for future use */
 } ib_rule_dlog_level_t;
 
+/**
+ * Rule execution ordering within a phase
+ **/
+typedef enum {
+    IB_RULE_ORDERING_CONFIG,        /**< Configuration order */
+    IB_RULE_ORDERING_ADAPTIVE,      /**< Reorder by cost and match rate */
+} ib_rule_ordering_t;
+
 /**
  * Rule engine: Basic rule type information
  */
@@ -92,6 +92,7 @@ struct ib_rule_t {
     ib_rule_t             *chained_rule;    /**< Next rule in the chain */
     ib_rule_t             *chained_from;    /**< Ptr to rule chained from */
     const char            *capture_collection; /**< Capture collection name */
+    ib_var_source_t       *capture_source;  /**< Capture collection source */
     ib_flags_t             flags;           /**< External, etc. */
 };
 
@@ -128,6 +129,33 @@ typedef struct {
     size_t evaluation_n;
 } ib_rule_trace_t;
 
+/** Number of buckets of a rule latency histogram. */
+#define IB_RULE_PROFILE_BUCKETS (20)
+
+/**
+ * Rule profile
+ *
+ * Execution statistics of a rule, aggregated over all transactions of
+ * contexts with RuleEngineProfile enabled, and of all contexts while
+ * ib_rule_profile_set() has profiling on.  Bucket 0 of the histogram counts
+ * executions that took less than a microsecond, bucket i counts executions
+ * that took at least 2^(i-1) and less than 2^i microseconds and the last
+ * bucket counts all longer executions.  Chained rules are included in the
+ * time of the rule they are chained from.
+ *
+ * The fields are updated with relaxed atomic operations by every thread
+ * executing rules; while rules run, a reader may see a profile that is a
+ * few executions behind, or fields that disagree by as much.
+ */
+typedef struct {
+    const ib_rule_t *rule;        /**< Profiled rule */
+    uint64_t         evaluations; /**< Number of executions */
+    uint64_t         matches;     /**< Executions with a true result */
+    uint64_t         time;        /**< Total time (microseconds) */
+    uint64_t         max_time;    /**< Longest execution (microseconds) */
+    uint64_t         histogram[IB_RULE_PROFILE_BUCKETS]; /**< Latencies */
+} ib_rule_profile_t;
+
 /**
  * Rule execution data
  */
@@ -153,16 +181,58 @@ struct ib_rule_exec_t {
     /* The below members are for rule engine internal use only, and should
      * never be accessed by actions, injection functions, etc. */
 
-    /* Rule stack (for chains) */
-    ib_list_t              *rule_stack;  /**< Stack of rules */
+    /* Rule stack (for chains), preallocated and grown on demand */
+    struct ib_rule_exec_frame_t *rule_stack; /**< Stack of rule frames */
+    size_t                  rule_stack_depth; /**< Frames in use */
+    size_t                  rule_stack_size;  /**< Frames allocated */
 
-    /* List of all rules to run during the current phase. */
+    /* List of rules injected into the current phase.  The context's own
+     * rules are run from its precompiled phase rule array. */
     ib_list_t              *phase_rules; /**< List of ib_rule_t */
 
     /**
-     * Stack of @ref ib_field_t used for creating FIELD* targets
+     * Stack of @ref ib_field_t used for creating FIELD* targets,
+     * preallocated and grown on demand.
+     */
+    const ib_field_t      **value_stack;
+    size_t                  value_stack_depth; /**< Values in use */
+    size_t                  value_stack_size;  /**< Values allocated */
+
+    /**
+     * Transformation results of the current phase, keyed by source value
+     * and transformation chain.
+     */
+    ib_hash_t              *tfn_cache;
+    size_t                  tfn_cache_hits;   /**< Transformation cache hits */
+    size_t                  tfn_cache_misses; /**< Transformation cache misses */
+
+    /**
+     * Body data coalesced for stream rules, indexed by direction
+     * (0: request, 1: response).
+     */
+    char                   *stream_buffer[2];
+    size_t                  stream_buffer_length[2]; /**< Bytes buffered */
+
+    /**
+     * Last body data given to stream rules, passed again in front of the
+     * next data (RuleEngineStreamOverlap), indexed by direction.
+     */
+    char                   *stream_overlap[2];
+    size_t                  stream_overlap_length[2]; /**< Bytes kept */
+    char                   *stream_window[2];   /**< Overlap plus data */
+    size_t                  stream_window_size[2]; /**< Size of window */
+
+    /**
+     * Operator results computed by parallel rule execution, indexed by rule
+     * index, or NULL if parallel execution has not been used yet.
+     */
+    struct ib_rule_parallel_result_t *parallel_results;
+    size_t                  parallel_hits; /**< Results used by rules */
+
+    /**
+     * Arm of RuleEngineCompare the transaction runs in (0: A, 1: B).
      */
-    ib_list_t              *value_stack;
+    size_t                  compare_arm;
 
 #ifdef IB_RULE_TRACE
     ib_rule_trace_t        *traces; /**< Rule trace information. */
@@ -1286,6 +1356,149 @@ ib_status_t DLL_PUBLIC ib_rule_chain_invalidate(
  */
 ib_mm_t DLL_PUBLIC ib_rule_mm(ib_engine_t *ib);
 
+/**
+ * Get the profile of a rule.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in] rule Rule
+ * @param[out] profile Profile of @a rule
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_ENOENT if @a rule has never been executed with profiling enabled.
+ */
+ib_status_t DLL_PUBLIC ib_rule_profile_get(
+    const ib_engine_t        *ib,
+    const ib_rule_t          *rule,
+    const ib_rule_profile_t **profile)
+NONNULL_ATTRIBUTE(1, 2, 3);
+
+/**
+ * Turn profiling of the rules of all contexts on or off.
+ *
+ * This is in addition to RuleEngineProfile, which turns profiling on for
+ * the contexts it is set in from configuration on: it may be called while
+ * transactions are running, e.g., from the control channel, to profile a
+ * running engine for a time.  Profiles are kept when profiling is turned
+ * off; see ib_rule_profile_reset().
+ *
+ * This must not be called from more than one thread at a time.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in] enabled Profile all rules?
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ */
+ib_status_t DLL_PUBLIC ib_rule_profile_set(
+    ib_engine_t *ib,
+    bool         enabled)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Is profiling of the rules of all contexts on?
+ *
+ * @param[in] ib IronBee engine
+ *
+ * @returns true if ib_rule_profile_set() turned profiling on.
+ */
+bool DLL_PUBLIC ib_rule_profile_enabled(
+    const ib_engine_t *ib)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Discard the profiles of all rules.
+ *
+ * Rules running at the same time may leave a partial record.
+ *
+ * @param[in] ib IronBee engine
+ */
+void DLL_PUBLIC ib_rule_profile_reset(
+    ib_engine_t *ib)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Get the profiles of the rules that used the most time.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in] mm Memory manager to allocate @a profiles from
+ * @param[in] limit Maximum number of profiles to return (0: no limit)
+ * @param[out] profiles List of const ib_rule_profile_t, by decreasing
+ *                      total time
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ */
+ib_status_t DLL_PUBLIC ib_rule_profile_hot(
+    const ib_engine_t  *ib,
+    ib_mm_t             mm,
+    size_t              limit,
+    ib_list_t         **profiles)
+NONNULL_ATTRIBUTE(1, 4);
+
+/**
+ * Estimate a latency quantile of a rule profile.
+ *
+ * @param[in] profile Rule profile
+ * @param[in] quantile Quantile, between 0 and 1
+ *
+ * @returns Upper bound (microseconds) of the histogram bucket holding
+ *          @a quantile; the maximum time for the last bucket.
+ */
+uint64_t DLL_PUBLIC ib_rule_profile_quantile(
+    const ib_rule_profile_t *profile,
+    double                   quantile)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Log the profiles of the rules that used the most time.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in] limit Maximum number of rules to report (0: no limit)
+ */
+void DLL_PUBLIC ib_rule_profile_report(
+    ib_engine_t *ib,
+    size_t       limit)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Get the profiles of a rule in the two arms of RuleEngineCompare.
+ *
+ * Transactions alternate between arm A, which executes rules as
+ * configured, and arm B, which executes them in configuration order
+ * without parallel rule execution.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in] rule Rule
+ * @param[out] profile_a Profile of @a rule in arm A
+ * @param[out] profile_b Profile of @a rule in arm B
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_ENOENT if @a rule has never been executed with RuleEngineCompare
+ *     enabled.
+ */
+ib_status_t DLL_PUBLIC ib_rule_compare_get(
+    const ib_engine_t        *ib,
+    const ib_rule_t          *rule,
+    const ib_rule_profile_t **profile_a,
+    const ib_rule_profile_t **profile_b)
+NONNULL_ATTRIBUTE(1, 2, 3, 4);
+
+/**
+ * Log the profiles of the rules that used the most time in the two arms
+ * of RuleEngineCompare, side by side.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in] limit Maximum number of rules to report (0: no limit)
+ */
+void DLL_PUBLIC ib_rule_compare_report(
+    ib_engine_t *ib,
+    size_t       limit)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Perform logging of a rule's execution
  *
@@ -0,0 +1,170 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef _IB_SHM_RING_H_
+#define _IB_SHM_RING_H_
+
+/**
+ * @file
+ * @brief IronBee --- Shared Memory Ring
+ */
+
+#include <ironbee/build.h>
+#include <ironbee/mm.h>
+#include <ironbee/types.h>
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup IronBeeUtilShmRing Shared Memory Ring
+ * @ingroup IronBeeUtil
+ *
+ * A ring buffer of records in a memory-mapped file, such as one in
+ * @c /dev/shm, to pass data from one process to another.
+ *
+ * There is one producer and one consumer, which may be in different
+ * processes.  Neither takes a lock: each only writes its own position in
+ * the ring.  The producer copies a record in once; the consumer reads it
+ * in place and releases it when done.  A ring with several producers,
+ * e.g., the workers of a server, must serialize them, or use a ring for
+ * each.
+ *
+ * Neither side blocks: a full ring refuses a record and an empty one has
+ * none to read, and the caller decides whether to wait, retry or drop.
+ *
+ * @{
+ */
+
+/**
+ * A shared memory ring.
+ */
+typedef struct ib_shm_ring_t ib_shm_ring_t;
+
+/**
+ * Open the ring in @a path, creating it if necessary.
+ *
+ * The file is created with room for @a capacity bytes of records.  The
+ * capacity of an existing ring is used instead.  The ring is unmapped
+ * when @a mm is cleaned up.
+ *
+ * @param[out] ring     The ring.
+ * @param[in]  mm       Memory manager to allocate from.
+ * @param[in]  path     The file the ring is kept in.
+ * @param[in]  capacity Capacity of a new ring; rounded up to a multiple
+ *                      of 8 bytes.
+ * @returns
+ * - IB_OK on success.
+ * - IB_EINVAL if @a capacity is too small or @a path is not a ring.
+ * - IB_EALLOC on allocation failure.
+ * - IB_EOTHER on a system call failure; see @c errno.
+ */
+ib_status_t DLL_PUBLIC ib_shm_ring_open(
+    ib_shm_ring_t **ring,
+    ib_mm_t         mm,
+    const char     *path,
+    size_t          capacity
+)
+NONNULL_ATTRIBUTE(1, 3);
+
+/**
+ * Largest record @a ring accepts.
+ *
+ * @param[in] ring The ring.
+ * @returns Largest length that ib_shm_ring_push() accepts.
+ */
+size_t DLL_PUBLIC ib_shm_ring_max_record(
+    const ib_shm_ring_t *ring
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Add a record to @a ring.
+ *
+ * Only the producer may call this.
+ *
+ * @param[in] ring   The ring.
+ * @param[in] data   Record.
+ * @param[in] length Length of @a data.
+ * @returns
+ * - IB_OK on success.
+ * - IB_EAGAIN if there is no room for the record now.
+ * - IB_EINVAL if the record is larger than ib_shm_ring_max_record().
+ */
+ib_status_t DLL_PUBLIC ib_shm_ring_push(
+    ib_shm_ring_t *ring,
+    const void    *data,
+    size_t         length
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Mark the end of the records of @a ring.
+ *
+ * Only the producer may call this.  The consumer reads any records in
+ * the ring before it sees the end.
+ *
+ * @param[in] ring The ring.
+ */
+void DLL_PUBLIC ib_shm_ring_close(
+    ib_shm_ring_t *ring
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Read the oldest record of @a ring in place.
+ *
+ * Only the consumer may call this.  The record remains valid, and
+ * remains the oldest record, until ib_shm_ring_pop() is called.
+ *
+ * @param[in]  ring   The ring.
+ * @param[out] data   The record.
+ * @param[out] length Length of @a data.
+ * @returns
+ * - IB_OK on success.
+ * - IB_EAGAIN if there is no record now.
+ * - IB_ENOENT if there is no record and the ring is closed.
+ */
+ib_status_t DLL_PUBLIC ib_shm_ring_peek(
+    ib_shm_ring_t  *ring,
+    const void    **data,
+    size_t         *length
+)
+NONNULL_ATTRIBUTE(1, 2, 3);
+
+/**
+ * Release the record returned by ib_shm_ring_peek().
+ *
+ * Only the consumer may call this.
+ *
+ * @param[in] ring The ring.
+ */
+void DLL_PUBLIC ib_shm_ring_pop(
+    ib_shm_ring_t *ring
+)
+NONNULL_ATTRIBUTE(1);
+
+/** @} IronBeeUtilShmRing */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IB_SHM_RING_H_ */
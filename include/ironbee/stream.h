@@ -74,6 +74,8 @@ struct ib_stream_t {
     /// @todo Need a list of recycled sdata
     ib_mm_t                 mm;         /**< Stream memory manager */
     size_t                  slen;       /**< Stream length */
+    size_t                  tail_avail; /**< Room after the tail's data if
+                                             ib_stream_append() owns it */
     IB_LIST_GEN_REQ_FIELDS(ib_sdata_t);     /* Required list fields */
 };
 
@@ -125,6 +127,27 @@ ib_status_t DLL_PUBLIC ib_stream_push(ib_stream_t *s,
                                       void *data,
                                       size_t dlen);
 
+/**
+ * Append a copy of data to a stream.
+ *
+ * Where ib_stream_push() references @a data, this copies it into buffer
+ * segments owned by the stream.  Data appended in short pieces, e.g., a
+ * chunked body, shares segments of @a segment_size bytes instead of taking
+ * a node each: @a data fills the room left in the last segment, if the
+ * stream's tail is one, and the rest starts a new segment.  Long data is
+ * usually better pushed, without copying, by reference.
+ *
+ * @param s Stream
+ * @param data Data
+ * @param dlen Data length
+ * @param segment_size Size of new buffer segments
+ * @returns Status code
+ */
+ib_status_t DLL_PUBLIC ib_stream_append(ib_stream_t *s,
+                                        const void *data,
+                                        size_t dlen,
+                                        size_t segment_size);
+
 /**
  * Pull a chunk of data (or metadata) from a stream.
  *
@@ -28,6 +28,7 @@
 #include <ironbee/mm.h>
 #include <ironbee/types.h>
 #include <ironbee/mpool_freeable.h>
+#include <ironbee/queue.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -80,6 +81,8 @@ extern "C" {
  * - ib_stream_io_tx_error_add() - Add error to an io_tx input.
  * - ib_stream_io_tx_reuse() - Swap input with output for reuse.
  * - ib_stream_io_tx_redo() - Clear the output list. Resubmit the input list.
+ * - ib_stream_io_tx_hold() - Hold unconsumed input for a later pass.
+ * - ib_stream_io_tx_unhold() - Return held input to the input list.
  *
  * @{
  */
@@ -248,10 +251,50 @@ ib_status_t DLL_PUBLIC ib_stream_io_tx_redo(
     ib_stream_io_tx_t *io_tx
 ) NONNULL_ATTRIBUTE(1);
 
+/**
+ * Move the data left in the input list of @a io_tx to the end of @a held.
+ *
+ * This is how a pipeline applies backpressure: data a processor did not
+ * consume is kept, still owned, and is returned to the processor's input
+ * with ib_stream_io_tx_unhold() the next time the processor runs.
+ *
+ * @param[in] io_tx The transaction.
+ * @param[in] held Queue of @ref ib_stream_io_data_t to append to. It must
+ *            have been created with a memory manager that outlives the
+ *            data it holds.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation error.
+ */
+ib_status_t DLL_PUBLIC ib_stream_io_tx_hold(
+    ib_stream_io_tx_t *io_tx,
+    ib_queue_t        *held
+) NONNULL_ATTRIBUTE(1, 2);
+
+/**
+ * Move the data in @a held to the front of the input list of @a io_tx.
+ *
+ * The held data keeps its order and is placed before any input
+ * already in @a io_tx. @a held is empty afterwards.
+ *
+ * @param[in] io_tx The transaction.
+ * @param[in] held Queue filled by ib_stream_io_tx_hold().
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation error.
+ */
+ib_status_t DLL_PUBLIC ib_stream_io_tx_unhold(
+    ib_stream_io_tx_t *io_tx,
+    ib_queue_t        *held
+) NONNULL_ATTRIBUTE(1, 2);
+
 /**
  * Clean up a transaction, releasing all resources.
  *
- * A transaction is not usable after this is called.
+ * All data in the input and output lists is released. The (empty)
+ * transaction may then be filled and processed again.
  * If you would like to reuse a transaction object,
  * using its output stream as the input, see ib_stream_io_tx_reuse().
  *
@@ -81,6 +81,12 @@ typedef ib_status_t (*ib_stream_processor_create_fn)(
  * calling @ref ib_stream_io_data_slice() or
  * @ref ib_stream_io_data_ref().
  *
+ * A processor that returns IB_OK without consuming all of its input, for
+ * example because it needs more data to make a decision, leaves the rest
+ * in its input. A @ref ib_stream_pump_t holds that data and presents it
+ * again, ahead of any new data, the next time the processor executes.
+ * Data left after the stream is closed is released.
+ *
  * @sa ib_stream_io_data_slice()
  * @sa ib_stream_io_data_ref()
  *
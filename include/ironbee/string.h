@@ -71,6 +71,53 @@ const char DLL_PUBLIC *ib_strstr(
     size_t      needle_len
 );
 
+/**
+ * Precompiled substring search.
+ *
+ * Holds the skip table of a needle so that it can be searched for
+ * repeatedly without preparing it again.
+ */
+typedef struct ib_strsearch_t ib_strsearch_t;
+
+/**
+ * Precompile a substring search for @a needle.
+ *
+ * @param[out] search Created search.  Lifetime is that of @a mm.
+ * @param[in] mm Memory manager.
+ * @param[in] needle String to search for.  Copied.
+ * @param[in] needle_len Length of @a needle.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+ib_status_t DLL_PUBLIC ib_strsearch_create(
+    ib_strsearch_t **search,
+    ib_mm_t          mm,
+    const char      *needle,
+    size_t           needle_len
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Find the first occurrence of the needle of @a search in @a haystack.
+ *
+ * Equivalent to ib_strstr() with the needle of @a search.
+ *
+ * @param[in] search Precompiled search.
+ * @param[in] haystack String to search.
+ * @param[in] haystack_len Length of @a haystack.
+ *
+ * @returns Pointer to the first match in @a haystack, or NULL if no match
+ * found.
+ */
+const char DLL_PUBLIC *ib_strsearch_find(
+    const ib_strsearch_t *search,
+    const char           *haystack,
+    size_t                haystack_len
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Join strings in @a list using @a join_string into a single string.
  *
@@ -57,6 +57,17 @@ ib_status_t ib_strlower(
 )
 NONNULL_ATTRIBUTE(2, 4);
 
+/**
+ * Simple ASCII lowercase function, in place.
+ *
+ * @param[in,out] data Data to convert to lowercase.
+ * @param[in] dlen Length of @a data.
+ */
+void DLL_PUBLIC ib_strlower_inplace(
+    uint8_t *data,
+    size_t   dlen
+);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -59,6 +59,18 @@ ib_status_t DLL_PUBLIC ib_str_whitespace_remove(
 )
 NONNULL_ATTRIBUTE(2, 4, 5);
 
+/**
+ * Delete all whitespace from a string, in place.
+ *
+ * @param[in,out] data Data.
+ * @param[in,out] dlen Length of @a data.
+ */
+void DLL_PUBLIC ib_str_whitespace_remove_inplace(
+    uint8_t *data,
+    size_t  *dlen
+)
+NONNULL_ATTRIBUTE(1, 2);
+
 /**
  * Compress whitespace in a string.
  *
@@ -79,6 +91,18 @@ ib_status_t DLL_PUBLIC ib_str_whitespace_compress(
 )
 NONNULL_ATTRIBUTE(2, 4, 5);
 
+/**
+ * Compress whitespace in a string, in place.
+ *
+ * @param[in,out] data Data.
+ * @param[in,out] dlen Length of @a data.
+ */
+void DLL_PUBLIC ib_str_whitespace_compress_inplace(
+    uint8_t *data,
+    size_t  *dlen
+)
+NONNULL_ATTRIBUTE(1, 2);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -26,6 +26,7 @@
  */
 
 #include <ironbee/build.h>
+#include <ironbee/mm.h>
 #include <ironbee/types.h>
 
 #include <sys/types.h>
@@ -49,6 +50,9 @@ extern "C" {
  *   this as a *move* of the array from you to the stringset.  The array
  *   should not be subsequently used.  The array must live at least as long
  *   as the stringset.
+ * - Optionally, call ib_stringset_index() to build a double-array trie of
+ *   the stringset.  Queries then take time linear in the length of the
+ *   matched prefix, independent of the number of strings.
  * - Query the stringset as desired.
  *
  * @{
@@ -83,6 +87,13 @@ typedef struct ib_stringset_t ib_stringset_t;
 
 /** @cond internal */
 
+/**
+ * Double-array trie of a string set.  Opaque.
+ *
+ * @sa ib_stringset_index()
+ **/
+typedef struct ib_stringset_index_t ib_stringset_index_t;
+
 /**
  * Set of strings.
  *
@@ -94,6 +105,8 @@ struct ib_stringset_t
     const ib_stringset_entry_t *entries;
     /** Number of entries. */
     size_t num_entries;
+    /** Trie index or NULL.  See ib_stringset_index(). */
+    const ib_stringset_index_t *index;
 };
 
 /** @endcond */
@@ -114,6 +127,25 @@ ib_status_t DLL_PUBLIC ib_stringset_init(
 )
 NONNULL_ATTRIBUTE(1, 2);
 
+/**
+ * Build a double-array trie index of a String Set.
+ *
+ * Optional.  Once indexed, ib_stringset_query() walks the trie one byte at
+ * a time instead of binary searching the entries.
+ *
+ * @param[in] set Set to index.  Must be initialized.
+ * @param[in] mm Memory manager to allocate index from.
+ * @return
+ * - IB_OK on success.
+ * - IB_EINVAL if @a set has too many entries to index.
+ * - IB_EALLOC on allocation failure.
+ */
+ib_status_t DLL_PUBLIC ib_stringset_index(
+    ib_stringset_t *set,
+    ib_mm_t         mm
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Query a String Set.
  *
@@ -0,0 +1,154 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef _IB_THREAD_POOL_H_
+#define _IB_THREAD_POOL_H_
+
+/**
+ * @file
+ * @brief IronBee --- Thread Pool Utility Functions
+ */
+
+#include <ironbee/build.h>
+#include <ironbee/types.h>
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup IronBeeUtilThreadPool Thread Pool
+ * @ingroup IronBeeUtil
+ *
+ * A fixed set of worker threads running queued tasks.
+ *
+ * Starting a thread costs far more than most of the work IronBee would
+ * hand to one, so work is queued to threads started once instead.  Tasks
+ * run in the order they are queued, each on one of the worker threads.
+ *
+ * @{
+ */
+
+typedef struct ib_thread_pool_t ib_thread_pool_t;
+
+/**
+ * A task run by a thread pool.
+ *
+ * @param[in] cbdata Callback data.
+ */
+typedef void (*ib_thread_pool_task_fn_t)(void *cbdata);
+
+/**
+ * Create a thread pool and start its threads.
+ *
+ * The pool is allocated with malloc() and must be destroyed with
+ * ib_thread_pool_destroy().
+ *
+ * @param[out] pool    The created pool.
+ * @param[in]  threads Number of worker threads; must be at least 1.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EINVAL if @a threads is 0.
+ * - IB_EALLOC on allocation failure.
+ * - IB_EOTHER if a thread could not be started.
+ */
+ib_status_t DLL_PUBLIC ib_thread_pool_create(
+    ib_thread_pool_t **pool,
+    size_t             threads
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Run the queued tasks, stop the threads and destroy @a pool.
+ *
+ * No tasks may be queued during or after this call.  Does nothing if
+ * @a pool is NULL.
+ *
+ * @param[in] pool Pool to destroy.
+ */
+void DLL_PUBLIC ib_thread_pool_destroy(
+    ib_thread_pool_t *pool
+);
+
+/**
+ * Number of worker threads of @a pool.
+ *
+ * @param[in] pool Pool.
+ *
+ * @returns Number of threads.
+ */
+size_t DLL_PUBLIC ib_thread_pool_threads(
+    const ib_thread_pool_t *pool
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Queue @a fn to be run with @a cbdata on a worker thread.
+ *
+ * Returns without waiting for @a fn.  @a cbdata must remain valid until
+ * @a fn is done with it.
+ *
+ * @param[in] pool   Pool.
+ * @param[in] fn     Task.
+ * @param[in] cbdata Callback data for @a fn.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+ib_status_t DLL_PUBLIC ib_thread_pool_submit(
+    ib_thread_pool_t         *pool,
+    ib_thread_pool_task_fn_t  fn,
+    void                     *cbdata
+)
+NONNULL_ATTRIBUTE(1, 2);
+
+/**
+ * Share work between the calling thread and up to @a helpers worker threads.
+ *
+ * @a fn is called on the calling thread and queued @a helpers times (at most
+ * once per worker thread).  When the call on the calling thread returns,
+ * queued calls that have not started are dropped, and this waits for the
+ * started ones to return.  @a fn must therefore take work from a queue
+ * shared through @a cbdata until it is empty, and be correct however many
+ * of the calls run.
+ *
+ * @param[in] pool    Pool.
+ * @param[in] fn      Work function.
+ * @param[in] cbdata  Callback data for @a fn.
+ * @param[in] helpers Maximum number of worker threads to help.
+ *
+ * @returns Number of calls to @a fn that ran on worker threads.
+ */
+size_t DLL_PUBLIC ib_thread_pool_share(
+    ib_thread_pool_t         *pool,
+    ib_thread_pool_task_fn_t  fn,
+    void                     *cbdata,
+    size_t                    helpers
+)
+NONNULL_ATTRIBUTE(1, 2);
+
+/** @} IronBeeUtilThreadPool */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IB_THREAD_POOL_H_ */
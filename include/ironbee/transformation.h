@@ -129,6 +129,34 @@ typedef ib_status_t (* ib_transformation_execute_fn_t)(
 )
 NONNULL_ATTRIBUTE(3, 4);
 
+/**
+ * Transformation in-place execution callback type.
+ *
+ * Optional byte string form of a transformation.  Transformations that
+ * provide it can be run back to back on a single writable buffer, so that a
+ * chain of them copies the input once and creates a single output field.
+ *
+ * The callback may modify the bytes of @a data, advance @a data and reduce
+ * @a dlen, but must never increase the length.  It must produce the same
+ * value as the execute callback does for a byte string field.
+ *
+ * @param[in,out] data          Writable data.
+ * @param[in,out] dlen          Length of @a data.
+ * @param[in]     instance_data Instance data.
+ * @param[in]     cbdata        Callback data.
+ *
+ * @return
+ * - IB_OK on success.
+ * - Other on failure.
+ */
+typedef ib_status_t (* ib_transformation_inplace_fn_t)(
+    uint8_t **data,
+    size_t   *dlen,
+    void     *instance_data,
+    void     *cbdata
+)
+NONNULL_ATTRIBUTE(1, 2);
+
 /**
  * Create a transformation.
  *
@@ -165,6 +193,24 @@ ib_status_t DLL_PUBLIC ib_transformation_create(
 )
 NONNULL_ATTRIBUTE(1, 3, 9);
 
+/**
+ * Set the in-place execution function of a transformation.
+ *
+ * Must be called before @a tfn is registered.
+ *
+ * @sa ib_transformation_inplace_fn_t
+ *
+ * @param[in] tfn            Transformation.
+ * @param[in] inplace_fn     In-place execute function.
+ * @param[in] inplace_cbdata In-place execute callback data.
+ */
+void DLL_PUBLIC ib_transformation_inplace_set(
+    ib_transformation_t            *tfn,
+    ib_transformation_inplace_fn_t  inplace_fn,
+    void                           *inplace_cbdata
+)
+NONNULL_ATTRIBUTE(1, 2);
+
 /**
  * Register a transformation with engine.
  *
@@ -268,6 +314,20 @@ bool DLL_PUBLIC ib_transformation_handle_list(
 )
 NONNULL_ATTRIBUTE(1);
 
+/**
+ * In-place accessor.
+ *
+ * @sa ib_transformation_inplace_set().
+ *
+ * @param[in] tfn Transformation.
+ *
+ * @return true if @a tfn has an in-place execute function.
+ */
+bool DLL_PUBLIC ib_transformation_has_inplace(
+    const ib_transformation_t *tfn
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Create a transformation instance.
  *
@@ -348,6 +408,27 @@ ib_status_t DLL_PUBLIC ib_transformation_inst_execute(
 )
 NONNULL_ATTRIBUTE(1, 3, 4);
 
+/**
+ * Execute transformation in place on writable byte string data.
+ *
+ * @sa ib_transformation_inplace_fn_t
+ *
+ * @param[in]     tfn_inst Transformation instance.
+ * @param[in,out] data     Writable data.
+ * @param[in,out] dlen     Length of @a data.
+ *
+ * @return
+ * - IB_OK on success.
+ * - IB_ENOTIMPL if the transformation has no in-place execute function.
+ * - Other on other failure.
+ */
+ib_status_t DLL_PUBLIC ib_transformation_inst_execute_inplace(
+    const ib_transformation_inst_t  *tfn_inst,
+    uint8_t                        **data,
+    size_t                          *dlen
+)
+NONNULL_ATTRIBUTE(1, 2, 3);
+
 #ifdef __cplusplus
 }
 #endif
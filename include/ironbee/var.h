@@ -665,6 +665,21 @@ ib_var_source_t DLL_PUBLIC *ib_var_target_source(
 )
 NONNULL_ATTRIBUTE(1);
 
+/**
+ * Is @a target trivial, i.e., its source with no filter or expansion?
+ *
+ * The value of a trivial target is the value of its source, which can be
+ * read and modified in place with ib_var_source_get().
+ *
+ * @param[in] target Target to check.
+ *
+ * @returns True if @a target is trivial.
+ */
+bool DLL_PUBLIC ib_var_target_is_trivial(
+    const ib_var_target_t *target
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Acquire a target from a specification string.
  *
@@ -719,8 +734,10 @@ NONNULL_ATTRIBUTE(1, 2, 3);
  *
  * The lifetime of @a result will depend on the value.  For non-filtered
  * list fields, the underlying value will be reported directly and @a result
- * will have lifetime equal to that field.  For all other results, the
- * lifetime will equal that of @a mp.
+ * will have lifetime equal to that field.  Filtered results of large,
+ * repeatedly filtered collections of indexed sources are served from an index
+ * held by @a store and will have lifetime equal to that of @a store.  For all
+ * other results, the lifetime will equal that of @a mp.
  *
  * @param[in]  target Target to get values of.
  * @param[out] result Fetched values.  Lifetime will vary.  See above.
@@ -45,6 +45,7 @@
 #include <ironbeepp/ironbee.hpp>
 #include <ironbeepp/list.hpp>
 #include <ironbeepp/memory_manager.hpp>
+#include <ironbeepp/memory_manager_allocator.hpp>
 #include <ironbeepp/memory_pool.hpp>
 #include <ironbeepp/memory_pool_lite.hpp>
 #include <ironbeepp/module.hpp>
@@ -83,9 +83,9 @@ namespace c_trampoline_implementation {
                 void* cdata                                                  \
             )                                                                \
             {                                                                \
-                return boost::any_cast<type_of_function>(                    \
-                    *reinterpret_cast<boost::any*>(cdata)                    \
-                )(                                                           \
+                return (*boost::any_cast<type_of_function>(                  \
+                    reinterpret_cast<boost::any*>(cdata)                     \
+                ))(                                                          \
                     BOOST_PP_ENUM_SHIFTED_PARAMS(n, a)                       \
                 );                                                           \
             }                                                                \
@@ -95,6 +95,9 @@ namespace c_trampoline_implementation {
 /**
  * Helper struct for make_c_trampoline().
  *
+ * The trampolines call the stored functional in place; they do not copy
+ * it, so a call allocates nothing beyond what the functional does.
+ *
  * When @a N is between 1 and IRONBEEPP_C_TRAMPOLINE_MAX_ARGS, this struct
  * will contain an internal template @c impl, templated on the function
  * signature.  The @c impl template will define:
@@ -136,9 +139,9 @@ struct make_c_trampoline_helper<0>
 
         static type_of_result trampoline(void* cdata)
         {
-            return boost::any_cast<type_of_function>(
-                *reinterpret_cast<boost::any*>(cdata)
-            )();
+            return (*boost::any_cast<type_of_function>(
+                reinterpret_cast<boost::any*>(cdata)
+            ))();
         }
     };
 };
@@ -24,7 +24,8 @@
  * and runtime type checking.
  *
  * The values are both copied in and copied out.  As such, they should be
- * rapid-copying types, e.g., boost::shared_ptr.
+ * rapid-copying types, e.g., boost::shared_ptr.  data_to_value_ref()
+ * accesses a value in place instead, e.g., to call a stored functional.
  *
  * These functions are implemented by storing the values in boost::any's and
  * only casting between @c void* and @c boost::any*.  The boost::any semantics
@@ -91,6 +92,34 @@ ValueType data_to_value(void* data)
     }
 }
 
+/**
+ * Access value stored in @a data in place.
+ *
+ * Unlike data_to_value(), this does not copy the value, so calling a
+ * stored functional through it does not copy the functional, and whatever
+ * it binds, on every call.  The reference is valid for as long as @a data.
+ *
+ * @tparam ValueType Type of value stored in @a data.
+ * @param[in] data Data to access value of.
+ * @return Reference to value stored in data.
+ * @throw einval if @a ValueType is incorrect.
+ **/
+template <typename ValueType>
+const ValueType& data_to_value_ref(void* data)
+{
+    const ValueType* value =
+        boost::any_cast<ValueType>(reinterpret_cast<boost::any*>(data));
+
+    if (! value) {
+        BOOST_THROW_EXCEPTION(
+            einval() << errinfo_what(
+                "Stored type mismatch."
+            )
+        );
+    }
+    return *value;
+}
+
 /**
  * Store a copy of @a value and provide a @c void* for data_to_value().
  *
@@ -31,7 +31,6 @@
 
 #include <ironbeepp/exception.hpp>
 
-#include <boost/any.hpp>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
@@ -39,6 +38,8 @@
 #include <yajl/yajl_common.h>
 #include <yajl/yajl_gen.h>
 
+#include <stdint.h>
+
 namespace IronBee {
 
 /**
@@ -68,6 +69,9 @@ public:
      * This allows C-implemented clients to this class to
      * append without building a new std::string instance.
      *
+     * The buffer grows geometrically, so rendering a document token by
+     * token copies it a bounded number of times.
+     *
      * @param[in] str The string to append.
      * @param[in] str_len The length of the string to append.
 
@@ -151,6 +155,12 @@ struct JsonError : public IronBee::eother {};
  * Json.render(&str, &str_len);
  * @endcode
  *
+ * The same calls may instead render CBOR (RFC 7049), a compact binary
+ * encoding of the same data, by constructing with Json::CBOR.  Maps and
+ * arrays are then rendered with indefinite length, so they need not be
+ * counted in advance, strings as text strings, and times as text strings
+ * tagged as date/time strings.
+ *
  * @note This class does as much validation as YAJL, which is almost nothing.
  *       It is trivial to produce invalid JSON by not closing maps and arrays.
  */
@@ -159,19 +169,41 @@ public:
     //! The generator type.
     typedef yajl_gen json_generator_t;
 
+    //! Encodings that may be rendered.
+    enum encoding_e {
+        JSON, //!< JSON text.
+        CBOR  //!< CBOR binary.
+    };
+
 private:
     //! The buffer we will render into.
     JsonBuffer  m_buffer;
 
-    //! A protective wrapper for @c m_buffer used to pass it to C.
-    boost::any       m_any;
+    //! The encoding rendered.
+    encoding_e m_encoding;
 
-    //! The yajl_gen instance.
+    //! The yajl_gen instance; NULL when rendering CBOR.
     json_generator_t m_json_generator;
 
+    /**
+     * Append the CBOR head of an item of @a major type with @a value.
+     *
+     * @param[in] major Major type, 0 to 7.
+     * @param[in] value Value or length of the item.
+     */
+    void cborHead(int major, uint64_t value);
+
+    //! Append a CBOR simple value or break of @a byte.
+    void cborByte(uint8_t byte);
+
 public:
-    //! Constructor.
-    Json();
+    /**
+     * Constructor.
+     *
+     * @param[in] encoding Encoding to render.
+     */
+    explicit
+    Json(encoding_e encoding = JSON);
 
     //! Destructor.
     ~Json();
@@ -200,9 +232,24 @@ public:
     //! Render a NULL.
     void withNull();
 
-    //! Accessor for the JSON Generator (YAJL).
+    //! Accessor for the JSON Generator (YAJL); NULL when rendering CBOR.
     json_generator_t& getJsonGenerator() { return m_json_generator; }
 
+    //! Encoding rendered.
+    encoding_e encoding() const { return m_encoding; }
+
+    //! Open a map.  Prefer withMap().
+    void openMap();
+
+    //! Close a map opened by openMap().
+    void closeMap();
+
+    //! Open an array.  Prefer withArray().
+    void openArray();
+
+    //! Close an array opened by openArray().
+    void closeArray();
+
     //! Render and return a map that, when closed, will return @c this.
     JsonMap<Json> withMap();
 
@@ -431,21 +478,13 @@ JsonArray<PARENT>::JsonArray
     m_Json(Json),
     m_parent(parent)
 {
-    int yg_rc = yajl_gen_array_open(m_Json.getJsonGenerator());
-    if (yg_rc != yajl_gen_status_ok) {
-        BOOST_THROW_EXCEPTION(JsonError() <<
-            IronBee::errinfo_what("Failed to open array."));
-    }
+    m_Json.openArray();
 }
 
 template <typename PARENT>
 PARENT& JsonArray<PARENT>::close()
 {
-    int yg_rc = yajl_gen_array_close(m_Json.getJsonGenerator());
-    if (yg_rc != yajl_gen_status_ok) {
-        BOOST_THROW_EXCEPTION(JsonError() <<
-            IronBee::errinfo_what("Failed close array."));
-    }
+    m_Json.closeArray();
 
     return m_parent;
 }
@@ -472,21 +511,13 @@ JsonMap<PARENT>::JsonMap(
     m_Json(Json),
     m_parent(parent)
 {
-    int yg_rc = yajl_gen_map_open(Json.getJsonGenerator());
-    if (yg_rc != yajl_gen_status_ok) {
-        BOOST_THROW_EXCEPTION(JsonError() <<
-            IronBee::errinfo_what("Failed to open map"));
-    }
+    m_Json.openMap();
 }
 
 template <typename PARENT>
 PARENT& JsonMap<PARENT>::close()
 {
-    int yg_rc = yajl_gen_map_close(m_Json.getJsonGenerator());
-    if (yg_rc != yajl_gen_status_ok) {
-        BOOST_THROW_EXCEPTION(JsonError() <<
-            IronBee::errinfo_what("Failed to open map"));
-    }
+    m_Json.closeMap();
 
     return m_parent;
 }
@@ -0,0 +1,205 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee++ --- Memory Manager Allocator
+ *
+ * This file defines MemoryManagerAllocator, a standard allocator that
+ * allocates from a MemoryManager.
+ */
+
+#ifndef __IBPP__MEMORY_MANAGER_ALLOCATOR__
+#define __IBPP__MEMORY_MANAGER_ALLOCATOR__
+
+#include <ironbeepp/abi_compatibility.hpp>
+#include <ironbeepp/memory_manager.hpp>
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+namespace IronBee {
+
+/**
+ * Standard allocator allocating from a MemoryManager.
+ *
+ * Containers using this allocator, e.g., a `std::vector` that a module
+ * builds for every transaction, take their memory from the transaction
+ * memory manager instead of the heap.  Deallocation does nothing: the
+ * memory is released all at once when the memory manager is.  The
+ * container must therefore not outlive the memory manager.  Destructors of
+ * the elements are still called when the container is destroyed.
+ *
+ * Allocators compare equal if they use the same memory manager, so
+ * containers may only exchange memory, e.g., via `swap()`, if they use the
+ * same one.  There is no default constructor; use a singular
+ * MemoryManager only for containers that never allocate.
+ *
+ * Example:
+ * @code
+ * typedef MemoryManagerAllocator<int> alloc_t;
+ * std::vector<int, alloc_t> v((alloc_t(tx.memory_manager())));
+ * @endcode
+ *
+ * @tparam T Type to allocate.
+ **/
+template <typename T>
+class MemoryManagerAllocator
+{
+public:
+    //! Value type.
+    typedef T              value_type;
+    //! Pointer type.
+    typedef T*             pointer;
+    //! Const pointer type.
+    typedef const T*       const_pointer;
+    //! Reference type.
+    typedef T&             reference;
+    //! Const reference type.
+    typedef const T&       const_reference;
+    //! Size type.
+    typedef std::size_t    size_type;
+    //! Difference type.
+    typedef std::ptrdiff_t difference_type;
+
+    //! Allocator for another type.
+    template <typename U>
+    struct rebind
+    {
+        //! Type of allocator.
+        typedef MemoryManagerAllocator<U> other;
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param[in] memory_manager Memory manager to allocate from.
+     **/
+    explicit
+    MemoryManagerAllocator(MemoryManager memory_manager) :
+        m_memory_manager(memory_manager)
+    {
+        // nop
+    }
+
+    //! Conversion from an allocator of another type.
+    template <typename U>
+    MemoryManagerAllocator(const MemoryManagerAllocator<U>& other) :
+        m_memory_manager(other.memory_manager())
+    {
+        // nop
+    }
+
+    //! Memory manager allocated from.
+    MemoryManager memory_manager() const
+    {
+        return m_memory_manager;
+    }
+
+    //! Address of @a x.
+    pointer address(reference x) const
+    {
+        return &x;
+    }
+
+    //! Address of @a x.
+    const_pointer address(const_reference x) const
+    {
+        return &x;
+    }
+
+    /**
+     * Allocate memory for @a n Ts.
+     *
+     * @param[in] n Number of Ts.
+     * @returns Memory for @a n Ts.
+     * @throw std::bad_alloc on allocation failure.
+     **/
+    pointer allocate(size_type n, const void* = 0)
+    {
+        if (n > max_size()) {
+            throw std::bad_alloc();
+        }
+        void* p = ib_mm_alloc(m_memory_manager.ib(), n * sizeof(T));
+        if (! p) {
+            throw std::bad_alloc();
+        }
+        return static_cast<pointer>(p);
+    }
+
+    //! Does nothing; memory is released with the memory manager.
+    void deallocate(pointer, size_type)
+    {
+        // nop
+    }
+
+    //! Largest number of Ts that can be allocated at once.
+    size_type max_size() const
+    {
+        return std::numeric_limits<size_type>::max() / sizeof(T);
+    }
+
+    //! Construct a copy of @a value at @a p.
+    void construct(pointer p, const T& value)
+    {
+        new (static_cast<void*>(p)) T(value);
+    }
+
+    //! Destroy the T at @a p.
+    void destroy(pointer p)
+    {
+        p->~T();
+    }
+
+private:
+    //! Memory manager.
+    MemoryManager m_memory_manager;
+};
+
+/**
+ * Allocators are equal if they use the same memory manager.
+ **/
+template <typename T, typename U>
+bool operator==(
+    const MemoryManagerAllocator<T>& a,
+    const MemoryManagerAllocator<U>& b
+)
+{
+    ib_mm_t a_mm = a.memory_manager().ib();
+    ib_mm_t b_mm = b.memory_manager().ib();
+
+    return
+        a_mm.alloc == b_mm.alloc &&
+        a_mm.alloc_data == b_mm.alloc_data;
+}
+
+/**
+ * Allocators are unequal if they use different memory managers.
+ **/
+template <typename T, typename U>
+bool operator!=(
+    const MemoryManagerAllocator<T>& a,
+    const MemoryManagerAllocator<U>& b
+)
+{
+    return ! (a == b);
+}
+
+} // IronBee
+
+#endif
@@ -146,7 +146,7 @@ void action_execute(
     void*                 instance_data
 )
 {
-    data_to_value<Action::action_instance_t>(instance_data)(rule_exec);
+    data_to_value_ref<Action::action_instance_t>(instance_data)(rule_exec);
 }
 
 void action_destroy(
@@ -135,21 +135,21 @@ ib_status_t ibpp_field_dynamic_get(
         switch (field->type) {
             case IB_FTYPE_TIME: {
                 ib_time_t* n = reinterpret_cast<ib_time_t*>(out_val);
-                *n = data_to_value<Field::time_get_t>(cbdata)(
+                *n = data_to_value_ref<Field::time_get_t>(cbdata)(
                     fieldpp, carg, arg_length
                 );
                 return IB_OK;
             }
             case IB_FTYPE_NUM: {
                 ib_num_t* n = reinterpret_cast<ib_num_t*>(out_val);
-                *n = data_to_value<Field::number_get_t>(cbdata)(
+                *n = data_to_value_ref<Field::number_get_t>(cbdata)(
                     fieldpp, carg, arg_length
                 );
                 return IB_OK;
             }
             case IB_FTYPE_FLOAT: {
                 ib_float_t* u = reinterpret_cast<ib_float_t*>(out_val);
-                *u = data_to_value<
+                *u = data_to_value_ref<
                     Field::float_get_t
                 >(cbdata)(
                     fieldpp, carg, arg_length
@@ -159,7 +159,7 @@ ib_status_t ibpp_field_dynamic_get(
             case IB_FTYPE_NULSTR:
             {
                 const char** ns = reinterpret_cast<const char**>(out_val);
-                *ns = data_to_value<
+                *ns = data_to_value_ref<
                     Field::null_string_get_t
                 >(cbdata)(
                     fieldpp, carg, arg_length
@@ -170,7 +170,7 @@ ib_status_t ibpp_field_dynamic_get(
             {
                 const ib_bytestr_t** bs
                     = reinterpret_cast<const ib_bytestr_t**>(out_val);
-                *bs = data_to_value<
+                *bs = data_to_value_ref<
                     Field::byte_string_get_t
                 >(cbdata)(
                     fieldpp, carg, arg_length
@@ -181,7 +181,7 @@ ib_status_t ibpp_field_dynamic_get(
             {
                 const ib_list_t** l
                     = reinterpret_cast<const ib_list_t**>(out_val);
-                *l = data_to_value<
+                *l = data_to_value_ref<
                     Internal::dynamic_list_getter_translator_t
                 >(cbdata)(
                     fieldpp, carg, arg_length
@@ -219,28 +219,28 @@ ib_status_t ibpp_field_dynamic_set(
     try {
         switch (field->type) {
             case IB_FTYPE_TIME:
-                data_to_value<Field::time_set_t>(cbdata)(
+                data_to_value_ref<Field::time_set_t>(cbdata)(
                     Field(field),
                     carg, arg_length,
                     *reinterpret_cast<const uint64_t*>(in_value)
                 );
                 break;
             case IB_FTYPE_NUM:
-                data_to_value<Field::number_set_t>(cbdata)(
+                data_to_value_ref<Field::number_set_t>(cbdata)(
                     Field(field),
                     carg, arg_length,
                     *reinterpret_cast<const int64_t*>(in_value)
                 );
                 break;
             case IB_FTYPE_FLOAT:
-                data_to_value<Field::float_set_t>(cbdata)(
+                data_to_value_ref<Field::float_set_t>(cbdata)(
                     Field(field),
                     carg, arg_length,
                     *reinterpret_cast<const long double*>(in_value)
                 );
                 break;
             case IB_FTYPE_NULSTR:
-                data_to_value<Field::null_string_set_t>(cbdata)(
+                data_to_value_ref<Field::null_string_set_t>(cbdata)(
                     Field(field),
                     carg, arg_length,
                     reinterpret_cast<const char*>(in_value)
@@ -251,7 +251,7 @@ ib_status_t ibpp_field_dynamic_set(
                 const ConstByteString value(
                     reinterpret_cast<const ib_bytestr_t*>(in_value)
                 );
-                data_to_value<Field::byte_string_set_t>(cbdata)(
+                data_to_value_ref<Field::byte_string_set_t>(cbdata)(
                     Field(field),
                     carg, arg_length,
                     value
@@ -261,7 +261,7 @@ ib_status_t ibpp_field_dynamic_set(
             case IB_FTYPE_LIST: {
                 const ib_list_t* value =
                     reinterpret_cast<const ib_list_t*>(in_value);
-                data_to_value<
+                data_to_value_ref<
                     Internal::dynamic_list_setter_translator_t
                 >(cbdata)(
                     Field(field),
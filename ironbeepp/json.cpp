@@ -24,7 +24,6 @@
 
 #include <ironbeepp/json.hpp>
 
-#include <boost/any.hpp>
 #ifdef __clang__
 #pragma clang diagnostic push
 #if __has_warning("-Wunused-local-typedef")
@@ -35,13 +34,15 @@
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
-#include <boost/date_time/time_facet.hpp>
 #include <boost/foreach.hpp>
+#include <boost/static_assert.hpp>
 
 #include <yajl/yajl_common.h>
 #include <yajl/yajl_gen.h>
 
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 namespace IronBee {
 
@@ -80,22 +81,26 @@ void JsonBuffer::append(const char *str, size_t str_len)
 {
     size_t new_len = m_json_buffer_len + str_len;
 
-    /* Grow the buffer by 1k as that should satisfy most conditions.
-     * Should we be in an unexpected situation, loop until we get it right.
-     */
+    /* Double the buffer, starting at 1k, so that appending the many small
+     * tokens of a large document is linear in its size. */
     if (new_len > m_json_buffer_sz)
     {
-        /* Compute the new buffer length on a 1024-length page. */
-        m_json_buffer_sz = new_len + (new_len % 1024);
-        m_json_buffer = reinterpret_cast<char *>(
-            realloc(m_json_buffer, m_json_buffer_sz));
+        size_t new_sz = (m_json_buffer_sz < 1024) ? 1024 : m_json_buffer_sz;
+        while (new_sz < new_len) {
+            new_sz *= 2;
+        }
 
-        if (m_json_buffer == NULL)
+        char *new_buffer = reinterpret_cast<char *>(
+            realloc(m_json_buffer, new_sz));
+        if (new_buffer == NULL)
         {
             BOOST_THROW_EXCEPTION(
                 IronBee::ealloc()
                     << IronBee::errinfo_what("Allocating JSON buffer."));
         }
+
+        m_json_buffer = new_buffer;
+        m_json_buffer_sz = new_sz;
     }
 
     std::copy(str, str + str_len, m_json_buffer + m_json_buffer_len);
@@ -109,19 +114,20 @@ extern "C" {
  */
 static void txlog_json_print_callback(void *ctx, const char *str, size_t len)
 {
-    JsonBuffer *buffer =
-        boost::any_cast<JsonBuffer*>(
-            *reinterpret_cast<boost::any *>(ctx));
-
-    buffer->append(str, len);
+    reinterpret_cast<JsonBuffer *>(ctx)->append(str, len);
 }
 
 } /* extern "C" */
 
-Json::Json():
-    m_any(&m_buffer),
-    m_json_generator(yajl_gen_alloc(NULL))
+Json::Json(encoding_e encoding):
+    m_encoding(encoding),
+    m_json_generator(NULL)
 {
+    if (m_encoding == CBOR) {
+        return;
+    }
+
+    m_json_generator = yajl_gen_alloc(NULL);
     if (m_json_generator == NULL) {
         BOOST_THROW_EXCEPTION(
             JsonError()
@@ -134,15 +140,50 @@ Json::Json():
         m_json_generator,
         yajl_gen_print_callback,
         &txlog_json_print_callback,
-        reinterpret_cast<void *>(&m_any)
+        reinterpret_cast<void *>(&m_buffer)
     );
 }
 
 Json::~Json()
 {
-    assert (m_json_generator);
+    assert (m_encoding == CBOR || m_json_generator);
 
-    yajl_gen_free(m_json_generator);
+    if (m_json_generator) {
+        yajl_gen_free(m_json_generator);
+    }
+}
+
+void Json::cborHead(int major, uint64_t value)
+{
+    char   head[9];
+    size_t head_len;
+
+    major <<= 5;
+    if (value < 24) {
+        head[0] = major | value;
+        head_len = 1;
+    }
+    else {
+        /* Additional information 24 to 27 is a 1, 2, 4 or 8 byte value. */
+        int size_log2 =
+            (value <= 0xff) ? 0 :
+            (value <= 0xffff) ? 1 :
+            (value <= 0xffffffff) ? 2 : 3;
+
+        head_len = 1 + (1 << size_log2);
+        head[0] = major | (24 + size_log2);
+        for (size_t i = head_len - 1; i > 0; --i) {
+            head[i] = value & 0xff;
+            value >>= 8;
+        }
+    }
+
+    m_buffer.append(head, head_len);
+}
+
+void Json::cborByte(uint8_t byte)
+{
+    m_buffer.append(reinterpret_cast<const char *>(&byte), 1);
 }
 
 void Json::render(char*& buf, size_t& buf_sz)
@@ -160,64 +201,102 @@ JsonArray<Json> Json::withArray()
     return JsonArray<Json>(*this, *this);
 }
 
-void Json::withTime(const boost::posix_time::ptime& val)
+void Json::openMap()
 {
-    int yajl_rc;
-
-    /* The output stream the does the formatting for the date using facets. */
-    std::ostringstream osstream;
-
-    /* The formatted date is stored here. */
-    std::string str;
-
-    /* Location of the last '.' character in the formatted date.
-     * This is used to trim fractional second precision. */
-    size_t dot_loc;
-
-    /* Location of the last '-' character in the formatted date.
-     * This is used to trim fractional second precision. */
-    size_t dash_loc;
-
-    /* Setup posix time formatting. The timezone %q is replaced with -00:00.*/
-    osstream.imbue(
-        std::locale(
-            osstream.getloc(),
-            /* NOTE: Facet object is destroyed with str. */
-            new boost::date_time::time_facet
-            <
-                boost::posix_time::ptime,
-                char
-            > (
-                "%Y-%m-%dT%H:%M:%S.%f-00:00"
-            )
-        )
-    );
+    if (m_encoding == CBOR) {
+        /* Map of indefinite length. */
+        cborByte(0xbf);
+        return;
+    }
 
-    /* Format the raw date string. */
-    osstream << val;
+    int yg_rc = yajl_gen_map_open(m_json_generator);
+    if (yg_rc != yajl_gen_status_ok) {
+        BOOST_THROW_EXCEPTION(JsonError() <<
+            IronBee::errinfo_what("Failed to open map"));
+    }
+}
 
-    /* Capture the formatted date string. */
-    str = osstream.str();
+void Json::closeMap()
+{
+    if (m_encoding == CBOR) {
+        /* Break. */
+        cborByte(0xff);
+        return;
+    }
 
-    /* Find '.' & '-' surrounding the frac. seconds; Trim to 3 places. */
-    dot_loc = str.rfind(".");
-    dash_loc = str.rfind("-");
-    str = str.replace(dot_loc + 4, dash_loc - dot_loc - 4, "");
+    int yg_rc = yajl_gen_map_close(m_json_generator);
+    if (yg_rc != yajl_gen_status_ok) {
+        BOOST_THROW_EXCEPTION(JsonError() <<
+            IronBee::errinfo_what("Failed to close map"));
+    }
+}
 
-    /* Finally, convert the string to JSON. */
-    yajl_rc = yajl_gen_string(
-        m_json_generator,
-        reinterpret_cast<const unsigned char *>(str.data()),
-        str.length());
+void Json::openArray()
+{
+    if (m_encoding == CBOR) {
+        /* Array of indefinite length. */
+        cborByte(0x9f);
+        return;
+    }
 
-    /* Check and throw if there was a problem. */
-    if (yajl_rc != yajl_gen_status_ok)
-    {
+    int yg_rc = yajl_gen_array_open(m_json_generator);
+    if (yg_rc != yajl_gen_status_ok) {
         BOOST_THROW_EXCEPTION(JsonError() <<
-            IronBee::errinfo_what("Failed to write string."));
+            IronBee::errinfo_what("Failed to open array."));
     }
 }
 
+void Json::closeArray()
+{
+    if (m_encoding == CBOR) {
+        /* Break. */
+        cborByte(0xff);
+        return;
+    }
+
+    int yg_rc = yajl_gen_array_close(m_json_generator);
+    if (yg_rc != yajl_gen_status_ok) {
+        BOOST_THROW_EXCEPTION(JsonError() <<
+            IronBee::errinfo_what("Failed close array."));
+    }
+}
+
+void Json::withTime(const boost::posix_time::ptime& val)
+{
+    /* Format as %Y-%m-%dT%H:%M:%S with milliseconds and a -00:00 zone
+     * directly rather than through a stream and time facet, as this is
+     * done for every transaction logged. */
+    char str[sizeof("YYYY-mm-ddTHH:MM:SS.mmm-00:00") + 16];
+    int  str_len;
+
+    if (val.is_special()) {
+        BOOST_THROW_EXCEPTION(JsonError() <<
+            IronBee::errinfo_what("Failed to write special time."));
+    }
+
+    const boost::gregorian::date::ymd_type ymd =
+        val.date().year_month_day();
+    const boost::posix_time::time_duration tod = val.time_of_day();
+
+    str_len = snprintf(
+        str, sizeof(str),
+        "%04d-%02d-%02dT%02d:%02d:%02d.%03d-00:00",
+        static_cast<int>(ymd.year),
+        static_cast<int>(ymd.month),
+        static_cast<int>(ymd.day),
+        static_cast<int>(tod.hours()),
+        static_cast<int>(tod.minutes()),
+        static_cast<int>(tod.seconds()),
+        static_cast<int>(tod.total_milliseconds() % 1000));
+
+    if (m_encoding == CBOR) {
+        /* Tag 0: standard date/time string. */
+        cborHead(6, 0);
+    }
+
+    withString(str, str_len);
+}
+
 void Json::withString(const std::string& val)
 {
     withString(val.data(), val.length());
@@ -230,6 +309,12 @@ void Json::withString(const char* val)
 
 void Json::withString(const char* val, size_t len)
 {
+    if (m_encoding == CBOR) {
+        cborHead(3, len);
+        m_buffer.append(val, len);
+        return;
+    }
+
     int yajl_rc = yajl_gen_string(
         m_json_generator,
         reinterpret_cast<const unsigned char *>(val),
@@ -243,6 +328,17 @@ void Json::withString(const char* val, size_t len)
 
 void Json::withInt(int val)
 {
+    if (m_encoding == CBOR) {
+        /* Negative integers are encoded as -1 - n. */
+        if (val < 0) {
+            cborHead(1, -1 - static_cast<int64_t>(val));
+        }
+        else {
+            cborHead(0, val);
+        }
+        return;
+    }
+
     int yg_rc = yajl_gen_integer(m_json_generator, val);
     if (yg_rc != yajl_gen_status_ok) {
         BOOST_THROW_EXCEPTION(JsonError()
@@ -252,6 +348,23 @@ void Json::withInt(int val)
 
 void Json::withDouble(double val)
 {
+    if (m_encoding == CBOR) {
+        uint64_t bits;
+
+        BOOST_STATIC_ASSERT(sizeof(bits) == sizeof(val));
+        memcpy(&bits, &val, sizeof(bits));
+
+        /* Major type 7, additional information 27: double precision. */
+        char item[9];
+        item[0] = static_cast<char>(0xfb);
+        for (int i = 8; i > 0; --i) {
+            item[i] = bits & 0xff;
+            bits >>= 8;
+        }
+        m_buffer.append(item, sizeof(item));
+        return;
+    }
+
     int yg_rc = yajl_gen_double(m_json_generator, val);
     if (yg_rc != yajl_gen_status_ok) {
         BOOST_THROW_EXCEPTION(JsonError()
@@ -261,6 +374,12 @@ void Json::withDouble(double val)
 
 void Json::withBool(bool val)
 {
+    if (m_encoding == CBOR) {
+        /* Simple values 21 and 20. */
+        cborByte(val ? 0xf5 : 0xf4);
+        return;
+    }
+
     int yg_rc = yajl_gen_bool(m_json_generator, (val)?1:0);
     if (yg_rc != yajl_gen_status_ok) {
         BOOST_THROW_EXCEPTION(JsonError()
@@ -270,6 +389,12 @@ void Json::withBool(bool val)
 
 void Json::withNull()
 {
+    if (m_encoding == CBOR) {
+        /* Simple value 22. */
+        cborByte(0xf6);
+        return;
+    }
+
     int yg_rc = yajl_gen_null(m_json_generator);
     if (yg_rc != yajl_gen_status_ok) {
         BOOST_THROW_EXCEPTION(JsonError()
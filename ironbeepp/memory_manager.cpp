@@ -61,7 +61,7 @@ ib_status_t ibpp_mm_register_cleanup(
 )
 {
     try {
-        data_to_value<MemoryManager::register_cleanup_t>(cbdata)(
+        data_to_value_ref<MemoryManager::register_cleanup_t>(cbdata)(
             boost::bind(fn, fndata)
         );
     }
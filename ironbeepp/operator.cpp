@@ -175,7 +175,7 @@ int operator_execute(
     void*       instance_data
 )
 {
-    return data_to_value<Operator::operator_instance_t>(instance_data)(
+    return data_to_value_ref<Operator::operator_instance_t>(instance_data)(
         tx,
         field,
         capture
@@ -119,7 +119,7 @@ static ib_status_t server_error_translator(
 )
 {
     try {
-        data_to_value<Server::error_callback_t>(cbdata)(
+        data_to_value_ref<Server::error_callback_t>(cbdata)(
             Transaction(tx),
             status
         );
@@ -138,7 +138,7 @@ static ib_status_t server_error_header_translator(
 )
 {
     try {
-        data_to_value<Server::error_header_callback_t>(cbdata)(
+        data_to_value_ref<Server::error_header_callback_t>(cbdata)(
             Transaction(tx),
             name, name_length,
             value, value_length
@@ -157,7 +157,7 @@ static ib_status_t server_error_data_translator(
 )
 {
     try {
-        data_to_value<Server::error_data_callback_t>(cbdata)(
+        data_to_value_ref<Server::error_data_callback_t>(cbdata)(
             Transaction(tx),
             data, data_length
         );
@@ -178,7 +178,7 @@ static ib_status_t server_header_translator(
 )
 {
     try {
-        data_to_value<Server::header_callback_t>(cbdata)(
+        data_to_value_ref<Server::header_callback_t>(cbdata)(
             Transaction(tx),
             Server::direction_e(dir),
             Server::header_action_e(action),
@@ -199,7 +199,7 @@ static ib_status_t server_close_translator(
 )
 {
     try {
-        data_to_value<Server::close_callback_t>(cbdata)(
+        data_to_value_ref<Server::close_callback_t>(cbdata)(
             Connection(conn),
             Transaction(tx)
         );
@@ -221,7 +221,7 @@ static ib_status_t server_body_edit_translator(
 )
 {
     try {
-        data_to_value<Server::body_edit_callback_t>(cbdata)(
+        data_to_value_ref<Server::body_edit_callback_t>(cbdata)(
             Transaction(tx),
             Server::direction_e(dir),
             start,
@@ -245,7 +245,7 @@ static ib_status_t server_filter_init_translator(
 )
 {
     try {
-        data_to_value<Server:filter_init_callback_t>(cbdata)(
+        data_to_value_ref<Server::filter_init_callback_t>(cbdata)(
             Transaction(tx),
             Server::direction_e(dir)
         );
@@ -264,7 +264,7 @@ static ib_status_t server_filter_data_translator(
 )
 {
     try {
-        data_to_value<Server::filter_data_callback_t>(cbdata)(
+        data_to_value_ref<Server::filter_data_callback_t>(cbdata)(
             Transaction(tx),
             Server::direction_e(dir),
             block, block_length
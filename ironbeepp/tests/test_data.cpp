@@ -105,3 +105,29 @@ TEST(TestData, NoPool)
 
     IronBee::Internal::ibpp_data_cleanup(data);
 }
+
+TEST(TestData, Reference)
+{
+    using namespace IronBee;
+
+    bool flag = false;
+    destruction_registerer_p it =
+        boost::make_shared<destruction_registerer>(&flag);
+
+    void* data = value_to_data(it);
+    ASSERT_TRUE(data);
+    ASSERT_EQ(2, it.use_count());
+
+    {
+        const destruction_registerer_p& ref =
+            data_to_value_ref<destruction_registerer_p>(data);
+        ASSERT_EQ(it, ref);
+        // No copy was made.
+        ASSERT_EQ(2, it.use_count());
+    }
+
+    ASSERT_THROW(data_to_value_ref<int>(data), IronBee::einval);
+
+    IronBee::Internal::ibpp_data_cleanup(data);
+    ASSERT_EQ(1, it.use_count());
+}
@@ -0,0 +1,134 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee++ Internals --- JSON Tests
+ **/
+
+#include <ironbeepp/json.hpp>
+
+#include "gtest/gtest.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <cstdlib>
+
+using namespace boost::posix_time;
+using namespace IronBee;
+
+namespace {
+
+//! Render @a json and return it as a string.
+std::string render(Json& json)
+{
+    char*  buf;
+    size_t buf_sz;
+
+    json.render(buf, buf_sz);
+    std::string result(buf, buf_sz);
+    free(buf);
+
+    return result;
+}
+
+}
+
+TEST(Json, Time)
+{
+    Json json;
+    ptime t(
+        boost::gregorian::date(2014, 3, 7),
+        hours(9) + minutes(5) + seconds(2) + microseconds(123987)
+    );
+
+    json.withTime(t);
+    EXPECT_EQ("\"2014-03-07T09:05:02.123-00:00\"", render(json));
+}
+
+TEST(Json, TimeMidnight)
+{
+    Json json;
+
+    json.withTime(ptime(boost::gregorian::date(2014, 12, 31)));
+    EXPECT_EQ("\"2014-12-31T00:00:00.000-00:00\"", render(json));
+}
+
+TEST(Json, TimeSpecial)
+{
+    Json json;
+
+    EXPECT_THROW(json.withTime(ptime()), JsonError);
+}
+
+TEST(Json, LargeDocument)
+{
+    Json        json;
+    std::string value(100, 'x');
+    std::string result;
+
+    JsonArray<Json> array = json.withArray();
+    for (int i = 0; i < 10000; ++i) {
+        array.withString(value);
+    }
+    array.close();
+
+    result = render(json);
+    EXPECT_EQ(10000 * (value.length() + 3) + 1, result.length());
+    EXPECT_EQ("[\"" + value + "\",", result.substr(0, value.length() + 4));
+    EXPECT_EQ(
+        ",\"" + value + "\"]",
+        result.substr(result.length() - value.length() - 4)
+    );
+}
+
+TEST(Json, Cbor)
+{
+    Json json(Json::CBOR);
+
+    json.withMap()
+        .withInt("a", 1)
+        .withArray("b")
+            .withInt(-1)
+            .withBool(true)
+            .withNull()
+            .withString("xyz")
+        .close()
+        .withDouble("c", 1.5)
+        .withInt("d", 500)
+    .close();
+
+    const char expected[] =
+        "\xbf"
+            "\x61" "a" "\x01"
+            "\x61" "b" "\x9f" "\x20" "\xf5" "\xf6" "\x63" "xyz" "\xff"
+            "\x61" "c" "\xfb" "\x3f\xf8\x00\x00\x00\x00\x00\x00"
+            "\x61" "d" "\x19\x01\xf4"
+        "\xff";
+    EXPECT_EQ(std::string(expected, sizeof(expected) - 1), render(json));
+}
+
+TEST(Json, CborTime)
+{
+    Json json(Json::CBOR);
+
+    json.withTime(ptime(boost::gregorian::date(2014, 12, 31)));
+    EXPECT_EQ(
+        std::string("\xc0\x78\x1d") + "2014-12-31T00:00:00.000-00:00",
+        render(json)
+    );
+}
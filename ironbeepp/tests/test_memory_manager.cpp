@@ -23,10 +23,14 @@
  **/
 
 #include <ironbeepp/memory_manager.hpp>
+#include <ironbeepp/memory_manager_allocator.hpp>
 #include <ironbeepp/memory_pool_lite.hpp>
 
 #include <algorithm>
 #include <list>
+#include <map>
+#include <string>
+#include <vector>
 #ifdef __clang__
 #pragma clang diagnostic push
 #if __has_warning("-Wunused-local-typedef")
@@ -163,3 +167,32 @@ TEST(TestMemoryManager, CreateFromFunctionals)
     }
     EXPECT_TRUE(callback_flag);
 }
+
+TEST(TestMemoryManager, Allocator)
+{
+    typedef MemoryManagerAllocator<int> int_alloc_t;
+    typedef std::pair<const std::string, int> pair_t;
+    typedef MemoryManagerAllocator<pair_t> pair_alloc_t;
+
+    ScopedMemoryPoolLite smpl;
+    ScopedMemoryPoolLite other;
+    MemoryManager mpl = MemoryPoolLite(smpl);
+
+    EXPECT_TRUE(int_alloc_t(mpl) == pair_alloc_t(mpl));
+    EXPECT_TRUE(int_alloc_t(mpl) != int_alloc_t(MemoryPoolLite(other)));
+
+    {
+        std::vector<int, int_alloc_t> v((int_alloc_t(mpl)));
+        for (int i = 0; i < 100; ++i) {
+            v.push_back(i);
+        }
+        EXPECT_EQ(100UL, v.size());
+        EXPECT_EQ(99, v.back());
+
+        std::map<std::string, int, std::less<std::string>, pair_alloc_t>
+            m(std::less<std::string>(), (pair_alloc_t(mpl)));
+        m["a"] = 1;
+        m["b"] = 2;
+        EXPECT_EQ(2, m["b"]);
+    }
+}
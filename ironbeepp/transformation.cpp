@@ -159,7 +159,7 @@ ConstField transformation_execute(
     void*         instance_data
 )
 {
-    return data_to_value<Transformation::transformation_instance_t>(instance_data)(
+    return data_to_value_ref<Transformation::transformation_instance_t>(instance_data)(
         mm,
         input
     );
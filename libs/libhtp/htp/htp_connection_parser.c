@@ -103,6 +103,11 @@ void htp_connp_destroy(htp_connp_t *connp) {
         connp->out_decompressor = NULL;
     }
 
+    if (connp->out_decompressor_spare != NULL) {
+        connp->out_decompressor_spare->destroy(connp->out_decompressor_spare);
+        connp->out_decompressor_spare = NULL;
+    }
+
     if (connp->put_file != NULL) {
         bstr_free(connp->put_file->filename);
         free(connp->put_file);
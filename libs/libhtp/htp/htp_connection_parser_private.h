@@ -130,9 +130,12 @@ struct htp_connp_t {
     /** Used to buffer a line of inbound data when buffering cannot be avoided. */
     unsigned char *in_buf;
 
-    /** Stores the size of the buffer. Valid only when htp_tx_t::in_buf is not NULL. */
+    /** Stores the amount of data in the buffer. */
     size_t in_buf_size;
 
+    /** Stores the allocated size of the buffer. */
+    size_t in_buf_capacity;
+
     /**
      * Stores the current value of a folded request header. Such headers span
      * multiple lines, and are processed only when all data is available.
@@ -214,9 +217,12 @@ struct htp_connp_t {
     /** Used to buffer a line of outbound data when buffering cannot be avoided. */
     unsigned char *out_buf;
 
-    /** Stores the size of the buffer. Valid only when htp_tx_t::out_buf is not NULL. */
+    /** Stores the amount of data in the buffer. */
     size_t out_buf_size;
 
+    /** Stores the allocated size of the buffer. */
+    size_t out_buf_capacity;
+
     /**
      * Stores the current value of a folded response header. Such headers span
      * multiple lines, and are processed only when all data is available.
@@ -253,6 +259,12 @@ struct htp_connp_t {
     /** Response decompressor used to decompress response body data. */
     htp_decompressor_t *out_decompressor;
 
+    /**
+     * A finished response decompressor kept for reuse by the next
+     * compressed response on this connection, or NULL.
+     */
+    htp_decompressor_t *out_decompressor_spare;
+
     /** On a PUT request, this field contains additional file data. */
     htp_file_t *put_file;
 };
@@ -43,12 +43,12 @@
 /**
  * Parses a single v0 request cookie and places the results into tx->request_cookies.
  *
- * @param[in] connp
+ * @param[in] tx
  * @param[in] data
  * @param[in] len
  * @return HTP_OK on success, HTP_ERROR on error.
  */
-int htp_parse_single_cookie_v0(htp_connp_t *connp, unsigned char *data, size_t len) {
+int htp_parse_single_cookie_v0(htp_tx_t *tx, unsigned char *data, size_t len) {
     if (len == 0) return HTP_OK;
     
     size_t pos = 0;
@@ -74,7 +74,7 @@ int htp_parse_single_cookie_v0(htp_connp_t *connp, unsigned char *data, size_t l
         return HTP_ERROR;
     }
     
-    htp_table_addn(connp->in_tx->request_cookies, name, value);
+    htp_table_addn(tx->request_cookies, name, value);
 
     return HTP_OK;
 }
@@ -82,16 +82,16 @@ int htp_parse_single_cookie_v0(htp_connp_t *connp, unsigned char *data, size_t l
 /**
  * Parses the Cookie request header in v0 format.
  *
- * @param[in] connp
+ * @param[in] tx
  * @return HTP_OK on success, HTP_ERROR on error
  */
-htp_status_t htp_parse_cookies_v0(htp_connp_t *connp) {
-    htp_header_t *cookie_header = htp_table_get_c(connp->in_tx->request_headers, "cookie");
+htp_status_t htp_parse_cookies_v0(htp_tx_t *tx) {
+    htp_header_t *cookie_header = htp_table_get_c(tx->request_headers, "cookie");
     if (cookie_header == NULL) return HTP_OK;
 
     // Create a new table to store cookies.
-    connp->in_tx->request_cookies = htp_table_create(4);
-    if (connp->in_tx->request_cookies == NULL) return HTP_ERROR;
+    tx->request_cookies = htp_table_create(4);
+    if (tx->request_cookies == NULL) return HTP_ERROR;
 
     unsigned char *data = bstr_ptr(cookie_header->value);
     size_t len = bstr_len(cookie_header->value);
@@ -107,7 +107,7 @@ htp_status_t htp_parse_cookies_v0(htp_connp_t *connp) {
         // Find the end of the cookie.
         while ((pos < len) && (data[pos] != ';')) pos++;
 
-        if (htp_parse_single_cookie_v0(connp, data + start, pos - start) != HTP_OK) {
+        if (htp_parse_single_cookie_v0(tx, data + start, pos - start) != HTP_OK) {
             return HTP_ERROR;
         }
 
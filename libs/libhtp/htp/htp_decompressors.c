@@ -161,51 +161,79 @@ static void htp_gzip_decompressor_destroy(htp_decompressor_gzip_t *drec) {
 }
 
 /**
- * Create a new decompressor instance.
+ * Initialize (or reinitialize) the zlib stream of a decompressor.
  *
  * @param[in] connp
+ * @param[in] drec
  * @param[in] format
- * @return New htp_decompressor_t instance on success, or NULL on failure.
+ * @return HTP_OK on success, HTP_ERROR on failure.
  */
-htp_decompressor_t *htp_gzip_decompressor_create(htp_connp_t *connp, enum htp_content_encoding_t format) {
-    htp_decompressor_gzip_t *drec = calloc(1, sizeof (htp_decompressor_gzip_t));
-    if (drec == NULL) return NULL;
-
-    drec->super.decompress = (int (*)(htp_decompressor_t *, htp_tx_data_t *))htp_gzip_decompressor_decompress;
-    drec->super.destroy = (void (*)(htp_decompressor_t *))htp_gzip_decompressor_destroy;
-
-    drec->buffer = malloc(GZIP_BUF_SIZE);
-    if (drec->buffer == NULL) {
-        free(drec);
-        return NULL;
-    }
-
-    // Initialize zlib.
+static htp_status_t htp_gzip_decompressor_init(htp_connp_t *connp, htp_decompressor_gzip_t *drec, enum htp_content_encoding_t format) {
+    // Negative values activate raw processing, which is what we need for
+    // deflate. Increased windows size activates gzip header processing.
+    int window_bits = (format == HTP_COMPRESSION_DEFLATE) ? -15 : 15 + 32;
     int rc;
 
-    if (format == HTP_COMPRESSION_DEFLATE) {
-        // Negative values activate raw processing,
-        // which is what we need for deflate.
-        rc = inflateInit2(&drec->stream, -15);
+    if (drec->zlib_initialized) {
+        // Reusing a decompressor; keep the zlib state allocations.
+        rc = inflateReset2(&drec->stream, window_bits);
     } else {
-        // Increased windows size activates gzip header processing.
-        rc = inflateInit2(&drec->stream, 15 + 32);
+        rc = inflateInit2(&drec->stream, window_bits);
     }
 
     if (rc != Z_OK) {
         htp_log(connp, HTP_LOG_MARK, HTP_LOG_ERROR, 0, "GZip decompressor: inflateInit2 failed with code %d", rc);
 
         inflateEnd(&drec->stream);
-        free(drec->buffer);
-        free(drec);
+        drec->zlib_initialized = 0;
 
-        return NULL;
+        return HTP_ERROR;
     }
 
     drec->zlib_initialized = 1;
+    drec->header_len = 0;
+    drec->crc = 0;
     drec->stream.avail_out = GZIP_BUF_SIZE;
     drec->stream.next_out = drec->buffer;
 
+    return HTP_OK;
+}
+
+/**
+ * Create a new decompressor instance. The connection's spare decompressor,
+ * if there is one, is reused instead of allocating a new one.
+ *
+ * @param[in] connp
+ * @param[in] format
+ * @return New htp_decompressor_t instance on success, or NULL on failure.
+ */
+htp_decompressor_t *htp_gzip_decompressor_create(htp_connp_t *connp, enum htp_content_encoding_t format) {
+    htp_decompressor_gzip_t *drec = (htp_decompressor_gzip_t *) connp->out_decompressor_spare;
+
+    if (drec != NULL) {
+        connp->out_decompressor_spare = NULL;
+    } else {
+        drec = calloc(1, sizeof (htp_decompressor_gzip_t));
+        if (drec == NULL) return NULL;
+
+        drec->super.decompress = (int (*)(htp_decompressor_t *, htp_tx_data_t *))htp_gzip_decompressor_decompress;
+        drec->super.destroy = (void (*)(htp_decompressor_t *))htp_gzip_decompressor_destroy;
+
+        drec->buffer = malloc(GZIP_BUF_SIZE);
+        if (drec->buffer == NULL) {
+            free(drec);
+            return NULL;
+        }
+    }
+
+    drec->super.callback = NULL;
+
+    // Initialize zlib.
+    if (htp_gzip_decompressor_init(connp, drec, format) != HTP_OK) {
+        htp_gzip_decompressor_destroy(drec);
+        return NULL;
+    }
+
     #if 0
     if (format == COMPRESSION_DEFLATE) {
         drec->initialized = 1;
@@ -214,3 +242,22 @@ htp_decompressor_t *htp_gzip_decompressor_create(htp_connp_t *connp, enum htp_co
 
     return (htp_decompressor_t *) drec;
 }
+
+/**
+ * Release a decompressor that is no longer needed. The decompressor is kept
+ * as the connection's spare, so that the next compressed response on the
+ * same connection does not have to allocate a new zlib state, unless there
+ * already is a spare, in which case it is destroyed.
+ *
+ * @param[in] connp
+ * @param[in] drec
+ */
+void htp_gzip_decompressor_release(htp_connp_t *connp, htp_decompressor_t *drec) {
+    if (drec == NULL) return;
+
+    if ((connp->out_decompressor_spare == NULL) && (((htp_decompressor_gzip_t *) drec)->zlib_initialized)) {
+        connp->out_decompressor_spare = drec;
+    } else {
+        drec->destroy(drec);
+    }
+}
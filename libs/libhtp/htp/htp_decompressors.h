@@ -73,6 +73,7 @@ struct htp_decompressor_gzip_t {
 };
 
 htp_decompressor_t *htp_gzip_decompressor_create(htp_connp_t *connp, enum htp_content_encoding_t format);
+void htp_gzip_decompressor_release(htp_connp_t *connp, htp_decompressor_t *drec);
 
 #ifdef __cplusplus
 }
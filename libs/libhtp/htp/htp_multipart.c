@@ -1096,6 +1096,28 @@ htp_status_t htp_mpartp_finalize(htp_mpartp_t *parser) {
     return HTP_OK;
 }
 
+/**
+ * Finds the next CR or LF byte in a buffer. Part data can be large (file uploads)
+ * and contain few line endings, so the search is done with memchr(), which
+ * examines many bytes at a time, rather than byte by byte.
+ *
+ * @param[in] data
+ * @param[in] pos Position to start from.
+ * @param[in] len Buffer length.
+ * @return Position of the first CR or LF at or after pos, or len if there is none.
+ */
+static size_t htp_mpartp_find_line_end(const unsigned char *data, size_t pos, size_t len) {
+    if (pos >= len) return len;
+
+    const unsigned char *lf = memchr(data + pos, LF, len - pos);
+    size_t end = (lf == NULL) ? len : (size_t) (lf - data);
+
+    const unsigned char *cr = memchr(data + pos, CR, end - pos);
+    if (cr != NULL) return (size_t) (cr - data);
+
+    return end;
+}
+
 htp_status_t htp_mpartp_parse(htp_mpartp_t *parser, const void *_data, size_t len) {
     unsigned char *data = (unsigned char *) _data;
 
@@ -1200,6 +1222,9 @@ STATE_SWITCH:
                             parser->handle_data(parser, (unsigned char *) &"\r", 1, /* not a line */ 0);
                             parser->cr_aside = 0;
                         }
+
+                        // Only CR and LF bytes need attention; skip to the next one.
+                        pos = htp_mpartp_find_line_end(data, pos, len);
                     }
                 } // while               
 
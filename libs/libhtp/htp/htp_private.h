@@ -206,8 +206,8 @@ htp_status_t htp_php_parameter_processor(htp_param_t *p);
 int htp_transcode_params(htp_connp_t *connp, htp_table_t **params, int destroy_old);
 int htp_transcode_bstr(iconv_t cd, bstr *input, bstr **output);
 
-int htp_parse_single_cookie_v0(htp_connp_t *connp, unsigned char *data, size_t len);
-int htp_parse_cookies_v0(htp_connp_t *connp);
+int htp_parse_single_cookie_v0(htp_tx_t *tx, unsigned char *data, size_t len);
+int htp_parse_cookies_v0(htp_tx_t *tx);
 int htp_parse_authorization(htp_connp_t *connp);
 
 htp_status_t htp_extract_quoted_string_as_bstr(unsigned char *data, size_t len, bstr **out, size_t *endoffset);
@@ -81,6 +81,29 @@ if ((X)->in_current_read_offset < (X)->in_current_len) { \
     return HTP_DATA_BUFFER; \
 }
 
+/**
+ * Copies the bytes up to and including the next LF, as repeated use of
+ * IN_COPY_BYTE_OR_RETURN() would, but locating the LF with memchr(),
+ * which examines many bytes at a time. Returns HTP_DATA_BUFFER if the
+ * available data does not contain a LF.
+ */
+#define IN_COPY_LINE_OR_RETURN(X) \
+{ \
+    if ((X)->in_current_read_offset >= (X)->in_current_len) { \
+        return HTP_DATA_BUFFER; \
+    } \
+    const unsigned char *_start = (X)->in_current_data + (X)->in_current_read_offset; \
+    size_t _avail = (size_t) ((X)->in_current_len - (X)->in_current_read_offset); \
+    const unsigned char *_lf = memchr(_start, LF, _avail); \
+    size_t _n = (_lf == NULL) ? _avail : (size_t) (_lf - _start) + 1; \
+    (X)->in_next_byte = _start[_n - 1]; \
+    (X)->in_current_read_offset += _n; \
+    (X)->in_stream_offset += _n; \
+    if (_lf == NULL) { \
+        return HTP_DATA_BUFFER; \
+    } \
+}
+
 /**
  * Sends outstanding connection data to the currently active data receiver hook.
  *
@@ -215,20 +238,22 @@ static htp_status_t htp_connp_req_buffer(htp_connp_t *connp) {
 
     // Copy the data remaining in the buffer.
 
-    if (connp->in_buf == NULL) {
-        connp->in_buf = malloc(len);
-        if (connp->in_buf == NULL) return HTP_ERROR;
-        memcpy(connp->in_buf, data, len);
-        connp->in_buf_size = len;
-    } else {
-        size_t newsize = connp->in_buf_size + len;
-        unsigned char *newbuf = realloc(connp->in_buf, newsize);
+    if (connp->in_buf_size + len > connp->in_buf_capacity) {
+        // Grow geometrically, and keep the buffer when it is cleared, so that
+        // fragments of pipelined messages do not cost an allocation each.
+        size_t newcapacity = connp->in_buf_capacity * 2;
+        if (newcapacity < connp->in_buf_size + len) {
+            newcapacity = connp->in_buf_size + len;
+        }
+        unsigned char *newbuf = realloc(connp->in_buf, newcapacity);
         if (newbuf == NULL) return HTP_ERROR;
         connp->in_buf = newbuf;
-        memcpy(connp->in_buf + connp->in_buf_size, data, len);
-        connp->in_buf_size = newsize;
+        connp->in_buf_capacity = newcapacity;
     }
 
+    memcpy(connp->in_buf + connp->in_buf_size, data, len);
+    connp->in_buf_size += len;
+
     // Reset the consumer position.
     connp->in_current_consume_offset = connp->in_current_read_offset;
 
@@ -246,7 +271,7 @@ static htp_status_t htp_connp_req_buffer(htp_connp_t *connp) {
  * @return HTP_OK
  */
 static htp_status_t htp_connp_req_consolidate_data(htp_connp_t *connp, unsigned char **data, size_t *len) {
-    if (connp->in_buf == NULL) {
+    if (connp->in_buf_size == 0) {
         // We do not have any data buffered; point to the current data chunk.
         *data = connp->in_current_data + connp->in_current_consume_offset;
         *len = connp->in_current_read_offset - connp->in_current_consume_offset;
@@ -272,11 +297,7 @@ static htp_status_t htp_connp_req_consolidate_data(htp_connp_t *connp, unsigned
 static void htp_connp_req_clear_buffer(htp_connp_t *connp) {
     connp->in_current_consume_offset = connp->in_current_read_offset;
 
-    if (connp->in_buf != NULL) {
-        free(connp->in_buf);
-        connp->in_buf = NULL;
-        connp->in_buf_size = 0;
-    }
+    connp->in_buf_size = 0;
 }
 
 /**
@@ -481,7 +502,7 @@ htp_status_t htp_connp_REQ_BODY_CHUNKED_DATA(htp_connp_t *connp) {
  */
 htp_status_t htp_connp_REQ_BODY_CHUNKED_LENGTH(htp_connp_t *connp) {
     for (;;) {
-        IN_COPY_BYTE_OR_RETURN(connp);
+        IN_COPY_LINE_OR_RETURN(connp);
 
         // Have we reached the end of the line?
         if (connp->in_next_byte == LF) {
@@ -615,7 +636,7 @@ htp_status_t htp_connp_REQ_BODY_DETERMINE(htp_connp_t *connp) {
  */
 htp_status_t htp_connp_REQ_HEADERS(htp_connp_t *connp) {
     for (;;) {
-        IN_COPY_BYTE_OR_RETURN(connp);
+        IN_COPY_LINE_OR_RETURN(connp);
 
         // Have we reached the end of the line?
         if (connp->in_next_byte == LF) {
@@ -779,8 +800,8 @@ htp_status_t htp_connp_REQ_LINE_complete(htp_connp_t *connp) {
  */
 htp_status_t htp_connp_REQ_LINE(htp_connp_t *connp) {
     for (;;) {
-        // Get one byte
-        IN_COPY_BYTE_OR_RETURN(connp);
+        // Get the rest of the line
+        IN_COPY_LINE_OR_RETURN(connp);
 
         // Have we reached the end of the line?
         if (connp->in_next_byte == LF) {
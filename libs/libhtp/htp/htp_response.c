@@ -81,6 +81,29 @@ if ((X)->out_current_read_offset < (X)->out_current_len) { \
     return HTP_DATA_BUFFER; \
 }
 
+/**
+ * Copies the bytes up to and including the next LF, as repeated use of
+ * OUT_COPY_BYTE_OR_RETURN() would, but locating the LF with memchr(),
+ * which examines many bytes at a time. Returns HTP_DATA_BUFFER if the
+ * available data does not contain a LF.
+ */
+#define OUT_COPY_LINE_OR_RETURN(X) \
+{ \
+    if ((X)->out_current_read_offset >= (X)->out_current_len) { \
+        return HTP_DATA_BUFFER; \
+    } \
+    const unsigned char *_start = (X)->out_current_data + (X)->out_current_read_offset; \
+    size_t _avail = (size_t) ((X)->out_current_len - (X)->out_current_read_offset); \
+    const unsigned char *_lf = memchr(_start, LF, _avail); \
+    size_t _n = (_lf == NULL) ? _avail : (size_t) (_lf - _start) + 1; \
+    (X)->out_next_byte = _start[_n - 1]; \
+    (X)->out_current_read_offset += _n; \
+    (X)->out_stream_offset += _n; \
+    if (_lf == NULL) { \
+        return HTP_DATA_BUFFER; \
+    } \
+}
+
 /**
  * Sends outstanding connection data to the currently active data receiver hook.
  *
@@ -214,20 +237,22 @@ static htp_status_t htp_connp_res_buffer(htp_connp_t *connp) {
 
     // Copy the data remaining in the buffer.
 
-    if (connp->out_buf == NULL) {
-        connp->out_buf = malloc(len);
-        if (connp->out_buf == NULL) return HTP_ERROR;
-        memcpy(connp->out_buf, data, len);
-        connp->out_buf_size = len;
-    } else {
-        size_t newsize = connp->out_buf_size + len;
-        unsigned char *newbuf = realloc(connp->out_buf, newsize);
+    if (connp->out_buf_size + len > connp->out_buf_capacity) {
+        // Grow geometrically, and keep the buffer when it is cleared, so that
+        // fragments of pipelined messages do not cost an allocation each.
+        size_t newcapacity = connp->out_buf_capacity * 2;
+        if (newcapacity < connp->out_buf_size + len) {
+            newcapacity = connp->out_buf_size + len;
+        }
+        unsigned char *newbuf = realloc(connp->out_buf, newcapacity);
         if (newbuf == NULL) return HTP_ERROR;
         connp->out_buf = newbuf;
-        memcpy(connp->out_buf + connp->out_buf_size, data, len);
-        connp->out_buf_size = newsize;
+        connp->out_buf_capacity = newcapacity;
     }
 
+    memcpy(connp->out_buf + connp->out_buf_size, data, len);
+    connp->out_buf_size += len;
+
     // Reset the consumer position.
     connp->out_current_consume_offset = connp->out_current_read_offset;
 
@@ -245,7 +270,7 @@ static htp_status_t htp_connp_res_buffer(htp_connp_t *connp) {
  * @return HTP_OK
  */
 static htp_status_t htp_connp_res_consolidate_data(htp_connp_t *connp, unsigned char **data, size_t *len) {    
-    if (connp->out_buf == NULL) {
+    if (connp->out_buf_size == 0) {
         // We do not have any data buffered; point to the current data chunk.
         *data = connp->out_current_data + connp->out_current_consume_offset;
         *len = connp->out_current_read_offset - connp->out_current_consume_offset;
@@ -271,11 +296,7 @@ static htp_status_t htp_connp_res_consolidate_data(htp_connp_t *connp, unsigned
 static void htp_connp_res_clear_buffer(htp_connp_t *connp) {
     connp->out_current_consume_offset = connp->out_current_read_offset;
 
-    if (connp->out_buf != NULL) {
-        free(connp->out_buf);
-        connp->out_buf = NULL;
-        connp->out_buf_size = 0;
-    }
+    connp->out_buf_size = 0;
 }
 
 /**
@@ -348,7 +369,7 @@ htp_status_t htp_connp_RES_BODY_CHUNKED_DATA(htp_connp_t *connp) {
  */
 htp_status_t htp_connp_RES_BODY_CHUNKED_LENGTH(htp_connp_t *connp) {
     for (;;) {
-        OUT_COPY_BYTE_OR_RETURN(connp);
+        OUT_COPY_LINE_OR_RETURN(connp);
         
         // Have we reached the end of the line?
         if (connp->out_next_byte == LF) {
@@ -641,7 +662,7 @@ htp_status_t htp_connp_RES_BODY_DETERMINE(htp_connp_t *connp) {
  */
 htp_status_t htp_connp_RES_HEADERS(htp_connp_t *connp) {
     for (;;) {
-        OUT_COPY_BYTE_OR_RETURN(connp);
+        OUT_COPY_LINE_OR_RETURN(connp);
 
         // Have we reached the end of the line?
         if (connp->out_next_byte == LF) {
@@ -757,8 +778,8 @@ htp_status_t htp_connp_RES_LINE(htp_connp_t *connp) {
     for (;;) {
         // Don't try to get more data if the stream is closed. If we do, we'll return, asking for more data.
         if (connp->out_status != HTP_STREAM_CLOSED) {
-            // Get one byte
-            OUT_COPY_BYTE_OR_RETURN(connp);
+            // Get the rest of the line
+            OUT_COPY_LINE_OR_RETURN(connp);
         }
 
         // Have we reached the end of the line? We treat stream closure as end of line in
@@ -40,6 +40,117 @@
 
 #include "htp_private.h"
 
+/**
+ * Computes the case-insensitive (FNV-1a) hash of a key.
+ *
+ * @param[in] data
+ * @param[in] len
+ * @return Hash value.
+ */
+static size_t _htp_table_hash(const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *) data;
+    size_t hash = 2166136261U;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (size_t) tolower(p[i]);
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+/**
+ * Inserts an element into the table index, unless an element with the same
+ * key is already indexed. The index must have at least one free slot.
+ *
+ * @param[in] table
+ * @param[in] idx Element index.
+ */
+static void _htp_table_index_insert(htp_table_t *table, size_t idx) {
+    bstr *key = htp_list_get(table->list, idx * 2);
+    size_t hash = _htp_table_hash(bstr_ptr(key), bstr_len(key));
+    size_t mask = table->index_size - 1;
+
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        htp_table_slot_t *slot = &table->index[i];
+
+        if (slot->position == 0) {
+            slot->hash = hash;
+            slot->position = idx + 1;
+            return;
+        }
+
+        if (slot->hash == hash) {
+            bstr *key_candidate = htp_list_get(table->list, (slot->position - 1) * 2);
+            if (bstr_cmp_nocase(key_candidate, key) == 0) {
+                // Lookups return the first element with a key.
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * (Re)builds the table index with room for at least twice the current
+ * number of elements. On allocation failure, the table is left without
+ * an index.
+ *
+ * @param[in] table
+ */
+static void _htp_table_index_build(htp_table_t *table) {
+    size_t n = htp_table_size(table);
+    size_t size = 16;
+
+    while (size < n * 4) size *= 2;
+
+    free(table->index);
+    table->index_size = 0;
+    table->index = calloc(size, sizeof (htp_table_slot_t));
+    if (table->index == NULL) return;
+    table->index_size = size;
+
+    for (size_t i = 0; i < n; i++) {
+        _htp_table_index_insert(table, i);
+    }
+}
+
+/**
+ * Looks up the first element with a key using the table index.
+ *
+ * @param[in] table Table with an index.
+ * @param[in] key
+ * @param[in] key_len
+ * @return Element, or NULL if there is no element with the key.
+ */
+static void *_htp_table_index_get(const htp_table_t *table, const void *key, size_t key_len) {
+    size_t hash = _htp_table_hash(key, key_len);
+    size_t mask = table->index_size - 1;
+
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        const htp_table_slot_t *slot = &table->index[i];
+
+        if (slot->position == 0) return NULL;
+
+        if (slot->hash == hash) {
+            bstr *key_candidate = htp_list_get(table->list, (slot->position - 1) * 2);
+            if (bstr_cmp_mem_nocase(key_candidate, key, key_len) == 0) {
+                return htp_list_get(table->list, ((slot->position - 1) * 2) + 1);
+            }
+        }
+    }
+}
+
+/**
+ * Forgets the table index.
+ *
+ * @param[in] table
+ */
+static void _htp_table_index_clear(htp_table_t *table) {
+    free(table->index);
+    table->index = NULL;
+    table->index_size = 0;
+}
+
 static htp_status_t _htp_table_add(htp_table_t *table, const bstr *key, const void *element) {
     // Add key.
     if (htp_list_add(table->list, (void *)key) != HTP_OK) return HTP_ERROR;
@@ -50,6 +161,18 @@ static htp_status_t _htp_table_add(htp_table_t *table, const bstr *key, const vo
         return HTP_ERROR;
     }
 
+    // Maintain the index, keeping its load factor at or below one half.
+    size_t n = htp_table_size(table);
+    if (table->index != NULL) {
+        if (n * 2 > table->index_size) {
+            _htp_table_index_build(table);
+        } else {
+            _htp_table_index_insert(table, n - 1);
+        }
+    } else if (n >= HTP_TABLE_INDEX_MIN) {
+        _htp_table_index_build(table);
+    }
+
     return HTP_OK;
 }
 
@@ -136,6 +259,7 @@ void htp_table_clear(htp_table_t *table) {
         }
     }
 
+    _htp_table_index_clear(table);
     htp_list_clear(table->list);
 }
 
@@ -144,6 +268,7 @@ void htp_table_clear_ex(htp_table_t *table) {
 
     // This function does not free table keys.
 
+    _htp_table_index_clear(table);
     htp_list_clear(table->list);
 }
 
@@ -189,6 +314,10 @@ void htp_table_destroy_ex(htp_table_t *table) {
 void *htp_table_get(const htp_table_t *table, const bstr *key) {
     if ((table == NULL)||(key == NULL)) return NULL;
 
+    if (table->index != NULL) {
+        return _htp_table_index_get(table, bstr_ptr(key), bstr_len(key));
+    }
+
     // Iterate through the list, comparing
     // keys with the parameter, return data if found.    
     for (size_t i = 0, n = htp_list_size(table->list); i < n; i += 2) {
@@ -205,6 +334,10 @@ void *htp_table_get(const htp_table_t *table, const bstr *key) {
 void *htp_table_get_c(const htp_table_t *table, const char *ckey) {
     if ((table == NULL)||(ckey == NULL)) return NULL;
 
+    if (table->index != NULL) {
+        return _htp_table_index_get(table, ckey, strlen(ckey));
+    }
+
     // Iterate through the list, comparing
     // keys with the parameter, return data if found.    
     for (size_t i = 0, n = htp_list_size(table->list); i < n; i += 2) {
@@ -233,6 +366,10 @@ void *htp_table_get_index(const htp_table_t *table, size_t idx, bstr **key) {
 void *htp_table_get_mem(const htp_table_t *table, const void *key, size_t key_len) {
     if ((table == NULL)||(key == NULL)) return NULL;
 
+    if (table->index != NULL) {
+        return _htp_table_index_get(table, key, key_len);
+    }
+
     // Iterate through the list, comparing
     // keys with the parameter, return data if found.
     for (size_t i = 0, n = htp_list_size(table->list); i < n; i += 2) {
@@ -60,6 +60,20 @@ enum htp_table_alloc_t {
     HTP_TABLE_KEYS_REFERENCED = 3
 };
 
+/** Number of elements at which a table starts maintaining a hash index. */
+#define HTP_TABLE_INDEX_MIN 8
+
+/**
+ * Slot of the hash index of a table.
+ */
+typedef struct htp_table_slot_t {
+    /** Case-insensitive hash of the key. */
+    size_t hash;
+
+    /** Element index plus one; zero for an empty slot. */
+    size_t position;
+} htp_table_slot_t;
+
 struct htp_table_t {
     /** Table key and value pairs are stored in this list; name first, then value. */
     htp_list_t *list;
@@ -69,6 +83,16 @@ struct htp_table_t {
      * actual strategy is determined by the first allocation.
      */
     enum htp_table_alloc_t alloc_type;
+
+    /**
+     * Open addressing hash index of the first element of each (case-insensitive)
+     * key. NULL until the table holds HTP_TABLE_INDEX_MIN elements; lookups in
+     * smaller tables, or when the index could not be allocated, scan the list.
+     */
+    htp_table_slot_t *index;
+
+    /** Number of slots in the index; always a power of two. */
+    size_t index_size;
 };
 
 #ifdef	__cplusplus
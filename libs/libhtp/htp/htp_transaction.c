@@ -530,7 +530,7 @@ static htp_status_t htp_tx_process_request_headers(htp_tx_t *tx) {
 
     // Parse cookies.
     if (tx->connp->cfg->parse_request_cookies) {
-        rc = htp_parse_cookies_v0(tx->connp);
+        rc = htp_parse_cookies_v0(tx);
         if (rc != HTP_OK) return rc;
     }
 
@@ -612,6 +612,15 @@ htp_status_t htp_tx_req_set_headers_clear(htp_tx_t *tx) {
     return HTP_OK;
 }
 
+htp_status_t htp_tx_req_parse_cookies(htp_tx_t *tx) {
+    if ((tx == NULL) || (tx->request_headers == NULL)) return HTP_ERROR;
+
+    // Nothing to do if the cookies were already parsed.
+    if (tx->request_cookies != NULL) return HTP_OK;
+
+    return htp_parse_cookies_v0(tx);
+}
+
 htp_status_t htp_tx_req_set_line(htp_tx_t *tx, const char *line, size_t line_len, enum htp_alloc_strategy_t alloc) {
     if ((tx == NULL) || (line == NULL) || (line_len == 0)) return HTP_ERROR;
 
@@ -795,16 +804,26 @@ htp_status_t htp_tx_res_process_body_data_ex(htp_tx_t *tx, const void *data, siz
     switch (tx->response_content_encoding_processing) {
         case HTP_COMPRESSION_GZIP:
         case HTP_COMPRESSION_DEFLATE:
-            // In severe memory stress these could be NULL
-            if (tx->connp->out_decompressor == NULL || tx->connp->out_decompressor->decompress == NULL)
-                return HTP_ERROR;
+            if (tx->connp->out_decompressor == NULL) {
+                if (data == NULL) {
+                    // No body data was seen, so there is nothing to
+                    // decompress; just signal the end of the body.
+                    return htp_tx_res_process_body_data_decompressor_callback(&d);
+                }
+
+                // Create the decompressor when the first body data arrives.
+                tx->connp->out_decompressor = htp_gzip_decompressor_create(tx->connp, tx->response_content_encoding_processing);
+                if (tx->connp->out_decompressor == NULL) return HTP_ERROR;
+
+                tx->connp->out_decompressor->callback = htp_tx_res_process_body_data_decompressor_callback;
+            }
 
             // Send data buffer to the decompressor.
             tx->connp->out_decompressor->decompress(tx->connp->out_decompressor, &d);
 
             if (data == NULL) {
-                // Shut down the decompressor, if we used one.
-                tx->connp->out_decompressor->destroy(tx->connp->out_decompressor);
+                // Shut down the decompressor, keeping it for the next response.
+                htp_gzip_decompressor_release(tx->connp, tx->connp->out_decompressor);
                 tx->connp->out_decompressor = NULL;
             }
             break;
@@ -1117,17 +1136,17 @@ htp_status_t htp_tx_state_response_headers(htp_tx_t *tx) {
     // 3. Decompression is disabled and we do not attempt to enable it, but the user
     //    forces decompression by setting response_content_encoding to one of the
     //    supported algorithms.
-    if ((tx->response_content_encoding_processing == HTP_COMPRESSION_GZIP) || (tx->response_content_encoding_processing == HTP_COMPRESSION_DEFLATE)) {
-        if (tx->connp->out_decompressor != NULL) {
-            tx->connp->out_decompressor->destroy(tx->connp->out_decompressor);
-            tx->connp->out_decompressor = NULL;
-        }
+    //
+    // The decompressor itself is created when the first response body
+    // data arrives, so that responses without a body never set up zlib.
+    if (tx->connp->out_decompressor != NULL) {
+        htp_gzip_decompressor_release(tx->connp, tx->connp->out_decompressor);
+        tx->connp->out_decompressor = NULL;
+    }
 
-        tx->connp->out_decompressor = htp_gzip_decompressor_create(tx->connp, tx->response_content_encoding_processing);
-        if (tx->connp->out_decompressor == NULL) return HTP_ERROR;
-        
-        tx->connp->out_decompressor->callback = htp_tx_res_process_body_data_decompressor_callback;
-    } else if (tx->response_content_encoding_processing != HTP_COMPRESSION_NONE) {
+    if ((tx->response_content_encoding_processing != HTP_COMPRESSION_NONE)
+            && (tx->response_content_encoding_processing != HTP_COMPRESSION_GZIP)
+            && (tx->response_content_encoding_processing != HTP_COMPRESSION_DEFLATE)) {
         return HTP_ERROR;
     }
 
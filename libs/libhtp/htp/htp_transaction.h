@@ -228,6 +228,18 @@ htp_status_t htp_tx_req_set_header(htp_tx_t *tx, const char *name, size_t name_l
  */
 htp_status_t htp_tx_req_set_headers_clear(htp_tx_t *tx);
 
+/**
+ * Parses the Cookie request header into tx->request_cookies, unless the
+ * cookies have already been parsed. Containers that disable automatic
+ * cookie parsing (see htp_config_set_parse_request_cookies()) can use this
+ * function to parse cookies only when they are needed. The request headers
+ * must be available.
+ *
+ * @param[in] tx Transaction pointer. Must not be NULL.
+ * @return HTP_OK on success, HTP_ERROR on failure.
+ */
+htp_status_t htp_tx_req_parse_cookies(htp_tx_t *tx);
+
 /**
  * Set request line. When used, this function should always be called first,
  * with more specific functions following. Must not contain line terminators.
@@ -0,0 +1,28 @@
+>>>
+GET /first HTTP/1.1
+Host: www.example.com
+
+GET /sec
+>>>
+ond HTTP/1.1
+Host: www.exa
+>>>
+mple.com
+
+GET /third HTTP/1.1
+Host: www.example.com
+
+
+<<<
+HTTP/1.1 200 OK
+Content-Length: 12
+
+Hello World!HTTP/1.1 200 OK
+Content-Le
+<<<
+ngth: 12
+
+Hello World!HTTP/1.1 200 OK
+Content-Length: 12
+
+Hello World!
\ No newline at end of file
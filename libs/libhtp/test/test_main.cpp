@@ -250,6 +250,31 @@ TEST_F(ConnectionParsing, PipelinedConn) {
     ASSERT_TRUE(tx != NULL);
 }
 
+TEST_F(ConnectionParsing, PipelinedSplitConn) {
+    int rc = test_run(home, "92-pipelined-split-connection.t", cfg, &connp);
+    ASSERT_GE(rc, 0);
+
+    ASSERT_EQ(3, htp_list_size(connp->conn->transactions));
+
+    ASSERT_TRUE(connp->conn->flags & HTP_CONN_PIPELINED);
+
+    const char *uris[] = { "/first", "/second", "/third" };
+    for (size_t i = 0; i < 3; i++) {
+        htp_tx_t *tx = (htp_tx_t *) htp_list_get(connp->conn->transactions, i);
+        ASSERT_TRUE(tx != NULL);
+
+        ASSERT_EQ(0, bstr_cmp_c(tx->request_uri, uris[i]));
+
+        htp_header_t *h = (htp_header_t *) htp_table_get_c(tx->request_headers, "host");
+        ASSERT_TRUE(h != NULL);
+        ASSERT_EQ(0, bstr_cmp_c(h->value, "www.example.com"));
+
+        ASSERT_EQ(200, tx->response_status_number);
+        ASSERT_EQ(12, tx->response_content_length);
+        ASSERT_EQ(HTP_RESPONSE_COMPLETE, tx->response_progress);
+    }
+}
+
 TEST_F(ConnectionParsing, NotPipelinedConn) {
     int rc = test_run(home, "08-not-pipelined-connection.t", cfg, &connp);
     ASSERT_GE(rc, 0);
@@ -363,6 +388,25 @@ TEST_F(ConnectionParsing, CompressedResponseChunked) {
     ASSERT_EQ(159590, tx->response_entity_len);
 }
 
+TEST_F(ConnectionParsing, CompressedResponseKeepAlive) {
+    int rc = test_run(home, "91-compressed-response-keepalive.t", cfg, &connp);
+    ASSERT_GE(rc, 0);
+
+    ASSERT_EQ(2, htp_list_size(connp->conn->transactions));
+
+    // The second response reuses the decompressor of the first one.
+    for (size_t i = 0; i < 2; i++) {
+        htp_tx_t *tx = (htp_tx_t *) htp_list_get(connp->conn->transactions, i);
+        ASSERT_TRUE(tx != NULL);
+
+        ASSERT_TRUE(htp_tx_is_complete(tx));
+
+        ASSERT_EQ(187, tx->response_message_len);
+
+        ASSERT_EQ(225, tx->response_entity_len);
+    }
+}
+
 TEST_F(ConnectionParsing, SuccessfulConnectRequest) {
     int rc = test_run(home, "15-connect-complete.t", cfg, &connp);
     ASSERT_GE(rc, 0);
@@ -1474,6 +1518,34 @@ TEST_F(ConnectionParsing, RequestCookies) {
     ASSERT_EQ(0, bstr_cmp_c(value, ""));
 }
 
+TEST_F(ConnectionParsing, RequestCookiesOnDemand) {
+    htp_config_set_parse_request_cookies(cfg, 0);
+
+    int rc = test_run(home, "60-request-cookies.t", cfg, &connp);
+    ASSERT_GE(rc, 0);
+
+    ASSERT_EQ(1, htp_list_size(connp->conn->transactions));
+
+    htp_tx_t *tx = (htp_tx_t *) htp_list_get(connp->conn->transactions, 0);
+    ASSERT_TRUE(tx != NULL);
+
+    ASSERT_TRUE(tx->request_cookies == NULL);
+
+    ASSERT_EQ(HTP_OK, htp_tx_req_parse_cookies(tx));
+    ASSERT_EQ(3, htp_table_size(tx->request_cookies));
+
+    // Parsing again must not add the cookies twice.
+    ASSERT_EQ(HTP_OK, htp_tx_req_parse_cookies(tx));
+    ASSERT_EQ(3, htp_table_size(tx->request_cookies));
+
+    bstr *key = NULL;
+    bstr *value = (bstr *) htp_table_get_index(tx->request_cookies, 1, &key);
+    ASSERT_TRUE(key != NULL);
+    ASSERT_TRUE(value != NULL);
+    ASSERT_EQ(0, bstr_cmp_c(key, "q"));
+    ASSERT_EQ(0, bstr_cmp_c(value, "2"));
+}
+
 TEST_F(ConnectionParsing, EmptyLineBetweenRequests) {
     int rc = test_run(home, "61-empty-line-between-requests.t", cfg, &connp);
     ASSERT_GE(rc, 0);
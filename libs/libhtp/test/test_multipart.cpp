@@ -37,6 +37,7 @@
  */
 
 #include <iostream>
+#include <string>
 #include <gtest/gtest.h>
 #include <htp/htp_private.h>
 #include "test.h"
@@ -1938,3 +1939,39 @@ TEST_F(Multipart, HeaderValueTrim) {
     ASSERT_TRUE(h != NULL);
     ASSERT_TRUE(bstr_cmp_c(h->value, "form-data; name=\"field1\" ") == 0);
 }
+
+TEST_F(Multipart, LargePartInChunks) {
+    // Part data with few, isolated line endings, some of them at chunk edges.
+    std::string value;
+    for (size_t i = 0; i < 20000; i++) {
+        if (i % 1500 == 999) value += '\r';
+        else if (i % 1500 == 1499) value += '\n';
+        else if (i % 2000 == 1998) value += "\r\n-";
+        else value += (char) ('A' + (i % 26));
+    }
+
+    std::string payload = "--0123456789\r\n"
+        "Content-Disposition: form-data; name=\"field1\"\r\n"
+        "\r\n" + value + "\r\n"
+        "--0123456789--";
+
+    mpartp = htp_mpartp_create(cfg, bstr_dup_c("0123456789"), 0 /* flags */);
+
+    for (size_t pos = 0; pos < payload.size(); pos += 1000) {
+        size_t n = payload.size() - pos;
+        if (n > 1000) n = 1000;
+        htp_mpartp_parse(mpartp, payload.data() + pos, n);
+    }
+
+    htp_mpartp_finalize(mpartp);
+
+    body = htp_mpartp_get_multipart(mpartp);
+    ASSERT_TRUE(body != NULL);
+    ASSERT_EQ(1, htp_list_size(body->parts));
+
+    htp_multipart_part_t *part = (htp_multipart_part_t *) htp_list_get(body->parts, 0);
+    ASSERT_EQ(MULTIPART_PART_TEXT, part->type);
+    ASSERT_TRUE(part->value != NULL);
+    ASSERT_EQ(value.size(), bstr_len(part->value));
+    ASSERT_TRUE(memcmp(value.data(), bstr_ptr(part->value), value.size()) == 0);
+}
@@ -1705,6 +1705,66 @@ TEST(Table, Misc) {
     htp_table_destroy(t);
 }
 
+TEST(Table, Indexed) {
+    htp_table_t *t = htp_table_create(2);
+    char name[16];
+    char *p;
+
+    // Enough elements for the table to be indexed, and to grow its index.
+    for (int i = 0; i < 100; i++) {
+        snprintf(name, sizeof(name), "Key%d", i);
+        bstr *key = bstr_dup_c(name);
+        ASSERT_EQ(HTP_OK, htp_table_add(t, key, (void *) (intptr_t) (i + 1)));
+        bstr_free(key);
+    }
+
+    // A duplicate key; lookups return the first element.
+    bstr *dupkey = bstr_dup_c("KEY7");
+    ASSERT_EQ(HTP_OK, htp_table_add(t, dupkey, (void *) (intptr_t) 1000));
+    bstr_free(dupkey);
+
+    ASSERT_EQ(101, htp_table_size(t));
+
+    for (int i = 0; i < 100; i++) {
+        snprintf(name, sizeof(name), "kEy%d", i);
+        p = (char *) htp_table_get_c(t, name);
+        ASSERT_EQ(i + 1, (intptr_t) p);
+        p = (char *) htp_table_get_mem(t, name, strlen(name));
+        ASSERT_EQ(i + 1, (intptr_t) p);
+    }
+
+    bstr *key = bstr_dup_c("key7");
+    p = (char *) htp_table_get(t, key);
+    ASSERT_EQ(8, (intptr_t) p);
+    bstr_free(key);
+
+    bstr *lastkey = NULL;
+    p = (char *) htp_table_get_index(t, 100, &lastkey);
+    ASSERT_EQ(1000, (intptr_t) p);
+    ASSERT_EQ(0, bstr_cmp_c(lastkey, "KEY7"));
+
+    ASSERT_TRUE(htp_table_get_c(t, "key100") == NULL);
+    ASSERT_TRUE(htp_table_get_c(t, "key") == NULL);
+    ASSERT_TRUE(htp_table_get_c(t, "") == NULL);
+
+    // The index is rebuilt after the table is cleared.
+    htp_table_clear(t);
+    ASSERT_EQ(0, htp_table_size(t));
+    ASSERT_TRUE(htp_table_get_c(t, "key1") == NULL);
+
+    for (int i = 0; i < 10; i++) {
+        snprintf(name, sizeof(name), "other%d", i);
+        bstr *okey = bstr_dup_c(name);
+        ASSERT_EQ(HTP_OK, htp_table_add(t, okey, (void *) (intptr_t) (i + 1)));
+        bstr_free(okey);
+    }
+
+    ASSERT_TRUE(htp_table_get_c(t, "key1") == NULL);
+    ASSERT_EQ(10, (intptr_t) htp_table_get_c(t, "OTHER9"));
+
+    htp_table_destroy(t);
+}
+
 TEST(Util, ExtractQuotedString) {
     bstr *s;
     size_t end_offset;
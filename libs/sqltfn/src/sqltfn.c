@@ -86,7 +86,7 @@ typedef struct tfn_state_t {
  * Handle a dollar-escaped string (e.g., $$text$$ or $tag$text$tag$).
  * 
  * @param[in, out] state
- * @return -1 in case of memory allocation errorr 
+ * @return 1; the tag is not copied, so this can not fail.
  */
 static int sqltfn_normalize_pg_handle_dollar_string(tfn_state_t *state) {
     char *tag = NULL;
@@ -126,14 +126,10 @@ static int sqltfn_normalize_pg_handle_dollar_string(tfn_state_t *state) {
             return 1;
         }
 
-        // Now that we know that we have a valid tag, make
-        // a copy of it, and also copy it into output       
-
-        // Determine the tag length, and copy it
-        // TODO Why copy when the tag is always available in input?        
-        tag = malloc(tag_len);
-        if (tag == NULL) return -1;
-        memcpy(tag, tag_start, tag_len);
+        // Now that we know that we have a valid tag, copy it into
+        // output. The tag stays available in input, so refer to it
+        // there instead of making a copy.
+        tag = tag_start;
 
         while(tag_len--) {            
             COPY_BYTE;
@@ -169,10 +165,6 @@ static int sqltfn_normalize_pg_handle_dollar_string(tfn_state_t *state) {
                 // Copy the second $
                 COPY_BYTE;
 
-                if (tag != NULL) {
-                    free(tag);
-                }
-
                 return 1;
             }
         }
@@ -181,10 +173,6 @@ static int sqltfn_normalize_pg_handle_dollar_string(tfn_state_t *state) {
         COPY_BYTE;
     }
 
-    if (tag != NULL) {
-        free(tag);
-    }
-
     return 1;
 }
 
@@ -222,10 +222,9 @@ local add_operator = function(
         ffi.C.ib_engine_mm_main_get(ib.ib_engine),
         tostring(rule.data.op_arg))
 
-    -- Create the operator.
-    rc = ffi.C.ib_operator_inst_create(
+    -- Create the operator, sharing it with rules of equal parameters.
+    rc = ffi.C.ib_operator_inst_acquire(
         opinst,
-        ffi.C.ib_engine_mm_main_get(ib.ib_engine),
         ctx,
         op[0],
         op_inst_create_flags,
@@ -417,10 +416,9 @@ local build_rule = function(ib, ctx, chain, db)
 
         -- Set tags
         for tag, _ in pairs(rule.data.tags) do
-            local tagcpy =
-                ffi.C.ib_mm_strdup(
-                    ffi.C.ib_engine_mm_main_get(ib.ib_engine),
-                    tostring(tag))
+            local tagcpy = ffi.cast(
+                "char *",
+                ffi.C.ib_engine_intern(ib.ib_engine, tostring(tag)))
             ib:logDebug("Setting tag %s on rule.", tag)
             rc = ffi.C.ib_list_push(prule[0].meta.tags, tagcpy)
             if rc ~= ffi.C.IB_OK then
@@ -531,8 +529,15 @@ local build_rules = function(ib_engine)
     -- Get the main context. All rules are added to the main context.
     local mainctx = ffi.C.ib_context_main(ib_engine)
 
+    -- Plan once; validation and building share the plan.
+    local plan = Waggle:Plan()
+    if type(plan) == 'string' then
+        ib:logError("Failed to plan rules: %s", plan)
+        return ffi.C.IB_EINVAL
+    end
+
     ib:logDebug("Validating rules.")
-    local validator = Waggle:Validate()
+    local validator = Waggle:Validate(plan)
     if type(validator) ~= 'string' then
         if validator:has_warnings() then
             for _, rec in ipairs(validator.warnings) do
@@ -563,7 +568,6 @@ local build_rules = function(ib_engine)
         ib:logDebug("Validation found no problems.")
     end
 
-    local plan = Waggle:Plan()
     local db = Waggle.DEFAULT_RULE_DB
     for _, chain in ipairs(plan) do
         local rc = build_rule(ib, mainctx, chain, db)
@@ -36,6 +36,17 @@ local ibcutil = require('ibcutil')
 local M = {}
 M.__index = M
 
+-- Out parameters of ib_field_value() used by fieldToLua().
+--
+-- Each is read as soon as ib_field_value() fills it in, so they are shared
+-- by all calls rather than allocated for every field converted.
+local numValue     = ffi.new("ib_num_t[1]")
+local timeValue    = ffi.new("ib_time_t[1]")
+local floatValue   = ffi.new("ib_float_t[1]")
+local strValue     = ffi.new("const char*[1]")
+local bytestrValue = ffi.new("const ib_bytestr_t*[1]")
+local listValue    = ffi.new("ib_list_t*[1]")
+
 -------------------------------------------------------------------
 -- Create a new Engine.
 --
@@ -77,43 +88,38 @@ M.fieldToLua = function(self, field)
         return nil
     -- Number
     elseif field.type == ffi.C.IB_FTYPE_NUM then
-        local value = ffi.new("ib_num_t[1]")
-        ffi.C.ib_field_value(field, value)
-        return tonumber(value[0])
+        ffi.C.ib_field_value(field, numValue)
+        return tonumber(numValue[0])
 
     -- Time
     elseif field.type == ffi.C.IB_FTYPE_TIME then
-        local value = ffi.new("ib_time_t[1]")
-        ffi.C.ib_field_value(field, value)
-        return tonumber(value[0])
+        ffi.C.ib_field_value(field, timeValue)
+        return tonumber(timeValue[0])
 
     -- Float Number
     elseif field.type == ffi.C.IB_FTYPE_FLOAT then
-        local value = ffi.new("ib_float_t[1]")
-        ffi.C.ib_field_value(field, value)
-        return ibcutil.from_ib_float(value);
+        ffi.C.ib_field_value(field, floatValue)
+        return ibcutil.from_ib_float(floatValue);
 
     -- String
     elseif field.type == ffi.C.IB_FTYPE_NULSTR then
-        local value = ffi.new("const char*[1]")
-        ffi.C.ib_field_value(field, value)
-        return ffi.string(value[0])
+        ffi.C.ib_field_value(field, strValue)
+        return ffi.string(strValue[0])
 
     -- Byte String
     elseif field.type == ffi.C.IB_FTYPE_BYTESTR then
-        local value = ffi.new("const ib_bytestr_t*[1]")
-        ffi.C.ib_field_value(field, value)
-        return ffi.string(ffi.C.ib_bytestr_const_ptr(value[0]),
-                          ffi.C.ib_bytestr_length(value[0]))
+        ffi.C.ib_field_value(field, bytestrValue)
+        return ffi.string(ffi.C.ib_bytestr_const_ptr(bytestrValue[0]),
+                          ffi.C.ib_bytestr_length(bytestrValue[0]))
 
     -- Lists
     elseif field.type == ffi.C.IB_FTYPE_LIST then
         local t = {}
-        local value = ffi.new("ib_list_t*[1]")
 
-        ffi.C.ib_field_value(field, value)
+        -- The list is passed on before recursing, which reuses listValue.
+        ffi.C.ib_field_value(field, listValue)
         ibutil.each_list_node(
-            value[0],
+            listValue[0],
             function(data)
                 t[#t+1] = { ffi.string(data.name, data.nlen),
                             self:fieldToLua(data) }
@@ -194,6 +200,13 @@ M.log = function(self, level, prefix, fmt, ...)
     local func = '?'
     local msg
 
+    -- Skip the caller lookup and formatting for messages the logger
+    -- would drop.
+    local logger = ffi.C.ib_engine_logger_get(self.ib_engine)
+    if level > ffi.C.ib_logger_level_get(logger) then
+        return
+    end
+
     if level >= ffi.C.IB_LOG_DEBUG then
         local debug_table = debug.getinfo(3, "Sln")
         file = debug_table.short_src
@@ -99,6 +99,40 @@ local actionMap = {
 }
 setmetatable(actionMap, { __index = ibutil.returnUnknown })
 
+-- Var targets by name.
+--
+-- Acquiring a target parses its name and allocates, so targets are kept
+-- for the life of this Lua stack instead of being acquired from the
+-- transaction on every access.  Targets only depend on the var
+-- configuration, which does not change once the stack is in use.
+local targetCache = {}
+
+-- Number of entries in targetCache.
+local targetCacheSize = 0
+
+-- Limit on targetCacheSize; names beyond this are not cached.
+local targetCacheLimit = 1024
+
+-- Memory manager targetCache targets are allocated from.
+local targetCacheMm
+
+-- Memory pool of targetCacheMm; destroyed with this Lua stack.
+local targetCachePool
+
+-- Return targetCacheMm, creating it if needed, or nil on failure.
+local targetCacheMmGet = function()
+    if targetCacheMm == nil then
+        local mpl = ffi.new("ib_mpool_lite_t*[1]")
+        if ffi.C.ib_mpool_lite_create(mpl) ~= ffi.C.IB_OK then
+            return nil
+        end
+        targetCachePool = ffi.gc(mpl[0], ffi.C.ib_mpool_lite_destroy)
+        targetCacheMm = ffi.C.ib_mm_mpool_lite(targetCachePool)
+    end
+
+    return targetCacheMm
+end
+
 
 local M = {}
 M.__index = M
@@ -713,19 +747,37 @@ M.getVarSource = function(self, name)
 end
 
 M.getVarTarget = function(self, name)
+    local cached = targetCache[name]
+    if cached ~= nil then
+        return cached
+    end
+
     local ib_tx     = ffi.cast("ib_tx_t *", self.ib_tx)
     local ib_target = ffi.new("ib_var_target_t*[1]")
+    local mm        = ib_tx.mm
+    local cache     = false
     local rc
 
+    if targetCacheSize < targetCacheLimit then
+        local cache_mm = targetCacheMmGet()
+        if cache_mm ~= nil then
+            mm = cache_mm
+            cache = true
+        end
+    end
+
     rc = ffi.C.ib_var_target_acquire_from_string(
         ib_target,
-        ib_tx.mm,
+        mm,
         ffi.C.ib_engine_var_config_get(ib_tx.ib),
         name,
         #name
     )
     if rc ~= ffi.C.IB_OK then
         self:logError("Error at in %s", name)
+    elseif cache then
+        targetCache[name] = ib_target[0]
+        targetCacheSize = targetCacheSize + 1
     end
 
     return ib_target[0]
@@ -246,8 +246,11 @@ end
 
 -- Return the validator if there are any errors or warnings.
 -- Returns the string "OK" otherwise.
-M.Validate = function(self)
-    local plan = M.Plan()
+--
+-- @param[in] plan The plan to validate, as returned by M.Plan().
+--            If nil, the rules are planned first.
+M.Validate = function(self, plan)
+    plan = plan or M.Plan()
     local validator = Validator:new()
     if type(plan) == 'string' then
         error(plan)
@@ -41,10 +41,15 @@
 
 #include <ironbee/type_convert.h>
 
+#include <openssl/crypto.h>
 #include <openssl/hmac.h>
 
 #include <vector>
 
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
 #ifdef __clang__
 #pragma clang diagnostic push
 #if __has_warning("-Wunused-local-typedef")
@@ -75,6 +80,57 @@ HmacException::HmacException(const std::string& msg)
 {
 }
 
+/**
+ * HMAC-SHA256 key.
+ *
+ * Holds an HMAC context initialized with the key.  Hashes created from it
+ * copy the context instead of hashing the padded key again.
+ */
+class HmacSha256Key : boost::noncopyable {
+public:
+    /**
+     * @throws HmacException on error.
+     */
+    HmacSha256Key(const void *key, int key_len);
+
+    ~HmacSha256Key();
+
+    //! The initialized context.  Only copied from.
+    HMAC_CTX* ctx() const;
+
+private:
+    mutable HMAC_CTX m_ctx;
+};
+
+HmacSha256Key::HmacSha256Key(const void *key, int key_len)
+{
+    HMAC_CTX_init(&m_ctx);
+
+    int hmac_rc = HMAC_Init_ex(
+        &m_ctx,
+        key,
+        key_len,
+        EVP_sha256(),
+        NULL /* No engine. */
+    );
+    if (hmac_rc == 0) {
+        HMAC_CTX_cleanup(&m_ctx);
+        BOOST_THROW_EXCEPTION(
+            HmacException("Failed to initialize key context.")
+        );
+    }
+}
+
+HmacSha256Key::~HmacSha256Key()
+{
+    HMAC_CTX_cleanup(&m_ctx);
+}
+
+HMAC_CTX* HmacSha256Key::ctx() const
+{
+    return &m_ctx;
+}
+
 class HmacSha256 {
 public:
 
@@ -83,6 +139,15 @@ public:
      */
     HmacSha256(const void *key, int key_len);
 
+    /**
+     * Start a hash with a prepared key.
+     *
+     * @param[in] key Key; must outlive this hash.
+     * @throws HmacException on error.
+     */
+    explicit
+    HmacSha256(const HmacSha256Key& key);
+
     /**
      * Update this hash.
      * @throws HmacException on error.
@@ -105,9 +170,10 @@ public:
 
     ~HmacSha256();
 private:
-    HMAC_CTX     m_ctx;
-    const void*  m_key;
-    int          m_key_len;
+    HMAC_CTX             m_ctx;
+    const void*          m_key;
+    int                  m_key_len;
+    const HmacSha256Key* m_prepared_key;
 };
 
 void HmacSha256::update(const unsigned char *data, int len) {
@@ -151,6 +217,15 @@ std::vector<unsigned char> HmacSha256::finish() {
 }
 
 void HmacSha256::reset() {
+    if (m_prepared_key) {
+        if (HMAC_CTX_copy(&m_ctx, m_prepared_key->ctx()) == 0) {
+            BOOST_THROW_EXCEPTION(
+                HmacException("Failed to reset hash context.")
+            );
+        }
+        return;
+    }
+
     int hmac_rc = HMAC_Init_ex(
         &m_ctx,
         m_key,
@@ -168,7 +243,8 @@ void HmacSha256::reset() {
 HmacSha256::HmacSha256(const void *key, int key_len)
 :
     m_key(key),
-    m_key_len(key_len)
+    m_key_len(key_len),
+    m_prepared_key(NULL)
 {
     HMAC_CTX_init(&m_ctx);
 
@@ -188,6 +264,22 @@ HmacSha256::HmacSha256(const void *key, int key_len)
     }
 }
 
+HmacSha256::HmacSha256(const HmacSha256Key& key)
+:
+    m_key(NULL),
+    m_key_len(0),
+    m_prepared_key(&key)
+{
+    HMAC_CTX_init(&m_ctx);
+
+    if (HMAC_CTX_copy(&m_ctx, m_prepared_key->ctx()) == 0) {
+        HMAC_CTX_cleanup(&m_ctx);
+        BOOST_THROW_EXCEPTION(
+            HmacException("Failed to initialize hash context.")
+        );
+    }
+}
+
 HmacSha256::~HmacSha256() {
     HMAC_CTX_cleanup(&m_ctx);
 }
@@ -198,6 +290,77 @@ namespace {
 
 using namespace IronBee;
 
+/**
+ * Value of hexadecimal digit @a c.
+ *
+ * @param[in] c Character.
+ * @returns Value of @a c or -1 if @a c is not a hex digit.
+ */
+int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * Decode hexadecimal digits, of either case.
+ *
+ * @param[in] begin Beginning of digits.
+ * @param[in] end End of digits.
+ * @param[out] out Decoded bytes.
+ * @returns false if the digits are not an even number of hex digits.
+ */
+bool decode_hex(
+    const char*                 begin,
+    const char*                 end,
+    std::vector<unsigned char>& out
+)
+{
+    if ((end - begin) % 2 != 0) {
+        return false;
+    }
+
+    out.clear();
+    out.reserve((end - begin) / 2);
+    for (const char* p = begin; p != end; p += 2) {
+        int hi = hex_value(p[0]);
+        int lo = hex_value(p[1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out.push_back(static_cast<unsigned char>(hi << 4 | lo));
+    }
+
+    return true;
+}
+
+/**
+ * Encode bytes as lowercase hexadecimal digits.
+ *
+ * @param[in] bytes Bytes to encode.
+ * @returns Hex digits.
+ */
+std::string encode_hex(const std::vector<unsigned char>& bytes)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string result(2 * bytes.size(), '0');
+
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        result[2 * i]     = digits[bytes[i] >> 4];
+        result[2 * i + 1] = digits[bytes[i] & 0x0f];
+    }
+
+    return result;
+}
+
 struct Config {
 
     /**
@@ -210,6 +373,13 @@ struct Config {
      */
     std::string secret;
 
+    /**
+     * The secret, prepared by AuthScanSharedSecret.
+     *
+     * Shared with child contexts.  NULL until the directive is used.
+     */
+    boost::shared_ptr<const HmacSha256Key> key;
+
     /**
      * When validation is successful, this is set to 1.
      *
@@ -418,6 +588,9 @@ void Delegate::dir_shared_secret(
     Config& config = module().configuration_data<Config>(cp.current_context());
 
     config.secret = param;
+    config.key.reset(
+        new HmacSha256Key(config.secret.data(), config.secret.length())
+    );
 }
 
 void Delegate::allow(
@@ -513,17 +686,25 @@ void Delegate::handle_headers(
     }
 
     for (; header; header = header.next()) {
-        std::string header_name = header.name().to_s();
+        ConstByteString header_name = header.name();
 
         ib_log_debug_tx(
             tx.ib(),
             "Checking header %.*s",
             static_cast<int>(header_name.length()),
-            header_name.data()
+            header_name.const_data()
         );
 
         /* Does the header match? */
-        if (boost::algorithm::iequals(header.name().to_s(), config.header)) {
+        if (
+            header_name.length() == config.header.length() &&
+            strncasecmp(
+                header_name.const_data(),
+                config.header.data(),
+                config.header.length()
+            ) == 0
+        )
+        {
 
             boost::cmatch results;
 
@@ -540,10 +721,16 @@ void Delegate::handle_headers(
                     std::string date = results[2].str();
                     std::string id = results[3] == "" ? "1" : results[3].str();
 
-                    /* Compute the HMAC for ourselves. */
-                    HmacSha256 hash(
-                        config.secret.data(),
-                        config.secret.length());
+                    /* Compute the HMAC for ourselves, starting from the
+                     * prepared key if there is one. */
+                    boost::scoped_ptr<HmacSha256> hash_ptr(
+                        config.key ?
+                            new HmacSha256(*config.key) :
+                            new HmacSha256(
+                                config.secret.data(),
+                                config.secret.length())
+                    );
+                    HmacSha256& hash = *hash_ptr;
 
                     ib_log_debug_tx(
                         tx.ib(),
@@ -572,40 +759,32 @@ void Delegate::handle_headers(
                     /* Tidy up the hash. */
                     std::vector<unsigned char> hash_bytes = hash.finish();
 
-                    /* Convert bytes into hex. */
-                    size_t hash_str_len = 2 * 256 / 8;
-                    std::vector<char> hash_str(hash_str_len+1);
-
-                    /* For each byte in the binary hash. */
-                    for (size_t i = 0; i < hash_bytes.size(); ++i) {
-                        /* Convert into 2 bytes for the destination output. */
-                        snprintf(&hash_str[i*2], 3, "%.2x", hash_bytes[i]);
-                    }
-
-                    /* -1 to remove the \0 terminator. */
-                    std::string hash_str2(&hash_str[0], hash_str.size()-1);
+                    std::string hash_str = encode_hex(hash_bytes);
 
                     ib_log_debug_tx(
                         tx.ib(),
                         "Computed request hash of %.*s",
-                        static_cast<int>(hash_str2.length()),
-                        hash_str2.data());
+                        static_cast<int>(hash_str.length()),
+                        hash_str.data());
 
-                    /* Validate the hash. */
+                    /* Validate the hash; compare in constant time. */
+                    std::vector<unsigned char> submitted;
                     if (
-                        ! boost::algorithm::iequals(
-                            results[1].str(),
-                            hash_str2
-                        )
+                        ! decode_hex(results[1].first, results[1].second,
+                                     submitted) ||
+                        submitted.size() != hash_bytes.size() ||
+                        CRYPTO_memcmp(
+                            &submitted[0], &hash_bytes[0], hash_bytes.size()
+                        ) != 0
                     )
                     {
                         ib_log_debug_tx(
                             tx.ib(),
                             "Submitted hash %.*s does not equal computed hash %.*s. No action taken.",
-                            static_cast<int>(results[1].str().length()),
-                            results[1].str().data(),
-                            static_cast<int>(hash_str2.length()),
-                            hash_str2.data()
+                            static_cast<int>(results[1].length()),
+                            results[1].first,
+                            static_cast<int>(hash_str.length()),
+                            hash_str.data()
                         );
 
                         return;
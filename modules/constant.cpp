@@ -44,6 +44,9 @@
 
 #include <boost/bind.hpp>
 
+#include <algorithm>
+#include <vector>
+
 using namespace std;
 using namespace IronBee;
 
@@ -62,6 +65,30 @@ const char* c_oracle_var = "CONSTANT";
 */
 typedef map<string, List<ConstField> > map_t;
 
+/**
+ * Sorted vector of constants.
+ *
+ * Built from a map_t when the context is closed.  Unlike the map, it can be
+ * searched for a key without copying the key into a string.
+ */
+typedef vector<pair<string, List<ConstField> > > index_t;
+
+//! Key being searched for in an index_t.
+typedef pair<const char*, size_t> lookup_key_t;
+
+//! Order index_t entries and keys.
+struct index_less
+{
+    //! True iff @a entry is before @a key.
+    bool operator()(
+        const index_t::value_type& entry,
+        const lookup_key_t&        key
+    ) const
+    {
+        return entry.first.compare(0, string::npos, key.first, key.second) < 0;
+    }
+};
+
 class Delegate;
 
 //! Per context data.
@@ -77,6 +104,16 @@ struct per_context_t
     //! Constants.  Note: Copied from parent by copy constructor.
     map_t constants;
 
+    //! Constants, sorted.  Only valid if @ref oracle is not singular.
+    index_t index;
+
+    /**
+     * Oracle field of the context, shared by its transactions.
+     *
+     * Singular until the context is closed.
+     **/
+    Field oracle;
+
     //! Delegate.  Used by external API.
     Delegate* delegate;
 };
@@ -124,6 +161,9 @@ private:
     //! Hook for context transaction event.  Setup Oracle.
     void on_context_transaction(IronBee::Transaction tx) const;
 
+    //! Hook for context close event.  Build index and oracle.
+    void on_context_close(Context context);
+
     /**
      * Get a dynamic field for accessing constants.
      *
@@ -186,6 +226,9 @@ Delegate::Delegate(IronBee::Module module) :
         .handle_context_transaction(
             boost::bind(&Delegate::on_context_transaction, this, _2)
         )
+        .context_close(
+            boost::bind(&Delegate::on_context_close, this, _2)
+        )
         ;
 
     m_oracle_source = VarSource::register_(
@@ -197,10 +240,24 @@ Delegate::Delegate(IronBee::Module module) :
 
 void Delegate::on_context_transaction(IronBee::Transaction tx) const
 {
-    m_oracle_source.set(
-        tx.var_store(),
-        oracle(tx.context(), tx.memory_manager())
+    Field context_oracle = get_per_context(tx.context()).oracle;
+
+    if (! context_oracle) {
+        context_oracle = oracle(tx.context(), tx.memory_manager());
+    }
+    m_oracle_source.set(tx.var_store(), context_oracle);
+}
+
+void Delegate::on_context_close(Context context)
+{
+    per_context_t& per_context = get_per_context(context);
+
+    // The map is already sorted.
+    per_context.index.assign(
+        per_context.constants.begin(),
+        per_context.constants.end()
     );
+    per_context.oracle = oracle(context, context.memory_manager());
 }
 
 void Delegate::set(Context context, ConstField value)
@@ -220,6 +277,20 @@ void Delegate::set(Context context, ConstField value)
     list_value = List<ConstField>::create(mm);
     list_value.push_back(value);
     constants.insert(map_t::value_type(key_s, list_value));
+
+    // Set after the context was closed.
+    per_context_t& per_context = get_per_context(context);
+    if (per_context.oracle) {
+        index_t& index = per_context.index;
+        index.insert(
+            lower_bound(
+                index.begin(), index.end(),
+                lookup_key_t(key_s.data(), key_s.length()),
+                index_less()
+            ),
+            index_t::value_type(key_s, list_value)
+        );
+    }
 }
 
 ConstField Delegate::get(ConstContext context, const char* key, size_t key_length) const
@@ -246,7 +317,25 @@ Field Delegate::oracle(Context context, MemoryManager mm) const
 
 ConstList<ConstField> Delegate::oracle_get(ConstContext context, const char* key, size_t key_length) const
 {
-    const map_t& constants = get_per_context(context).constants;
+    const per_context_t& per_context = get_per_context(context);
+
+    if (per_context.oracle) {
+        const index_t& index = per_context.index;
+        index_t::const_iterator i = lower_bound(
+            index.begin(), index.end(),
+            lookup_key_t(key, key_length),
+            index_less()
+        );
+        if (
+            i == index.end() ||
+            i->first.compare(0, string::npos, key, key_length) != 0
+        ) {
+            return m_empty_list;
+        }
+        return i->second;
+    }
+
+    const map_t& constants = per_context.constants;
     map_t::const_iterator i = constants.find(string(key, key_length));
     if (i == constants.end()) {
         return m_empty_list;
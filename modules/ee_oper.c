@@ -29,11 +29,11 @@
 
 #include <ironautomata/eudoxus.h>
 
+#include <ironbee/artifact.h>
 #include <ironbee/capture.h>
 #include <ironbee/context.h>
 #include <ironbee/engine_state.h>
 #include <ironbee/hash.h>
-#include <ironbee/mm_mpool_lite.h>
 #include <ironbee/module.h>
 #include <ironbee/operator.h>
 #include <ironbee/path.h>
@@ -41,6 +41,10 @@
 #include <ironbee/util.h>
 
 #include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 /** Module name. */
@@ -56,16 +60,19 @@ IB_MODULE_DECLARE();
 typedef struct ee_config_t ee_config_t;
 typedef struct ee_operator_data_t ee_operator_data_t;
 typedef struct ee_tx_data_t ee_tx_data_t;
+typedef struct ee_tx_t ee_tx_t;
 
 struct ee_config_t {
     /** Hash of eudoxus patterns defined via the LoadEudoxus directive. */
     ib_hash_t *eudoxus_pattern_hash;
+    /** Number of operator instances created; next instance index. */
+    size_t num_instances;
 };
 
 /* Operator instance data. */
 struct ee_operator_data_t {
-    /** Unique ID for this operator instance. */
-    char id[IB_UUID_LENGTH];
+    /** Index of this operator instance in the per-tx arrays. */
+    size_t index;
     /** Pointer to the eudoxus pattern for this instance. */
     ia_eudoxus_t *eudoxus;
 };
@@ -90,6 +97,23 @@ struct ee_tx_data_t
     bool end_of_automata;
 };
 
+/**
+ * Per-tx data of the module.
+ *
+ * Both arrays are indexed by @ref ee_operator_data_t::index.  Stream
+ * executions continue the state in @ref stream_data across calls and
+ * phases.  Non-stream executions reset the state in @ref scratch_data
+ * instead of creating one for each call.  All states are destroyed with
+ * the transaction memory.
+ */
+struct ee_tx_t
+{
+    /** Stream state of each instance; ee_tx_data_t*. */
+    ib_array_t *stream_data;
+    /** Reusable non-stream state of each instance; ee_tx_data_t*. */
+    ib_array_t *scratch_data;
+};
+
 /**
  * Access configuration data.
  *
@@ -129,131 +153,93 @@ ee_config_t *ee_get_config(
 }
 
 /**
- * Get or create an ib_hash_t inside of @c tx for storing the operator state.
- *
- * The hash is stored at the key @c HASH_NAME_STR.
+ * Destroy the eudoxus states of @a array.
  *
- * @param[in] m  This module.
- * @param[in] tx The transaction containing @c tx->data which holds
- *            the @a operator_data object.
- * @param[out] hash The fetched or created rule data hash. This is set
- *             to NULL on failure.
- *
- * @return
- *   - IB_OK on success.
- *   - IB_EALLOC on allocation failure
+ * @param[in] array Array of ee_tx_data_t*.
  */
 static
-ib_status_t get_or_create_operator_data_hash(
-    const ib_module_t  *m,
-    ib_tx_t            *tx,
-    ib_hash_t         **hash
-)
+void ee_tx_data_array_destroy(ib_array_t *array)
 {
-    assert(tx != NULL);
-
-    ib_status_t rc;
-
-    /* Get or create the hash that contains the rule data. */
-    rc = ib_tx_get_module_data(tx, m, hash);
-    if ( (rc == IB_OK) && (*hash != NULL) ) {
-        return IB_OK;
-    }
+    const ee_tx_data_t *data;
+    size_t ne;
+    size_t i;
 
-    rc = ib_hash_create(hash, tx->mm);
-    if (rc != IB_OK) {
-        return rc;
-    }
-
-    rc = ib_tx_set_module_data(tx, m, *hash);
-    if (rc != IB_OK) {
-        *hash = NULL;
+    IB_ARRAY_LOOP(array, ne, i, data) {
+        if (data != NULL && data->eudoxus_state != NULL) {
+            ia_eudoxus_destroy_state(data->eudoxus_state);
+        }
     }
-
-    return rc;
 }
 
 /**
- * Return the per-transaction state for the operator.
- *
- * @param[in] m This module.
- * @param[in,out] tx Transaction to lookup the data in.
- * @param[in] instance_data Pointer to the operator instance data.
- *                          The pointer value is used key to lookup the instance
- *                          state.
- * @param[out] tx_data Returns the tx data if found.
+ * Destroy all eudoxus states of a transaction.
  *
- * @returns
- *   - IB_OK on success.
- *   - IB_ENOENT if the state is not found. The caller should create it
- *               and add it to the hash using @ref set_ee_tx_data
+ * @param[in] cbdata The @ref ee_tx_t.
  */
 static
-ib_status_t get_ee_tx_data(
-    const ib_module_t   *m,
-    ib_tx_t             *tx,
-    ee_operator_data_t  *instance_data,
-    ee_tx_data_t       **tx_data
-)
+void ee_tx_cleanup(void *cbdata)
 {
-    assert(tx != NULL);
-    assert(instance_data != NULL);
-    assert(tx_data != NULL);
-
-    ib_hash_t *hash;
-    ib_status_t rc;
-
-    rc = get_or_create_operator_data_hash(m, tx, &hash);
-    if (rc != IB_OK) {
-        return rc;
-    }
+    assert(cbdata != NULL);
 
-    rc = ib_hash_get_ex(hash, tx_data, instance_data->id, IB_UUID_LENGTH - 1);
-    if (rc != IB_OK) {
-        *tx_data = NULL;
-    }
+    ee_tx_t *ee_tx = (ee_tx_t *)cbdata;
 
-    return rc;
+    ee_tx_data_array_destroy(ee_tx->stream_data);
+    ee_tx_data_array_destroy(ee_tx->scratch_data);
 }
 
 /**
- * Store the per-transaction data for use with the operator.
+ * Get or create the per-tx data of the module.
  *
- * @param[in] m This module.
- * @param[in,out] tx Transaction to store the data in.
- * @param[in] instance_data Pointer to the operator instance data.
- * @param[in] tx_data Data to be stored.
+ * @param[in] m  This module.
+ * @param[in] tx The transaction.
+ * @param[out] ee_tx The fetched or created data.
  *
- * @returns
+ * @return
  *   - IB_OK on success.
- *   - IB_ENOENT if the structure does not exist.
+ *   - IB_EALLOC on allocation failure
  */
 static
-ib_status_t set_ee_tx_data(
+ib_status_t get_or_create_ee_tx(
     const ib_module_t  *m,
     ib_tx_t            *tx,
-    ee_operator_data_t *instance_data,
-    ee_tx_data_t       *tx_data
+    ee_tx_t           **ee_tx
 )
 {
     assert(tx != NULL);
-    assert(instance_data != NULL);
-    assert(tx_data != NULL);
+    assert(ee_tx != NULL);
 
-    ib_hash_t *hash;
     ib_status_t rc;
+    ee_tx_t *data;
 
-    rc = get_or_create_operator_data_hash(m, tx, &hash);
+    rc = ib_tx_get_module_data(tx, m, ee_tx);
+    if ( (rc == IB_OK) && (*ee_tx != NULL) ) {
+        return IB_OK;
+    }
+
+    data = ib_mm_alloc(tx->mm, sizeof(*data));
+    if (data == NULL) {
+        return IB_EALLOC;
+    }
+    rc = ib_array_create(&(data->stream_data), tx->mm, 8, 8);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = ib_array_create(&(data->scratch_data), tx->mm, 8, 8);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = ib_mm_register_cleanup(tx->mm, ee_tx_cleanup, data);
     if (rc != IB_OK) {
         return rc;
     }
 
-    rc = ib_hash_set_ex(hash,
-                        instance_data->id,
-                        IB_UUID_LENGTH - 1,
-                        tx_data);
+    rc = ib_tx_set_module_data(tx, m, data);
+    if (rc != IB_OK) {
+        return rc;
+    }
 
-    return rc;
+    *ee_tx = data;
+    return IB_OK;
 }
 
 static void ia_eudoxus_destroy_wrapper(void *cbdata)
@@ -265,12 +251,42 @@ static void ia_eudoxus_destroy_wrapper(void *cbdata)
     ia_eudoxus_destroy(eudoxus);
 }
 
+/**
+ * Load an automata file as a shared artifact.
+ *
+ * @param[out] artifact The ia_eudoxus_t loaded.
+ * @param[in] cbdata Path of the automata file.
+ * @return
+ * - IB_OK on success.
+ * - IB_EINVAL if the file can not be loaded.
+ */
+static ib_status_t ia_eudoxus_artifact_create(void **artifact, void *cbdata)
+{
+    assert(artifact != NULL);
+    assert(cbdata != NULL);
+
+    ia_eudoxus_t *eudoxus;
+
+    if (ia_eudoxus_create_from_path(&eudoxus, (const char *)cbdata) !=
+        IA_EUDOXUS_OK)
+    {
+        return IB_EINVAL;
+    }
+
+    *artifact = eudoxus;
+
+    return IB_OK;
+}
+
 /**
  * Load a eudoxus pattern so it can be used in rules.
  *
  * The filename should point to a compiled automata. If a relative path is
  * given, it will be loaded relative to the current configuration file.
  *
+ * Automata are shared with other engines that load the same, unchanged,
+ * file; e.g., the engine being replaced by a reload.
+ *
  * @param[in] cp Configuration parser.
  * @param[in] name Directive name.
  * @param[in] pattern_name Name to associate with the pattern.
@@ -291,7 +307,9 @@ ib_status_t load_eudoxus_pattern_param2(ib_cfgparser_t *cp,
     ib_engine_t *ib;
     ib_status_t rc;
     const char *automata_file;
-    ia_eudoxus_result_t ia_rc;
+    char *artifact_key;
+    size_t key_length;
+    struct stat st;
     ib_hash_t *eudoxus_pattern_hash;
     ia_eudoxus_t *eudoxus;
     const ee_config_t* config;
@@ -330,24 +348,51 @@ ib_status_t load_eudoxus_pattern_param2(ib_cfgparser_t *cp,
         return IB_EINVAL;
     }
 
-    ia_rc = ia_eudoxus_create_from_path(&eudoxus, automata_file);
-    if (ia_rc != IA_EUDOXUS_OK) {
+    /* The file identity is part of the key so that a changed file is
+     * reloaded. */
+    if (stat(automata_file, &st) != 0) {
         ib_log_error(cp->ib,
-                     MODULE_NAME_STR ": Error loading eudoxus automata file[%d]: %s.",
-                     ia_rc, automata_file);
+                     MODULE_NAME_STR ": Error accessing eudoxus automata file: %s.",
+                     automata_file);
         return IB_EINVAL;
     }
-
-    /* Destroy this machine when the engine is destroyed. */
-    rc = ib_mm_register_cleanup(
+    key_length = snprintf(NULL, 0, "%s:%ju:%jd:%jd",
+                          automata_file,
+                          (uintmax_t)st.st_ino,
+                          (intmax_t)st.st_size,
+                          (intmax_t)st.st_mtime);
+    artifact_key = ib_mm_alloc(mm_tmp, key_length + 1);
+    if (artifact_key == NULL) {
+        return IB_EALLOC;
+    }
+    snprintf(artifact_key, key_length + 1, "%s:%ju:%jd:%jd",
+             automata_file,
+             (uintmax_t)st.st_ino,
+             (intmax_t)st.st_size,
+             (intmax_t)st.st_mtime);
+
+    /* The machine is released when the engine is destroyed. */
+    rc = ib_artifact_acquire(
+        &tmp,
         ib_engine_mm_main_get(ib),
-        ia_eudoxus_destroy_wrapper,
-        eudoxus
+        MODULE_NAME_STR ":eudoxus",
+        artifact_key,
+        key_length,
+        ia_eudoxus_artifact_create,
+        (void *)automata_file,
+        ia_eudoxus_destroy_wrapper
     );
-    if (rc != IB_OK) {
-        ib_log_error(cp->ib, "Failed to register eudoxus cleanup function.");
+    if (rc == IB_EALLOC) {
+        ib_log_error(cp->ib, "Failed to allocate eudoxus automata.");
         return rc;
     }
+    if (rc != IB_OK) {
+        ib_log_error(cp->ib,
+                     MODULE_NAME_STR ": Error loading eudoxus automata file: %s.",
+                     automata_file);
+        return IB_EINVAL;
+    }
+    eudoxus = (ia_eudoxus_t *)tmp;
 
     rc = ib_hash_set(eudoxus_pattern_hash, pattern_name, eudoxus);
     if (rc != IB_OK) {
@@ -434,6 +479,87 @@ ia_eudoxus_command_t ee_first_match_callback(ia_eudoxus_t* engine,
     return IA_EUDOXUS_CMD_STOP;
 }
 
+/**
+ * Return the state of an operator instance in @a array.
+ *
+ * If there is none yet, a state is created and stored.  @a *created tells
+ * the caller whether it has to reset a reused state.
+ *
+ * @param[in] tx Transaction.
+ * @param[in] array The @ref ee_tx_t array to use.
+ * @param[in] operator_data Operator instance.
+ * @param[in] capture Capture collection for the callback data of a new
+ *                    state.
+ * @param[out] tx_data The state.
+ * @param[out] created True if the state was created by this call.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ *   - IB_EINVAL if the state could not be created.
+ */
+static
+ib_status_t get_or_create_ee_tx_data(
+    ib_tx_t             *tx,
+    ib_array_t          *array,
+    ee_operator_data_t  *operator_data,
+    ib_field_t          *capture,
+    ee_tx_data_t       **tx_data,
+    bool                *created
+
+)
+{
+    assert(tx != NULL);
+    assert(array != NULL);
+    assert(operator_data != NULL);
+    assert(tx_data != NULL);
+    assert(created != NULL);
+
+    ib_status_t rc;
+    ia_eudoxus_result_t ia_rc;
+    ee_tx_data_t *data = NULL;
+    ee_callback_data_t *ee_cbdata;
+
+    rc = ib_array_get(array, operator_data->index, &data);
+    if (rc == IB_OK && data != NULL) {
+        *tx_data = data;
+        *created = false;
+        return IB_OK;
+    }
+
+    data = ib_mm_alloc(tx->mm, sizeof(*data));
+    ee_cbdata = ib_mm_alloc(tx->mm, sizeof(*ee_cbdata));
+    if (data == NULL || ee_cbdata == NULL) {
+        return IB_EALLOC;
+    }
+    ee_cbdata->tx = tx;
+    ee_cbdata->capture = capture;
+    ee_cbdata->match_len = 0;
+    data->ee_cbdata = ee_cbdata;
+    data->end_of_automata = false;
+
+    ia_rc = ia_eudoxus_create_state(&data->eudoxus_state,
+                                    operator_data->eudoxus,
+                                    ee_first_match_callback,
+                                    (void *)ee_cbdata);
+    if (ia_rc != IA_EUDOXUS_OK) {
+        if (data->eudoxus_state != NULL) {
+            ia_eudoxus_destroy_state(data->eudoxus_state);
+        }
+        return IB_EINVAL;
+    }
+
+    rc = ib_array_setn(array, operator_data->index, data);
+    if (rc != IB_OK) {
+        ia_eudoxus_destroy_state(data->eudoxus_state);
+        return rc;
+    }
+
+    *tx_data = data;
+    *created = true;
+    return IB_OK;
+}
+
 /**
  * Create an instance of the @c ee operator.
  *
@@ -463,7 +589,7 @@ ib_status_t ee_operator_create(
     ee_operator_data_t *operator_data;
     ib_module_t *module;
     ib_engine_t *ib = ib_context_get_engine(ctx);
-    const ee_config_t *config = ee_get_config(ib);
+    ee_config_t *config = ee_get_config(ib);
     const ib_hash_t *eudoxus_pattern_hash;
 
     assert(config != NULL);
@@ -498,12 +624,7 @@ ib_status_t ee_operator_create(
     }
 
     operator_data->eudoxus = eudoxus;
-    rc = ib_uuid_create_v4(operator_data->id);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-                     MODULE_NAME_STR ": Failed to setup eudoxus automata operator id.");
-        return rc;
-    }
+    operator_data->index = config->num_instances++;
 
     *(ee_operator_data_t **)instance_data = operator_data;
 
@@ -642,38 +763,43 @@ ib_status_t ee_match_operator_execute_nonstream(
     ib_status_t rc;
     ia_eudoxus_result_t ia_rc;
     ee_operator_data_t *operator_data = instance_data;
-    ia_eudoxus_t* eudoxus = operator_data->eudoxus;
+    const ib_module_t *m = (const ib_module_t *)cbdata;
+    ee_tx_t *ee_tx;
+    ee_tx_data_t *data;
+    bool created;
 
+    assert(m != NULL);
     assert(tx != NULL);
     assert(instance_data != NULL);
 
     *result = 0;
 
-    /* Not streaming, so create data for this use only */
-    ee_callback_data_t local_cbdata = { tx, capture, 0 };
-    ee_tx_data_t local_data;
-    local_data.ee_cbdata = &local_cbdata;
-
-    ia_rc = ia_eudoxus_create_state(&local_data.eudoxus_state,
-                                    eudoxus,
-                                    ee_first_match_callback,
-                                    (void *)&local_cbdata);
-    if (ia_rc != IA_EUDOXUS_OK) {
-        if (local_data.eudoxus_state != NULL) {
-            ia_eudoxus_destroy_state(local_data.eudoxus_state);
+    /* Not streaming, so start from the start state each time.  The state
+     * of an earlier execution in this transaction, in this or an earlier
+     * phase, is reset rather than a new one created. */
+    rc = get_or_create_ee_tx(m, tx, &ee_tx);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = get_or_create_ee_tx_data(
+        tx, ee_tx->scratch_data, operator_data, capture, &data, &created
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+    if (! created) {
+        data->ee_cbdata->capture = capture;
+        data->ee_cbdata->match_len = 0;
+        data->end_of_automata = false;
+        ia_rc = ia_eudoxus_reset_state(data->eudoxus_state);
+        if (ia_rc != IA_EUDOXUS_OK) {
+            return IB_EINVAL;
         }
-        return IB_EINVAL;
     }
-    local_data.end_of_automata = false;
-
 
-    rc = ee_operator_execute_common(
-        tx, operator_data, &local_data, field, full_match, result
+    return ee_operator_execute_common(
+        tx, operator_data, data, field, full_match, result
     );
-
-    ia_eudoxus_destroy_state(local_data.eudoxus_state);
-
-    return rc;
 }
 
 /**
@@ -760,12 +886,11 @@ ib_status_t ee_operator_execute_stream(
 )
 {
     ib_status_t rc;
-    ia_eudoxus_result_t ia_rc;
     ee_operator_data_t *operator_data = instance_data;
-    ia_eudoxus_t* eudoxus = operator_data->eudoxus;
-    ee_tx_data_t* data = NULL;
-    ee_callback_data_t *ee_cbdata;
     const ib_module_t *m = (const ib_module_t *)cbdata;
+    ee_tx_t *ee_tx;
+    ee_tx_data_t *data;
+    bool created;
 
     assert(m != NULL);
     assert(tx != NULL);
@@ -774,107 +899,22 @@ ib_status_t ee_operator_execute_stream(
     *result = 0;
 
     /* Persist data. */
-    rc = get_ee_tx_data(m, tx, operator_data, &data);
-    if (rc == IB_ENOENT) {
-        /* Data not found create it */
-        data = ib_mm_alloc(tx->mm, sizeof(*data));
-        ee_cbdata = ib_mm_alloc(tx->mm, sizeof(*ee_cbdata));
-        if (ee_cbdata == NULL) {
-            return IB_EALLOC;
-        }
-        ee_cbdata->tx = tx;
-        ee_cbdata->capture = capture;
-        data->ee_cbdata = ee_cbdata;
-
-        ia_rc = ia_eudoxus_create_state(&data->eudoxus_state,
-                                        eudoxus,
-                                        ee_first_match_callback,
-                                        (void *)ee_cbdata);
-        if (ia_rc != IA_EUDOXUS_OK) {
-            if (data->eudoxus_state != NULL) {
-                ia_eudoxus_destroy_state(data->eudoxus_state);
-                data->eudoxus_state = NULL;
-            }
-            return IB_EINVAL;
-        }
-        data->end_of_automata = false;
-        set_ee_tx_data(m, tx, operator_data, data);
-    }
-    else if (rc != IB_OK) {
-        /* Error getting the state -- abort */
+    rc = get_or_create_ee_tx(m, tx, &ee_tx);
+    if (rc != IB_OK) {
         return rc;
     }
-
-    return ee_operator_execute_common(
-        tx, operator_data, data, field, false, result
+    rc = get_or_create_ee_tx_data(
+        tx, ee_tx->stream_data, operator_data, capture, &data, &created
     );
-}
-
-/**
- * Destroy the eudoxus state when the transaction is complete.
- *
- * After the transaction is complete iterate over all of the states create
- * during the transaction and destroy them.
- *
- * @param[in] ib IronBee engine.
- * @param[in] tx Current transaction.
- * @param[in] state State (should always be @ref tx_finished_state)
- * @param[in] cbdata Callback data -- pointer to this module (@ref ib_module_t).
- *
- * @returns IB_OK on success.
- */
-static
-ib_status_t ee_tx_finished_handler(ib_engine_t *ib,
-                                   ib_tx_t *tx,
-                                   ib_state_t state,
-                                   void *cbdata)
-{
-    ib_status_t rc;
-    ib_hash_t *hash;
-    ib_mpool_lite_t* mpl;
-    ib_mm_t mm;
-    const ib_module_t *m = (const ib_module_t *)cbdata;
-    ee_tx_data_t *data;
-    ib_hash_iterator_t *iterator;
-
-    rc = ib_tx_get_module_data(tx, m, &hash);
-    if (rc == IB_ENOENT) {
-        /* Nothing to do. */
-        return IB_OK;
-    }
-    if (rc != IB_OK || hash == NULL) {
-        return rc;
-    }
-
-    rc = ib_mpool_lite_create(&mpl);
     if (rc != IB_OK) {
         return rc;
     }
-    mm = ib_mm_mpool_lite(mpl);
-
-    iterator = ib_hash_iterator_create(mm);
-    if (iterator == NULL) {
-        ib_mpool_lite_destroy(mpl);
-        return IB_EALLOC;
-    }
-    for (
-        ib_hash_iterator_first(iterator, hash);
-        ! ib_hash_iterator_at_end(iterator);
-        ib_hash_iterator_next(iterator)
-    ) {
-        ib_hash_iterator_fetch(NULL, NULL, &data, iterator);
-        if (data->eudoxus_state != NULL) {
-            ia_eudoxus_destroy_state(data->eudoxus_state);
-            data->eudoxus_state = NULL;
-        }
-    }
-
-    ib_mpool_lite_destroy(mpl);
 
-    return IB_OK;
+    return ee_operator_execute_common(
+        tx, operator_data, data, field, false, result
+    );
 }
 
-
 /**
  * Initialize the eudoxus operator module.
  *
@@ -925,7 +965,7 @@ ib_status_t ee_module_init(ib_engine_t *ib,
         NULL,
         ib,
         "ee",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_STREAM ),
         &ee_operator_create, NULL,
         NULL, NULL,
         &ee_operator_execute_stream, m
@@ -955,19 +995,6 @@ ib_status_t ee_module_init(ib_engine_t *ib,
         return rc;
     }
 
-    rc = ib_hook_tx_register(ib,
-                             tx_finished_state,
-                             ee_tx_finished_handler,
-                             m);
-
-    if (rc != IB_OK) {
-        ib_log_error(
-            ib,
-            "Error registering transaction finished state for ee operator: %s",
-            ib_status_to_string(rc));
-        return rc;
-    }
-
     return IB_OK;
 }
 
@@ -994,7 +1021,7 @@ ib_status_t ee_module_finish(ib_engine_t *ib,
  * This static will *only* be passed to IronBee as part of module
  * definition.  It will never be read or written by any code in this file.
  */
-static ee_config_t g_ee_config = {NULL};
+static ee_config_t g_ee_config = {NULL, 0};
 
 #ifndef DOXYGEN_SKIP
 static IB_DIRMAP_INIT_STRUCTURE(eudoxus_directive_map) = {
@@ -45,14 +45,17 @@
 #pragma clang diagnostic ignored "-Wunused-local-typedef"
 #endif
 #endif
-#include <boost/algorithm/string/replace.hpp>
 #include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <boost/function.hpp>
 #include <boost/iostreams/device/mapped_file.hpp>
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
 
+#include <algorithm>
+#include <vector>
+
 #if defined(__cplusplus) && !defined(__STDC_FORMAT_MACROS)
 /* C99 requires that inttypes.h only exposes PRI* macros
  * for C++ implementations if this is defined: */
@@ -110,6 +113,25 @@ IBPP_BOOTSTRAP_MODULE_DELEGATE("ErrorPageModule", ErrorPageModule);
  */
 typedef std::map<ib_num_t, std::string> status_to_file_map_t;
 
+/**
+ * An error page prepared at configuration time.
+ *
+ * The page is split at each transaction id placeholder once, so building
+ * the response for a transaction is a single allocation and copy.  A page
+ * without placeholders is handed to the server as is.
+ */
+struct ErrorPage {
+    /**
+     * The memory mapped file.
+     */
+    boost::iostreams::mapped_file_source source;
+
+    /**
+     * Offsets of the placeholders in @ref source.
+     */
+    std::vector<size_t> placeholders;
+};
+
 /**
  * Context configuration value for the ErrorPageModule.
  */
@@ -121,12 +143,25 @@ struct ErrorPageCtxConfig {
     status_to_file_map_t status_to_file;
 
     /**
-     * The mapping from an HTTP status code to the memory mapped file.
+     * The mapping from an HTTP status code to the prepared page.
      */
-    std::map<ib_num_t, boost::iostreams::mapped_file_source>
-        status_to_mapped_file_source;
+    std::map<ib_num_t, ErrorPage> status_to_page;
 };
 
+namespace {
+
+/**
+ * The text replaced by the transaction id.
+ */
+const char c_placeholder[] = "${TRANSACTION_ID}";
+
+/**
+ * Length of @ref c_placeholder.
+ */
+const size_t c_placeholder_length = sizeof(c_placeholder) - 1;
+
+}
+
 /* Implementation */
 
 ErrorPageModule::ErrorPageModule(IronBee::Module module):
@@ -170,8 +205,9 @@ void ErrorPageModule::errorPageMapDirective(
         param2
     );
 
+    ErrorPage page;
     try {
-        cfg.status_to_mapped_file_source[num] =
+        page.source =
             boost::iostreams::mapped_file_source(cfg.status_to_file[num]);
     }
     catch (const std::exception& e) {
@@ -179,6 +215,24 @@ void ErrorPageModule::errorPageMapDirective(
             IronBee::enoent()
                 << IronBee::errinfo_what(e.what()));
     }
+
+    const char *begin = page.source.data();
+    const char *end = begin + page.source.size();
+    for (
+        const char *p = std::search(
+            begin, end, c_placeholder, c_placeholder + c_placeholder_length
+        );
+        p != end;
+        p = std::search(
+            p + c_placeholder_length, end,
+            c_placeholder, c_placeholder + c_placeholder_length
+        )
+    )
+    {
+        page.placeholders.push_back(p - begin);
+    }
+
+    cfg.status_to_page[num] = page;
 }
 
 void ErrorPageModule::post_block(
@@ -207,34 +261,10 @@ void ErrorPageModule::post_block(
 #ifndef NDEBUG
     const std::string& file = itr->second;
 #endif
-    const boost::iostreams::mapped_file_source &source =
-        cfg.status_to_mapped_file_source[info.status];
-
-    /* The error page to be handed to the server is written to this
-     * output string stream. */
-    std::ostringstream error_page_output_stream;
-
-    /* Optimization: Reserve the document size + 37 characters for a UUID.
-     * We assume that the transaction ID is only replaced once. */
-    error_page_output_stream.str().reserve(source.size() + 37);
-
-    /* Replace holder text with transaction id. */
-    boost::algorithm::replace_all_copy(
-        /* Output iterator. */
-        std::ostream_iterator<char>(error_page_output_stream),
-
-        /* The range. */
-        std::pair<const char *, const char *>(
-            source.data(),
-            source.data()+ source.size()
-        ),
-
-        /* The text to replace. */
-        "${TRANSACTION_ID}",
-
-        /* What to replace the text with. */
-        tx.id()
-    );
+    const ErrorPage &page = cfg.status_to_page.find(info.status)->second;
+    const char *data = page.source.data();
+    size_t size = page.source.size();
+    IronBee::ByteString body;
 
 #ifndef NDEBUG
     ib_log_debug2_tx(
@@ -245,11 +275,36 @@ void ErrorPageModule::post_block(
     );
 #endif
 
-    IronBee::ByteString body = IronBee::ByteString::create(
-        tx.memory_manager(),
-        error_page_output_stream.str().data(),
-        error_page_output_stream.str().size()
-    );
+    if (page.placeholders.empty()) {
+        body = IronBee::ByteString::create_alias(
+            tx.memory_manager(), data, size
+        );
+    }
+    else {
+        /* Copy the text between the placeholders and the transaction id
+         * in their place into a single buffer. */
+        size_t id_length = strlen(tx.id());
+        size_t length =
+            size +
+            page.placeholders.size() * id_length -
+            page.placeholders.size() * c_placeholder_length;
+        char *buffer =
+            static_cast<char *>(tx.memory_manager().alloc(length));
+        char *out = buffer;
+        size_t offset = 0;
+
+        BOOST_FOREACH(size_t placeholder, page.placeholders) {
+            out = std::copy(data + offset, data + placeholder, out);
+            out = std::copy(tx.id(), tx.id() + id_length, out);
+            offset = placeholder + c_placeholder_length;
+        }
+        out = std::copy(data + offset, data + size, out);
+        assert(out == buffer + length);
+
+        body = IronBee::ByteString::create_alias(
+            tx.memory_manager(), buffer, length
+        );
+    }
 
     ib_status_t rc = ib_tx_response(tx.ib(), info.status, NULL, body.ib());
     if ((rc == IB_DECLINED) || (rc == IB_ENOTIMPL)) {
@@ -21,17 +21,20 @@
  *
  * This module adds support for fast rules.  See fast/fast.html for details.
  *
- * Provides a single directive:
+ * Provides two directives:
  * @code
  * FastAutomata <path>
+ * FastGenerate on|off
  * @endcode
  *
- * @c FastAutomata must occur in the main context and at most once in
- * configuration.  It loads the specified automata and enables the fast rule
- * subsystem.  The loaded automata must be consistent with the fast rules in
- * the configuration.  This consistency is usually achieved by feeding the
- * rules into a set of scripts which creates the automata (see
- * fast/fast.html).
+ * One of them must occur in the main context and at most once in
+ * configuration.  @c FastAutomata loads the specified automata and enables
+ * the fast rule subsystem.  The loaded automata must be consistent with the
+ * fast rules in the configuration.  This consistency is usually achieved by
+ * feeding the rules into a set of scripts which creates the automata (see
+ * fast/fast.html).  @c FastGenerate instead enables the fast rule subsystem
+ * with an automata generated from the fast modifiers of the rules when the
+ * main context closes (see fast_generate()).  It requires C++ support.
  *
  * In general, @c EOTHER is used to indicate IronBee related failures and
  * @c EINVAL is used to indicate IronAutomata related failures.
@@ -42,6 +45,8 @@
  * @author Christopher Alfeld <calfeld@qualys.com>
  */
 
+#include "fast_private.h"
+
 #include <ironautomata/eudoxus.h>
 
 #include <ironbee/cfgmap.h>
@@ -68,6 +73,7 @@ IB_MODULE_DECLARE();
 typedef struct fast_runtime_t                 fast_runtime_t;
 typedef struct fast_config_t                  fast_config_t;
 typedef struct fast_search_t                  fast_search_t;
+typedef struct fast_feeder_t                  fast_feeder_t;
 typedef struct fast_collection_spec_t         fast_collection_spec_t;
 typedef struct fast_collection_runtime_spec_t fast_collection_runtime_spec_t;
 typedef struct fast_specs_t                   fast_specs_t;
@@ -86,6 +92,18 @@ struct fast_runtime_t
     /** Rule index: pointers to rules based on automata outputs. */
     const ib_rule_t **index;
 
+    /** Number of entries in @ref index. */
+    uint32_t index_size;
+
+    /**
+     * Patterns (@ref fast_pattern_t) of claimed rules if the automata is
+     * generated (@c FastGenerate); NULL if it is loaded (@c FastAutomata).
+     */
+    ib_list_t *patterns;
+
+    /** Allocated entries of @ref index if generating. */
+    uint32_t index_capacity;
+
     /** Hash of id (@c const @c char *) to index (@c uint32_t *) */
     ib_hash_t *by_id;
 
@@ -108,8 +126,11 @@ struct fast_config_t
 /**
  * Search state.
  *
- * This structure holds the data used during a search of the automata.  In
- * particular it is the callback data of the function passed to
+ * This structure holds the automata execution of a transaction.  A single
+ * execution is shared by every phase: each phase feeds its data to the same
+ * state and the indices found are recorded for the entire transaction.  At
+ * each phase, the rules of that phase are injected from all indices found
+ * so far.  It is the callback data of the function passed to
  * ia_eudoxus_execute().
  */
 struct fast_search_t
@@ -117,17 +138,43 @@ struct fast_search_t
     /** Runtime data. */
     const fast_runtime_t *runtime;
 
-    /** Rule execution context. */
-    const ib_rule_exec_t *rule_exec;
+    /** Automata execution state. */
+    ia_eudoxus_state_t *state;
+
+    /** Bit per index of runtime; set if found. */
+    uint8_t *found;
+
+    /** Outputs found (@c const @c char *), each once, in order found. */
+    ib_list_t *outputs;
+};
+
+/** Size of buffer used to combine data before feeding it to the automata. */
+#define FAST_FEED_BUFFER_SIZE 4096
 
-    /** Rules eligible to be added. */
-    const ib_hash_t *rules;
+/**
+ * Feeder.
+ *
+ * Data fed to the automata is combined in @ref buffer so that the many small
+ * pieces of a phase, e.g., the names, separators, and values of a
+ * collection, are executed together instead of one call to
+ * ia_eudoxus_execute() each.
+ */
+struct fast_feeder_t
+{
+    /** IronBee engine; used for logging. */
+    const ib_engine_t *ib;
 
-    /** List to add eligible rules to. */
-    ib_list_t *rule_list;
+    /** Eudoxus engine; used for ia_eudoxus_error(). */
+    const ia_eudoxus_t *eudoxus;
 
-    /** Rules already added by pointer.  No data. */
-    ib_hash_t *rule_set;
+    /** Eudoxus execution state. */
+    ia_eudoxus_state_t *state;
+
+    /** Length of data in @ref buffer. */
+    size_t length;
+
+    /** Data not yet executed. */
+    uint8_t buffer[FAST_FEED_BUFFER_SIZE];
 };
 
 /* Configuration */
@@ -319,11 +366,9 @@ const fast_config_t *fast_get_config_module(
 }
 
 /**
- * Feed data to the automata.
+ * Execute data in the automata.
  *
- * @param[in] ib          IronBee engine; used for logging.
- * @param[in] eudoxus     Eudoxus engine; used for ia_eudoxus_error().
- * @param[in] state       Current Eudoxus execution state; updated.
+ * @param[in] feeder      Feeder; state is updated.
  * @param[in] data        Data to send to automata.
  * @param[in] data_length Length of @a data.
  * @return
@@ -331,27 +376,26 @@ const fast_config_t *fast_get_config_module(
  * - IB_EINVAL on IronAutomata failure; will emit log message.
  */
 static
-ib_status_t fast_feed(
-    const ib_engine_t  *ib,
-    const ia_eudoxus_t *eudoxus,
-    ia_eudoxus_state_t *state,
-    const uint8_t      *data,
-    size_t              data_length
+ib_status_t fast_execute(
+    fast_feeder_t *feeder,
+    const uint8_t *data,
+    size_t         data_length
 )
 {
-    assert(ib      != NULL);
-    assert(eudoxus != NULL);
-    assert(state   != NULL);
-    assert(data    != NULL);
+    assert(feeder          != NULL);
+    assert(feeder->ib      != NULL);
+    assert(feeder->eudoxus != NULL);
+    assert(feeder->state   != NULL);
+    assert(data            != NULL);
 
     ia_eudoxus_result_t irc;
 
-    irc = ia_eudoxus_execute(state, data, data_length);
+    irc = ia_eudoxus_execute(feeder->state, data, data_length);
     if (irc != IA_EUDOXUS_OK) {
         ib_log_error(
-            ib,
+            feeder->ib,
             "fast: Error executing eudoxus: %s",
-            fast_eudoxus_error(eudoxus)
+            fast_eudoxus_error(feeder->eudoxus)
         );
         return IB_EINVAL;
     }
@@ -359,13 +403,80 @@ ib_status_t fast_feed(
     return IB_OK;
 }
 
+/**
+ * Execute any data buffered in @a feeder.
+ *
+ * @param[in] feeder Feeder; buffer is emptied.
+ * @return
+ * - IB_OK on success.
+ * - IB_EINVAL on IronAutomata failure; will emit log message.
+ */
+static
+ib_status_t fast_feed_flush(
+    fast_feeder_t *feeder
+)
+{
+    assert(feeder != NULL);
+
+    ib_status_t rc;
+
+    if (feeder->length == 0) {
+        return IB_OK;
+    }
+
+    rc = fast_execute(feeder, feeder->buffer, feeder->length);
+    feeder->length = 0;
+
+    return rc;
+}
+
+/**
+ * Feed data to the automata.
+ *
+ * Data is buffered and executed when the buffer is full or when
+ * fast_feed_flush() is called.  Data larger than the buffer is executed
+ * directly.
+ *
+ * @param[in] feeder      Feeder; updated.
+ * @param[in] data        Data to send to automata.
+ * @param[in] data_length Length of @a data.
+ * @return
+ * - IB_OK on success.
+ * - IB_EINVAL on IronAutomata failure; will emit log message.
+ */
+static
+ib_status_t fast_feed(
+    fast_feeder_t *feeder,
+    const uint8_t *data,
+    size_t         data_length
+)
+{
+    assert(feeder != NULL);
+    assert(data   != NULL);
+
+    ib_status_t rc;
+
+    if (feeder->length + data_length > sizeof(feeder->buffer)) {
+        rc = fast_feed_flush(feeder);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    if (data_length >= sizeof(feeder->buffer)) {
+        return fast_execute(feeder, data, data_length);
+    }
+
+    memcpy(feeder->buffer + feeder->length, data, data_length);
+    feeder->length += data_length;
+
+    return IB_OK;
+}
+
 /**
  * Feed a byte string from an @ref ib_var_store_t to the automata.
  *
- * @param[in] ib                IronBee engine; used for logging.
- * @param[in] eudoxus           Eudoxus engine; used for
- *                              ia_eudoxus_error().
- * @param[in] state             Current Eudoxus execution state; updated.
+ * @param[in] feeder            Feeder; updated.
  * @param[in] var_store         Var store.
  * @param[in] bytestring_source Source of bytestring.
  * @return
@@ -374,19 +485,16 @@ ib_status_t fast_feed(
  * - IB_EOTHER on IronBee failure; will emit log message.
  */
 static ib_status_t fast_feed_var_bytestring(
-    const ib_engine_t     *ib,
-    const ia_eudoxus_t    *eudoxus,
-    ia_eudoxus_state_t    *state,
+    fast_feeder_t         *feeder,
     const ib_var_store_t  *var_store,
     const ib_var_source_t *bytestring_source
 )
 {
-    assert(ib                != NULL);
-    assert(eudoxus           != NULL);
-    assert(state             != NULL);
+    assert(feeder            != NULL);
     assert(var_store         != NULL);
     assert(bytestring_source != NULL);
 
+    const ib_engine_t  *ib = feeder->ib;
     const ib_field_t   *field;
     const ib_bytestr_t *bs;
     ib_status_t         rc;
@@ -433,9 +541,7 @@ static ib_status_t fast_feed_var_bytestring(
         return IB_OK;
     }
     return fast_feed(
-        ib,
-        eudoxus,
-        state,
+        feeder,
         ib_bytestr_const_ptr(bs), ib_bytestr_size(bs)
     );
 }
@@ -443,9 +549,7 @@ static ib_status_t fast_feed_var_bytestring(
 /**
  * Feed a collection of byte strings from an @ref ib_var_store_t to automata.
  *
- * @param[in] ib          IronBee engine; used for logging.
- * @param[in] eudoxus     Eudoxus engine; used for ia_eudoxus_error().
- * @param[in] state       Current Eudoxus execution state; updated.
+ * @param[in] feeder      Feeder; updated.
  * @param[in] var_store   Var store.
  * @param[in] collection  Collection to feed.
  * @return
@@ -455,19 +559,16 @@ static ib_status_t fast_feed_var_bytestring(
  */
 static
 ib_status_t fast_feed_var_collection(
-    const ib_engine_t                    *ib,
-    const ia_eudoxus_t                   *eudoxus,
-    ia_eudoxus_state_t                   *state,
+    fast_feeder_t                        *feeder,
     const ib_var_store_t                 *var_store,
     const fast_collection_runtime_spec_t *collection
 )
 {
-    assert(ib         != NULL);
-    assert(eudoxus    != NULL);
-    assert(state      != NULL);
+    assert(feeder     != NULL);
     assert(var_store  != NULL);
     assert(collection != NULL);
 
+    const ib_engine_t    *ib = feeder->ib;
     const ib_field_t     *field;
     const ib_list_t      *subfields;
     const ib_list_node_t *node;
@@ -530,9 +631,7 @@ ib_status_t fast_feed_var_collection(
         }
 
         rc = fast_feed(
-            ib,
-            eudoxus,
-            state,
+            feeder,
             (const uint8_t *)subfield->name,
             subfield->nlen
         );
@@ -541,9 +640,7 @@ ib_status_t fast_feed_var_collection(
         }
 
         rc = fast_feed(
-            ib,
-            eudoxus,
-            state,
+            feeder,
             (const uint8_t *)collection->separator,
             strlen(collection->separator)
         );
@@ -553,9 +650,7 @@ ib_status_t fast_feed_var_collection(
 
         if (ib_bytestr_const_ptr(bs) != NULL && ib_bytestr_size(bs) > 0) {
             rc = fast_feed(
-                ib,
-                eudoxus,
-                state,
+                feeder,
                 ib_bytestr_const_ptr(bs),
                 ib_bytestr_size(bs)
             );
@@ -565,9 +660,7 @@ ib_status_t fast_feed_var_collection(
         }
 
         rc = fast_feed(
-            ib,
-            eudoxus,
-            state,
+            feeder,
             (const uint8_t *)c_data_separator,
             strlen(c_data_separator)
         );
@@ -585,11 +678,10 @@ ib_status_t fast_feed_var_collection(
  * Pull and feed the specified bytestrings and collections to an automata.
  * This function is similar to fast_rule_injection() but requires an already
  * functioning automata execution.  It can be combined with other feed
- * functions.
+ * functions.  Data may remain buffered in @a feeder; use fast_feed_flush()
+ * to execute it.
  *
- * @param[in] ib          IronBee engine.
- * @param[in] eudoxus     Eudoxus engine.
- * @param[in] state       Eudoxus execution state; updated.
+ * @param[in] feeder      Feeder; updated.
  * @param[in] var_store   Var store.
  * @param[in] bytestrings Bytestrings to feed.
  * @param[in] collections Collections to feed.
@@ -600,17 +692,13 @@ ib_status_t fast_feed_var_collection(
  */
 static
 ib_status_t fast_feed_phase(
-    const ib_engine_t                     *ib,
-    const ia_eudoxus_t                    *eudoxus,
-    ia_eudoxus_state_t                    *state,
+    fast_feeder_t                         *feeder,
     const ib_var_store_t                  *var_store,
     const ib_var_source_t                **bytestrings,
     const fast_collection_runtime_spec_t  *collections
 )
 {
-    assert(ib          != NULL);
-    assert(eudoxus     != NULL);
-    assert(state       != NULL);
+    assert(feeder      != NULL);
     assert(var_store   != NULL);
     assert(bytestrings != NULL);
     assert(collections != NULL);
@@ -625,9 +713,7 @@ ib_status_t fast_feed_phase(
         ++bytestring_source
     ) {
         rc = fast_feed_var_bytestring(
-            ib,
-            eudoxus,
-            state,
+            feeder,
             var_store,
             *bytestring_source
         );
@@ -635,9 +721,7 @@ ib_status_t fast_feed_phase(
             return rc;
         }
         rc = fast_feed(
-            ib,
-            eudoxus,
-            state,
+            feeder,
             (const uint8_t *)c_bytestring_separator,
             strlen(c_bytestring_separator)
         );
@@ -647,9 +731,7 @@ ib_status_t fast_feed_phase(
     }
 
     rc = fast_feed(
-        ib,
-        eudoxus,
-        state,
+        feeder,
         (uint8_t *)c_data_separator,
         strlen(c_data_separator)
     );
@@ -663,9 +745,7 @@ ib_status_t fast_feed_phase(
         ++collection
     ) {
         rc = fast_feed_var_collection(
-            ib,
-            eudoxus,
-            state,
+            feeder,
             var_store,
             collection
         );
@@ -884,7 +964,11 @@ ib_status_t fast_convert_specs(
 /* Callbacks */
 
 /**
- * Called by Eudoxus when automata finds an eligible rule.
+ * Called by Eudoxus when automata finds an index.
+ *
+ * Records the output if its index has not been found before in the
+ * transaction.  Rules are selected from the recorded outputs by
+ * fast_rule_injection().
  *
  * @param[in] eudoxus        Eudoxus engine; used to record errors.
  * @param[in] output         Eudoxus output; @c uint32_t of index location.
@@ -910,14 +994,12 @@ ia_eudoxus_command_t fast_eudoxus_callback(
 
     fast_search_t *search = (fast_search_t *)callback_data;
 
-    assert(search->runtime   != NULL);
-    assert(search->rule_exec != NULL);
-    assert(search->rule_list != NULL);
-    assert(search->rule_set  != NULL);
+    assert(search->runtime != NULL);
+    assert(search->found   != NULL);
+    assert(search->outputs != NULL);
 
-    uint32_t         index;
-    const ib_rule_t *rule;
-    ib_status_t      rc;
+    uint32_t    index;
+    ib_status_t rc;
 
     /* Error instead of assert as automata may be invalid. */
     if (output_length != sizeof(uint32_t)) {
@@ -931,84 +1013,145 @@ ia_eudoxus_command_t fast_eudoxus_callback(
     }
 
     memcpy(&index, output, sizeof(index));
-    rule = search->runtime->index[index];
-
-    if (rule == NULL) {
-        /* Rule is in automata but not claimed.  This can occur when fast
-         * rules are present but enabled anywhere.
-         */
-        return IA_EUDOXUS_CMD_CONTINUE;
+    if (index >= search->runtime->index_size) {
+        ia_eudoxus_set_error_printf(
+            eudoxus,
+            "Invalid automata; index out of range; size = %d actual = %d.",
+            search->runtime->index_size,
+            index
+        );
+        return IA_EUDOXUS_CMD_ERROR;
     }
 
-    /* Check phase. */
-    if (rule->meta.phase != search->rule_exec->phase) {
+    /* Check/mark if already found. */
+    if ((search->found[index / 8] & (1 << (index % 8))) != 0) {
         return IA_EUDOXUS_CMD_CONTINUE;
     }
+    search->found[index / 8] |= (1 << (index % 8));
 
-    /* Check context, i.e., is in eligible rules */
-    rc = ib_hash_get_ex(
-        search->rules,
-        NULL,
-        output,
-        output_length
-    );
-    if (rc == IB_ENOENT) {
-        return IA_EUDOXUS_CMD_CONTINUE;
-    }
-    else if (rc != IB_OK) {
-        ib_log_error(
-            search->rule_exec->ib,
-            "Unexpected return code from eligible rules check: %s",
+    /* Output is in the automata and lives as long as it does. */
+    rc = ib_list_push(search->outputs, (void *)output);
+    if (rc != IB_OK) {
+        ia_eudoxus_set_error_printf(
+            eudoxus,
+            "Error pushing output onto output list: %s",
             ib_status_to_string(rc)
         );
         return IA_EUDOXUS_CMD_ERROR;
     }
 
-    /* Check/mark if already added. */
-    {
-        void *dummy_value;
-        rc = ib_hash_get_ex(
-            search->rule_set,
-            &dummy_value,
-            output,
-            output_length
-        );
-        if (rc == IB_OK) {
-            /* Rule already added. */
-            return IA_EUDOXUS_CMD_CONTINUE;
+    return IA_EUDOXUS_CMD_CONTINUE;
+}
+
+/**
+ * Add a rule and its fast patterns to a runtime that generates its automata.
+ *
+ * @param[in]  ib      IronBee engine.
+ * @param[in]  runtime Runtime; index, by_id, and patterns are updated.
+ * @param[in]  rule    Rule to add.
+ * @param[in]  actions Fast actions (@c ib_action_inst_t) of @a rule.
+ * @param[out] index   Index of @a rule.
+ * @return
+ * - IB_OK on success.
+ * - IB_EINVAL if a fast modifier is empty; will emit log message.
+ * - IB_EOTHER on IronBee failure; will emit log message.
+ */
+static
+ib_status_t fast_add_rule(
+    const ib_engine_t  *ib,
+    fast_runtime_t     *runtime,
+    const ib_rule_t    *rule,
+    const ib_list_t    *actions,
+    uint32_t          **index
+)
+{
+    assert(ib                != NULL);
+    assert(runtime           != NULL);
+    assert(runtime->patterns != NULL);
+    assert(rule              != NULL);
+    assert(actions           != NULL);
+    assert(index             != NULL);
+
+    ib_mm_t               mm = ib_engine_mm_main_get(ib);
+    const ib_list_node_t *node;
+    ib_status_t           rc;
+
+    /* Grow index. */
+    if (runtime->index_size == runtime->index_capacity) {
+        uint32_t capacity =
+            runtime->index_capacity == 0 ? 64 : 2 * runtime->index_capacity;
+        const ib_rule_t **new_index =
+            ib_mm_calloc(mm, capacity, sizeof(*new_index));
+        if (new_index == NULL) {
+            ib_log_error(ib, "fast: Error allocating index.");
+            return IB_EOTHER;
         }
-        if (rc != IB_ENOENT) {
-            /* Error. */
-            ia_eudoxus_set_error_printf(
-                eudoxus,
-                "Unexpected error reading from rule set hash: %s",
-                ib_status_to_string(rc)
+        if (runtime->index_size > 0) {
+            memcpy(
+                new_index, runtime->index,
+                runtime->index_size * sizeof(*new_index)
             );
-            return IA_EUDOXUS_CMD_ERROR;
         }
+        runtime->index = new_index;
+        runtime->index_capacity = capacity;
     }
 
-    rc = ib_hash_set_ex(search->rule_set, output, output_length, (void *)1);
-    if (rc != IB_OK) {
-        ia_eudoxus_set_error_printf(
-            eudoxus,
-            "Unexpected error writing to rule set hash: %s",
-            ib_status_to_string(rc)
-        );
-        return IA_EUDOXUS_CMD_ERROR;
+    *index = ib_mm_alloc(mm, sizeof(**index));
+    if (*index == NULL) {
+        ib_log_error(ib, "fast: Error allocating index.");
+        return IB_EOTHER;
+    }
+    **index = runtime->index_size;
+
+    IB_LIST_LOOP_CONST(actions, node) {
+        const ib_action_inst_t *action =
+            (const ib_action_inst_t *)ib_list_node_data_const(node);
+        const char *parameters = ib_action_inst_parameters(action);
+        fast_pattern_t *pattern;
+
+        if (parameters == NULL || *parameters == '\0') {
+            ib_log_error(
+                ib,
+                "fast: Fast rule %s has empty fast modifier.",
+                rule->meta.id
+            );
+            return IB_EINVAL;
+        }
+
+        pattern = ib_mm_alloc(mm, sizeof(*pattern));
+        if (pattern == NULL) {
+            ib_log_error(ib, "fast: Error allocating pattern.");
+            return IB_EOTHER;
+        }
+        pattern->pattern = parameters;
+        pattern->index   = **index;
+
+        rc = ib_list_push(runtime->patterns, pattern);
+        if (rc != IB_OK) {
+            ib_log_error(
+                ib,
+                "fast: Error adding pattern of %s: %s",
+                rule->meta.id,
+                ib_status_to_string(rc)
+            );
+            return IB_EOTHER;
+        }
     }
 
-    rc = ib_list_push(search->rule_list, (void *)rule);
+    rc = ib_hash_set(runtime->by_id, rule->meta.id, *index);
     if (rc != IB_OK) {
-         ia_eudoxus_set_error_printf(
-             eudoxus,
-             "Error pushing rule onto rule list: %s",
+        ib_log_error(
+            ib,
+            "fast: Error adding %s to id map: %s",
+            rule->meta.id,
             ib_status_to_string(rc)
         );
-        return IA_EUDOXUS_CMD_ERROR;
+        return IB_EOTHER;
     }
 
-    return IA_EUDOXUS_CMD_CONTINUE;
+    ++runtime->index_size;
+
+    return IB_OK;
 }
 
 /**
@@ -1026,6 +1169,9 @@ ia_eudoxus_command_t fast_eudoxus_callback(
  * - IB_EINVAL if rule wants to be a fast rule but cannot be.  This can
  *   occur if a rule is marked as fast but either lacks an id or is not in
  *   the loaded automata.
+ *
+ * If the automata is generated, rules not yet known are added to it
+ * instead.
  */
 ib_status_t fast_ownership(
     const ib_engine_t  *ib,
@@ -1098,7 +1244,14 @@ ib_status_t fast_ownership(
         &index,
         rule->meta.id
     );
-    if (rc == IB_ENOENT) {
+    if (rc == IB_ENOENT && runtime->patterns != NULL) {
+        /* fast_add_rule() will handle logging errors. */
+        rc = fast_add_rule(ib, runtime, rule, actions, &index);
+        if (rc != IB_OK) {
+            FAST_RETURN(rc);
+        }
+    }
+    else if (rc == IB_ENOENT) {
         ib_log_error(
             ib,
             "fast: Fast rule %s not in automata.",
@@ -1142,6 +1295,127 @@ done:
     return rc;
 }
 
+/**
+ * Destroy the execution state of a search.
+ *
+ * Registered as a cleanup of the transaction memory manager.
+ *
+ * @param[in] cbdata The @ref fast_search_t.
+ */
+static
+void fast_search_cleanup(
+    void *cbdata
+)
+{
+    assert(cbdata != NULL);
+
+    fast_search_t *search = (fast_search_t *)cbdata;
+
+    if (search->state != NULL) {
+        ia_eudoxus_destroy_state(search->state);
+        search->state = NULL;
+    }
+}
+
+/**
+ * Fetch or create the search state of a transaction.
+ *
+ * @param[in]  ib      IronBee engine.
+ * @param[in]  m       This module.
+ * @param[in]  tx      Transaction.
+ * @param[in]  runtime Runtime data.
+ * @param[out] search  Search state of @a tx.
+ * @return
+ * - IB_OK on success.
+ * - IB_EINVAL on IronAutomata failure; will emit log message.
+ * - IB_EOTHER on IronBee failure; will emit log message.
+ */
+static
+ib_status_t fast_get_search(
+    const ib_engine_t     *ib,
+    const ib_module_t     *m,
+    ib_tx_t               *tx,
+    const fast_runtime_t  *runtime,
+    fast_search_t        **search
+)
+{
+    assert(ib      != NULL);
+    assert(m       != NULL);
+    assert(tx      != NULL);
+    assert(runtime != NULL);
+    assert(search  != NULL);
+
+    ia_eudoxus_result_t  irc;
+    ib_status_t          rc;
+    fast_search_t       *new_search;
+
+    rc = ib_tx_get_module_data(tx, m, search);
+    if (rc == IB_OK && *search != NULL) {
+        return IB_OK;
+    }
+
+    new_search = ib_mm_calloc(tx->mm, 1, sizeof(*new_search));
+    if (new_search == NULL) {
+        ib_log_error(ib, "fast: Error allocating search.");
+        return IB_EOTHER;
+    }
+    new_search->runtime = runtime;
+    new_search->found =
+        ib_mm_calloc(tx->mm, (runtime->index_size + 7) / 8, 1);
+    if (new_search->found == NULL) {
+        ib_log_error(ib, "fast: Error allocating found indices.");
+        return IB_EOTHER;
+    }
+    rc = ib_list_create(&new_search->outputs, tx->mm);
+    if (rc != IB_OK) {
+        ib_log_error(
+            ib,
+            "fast: Error creating output list: %s",
+            ib_status_to_string(rc)
+        );
+        return IB_EOTHER;
+    }
+
+    irc = ia_eudoxus_create_state(
+        &new_search->state,
+        runtime->eudoxus,
+        fast_eudoxus_callback,
+        new_search
+    );
+    if (irc != IA_EUDOXUS_OK) {
+        ib_log_error(
+            ib,
+            "fast: Error creating state: %s",
+            fast_eudoxus_error(runtime->eudoxus)
+        );
+        return IB_EINVAL;
+    }
+
+    rc = ib_mm_register_cleanup(tx->mm, fast_search_cleanup, new_search);
+    if (rc != IB_OK) {
+        ia_eudoxus_destroy_state(new_search->state);
+        ib_log_error(
+            ib,
+            "fast: Error registering search cleanup: %s",
+            ib_status_to_string(rc)
+        );
+        return IB_EOTHER;
+    }
+
+    rc = ib_tx_set_module_data(tx, m, new_search);
+    if (rc != IB_OK) {
+        ib_log_error(
+            ib,
+            "fast: Error storing search: %s",
+            ib_status_to_string(rc)
+        );
+        return IB_EOTHER;
+    }
+
+    *search = new_search;
+    return IB_OK;
+}
+
 /**
  * Evaluate automata for a single phase.
  *
@@ -1149,6 +1423,11 @@ done:
  * phase specific functions that simply forward their parameters along with
  * the bytestrings and collections specific to the phase.
  *
+ * The bytestrings and collections are fed to the execution shared by all
+ * phases of the transaction.  Then every rule of the current phase and
+ * context whose index has been found in this or an earlier phase is
+ * injected.
+ *
  * @sa fast_feed_phase()
  *
  * @param[in] ib          IronBee engine.
@@ -1182,87 +1461,96 @@ ib_status_t fast_rule_injection(
     const fast_config_t *cfg = fast_get_config_module(m, rule_exec->tx->ctx);
     assert(cfg != NULL);
     const fast_runtime_t *runtime = cfg->runtime;
-    assert(runtime          != NULL);
-    assert(runtime->eudoxus != NULL);
-    assert(runtime->index   != NULL);
+    assert(runtime != NULL);
 
-    ia_eudoxus_result_t   irc;
-    ia_eudoxus_state_t   *state = NULL;
     ib_status_t           rc;
-    const ib_var_store_t *var_store;
-    ib_mpool_lite_t      *tmp_mp = NULL;
-    ib_mm_t               tmp_mm;
-    ib_hash_t            *rule_set;
+    fast_search_t        *search;
+    fast_feeder_t         feeder;
+    const ib_list_node_t *node;
 
-    rc = ib_mpool_lite_create(&tmp_mp);
-    if (rc != IB_OK) {
-        ib_log_error(
-            ib,
-            "fast: Error creating temporary memory pool: %s",
-            ib_status_to_string(rc)
-        );
-        tmp_mp = NULL;
-        rc = IB_EOTHER;
-        goto done;
+    if (runtime->eudoxus == NULL) {
+        /* Generated automata without any fast rules. */
+        return IB_OK;
     }
-    tmp_mm = ib_mm_mpool_lite(tmp_mp);
+    assert(runtime->index != NULL);
 
-    rc = ib_hash_create(&rule_set, tmp_mm);
+    rc = fast_get_search(ib, m, rule_exec->tx, runtime, &search);
     if (rc != IB_OK) {
-        ib_log_error(
-            ib,
-            "fast: Error creating rule set hash: %s",
-            ib_status_to_string(rc)
-        );
-        rc = IB_EOTHER;
-        goto done;
+        return rc;
     }
 
-    fast_search_t search = {
-        .runtime   = runtime,
-        .rule_exec = rule_exec,
-        .rules     = cfg->rules,
-        .rule_list = rule_list,
-        .rule_set  = rule_set
-    };
+    feeder.ib      = ib;
+    feeder.eudoxus = runtime->eudoxus;
+    feeder.state   = search->state;
+    feeder.length  = 0;
 
-    var_store = rule_exec->tx->var_store;
-
-    irc = ia_eudoxus_create_state(
-        &state,
-        runtime->eudoxus,
-        fast_eudoxus_callback,
-        &search
-    );
-    if (irc != IA_EUDOXUS_OK) {
-        ib_log_error(
-            ib,
-            "fast: Error creating state: %s",
-            fast_eudoxus_error(runtime->eudoxus)
-        );
-        rc = IB_EINVAL;
-        goto done;
-    }
-
-    /* fast_feed_phase() will handle logging errors. */
+    /* fast_feed_phase() and fast_feed_flush() will handle logging errors. */
     rc = fast_feed_phase(
-        ib,
-        runtime->eudoxus,
-        state,
-        var_store,
+        &feeder,
+        rule_exec->tx->var_store,
         bytestrings,
         collections
     );
-
-done:
-    if (state != NULL) {
-        ia_eudoxus_destroy_state(state);
+    if (rc != IB_OK) {
+        return rc;
     }
-    if (tmp_mp != NULL) {
-        ib_mpool_lite_destroy(tmp_mp);
+    rc = fast_feed_flush(&feeder);
+    if (rc != IB_OK) {
+        return rc;
     }
 
-    return rc;
+    IB_LIST_LOOP_CONST(search->outputs, node) {
+        const char      *output = (const char *)ib_list_node_data_const(node);
+        uint32_t         index;
+        const ib_rule_t *rule;
+
+        memcpy(&index, output, sizeof(index));
+        rule = runtime->index[index];
+
+        if (rule == NULL) {
+            /* Rule is in automata but not claimed.  This can occur when fast
+             * rules are present but enabled anywhere.
+             */
+            continue;
+        }
+
+        /* Check phase.  As each rule has a single phase, this also ensures
+         * each rule is injected at most once. */
+        if (rule->meta.phase != rule_exec->phase) {
+            continue;
+        }
+
+        /* Check context, i.e., is in eligible rules */
+        rc = ib_hash_get_ex(
+            cfg->rules,
+            NULL,
+            output,
+            sizeof(index)
+        );
+        if (rc == IB_ENOENT) {
+            continue;
+        }
+        else if (rc != IB_OK) {
+            ib_log_error(
+                ib,
+                "fast: Unexpected return code from eligible rules check: %s",
+                ib_status_to_string(rc)
+            );
+            return IB_EOTHER;
+        }
+
+        rc = ib_list_push(rule_list, (void *)rule);
+        if (rc != IB_OK) {
+            ib_log_error(
+                ib,
+                "fast: Error pushing rule onto rule list: %s",
+                ib_status_to_string(rc)
+            );
+            return IB_EOTHER;
+        }
+    }
+
+    return IB_OK;
 }
 
 /**
@@ -1455,7 +1743,9 @@ ib_status_t fast_ctx_open(
  * Called on context close.
  *
  * On close of main context, will call fast_convert_specs().  This is the
- * appropriate time to do so as all vars will be registered by then.
+ * appropriate time to do so as all vars will be registered by then.  If
+ * generating, it will also generate the automata, as every rule has been
+ * offered to fast_ownership() by then.
  *
  * @param[in] ib  Engine.
  * @param[in] ctx Context.
@@ -1465,7 +1755,7 @@ ib_status_t fast_ctx_open(
  * - IB_OK on success.
  * - IB_EALLOC on allocation failure.
  * - IB_EOTHER on unexpected failure.
- * - As fast_convert_specs()
+ * - As fast_convert_specs() and fast_generate().
  **/
 static
 ib_status_t fast_ctx_close(
@@ -1478,6 +1768,8 @@ ib_status_t fast_ctx_close(
     assert(ib != NULL);
     assert(ctx != NULL);
 
+    ib_status_t rc;
+
     if (ib_context_type(ctx) == IB_CTYPE_MAIN) {
         fast_config_t *cfg = fast_get_config(ib, ctx);
         if (cfg == NULL) {
@@ -1491,12 +1783,204 @@ ib_status_t fast_ctx_close(
             return IB_EALLOC;
         }
 
-        return fast_convert_specs(ib, cfg->runtime->specs);
+        rc = fast_convert_specs(ib, cfg->runtime->specs);
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+#ifdef FAST_GENERATE
+        if (cfg->runtime->patterns != NULL && cfg->runtime->index_size > 0) {
+            rc = fast_generate(
+                ib,
+                &cfg->runtime->eudoxus,
+                cfg->runtime->patterns
+            );
+            if (rc != IB_OK) {
+                return rc;
+            }
+            ib_log_debug(
+                ib,
+                "fast: Generated automata of %zd patterns for %d rules.",
+                ib_list_elements(cfg->runtime->patterns),
+                cfg->runtime->index_size
+            );
+        }
+#endif
     }
 
     return IB_OK;
 }
 
+/**
+ * Create the runtime for a @c FastAutomata or @c FastGenerate directive.
+ *
+ * @param[in]  cp      Configuration parser; used for logging.
+ * @param[in]  what    Parameter of directive; used for logging.
+ * @param[out] runtime New runtime, stored in main context configuration.
+ * @return
+ * - IB_OK on success.
+ * - IB_EINVAL if not in main context or a directive has already occurred;
+ *   will emit log message.
+ * - IB_EALLOC on failures due to memory allocation; no log message.
+ * - Any error from ib_engine_module_get(); will emit log message.
+ **/
+static
+ib_status_t fast_create_runtime(
+    ib_cfgparser_t  *cp,
+    const char      *what,
+    fast_runtime_t **runtime
+)
+{
+    assert(cp      != NULL);
+    assert(cp->ib  != NULL);
+    assert(what    != NULL);
+    assert(runtime != NULL);
+
+    ib_engine_t   *ib = cp->ib;
+    fast_config_t *config;
+    ib_status_t    rc;
+
+    if (cp->cur_ctx != ib_context_main(ib)) {
+        ib_cfg_log_error(
+            cp,
+            "fast: %s: Fast directives must occur in main context.",
+            what
+        );
+        return IB_EINVAL;
+    }
+
+    config = fast_get_config(ib, cp->cur_ctx);
+
+    assert(config != NULL);
+
+    if (config->runtime != NULL) {
+        ib_cfg_log_error(
+            cp,
+            "fast: %s: FastAutomata or FastGenerate must be unique.",
+            what
+        );
+        return IB_EINVAL;
+    }
+
+    config->runtime = *runtime =
+        ib_mm_calloc(ib_engine_mm_main_get(ib), 1, sizeof(**runtime));
+    if (*runtime == NULL) {
+        return IB_EALLOC;
+    }
+
+    rc = ib_hash_create(&(*runtime)->by_id, ib_engine_mm_main_get(ib));
+    if (rc != IB_OK) {
+        ib_cfg_log_error(
+            cp,
+            "fast: %s: Error creating hash: %s",
+            what,
+            ib_status_to_string(rc)
+        );
+        return IB_EOTHER;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Register hooks, ownership, and the fast action for @a runtime.
+ *
+ * @param[in] cp      Configuration parser; used for logging.
+ * @param[in] what    Parameter of directive; used for logging.
+ * @param[in] runtime Runtime to register.
+ * @return
+ * - IB_OK on success.
+ * - IB_EOTHER on failures due to IronBee API failures; will emit log message.
+ **/
+static
+ib_status_t fast_register(
+    ib_cfgparser_t *cp,
+    const char     *what,
+    fast_runtime_t *runtime
+)
+{
+/* This macro is local to this function. */
+#ifndef DOXYGEN_SKIP
+#define FAST_CHECK_RC(msg) \
+    if (rc != IB_OK) { \
+        ib_cfg_log_error(cp, "fast: %s: %s: %s", what, msg, ib_status_to_string(rc)); \
+        return IB_EOTHER; \
+    }
+#endif
+
+    assert(cp      != NULL);
+    assert(cp->ib  != NULL);
+    assert(what    != NULL);
+    assert(runtime != NULL);
+
+    ib_engine_t *ib = cp->ib;
+    ib_module_t *module;
+    ib_status_t  rc;
+
+    rc = ib_engine_module_get(ib, MODULE_NAME_STR, &module);
+    FAST_CHECK_RC("Unable to get my own module");
+
+    /* Register hooks */
+    rc = ib_rule_register_injection_fn(
+        ib,
+        MODULE_NAME_STR,
+        IB_PHASE_REQUEST_HEADER,
+        fast_rule_injection_request_header, module
+    );
+    FAST_CHECK_RC("Error registering injection for request header phase.");
+    rc = ib_rule_register_injection_fn(
+        ib,
+        MODULE_NAME_STR,
+        IB_PHASE_REQUEST,
+        fast_rule_injection_request_body, module
+    );
+    FAST_CHECK_RC("Error registering injection for request header phase.");
+    rc = ib_rule_register_injection_fn(
+        ib,
+        MODULE_NAME_STR,
+        IB_PHASE_RESPONSE_HEADER,
+        fast_rule_injection_response_header, module
+    );
+    FAST_CHECK_RC("Error registering injection for response header phase.");
+    rc = ib_rule_register_injection_fn(
+        ib,
+        MODULE_NAME_STR,
+        IB_PHASE_RESPONSE,
+        fast_rule_injection_response_body, module
+    );
+    FAST_CHECK_RC("Error registering injection for response header phase.");
+
+    rc = ib_rule_register_ownership_fn(
+        ib,
+        MODULE_NAME_STR,
+        fast_ownership, runtime
+    );
+    FAST_CHECK_RC("Error registering ownership");
+
+    /* Register the fast "action" */
+    rc = ib_action_create_and_register(
+        NULL, ib,
+        c_fast_action,
+        NULL, NULL,
+        NULL, NULL,
+        NULL, NULL
+    );
+    FAST_CHECK_RC("Error registering action");
+
+    /* Register context open hook to setup per-context data. */
+    rc = ib_hook_context_register(ib, context_open_state,
+                                  fast_ctx_open, NULL);
+    FAST_CHECK_RC("Error registering context close.");
+    /* Register context close hook to convert specs once all vars are
+     * registered. */
+    rc = ib_hook_context_register(ib, context_close_state,
+                                  fast_ctx_close, NULL);
+    FAST_CHECK_RC("Error registering context close.");
+
+    return IB_OK;
+#undef FAST_CHECK_RC
+}
+
 /**
  * Called when @c FastAutomata directive appears in configuration.
  *
@@ -1528,11 +2012,6 @@ ib_status_t fast_dir_fast_automata(
         ib_cfg_log_error(cp, "fast: %s: " msg " (%d %s)", p1, (param), irc, fast_eudoxus_error(runtime->eudoxus)); \
         return IB_EINVAL; \
     }
-#define FAST_CHECK_RC(msg) \
-    if (rc != IB_OK) { \
-        ib_cfg_log_error(cp, "fast: %s: %s: %s", p1, msg, ib_status_to_string(rc)); \
-        return IB_EOTHER; \
-    }
 #endif
 
     assert(cp     != NULL);
@@ -1544,56 +2023,21 @@ ib_status_t fast_dir_fast_automata(
     ib_engine_t         *ib;
     ib_mm_t              mm;
     fast_runtime_t      *runtime;
-    fast_config_t       *config;
     ia_eudoxus_result_t  irc;
     ib_status_t          rc;
     const uint8_t       *data;
     size_t               data_size;
     uint32_t             index_size;
-    ib_module_t         *module;
-
-    ib     = cp->ib;
-    if (cp->cur_ctx != ib_context_main(ib)) {
-        ib_cfg_log_error(
-            cp,
-            "fast: %s: FastAutomata directive must occur in main context.",
-            p1
-        );
-        return IB_EINVAL;
-    }
-
-    mm     = ib_engine_mm_main_get(ib);
-    config = fast_get_config(ib, cp->cur_ctx);
 
-    assert(config != NULL);
+    ib = cp->ib;
+    mm = ib_engine_mm_main_get(ib);
 
-    if (config->runtime != NULL) {
-        ib_cfg_log_error(
-            cp,
-            "fast: %s: FastAutomata directive must be unique.",
-            p1
-        );
-        return IB_EINVAL;
-    }
-
-    rc = ib_engine_module_get(ib, MODULE_NAME_STR, &module);
+    /* Create Runtime */
+    rc = fast_create_runtime(cp, p1, &runtime);
     if (rc != IB_OK) {
-        ib_cfg_log_error(
-            cp,
-            "fast: %s: Unable to get my own module: %s",
-            p1,
-            ib_status_to_string(rc)
-        );
         return rc;
     }
 
-    /* Create Runtime */
-    config->runtime = runtime =
-        ib_mm_calloc(mm, 1, sizeof(*config->runtime));
-    if (config->runtime == NULL) {
-        return IB_EALLOC;
-    }
-
     /* Load Automata */
     irc = ia_eudoxus_create_from_path(&runtime->eudoxus, p1);
     if (irc != IA_EUDOXUS_OK) {
@@ -1640,6 +2084,7 @@ ib_status_t fast_dir_fast_automata(
         ib_cfg_log_error(cp, "Automata has index size of 0.");
         return IB_EINVAL;
     }
+    runtime->index_size = index_size;
 
     /* Create index */
     runtime->index =
@@ -1648,10 +2093,6 @@ ib_status_t fast_dir_fast_automata(
         return IB_EALLOC;
     }
 
-    /* Create by_id */
-    rc = ib_hash_create(&runtime->by_id, mm);
-    FAST_CHECK_RC("Error creating hash");
-
     /* Load index */
     irc = ia_eudoxus_metadata_with_key(
         runtime->eudoxus,
@@ -1705,66 +2146,76 @@ ib_status_t fast_dir_fast_automata(
         }
     }
 
-    /* Register hooks */
-    rc = ib_rule_register_injection_fn(
-        ib,
-        MODULE_NAME_STR,
-        IB_PHASE_REQUEST_HEADER,
-        fast_rule_injection_request_header, module
-    );
-    FAST_CHECK_RC("Error registering injection for request header phase.");
-    rc = ib_rule_register_injection_fn(
-        ib,
-        MODULE_NAME_STR,
-        IB_PHASE_REQUEST,
-        fast_rule_injection_request_body, module
-    );
-    FAST_CHECK_RC("Error registering injection for request header phase.");
-    rc = ib_rule_register_injection_fn(
-        ib,
-        MODULE_NAME_STR,
-        IB_PHASE_RESPONSE_HEADER,
-        fast_rule_injection_response_header, module
-    );
-    FAST_CHECK_RC("Error registering injection for response header phase.");
-    rc = ib_rule_register_injection_fn(
-        ib,
-        MODULE_NAME_STR,
-        IB_PHASE_RESPONSE,
-        fast_rule_injection_response_body, module
-    );
-    FAST_CHECK_RC("Error registering injection for response header phase.");
+    return fast_register(cp, p1, runtime);
+#undef FAST_METADATA_ERROR
+}
 
-    rc = ib_rule_register_ownership_fn(
-        ib,
-        MODULE_NAME_STR,
-        fast_ownership, runtime
-    );
-    FAST_CHECK_RC("Error registering ownership");
+/**
+ * Called when @c FastGenerate directive appears in configuration.
+ *
+ * If on, the automata is generated from the fast modifiers of the claimed
+ * rules when the main context closes, instead of being loaded from a file.
+ *
+ * @param[in] cp     Configuration parsed; used for logging.
+ * @param[in] name   Name; used for logging.
+ * @param[in] onoff  Whether to generate.
+ * @param[in] cbdata Ignored.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EINVAL on failures related to invalid use such as not main context,
+ *   duplicate directive, or lack of C++ support; will emit log message.
+ * - IB_EOTHER on failures due to IronBee API failures; will emit log message.
+ * - IB_EALLOC on failures due to memory allocation; no log message.
+ **/
+static
+ib_status_t fast_dir_fast_generate(
+    ib_cfgparser_t *cp,
+    const char     *name,
+    int             onoff,
+    void           *cbdata
+)
+{
+    assert(cp     != NULL);
+    assert(cp->ib != NULL);
+    assert(name   != NULL);
 
-    /* Register the fast "action" */
-    rc = ib_action_create_and_register(
-        NULL, ib,
-        c_fast_action,
-        NULL, NULL,
-        NULL, NULL,
-        NULL, NULL
+    ib_status_t rc;
+
+    if (! onoff) {
+        return IB_OK;
+    }
+
+#ifndef FAST_GENERATE
+    ib_cfg_log_error(
+        cp,
+        "fast: %s: Not supported as IronBee was built without C++.",
+        name
     );
-    FAST_CHECK_RC("Error registering action");
+    rc = IB_EINVAL;
+#else
+    fast_runtime_t *runtime;
 
-    /* Register context open hook to setup per-context data. */
-    rc = ib_hook_context_register(ib, context_open_state,
-                                  fast_ctx_open, NULL);
-    FAST_CHECK_RC("Error registering context close.");
-    /* Register context close hook to convert specs once all vars are
-     * registered. */
-    rc = ib_hook_context_register(ib, context_close_state,
-                                  fast_ctx_close, NULL);
-    FAST_CHECK_RC("Error registering context close.");
+    rc = fast_create_runtime(cp, name, &runtime);
+    if (rc != IB_OK) {
+        return rc;
+    }
 
-    return IB_OK;
-#undef FAST_METADATA_ERROR
-#undef FAST_IB_ERROR
+    rc = ib_list_create(&runtime->patterns, ib_engine_mm_main_get(cp->ib));
+    if (rc != IB_OK) {
+        ib_cfg_log_error(
+            cp,
+            "fast: %s: Error creating pattern list: %s",
+            name,
+            ib_status_to_string(rc)
+        );
+        return IB_EOTHER;
+    }
+
+    rc = fast_register(cp, name, runtime);
+#endif
+
+    return rc;
 }
 
 /**
@@ -1817,6 +2268,11 @@ static IB_DIRMAP_INIT_STRUCTURE(fast_directive_map) = {
         fast_dir_fast_automata,
         NULL
     ),
+    IB_DIRMAP_INIT_ONOFF(
+        "FastGenerate",
+        fast_dir_fast_generate,
+        NULL
+    ),
 
     /* End */
     IB_DIRMAP_INIT_LAST
@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Fast Pattern Module Automata Generation
+ *
+ * Builds the fast pattern automata in the engine for the @c FastGenerate
+ * directive.  This does in memory what @c fast/extract.rb,
+ * @c fast/generate, and @c ec do for @c FastAutomata.
+ */
+
+#include "fast_private.h"
+
+#include <ironbee/log.h>
+
+#include <ironautomata/buffer.hpp>
+#include <ironautomata/deduplicate_outputs.hpp>
+#include <ironautomata/eudoxus_compiler.hpp>
+#include <ironautomata/generator/aho_corasick.hpp>
+#include <ironautomata/intermediate.hpp>
+#include <ironautomata/optimize_edges.hpp>
+
+#include <cassert>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace std;
+
+namespace {
+
+/**
+ * Convert a fast modifier to a pattern as @c fast/extract.rb does.
+ *
+ * @param[in] modifier Value of fast modifier.
+ * @return Pattern with each whitespace character replaced by @c \\s.
+ */
+string modifier_to_pattern(const char *modifier)
+{
+    string pattern;
+    for (const char *c = modifier; *c != '\0'; ++c) {
+        if (isspace(static_cast<unsigned char>(*c))) {
+            pattern += "\\s";
+        }
+        else {
+            pattern += *c;
+        }
+    }
+    return pattern;
+}
+
+/**
+ * Compile @a patterns into a Eudoxus automata buffer.
+ *
+ * @param[in] patterns List of @ref fast_pattern_t.
+ * @return Eudoxus automata.
+ * @throw invalid_argument on invalid pattern.
+ */
+IronAutomata::buffer_t compile_patterns(const ib_list_t *patterns)
+{
+    namespace ia = IronAutomata;
+
+    ia::Intermediate::Automata automata;
+    ia::buffer_t index_data;
+    ia::BufferAssembler index_assembler(index_data);
+    const ib_list_node_t *node;
+
+    ia::Generator::aho_corasick_begin(automata);
+    IB_LIST_LOOP_CONST(patterns, node) {
+        const fast_pattern_t *pattern =
+            reinterpret_cast<const fast_pattern_t *>(
+                ib_list_node_data_const(node)
+            );
+
+        index_data.clear();
+        index_assembler.append_object(pattern->index);
+        ia::Generator::aho_corasick_add_pattern(
+            automata,
+            modifier_to_pattern(pattern->pattern),
+            index_data
+        );
+    }
+    ia::Generator::aho_corasick_finish(automata);
+
+    ia::Intermediate::breadth_first(
+        automata,
+        ia::Intermediate::optimize_edges
+    );
+    ia::Intermediate::deduplicate_outputs(automata);
+    automata.metadata()["Output-Type"] = "integer";
+
+    return ia::EudoxusCompiler::compile(automata).buffer;
+}
+
+} // Anonymous
+
+extern "C" {
+
+ib_status_t fast_generate(
+    const ib_engine_t  *ib,
+    ia_eudoxus_t      **eudoxus,
+    const ib_list_t    *patterns
+)
+{
+    assert(ib       != NULL);
+    assert(eudoxus  != NULL);
+    assert(patterns != NULL);
+
+    IronAutomata::buffer_t buffer;
+    try {
+        buffer = compile_patterns(patterns);
+    }
+    catch (const bad_alloc&) {
+        return IB_EALLOC;
+    }
+    catch (const exception& e) {
+        ib_log_error(ib, "fast: Error generating automata: %s", e.what());
+        return IB_EINVAL;
+    }
+
+    /* Eudoxus takes ownership of the data and frees it on destroy. */
+    char *data = reinterpret_cast<char *>(malloc(buffer.size()));
+    if (data == NULL) {
+        return IB_EALLOC;
+    }
+    memcpy(data, &buffer[0], buffer.size());
+
+    if (ia_eudoxus_create(eudoxus, data) != IA_EUDOXUS_OK) {
+        free(data);
+        ib_log_error(ib, "fast: Error loading generated automata.");
+        return IB_EINVAL;
+    }
+
+    return IB_OK;
+}
+
+}
@@ -0,0 +1,77 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef _IB_MODULE_FAST_PRIVATE_H_
+#define _IB_MODULE_FAST_PRIVATE_H_
+
+/**
+ * @file
+ * @brief IronBee --- Private fast pattern module definitions
+ *
+ * Declarations shared between the C module and the C++ automata generation
+ * used by the @c FastGenerate directive.
+ */
+
+#include <ironautomata/eudoxus.h>
+
+#include <ironbee/engine.h>
+#include <ironbee/list.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A fast pattern and the index of its rule.
+ */
+typedef struct fast_pattern_t fast_pattern_t;
+struct fast_pattern_t
+{
+    /** Pattern; IronAutomata Aho-Corasick pattern syntax. */
+    const char *pattern;
+    /** Index of rule; the output of @ref pattern in the automata. */
+    uint32_t    index;
+};
+
+/**
+ * Generate a Eudoxus automata from fast patterns.
+ *
+ * The automata is an Aho-Corasick automata of every pattern whose outputs
+ * are the @c uint32_t indices of the patterns, as built by the
+ * @c fast/generate program and @c ec.  Whitespace in patterns is treated
+ * as in @c fast/extract.rb.
+ *
+ * @param[in]  ib       IronBee engine; used for logging.
+ * @param[out] eudoxus  Generated automata; destroy with ia_eudoxus_destroy().
+ * @param[in]  patterns List of @ref fast_pattern_t.
+ * @return
+ * - IB_OK on success.
+ * - IB_EINVAL if a pattern is invalid or the automata can not be loaded;
+ *   will emit log message.
+ * - IB_EALLOC on allocation failure.
+ */
+ib_status_t fast_generate(
+    const ib_engine_t  *ib,
+    ia_eudoxus_t      **eudoxus,
+    const ib_list_t    *patterns
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IB_MODULE_FAST_PRIVATE_H_ */
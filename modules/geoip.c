@@ -35,6 +35,7 @@
 
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 #include <strings.h>
 #include <unistd.h>
 
@@ -50,9 +51,74 @@ typedef struct {
     ib_var_source_t *geoip_source; /**< Var source for GEO */
 } module_data_t;
 
+/**
+ * Per-connection cache of the last lookup.
+ *
+ * Transactions on a keep-alive connection almost always share a remote
+ * address, so the id of the last address looked up is kept with the
+ * connection and the database is only searched when the address changes
+ * (e.g., when rewritten by the trusted_proxy module).
+ */
+typedef struct {
+    const char *ip;       /**< Last address looked up; NULL if none. */
+    int         geoip_id; /**< GeoIP id of @ref ip. */
+} geoip_conn_cache_t;
+
 /* Declare the public module symbol. */
 IB_MODULE_DECLARE();
 
+/**
+ * Lookup the GeoIP id of @a ip, using the connection cache if possible.
+ *
+ * Failure to create the cache is not fatal; the database is searched
+ * directly.
+ *
+ * @param[in] tx Transaction.
+ * @param[in] mod_data Module data.
+ * @param[in] ip Address to lookup.
+ *
+ * @returns GeoIP id of @a ip; 0 or less if there is no record.
+ */
+static int geoip_id_lookup(
+    ib_tx_t             *tx,
+    const module_data_t *mod_data,
+    const char          *ip
+)
+{
+    assert(tx != NULL);
+    assert(tx->conn != NULL);
+    assert(mod_data != NULL);
+    assert(mod_data->geoip_db != NULL);
+    assert(ip != NULL);
+
+    geoip_conn_cache_t *cache = NULL;
+    ib_status_t         rc;
+
+    rc = ib_conn_get_module_data(tx->conn, IB_MODULE_STRUCT_PTR, &cache);
+    if (rc != IB_OK || cache == NULL) {
+        cache = ib_mm_calloc(tx->conn->mm, 1, sizeof(*cache));
+        if (
+            cache == NULL ||
+            ib_conn_set_module_data(
+                tx->conn, IB_MODULE_STRUCT_PTR, cache
+            ) != IB_OK
+        ) {
+            return GeoIP_id_by_addr(mod_data->geoip_db, ip);
+        }
+    }
+
+    if (cache->ip != NULL && strcmp(cache->ip, ip) == 0) {
+        ib_log_debug_tx(tx, "GeoIP: Using cached lookup of \"%s\"", ip);
+        return cache->geoip_id;
+    }
+
+    cache->geoip_id = GeoIP_id_by_addr(mod_data->geoip_db, ip);
+    /* If the copy fails, the cache is left empty. */
+    cache->ip = ib_mm_strdup(tx->conn->mm, ip);
+
+    return cache->geoip_id;
+}
+
 /**
  * Lookup the IP address in the GeoIP database
  *
@@ -130,7 +196,7 @@ static ib_status_t geoip_lookup(
         return IB_EINVAL;
     }
 
-    geoip_id = GeoIP_id_by_addr(mod_data->geoip_db, ip);
+    geoip_id = geoip_id_lookup(tx, mod_data, ip);
 
     if (geoip_id > 0) {
         const char *tmp_str;
@@ -50,6 +50,11 @@
 #pragma clang diagnostic pop
 #endif
 
+#include <algorithm>
+#include <vector>
+
+#include <strings.h>
+
 using boost::bind;
 using namespace std;
 using namespace IronBee;
@@ -110,8 +115,64 @@ static const char* c_response_directive = "HeaderOrderResponse";
 
 // END CONFIGURATION
 
-//! Map of header key to abbreviation.  Keys must be lowercase.
-typedef map<string, string> header_map_t;
+/**
+ * Index of header key to abbreviation.
+ *
+ * Entries are sorted by a fingerprint of the lowercased key, so a header
+ * is looked up by hashing its name in place, without copying or
+ * lowercasing it, and a binary search.  Matching fingerprints are
+ * confirmed by comparing the keys case insensitively.
+ **/
+class header_map_t
+{
+public:
+    /**
+     * Add @a key with @a abbrev unless @a key is already present.
+     *
+     * @param[in] key    Header key; any case.
+     * @param[in] abbrev Abbreviation.
+     **/
+    void insert(const string& key, const string& abbrev);
+
+    //! Remove all entries.
+    void clear()
+    {
+        m_entries.clear();
+    }
+
+    /**
+     * Find abbreviation of header @a name.
+     *
+     * @param[in] name   Header name; any case.
+     * @param[in] length Length of @a name.
+     * @return Abbreviation or NULL if @a name is not in the index.
+     **/
+    const string* find(const char* name, size_t length) const;
+
+private:
+    //! Case insensitive fingerprint of @a length bytes at @a name.
+    static uint64_t fingerprint(const char* name, size_t length);
+
+    //! Entry of the index.
+    struct entry_t
+    {
+        //! fingerprint() of @ref key.
+        uint64_t fingerprint;
+        //! Lowercase header key.
+        string key;
+        //! Abbreviation.
+        string abbrev;
+
+        //! Order by fingerprint.
+        bool operator<(const entry_t& other) const
+        {
+            return fingerprint < other.fingerprint;
+        }
+    };
+
+    //! Entries sorted by fingerprint.
+    vector<entry_t> m_entries;
+};
 
 //! Per context data.
 struct PerContext
@@ -188,6 +249,59 @@ IBPP_BOOTSTRAP_MODULE_DELEGATE("header_order", Delegate)
 // Keep doxygen happy.
 namespace {
 
+uint64_t header_map_t::fingerprint(const char* name, size_t length)
+{
+    // FNV-1a.
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(::tolower(name[i]));
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void header_map_t::insert(const string& key, const string& abbrev)
+{
+    if (find(key.data(), key.length())) {
+        return;
+    }
+
+    entry_t entry;
+    entry.fingerprint = fingerprint(key.data(), key.length());
+    entry.key = key;
+    entry.abbrev = abbrev;
+    transform(
+        entry.key.begin(), entry.key.end(), entry.key.begin(), ::tolower
+    );
+
+    m_entries.insert(
+        upper_bound(m_entries.begin(), m_entries.end(), entry),
+        entry
+    );
+}
+
+const string* header_map_t::find(const char* name, size_t length) const
+{
+    entry_t probe;
+    probe.fingerprint = fingerprint(name, length);
+
+    for (
+        vector<entry_t>::const_iterator i =
+            lower_bound(m_entries.begin(), m_entries.end(), probe);
+        i != m_entries.end() && i->fingerprint == probe.fingerprint;
+        ++i
+    ) {
+        if (
+            i->key.length() == length &&
+            strncasecmp(i->key.data(), name, length) == 0
+        ) {
+            return &i->abbrev;
+        }
+    }
+
+    return NULL;
+}
+
 void configure_header_map(
     header_map_t& header_map,
     const char*   config
@@ -211,12 +325,10 @@ void configure_header_map(
             );
         }
 
-        string abbrev = part.substr(0, equal_pos);
-        string key = part.substr(equal_pos + 1);
-
-        transform(key.begin(), key.end(), key.begin(), ::tolower);
-
-        header_map.insert(header_map_t::value_type(key, abbrev));
+        header_map.insert(
+            part.substr(equal_pos + 1),
+            part.substr(0, equal_pos)
+        );
     }
 }
 
@@ -311,15 +423,12 @@ void Delegate::handle_header_state(
     }
 
     string result;
-    string key;
-    header_map_t::const_iterator key_i;
     while (header) {
-        key = header.name().to_s();
-        transform(key.begin(), key.end(), key.begin(), ::tolower);
-
-        key_i = header_map->find(key);
-        if (key_i != header_map->end()) {
-            result += key_i->second;
+        ConstByteString name = header.name();
+        const string* abbrev =
+            header_map->find(name.const_data(), name.length());
+        if (abbrev) {
+            result += *abbrev;
         }
 
         header = header.next();
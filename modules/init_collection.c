@@ -34,6 +34,7 @@
 #include <ironbee/file.h>
 #include <ironbee/json.h>
 #include <ironbee/module.h>
+#include <ironbee/mm_mpool_lite.h>
 #include <ironbee/path.h>
 #include <ironbee/rule_engine.h>
 #include <ironbee/string.h>
@@ -84,10 +85,53 @@ typedef struct init_collection_cfg_t init_collection_cfg_t;
  * JSON configuration type.
  */
 struct json_t {
-    const char *file; /**< The file containing the JSON. */
+    const char      *file;   /**< The file containing the JSON. */
+    const ib_list_t *fields; /**< Fields decoded from @ref json_t::file. */
 };
 typedef struct json_t json_t;
 
+/**
+ * Push the shared fields @a src onto the transaction's @a fields.
+ *
+ * Fields are created once, from the main memory manager, when the
+ * collection is configured and are shared by all transactions.  They
+ * must be treated as immutable.
+ *
+ * @param[in] tx The transaction.
+ * @param[in] src The shared fields.
+ * @param[in] fields The output fields.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - Other on list errors.
+ */
+static ib_status_t push_shared_fields(
+    ib_tx_t         *tx,
+    const ib_list_t *src,
+    ib_list_t       *fields
+)
+{
+    assert(tx != NULL);
+    assert(src != NULL);
+    assert(fields != NULL);
+
+    const ib_list_node_t *node;
+
+    IB_LIST_LOOP_CONST(src, node) {
+        ib_status_t rc;
+        const ib_field_t *field =
+            (const ib_field_t *)ib_list_node_data_const(node);
+        assert(field != NULL);
+        rc = ib_list_push(fields, (void *)field);
+        if (rc !=  IB_OK) {
+            ib_log_error_tx(tx, "Failed to populate fields.");
+            return rc;
+        }
+    }
+
+    return IB_OK;
+}
+
 /**
  * JSON Load callback.
  *
@@ -115,45 +159,93 @@ static ib_status_t json_load_fn(
     assert(tx != NULL);
     assert(fields != NULL);
 
-    json_t        *json_cfg = (json_t *)impl;
-    ib_status_t    rc;
-    const char    *err_msg;
-    const uint8_t *buf = NULL;
-    size_t         sz;
+    json_t *json_cfg = (json_t *)impl;
+
+    assert(json_cfg->fields != NULL);
+
+    return push_shared_fields(tx, json_cfg->fields, fields);
+}
+
+/**
+ * Read and decode @a file into @a fields.
+ *
+ * The file is read into a temporary memory pool; the decoded fields are
+ * copies allocated from @a mm.
+ *
+ * @param[in] ib IronBee Engine.
+ * @param[in] mm Memory manager to allocate the fields from.
+ * @param[in] file The JSON file.
+ * @param[out] fields The decoded fields.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation error.
+ * - Other on read or decode errors.
+ */
+static ib_status_t json_decode_file(
+    ib_engine_t  *ib,
+    ib_mm_t       mm,
+    const char   *file,
+    ib_list_t   **fields
+)
+{
+    assert(ib != NULL);
+    assert(file != NULL);
+    assert(fields != NULL);
+
+    ib_mpool_lite_t *mp;
+    ib_status_t      rc;
+    const char      *err_msg;
+    const uint8_t   *buf = NULL;
+    size_t           sz;
+
+    rc = ib_list_create(fields, mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_mpool_lite_create(&mp);
+    if (rc != IB_OK) {
+        return rc;
+    }
 
     /* Load the file into a buffer. */
-    rc = ib_file_readall(tx->mm, json_cfg->file, &buf, &sz);
+    rc = ib_file_readall(ib_mm_mpool_lite(mp), file, &buf, &sz);
     if (rc != IB_OK) {
         if (rc == IB_EOTHER || rc == IB_EINVAL) {
-            ib_log_error_tx(
-                tx,
+            ib_log_error(
+                ib,
                 "Error reading file \"%s\": %s",
-                json_cfg->file,
+                file,
                 strerror(errno));
         }
         else {
-            ib_log_error_tx(tx, "Failed to read JSON file \"%s\"", json_cfg->file);
+            ib_log_error(ib, "Failed to read JSON file \"%s\"", file);
         }
-        return rc;
+        goto cleanup;
     }
 
     /* Parse the buffer into the fields list. */
-    rc = ib_json_decode_ex(tx->mm, buf, sz, fields, &err_msg);
+    rc = ib_json_decode_ex(mm, buf, sz, *fields, &err_msg);
     if (rc != IB_OK) {
-        ib_log_error_tx(
-            tx,
+        ib_log_error(
+            ib,
             "Error decoding JSON file \"%s\": %s",
-            json_cfg->file,
+            file,
             err_msg);
-        return rc;
+        goto cleanup;
     }
 
-    return IB_OK;
+cleanup:
+    ib_mpool_lite_destroy(mp);
+    return rc;
 }
 
 /**
  * Create a new @a impl which is passed to json_load_fn().
  *
+ * The JSON file is decoded here, once, rather than for every transaction.
+ *
  * @param[in] ib IronBee Engine.
  * @param[in] params Parameters to constructor.
  * @param[out] impl The @ref json_t to be constructed.
@@ -163,6 +255,7 @@ static ib_status_t json_load_fn(
  * - IB_OK On success.
  * - IB_EINVAL On invalid entry.
  * - IB_EALLOC On allocation error.
+ * - Other on errors reading or decoding the JSON file.
  */
 static ib_status_t json_create_fn(
     ib_engine_t     *ib,
@@ -178,9 +271,11 @@ static ib_status_t json_create_fn(
 
     ib_mm_t                mm = ib_engine_mm_main_get(ib);
     json_t                *json_cfg;
+    ib_list_t             *fields;
     const ib_list_node_t  *node;
     const char            *json_file;
     init_collection_cfg_t *cfg = (init_collection_cfg_t *)cbdata;
+    ib_status_t            rc;
 
     assert(cfg->config_file != NULL);
 
@@ -216,6 +311,12 @@ static ib_status_t json_create_fn(
         return IB_EALLOC;
     }
 
+    rc = json_decode_file(ib, mm, json_cfg->file, &fields);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    json_cfg->fields = fields;
+
     *(json_t **)impl = json_cfg;
     return IB_OK;
 }
@@ -487,23 +588,10 @@ ib_status_t var_load_fn(
     assert(tx != NULL);
 
     var_t *var = (var_t *)impl;
-    const ib_list_node_t *node;
 
     assert(var->fields != NULL);
 
-    IB_LIST_LOOP_CONST(var->fields, node) {
-        ib_status_t rc;
-        const ib_field_t *field =
-            (const ib_field_t *)ib_list_node_data_const(node);
-        assert(field != NULL);
-        rc = ib_list_push(fields, (void *)field);
-        if (rc !=  IB_OK) {
-            ib_log_error_tx(tx, "Failed to populate fields.");
-            return rc;
-        }
-    }
-
-    return IB_OK;
+    return push_shared_fields(tx, var->fields, fields);
 }
 
 /**
@@ -0,0 +1,752 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- JSON Body Module
+ *
+ * This module parses JSON request bodies as they arrive and adds their
+ * values to the `request_body_params` and `ARGS` vars.
+ *
+ * The body is parsed incrementally, one body chunk at a time, by the YAJL
+ * event parser; it is never buffered.  Each string, number, boolean or null
+ * value becomes a parameter named by the keys leading to it, joined by a
+ * period.  Elements of an array are named like the array.  E.g.,
+ * `{"a": {"b": [1, 2]}}` results in two parameters `a.b` with the values
+ * `1` and `2`.
+ *
+ * Only bodies of requests with a `Content-Type` of `application/json`, or
+ * a type ending in `+json`, are parsed, and only in contexts with
+ * `JsonBody On`.
+ */
+
+#include <ironbee/bytestr.h>
+#include <ironbee/context.h>
+#include <ironbee/engine.h>
+#include <ironbee/engine_state.h>
+#include <ironbee/field.h>
+#include <ironbee/flags.h>
+#include <ironbee/mm.h>
+#include <ironbee/module.h>
+#include <ironbee/parsed_content.h>
+#include <ironbee/string.h>
+#include <ironbee/var.h>
+
+#include <yajl/yajl_parse.h>
+
+#include <assert.h>
+#include <string.h>
+#include <strings.h>
+
+/* Define the module name as well as a string version of it. */
+#define MODULE_NAME        json_body
+#define MODULE_NAME_STR    IB_XSTRINGIFY(MODULE_NAME)
+
+/** Deepest nesting of objects and arrays that is parsed. */
+#define JSON_BODY_MAX_DEPTH  32
+
+/** Most parameters created from a single body. */
+#define JSON_BODY_MAX_PARAMS 1024
+
+/**
+ * JSON body module data.
+ */
+typedef struct {
+    ib_var_source_t *body_params; /**< request_body_params source */
+    ib_var_source_t *args;        /**< ARGS source */
+} json_body_module_data_t;
+
+/**
+ * JSON body configuration
+ */
+typedef struct {
+    bool enabled;                 /**< Parse JSON bodies? */
+} json_body_config_t;
+
+/**
+ * JSON body global configuration
+ */
+static json_body_config_t json_body_config = {
+    .enabled = false,
+};
+
+/**
+ * A container being parsed.
+ */
+typedef struct {
+    size_t name_length;           /**< Length of the container's name. */
+    bool   is_array;              /**< Array or object? */
+} json_body_frame_t;
+
+/**
+ * Per-transaction parser state.
+ */
+typedef struct {
+    ib_tx_t                       *tx;          /**< Transaction */
+    const json_body_module_data_t *mod_data;    /**< Module data */
+    yajl_handle                    handle;      /**< YAJL parser */
+    char                          *name;        /**< Name of next value */
+    size_t                         name_length; /**< Length of @ref name */
+    size_t                         name_size;   /**< Size of @ref name */
+    json_body_frame_t frames[JSON_BODY_MAX_DEPTH]; /**< Open containers */
+    size_t                         depth;       /**< Elements of frames */
+    size_t                         params;      /**< Parameters created */
+    bool                           stopped;     /**< Parsing given up? */
+    bool                           finishing;   /**< Request finished? */
+} json_body_tx_t;
+
+/**
+ * Set the length of the name of the next value, growing its buffer.
+ *
+ * @param[in] state Parser state.
+ * @param[in] length New length.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static ib_status_t reserve_name(json_body_tx_t *state, size_t length)
+{
+    assert(state != NULL);
+
+    if (length > state->name_size) {
+        size_t  size = state->name_size * 2;
+        char   *name;
+
+        if (size < length) {
+            size = length;
+        }
+        name = ib_mm_alloc(state->tx->mm, size);
+        if (name == NULL) {
+            return IB_EALLOC;
+        }
+        if (state->name_length > 0) {
+            memcpy(name, state->name, state->name_length);
+        }
+        state->name = name;
+        state->name_size = size;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Add a parameter named by the current name.
+ *
+ * @param[in] state Parser state.
+ * @param[in] value Value.
+ * @param[in] length Length of @a value.
+ *
+ * @returns 1 to continue parsing, 0 to stop.
+ */
+static int add_param(
+    json_body_tx_t *state,
+    const char     *value,
+    size_t          length
+)
+{
+    assert(state != NULL);
+    assert(value != NULL);
+
+    ib_tx_t      *tx = state->tx;
+    ib_bytestr_t *bs;
+    ib_field_t   *param;
+    ib_field_t   *list;
+    ib_status_t   rc;
+
+    /* A value at the top level has no name. */
+    if (state->name_length == 0) {
+        return 1;
+    }
+
+    if (state->params >= JSON_BODY_MAX_PARAMS) {
+        ib_log_notice_tx(tx,
+                         "JSON body has more than %d parameters; "
+                         "ignoring the rest.",
+                         JSON_BODY_MAX_PARAMS);
+        state->stopped = true;
+        return 0;
+    }
+
+    rc = ib_bytestr_dup_mem(&bs, tx->mm, (const uint8_t *)value, length);
+    if (rc != IB_OK) {
+        goto error;
+    }
+    rc = ib_field_create(&param, tx->mm,
+                         state->name, state->name_length,
+                         IB_FTYPE_BYTESTR,
+                         ib_ftype_bytestr_in(bs));
+    if (rc != IB_OK) {
+        goto error;
+    }
+
+    rc = ib_var_source_get(state->mod_data->body_params, &list, tx->var_store);
+    if (rc == IB_ENOENT) {
+        rc = ib_var_source_initialize(state->mod_data->body_params, &list,
+                                      tx->var_store, IB_FTYPE_LIST);
+    }
+    if (rc != IB_OK) {
+        goto error;
+    }
+    rc = ib_field_list_add(list, param);
+    if (rc != IB_OK) {
+        goto error;
+    }
+
+    /* The core copies request_body_params to ARGS when the request
+     * finishes, before the rest of the body is parsed. */
+    if (state->finishing) {
+        rc = ib_var_source_get(state->mod_data->args, &list, tx->var_store);
+        if (rc == IB_OK) {
+            rc = ib_field_list_add(list, param);
+        }
+        if (rc != IB_OK && rc != IB_ENOENT) {
+            goto error;
+        }
+    }
+
+    ++state->params;
+    return 1;
+
+error:
+    ib_log_error_tx(tx, "Error adding JSON body parameter: %s",
+                    ib_status_to_string(rc));
+    state->stopped = true;
+    return 0;
+}
+
+/* YAJL callbacks */
+
+static int json_body_null(void *ctx)
+{
+    return add_param(ctx, IB_S2SL("null"));
+}
+
+static int json_body_boolean(void *ctx, int value)
+{
+    return value ?
+        add_param(ctx, IB_S2SL("true")) :
+        add_param(ctx, IB_S2SL("false"));
+}
+
+static int json_body_number(void *ctx, const char *value, size_t length)
+{
+    return add_param(ctx, value, length);
+}
+
+static int json_body_string(
+    void                *ctx,
+    const unsigned char *value,
+    size_t               length
+)
+{
+    return add_param(ctx, (const char *)value, length);
+}
+
+/**
+ * Open an object or array.
+ *
+ * @param[in] state Parser state.
+ * @param[in] is_array Array or object?
+ *
+ * @returns 1 to continue parsing, 0 to stop.
+ */
+static int json_body_open(json_body_tx_t *state, bool is_array)
+{
+    assert(state != NULL);
+
+    json_body_frame_t *frame;
+
+    if (state->depth >= JSON_BODY_MAX_DEPTH) {
+        ib_log_notice_tx(state->tx,
+                         "JSON body nested deeper than %d; "
+                         "ignoring the rest.",
+                         JSON_BODY_MAX_DEPTH);
+        state->stopped = true;
+        return 0;
+    }
+
+    frame = &(state->frames[state->depth]);
+    frame->name_length = state->name_length;
+    frame->is_array = is_array;
+    ++state->depth;
+
+    return 1;
+}
+
+/**
+ * Close an object or array; the name reverts to the container's.
+ *
+ * @param[in] state Parser state.
+ *
+ * @returns 1 to continue parsing.
+ */
+static int json_body_close(json_body_tx_t *state)
+{
+    assert(state != NULL);
+    assert(state->depth > 0);
+
+    --state->depth;
+    state->name_length = state->frames[state->depth].name_length;
+
+    return 1;
+}
+
+static int json_body_start_map(void *ctx)
+{
+    return json_body_open(ctx, false);
+}
+
+static int json_body_map_key(
+    void                *ctx,
+    const unsigned char *key,
+    size_t               length
+)
+{
+    json_body_tx_t *state = ctx;
+    size_t          base;
+    size_t          name_length;
+
+    assert(state->depth > 0);
+
+    base = state->frames[state->depth - 1].name_length;
+    name_length = base + (base > 0 ? 1 : 0) + length;
+
+    state->name_length = base;
+    if (reserve_name(state, name_length) != IB_OK) {
+        state->stopped = true;
+        return 0;
+    }
+    if (base > 0) {
+        state->name[base++] = '.';
+    }
+    memcpy(state->name + base, key, length);
+    state->name_length = name_length;
+
+    return 1;
+}
+
+static int json_body_end_map(void *ctx)
+{
+    return json_body_close(ctx);
+}
+
+static int json_body_start_array(void *ctx)
+{
+    return json_body_open(ctx, true);
+}
+
+static int json_body_end_array(void *ctx)
+{
+    return json_body_close(ctx);
+}
+
+/** YAJL callbacks; numbers are passed as text. */
+static const yajl_callbacks json_body_callbacks = {
+    json_body_null,
+    json_body_boolean,
+    NULL,
+    NULL,
+    json_body_number,
+    json_body_string,
+    json_body_start_map,
+    json_body_map_key,
+    json_body_end_map,
+    json_body_start_array,
+    json_body_end_array
+};
+
+/**
+ * Free the YAJL parser of a transaction.
+ *
+ * @param[in] cbdata Parser state.
+ */
+static void json_body_cleanup(void *cbdata)
+{
+    json_body_tx_t *state = cbdata;
+
+    yajl_free(state->handle);
+}
+
+/**
+ * Is @a value a JSON media type?
+ *
+ * @param[in] value Content-Type header value.
+ *
+ * @returns true if @a value is `application/json` or ends in `+json`,
+ *          ignoring parameters.
+ */
+static bool is_json_type(const ib_bytestr_t *value)
+{
+    const char *data = (const char *)ib_bytestr_const_ptr(value);
+    size_t      length = ib_bytestr_length(value);
+    size_t      end = 0;
+
+    if (data == NULL) {
+        return false;
+    }
+
+    while (end < length && data[end] != ';' && data[end] != ' ') {
+        ++end;
+    }
+
+    if (end == sizeof("application/json") - 1 &&
+        strncasecmp(data, "application/json", end) == 0)
+    {
+        return true;
+    }
+    if (end >= sizeof("+json") - 1 &&
+        strncasecmp(data + end - (sizeof("+json") - 1), "+json",
+                    sizeof("+json") - 1) == 0)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Start parsing JSON request bodies.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in] tx Transaction.
+ * @param[in] state State.
+ * @param[in] cbdata Module.
+ *
+ * @returns Status code.
+ */
+static ib_status_t json_body_request_header(
+    ib_engine_t *ib,
+    ib_tx_t     *tx,
+    ib_state_t   state,
+    void        *cbdata
+)
+{
+    assert(ib != NULL);
+    assert(tx != NULL);
+    assert(state == request_header_finished_state);
+    assert(cbdata != NULL);
+
+    const ib_module_t        *module = cbdata;
+    const json_body_config_t *config;
+    const ib_parsed_header_t *header;
+    json_body_tx_t           *tx_state;
+    ib_status_t               rc;
+
+    rc = ib_context_module_config(tx->ctx, module, &config);
+    if (rc != IB_OK) {
+        ib_log_error_tx(tx, "Failed to get %s module configuration: %s",
+                        module->name, ib_status_to_string(rc));
+        return rc;
+    }
+    if (! config->enabled || tx->request_header == NULL) {
+        return IB_OK;
+    }
+
+    for (header = tx->request_header->head;
+         header != NULL;
+         header = header->next)
+    {
+        if (ib_bytestr_length(header->name) == sizeof("Content-Type") - 1 &&
+            strncasecmp((const char *)ib_bytestr_const_ptr(header->name),
+                        "Content-Type", sizeof("Content-Type") - 1) == 0)
+        {
+            break;
+        }
+    }
+    if (header == NULL || ! is_json_type(header->value)) {
+        return IB_OK;
+    }
+
+    tx_state = ib_mm_calloc(tx->mm, 1, sizeof(*tx_state));
+    if (tx_state == NULL) {
+        return IB_EALLOC;
+    }
+    tx_state->tx = tx;
+    tx_state->mod_data = module->data;
+    tx_state->handle = yajl_alloc(&json_body_callbacks, NULL, tx_state);
+    if (tx_state->handle == NULL) {
+        return IB_EALLOC;
+    }
+    rc = ib_mm_register_cleanup(tx->mm, json_body_cleanup, tx_state);
+    if (rc != IB_OK) {
+        yajl_free(tx_state->handle);
+        return rc;
+    }
+
+    return ib_tx_set_module_data(tx, module, tx_state);
+}
+
+/**
+ * Report a parse error.
+ *
+ * @param[in] tx_state Parser state.
+ * @param[in] data Data just parsed.
+ * @param[in] data_length Length of @a data.
+ */
+static void json_body_parse_error(
+    json_body_tx_t *tx_state,
+    const char     *data,
+    size_t          data_length
+)
+{
+    unsigned char *error;
+
+    error = yajl_get_error(tx_state->handle, 0,
+                           (const unsigned char *)data, data_length);
+    ib_log_notice_tx(tx_state->tx, "Error parsing JSON body: %s",
+                     error != NULL ? (const char *)error : "unknown error");
+    if (error != NULL) {
+        yajl_free_error(tx_state->handle, error);
+    }
+    tx_state->stopped = true;
+}
+
+/**
+ * Parse a chunk of a JSON request body.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in] tx Transaction.
+ * @param[in] state State.
+ * @param[in] data Body data.
+ * @param[in] data_length Length of @a data.
+ * @param[in] cbdata Module.
+ *
+ * @returns Status code.
+ */
+static ib_status_t json_body_request_body_data(
+    ib_engine_t *ib,
+    ib_tx_t     *tx,
+    ib_state_t   state,
+    const char  *data,
+    size_t       data_length,
+    void        *cbdata
+)
+{
+    assert(ib != NULL);
+    assert(tx != NULL);
+    assert(state == request_body_data_state);
+    assert(cbdata != NULL);
+
+    const ib_module_t *module = cbdata;
+    json_body_tx_t    *tx_state;
+
+    if (ib_tx_get_module_data(tx, module, &tx_state) != IB_OK ||
+        tx_state == NULL ||
+        tx_state->stopped ||
+        data == NULL || data_length == 0)
+    {
+        return IB_OK;
+    }
+
+    /* The body of an allowed request is not inspected. */
+    if (ib_flags_any(tx->flags, IB_TX_FALLOW_ALL | IB_TX_FALLOW_REQUEST)) {
+        tx_state->stopped = true;
+        return IB_OK;
+    }
+
+    if (yajl_parse(tx_state->handle,
+                   (const unsigned char *)data, data_length) != yajl_status_ok)
+    {
+        if (! tx_state->stopped) {
+            json_body_parse_error(tx_state, data, data_length);
+        }
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Finish parsing a JSON request body.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in] tx Transaction.
+ * @param[in] state State.
+ * @param[in] cbdata Module.
+ *
+ * @returns Status code.
+ */
+static ib_status_t json_body_request_finished(
+    ib_engine_t *ib,
+    ib_tx_t     *tx,
+    ib_state_t   state,
+    void        *cbdata
+)
+{
+    assert(ib != NULL);
+    assert(tx != NULL);
+    assert(state == request_finished_state);
+    assert(cbdata != NULL);
+
+    const ib_module_t *module = cbdata;
+    json_body_tx_t    *tx_state;
+
+    if (ib_tx_get_module_data(tx, module, &tx_state) != IB_OK ||
+        tx_state == NULL ||
+        tx_state->stopped)
+    {
+        return IB_OK;
+    }
+
+    tx_state->finishing = true;
+    if (yajl_complete_parse(tx_state->handle) != yajl_status_ok) {
+        if (! tx_state->stopped) {
+            json_body_parse_error(tx_state, NULL, 0);
+        }
+    }
+    tx_state->stopped = true;
+
+    ib_log_debug_tx(tx, "Parsed %zu JSON body parameters.", tx_state->params);
+
+    return IB_OK;
+}
+
+/**
+ * Handle the JsonBody directive.
+ *
+ * @param[in] cp Config parser
+ * @param[in] directive Directive name
+ * @param[in] value On/Off value
+ * @param[in] cbdata Module.
+ *
+ * @returns Status code
+ */
+static ib_status_t json_body_handler(
+    ib_cfgparser_t  *cp,
+    const char      *directive,
+    int              value,
+    void            *cbdata
+)
+{
+    assert(cp != NULL);
+    assert(directive != NULL);
+    assert(cbdata != NULL);
+
+    const ib_module_t  *module = cbdata;
+    ib_context_t       *context;
+    json_body_config_t *config;
+    ib_status_t         rc;
+
+    rc = ib_cfgparser_context_current(cp, &context);
+    if (rc != IB_OK) {
+        ib_cfg_log_error(cp, "%s: Failed to get current context: %s",
+                         directive, ib_status_to_string(rc));
+        return rc;
+    }
+
+    rc = ib_context_module_config(context, module, &config);
+    if (rc != IB_OK) {
+        ib_cfg_log_error(cp, "Failed to get %s module configuration: %s",
+                         module->name, ib_status_to_string(rc));
+        return rc;
+    }
+
+    config->enabled = (value != 0);
+
+    return IB_OK;
+}
+
+/**
+ * Initialize the JSON body module.
+ *
+ * @param[in] ib IronBee Engine.
+ * @param[in] module Module data.
+ * @param[in] cbdata Callback data (unused).
+ *
+ * @returns Status code
+ */
+static ib_status_t json_body_init(
+    ib_engine_t *ib,
+    ib_module_t *module,
+    void        *cbdata
+)
+{
+    assert(ib != NULL);
+    assert(module != NULL);
+
+    ib_mm_t                  mm = ib_engine_mm_main_get(ib);
+    json_body_module_data_t *mod_data;
+    ib_status_t              rc;
+
+    mod_data = ib_mm_calloc(mm, 1, sizeof(*mod_data));
+    if (mod_data == NULL) {
+        return IB_EALLOC;
+    }
+
+    rc = ib_var_source_acquire(&mod_data->body_params, mm,
+                               ib_engine_var_config_get(ib),
+                               IB_S2SL("request_body_params"));
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = ib_var_source_acquire(&mod_data->args, mm,
+                               ib_engine_var_config_get(ib),
+                               IB_S2SL("ARGS"));
+    if (rc != IB_OK) {
+        return rc;
+    }
+    module->data = mod_data;
+
+    rc = ib_config_register_directive(ib,
+                                      "JsonBody",
+                                      IB_DIRTYPE_ONOFF,
+                                      (ib_void_fn_t)json_body_handler,
+                                      NULL,
+                                      module,
+                                      NULL,
+                                      NULL);
+    if (rc != IB_OK) {
+        ib_log_error(ib, "Failed to register JsonBody directive: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    rc = ib_hook_tx_register(ib, request_header_finished_state,
+                             json_body_request_header, module);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = ib_hook_txdata_register(ib, request_body_data_state,
+                                 json_body_request_body_data, module);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = ib_hook_tx_register(ib, request_finished_state,
+                             json_body_request_finished, module);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Module structure.
+ *
+ * This structure defines some metadata, config data and various functions.
+ */
+IB_MODULE_INIT(
+    IB_MODULE_HEADER_DEFAULTS,               /* Default metadata */
+    MODULE_NAME_STR,                         /* Module name */
+    IB_MODULE_CONFIG(&json_body_config),     /* Global config data */
+    NULL,                                    /* Module config map */
+    NULL,                                    /* Module directive map */
+    json_body_init,                          /* Initialize function */
+    NULL,                                    /* Callback data */
+    NULL,                                    /* Finish function */
+    NULL,                                    /* Callback data */
+);
@@ -76,8 +76,45 @@ typedef struct sqli_fingerprint_entry_t {
 typedef struct sqli_fingerprint_set_t {
     sqli_fingerprint_entry_t *fingerprints;     /**< Sorted array of entries. */
     size_t                    num_fingerprints; /**< Size of @ref fingerprints. */
+    ib_hash_t                *index;            /**< Fingerprint to entry. */
 } sqli_fingerprint_set_t;
 
+/**
+ * Longest input whose verdict is cached.
+ *
+ * Inputs are copied into the cache, so long inputs, e.g., bodies, which
+ * are also the least likely to be inspected again, are not cached.
+ */
+#define SQLI_VERDICT_MAX_LENGTH 1024
+
+/**
+ * Cached verdict of is_sqli or is_xss for an input.
+ *
+ * Rules commonly inspect the same values, e.g., every argument, with
+ * several rules or in several phases.  Verdicts are cached per transaction
+ * so libinjection only runs once per operator, fingerprint set and value.
+ */
+typedef struct sqli_verdict_t {
+    ib_num_t result;     /**< Result of the operator. */
+    ib_num_t confidence; /**< Confidence of fingerprint; is_sqli only. */
+    /** Matched fingerprint; is_sqli only. */
+    char     fingerprint[LIBINJECTION_SQLI_MAX_TOKENS + 1];
+} sqli_verdict_t;
+
+/**
+ * Kind of check a cached verdict is for; the first byte of its key.
+ */
+enum {
+    SQLI_VERDICT_SQLI = 's',
+    SQLI_VERDICT_XSS  = 'x'
+};
+
+/**
+ * Longest key of a cached verdict: kind, fingerprint set, and input.
+ */
+#define SQLI_VERDICT_MAX_KEY_LENGTH \
+    (1 + sizeof(void *) + SQLI_VERDICT_MAX_LENGTH)
+
 /* Callback data for lookup. */
 typedef struct sqli_callback_data_t {
     const sqli_fingerprint_set_t *fingerprint_set;
@@ -113,17 +150,8 @@ int sqli_is_sqli_fingerprint(const char *fingerprint, size_t len, void *cbdata)
 
     sqli_callback_data_t *callback_data =
         (sqli_callback_data_t *)cbdata;
-    char fp[LIBINJECTION_SQLI_MAX_TOKENS + 1];
     const sqli_fingerprint_entry_t *result = NULL;
 
-    /* Create a NUL terminated string. */
-    memcpy(fp, fingerprint, len);
-    fp[len] = '\0';
-
-    /* Calling bsearch on an array of *pointers*, thus a pointer to an
-       element is a pointer to a pointer.
-
-       Note that &fp is different than &fp_p. */
     if (
         callback_data != NULL &&
         callback_data->fingerprint_set != NULL &&
@@ -131,13 +159,7 @@ int sqli_is_sqli_fingerprint(const char *fingerprint, size_t len, void *cbdata)
     ) {
         const sqli_fingerprint_set_t *fps = callback_data->fingerprint_set;
 
-        sqli_fingerprint_entry_t key = { 0, fp };
-        result = bsearch(
-            &key,
-            fps->fingerprints, fps->num_fingerprints, sizeof(*fps->fingerprints),
-            &sqli_cmp
-        );
-        if (result != NULL) {
+        if (ib_hash_get_ex(fps->index, &result, fingerprint, len) == IB_OK) {
             callback_data->confidence = result->confidence;
         }
     }
@@ -320,6 +342,152 @@ ib_status_t sqli_normalize_tfn(
  * Operators
  *********************************/
 
+/**
+ * Fetch the verdict cache of @a tx, creating it if needed.
+ *
+ * @param[in] m This module.
+ * @param[in] tx Transaction.
+ * @param[out] cache Hash of verdict key to @ref sqli_verdict_t.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - Other on allocation failure.
+ */
+static
+ib_status_t sqli_verdict_cache_get(
+    const ib_module_t  *m,
+    ib_tx_t            *tx,
+    ib_hash_t         **cache
+)
+{
+    assert(m     != NULL);
+    assert(tx    != NULL);
+    assert(cache != NULL);
+
+    ib_status_t rc;
+
+    rc = ib_tx_get_module_data(tx, m, cache);
+    if (rc == IB_OK && *cache != NULL) {
+        return IB_OK;
+    }
+
+    rc = ib_hash_create(cache, tx->mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_tx_set_module_data(tx, m, *cache);
+    if (rc != IB_OK) {
+        *cache = NULL;
+    }
+
+    return rc;
+}
+
+/**
+ * Look up the cached verdict for @a data.
+ *
+ * @param[in] m This module.
+ * @param[in] tx Transaction.
+ * @param[in] kind SQLI_VERDICT_SQLI or SQLI_VERDICT_XSS.
+ * @param[in] set Fingerprint set the verdict depends on or NULL.
+ * @param[in] data Input.
+ * @param[in] data_length Length of @a data.
+ * @param[out] key Key of the verdict; must have room for
+ *             SQLI_VERDICT_MAX_KEY_LENGTH bytes.
+ * @param[out] key_length Length of @a key.
+ * @param[out] verdict The cached verdict, if any.
+ *
+ * @returns
+ * - IB_OK If a verdict is cached.
+ * - IB_ENOENT If no verdict is cached.
+ * - IB_DECLINED If @a data is too long to be cached.
+ * - Other on allocation failure.
+ */
+static
+ib_status_t sqli_verdict_lookup(
+    const ib_module_t     *m,
+    ib_tx_t               *tx,
+    char                   kind,
+    const void            *set,
+    const uint8_t         *data,
+    size_t                 data_length,
+    char                  *key,
+    size_t                *key_length,
+    const sqli_verdict_t **verdict
+)
+{
+    assert(tx         != NULL);
+    assert(key        != NULL);
+    assert(key_length != NULL);
+    assert(verdict    != NULL);
+
+    ib_status_t  rc;
+    ib_hash_t   *cache;
+
+    if (m == NULL || data_length > SQLI_VERDICT_MAX_LENGTH) {
+        return IB_DECLINED;
+    }
+
+    key[0] = kind;
+    memcpy(key + 1, &set, sizeof(set));
+    memcpy(key + 1 + sizeof(set), data, data_length);
+    *key_length = 1 + sizeof(set) + data_length;
+
+    rc = sqli_verdict_cache_get(m, tx, &cache);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    return ib_hash_get_ex(cache, verdict, key, *key_length);
+}
+
+/**
+ * Cache @a verdict under @a key.
+ *
+ * @param[in] m This module.
+ * @param[in] tx Transaction.
+ * @param[in] key Key from sqli_verdict_lookup(); copied.
+ * @param[in] key_length Length of @a key.
+ * @param[in] verdict Verdict; copied.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ */
+static
+ib_status_t sqli_verdict_store(
+    const ib_module_t    *m,
+    ib_tx_t              *tx,
+    const char           *key,
+    size_t                key_length,
+    const sqli_verdict_t *verdict
+)
+{
+    assert(m       != NULL);
+    assert(tx      != NULL);
+    assert(key     != NULL);
+    assert(verdict != NULL);
+
+    ib_status_t     rc;
+    ib_hash_t      *cache;
+    const char     *key_copy;
+    sqli_verdict_t *verdict_copy;
+
+    rc = sqli_verdict_cache_get(m, tx, &cache);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    key_copy = ib_mm_memdup(tx->mm, key, key_length);
+    verdict_copy = ib_mm_memdup(tx->mm, verdict, sizeof(*verdict));
+    if (key_copy == NULL || verdict_copy == NULL) {
+        return IB_EALLOC;
+    }
+
+    return ib_hash_set_ex(cache, key_copy, key_length, verdict_copy);
+}
+
 static
 ib_status_t sqli_op_create(
     ib_context_t *ctx,
@@ -393,10 +561,15 @@ ib_status_t sqli_op_execute(
     assert(result != NULL);
 
     const sqli_fingerprint_set_t *ps = (const sqli_fingerprint_set_t *)instance_data;
+    const ib_module_t        *m  = (const ib_module_t *)cbdata;
     sfilter                   sf;
     ib_bytestr_t             *bs;
     ib_status_t               rc;
     sqli_callback_data_t      callback_data;
+    char                      key[SQLI_VERDICT_MAX_KEY_LENGTH];
+    size_t                    key_length;
+    const sqli_verdict_t     *cached;
+    sqli_verdict_t            verdict;
 
     *result = 0;
 
@@ -411,32 +584,60 @@ ib_status_t sqli_op_execute(
         return rc;
     }
 
-    /* Run through libinjection. */
-    libinjection_sqli_init(
-        &sf,
-        (const char *)ib_bytestr_const_ptr(bs),
-        ib_bytestr_length(bs),
-        FLAG_NONE
+    rc = sqli_verdict_lookup(
+        m, tx, SQLI_VERDICT_SQLI, ps,
+        ib_bytestr_const_ptr(bs), ib_bytestr_length(bs),
+        key, &key_length, &cached
     );
-    callback_data.confidence = 0;
-    callback_data.fingerprint_set = NULL;
-    if (ps != NULL) {
-        callback_data.fingerprint_set = ps;
-        libinjection_sqli_callback(&sf, sqli_lookup_word, (void *)&callback_data);
-    }
-    if (libinjection_is_sqli(&sf)) {
-        ib_log_debug_tx(tx, "Matched SQLi fingerprint: %s", sf.fingerprint);
+    if (rc == IB_OK) {
+        verdict = *cached;
+    }
+    else if (rc == IB_ENOENT || rc == IB_DECLINED) {
+        /* Run through libinjection. */
+        libinjection_sqli_init(
+            &sf,
+            (const char *)ib_bytestr_const_ptr(bs),
+            ib_bytestr_length(bs),
+            FLAG_NONE
+        );
+        callback_data.confidence = 0;
+        callback_data.fingerprint_set = NULL;
+        if (ps != NULL) {
+            callback_data.fingerprint_set = ps;
+            libinjection_sqli_callback(&sf, sqli_lookup_word, (void *)&callback_data);
+        }
+        memset(&verdict, 0, sizeof(verdict));
+        if (libinjection_is_sqli(&sf)) {
+            verdict.result = 1;
+            verdict.confidence = callback_data.confidence;
+            assert(strlen(sf.fingerprint) <= LIBINJECTION_SQLI_MAX_TOKENS);
+            strcpy(verdict.fingerprint, sf.fingerprint);
+        }
+
+        if (rc == IB_ENOENT) {
+            rc = sqli_verdict_store(m, tx, key, key_length, &verdict);
+            if (rc != IB_OK) {
+                return rc;
+            }
+        }
+    }
+    else {
+        return rc;
+    }
+
+    if (verdict.result == 1) {
+        ib_log_debug_tx(tx, "Matched SQLi fingerprint: %s", verdict.fingerprint);
         *result = 1;
     }
     if (*result == 1 && capture != NULL) {
         {
             ib_field_t *fingerprint_field;
-            size_t fingerprint_length = strlen(sf.fingerprint);
+            size_t fingerprint_length = strlen(verdict.fingerprint);
             const uint8_t *fingerprint;
 
             fingerprint = ib_mm_memdup(
                 tx->mm,
-                sf.fingerprint, fingerprint_length
+                verdict.fingerprint, fingerprint_length
             );
             if (fingerprint == NULL) {
                 return IB_EALLOC;
@@ -466,7 +667,7 @@ ib_status_t sqli_op_execute(
                 tx->mm,
                 IB_S2SL("confidence"),
                 IB_FTYPE_NUM,
-                ib_ftype_num_in(&callback_data.confidence)
+                ib_ftype_num_in(&verdict.confidence)
             );
             if (rc != IB_OK) {
                 return rc;
@@ -496,8 +697,13 @@ ib_status_t xss_op_execute(
     assert(field  != NULL);
     assert(result != NULL);
 
+    const ib_module_t *m = (const ib_module_t *)cbdata;
     ib_bytestr_t *bs;
     ib_status_t rc;
+    char key[SQLI_VERDICT_MAX_KEY_LENGTH];
+    size_t key_length;
+    const sqli_verdict_t *cached;
+    sqli_verdict_t verdict;
 
     *result = 0;
 
@@ -512,9 +718,34 @@ ib_status_t xss_op_execute(
         return rc;
     }
 
-    /* Run through libinjection. */
-    // TODO: flags parameter is currently undocumented - using 0
-    if (libinjection_is_xss((const char *)ib_bytestr_const_ptr(bs), ib_bytestr_length(bs), 0)) {
+    rc = sqli_verdict_lookup(
+        m, tx, SQLI_VERDICT_XSS, NULL,
+        ib_bytestr_const_ptr(bs), ib_bytestr_length(bs),
+        key, &key_length, &cached
+    );
+    if (rc == IB_OK) {
+        verdict = *cached;
+    }
+    else if (rc == IB_ENOENT || rc == IB_DECLINED) {
+        memset(&verdict, 0, sizeof(verdict));
+        /* Run through libinjection. */
+        // TODO: flags parameter is currently undocumented - using 0
+        if (libinjection_is_xss((const char *)ib_bytestr_const_ptr(bs), ib_bytestr_length(bs), 0)) {
+            verdict.result = 1;
+        }
+
+        if (rc == IB_ENOENT) {
+            rc = sqli_verdict_store(m, tx, key, key_length, &verdict);
+            if (rc != IB_OK) {
+                return rc;
+            }
+        }
+    }
+    else {
+        return rc;
+    }
+
+    if (verdict.result == 1) {
         ib_log_debug_tx(tx, "Matched XSS.");
         *result = 1;
     }
@@ -629,6 +860,22 @@ ib_status_t sqli_create_fingerprint_set_from_file(
         &sqli_cmp
     );
 
+    /* Index the entries for lookup; the first of duplicates wins. */
+    rc = ib_hash_create(&ps->index, mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    for (i = 0; i < ps->num_fingerprints; ++i) {
+        const sqli_fingerprint_entry_t *entry = &(ps->fingerprints[i]);
+        if (ib_hash_get(ps->index, NULL, entry->fingerprint) == IB_OK) {
+            continue;
+        }
+        rc = ib_hash_set(ps->index, entry->fingerprint, (void *)entry);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
     *out_ps = ps;
 
     return IB_OK;
@@ -769,7 +1016,7 @@ static ib_status_t sqli_init(ib_engine_t *ib, ib_module_t *m, void *cbdata)
         IB_OP_CAPABILITY_CAPTURE,
         sqli_op_create, m,
         NULL, NULL,
-        sqli_op_execute, NULL
+        sqli_op_execute, m
     );
     if (rc != IB_OK) {
         return rc;
@@ -783,7 +1030,7 @@ static ib_status_t sqli_init(ib_engine_t *ib, ib_module_t *m, void *cbdata)
         IB_OP_CAPABILITY_NONE,
         NULL, NULL,
         NULL, NULL,
-        xss_op_execute, NULL
+        xss_op_execute, m
     );
     if (rc != IB_OK) {
         return rc;
@@ -41,7 +41,6 @@
 #include <ironbee/escape.h>
 #include <ironbee/field.h>
 #include <ironbee/hash.h>
-#include <ironbee/mm_mpool_lite.h>
 #include <ironbee/path.h>
 #include <ironbee/queue.h>
 #include <ironbee/string.h>
@@ -412,65 +411,41 @@ static ib_status_t modlua_ownership_fn(
     assert(rule->ctx != NULL);
     assert(cbdata != NULL);
 
-    ib_status_t       rc;
-    ib_mpool_lite_t  *tmpmp;
-    ib_mm_t           tmpmm;
-    ib_list_t        *actions;
-
-    rc = ib_mpool_lite_create(&tmpmp);
-    if (rc != IB_OK) {
-        return rc;
-    }
-    tmpmm = ib_mm_mpool_lite(tmpmp);
-
-    rc = ib_list_create(&actions, tmpmm);
-    if (rc != IB_OK) {
-        goto cleanup;
-    }
+    ib_status_t         rc;
+    size_t              count;
+    const modlua_cfg_t *cfg    = NULL;
+    const ib_module_t  *module = (const ib_module_t *)cbdata;
 
+    /* Only count the actions; this is called for every rule. */
     rc = ib_rule_search_action(
         ib,
         rule,
         IB_RULE_ACTION_TRUE,
         g_modlua_waggle_action_name,
-        actions,
-        NULL
+        NULL,
+        &count
     );
     if (rc != IB_OK) {
         ib_log_notice(
             ib,
             "Cannot find action %s.",
             g_modlua_waggle_action_name);
-        goto cleanup;
+        return rc;
     }
 
-    if (ib_list_elements(actions) > 0) {
-
-        const modlua_cfg_t *cfg    = NULL;
-        const ib_module_t  *module = (const ib_module_t *)cbdata;
-
-        /* Fetch the module configuration. */
-        rc = ib_context_module_config(ctx, module, &cfg);
-        if (rc != IB_OK) {
-            ib_log_error(ib, "Cannot retrieve module configuration.");
-            rc = IB_OK;
-            goto cleanup;
-        }
-
-        /* Copy the rule into the waggle list for this context. */
-        rc = ib_list_push(cfg->waggle_rules, (void *)rule);
-        if (rc != IB_OK) {
-            goto cleanup;
-        }
+    if (count == 0) {
+        return IB_DECLINED;
+    }
 
-        rc = IB_OK;
-        goto cleanup;
+    /* Fetch the module configuration. */
+    rc = ib_context_module_config(ctx, module, &cfg);
+    if (rc != IB_OK) {
+        ib_log_error(ib, "Cannot retrieve module configuration.");
+        return IB_OK;
     }
 
-    rc = IB_DECLINED;
-cleanup:
-    ib_mpool_lite_destroy(tmpmp);
-    return rc;
+    /* Copy the rule into the waggle list for this context. */
+    return ib_list_push(cfg->waggle_rules, (void *)rule);
 }
 
 /**
@@ -590,12 +565,6 @@ static ib_status_t modlua_init(
         return rc;
     }
 
-    rc = ib_lock_create(&(cfg->lua_pool_lock), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib, "Failed to configure Lua resource pool lock.");
-        return rc;
-    }
-
     rc = modlua_runtime_resource_pool_create(
         &(cfg->lua_pool),
         ib,
@@ -1030,6 +999,29 @@ static ib_status_t modlua_dir_param1(
             return rc;
         }
     }
+    else if (strcasecmp("LuaGcStep", name) == 0) {
+        ib_num_t step;
+
+        rc = ib_type_atoi(p1, 10, &step);
+        if (rc != IB_OK) {
+            ib_cfg_log_error(
+                cp,
+                "Directive %s was not given an integer but \"%s\".",
+                name,
+                p1);
+            return rc;
+        }
+
+        rc = modlua_runtime_cfg_set_gc_step(cfg->lua_pool_cfg, step);
+        if (rc != IB_OK) {
+            ib_cfg_log_error(
+                cp,
+                "%s parameter must be a non-negative integer: %s",
+                name,
+                p1);
+            return rc;
+        }
+    }
     else if (strcasecmp("LuaStackMax", name) == 0) {
         ib_num_t limit;
 
@@ -1208,6 +1200,11 @@ static IB_DIRMAP_INIT_STRUCTURE(modlua_directive_map) = {
         modlua_dir_param1,
         NULL
     ),
+    IB_DIRMAP_INIT_PARAM1(
+        "LuaGcStep",
+        modlua_dir_param1,
+        NULL
+    ),
     IB_DIRMAP_INIT_PARAM1(
         "LuaStackMax",
         modlua_dir_param1,
@@ -26,8 +26,127 @@
 
 #include <ironbee/types.h>
 
+#include <lauxlib.h>
 #include <lua.h>
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Growing buffer that ib_lua_compile() dumps bytecode into.
+ */
+struct lua_chunk_buffer_t {
+    char   *data;   /**< Bytecode so far. */
+    size_t  length; /**< Length of bytecode so far. */
+    size_t  size;   /**< Allocated size of data. */
+};
+typedef struct lua_chunk_buffer_t lua_chunk_buffer_t;
+
+/**
+ * A lua_Writer that appends to a @ref lua_chunk_buffer_t.
+ *
+ * @param[in] L Lua state being dumped.
+ * @param[in] p Bytecode to append.
+ * @param[in] sz Length of @a p.
+ * @param[in] ud The @ref lua_chunk_buffer_t.
+ *
+ * @returns 0 on success and 1 on allocation failure.
+ */
+static int lua_chunk_writer(lua_State *L, const void *p, size_t sz, void *ud)
+{
+    lua_chunk_buffer_t *buffer = (lua_chunk_buffer_t *)ud;
+
+    if (buffer->length + sz > buffer->size) {
+        size_t  size = (buffer->size == 0) ? 4096 : buffer->size;
+        char   *data;
+
+        while (size < buffer->length + sz) {
+            size *= 2;
+        }
+
+        data = realloc(buffer->data, size);
+        if (data == NULL) {
+            return 1;
+        }
+        buffer->data = data;
+        buffer->size = size;
+    }
+
+    memcpy(buffer->data + buffer->length, p, sz);
+    buffer->length += sz;
+
+    return 0;
+}
+
+ib_status_t ib_lua_compile(
+    ib_engine_t  *ib,
+    ib_mm_t       mm,
+    const char   *file,
+    const char  **chunk,
+    size_t       *chunk_length
+)
+{
+    assert(ib           != NULL);
+    assert(file         != NULL);
+    assert(chunk        != NULL);
+    assert(chunk_length != NULL);
+
+    lua_State          *L;
+    lua_chunk_buffer_t  buffer = { NULL, 0, 0 };
+    int                 lua_rc;
+    char               *data;
+
+    /* Compiling needs no libraries, so a bare state is enough. */
+    L = luaL_newstate();
+    if (L == NULL) {
+        return IB_EALLOC;
+    }
+
+    lua_rc = luaL_loadfile(L, file);
+    if (lua_rc != 0) {
+        ib_log_debug(ib, "Not compiling \"%s\": %s",
+                     file,
+                     lua_tostring(L, -1));
+        lua_close(L);
+        return IB_EINVAL;
+    }
+
+    lua_rc = lua_dump(L, lua_chunk_writer, &buffer);
+    lua_close(L);
+    if (lua_rc != 0) {
+        free(buffer.data);
+        return IB_EALLOC;
+    }
+
+    data = ib_mm_memdup(mm, buffer.data, buffer.length);
+    free(buffer.data);
+    if (data == NULL) {
+        return IB_EALLOC;
+    }
+
+    *chunk        = data;
+    *chunk_length = buffer.length;
+
+    return IB_OK;
+}
+
+int ib_lua_loadfile(
+    lua_State  *L,
+    const char *file,
+    const char *chunk,
+    size_t      chunk_length
+)
+{
+    assert(L    != NULL);
+    assert(file != NULL);
+
+    if (chunk == NULL) {
+        return luaL_loadfile(L, file);
+    }
+
+    /* The chunk name is recorded in the bytecode; this is only a fallback. */
+    return luaL_loadbuffer(L, chunk, chunk_length, file);
+}
 
 ib_status_t ib_lua_load_eval(ib_engine_t *ib, lua_State *L, const char *file)
 {
@@ -87,7 +206,9 @@ ib_status_t ib_lua_load_func(
     ib_engine_t *ib,
     lua_State   *L,
     const char  *file,
-    const char  *func_name
+    const char  *func_name,
+    const char  *chunk,
+    size_t       chunk_length
 )
 {
     assert(ib        != NULL);
@@ -96,7 +217,7 @@ ib_status_t ib_lua_load_func(
     assert(func_name != NULL);
 
     /* Load (compile) the lua module. */
-    ib_status_t ib_rc = luaL_loadfile(L, file);
+    ib_status_t ib_rc = ib_lua_loadfile(L, file, chunk, chunk_length);
 
     if (ib_rc != 0) {
         ib_log_error(
@@ -49,6 +49,52 @@
  */
 ib_status_t ib_lua_load_eval(ib_engine_t *ib, lua_State *L, const char *file);
 
+/**
+ * Compile the Lua file @a file to bytecode.
+ *
+ * The bytecode may be loaded into any Lua state with ib_lua_loadfile(),
+ * which avoids reading and parsing @a file again for every state.
+ *
+ * @param[in] ib IronBee engine used to log.
+ * @param[in] mm Memory manager to allocate the bytecode from.
+ * @param[in] file File to compile.
+ * @param[out] chunk The bytecode.
+ * @param[out] chunk_length The length of @a chunk.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EINVAL If @a file can not be loaded.
+ * - IB_EALLOC On allocation errors.
+ */
+ib_status_t ib_lua_compile(
+    ib_engine_t  *ib,
+    ib_mm_t       mm,
+    const char   *file,
+    const char  **chunk,
+    size_t       *chunk_length
+);
+
+/**
+ * Load @a file onto the top of @a L as a function.
+ *
+ * This is luaL_loadfile() except that, if @a chunk is not NULL, the
+ * bytecode @a chunk produced by ib_lua_compile() for @a file is loaded
+ * instead of the file.
+ *
+ * @param[in,out] L The Lua state to load into.
+ * @param[in] file The file to load.
+ * @param[in] chunk Bytecode of @a file or NULL to read @a file.
+ * @param[in] chunk_length The length of @a chunk.
+ *
+ * @returns The return code of luaL_loadfile() or luaL_loadbuffer().
+ */
+int ib_lua_loadfile(
+    lua_State  *L,
+    const char *file,
+    const char *chunk,
+    size_t      chunk_length
+);
+
 /**
  * Add a lua rule stored in a file to the Ironbee engine.
  *
@@ -57,6 +103,8 @@ ib_status_t ib_lua_load_eval(ib_engine_t *ib, lua_State *L, const char *file);
  * @param[in] func_name The name the contents of the file will be stored
  *                      under.
  * @param[in] file The file that holds the Lua script that makes up the rule.
+ * @param[in] chunk Bytecode of @a file from ib_lua_compile() or NULL.
+ * @param[in] chunk_length The length of @a chunk.
  *
  * @returns
  * - IB_OK On success.
@@ -66,7 +114,9 @@ ib_status_t ib_lua_load_func(
     ib_engine_t *ib,
     lua_State   *L,
     const char  *file,
-    const char  *func_name
+    const char  *func_name,
+    const char  *chunk,
+    size_t       chunk_length
 );
 
 /**
@@ -2176,6 +2176,8 @@ exit:
  *            should be false, meaning @a ib already has all the
  *            directives defined.
  * @param[in] file The Lua file to load.
+ * @param[in] chunk Bytecode of @a file from ib_lua_compile() or NULL.
+ * @param[in] chunk_length The length of @a chunk.
  * @param[in] module The module structure being loaded.
  * @param[in] L The Lua stack and environment being loaded into.
  *
@@ -2187,15 +2189,19 @@ static ib_status_t modlua_load_module_push_stack(
     ib_engine_t *ib,
     bool         register_directives,
     const char  *file,
+    const char  *chunk,
+    size_t       chunk_length,
     ib_module_t *module,
     lua_State   *L
 )
-NONNULL_ATTRIBUTE(1, 3, 4, 5);
+NONNULL_ATTRIBUTE(1, 3, 6, 7);
 
 static ib_status_t modlua_load_module_push_stack(
     ib_engine_t *ib,
     bool         register_directives,
     const char  *file,
+    const char  *chunk,
+    size_t       chunk_length,
     ib_module_t *module,
     lua_State   *L
 )
@@ -2243,7 +2249,7 @@ static ib_status_t modlua_load_module_push_stack(
         lua_pushnil(L);
     }
 
-    lua_rc = luaL_loadfile(L, file);
+    lua_rc = ib_lua_loadfile(L, file, chunk, chunk_length);
     switch(lua_rc) {
         case 0:
             /* NOP */
@@ -2401,7 +2407,7 @@ static ib_status_t modlua_module_config_lua(
     ib_status_t rc;
 
     /* Load the stack with the register directives function. */
-    rc = modlua_load_module_push_stack(ib, true, file, module, L);
+    rc = modlua_load_module_push_stack(ib, true, file, NULL, 0, module, L);
     if (rc != IB_OK) {
         return rc;
     }
@@ -2418,6 +2424,8 @@ static ib_status_t modlua_module_config_lua(
 ib_status_t modlua_module_load_lua(
     ib_engine_t *ib,
     const char  *file,
+    const char  *chunk,
+    size_t       chunk_length,
     ib_module_t *module,
     lua_State   *L
 )
@@ -2430,7 +2438,14 @@ ib_status_t modlua_module_load_lua(
     ib_status_t rc;
 
     /* Load the stack without the register directives function. */
-    rc = modlua_load_module_push_stack(ib, false, file, module, L);
+    rc = modlua_load_module_push_stack(
+        ib,
+        false,
+        file,
+        chunk,
+        chunk_length,
+        module,
+        L);
     if (rc != IB_OK) {
         return rc;
     }
@@ -65,6 +65,8 @@ NONNULL_ATTRIBUTE(1, 2, 3, 4, 5);
  *
  * @param[in] ib IronBee engine.
  * @param[in] file The file we are loading.
+ * @param[in] chunk Bytecode of @a file from ib_lua_compile() or NULL.
+ * @param[in] chunk_length The length of @a chunk.
  * @param[in] module The registered module structure.
  * @param[in,out] L The lua context that @a file will be loaded into as
  *                @a module.
@@ -75,9 +77,11 @@ NONNULL_ATTRIBUTE(1, 2, 3, 4, 5);
 ib_status_t modlua_module_load_lua(
     ib_engine_t *ib,
     const char  *file,
+    const char  *chunk,
+    size_t       chunk_length,
     ib_module_t *module,
     lua_State   *L
 )
-NONNULL_ATTRIBUTE(1, 2, 3, 4);
+NONNULL_ATTRIBUTE(1, 2, 5, 6);
 
 #endif /* __MODULES__LUA_MODULES_PRIVATE_H */
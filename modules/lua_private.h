@@ -31,7 +31,6 @@
 #include "lua/ironbee.h"
 
 #include <ironbee/core.h>
-#include <ironbee/lock.h>
 #include <ironbee/module.h>
 #include <ironbee/release.h>
 #include <ironbee/resource_pool.h>
@@ -56,7 +55,6 @@ struct modlua_cfg_t {
     ib_list_t            *reloads;       /**< modlua_reload_t list. */
     ib_list_t            *waggle_rules;  /**< Waggle rules to execute. */
     ib_resource_pool_t   *lua_pool;      /**< Pool of Lua stacks. */
-    ib_lock_t            *lua_pool_lock; /**< Pool lock. */
     modlua_runtime_cfg_t *lua_pool_cfg;  /**< Pool configuration. */
     ib_resource_t        *lua_resource;  /**< Resource modlua_cfg_t::L. */
     lua_State            *L;             /**< Lua stack used for config. */
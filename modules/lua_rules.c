@@ -188,7 +188,8 @@ static ib_status_t modlua_rule_driver(
         cp->ib,
         cfg->L,
         location,
-        ib_rule_id(rule));
+        ib_rule_id(rule),
+        NULL, 0);
     if (rc != IB_OK) {
         ib_cfg_log_error(cp, "Failed to load lua file \"%s\"", location);
         return rc;
@@ -40,6 +40,7 @@
 #include <lualib.h>
 
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
 
 /* If LUA_BASE_PATH was not set as part of autoconf, define a default. */
@@ -64,6 +65,12 @@ struct modlua_runtime_cfg_t {
      * The limit on the number of times a Lua stack may be used.
      */
     ssize_t max_lua_stack_uses;
+
+    /**
+     * Size, in kilobytes, of the garbage collection step taken when a Lua
+     * stack is released.  Zero disables these steps.
+     */
+    int gc_step;
 };
 
 /**
@@ -353,6 +360,8 @@ static ib_status_t modlua_reload_ctx(
                 tmp_rc = modlua_module_load_lua(
                     ib,
                     reload->file,
+                    reload->chunk,
+                    reload->chunk_length,
                     reload->module,
                     L);
                 break;
@@ -361,7 +370,9 @@ static ib_status_t modlua_reload_ctx(
                     ib,
                     L,
                     reload->file,
-                    reload->rule_id);
+                    reload->rule_id,
+                    reload->chunk,
+                    reload->chunk_length);
                 break;
         }
 
@@ -424,6 +435,15 @@ ib_status_t modlua_record_reload(
         }
     }
 
+    /* Compile the file once; every Lua stack it is reloaded into then
+     * loads the bytecode.  On failure, reloading reads the file. */
+    data->chunk = NULL;
+    data->chunk_length = 0;
+    rc = ib_lua_compile(ib, mm, file, &(data->chunk), &(data->chunk_length));
+    if (rc != IB_OK) {
+        ib_log_debug(ib, "Reloading \"%s\" from source.", file);
+    }
+
     rc = ib_list_push(cfg->reloads, data);
     if (rc != IB_OK) {
         return rc;
@@ -668,6 +688,22 @@ ib_status_t modlua_runtime_cfg_set_stack_use_limit(
     return IB_OK;
 }
 
+ib_status_t modlua_runtime_cfg_set_gc_step(
+    modlua_runtime_cfg_t *cfg,
+    ib_num_t              step
+)
+{
+    assert(cfg != NULL);
+
+    if (step < 0 || step > INT_MAX) {
+        return IB_EINVAL;
+    }
+
+    cfg->gc_step = (int)step;
+
+    return IB_OK;
+}
+
 ib_status_t modlua_runtime_resource_pool_create(
     ib_resource_pool_t   **resource_pool,
     ib_engine_t           *ib,
@@ -716,6 +752,13 @@ ib_status_t modlua_runtime_resource_pool_create(
         return rc;
     }
 
+    /* Keep a couple of Lua stacks per worker thread. This also makes the
+     * pool safe to share between threads. */
+    rc = ib_resource_pool_thread_cache(*resource_pool, 2);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
     *cfg = &(modlua_runtime_cbdata->cfg);
 
     return IB_OK;
@@ -732,18 +775,14 @@ ib_status_t modlua_releasestate(
 
     ib_status_t rc;
 
-    rc = ib_lock_lock(cfg->lua_pool_lock);
-    if (rc != IB_OK) {
-        return rc;
+    /* Pay for some of the garbage of this use now, while the stack is idle,
+     * rather than leaving the collector to run in the middle of a rule of a
+     * later transaction. */
+    if (cfg->lua_pool_cfg->gc_step > 0) {
+        lua_gc(modlua_runtime->L, LUA_GCSTEP, cfg->lua_pool_cfg->gc_step);
     }
 
     rc = ib_resource_release(modlua_runtime->resource);
-    if (rc != IB_OK) {
-        ib_lock_unlock(cfg->lua_pool_lock);
-        return rc;
-    }
-
-    rc = ib_lock_unlock(cfg->lua_pool_lock);
     if (rc != IB_OK) {
         return rc;
     }
@@ -763,18 +802,7 @@ ib_status_t modlua_acquirestate(
     ib_status_t    rc;
     ib_resource_t *resource;
 
-    rc = ib_lock_lock(cfg->lua_pool_lock);
-    if (rc != IB_OK) {
-        return rc;
-    }
-
     rc = ib_resource_acquire(cfg->lua_pool, &resource);
-    if (rc != IB_OK) {
-        ib_lock_unlock(cfg->lua_pool_lock);
-        return rc;
-    }
-
-    rc = ib_lock_unlock(cfg->lua_pool_lock);
     if (rc != IB_OK) {
         return rc;
     }
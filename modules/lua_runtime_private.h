@@ -77,6 +77,8 @@ struct modlua_reload_t {
     ib_module_t          *module;  /**< Lua module (not ibmod_lua.so). */
     const char           *file;    /**< File of the rule or module code. */
     const char           *rule_id; /**< Rule if this is a rule type. */
+    const char           *chunk;   /**< Bytecode of file or NULL. */
+    size_t                chunk_length; /**< Length of chunk. */
 };
 typedef struct modlua_reload_t modlua_reload_t;
 
@@ -100,6 +102,28 @@ ib_status_t modlua_runtime_cfg_set_stack_use_limit(
 )
 NONNULL_ATTRIBUTE(1);
 
+/**
+ * Set the garbage collection step taken when a Lua stack is released.
+ *
+ * Each time a Lua stack is returned to the resource pool, an incremental
+ * collection step of @a step kilobytes is performed on it.  This bounds the
+ * collection work done per use and keeps it out of rule execution.
+ *
+ * @param[in] cfg The configuration object returned to the user by
+ *            modlua_runtime_resource_pool_create().
+ * @param[in] step The step size in kilobytes.  Zero disables the step and
+ *            leaves collection entirely to Lua.
+ *
+ * @return
+ * - IB_OK On success.
+ * - IB_EINVAL If @a step is negative or too large.
+ */
+ib_status_t modlua_runtime_cfg_set_gc_step(
+    modlua_runtime_cfg_t *cfg,
+    ib_num_t              step
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Create a resource pool that manages @ref modlua_runtime_t instances.
  *
@@ -179,7 +203,8 @@ ib_status_t modlua_reload_ctx_main(
  * @param[in] module For MODLUA_RELOAD_MODULE types this is a pointer
  *            to the Lua script's module structure.
  * @param[in] rule_id The rule id. This is copied.
- * @param[in] file Where is the Lua file to load. This is copied.
+ * @param[in] file Where is the Lua file to load. This is copied and
+ *            compiled so that reloading need not read and parse it again.
  */
 ib_status_t modlua_record_reload(
     ib_engine_t          *ib,
@@ -99,6 +99,8 @@ struct modhtp_config_t {
      */
     const ib_var_source_t  *htp_request_flags;  /**< Request flags src. */
     const ib_var_source_t  *htp_response_flags; /**< Response flags src. */
+    htp_cfg_t             **htp_configs;        /**< Parser configs by
+                                                 *   personality. */
 };
 typedef struct modhtp_config_t modhtp_config_t;
 
@@ -137,6 +139,7 @@ struct modhtp_txdata_t {
     int                         error_code;  /**< Error code from parser */
     const char                 *error_msg;   /**< Error message from parser */
     ib_flags_t                  flags;       /**< Various flags */
+    ib_field_t                 *cookies;     /**< Parsed request cookies */
 };
 typedef struct modhtp_txdata_t modhtp_txdata_t;
 
@@ -169,9 +172,13 @@ static modhtp_config_t modhtp_global_config = {
     "generic", /* personality */
     NULL,
     NULL,
+    NULL,
     NULL
 };
 
+/** Number of entries in modhtp_config_t::htp_configs. */
+#define MODHTP_NUM_PERSONALITIES (HTP_SERVER_APACHE_2 + 1)
+
 /* Keys to register as indexed except for HTP_{REQUEST,RESPONSE}_FLAGS. */
 static const char *indexed_keys[] = {
     "request_line",
@@ -1992,6 +1999,97 @@ static ib_status_t modhtp_gen_request_uri_fields(
     return IB_OK;
 }
 
+/**
+ * Dynamic field getter for the request cookies.
+ *
+ * The Cookie header is parsed and the cookie list built on the first call;
+ * later calls reuse the list.  If @a arg is given, only the cookies named
+ * @a arg (case insensitive) are returned.
+ *
+ * @param[in] field The request cookies field
+ * @param[out] out_pval Where to write the list (const ib_list_t **)
+ * @param[in] arg Cookie name or NULL for all cookies
+ * @param[in] alen Length of @a arg
+ * @param[in] data Transaction data (modhtp_txdata_t *)
+ *
+ * @returns Status code
+ */
+static ib_status_t modhtp_request_cookies_get(
+    const ib_field_t *field,
+    void             *out_pval,
+    const void       *arg,
+    size_t            alen,
+    void             *data)
+{
+    assert(field != NULL);
+    assert(out_pval != NULL);
+    assert(data != NULL);
+
+    modhtp_txdata_t      *txdata = (modhtp_txdata_t *)data;
+    ib_tx_t              *itx = txdata->itx;
+    const ib_list_t      *cookies;
+    const ib_list_node_t *node;
+    ib_list_t            *result;
+    ib_status_t           rc;
+
+    if (txdata->cookies == NULL) {
+        ib_field_t *flist;
+
+        rc = ib_field_create(&flist, itx->mm, IB_S2SL("request_cookies"),
+                             IB_FTYPE_LIST, NULL);
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+        /* The libhtp transaction is gone once the IronBee one finishes. */
+        if ( (txdata->htx != NULL) &&
+             (htp_tx_req_parse_cookies(txdata->htx) == HTP_OK) &&
+             (txdata->htx->request_cookies != NULL) )
+        {
+            rc = modhtp_table_iterator(itx, txdata->htx->request_cookies,
+                                       modhtp_field_list_callback, flist);
+            if (rc != IB_OK) {
+                ib_log_warning_tx(itx, "Error adding request cookies.");
+            }
+        }
+        else {
+            ib_log_debug2_tx(itx, "No request cookies.");
+        }
+        txdata->cookies = flist;
+    }
+
+    rc = ib_field_value(txdata->cookies, ib_ftype_list_out(&cookies));
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    if (arg == NULL) {
+        *(const ib_list_t **)out_pval = cookies;
+        return IB_OK;
+    }
+
+    rc = ib_list_create(&result, itx->mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    IB_LIST_LOOP_CONST(cookies, node) {
+        const ib_field_t *cookie =
+            (const ib_field_t *)ib_list_node_data_const(node);
+
+        if ( (cookie->nlen == alen) &&
+             (strncasecmp(cookie->name, (const char *)arg, alen) == 0) )
+        {
+            rc = ib_list_push(result, (void *)cookie);
+            if (rc != IB_OK) {
+                return rc;
+            }
+        }
+    }
+    *(const ib_list_t **)out_pval = result;
+
+    return IB_OK;
+}
+
 /**
  * Generate IronBee request header fields
  *
@@ -2006,10 +2104,11 @@ static ib_status_t modhtp_gen_request_header_fields(
     assert(txdata->itx != NULL);
     assert(txdata->htx != NULL);
 
-    ib_field_t  *f;
-    ib_status_t  rc;
-    ib_tx_t     *itx = txdata->itx;
-    htp_tx_t    *htx = txdata->htx;
+    ib_field_t      *f;
+    ib_var_source_t *source;
+    ib_status_t      rc;
+    ib_tx_t         *itx = txdata->itx;
+    htp_tx_t        *htx = txdata->htx;
 
     modhtp_field_gen_bstr(itx, "request_line",
                           htx->request_line, false, NULL);
@@ -2018,19 +2117,29 @@ static ib_status_t modhtp_gen_request_header_fields(
                              IB_S2SL(itx->hostname == NULL ? "" : itx->hostname),
                              false, NULL);
 
-    rc = modhtp_get_or_create_list(itx, "request_cookies", &f);
-    if ( (htx->request_cookies != NULL) &&
-         htp_table_size(htx->request_cookies) &&
-         (rc == IB_OK) )
-    {
-        rc = modhtp_table_iterator(itx, htx->request_cookies,
-                                   modhtp_field_list_callback, f);
-        if (rc != IB_OK) {
-            ib_log_warning_tx(itx, "Error adding request cookies.");
-        }
+    /* Cookies are parsed the first time they are used. */
+    rc = ib_var_source_acquire(
+        &source,
+        itx->mm,
+        ib_engine_var_config_get(itx->ib),
+        IB_S2SL("request_cookies")
+    );
+    if (rc == IB_OK) {
+        rc = ib_field_create_dynamic(
+            &f,
+            itx->mm,
+            IB_S2SL("request_cookies"),
+            IB_FTYPE_LIST,
+            modhtp_request_cookies_get, (void *)txdata,
+            NULL, NULL
+        );
+    }
+    if (rc == IB_OK) {
+        rc = ib_var_source_set(source, itx->var_store, f);
     }
-    else if (rc == IB_OK) {
-        ib_log_debug2_tx(itx, "No request cookies.");
+    if (rc != IB_OK) {
+        ib_log_error_tx(itx, "Error creating request cookies: %s",
+                        ib_status_to_string(rc));
     }
 
     return IB_OK;
@@ -2120,9 +2229,59 @@ static ib_status_t modhtp_gen_response_fields(
     return IB_OK;
 }
 
+/**
+ * Create and populate a parser configuration
+ *
+ * @param[in] personality libhtp personality
+ *
+ * @returns The configuration or NULL on allocation failure.
+ */
+static htp_cfg_t *modhtp_build_htp_config(int personality)
+{
+    htp_cfg_t *htp_config;
+
+    /* Create a parser configuration. */
+    htp_config = htp_config_create();
+    if (htp_config == NULL) {
+        return NULL;
+    }
+
+    /* Fill in the configuration */
+    htp_config_set_server_personality(htp_config, personality);
+
+    /* @todo Make all these configurable??? */
+    htp_config->log_level = HTP_LOG_DEBUG2;
+    htp_config_set_tx_auto_destroy(htp_config, 0);
+
+    htp_config_register_urlencoded_parser(htp_config);
+    htp_config_register_multipart_parser(htp_config);
+    htp_config_register_log(htp_config, modhtp_htp_log);
+
+    /* Cookies are parsed on demand; see modhtp_request_cookies_get(). */
+    htp_config->parse_request_cookies = 0;
+
+    /* Register libhtp callbacks. */
+    htp_config_register_request_start(htp_config, modhtp_htp_req_start);
+    htp_config_register_request_line(htp_config, modhtp_htp_req_line);
+    htp_config_register_request_headers(htp_config, modhtp_htp_req_headers);
+    htp_config_register_request_body_data(htp_config, modhtp_htp_req_body_data);
+    htp_config_register_request_trailer(htp_config, modhtp_htp_req_trailer);
+    htp_config_register_request_complete(htp_config, modhtp_htp_req_complete);
+    htp_config_register_response_line(htp_config, modhtp_htp_rsp_line);
+    htp_config_register_response_headers(htp_config, modhtp_htp_rsp_headers);
+    htp_config_register_response_body_data(htp_config, modhtp_htp_rsp_body_data);
+    htp_config_register_response_trailer(htp_config, modhtp_htp_rsp_trailer);
+    htp_config_register_response_complete(htp_config, modhtp_htp_rsp_complete);
+
+    return htp_config;
+}
+
 /**
  * Create and populate a module configuration context object
  *
+ * Parser configurations depend only on the personality, so contexts with
+ * the same personality share one, created by the first of them to close.
+ *
  * @param[in] ib IronBee engine
  * @param[in] mm Memory manager to use for allocations
  * @param[in] mod_config modhtp configuration structure
@@ -2155,40 +2314,19 @@ static ib_status_t modhtp_build_context (
     context->ib = ib;
     context->mod_config = mod_config;
 
-    /* Create a parser configuration. */
-    htp_config = htp_config_create();
+    /* Find or create the parser configuration. */
+    assert(mod_config->htp_configs != NULL);
+    assert(personality >= 0 && personality < MODHTP_NUM_PERSONALITIES);
+    htp_config = mod_config->htp_configs[personality];
     if (htp_config == NULL) {
-        return IB_EALLOC;
+        htp_config = modhtp_build_htp_config(personality);
+        if (htp_config == NULL) {
+            return IB_EALLOC;
+        }
+        mod_config->htp_configs[personality] = htp_config;
     }
     context->htp_config = htp_config;
 
-    /* Fill in the configuration */
-    htp_config_set_server_personality(htp_config, personality);
-
-    /* @todo Make all these configurable??? */
-    htp_config->log_level = HTP_LOG_DEBUG2;
-    htp_config_set_tx_auto_destroy(htp_config, 0);
-
-    htp_config_register_urlencoded_parser(htp_config);
-    htp_config_register_multipart_parser(htp_config);
-    htp_config_register_log(htp_config, modhtp_htp_log);
-
-    /* Cookies */
-    htp_config->parse_request_cookies = 1;
-
-    /* Register libhtp callbacks. */
-    htp_config_register_request_start(htp_config, modhtp_htp_req_start);
-    htp_config_register_request_line(htp_config, modhtp_htp_req_line);
-    htp_config_register_request_headers(htp_config, modhtp_htp_req_headers);
-    htp_config_register_request_body_data(htp_config, modhtp_htp_req_body_data);
-    htp_config_register_request_trailer(htp_config, modhtp_htp_req_trailer);
-    htp_config_register_request_complete(htp_config, modhtp_htp_req_complete);
-    htp_config_register_response_line(htp_config, modhtp_htp_rsp_line);
-    htp_config_register_response_headers(htp_config, modhtp_htp_rsp_headers);
-    htp_config_register_response_body_data(htp_config, modhtp_htp_rsp_body_data);
-    htp_config_register_response_trailer(htp_config, modhtp_htp_rsp_trailer);
-    htp_config_register_response_complete(htp_config, modhtp_htp_rsp_complete);
-
     *pcontext = context;
     return IB_OK;
 }
@@ -2735,6 +2873,12 @@ ib_status_t modhtp_request_body_data(
         return IB_OK;
     }
 
+    /* The body of an allowed request is not inspected, so there is no
+     * need to parse it. */
+    if (ib_flags_any(itx->flags, IB_TX_FALLOW_ALL | IB_TX_FALLOW_REQUEST)) {
+        return IB_OK;
+    }
+
     /* Fetch the transaction data */
     txdata = modhtp_get_txdata_ibtx(m, itx);
 
@@ -3007,6 +3151,12 @@ ib_status_t modhtp_response_body_data(
         return IB_OK;
     }
 
+    /* The body of an allowed response is not inspected, so there is no
+     * need to decompress it. */
+    if (ib_flags_all(itx->flags, IB_TX_FALLOW_ALL)) {
+        return IB_OK;
+    }
+
     /* Fetch the transaction data */
     txdata = modhtp_get_txdata_ibtx(m, itx);
 
@@ -3115,53 +3265,20 @@ ib_status_t modhtp_context_close(
 }
 
 /**
- * Handle IronBee context destroy
- *
- * @param[in] ib The IronBee engine
- * @param[in] ctx The IronBee context
- * @param[in] state State
- * @param[in] cbdata Module-specific context-destroy callback data (module data)
+ * Destroy the parser configurations
  *
- * @returns Status code
+ * @param[in] cbdata Parser configurations.
  */
-static
-ib_status_t modhtp_context_destroy(
-    ib_engine_t  *ib,
-    ib_context_t *ctx,
-    ib_state_t    state,
-    void         *cbdata
-)
+static void modhtp_htp_configs_cleanup(void *cbdata)
 {
-    assert(ib != NULL);
-    assert(ctx != NULL);
-    assert(state == context_destroy_state);
-    assert(cbdata != NULL);
+    htp_cfg_t **htp_configs = (htp_cfg_t **)cbdata;
 
-    ib_status_t         rc;
-    modhtp_config_t    *config;
-    modhtp_context_t   *modctx;
-    ib_module_t        *module = (ib_module_t *)cbdata;
-
-    if (ib_context_type_check(ctx, IB_CTYPE_ENGINE)) {
-        return IB_OK;
-    }
-
-    /* Get the module config. */
-    rc = ib_context_module_config(ctx, module, (void *)&config);
-    if (rc != IB_OK) {
-        ib_log_error(ib, "Error fetching module %s config: %s",
-                     MODULE_NAME_STR, ib_status_to_string(rc));
-        return rc;
-    }
-
-    /* Destroy the context */
-    modctx = (modhtp_context_t *)config->context; /* cast away const-ness */
-    if ( (modctx != NULL) && (modctx->htp_config != NULL) ) {
-        htp_config_destroy((htp_cfg_t *)modctx->htp_config);
-        modctx->htp_config = NULL;
+    for (int i = 0; i < MODHTP_NUM_PERSONALITIES; ++i) {
+        if (htp_configs[i] != NULL) {
+            htp_config_destroy(htp_configs[i]);
+            htp_configs[i] = NULL;
+        }
     }
-
-    return IB_OK;
 }
 
 /**
@@ -3204,15 +3321,22 @@ static ib_status_t modhtp_init(ib_engine_t *ib,
     }
 
 
-    /* Register hooks */
-    /* Register the context close/destroy function */
-    rc = ib_hook_context_register(ib, context_close_state,
-                                  modhtp_context_close, m);
+    /* Parser configurations are shared by all contexts of the engine. */
+    modconfig->htp_configs =
+        ib_mm_calloc(mm, MODHTP_NUM_PERSONALITIES, sizeof(htp_cfg_t *));
+    if (modconfig->htp_configs == NULL) {
+        return IB_EALLOC;
+    }
+    rc = ib_mm_register_cleanup(mm, modhtp_htp_configs_cleanup,
+                                modconfig->htp_configs);
     if (rc != IB_OK) {
         return rc;
     }
-    rc = ib_hook_context_register(ib, context_destroy_state,
-                                  modhtp_context_destroy, m);
+
+    /* Register hooks */
+    /* Register the context close function */
+    rc = ib_hook_context_register(ib, context_close_state,
+                                  modhtp_context_close, m);
     if (rc != IB_OK) {
         return rc;
     }
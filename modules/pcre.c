@@ -32,6 +32,8 @@
 #include <ironbee/mm.h>
 #include <ironbee/module.h>
 #include <ironbee/operator.h>
+#include <ironbee/path.h>
+#include <ironbee/resource_pool.h>
 #include <ironbee/rule_engine.h>
 #include <ironbee/string.h>
 #include <ironbee/transformation.h>
@@ -45,6 +47,8 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -52,6 +56,7 @@
 #include <strings.h>
 #include <time.h>
 #include <limits.h>
+#include <unistd.h>
 
 /* Define the module name as well as a string version of it. */
 #define MODULE_NAME        pcre
@@ -75,6 +80,9 @@
  */
 #define WORKSPACE_SIZE_DEFAULT (WORKSPACE_SIZE_MIN * 10)
 
+/* Shortest required literal worth searching for before matching. */
+#define LITERAL_LENGTH_MIN     (2)
+
 /* Define the public module symbol. */
 IB_MODULE_DECLARE();
 
@@ -103,6 +111,7 @@ struct modpcre_cpat_data_t {
     bool                 is_dfa;          /**< Is this a DFA? */
     bool                 is_jit;          /**< Is this JIT compiled? */
     int                  dfa_ws_size;     /**< Size of DFA workspace */
+    const ib_strsearch_t *literal;        /**< Required literal or NULL */
 };
 typedef struct modpcre_cpat_data_t modpcre_cpat_data_t;
 
@@ -126,6 +135,31 @@ static modpcre_cfg_t modpcre_global_cfg = {
     WORKSPACE_SIZE_DEFAULT /* dfa_workspace_size. */
 };
 
+/**
+ * Match scratch space reused across transactions.
+ *
+ * Allocating a JIT stack is expensive relative to a match, so scratch space
+ * is kept in a resource pool (@c ib_module_t::data) with a per-thread cache
+ * and lent to one transaction at a time.
+ */
+struct pcre_scratch_t {
+    pcre_jit_stack *stack;               /**< JIT stack; may be NULL. */
+    ib_num_t        jit_stack_start;     /**< Start size of @ref stack. */
+    ib_num_t        jit_stack_max;       /**< Max size of @ref stack. */
+    int             ovector[MATCH_MAX * 3]; /**< Capture buffer. */
+};
+typedef struct pcre_scratch_t pcre_scratch_t;
+
+/**
+ * Module state, held in @c ib_module_t::data.
+ */
+struct modpcre_data_t {
+    ib_resource_pool_t *scratch_pool;  /**< Pool of pcre_scratch_t. */
+    ib_hash_t          *pattern_cache; /**< Compiled patterns by key. */
+    const char         *bundle_dir;    /**< PcreCompiledCache or NULL. */
+};
+typedef struct modpcre_data_t modpcre_data_t;
+
 /* State information for a PCRE work common to all pcre operators in a tx. */
 struct pcre_tx_data_t {
     pcre_jit_stack *stack;
@@ -142,6 +176,87 @@ static void pcre_jit_stack_cleanup(void *stack) {
 }
 #endif
 
+/**
+ * Create scratch space for the scratch resource pool.
+ *
+ * The JIT stack is sized by the main context configuration.
+ *
+ * @param[out] resource The created @ref pcre_scratch_t.
+ * @param[in] cbdata The PCRE module.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ * - Other if the module configuration can not be fetched.
+ */
+static ib_status_t pcre_scratch_create(void *resource, void *cbdata)
+{
+    assert(resource != NULL);
+    assert(cbdata != NULL);
+
+    const ib_module_t *m = (const ib_module_t *)cbdata;
+    modpcre_cfg_t     *config;
+    pcre_scratch_t    *scratch;
+    ib_status_t        rc;
+
+    rc = ib_context_module_config(ib_context_main(m->ib), m, &config);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    scratch = malloc(sizeof(*scratch));
+    if (scratch == NULL) {
+        return IB_EALLOC;
+    }
+
+    scratch->stack = NULL;
+    scratch->jit_stack_start = config->jit_stack_start;
+    scratch->jit_stack_max = config->jit_stack_max;
+#ifdef PCRE_HAVE_JIT
+    /* A null stack is left for the tx to report. */
+    scratch->stack = pcre_jit_stack_alloc(
+        config->jit_stack_start,
+        config->jit_stack_max
+    );
+#endif
+
+    *(void **)resource = scratch;
+
+    return IB_OK;
+}
+
+/**
+ * Destroy scratch space of the scratch resource pool.
+ *
+ * @param[in] resource The @ref pcre_scratch_t.
+ * @param[in] cbdata Unused.
+ */
+static void pcre_scratch_destroy(void *resource, void *cbdata)
+{
+    assert(resource != NULL);
+
+    pcre_scratch_t *scratch = (pcre_scratch_t *)resource;
+
+#ifdef PCRE_HAVE_JIT
+    if (scratch->stack != NULL) {
+        pcre_jit_stack_free(scratch->stack);
+    }
+#endif
+    free(scratch);
+}
+
+/**
+ * Return scratch space to its pool when the transaction is destroyed.
+ *
+ * @param[in] resource The @c ib_resource_t holding the scratch space.
+ */
+static void pcre_scratch_release(void *resource)
+{
+    assert(resource != NULL);
+
+    ib_resource_release((ib_resource_t *)resource);
+}
+
 
 /**
  * A custom logger to log a regex pattern and a field with a message.
@@ -220,7 +335,9 @@ static void pcre_log_tx(
 /**
  * Get or create an ib_hash_t inside of @c tx for storing dfa rule data.
  *
- * The hash is stored at the key @c HASH_NAME_STR.
+ * The hash is stored at the key @c HASH_NAME_STR.  The capture buffer and
+ * JIT stack are borrowed from the module scratch pool until @a tx is
+ * destroyed.
  *
  * @param[in] m  PCRE module.
  * @param[in] tx The transaction containing @c tx->data which holds
@@ -243,6 +360,7 @@ ib_status_t get_or_create_operator_data(
 
     ib_status_t     rc;
     pcre_tx_data_t *data_tmp;
+    pcre_scratch_t *scratch;
 
     /* Get or create the hash that contains the rule data. */
     rc = ib_tx_get_module_data(tx, m, data);
@@ -268,25 +386,9 @@ ib_status_t get_or_create_operator_data(
         }
     }
 
-    /* Create capture buffer that DFA and PCRE may use. */
-    {
-        /* We could statically allocate this but it is "cheap" to leave
-         * dynamic and allows us to tweak match size later.
-         * For now it remains at 10. */
-        data_tmp->ovector_sz = 10 * 3;
-        data_tmp->ovector = (int *)ib_mm_alloc(
-            tx->mm,
-            data_tmp->ovector_sz*sizeof(*data_tmp->ovector)
-        );
-
-        if (data_tmp->ovector == NULL) {
-            return IB_EALLOC;
-        }
-    }
-
-    /* Initialize the PCRE JIT Stack for the TX. */
-#ifdef PCRE_HAVE_JIT
+    /* Borrow scratch space for the capture buffer and JIT stack. */
     {
+        ib_resource_t  *resource;
         modpcre_cfg_t  *config;
 
         rc = ib_context_module_config(tx->ctx, m, &config);
@@ -295,10 +397,54 @@ ib_status_t get_or_create_operator_data(
             return rc;
         }
 
-        data_tmp->stack = pcre_jit_stack_alloc(
-            config->jit_stack_start,
-            config->jit_stack_max
+        rc = ib_resource_acquire(
+            ((const modpcre_data_t *)m->data)->scratch_pool,
+            &resource
         );
+        if (rc != IB_OK) {
+            ib_log_error_tx(tx, "Cannot acquire pcre scratch space.");
+            return rc;
+        }
+
+        rc = ib_mm_register_cleanup(tx->mm, pcre_scratch_release, resource);
+        if (rc != IB_OK) {
+            ib_resource_release(resource);
+            return rc;
+        }
+
+        scratch = (pcre_scratch_t *)ib_resource_get(resource);
+        data_tmp->ovector = scratch->ovector;
+        data_tmp->ovector_sz = sizeof(scratch->ovector) /
+                               sizeof(*scratch->ovector);
+        data_tmp->stack = NULL;
+
+#ifdef PCRE_HAVE_JIT
+        /* The pooled stack is sized for the main context; contexts that
+         * configure another size get a stack of their own. */
+        if (
+            scratch->jit_stack_start == config->jit_stack_start &&
+            scratch->jit_stack_max == config->jit_stack_max
+        ) {
+            data_tmp->stack = scratch->stack;
+        }
+        else {
+            data_tmp->stack = pcre_jit_stack_alloc(
+                config->jit_stack_start,
+                config->jit_stack_max
+            );
+            if (data_tmp->stack != NULL) {
+                rc = ib_mm_register_cleanup(
+                    tx->mm,
+                    pcre_jit_stack_cleanup,
+                    data_tmp->stack
+                );
+                if (rc != IB_OK) {
+                    pcre_jit_stack_free(data_tmp->stack);
+                    return rc;
+                }
+            }
+        }
+
         /* A null stack is extremely unexpected, but not fatal.
          * JIT can use a callstack in a threadsafe way. */
         if (data_tmp->stack == NULL) {
@@ -309,19 +455,8 @@ ib_status_t get_or_create_operator_data(
                 (int)config->jit_stack_max
             );
         }
-        else {
-            rc = ib_mm_register_cleanup(
-                tx->mm,
-                pcre_jit_stack_cleanup,
-                data_tmp->stack
-            );
-            if (rc != IB_OK) {
-                pcre_jit_stack_free(data_tmp->stack);
-                return rc;
-            }
-        }
-    }
 #endif
+    }
 
     *data = data_tmp;
 
@@ -342,8 +477,215 @@ static void pcre_free_study_wrapper(void *edata)
     }
 }
 
+/* Magic string at the start of a compiled pattern file. */
+static const char c_bundle_magic[8] = "IBPCRE1";
+
+/**
+ * Header of a compiled pattern file.
+ *
+ * The header is followed by the pattern text and then by the compiled
+ * pattern.  Files are only valid on hosts with the same byte order and
+ * PCRE version as the host that wrote them; others are recompiled.
+ */
+struct pcre_bundle_header_t {
+    char     magic[8];          /**< c_bundle_magic */
+    char     pcre_version[32];  /**< pcre_version() of the writer */
+    uint32_t pattern_length;    /**< Length of the pattern text */
+    uint32_t compiled_length;   /**< Length of the compiled pattern */
+};
+typedef struct pcre_bundle_header_t pcre_bundle_header_t;
+
+/**
+ * Path of the compiled pattern file for @a patt in @a dir.
+ *
+ * @param[in] mm Memory manager to allocate the path from.
+ * @param[in] dir PcreCompiledCache directory.
+ * @param[in] patt Uncompiled pattern.
+ *
+ * @returns Path or NULL on allocation failure.
+ */
+static char *pcre_bundle_path(ib_mm_t mm, const char *dir, const char *patt)
+{
+    size_t   patt_len = strlen(patt);
+    uint32_t h1 = ib_hashfunc_djb2(patt, patt_len, 0, NULL);
+    uint32_t h2 = ib_hashfunc_djb2(patt, patt_len, 0x9e3779b9, NULL);
+    size_t   len = strlen(dir) + sizeof("/0123456789abcdef.pcre");
+    char    *path = ib_mm_alloc(mm, len);
+
+    if (path != NULL) {
+        snprintf(path, len, "%s/%08" PRIx32 "%08" PRIx32 ".pcre", dir, h1, h2);
+    }
+
+    return path;
+}
+
+/**
+ * Load the compiled pattern for @a patt from @a path.
+ *
+ * @param[in] path Compiled pattern file.
+ * @param[in] patt Uncompiled pattern.
+ * @param[out] pcpatt Compiled pattern, allocated with pcre_malloc().
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_ENOENT if there is no usable file for @a patt at @a path.
+ * - IB_EALLOC on allocation failure.
+ */
+static ib_status_t pcre_bundle_load(
+    const char  *path,
+    const char  *patt,
+    pcre       **pcpatt
+)
+{
+    pcre_bundle_header_t header;
+    size_t               patt_len = strlen(patt);
+    size_t               size;
+    char                *stored_patt = NULL;
+    pcre                *cpatt = NULL;
+    FILE                *fp;
+    ib_status_t          rc = IB_ENOENT;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return IB_ENOENT;
+    }
+
+    if (
+        fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, c_bundle_magic, sizeof(header.magic)) != 0 ||
+        strncmp(header.pcre_version, pcre_version(),
+                sizeof(header.pcre_version)) != 0 ||
+        header.pattern_length != patt_len ||
+        header.compiled_length == 0
+    ) {
+        goto finish;
+    }
+
+    /* Guard against hash collisions. */
+    stored_patt = malloc(patt_len + 1);
+    if (stored_patt == NULL) {
+        rc = IB_EALLOC;
+        goto finish;
+    }
+    if (
+        fread(stored_patt, 1, patt_len, fp) != patt_len ||
+        memcmp(stored_patt, patt, patt_len) != 0
+    ) {
+        goto finish;
+    }
+
+    cpatt = (pcre *)pcre_malloc(header.compiled_length);
+    if (cpatt == NULL) {
+        rc = IB_EALLOC;
+        goto finish;
+    }
+    if (fread(cpatt, 1, header.compiled_length, fp) !=
+        header.compiled_length)
+    {
+        goto finish;
+    }
+
+    /* PCRE checks the magic number and byte order of the pattern. */
+    if (
+        pcre_fullinfo(cpatt, NULL, PCRE_INFO_SIZE, &size) != 0 ||
+        size != header.compiled_length
+    ) {
+        goto finish;
+    }
+
+    *pcpatt = cpatt;
+    cpatt = NULL;
+    rc = IB_OK;
+
+finish:
+    if (cpatt != NULL) {
+        pcre_free(cpatt);
+    }
+    free(stored_patt);
+    fclose(fp);
+
+    return rc;
+}
+
+/**
+ * Save the compiled pattern @a cpatt for @a patt to @a path.
+ *
+ * The file is written under a temporary name and renamed, so that engines
+ * loading the directory concurrently never see a partial file.
+ *
+ * @param[in] mm Memory manager for temporary allocations.
+ * @param[in] path Compiled pattern file.
+ * @param[in] patt Uncompiled pattern.
+ * @param[in] cpatt Compiled pattern.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ * - IB_EOTHER on file system errors; see @c errno.
+ */
+static ib_status_t pcre_bundle_save(
+    ib_mm_t     mm,
+    const char *path,
+    const char *patt,
+    const pcre *cpatt
+)
+{
+    pcre_bundle_header_t header;
+    size_t               patt_len = strlen(patt);
+    size_t               size;
+    char                *tmp_path;
+    size_t               tmp_len;
+    int                  fd;
+    FILE                *fp;
+    bool                 ok;
+
+    if (pcre_fullinfo(cpatt, NULL, PCRE_INFO_SIZE, &size) != 0) {
+        return IB_EOTHER;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, c_bundle_magic, sizeof(header.magic));
+    strncpy(header.pcre_version, pcre_version(),
+            sizeof(header.pcre_version) - 1);
+    header.pattern_length = (uint32_t)patt_len;
+    header.compiled_length = (uint32_t)size;
+
+    tmp_len = strlen(path) + sizeof(".XXXXXX");
+    tmp_path = ib_mm_alloc(mm, tmp_len);
+    if (tmp_path == NULL) {
+        return IB_EALLOC;
+    }
+    snprintf(tmp_path, tmp_len, "%s.XXXXXX", path);
+
+    fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        return IB_EOTHER;
+    }
+    fp = fdopen(fd, "wb");
+    if (fp == NULL) {
+        close(fd);
+        unlink(tmp_path);
+        return IB_EOTHER;
+    }
+
+    ok =
+        fwrite(&header, sizeof(header), 1, fp) == 1 &&
+        fwrite(patt, 1, patt_len, fp) == patt_len &&
+        fwrite(cpatt, 1, size, fp) == size;
+    ok = (fclose(fp) == 0) && ok;
+    if (! ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return IB_EOTHER;
+    }
+
+    return IB_OK;
+}
+
 /**
  * Given cpdata, populate cdata and cdata_sz.
+ *
+ * If PcreCompiledCache is set, the compiled pattern is loaded from the
+ * cache directory if there and saved to it if not.
  */
 static ib_status_t compile_pattern(
     ib_engine_t         *ib,
@@ -357,15 +699,51 @@ static ib_status_t compile_pattern(
     /* How cpatt is produced. */
     const int compile_flags = PCRE_DOTALL | PCRE_DOLLAR_ENDONLY;
 
-    pcre *cpatt;
+    const modpcre_data_t *data = NULL;
+    char *bundle_path = NULL;
+    pcre *cpatt = NULL;
+    ib_status_t rc;
+
+    if (cpdata->module != NULL) {
+        data = (const modpcre_data_t *)cpdata->module->data;
+    }
+    if (data != NULL && data->bundle_dir != NULL) {
+        bundle_path = pcre_bundle_path(mm, data->bundle_dir, patt);
+        if (bundle_path == NULL) {
+            return IB_EALLOC;
+        }
+        rc = pcre_bundle_load(bundle_path, patt, &cpatt);
+        if (rc == IB_OK) {
+            ib_log_debug(ib, "Loaded compiled PCRE pattern \"%s\" from %s.",
+                         patt, bundle_path);
+        }
+        else if (rc != IB_ENOENT) {
+            return rc;
+        }
+    }
 
     /* Common to all code, compile. */
-    cpatt = pcre_compile(patt, compile_flags, errptr, erroffset, NULL);
-    if (*errptr != NULL) {
-        ib_log_error(ib, "Error compiling PCRE pattern \"%s\": %s at offset %d",
-                     patt, *errptr, *erroffset);
-        return IB_EINVAL;
+    if (cpatt == NULL) {
+        cpatt = pcre_compile(patt, compile_flags, errptr, erroffset, NULL);
+        if (*errptr != NULL) {
+            ib_log_error(ib,
+                         "Error compiling PCRE pattern \"%s\": %s at offset %d",
+                         patt, *errptr, *erroffset);
+            return IB_EINVAL;
+        }
+
+        if (bundle_path != NULL) {
+            rc = pcre_bundle_save(mm, bundle_path, patt, cpatt);
+            if (rc != IB_OK) {
+                ib_log_notice(ib,
+                              "Failed to save compiled PCRE pattern to %s: %s",
+                              bundle_path,
+                              (rc == IB_EOTHER) ?
+                                  strerror(errno) : ib_status_to_string(rc));
+            }
+        }
     }
+    *errptr = NULL;
     ib_mm_register_cleanup(mm, pcre_free, cpatt);
 
     /* Alias cpatt as the read-only cpatt value. */
@@ -381,6 +759,300 @@ static ib_status_t compile_pattern(
     return IB_OK;
 }
 
+/**
+ * Find the length of a counted quantifier, e.g., @c {2,5}.
+ *
+ * @param[in] p Pattern text starting at the opening brace.
+ *
+ * @returns Length of the quantifier or 0 if @a p is not one, in which case
+ *          the brace is a literal.
+ */
+static size_t counted_quantifier_length(const char *p)
+{
+    const char *q = p + 1;
+
+    if (! isdigit((unsigned char)*q)) {
+        return 0;
+    }
+    while (isdigit((unsigned char)*q)) {
+        ++q;
+    }
+    if (*q == ',') {
+        ++q;
+        while (isdigit((unsigned char)*q)) {
+            ++q;
+        }
+    }
+    if (*q != '}') {
+        return 0;
+    }
+
+    return q - p + 1;
+}
+
+/**
+ * Does the escape at @a p take arguments?
+ *
+ * Such escapes (@c \x41, @c \012, @c \cA, @c \p{Lu}, @c \g1,
+ * @c \k<name>, @c \N{...}, @c \o{...}) are followed by text that is
+ * not matched literally and, for @c \c, may be any character at all.
+ *
+ * @param[in] p Backslash starting the escape.
+ *
+ * @returns true if the characters after the escape letter belong to it.
+ */
+static bool escape_has_arguments(const char *p)
+{
+    assert(*p == '\\');
+
+    return (p[1] != '\0') &&
+        ( (strchr("xcpPgkNoQ", p[1]) != NULL) ||
+          isdigit((unsigned char)p[1]) );
+}
+
+/**
+ * Find the longest literal that every match of @a patt contains.
+ *
+ * Only the top level sequence of the pattern is examined: groups, classes,
+ * escapes of alphanumerics and optional characters end a literal.  Patterns
+ * with top level alternation, inline options (which may make the pattern
+ * case-insensitive or extended), @c \Q quoting or escapes that take
+ * arguments (see escape_has_arguments()) have no literal.
+ *
+ * @param[in] patt The pattern.
+ * @param[out] literal Buffer of at least the length of @a patt.
+ * @param[in] run Work buffer of at least the length of @a patt.
+ *
+ * @returns Length of the literal written to @a literal; 0 if none.
+ */
+static size_t required_literal(const char *patt, char *literal, char *run)
+{
+    assert(patt != NULL);
+    assert(literal != NULL);
+    assert(run != NULL);
+
+    const char *p = patt;
+    size_t      best_len = 0;
+    size_t      run_len = 0;
+
+    /* Literal characters are collected in @a run and the longest run is
+     * copied to @a literal when it ends. */
+#define END_RUN()                                   \
+    do {                                            \
+        if (run_len > best_len) {                   \
+            memcpy(literal, run, run_len);          \
+            best_len = run_len;                     \
+        }                                           \
+        run_len = 0;                                \
+    } while (0)
+
+    while (*p != '\0') {
+        size_t quantifier;
+        char   c;
+
+        switch (*p) {
+        case '|':
+            return 0;
+        case '(':
+        {
+            int depth = 0;
+
+            if (p[1] == '*') {
+                return 0;
+            }
+            if (p[1] == '?' && strchr("imsxXUJ-", p[2]) != NULL) {
+                return 0;
+            }
+            END_RUN();
+            /* Skip the group, minding escapes and classes. */
+            do {
+                if (*p == '\\') {
+                    /* \\c may take ')' or ']' as its argument. */
+                    if (p[1] == 'Q' || p[1] == 'c') {
+                        return 0;
+                    }
+                    if (p[1] != '\0') {
+                        ++p;
+                    }
+                }
+                else if (*p == '[') {
+                    ++p;
+                    if (*p == '^') {
+                        ++p;
+                    }
+                    if (*p == ']') {
+                        ++p;
+                    }
+                    while (*p != '\0' && *p != ']') {
+                        if (*p == '\\' && (p[1] == 'Q' || p[1] == 'c')) {
+                            return 0;
+                        }
+                        if (*p == '\\' && p[1] != '\0') {
+                            ++p;
+                        }
+                        ++p;
+                    }
+                    if (*p == '\0') {
+                        return 0;
+                    }
+                }
+                else if (*p == '(') {
+                    if (p[1] == '?' && strchr("imsxXUJ-", p[2]) != NULL) {
+                        return 0;
+                    }
+                    ++depth;
+                }
+                else if (*p == ')') {
+                    --depth;
+                }
+                ++p;
+            } while (*p != '\0' && depth > 0);
+            continue;
+        }
+        case '[':
+            END_RUN();
+            ++p;
+            if (*p == '^') {
+                ++p;
+            }
+            if (*p == ']') {
+                ++p;
+            }
+            while (*p != '\0' && *p != ']') {
+                if (*p == '\\' && (p[1] == 'Q' || p[1] == 'c')) {
+                    return 0;
+                }
+                if (*p == '\\' && p[1] != '\0') {
+                    ++p;
+                }
+                ++p;
+            }
+            if (*p == '\0') {
+                return 0;
+            }
+            ++p;
+            continue;
+        case '?':
+        case '*':
+            /* The previous character is optional. */
+            if (run_len > 0) {
+                --run_len;
+            }
+            END_RUN();
+            ++p;
+            if (*p == '?' || *p == '+') {
+                ++p;
+            }
+            continue;
+        case '+':
+            END_RUN();
+            ++p;
+            if (*p == '?' || *p == '+') {
+                ++p;
+            }
+            continue;
+        case '{':
+            quantifier = counted_quantifier_length(p);
+            if (quantifier > 0) {
+                if (run_len > 0) {
+                    --run_len;
+                }
+                END_RUN();
+                p += quantifier;
+                if (*p == '?' || *p == '+') {
+                    ++p;
+                }
+                continue;
+            }
+            c = *p;
+            break;
+        case '.':
+        case '^':
+        case '$':
+            END_RUN();
+            ++p;
+            continue;
+        case '\\':
+            /* The arguments would be read as literal text. */
+            if (escape_has_arguments(p)) {
+                return 0;
+            }
+            if (p[1] == '\0' || isalnum((unsigned char)p[1])) {
+                END_RUN();
+                p += (p[1] == '\0') ? 1 : 2;
+                continue;
+            }
+            ++p;
+            c = *p;
+            break;
+        default:
+            c = *p;
+            break;
+        }
+
+        run[run_len++] = c;
+        ++p;
+    }
+    END_RUN();
+
+#undef END_RUN
+
+    return best_len;
+}
+
+/**
+ * Prepare the search for the required literal of @a cpdata.
+ *
+ * Sets @c cpdata->literal to NULL if the pattern has no required literal.
+ *
+ * @param[in] mm Memory manager determining the lifetime of the search.
+ * @param[in,out] cpdata Compiled pattern data.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t prepare_literal(
+    ib_mm_t              mm,
+    modpcre_cpat_data_t *cpdata
+)
+{
+    assert(cpdata != NULL);
+    assert(cpdata->patt != NULL);
+
+    ib_strsearch_t *search;
+    char           *literal;
+    size_t          literal_len;
+    ib_status_t     rc;
+
+    cpdata->literal = NULL;
+
+    /* One buffer holds both the literal and the work buffer. */
+    literal = malloc(2 * strlen(cpdata->patt) + 1);
+    if (literal == NULL) {
+        return IB_EALLOC;
+    }
+
+    literal_len = required_literal(
+        cpdata->patt,
+        literal,
+        literal + strlen(cpdata->patt)
+    );
+    if (literal_len < LITERAL_LENGTH_MIN) {
+        free(literal);
+        return IB_OK;
+    }
+
+    rc = ib_strsearch_create(&search, mm, literal, literal_len);
+    free(literal);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    cpdata->literal = search;
+
+    return IB_OK;
+}
+
 /**
  * Internal compilation of the modpcre pattern.
  *
@@ -539,6 +1211,15 @@ static ib_status_t pcre_compile_internal(
     cpdata->is_dfa = is_dfa;
     cpdata->is_jit = use_jit;
 
+    /* Partial DFA matches may lack the literal, so only non-DFA patterns
+     * are prefiltered. */
+    if (! is_dfa) {
+        ib_rc = prepare_literal(mm, cpdata);
+        if (ib_rc != IB_OK) {
+            return ib_rc;
+        }
+    }
+
     /* Assert that in call cases:
      *   - if this is not jit, we don't care about edata.
      *   - if this *is* jit, edata must be defined.
@@ -561,6 +1242,111 @@ static ib_status_t pcre_compile_internal(
     return IB_OK;
 }
 
+/**
+ * Compile a pattern or reuse an earlier compilation of it.
+ *
+ * Compiled patterns are shared by all operators and transformations of the
+ * engine that use the same pattern with the same settings, so rule sets
+ * that repeat a pattern compile and JIT it once.  Shared compilations live
+ * as long as the engine.
+ *
+ * @param[in] module The PCRE module.
+ * @param[in] ib IronBee engine.
+ * @param[in] config Module configuration
+ * @param[in] is_dfa Set to true for DFA
+ * @param[out] pcpdata The compiled pattern.
+ * @param[in] patt The uncompiled pattern to match.
+ * @param[out] errptr Pointer to an error message describing the failure.
+ * @param[out] erroffset The location of the failure, if this fails.
+ *
+ * @returns Any return of pcre_compile_internal().
+ */
+static ib_status_t pcre_compile_cached(
+    ib_module_t          *module,
+    ib_engine_t          *ib,
+    const modpcre_cfg_t  *config,
+    bool                  is_dfa,
+    modpcre_cpat_data_t **pcpdata,
+    const char           *patt,
+    const char          **errptr,
+    int                  *erroffset
+)
+{
+    assert(module != NULL);
+    assert(module->data != NULL);
+    assert(ib != NULL);
+    assert(config != NULL);
+    assert(pcpdata != NULL);
+    assert(patt != NULL);
+
+    const modpcre_data_t *data = (const modpcre_data_t *)module->data;
+    ib_mm_t               mm = ib_engine_mm_main_get(ib);
+    modpcre_cpat_data_t  *cpdata;
+    char                 *key;
+    size_t                key_len;
+    ib_status_t           rc;
+
+    /* The key is every setting that affects compilation and the pattern. */
+    key_len = snprintf(
+        NULL, 0,
+        "%d:%d:%d:%" PRId64 ":%" PRId64 ":%" PRId64 ":%s",
+        is_dfa ? 1 : 0,
+        config->study ? 1 : 0,
+        config->use_jit ? 1 : 0,
+        config->match_limit,
+        config->match_limit_recursion,
+        config->dfa_workspace_size,
+        patt
+    );
+    key = ib_mm_alloc(mm, key_len + 1);
+    if (key == NULL) {
+        return IB_EALLOC;
+    }
+    snprintf(
+        key, key_len + 1,
+        "%d:%d:%d:%" PRId64 ":%" PRId64 ":%" PRId64 ":%s",
+        is_dfa ? 1 : 0,
+        config->study ? 1 : 0,
+        config->use_jit ? 1 : 0,
+        config->match_limit,
+        config->match_limit_recursion,
+        config->dfa_workspace_size,
+        patt
+    );
+
+    rc = ib_hash_get_ex(data->pattern_cache, &cpdata, key, key_len);
+    if (rc == IB_OK) {
+        ib_log_trace(ib, "Reusing compiled PCRE pattern \"%s\".", patt);
+        *errptr = NULL;
+        *pcpdata = cpdata;
+        return IB_OK;
+    }
+
+    rc = pcre_compile_internal(
+        module,
+        ib,
+        mm,
+        config,
+        is_dfa,
+        &cpdata,
+        patt,
+        errptr,
+        erroffset
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_hash_set_ex(data->pattern_cache, key, key_len, cpdata);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    *pcpdata = cpdata;
+
+    return IB_OK;
+}
+
 /**
  * Create the PCRE operator.
  *
@@ -620,15 +1406,14 @@ ib_status_t pcre_operator_create(
 
     /* Compile the pattern.  Note that the rule data is an alias for
      * the compiled pattern type */
-    rc = pcre_compile_internal(module,
-                               ib,
-                               mm,
-                               config,
-                               false,
-                               &cpdata,
-                               parameters,
-                               &errptr,
-                               &erroffset);
+    rc = pcre_compile_cached(module,
+                             ib,
+                             config,
+                             false,
+                             &cpdata,
+                             parameters,
+                             &errptr,
+                             &erroffset);
     if (rc != IB_OK) {
         return rc;
     }
@@ -654,7 +1439,8 @@ ib_status_t pcre_operator_create(
  * @param[in] capture Collection to capture to.
  * @param[in] ovector The vector of integer pairs of matches from PCRE.
  * @param[in] matches The number of matches.
- * @param[in] subject The matched-against string data.
+ * @param[in] subject The matched-against string data.  The captures alias
+ *            it.
  *
  * @returns IB_OK or IB_EALLOC.
  */
@@ -693,29 +1479,30 @@ ib_status_t pcre_set_matches(
         /* Field name */
         const char *name;
 
-        /* Holder for a copy of the field value when creating a new field. */
-        ib_bytestr_t *bs;
-
         /* Field holder. */
         ib_field_t *field;
 
-        /* Readability. Mark the start and length of the string. */
-        match_start = subject+ovector[i*2];
-        match_len = ovector[i*2+1] - ovector[i*2];
-
-        /* Create a byte-string representation */
-        rc = ib_bytestr_dup_mem(&bs,
-                                tx->mm,
-                                (const uint8_t*)match_start,
-                                match_len);
-        if (rc != IB_OK) {
-            return rc;
+        /* Readability. Mark the start and length of the string. Unset
+         * groups have offsets of -1 and are empty. */
+        if (ovector[i*2] < 0) {
+            match_start = subject;
+            match_len = 0;
+        }
+        else {
+            match_start = subject+ovector[i*2];
+            match_len = ovector[i*2+1] - ovector[i*2];
         }
 
-        /* Create a field to hold the byte-string */
+        /* Alias the match in the subject rather than copying it; the
+         * subject lives at least as long as the field that was matched,
+         * just like captures of the field itself. */
         name = ib_capture_name(i);
-        rc = ib_field_create(&field, tx->mm, name, strlen(name),
-                             IB_FTYPE_BYTESTR, ib_ftype_bytestr_in(bs));
+        rc = ib_field_create_bytestr_alias(
+            &field,
+            tx->mm,
+            name, strlen(name),
+            (const uint8_t *)match_start, match_len
+        );
         if (rc != IB_OK) {
             return rc;
         }
@@ -959,6 +1746,9 @@ ib_status_t pcre_dfa_set_match(
 /**
  * Internal method to call pcre_jit_exec() or pcre_exec().
  *
+ * If the pattern has a required literal and @a options is 0, subjects
+ * without the literal are rejected without calling PCRE.
+ *
  * The arguments are *almost* the same as pcre_exec() except
  * the first two are replaced with this module's
  * @ref modpcre_cpat_data_t data. This struct contains
@@ -996,6 +1786,15 @@ static int pcre_exec_internal(
     int                        ovecsize
 )
 {
+    /* A subject without the required literal can not match. */
+    if (
+        cpdata->literal != NULL &&
+        options == 0 &&
+        ib_strsearch_find(cpdata->literal, subject, (size_t)length) == NULL
+    ) {
+        return PCRE_ERROR_NOMATCH;
+    }
+
 #ifdef PCRE_HAVE_JIT
 #ifdef HAVE_PCRE_JIT_EXEC
     if (cpdata->is_jit && stack != NULL) {
@@ -1361,15 +2160,14 @@ ib_status_t dfa_operator_create(
         return rc;
     }
 
-    rc = pcre_compile_internal(module,
-                               ib,
-                               mm,
-                               config,
-                               true,
-                               &cpdata,
-                               parameters,
-                               &errptr,
-                               &erroffset);
+    rc = pcre_compile_cached(module,
+                             ib,
+                             config,
+                             true,
+                             &cpdata,
+                             parameters,
+                             &errptr,
+                             &erroffset);
 
     if (rc != IB_OK) {
         ib_log_error(ib, "Error parsing DFA operator pattern \"%s\":%s",
@@ -2033,6 +2831,51 @@ static ib_status_t handle_directive_param(ib_cfgparser_t *cp,
     return IB_OK;
 }
 
+/**
+ * Handle the PcreCompiledCache directive.
+ *
+ * @param[in] cp Config parser
+ * @param[in] name Directive name
+ * @param[in] p1 Directory, relative to the configuration file.
+ * @param[in] cbdata Callback data (module)
+ *
+ * @returns Status code
+ */
+static ib_status_t handle_directive_compiled_cache(ib_cfgparser_t *cp,
+                                                   const char *name,
+                                                   const char *p1,
+                                                   void *cbdata)
+{
+    assert(cp != NULL);
+    assert(name != NULL);
+    assert(p1 != NULL);
+    assert(cbdata != NULL);
+
+    ib_module_t    *module = (ib_module_t *)cbdata;
+    modpcre_data_t *data = (modpcre_data_t *)module->data;
+    char           *dir;
+    ib_status_t     rc;
+
+    assert(data != NULL);
+
+    dir = ib_util_relative_file(ib_engine_mm_main_get(cp->ib),
+                                cp->curr->file, p1);
+    if (dir == NULL) {
+        return IB_EALLOC;
+    }
+
+    rc = ib_util_mkpath(dir, 0755);
+    if (rc != IB_OK) {
+        ib_cfg_log_error(cp, "Error creating %s directory \"%s\": %s",
+                         name, dir, strerror(errno));
+        return rc;
+    }
+
+    data->bundle_dir = dir;
+
+    return IB_OK;
+}
+
 /**! Constant used as cbdata for value filters. */
 static const char *c_filter_rx_value = "FilterValue";
 /**! Constant used as cbdata for name filters. */
@@ -2041,13 +2884,13 @@ static const char *c_filter_rx_name = "FilterName";
 /**
  * Create function for all rx filters.
  *
- * @param[in] mm Memory manager.
+ * @param[in] mm Memory manager.  Unused; compiled patterns are shared.
  * @param[in] regex Regular expression.
  * @param[out] instance_data Will be set to compiled pattern data.
  * @param[in] cbdata Module.
  * @return
  * - IB_OK on success.
- * - Any return of pcre_compile_internal().
+ * - Any return of pcre_compile_cached().
  **/
 static
 ib_status_t filter_rx_create(
@@ -2068,10 +2911,9 @@ ib_status_t filter_rx_create(
     int error_offset;
     ib_status_t rc;
 
-    rc = pcre_compile_internal(
+    rc = pcre_compile_cached(
         m,
         ib,
-        mm,
         &modpcre_global_cfg,
         false,
         &cpdata,
@@ -2274,6 +3116,11 @@ static IB_DIRMAP_INIT_STRUCTURE(directive_map) = {
         handle_directive_param,
         NULL
     ),
+    IB_DIRMAP_INIT_PARAM1(
+        "PcreCompiledCache",
+        handle_directive_compiled_cache,
+        IB_MODULE_STRUCT_PTR
+    ),
     IB_DIRMAP_INIT_LAST
 };
 
@@ -2284,14 +3131,48 @@ static ib_status_t modpcre_init(ib_engine_t *ib,
     assert(ib != NULL);
     assert(m != NULL);
 
-    ib_status_t rc;
+    ib_status_t     rc;
+    modpcre_data_t *data;
+
+    data = ib_mm_alloc(ib_engine_mm_main_get(ib), sizeof(*data));
+    if (data == NULL) {
+        return IB_EALLOC;
+    }
+
+    data->bundle_dir = NULL;
+
+    /* Create the cache of compiled patterns shared by all rules. */
+    rc = ib_hash_create(&data->pattern_cache, ib_engine_mm_main_get(ib));
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    /* Create the pool of match scratch space shared by transactions. */
+    rc = ib_resource_pool_create(
+        &data->scratch_pool,
+        ib_engine_mm_main_get(ib),
+        0,
+        0,
+        pcre_scratch_create, m,
+        pcre_scratch_destroy, NULL,
+        NULL, NULL,
+        NULL, NULL
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = ib_resource_pool_thread_cache(data->scratch_pool, 2);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    m->data = data;
 
     /* Register operators. */
     rc = ib_operator_create_and_register(
         NULL,
         ib,
         "pcre",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_SHAREABLE ),
         pcre_operator_create, NULL,
         NULL, NULL,
         pcre_operator_execute, m
@@ -2305,7 +3186,22 @@ static ib_status_t modpcre_init(ib_engine_t *ib,
         NULL,
         ib,
         "rx",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_SHAREABLE ),
+        pcre_operator_create, NULL,
+        NULL, NULL,
+        pcre_operator_execute, m
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    /* Stream rx matches each piece of data on its own; patterns spanning
+     * pieces need RuleEngineStreamOverlap. */
+    rc = ib_operator_stream_create_and_register(
+        NULL,
+        ib,
+        "rx",
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_SHAREABLE ),
         pcre_operator_create, NULL,
         NULL, NULL,
         pcre_operator_execute, m
@@ -2331,7 +3227,7 @@ static ib_status_t modpcre_init(ib_engine_t *ib,
         NULL,
         ib,
         "dfa",
-        IB_OP_CAPABILITY_CAPTURE,
+        ( IB_OP_CAPABILITY_CAPTURE | IB_OP_CAPABILITY_STREAM ),
         dfa_operator_create, NULL,
         NULL, NULL,
         dfa_stream_operator_execute, m
@@ -0,0 +1,1123 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- PCRE2 Module
+ *
+ * A PCRE2 backend for the regular expression operators and transformations
+ * of the pcre module.  It registers the @c pcre and @c rx operators and the
+ * @c filterValueRx and @c filterNameRx transformations, so it is loaded
+ * instead of the pcre module, not alongside it.  The @c dfa operator is not
+ * provided.
+ *
+ * Patterns are JIT compiled when possible and JIT compiled patterns are
+ * matched with pcre2_jit_match(), which skips the checks of pcre2_match().
+ * Match data, match contexts and JIT stacks are kept in a resource pool with
+ * a per-thread cache and lent to one transaction at a time.
+ */
+
+#include <ironbee/bytestr.h>
+#include <ironbee/capture.h>
+#include <ironbee/cfgmap.h>
+#include <ironbee/context.h>
+#include <ironbee/engine.h>
+#include <ironbee/field.h>
+#include <ironbee/mm.h>
+#include <ironbee/module.h>
+#include <ironbee/operator.h>
+#include <ironbee/resource_pool.h>
+#include <ironbee/string.h>
+#include <ironbee/transformation.h>
+#include <ironbee/type_convert.h>
+#include <ironbee/util.h>
+
+#include <ironbee_config_auto_gen.h>
+
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* Define the module name as well as a string version of it. */
+#define MODULE_NAME        pcre2
+#define MODULE_NAME_STR    IB_XSTRINGIFY(MODULE_NAME)
+
+/* How many matches will PCRE2 find and populate. */
+#define MATCH_MAX 10
+
+/* Define the public module symbol. */
+IB_MODULE_DECLARE();
+
+/**
+ * Module Configuration Structure.
+ */
+struct modpcre2_cfg_t {
+    ib_num_t use_jit;               /**< Bool: Use JIT if available */
+    ib_num_t match_limit;           /**< Match limit */
+    ib_num_t match_limit_recursion; /**< Match depth limit */
+    ib_num_t jit_stack_start;       /**< Starting JIT stack size */
+    ib_num_t jit_stack_max;         /**< Max JIT stack size */
+};
+typedef struct modpcre2_cfg_t modpcre2_cfg_t;
+
+/* Instantiate a module global configuration. */
+static modpcre2_cfg_t modpcre2_global_cfg = {
+    1,                     /* use_jit. */
+    5000,                  /* match_limit. */
+    5000,                  /* match_limit_recursion. */
+    32 * 1024,             /* jit_stack_start. */
+    1000 * 1024            /* jit_stack_max. */
+};
+
+/**
+ * Compiled pattern.
+ */
+struct modpcre2_cpat_data_t {
+    ib_module_t *module;      /**< Pointer to this module. */
+    pcre2_code  *code;        /**< Compiled pattern. */
+    const char  *patt;        /**< Regex pattern text. */
+    bool         is_jit;      /**< Is this JIT compiled? */
+    uint32_t     match_limit; /**< Match limit. */
+    uint32_t     depth_limit; /**< Match depth limit. */
+};
+typedef struct modpcre2_cpat_data_t modpcre2_cpat_data_t;
+
+/**
+ * Match scratch space reused across transactions.
+ */
+struct pcre2_scratch_t {
+    pcre2_match_data    *match_data; /**< Capture buffer. */
+    pcre2_match_context *mcontext;   /**< Limits and JIT stack. */
+    pcre2_jit_stack     *stack;      /**< JIT stack; may be NULL. */
+};
+typedef struct pcre2_scratch_t pcre2_scratch_t;
+
+/**
+ * Per-transaction data: the scratch space borrowed for the transaction.
+ */
+struct pcre2_tx_data_t {
+    ib_resource_t   *resource; /**< Resource holding @ref scratch. */
+    pcre2_scratch_t *scratch;  /**< Scratch space. */
+};
+typedef struct pcre2_tx_data_t pcre2_tx_data_t;
+
+/**
+ * Destroy scratch space of the scratch resource pool.
+ *
+ * @param[in] resource The @ref pcre2_scratch_t.
+ * @param[in] cbdata Unused.
+ */
+static void pcre2_scratch_destroy(void *resource, void *cbdata)
+{
+    assert(resource != NULL);
+
+    pcre2_scratch_t *scratch = (pcre2_scratch_t *)resource;
+
+    if (scratch->stack != NULL) {
+        pcre2_jit_stack_free(scratch->stack);
+    }
+    if (scratch->mcontext != NULL) {
+        pcre2_match_context_free(scratch->mcontext);
+    }
+    if (scratch->match_data != NULL) {
+        pcre2_match_data_free(scratch->match_data);
+    }
+    free(scratch);
+}
+
+/**
+ * Create scratch space for the scratch resource pool.
+ *
+ * The JIT stack is sized by the main context configuration.
+ *
+ * @param[out] resource The created @ref pcre2_scratch_t.
+ * @param[in] cbdata The PCRE2 module.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ * - Other if the module configuration can not be fetched.
+ */
+static ib_status_t pcre2_scratch_create(void *resource, void *cbdata)
+{
+    assert(resource != NULL);
+    assert(cbdata != NULL);
+
+    const ib_module_t *m = (const ib_module_t *)cbdata;
+    modpcre2_cfg_t    *config;
+    pcre2_scratch_t   *scratch;
+    ib_status_t        rc;
+
+    rc = ib_context_module_config(ib_context_main(m->ib), m, &config);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    scratch = calloc(1, sizeof(*scratch));
+    if (scratch == NULL) {
+        return IB_EALLOC;
+    }
+
+    scratch->match_data = pcre2_match_data_create(MATCH_MAX, NULL);
+    scratch->mcontext = pcre2_match_context_create(NULL);
+    if (scratch->match_data == NULL || scratch->mcontext == NULL) {
+        pcre2_scratch_destroy(scratch, NULL);
+        return IB_EALLOC;
+    }
+
+    /* Without a stack, JIT uses the machine stack. */
+    scratch->stack = pcre2_jit_stack_create(
+        (PCRE2_SIZE)config->jit_stack_start,
+        (PCRE2_SIZE)config->jit_stack_max,
+        NULL
+    );
+    if (scratch->stack != NULL) {
+        pcre2_jit_stack_assign(scratch->mcontext, NULL, scratch->stack);
+    }
+    else {
+        ib_log_info(
+            m->ib,
+            "Could not allocate a pcre2 JIT stack: min=%d max=%d",
+            (int)config->jit_stack_start,
+            (int)config->jit_stack_max
+        );
+    }
+
+    *(void **)resource = scratch;
+
+    return IB_OK;
+}
+
+/**
+ * Return scratch space to its pool when the transaction is destroyed.
+ *
+ * @param[in] resource The @c ib_resource_t holding the scratch space.
+ */
+static void pcre2_scratch_release(void *resource)
+{
+    assert(resource != NULL);
+
+    ib_resource_release((ib_resource_t *)resource);
+}
+
+/**
+ * Get the scratch space of @a tx, borrowing it on first use.
+ *
+ * @param[in] m PCRE2 module.
+ * @param[in] tx Transaction.
+ * @param[out] scratch Scratch space for @a tx.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ * - Other if no scratch space can be acquired.
+ */
+static ib_status_t get_tx_scratch(
+    const ib_module_t  *m,
+    ib_tx_t            *tx,
+    pcre2_scratch_t   **scratch
+)
+{
+    assert(m != NULL);
+    assert(m->data != NULL);
+    assert(tx != NULL);
+    assert(scratch != NULL);
+
+    pcre2_tx_data_t *data;
+    ib_status_t      rc;
+
+    rc = ib_tx_get_module_data(tx, m, &data);
+    if (rc == IB_OK && data != NULL) {
+        *scratch = data->scratch;
+        return IB_OK;
+    }
+
+    data = ib_mm_alloc(tx->mm, sizeof(*data));
+    if (data == NULL) {
+        return IB_EALLOC;
+    }
+
+    rc = ib_resource_acquire((ib_resource_pool_t *)m->data, &data->resource);
+    if (rc != IB_OK) {
+        ib_log_error_tx(tx, "Cannot acquire pcre2 scratch space.");
+        return rc;
+    }
+
+    rc = ib_mm_register_cleanup(tx->mm, pcre2_scratch_release, data->resource);
+    if (rc != IB_OK) {
+        ib_resource_release(data->resource);
+        return rc;
+    }
+
+    data->scratch = (pcre2_scratch_t *)ib_resource_get(data->resource);
+
+    rc = ib_tx_set_module_data(tx, m, data);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    *scratch = data->scratch;
+
+    return IB_OK;
+}
+
+/**
+ * An adapter function to allow freeing of compiled patterns via mm cleanups.
+ */
+static void pcre2_code_free_wrapper(void *code)
+{
+    pcre2_code_free((pcre2_code *)code);
+}
+
+/**
+ * Compile a pattern.
+ *
+ * @param[in] module PCRE2 module.
+ * @param[in] ib IronBee engine for logging.
+ * @param[in] mm Memory manager determining the lifetime of the pattern.
+ * @param[in] config Module configuration.
+ * @param[in] patt The pattern.
+ * @param[out] pcpdata The compiled pattern.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EINVAL if the pattern is invalid.
+ * - IB_EALLOC on allocation failure.
+ */
+static ib_status_t pcre2_compile_internal(
+    ib_module_t           *module,
+    ib_engine_t           *ib,
+    ib_mm_t                mm,
+    const modpcre2_cfg_t  *config,
+    const char            *patt,
+    modpcre2_cpat_data_t **pcpdata
+)
+{
+    assert(module != NULL);
+    assert(ib != NULL);
+    assert(config != NULL);
+    assert(patt != NULL);
+    assert(pcpdata != NULL);
+
+    /* How code is produced; as the pcre module. */
+    const uint32_t compile_flags = PCRE2_DOTALL | PCRE2_DOLLAR_ENDONLY;
+
+    modpcre2_cpat_data_t *cpdata;
+    int                   errorcode;
+    PCRE2_SIZE            erroroffset;
+    ib_status_t           rc;
+
+    cpdata = ib_mm_calloc(mm, sizeof(*cpdata), 1);
+    if (cpdata == NULL) {
+        return IB_EALLOC;
+    }
+    cpdata->module = module;
+
+    cpdata->patt = ib_mm_strdup(mm, patt);
+    if (cpdata->patt == NULL) {
+        return IB_EALLOC;
+    }
+
+    cpdata->code = pcre2_compile(
+        (PCRE2_SPTR)patt,
+        PCRE2_ZERO_TERMINATED,
+        compile_flags,
+        &errorcode,
+        &erroroffset,
+        NULL
+    );
+    if (cpdata->code == NULL) {
+        PCRE2_UCHAR message[256];
+
+        pcre2_get_error_message(errorcode, message, sizeof(message));
+        ib_log_error(ib, "Error compiling PCRE2 pattern \"%s\": %s at offset %d",
+                     patt, (const char *)message, (int)erroroffset);
+        return IB_EINVAL;
+    }
+    rc = ib_mm_register_cleanup(mm, pcre2_code_free_wrapper, cpdata->code);
+    if (rc != IB_OK) {
+        pcre2_code_free(cpdata->code);
+        return rc;
+    }
+
+    cpdata->is_jit = false;
+    if (config->use_jit) {
+        uint32_t have_jit = 0;
+
+        pcre2_config(PCRE2_CONFIG_JIT, &have_jit);
+        if (have_jit && pcre2_jit_compile(cpdata->code, PCRE2_JIT_COMPLETE) == 0) {
+            cpdata->is_jit = true;
+        }
+        else {
+            ib_log_info(ib, "PCRE2-JIT compiler does not support: %s", patt);
+        }
+    }
+
+    cpdata->match_limit = (uint32_t)config->match_limit;
+    cpdata->depth_limit = (uint32_t)config->match_limit_recursion;
+
+    ib_log_trace(ib,
+                 "Compiled PCRE2 pattern \"%s\": "
+                 "limit=%u depth-limit=%u jit=%s",
+                 patt,
+                 cpdata->match_limit,
+                 cpdata->depth_limit,
+                 cpdata->is_jit ? "yes" : "no");
+
+    *pcpdata = cpdata;
+
+    return IB_OK;
+}
+
+/**
+ * Match @a cpdata against @a subject.
+ *
+ * JIT compiled patterns are matched with pcre2_jit_match().
+ *
+ * @param[in] cpdata Compiled pattern.
+ * @param[in] scratch Scratch space; holds the captures afterwards.
+ * @param[in] subject Subject.
+ * @param[in] subject_len Length of @a subject.
+ *
+ * @returns The return of pcre2_match() or pcre2_jit_match().
+ */
+static int pcre2_match_internal(
+    const modpcre2_cpat_data_t *cpdata,
+    pcre2_scratch_t            *scratch,
+    const char                 *subject,
+    size_t                      subject_len
+)
+{
+    assert(cpdata != NULL);
+    assert(scratch != NULL);
+    assert(subject != NULL);
+
+    if (cpdata->is_jit) {
+        return pcre2_jit_match(
+            cpdata->code,
+            (PCRE2_SPTR)subject,
+            subject_len,
+            0,
+            0,
+            scratch->match_data,
+            scratch->mcontext
+        );
+    }
+
+    /* Limits only apply to the interpreter; JIT has its stack limit. */
+    pcre2_set_match_limit(scratch->mcontext, cpdata->match_limit);
+#ifdef PCRE2_ERROR_DEPTHLIMIT
+    pcre2_set_depth_limit(scratch->mcontext, cpdata->depth_limit);
+#else
+    pcre2_set_recursion_limit(scratch->mcontext, cpdata->depth_limit);
+#endif
+
+    return pcre2_match(
+        cpdata->code,
+        (PCRE2_SPTR)subject,
+        subject_len,
+        0,
+        0,
+        scratch->match_data,
+        scratch->mcontext
+    );
+}
+
+/**
+ * Set the matches into the given field name as .0, .1, .2 ... .9.
+ *
+ * @param[in] tx Current transaction.
+ * @param[in] capture Collection to capture to.
+ * @param[in] ovector The vector of pairs of match offsets from PCRE2.
+ * @param[in] matches The number of matches.
+ * @param[in] subject The matched-against string data.  The captures alias
+ *            it.
+ *
+ * @returns IB_OK or IB_EALLOC.
+ */
+static ib_status_t pcre2_set_matches(
+    const ib_tx_t    *tx,
+    ib_field_t       *capture,
+    const PCRE2_SIZE *ovector,
+    int               matches,
+    const char       *subject
+)
+{
+    assert(tx != NULL);
+    assert(capture != NULL);
+    assert(ovector != NULL);
+
+    ib_status_t rc;
+    int i;
+
+    rc = ib_capture_clear(capture);
+    if (rc != IB_OK) {
+        ib_log_error_tx(tx, "Error clearing captures: %s",
+                        ib_status_to_string(rc));
+    }
+
+    for (i = 0; i < matches; ++i) {
+        const char *name;
+        ib_field_t *field;
+        size_t      match_start = 0;
+        size_t      match_len = 0;
+
+        /* Unset groups have both offsets PCRE2_UNSET and are empty. */
+        if (ovector[i * 2] != PCRE2_UNSET) {
+            match_start = ovector[i * 2];
+            match_len = ovector[i * 2 + 1] - ovector[i * 2];
+        }
+
+        /* Alias the match in the subject rather than copying it. */
+        name = ib_capture_name(i);
+        rc = ib_field_create_bytestr_alias(
+            &field,
+            tx->mm,
+            name, strlen(name),
+            (const uint8_t *)subject + match_start, match_len
+        );
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+        rc = ib_capture_set_item(capture, i, tx->mm, field);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Create the pcre and rx operators.
+ *
+ * @param[in] ctx Current context.
+ * @param[in] mm Memory manager.
+ * @param[in] parameters The pattern.
+ * @param[out] instance_data The compiled pattern.
+ * @param[in] cbdata The PCRE2 module.
+ *
+ * @returns Any return of pcre2_compile_internal().
+ */
+static ib_status_t pcre2_operator_create(
+    ib_context_t *ctx,
+    ib_mm_t       mm,
+    const char   *parameters,
+    void         *instance_data,
+    void         *cbdata
+)
+{
+    assert(ctx           != NULL);
+    assert(instance_data != NULL);
+    assert(cbdata        != NULL);
+
+    ib_engine_t          *ib = ib_context_get_engine(ctx);
+    ib_module_t          *module = (ib_module_t *)cbdata;
+    modpcre2_cfg_t       *config;
+    modpcre2_cpat_data_t *cpdata;
+    ib_status_t           rc;
+
+    if (parameters == NULL) {
+        ib_log_error(ib, "No pattern for operator.");
+        return IB_EINVAL;
+    }
+
+    rc = ib_context_module_config(ctx, module, &config);
+    if (rc != IB_OK) {
+        ib_log_error(ib, "Error getting pcre2 module configuration: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
+    rc = pcre2_compile_internal(module, ib, mm, config, parameters, &cpdata);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    *(modpcre2_cpat_data_t **)instance_data = cpdata;
+
+    return IB_OK;
+}
+
+/**
+ * Execute the pcre and rx operators.
+ *
+ * @param[in] tx Current transaction.
+ * @param[in] field The field to operate on.
+ * @param[in] capture If non-NULL, the collection to capture to.
+ * @param[out] result The result of the operator 1=true 0=false.
+ * @param[in] instance_data The compiled pattern.
+ * @param[in] cbdata The PCRE2 module.
+ *
+ * @returns
+ * - IB_OK on success, match or not.
+ * - IB_EINVAL if @a field is not a string.
+ * - IB_EUNKNOWN if matching fails.
+ */
+static ib_status_t pcre2_operator_execute(
+    ib_tx_t          *tx,
+    const ib_field_t *field,
+    ib_field_t       *capture,
+    ib_num_t         *result,
+    void             *instance_data,
+    void             *cbdata
+)
+{
+    assert(tx            != NULL);
+    assert(instance_data != NULL);
+    assert(cbdata        != NULL);
+
+    const modpcre2_cpat_data_t *cpdata =
+        (const modpcre2_cpat_data_t *)instance_data;
+    const char         *subject = NULL;
+    size_t              subject_len = 0;
+    const ib_bytestr_t *bytestr;
+    pcre2_scratch_t    *scratch;
+    ib_status_t         rc;
+    int                 matches;
+
+    if (! field) {
+        ib_log_error_tx(tx, "pcre operator received NULL field.");
+        return IB_EINVAL;
+    }
+
+    if (field->type == IB_FTYPE_NULSTR) {
+        rc = ib_field_value(field, ib_ftype_nulstr_out(&subject));
+        if (rc != IB_OK) {
+            return rc;
+        }
+        if (subject != NULL) {
+            subject_len = strlen(subject);
+        }
+    }
+    else if (field->type == IB_FTYPE_BYTESTR) {
+        rc = ib_field_value(field, ib_ftype_bytestr_out(&bytestr));
+        if (rc != IB_OK) {
+            return rc;
+        }
+        if (bytestr != NULL) {
+            subject_len = ib_bytestr_length(bytestr);
+            subject = (const char *)ib_bytestr_const_ptr(bytestr);
+        }
+    }
+    else {
+        return IB_EINVAL;
+    }
+
+    if (subject == NULL) {
+        subject = "";
+    }
+
+    rc = get_tx_scratch((const ib_module_t *)cbdata, tx, &scratch);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    matches = pcre2_match_internal(cpdata, scratch, subject, subject_len);
+
+    /* 0 means the captures did not all fit. */
+    if (matches == 0) {
+        matches = MATCH_MAX;
+    }
+
+    if (matches > 0) {
+        if (capture != NULL) {
+            rc = pcre2_set_matches(
+                tx,
+                capture,
+                pcre2_get_ovector_pointer(scratch->match_data),
+                matches,
+                subject
+            );
+            if (rc != IB_OK) {
+                return rc;
+            }
+        }
+        *result = 1;
+        return IB_OK;
+    }
+
+    *result = 0;
+    if (matches == PCRE2_ERROR_NOMATCH) {
+        return IB_OK;
+    }
+
+    {
+        PCRE2_UCHAR message[256];
+
+        pcre2_get_error_message(matches, message, sizeof(message));
+        ib_log_error_tx(tx, "Failure matching /%s/: %s",
+                        cpdata->patt, (const char *)message);
+    }
+
+    return IB_EUNKNOWN;
+}
+
+/**
+ * Used to indicate that filter should filter on value.
+ *
+ * Value doesn't matter, only address.
+ **/
+static const char *c_filter_rx_value = "FilterValue";
+
+/**
+ * Used to indicate that filter should filter on name.
+ *
+ * Value doesn't matter, only address.
+ **/
+static const char *c_filter_rx_name = "FilterName";
+
+/**
+ * Create function for all rx filters.
+ *
+ * @param[in] mm Memory manager.
+ * @param[in] regex Regular expression.
+ * @param[out] instance_data Will be set to compiled pattern data.
+ * @param[in] cbdata Module.
+ * @return
+ * - IB_OK on success.
+ * - Any return of pcre2_compile_internal().
+ **/
+static ib_status_t filter_rx_create(
+    ib_mm_t     mm,
+    const char *regex,
+    void       *instance_data,
+    void       *cbdata
+)
+{
+    assert(regex != NULL);
+    assert(instance_data != NULL);
+    assert(cbdata != NULL);
+
+    ib_module_t *m = (ib_module_t *)cbdata;
+
+    return pcre2_compile_internal(
+        m,
+        m->ib,
+        mm,
+        &modpcre2_global_cfg,
+        regex,
+        (modpcre2_cpat_data_t **)instance_data
+    );
+}
+
+/**
+ * Execute function for all rx filters.
+ *
+ * @param[in] mm Memory manager.
+ * @param[in] fin Input field; must be a list.
+ * @param[out] fout Output field; list of matching subfields.
+ * @param[in] instance_data Compiled pattern data.
+ * @param[in] cbdata @ref c_filter_rx_value or @ref c_filter_rx_name.
+ * @return
+ * - IB_OK on success.
+ * - IB_EINVAL if @a fin is not a list.
+ * - IB_EUNKNOWN on matching failure.
+ * - IB_EALLOC on allocation failure.
+ **/
+static ib_status_t filter_rx_execute(
+    ib_mm_t            mm,
+    const ib_field_t  *fin,
+    const ib_field_t **fout,
+    void              *instance_data,
+    void              *cbdata
+)
+{
+    assert(fin != NULL);
+    assert(fout != NULL);
+    assert(instance_data != NULL);
+    assert(cbdata != NULL);
+
+    const modpcre2_cpat_data_t *cpdata =
+        (const modpcre2_cpat_data_t *)instance_data;
+    bool                  filter_value;
+    const ib_list_t      *collection;
+    ib_list_t            *result;
+    ib_field_t           *result_field;
+    const ib_list_node_t *node;
+    ib_resource_t        *resource;
+    pcre2_scratch_t      *scratch;
+    ib_status_t           rc;
+
+    if ((const char *)cbdata == c_filter_rx_value) {
+        filter_value = true;
+    }
+    else if ((const char *)cbdata == c_filter_rx_name) {
+        filter_value = false;
+    }
+    else {
+        return IB_EOTHER;
+    }
+
+    rc = ib_field_value_type(
+        fin,
+        ib_ftype_list_out(&collection),
+        IB_FTYPE_LIST
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_list_create(&result, mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    /* No transaction to lend scratch space to; hold it for the loop. */
+    rc = ib_resource_acquire(
+        (ib_resource_pool_t *)cpdata->module->data,
+        &resource
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+    scratch = (pcre2_scratch_t *)ib_resource_get(resource);
+
+    IB_LIST_LOOP_CONST(collection, node) {
+        const ib_field_t *subfield = ib_list_node_data_const(node);
+        const char *subject;
+        size_t subject_len;
+        int match_rc;
+
+        if (filter_value) {
+            const ib_bytestr_t *bs;
+            rc = ib_field_value_type(
+                subfield,
+                ib_ftype_bytestr_out(&bs),
+                IB_FTYPE_BYTESTR
+            );
+            if (rc == IB_EINVAL) {
+                /* Not a bytestr. */
+                continue;
+            }
+            else if (rc != IB_OK) {
+                goto finish;
+            }
+
+            subject = (const char *)ib_bytestr_const_ptr(bs);
+            subject_len = ib_bytestr_length(bs);
+            if (subject == NULL) {
+                subject = "";
+            }
+        }
+        else {
+            subject = subfield->name;
+            subject_len = subfield->nlen;
+        }
+
+        match_rc = pcre2_match_internal(cpdata, scratch, subject, subject_len);
+        if (match_rc == PCRE2_ERROR_NOMATCH) {
+            continue;
+        }
+        if (match_rc < 0) {
+            rc = IB_EUNKNOWN;
+            goto finish;
+        }
+
+        rc = ib_list_push(result, (void *)subfield);
+        if (rc != IB_OK) {
+            goto finish;
+        }
+    }
+
+    rc = ib_field_create_no_copy(
+        &result_field,
+        mm,
+        fin->name, fin->nlen,
+        IB_FTYPE_LIST,
+        ib_ftype_list_mutable_in(result)
+    );
+    if (rc != IB_OK) {
+        goto finish;
+    }
+
+    *fout = result_field;
+
+finish:
+    ib_resource_release(resource);
+
+    return rc;
+}
+
+static IB_CFGMAP_INIT_STRUCTURE(config_map) = {
+    IB_CFGMAP_INIT_ENTRY(
+        MODULE_NAME_STR ".use_jit",
+        IB_FTYPE_NUM,
+        modpcre2_cfg_t,
+        use_jit
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        MODULE_NAME_STR ".match_limit",
+        IB_FTYPE_NUM,
+        modpcre2_cfg_t,
+        match_limit
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        MODULE_NAME_STR ".match_limit_recursion",
+        IB_FTYPE_NUM,
+        modpcre2_cfg_t,
+        match_limit_recursion
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        MODULE_NAME_STR ".jit_stack_start",
+        IB_FTYPE_NUM,
+        modpcre2_cfg_t,
+        jit_stack_start
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        MODULE_NAME_STR ".jit_stack_max",
+        IB_FTYPE_NUM,
+        modpcre2_cfg_t,
+        jit_stack_max
+    ),
+    IB_CFGMAP_INIT_LAST
+};
+
+/**
+ * Handle on/off directives.
+ *
+ * @param[in] cp Config parser
+ * @param[in] name Directive name
+ * @param[in] onoff on/off flag
+ * @param[in] cbdata Callback data (ignored)
+ *
+ * @returns Status code
+ */
+static ib_status_t handle_directive_onoff(ib_cfgparser_t *cp,
+                                          const char *name,
+                                          int onoff,
+                                          void *cbdata)
+{
+    assert(cp != NULL);
+    assert(name != NULL);
+    assert(cp->ib != NULL);
+
+    ib_context_t *ctx = cp->cur_ctx ? cp->cur_ctx : ib_context_main(cp->ib);
+    const char *pname;
+    ib_status_t rc;
+
+    if (strcasecmp("PcreUseJit", name) == 0) {
+        pname = MODULE_NAME_STR ".use_jit";
+    }
+    else {
+        ib_cfg_log_error(cp, "Unhandled directive \"%s\"", name);
+        return IB_EINVAL;
+    }
+    rc = ib_context_set_num(ctx, pname, onoff);
+    if (rc != IB_OK) {
+        ib_cfg_log_error(cp, "Error setting \"%s\" to %s for \"%s\": %s",
+                         pname, onoff ? "true" : "false", name,
+                         ib_status_to_string(rc));
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Handle single parameter directives.
+ *
+ * @param[in] cp Config parser
+ * @param[in] name Directive name
+ * @param[in] p1 First parameter
+ * @param[in] cbdata Callback data (ignored)
+ *
+ * @returns Status code
+ */
+static ib_status_t handle_directive_param(ib_cfgparser_t *cp,
+                                          const char *name,
+                                          const char *p1,
+                                          void *cbdata)
+{
+    assert(cp != NULL);
+    assert(name != NULL);
+    assert(p1 != NULL);
+    assert(cp->ib != NULL);
+
+    ib_context_t *ctx = cp->cur_ctx ? cp->cur_ctx : ib_context_main(cp->ib);
+    const char *pname;
+    ib_num_t value;
+    ib_status_t rc;
+
+    /* p1 should be a number */
+    rc = ib_type_atoi(p1, 0, &value);
+    if (rc != IB_OK) {
+        ib_cfg_log_error(cp,
+                         "Error converting \"%s\" to a number for \"%s\": %s",
+                         p1, name, ib_status_to_string(rc));
+        return rc;
+    }
+
+    if (strcasecmp("PcreMatchLimit", name) == 0) {
+        pname = MODULE_NAME_STR ".match_limit";
+    }
+    else if (strcasecmp("PcreMatchLimitRecursion", name) == 0) {
+        pname = MODULE_NAME_STR ".match_limit_recursion";
+    }
+    else if (strcasecmp("PcreJitStackStart", name) == 0) {
+        pname = MODULE_NAME_STR ".jit_stack_start";
+    }
+    else if (strcasecmp("PcreJitStackMax", name) == 0) {
+        pname = MODULE_NAME_STR ".jit_stack_max";
+    }
+    else {
+        ib_cfg_log_error(cp, "Unhandled directive \"%s\"", name);
+        return IB_EINVAL;
+    }
+    rc = ib_context_set_num(ctx, pname, value);
+    if (rc != IB_OK) {
+        ib_cfg_log_error(cp, "Error setting \"%s\" to %ld for \"%s\": %s",
+                         pname, (long int)value, name, ib_status_to_string(rc));
+    }
+
+    return IB_OK;
+}
+
+/* The directives of the pcre module that apply to PCRE2. */
+static IB_DIRMAP_INIT_STRUCTURE(directive_map) = {
+    IB_DIRMAP_INIT_ONOFF(
+        "PcreUseJit",
+        handle_directive_onoff,
+        NULL
+    ),
+    IB_DIRMAP_INIT_PARAM1(
+        "PcreMatchLimit",
+        handle_directive_param,
+        NULL
+    ),
+    IB_DIRMAP_INIT_PARAM1(
+        "PcreMatchLimitRecursion",
+        handle_directive_param,
+        NULL
+    ),
+    IB_DIRMAP_INIT_PARAM1(
+        "PcreJitStackStart",
+        handle_directive_param,
+        NULL
+    ),
+    IB_DIRMAP_INIT_PARAM1(
+        "PcreJitStackMax",
+        handle_directive_param,
+        NULL
+    ),
+    IB_DIRMAP_INIT_LAST
+};
+
+static ib_status_t modpcre2_init(ib_engine_t *ib,
+                                 ib_module_t *m,
+                                 void        *cbdata)
+{
+    assert(ib != NULL);
+    assert(m != NULL);
+
+    ib_status_t         rc;
+    ib_resource_pool_t *scratch_pool;
+
+    /* Create the pool of match scratch space shared by transactions. */
+    rc = ib_resource_pool_create(
+        &scratch_pool,
+        ib_engine_mm_main_get(ib),
+        0,
+        0,
+        pcre2_scratch_create, m,
+        pcre2_scratch_destroy, NULL,
+        NULL, NULL,
+        NULL, NULL
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = ib_resource_pool_thread_cache(scratch_pool, 2);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    m->data = scratch_pool;
+
+    rc = ib_operator_create_and_register(
+        NULL,
+        ib,
+        "pcre",
+        IB_OP_CAPABILITY_CAPTURE,
+        pcre2_operator_create, m,
+        NULL, NULL,
+        pcre2_operator_execute, m
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_operator_create_and_register(
+        NULL,
+        ib,
+        "rx",
+        IB_OP_CAPABILITY_CAPTURE,
+        pcre2_operator_create, m,
+        NULL, NULL,
+        pcre2_operator_execute, m
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_transformation_create_and_register(
+        NULL,
+        ib,
+        "filterValueRx",
+        true,
+        filter_rx_create, m,
+        NULL, NULL,
+        filter_rx_execute, (void *)c_filter_rx_value
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = ib_transformation_create_and_register(
+        NULL,
+        ib,
+        "filterNameRx",
+        true,
+        filter_rx_create, m,
+        NULL, NULL,
+        filter_rx_execute, (void *)c_filter_rx_name
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Module structure.
+ *
+ * This structure defines some metadata, config data and various functions.
+ */
+IB_MODULE_INIT(
+    IB_MODULE_HEADER_DEFAULTS,             /**< Default metadata */
+    MODULE_NAME_STR,                       /**< Module name */
+    IB_MODULE_CONFIG(&modpcre2_global_cfg),/**< Global config data */
+    config_map,                            /**< Configuration field map */
+    directive_map,                         /**< Config directive map */
+    modpcre2_init,                         /**< Initialize function */
+    NULL,                                  /**< Callback data */
+    NULL,                                  /**< Finish function */
+    NULL,                                  /**< Callback data */
+);
@@ -28,7 +28,11 @@
 #include <ironbee/engine.h>
 #include <ironbee/json.h>
 #include <ironbee/kvstore.h>
+#include <ironbee/kvstore_cache.h>
 #include <ironbee/kvstore_filesystem.h>
+#include <ironbee/kvstore_log.h>
+#include <ironbee/kvstore_shm.h>
+#include <ironbee/kvstore_writebehind.h>
 #include <ironbee/list.h>
 #include <ironbee/mm.h>
 #include <ironbee/module.h>
@@ -47,7 +51,15 @@
 //! Default expiration time of persisted collections (useconds)
 static const ib_num_t DEFAULT_EXPIRATION = 60;
 
+//! Default number of slots of a shared memory store.
+static const ib_num_t DEFAULT_SHM_SLOTS = 16384;
+
+//! Default size of each slot of a shared memory store (bytes).
+static const ib_num_t DEFAULT_SHM_SLOT_SIZE = 1024;
+
 static const char FILE_URI_PREFIX[] = "persist-fs://";
+static const char LOG_URI_PREFIX[] = "persist-log://";
+static const char SHM_URI_PREFIX[] = "persist-shm://";
 static const char JSON_TYPE[] = "application_json";
 
 /* Define the module name as well as a string version of it. */
@@ -72,6 +84,8 @@ static const char FILE_TYPE[] = "filerw";
  */
 struct file_rw_t {
     ib_kvstore_t *kvstore;
+    ib_kvstore_t *backing;      /**< Store under kvstore or NULL. */
+    ib_kvstore_t *write_behind; /**< Write-behind store or NULL. */
     ib_engine_t  *ib;
     const char   *key;
     size_t        keysz;
@@ -132,6 +146,11 @@ ib_status_t file_rw_create_fn(
     const ib_list_node_t *node;
     const char           *uri;
     file_rw_t            *file_rw;
+    ib_num_t              cache_size = 0;
+    ib_num_t              cache_age = 0;
+    ib_num_t              write_behind = 0;
+    ib_num_t              shm_slots = DEFAULT_SHM_SLOTS;
+    ib_num_t              shm_slot_size = DEFAULT_SHM_SLOT_SIZE;
     ib_status_t           rc;
 
     file_rw = ib_mm_calloc(mm, 1, sizeof(*file_rw));
@@ -172,6 +191,51 @@ ib_status_t file_rw_create_fn(
                 return IB_EALLOC;
             }
         }
+
+        val = get_val("cache=", opt);
+        if (val != NULL) {
+            rc = ib_type_atoi(val, 10, &cache_size);
+            if (rc != IB_OK || cache_size < 0) {
+                ib_log_error(ib, "Invalid cache size: %s", val);
+                return IB_EINVAL;
+            }
+        }
+
+        val = get_val("cache_age=", opt);
+        if (val != NULL) {
+            rc = ib_type_atoi(val, 10, &cache_age);
+            if (rc != IB_OK || cache_age < 0) {
+                ib_log_error(ib, "Invalid cache age: %s", val);
+                return IB_EINVAL;
+            }
+        }
+
+        val = get_val("write_behind=", opt);
+        if (val != NULL) {
+            rc = ib_type_atoi(val, 10, &write_behind);
+            if (rc != IB_OK || write_behind < 0) {
+                ib_log_error(ib, "Invalid write behind size: %s", val);
+                return IB_EINVAL;
+            }
+        }
+
+        val = get_val("slots=", opt);
+        if (val != NULL) {
+            rc = ib_type_atoi(val, 10, &shm_slots);
+            if (rc != IB_OK || shm_slots <= 0) {
+                ib_log_error(ib, "Invalid number of slots: %s", val);
+                return IB_EINVAL;
+            }
+        }
+
+        val = get_val("slot_size=", opt);
+        if (val != NULL) {
+            rc = ib_type_atoi(val, 10, &shm_slot_size);
+            if (rc != IB_OK || shm_slot_size <= 0) {
+                ib_log_error(ib, "Invalid slot size: %s", val);
+                return IB_EINVAL;
+            }
+        }
     }
 
     file_rw->kvstore = ib_mm_alloc(mm, ib_kvstore_size());
@@ -192,11 +256,99 @@ ib_status_t file_rw_create_fn(
             return rc;
         }
     }
+    else if (strncmp(uri, LOG_URI_PREFIX, sizeof(LOG_URI_PREFIX)-1) == 0) {
+        const char *path = uri + sizeof(LOG_URI_PREFIX)-1;
+        ib_log_debug(ib, "Creating key-value store in log file: %s", path);
+
+        rc = ib_kvstore_log_init(file_rw->kvstore, path);
+        if (rc != IB_OK) {
+            ib_log_error(ib, "Failed to initialize kvstore.");
+            return rc;
+        }
+
+        rc = ib_kvstore_connect(file_rw->kvstore);
+        if (rc != IB_OK) {
+            ib_log_error(ib, "Failed to connect to kvstore.");
+            return rc;
+        }
+    }
+    else if (strncmp(uri, SHM_URI_PREFIX, sizeof(SHM_URI_PREFIX)-1) == 0) {
+        const char *path = uri + sizeof(SHM_URI_PREFIX)-1;
+        ib_log_debug(ib, "Creating key-value store in shared memory: %s", path);
+
+        rc = ib_kvstore_shm_init(
+            file_rw->kvstore,
+            path,
+            shm_slots,
+            shm_slot_size);
+        if (rc != IB_OK) {
+            ib_log_error(ib, "Failed to initialize kvstore.");
+            return rc;
+        }
+
+        rc = ib_kvstore_connect(file_rw->kvstore);
+        if (rc != IB_OK) {
+            ib_log_error(ib, "Failed to connect to kvstore.");
+            return rc;
+        }
+    }
     else {
         ib_log_error(ib, "Unsupported URI: %s", uri);
         return IB_EINVAL;
     }
 
+    if (write_behind > 0) {
+        ib_log_debug(
+            ib,
+            "Writing behind up to %" PRId64 " writes to key-value store: %s",
+            write_behind,
+            uri);
+
+        file_rw->backing = file_rw->kvstore;
+        file_rw->write_behind = ib_mm_alloc(mm, ib_kvstore_size());
+        if (file_rw->write_behind == NULL) {
+            return IB_EALLOC;
+        }
+
+        rc = ib_kvstore_writebehind_init(
+            file_rw->write_behind,
+            file_rw->backing,
+            write_behind);
+        if (rc != IB_OK) {
+            ib_log_error(ib, "Failed to initialize kvstore write behind.");
+            return rc;
+        }
+        file_rw->kvstore = file_rw->write_behind;
+    }
+
+    if (cache_size > 0) {
+        ib_kvstore_t *cached = file_rw->kvstore;
+
+        ib_log_debug(
+            ib,
+            "Caching %" PRId64 " keys of key-value store: %s",
+            cache_size,
+            uri);
+
+        if (file_rw->backing == NULL) {
+            file_rw->backing = cached;
+        }
+        file_rw->kvstore = ib_mm_alloc(mm, ib_kvstore_size());
+        if (file_rw->kvstore == NULL) {
+            return IB_EALLOC;
+        }
+
+        rc = ib_kvstore_cache_init(
+            file_rw->kvstore,
+            cached,
+            cache_size,
+            cache_age * 1000000);
+        if (rc != IB_OK) {
+            ib_log_error(ib, "Failed to initialize kvstore cache.");
+            return rc;
+        }
+    }
+
     *(file_rw_t **)impl = file_rw;
     return IB_OK;
 }
@@ -215,6 +367,15 @@ static void file_rw_destroy_fn(
     ib_kvstore_disconnect(file_rw->kvstore);
 
     ib_kvstore_destroy(file_rw->kvstore);
+    if (
+        file_rw->write_behind != NULL &&
+        file_rw->write_behind != file_rw->kvstore
+    ) {
+        ib_kvstore_destroy(file_rw->write_behind);
+    }
+    if (file_rw->backing != NULL) {
+        ib_kvstore_destroy(file_rw->backing);
+    }
 }
 
 static ib_status_t file_rw_load_fn(
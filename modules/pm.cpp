@@ -0,0 +1,312 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Phrase Match Module
+ *
+ * This module adds support for matching any of a set of literal phrases.
+ *
+ * Adds the `pm` operator, which takes a set of phrases as a space separated
+ * list as argument.  It is true iff the input contains any of the phrases.
+ * The capture field is set to the first phrase found.
+ *
+ * The phrases of each operator instance are compiled into an Aho-Corasick
+ * automaton (IronAutomata) when the rule is configured, so the input is
+ * scanned once regardless of the number of phrases.  Unlike the `ee`
+ * operator, no separately generated automata file is needed.
+ */
+
+#include <ironbee/capture.h>
+
+#include <ironbeepp/all.hpp>
+
+#include <ironautomata/deduplicate_outputs.hpp>
+#include <ironautomata/eudoxus.h>
+#include <ironautomata/eudoxus_compiler.hpp>
+#include <ironautomata/generator/aho_corasick.hpp>
+#include <ironautomata/intermediate.hpp>
+#include <ironautomata/optimize_edges.hpp>
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#if __has_warning("-Wunused-local-typedef")
+#pragma clang diagnostic ignored "-Wunused-local-typedef"
+#endif
+#endif
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/bind.hpp>
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+using namespace IronBee;
+
+namespace {
+
+//! pm operator name.
+const char* c_pm = "pm";
+
+//! Called on module load.
+void module_load(IronBee::Module module);
+
+} // Anonymous
+
+IBPP_BOOTSTRAP_MODULE("pm", module_load)
+
+// Implementation
+
+// Reopen for doxygen; not needed by C++.
+namespace {
+
+/**
+ * Compile a set of phrases into a Eudoxus automaton.
+ *
+ * The output of each phrase is the phrase itself.
+ *
+ * @param[in] mm Memory manager determining lifetime.
+ * @param[in] parameters Space separated list of phrases.
+ * @return Eudoxus engine.
+ * @throw einval if there are no phrases or the automaton can not be loaded.
+ **/
+ia_eudoxus_t* compile_phrases(
+    MemoryManager mm,
+    const char*   parameters
+)
+{
+    namespace ia = IronAutomata;
+
+    vector<string> items;
+    boost::split(
+        items, parameters, boost::is_any_of(" "), boost::token_compress_on
+    );
+
+    ia::Intermediate::Automata automata;
+    size_t phrases = 0;
+
+    ia::Generator::aho_corasick_begin(automata);
+    for (vector<string>::const_iterator i = items.begin();
+         i != items.end();
+         ++i)
+    {
+        if (i->empty()) {
+            continue;
+        }
+        ia::Intermediate::byte_vector_t data(i->begin(), i->end());
+        ia::Generator::aho_corasick_add_data(automata, *i, data);
+        ++phrases;
+    }
+    if (phrases == 0) {
+        BOOST_THROW_EXCEPTION(
+            einval() << errinfo_what(
+                string(c_pm) + " requires at least one phrase."
+            )
+        );
+    }
+    ia::Generator::aho_corasick_finish(automata);
+
+    ia::Intermediate::breadth_first(
+        automata,
+        ia::Intermediate::optimize_edges
+    );
+    ia::Intermediate::deduplicate_outputs(automata);
+
+    ia::EudoxusCompiler::result_t result =
+        ia::EudoxusCompiler::compile(automata);
+
+    /* Eudoxus takes ownership of the data and frees it on destroy. */
+    char* data = reinterpret_cast<char*>(malloc(result.buffer.size()));
+    if (data == NULL) {
+        BOOST_THROW_EXCEPTION(ealloc());
+    }
+    memcpy(data, &result.buffer[0], result.buffer.size());
+
+    ia_eudoxus_t* eudoxus = NULL;
+    if (ia_eudoxus_create(&eudoxus, data) != IA_EUDOXUS_OK) {
+        free(data);
+        BOOST_THROW_EXCEPTION(
+            einval() << errinfo_what(
+                string(c_pm) + " failed to load compiled phrases."
+            )
+        );
+    }
+    mm.register_cleanup(boost::bind(ia_eudoxus_destroy, eudoxus));
+
+    return eudoxus;
+}
+
+/**
+ * First match of a pm execution.
+ **/
+struct pm_match_t
+{
+    //! Matched phrase; NULL if none.
+    const char* phrase;
+    //! Length of @ref phrase.
+    size_t      phrase_length;
+};
+
+/**
+ * Eudoxus output callback; records the phrase and stops at the first match.
+ *
+ * @param[in] engine Eudoxus engine.
+ * @param[in] output Output (the phrase).
+ * @param[in] output_length Length of @a output.
+ * @param[in] input_location End of the match in the input.
+ * @param[in] callback_data The pm_match_t to fill in.
+ * @return IA_EUDOXUS_CMD_STOP
+ **/
+ia_eudoxus_command_t pm_callback(
+    ia_eudoxus_t*  engine,
+    const char*    output,
+    size_t         output_length,
+    const uint8_t* input_location,
+    void*          callback_data
+)
+{
+    pm_match_t* match = reinterpret_cast<pm_match_t*>(callback_data);
+
+    match->phrase = output;
+    match->phrase_length = output_length;
+
+    return IA_EUDOXUS_CMD_STOP;
+}
+
+/** Execute pm. */
+int pm_execute(
+    ia_eudoxus_t* eudoxus,
+    Transaction   tx,
+    ConstField    input,
+    Field         capture
+)
+{
+    if (! input) {
+        return 0;
+    }
+
+    const uint8_t* data;
+    size_t         data_length;
+
+    if (input.type() == Field::BYTE_STRING) {
+        ConstByteString bs = input.value_as_byte_string();
+        data = reinterpret_cast<const uint8_t*>(bs.const_data());
+        data_length = bs.size();
+    }
+    else if (input.type() == Field::NULL_STRING) {
+        const char* s = input.value_as_null_string();
+        data = reinterpret_cast<const uint8_t*>(s);
+        data_length = strlen(s);
+    }
+    else {
+        BOOST_THROW_EXCEPTION(
+            einval() << errinfo_what(
+                string(c_pm) + " requires string input."
+            )
+        );
+    }
+
+    if (data == NULL || data_length == 0) {
+        return 0;
+    }
+
+    pm_match_t match = { NULL, 0 };
+    ia_eudoxus_state_t* state;
+    ia_eudoxus_result_t rc;
+
+    rc = ia_eudoxus_create_state(&state, eudoxus, pm_callback, &match);
+    if (rc != IA_EUDOXUS_OK) {
+        BOOST_THROW_EXCEPTION(
+            eother() << errinfo_what(
+                string(c_pm) + " failed to create automata state."
+            )
+        );
+    }
+    rc = ia_eudoxus_execute(state, data, data_length);
+    ia_eudoxus_destroy_state(state);
+
+    if (rc != IA_EUDOXUS_OK && rc != IA_EUDOXUS_STOP && rc != IA_EUDOXUS_END) {
+        const char* message = ia_eudoxus_error(eudoxus);
+        BOOST_THROW_EXCEPTION(
+            eother() << errinfo_what(
+                string(c_pm) + " automata execution failed: " +
+                (message != NULL ? message : "unknown error")
+            )
+        );
+    }
+
+    if (match.phrase == NULL) {
+        return 0;
+    }
+
+    if (capture) {
+        throw_if_error(ib_capture_clear(capture.ib()));
+        throw_if_error(ib_capture_set_item(
+            capture.ib(),
+            0,
+            tx.memory_manager().ib(),
+            Field::create_byte_string(
+                tx.memory_manager(),
+                "0", 1,
+                ByteString::create(
+                    tx.memory_manager(),
+                    match.phrase, match.phrase_length
+                )
+            ).ib()
+        ));
+    }
+
+    return 1;
+}
+
+/** Generate pm instance. */
+Operator::operator_instance_t pm_generator(
+    Context,
+    MemoryManager mm,
+    const char* parameters
+)
+{
+    if (parameters == NULL) {
+        BOOST_THROW_EXCEPTION(
+            einval() << errinfo_what(
+                string(c_pm) + " requires at least one phrase."
+            )
+        );
+    }
+
+    ia_eudoxus_t* eudoxus = compile_phrases(mm, parameters);
+
+    return bind(pm_execute, eudoxus, _1, _2, _3);
+}
+
+void module_load(IronBee::Module module)
+{
+    MemoryManager mm = module.engine().main_memory_mm();
+
+    Operator::create(
+        mm,
+        c_pm,
+        IB_OP_CAPABILITY_CAPTURE,
+        pm_generator
+    ).register_with(module.engine());
+}
+
+} // Anonymous
@@ -0,0 +1,606 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- ParserSuite HTTP module.
+ *
+ * A lightweight alternative to the htp module for servers that hand
+ * IronBee an already parsed request line and headers.  Instead of running
+ * libhtp over the connection, it splits the request URI and headers with
+ * ParserSuite and fills the request vars that the htp module provides:
+ *
+ * - `request_uri`, `request_uri_scheme`, `request_uri_username`,
+ *   `request_uri_password`, `request_uri_host`, `request_uri_port`,
+ *   `request_uri_path`, `request_uri_path_raw`, `request_uri_query` and
+ *   `request_uri_fragment`.
+ * - `request_uri_params` from the query string and `request_body_params`
+ *   from a `application/x-www-form-urlencoded` body; names and values
+ *   are URL decoded.
+ * - `request_cookies` from the `Cookie` headers and `request_host`.
+ *
+ * It also sets the transaction host name and path, used to select the
+ * context.  Values are aliases of the request line, headers and body
+ * wherever they need no decoding.  There is no normalization beyond URL
+ * decoding, no personality and none of the htp module's flags; do not load
+ * both modules.
+ *
+ * Request body parameters are parsed from the buffered request body, so
+ * only the part of the body within the request body log limit is used.
+ */
+
+#include <ironbee/module/parser_suite.hpp>
+
+#include <ironbeepp/all.hpp>
+
+#include <ironbee/stream.h>
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#if __has_warning("-Wunused-local-typedef")
+#pragma clang diagnostic ignored "-Wunused-local-typedef"
+#endif
+#endif
+#include <boost/bind.hpp>
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+using namespace std;
+
+using IronBee::ParserSuite::span_t;
+
+namespace {
+
+//! Request URI var names in the order of Delegate::uri_source_e.
+const char* c_uri_sources[] = {
+    "request_uri",
+    "request_uri_scheme",
+    "request_uri_username",
+    "request_uri_password",
+    "request_uri_host",
+    "request_uri_port",
+    "request_uri_path",
+    "request_uri_path_raw",
+    "request_uri_query",
+    "request_uri_fragment"
+};
+
+//! Module delegate.
+class Delegate :
+    public IronBee::ModuleDelegate
+{
+public:
+    //! Constructor.  Acquires var sources and registers hooks.
+    explicit
+    Delegate(IronBee::Module module);
+
+private:
+    //! Indices into @ref m_uri_sources.
+    enum uri_source_e {
+        URI,
+        URI_SCHEME,
+        URI_USERNAME,
+        URI_PASSWORD,
+        URI_HOST,
+        URI_PORT,
+        URI_PATH,
+        URI_PATH_RAW,
+        URI_QUERY,
+        URI_FRAGMENT,
+        URI_SOURCES
+    };
+
+    /**
+     * Parse the request line and headers of @a tx.
+     *
+     * @param[in] tx Transaction.
+     **/
+    void request_header_process(IronBee::Transaction tx) const;
+
+    /**
+     * Parse the parameters in the request body of @a tx.
+     *
+     * @param[in] tx Transaction.
+     **/
+    void request_finished(IronBee::Transaction tx) const;
+
+    //! Request URI var sources.
+    IronBee::VarSource m_uri_sources[URI_SOURCES];
+    //! request_uri_params.
+    IronBee::VarSource m_uri_params_source;
+    //! request_body_params.
+    IronBee::VarSource m_body_params_source;
+    //! request_cookies.
+    IronBee::VarSource m_cookies_source;
+    //! request_host.
+    IronBee::VarSource m_host_source;
+};
+
+} // Anonymous namespace
+
+IBPP_BOOTSTRAP_MODULE_DELEGATE("ps_http", Delegate)
+
+// Implementation
+
+namespace {
+
+/**
+ * Span of @a bs.
+ *
+ * @param[in] bs Byte string; may be singular.
+ * @returns Span of the data of @a bs.
+ **/
+span_t to_span(IronBee::ConstByteString bs)
+{
+    if (! bs || bs.length() == 0) {
+        return span_t();
+    }
+    return span_t(bs.const_data(), bs.const_data() + bs.length());
+}
+
+/**
+ * Does @a name equal @a s, ignoring case?
+ *
+ * @param[in] name Span to compare.
+ * @param[in] s    NUL terminated string.
+ * @returns true iff @a name and @a s are equal ignoring case.
+ **/
+bool equal_nocase(span_t name, const char* s)
+{
+    size_t length = strlen(s);
+    return
+        size_t(name.size()) == length &&
+        strncasecmp(name.begin(), s, length) == 0;
+}
+
+/**
+ * Trim whitespace from both ends of @a span.
+ *
+ * @param[in] span Span to trim.
+ * @returns @a span without leading and trailing whitespace.
+ **/
+span_t trim(span_t span)
+{
+    const char* begin = span.begin();
+    const char* end = span.end();
+
+    while (begin < end && isspace(static_cast<unsigned char>(*begin))) {
+        ++begin;
+    }
+    while (end > begin && isspace(static_cast<unsigned char>(*(end - 1)))) {
+        --end;
+    }
+    return span_t(begin, end);
+}
+
+/**
+ * Value of a hexadecimal digit.
+ *
+ * @param[in] c Character.
+ * @returns Value of @a c or -1 if @a c is not a hexadecimal digit.
+ **/
+int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * URL decode @a span.
+ *
+ * Invalid escapes are left as they are.  @a span itself is returned if it
+ * needs no decoding; otherwise, the decoded copy is allocated from @a mm.
+ *
+ * @param[in] mm            Memory manager to allocate from.
+ * @param[in] span          Span to decode.
+ * @param[in] plus_is_space Decode `+` to space?
+ * @returns Decoded span.
+ **/
+span_t url_decode(
+    IronBee::MemoryManager mm,
+    span_t                 span,
+    bool                   plus_is_space
+)
+{
+    const char* begin = span.begin();
+    const char* end = span.end();
+    const char* p = begin;
+
+    while (p < end && *p != '%' && (! plus_is_space || *p != '+')) {
+        ++p;
+    }
+    if (p == end) {
+        return span;
+    }
+
+    char* buf = static_cast<char*>(mm.alloc(end - begin));
+    char* out = buf + (p - begin);
+    memcpy(buf, begin, p - begin);
+    while (p < end) {
+        if (*p == '+' && plus_is_space) {
+            *out++ = ' ';
+            ++p;
+        }
+        else if (
+            *p == '%' && end - p >= 3 &&
+            hex_value(p[1]) >= 0 && hex_value(p[2]) >= 0
+        ) {
+            *out++ = char(hex_value(p[1]) * 16 + hex_value(p[2]));
+            p += 3;
+        }
+        else {
+            *out++ = *p++;
+        }
+    }
+
+    return span_t(buf, out);
+}
+
+/**
+ * Create a byte string field aliasing @a value.
+ *
+ * @param[in] mm    Memory manager to use.
+ * @param[in] name  Name of field.
+ * @param[in] value Value of field.
+ * @returns Field.
+ **/
+IronBee::Field alias_field(
+    IronBee::MemoryManager mm,
+    span_t                 name,
+    span_t                 value
+)
+{
+    return IronBee::Field::create_no_copy_byte_string(
+        mm,
+        name.begin(), name.size(),
+        IronBee::ByteString::create_alias(
+            mm,
+            value.begin(), value.size()
+        )
+    );
+}
+
+/**
+ * Set @a source to a byte string aliasing @a value if it is not empty.
+ *
+ * @param[in] tx     Transaction.
+ * @param[in] source Var source.
+ * @param[in] name   Name of @a source.
+ * @param[in] value  Value.
+ **/
+void set_var(
+    IronBee::Transaction      tx,
+    const IronBee::VarSource& source,
+    const char*               name,
+    span_t                    value
+)
+{
+    if (value.empty()) {
+        return;
+    }
+    source.set(
+        tx.var_store(),
+        alias_field(
+            tx.memory_manager(),
+            span_t(name, name + strlen(name)),
+            value
+        )
+    );
+}
+
+/**
+ * Get the list of @a source, creating it if necessary.
+ *
+ * @param[in] tx     Transaction.
+ * @param[in] source Var source.
+ * @returns List field.
+ **/
+IronBee::Field get_list(
+    IronBee::Transaction      tx,
+    const IronBee::VarSource& source
+)
+{
+    try {
+        return source.get(tx.var_store());
+    }
+    catch (const IronBee::enoent&) {
+        return source.initialize(tx.var_store(), IronBee::Field::LIST);
+    }
+}
+
+/**
+ * Add the parameters in @a input to @a list.
+ *
+ * Parameters are separated by @a separator and their names are
+ * separated from their values by `=`.
+ *
+ * @param[in] mm        Memory manager to use.
+ * @param[in] list      List field to add parameters to.
+ * @param[in] input     Parameters.
+ * @param[in] separator Separator of parameters.
+ * @param[in] decode    URL decode names and values?
+ * @returns Number of parameters added.
+ **/
+size_t add_params(
+    IronBee::MemoryManager mm,
+    IronBee::Field         list,
+    span_t                 input,
+    char                   separator,
+    bool                   decode
+)
+{
+    IronBee::List<IronBee::Field> fields =
+        list.mutable_value_as_list<IronBee::Field>();
+    const char* p = input.begin();
+    const char* end = input.end();
+    size_t count = 0;
+
+    while (p < end) {
+        const char* param_end =
+            static_cast<const char*>(memchr(p, separator, end - p));
+        if (param_end == NULL) {
+            param_end = end;
+        }
+
+        span_t param(p, param_end);
+        if (! decode) {
+            param = trim(param);
+        }
+        if (! param.empty()) {
+            const char* eq = static_cast<const char*>(
+                memchr(param.begin(), '=', param.size())
+            );
+            span_t name(param.begin(), eq ? eq : param.end());
+            span_t value(eq ? eq + 1 : param.end(), param.end());
+
+            if (decode) {
+                name = url_decode(mm, name, true);
+                value = url_decode(mm, value, true);
+            }
+            if (! name.empty()) {
+                fields.push_back(alias_field(mm, name, value));
+                ++count;
+            }
+        }
+
+        p = param_end + 1;
+    }
+
+    return count;
+}
+
+/**
+ * Copy @a span to a NUL terminated string.
+ *
+ * @param[in] mm   Memory manager to allocate from.
+ * @param[in] span Span to copy.
+ * @returns NUL terminated copy of @a span.
+ **/
+const char* to_nulstr(IronBee::MemoryManager mm, span_t span)
+{
+    char* s = static_cast<char*>(mm.alloc(span.size() + 1));
+    memcpy(s, span.begin(), span.size());
+    s[span.size()] = '\0';
+    return s;
+}
+
+Delegate::Delegate(IronBee::Module module) :
+    IronBee::ModuleDelegate(module)
+{
+    IronBee::MemoryManager mm = module.engine().main_memory_mm();
+    IronBee::ConstVarConfig config = module.engine().var_config();
+
+    for (int i = 0; i < URI_SOURCES; ++i) {
+        m_uri_sources[i] = IronBee::VarSource::acquire(
+            mm, config, string(c_uri_sources[i])
+        );
+    }
+    m_uri_params_source = IronBee::VarSource::acquire(
+        mm, config, string("request_uri_params")
+    );
+    m_body_params_source = IronBee::VarSource::acquire(
+        mm, config, string("request_body_params")
+    );
+    m_cookies_source = IronBee::VarSource::acquire(
+        mm, config, string("request_cookies")
+    );
+    m_host_source = IronBee::VarSource::acquire(
+        mm, config, string("request_host")
+    );
+
+    module.engine().register_hooks()
+        .request_header_process(
+            boost::bind(&Delegate::request_header_process, this, _2)
+        )
+        .request_finished(
+            boost::bind(&Delegate::request_finished, this, _2)
+        );
+}
+
+void Delegate::request_header_process(IronBee::Transaction tx) const
+{
+    using namespace IronBee::ParserSuite;
+
+    IronBee::MemoryManager mm = tx.memory_manager();
+    span_t host;
+
+    IronBee::ParsedRequestLine request_line = tx.request_line();
+    if (request_line) {
+        span_t uri = to_span(request_line.uri());
+        span_t input = uri;
+        parse_uri_result_t parsed;
+
+        try {
+            parsed = parse_uri(input);
+        }
+        catch (const error&) {
+            ib_log_info_tx(tx.ib(), "Could not parse request URI.");
+        }
+
+        parse_authority_result_t authority;
+        if (! parsed.authority.empty()) {
+            span_t authority_input = parsed.authority;
+            try {
+                authority = parse_authority(authority_input);
+            }
+            catch (const error&) {
+                ib_log_info_tx(tx.ib(), "Could not parse URI authority.");
+            }
+        }
+
+        span_t path = url_decode(mm, parsed.path, false);
+        const span_t values[URI_SOURCES] = {
+            uri,
+            parsed.scheme,
+            authority.username,
+            authority.password,
+            authority.host,
+            authority.port,
+            path,
+            parsed.path,
+            parsed.query,
+            parsed.fragment
+        };
+        for (int i = 0; i < URI_SOURCES; ++i) {
+            set_var(tx, m_uri_sources[i], c_uri_sources[i], values[i]);
+        }
+
+        size_t count = add_params(
+            mm, get_list(tx, m_uri_params_source), parsed.query, '&', true
+        );
+        ib_log_debug2_tx(tx.ib(), "Parsed %zd request URI parameters",
+                         count);
+
+        if (! path.empty()) {
+            tx.ib()->path = to_nulstr(mm, path);
+        }
+        host = authority.host;
+    }
+
+    IronBee::Field cookies = get_list(tx, m_cookies_source);
+    for (
+        IronBee::ParsedHeader header = tx.request_header();
+        header;
+        header = header.next()
+    )
+    {
+        span_t name = to_span(header.name());
+        if (equal_nocase(name, "host")) {
+            // Strip the port, but not the colons of an IPv6 address.
+            span_t value = trim(to_span(header.value()));
+            const char* p = value.end();
+            while (p > value.begin() && isdigit(static_cast<unsigned char>(*(p - 1)))) {
+                --p;
+            }
+            if (p > value.begin() && *(p - 1) == ':') {
+                value = span_t(value.begin(), p - 1);
+            }
+            if (! value.empty()) {
+                host = value;
+            }
+        }
+        else if (equal_nocase(name, "cookie")) {
+            add_params(mm, cookies, to_span(header.value()), ';', false);
+        }
+    }
+
+    if (! host.empty()) {
+        tx.ib()->hostname = to_nulstr(mm, host);
+    }
+    else if (tx.ib()->hostname == NULL || *(tx.ib()->hostname) == '\0') {
+        // Fall back to the connection's IP, as the htp module does.
+        tx.ib()->hostname = tx.connection().local_ip_string();
+    }
+    if (tx.ib()->path == NULL) {
+        tx.ib()->path = "/";
+    }
+
+    const char* hostname = tx.ib()->hostname ? tx.ib()->hostname : "";
+    set_var(tx, m_host_source, "request_host",
+            span_t(hostname, hostname + strlen(hostname)));
+}
+
+void Delegate::request_finished(IronBee::Transaction tx) const
+{
+    static const char c_urlencoded[] = "application/x-www-form-urlencoded";
+
+    IronBee::MemoryManager mm = tx.memory_manager();
+    const ib_stream_t* body = tx.ib()->request_body;
+    bool urlencoded = false;
+
+    for (
+        IronBee::ParsedHeader header = tx.request_header();
+        header;
+        header = header.next()
+    )
+    {
+        if (equal_nocase(to_span(header.name()), "content-type")) {
+            span_t value = trim(to_span(header.value()));
+            urlencoded =
+                size_t(value.size()) >= sizeof(c_urlencoded) - 1 &&
+                strncasecmp(
+                    value.begin(), c_urlencoded, sizeof(c_urlencoded) - 1
+                ) == 0;
+        }
+    }
+
+    IronBee::Field params = get_list(tx, m_body_params_source);
+    if (! urlencoded || body == NULL || body->slen == 0) {
+        return;
+    }
+
+    // Parse a body of one segment in place; copy one of several.
+    span_t input;
+    if (body->nelts == 1) {
+        const char* data = static_cast<const char*>(body->head->data);
+        input = span_t(data, data + body->head->dlen);
+    }
+    else {
+        char* buf = static_cast<char*>(mm.alloc(body->slen));
+        char* out = buf;
+        for (
+            const ib_sdata_t* sdata = body->head;
+            sdata != NULL;
+            sdata = sdata->next
+        )
+        {
+            if (sdata->type == IB_STREAM_DATA && sdata->dlen > 0) {
+                memcpy(out, sdata->data, sdata->dlen);
+                out += sdata->dlen;
+            }
+        }
+        input = span_t(buf, out);
+    }
+
+    size_t count = add_params(mm, params, input, '&', true);
+    ib_log_debug2_tx(tx.ib(), "Parsed %zd request body parameters", count);
+}
+
+} // Anonymous namespace
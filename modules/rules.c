@@ -160,9 +160,8 @@ static ib_status_t parse_operator(ib_cfgparser_t *cp,
     }
 
     /* Create the operator instance */
-    rc = ib_operator_inst_create(
+    rc = ib_operator_inst_acquire(
         &real_opinst,
-        main_mm,
         cp->cur_ctx,
         operator,
         ib_rule_required_op_flags(rule),
@@ -547,7 +546,12 @@ static ib_status_t parse_modifier(ib_cfgparser_t *cp,
 
     /* Tag modifier */
     if (strcasecmp(name, "tag") == 0) {
-        rc = ib_list_push(rule->meta.tags, (void *)value);
+        const char *tag = ib_engine_intern(cp->ib, value);
+
+        if ( (tag == NULL) && (value != NULL) ) {
+            return IB_EALLOC;
+        }
+        rc = ib_list_push(rule->meta.tags, (void *)tag);
         return rc;
     }
 
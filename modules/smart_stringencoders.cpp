@@ -40,6 +40,7 @@
 #include <boost/foreach.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -80,6 +81,16 @@ public:
         size_t*     out_len
     ) const = 0;
 
+    /**
+     * The first character of every input this decoder can decode.
+     *
+     * Input up to the next such character of any decoder is copied without
+     * calling any decoder.
+     *
+     * @returns The first character.
+     */
+    virtual char first_char() const = 0;
+
     virtual ~AbstractDecoder(){};
 };
 
@@ -121,6 +132,8 @@ public:
         size_t*     out_len
     ) const;
 
+    //! The first character of the prefix.
+    char first_char() const;
 };
 
 HexDecoder::HexDecoder(string prefix) : m_prefix(prefix)
@@ -153,6 +166,11 @@ size_t HexDecoder::attempt_decode(
     return 0;
 }
 
+char HexDecoder::first_char() const
+{
+    return m_prefix[0];
+}
+
 bool HexDecoder::can_decode(const char *in, size_t in_sz) const
 {
     if (m_prefix.size() + 2 > in_sz) {
@@ -171,6 +189,7 @@ public:
         char*       out,
         size_t*     out_len
     ) const;
+    char first_char() const;
 };
 
 
@@ -178,6 +197,11 @@ HtmlEntityDecoder::HtmlEntityDecoder()
 {
 }
 
+char HtmlEntityDecoder::first_char() const
+{
+    return '&';
+}
+
 size_t HtmlEntityDecoder::attempt_decode(
     const char* in,
     size_t      in_len,
@@ -227,6 +251,22 @@ private:
     std::string m_arg;
 
     std::vector< boost::shared_ptr< AbstractDecoder > > m_decoders;
+
+    //! The distinct first characters of all decoders.
+    std::string m_first_chars;
+
+    //! True for each character in m_first_chars.
+    bool m_is_first_char[256];
+
+    /**
+     * Find the next character that a decoder may start at.
+     *
+     * @param[in] str The input to search.
+     * @param[in] end The end of @a str.
+     *
+     * @returns The first character of a decoder in @a str or @a end.
+     */
+    const char* find_first_char(const char* str, const char* end) const;
 public:
 
     /**
@@ -265,10 +305,39 @@ SmartStringEncoderTransformation& SmartStringEncoderTransformation::add(
     boost::shared_ptr<AbstractDecoder> decoder
 )
 {
+    const char c = decoder->first_char();
+
     m_decoders.push_back(decoder);
+    if (! m_is_first_char[static_cast<unsigned char>(c)]) {
+        m_is_first_char[static_cast<unsigned char>(c)] = true;
+        m_first_chars.push_back(c);
+    }
     return *this;
 }
 
+const char* SmartStringEncoderTransformation::find_first_char(
+    const char* str,
+    const char* end
+) const
+{
+    /* A single first character, such as the '%' of all URL decoders, is
+     * found with memchr(), which examines several bytes at a time. */
+    if (m_first_chars.size() == 1) {
+        const void* found = memchr(str, m_first_chars[0], end - str);
+
+        return (found == NULL) ? end : static_cast<const char*>(found);
+    }
+
+    while (
+        str < end &&
+        ! m_is_first_char[static_cast<unsigned char>(*str)]
+    ) {
+        ++str;
+    }
+
+    return str;
+}
+
 /**
  * The Smart String Encoder module delegate.
  */
@@ -289,6 +358,7 @@ SmartStringEncoderTransformation::SmartStringEncoderTransformation(
 ) :
     m_arg(arg)
 {
+    std::fill(m_is_first_char, m_is_first_char + 256, false);
 }
 
 ConstField SmartStringEncoderTransformation::operator()(
@@ -330,7 +400,23 @@ ConstField SmartStringEncoderTransformation::operator()(
         size_t bytes_written  = 0;
         size_t bytes_consumed = 0;
 
-        BOOST_FOREACH(boost::shared_ptr<AbstractDecoder> decoder, m_decoders)
+        /* Copy everything up to where a decoder may apply at once. */
+        const char* next = find_first_char(instr + i, instr + instr_sz);
+        if (next != instr + i) {
+            size_t run = next - (instr + i);
+
+            memcpy(outstr + outstr_sz, instr + i, run);
+            outstr_sz += run;
+            i += run;
+            if (i == instr_sz) {
+                break;
+            }
+        }
+
+        BOOST_FOREACH(
+            const boost::shared_ptr<AbstractDecoder>& decoder,
+            m_decoders
+        )
         {
             bytes_consumed = decoder->attempt_decode(
                 instr + i,
@@ -46,6 +46,7 @@
 #pragma clang diagnostic pop
 #endif
 
+#include <cstring>
 #include <string>
 
 using namespace IronBee;
@@ -85,28 +86,85 @@ public:
 
 protected:
 
+    /**
+     * Could @a first to @a last contain a comment?
+     *
+     * Every comment starts with a slash and an asterisk or, if
+     * m_line_comments is set, with `--` or `#`.  Input without these,
+     * which is most input, can not be changed by the parser, so the
+     * parser is not run on it.
+     *
+     * @param[in] first Start of the input.
+     * @param[in] last End of the input.
+     *
+     * @returns True if the parser must run.
+     */
+    bool may_have_comment(itr_t first, itr_t last) const;
+
     //! Test to replace matched comments with.
     std::string m_replacement;
 
+    //! Do comments also start with `--` or `#`?
+    bool m_line_comments;
+
     //! Main parser.
     qi::rule<itr_t, std::string()> m_parser;
 };
 
-ReplaceComments::ReplaceComments() : m_replacement("")
+ReplaceComments::ReplaceComments() :
+    m_replacement(""),
+    m_line_comments(false)
 {}
 
 ReplaceComments::ReplaceComments(
     const ReplaceComments& that
 ) :
-    m_replacement(that.m_replacement)
+    m_replacement(that.m_replacement),
+    m_line_comments(that.m_line_comments)
 {}
 
 ReplaceComments::ReplaceComments(
     const char * replacement
 ) :
-    m_replacement(replacement)
+    m_replacement(replacement),
+    m_line_comments(false)
 {}
 
+bool ReplaceComments::may_have_comment(itr_t first, itr_t last) const
+{
+    if (! m_line_comments) {
+        /* Only block comments; memchr() is much faster than a loop. */
+        for (
+            itr_t i = static_cast<itr_t>(memchr(first, '/', last - first));
+            i != NULL && i + 1 < last;
+            i = static_cast<itr_t>(memchr(i + 1, '/', last - i - 1))
+        ) {
+            if (i[1] == '*') {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    for (itr_t i = first; i < last; ++i) {
+        switch (*i) {
+        case '#':
+            return true;
+        case '/':
+            if (i + 1 < last && i[1] == '*') {
+                return true;
+            }
+            break;
+        case '-':
+            if (i + 1 < last && i[1] == '-') {
+                return true;
+            }
+            break;
+        }
+    }
+    return false;
+}
+
 ConstField ReplaceComments::operator()(
     MemoryManager mm,
     ConstField    field_in
@@ -143,6 +201,9 @@ ConstField ReplaceComments::operator()(
         return field_in;
     }
 
+    if (! may_have_comment(first, last)) {
+        return field_in;
+    }
 
     /* Parse a single comment. */
     parse_success = qi::phrase_parse(
@@ -170,7 +231,7 @@ ConstField ReplaceComments::operator()(
         parse_success &&
         cleaned_text.length() != static_cast<size_t>(last-first)
     ) {
-        return Field::create_byte_string(
+        return Field::create_no_copy_byte_string(
             field_in.memory_manager(),
             field_in.name(),
             field_in.name_length(),
@@ -339,6 +400,8 @@ void MysqlReplaceComments::build_parser()
 {
     using boost::spirit::qi::labels::_val;
 
+    m_line_comments = true;
+
     // Basic symbols.
     m_open_comment  = qi::lit("/*");
     m_close_comment = qi::lit("*/");
@@ -445,6 +508,8 @@ void OracleReplaceComments::build_parser()
 {
     using boost::spirit::qi::labels::_val;
 
+    m_line_comments = true;
+
     // Basic symbols.
     m_open_comment  = qi::lit("/*");
     m_close_comment = qi::lit("*/");
@@ -82,6 +82,13 @@ ConstField b64_decode(
 
     int actual_output_length =
         modp_b64_decode(output, bs.const_data(), bs.size());
+    if (actual_output_length < 0) {
+        BOOST_THROW_EXCEPTION(
+            einval() << errinfo_what(
+                "Invalid base64 input."
+            )
+        );
+    }
 
     return Field::create_no_copy_byte_string(
         mm,
@@ -110,6 +117,13 @@ ConstField b64w_decode(
 
     int actual_output_length =
         modp_b64w_decode(output, bs.const_data(), bs.size());
+    if (actual_output_length < 0) {
+        BOOST_THROW_EXCEPTION(
+            einval() << errinfo_what(
+                "Invalid web safe base64 input."
+            )
+        );
+    }
 
     return Field::create_no_copy_byte_string(
         mm,
@@ -145,22 +159,33 @@ ConstField b16_decode(
         data_length = bs_size;
     }
     else {
-        // Extract out XX from any prefixXX in string.
+        // Extract out XX from any prefixXX in string.  Candidates are
+        // found with memchr() on the first character of the prefix, which
+        // examines several bytes at a time, and everything else is skipped.
         size_t prefix_length = strlen(prefix);
         char* mutable_data = mm.allocate<char>(bs_size);
         data = mutable_data;
-        size_t i = 0;
         data_length = 0;
-        while (i < bs_size - prefix_length - 1) {
-            if (memcmp(bs_data + i, prefix, prefix_length) == 0) {
-                // skip prefix
-                i += prefix_length;
-                // copy two chars
-                *(mutable_data + data_length) = *(bs_data + i);
+        const char* i = bs_data;
+        const char* end = bs_data + bs_size;
+        while (end - i >= static_cast<ptrdiff_t>(prefix_length + 2)) {
+            const char* candidate = static_cast<const char*>(
+                memchr(i, prefix[0], end - i - prefix_length - 1)
+            );
+            if (! candidate) {
+                break;
+            }
+            if (memcmp(candidate, prefix, prefix_length) == 0) {
+                // skip prefix and copy two chars
+                i = candidate + prefix_length;
+                *(mutable_data + data_length) = *i;
                 ++data_length; ++i;
-                *(mutable_data + data_length) = *(bs_data + i);
+                *(mutable_data + data_length) = *i;
                 ++data_length; ++i;
             }
+            else {
+                i = candidate + 1;
+            }
         }
     }
 
@@ -168,6 +193,13 @@ ConstField b16_decode(
     char* output = mm.allocate<char>(output_length);
 
     int actual_output_length = modp_b16_decode(output, data, data_length);
+    if (actual_output_length < 0) {
+        BOOST_THROW_EXCEPTION(
+            einval() << errinfo_what(
+                "Invalid base16 input."
+            )
+        );
+    }
 
     return Field::create_no_copy_byte_string(
         mm,
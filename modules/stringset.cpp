@@ -100,6 +100,7 @@ const ib_stringset_t* construct_set(
     }
 
     throw_if_error(ib_stringset_init(set, entries, items.size()));
+    throw_if_error(ib_stringset_index(set, mm.ib()));
 
     return set;
 }
@@ -319,6 +319,53 @@ class TestAuthScan < CLIPPTest::TestCase
         assert_log_match /authscan.cpp.*Allowing Transaction/
     end
 
+    def test_authscan_location_uppercase
+        secret = 'mysecret'
+        host   = 'www.myhost.com'
+        date   = generate_date
+        req1   = 'GET /a HTTP/1.1'
+        req2   = 'GET /a/b HTTP/1.1'
+        hash1  = generate_hash(secret, req1, host, date).upcase
+        hash2  = generate_hash(secret, req2, host, date)
+        clipp(
+            modhtp: true,
+            modules: %w{ authscan },
+            log_level: 'debug',
+            config: """
+                AuthScanEnable on
+                AuthScanSharedSecret #{secret}
+            """,
+            default_site_config: """
+                <Location /a>
+                </Location>
+            """
+        ) do
+            transaction do |t|
+                t.request(
+                    raw: req1,
+                    headers: {
+                        'Host' => host,
+                        'X-Auth-Scan' => "#{hash1};date=#{date}"
+                    }
+                )
+                t.response(raw: 'HTTP/1.1 200 OK')
+            end
+            transaction do |t|
+                t.request(
+                    raw: req2,
+                    headers: {
+                        'Host' => host,
+                        'X-Auth-Scan' => "#{hash2};date=#{date}"
+                    }
+                )
+                t.response(raw: 'HTTP/1.1 200 OK')
+            end
+        end
+
+        assert_no_issues
+        assert_equal(2, @log.scan(/authscan.cpp.*Allowing Transaction/).size)
+    end
+
     private
 
     def generate_date(t=Time.new)
@@ -54,4 +54,26 @@ class TestConstant < CLIPPTest::TestCase
     assert_log_no_match /CLIPP ANNOUNCE: Baz/
     assert_no_issues
   end
+
+  def test_oracle_location
+    clipp(
+      modules: ['constant'],
+      default_site_config: <<-EOS
+        ConstantSet Foo Bar
+        Rule CONSTANT:Foo @match Bar phase:REQUEST_HEADER id:1 clipp_announce:Foo
+        Rule CONSTANT:Foobar @match Baz phase:REQUEST_HEADER id:2 clipp_announce:Foobar
+        Rule CONSTANT:Foob @nop "" phase:REQUEST_HEADER id:3 clipp_announce:Foob
+        <Location /x>
+          ConstantSet Foobar Baz
+        </Location>
+      EOS
+    ) do
+      transaction {|t| t.request(raw: "GET /")}
+      transaction {|t| t.request(raw: "GET /x")}
+    end
+    assert_equal(2, @log.scan(/CLIPP ANNOUNCE: Foo$/).size)
+    assert_equal(1, @log.scan(/CLIPP ANNOUNCE: Foobar/).size)
+    assert_log_no_match /CLIPP ANNOUNCE: Foob$/
+    assert_no_issues
+  end
 end
@@ -110,6 +110,36 @@ class TestFast < CLIPPTest::TestCase
     assert_log_match /CLIPP ANNOUNCE: rheader/
   end
 
+  def test_earlier_phase
+    clipp(
+      :input_hashes => [simple_hash(
+        "GET /a HTTP/1.1\nHost: crossphase\n\n",
+        "HTTP/1.1 200 OK\nABC: XYZ\n\n"
+      )],
+      :config => CONFIG,
+      :default_site_config => "Include \"#{Dir.pwd}/fast_rules.txt\""
+    )
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: crossphase/
+  end
+
+  def test_generate
+    clipp(
+      :input_hashes => [make_request('abcdef')],
+      :config => [
+        'LoadModule "ibmod_fast.so"',
+        'LoadModule "ibmod_pcre.so"',
+        'FastGenerate on'
+      ].join("\n"),
+      :default_site_config => "Include \"#{Dir.pwd}/fast_rules.txt\""
+    )
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: abc/
+    assert_log_match /CLIPP ANNOUNCE: def/
+    assert_log_no_match /CLIPP ANNOUNCE: somethingelse/
+    assert_log_no_match /CLIPP ANNOUNCE: contradiction/
+  end
+
   def test_not_enabled
     clipp(
       :input_hashes => [make_request('foobar')],
@@ -103,4 +103,19 @@ class TestHeaderOrder < CLIPPTest::TestCase
     assert_log_match /RESPONSE=213/
     assert_no_issues
   end
+
+  def test_case
+    header_order_clipp(
+      ['hOST', 'ACCEPT', 'referer', 'Accept-Encoding', 'Accept-Language'],
+      ['LOCATION', 'date'],
+      default_site_config: <<-EOS
+        Action id:1 phase:REQUEST "clipp_announce:REQUEST=%{REQUEST_HEADER_ORDER}"
+        Action id:2 phase:RESPONSE_HEADER "clipp_announce:RESPONSE=%{RESPONSE_HEADER_ORDER}"
+      EOS
+    )
+
+    assert_log_match /REQUEST=HAREL/
+    assert_log_match /RESPONSE=AD/
+    assert_no_issues
+  end
 end
@@ -43,6 +43,27 @@ class TestInitCollection < CLIPPTest::TestCase
     assert_log_match /clipp_print \['B2'\]: b2/
   end
 
+  def test_init_collection_after_rule
+    clipp(
+      :input_hashes => [simple_hash("GET /foobar\n", "HTTP/1.1 200 OK\n\n")],
+      :config => '''
+        LoadModule ibmod_persistence_framework.so
+        LoadModule ibmod_init_collection.so
+
+        Rule COL1:A @clipp_print "A1" id:1 rev:1 phase:REQUEST
+
+        InitCollection COL1 vars: \
+          A=a1
+      ''',
+      :default_site_config => <<-EOS
+        RuleEnable all
+      EOS
+    )
+
+    assert_no_issues
+    assert_log_match /clipp_print \[A1\]: a1/
+  end
+
   def test_init_collection_json
     clipp(
       :input_hashes => [simple_hash("GET /foobar\n", "HTTP/1.1 200 OK\n\n")],
@@ -72,6 +93,27 @@ class TestInitCollection < CLIPPTest::TestCase
     assert_log_match /clipp_print \['B2'\]: b2/
   end
 
+  def test_init_collection_json_every_transaction
+    clipp(
+      :input_hashes => [
+        simple_hash("GET /foobar\n", "HTTP/1.1 200 OK\n\n"),
+        simple_hash("GET /foobaz\n", "HTTP/1.1 200 OK\n\n")
+      ],
+      :config => '''
+        LoadModule ibmod_persistence_framework.so
+        LoadModule ibmod_init_collection.so
+
+        InitCollection COL1 json-file://init_collection_1.json
+      ''',
+      :default_site_config => <<-EOS
+        Rule COL1:A @clipp_print 'A1' id:1 rev:1 phase:REQUEST
+      EOS
+    )
+
+    assert_no_issues
+    assert_log_every_input_match /clipp_print \['A1'\]: a1/
+  end
+
   def test_init_collection_two_sites
     clipp(
       :input_hashes => [simple_hash("GET /foobar\n", "HTTP/1.1 200 OK\n\n")],
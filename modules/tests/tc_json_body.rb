@@ -0,0 +1,92 @@
+class TestJsonBody < CLIPPTest::TestCase
+  include CLIPPTest
+
+  def json_request(t, body, type = 'application/json')
+    t.request(
+      method: 'POST',
+      uri: '/',
+      protocol: 'HTTP/1.1',
+      headers: {
+        'Host' => 'www.myhost.com',
+        'Content-Type' => type,
+        'Content-Length' => body.length
+      },
+      body: body
+    )
+  end
+
+  def test_json_body
+    clipp(
+      modules: %w[ json_body ],
+      config: 'JsonBody On',
+      default_site_config: <<-EOS
+        Rule request_body_params:user.name @streq "x" id:1 phase:REQUEST clipp_announce:name
+        Rule ARGS:user.roles @streq "b" id:2 phase:REQUEST clipp_announce:role
+        Rule ARGS:n @streq "1.50" id:3 phase:REQUEST clipp_announce:number
+        Rule ARGS:ok @streq "true" id:4 phase:REQUEST clipp_announce:boolean
+      EOS
+    ) do
+      transaction do |t|
+        json_request(t,
+          '{"user": {"name": "x", "roles": ["a", "b"]}, "n": 1.50, "ok": true}')
+      end
+    end
+
+    assert_no_issues
+    assert_log_match 'CLIPP ANNOUNCE: name'
+    assert_log_match 'CLIPP ANNOUNCE: role'
+    assert_log_match 'CLIPP ANNOUNCE: number'
+    assert_log_match 'CLIPP ANNOUNCE: boolean'
+  end
+
+  def test_json_body_suffix_type
+    clipp(
+      modules: %w[ json_body ],
+      config: 'JsonBody On',
+      default_site_config: <<-EOS
+        Rule ARGS:a @streq "1" id:1 phase:REQUEST clipp_announce:suffix
+      EOS
+    ) do
+      transaction do |t|
+        json_request(t, '{"a": 1}', 'application/vnd.api+json; charset=utf-8')
+      end
+    end
+
+    assert_no_issues
+    assert_log_match 'CLIPP ANNOUNCE: suffix'
+  end
+
+  def test_json_body_off
+    clipp(
+      modules: %w[ json_body ],
+      default_site_config: <<-EOS
+        Rule ARGS:a @streq "1" id:1 phase:REQUEST clipp_announce:off
+      EOS
+    ) do
+      transaction do |t|
+        json_request(t, '{"a": 1}')
+      end
+    end
+
+    assert_no_issues
+    assert_log_no_match /CLIPP ANNOUNCE: off/
+  end
+
+  def test_json_body_invalid
+    clipp(
+      modules: %w[ json_body ],
+      config: 'JsonBody On',
+      default_site_config: <<-EOS
+        Rule ARGS:a @streq "1" id:1 phase:REQUEST clipp_announce:partial
+      EOS
+    ) do
+      transaction do |t|
+        json_request(t, '{"a": 1, "b": ]')
+      end
+    end
+
+    assert_no_issues
+    assert_log_match 'CLIPP ANNOUNCE: partial'
+    assert_log_match 'Error parsing JSON body'
+  end
+end
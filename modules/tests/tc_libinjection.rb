@@ -136,6 +136,24 @@ class TestLibInjection < CLIPPTest::TestCase
     assert_log_match /CLIPP ANNOUNCE: 1UE,14/
   end
 
+  def test_cached_verdict_per_set
+    clipp(
+      :input_hashes => [make_request('-1 UNION ALL SELECT')],
+      :config => CONFIG,
+      :default_site_config => <<-EOS
+        Rule REQUEST_HEADERS:Host @is_sqli 'default' capture id:1 phase:REQUEST_HEADER clipp_announce:A%{CAPTURE:fingerprint},%{CAPTURE:confidence}
+        Rule REQUEST_HEADERS:Host @is_sqli 'b' capture id:2 phase:REQUEST_HEADER clipp_announce:B%{CAPTURE:fingerprint},%{CAPTURE:confidence}
+        Rule REQUEST_HEADERS:Host @is_sqli 'a' id:3 phase:REQUEST_HEADER clipp_announce:C
+        Rule REQUEST_HEADERS:Host @is_sqli 'b' capture id:4 phase:REQUEST_HEADER clipp_announce:D%{CAPTURE:fingerprint},%{CAPTURE:confidence}
+      EOS
+    )
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: A1UE,0/
+    assert_log_match /CLIPP ANNOUNCE: B1UE,14/
+    assert_log_no_match /CLIPP ANNOUNCE: C/
+    assert_log_match /CLIPP ANNOUNCE: D1UE,14/
+  end
+
   def test_normalize
     clipp(
       :input_hashes => [make_request('IS IS IS IS IS')],
@@ -357,6 +357,26 @@ class TestLuaModule < CLIPPTest::TestCase
     assert_log_match /LuaStackUseLimit was not given an integer but "3.3"/
   end
 
+  def test_lua_gc_step
+    clipp(
+      modules: %w{ lua },
+      config: "LuaGcStep 64",
+    ) do
+    end
+
+    assert_no_issues
+  end
+
+  def test_lua_gc_step_negative_fail
+    clipp(
+      modules: %w{ lua },
+      config: "LuaGcStep -64",
+    ) do
+    end
+
+    assert_log_match /LuaGcStep parameter must be a non-negative integer: -64/
+  end
+
   def test_lua_stack_minmax
     clipp(
       modules: %w{ lua },
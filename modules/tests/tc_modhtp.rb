@@ -73,4 +73,35 @@ class TestModHTP < CLIPPTest::TestCase
     assert_log_match 'REQ - HOST_MISSING=1'
     assert_log_match 'RESP - HOST_MISSING=1'
   end
-end
\ No newline at end of file
+
+  def test_modhtp_skips_allowed_request_body
+    clipp(
+      modules: %w[ htp ],
+      default_site_config: '''
+        Rule REQUEST_URI_PATH @streq "/static" id:1 rev:1 phase:REQUEST_HEADER allow
+        Rule ARGS:a @clipp_print "a" id:2 rev:1 phase:LOGGING
+      '''
+    ) do
+      %w[ /static /dynamic ].each do |path|
+        transaction do |t|
+          t.request(
+            method: 'POST',
+            uri: path,
+            protocol: 'HTTP/1.1',
+            headers: {
+              'Host' => 'www.myhost.com',
+              'Content-Type' => 'application/x-www-form-urlencoded',
+              'Content-Length' => 5
+            },
+            body: "a=#{path[1]}#{path[1]}#{path[1]}"
+          )
+          t.response(raw: "HTTP/1.1 200 OK")
+        end
+      end
+    end
+
+    assert_no_issues
+    assert_log_match /clipp_print \[a\]: ddd/
+    assert_log_no_match /clipp_print \[a\]: sss/
+  end
+end
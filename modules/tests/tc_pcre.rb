@@ -1,3 +1,5 @@
+require 'fileutils'
+
 class TestPcre < CLIPPTest::TestCase
   include CLIPPTest
 
@@ -210,4 +212,32 @@ class TestPcre < CLIPPTest::TestCase
     assert_no_issues
     assert_log_match /CLIPP ANNOUNCE/
   end
+
+  def test_pcre_compiled_cache
+    cache = File.join(BUILDDIR, "clipp_test_pcre_compiled_cache_#{$$}")
+    FileUtils.rm_rf(cache)
+
+    2.times do
+      clipp(
+        modules: ['pcre'],
+        modhtp: true,
+        config: """
+          PcreCompiledCache #{cache}
+        """,
+        default_site_config: <<-EOS
+          Rule ARGS @rx "a[b]c" id:1 phase:REQUEST clipp_announce:YES
+        EOS
+      ) do
+        transaction do |t|
+          t.request(raw:"GET /foo?1=foobar&2=---abc--- HTTP/1.0")
+        end
+      end
+
+      assert_no_issues
+      assert_log_match /CLIPP ANNOUNCE/
+      assert_equal(1, Dir.glob(File.join(cache, '*.pcre')).size)
+    end
+  ensure
+    FileUtils.rm_rf(cache)
+  end
 end
@@ -51,4 +51,120 @@ class TestPersistence < CLIPPTest::TestCase
 
     assert_no_issues
   end
+
+  def test_persist_log
+    log = File.join(Dir.tmpdir, "ironbee_persist_#{Process.pid}.log")
+    FileUtils.rm_f(log)
+
+    2.times do
+      clipp(
+        modules: %w[ persistence_framework persist ],
+        config: """
+          PersistenceStore persist persist-log://#{log}
+        """,
+        default_site_config: <<-EOS
+          PersistenceMap IP persist key=%{REMOTE_ADDR} expire=300
+
+          Action id:1 rev:1 phase:REQUEST_HEADER "setvar:IP:count+=1"
+          Rule IP:count @clipp_print "count" id:2 rev:1 phase:REQUEST_HEADER
+        EOS
+      ) do
+        transaction do |t|
+          t.request(raw: "GET /foobar/a\n")
+        end
+      end
+    end
+
+    assert_no_issues
+    assert_log_match /clipp_print \[count\]: 2/
+  ensure
+    FileUtils.rm_f(log)
+  end
+
+  def test_persist_log_cached
+    log = File.join(Dir.tmpdir, "ironbee_persist_cached_#{Process.pid}.log")
+    FileUtils.rm_f(log)
+
+    clipp(
+      modules: %w[ persistence_framework persist ],
+      config: """
+        PersistenceStore persist persist-log://#{log} cache=16 cache_age=60
+      """,
+      default_site_config: <<-EOS
+        PersistenceMap IP persist key=%{REMOTE_ADDR} expire=300
+
+        Action id:1 rev:1 phase:REQUEST_HEADER "setvar:IP:count+=1"
+        Rule IP:count @clipp_print "count" id:2 rev:1 phase:REQUEST_HEADER
+      EOS
+    ) do
+      3.times do
+        transaction do |t|
+          t.request(raw: "GET /foobar/a\n")
+        end
+      end
+    end
+
+    assert_no_issues
+    assert_log_match /clipp_print \[count\]: 3/
+  ensure
+    FileUtils.rm_f(log)
+  end
+
+  def test_persist_write_behind
+    log = File.join(Dir.tmpdir, "ironbee_persist_wb_#{Process.pid}.log")
+    FileUtils.rm_f(log)
+
+    clipp(
+      modules: %w[ persistence_framework persist ],
+      config: """
+        PersistenceStore persist persist-log://#{log} write_behind=64
+      """,
+      default_site_config: <<-EOS
+        PersistenceMap IP persist key=%{REMOTE_ADDR} expire=300
+
+        Action id:1 rev:1 phase:REQUEST_HEADER "setvar:IP:count+=1"
+        Rule IP:count @clipp_print "count" id:2 rev:1 phase:REQUEST_HEADER
+      EOS
+    ) do
+      3.times do
+        transaction do |t|
+          t.request(raw: "GET /foobar/a\n")
+        end
+      end
+    end
+
+    assert_no_issues
+    assert_log_match /clipp_print \[count\]: 3/
+  ensure
+    FileUtils.rm_f(log)
+  end
+
+  def test_persist_shm
+    shm = File.join(Dir.tmpdir, "ironbee_persist_#{Process.pid}.shm")
+    FileUtils.rm_f(shm)
+
+    2.times do
+      clipp(
+        modules: %w[ persistence_framework persist ],
+        config: """
+          PersistenceStore persist persist-shm://#{shm} slots=64 slot_size=512
+        """,
+        default_site_config: <<-EOS
+          PersistenceMap IP persist key=%{REMOTE_ADDR} expire=300
+
+          Action id:1 rev:1 phase:REQUEST_HEADER "setvar:IP:count+=1"
+          Rule IP:count @clipp_print "count" id:2 rev:1 phase:REQUEST_HEADER
+        EOS
+      ) do
+        transaction do |t|
+          t.request(raw: "GET /foobar/a\n")
+        end
+      end
+    end
+
+    assert_no_issues
+    assert_log_match /clipp_print \[count\]: 2/
+  ensure
+    FileUtils.rm_f(shm)
+  end
 end
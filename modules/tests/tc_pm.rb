@@ -0,0 +1,41 @@
+class TestPm < CLIPPTest::TestCase
+  include CLIPPTest
+
+  def pm_clipp(config = {})
+    config[:modules] ||= []
+    config[:modules] << 'pm'
+    config[:modules] << 'htp'
+    clipp(config) do
+      transaction do |t|
+        t.request(raw: "GET /index.php?id=1+union+select+password")
+      end
+    end
+  end
+
+  def test_load
+    pm_clipp
+    assert_no_issues
+  end
+
+  def test_pm
+    pm_clipp(
+      default_site_config: <<-EOS
+        Rule REQUEST_URI @pm \"sleep( union benchmark(\" phase:REQUEST_HEADER id:1 capture clipp_announce:YES=%{CAPTURE:0}
+        Rule REQUEST_URI @pm \"sleep( benchmark( waitfor\" phase:REQUEST_HEADER id:2 clipp_announce:NO
+      EOS
+    )
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: YES=union/
+    assert_log_no_match /CLIPP ANNOUNCE: NO/
+  end
+
+  def test_pm_overlapping
+    pm_clipp(
+      default_site_config: <<-EOS
+        Rule REQUEST_METHOD @pm \"ET GE\" phase:REQUEST_HEADER id:1 capture clipp_announce:YES=%{CAPTURE:0}
+      EOS
+    )
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: YES=GE/
+  end
+end
@@ -0,0 +1,94 @@
+class TestPSHTTP < CLIPPTest::TestCase
+  include CLIPPTest
+
+  def test_load
+    clipp(
+      modules: %w[ ps_http ],
+    ) do
+      transaction do |t|
+        t.request(raw: "GET / HTTP/1.1", headers: { Host: 'www.myhost.com' })
+        t.response(raw: "HTTP/1.1 200 OK")
+      end
+    end
+
+    assert_no_issues
+  end
+
+  def test_uri_fields
+    clipp(
+      modules: %w[ ps_http ],
+      default_site_config: <<-EOS
+        Rule request_uri_path @streq "/a b/c" id:1 phase:REQUEST_HEADER clipp_announce:path
+        Rule request_uri_path_raw @streq "/a%20b/c" id:2 phase:REQUEST_HEADER clipp_announce:path_raw
+        Rule request_uri_query @streq "x=1&y=a+b" id:3 phase:REQUEST_HEADER clipp_announce:query
+        Rule request_uri_fragment @streq "frag" id:4 phase:REQUEST_HEADER clipp_announce:fragment
+        Rule request_uri_host @streq "a.b.c" id:5 phase:REQUEST_HEADER clipp_announce:uri_host
+        Rule request_uri_port @streq "8080" id:6 phase:REQUEST_HEADER clipp_announce:uri_port
+        Rule ARGS:y @streq "a b" id:7 phase:REQUEST_HEADER clipp_announce:arg
+      EOS
+    ) do
+      transaction do |t|
+        t.request(
+          raw: "GET http://a.b.c:8080/a%20b/c?x=1&y=a+b#frag HTTP/1.1",
+          headers: { Host: 'a.b.c:8080' }
+        )
+      end
+    end
+
+    assert_no_issues
+    assert_log_match 'CLIPP ANNOUNCE: path'
+    assert_log_match 'CLIPP ANNOUNCE: path_raw'
+    assert_log_match 'CLIPP ANNOUNCE: query'
+    assert_log_match 'CLIPP ANNOUNCE: fragment'
+    assert_log_match 'CLIPP ANNOUNCE: uri_host'
+    assert_log_match 'CLIPP ANNOUNCE: uri_port'
+    assert_log_match 'CLIPP ANNOUNCE: arg'
+  end
+
+  def test_host_and_cookies
+    clipp(
+      modules: %w[ ps_http ],
+      default_site_config: <<-EOS
+        Rule request_host @streq "www.myhost.com" id:1 phase:REQUEST_HEADER clipp_announce:host
+        Rule request_cookies:b @streq "2" id:2 phase:REQUEST_HEADER clipp_announce:cookie
+      EOS
+    ) do
+      transaction do |t|
+        t.request(
+          raw: "GET / HTTP/1.1",
+          headers: { Host: 'www.myhost.com:80', Cookie: 'a=1; b=2' }
+        )
+      end
+    end
+
+    assert_no_issues
+    assert_log_match 'CLIPP ANNOUNCE: host'
+    assert_log_match 'CLIPP ANNOUNCE: cookie'
+  end
+
+  def test_body_params
+    clipp(
+      modules: %w[ ps_http ],
+      default_site_config: <<-EOS
+        Rule request_body_params:b @streq "x y" id:1 phase:REQUEST clipp_announce:body_param
+      EOS
+    ) do
+      transaction do |t|
+        t.request(
+          method: 'POST',
+          uri: '/',
+          protocol: 'HTTP/1.1',
+          headers: {
+            'Host' => 'www.myhost.com',
+            'Content-Type' => 'application/x-www-form-urlencoded',
+            'Content-Length' => 11
+          },
+          body: "a=1&b=x%20y"
+        )
+      end
+    end
+
+    assert_no_issues
+    assert_log_match 'CLIPP ANNOUNCE: body_param'
+  end
+end
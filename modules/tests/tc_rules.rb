@@ -238,4 +238,43 @@ class TestRules < CLIPPTest::TestCase
     assert_log_no_match /clipp_print \[A1\]: 1/
     assert_log_no_match /clipp_print \[A2\]: 2/
   end
-end
\ No newline at end of file
+
+  def test_rule_enable_locations
+    clipp(
+      config: '''
+        InitVar A1 1
+        InitVar A2 2
+        Rule A1 @clipp_print "A1" id:r1 rev:1 tag:rules/a/1 phase:REQUEST
+        Rule A2 @clipp_print "A2" id:r2 rev:1 tag:rules/a/2 phase:REQUEST
+      ''',
+      default_site_config: <<-EOS
+        RuleEnable "tag:rules/a/1"
+        <Location /x>
+          RuleDisable "tag:rules/a/1"
+          RuleEnable "id:r2"
+        </Location>
+        <Location /y>
+          RuleEnable all
+          RuleDisable "id:r2"
+        </Location>
+      EOS
+    ) do
+      transaction do |t|
+        t.request(raw: "GET / HTTP/1.1\nHost: foo.bar\n\n")
+        t.response(raw: "HTTP/1.1 200 OK")
+      end
+      transaction do |t|
+        t.request(raw: "GET /x HTTP/1.1\nHost: foo.bar\n\n")
+        t.response(raw: "HTTP/1.1 200 OK")
+      end
+      transaction do |t|
+        t.request(raw: "GET /y HTTP/1.1\nHost: foo.bar\n\n")
+        t.response(raw: "HTTP/1.1 200 OK")
+      end
+    end
+
+    assert_no_issues
+    assert_equal(2, @log.scan(/clipp_print \[A1\]: 1/).size)
+    assert_equal(1, @log.scan(/clipp_print \[A2\]: 2/).size)
+  end
+end
@@ -11,6 +11,7 @@ class TestSql < CLIPPTest::TestCase
     [ "replace_pg_comments(-)", "a/* /* HI! */b"     , "a/* /* HI! */b" ],
     [ "replace_pg_comments(-)", "a/* HI! */ */b"     , "a/* HI! */ */b" ],
     [ "replace_pg_comments(-)", "a/* /* HI! */ */b"  , "a-b"            ],
+    [ "replace_pg_comments()" , "a - b / c * d"      , "a - b / c * d"  ],
   ].each_with_index do |test_case, i|
     transform, input, expected = test_case
 
@@ -40,6 +41,7 @@ class TestSql < CLIPPTest::TestCase
     [ "replace_mysql_comments()" , "a# hi\nb"            , "a\nb"              ],
     [ "replace_mysql_comments()" , "a /* /* */ b"         , "a  b"              ],
     [ "replace_mysql_comments()" , "a /*! c */ b"         , "a /*! c */ b"      ],
+    [ "replace_mysql_comments()" , "a - b / c * d"        , "a - b / c * d"     ],
   ].each_with_index do |test_case, i|
     transform, input, expected = test_case
 
@@ -58,4 +58,15 @@ class TestStringEncoders < CLIPPTest::TestCase
     assert_no_issues
     assert_log_match /DECODED\]: HelloWorld/
   end
+
+  def test_b16_decode_prefix_unprefixed
+    stringencoders_clipp(
+      '/0x48x0x65-0x6c0x6c0x6f0',
+      default_site_config: <<-EOS
+        Rule REQUEST_URI.b16_decode(0x) @clipp_print "DECODED" id:1 phase:REQUEST_HEADER
+      EOS
+    )
+    assert_no_issues
+    assert_log_match /DECODED\]: Hello/
+  end
 end
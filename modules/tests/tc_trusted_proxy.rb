@@ -225,4 +225,55 @@ class TestTrustedProxy < CLIPPTest::TestCase
     assert_no_issues
     assert_log_match /val of remote_addr.*4\.4\.4\.4/
   end
+
+  def test_many_networks
+    clipp(modhtp: true,
+          config: CONFIG,
+          default_site_config: make_site_config(
+            "10.0.0.0/8 172.16.0.0/12 192.168.0.0/16 5.5.0.0/16 -5.5.6.0/24 6.6.6.6"
+          )
+         ) do
+      connection(remote_ip:"5.5.5.5") do |c|
+        c.transaction() do |t|
+          t.request(
+                    method: 'GET',
+                    uri: '/hello/world',
+                    protocol: 'HTTP/1.0',
+                    headers: {
+                      'Host' => 'Foo.Com',
+                      'x-forwarded-for' => '1.1.1.1 , 2.2.2.2, 3.3.3.3 ,  4.4.4.4  '
+                    }
+                    )
+        end
+      end
+    end
+    assert_no_issues
+    assert_log_match /val of remote_addr.*4\.4\.4\.4/
+  end
+
+  def test_many_transactions
+    clipp(modhtp: true,
+          config: CONFIG,
+          default_site_config: make_site_config("+5.5.5.5")
+         ) do
+      connection(remote_ip:"5.5.5.5") do |c|
+        ['4.4.4.4', '4.4.4.4', '6.6.6.6'].each do |xff|
+          c.transaction() do |t|
+            t.request(
+                      method: 'GET',
+                      uri: '/hello/world',
+                      protocol: 'HTTP/1.1',
+                      headers: {
+                        'Host' => 'Foo.Com',
+                        'X-Forwarded-For' => "1.1.1.1, #{xff}"
+                      }
+                      )
+          end
+        end
+      end
+    end
+    assert_no_issues
+    assert_log_match /val of remote_addr.*4\.4\.4\.4/
+    assert_log_match /val of remote_addr.*6\.6\.6\.6/
+  end
 end
@@ -0,0 +1,40 @@
+class TestTxDump < CLIPPTest::TestCase
+  include CLIPPTest
+
+  def dump(config)
+    clipp(
+      modules: %w/ txdump /,
+      config: config,
+      default_site_config: ''
+    ) do
+      transaction do |t|
+        t.request(raw: 'GET /txdump HTTP/1.1', headers: {'Host'=>'www.myhost.com'})
+        t.response(raw: 'HTTP/1.1 200 OK')
+      end
+    end
+  end
+
+  def test_async
+    dump('''
+      TxDumpAsync On
+      TxDump TxFinished stderr +ReqLine
+    ''')
+    assert_no_issues
+    assert_log_match 'GET /txdump HTTP/1.1'
+  end
+
+  def test_sample_all
+    dump('''
+      TxDump TxFinished stderr +ReqLine Sample=1
+    ''')
+    assert_no_issues
+    assert_log_match 'GET /txdump HTTP/1.1'
+  end
+
+  def test_sample_invalid
+    dump('''
+      TxDump TxFinished stderr +ReqLine Sample=0
+    ''')
+    assert_log_match 'Invalid sample rate'
+  end
+end
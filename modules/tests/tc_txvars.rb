@@ -27,4 +27,35 @@ class TxVars < CLIPPTest::TestCase
         assert_log_match "site_id"
         assert_log_match "engine_id"
     end
+
+    def test_txvars_shared
+        clipp(
+            modules: %w/ txvars /,
+            config: '''
+                TxVars On
+            ''',
+            default_site_config: <<-EOS
+                Rule location_path @clipp_print "location_path" id:1 rev:1 phase:REQUEST_HEADER
+                Rule conn_id @clipp_print "conn_id" id:2 rev:1 phase:REQUEST_HEADER
+                <Location /x>
+                </Location>
+            EOS
+        ) do
+            transaction do |t|
+                t.request(raw: 'GET / HTTP/1.1', headers: {'Host'=>'www.myhost.com'})
+                t.response(raw: 'HTTP/1.1 200 OK')
+            end
+            transaction do |t|
+                t.request(raw: 'GET /x HTTP/1.1', headers: {'Host'=>'www.myhost.com'})
+                t.response(raw: 'HTTP/1.1 200 OK')
+            end
+        end
+
+        assert_no_issues
+        assert_log_match 'clipp_print [location_path]: /'
+        assert_log_match 'clipp_print [location_path]: /x'
+        conn_ids = @log.scan(/clipp_print \[conn_id\]: (\S+)/).flatten
+        assert_equal(2, conn_ids.size)
+        assert_equal(1, conn_ids.uniq.size)
+    end
 end
@@ -0,0 +1,58 @@
+class TestUserAgent < CLIPPTest::TestCase
+  include CLIPPTest
+
+  AGENT = 'curl/7.30.0 (x86_64-pc-linux-gnu) libcurl/7.30.0'
+
+  def make_request(t)
+    t.request(
+      method: 'GET',
+      uri: '/',
+      protocol: 'HTTP/1.1',
+      headers: {
+        'Host' => 'foo.com',
+        'User-Agent' => AGENT
+      }
+    )
+  end
+
+  def test_category_cached
+    clipp(
+      modules: %w{ user_agent },
+      default_site_config: <<-EOS
+        Rule UA:category @clipp_print "category" id:1 rev:1 phase:REQUEST_HEADER
+      EOS
+    ) do
+      transaction { |t| make_request(t) }
+      transaction { |t| make_request(t) }
+    end
+
+    assert_no_issues
+    assert_log_every_input_match /clipp_print \[category\]: library\/curl/
+  end
+
+  def test_cache_disabled
+    clipp(
+      modules: %w{ user_agent },
+      config: "UserAgentCacheSize 0",
+      default_site_config: <<-EOS
+        Rule UA:category @clipp_print "category" id:1 rev:1 phase:REQUEST_HEADER
+      EOS
+    ) do
+      transaction { |t| make_request(t) }
+      transaction { |t| make_request(t) }
+    end
+
+    assert_no_issues
+    assert_log_every_input_match /clipp_print \[category\]: library\/curl/
+  end
+
+  def test_cache_size_negative_fail
+    clipp(
+      modules: %w{ user_agent },
+      config: "UserAgentCacheSize -1",
+    ) do
+    end
+
+    assert_log_match /UserAgentCacheSize parameter must be a non-negative integer: -1/
+  end
+end
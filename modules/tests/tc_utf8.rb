@@ -130,6 +130,48 @@ class TestUTF8 < CLIPPTest::TestCase
     assert_log_match "clipp_print [A]: b"
   end
 
+  def test_utf8_validateUtf8_split_by_space_notok
+    clipp(
+      modules: %w/ utf8 smart_stringencoders /,
+      config: '''
+        InitVar "A" "\xc3 \xa9"
+      ''',
+      default_site_config: '''
+        Rule A.smart_hex_decode() @validateUtf8 ""  "setvar:A=b" id:1 rev:1 phase:REQUEST
+        Rule A                    @clipp_print  "A" id:2 rev:1 phase:REQUEST
+      ''',
+    ) do
+      transaction do |t|
+        t.request(raw: 'GET / HTTP/1.1', headers: { Host: 'a.b.c' })
+        t.response(raw: 'HTTP/1.1 200 OK')
+      end
+    end
+
+    assert_no_issues
+    assert_log_match 'clipp_print [A]: \xc3 \xa9'
+  end
+
+  def test_utf8_normalizeUtf8_ascii_and_overlong_dot
+    clipp(
+      modules: %w/ utf8 smart_stringencoders /,
+      config: '''
+        InitVar "A" "abcdefghij%c0%aeklmnopqrstuvwxyz"
+      ''',
+      default_site_config: '''
+        Rule A.smart_url_hex_decode().normalizeUtf8() @streq "abcdefghij.klmnopqrstuvwxyz"  id:1 rev:1 phase:REQUEST "setvar:A=b"
+        Rule A @clipp_print  "A" id:2 rev:1 phase:REQUEST
+      ''',
+    ) do
+      transaction do |t|
+        t.request(raw: 'GET / HTTP/1.1', headers: { Host: 'a.b.c' })
+        t.response(raw: 'HTTP/1.1 200 OK')
+      end
+    end
+
+    assert_no_issues
+    assert_log_match "clipp_print [A]: b"
+  end
+
   def test_utf8_normalizeUtf8_very_overlong_a
     clipp(
       modules: %w/ utf8 smart_stringencoders /,
@@ -126,6 +126,29 @@ class TestWriteClipp < CLIPPTest::TestCase
     assert(b_txt =~ %r{/a/b})
   end
 
+  def test_write_clipp_tx_many
+    prefix = generate_id
+    b = File.join(BUILDDIR, prefix + "_b.pb")
+    clipp(
+      modules: ['htp', 'write_clipp'],
+      default_site_config: "Action phase:REQUEST_HEADER id:1 write_clipp_tx:#{b}"
+    ) do
+      50.times do |i|
+        transaction do |t|
+          t.request(raw: "GET /many/#{i} HTTP/1.1")
+          t.response(raw: "HTTP/1.1 200 OK")
+        end
+      end
+    end
+    assert_no_issues
+
+    clipp(input:"pb:#{b}", consumer:"view")
+    assert_no_issues
+    50.times do |i|
+      assert_log_match %r{/many/#{i} }
+    end
+  end
+
   def test_write_clipp_tx_expansion
     prefix = generate_id
 
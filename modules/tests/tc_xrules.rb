@@ -325,6 +325,31 @@ class TestXRules < CLIPPTest::TestCase
     assert_log_match 'IsBlocked'
   end
 
+  def test_xrule_path_prefixes
+    clipp(
+      modhtp: true,
+      modules: %w{ xrules txdump },
+      config: '''
+        ProtectionEngineOptions +blockingMode
+        TxDump TxFinished stdout all
+      ''',
+      default_site_config: <<-EOS
+        XRulePath /public Allow priority=2
+        XRulePath /pub block priority=1
+        XRulePath /pub/ok Allow priority=1
+        XRuleMethod post Allow priority=2
+        XRuleHostname FOO.BAR Allow priority=2
+      EOS
+    ) do
+      transaction do |t|
+        t.request(raw: "GET /pub/ok HTTP/1.1", headers: { Host: 'www.foo.baz' })
+      end
+    end
+
+    assert_log_match 'Blocking Mode = On'
+    assert_log_match 'IsBlocked'
+  end
+
   def test_xrule_threat_level
     clipp(
       modhtp: true,
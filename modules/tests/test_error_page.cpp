@@ -88,6 +88,7 @@ namespace {
 
 int         mock_error_status;
 std::string mock_error_body;
+std::string mock_error_tx_id;
 
 extern "C" {
 /**
@@ -112,6 +113,7 @@ ib_status_t mock_error_body_fn(
 )
 {
     mock_error_body = std::string(reinterpret_cast<const char *>(data), len);
+    mock_error_tx_id = tx->id;
 
     return IB_OK;
 }
@@ -190,3 +192,51 @@ TEST_F(ErrorPage, basic_file) {
         buf.str(),
         mock_error_body);
 }
+
+/* Test that the transaction id placeholders are replaced. */
+TEST_F(ErrorPage, tx_id_file) {
+    std::string config =
+        std::string(
+            "LogLevel DEBUG\n"
+            "LoadModule \"ibmod_error_page.so\"\n"
+            "LoadModule \"ibmod_rules.so\"\n"
+            "LoadModule \"ibmod_block.so\"\n"
+            "SensorId B9C1B52B-C24A-4309-B9F9-0EF4CD577A3E\n"
+            "SensorName UnitTesting\n"
+            "SensorHostname unit-testing.sensor.tld\n"
+            "ErrorPageMap 500 error_page_tx_id.html\n"
+            "BlockMethod status\n"
+            "BlockStatus 500\n"
+            "<Site test-site>\n"
+            "   SiteId AAAABBBB-1111-2222-3333-000000000000\n"
+            "   Service *:*\n"
+            "   Hostname *\n"
+            "   Action id:action01 rev:1 phase:request setflag:blockingMode block:phase\n"
+            "</Site>\n"
+        );
+
+    configureIronBeeByString(config.c_str());
+
+    const_cast<ib_server_t *>(ib_engine->server)->err_fn = mock_error_fn;
+    const_cast<ib_server_t *>(ib_engine->server)->err_body_fn =
+        mock_error_body_fn;
+
+    mock_error_body = "";
+    mock_error_tx_id = "";
+    mock_error_status = 0;
+
+    performTx();
+
+    ASSERT_EQ(500, mock_error_status);
+    ASSERT_FALSE(mock_error_tx_id.empty());
+
+    std::string expected =
+        "<!doctype html>\n"
+        "<html>\n"
+        "    <body>\n"
+        "        <p>Blocked: " + mock_error_tx_id + "</p>\n"
+        "        <p>Reference " + mock_error_tx_id + ".</p>\n"
+        "    </body>\n"
+        "</html>\n";
+    ASSERT_EQ(expected, mock_error_body);
+}
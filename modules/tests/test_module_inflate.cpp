@@ -25,6 +25,10 @@
 #include "gtest/gtest.h"
 
 #include <zlib.h>
+
+#include <string>
+#include <vector>
+
 #ifdef __clang__
 #pragma clang diagnostic push
 #if __has_warning("-Wunused-local-typedef")
@@ -183,3 +187,42 @@ TEST_F(TestStream, Simple)
                                   reinterpret_cast<const char*>(uncompressed_data),
                                   uncompressed_data_len));
 }
+
+TEST_F(TestStream, HeldData)
+{
+    Connection c = Connection::create(m_engine);
+    Transaction tx = Transaction::create(c);
+    ib_stream_pump_t *pump;
+    std::string uncompressed(20000, 'a');
+    std::vector<uint8_t> compressed(compressBound(uncompressed.size()));
+    uLongf compressed_len = compressed.size();
+
+    ASSERT_EQ(Z_OK,
+              compress(&compressed[0], &compressed_len,
+                       reinterpret_cast<const Bytef *>(uncompressed.data()),
+                       uncompressed.size())
+             );
+
+    ASSERT_EQ(IB_OK,
+              ib_stream_pump_create(&pump, m_reg, tx.ib())
+             );
+    ASSERT_EQ(IB_OK,
+              ib_stream_pump_processor_add(pump, "inflate")
+             );
+    ASSERT_EQ(IB_OK,
+              ib_stream_pump_processor_add(pump, "collector")
+             );
+
+    /* Inflate produces several segments, the collector takes only one
+     * per call. The rest is held for the following calls. */
+    ASSERT_EQ(IB_OK,
+              ib_stream_pump_process(pump, &compressed[0], compressed_len)
+             );
+    ASSERT_GT(uncompressed.size(), m_collector.size());
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(IB_OK,
+                  ib_stream_pump_flush(pump)
+                 );
+    }
+    ASSERT_EQ(uncompressed, m_collector);
+}
@@ -372,3 +372,116 @@ TEST_F(PcreModuleTest, test_match_capture_named)
     ib_field = getTarget1(capname);
     ASSERT_FALSE(ib_field);
 }
+
+TEST_F(PcreModuleTest, test_literal_prefilter)
+{
+    // Patterns and whether they match field1 ("string 1") and field2
+    // ("string 2").  Several have required literals that must only be
+    // used when the literal is really required.
+    static const struct {
+        const char *pattern;
+        bool        match1;
+        bool        match2;
+    } cases[] = {
+        { "string 2",         false, true  },
+        { "string [12]",      true,  true  },
+        { "string 2x?",       false, true  },
+        { "strx*ing",         true,  true  },
+        { "str(?:ing|ong) 1", true,  false },
+        { "string 3|ing",     true,  true  },
+        { "(?i)STRING 1",     true,  false },
+        { "st\\.ring",        false, false },
+        { "ing{1,2} 2",       false, true  },
+        { "\\Qring 2\\E",     false, true  }
+    };
+    const ib_operator_t *op;
+    ASSERT_EQ(IB_OK, ib_operator_lookup(ib_engine, IB_S2SL("pcre"), &op));
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(*cases); ++i) {
+        ib_operator_inst_t *opinst;
+        ib_num_t result;
+
+        ASSERT_EQ(
+            IB_OK,
+            ib_operator_inst_create(
+                &opinst,
+                ib_engine_mm_main_get(ib_engine),
+                ib_context_main(ib_engine),
+                op,
+                IB_OP_CAPABILITY_NONE,
+                cases[i].pattern
+            )
+        ) << cases[i].pattern;
+
+        ASSERT_EQ(
+            IB_OK,
+            ib_operator_inst_execute(
+                opinst, rule_exec1.tx, field1, NULL, &result
+            )
+        ) << cases[i].pattern;
+        EXPECT_EQ(cases[i].match1, result != 0) << cases[i].pattern;
+
+        ASSERT_EQ(
+            IB_OK,
+            ib_operator_inst_execute(
+                opinst, rule_exec1.tx, field2, NULL, &result
+            )
+        ) << cases[i].pattern;
+        EXPECT_EQ(cases[i].match2, result != 0) << cases[i].pattern;
+    }
+
+    // Escapes whose arguments are not literal text, each with a subject it
+    // matches.
+    static const struct {
+        const char *pattern;
+        const char *subject;
+    } escapes[] = {
+        { "ab\\x41BC",           "abABC"        },
+        { "\\x27\\x22or",        "'\"or"        },
+        { "str\\x{69}ng",        "string"       },
+        { "foo\\p{Lu}bar",       "fooXbar"      },
+        { "ab\\cAxy",            "ab\001xy"     },
+        { "xy\\012345",          "xy\n345"      },
+        { "(a)\\1bc",            "aabc"         },
+        { "(a)\\g1bc",           "aabc"         },
+        { "(?<n>a)\\k<n>bc",     "aabc"         },
+        { "[\\c]]xyz",           "\035xyz"      },
+        { "(\\c)ab)cd",          "iabcd"        }
+    };
+
+    for (size_t i = 0; i < sizeof(escapes) / sizeof(*escapes); ++i) {
+        ib_operator_inst_t *opinst;
+        ib_field_t *subject;
+        ib_num_t result;
+
+        ASSERT_EQ(
+            IB_OK,
+            ib_field_create(
+                &subject,
+                ib_engine_mm_main_get(ib_engine),
+                IB_S2SL("subject"),
+                IB_FTYPE_NULSTR,
+                ib_ftype_nulstr_in(escapes[i].subject)
+            )
+        );
+        ASSERT_EQ(
+            IB_OK,
+            ib_operator_inst_create(
+                &opinst,
+                ib_engine_mm_main_get(ib_engine),
+                ib_context_main(ib_engine),
+                op,
+                IB_OP_CAPABILITY_NONE,
+                escapes[i].pattern
+            )
+        ) << escapes[i].pattern;
+
+        ASSERT_EQ(
+            IB_OK,
+            ib_operator_inst_execute(
+                opinst, rule_exec1.tx, subject, NULL, &result
+            )
+        ) << escapes[i].pattern;
+        EXPECT_EQ(1, result) << escapes[i].pattern;
+    }
+}
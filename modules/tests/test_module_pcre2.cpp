@@ -0,0 +1,138 @@
+//////////////////////////////////////////////////////////////////////////////
+// Licensed to Qualys, Inc. (QUALYS) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.
+// QUALYS licenses this file to You under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+/// @file
+/// @brief IronBee --- PCRE2 module tests
+//////////////////////////////////////////////////////////////////////////////
+
+#include "gtest/gtest.h"
+
+#include "base_fixture.h"
+#include <ironbee/operator.h>
+#include <ironbee/mm.h>
+#include <ironbee/field.h>
+#include <ironbee/capture.h>
+#include <ironbee/bytestr.h>
+
+#include <string>
+
+class Pcre2ModuleTest : public BaseTransactionFixture
+{
+public:
+    ib_field_t *field1;
+    ib_field_t *field2;
+
+    virtual void SetUp()
+    {
+        ib_status_t rc;
+        ib_mm_t mm;
+
+        BaseTransactionFixture::SetUp();
+        configureIronBee();
+        performTx();
+
+        mm = ib_engine_mm_main_get(ib_engine);
+
+        rc = ib_field_create(&field1,
+                             mm,
+                             IB_S2SL("field1"),
+                             IB_FTYPE_NULSTR,
+                             ib_ftype_nulstr_in(ib_mm_strdup(mm, "string 1")));
+        if (rc != IB_OK) {
+            throw std::runtime_error("Could not initialize field1.");
+        }
+
+        rc = ib_field_create(&field2,
+                             mm,
+                             IB_S2SL("field2"),
+                             IB_FTYPE_NULSTR,
+                             ib_ftype_nulstr_in(ib_mm_strdup(mm, "string 2")));
+        if (rc != IB_OK) {
+            throw std::runtime_error("Could not initialize field2.");
+        }
+    }
+
+    ib_operator_inst_t *createOperator(const char *name, const char *pattern)
+    {
+        const ib_operator_t *op;
+        ib_operator_inst_t *opinst;
+
+        if (
+            ib_operator_lookup(ib_engine, name, strlen(name), &op) != IB_OK ||
+            ib_operator_inst_create(
+                &opinst,
+                ib_engine_mm_main_get(ib_engine),
+                ib_context_main(ib_engine),
+                op,
+                IB_OP_CAPABILITY_NONE,
+                pattern
+            ) != IB_OK
+        ) {
+            throw std::runtime_error("Could not create operator.");
+        }
+
+        return opinst;
+    }
+};
+
+TEST_F(Pcre2ModuleTest, test_rx_operator)
+{
+    ib_num_t result;
+    ib_operator_inst_t *opinst = createOperator("rx", "string\\s2");
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_operator_inst_execute(opinst, ib_tx, field1, NULL, &result)
+    );
+    ASSERT_FALSE(result);
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_operator_inst_execute(opinst, ib_tx, field2, NULL, &result)
+    );
+    ASSERT_TRUE(result);
+}
+
+TEST_F(Pcre2ModuleTest, test_capture)
+{
+    ib_num_t result;
+    ib_field_t *capture;
+    const ib_field_t *item;
+    const ib_bytestr_t *bs;
+    ib_operator_inst_t *opinst = createOperator("pcre", "(str)ing (\\d)");
+
+    ASSERT_EQ(IB_OK, ib_capture_acquire(ib_tx, NULL, &capture));
+    ASSERT_EQ(
+        IB_OK,
+        ib_operator_inst_execute(opinst, ib_tx, field2, capture, &result)
+    );
+    ASSERT_TRUE(result);
+
+    const char *expected[] = { "string 2", "str", "2" };
+    for (size_t i = 0; i < sizeof(expected) / sizeof(*expected); ++i) {
+        std::string name = std::string(IB_TX_CAPTURE":") +
+                           ib_capture_name(i);
+        item = getTarget1(name.c_str());
+        ASSERT_TRUE(item) << name;
+        ASSERT_EQ(IB_OK, ib_field_value(item, ib_ftype_bytestr_out(&bs)));
+        EXPECT_EQ(expected[i], std::string(
+            reinterpret_cast<const char *>(ib_bytestr_const_ptr(bs)),
+            ib_bytestr_length(bs)
+        ));
+    }
+}
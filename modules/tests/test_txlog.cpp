@@ -214,3 +214,60 @@ TEST_F(TxLogTest, BlockResponse) {
     ASSERT_TRUE(ib_tx);
     std::cout << "Log string is: " << test_log.str();
 }
+
+TEST_F(TxLogTest, BinaryFormat) {
+
+    ib_logger_format_t *format;
+
+    std::string config =
+        std::string(
+            "LogLevel INFO\n"
+            "LoadModule \"ibmod_htp.so\"\n"
+            "LoadModule \"ibmod_rules.so\"\n"
+            "LoadModule \"ibmod_txlog.so\"\n"
+            "AuditLogBaseDir .\n"
+            "SensorId B9C1B52B-C24A-4309-B9F9-0EF4CD577A3E\n"
+            "SensorName UnitTesting\n"
+            "SensorHostname unit-testing.sensor.tld\n"
+            "<Site test-site>\n"
+            "   SiteId AAAABBBB-1111-2222-3333-000000000000\n"
+            "   Hostname UnitTest\n"
+            "</Site>\n"
+        );
+
+    configureIronBeeByString(config.c_str());
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_logger_fetch_format(
+            ib_engine_logger_get(ib_engine),
+            TXLOG_BINARY_FORMAT_FN_NAME,
+            &format)
+    );
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_logger_writer_add(
+            ib_engine_logger_get(ib_engine),
+            NULL,                  NULL,   /* Open. */
+            NULL,                  NULL,   /* Close. */
+            NULL,                  NULL,   /* Reopen. */
+            format,                        /* Format. */
+            test_record_handler,   NULL    /* Record. */
+        )
+    );
+
+    test_log.str("");
+    performTx();
+    ASSERT_TRUE(ib_tx);
+
+    /* A CBOR map, with a tagged timestamp, followed by the newline. */
+    std::string record = test_log.str();
+    ASSERT_LT(2U, record.length());
+    EXPECT_EQ('\xbf', record[0]);
+    EXPECT_EQ('\xff', record[record.length() - 2]);
+    EXPECT_NE(
+        std::string::npos,
+        record.find("\x69" "timestamp" "\xc0\x78\x1d"));
+    EXPECT_NE(std::string::npos, record.find("\x63" "GET"));
+}
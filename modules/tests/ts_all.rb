@@ -7,9 +7,11 @@ require 'tc_libinjection'
 require 'tc_fast'
 require 'tc_parser_suite'
 require 'tc_modps'
+require 'tc_ps_http'
 require 'tc_rules'
 require 'tc_xrules'
 require 'tc_init_collection'
+require 'tc_json_body'
 require 'tc_trusted_proxy'
 require 'tc_txlog'
 require 'tc_ee'
@@ -18,6 +20,8 @@ require 'tc_abort'
 require 'tc_constant'
 require 'tc_write_clipp'
 require 'tc_stringset'
+require 'tc_user_agent'
+require 'tc_pm'
 require 'tc_header_order'
 require 'tc_sql_comments'
 require 'tc_sqltfn'
@@ -25,6 +29,7 @@ require 'tc_block'
 require 'tc_modhtp'
 require 'tc_smart_stringencoders'
 require 'tc_utf8'
+require 'tc_txdump'
 require 'tc_txvars'
 require 'tc_response'
 
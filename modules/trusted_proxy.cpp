@@ -31,16 +31,18 @@
 #pragma clang diagnostic ignored "-Wunused-local-typedef"
 #endif
 #endif
-#include <boost/algorithm/string/predicate.hpp>
-#include <boost/algorithm/string/split.hpp>
-#include <boost/algorithm/string/trim.hpp>
 #include <boost/bind.hpp>
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
+#include <boost/shared_ptr.hpp>
 
+#include <string>
 #include <vector>
 
+#include <ctype.h>
+#include <strings.h>
+
 using namespace std;
 
 namespace {
@@ -80,8 +82,17 @@ public:
      */
     bool is_trusted(const char* ipstr) const;
 
-    //! Finalize the configuration when the context is closed.
-    void context_close(IronBee::Engine& ib);
+    /**
+     * Finalize the configuration when the context is closed.
+     *
+     * Builds the IP set of the trusted and untrusted networks and its trie
+     * index, so that checking an address takes a bounded number of steps
+     * however many networks are configured.
+     *
+     * @param[in] mm Memory manager of the context to allocate the index
+     *               from.
+     */
+    void context_close(IronBee::MemoryManager mm);
 
 private:
     //! X-Forwarding-For handling enabled?
@@ -97,6 +108,33 @@ private:
     ib_ipset4_t m_trusted_networks;
 };
 
+/**
+ * Per-connection results of the module.
+ *
+ * The remote address of a connection does not change, so whether it is a
+ * trusted proxy is decided once per connection and configuration rather
+ * than for every transaction.  Clients behind a proxy usually repeat the
+ * same X-Forwarded-For address on a connection, so the last validated
+ * address is remembered too.
+ */
+struct TrustedProxyConnData
+{
+    //! Constructor.
+    TrustedProxyConnData() : config(NULL), trusted(false) {}
+
+    //! Configuration @ref trusted was decided with.
+    const TrustedProxyConfig* config;
+
+    //! Is the remote address of the connection trusted by @ref config?
+    bool trusted;
+
+    //! Last X-Forwarded-For address found to be valid.
+    string last_forwarded;
+};
+
+//! Pointer to @ref TrustedProxyConnData; stored in connection module data.
+typedef boost::shared_ptr<TrustedProxyConnData> trusted_proxy_conn_data_p;
+
 /**
  * Module to handle X-Forwarded-For headers from trusted Proxies.
  */
@@ -130,6 +168,14 @@ private:
 
     void on_context_close(IronBee::Engine ib, IronBee::Context ctx);
 
+    /**
+     * Fetch the data of the connection of @a tx, creating it if needed.
+     *
+     * @param[in] tx Transaction.
+     * @returns Connection data.
+     */
+    trusted_proxy_conn_data_p conn_data(IronBee::Transaction tx) const;
+
     /**
      * Update the transaction effective IP based.
      *
@@ -200,7 +246,7 @@ void TrustedProxyConfig::add_untrusted_network(const char* cidr_or_ip)
     m_untrusted_net_list.push_back(net_entry);
 }
 
-void TrustedProxyConfig::context_close(IronBee::Engine& ib)
+void TrustedProxyConfig::context_close(IronBee::MemoryManager mm)
 {
     IronBee::throw_if_error(
         ib_ipset4_init(
@@ -210,6 +256,9 @@ void TrustedProxyConfig::context_close(IronBee::Engine& ib)
             m_trusted_net_list.data(),
             m_trusted_net_list.size()),
         "Failed to initialize IPv4 set.");
+    IronBee::throw_if_error(
+        ib_ipset4_index(&m_trusted_networks, mm.ib()),
+        "Failed to index IPv4 set.");
 }
 
 bool TrustedProxyConfig::is_trusted(const char* ipstr) const
@@ -298,7 +347,25 @@ void TrustedProxyModule::on_context_close(
     TrustedProxyConfig& config =
         module().configuration_data<TrustedProxyConfig>(ctx);
 
-    config.context_close(ib);
+    config.context_close(ctx.memory_manager());
+}
+
+trusted_proxy_conn_data_p TrustedProxyModule::conn_data(
+    IronBee::Transaction tx
+) const
+{
+    IronBee::Connection conn = tx.connection();
+    trusted_proxy_conn_data_p data;
+
+    try {
+        data = conn.get_module_data<trusted_proxy_conn_data_p>(module());
+    }
+    catch (const IronBee::enoent&) {
+        data.reset(new TrustedProxyConnData());
+        conn.set_module_data(module(), data);
+    }
+
+    return data;
 }
 
 void TrustedProxyModule::set_effective_ip(
@@ -306,55 +373,84 @@ void TrustedProxyModule::set_effective_ip(
     IronBee::Transaction tx
 )
 {
-    using namespace boost::algorithm;
-
     ib_status_t rc;
     IronBee::Context ctx = tx.context();
     TrustedProxyConfig& config =
         module().configuration_data<TrustedProxyConfig>(ctx);
+    trusted_proxy_conn_data_p data = conn_data(tx);
 
-    ib_log_debug_tx(tx.ib(), "checking: %s",
-                    tx.connection().remote_ip_string());
-    // check actual remote ip against trusted ips
-    if (! config.is_trusted(tx.connection().remote_ip_string())) {
+    // check actual remote ip against trusted ips, once per connection
+    // and configuration.
+    if (data->config != &config) {
+        ib_log_debug_tx(tx.ib(), "checking: %s",
+                        tx.connection().remote_ip_string());
+        data->trusted = config.is_trusted(tx.connection().remote_ip_string());
+        data->config = &config;
+        data->last_forwarded.clear();
+    }
+    if (! data->trusted) {
         ib_log_debug_tx(tx.ib(), "Remote address '%s' not a trusted proxy.",
                         tx.connection().remote_ip_string());
         return;
     }
 
     // Last remote address is trusted, get the last X-Forwarded-For value.
-    string forwarded;
+    // The header is examined in place rather than copied and split.
+    static const char   xff[]  = "X-Forwarded-For";
+    static const size_t xff_len = sizeof(xff) - 1;
+    const char* forwarded = NULL;
+    size_t forwarded_len = 0;
     for (
         IronBee::ParsedHeader header = tx.request_header();
         header;
         header = header.next()
     )
     {
-        if (iequals("X-Forwarded-For", header.name().to_s())) {
-            forwarded = header.value().to_s();
+        IronBee::ByteString name = header.name();
+        if (
+            name.length() == xff_len &&
+            strncasecmp(name.const_data(), xff, xff_len) == 0
+        ) {
+            forwarded = header.value().const_data();
+            forwarded_len = header.value().length();
         }
     }
 
-    if (forwarded.length() == 0) {
+    if (forwarded_len == 0) {
         return;
     }
 
-    list<string> forwarded_list;
-
-    split(forwarded_list, forwarded, is_any_of(","));
-
-    string remote_ip = trim_copy(forwarded_list.back());
+    // The last address is after the last comma; trim spaces around it.
+    const char* ip_end = forwarded + forwarded_len;
+    const char* ip_start = ip_end;
+    while (ip_start > forwarded && *(ip_start - 1) != ',') {
+        --ip_start;
+    }
+    while (ip_start < ip_end && isspace(static_cast<unsigned char>(*ip_start))) {
+        ++ip_start;
+    }
+    while (ip_end > ip_start && isspace(static_cast<unsigned char>(*(ip_end - 1)))) {
+        --ip_end;
+    }
 
-    /* Verify that it looks like a valid IP address, ignore it if not */
-    rc = ib_ip_validate(remote_ip.c_str());
-    if (rc != IB_OK) {
-        ib_log_error_tx(tx.ib(),
-                        "X-Forwarded-For \"%s\" is not a valid IP address",
-                        remote_ip.c_str());
-        return;
+    char* buf = static_cast<char*>(
+        tx.memory_manager().alloc(ip_end - ip_start + 1));
+    memcpy(buf, ip_start, ip_end - ip_start);
+    buf[ip_end - ip_start] = '\0';
+
+    /* Verify that it looks like a valid IP address, ignore it if not.
+     * An address already validated on this connection is not checked
+     * again. */
+    if (data->last_forwarded != buf) {
+        rc = ib_ip_validate(buf);
+        if (rc != IB_OK) {
+            ib_log_error_tx(tx.ib(),
+                            "X-Forwarded-For \"%s\" is not a valid IP address",
+                            buf);
+            return;
+        }
+        data->last_forwarded = buf;
     }
-    char* buf = static_cast<char*>(tx.memory_manager().alloc(remote_ip.length()+1));
-    strcpy(buf, remote_ip.c_str());
 
     /* This will lose the pointer to the original address
      * buffer, but it should be cleaned up with the rest
@@ -68,6 +68,21 @@
  * - <tt>TxDump PostProcess file:///tmp/tx.txt All</tt>
  * - <tt>TxDump Logging file:///var/log/ib/all.txt+ All</tt>
  * - <tt>TxDump PostProcess StdOut All</tt>
+ * - <tt>TxDump PostProcess file:///tmp/tx.txt+ All Sample=100</tt>
+ *
+ * A <tt>Sample=@<n@></tt> parameter, for both the directive and the
+ * action, dumps only one transaction in @<n@>.  Which ones is decided by
+ * the transaction id, so every TxDump with the same sample rate picks the
+ * same transactions.
+ *
+ * @par The TxDumpAsync directive
+ *
+ * <tt>usage: TxDumpAsync On|Off</tt>
+ *
+ * Dumps to files, stdout and stderr are always built in memory and written
+ * at once, so that dumps of concurrent transactions do not interleave.
+ * With TxDumpAsync on, they are written by a dedicated thread instead of
+ * the transaction's, which flushes once per batch.
  *
  * @par The txDump action
  *
@@ -100,6 +115,9 @@
  * @author Nick LeRoy <nleroy@qualys.com>
  */
 
+#include "ironbee_config_auto.h"
+
+#include <ironbee/batch_writer.h>
 #include <ironbee/bytestr.h>
 #include <ironbee/cfgmap.h>
 #include <ironbee/context.h>
@@ -107,6 +125,7 @@
 #include <ironbee/escape.h>
 #include <ironbee/field.h>
 #include <ironbee/flags.h>
+#include <ironbee/hash.h>
 #include <ironbee/list.h>
 #include <ironbee/mm.h>
 #include <ironbee/module.h>
@@ -149,6 +168,7 @@ static const size_t MAX_FIELD_NAME = 48;    /**< Max field name for printing */
 static const size_t MAX_FIELD_SIZE = 256;   /**< Max field value for printing */
 static const size_t MAX_BS_LEN = 1024;      /**< Max escaped byte string */
 static const size_t MIN_BS_LEN = 5;         /**< Min escaped byte string */
+static const size_t MAX_PENDING = 1024;     /**< Max dumps queued for writer */
 
 /**
  * TxDump bytestring format result flags
@@ -253,17 +273,43 @@ struct txdump_t {
     const char            *dest;      /**< Copy of the destination string */
     txdump_config_t       *config;    /**< TxDump configuration data */
     const ib_module_t     *module;    /**< Pointer to module object */
+    uint32_t               sample;    /**< Dump 1 in this many TXs; 0: all */
 };
 typedef struct txdump_t txdump_t;
 
+/**
+ * A dump queued for the asynchronous writer.
+ *
+ * The dump is allocated by open_memstream().
+ */
+typedef struct txdump_record_t txdump_record_t;
+struct txdump_record_t {
+    FILE            *fp;              /**< File to write to */
+    char            *data;            /**< Buffered dump */
+    size_t           data_len;        /**< Length of data */
+};
+
 /**
  * TxDump module instance data
  */
 struct txdump_moddata_t {
-    ib_list_t *fp_list;               /**< List of all file pointers */
+    ib_list_t       *fp_list;         /**< List of all file pointers */
+    ib_batch_writer_t *writer;        /**< TxDumpAsync writer or NULL */
 };
 typedef struct txdump_moddata_t txdump_moddata_t;
 
+/**
+ * Output of one dump
+ *
+ * See txdump_open() and txdump_close().
+ */
+struct txdump_out_t {
+    txdump_t               buffered;  /**< Copy writing to the buffer */
+    char                  *buf;       /**< Buffer or NULL */
+    size_t                 buf_len;   /**< Length of buf */
+};
+typedef struct txdump_out_t txdump_out_t;
+
 /**
  * TxDump configuration
  */
@@ -384,6 +430,184 @@ static ib_status_t txdump_flush(
     return IB_OK;
 }
 
+/**
+ * Write a batch of dumps and free them.
+ *
+ * Each file is flushed once, when the batch moves on to another file and
+ * at the end of the batch.
+ *
+ * @param[in] items Records of the batch.
+ * @param[in] n_items Number of @a items.
+ * @param[in] cbdata Unused.
+ */
+static void txdump_write_batch(
+    void   **items,
+    size_t   n_items,
+    void    *cbdata
+)
+{
+    FILE *unflushed = NULL;
+
+    for (size_t i = 0; i < n_items; ++i) {
+        txdump_record_t *record = (txdump_record_t *)items[i];
+
+        if (unflushed != NULL && unflushed != record->fp) {
+            fflush(unflushed);
+        }
+        fwrite(record->data, 1, record->data_len, record->fp);
+        unflushed = record->fp;
+
+        free(record->data);
+        free(record);
+    }
+
+    if (unflushed != NULL) {
+        fflush(unflushed);
+    }
+}
+
+/**
+ * Create an asynchronous writer.
+ *
+ * @param[out] writer The writer.
+ * @param[in] mm Memory manager; the writer is stopped when it is destroyed.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_ENOTIMPL If dumps cannot be buffered on this platform.
+ * - Other errors of ib_batch_writer_create().
+ */
+static ib_status_t txdump_writer_create(
+    ib_batch_writer_t **writer,
+    ib_mm_t             mm
+)
+{
+    assert(writer != NULL);
+
+#ifndef HAVE_OPEN_MEMSTREAM
+    /* Dumps are buffered with open_memstream(). */
+    return IB_ENOTIMPL;
+#endif
+
+    return ib_batch_writer_create(writer, mm, MAX_PENDING,
+                                  txdump_write_batch, NULL);
+}
+
+/**
+ * Start a dump.
+ *
+ * A dump to a file is buffered in memory, where the platform allows, and
+ * written by txdump_close().  Otherwise, the dump is written as it is
+ * made.
+ *
+ * @param[in] txdump TxDump data
+ * @param[out] out Output of the dump
+ *
+ * @returns The TxDump data to dump with
+ */
+static const txdump_t *txdump_open(
+    const txdump_t *txdump,
+    txdump_out_t   *out
+)
+{
+    assert(txdump != NULL);
+    assert(out != NULL);
+
+    out->buf = NULL;
+    out->buf_len = 0;
+    if (txdump->fp == NULL) {
+        return txdump;
+    }
+
+#ifdef HAVE_OPEN_MEMSTREAM
+    out->buffered = *txdump;
+    out->buffered.fp = open_memstream(&(out->buf), &(out->buf_len));
+    if (out->buffered.fp != NULL) {
+        return &(out->buffered);
+    }
+#endif
+
+    return txdump;
+}
+
+/**
+ * Finish a dump started with txdump_open().
+ *
+ * Hands a buffered dump to the asynchronous writer, if there is one, or
+ * writes it.
+ *
+ * @param[in] tx IronBee Transaction
+ * @param[in] txdump TxDump data passed to txdump_open()
+ * @param[in] dumped TxDump data returned by txdump_open()
+ * @param[in] out Output of the dump
+ */
+static void txdump_close(
+    const ib_tx_t  *tx,
+    const txdump_t *txdump,
+    const txdump_t *dumped,
+    txdump_out_t   *out
+)
+{
+    assert(tx != NULL);
+    assert(txdump != NULL);
+    assert(dumped != NULL);
+    assert(out != NULL);
+
+    const txdump_moddata_t *moddata;
+    txdump_record_t        *record;
+
+    if (dumped == txdump) {
+        txdump_flush(tx, txdump);
+        return;
+    }
+
+    /* Closing the stream sets the buffer and its length. */
+    fclose(out->buffered.fp);
+    if (out->buf == NULL) {
+        return;
+    }
+
+    moddata = (const txdump_moddata_t *)txdump->module->data;
+    if (moddata->writer != NULL) {
+        record = malloc(sizeof(*record));
+        if (record != NULL) {
+            record->fp = txdump->fp;
+            record->data = out->buf;
+            record->data_len = out->buf_len;
+            ib_batch_writer_submit(moddata->writer, record);
+            return;
+        }
+    }
+
+    fwrite(out->buf, 1, out->buf_len, txdump->fp);
+    fflush(txdump->fp);
+    free(out->buf);
+}
+
+/**
+ * Check if @a tx is in the sample of @a txdump.
+ *
+ * @param[in] tx IronBee Transaction
+ * @param[in] txdump TxDump data
+ *
+ * @returns True if @a tx should be dumped
+ */
+static bool txdump_sampled(
+    const ib_tx_t  *tx,
+    const txdump_t *txdump
+)
+{
+    assert(tx != NULL);
+    assert(txdump != NULL);
+
+    if (txdump->sample <= 1) {
+        return true;
+    }
+    return
+        ib_hashfunc_djb2(tx->id, strlen(tx->id), 0, NULL) %
+        txdump->sample == 0;
+}
+
 /**
  * Get string of bytestring flags
  *
@@ -1312,17 +1536,20 @@ ib_status_t txdump_tx_state(
     assert(cbdata != NULL);
 
     const txdump_t *txdump = (const txdump_t *)cbdata;
+    const txdump_t *dumped;
+    txdump_out_t    out;
     ib_status_t     rc;
 
     assert(txdump->state == state);
-    if (!txdump_check_tx(tx, txdump)) {
+    if (!txdump_check_tx(tx, txdump) || !txdump_sampled(tx, txdump)) {
         return IB_OK;
     }
 
-    txdump_v(tx, txdump, 0, "[TX %s @ %s]", tx->id, txdump->name);
+    dumped = txdump_open(txdump, &out);
+    txdump_v(tx, dumped, 0, "[TX %s @ %s]", tx->id, dumped->name);
 
-    rc = txdump_tx(ib, tx, txdump);
-    txdump_flush(tx, txdump);
+    rc = txdump_tx(ib, tx, dumped);
+    txdump_close(tx, txdump, dumped, &out);
     return rc;
 }
 
@@ -1351,15 +1578,18 @@ ib_status_t txdump_reqline_state(
     assert(cbdata != NULL);
 
     const txdump_t *txdump = (const txdump_t *)cbdata;
+    const txdump_t *dumped;
+    txdump_out_t    out;
 
     assert(txdump->state == state);
-    if (!txdump_check_tx(tx, txdump)) {
+    if (!txdump_check_tx(tx, txdump) || !txdump_sampled(tx, txdump)) {
         return IB_OK;
     }
 
-    txdump_v(tx, txdump, 0, "[TX %s @ %s]", tx->id, txdump->name);
-    txdump_reqline(tx, txdump, 2, line);
-    txdump_flush(tx, txdump);
+    dumped = txdump_open(txdump, &out);
+    txdump_v(tx, dumped, 0, "[TX %s @ %s]", tx->id, dumped->name);
+    txdump_reqline(tx, dumped, 2, line);
+    txdump_close(tx, txdump, dumped, &out);
     return IB_OK;
 }
 
@@ -1388,15 +1618,18 @@ ib_status_t txdump_resline_state(
     assert(cbdata != NULL);
 
     const txdump_t *txdump = (const txdump_t *)cbdata;
+    const txdump_t *dumped;
+    txdump_out_t    out;
 
     assert(txdump->state == state);
-    if (!txdump_check_tx(tx, txdump)) {
+    if (!txdump_check_tx(tx, txdump) || !txdump_sampled(tx, txdump)) {
         return IB_OK;
     }
 
-    txdump_v(tx, txdump, 0, "[TX %s @ %s]", tx->id, txdump->name);
-    txdump_resline(tx, txdump, 2, line);
-    txdump_flush(tx, txdump);
+    dumped = txdump_open(txdump, &out);
+    txdump_v(tx, dumped, 0, "[TX %s @ %s]", tx->id, dumped->name);
+    txdump_resline(tx, dumped, 2, line);
+    txdump_close(tx, txdump, dumped, &out);
     return IB_OK;
 }
 
@@ -1425,14 +1658,21 @@ static ib_status_t txdump_act_execute(
     assert(data != NULL);
 
     const txdump_t *txdump = (const txdump_t *)data;
+    const txdump_t *dumped;
+    txdump_out_t    out;
     ib_status_t     rc;
     const ib_tx_t  *tx = rule_exec->tx;
 
-    txdump_v(tx, txdump, 0, "[TX %s @ Rule %s]",
+    if (!txdump_sampled(tx, txdump)) {
+        return IB_OK;
+    }
+
+    dumped = txdump_open(txdump, &out);
+    txdump_v(tx, dumped, 0, "[TX %s @ Rule %s]",
              tx->id, ib_rule_id(rule_exec->rule));
 
-    rc = txdump_tx(rule_exec->ib, tx, txdump);
-    txdump_flush(tx, txdump);
+    rc = txdump_tx(rule_exec->ib, tx, dumped);
+    txdump_close(tx, txdump, dumped, &out);
     return rc;
 }
 
@@ -1654,6 +1894,44 @@ static ib_status_t txdump_parse_dest(
     return IB_OK;
 }
 
+/**
+ * Parse a Sample parameter.
+ *
+ * @param[in] param Parameter string
+ * @param[in,out] txdump TxDump object to set the sample rate in
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_DECLINED If @a param is not a Sample parameter.
+ * - IB_EINVAL If the sample rate is not a positive number.
+ */
+static ib_status_t txdump_parse_sample(
+    const char *param,
+    txdump_t   *txdump
+)
+{
+    assert(param != NULL);
+    assert(txdump != NULL);
+
+    unsigned long  sample;
+    char          *end;
+
+    if (strncasecmp(param, "sample=", 7) != 0) {
+        return IB_DECLINED;
+    }
+
+    errno = 0;
+    sample = strtoul(param + 7, &end, 10);
+    if ( (errno != 0) || (end == param + 7) || (*end != '\0') ||
+         (sample == 0) || (sample > UINT32_MAX) )
+    {
+        return IB_EINVAL;
+    }
+    txdump->sample = (uint32_t)sample;
+
+    return IB_OK;
+}
+
 static IB_STRVAL_MAP(flags_map) = {
     IB_STRVAL_PAIR("default", TXDUMP_DEFAULT),
     IB_STRVAL_PAIR("basic", TXDUMP_BASIC),
@@ -1767,6 +2045,15 @@ static ib_status_t txdump_handler(
     while( (node = ib_list_node_next_const(node)) != NULL) {
         param = (const char *)ib_list_node_data_const(node);
         assert(param != NULL);
+        rc = txdump_parse_sample(param, &txdump);
+        if (rc == IB_OK) {
+            continue;
+        }
+        else if (rc != IB_DECLINED) {
+            ib_cfg_log_error(cp, "Invalid sample rate \"%s\" for %s.",
+                             param, label);
+            return rc;
+        }
         rc = ib_flags_string(flags_map, param, flagno++, &flags, &mask);
         if (rc != IB_OK) {
             ib_cfg_log_error(cp, "Error parsing enable for %s: %s",
@@ -1828,6 +2115,61 @@ static ib_status_t txdump_handler(
     return IB_OK;
 }
 
+/**
+ * Handle the TxDumpAsync directive
+ *
+ * @param[in] cp Config parser
+ * @param[in] name Directive name
+ * @param[in] onoff On or off
+ * @param[in] cbdata Callback data (module)
+ *
+ * @returns
+ * - IB_OK On success.
+ * - Other if the writer could not be started.
+ */
+static ib_status_t txdump_async_handler(
+    ib_cfgparser_t *cp,
+    const char     *name,
+    int             onoff,
+    void           *cbdata
+)
+{
+    assert(cp != NULL);
+    assert(cp->ib != NULL);
+    assert(name != NULL);
+    assert(cbdata != NULL);
+
+    const ib_module_t *module = cbdata;
+    txdump_moddata_t  *moddata = (txdump_moddata_t *)module->data;
+    ib_status_t        rc;
+
+    /* The writer is engine wide and kept in the module data. */
+    if (onoff && moddata->writer == NULL) {
+        rc = txdump_writer_create(&(moddata->writer),
+                                  ib_engine_mm_main_get(cp->ib));
+        if (rc == IB_ENOTIMPL) {
+            ib_cfg_log_warning(cp,
+                               "Asynchronous TxDump writing is not supported "
+                               "on this platform; ignoring %s.",
+                               name);
+            return IB_OK;
+        }
+        if (rc != IB_OK) {
+            ib_cfg_log_error(cp, "Failed to start TxDump writer: %s",
+                             ib_status_to_string(rc));
+        }
+        return rc;
+    }
+    else if (! onoff && moddata->writer != NULL) {
+        ib_batch_writer_t *writer = moddata->writer;
+
+        moddata->writer = NULL;
+        ib_batch_writer_stop(writer);
+    }
+
+    return IB_OK;
+}
+
 /**
  * Create function for the txDump action.
  *
@@ -1873,6 +2215,7 @@ static ib_status_t txdump_act_create(
     /* Initialize the txdump object */
     memset(&txdump, 0, sizeof(txdump));
     txdump.name = "Action";
+    txdump.module = module;
 
     /* Make a copy of the parameters that we can use for strtok() */
     pcopy = ib_mm_strdup(ib_engine_mm_temp_get(ib), parameters);
@@ -1894,6 +2237,15 @@ static ib_status_t txdump_act_create(
 
     /* Parse the remainder of the parameters a enables / disables */
     while ((param = strtok(NULL, ",")) != NULL) {
+        rc = txdump_parse_sample(param, &txdump);
+        if (rc == IB_OK) {
+            continue;
+        }
+        else if (rc != IB_DECLINED) {
+            ib_log_error(ib, "Invalid sample rate \"%s\" for %s.",
+                         param, label);
+            return rc;
+        }
         rc = ib_flags_string(flags_map, param, flagno++, &flags, &mask);
         if (rc != IB_OK) {
             ib_log_error(ib, "Error parsing enable for %s.", label);
@@ -2011,6 +2363,21 @@ static ib_status_t txdump_init(
         return rc;
     }
 
+    /* Register the TxDumpAsync directive */
+    rc = ib_config_register_directive(ib,
+                                      "TxDumpAsync",
+                                      IB_DIRTYPE_ONOFF,
+                                      (ib_void_fn_t)txdump_async_handler,
+                                      NULL,
+                                      module,
+                                      NULL,
+                                      NULL);
+    if (rc != IB_OK) {
+        ib_log_error(ib, "Failed to register TxDumpAsync directive: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
     /* Register the TxDump action */
     rc = ib_action_create_and_register(
         NULL, ib,
@@ -2024,7 +2391,7 @@ static ib_status_t txdump_init(
     }
 
     /* Allocate the module instance data */
-    moddata = ib_mm_alloc(mm, sizeof(*moddata));
+    moddata = ib_mm_calloc(mm, 1, sizeof(*moddata));
     if (moddata == NULL) {
         ib_log_error(ib, "Failed to allocate TxDump module instance data");
         return IB_EALLOC;
@@ -2067,6 +2434,11 @@ static ib_status_t txdump_finish(
 
     assert(moddata->fp_list != NULL);
 
+    /* Write the queued dumps before the files are closed. */
+    if (moddata->writer != NULL) {
+        ib_batch_writer_stop(moddata->writer);
+    }
+
     /* Loop through the list & log everything */
     IB_LIST_LOOP(moddata->fp_list, node) {
         FILE *fp = (FILE *)node->data;
@@ -64,6 +64,7 @@
 #include <boost/function.hpp>
 #include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/range/iterator_range.hpp>
 #include <boost/shared_ptr.hpp>
 #ifdef __clang__
 #pragma clang diagnostic pop
@@ -263,6 +264,40 @@ void TxLogData::recordAuditLogData(
     m_auditlogId = tx.audit_log_id();
 }
 
+/**
+ * Range over the bytes of @a bs, to compare them without a copy.
+ *
+ * @param[in] bs The byte string.
+ *
+ * @returns Range of @a bs.
+ */
+boost::iterator_range<const char *> byteRange(IronBee::ConstByteString bs)
+{
+    return boost::make_iterator_range(
+        bs.const_data(),
+        bs.const_data() + bs.length());
+}
+
+/**
+ * Render the name and value of @a headerNvp as a map in @a headers.
+ *
+ * @param[in] headers The array of headers.
+ * @param[in] headerNvp The header.
+ */
+void headerToJson(
+    IronBee::JsonArray<IronBee::Json>& headers,
+    IronBee::ConstParsedHeader         headerNvp
+)
+{
+    IronBee::ConstByteString name  = headerNvp.name();
+    IronBee::ConstByteString value = headerNvp.value();
+
+    headers.withMap()
+            .withString("name", name.const_data(), name.length())
+            .withString("value", value.const_data(), value.length())
+        .close();
+}
+
 void eventsToJson(
     IronBee::ConstTransaction tx,
     IronBee::Json& txLogJson
@@ -324,8 +359,8 @@ void requestHeadersToJson(
             headerNvp = headerNvp.next()
         )
         {
-            std::string headerName = headerNvp.name().to_s();
-            std::string headerValue = headerNvp.value().to_s();
+            boost::iterator_range<const char *> headerName =
+                byteRange(headerNvp.name());
 
             // TODO: These need to be configurable (string set?).
             if (boost::algorithm::istarts_with(headerName, "Content-") ||
@@ -334,10 +369,7 @@ void requestHeadersToJson(
                 boost::algorithm::iequals(headerName, "Referer") ||
                 boost::algorithm::iequals(headerName, "TE"))
             {
-                headers.withMap()
-                        .withString("name", headerNvp.name().to_s())
-                        .withString("value", headerNvp.value().to_s())
-                    .close();
+                headerToJson(headers, headerNvp);
             }
         }
     }
@@ -360,8 +392,8 @@ void responseHeadersToJson(
             headerNvp = headerNvp.next()
         )
         {
-            std::string headerName = headerNvp.name().to_s();
-            std::string headerValue = headerNvp.value().to_s();
+            boost::iterator_range<const char *> headerName =
+                byteRange(headerNvp.name());
 
             // TODO: These need to be configurable (string set?).
             if (boost::algorithm::istarts_with(headerName, "Content-") ||
@@ -369,10 +401,7 @@ void responseHeadersToJson(
                 boost::algorithm::iequals(headerName, "Server") ||
                 boost::algorithm::iequals(headerName, "Allow"))
             {
-                headers.withMap()
-                        .withString("name", headerNvp.name().to_s())
-                        .withString("value", headerNvp.value().to_s())
-                    .close();
+                headerToJson(headers, headerNvp);
             }
         }
     }
@@ -401,7 +430,7 @@ void responseHeadersToJson(
 void varSourceToJson(
     IronBee::ConstTransaction tx,
     IronBee::Json&                txLogJson,
-    const std::string         name,
+    const std::string&        name,
     IronBee::ConstVarSource   source
 )
 {
@@ -429,10 +458,13 @@ void varSourceToJson(
                             "Null strings are an error "
                             "when processing var sources.");
                         break;
-                    case IronBee::ConstField::BYTE_STRING:
+                    case IronBee::ConstField::BYTE_STRING: {
+                        IronBee::ConstByteString bs =
+                            field.value_as_byte_string();
                         txLogJson.withString(name);
-                        txLogJson.withString(field.value_as_byte_string().to_s());
+                        txLogJson.withString(bs.const_data(), bs.length());
                         break;
+                    }
                     default:
                         ib_log_error(
                             tx.engine().ib(),
@@ -533,8 +565,8 @@ void renderMap(
     IronBee::VarConfig     var_config =
         IronBee::VarConfig::remove_const(var_store.config());
 
-    std::pair<std::string, std::string> p;
-    BOOST_FOREACH(p, pairs) {
+    typedef std::map<std::string, std::string>::value_type pair_t;
+    BOOST_FOREACH(const pair_t& p, pairs) {
         if (IronBee::VarExpand::test(p.second)) {
             IronBee::VarExpand exp = IronBee::VarExpand::acquire(
                 mm,
@@ -671,7 +703,7 @@ TxLogLoggerFormatCbdata::TxLogLoggerFormatCbdata(
 extern "C" {
 
 /**
- * An implementation of @ref ib_logger_format_fn_t for this module.
+ * Render the TxLog record of @a rec in @a encoding.
  *
  * It produces a @ref ib_logger_standard_msg_t in @a writer_record.
  *
@@ -680,11 +712,10 @@ extern "C" {
  *
  * @param[in] logger The logger.
  * @param[in] rec The record to produce @a writer_record from.
- * @param[in] log_msg Unused.
- * @param[in] log_msg_sz The length of @a log_msg.
  * @param[out] writer_record A @ref ib_logger_standard_msg_t if this returns
  *             IB_OK. Unset otherwise. This must be a `ib_logger_std_msg_t **`.
  * @param[in] cbdata Callback data which is a TxLogLoggerFormatCbdata pointer.
+ * @param[in] encoding Encoding of the record.
  *
  * @returns
  * - IB_OK On success.
@@ -692,13 +723,12 @@ extern "C" {
  *   @ref IB_LOGGER_TXLOG_TYPE.
  * - Other on error.
  */
-static ib_status_t txlog_logger_format_fn(
-    ib_logger_t           *logger,
-    const ib_logger_rec_t *rec,
-    const uint8_t         *log_msg,
-    const size_t           log_msg_sz,
-    void                  *writer_record,
-    void                  *cbdata
+static ib_status_t txlog_logger_format(
+    ib_logger_t               *logger,
+    const ib_logger_rec_t     *rec,
+    void                      *writer_record,
+    void                      *cbdata,
+    IronBee::Json::encoding_e  encoding
 )
 {
     assert(rec);
@@ -747,7 +777,18 @@ static ib_status_t txlog_logger_format_fn(
     }
 
     try {
-        IronBee::Json()
+        /* Byte strings are rendered in place rather than copied. */
+        IronBee::ConstByteString requestMethod = tx.request_line().method();
+        IronBee::ConstByteString requestUri = tx.request_line().uri();
+        IronBee::ConstByteString requestProtocol =
+            tx.request_line().protocol();
+        IronBee::ConstByteString responseProtocol =
+            tx.response_line().protocol();
+        IronBee::ConstByteString responseStatus = tx.response_line().status();
+        IronBee::ConstByteString responseMessage =
+            tx.response_line().message();
+
+        IronBee::Json(encoding)
             .withMap()
                 .withTime("timestamp", tx.started_time())
                 .withInt("duration",
@@ -782,9 +823,12 @@ static ib_status_t txlog_logger_format_fn(
                             _1
                         )
                     )
-                    .withString("method", tx.request_line().method().to_s())
-                    .withString("uri", tx.request_line().uri().to_s())
-                    .withString("protocol", tx.request_line().protocol().to_s())
+                    .withString("method",
+                        requestMethod.const_data(), requestMethod.length())
+                    .withString("uri",
+                        requestUri.const_data(), requestUri.length())
+                    .withString("protocol",
+                        requestProtocol.const_data(), requestProtocol.length())
                     .withString("host", tx.hostname())
                     .withString("path", tx.path())
                     .withInt("bandwidth", tx.request_length())
@@ -806,9 +850,13 @@ static ib_status_t txlog_logger_format_fn(
                             _1
                         )
                     )
-                    .withString("protocol", tx.response_line().protocol().to_s())
-                    .withString("status", tx.response_line().status().to_s())
-                    .withString("message", tx.response_line().message().to_s())
+                    .withString("protocol",
+                        responseProtocol.const_data(),
+                        responseProtocol.length())
+                    .withString("status",
+                        responseStatus.const_data(), responseStatus.length())
+                    .withString("message",
+                        responseMessage.const_data(), responseMessage.length())
                     .withInt("bandwidth", tx.response_length())
                     .withFunction(boost::bind(responseHeadersToJson, tx, _1))
                     .withFunction(
@@ -879,6 +927,56 @@ static ib_status_t txlog_logger_format_fn(
     return IB_OK;
 }
 
+/**
+ * An implementation of @ref ib_logger_format_fn_t that renders JSON.
+ *
+ * @param[in] logger The logger.
+ * @param[in] rec The record to produce @a writer_record from.
+ * @param[in] log_msg Unused.
+ * @param[in] log_msg_sz The length of @a log_msg.
+ * @param[out] writer_record See txlog_logger_format().
+ * @param[in] cbdata Callback data which is a TxLogLoggerFormatCbdata pointer.
+ *
+ * @returns See txlog_logger_format().
+ */
+static ib_status_t txlog_logger_format_fn(
+    ib_logger_t           *logger,
+    const ib_logger_rec_t *rec,
+    const uint8_t         *log_msg,
+    const size_t           log_msg_sz,
+    void                  *writer_record,
+    void                  *cbdata
+)
+{
+    return txlog_logger_format(
+        logger, rec, writer_record, cbdata, IronBee::Json::JSON);
+}
+
+/**
+ * An implementation of @ref ib_logger_format_fn_t that renders CBOR.
+ *
+ * @param[in] logger The logger.
+ * @param[in] rec The record to produce @a writer_record from.
+ * @param[in] log_msg Unused.
+ * @param[in] log_msg_sz The length of @a log_msg.
+ * @param[out] writer_record See txlog_logger_format().
+ * @param[in] cbdata Callback data which is a TxLogLoggerFormatCbdata pointer.
+ *
+ * @returns See txlog_logger_format().
+ */
+static ib_status_t txlog_logger_binary_format_fn(
+    ib_logger_t           *logger,
+    const ib_logger_rec_t *rec,
+    const uint8_t         *log_msg,
+    const size_t           log_msg_sz,
+    void                  *writer_record,
+    void                  *cbdata
+)
+{
+    return txlog_logger_format(
+        logger, rec, writer_record, cbdata, IronBee::Json::CBOR);
+}
+
 /**
  * Do the work of logging a single ib_logger_standard_msg_t to the log.
  *
@@ -1061,6 +1159,24 @@ TxLogModule::TxLogModule(IronBee::Module module):
             TXLOG_FORMAT_FN_NAME,
             format));
 
+    IronBee::throw_if_error(
+        ib_logger_format_create(
+            ib_engine_logger_get(module.engine().ib()),
+            &format,
+            txlog_logger_binary_format_fn,
+            IronBee::value_to_data(
+                &m_txLogLoggerFormatCbdata,
+                module.engine().main_memory_mm().ib()),
+            ib_logger_standard_msg_free,
+            NULL));
+
+    /* Register the TxLog binary logger format function. */
+    IronBee::throw_if_error(
+        ib_logger_register_format(
+            ib_engine_logger_get(module.engine().ib()),
+            TXLOG_BINARY_FORMAT_FN_NAME,
+            format));
+
     /* Set the default configuration. */
     module.set_configuration_data(TxLogConfig());
 
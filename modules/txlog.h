@@ -36,6 +36,14 @@ extern "C" {
 #define TXLOG_MODULE_NAME "TxLogModule"
 #define TXLOG_FORMAT_FN_NAME "TxLogModuleFormatFn"
 
+/**
+ * Name of the format that renders TxLog records as CBOR (RFC 7049).
+ *
+ * Records hold the same data as those of @ref TXLOG_FORMAT_FN_NAME, which
+ * are JSON, in a compact binary encoding.
+ */
+#define TXLOG_BINARY_FORMAT_FN_NAME "TxLogModuleBinaryFormatFn"
+
 #ifdef __cplusplus
 } /* extern C */
 #endif
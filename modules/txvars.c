@@ -33,6 +33,10 @@
  *  - `site_name`: The context's site name
  *  - `location_path`: The context's location path
  *
+ * The engine and context vars are built once per context, when it is closed,
+ * and the connection vars once per connection.  Transactions share them and
+ * only create their own `tx_id` and `tx_start`.
+ *
  * Sample values published into vars:
  *  - `conn_id = "e68a8286-f012-49ae-b607-5ed98e8ab46f"`
  *  - `conn_start = 2014-01-24T11:22:40.0221-0600`
@@ -184,6 +188,14 @@ typedef struct txvars_module_data_t txvars_module_data_t;
  */
 struct txvars_config_t {
     bool enabled;                      /**< TxVars enabled? */
+    /**
+     * Fields of the vars that are the same for all transactions of the
+     * context, built when the context is closed.
+     *
+     * NULL for per-connection and per-transaction vars, and for vars the
+     * context has no value for.
+     */
+    ib_field_t *fields[TXVAR_COUNT];
 };
 typedef struct txvars_config_t txvars_config_t;
 
@@ -192,14 +204,76 @@ typedef struct txvars_config_t txvars_config_t;
  */
 static txvars_config_t txvars_config = {
     .enabled = false,
+    .fields = { NULL },
+};
+
+/**
+ * TxVars per-connection data
+ */
+struct txvars_conn_t {
+    /** Fields of the per-connection vars; NULL for others. */
+    ib_field_t *fields[TXVAR_COUNT];
 };
+typedef struct txvars_conn_t txvars_conn_t;
+
+/**
+ * Create a field shared by several transactions.
+ *
+ * Shared fields are never modified: setvar only changes numeric vars in
+ * place and replaces any other var in the transaction's var store.
+ *
+ * @param[out] pf Created field.
+ * @param[in] mm Memory manager; must outlive all transactions using it.
+ * @param[in] item TxVars item
+ * @param[in] strval String value for string items; NULL if not available.
+ * @param[in] timeval Time value for time items.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_ENOENT if the item is a string item and @a strval is NULL.
+ * - IB_EALLOC on allocation errors.
+ */
+static ib_status_t create_shared_field(
+    ib_field_t          **pf,
+    ib_mm_t               mm,
+    const txvars_item_t  *item,
+    const char           *strval,
+    ib_time_t             timeval
+)
+{
+    assert(pf != NULL);
+    assert(item != NULL);
+
+    ib_bytestr_t *bs;
+    ib_status_t   rc;
+
+    if (item->init->type == IB_FTYPE_TIME) {
+        return ib_field_create(pf, mm,
+                               IB_S2SL(item->init->name),
+                               IB_FTYPE_TIME,
+                               ib_ftype_time_in(&timeval));
+    }
+
+    if (strval == NULL) {
+        return IB_ENOENT;
+    }
+    rc = ib_bytestr_dup_nulstr(&bs, mm, strval);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    return ib_field_create(pf, mm,
+                           IB_S2SL(item->init->name),
+                           IB_FTYPE_BYTESTR,
+                           ib_ftype_bytestr_in(bs));
+}
 
 /**
  * Store a var string item into TX vars
  *
  * @param[in] tx Transaction
  * @param[in] item TxVars item
- * @param[in] value Value string
+ * @param[in] value Value string; must live as long as @a tx
  *
  */
 static void store_var_str_item(
@@ -220,8 +294,8 @@ static void store_var_str_item(
         return;
     }
 
-    /* Create the byte string */
-    rc = ib_bytestr_dup_nulstr(&bs, tx->mm, value);
+    /* Create the byte string; @a value outlives the transaction. */
+    rc = ib_bytestr_alias_nulstr(&bs, tx->mm, value);
     if (rc != IB_OK) {
         ib_log_error_tx(tx,
                         "Error creating bytestr for \"%s\" [\"%s\"]: %s",
@@ -323,9 +397,8 @@ ib_status_t handle_tx_context(
     const ib_module_t        *module = cbdata;
     txvars_module_data_t     *mod_data = module->data;
     txvars_config_t          *config;
+    txvars_conn_t            *conn_data = NULL;
     ib_status_t               rc;
-    const ib_site_t          *site = NULL;
-    const ib_site_location_t *location = NULL;
     size_t                    n;
 
     /* No module data? */
@@ -344,15 +417,128 @@ ib_status_t handle_tx_context(
         return IB_OK;
     }
 
+    /* Get the per-connection vars, built by the first transaction. */
+    rc = ib_conn_get_module_data(tx->conn, module, &conn_data);
+    if (rc != IB_OK || conn_data == NULL) {
+        conn_data = ib_mm_calloc(tx->conn->mm, 1, sizeof(*conn_data));
+        if (conn_data == NULL) {
+            return IB_EALLOC;
+        }
+        rc = create_shared_field(&conn_data->fields[TXVAR_CONN_ID],
+                                 tx->conn->mm,
+                                 mod_data->items[TXVAR_CONN_ID],
+                                 tx->conn->id, 0);
+        if (rc != IB_OK && rc != IB_ENOENT) {
+            return rc;
+        }
+        rc = create_shared_field(&conn_data->fields[TXVAR_CONN_START],
+                                 tx->conn->mm,
+                                 mod_data->items[TXVAR_CONN_START],
+                                 NULL,
+                                 tx->conn->t.started + mod_data->base_time);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        rc = ib_conn_set_module_data(tx->conn, module, conn_data);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    /* Point the vars sources at the shared fields; only the transaction's
+     * own vars are created here. */
+    for(n = 0; n < TXVAR_NONE; ++n) {
+        txvars_item_t *item  = mod_data->items[n];
+        ib_field_t    *field = NULL;
+
+        switch(item->init->which) {
+        case TXVAR_TX_ID:
+            store_var_str_item(tx, item, tx->id);
+            continue;
+        case TXVAR_TX_START:
+            store_var_time_item(tx, item, tx->t.started, mod_data->base_time);
+            continue;
+        case TXVAR_CONN_ID:
+        case TXVAR_CONN_START:
+            field = conn_data->fields[n];
+            break;
+        default:
+            field = config->fields[n];
+            break;
+        }
+
+        /* No value available. */
+        if (field == NULL) {
+            continue;
+        }
+
+        rc = ib_var_source_set(item->source, tx->var_store, field);
+        if (rc != IB_OK) {
+            ib_log_error_tx(tx, "Failed to add field \"%s\" to TX var store.",
+                            item->init->name);
+        }
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Handle context close events to build the context's shared vars.
+ *
+ * @param[in] ib IronBee object
+ * @param[in] ctx Context
+ * @param[in] state State
+ * @param[in] cbdata Callback data (module)
+ *
+ * @returns Status code
+ */
+static
+ib_status_t handle_context_close(
+    ib_engine_t  *ib,
+    ib_context_t *ctx,
+    ib_state_t    state,
+    void         *cbdata
+)
+{
+    assert(ib != NULL);
+    assert(ctx != NULL);
+    assert(state == context_close_state);
+    assert(cbdata != NULL);
+
+    const ib_module_t        *module = cbdata;
+    txvars_module_data_t     *mod_data = module->data;
+    txvars_config_t          *config;
+    ib_status_t               rc;
+    const ib_site_t          *site = NULL;
+    const ib_site_location_t *location = NULL;
+    size_t                    n;
+
+    assert(mod_data != NULL);
+
+    rc = ib_context_module_config(ctx, module, (void *)&config);
+    if (rc != IB_OK) {
+        ib_log_error(ib, "Failed to get %s module configuration: %s",
+                     module->name, ib_status_to_string(rc));
+        return rc;
+    }
+
+    /* Fields inherited from the parent context do not apply. */
+    for(n = 0; n < TXVAR_COUNT; ++n) {
+        config->fields[n] = NULL;
+    }
+
+    /* Do nothing if not enabled */
+    if (config->enabled == false) {
+        return IB_OK;
+    }
+
     /* Get the context's site and location */
-    ib_context_site_get(tx->ctx, &site);
-    ib_context_location_get(tx->ctx, &location);
+    ib_context_site_get(ctx, &site);
+    ib_context_location_get(ctx, &location);
 
-    /* Create the vars sources */
     for(n = 0; n < TXVAR_NONE; ++n) {
         txvars_item_t *item    = mod_data->items[n];
         const char    *strval  = NULL;
-        ib_time_t      timeval = 0;
 
         switch(item->init->which) {
         case TXVAR_ENGINE_ID:
@@ -361,20 +547,8 @@ ib_status_t handle_tx_context(
         case TXVAR_SENSOR_ID:
             strval = ib_engine_sensor_id(ib);
             break;
-        case TXVAR_CONN_ID:
-            strval = tx->conn->id;
-            break;
-        case TXVAR_CONN_START:
-            timeval = tx->conn->t.started;
-            break;
-        case TXVAR_TX_ID:
-            strval = tx->id;
-            break;
-        case TXVAR_TX_START:
-            timeval = tx->t.started;
-            break;
         case TXVAR_CTX_NAME:
-            strval = ib_context_full_get(tx->ctx);
+            strval = ib_context_full_get(ctx);
             break;
         case TXVAR_SITE_ID:
             if (site != NULL) {
@@ -391,19 +565,24 @@ ib_status_t handle_tx_context(
                 strval = location->path;
             }
             break;
+        case TXVAR_CONN_ID:
+        case TXVAR_CONN_START:
+        case TXVAR_TX_ID:
+        case TXVAR_TX_START:
+            continue;
         default:
             assert(0 && "Invalid TxVar source");
         }
 
-        switch(item->init->type) {
-        case IB_FTYPE_NULSTR:
-            store_var_str_item(tx, item, strval);
-            break;
-        case IB_FTYPE_TIME:
-            store_var_time_item(tx, item, timeval, mod_data->base_time);
-            break;
-        default:
-            assert(0 && "Unsupported TxVar source type");
+        rc = create_shared_field(&config->fields[n],
+                                 ib_context_get_mm(ctx), item, strval, 0);
+        if (rc == IB_ENOENT) {
+            config->fields[n] = NULL;
+        }
+        else if (rc != IB_OK) {
+            ib_log_error(ib, "Error creating field for \"%s\": %s",
+                         item->init->name, ib_status_to_string(rc));
+            return rc;
         }
     }
 
@@ -588,6 +767,15 @@ static ib_status_t txvars_init(
         ib_log_error(ib, "Error registering hook: %s", ib_status_to_string(rc));
     }
 
+    /* Register the context close callback */
+    rc = ib_hook_context_register(ib,
+                                  context_close_state,
+                                  handle_context_close,
+                                  module);
+    if (rc != IB_OK) {
+        ib_log_error(ib, "Error registering hook: %s", ib_status_to_string(rc));
+    }
+
     return IB_OK;
 }
 
@@ -27,25 +27,30 @@
 #include "user_agent_private.h"
 
 #include <ironbee/bytestr.h>
+#include <ironbee/config.h>
 #include <ironbee/context.h>
 #include <ironbee/engine.h>
 #include <ironbee/engine_state.h>
 #include <ironbee/field.h>
 #include <ironbee/hash.h>
 #include <ironbee/ip.h>
+#include <ironbee/lock.h>
 #include <ironbee/mm.h>
 #include <ironbee/module.h>
 #include <ironbee/string.h>
 #include <ironbee/string_trim.h>
+#include <ironbee/type_convert.h>
 #include <ironbee/types.h>
 #include <ironbee/util.h>
 
 #include <assert.h>
 #include <ctype.h>
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include <sys/types.h>
 
@@ -58,13 +63,383 @@ IB_MODULE_DECLARE();
 
 static const modua_match_ruleset_t *modua_match_ruleset = NULL;
 
+/**
+ * Longest user agent string that is cached.
+ *
+ * Longer strings are rare and are parsed every time.
+ */
+#define MODUA_CACHE_MAX_AGENT_LENGTH 511
+
+/** Default number of user agent strings cached. */
+#define MODUA_CACHE_DEFAULT_SIZE 512
+
+/** Marker for no entry in cache indices. */
+#define MODUA_CACHE_NONE ((size_t)-1)
+
+/**
+ * A user agent string and the result of parsing and categorizing it.
+ *
+ * The parsed components are kept as offsets into @ref parsed, which is the
+ * agent string as modified by modua_parse_uastring().
+ */
+typedef struct {
+    char    agent[MODUA_CACHE_MAX_AGENT_LENGTH + 1];  /**< Key. */
+    char    parsed[MODUA_CACHE_MAX_AGENT_LENGTH + 1]; /**< Parsed agent. */
+    size_t  length;           /**< Length of @ref agent. */
+    uint32_t hash;            /**< Hash of @ref agent. */
+    ib_status_t parse_rc;     /**< Result of modua_parse_uastring(). */
+    size_t  product;          /**< Offset of product or MODUA_CACHE_NONE. */
+    size_t  platform;         /**< Offset of platform or MODUA_CACHE_NONE. */
+    size_t  extra;            /**< Offset of extra or MODUA_CACHE_NONE. */
+    const modua_match_rule_t *rule; /**< Matching rule; may be NULL. */
+    size_t  bucket_next;      /**< Next entry in the same bucket. */
+    size_t  lru_prev;         /**< Next more recently used entry. */
+    size_t  lru_next;         /**< Next less recently used entry. */
+} modua_cache_entry_t;
+
+/**
+ * Least recently used cache of parsed user agent strings.
+ *
+ * Shared by all transactions of the engine and protected by @ref lock.
+ * Every entry is allocated when the cache is created and reused on
+ * eviction, so the cache uses no memory on the request path.
+ */
+typedef struct {
+    ib_lock_t           *lock;        /**< Protects everything below. */
+    modua_cache_entry_t *entries;     /**< Entries. */
+    size_t               capacity;    /**< Number of entries. */
+    size_t               used;        /**< Number of entries in use. */
+    size_t              *buckets;     /**< First entry of each bucket. */
+    size_t               bucket_mask; /**< Number of buckets minus one. */
+    uint32_t             randomizer;  /**< Hash randomizer. */
+    size_t               lru_head;    /**< Most recently used entry. */
+    size_t               lru_tail;    /**< Least recently used entry. */
+} modua_cache_t;
+
 typedef struct {
     const ib_var_target_t *user_agent;
     const ib_var_target_t *forwarded_for;
     ib_var_source_t *remote_addr;
+    ib_num_t cache_size;  /**< Size of @ref cache; 0 to disable. */
+    modua_cache_t *cache; /**< Parse cache; NULL if disabled. */
 } modua_config_t;
 
-static modua_config_t c_modua_config = {NULL, NULL, NULL};
+static modua_config_t c_modua_config = {
+    NULL, NULL, NULL, MODUA_CACHE_DEFAULT_SIZE, NULL
+};
+
+/**
+ * Create the user agent cache.
+ *
+ * @param[out] pcache Created cache.
+ * @param[in] mm Memory manager to allocate from.
+ * @param[in] capacity Number of entries; must be positive.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static ib_status_t modua_cache_create(
+    modua_cache_t **pcache,
+    ib_mm_t         mm,
+    size_t          capacity
+)
+{
+    assert(pcache != NULL);
+    assert(capacity > 0);
+
+    modua_cache_t *cache;
+    size_t         buckets = 1;
+    ib_status_t    rc;
+
+    cache = ib_mm_calloc(mm, 1, sizeof(*cache));
+    if (cache == NULL) {
+        return IB_EALLOC;
+    }
+
+    rc = ib_lock_create(&(cache->lock), mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    while (buckets < capacity) {
+        buckets *= 2;
+    }
+
+    cache->entries = ib_mm_calloc(mm, capacity, sizeof(*cache->entries));
+    cache->buckets = ib_mm_alloc(mm, buckets * sizeof(*cache->buckets));
+    if (cache->entries == NULL || cache->buckets == NULL) {
+        return IB_EALLOC;
+    }
+    for (size_t i = 0; i < buckets; ++i) {
+        cache->buckets[i] = MODUA_CACHE_NONE;
+    }
+
+    cache->capacity    = capacity;
+    cache->used        = 0;
+    cache->bucket_mask = buckets - 1;
+    cache->randomizer  = (uint32_t)clock();
+    cache->lru_head    = MODUA_CACHE_NONE;
+    cache->lru_tail    = MODUA_CACHE_NONE;
+
+    *pcache = cache;
+    return IB_OK;
+}
+
+/**
+ * Remove entry @a i from the LRU list of @a cache.
+ *
+ * @param[in] cache Cache.
+ * @param[in] i Index of entry.
+ */
+static void modua_cache_lru_unlink(modua_cache_t *cache, size_t i)
+{
+    modua_cache_entry_t *entry = &(cache->entries[i]);
+
+    if (entry->lru_prev == MODUA_CACHE_NONE) {
+        cache->lru_head = entry->lru_next;
+    }
+    else {
+        cache->entries[entry->lru_prev].lru_next = entry->lru_next;
+    }
+    if (entry->lru_next == MODUA_CACHE_NONE) {
+        cache->lru_tail = entry->lru_prev;
+    }
+    else {
+        cache->entries[entry->lru_next].lru_prev = entry->lru_prev;
+    }
+}
+
+/**
+ * Make entry @a i the most recently used entry of @a cache.
+ *
+ * @param[in] cache Cache.
+ * @param[in] i Index of entry; must not be in the LRU list.
+ */
+static void modua_cache_lru_push(modua_cache_t *cache, size_t i)
+{
+    modua_cache_entry_t *entry = &(cache->entries[i]);
+
+    entry->lru_prev = MODUA_CACHE_NONE;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head == MODUA_CACHE_NONE) {
+        cache->lru_tail = i;
+    }
+    else {
+        cache->entries[cache->lru_head].lru_prev = i;
+    }
+    cache->lru_head = i;
+}
+
+/**
+ * Find the entry for @a agent in @a cache.
+ *
+ * @param[in] cache Cache.
+ * @param[in] agent Agent string.
+ * @param[in] length Length of @a agent.
+ * @param[in] hash Hash of @a agent.
+ *
+ * @returns Index of entry or MODUA_CACHE_NONE.
+ */
+static size_t modua_cache_find(
+    const modua_cache_t *cache,
+    const char          *agent,
+    size_t               length,
+    uint32_t             hash
+)
+{
+    size_t i;
+
+    for (
+        i = cache->buckets[hash & cache->bucket_mask];
+        i != MODUA_CACHE_NONE;
+        i = cache->entries[i].bucket_next
+    ) {
+        const modua_cache_entry_t *entry = &(cache->entries[i]);
+        if (
+            entry->hash == hash &&
+            entry->length == length &&
+            memcmp(entry->agent, agent, length) == 0
+        ) {
+            return i;
+        }
+    }
+
+    return MODUA_CACHE_NONE;
+}
+
+/**
+ * Convert a pointer into a parsed buffer to a cache offset.
+ *
+ * @param[in] buf Parsed buffer.
+ * @param[in] p Pointer into @a buf or NULL.
+ *
+ * @returns Offset of @a p in @a buf or MODUA_CACHE_NONE if @a p is NULL.
+ */
+static size_t modua_cache_offset(const char *buf, const char *p)
+{
+    return (p == NULL) ? MODUA_CACHE_NONE : (size_t)(p - buf);
+}
+
+/**
+ * Convert a cache offset to a pointer into a parsed buffer.
+ *
+ * @param[in] buf Parsed buffer.
+ * @param[in] offset Offset or MODUA_CACHE_NONE.
+ *
+ * @returns Pointer into @a buf or NULL if @a offset is MODUA_CACHE_NONE.
+ */
+static char *modua_cache_pointer(char *buf, size_t offset)
+{
+    return (offset == MODUA_CACHE_NONE) ? NULL : buf + offset;
+}
+
+/**
+ * Lookup @a agent in @a cache.
+ *
+ * On a hit, the parsed agent string is copied into @a buf and the component
+ * pointers point into it, just as if modua_parse_uastring() had been called
+ * on @a buf.
+ *
+ * @param[in] cache Cache.
+ * @param[in] agent Agent string.
+ * @param[in] hash Hash of @a agent.
+ * @param[out] buf Buffer of at least `strlen(agent) + 1` bytes.
+ * @param[out] p_product Product.
+ * @param[out] p_platform Platform.
+ * @param[out] p_extra Extra.
+ * @param[out] p_rule Matching rule.
+ * @param[out] p_parse_rc Result of modua_parse_uastring().
+ *
+ * @returns
+ * - IB_OK on hit.
+ * - IB_ENOENT on miss.
+ * - Other if the cache could not be locked.
+ */
+static ib_status_t modua_cache_lookup(
+    modua_cache_t             *cache,
+    const char                *agent,
+    uint32_t                   hash,
+    char                      *buf,
+    char                     **p_product,
+    char                     **p_platform,
+    char                     **p_extra,
+    const modua_match_rule_t **p_rule,
+    ib_status_t               *p_parse_rc
+)
+{
+    size_t      length = strlen(agent);
+    size_t      i;
+    ib_status_t rc;
+
+    rc = ib_lock_lock(cache->lock);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    i = modua_cache_find(cache, agent, length, hash);
+    if (i == MODUA_CACHE_NONE) {
+        ib_lock_unlock(cache->lock);
+        return IB_ENOENT;
+    }
+
+    const modua_cache_entry_t *entry = &(cache->entries[i]);
+    memcpy(buf, entry->parsed, length + 1);
+    *p_product  = modua_cache_pointer(buf, entry->product);
+    *p_platform = modua_cache_pointer(buf, entry->platform);
+    *p_extra    = modua_cache_pointer(buf, entry->extra);
+    *p_rule     = entry->rule;
+    *p_parse_rc = entry->parse_rc;
+
+    modua_cache_lru_unlink(cache, i);
+    modua_cache_lru_push(cache, i);
+
+    ib_lock_unlock(cache->lock);
+    return IB_OK;
+}
+
+/**
+ * Store the result of parsing @a agent in @a cache.
+ *
+ * Evicts the least recently used entry if @a cache is full.  Failure to
+ * lock the cache is ignored; the result is simply not cached.
+ *
+ * @param[in] cache Cache.
+ * @param[in] agent Agent string; no longer than
+ *            MODUA_CACHE_MAX_AGENT_LENGTH.
+ * @param[in] hash Hash of @a agent.
+ * @param[in] buf Parsed agent string.
+ * @param[in] product Product; NULL or points into @a buf.
+ * @param[in] platform Platform; NULL or points into @a buf.
+ * @param[in] extra Extra; NULL or points into @a buf.
+ * @param[in] rule Matching rule.
+ * @param[in] parse_rc Result of modua_parse_uastring().
+ */
+static void modua_cache_store(
+    modua_cache_t            *cache,
+    const char               *agent,
+    uint32_t                  hash,
+    const char               *buf,
+    const char               *product,
+    const char               *platform,
+    const char               *extra,
+    const modua_match_rule_t *rule,
+    ib_status_t               parse_rc
+)
+{
+    size_t               length = strlen(agent);
+    size_t               i;
+    size_t              *link;
+    modua_cache_entry_t *entry;
+
+    assert(length <= MODUA_CACHE_MAX_AGENT_LENGTH);
+
+    if (ib_lock_lock(cache->lock) != IB_OK) {
+        return;
+    }
+
+    /* Another transaction may have stored it since the lookup. */
+    if (modua_cache_find(cache, agent, length, hash) != MODUA_CACHE_NONE) {
+        ib_lock_unlock(cache->lock);
+        return;
+    }
+
+    if (cache->used < cache->capacity) {
+        i = cache->used;
+        ++cache->used;
+    }
+    else {
+        /* Evict the least recently used entry. */
+        i = cache->lru_tail;
+        assert(i != MODUA_CACHE_NONE);
+        modua_cache_lru_unlink(cache, i);
+
+        link = &(cache->buckets[cache->entries[i].hash & cache->bucket_mask]);
+        while (*link != i) {
+            assert(*link != MODUA_CACHE_NONE);
+            link = &(cache->entries[*link].bucket_next);
+        }
+        *link = cache->entries[i].bucket_next;
+    }
+
+    entry = &(cache->entries[i]);
+    memcpy(entry->agent, agent, length + 1);
+    memcpy(entry->parsed, buf, length + 1);
+    entry->length   = length;
+    entry->hash     = hash;
+    entry->parse_rc = parse_rc;
+    entry->product  = modua_cache_offset(buf, product);
+    entry->platform = modua_cache_offset(buf, platform);
+    entry->extra    = modua_cache_offset(buf, extra);
+    entry->rule     = rule;
+
+    link = &(cache->buckets[hash & cache->bucket_mask]);
+    entry->bucket_next = *link;
+    *link = i;
+    modua_cache_lru_push(cache, i);
+
+    ib_lock_unlock(cache->lock);
+}
 
 /**
  * Skip spaces, return pointer to first non-space.
@@ -379,12 +754,14 @@ static ib_status_t modua_store_field(ib_engine_t *ib,
  * @param[in] ib IronBee object
  * @param[in,out] tx Transaction object
  * @param[in] bs Byte string containing the agent string
+ * @param[in] cache Parse cache; may be NULL.
  *
  * @returns Status code
  */
 static ib_status_t modua_agent_fields(ib_engine_t *ib,
                                       ib_tx_t *tx,
-                                      const ib_bytestr_t *bs)
+                                      const ib_bytestr_t *bs,
+                                      modua_cache_t *cache)
 {
     const modua_match_rule_t *rule = NULL;
     ib_field_t               *agent_list = NULL;
@@ -394,6 +771,11 @@ static ib_status_t modua_agent_fields(ib_engine_t *ib,
     char                     *agent;
     char                     *buf;
     size_t                    len;
+    size_t                    agent_length;
+    uint32_t                  hash = 0;
+    bool                      cacheable;
+    bool                      cached = false;
+    ib_status_t               parse_rc = IB_OK;
     ib_status_t               rc;
     ib_var_source_t          *source;
 
@@ -417,15 +799,40 @@ static ib_status_t modua_agent_fields(ib_engine_t *ib,
         return IB_EALLOC;
     }
 
-    /* Parse the user agent string */
-    rc = modua_parse_uastring(buf, &product, &platform, &extra);
-    if (rc != IB_OK) {
+    /* Check the cache for an earlier parse of the same string. */
+    agent_length = strlen(agent);
+    cacheable = (cache != NULL) &&
+                (agent_length <= MODUA_CACHE_MAX_AGENT_LENGTH);
+    if (cacheable) {
+        hash = ib_hashfunc_djb2(agent, agent_length, cache->randomizer, NULL);
+        cached = modua_cache_lookup(
+            cache, agent, hash, buf,
+            &product, &platform, &extra, &rule, &parse_rc
+        ) == IB_OK;
+    }
+
+    if (! cached) {
+        /* Parse the user agent string */
+        parse_rc = modua_parse_uastring(buf, &product, &platform, &extra);
+
+        /* Categorize the parsed string */
+        if (parse_rc == IB_OK) {
+            rule = modua_match_cat_rules(product, platform, extra);
+        }
+
+        if (cacheable) {
+            modua_cache_store(
+                cache, agent, hash, buf,
+                product, platform, extra, rule, parse_rc
+            );
+        }
+    }
+
+    if (parse_rc != IB_OK) {
         ib_log_debug_tx(tx, "Failed to parse User Agent string \"%s\".", agent);
         return IB_OK;
     }
 
-    /* Categorize the parsed string */
-    rule = modua_match_cat_rules(product, platform, extra);
     if (rule == NULL) {
         ib_log_debug_tx(tx, "No rule matched." );
     }
@@ -569,7 +976,7 @@ static ib_status_t modua_user_agent(ib_engine_t *ib,
     }
 
     /* Finally, split it up & store the components */
-    rc = modua_agent_fields(ib, tx, bs);
+    rc = modua_agent_fields(ib, tx, bs, cfg->cache);
     return rc;
 }
 
@@ -798,6 +1205,20 @@ ib_status_t modua_ctx_close(
         }
         cfg->forwarded_for = target;
 
+        if (cfg->cache_size > 0) {
+            rc = modua_cache_create(
+                &(cfg->cache),
+                ib_engine_mm_main_get(ib),
+                (size_t)cfg->cache_size
+            );
+            if (rc != IB_OK) {
+                ib_log_error(ib,
+                             "Error creating user agent cache: %s",
+                             ib_status_to_string(rc));
+                return rc;
+            }
+        }
+
         rc = ib_var_source_acquire(
             &(cfg->remote_addr),
             ib_engine_mm_main_get(ib),
@@ -816,6 +1237,65 @@ ib_status_t modua_ctx_close(
     return IB_OK;
 }
 
+/**
+ * Handle the UserAgentCacheSize directive.
+ *
+ * @param[in] cp Configuration parser
+ * @param[in] name The directive name.
+ * @param[in] p1 The directive parameter.
+ * @param[in] cbdata Callback data (unused)
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EINVAL if @a p1 is not a non-negative integer.
+ * - Other on failure to fetch the configuration.
+ */
+static ib_status_t modua_cache_size_dir_param1(ib_cfgparser_t *cp,
+                                               const char *name,
+                                               const char *p1,
+                                               void *cbdata)
+{
+    assert(cp != NULL);
+    assert(name != NULL);
+    assert(p1 != NULL);
+
+    modua_config_t *cfg;
+    ib_num_t        size;
+    ib_status_t     rc;
+
+    rc = ib_context_module_config(
+        ib_context_main(cp->ib), IB_MODULE_STRUCT_PTR, &cfg
+    );
+    if (rc != IB_OK) {
+        ib_cfg_log_error(cp, "Error fetching configuration: %s",
+                         ib_status_to_string(rc));
+        return rc;
+    }
+
+    rc = ib_type_atoi(p1, 10, &size);
+    if (rc != IB_OK || size < 0) {
+        ib_cfg_log_error(cp,
+                         "%s parameter must be a non-negative integer: %s",
+                         name, p1);
+        return IB_EINVAL;
+    }
+
+    cfg->cache_size = size;
+
+    return IB_OK;
+}
+
+static IB_DIRMAP_INIT_STRUCTURE(modua_directive_map) = {
+    IB_DIRMAP_INIT_PARAM1(
+        "UserAgentCacheSize",
+        modua_cache_size_dir_param1,
+        NULL
+    ),
+
+    /* signal the end of the list */
+    IB_DIRMAP_INIT_LAST
+};
+
 /**
  * Called to initialize the user agent module (when the module is loaded).
  *
@@ -913,7 +1393,7 @@ IB_MODULE_INIT(
     MODULE_NAME_STR,                   /* Module name */
     IB_MODULE_CONFIG(&c_modua_config), /* Global config data */
     NULL,                              /* Module config map */
-    NULL,                              /* Module directive map */
+    modua_directive_map,               /* Module directive map */
     modua_init,                        /* Initialize function */
     NULL,                              /* Callback data */
     NULL,                              /* Finish function */
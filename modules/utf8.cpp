@@ -47,11 +47,14 @@
 /* UTF-8 library found in base_srcdir/libs/utf8*. */
 #include <utf8.h>
 
+#include <cstring>
 #include <iterator>
 #include <map>
-#include <sstream>
+#include <string>
 #include <vector>
 
+#include <stdint.h>
+
 namespace {
 
 typedef std::map<std::string, char> utf8ToAscii_t;
@@ -198,6 +201,81 @@ void repack_utf8(std::vector<T> &v)
     }
 }
 
+/**
+ * Get the bytes of string field @a f without copying them.
+ *
+ * @param[in] f Field of type Field::NULL_STRING or Field::BYTE_STRING.
+ * @param[out] data The bytes of @a f.
+ * @param[out] length The number of bytes at @a data.
+ */
+void field_data(ConstField f, const char*& data, size_t& length)
+{
+    if (f.type() == Field::BYTE_STRING) {
+        ConstByteString bs = f.value_as_byte_string();
+        data   = bs.const_data();
+        length = bs.size();
+    }
+    else {
+        data   = f.value_as_null_string();
+        length = strlen(data);
+    }
+}
+
+/**
+ * Count the ASCII bytes at the start of @a data.
+ *
+ * Eight bytes are checked at a time, so the common case of text that is
+ * entirely or mostly ASCII is handled without decoding it.
+ *
+ * @param[in] data The bytes to check
+ * @param[in] length The number of bytes at @a data.
+ *
+ * @returns The number of leading bytes with the high-order bit clear.
+ */
+size_t ascii_length(const char* data, size_t length)
+{
+    static const uint64_t high_bits = 0x8080808080808080ULL;
+    size_t i = 0;
+
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+        uint64_t word;
+
+        memcpy(&word, data + i, sizeof(word));
+        if (word & high_bits) {
+            break;
+        }
+    }
+
+    while (i < length && ! (data[i] & 0x80)) {
+        ++i;
+    }
+
+    return i;
+}
+
+/**
+ * Create a byte string field named as @a f holding @a str.
+ *
+ * @param[in] mm Memory manager.
+ * @param[in] f The field to name the result after.
+ * @param[in] str The value.
+ *
+ * @returns The new field.
+ */
+ConstField create_result(
+    MemoryManager      mm,
+    ConstField         f,
+    const std::string& str
+)
+{
+    return Field::create_no_copy_byte_string(
+        mm,
+        f.name(),
+        f.name_length(),
+        ByteString::create(mm, str)
+    );
+}
+
 /**
  * Return 1 if @a in is UTF8 and 0 otherwise.
  *
@@ -218,12 +296,13 @@ int validateUtf8(Transaction tx, ConstField in)
         return 0;
     }
 
-    std::istringstream in_stringstream(in.to_s());
+    const char* data;
+    size_t      length;
+    field_data(in, data, length);
 
-    std::istream_iterator<char> it(in_stringstream);
-    std::istream_iterator<char> eos;
+    size_t ascii = ascii_length(data, length);
 
-    if (utf8::is_valid(it, eos)) {
+    if (ascii == length || utf8::is_valid(data + ascii, data + length)) {
         return 1;
     }
     else {
@@ -250,17 +329,27 @@ ConstField replaceInvalidUtf8(MemoryManager mm, ConstField f)
         return f;
     }
 
-    std::string str = f.to_s();
+    const char* data;
+    size_t      length;
+    field_data(f, data, length);
 
-    std::string new_str;
-    utf8::replace_invalid(str.begin(), str.end(), std::back_inserter(new_str));
+    size_t ascii = ascii_length(data, length);
 
-    return Field::create_byte_string(
-        mm,
-        f.name(),
-        f.name_length(),
-        ByteString::create(mm, new_str)
+    /* ASCII is valid UTF-8; nothing to replace. */
+    if (ascii == length && f.type() == Field::BYTE_STRING) {
+        return f;
+    }
+
+    std::string new_str;
+    new_str.reserve(length);
+    new_str.append(data, ascii);
+    utf8::replace_invalid(
+        data + ascii,
+        data + length,
+        std::back_inserter(new_str)
     );
+
+    return create_result(mm, f, new_str);
 }
 
 ConstField removeUtf8ReplacementCharacter(MemoryManager mm, ConstField f)
@@ -273,18 +362,28 @@ ConstField removeUtf8ReplacementCharacter(MemoryManager mm, ConstField f)
         return f;
     }
 
-    std::string str = f.to_s();
+    const char* data;
+    size_t      length;
+    field_data(f, data, length);
 
-    std::ostringstream oss;
-    std::ostream_iterator<char> osi(oss);
-    boost::algorithm::erase_all_copy(osi, str, UTF8_REPLACEMENT_CHARACTER);
+    /* Without the first byte of the replacement character, there is
+     * nothing to remove. */
+    if (
+        f.type() == Field::BYTE_STRING &&
+        memchr(data, UTF8_REPLACEMENT_CHARACTER[0], length) == NULL
+    ) {
+        return f;
+    }
 
-    return Field::create_byte_string(
-        mm,
-        f.name(),
-        f.name_length(),
-        ByteString::create(mm, oss.str())
+    std::string new_str;
+    new_str.reserve(length);
+    boost::algorithm::erase_all_copy(
+        std::back_inserter(new_str),
+        std::make_pair(data, data + length),
+        UTF8_REPLACEMENT_CHARACTER
     );
+
+    return create_result(mm, f, new_str);
 }
 
 /**
@@ -312,12 +411,7 @@ ConstField utf8To16(MemoryManager mm, ConstField f)
 
     utf8::unchecked::utf8to16(str.begin(), str.end(), std::back_inserter(new_str));
 
-    return Field::create_byte_string(
-        mm,
-        f.name(),
-        f.name_length(),
-        ByteString::create(mm, new_str)
-    );
+    return create_result(mm, f, new_str);
  }
 
 /**
@@ -345,12 +439,7 @@ ConstField utf8To32(MemoryManager mm, ConstField f)
 
     utf8::unchecked::utf8to32(str.begin(), str.end(), std::back_inserter(new_str));
 
-    return Field::create_byte_string(
-        mm,
-        f.name(),
-        f.name_length(),
-        ByteString::create(mm, new_str)
-    );
+    return create_result(mm, f, new_str);
 }
 
 /**
@@ -378,12 +467,7 @@ ConstField utf16To8(MemoryManager mm, ConstField f)
 
     utf8::unchecked::utf16to8(str.begin(), str.end(), std::back_inserter(new_str));
 
-    return Field::create_byte_string(
-        mm,
-        f.name(),
-        f.name_length(),
-        ByteString::create(mm, new_str)
-    );
+    return create_result(mm, f, new_str);
 }
 
 /**
@@ -411,12 +495,7 @@ ConstField utf32To8(MemoryManager mm, ConstField f)
 
     utf8::unchecked::utf32to8(str.begin(), str.end(), std::back_inserter(new_str));
 
-    return Field::create_byte_string(
-        mm,
-        f.name(),
-        f.name_length(),
-        ByteString::create(mm, new_str)
-    );
+    return create_result(mm, f, new_str);
 }
 
 /**
@@ -429,13 +508,14 @@ ConstField utf32To8(MemoryManager mm, ConstField f)
 class Utf8Reader {
 public:
     /**
-     * Construct a Utf8Reader that iterates over @a str.
+     * Construct a Utf8Reader that iterates over @a data.
      *
-     * @a str must not be changed during this class's use.
+     * @a data must not be changed during this class's use.
      *
-     * @param[in] str The sting to iterate over.
+     * @param[in] data The bytes to iterate over.
+     * @param[in] length The number of bytes at @a data.
      */
-    Utf8Reader(std::string& str);
+    Utf8Reader(const char* data, size_t length);
 
     /**
      * Read a character, returning if it is valid or not.
@@ -459,6 +539,15 @@ public:
      */
     void shift(int n);
 
+    /**
+     * Append the ASCII bytes at the current position to @a out.
+     *
+     * The next call to Utf8Reader::read() will start after them.
+     *
+     * @param[in] out The string to append to.
+     */
+    void read_ascii(std::string& out);
+
     /**
      * Return a vector that holds the currently read number of bytes.
      * This is a reference to the internal buffer. The user may modify
@@ -472,15 +561,15 @@ public:
     bool has_more();
 
 private:
-    std::string::iterator      m_itr;
-    std::string::iterator      m_end;
+    const char*                m_itr;
+    const char*                m_end;
     std::vector<unsigned char> m_utfchar;
 };
 
-Utf8Reader::Utf8Reader(std::string& str)
+Utf8Reader::Utf8Reader(const char* data, size_t length)
 :
-    m_itr(str.begin()),
-    m_end(str.end()),
+    m_itr(data),
+    m_end(data + length),
     m_utfchar(6)
 {
     m_utfchar.resize(0);
@@ -568,6 +657,13 @@ void Utf8Reader::shift(int n) {
     m_itr = m_itr + n;
 }
 
+void Utf8Reader::read_ascii(std::string& out) {
+    size_t n = ascii_length(m_itr, m_end - m_itr);
+
+    out.append(m_itr, n);
+    m_itr += n;
+}
+
 /**
  * Handle invalid reads from a Utf8Reader in a common way.
  *
@@ -623,14 +719,28 @@ ConstField normalizeUtf8(MemoryManager mm, ConstField f)
         return f;
     }
 
-    std::string str = f.to_s();
+    const char* data;
+    size_t      length;
+    field_data(f, data, length);
+
+    /* ASCII has no overlong characters. */
+    if (f.type() == Field::BYTE_STRING && ascii_length(data, length) == length) {
+        return f;
+    }
 
     std::string new_str;
+    new_str.reserve(length);
 
-    Utf8Reader reader(str);
+    Utf8Reader reader(data, length);
 
     while (reader.has_more()) {
 
+        /* Copy runs of ASCII as they are. */
+        reader.read_ascii(new_str);
+        if (! reader.has_more()) {
+            break;
+        }
+
         /* Valid char. */
         if (reader.read()) {
             repack_utf8(reader.utf8char());
@@ -646,12 +756,7 @@ ConstField normalizeUtf8(MemoryManager mm, ConstField f)
         }
     }
 
-    return Field::create_byte_string(
-        mm,
-        f.name(),
-        f.name_length(),
-        ByteString::create(mm, new_str)
-    );
+    return create_result(mm, f, new_str);
 }
 
 /**
@@ -680,14 +785,27 @@ ConstField utf8ToAscii(
         return f;
     }
 
-    std::string str = f.to_s();
+    const char* data;
+    size_t      length;
+    field_data(f, data, length);
+
+    /* ASCII characters have no mappings. */
+    if (f.type() == Field::BYTE_STRING && ascii_length(data, length) == length) {
+        return f;
+    }
 
     std::string new_str;
+    new_str.reserve(length);
 
-    Utf8Reader reader(str);
+    Utf8Reader reader(data, length);
 
     while (reader.has_more()) {
 
+        reader.read_ascii(new_str);
+        if (! reader.has_more()) {
+            break;
+        }
+
         utf8ToAscii_t::const_iterator map_itr = utf8ToAscii.end();
 
         if (reader.read()) {
@@ -721,12 +839,7 @@ ConstField utf8ToAscii(
 
     }
 
-    return Field::create_byte_string(
-        mm,
-        f.name(),
-        f.name_length(),
-        ByteString::create(mm, new_str)
-    );
+    return create_result(mm, f, new_str);
 }
 
 /**
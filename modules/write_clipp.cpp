@@ -40,8 +40,10 @@
  * @note Either action must be fired before IB_PHASE_LOGGING in order to
  *       capture the current transaction.  They must be fired the body
  *       phases in order to capture the body.  Otherwise, it does not
- *       matter which phase they are fired in; non-body writing and all file
- *       I/O takes place in the logging phase.
+ *       matter which phase they are fired in; non-body writing takes place
+ *       in the logging phase.  Serialization and all file I/O take place
+ *       in a writer thread of the module; the output is complete once the
+ *       engine is destroyed.
  *
  * @note The resulting PB is a reproduction of the traffic, not an
  *       accurate reproduction of the event stream.  Differences include
@@ -59,7 +61,14 @@
  * Input before we write anything, which means, for `write_clipp_conn`,
  * writing at the end of the connection.  As transaction data does not live
  * past the end of the transaction, we make copies of the relevant data
- * using the connection memory pool.
+ * using a memory pool owned by the Input.
+ *
+ * Finished Inputs are handed to an ib_batch_writer_t whose thread
+ * serializes, compresses and appends them.  The thread writes all Inputs
+ * queued since its last pass at once, opening each file once per pass, so
+ * the transaction threads never wait on compression or file I/O, only on a
+ * full queue.  Owning its memory lets an Input outlive its connection until
+ * it is written.
  *
  * There are more memory efficient alternatives including:
  *
@@ -78,10 +87,18 @@
 
 #include <ironbeepp/all.hpp>
 
+#include <ironbee/batch_writer.h>
 #include <ironbee/rule_engine.h>
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <fstream>
+#include <list>
+#include <map>
+
+#include <arpa/inet.h>
+
 using namespace std;
 using namespace IronBee;
 
@@ -123,6 +140,70 @@ struct per_connection_t
 //! Pointer to @ref per_connection_t; stored in connection module data.
 typedef boost::shared_ptr<per_connection_t> per_connection_p;
 
+//! Memory pool owning the data of an Input; stored in its source.
+typedef boost::shared_ptr<ScopedMemoryPoolLite> input_pool_p;
+
+/**
+ * Background writer of finished inputs.
+ *
+ * Inputs are queued by submit() and written by the thread of an
+ * ib_batch_writer_t.  The destructor writes any inputs still queued.
+ **/
+class Writer :
+    boost::noncopyable
+{
+public:
+    /**
+     * Constructor.
+     *
+     * The thread is started by the first submit() of each process.
+     *
+     * @param[in] engine Engine to log errors to.
+     * @throw IronBee exception if the batch writer can not be created.
+     **/
+    explicit
+    Writer(Engine engine);
+
+    //! Destructor.  Writes all queued inputs and stops the thread.
+    ~Writer();
+
+    /**
+     * Queue @a input to be appended to @a to.
+     *
+     * Blocks while the queue is full.
+     *
+     * @param[in] input Input to write.
+     * @param[in] to    Where to write it.  Empty string means cerr.
+     **/
+    void submit(const CLIPP::Input::input_p& input, const string& to);
+
+private:
+    //! An input and where to write it.
+    typedef pair<CLIPP::Input::input_p, string> job_t;
+
+    //! Most inputs queued before submit() waits.
+    static const size_t c_max_pending = 1024;
+
+    /**
+     * Write and delete a batch of jobs; the write function of @ref m_batch.
+     *
+     * @param[in] items   Jobs, each allocated by submit().
+     * @param[in] n_items Number of @a items.
+     * @param[in] cbdata  The writer.
+     **/
+    static void write_batch(void** items, size_t n_items, void* cbdata);
+
+    //! Write the @a n_items jobs of @a items.
+    void write(void* const* items, size_t n_items);
+
+    //! Engine.
+    Engine m_engine;
+    //! Memory pool of @ref m_batch.
+    ScopedMemoryPoolLite m_pool;
+    //! Queue of jobs and the thread writing them.
+    ib_batch_writer_t* m_batch;
+};
+
 //! Delegate
 class Delegate :
     public IronBee::ModuleDelegate
@@ -186,6 +267,20 @@ private:
      * @param[in] connection Current connection.
      **/
     void on_connection_close(Connection connection) const;
+
+    /**
+     * Finish an input and queue it for writing.
+     *
+     * @param[in] input Input to write out.
+     * @param[in] to    Where to write it.  Empty string means cerr.
+     **/
+    void finish_input(
+        const CLIPP::Input::input_p& input,
+        const char*                  to
+    ) const;
+
+    //! Writer of finished inputs.
+    boost::scoped_ptr<Writer> m_writer;
 };
 
 /**
@@ -197,15 +292,12 @@ private:
 CLIPP::Input::input_p start_input(Connection connection);
 
 /**
- * Finish an input.
+ * Memory manager of the pool owning the data of @a input.
  *
- * @param[in] input Input to write out.
- * @param[in] to    Where to write it.  Empty string means cerr.
+ * @param[in] input Input created by start_input().
+ * @return Memory manager to copy data for @a input with.
  **/
-void finish_input(
-    const CLIPP::Input::input_p& input,
-    const char*                  to
-);
+MemoryManager input_memory_manager(const CLIPP::Input::input_p& input);
 
 /**
  * Add headers starting with @a first to @a e.
@@ -276,8 +368,129 @@ IBPP_BOOTSTRAP_MODULE_DELEGATE("constant", Delegate)
 // Reopen for doxygen; not needed by C++.
 namespace {
 
+Writer::Writer(Engine engine) :
+    m_engine(engine),
+    m_batch(NULL)
+{
+    throw_if_error(
+        ib_batch_writer_create(
+            &m_batch,
+            MemoryManager(m_pool).ib(),
+            c_max_pending,
+            &Writer::write_batch,
+            this
+        ),
+        "Failed to create write_clipp writer."
+    );
+}
+
+Writer::~Writer()
+{
+    ib_batch_writer_stop(m_batch);
+}
+
+void Writer::submit(const CLIPP::Input::input_p& input, const string& to)
+{
+    ib_batch_writer_submit(m_batch, new job_t(input, to));
+}
+
+void Writer::write_batch(void** items, size_t n_items, void* cbdata)
+{
+    Writer* writer = static_cast<Writer*>(cbdata);
+
+    // Called from C; nothing may escape.
+    try {
+        writer->write(items, n_items);
+    }
+    catch (const exception& e) {
+        ib_log_error(
+            writer->m_engine.ib(),
+            "write_clipp: Could not write inputs: %s",
+            e.what()
+        );
+    }
+    catch (...) {
+        ib_log_error(
+            writer->m_engine.ib(),
+            "write_clipp: Could not write inputs."
+        );
+    }
+
+    for (size_t i = 0; i < n_items; ++i) {
+        delete static_cast<job_t*>(items[i]);
+    }
+}
+
+void Writer::write(void* const* items, size_t n_items)
+
+{
+    typedef map<string, ostream*> streams_t;
+    streams_t streams;
+    list<boost::shared_ptr<ofstream> > files;
+    string buffer;
+
+    for (size_t n = 0; n < n_items; ++n) {
+        const job_t* i = static_cast<const job_t*>(items[n]);
+
+        streams_t::iterator stream_i = streams.find(i->second);
+        if (stream_i == streams.end()) {
+            ostream* stream = &cerr;
+            if (! i->second.empty()) {
+                files.push_back(boost::shared_ptr<ofstream>(new ofstream(
+                    i->second.c_str(),
+                    ios::binary | ios::app | ios::out
+                )));
+                stream = files.back().get();
+                if (! *stream) {
+                    ib_log_error(
+                        m_engine.ib(),
+                        "write_clipp: Could not open %s for writing.",
+                        i->second.c_str()
+                    );
+                }
+            }
+            stream_i = streams.insert(make_pair(i->second, stream)).first;
+        }
+
+        ostream& out = *stream_i->second;
+        if (! out) {
+            continue;
+        }
+
+        try {
+            CLIPP::serialize_pb_input(buffer, i->first);
+        }
+        catch (const exception& e) {
+            ib_log_error(
+                m_engine.ib(),
+                "write_clipp: Could not serialize input %s: %s",
+                i->first->id.c_str(), e.what()
+            );
+            continue;
+        }
+
+        uint32_t nsize = htonl(buffer.length());
+        out.write(reinterpret_cast<const char*>(&nsize), sizeof(nsize));
+        out.write(buffer.data(), buffer.length());
+    }
+
+    // Flush each output once per pass; files are closed as files goes out
+    // of scope.
+    for (
+        streams_t::const_iterator i = streams.begin();
+        i != streams.end();
+        ++i
+    )
+    {
+        if (*i->second) {
+            i->second->flush();
+        }
+    }
+}
+
 Delegate::Delegate(IronBee::Module module) :
-    IronBee::ModuleDelegate(module)
+    IronBee::ModuleDelegate(module),
+    m_writer(new Writer(module.engine()))
 {
     using boost::bind;
 
@@ -474,29 +687,33 @@ CLIPP::Input::Buffer stream_to_buf(
 CLIPP::Input::input_p start_input(Connection connection)
 {
     CLIPP::Input::input_p input(new CLIPP::Input::Input(connection.id()));
+    input_pool_p pool(new ScopedMemoryPoolLite());
+    MemoryManager mm(*pool);
 
+    input->source = pool;
     input->connection.connection_opened(
-        s_to_buf(connection.memory_manager(), connection.local_ip_string()),
+        s_to_buf(mm, connection.local_ip_string()),
         connection.local_port(),
-        s_to_buf(connection.memory_manager(), connection.remote_ip_string()),
+        s_to_buf(mm, connection.remote_ip_string()),
         connection.remote_port()
     );
 
     return input;
 }
 
-void finish_input(const CLIPP::Input::input_p& input, const char* to)
+MemoryManager input_memory_manager(const CLIPP::Input::input_p& input)
+{
+    return MemoryManager(*boost::any_cast<input_pool_p>(input->source));
+}
+
+void Delegate::finish_input(
+    const CLIPP::Input::input_p& input,
+    const char*                  to
+) const
 {
     input->connection.connection_closed();
 
-    if (! to[0]) {
-        CLIPP::PBConsumer consumer(cerr);
-        consumer(input);
-    }
-    else {
-        CLIPP::PBConsumer consumer(to);
-        consumer(input);
-    }
+    m_writer->submit(input, to);
 }
 
 void add_headers(
@@ -521,7 +738,7 @@ void add_headers(
 void add_transaction(const CLIPP::Input::input_p& input, ConstTransaction tx)
 {
     CLIPP::Input::Transaction& clipp_tx = input->connection.add_transaction();
-    MemoryManager mm = tx.connection().memory_manager();
+    MemoryManager mm = input_memory_manager(input);
 
     clipp_tx.request_started(
         bs_to_buf(mm, tx.request_line().raw()),
@@ -489,6 +489,11 @@ void XRule::xrule_impl(IronBee::Transaction tx, ActionSet& actions)
     );
 }
 
+bool XRule::compile(XRuleTable& table) const
+{
+    return false;
+}
+
 /* End XRule Impl */
 
 
@@ -649,6 +654,11 @@ void XRulesModule::build_ip_xrule(IronBee::Engine ib, IronBee::Context ctx) {
         module().configuration_data<XRulesModuleConfig>(ctx);
 
     cfg.req_xrules.push_back(xrule_ptr(new XRuleIP(cfg)));
+
+    /* Replace the request XRules with one that decides them together. */
+    xrule_ptr table(new XRuleTable(ib, cfg.req_xrules));
+    cfg.req_xrules.clear();
+    cfg.req_xrules.push_back(table);
 }
 
 void XRulesModule::disable_xrule_events(IronBee::Engine ib, IronBee::Transaction tx) {
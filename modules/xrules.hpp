@@ -60,6 +60,8 @@ class Action;
 
 class XRule;
 
+class XRuleTable;
+
 class XRulesModuleConfig;
 
 struct XRulesModuleTxData;
@@ -408,6 +410,18 @@ public:
      */
     void operator()(IronBee::Transaction tx, ActionSet &actions);
 
+    /**
+     * Add this XRule to @a table if a table lookup can decide it.
+     *
+     * The default adds nothing; XRules that match a single value of the
+     * transaction against a constant override this.
+     *
+     * @param[in] table The table to add to.
+     *
+     * @returns True if added, false if this XRule must run on its own.
+     */
+    virtual bool compile(XRuleTable& table) const;
+
     //! Destructor.
     virtual ~XRule();
 };
@@ -485,7 +499,8 @@ private:
     /**
      * Context close callback.
      *
-     * Currently this will only roll-up IP checks into a single IP check rule.
+     * Rolls up IP checks into a single IP check rule and then compiles the
+     * request XRules into a single XRuleTable.
      *
      * @param[in] ib IronBee engine.
      * @param[in] ctx IronBee configuration context.
@@ -37,6 +37,7 @@
 #pragma clang diagnostic ignored "-Wunused-local-typedef"
 #endif
 #endif
+#include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -48,6 +49,8 @@
 #pragma clang diagnostic pop
 #endif
 
+#include <algorithm>
+
 
 /* BlockAllow Impl */
 BlockAllow::BlockAllow(bool block, int priority)
@@ -273,6 +276,12 @@ void XRuleGeo::xrule_impl(IronBee::Transaction tx, ActionSet& actions)
     }
 }
 
+bool XRuleGeo::compile(XRuleTable& table) const
+{
+    table.add_geo(m_country, m_action);
+    return true;
+}
+
 const char *XRuleGeo::GEOIP_FIELD = "GEOIP:country_code";
 /* End XRuleGeo Impl */
 
@@ -457,6 +466,12 @@ void XRulePath::xrule_impl(
             "Skipping rule as action does not override tx actions.");
     }
 }
+
+bool XRulePath::compile(XRuleTable& table) const
+{
+    table.add_path_prefix(m_path, m_action);
+    return true;
+}
 /* End XRulePath Impl */
 
 /* XRuleTime Impl */
@@ -945,6 +960,12 @@ void XRuleRequestHeader::xrule_impl(
     }
 }
 
+bool XRuleRequestHeader::compile(XRuleTable& table) const
+{
+    table.add_request_header(m_param, m_action);
+    return true;
+}
+
 XRuleRequestHeader::~XRuleRequestHeader(){}
 
 /* End XRuleRequestHeader Impl */
@@ -968,6 +989,12 @@ void XRuleMethod::xrule_impl(
     }
 }
 
+bool XRuleMethod::compile(XRuleTable& table) const
+{
+    table.add_method(m_param, m_action);
+    return true;
+}
+
 XRuleMethod::~XRuleMethod(){}
 
 /* End XRuleMethod Impl */
@@ -992,7 +1019,220 @@ void XRuleHostname::xrule_impl(
     }
 }
 
+bool XRuleHostname::compile(XRuleTable& table) const
+{
+    table.add_hostname_suffix(m_param, m_action);
+    return true;
+}
+
 XRuleHostname::~XRuleHostname(){}
 
 /* End XRuleHostname  Impl */
 
+/* XRuleTable Impl */
+namespace {
+
+//! Order entries by position.
+bool entry_before(
+    const std::pair<size_t, action_ptr>& a,
+    const std::pair<size_t, action_ptr>& b
+)
+{
+    return a.first < b.first;
+}
+
+}
+
+XRuleTable::XRuleTable(
+    IronBee::Engine             engine,
+    const std::list<xrule_ptr>& xrules
+)
+:
+    m_position(0)
+{
+    BOOST_FOREACH(const xrule_ptr& xrule, xrules) {
+        if (! xrule->compile(*this)) {
+            m_others.push_back(std::make_pair(m_position, xrule));
+        }
+        ++m_position;
+    }
+
+    if (! m_geo.empty()) {
+        m_geo_target = IronBee::VarTarget::acquire_from_string(
+            engine.main_memory_mm(),
+            engine.var_config(),
+            XRuleGeo::GEOIP_FIELD
+        );
+    }
+}
+
+void XRuleTable::add_geo(const std::string& country, action_ptr action)
+{
+    m_geo[boost::to_lower_copy(country)].push_back(
+        entry_t(m_position, action));
+}
+
+void XRuleTable::add_method(const std::string& method, action_ptr action)
+{
+    m_methods[boost::to_lower_copy(method)].push_back(
+        entry_t(m_position, action));
+}
+
+void XRuleTable::add_hostname_suffix(
+    const std::string& suffix,
+    action_ptr         action
+)
+{
+    m_hostname_suffixes[boost::to_lower_copy(suffix)].push_back(
+        entry_t(m_position, action));
+    m_hostname_suffix_lengths.insert(suffix.length());
+}
+
+void XRuleTable::add_path_prefix(
+    const std::string& prefix,
+    action_ptr         action
+)
+{
+    m_path_prefixes[prefix].push_back(entry_t(m_position, action));
+    m_path_prefix_lengths.insert(prefix.length());
+}
+
+void XRuleTable::add_request_header(
+    const std::string& name,
+    action_ptr         action
+)
+{
+    m_request_headers[boost::to_lower_copy(name)].push_back(
+        entry_t(m_position, action));
+}
+
+void XRuleTable::lookup(
+    const index_t&        index,
+    const std::string&    key,
+    std::vector<entry_t>& matches
+)
+{
+    index_t::const_iterator i = index.find(key);
+
+    if (i != index.end()) {
+        matches.insert(matches.end(), i->second.begin(), i->second.end());
+    }
+}
+
+void XRuleTable::lookup_geo(
+    IronBee::Transaction  tx,
+    std::vector<entry_t>& matches
+)
+{
+    IronBee::ConstList<IronBee::ConstField> ls =
+        m_geo_target.get(tx.memory_manager(), tx.var_store());
+
+    if (ls.size() < 1) {
+        ib_log_info_tx(
+            tx.ib(),
+            "No GeoIP fields. Not filtering on GeoIP.");
+        return;
+    }
+
+    try {
+        IronBee::ConstByteString bs = ls.front().value_as_byte_string();
+
+        ib_log_debug_tx(
+            tx.ib(),
+            "Matching GeoIP input %.*s against %zd countries.",
+            static_cast<int>(bs.length()),
+            bs.const_data(),
+            m_geo.size());
+        lookup(m_geo, boost::to_lower_copy(bs.to_s()), matches);
+    }
+    catch (const IronBee::einval& e) {
+        ib_log_error_tx(
+            tx.ib(),
+            "GeoIP field is not a byte string field. "
+            "This XRule cannot run."
+        );
+    }
+}
+
+void XRuleTable::xrule_impl(
+    IronBee::Transaction tx,
+    ActionSet&           actions
+)
+{
+    std::vector<entry_t> matches;
+
+    if (! m_geo.empty()) {
+        lookup_geo(tx, matches);
+    }
+
+    if (! m_methods.empty()) {
+        lookup(
+            m_methods,
+            boost::to_lower_copy(tx.request_line().method().to_s()),
+            matches);
+    }
+
+    if (! m_hostname_suffixes.empty() && tx.hostname() != NULL) {
+        const std::string hostname =
+            boost::to_lower_copy(std::string(tx.hostname()));
+
+        BOOST_FOREACH(size_t length, m_hostname_suffix_lengths) {
+            if (length > hostname.length()) {
+                break;
+            }
+            lookup(
+                m_hostname_suffixes,
+                hostname.substr(hostname.length() - length),
+                matches);
+        }
+    }
+
+    if (! m_path_prefixes.empty() && tx.ib()->path != NULL) {
+        const std::string path(tx.ib()->path);
+
+        BOOST_FOREACH(size_t length, m_path_prefix_lengths) {
+            if (length > path.length()) {
+                break;
+            }
+            lookup(m_path_prefixes, path.substr(0, length), matches);
+        }
+    }
+
+    if (! m_request_headers.empty()) {
+        for (
+            IronBee::ParsedHeader ph = tx.request_header();
+            ph;
+            ph = ph.next()
+        )
+        {
+            lookup(
+                m_request_headers,
+                boost::to_lower_copy(ph.name().to_s()),
+                matches);
+        }
+    }
+
+    /* Set actions and run the other XRules in configuration order. */
+    std::stable_sort(matches.begin(), matches.end(), entry_before);
+
+    std::vector<entry_t>::iterator match = matches.begin();
+    std::vector<std::pair<size_t, xrule_ptr> >::iterator other =
+        m_others.begin();
+
+    while (match != matches.end() || other != m_others.end()) {
+        if (
+            other == m_others.end() ||
+            (match != matches.end() && match->first < other->first)
+        )
+        {
+            actions.set(match->second);
+            ++match;
+        }
+        else {
+            (*(other->second))(tx, actions);
+            ++other;
+        }
+    }
+}
+/* End XRuleTable Impl */
+
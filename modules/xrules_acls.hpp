@@ -48,6 +48,12 @@
 #pragma clang diagnostic pop
 #endif
 
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
 /**
  * Defines how to block a transaction.
  */
@@ -253,6 +259,9 @@ public:
     //! The field that is set.
     static const char *GEOIP_FIELD;
 
+    //! Add to @a table as a country lookup.
+    virtual bool compile(XRuleTable& table) const;
+
 private:
 
     //! The country that will cause this rule to succeed if it matches.
@@ -325,6 +334,9 @@ public:
      */
     XRulePath(const char *path, action_ptr action);
 
+    //! Add to @a table as a path prefix lookup.
+    virtual bool compile(XRuleTable& table) const;
+
 private:
     //! Path to check the HTTP request for.
     std::string m_path;
@@ -630,6 +642,9 @@ public:
     //! Destructor.
     ~XRuleRequestHeader();
 
+    //! Add to @a table as a header name lookup.
+    virtual bool compile(XRuleTable& table) const;
+
 private:
 
     //! The parameter to use in checking.
@@ -657,6 +672,9 @@ public:
     //! Destructor.
     ~XRuleMethod();
 
+    //! Add to @a table as a method lookup.
+    virtual bool compile(XRuleTable& table) const;
+
 private:
 
     //! The parameter to use in checking.
@@ -684,6 +702,9 @@ public:
     //! Destructor.
     ~XRuleHostname();
 
+    //! Add to @a table as a hostname suffix lookup.
+    virtual bool compile(XRuleTable& table) const;
+
 private:
 
     //! The parameter to use in checking.
@@ -699,5 +720,111 @@ private:
     );
 };
 
+/**
+ * Decide a list of XRules in a single pass over the transaction.
+ *
+ * Like XRuleIP does for IP addresses, this XRule is built after the
+ * configuration phase from all request XRules of a context.  XRules that
+ * match a single value against a constant (see XRule::compile()) are
+ * indexed by that constant, so each value of the transaction is fetched
+ * once and looked up once, or once per configured length for prefixes and
+ * suffixes, instead of once per XRule.  All other XRules are run as
+ * before.
+ *
+ * Actions of matches are set in the order the XRules were configured, so
+ * that actions of equal priority override each other as before.
+ */
+class XRuleTable : public XRule {
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param[in] engine The engine.  Used to acquire the GeoIP target.
+     * @param[in] xrules The XRules to decide, in order.
+     */
+    XRuleTable(IronBee::Engine engine, const std::list<xrule_ptr>& xrules);
+
+    //! Match @a action if the GeoIP country code is @a country.
+    void add_geo(const std::string& country, action_ptr action);
+
+    //! Match @a action if the request method is @a method.
+    void add_method(const std::string& method, action_ptr action);
+
+    //! Match @a action if the hostname ends with @a suffix.
+    void add_hostname_suffix(const std::string& suffix, action_ptr action);
+
+    //! Match @a action if the request path starts with @a prefix.
+    void add_path_prefix(const std::string& prefix, action_ptr action);
+
+    //! Match @a action if the request has a header named @a name.
+    void add_request_header(const std::string& name, action_ptr action);
+
+private:
+
+    //! Position of an XRule in configuration order and its action.
+    typedef std::pair<size_t, action_ptr> entry_t;
+
+    //! Entries by the (possibly lowercased) constant they match.
+    typedef std::map<std::string, std::vector<entry_t> > index_t;
+
+    //! Position of the XRule being compiled.
+    size_t m_position;
+
+    //! XRules that are not compiled, with their positions.
+    std::vector<std::pair<size_t, xrule_ptr> > m_others;
+
+    //! Lowercase country codes.
+    index_t m_geo;
+
+    //! Lowercase methods.
+    index_t m_methods;
+
+    //! Lowercase hostname suffixes.
+    index_t m_hostname_suffixes;
+
+    //! Lengths of the entries of m_hostname_suffixes.
+    std::set<size_t> m_hostname_suffix_lengths;
+
+    //! Path prefixes.
+    index_t m_path_prefixes;
+
+    //! Lengths of the entries of m_path_prefixes.
+    std::set<size_t> m_path_prefix_lengths;
+
+    //! Lowercase header names.
+    index_t m_request_headers;
+
+    //! Target of XRuleGeo::GEOIP_FIELD; singular if no GeoIP entries.
+    IronBee::ConstVarTarget m_geo_target;
+
+    /**
+     * Add the entries of @a index for @a key to @a matches.
+     *
+     * @param[in] index Index to look in.
+     * @param[in] key Key to look up.
+     * @param[in] matches Matches to add to.
+     */
+    static void lookup(
+        const index_t&        index,
+        const std::string&    key,
+        std::vector<entry_t>& matches
+    );
+
+    //! Add the entries of m_geo for the GeoIP country code to @a matches.
+    void lookup_geo(IronBee::Transaction tx, std::vector<entry_t>& matches);
+
+    /**
+     * Run all XRules of this table.
+     *
+     * @param[in] tx The transaction to check.
+     * @param[in] actions The ActionSet to edit.
+     */
+    virtual void xrule_impl(
+        IronBee::Transaction tx,
+        ActionSet&           actions
+    );
+};
 
 #endif /* __MODULES__XRULES_ACLS_HPP */
@@ -284,6 +284,14 @@ void Call::recalculate_s() const
 
 void Call::reset_s() const
 {
+    // If not calculated, neither are any ancestors: every change resets
+    // all ancestors and a node is only calculated after its children.
+    // Stopping here keeps resets linear rather than following every path
+    // through shared ancestors.
+    if (! m_calculated_s) {
+        return;
+    }
+
     BOOST_FOREACH(const weak_node_p& weak_parent, parents()) {
         call_p parent = boost::dynamic_pointer_cast<Call>(
             weak_parent.lock()
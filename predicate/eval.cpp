@@ -53,7 +53,8 @@ static const Value
 NodeEvalState::NodeEvalState() :
     m_forward(NULL),
     m_finished(false),
-    m_phase(IB_PHASE_NONE)
+    m_phase(IB_PHASE_NONE),
+    m_version(0)
 {
     // nop
 }
@@ -91,6 +92,7 @@ void NodeEvalState::forward(const Node* to)
 
     // TODO - srb - can we remove this const cast at some point?
     m_forward = const_cast<Node*>(to);
+    ++m_version;
 }
 
 void NodeEvalState::set_phase(ib_rule_phase_num_t phase)
@@ -131,6 +133,7 @@ void NodeEvalState::setup_local_list(
 
     m_local_values = List<Value>::create(mm);
     m_value = Value::alias_list(mm, name, name_length, m_local_values);
+    ++m_version;
 }
 
 void NodeEvalState::append_to_list(Value value)
@@ -157,6 +160,7 @@ void NodeEvalState::append_to_list(Value value)
         );
     }
     m_local_values.push_back(value);
+    ++m_version;
 }
 
 void NodeEvalState::finish()
@@ -176,6 +180,7 @@ void NodeEvalState::finish()
         );
     }
     m_finished = true;
+    ++m_version;
 }
 
 void NodeEvalState::finish(Value v)
@@ -223,6 +228,7 @@ void NodeEvalState::alias(Value other)
         );
     }
     m_value = other;
+    ++m_version;
 }
 
 void NodeEvalState::finish_true(EvalContext eval_context)
@@ -289,6 +295,7 @@ GraphEvalProfileData* GraphEvalProfileData::parent() const {
 GraphEvalState::GraphEvalState(size_t index_limit):
     m_vector(index_limit),
     m_initialized(index_limit),
+    m_touched(index_limit),
     m_profile(false),
     m_parent_profile_data(NULL)
 {
@@ -336,6 +343,26 @@ bool GraphEvalState::is_finished(const Node* node, EvalContext context)
     return final(node, context).is_finished();
 }
 
+size_t GraphEvalState::version(const Node* node, EvalContext context)
+{
+    size_t version = 0;
+    size_t index = node->index();
+
+    // Every node of the forwarding chain counts, as forwarding changes the
+    // final node.
+    while (m_vector[index].is_forwarding()) {
+        version += m_vector[index].version();
+        node = m_vector[index].forwarded_to();
+        index = node->index();
+    }
+
+    if (!m_initialized[index]) {
+        initialize(node, context);
+    }
+
+    return version + m_vector[index].version();
+}
+
 void GraphEvalState::initialize(const Node* node, EvalContext context)
 {
     /* Protect against double inits. */
@@ -347,6 +374,7 @@ void GraphEvalState::initialize(const Node* node, EvalContext context)
 
     // Mark that this node is being initialized.
     m_initialized.flip(node->index());
+    m_touched.set(node->index());
 
     if (m_profile) {
         GraphEvalProfileData& gpd = profiler_mark(node);
@@ -406,6 +434,23 @@ void GraphEvalState::eval(const Node* node, EvalContext context)
 #endif
 }
 
+void GraphEvalState::reset()
+{
+    // Only visit touched nodes; untouched nodes are still default.
+    for (
+        size_t i = m_touched.find_first();
+        i != boost::dynamic_bitset<>::npos;
+        i = m_touched.find_next(i)
+    ) {
+        m_vector[i] = NodeEvalState();
+    }
+    m_touched.reset();
+    m_initialized.reset();
+
+    profiler_clear();
+    m_parent_profile_data = NULL;
+}
+
 GraphEvalProfileData& GraphEvalState::profiler_mark(const Node* node)
 {
     // Build a data node whose parent is from the prev. call to eval().
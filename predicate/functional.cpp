@@ -55,7 +55,8 @@ namespace Impl {
 #ifndef DOXYGEN_SKIP
 Call::Call(const string& name, const base_p& base) :
     m_base(base),
-    m_name(name)
+    m_name(name),
+    m_prepared(false)
 {
     // nop
 }
@@ -232,28 +233,56 @@ void Call::pre_eval(Environment environment, NodeReporter reporter)
         environment,
         reporter
     );
+
+    m_dynamic_args.clear();
+    dynamic_args(m_dynamic_args);
+    m_prepared = true;
 }
 
-namespace {
+const Call::arg_vec_t& Call::dynamic_args(arg_vec_t& scratch) const
+{
+    if (m_prepared) {
+        return m_dynamic_args;
+    }
+
+    size_t i = 0;
+    BOOST_FOREACH(const node_p& child, children()) {
+        if (! child->is_literal()) {
+            scratch.push_back(make_pair(child.get(), i));
+        }
+        ++i;
+    }
+    return scratch;
+}
 
-typedef pair<const Node*, size_t> arg_with_index_t;
-typedef list<arg_with_index_t> arg_list_t;
+namespace {
 
 struct call_state_t {
-    arg_list_t unfinished;
+    call_state_t() : evaluated(false), args_version(0) {}
+
+    Call::arg_vec_t unfinished;
     boost::any substate;
+    //! Has Base::eval() been called.
+    bool evaluated;
+    //! Sum of argument versions at last Base::eval().
+    size_t args_version;
 };
 typedef boost::shared_ptr<call_state_t> call_state_p;
 
 void eval_args(
-    arg_list_t&     args,
-    const Base&     base,
-    GraphEvalState& graph_eval_state,
-    EvalContext     context
+    Call::arg_vec_t& args,
+    const Base&      base,
+    GraphEvalState&  graph_eval_state,
+    EvalContext      context
 )
 {
-    arg_list_t::iterator iter = args.begin();
-    while (iter != args.end()) {
+    // Unfinished arguments are compacted to the front, in order.
+    Call::arg_vec_t::iterator unfinished = args.begin();
+    for (
+        Call::arg_vec_t::const_iterator iter = args.begin();
+        iter != args.end();
+        ++iter
+    ) {
         const Node* n = iter->first;
         graph_eval_state.eval(n, context);
         NodeEvalState& n_nes = graph_eval_state.final(n, context);
@@ -278,15 +307,13 @@ void eval_args(
                     )
                 );
             }
-
-            arg_list_t::iterator to_remove = iter;
-            ++iter;
-            args.erase(to_remove);
         }
         else {
-            ++iter;
+            *unfinished = *iter;
+            ++unfinished;
         }
     }
+    args.erase(unfinished, args.end());
 }
 
 } // Anonymous
@@ -301,16 +328,11 @@ void Call::eval_initialize(
 
     Predicate::Call::eval_initialize(graph_eval_state, context);
 
-    node_list_t::const_iterator iter;
-    size_t i;
-    for (
-        iter = children().begin(), i = 0;
-        iter != children().end();
-        ++i, ++iter
-    ) {
-        if (! (*iter)->is_literal()) {
-            call_state->unfinished.push_back(make_pair(iter->get(), i));
-        }
+    if (m_prepared) {
+        call_state->unfinished = m_dynamic_args;
+    }
+    else {
+        dynamic_args(call_state->unfinished);
     }
 
     m_base->eval_initialize(
@@ -333,6 +355,19 @@ void Call::eval_calculate(
 
     eval_args(call_state->unfinished, *m_base, graph_eval_state, context);
 
+    // Base::eval() depends only on the arguments and substate, so if no
+    // argument changed since the last call, it would do nothing.
+    size_t args_version = 0;
+    arg_vec_t scratch;
+    BOOST_FOREACH(const arg_with_index_t& arg, dynamic_args(scratch)) {
+        args_version += graph_eval_state.version(arg.first, context);
+    }
+    if (call_state->evaluated && args_version == call_state->args_version) {
+        return;
+    }
+    call_state->evaluated = true;
+    call_state->args_version = args_version;
+
     m_base->eval(
         context.memory_manager(),
         shared_from_this(),
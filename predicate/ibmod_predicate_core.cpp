@@ -71,6 +71,7 @@
 #pragma clang diagnostic pop
 #endif
 #include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
@@ -119,6 +120,12 @@ const char* c_profile_directive = "PredicateProfile";
 //! Directory to write profiling information out to.
 const char* c_profile_directive_dir = "PredicateProfileDir";
 
+//! Directive to aggregate profiling information across transactions.
+const char* c_profile_aggregate_directive = "PredicateProfileAggregate";
+
+//! Name of aggregate profile file in context profile directory.
+const char* c_profile_aggregate_file = "profile_aggregate.txt";
+
 //! Directive to define a template.
 const char* c_define_directive = "PredicateDefine";
 
@@ -128,6 +135,120 @@ const char* c_predicate_add_to_graph = "PredicateAddToGraph";
 class Delegate;
 class PerTransaction;
 
+/**
+ * Profiling data of a context aggregated across transactions.
+ *
+ * For every node, counts evaluations and sums the durations of them.  The
+ * totals are written to a file in the profile directory of the context when
+ * this is destroyed, i.e., when the engine is destroyed.
+ *
+ * This class is thread safe.
+ **/
+class ProfileAggregate :
+    boost::noncopyable
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param[in] index_limit All indices of nodes must be below this.
+     * @param[in] path        File to write totals to.
+     **/
+    ProfileAggregate(size_t index_limit, const boost::filesystem::path& path);
+
+    //! Destructor.  Writes totals; failures are ignored.
+    ~ProfileAggregate();
+
+    /**
+     * Add profiling data of a transaction.
+     *
+     * @param[in] data Profiling data to add.
+     **/
+    void add(const P::GraphEvalState::profiler_data_list_t& data);
+
+    /**
+     * Write totals.
+     *
+     * Writes a line of node index, number of evaluations, total duration
+     * and total self duration (both in microseconds) separated by tabs for
+     * every node evaluated at least once.
+     *
+     * @param[in] out Where to write to.
+     **/
+    void write(ostream& out) const;
+
+private:
+    //! Totals for a single node.
+    struct totals_t
+    {
+        totals_t() : calls(0), duration(0), self_duration(0) {}
+
+        //! Number of evaluations.
+        uint64_t calls;
+        //! Sum of durations in microseconds.
+        uint64_t duration;
+        //! Sum of self durations in microseconds.
+        uint64_t self_duration;
+    };
+
+    //! File to write totals to.
+    const boost::filesystem::path m_path;
+    //! Lock for @ref m_totals.
+    mutable boost::mutex m_mutex;
+    //! Totals by node index.
+    vector<totals_t> m_totals;
+};
+
+/**
+ * Pool of graph evaluation states.
+ *
+ * Constructing a GraphEvalState allocates state for every node of the
+ * graph, which is significant for large graphs.  Instead, states are
+ * acquired from this pool for a transaction and reset() and returned to it
+ * when the transaction is destroyed.  The pool grows to the number of
+ * concurrent transactions and never shrinks.
+ *
+ * This class is thread safe.
+ **/
+class GraphEvalStatePool :
+    boost::noncopyable
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param[in] index_limit All indices of nodes must be below this.
+     **/
+    explicit
+    GraphEvalStatePool(size_t index_limit);
+
+    //! Destructor.  Destroys all states in the pool.
+    ~GraphEvalStatePool();
+
+    /**
+     * Acquire a state.
+     *
+     * @return A state as if newly constructed.  Must be passed to release()
+     *         when done.
+     **/
+    P::GraphEvalState* acquire();
+
+    /**
+     * Reset @a state and return it to the pool.
+     *
+     * @param[in] state State from acquire().
+     **/
+    void release(P::GraphEvalState* state);
+
+private:
+    //! Index limit of all states.
+    const size_t m_index_limit;
+    //! Lock for @ref m_free.
+    boost::mutex m_mutex;
+    //! States available for acquire().
+    vector<P::GraphEvalState*> m_free;
+};
+
 /**
  * Per context functionality.
  *
@@ -224,6 +345,9 @@ public:
     //! Set the directory to write profiling files into.
     void set_profile_dir(const string& dir);
 
+    //! Turn aggregation of profiling information on or off.
+    void set_profile_aggregate(bool enabled);
+
     /**
      * Run internal validations.
      *
@@ -304,6 +428,8 @@ private:
     bool m_profile;
     //! Where should the profiling information be written to?
     string m_profile_to;
+    //! Should profiling information be aggregated across transactions?
+    bool m_profile_aggregate;
 
     //! MergeGraph.  Only valid during configuration, i.e., before close().
     boost::scoped_ptr<P::MergeGraph> m_merge_graph;
@@ -322,6 +448,12 @@ private:
 
     //! A breadth-first traversal of roots.begin() to roots.end().
     traversal_t m_traversal;
+
+    //! Graph evaluation states for transactions of this context.
+    boost::shared_ptr<GraphEvalStatePool> m_graph_eval_state_pool;
+
+    //! Aggregate profiling data; NULL unless aggregating.
+    boost::shared_ptr<ProfileAggregate> m_profile_aggregate_data;
 };
 
 /**
@@ -336,20 +468,26 @@ public:
     /**
      * Constructor.
      *
-     * Initializes graph evaluation state.
+     * Acquires graph evaluation state from @a pool.
      *
-     * @param[in] traversal   The traversal to initialize the nodes by.
+     * @param[in] pool        Pool to acquire graph evaluation state from.
      * @param[in] tx          Transaction this state is for.
      * @param[in] profile     Turn on or off profiling.
      * @param[in] profile_t   Where to write profiling information.
+     * @param[in] aggregate   If non-NULL, add profiling information to this
+     *                        instead of writing it to a file.
      **/
     PerTransaction(
-        const PerContext::traversal_t& traversal,
-        IB::Transaction                tx,
-        bool                           profile,
-        const string&                  profile_to
+        GraphEvalStatePool& pool,
+        IB::Transaction     tx,
+        bool                profile,
+        const string&       profile_to,
+        ProfileAggregate*   aggregate
     );
 
+    //! Destructor.  Returns graph evaluation state to the pool.
+    ~PerTransaction();
+
     /**
      * Query a root.
      *
@@ -383,17 +521,25 @@ public:
         return m_profile_to;
     }
 
-    //! Write out the eval graph's current profiling information.
+    /**
+     * Write out the eval graph's current profiling information.
+     *
+     * If aggregating, adds it to the aggregate instead.
+     **/
     void write_profile_file();
 private:
+    //! Pool @ref m_graph_eval_state came from.
+    GraphEvalStatePool& m_pool;
     //! Graph evaluation state.
-    P::GraphEvalState m_graph_eval_state;
+    P::GraphEvalState& m_graph_eval_state;
     //! Current transaction.
     IB::Transaction m_tx;
     //! Enable/disable profiling.
     bool m_profile;
     //! Directory that we will product profiling data into.
     const string& m_profile_to;
+    //! Aggregate to add profiling data to; NULL if not aggregating.
+    ProfileAggregate* m_profile_aggregate;
 };
 
 /**
@@ -488,6 +634,17 @@ private:
         const char*              to
     ) const;
 
+    /**
+     * Handle @ref c_profile_aggregate_directive.
+     *
+     * @param[in] cp      Configuration parser.
+     * @param[in] enabled Turn aggregation on or off. Default is off.
+     **/
+    void dir_profile_aggregate(
+        IB::ConfigurationParser& cp,
+        const bool               enabled
+    ) const;
+
     /**
      * Handle @ref c_define_directive.
      *
@@ -568,6 +725,100 @@ IBPP_BOOTSTRAP_MODULE_DELEGATE(c_module_name, Delegate);
 // Implementation
 namespace {
 
+// GraphEvalStatePool
+
+GraphEvalStatePool::GraphEvalStatePool(size_t index_limit) :
+    m_index_limit(index_limit)
+{
+    // nop
+}
+
+GraphEvalStatePool::~GraphEvalStatePool()
+{
+    BOOST_FOREACH(P::GraphEvalState* state, m_free) {
+        delete state;
+    }
+}
+
+P::GraphEvalState* GraphEvalStatePool::acquire()
+{
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        if (! m_free.empty()) {
+            P::GraphEvalState* state = m_free.back();
+            m_free.pop_back();
+            return state;
+        }
+    }
+
+    return new P::GraphEvalState(m_index_limit);
+}
+
+void GraphEvalStatePool::release(P::GraphEvalState* state)
+{
+    // Reset outside of the lock; it is the expensive part.
+    state->reset();
+
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_free.push_back(state);
+}
+
+// ProfileAggregate
+
+ProfileAggregate::ProfileAggregate(
+    size_t                         index_limit,
+    const boost::filesystem::path& path
+) :
+    m_path(path),
+    m_totals(index_limit)
+{
+    // nop
+}
+
+ProfileAggregate::~ProfileAggregate()
+{
+    try {
+        boost::filesystem::create_directories(m_path.parent_path());
+        std::ofstream out(
+            m_path.string().c_str(),
+            std::ofstream::trunc
+        );
+        write(out);
+    }
+    catch (...) {
+        // Destructors must not throw; nothing else to do.
+    }
+}
+
+void ProfileAggregate::add(
+    const P::GraphEvalState::profiler_data_list_t& data
+)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    BOOST_FOREACH(const P::GraphEvalProfileData& record, data) {
+        assert(record.node_id() < m_totals.size());
+        totals_t& totals = m_totals[record.node_id()];
+        ++totals.calls;
+        totals.duration += record.duration();
+        totals.self_duration += record.self_duration();
+    }
+}
+
+void ProfileAggregate::write(ostream& out) const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    for (size_t i = 0; i < m_totals.size(); ++i) {
+        const totals_t& totals = m_totals[i];
+        if (totals.calls == 0) {
+            continue;
+        }
+        out << i << "\t" << totals.calls << "\t" << totals.duration << "\t"
+            << totals.self_duration << "\n";
+    }
+}
+
 // PerContext
 
 PerContext::PerContext(Delegate& delegate) :
@@ -575,6 +826,7 @@ PerContext::PerContext(Delegate& delegate) :
     m_write_debug_report(false),
     m_profile(false),
     m_profile_to("/tmp"),
+    m_profile_aggregate(false),
     m_merge_graph(new P::MergeGraph())
 {
     // nop
@@ -588,6 +840,7 @@ PerContext::PerContext(const PerContext& other) :
     m_debug_report_to(other.m_debug_report_to),
     m_profile(other.m_profile),
     m_profile_to(other.m_profile_to),
+    m_profile_aggregate(other.m_profile_aggregate),
     m_merge_graph(
         new P::MergeGraph(*other.m_merge_graph, m_delegate.call_factory())
     )
@@ -639,6 +892,17 @@ void PerContext::close(IB::Context context)
     // Drop configuration data.
     m_merge_graph.reset();
 
+    m_graph_eval_state_pool =
+        boost::make_shared<GraphEvalStatePool>(m_traversal.size());
+
+    if (m_profile && m_profile_aggregate) {
+        m_profile_aggregate_data = boost::make_shared<ProfileAggregate>(
+            m_traversal.size(),
+            boost::filesystem::path(m_profile_to) /
+                context.name() / c_profile_aggregate_file
+        );
+    }
+
     if (m_profile) {
         write_profile_descr_file(context, roots, m_traversal);
     }
@@ -943,7 +1207,10 @@ PerTransaction& PerContext::fetch_per_transaction(IB::Transaction tx) const
     // If failure, initialize px, schedule its destruction and store it.
     if (!px) {
         // Create px.
-        px = new PerTransaction(m_traversal, tx, m_profile, m_profile_to);
+        px = new PerTransaction(
+            *m_graph_eval_state_pool, tx, m_profile, m_profile_to,
+            m_profile_aggregate_data.get()
+        );
 
         // Schedule px to be destroyed with this tx.
         tx.memory_manager().register_cleanup(
@@ -982,6 +1249,11 @@ void PerContext::set_profile_dir(const string& to)
     m_profile_to = to;
 }
 
+void PerContext::set_profile_aggregate(bool enabled)
+{
+    m_profile_aggregate = enabled;
+}
+
 const Delegate& PerContext::delegate() const
 {
     return m_delegate;
@@ -995,25 +1267,39 @@ Delegate& PerContext::delegate()
 // PerTransaction
 
 PerTransaction::PerTransaction(
-    const PerContext::traversal_t&  traversal,
-    IB::Transaction                 tx,
-    bool                            profile,
-    const string&                   profile_to
+    GraphEvalStatePool& pool,
+    IB::Transaction     tx,
+    bool                profile,
+    const string&       profile_to,
+    ProfileAggregate*   aggregate
 ) :
-    m_graph_eval_state(traversal.size()),
+    m_pool(pool),
+    m_graph_eval_state(*pool.acquire()),
     m_tx(tx),
     m_profile(profile),
-    m_profile_to(profile_to)
+    m_profile_to(profile_to),
+    m_profile_aggregate(aggregate)
 {
     m_graph_eval_state.profiler_enabled(m_profile);
 }
 
+PerTransaction::~PerTransaction()
+{
+    m_pool.release(&m_graph_eval_state);
+}
+
 void PerTransaction::write_profile_file()
 {
     if (!m_profile) {
         return;
     }
 
+    if (m_profile_aggregate) {
+        m_profile_aggregate->add(m_graph_eval_state.profiler_data());
+        m_graph_eval_state.profiler_clear();
+        return;
+    }
+
     boost::filesystem::path profile_file(m_profile_to);
 
     // Append context name.
@@ -1130,6 +1416,10 @@ Delegate::Delegate(IB::Module module) :
             c_profile_directive_dir,
             bind(&Delegate::dir_profile_dir, this, _1, _3)
         )
+        .on_off(
+            c_profile_aggregate_directive,
+            bind(&Delegate::dir_profile_aggregate, this, _1, _3)
+        )
         .list(
             c_define_directive,
             bind(&Delegate::dir_define, this, _1, _3)
@@ -1230,6 +1520,14 @@ void Delegate::dir_profile_dir(
     fetch_per_context(cp.current_context()).set_profile_dir(to);
 }
 
+void Delegate::dir_profile_aggregate(
+    IB::ConfigurationParser& cp,
+    const bool               enable
+) const
+{
+    fetch_per_context(cp.current_context()).set_profile_aggregate(enable);
+}
+
 void Delegate::dir_define(
     IB::ConfigurationParser& cp,
     IB::List<const char*>    params
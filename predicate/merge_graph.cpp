@@ -27,7 +27,6 @@
 #include <ironbee/predicate/bfs.hpp>
 #include <ironbee/predicate/call_factory.hpp>
 #include <ironbee/predicate/dot.hpp>
-#include <ironbee/predicate/tree_copy.hpp>
 
 #ifdef __clang__
 #pragma clang diagnostic push
@@ -54,19 +53,74 @@ MergeGraph::MergeGraph()
     // nop
 }
 
-MergeGraph::MergeGraph(const MergeGraph& other, CallFactory call_factory)
+namespace {
+
+//! Map of node to its copy.
+typedef map<const Node*, node_p> copies_t;
+
+/**
+ * Copy the DAG at @a source, sharing nodes already in @a copies.
+ *
+ * Unlike tree_copy(), shared subexpressions are copied once and stay
+ * shared.
+ *
+ * @param[in]     source  Root of DAG to copy.
+ * @param[in]     factory Call factory that knows about all calls in @a source.
+ * @param[in,out] copies  Nodes copied so far; updated with new copies.
+ * @return Copy of @a source.
+ **/
+node_p dag_copy(
+    const node_cp&     source,
+    const CallFactory& factory,
+    copies_t&          copies
+)
 {
-    for (size_t index = 0; index < other.m_roots.size(); ++index) {
-        const node_p& root = other.m_roots[index];
-        node_p root_copy = tree_copy(root, call_factory);
-        size_t new_index = add_root(root_copy);
-        assert(new_index == index);
-        if (new_index != index) {
-            BOOST_THROW_EXCEPTION(
-                std::invalid_argument("index must equal new_index")
-            );
+    copies_t::const_iterator i = copies.find(source.get());
+    if (i != copies.end()) {
+        return i->second;
+    }
+
+    node_p destination;
+    if (source->is_literal()) {
+        const Literal& l = *dynamic_cast<const Literal*>(source.get());
+
+        if (l.literal_value()) {
+            destination.reset(new Literal(l.literal_value()));
+        }
+        else {
+            destination.reset(new Literal());
         }
     }
+    else {
+        destination = factory(dynamic_cast<const Call&>(*source).name());
+    }
+
+    BOOST_FOREACH(const node_p& child, source->children()) {
+        destination->add_child(dag_copy(child, factory, copies));
+    }
+
+    copies.insert(make_pair(source.get(), destination));
+    return destination;
+}
+
+}
+
+MergeGraph::MergeGraph(const MergeGraph& other, CallFactory call_factory)
+{
+    // As other is merged and the copy preserves sharing, the copy is also
+    // merged and every node can be learned directly, rather than adding
+    // independent tree copies of every root and merging them again.
+    copies_t copies;
+    m_roots.reserve(other.m_roots.size());
+    BOOST_FOREACH(const node_p& root, other.m_roots) {
+        node_p root_copy = dag_copy(root, call_factory, copies);
+        m_root_indices[root_copy].insert(m_roots.size());
+        m_roots.push_back(root_copy);
+    }
+    BOOST_FOREACH(copies_t::const_reference v, copies) {
+        learn(v.second);
+    }
+
     BOOST_FOREACH(origins_t::const_reference v, other.m_origins) {
         BOOST_FOREACH(
             const string& origin,
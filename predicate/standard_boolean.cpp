@@ -36,6 +36,9 @@
 
 #include <boost/foreach.hpp>
 
+#include <algorithm>
+#include <set>
+
 using namespace std;
 
 namespace IronBee {
@@ -79,11 +82,117 @@ public:
     }
 };
 
+//! Costs above this are not distinguished.
+const size_t c_max_cost = 256;
+
+/**
+ * Estimate cost of evaluating @a node.
+ *
+ * The estimate is the number of distinct non-literal nodes in the subgraph
+ * of @a node, up to @ref c_max_cost.
+ *
+ * @param[in] node Node to estimate cost of.
+ * @return Estimated cost.
+ **/
+size_t estimate_cost(const Node* node)
+{
+    set<const Node*> seen;
+    vector<const Node*> todo(1, node);
+
+    while (! todo.empty() && seen.size() < c_max_cost) {
+        const Node* current = todo.back();
+        todo.pop_back();
+        if (current->is_literal() || ! seen.insert(current).second) {
+            continue;
+        }
+        BOOST_FOREACH(const node_p& child, current->children()) {
+            todo.push_back(child.get());
+        }
+    }
+
+    return seen.size();
+}
+
+//! Child and its estimated cost.
+typedef pair<size_t, const Node*> costed_node_t;
+
+//! Order by cost only, so that sorting is stable against canonical order.
+bool cost_before(const costed_node_t& a, const costed_node_t& b)
+{
+    return a.first < b.first;
+}
+
+/**
+ * Abelian call that evaluates children cheapest first.
+ *
+ * As the value of an abelian call does not depend on the order of its
+ * children, subclasses that can finish before evaluating all children may
+ * evaluate them in any order.  This class orders children by estimate_cost()
+ * at pre-evaluation, so that cheap children get a chance to finish the call
+ * before expensive ones are evaluated.
+ **/
+class CostOrderedCall :
+    public AbelianCall
+{
+public:
+    /**
+     * See Node::pre_eval().
+     *
+     * Orders children by estimated cost.
+     **/
+    virtual void pre_eval(Environment environment, NodeReporter reporter);
+
+protected:
+    //! Type of eval_order().
+    typedef vector<const Node*> eval_order_t;
+
+    /**
+     * Children in evaluation order.
+     *
+     * @param[out] order Filled with children if pre_eval() has not run.
+     * @return Children, cheapest first; or @a order if pre_eval() has not
+     *         run.
+     **/
+    const eval_order_t& eval_order(eval_order_t& order) const;
+
+private:
+    //! Children ordered by estimated cost.
+    eval_order_t m_eval_order;
+};
+
+void CostOrderedCall::pre_eval(Environment environment, NodeReporter reporter)
+{
+    vector<costed_node_t> costed;
+    BOOST_FOREACH(const node_p& child, children()) {
+        costed.push_back(make_pair(estimate_cost(child.get()), child.get()));
+    }
+    stable_sort(costed.begin(), costed.end(), cost_before);
+
+    m_eval_order.clear();
+    BOOST_FOREACH(const costed_node_t& child, costed) {
+        m_eval_order.push_back(child.second);
+    }
+}
+
+const CostOrderedCall::eval_order_t& CostOrderedCall::eval_order(
+    eval_order_t& order
+) const
+{
+    if (m_eval_order.size() == children().size()) {
+        return m_eval_order;
+    }
+
+    BOOST_FOREACH(const node_p& child, children()) {
+        order.push_back(child.get());
+    }
+    return order;
+}
+
 /**
  * True iff any children are truthy.
  **/
 class Or :
-    public AbelianCall
+    public CostOrderedCall
 {
 public:
     //! See Call::name()
@@ -116,7 +225,7 @@ public:
  * True iff all children are truthy.
  **/
 class And :
-    public AbelianCall
+    public CostOrderedCall
 {
 public:
     //! See Call::name()
@@ -288,8 +397,8 @@ void Or::eval_calculate(
     assert(children().size() >= 2);
     NodeEvalState& my_state = graph_eval_state.node_eval_state(this, context);
     bool unfinished_child = false;
-    BOOST_FOREACH(const node_p& childp, children()) {
-        Node *child = childp.get();
+    eval_order_t order;
+    BOOST_FOREACH(const Node* child, eval_order(order)) {
         graph_eval_state.eval(child, context);
         NodeEvalState& child_nes = graph_eval_state.final(child, context);
         if (child_nes.value()) {
@@ -368,8 +477,8 @@ void And::eval_calculate(
     assert(children().size() >= 2);
     NodeEvalState& my_state = graph_eval_state.node_eval_state(this, context);
     bool unfinished_child = false;
-    BOOST_FOREACH(const node_p& childp, children()) {
-        const Node* child = childp.get();
+    eval_order_t order;
+    BOOST_FOREACH(const Node* child, eval_order(order)) {
         graph_eval_state.eval(child, context);
         NodeEvalState& nes = graph_eval_state.final(child, context);
         if (nes.is_finished() && ! nes.value()) {
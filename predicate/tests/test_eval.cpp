@@ -227,3 +227,87 @@ TEST_F(TestEval, GraphEvalState)
     EXPECT_TRUE(ges.index_final(n3->index()).is_finished());
     EXPECT_TRUE(ges.index_final(n4->index()).is_finished());
 }
+
+TEST_F(TestEval, GraphEvalState_Reset)
+{
+    node_p n0(new Literal);
+    node_p n1(new Literal("Hello World"));
+
+    n0->set_index(0);
+    n1->set_index(1);
+
+    GraphEvalState ges(2);
+    ges.node_eval_state(0).forward(n1.get());
+    ges.node_eval_state(0).state() = 5;
+    ges.eval(n0.get(), m_transaction);
+
+    EXPECT_TRUE(ges.index_final(n0->index()).is_finished());
+    EXPECT_EQ("'Hello World'", ges.value(n0.get(), m_transaction).to_s());
+
+    ges.reset();
+
+    for (size_t i = 0; i < 2; ++i) {
+        NodeEvalState& nes = ges.node_eval_state(i);
+        EXPECT_FALSE(nes.is_finished());
+        EXPECT_FALSE(nes.is_forwarding());
+        EXPECT_FALSE(nes.value());
+        EXPECT_EQ(IB_PHASE_NONE, nes.phase());
+        EXPECT_TRUE(nes.state().empty());
+    }
+
+    // And usable again.
+    ges.eval(n1.get(), m_transaction);
+    EXPECT_TRUE(ges.is_finished(n1.get(), m_transaction));
+    EXPECT_EQ("'Hello World'", ges.value(n1.get(), m_transaction).to_s());
+}
+
+TEST_F(TestEval, NodeEvalState_Version)
+{
+    NodeEvalState nes;
+    size_t version = nes.version();
+
+    nes.setup_local_list(m_transaction.memory_manager());
+    EXPECT_LT(version, nes.version());
+    version = nes.version();
+
+    nes.setup_local_list(m_transaction.memory_manager());
+    EXPECT_EQ(version, nes.version());
+
+    nes.append_to_list(Value());
+    EXPECT_LT(version, nes.version());
+    version = nes.version();
+
+    nes.state() = 5;
+    nes.set_phase(IB_PHASE_REQUEST);
+    EXPECT_EQ(version, nes.version());
+
+    nes.finish();
+    EXPECT_LT(version, nes.version());
+}
+
+TEST_F(TestEval, GraphEvalState_Version)
+{
+    node_p n0(new Literal);
+    node_p n1(new Literal("Hello World"));
+
+    n0->set_index(0);
+    n1->set_index(1);
+
+    GraphEvalState ges(2);
+    ges.node_eval_state(0).setup_local_list(m_transaction.memory_manager());
+    size_t version = ges.version(n0.get(), m_transaction);
+
+    ges.node_eval_state(0).append_to_list(Value());
+    EXPECT_LT(version, ges.version(n0.get(), m_transaction));
+    version = ges.version(n0.get(), m_transaction);
+    EXPECT_EQ(version, ges.version(n0.get(), m_transaction));
+
+    GraphEvalState forwarding(2);
+    version = forwarding.version(n0.get(), m_transaction);
+    forwarding.node_eval_state(0).forward(n1.get());
+    EXPECT_LT(version, forwarding.version(n0.get(), m_transaction));
+    EXPECT_LT(
+        forwarding.version(n1.get(), m_transaction),
+        forwarding.version(n0.get(), m_transaction)
+    );
+}
@@ -104,6 +104,35 @@ TEST_F(TestMergeGraph, Copy)
     EXPECT_TRUE(g2.write_validation_report(cerr));
 }
 
+TEST_F(TestMergeGraph, CopyShared)
+{
+    node_p n = parse("(A (B (C)) (C))");
+    node_p m = parse("(B (C))");
+    MergeGraph g;
+    size_t n_i = 0;
+    size_t m_i = 0;
+
+    EXPECT_NO_THROW(n_i = g.add_root(n));
+    EXPECT_NO_THROW(m_i = g.add_root(m));
+
+    MergeGraph g2(g, factory());
+
+    EXPECT_EQ(g.root(n_i)->to_s(), g2.root(n_i)->to_s());
+    EXPECT_EQ(g.root(m_i)->to_s(), g2.root(m_i)->to_s());
+    EXPECT_EQ(3UL, num_descendants(g2.root(n_i)));
+
+    // Root m is a subexpression of n in the copy as in the original.
+    const node_p& copy_n = g2.root(n_i);
+    EXPECT_EQ(g2.root(m_i), copy_n->children().front());
+    EXPECT_EQ(
+        copy_n->children().front()->children().front(),
+        copy_n->children().back()
+    );
+    EXPECT_EQ(m_i, *g2.root_indices(m).begin());
+
+    EXPECT_TRUE(g2.write_validation_report(cerr));
+}
+
 TEST_F(TestMergeGraph, MultipleRoots)
 {
     MergeGraph g;
@@ -28,6 +28,36 @@
 using namespace IronBee::Predicate;
 using namespace std;
 
+namespace {
+
+//! True call that counts its calculations.
+class Counted : public Call
+{
+public:
+    //! Number of calculations by any Counted.
+    static size_t s_calculations;
+
+    virtual const string& name() const
+    {
+        static const string c_name("counted");
+        return c_name;
+    }
+
+protected:
+    virtual void eval_calculate(
+        GraphEvalState& graph_eval_state,
+        EvalContext     context
+    ) const
+    {
+        ++s_calculations;
+        graph_eval_state.node_eval_state(this, context).finish_true(context);
+    }
+};
+
+size_t Counted::s_calculations = 0;
+
+}
+
 class TestStandardBoolean :
     public StandardTest
 {
@@ -37,6 +67,8 @@ protected:
         Standard::load_boolean(factory());
         factory().add("A", &create);
         factory().add("B", &create);
+        factory().add<Counted>();
+        Counted::s_calculations = 0;
     }
 };
 
@@ -96,6 +128,25 @@ TEST_F(TestStandardBoolean, And)
     EXPECT_EQ("''", transform("(and 'foo' 'bar')"));
 }
 
+TEST_F(TestStandardBoolean, CostOrder)
+{
+    // Cheaper children are evaluated first and finish the call.
+    EXPECT_EQ(":", eval("(and (counted (counted)) (A))"));
+    EXPECT_EQ(0UL, Counted::s_calculations);
+    EXPECT_EQ("''", eval("(or (counted (counted)) (true))"));
+    EXPECT_EQ(0UL, Counted::s_calculations);
+
+    // Result does not depend on order.
+    EXPECT_EQ("''", eval("(and (counted (counted)) (true))"));
+    EXPECT_EQ(1UL, Counted::s_calculations);
+    EXPECT_EQ("''", eval("(or (counted (counted)) (A))"));
+    EXPECT_EQ(2UL, Counted::s_calculations);
+
+    // Short-circuiting calls keep their order.
+    EXPECT_EQ(":", eval("(andSC (counted) (A))"));
+    EXPECT_EQ(3UL, Counted::s_calculations);
+}
+
 TEST_F(TestStandardBoolean, DeMorgan)
 {
     EXPECT_EQ(
@@ -36,12 +36,16 @@
 #pragma clang diagnostic pop
 #endif
 #include <boost/foreach.hpp>
+#include <boost/static_assert.hpp>
 
 using namespace std;
 
 namespace IronBee {
 namespace Predicate {
 
+// Lists of values store values as field pointers.
+BOOST_STATIC_ASSERT(sizeof(Value) == sizeof(Value::ib_type));
+
 Value::Value() :
   m_field(NULL)
 {
@@ -152,17 +156,9 @@ Value Value::dup(
     }
 }
 
-Value::operator unspecified_bool_type() const
-{
-    return (
-        m_field &&
-        (type() != LIST || ! as_list().empty())
-    ) ? unspecified_bool : NULL;
-}
-
-bool Value::is_null() const
+bool Value::list_is_nonempty() const
 {
-    return ! m_field;
+    return ! as_list().empty();
 }
 
 namespace {
@@ -224,21 +220,6 @@ ConstList<Value> Value::as_list() const
     return m_field.value_as_list<Value>();
 }
 
-const char* Value::name() const
-{
-    return m_field.name();
-}
-
-size_t Value::name_length() const
-{
-    return m_field.name_length();
-}
-
-Value::type_e Value::type() const
-{
-    return static_cast<type_e>(m_field.type());
-}
-
 ostream& operator<<(ostream& o, const Value& v)
 {
     o << v.to_s();
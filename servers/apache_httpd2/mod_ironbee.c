@@ -101,6 +101,7 @@ typedef struct ironbee_req_ctx {
 } ironbee_req_ctx;
 typedef struct ironbee_filter_ctx {
     apr_bucket_brigade *buffer;
+    apr_off_t buffered;           /* Length of data in buffer */
     apr_off_t buf_limit;
     bool eos_sent;
 } ironbee_filter_ctx;
@@ -480,6 +481,11 @@ static int ironbee_headers_in(request_rec *r)
                                   apr_pool_cleanup_null);
         ap_set_module_config(r->request_config, &ironbee_module, ctx);
         ctx->r = r;
+
+        /* Drain connections on a replaced engine, so it can be destroyed. */
+        if (ib_manager_engine_retired(module_data.ib_manager, iconn->ib)) {
+            r->connection->keepalive = AP_CONN_CLOSE;
+        }
     }
 
     /* We act either early or late, according to config.
@@ -710,6 +716,45 @@ header_filter_cleanup:
     return ap_pass_brigade(nextf, bb);
 }
 
+/**
+ * Read a response data bucket and feed it to Ironbee.
+ *
+ * File buckets are mapped and fed from the mapping, so that the bucket
+ * remains a file bucket that the core can send with sendfile, rather
+ * than being read into heap buckets.  Other buckets are read in place.
+ *
+ * @param[in] r - the request
+ * @param[in] tx - the Ironbee transaction
+ * @param[in] b - the bucket
+ * @return number of bytes fed
+ */
+static apr_size_t ironbee_notify_response_bucket(request_rec *r,
+                                                 ib_tx_t *tx,
+                                                 apr_bucket *b)
+{
+    const char *buf;
+    apr_size_t buf_len;
+
+#if APR_HAS_MMAP
+    if (APR_BUCKET_IS_FILE(b) && b->length > 0) {
+        apr_bucket_file *fb = b->data;
+        apr_mmap_t *mm;
+        if (fb->can_mmap &&
+            apr_mmap_create(&mm, fb->fd, b->start, b->length,
+                            APR_MMAP_READ, r->pool) == APR_SUCCESS) {
+            ib_state_notify_response_body_data(tx->ib, tx,
+                                               mm->mm, b->length);
+            apr_mmap_delete(mm);
+            return b->length;
+        }
+    }
+#endif
+
+    apr_bucket_read(b, &buf, &buf_len, APR_BLOCK_READ);
+    ib_state_notify_response_body_data(tx->ib, tx, buf, buf_len);
+    return buf_len;
+}
+
 /**
  * HTTPD filter function to notify Ironbee of Response data,
  * and buffer data if required by Ironbee
@@ -728,8 +773,6 @@ static apr_status_t ironbee_filter_out(ap_filter_t *f, apr_bucket_brigade *bb)
     int growing = 0;
     apr_bucket *b;
     apr_bucket *bnext;
-    const char *buf;
-    size_t buf_len;
     apr_off_t buffered;
     apr_bucket_brigade *bbtemp;
     ironbee_req_ctx *rctx = ap_get_module_config(f->r->request_config,
@@ -802,9 +845,7 @@ static apr_status_t ironbee_filter_out(ap_filter_t *f, apr_bucket_brigade *bb)
 
         /* Now read the bucket and feed to ironbee */
         growing = (b->length == (apr_size_t)-1) ? 1 : growing;
-        apr_bucket_read(b, &buf, &buf_len, APR_BLOCK_READ);
-        bytecount += buf_len;
-        ib_state_notify_response_body_data(rctx->tx->ib, rctx->tx, buf, buf_len);
+        bytecount += ironbee_notify_response_bucket(f->r, rctx->tx, b);
 
         /* If Ironbee just signalled an error, switch to discard data mode,
          * dump anything we already have buffered,
@@ -818,6 +859,7 @@ static apr_status_t ironbee_filter_out(ap_filter_t *f, apr_bucket_brigade *bb)
              (rctx->output_buffering != IOBUF_DISCARD) ) {
             if (rctx->output_buffering != IOBUF_NOBUF) {
                 apr_brigade_cleanup(ctx->buffer);
+                ctx->buffered = 0;
             }
             rctx->output_buffering = IOBUF_DISCARD;
             APR_BRIGADE_INSERT_TAIL(ctx->buffer,
@@ -845,14 +887,10 @@ setaside_output:
             apr_bucket_setaside(b, f->r->pool);
             APR_BUCKET_REMOVE(b);
             APR_BRIGADE_INSERT_TAIL(ctx->buffer, b);
-            /* get the length */
-            rc = apr_brigade_length(ctx->buffer, 1, &buffered);
-            /* failure here should be a can't-happen, because these buckets
-             * have already been read and any read errors handled
-             */
-            ap_assert(rc == APR_SUCCESS);
+            /* Data buckets have already been read, so have a length */
+            ctx->buffered += b->length;
             bbtemp = NULL;
-            while (buffered > ctx->buf_limit) {
+            while (ctx->buffered > ctx->buf_limit) {
                 /* pass first bucket down chain until buffer size below limit */
                 b = APR_BRIGADE_FIRST(ctx->buffer);
                 APR_BUCKET_REMOVE(b);
@@ -860,8 +898,7 @@ setaside_output:
                     bbtemp = apr_brigade_create(f->r->pool, f->c->bucket_alloc);
                 }
                 APR_BRIGADE_INSERT_TAIL(bbtemp, b);
-                rc = apr_brigade_length(ctx->buffer, 1, &buffered);
-                ap_assert(rc == APR_SUCCESS);
+                ctx->buffered -= b->length;
             }
             if (bbtemp != NULL) {
                 APR_BRIGADE_INSERT_TAIL(bbtemp,
@@ -876,11 +913,7 @@ setaside_output:
             }
             break;
           case IOBUF_BUFFER_FLUSHALL:
-            rc = apr_brigade_length(ctx->buffer, 1, &buffered);
-            /* failure here should be a can't-happen, because these buckets
-             * have already been read and any read errors handled
-             */
-            ap_assert(rc == APR_SUCCESS);
+            buffered = ctx->buffered;
             /* Flush what we have if this would take us over the limit
              * EXCEPT if this alone would also take us over the limit,
              * then we add it before flushing.
@@ -896,11 +929,13 @@ setaside_output:
                       "Ironbee: downstream returned %d", rc);
                 }
                 apr_brigade_cleanup(ctx->buffer);
+                ctx->buffered = 0;
             }
             /* buffer the new data */
             apr_bucket_setaside(b, f->r->pool);
             APR_BUCKET_REMOVE(b);
             APR_BRIGADE_INSERT_TAIL(ctx->buffer, b);
+            ctx->buffered += b->length;
 
             /* ... and flush again in the unlikely event we're over
              *     the limit in this bucket alone ... */
@@ -913,6 +948,7 @@ setaside_output:
                           "Ironbee: downstream returned %d", rc);
                 }
                 apr_brigade_cleanup(ctx->buffer);
+                ctx->buffered = 0;
             }
             break;
           default: // bug
@@ -1006,11 +1042,13 @@ static apr_status_t ironbee_filter_in(ap_filter_t *f,
         }
         /* If we're buffering, initialise the buffer */
         ctx->buffer = apr_brigade_create(f->r->pool, f->c->bucket_alloc);
+        ctx->buffered = 0;
         ctx->eos_sent = false;
     }
     else {
         /* Clear any data previously buffered and returned */
         apr_brigade_cleanup(ctx->buffer);
+        ctx->buffered = 0;
     }
 
     /* While we're buffering, loop over all data before returning.
@@ -1056,6 +1094,7 @@ static apr_status_t ironbee_filter_in(ap_filter_t *f,
             if ( (STATUS_IS_ERROR(rctx->status)) &&
                  (rctx->input_buffering != IOBUF_DISCARD) ) {
                 apr_brigade_cleanup(ctx->buffer);
+                ctx->buffered = 0;
                 rctx->input_buffering = IOBUF_DISCARD;
                 rctx->state |= INTERNAL_ERRORDOC;
                 f->r->status = rctx->status;
@@ -1072,14 +1111,12 @@ setaside_input:
                 /* if we're over the buffer limit, break out of
                  * buffering loop so we can return what we have
                  */
+                ctx->buffered += b->length;
                 if (rctx->input_buffering != IOBUF_BUFFER_ALL) {
-                    apr_off_t sz;
-                    rc = apr_brigade_length(ctx->buffer, 1, &sz);
-                    /* failure here should be a can't-happen, because these buckets
-                     * have already been read and any read errors handled
+                    /* Data buckets have already been read, so have a
+                     * length; no need to walk the whole buffer.
                      */
-                    ap_assert(rc == APR_SUCCESS);
-                    buffering = (sz < ctx->buf_limit);
+                    buffering = (ctx->buffered < ctx->buf_limit);
                 }
             }
             else if (rctx->input_buffering == IOBUF_DISCARD) {
@@ -46,8 +46,12 @@ typedef struct ironbee_proc_t {
     ngx_uint_t log_level;
     ngx_flag_t use_ngxib_logger;
     ngx_uint_t max_engines;
+    ngx_str_t thread_pool;
 } ironbee_proc_t;
 
+static char *ngxib_set_thread_pool(ngx_conf_t *cf, ngx_command_t *cmd,
+                                   void *conf);
+
 static ngx_command_t  ngx_ironbee_commands[] =
 {
     {
@@ -86,6 +90,15 @@ static ngx_command_t  ngx_ironbee_commands[] =
         NULL
     },
 
+    {
+        ngx_string("ironbee_thread_pool"),
+        NGX_HTTP_MAIN_CONF|NGX_CONF_TAKE1,
+        ngxib_set_thread_pool,
+        NGX_HTTP_MAIN_CONF_OFFSET,
+        offsetof(ironbee_proc_t, thread_pool),
+        NULL
+    },
+
       ngx_null_command
 };
 
@@ -95,11 +108,42 @@ static ngx_command_t  ngx_ironbee_commands[] =
 static module_data_t module_data =
 {
     NULL,          /* .manager */
+    NULL,          /* .engine_cache */
     0,             /* .active */
     NULL,          /* .log */
     NGX_LOG_INFO,  /* .log_level */
+#ifdef NGXIB_THREADS
+    NULL,          /* .thread_pool */
+#endif
 };
 
+/**
+ * Handler for the ironbee_thread_pool directive.
+ *
+ * The named pool is the one declared by nginx's thread_pool directive.
+ *
+ * @param[in]  cf     Configuration rec
+ * @param[in]  cmd    The directive
+ * @param[in]  conf   Module configuration rec
+ * @return     NGX_CONF_OK or error message
+ */
+static char *ngxib_set_thread_pool(ngx_conf_t *cf, ngx_command_t *cmd,
+                                   void *conf)
+{
+#ifdef NGXIB_THREADS
+    return ngx_conf_set_str_slot(cf, cmd, conf);
+#else
+    return "requires nginx 1.7.11 or later built with --with-threads";
+#endif
+}
+
+#ifdef NGXIB_THREADS
+ngx_thread_pool_t *ngxib_thread_pool(void)
+{
+    return module_data.thread_pool;
+}
+#endif
+
 ib_status_t ngxib_acquire_engine(
     ib_engine_t  **pengine,
     ngx_log_t     *log
@@ -114,7 +158,20 @@ ib_status_t ngxib_acquire_engine(
         return IB_DECLINED;
     }
 
-    rc = ib_manager_engine_acquire(mod_data->manager, IB_MANAGER_ENGINE_NAME_DEFAULT, pengine);
+    /* A worker runs connections on one thread, so it can cache its engine. */
+    if (mod_data->engine_cache == NULL) {
+        rc = ib_manager_engine_cache_create(mod_data->manager,
+                                            IB_MANAGER_ENGINE_NAME_DEFAULT,
+                                            &(mod_data->engine_cache));
+        if (rc != IB_OK) {
+            ngx_log_error(NGX_LOG_ERR, log, 0,
+                          "Failed to create engine cache: %s!",
+                          ib_status_to_string(rc));
+            return rc;
+        }
+    }
+
+    rc = ib_manager_engine_cache_acquire(mod_data->engine_cache, pengine);
     if (rc != IB_OK) {
         ngx_log_error(NGX_LOG_ERR, log, 0,
                       "Failed to acquire engine from manager: %s!",
@@ -131,8 +188,9 @@ ib_status_t ngxib_release_engine(
     module_data_t *mod_data = &module_data;
     ib_status_t    rc;
     assert(mod_data->manager != NULL);
+    assert(mod_data->engine_cache != NULL);
 
-    rc = ib_manager_engine_release(mod_data->manager, engine);
+    rc = ib_manager_engine_cache_release(mod_data->engine_cache, engine);
     if (rc != IB_OK) {
         ngx_log_error(NGX_LOG_ERR, log, 0,
                       "Failed to release engine to manager: %s!",
@@ -721,6 +779,11 @@ static ngx_int_t ironbee_post_read_request(ngx_http_request_t *r)
 
     ib_tx_create(&ctx->tx, iconn, ctx);
 
+    /* Drain connections on a replaced engine, so it can be destroyed. */
+    if (ib_manager_engine_retired(module_data.manager, iconn->ib)) {
+        r->keepalive = 0;
+    }
+
     /* Notify IronBee of request line and headers */
     rc = ib_parsed_req_line_create(&rline, ctx->tx->mm,
                                    (const char*)r->request_line.data,
@@ -808,6 +871,14 @@ static ngx_int_t ironbee_init(ngx_conf_t *cf)
     mod_data->ib_log_active = proc->use_ngxib_logger;
     mod_data->log = cf->log;
     mod_data->log_level = proc->log_level;
+#ifdef NGXIB_THREADS
+    if (proc->thread_pool.len > 0) {
+        mod_data->thread_pool = ngx_thread_pool_add(cf, &proc->thread_pool);
+        if (mod_data->thread_pool == NULL) {
+            cleanup_return NGX_ERROR;
+        }
+    }
+#endif
 
     rc = ib_initialize();
     if (rc != IB_OK) {
@@ -955,6 +1026,8 @@ static void ironbee_exit(ngx_cycle_t *cycle)
 {
     ngx_log_error(NGX_LOG_NOTICE, cycle->log, 0, "ironbee_exit %d", getpid());
     /* FIXME: this fails under gdb */
+    ib_manager_engine_cache_destroy(module_data.engine_cache);
+    module_data.engine_cache = NULL;
     if (module_data.manager != NULL) {
         ib_manager_destroy(module_data.manager);
         module_data.manager = NULL;
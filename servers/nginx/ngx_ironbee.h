@@ -26,11 +26,18 @@
 #define NGXIB_H
 
 #include <ngx_http.h>
+#include <nginx.h>
 #include <ironbee/config.h>
 #include <ironbee/engine_state.h>
 #include <ironbee/engine_types.h>
 #include <ironbee/engine.h>
 
+/* Request bodies can be fed to IronBee on a thread pool (nginx 1.7.11+) */
+#if (NGX_THREADS) && (nginx_version >= 1007011)
+#define NGXIB_THREADS 1
+#include <ngx_thread_pool.h>
+#endif
+
 /* HTTP statuses we'll support when IronBee asks us to return them */
 #define STATUS_IS_ERROR(code) ( ((code) >= 200) && ((code) <  600) )
 
@@ -78,6 +85,7 @@ typedef struct ngxib_req_ctx {
     int edit_flags;               /* Are we editing HTTP payloads? */
     int body_done:1;              /* State flags */
     int body_wait:1;              /* State flags */
+    int body_task:1;              /* State flags */
     int has_request_body:1;       /* State flags */
     int tested_request_body:1;    /* State flags */
     int output_filter_init:1;     /* State flags */
@@ -157,13 +165,27 @@ ngx_int_t ngxib_handler(ngx_http_request_t *r);  /* Handler for Request Data */
 /* new stuff for module */
 typedef struct module_data_t {
     struct ib_manager_t   *manager;      /**< IronBee engine manager object */
+    struct ib_manager_engine_cache_t *engine_cache; /**< Worker's engine */
     int                    ib_log_active;
     ngx_log_t             *log;
     int                    log_level;
+#ifdef NGXIB_THREADS
+    ngx_thread_pool_t     *thread_pool;  /**< Pool to feed bodies on */
+#endif
 } module_data_t;
 
 ib_status_t ngxib_module(ib_module_t**, ib_engine_t*, void*);
 
+#ifdef NGXIB_THREADS
+/**
+ * Thread pool to feed request bodies to IronBee on
+ *
+ * @returns The pool set by ironbee_thread_pool, or NULL to feed
+ *          request bodies in the event loop.
+ */
+ngx_thread_pool_t *ngxib_thread_pool(void);
+#endif
+
 
 /* Return from a function that has set globals, ensuring those
  * globals are tidied up after use.  An ugly but necessary hack.
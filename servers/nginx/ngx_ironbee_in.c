@@ -28,9 +28,14 @@
 
 #include <ironbee/state_notify.h>
 
+#include <sys/mman.h>
+
 /* Buf size for reading from temp file and feeding to IronBee */
 #define BUFSIZE 65536
 
+/* Largest window of a temp file mapped at once for feeding to IronBee */
+#define MAPSIZE (16 * 1024 * 1024)
+
 /**
  * Function to reset processing cycle if input data are not yet available.
  *
@@ -76,26 +81,224 @@ int ngxib_has_request_body(ngx_http_request_t *r, ngxib_req_ctx *ctx)
         return 0;
 }
 
+/**
+ * Feed part of a file to IronBee as request body data.
+ *
+ * The file is mapped and fed in place, a window at a time, so a body
+ * nginx has spooled to a temp file is not copied again.  If it can not
+ * be mapped, it is read through a buffer instead.
+ *
+ * @param[in] ctx   the ngx request ctx for the ironbee module
+ * @param[in] file  the file
+ * @param[in] start offset of the data in the file
+ * @param[in] end   offset of the end of the data in the file
+ */
+static void ngxib_feed_file(ngxib_req_ctx *ctx, ngx_file_t *file,
+                            off_t start, off_t end)
+{
+    u_char buf[BUFSIZE];
+    ssize_t buf_len;
+
+    while (start < end) {
+        /* Mappings must start on a page boundary */
+        off_t base = start - (start % (off_t)ngx_pagesize);
+        size_t len = (end - base > MAPSIZE) ? MAPSIZE : (size_t)(end - base);
+        void *map = mmap(NULL, len, PROT_READ, MAP_SHARED, file->fd, base);
+        if (map == MAP_FAILED) {
+            ib_log_debug_tx(ctx->tx, "Failed to map request body in temp file.");
+            break;
+        }
+        ib_log_debug_tx(ctx->tx, "Feeding %zd bytes request data to ironbee.",
+                        len - (size_t)(start - base));
+        ib_state_notify_request_body_data(ctx->tx->ib, ctx->tx,
+                                          (const char*)map + (start - base),
+                                          len - (size_t)(start - base));
+        munmap(map, len);
+        start = base + len;
+    }
+
+    /* Fall back to reading anything we could not map */
+    while (start < end) {
+        size_t len = (end - start > BUFSIZE) ? BUFSIZE : (size_t)(end - start);
+        buf_len = ngx_read_file(file, buf, len, start);
+        if (buf_len == NGX_ERROR) {
+            ib_log_error_tx(ctx->tx, "Failed to read request body in temp file.");
+            return;
+        }
+        if (buf_len == 0) {
+            return;
+        }
+        ib_log_debug_tx(ctx->tx, "Feeding %zd bytes request data to ironbee.",
+                        buf_len);
+        ib_state_notify_request_body_data(ctx->tx->ib, ctx->tx,
+                                          (const char*)buf, buf_len);
+        start += buf_len;
+    }
+}
+
+/**
+ * Feed a request body to IronBee and notify it the request is finished.
+ *
+ * @param[in] ctx the ngx request ctx for the ironbee module
+ * @param[in] rb  the request body
+ */
+static void ngxib_feed_body(ngxib_req_ctx *ctx, ngx_http_request_body_t *rb)
+{
+    ngx_chain_t *link;
+
+    /* Each link is either in memory, which we feed in place, or
+     * in the temp file the reader has put (some of) the body in.
+     */
+    for (link = rb->bufs; link != NULL; link = link->next) {
+        ngx_buf_t *b = link->buf;
+        if (ngx_buf_in_memory(b)) {
+            size_t len = (b->last - b->pos);
+            ib_log_debug_tx(ctx->tx, "Feeding %zd bytes request data to ironbee.",
+                            len);
+            if (len > 0) {
+                ib_state_notify_request_body_data(ctx->tx->ib, ctx->tx,
+                                                  (const char*)b->pos, len);
+            }
+        }
+        else if (b->in_file && b->file != NULL
+                 && b->file->fd != NGX_INVALID_FILE) {
+            ib_log_debug_tx(ctx->tx, "Reading request body in temp file.");
+            ngxib_feed_file(ctx, b->file, b->file_pos, b->file_last);
+        }
+    }
+    ib_state_notify_request_finished(ctx->tx->ib, ctx->tx);
+}
+
+/**
+ * Determine the handler's return value once the body has been fed.
+ *
+ * @param[in] ctx the ngx request ctx for the ironbee module
+ * @return    NGX_DECLINED or error status if set by IronBee.
+ */
+static ngx_int_t ngxib_body_status(ngxib_req_ctx *ctx)
+{
+    ngx_int_t rv = NGX_DECLINED;
+
+    /* If IronBee signaled an error, we can return it */
+    if (STATUS_IS_ERROR(ctx->status)) {
+        rv = ctx->status;
+        ctx->internal_errordoc = 1;
+        ib_log_error_tx(ctx->tx, "IronBee set %d reading request body.", (int)rv);
+    }
+    return rv;
+}
+
+#ifdef NGXIB_THREADS
+/* Data of a task feeding a request body on the thread pool */
+typedef struct ngxib_body_task_t {
+    ngxib_req_ctx *ctx;
+    ngx_http_request_body_t *rb;
+} ngxib_body_task_t;
+
+/**
+ * Thread pool task to feed a request body to IronBee.
+ *
+ * The request is blocked while this runs, so nothing else touches it.
+ *
+ * @param[in] data the ngxib_body_task_t
+ * @param[in] log  the nginx log
+ */
+static void ngxib_body_thread(void *data, ngx_log_t *log)
+{
+    ngxib_body_task_t *task = data;
+
+    ngxib_feed_body(task->ctx, task->rb);
+}
+
+/**
+ * Event handler to resume request processing once the body is fed.
+ *
+ * @param[in] ev the task's completion event
+ */
+static void ngxib_body_thread_done(ngx_event_t *ev)
+{
+    ngx_http_request_t *r = ev->data;
+    ngx_connection_t *c = r->connection;
+    ngxib_req_ctx *ctx = ngx_http_get_module_ctx(r, ngx_ironbee_module);
+
+    r->main->blocked--;
+    r->aio = 0;
+    ctx->body_done = 1;
+
+    r->write_event_handler(r);
+    ngx_http_run_posted_requests(c);
+}
+
+/**
+ * Post a task to feed a request body on the thread pool.
+ *
+ * @param[in] r    the nginx request object
+ * @param[in] ctx  the ngx request ctx for the ironbee module
+ * @param[in] pool the thread pool
+ * @return    NGX_OK if posted, or NGX_ERROR to feed it here instead.
+ */
+static ngx_int_t ngxib_post_body_task(ngx_http_request_t *r,
+                                      ngxib_req_ctx *ctx,
+                                      ngx_thread_pool_t *pool)
+{
+    ngx_thread_task_t *task;
+    ngxib_body_task_t *data;
+
+    task = ngx_thread_task_alloc(r->pool, sizeof(ngxib_body_task_t));
+    if (task == NULL) {
+        return NGX_ERROR;
+    }
+    data = task->ctx;
+    data->ctx = ctx;
+    data->rb = r->request_body;
+    task->handler = ngxib_body_thread;
+    task->event.handler = ngxib_body_thread_done;
+    task->event.data = r;
+
+    if (ngx_thread_task_post(pool, task) != NGX_OK) {
+        return NGX_ERROR;
+    }
+
+    r->main->blocked++;
+    r->aio = 1;
+    ctx->body_task = 1;
+    return NGX_OK;
+}
+#endif
+
 /**
  * nginx handler to feed request body (if any) to IronBee
  *
+ * If ironbee_thread_pool is set, the body is fed on that pool, so that
+ * inspecting a large body does not hold up other requests in the event
+ * loop, and the handler runs again once it is done.
+ *
  * @param[in] r   the nginx request object
  * @return    NGX_DECLINED for normal operation
- * @return    NGX_DONE if body is not yet available (processing will resume
- *            on new data)
+ * @return    NGX_DONE if body is not yet available or is being fed on the
+ *            thread pool (processing will resume on new data)
  * @return    Error status if set by IronBee on sight of request data.
  */
 ngx_int_t ngxib_handler(ngx_http_request_t *r)
 {
-    ngx_chain_t *link;
     ngxib_req_ctx *ctx;
     ngx_int_t rv = NGX_DECLINED;
     ngx_http_request_body_t *rb;
+#ifdef NGXIB_THREADS
+    ngx_thread_pool_t *pool;
+#endif
     /* Don't process internal requests */
     if (r->internal)
         return rv;
 
     ctx = ngx_http_get_module_ctx(r, ngx_ironbee_module);
+    /* Back from feeding the body on the thread pool */
+    if (ctx->body_task) {
+        if (!ctx->body_done)
+            return NGX_DONE;
+        ctx->body_task = 0;
+        return ngxib_body_status(ctx);
+    }
     if (ctx->body_done)
         return rv;
 
@@ -132,44 +335,20 @@ ngx_int_t ngxib_handler(ngx_http_request_t *r)
         ib_log_error_tx(ctx->tx, "Probable error reading request body.");
     }
 
-    if (rb->temp_file && (rb->temp_file->file.fd != NGX_INVALID_FILE)) {
-        /* Reader has put request body in temp file */
-        off_t count = 0;
-        u_char buf[BUFSIZE];
-        size_t buf_len;
-        ib_log_debug_tx(ctx->tx, "Reading request body in temp file.");
-        while (buf_len = ngx_read_file(&rb->temp_file->file,
-                         buf, BUFSIZE, count),
-               buf_len > 0) {
-            ib_log_debug_tx(ctx->tx, "Feeding %zd bytes request data to ironbee.",
-                            buf_len);
-            ib_state_notify_request_body_data(ctx->tx->ib, ctx->tx,
-                                              (const char*)buf, buf_len);
-            count += buf_len;
-        }
-        if ((int)buf_len == NGX_ERROR) {
-            ib_log_error_tx(ctx->tx, "Failed to read request body in temp file.");
+#ifdef NGXIB_THREADS
+    pool = ngxib_thread_pool();
+    if (pool != NULL) {
+        if (ngxib_post_body_task(r, ctx, pool) == NGX_OK) {
+            ib_log_debug_tx(ctx->tx, "Feeding request body on thread pool.");
+            cleanup_return NGX_DONE;
         }
+        ib_log_notice_tx(ctx->tx,
+                         "Failed to post request body to thread pool.");
     }
+#endif
 
-    for (link = rb->bufs; link != NULL; link = link->next) {
-        size_t len = (link->buf->last - link->buf->pos);
-        ib_log_debug_tx(ctx->tx, "Feeding %zd bytes request data to ironbee.",
-                        len);
-        if (len > 0) {
-            ib_state_notify_request_body_data(ctx->tx->ib, ctx->tx,
-                                              (const char*)link->buf->pos, len);
-        }
-    }
+    ngxib_feed_body(ctx, rb);
     ctx->body_done = 1;
-    ib_state_notify_request_finished(ctx->tx->ib, ctx->tx);
-
-    /* If IronBee signaled an error, we can return it */
-    if (STATUS_IS_ERROR(ctx->status)) {
-        rv = ctx->status;
-        ctx->internal_errordoc = 1;
-        ib_log_error_tx(ctx->tx, "IronBee set %d reading request body.", (int)rv);
-    }
 
-    cleanup_return rv;
+    cleanup_return ngxib_body_status(ctx);
 }
@@ -550,6 +550,11 @@ static void ironbee_plugin_txn_start(TSCont contp, TSHttpTxn txnp)
 
     ++ssndata->txn_count;
 
+    /* Drain sessions on a replaced engine, so that it can be destroyed. */
+    if (tsib_manager_engine_retired(ssndata->iconn->ib)) {
+        TSHttpTxnConfigIntSet(txnp, TS_CONFIG_HTTP_KEEP_ALIVE_ENABLED_IN, 0);
+    }
+
     ib_log_debug2_tx(txndata->tx,
                     "TX CREATE: conn=%p tx=%p id=%s txn_count=%d",
                     ssndata->iconn, txndata->tx, txndata->tx->id,
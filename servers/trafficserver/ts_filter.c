@@ -228,6 +228,22 @@ static ib_status_t buffer_data_chunk(tsib_filter_ctx *fctx, TSIOBufferReader rea
 }
 
 
+/**
+ * Determine whether data can go straight from input to output.
+ *
+ * That is the case when we neither buffer nor have anything buffered
+ * or edits to apply, so flush_data() would only pass the data on.
+ *
+ * @param[in] fctx - the filter data
+ * @return nonzero if data can be passed straight through
+ */
+static int pass_through(const tsib_filter_ctx *fctx)
+{
+    return (fctx->buffering == IOBUF_NOBUF)
+        && (fctx->buffered == 0)
+        && ((fctx->edits == NULL) || (fctx->edits->len == 0));
+}
+
 /**
  * Determine buffering policy from config settings
  *
@@ -312,6 +328,7 @@ static void process_data(TSCont contp, ibd_ctx *ibd)
     TSIOBufferBlock block;
     const char *buf;
     int64_t nbytes;
+    int passed = 0;
     ib_status_t rc;
 
     tsib_filter_ctx *fctx = ibd->data;
@@ -421,7 +438,21 @@ static void process_data(TSCont contp, ibd_ctx *ibd)
         if (rc != IB_OK) {
             ib_log_error_tx(txndata->tx, "Error %d notifying body data.", rc);
         }
-        rc = buffer_data_chunk(fctx, input_reader, nbytes);
+        if (pass_through(fctx)) {
+            /* Move the block straight to output, without going through
+             * our buffer; it's only a refcount.  The output VIO is
+             * reenabled once we've passed all we have.
+             */
+            int64_t copied = TSIOBufferCopy(fctx->output_buffer,
+                                             input_reader, nbytes, 0);
+            assert(copied == nbytes);
+            fctx->bytes_done += copied;
+            passed = 1;
+            rc = IB_OK;
+        }
+        else {
+            rc = buffer_data_chunk(fctx, input_reader, nbytes);
+        }
         switch (rc) {
           case IB_EAGAIN:
           case IB_OK:
@@ -436,6 +467,9 @@ static void process_data(TSCont contp, ibd_ctx *ibd)
         TSIOBufferReaderConsume(input_reader, nbytes);
         TSVIONDoneSet(input_vio, TSVIONDoneGet(input_vio) + nbytes);
     }
+    if (passed) {
+        TSVIOReenable(fctx->output_vio);
+    }
 
     ntodo = TSVIONTodoGet(input_vio);
     if (ntodo == 0) {
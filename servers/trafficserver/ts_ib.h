@@ -34,6 +34,7 @@ ib_status_t tsib_manager_engine_acquire(ib_engine_t**);
 ib_status_t tsib_manager_engine_cleanup(void);
 ib_status_t tsib_manager_engine_create(void);
 ib_status_t tsib_manager_engine_release(ib_engine_t*);
+bool tsib_manager_engine_retired(const ib_engine_t*);
 
 typedef enum {
     HDR_OK,
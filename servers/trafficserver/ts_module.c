@@ -95,11 +95,33 @@ ib_status_t tsib_manager_engine_cleanup(void)
            ? IB_OK
            : ib_manager_engine_cleanup(module_data.manager);
 }
+/**
+ * Report the result of a background engine build.
+ *
+ * @param[in] manager The engine manager.
+ * @param[in] name The engine name.
+ * @param[in] rc Result of the build.
+ * @param[in] cbdata Unused.
+ */
+static void engine_create_done(
+    ib_manager_t *manager,
+    const char   *name,
+    ib_status_t   rc,
+    void         *cbdata
+)
+{
+    if (rc != IB_OK) {
+        TSError("[ironbee] Error creating new engine: %s",
+                ib_status_to_string(rc));
+    }
+}
 ib_status_t tsib_manager_engine_create(void)
 {
+    /* Build in the background so the management thread is not blocked
+     * while the configuration is parsed. */
     return module_data.manager == NULL
            ? IB_EALLOC
-           : ib_manager_engine_create(module_data.manager, IB_MANAGER_ENGINE_NAME_DEFAULT, module_data.config_file);
+           : ib_manager_engine_create_background(module_data.manager, IB_MANAGER_ENGINE_NAME_DEFAULT, module_data.config_file, engine_create_done, NULL);
 }
 ib_status_t tsib_manager_engine_release(ib_engine_t *ib)
 {
@@ -107,6 +129,11 @@ ib_status_t tsib_manager_engine_release(ib_engine_t *ib)
            ? IB_OK
            : ib_manager_engine_release(module_data.manager, ib);
 }
+bool tsib_manager_engine_retired(const ib_engine_t *ib)
+{
+    return module_data.manager != NULL &&
+           ib_manager_engine_retired(module_data.manager, ib);
+}
 /**
  * Engine Manager Control Channel continuation.
  *
@@ -26,15 +26,18 @@
  * This is essentially a two dimensional array storing a pointer to arbitrary
  * data.  The first dimension, the extent index (row), is allocated
  * immediately. The second dimension, the data index (column), is allocated
- * on demand (though the first set is allocated immediately).
+ * in chunks of ninit elements on demand (though the first chunk is
+ * allocated immediately).
  *
- * When data is added, enough extents are allocated to accommodate for the
- * index. If the number of extents required exceeds what is available, then
- * a replacement extents array is allocated, double the size it was
- * previously, the data arrays are copied into the new extents array, and
- * new data arrays are allocated. Because the extents array will expand
- * exponentially, it is important to set ninit/nextents correctly
- * for the task.
+ * When data is added, the chunk holding its index is allocated if it is not
+ * already.  Chunks below the index that were never written stay
+ * unallocated and read as NULL, so a sparse array only pays for the chunks
+ * it uses.  If the index is beyond the extents array, then a replacement
+ * extents array is allocated, doubled in size until the index fits, and the
+ * chunk pointers are copied into it.
+ *
+ * If ninit is a power of 2, as it usually is, indexes are split into chunk
+ * and offset with a shift and mask instead of a division.
  */
 
 #include "ironbee_config_auto.h"
@@ -51,6 +54,8 @@ struct ib_array_t {
     size_t  nelts;
     size_t  size;
     void    *extents;
+    /** log2(ninit) if ninit is a power of 2; otherwise 0. */
+    size_t  shift;
 };
 
 /**
@@ -62,7 +67,7 @@ struct ib_array_t {
  * @returns Extent index where data resides
  */
 #define IB_ARRAY_EXTENT_INDEX(arr, idx) \
-    ((idx) / (arr)->ninit)
+    ((arr)->shift > 0 ? (idx) >> (arr)->shift : (idx) / (arr)->ninit)
 
 /**
  * Calculate the data index from the array and extent indexes for an array.
@@ -97,6 +102,12 @@ ib_status_t ib_array_create(ib_array_t **parr, ib_mm_t mm,
     (*parr)->nextents = nextents;
     (*parr)->nelts = 0;
     (*parr)->size = ninit;
+    (*parr)->shift = 0;
+    if ((ninit & (ninit - 1)) == 0) {
+        while (((size_t)1 << (*parr)->shift) < ninit) {
+            ++(*parr)->shift;
+        }
+    }
 
     /* Create the extents array. */
     (*parr)->extents = (void *)ib_mm_calloc(mm,
@@ -139,8 +150,9 @@ ib_status_t ib_array_get(ib_array_t *arr, size_t idx, void *pval)
     r = IB_ARRAY_EXTENT_INDEX(arr, idx);
     c = IB_ARRAY_DATA_INDEX(arr, idx, r);
 
+    /* Chunks that were never written are not allocated. */
     data = ((void ***)arr->extents)[r];
-    *(void **)pval = data[c];
+    *(void **)pval = (data == NULL) ? NULL : data[c];
 
     return IB_OK;
 }
@@ -150,38 +162,46 @@ ib_status_t ib_array_setn(ib_array_t *arr, size_t idx, void *val)
     size_t r, c;
     void **data;
 
-    /* Keep extending by ninit elements until the index fits in the array. */
-    while (idx >= arr->size) {
-        r = arr->size / arr->ninit;
-
-        /* If this will exceed the max, then reallocate the extents
-         * to double its previous value to make room.
-         */
-        if (r >= arr->nextents) {
-            void *new_extents = (void *)ib_mm_calloc(arr->mm,
-                                                     arr->nextents * 2,
-                                                     sizeof(void *));
-            if (new_extents == NULL) {
-                return IB_EALLOC;
-            }
-            memcpy(new_extents, arr->extents, sizeof(void *) * arr->nextents);
-            arr->extents = new_extents;
-            arr->nextents *= 2;
-        }
-
-        ((void ***)arr->extents)[r] = (void **)ib_mm_calloc(arr->mm,
-            arr->ninit, sizeof(void *)
-        );
-        arr->size += arr->ninit;
-    }
-
     /* Calculate the row/column where the data resides. */
     r = IB_ARRAY_EXTENT_INDEX(arr, idx);
     c = IB_ARRAY_DATA_INDEX(arr, idx, r);
 
+    /* If this will exceed the max, then reallocate the extents, doubling
+     * until there is room.
+     */
+    if (r >= arr->nextents) {
+        size_t nextents = arr->nextents * 2;
+        void *new_extents;
+
+        while (r >= nextents) {
+            nextents *= 2;
+        }
+        new_extents = (void *)ib_mm_calloc(arr->mm,
+                                           nextents,
+                                           sizeof(void *));
+        if (new_extents == NULL) {
+            return IB_EALLOC;
+        }
+        memcpy(new_extents, arr->extents, sizeof(void *) * arr->nextents);
+        arr->extents = new_extents;
+        arr->nextents = nextents;
+    }
+
     data = ((void ***)arr->extents)[r];
+    if (data == NULL) {
+        data = (void **)ib_mm_calloc(arr->mm, arr->ninit, sizeof(void *));
+        if (data == NULL) {
+            return IB_EALLOC;
+        }
+        ((void ***)arr->extents)[r] = data;
+    }
     data[c] = val;
 
+    /* The array extends through the chunk holding the index. */
+    if (idx >= arr->size) {
+        arr->size = (r + 1) * arr->ninit;
+    }
+
     /* Keep track of the number of elements stored. */
     if (idx >= arr->nelts) {
         arr->nelts = idx + 1;
@@ -0,0 +1,236 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Shared Artifact Cache Implementation
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/artifact.h>
+
+#include <ironbee/hash.h>
+#include <ironbee/mm_mpool_lite.h>
+#include <ironbee/mpool_lite.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A cached artifact.
+ *
+ * Entries are allocated with malloc() and hold their own copy of the key:
+ * the kind, a NUL, then the caller's key.
+ */
+typedef struct artifact_entry_t {
+    void                     *artifact;   /**< The artifact. */
+    ib_artifact_destroy_fn_t  destroy_fn; /**< Destroys @a artifact. */
+    size_t                    refs;       /**< Number of references. */
+    size_t                    key_length; /**< Length of @a key. */
+    char                      key[];      /**< Full key. */
+} artifact_entry_t;
+
+/** Protects all globals below. */
+static pthread_mutex_t g_artifact_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Memory pool for @ref g_artifacts.
+ *
+ * Created with the first artifact and destroyed with the last, so that an
+ * idle cache holds no memory.
+ */
+static ib_mpool_lite_t *g_artifact_mp = NULL;
+
+/** Key to artifact_entry_t. */
+static ib_hash_t *g_artifacts = NULL;
+
+/**
+ * Release the reference held by a memory manager.
+ *
+ * @param[in] cbdata The artifact_entry_t.
+ */
+static void artifact_release(void *cbdata)
+{
+    assert(cbdata != NULL);
+
+    artifact_entry_t *entry = (artifact_entry_t *)cbdata;
+
+    pthread_mutex_lock(&g_artifact_lock);
+
+    assert(entry->refs > 0);
+    --(entry->refs);
+    if (entry->refs == 0) {
+        ib_hash_remove_ex(g_artifacts, NULL, entry->key, entry->key_length);
+        entry->destroy_fn(entry->artifact);
+        free(entry);
+
+        if (ib_hash_size(g_artifacts) == 0) {
+            ib_mpool_lite_destroy(g_artifact_mp);
+            g_artifact_mp = NULL;
+            g_artifacts = NULL;
+        }
+    }
+
+    pthread_mutex_unlock(&g_artifact_lock);
+}
+
+/**
+ * Find or create an entry.  The caller must hold @ref g_artifact_lock.
+ *
+ * @param[out] pentry The entry, with a reference taken.
+ * @param[in] full_key Kind, NUL and key.
+ * @param[in] full_key_length Length of @a full_key.
+ * @param[in] create_fn Creates the artifact.
+ * @param[in] create_cbdata Callback data for @a create_fn.
+ * @param[in] destroy_fn Destroys the artifact.
+ *
+ * @returns Status code.
+ */
+static ib_status_t artifact_get(
+    artifact_entry_t         **pentry,
+    const char                *full_key,
+    size_t                     full_key_length,
+    ib_artifact_create_fn_t    create_fn,
+    void                      *create_cbdata,
+    ib_artifact_destroy_fn_t   destroy_fn
+)
+{
+    artifact_entry_t *entry;
+    ib_status_t       rc;
+
+    if (g_artifacts == NULL) {
+        rc = ib_mpool_lite_create(&g_artifact_mp);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        rc = ib_hash_create(&g_artifacts, ib_mm_mpool_lite(g_artifact_mp));
+        if (rc != IB_OK) {
+            ib_mpool_lite_destroy(g_artifact_mp);
+            g_artifact_mp = NULL;
+            return rc;
+        }
+    }
+
+    rc = ib_hash_get_ex(g_artifacts, &entry, full_key, full_key_length);
+    if (rc == IB_OK) {
+        ++(entry->refs);
+        *pentry = entry;
+        return IB_OK;
+    }
+
+    entry = malloc(sizeof(*entry) + full_key_length);
+    if (entry == NULL) {
+        rc = IB_EALLOC;
+        goto failure;
+    }
+    memcpy(entry->key, full_key, full_key_length);
+    entry->key_length = full_key_length;
+    entry->destroy_fn = destroy_fn;
+    entry->refs = 1;
+
+    rc = create_fn(&(entry->artifact), create_cbdata);
+    if (rc != IB_OK) {
+        free(entry);
+        goto failure;
+    }
+
+    rc = ib_hash_set_ex(g_artifacts, entry->key, entry->key_length, entry);
+    if (rc != IB_OK) {
+        destroy_fn(entry->artifact);
+        free(entry);
+        goto failure;
+    }
+
+    *pentry = entry;
+    return IB_OK;
+
+failure:
+    if (ib_hash_size(g_artifacts) == 0) {
+        ib_mpool_lite_destroy(g_artifact_mp);
+        g_artifact_mp = NULL;
+        g_artifacts = NULL;
+    }
+    return rc;
+}
+
+ib_status_t ib_artifact_acquire(
+    void                     **artifact,
+    ib_mm_t                    mm,
+    const char                *kind,
+    const char                *key,
+    size_t                     key_length,
+    ib_artifact_create_fn_t    create_fn,
+    void                      *create_cbdata,
+    ib_artifact_destroy_fn_t   destroy_fn
+)
+{
+    assert(artifact != NULL);
+    assert(kind != NULL);
+    assert(key != NULL);
+    assert(create_fn != NULL);
+    assert(destroy_fn != NULL);
+
+    artifact_entry_t *entry;
+    size_t            kind_length = strlen(kind) + 1;
+    size_t            full_key_length = kind_length + key_length;
+    char             *full_key;
+    ib_status_t       rc;
+
+    full_key = malloc(full_key_length);
+    if (full_key == NULL) {
+        return IB_EALLOC;
+    }
+    memcpy(full_key, kind, kind_length);
+    memcpy(full_key + kind_length, key, key_length);
+
+    /* Creation is done with the lock held so that concurrent users of the
+     * same key do not build the artifact twice. */
+    pthread_mutex_lock(&g_artifact_lock);
+    rc = artifact_get(&entry, full_key, full_key_length,
+                      create_fn, create_cbdata, destroy_fn);
+    pthread_mutex_unlock(&g_artifact_lock);
+    free(full_key);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_mm_register_cleanup(mm, artifact_release, entry);
+    if (rc != IB_OK) {
+        artifact_release(entry);
+        return rc;
+    }
+
+    *artifact = entry->artifact;
+
+    return IB_OK;
+}
+
+size_t ib_artifact_count(void)
+{
+    size_t count = 0;
+
+    pthread_mutex_lock(&g_artifact_lock);
+    if (g_artifacts != NULL) {
+        count = ib_hash_size(g_artifacts);
+    }
+    pthread_mutex_unlock(&g_artifact_lock);
+
+    return count;
+}
@@ -0,0 +1,272 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Batch Writer Utility Functions
+ *
+ * Items are queued in one of two arrays of @c max_pending pointers.  The
+ * thread swaps the arrays to take a batch, so submitters fill one while the
+ * other is written.
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/batch_writer.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+struct ib_batch_writer_t {
+    ib_batch_writer_fn_t  write_fn;    /**< Writes each batch. */
+    void                 *cbdata;      /**< Callback data for write_fn. */
+    size_t                max_pending; /**< Capacity of each array. */
+    pthread_t             thread;      /**< Writer thread. */
+    pthread_mutex_t       mutex;       /**< Guards the fields below. */
+    pthread_cond_t        queued;      /**< Signals the writer thread. */
+    pthread_cond_t        written;     /**< Signals a batch taken or done. */
+    void                **queue;       /**< Items queued. */
+    size_t                pending;     /**< Number of items in queue. */
+    void                **batch;       /**< Items being written. */
+    bool                  busy;        /**< A batch is being written. */
+    bool                  stop;        /**< Stopped; write synchronously. */
+    /**
+     * Process that started @ref thread or 0 if none has.
+     */
+    pid_t                 pid;
+};
+
+/**
+ * Body of the writer thread.
+ *
+ * @param[in] data The @ref ib_batch_writer_t.
+ *
+ * @returns NULL
+ */
+static void *batch_writer_thread(void *data)
+{
+    assert(data != NULL);
+
+    ib_batch_writer_t *writer = (ib_batch_writer_t *)data;
+
+    pthread_mutex_lock(&(writer->mutex));
+    for (;;) {
+        void   **batch;
+        size_t   n_items;
+
+        while (writer->pending == 0 && ! writer->stop) {
+            pthread_cond_wait(&(writer->queued), &(writer->mutex));
+        }
+        /* Drain before honoring a stop request. */
+        if (writer->pending == 0) {
+            break;
+        }
+        batch           = writer->queue;
+        n_items         = writer->pending;
+        writer->queue   = writer->batch;
+        writer->batch   = batch;
+        writer->pending = 0;
+        writer->busy    = true;
+        pthread_cond_broadcast(&(writer->written));
+        pthread_mutex_unlock(&(writer->mutex));
+
+        writer->write_fn(batch, n_items, writer->cbdata);
+
+        pthread_mutex_lock(&(writer->mutex));
+        writer->busy = false;
+        pthread_cond_broadcast(&(writer->written));
+    }
+    pthread_mutex_unlock(&(writer->mutex));
+
+    return NULL;
+}
+
+/**
+ * Start the thread of this process.  The mutex must be held.
+ *
+ * @param[in] writer The writer.
+ *
+ * @returns True if the thread is running.
+ */
+static bool batch_writer_start(ib_batch_writer_t *writer)
+{
+    pid_t pid = getpid();
+
+    if (writer->pid == pid) {
+        return true;
+    }
+
+    if (writer->pid != 0) {
+        /* Items queued by the parent are its own to write, and the
+         * conditions still count the parent's thread as a waiter, which
+         * would take the signals meant for ours. */
+        writer->pending = 0;
+        writer->busy    = false;
+        pthread_cond_init(&(writer->queued), NULL);
+        pthread_cond_init(&(writer->written), NULL);
+    }
+    if (
+        pthread_create(&(writer->thread), NULL, batch_writer_thread, writer)
+        != 0
+    ) {
+        return false;
+    }
+    writer->pid = pid;
+
+    return true;
+}
+
+/**
+ * Memory manager cleanup function that stops a writer.
+ *
+ * @param[in] data The @ref ib_batch_writer_t.
+ */
+static void batch_writer_cleanup(void *data)
+{
+    ib_batch_writer_t *writer = (ib_batch_writer_t *)data;
+
+    ib_batch_writer_stop(writer);
+    pthread_cond_destroy(&(writer->written));
+    pthread_cond_destroy(&(writer->queued));
+    pthread_mutex_destroy(&(writer->mutex));
+}
+
+ib_status_t ib_batch_writer_create(
+    ib_batch_writer_t    **writer,
+    ib_mm_t                mm,
+    size_t                 max_pending,
+    ib_batch_writer_fn_t   write_fn,
+    void                  *cbdata
+)
+{
+    assert(writer != NULL);
+    assert(write_fn != NULL);
+
+    ib_batch_writer_t *new_writer;
+    ib_status_t        rc;
+
+    if (max_pending == 0) {
+        return IB_EINVAL;
+    }
+
+    new_writer = ib_mm_calloc(mm, 1, sizeof(*new_writer));
+    if (new_writer == NULL) {
+        return IB_EALLOC;
+    }
+    new_writer->queue = ib_mm_alloc(mm, max_pending * sizeof(void *));
+    new_writer->batch = ib_mm_alloc(mm, max_pending * sizeof(void *));
+    if (new_writer->queue == NULL || new_writer->batch == NULL) {
+        return IB_EALLOC;
+    }
+    new_writer->write_fn    = write_fn;
+    new_writer->cbdata      = cbdata;
+    new_writer->max_pending = max_pending;
+
+    if (pthread_mutex_init(&(new_writer->mutex), NULL) != 0) {
+        return IB_EOTHER;
+    }
+    if (pthread_cond_init(&(new_writer->queued), NULL) != 0) {
+        pthread_mutex_destroy(&(new_writer->mutex));
+        return IB_EOTHER;
+    }
+    if (pthread_cond_init(&(new_writer->written), NULL) != 0) {
+        pthread_cond_destroy(&(new_writer->queued));
+        pthread_mutex_destroy(&(new_writer->mutex));
+        return IB_EOTHER;
+    }
+
+    rc = ib_mm_register_cleanup(mm, batch_writer_cleanup, new_writer);
+    if (rc != IB_OK) {
+        pthread_cond_destroy(&(new_writer->written));
+        pthread_cond_destroy(&(new_writer->queued));
+        pthread_mutex_destroy(&(new_writer->mutex));
+        return rc;
+    }
+
+    *writer = new_writer;
+
+    return IB_OK;
+}
+
+void ib_batch_writer_submit(
+    ib_batch_writer_t *writer,
+    void              *item
+)
+{
+    assert(writer != NULL);
+
+    pthread_mutex_lock(&(writer->mutex));
+    if (! writer->stop && batch_writer_start(writer)) {
+        while (! writer->stop && writer->pending >= writer->max_pending) {
+            pthread_cond_wait(&(writer->written), &(writer->mutex));
+        }
+        if (! writer->stop) {
+            writer->queue[writer->pending++] = item;
+            pthread_cond_signal(&(writer->queued));
+            pthread_mutex_unlock(&(writer->mutex));
+            return;
+        }
+    }
+    pthread_mutex_unlock(&(writer->mutex));
+
+    /* Stopped or no thread; write synchronously. */
+    writer->write_fn(&item, 1, writer->cbdata);
+}
+
+void ib_batch_writer_flush(
+    ib_batch_writer_t *writer
+)
+{
+    assert(writer != NULL);
+
+    pthread_mutex_lock(&(writer->mutex));
+    while (
+        writer->pid == getpid() &&
+        (writer->pending > 0 || writer->busy)
+    ) {
+        pthread_cond_wait(&(writer->written), &(writer->mutex));
+    }
+    pthread_mutex_unlock(&(writer->mutex));
+}
+
+void ib_batch_writer_stop(
+    ib_batch_writer_t *writer
+)
+{
+    assert(writer != NULL);
+
+    pthread_mutex_lock(&(writer->mutex));
+    if (writer->stop) {
+        pthread_mutex_unlock(&(writer->mutex));
+        return;
+    }
+    writer->stop = true;
+
+    if (writer->pid != getpid()) {
+        /* No thread of this process; anything queued is a parent's. */
+        writer->pending = 0;
+        pthread_mutex_unlock(&(writer->mutex));
+        return;
+    }
+    pthread_cond_signal(&(writer->queued));
+    pthread_cond_broadcast(&(writer->written));
+    pthread_mutex_unlock(&(writer->mutex));
+
+    pthread_join(writer->thread, NULL);
+}
@@ -25,6 +25,7 @@
 #include "ironbee_config_auto.h"
 
 #include <ironbee/bytestr.h>
+#include "bytestr_private.h"
 
 #include <ironbee/mm.h>
 #include <ironbee/string.h>
@@ -81,6 +82,35 @@ const uint8_t DLL_PUBLIC *ib_bytestr_const_ptr(
     return bs->data;
 }
 
+size_t ib_bytestr_inline_size(size_t length)
+{
+    return sizeof(ib_bytestr_t) + length;
+}
+
+ib_bytestr_t *ib_bytestr_inline_init(
+    void          *mem,
+    ib_mm_t        mm,
+    const uint8_t *data,
+    size_t         length
+)
+{
+    assert(mem != NULL);
+    assert(data != NULL || length == 0);
+
+    ib_bytestr_t *bs = (ib_bytestr_t *)mem;
+
+    bs->mm     = mm;
+    bs->flags  = 0;
+    bs->size   = length;
+    bs->length = length;
+    bs->data   = (length != 0) ? (uint8_t *)(bs + 1) : NULL;
+    if (length != 0) {
+        memcpy(bs->data, data, length);
+    }
+
+    return bs;
+}
+
 ib_status_t ib_bytestr_create(
     ib_bytestr_t **pdst,
     ib_mm_t        mm,
@@ -88,35 +118,19 @@ ib_status_t ib_bytestr_create(
 ) {
     assert(pdst != NULL);
 
-    ib_status_t rc;
-
-    /* Create the structure. */
-    *pdst = (ib_bytestr_t *)ib_mm_alloc(mm, sizeof(**pdst));
+    /* Create the structure with its data following it. */
+    *pdst = (ib_bytestr_t *)ib_mm_alloc(mm, ib_bytestr_inline_size(size));
     if (*pdst == NULL) {
-        rc = IB_EALLOC;
-        goto failed;
+        return IB_EALLOC;
     }
 
-    (*pdst)->data   = NULL;
+    (*pdst)->data   = (size != 0) ? (uint8_t *)(*pdst + 1) : NULL;
     (*pdst)->mm     = mm;
     (*pdst)->flags  = 0;
     (*pdst)->size   = size;
     (*pdst)->length = 0;
 
-    if (size != 0) {
-        (*pdst)->data = (uint8_t *)ib_mm_alloc(mm, size);
-        if ((*pdst)->data == NULL) {
-            rc = IB_EALLOC;
-            goto failed;
-        }
-    }
-
     return IB_OK;
-
-failed:
-    *pdst = NULL;
-
-    return rc;
 }
 
 ib_status_t ib_bytestr_dup(
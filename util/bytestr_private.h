@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef _IB_BYTESTR_PRIVATE_H_
+#define _IB_BYTESTR_PRIVATE_H_
+
+/**
+ * @file
+ * @brief IronBee --- Private Byte String Functions
+ *
+ * Byte strings built inside a block of memory allocated by the caller,
+ * with their data following them, so that the structure holding a byte
+ * string, e.g., a field, can be allocated together with it.
+ */
+
+#include <ironbee/bytestr.h>
+
+/**
+ * Size of the block holding a byte string of @a length bytes.
+ *
+ * @param[in] length Length of the byte string.
+ * @return Size of the block.
+ */
+size_t ib_bytestr_inline_size(size_t length);
+
+/**
+ * Build a copy of @a data in @a mem.
+ *
+ * The byte string may grow later; its data is then allocated from @a mm.
+ *
+ * @param[in] mem    Block of ib_bytestr_inline_size(@a length) bytes,
+ *                   aligned for pointers.
+ * @param[in] mm     Memory manager of the byte string.
+ * @param[in] data   Data to copy.  May be NULL if @a length is 0.
+ * @param[in] length Length of @a data.
+ * @return The byte string; at @a mem.
+ */
+ib_bytestr_t *ib_bytestr_inline_init(
+    void          *mem,
+    ib_mm_t        mm,
+    const uint8_t *data,
+    size_t         length
+);
+
+#endif /* _IB_BYTESTR_PRIVATE_H_ */
@@ -45,17 +45,21 @@
 #endif /* CLOCK_MONOTONIC_RAW */
 #endif /* CLOCK_MONOTONIC_COARSE */
 
-#ifdef CLOCK_MONOTONIC_RAW
-#define IB_PRECISE_CLOCK                  CLOCK_MONOTONIC_RAW
-#else
+/* The precise clock times rules and hooks, so it must be cheap to read.
+ * CLOCK_MONOTONIC is read in user space on every Linux kernel that has a
+ * vDSO, while CLOCK_MONOTONIC_RAW is a system call before Linux 5.3; the
+ * slew of CLOCK_MONOTONIC does not matter for intervals this short. */
 #ifdef CLOCK_MONOTONIC
 #define IB_PRECISE_CLOCK                  CLOCK_MONOTONIC
 #else
+#ifdef CLOCK_MONOTONIC_RAW
+#define IB_PRECISE_CLOCK                  CLOCK_MONOTONIC_RAW
+#else
 #ifdef CLOCK_MONOTONIC_COARSE
 #define IB_PRECISE_CLOCK                  CLOCK_MONOTONIC_COARSE
-#endif /* CLOCK_MONOTONIC */
-#endif /* CLOCK_MONOTONIC_RAW */
 #endif /* CLOCK_MONOTONIC_COARSE */
+#endif /* CLOCK_MONOTONIC_RAW */
+#endif /* CLOCK_MONOTONIC */
 
 /**
  * Assign values between two timeval structures.
@@ -125,9 +129,9 @@ ib_time_t ib_clock_get_time(void)
     struct timespec ts;
 
     /* Ticks seem to be an undesirable due for many reasons.
-     * IB_CLOCK is set to CLOCK_MONOTONIC which is vulnerable to slew or
-     * if available set to CLOCK_MONOTONIC_RAW which does not suffer from
-     * slew.
+     * IB_CLOCK is set to CLOCK_MONOTONIC_COARSE if available, which is the
+     * cheapest clock to read and only as precise as the kernel tick, as
+     * this is called several times for every transaction.
      *
      * timespec provides sec and nsec resolution so we have to convert to
      * msec.
@@ -26,6 +26,7 @@
 #include "ironbee_config_auto.h"
 
 #include <ironbee/field.h>
+#include "bytestr_private.h"
 
 #include <ironbee/bytestr.h>
 #include <ironbee/engine.h>
@@ -72,6 +73,17 @@ struct ib_field_val_t {
     ib_field_val_union_t  u;             /**< Union of value types */
 };
 
+/**
+ * Field, value store and (following it) name, allocated as one block.
+ *
+ * A string or byte string value given at creation is kept in the block as
+ * well, between the value store and the name.
+ */
+typedef struct {
+    ib_field_t     field;  /**< Field */
+    ib_field_val_t val;    /**< Value store of field */
+} field_storage_t;
+
 const char *ib_field_type_name(
     ib_ftype_t ftype
 )
@@ -328,6 +340,57 @@ void ib_field_util_log_debug(
     }
 }
 
+/**
+ * Allocate a field, its value store, @a extra bytes and its name.
+ *
+ * @param[out] pf    The field.
+ * @param[in]  mm    Memory manager.
+ * @param[in]  name  Field name.
+ * @param[in]  nlen  Length of @a name.
+ * @param[in]  type  Field type.
+ * @param[in]  extra Bytes to reserve after the value store.
+ * @return Start of the @a extra bytes, aligned for pointers, or NULL on
+ *         allocation failure.
+ */
+static void *field_alloc(
+    ib_field_t **pf,
+    ib_mm_t      mm,
+    const char  *name,
+    size_t       nlen,
+    ib_ftype_t   type,
+    size_t       extra
+)
+{
+    field_storage_t *storage;
+    char            *name_copy;
+
+    /* Allocate the field structure, value store and name together. */
+    storage = (field_storage_t *)ib_mm_alloc(
+        mm,
+        sizeof(*storage) + extra + nlen
+    );
+    if (storage == NULL) {
+        return NULL;
+    }
+    *pf = &(storage->field);
+    (*pf)->mm = mm;
+    (*pf)->type = type;
+    (*pf)->tfn = NULL;
+
+    /* Copy the name. */
+    (*pf)->nlen = nlen;
+    name_copy = (char *)(storage + 1) + extra;
+    if (nlen > 0) {
+        memcpy(name_copy, name, nlen);
+    }
+    (*pf)->name = (const char *)name_copy;
+
+    memset(&(storage->val), 0, sizeof(storage->val));
+    (*pf)->val = &(storage->val);
+
+    return storage + 1;
+}
+
 ib_status_t ib_field_create(
     ib_field_t **pf,
     ib_mm_t      mm,
@@ -339,6 +402,44 @@ ib_status_t ib_field_create(
 {
     ib_status_t rc;
 
+    /* Copy string values into the field block instead of allocating. */
+    if (type == IB_FTYPE_NULSTR && in_pval != NULL) {
+        const char *s = (const char *)in_pval;
+        size_t      len = strlen(s) + 1;
+        void       *extra;
+
+        extra = field_alloc(pf, mm, name, nlen, type, len);
+        if (extra == NULL) {
+            *pf = NULL;
+            return IB_EALLOC;
+        }
+        memcpy(extra, s, len);
+        (*pf)->val->pval = &((*pf)->val->u);
+        (*pf)->val->u.nulstr = (char *)extra;
+
+        ib_field_util_log_debug("FIELD_CREATE", (*pf));
+        return IB_OK;
+    }
+    if (type == IB_FTYPE_BYTESTR && in_pval != NULL) {
+        const ib_bytestr_t *bs = (const ib_bytestr_t *)in_pval;
+        size_t              len = ib_bytestr_length(bs);
+        void               *extra;
+
+        extra = field_alloc(pf, mm, name, nlen, type,
+                            ib_bytestr_inline_size(len));
+        if (extra == NULL) {
+            *pf = NULL;
+            return IB_EALLOC;
+        }
+        (*pf)->val->pval = &((*pf)->val->u);
+        (*pf)->val->u.bytestr = ib_bytestr_inline_init(
+            extra, mm, ib_bytestr_const_ptr(bs), len
+        );
+
+        ib_field_util_log_debug("FIELD_CREATE", (*pf));
+        return IB_OK;
+    }
+
     rc = ib_field_create_alias(pf, mm, name, nlen, type, NULL);
     if (rc != IB_OK) {
         goto failed;
@@ -407,47 +508,15 @@ ib_status_t ib_field_create_alias(
     void        *storage_pval
 )
 {
-    ib_status_t rc;
-    char *name_copy;
-
-    /* Allocate the field structure. */
-    *pf = (ib_field_t *)ib_mm_alloc(mm, sizeof(**pf));
-    if (*pf == NULL) {
-        rc = IB_EALLOC;
-        goto failed;
-    }
-    (*pf)->mm = mm;
-    (*pf)->type = type;
-    (*pf)->tfn = NULL;
-
-    /* Copy the name. */
-    (*pf)->nlen = nlen;
-    name_copy = (char *)ib_mm_alloc(mm, nlen);
-    if (name_copy == NULL) {
-        rc = IB_EALLOC;
-        goto failed;
-    }
-    memcpy(name_copy, name, nlen);
-    (*pf)->name = (const char *)name_copy;
-
-    (*pf)->val = (ib_field_val_t *)ib_mm_calloc(mm,
-        1, sizeof(*((*pf)->val))
-    );
-    if ((*pf)->val == NULL) {
-        rc = IB_EALLOC;
-        goto failed;
+    if (field_alloc(pf, mm, name, nlen, type, 0) == NULL) {
+        *pf = NULL;
+        return IB_EALLOC;
     }
 
     (*pf)->val->pval = storage_pval;
 
     ib_field_util_log_debug("FIELD_CREATE_ALIAS", (*pf));
     return IB_OK;
-
-failed:
-    /* Make sure everything is cleaned up on failure. */
-    *pf = NULL;
-
-    return rc;
 }
 
 ib_status_t ib_field_create_dynamic(
@@ -33,12 +33,23 @@
 #include <string.h>
 #include <time.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 /* Internal Declarations */
 
 /**
  * @defgroup IronBeeHashInternal Hash Internal
  * @ingroup IronBeeHash
  *
+ * The hash is an open addressing table.  Next to the array of entries is an
+ * array of control bytes, one per entry, that is either
+ * IB_HASH_CTRL_EMPTY, IB_HASH_CTRL_DELETED or, for used entries, the top 7
+ * bits of the (mixed) hash value of the entry's key.  Lookups examine a
+ * group of IB_HASH_GROUP_SIZE control bytes at a time, with SSE2 when
+ * available, and only compare keys of entries whose control byte matches.
+ *
  * @{
  */
 
@@ -49,6 +60,24 @@
  **/
 #define IB_HASH_INITIAL_SIZE 16
 
+/**
+ * Number of control bytes examined at once.
+ *
+ * Tables always have at least this many entries.
+ **/
+#define IB_HASH_GROUP_SIZE 16
+
+/** Control byte of an empty entry. */
+#define IB_HASH_CTRL_EMPTY   ((uint8_t)0x80)
+/** Control byte of a removed entry. */
+#define IB_HASH_CTRL_DELETED ((uint8_t)0xfe)
+
+/**
+ * Maximum number of used and removed entries of a table of @a capacity
+ * entries (7/8 load factor).
+ **/
+#define IB_HASH_MAX_LOAD(capacity) ((capacity) - (capacity) / 8)
+
 /**
  * See ib_hash_entry_t()
  */
@@ -66,25 +95,20 @@ struct ib_hash_entry_t {
     void                *value;
     /** Hash of @c key. */
     uint32_t             hash_value;
-    /** Next entry in slot for @c hash. */
-    ib_hash_entry_t     *next_entry;
 };
 
 /**
  * External iterator for ib_hash_t.
  *
- * The end of the sequence is indicated by @c current_entry being NULL.
- * Any iterator is invalidated by any mutating operation on the hash.
+ * The end of the sequence is indicated by @c index being the capacity of the
+ * hash.  Any iterator is invalidated by any mutating operation on the hash
+ * other than removal.
  **/
 struct ib_hash_iterator_t {
     /** Hash table we are iterating through. */
     const ib_hash_t     *hash;
-    /** Current entry. */
-    ib_hash_entry_t     *current_entry;
-    /** Next entry. */
-    ib_hash_entry_t     *next_entry;
-    /** Which slot to look in next. */
-    size_t               slot_index;
+    /** Index of the current entry. */
+    size_t               index;
 };
 
 /**
@@ -100,21 +124,22 @@ struct ib_hash_t {
     /** Key equality callback data. */
     void                *equal_cbdata;
 
+    /** Entries; only those with a full control byte are valid. */
+    ib_hash_entry_t     *entries;
     /**
-     * Slots.
-     *
-     * Each slot holds a (possibly empty) linked list of ib_hash_entry_t's,
-     * all of which have the same hash value.
+     * Control bytes, one per entry, followed by a copy of the first
+     * IB_HASH_GROUP_SIZE control bytes so that a group can be loaded at any
+     * index without wrapping around.
      **/
-    ib_hash_entry_t    **slots;
-    /** Maximum slot index. */
-    size_t               max_slot;
+    uint8_t             *ctrl;
+    /** Number of entries minus one; the number of entries is a power of 2. */
+    size_t               mask;
     /** Memory manager. */
     ib_mm_t              mm;
-    /** Linked list of removed hash entries to use for recycling. */
-    ib_hash_entry_t     *free;
     /** Number of entries. */
     size_t               size;
+    /** Number of removed entries not yet reused. */
+    size_t               deleted;
     /** Randomizer value. */
     uint32_t             randomizer;
 };
@@ -139,22 +164,23 @@ static ib_status_t ib_hash_find_entry(
 );
 
 /**
- * Search for a hash entry in the list of entries starting at @a first.
+ * Search for the index of the entry matching @a key.
  *
  * @param[in] hash       Hash table.
- * @param[in] first      Beginning of list to search.
  * @param[in] key        Key to search for.
  * @param[in] key_length Length of @a key.
  * @param[in] hash_value Hash value of @a key.
+ * @param[out] free_index If not NULL, set to the first empty or removed
+ *                        entry of the probe sequence if @a key is not found.
  *
- * @returns Hash entry if found and NULL otherwise.
+ * @returns Index of the entry if found and the capacity of @a hash otherwise.
  */
-static ib_hash_entry_t *ib_hash_find_htentry(
+static size_t ib_hash_find_index(
      const ib_hash_t *hash,
-     ib_hash_entry_t *first,
      const char      *key,
      size_t           key_length,
-     uint32_t         hash_value
+     uint32_t         hash_value,
+     size_t          *free_index
 );
 
 /**
@@ -178,14 +204,17 @@ static ib_hash_entry_t *ib_hash_find_htentry(
     )
 
 /**
- * Resize the number of slots in @a hash.
+ * Rebuild @a hash with room for at least @a min_capacity entries.
+ *
+ * Also discards removed entries.
  *
  * @returns
  * - IB_OK on success.
  * - IB_EALLOC on allocation failure.
  */
-static ib_status_t ib_hash_resize_slots(
-    ib_hash_t *hash
+static ib_status_t ib_hash_rehash(
+    ib_hash_t *hash,
+    size_t     min_capacity
 );
 
 /**
@@ -203,34 +232,186 @@ static char ib_hash_tolower(
 
 /* Internal Definitions */
 
-ib_hash_entry_t *ib_hash_find_htentry(
+/**
+ * Mix the bits of a hash value.
+ *
+ * The hash functions do not spread their bits evenly, but the table uses
+ * both the low bits (for the position) and the top bits (for the control
+ * byte).  This is the MurmurHash3 finalizer.
+ *
+ * @param[in] hash_value Hash value.
+ * @return Mixed hash value.
+ */
+static inline uint32_t ib_hash_mix(uint32_t hash_value)
+{
+    hash_value ^= hash_value >> 16;
+    hash_value *= 0x85ebca6bU;
+    hash_value ^= hash_value >> 13;
+    hash_value *= 0xc2b2ae35U;
+    hash_value ^= hash_value >> 16;
+
+    return hash_value;
+}
+
+/**
+ * Control byte for a used entry.
+ *
+ * @param[in] mixed Mixed hash value of the key.
+ * @return Control byte (top bit clear).
+ */
+static inline uint8_t ib_hash_tag(uint32_t mixed)
+{
+    return (uint8_t)(mixed >> 25);
+}
+
+/**
+ * Index of the lowest set bit of a non-zero group mask.
+ *
+ * @param[in] mask Group mask.
+ * @return Index of the lowest set bit.
+ */
+static inline unsigned ib_hash_lowest_bit(uint32_t mask)
+{
+    assert(mask != 0);
+#ifdef __GNUC__
+    return (unsigned)__builtin_ctz(mask);
+#else
+    unsigned bit = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+/**
+ * Mask of the control bytes of a group equal to @a value.
+ *
+ * @param[in] ctrl First control byte of the group.
+ * @param[in] value Value to match.
+ * @return Bit i is set if @a ctrl[i] is @a value.
+ */
+static inline uint32_t ib_hash_group_match(
+    const uint8_t *ctrl,
+    uint8_t        value
+)
+{
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    __m128i match = _mm_set1_epi8((char)value);
+
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, match));
+#else
+    uint32_t mask = 0;
+
+    for (unsigned i = 0; i < IB_HASH_GROUP_SIZE; ++i) {
+        if (ctrl[i] == value) {
+            mask |= (uint32_t)1 << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/**
+ * Mask of the empty or removed control bytes of a group.
+ *
+ * @param[in] ctrl First control byte of the group.
+ * @return Bit i is set if @a ctrl[i] is not a used entry.
+ */
+static inline uint32_t ib_hash_group_free(const uint8_t *ctrl)
+{
+#ifdef __SSE2__
+    /* Free control bytes are exactly those with the top bit set. */
+    return (uint32_t)_mm_movemask_epi8(
+        _mm_loadu_si128((const __m128i *)ctrl));
+#else
+    uint32_t mask = 0;
+
+    for (unsigned i = 0; i < IB_HASH_GROUP_SIZE; ++i) {
+        if ((ctrl[i] & 0x80) != 0) {
+            mask |= (uint32_t)1 << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/**
+ * Set the control byte of an entry, keeping the trailing copy in sync.
+ *
+ * @param[in] hash  Hash table.
+ * @param[in] index Entry index.
+ * @param[in] value Control byte.
+ */
+static inline void ib_hash_set_ctrl(
+    ib_hash_t *hash,
+    size_t     index,
+    uint8_t    value
+)
+{
+    hash->ctrl[index] = value;
+    if (index < IB_HASH_GROUP_SIZE) {
+        hash->ctrl[hash->mask + 1 + index] = value;
+    }
+}
+
+size_t ib_hash_find_index(
     const ib_hash_t *hash,
-    ib_hash_entry_t *first,
     const char      *key,
     size_t           key_length,
-    uint32_t         hash_value
+    uint32_t         hash_value,
+    size_t          *free_index
 ) {
     assert(hash != NULL);
     assert(key  != NULL);
 
-    for (
-        ib_hash_entry_t* current_entry = first;
-        current_entry != NULL;
-        current_entry = current_entry->next_entry
-    )
-    {
-        if (
-            current_entry->hash_value == hash_value &&
-            hash->equal_predicate(
-                key,                key_length,
-                current_entry->key, current_entry->key_length,
-                hash->equal_cbdata
-            )
-        ) {
-            return current_entry;
+    uint32_t mixed    = ib_hash_mix(hash_value);
+    uint8_t  tag      = ib_hash_tag(mixed);
+    size_t   position = mixed & hash->mask;
+    size_t   step     = 0;
+    bool     have_free = false;
+
+    for (;;) {
+        const uint8_t *group = &(hash->ctrl[position]);
+        uint32_t       match = ib_hash_group_match(group, tag);
+        uint32_t       free_mask;
+
+        while (match != 0) {
+            size_t index =
+                (position + ib_hash_lowest_bit(match)) & hash->mask;
+            const ib_hash_entry_t *entry = &(hash->entries[index]);
+
+            if (
+                entry->hash_value == hash_value &&
+                hash->equal_predicate(
+                    key,        key_length,
+                    entry->key, entry->key_length,
+                    hash->equal_cbdata
+                )
+            ) {
+                return index;
+            }
+            match &= match - 1;
+        }
+
+        free_mask = ib_hash_group_free(group);
+        if ( (free_index != NULL) && ! have_free && (free_mask != 0) ) {
+            *free_index =
+                (position + ib_hash_lowest_bit(free_mask)) & hash->mask;
+            have_free = true;
+        }
+
+        /* An empty entry ends the probe sequence. */
+        if (ib_hash_group_match(group, IB_HASH_CTRL_EMPTY) != 0) {
+            return hash->mask + 1;
         }
+
+        /* Triangular probing visits every group of a power of 2 table. */
+        step += IB_HASH_GROUP_SIZE;
+        position = (position + step) & hash->mask;
     }
-    return NULL;
 }
 
 ib_status_t ib_hash_find_entry(
@@ -243,9 +424,8 @@ ib_status_t ib_hash_find_entry(
     assert(hash       != NULL);
     assert(key        != NULL);
 
-    ib_hash_entry_t *current_slot  = NULL;
-    ib_hash_entry_t *current_entry = NULL;
-    uint32_t         hash_value    = 0;
+    uint32_t hash_value;
+    size_t   index;
 
     hash_value = hash->hash_function(
         key, key_length,
@@ -253,20 +433,53 @@ ib_status_t ib_hash_find_entry(
         hash->hash_cbdata
     );
 
-    /* hash->max_slot+1 is a power of 2 */
-    current_slot = hash->slots[hash_value & hash->max_slot];
-    current_entry = ib_hash_find_htentry(
-        hash,
-        current_slot,
-        key,
-        key_length,
-        hash_value
-    );
-    if (current_entry == NULL) {
+    index = ib_hash_find_index(hash, key, key_length, hash_value, NULL);
+    if (index > hash->mask) {
         *hash_entry = NULL;
         return IB_ENOENT;
     }
-    *hash_entry = current_entry;
+    *hash_entry = &(hash->entries[index]);
+
+    return IB_OK;
+}
+
+/**
+ * Allocate the entry and control arrays of a table.
+ *
+ * @param[in]  mm       Memory manager.
+ * @param[in]  capacity Number of entries; a power of 2 of at least
+ *                      IB_HASH_GROUP_SIZE.
+ * @param[out] entries  Entries.
+ * @param[out] ctrl     Control bytes, all empty.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static ib_status_t ib_hash_alloc_table(
+    ib_mm_t           mm,
+    size_t            capacity,
+    ib_hash_entry_t **entries,
+    uint8_t         **ctrl
+)
+{
+    assert(capacity >= IB_HASH_GROUP_SIZE);
+    assert(entries != NULL);
+    assert(ctrl != NULL);
+
+    *entries = (ib_hash_entry_t *)ib_mm_alloc(
+        mm,
+        capacity * sizeof(**entries)
+    );
+    if (*entries == NULL) {
+        return IB_EALLOC;
+    }
+
+    *ctrl = (uint8_t *)ib_mm_alloc(mm, capacity + IB_HASH_GROUP_SIZE);
+    if (*ctrl == NULL) {
+        return IB_EALLOC;
+    }
+    memset(*ctrl, IB_HASH_CTRL_EMPTY, capacity + IB_HASH_GROUP_SIZE);
 
     return IB_OK;
 }
@@ -286,7 +499,7 @@ ib_hash_iterator_t *ib_hash_iterator_create_malloc()
 
 bool ib_hash_iterator_at_end(const ib_hash_iterator_t *iterator)
 {
-    return iterator->current_entry == NULL;
+    return iterator->index > iterator->hash->mask;
 }
 
 void ib_hash_iterator_first(
@@ -297,9 +510,14 @@ void ib_hash_iterator_first(
     assert(iterator != NULL);
     assert(hash     != NULL);
 
-    memset(iterator, 0, sizeof(*iterator));
     iterator->hash = hash;
-    ib_hash_iterator_next(iterator);
+    iterator->index = 0;
+    while (
+        iterator->index <= hash->mask &&
+        (hash->ctrl[iterator->index] & 0x80) != 0
+    ) {
+        ++iterator->index;
+    }
 }
 
 void ib_hash_iterator_fetch(
@@ -311,14 +529,16 @@ void ib_hash_iterator_fetch(
 {
     assert(iterator != NULL);
 
+    const ib_hash_entry_t *entry = &(iterator->hash->entries[iterator->index]);
+
     if (key != NULL) {
-        *key            = iterator->current_entry->key;
+        *key            = entry->key;
     }
     if (key_length != NULL) {
-        *key_length     = iterator->current_entry->key_length;
+        *key_length     = entry->key_length;
     }
     if (value != NULL) {
-        *(void **)value = iterator->current_entry->value;
+        *(void **)value = entry->value;
     }
 }
 
@@ -327,15 +547,17 @@ void ib_hash_iterator_next(
 ) {
     assert(iterator != NULL);
 
-    iterator->current_entry = iterator->next_entry;
-    while (! iterator->current_entry) {
-        if (iterator->slot_index > iterator->hash->max_slot) {
-            return;
-        }
-        iterator->current_entry = iterator->hash->slots[iterator->slot_index];
-        ++iterator->slot_index;
+    const ib_hash_t *hash = iterator->hash;
+
+    if (iterator->index > hash->mask) {
+        return;
     }
-    iterator->next_entry = iterator->current_entry->next_entry;
+    do {
+        ++iterator->index;
+    } while (
+        iterator->index <= hash->mask &&
+        (hash->ctrl[iterator->index] & 0x80) != 0
+    );
 }
 
 void ib_hash_iterator_copy(
@@ -353,40 +575,61 @@ bool ib_hash_iterator_equal(
 {
     return
         a->hash          == b->hash          &&
-        a->current_entry == b->current_entry &&
-        a->next_entry    == b->next_entry    &&
-        a->slot_index    == b->slot_index
+        a->index         == b->index
         ;
 }
 
-ib_status_t ib_hash_resize_slots(
-    ib_hash_t *hash
+ib_status_t ib_hash_rehash(
+    ib_hash_t *hash,
+    size_t     min_capacity
 ) {
     assert(hash != NULL);
 
-    ib_hash_entry_t    **new_slots     = NULL;
-    size_t               new_max_slot = 0;
-    ib_hash_iterator_t   i;
+    ib_hash_entry_t *old_entries  = hash->entries;
+    uint8_t         *old_ctrl     = hash->ctrl;
+    size_t           old_capacity = hash->mask + 1;
+    size_t           capacity     = old_capacity;
+    ib_status_t      rc;
 
-    /* Maintain power of 2 slots */
-    new_max_slot = 2 * hash->max_slot + 1;
-    new_slots = (ib_hash_entry_t **)ib_mm_calloc(
-        hash->mm,
-        new_max_slot + 1,
-        sizeof(*new_slots)
-    );
-    if (new_slots == NULL) {
-        return IB_EALLOC;
+    /* Maintain power of 2 entries */
+    while (capacity < min_capacity) {
+        capacity *= 2;
     }
 
-    IB_HASH_LOOP(i, hash) {
-        size_t j =
-            i.current_entry->hash_value & new_max_slot;
-        i.current_entry->next_entry = new_slots[j];
-        new_slots[j] = i.current_entry;
+    rc = ib_hash_alloc_table(hash->mm, capacity, &hash->entries, &hash->ctrl);
+    if (rc != IB_OK) {
+        hash->entries = old_entries;
+        hash->ctrl    = old_ctrl;
+        return rc;
+    }
+    hash->mask    = capacity - 1;
+    hash->deleted = 0;
+
+    for (size_t i = 0; i < old_capacity; ++i) {
+        const ib_hash_entry_t *entry = &(old_entries[i]);
+        uint32_t               mixed;
+        size_t                 position;
+        size_t                 step = 0;
+        uint32_t               free_mask;
+
+        if ((old_ctrl[i] & 0x80) != 0) {
+            continue;
+        }
+
+        /* Keys are unique, so only a free entry is needed. */
+        mixed = ib_hash_mix(entry->hash_value);
+        position = mixed & hash->mask;
+        while (
+            (free_mask = ib_hash_group_free(&(hash->ctrl[position]))) == 0
+        ) {
+            step += IB_HASH_GROUP_SIZE;
+            position = (position + step) & hash->mask;
+        }
+        position = (position + ib_hash_lowest_bit(free_mask)) & hash->mask;
+
+        hash->entries[position] = *entry;
+        ib_hash_set_ctrl(hash, position, ib_hash_tag(mixed));
     }
-    hash->max_slot = new_max_slot;
-    hash->slots     = new_slots;
 
     return IB_OK;
 }
@@ -523,7 +766,8 @@ ib_status_t ib_hash_create_ex(
     assert(hash != NULL);
     assert(size > 0);
 
-    ib_hash_t *new_hash = NULL;
+    ib_hash_t   *new_hash = NULL;
+    ib_status_t  rc;
 
     {
         int num_ones = 0;
@@ -541,31 +785,31 @@ ib_status_t ib_hash_create_ex(
         }
     }
 
+    /* A table holds at least one group. */
+    if (size < IB_HASH_GROUP_SIZE) {
+        size = IB_HASH_GROUP_SIZE;
+    }
+
     new_hash = (ib_hash_t *)ib_mm_alloc(mm, sizeof(*new_hash));
     if (new_hash == NULL) {
         *hash = NULL;
         return IB_EALLOC;
     }
 
-    ib_hash_entry_t **slots = (ib_hash_entry_t **)ib_mm_calloc(
-        mm,
-        size + 1,
-        sizeof(*slots)
-    );
-    if (slots == NULL) {
+    rc = ib_hash_alloc_table(mm, size, &new_hash->entries, &new_hash->ctrl);
+    if (rc != IB_OK) {
         *hash = NULL;
-        return IB_EALLOC;
+        return rc;
     }
 
     new_hash->hash_function   = hash_function;
     new_hash->hash_cbdata     = hash_cbdata;
     new_hash->equal_predicate = equal_predicate;
     new_hash->equal_cbdata    = equal_cbdata;
-    new_hash->max_slot        = size-1;
-    new_hash->slots           = slots;
+    new_hash->mask            = size-1;
     new_hash->mm              = mm;
-    new_hash->free            = NULL;
     new_hash->size            = 0;
+    new_hash->deleted         = 0;
     new_hash->randomizer      = (uint32_t)clock();
 
     *hash = new_hash;
@@ -686,7 +930,7 @@ ib_status_t ib_hash_get_all(
 
     ib_hash_iterator_t i;
     IB_HASH_LOOP(i, hash) {
-        ib_list_push(list, i.current_entry->value);
+        ib_list_push(list, hash->entries[i.index].value);
     }
 
     if (ib_list_elements(list) <= 0) {
@@ -705,97 +949,72 @@ ib_status_t ib_hash_set_ex(
     assert(hash != NULL);
     assert(key  != NULL);
 
-    uint32_t     hash_value = 0;
-    size_t       slot_index = 0;
-    int          found      = 0;
-
-    ib_hash_entry_t  *current_entry         = NULL;
-    /* Points to pointer that points to current_entry */
-    ib_hash_entry_t **current_entry_handle  = NULL;
+    uint32_t         hash_value = 0;
+    size_t           index;
+    size_t           free_index = 0;
+    ib_hash_entry_t *entry;
 
     hash_value = hash->hash_function(
         key, key_length,
         hash->randomizer,
         hash->hash_cbdata
     );
-    slot_index = (hash_value & hash->max_slot);
-
-    current_entry_handle = &hash->slots[slot_index];
-
-    while (*current_entry_handle != NULL) {
-        current_entry = *current_entry_handle;
-        if (
-            current_entry->hash_value == hash_value &&
-            hash->equal_predicate(
-               current_entry->key, current_entry->key_length,
-               key,                key_length,
-               hash->equal_cbdata
-            )
-        ) {
-            found = 1;
-            break;
-        }
-        current_entry_handle = &(current_entry->next_entry);
-    }
-    /* current_entry is now the entry to change, and current_entry_handler
-     * points to the pointer to it.
-     */
-    if (found) {
-        assert(current_entry != NULL);
-        assert(current_entry == *current_entry_handle);
 
+    index = ib_hash_find_index(hash, key, key_length, hash_value, &free_index);
+    if (index <= hash->mask) {
         /* Update. */
-        current_entry->value = value;
+        hash->entries[index].value = value;
 
         /* Delete if appropriate. */
         if (value == NULL) {
-            /* Delete */
             --hash->size;
-
-            /* Remove from slot list. */
-            *current_entry_handle = current_entry->next_entry;
-
-            /* Add to free list. */
-            current_entry->next_entry = hash->free;
-            hash->free                = current_entry;
+            ++hash->deleted;
+            ib_hash_set_ctrl(hash, index, IB_HASH_CTRL_DELETED);
         }
+        return IB_OK;
     }
-    else {
-        /* It's not in the list. Add it if value != NULL. */
-        if (value != NULL) {
-            ib_hash_entry_t *entry = NULL;
 
-            if (hash->free != NULL) {
-                entry = hash->free;
-                hash->free = entry->next_entry;
+    /* It's not in the table.  Add it if value != NULL. */
+    if (value == NULL) {
+        return IB_OK;
+    }
+
+    /* Reusing a removed entry does not increase the load. */
+    if (hash->ctrl[free_index] == IB_HASH_CTRL_EMPTY) {
+        if (hash->size + hash->deleted + 1 >
+            IB_HASH_MAX_LOAD(hash->mask + 1))
+        {
+            /* Grow unless most of the load is removed entries. */
+            size_t capacity = hash->mask + 1;
+            ib_status_t rc;
+
+            if (hash->size + 1 > capacity / 2) {
+                capacity *= 2;
             }
-            else {
-                entry = (ib_hash_entry_t *)ib_mm_alloc(
-                    hash->mm,
-                    sizeof(*entry)
-                );
-                if (entry == NULL) {
-                    return IB_EALLOC;
-                }
+            rc = ib_hash_rehash(hash, capacity);
+            if (rc != IB_OK) {
+                return rc;
             }
 
-            entry->hash_value = hash_value;
-            entry->key        = key;
-            entry->key_length = key_length;
-            entry->value      = value;
-            entry->next_entry = hash->slots[slot_index];
-
-            hash->slots[slot_index] = entry;
-
-            ++hash->size;
-
-            /* If we have more elements that slots, resize. */
-            if (hash->size > hash->max_slot+1) {
-                return ib_hash_resize_slots(hash);
-            }
+            /* The table changed; find the free entry again. */
+            index = ib_hash_find_index(
+                hash, key, key_length, hash_value, &free_index
+            );
+            assert(index > hash->mask);
         }
-        /* Else value == NULL and no changes are needed. */
     }
+    else {
+        --hash->deleted;
+    }
+
+    entry = &(hash->entries[free_index]);
+    entry->hash_value = hash_value;
+    entry->key        = key;
+    entry->key_length = key_length;
+    entry->value      = value;
+    ib_hash_set_ctrl(hash, free_index, ib_hash_tag(ib_hash_mix(hash_value)));
+
+    ++hash->size;
 
     return IB_OK;
 }
@@ -819,23 +1038,9 @@ ib_status_t ib_hash_set(
 void ib_hash_clear(ib_hash_t *hash) {
     assert(hash != NULL);
 
-    for (size_t i = 0; i <= hash->max_slot; ++i) {
-        if (hash->slots[i] != NULL) {
-            ib_hash_entry_t *current_entry;
-            for (
-                current_entry = hash->slots[i];
-                current_entry->next_entry != NULL;
-                current_entry = current_entry->next_entry
-            ) {
-                current_entry->value = NULL;
-            }
-
-            current_entry->next_entry = hash->free;
-            hash->free                = hash->slots[i];
-            hash->slots[i]            = NULL;
-        }
-    }
+    memset(hash->ctrl, IB_HASH_CTRL_EMPTY, hash->mask + 1 + IB_HASH_GROUP_SIZE);
     hash->size = 0;
+    hash->deleted = 0;
 
     return;
 }
@@ -31,6 +31,7 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 /**
  * Helper typedef of a stdlib compare function.
@@ -177,7 +178,7 @@ int ib_ipset4_compare_strict(
             return -1;
         }
         if (a_net->size > b_net->size) {
-            return -1;
+            return 1;
         }
         return 0;
     }
@@ -495,6 +496,620 @@ ib_status_t ib_ipset_query(
     return IB_OK;
 }
 
+/**
+ * @name Trie Index
+ *
+ * The index is a Poptrie: a multibit trie consuming
+ * IB_IPSET_INDEX_STRIDE bits per level where each node describes its
+ * children and leaves with two bitmaps.  Bit v of @c vector is set if slot v
+ * has a child node; children are stored contiguously starting at @c base1 so
+ * the child of slot v is found by counting the set bits of @c vector up to v.
+ * Runs of equal leaves are stored once: bit v of @c leafvec is set if slot v
+ * starts a new run, and the leaf of slot v is found by counting the set bits
+ * of @c leafvec up to v.
+ *
+ * Each leaf holds the most specific and most general positive entry for its
+ * addresses, or IB_IPSET_INDEX_NONE if the addresses are not in the set.
+ */
+/**@{*/
+
+/** Bits consumed per trie level. */
+#define IB_IPSET_INDEX_STRIDE 6
+
+/** Leaf value for addresses not in the set. */
+#define IB_IPSET_INDEX_NONE UINT32_MAX
+
+/**
+ * Extract @a count bits of an IP starting @a start bits from the top.
+ *
+ * @param[in] ip    IP; an ib_ip4_t or an ib_ip6_t.
+ * @param[in] start Index of first bit.
+ * @param[in] count Number of bits; at most IB_IPSET_INDEX_STRIDE.
+ * @return Bits as an integer.
+ */
+typedef unsigned (*ib_ipset_bits_fn)(
+    const void *ip,
+    size_t      start,
+    size_t      count
+);
+
+/**
+ * Network size of an entry.
+ *
+ * @param[in] entry Entry; an ib_ipset4_entry_t or an ib_ipset6_entry_t.
+ * @return Network size of @a entry.
+ */
+typedef size_t (*ib_ipset_size_fn)(const void *entry);
+
+/**
+ * Trie node.
+ */
+typedef struct ib_ipset_node_t ib_ipset_node_t;
+struct ib_ipset_node_t
+{
+    /** Bit v is set if slot v has a child node. */
+    uint64_t vector;
+    /** Bit v is set if leaf slot v starts a new run of leaves. */
+    uint64_t leafvec;
+    /** Index of the first leaf of this node. */
+    uint32_t base0;
+    /** Index of the first child of this node. */
+    uint32_t base1;
+};
+
+/**
+ * Trie leaf.
+ */
+typedef struct ib_ipset_leaf_t ib_ipset_leaf_t;
+struct ib_ipset_leaf_t
+{
+    /** Index of most specific positive entry or IB_IPSET_INDEX_NONE. */
+    uint32_t specific;
+    /** Index of most general positive entry or IB_IPSET_INDEX_NONE. */
+    uint32_t general;
+};
+
+/**
+ * See ib_ipset_index_t.
+ */
+struct ib_ipset_index_t
+{
+    /** Nodes; the root is the first. */
+    const ib_ipset_node_t *nodes;
+    /** Leaves. */
+    const ib_ipset_leaf_t *leaves;
+};
+
+/**
+ * State of index construction.
+ */
+typedef struct ib_ipset_builder_t ib_ipset_builder_t;
+struct ib_ipset_builder_t
+{
+    /** Address length in bits. */
+    size_t            width;
+    /** Bit extraction function. */
+    ib_ipset_bits_fn  bits;
+    /** Network size function. */
+    ib_ipset_size_fn  size;
+    /** Size of an entry. */
+    size_t            entry_size;
+    /** Positive entries, sorted. */
+    const char       *positive;
+    /** Negative entries, sorted. */
+    const char       *negative;
+
+    /** Nodes so far. */
+    ib_ipset_node_t  *nodes;
+    /** Number of nodes. */
+    size_t            num_nodes;
+    /** Allocated nodes. */
+    size_t            nodes_size;
+    /** Leaves so far. */
+    ib_ipset_leaf_t  *leaves;
+    /** Number of leaves. */
+    size_t            num_leaves;
+    /** Allocated leaves. */
+    size_t            leaves_size;
+};
+
+/**
+ * Number of set bits of @a x.
+ *
+ * @param[in] x Value.
+ * @return Number of set bits.
+ */
+static inline
+unsigned ib_ipset_popcount(uint64_t x)
+{
+#ifdef __GNUC__
+    return (unsigned)__builtin_popcountll(x);
+#else
+    unsigned count = 0;
+    while (x != 0) {
+        x &= x - 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+/**
+ * Bit extraction for ib_ip4_t.
+ *
+ * @sa ib_ipset_bits_fn
+ */
+static
+unsigned ib_ipset4_bits(
+    const void *ip,
+    size_t      start,
+    size_t      count
+)
+{
+    uint32_t v = *(const ib_ip4_t *)ip;
+
+    return (unsigned)((v >> (32 - start - count)) & ((1U << count) - 1));
+}
+
+/**
+ * Bit extraction for ib_ip6_t.
+ *
+ * @sa ib_ipset_bits_fn
+ */
+static
+unsigned ib_ipset6_bits(
+    const void *ip,
+    size_t      start,
+    size_t      count
+)
+{
+    const ib_ip6_t *v = (const ib_ip6_t *)ip;
+    size_t          word = start / 32;
+    uint64_t        pair;
+
+    pair = (uint64_t)v->ip[word] << 32;
+    if (word < 3) {
+        pair |= v->ip[word + 1];
+    }
+
+    return (unsigned)(
+        (pair >> (64 - (start % 32) - count)) & ((1U << count) - 1)
+    );
+}
+
+/**
+ * Network size function for ib_ipset4_entry_t.
+ *
+ * @sa ib_ipset_size_fn
+ */
+static
+size_t ib_ipset4_size(const void *entry)
+{
+    return ((const ib_ipset4_entry_t *)entry)->network.size;
+}
+
+/**
+ * Network size function for ib_ipset6_entry_t.
+ *
+ * @sa ib_ipset_size_fn
+ */
+static
+size_t ib_ipset6_size(const void *entry)
+{
+    return ((const ib_ipset6_entry_t *)entry)->network.size;
+}
+
+/**
+ * Append a leaf.
+ *
+ * @param[in,out] builder Builder.
+ * @param[in]     leaf    Leaf to append.
+ * @return
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static
+ib_status_t ib_ipset_builder_leaf(
+    ib_ipset_builder_t    *builder,
+    const ib_ipset_leaf_t *leaf
+)
+{
+    if (builder->num_leaves == builder->leaves_size) {
+        size_t           size = builder->leaves_size * 2 + 64;
+        ib_ipset_leaf_t *leaves =
+            realloc(builder->leaves, size * sizeof(*leaves));
+
+        if (leaves == NULL) {
+            return IB_EALLOC;
+        }
+        builder->leaves      = leaves;
+        builder->leaves_size = size;
+    }
+    builder->leaves[builder->num_leaves] = *leaf;
+    ++builder->num_leaves;
+
+    return IB_OK;
+}
+
+/**
+ * Reserve @a count contiguous nodes.
+ *
+ * @param[in,out] builder Builder.
+ * @param[in]     count   Number of nodes.
+ * @return
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static
+ib_status_t ib_ipset_builder_nodes(
+    ib_ipset_builder_t *builder,
+    size_t              count
+)
+{
+    if (builder->num_nodes + count > builder->nodes_size) {
+        size_t           size = builder->nodes_size * 2 + count + 64;
+        ib_ipset_node_t *nodes =
+            realloc(builder->nodes, size * sizeof(*nodes));
+
+        if (nodes == NULL) {
+            return IB_EALLOC;
+        }
+        builder->nodes      = nodes;
+        builder->nodes_size = size;
+    }
+    builder->num_nodes += count;
+
+    return IB_OK;
+}
+
+/**
+ * Build the trie node for the networks starting with a prefix.
+ *
+ * @param[in,out] builder      Builder.
+ * @param[in]     node_index   Index of the (reserved) node to build.
+ * @param[in]     depth        Length of the prefix.
+ * @param[in]     specific     Most specific positive entry containing the
+ *                             prefix.
+ * @param[in]     general      Most general positive entry containing the
+ *                             prefix.
+ * @param[in]     pos_begin    First positive entry inside the prefix.
+ * @param[in]     pos_end      End of positive entries inside the prefix.
+ * @param[in]     neg_begin    First negative entry inside the prefix.
+ * @param[in]     neg_end      End of negative entries inside the prefix.
+ * @return
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static
+ib_status_t ib_ipset_build_node(
+    ib_ipset_builder_t *builder,
+    size_t              node_index,
+    size_t              depth,
+    uint32_t            specific,
+    uint32_t            general,
+    size_t              pos_begin,
+    size_t              pos_end,
+    size_t              neg_begin,
+    size_t              neg_end
+)
+{
+    size_t          stride = builder->width - depth;
+    size_t          limit;
+    size_t          low;
+    size_t          slots;
+    ib_ipset_leaf_t slot_leaf[1 << IB_IPSET_INDEX_STRIDE];
+    bool            slot_negative[1 << IB_IPSET_INDEX_STRIDE];
+    size_t          slot_pos[(1 << IB_IPSET_INDEX_STRIDE) + 1];
+    size_t          slot_neg[(1 << IB_IPSET_INDEX_STRIDE) + 1];
+    ib_ipset_node_t node = {0, 0, 0, 0};
+    size_t          child;
+    ib_status_t     rc;
+
+    if (stride > IB_IPSET_INDEX_STRIDE) {
+        stride = IB_IPSET_INDEX_STRIDE;
+    }
+    limit = depth + stride;
+    slots = (size_t)1 << stride;
+    /* Networks of size depth or less were applied by the parent. */
+    low = (depth == 0) ? 0 : depth + 1;
+
+#define IB_IPSET_ENTRY(entries, i) \
+    ((const void *)(builder->entries + (i) * builder->entry_size))
+
+    for (size_t v = 0; v < slots; ++v) {
+        slot_leaf[v].specific = specific;
+        slot_leaf[v].general  = general;
+        slot_negative[v]      = false;
+    }
+
+    /* Apply the networks ending within this level. */
+    for (size_t i = neg_begin; i < neg_end; ++i) {
+        const void *entry = IB_IPSET_ENTRY(negative, i);
+        size_t      size  = builder->size(entry);
+
+        if (size >= low && size <= limit) {
+            size_t first = builder->bits(entry, depth, stride);
+            size_t count = (size_t)1 << (limit - size);
+
+            for (size_t v = first; v < first + count; ++v) {
+                slot_negative[v] = true;
+            }
+        }
+    }
+    /* Shortest first so that the most specific network wins. */
+    for (size_t size = low; size <= limit; ++size) {
+        for (size_t i = pos_begin; i < pos_end; ++i) {
+            const void *entry = IB_IPSET_ENTRY(positive, i);
+
+            if (builder->size(entry) == size) {
+                size_t first = builder->bits(entry, depth, stride);
+                size_t count = (size_t)1 << (limit - size);
+
+                for (size_t v = first; v < first + count; ++v) {
+                    slot_leaf[v].specific = (uint32_t)i;
+                    if (slot_leaf[v].general == IB_IPSET_INDEX_NONE) {
+                        slot_leaf[v].general = (uint32_t)i;
+                    }
+                }
+            }
+        }
+    }
+
+    /* Entries are sorted by address, so each slot has a range of them. */
+    slot_pos[0] = pos_begin;
+    slot_neg[0] = neg_begin;
+    for (size_t v = 0; v < slots; ++v) {
+        size_t i;
+        bool   deeper = false;
+
+        for (
+            i = slot_pos[v];
+            i < pos_end &&
+                builder->bits(IB_IPSET_ENTRY(positive, i), depth, stride) == v;
+            ++i
+        ) {
+            if (builder->size(IB_IPSET_ENTRY(positive, i)) > limit) {
+                deeper = true;
+            }
+        }
+        slot_pos[v + 1] = i;
+        for (
+            i = slot_neg[v];
+            i < neg_end &&
+                builder->bits(IB_IPSET_ENTRY(negative, i), depth, stride) == v;
+            ++i
+        ) {
+            if (builder->size(IB_IPSET_ENTRY(negative, i)) > limit) {
+                deeper = true;
+            }
+        }
+        slot_neg[v + 1] = i;
+
+        if (slot_negative[v]) {
+            /* Nothing below a negative network is in the set. */
+            slot_leaf[v].specific = IB_IPSET_INDEX_NONE;
+            slot_leaf[v].general  = IB_IPSET_INDEX_NONE;
+        }
+        else if (deeper) {
+            node.vector |= (uint64_t)1 << v;
+        }
+    }
+
+    /* Leaves, with runs of equal leaves stored once. */
+    node.base0 = (uint32_t)builder->num_leaves;
+    for (size_t v = 0; v < slots; ++v) {
+        const ib_ipset_leaf_t *last;
+
+        if ((node.vector >> v) & 1) {
+            continue;
+        }
+        last = builder->leaves + builder->num_leaves - 1;
+        if (
+            builder->num_leaves == node.base0 ||
+            last->specific != slot_leaf[v].specific ||
+            last->general  != slot_leaf[v].general
+        ) {
+            rc = ib_ipset_builder_leaf(builder, &slot_leaf[v]);
+            if (rc != IB_OK) {
+                return rc;
+            }
+            node.leafvec |= (uint64_t)1 << v;
+        }
+    }
+
+    /* Children are contiguous. */
+    node.base1 = (uint32_t)builder->num_nodes;
+    rc = ib_ipset_builder_nodes(builder, ib_ipset_popcount(node.vector));
+    if (rc != IB_OK) {
+        return rc;
+    }
+    builder->nodes[node_index] = node;
+
+    child = node.base1;
+    for (size_t v = 0; v < slots; ++v) {
+        if (((node.vector >> v) & 1) == 0) {
+            continue;
+        }
+        rc = ib_ipset_build_node(
+            builder,
+            child,
+            limit,
+            slot_leaf[v].specific,
+            slot_leaf[v].general,
+            slot_pos[v], slot_pos[v + 1],
+            slot_neg[v], slot_neg[v + 1]
+        );
+        if (rc != IB_OK) {
+            return rc;
+        }
+        ++child;
+    }
+
+#undef IB_IPSET_ENTRY
+
+    return IB_OK;
+}
+
+/**
+ * Build a trie index.
+ *
+ * @param[out] out_index    Index.
+ * @param[in]  mm           Memory manager to allocate index from.
+ * @param[in]  width        Address length in bits.
+ * @param[in]  bits         Bit extraction function.
+ * @param[in]  size         Network size function.
+ * @param[in]  entry_size   Size of an entry.
+ * @param[in]  negative     Negative entries, sorted.
+ * @param[in]  num_negative Number of entries in @a negative.
+ * @param[in]  positive     Positive entries, sorted.
+ * @param[in]  num_positive Number of entries in @a positive.
+ * @return
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static
+ib_status_t ib_ipset_index_build(
+    const ib_ipset_index_t **out_index,
+    ib_mm_t                  mm,
+    size_t                   width,
+    ib_ipset_bits_fn         bits,
+    ib_ipset_size_fn         size,
+    size_t                   entry_size,
+    const void              *negative,
+    size_t                   num_negative,
+    const void              *positive,
+    size_t                   num_positive
+)
+{
+    assert(out_index != NULL);
+
+    ib_ipset_builder_t  builder;
+    ib_ipset_index_t   *index;
+    ib_ipset_node_t    *nodes;
+    ib_ipset_leaf_t    *leaves;
+    ib_status_t         rc;
+
+    memset(&builder, 0, sizeof(builder));
+    builder.width      = width;
+    builder.bits       = bits;
+    builder.size       = size;
+    builder.entry_size = entry_size;
+    builder.positive   = (const char *)positive;
+    builder.negative   = (const char *)negative;
+
+    rc = ib_ipset_builder_nodes(&builder, 1);
+    if (rc != IB_OK) {
+        goto finish;
+    }
+    rc = ib_ipset_build_node(
+        &builder, 0, 0,
+        IB_IPSET_INDEX_NONE, IB_IPSET_INDEX_NONE,
+        0, num_positive,
+        0, num_negative
+    );
+    if (rc != IB_OK) {
+        goto finish;
+    }
+
+    index  = ib_mm_alloc(mm, sizeof(*index));
+    nodes  = ib_mm_memdup(mm, builder.nodes,
+                          builder.num_nodes * sizeof(*nodes));
+    leaves = ib_mm_memdup(mm, builder.leaves,
+                          builder.num_leaves * sizeof(*leaves));
+    if (index == NULL || nodes == NULL || leaves == NULL) {
+        rc = IB_EALLOC;
+        goto finish;
+    }
+    index->nodes  = nodes;
+    index->leaves = leaves;
+    *out_index = index;
+
+finish:
+    free(builder.nodes);
+    free(builder.leaves);
+
+    return rc;
+}
+
+/**
+ * Query a trie index.
+ *
+ * @param[in]  index              Index.
+ * @param[in]  ip                 IP; ib_ip4_t or ib_ip6_t.
+ * @param[in]  width              Address length in bits.
+ * @param[in]  bits               Bit extraction function.
+ * @param[in]  positive           Positive entries the index refers to.
+ * @param[in]  entry_size         Size of an entry.
+ * @param[out] out_entry          As ib_ipset_query().
+ * @param[out] out_specific_entry As ib_ipset_query().
+ * @param[out] out_general_entry  As ib_ipset_query().
+ * @return
+ * - IB_OK if @a ip is in the set.
+ * - IB_ENOENT if @a ip is not in the set.
+ */
+static
+ib_status_t ib_ipset_index_query(
+    const ib_ipset_index_t *index,
+    const void             *ip,
+    size_t                  width,
+    ib_ipset_bits_fn        bits,
+    const void             *positive,
+    size_t                  entry_size,
+    const void             *out_entry,
+    const void             *out_specific_entry,
+    const void             *out_general_entry
+)
+{
+    assert(index != NULL);
+
+    const ib_ipset_node_t *node  = index->nodes;
+    const ib_ipset_leaf_t *leaf;
+    size_t                 depth = 0;
+    const void            *specific = NULL;
+    const void            *general  = NULL;
+
+    for (;;) {
+        size_t   stride = width - depth;
+        unsigned v;
+
+        if (stride > IB_IPSET_INDEX_STRIDE) {
+            stride = IB_IPSET_INDEX_STRIDE;
+        }
+        v = bits(ip, depth, stride);
+
+        if (((node->vector >> v) & 1) == 0) {
+            /* Count the bits up to and including v. */
+            leaf = &(index->leaves[
+                node->base0 + ib_ipset_popcount(node->leafvec << (63 - v)) - 1
+            ]);
+            break;
+        }
+        node = &(index->nodes[
+            node->base1 + ib_ipset_popcount(node->vector << (63 - v)) - 1
+        ]);
+        depth += stride;
+    }
+
+    if (leaf->specific != IB_IPSET_INDEX_NONE) {
+        specific = (const char *)positive + leaf->specific * entry_size;
+        general  = (const char *)positive + leaf->general  * entry_size;
+    }
+
+    if (out_entry != NULL) {
+        *(const void **)out_entry = specific;
+    }
+    if (out_specific_entry != NULL) {
+        *(const void **)out_specific_entry = specific;
+    }
+    if (out_general_entry != NULL) {
+        *(const void **)out_general_entry = general;
+    }
+
+    return (specific == NULL) ? IB_ENOENT : IB_OK;
+}
+
+/**@}*/
+
 /* Public API */
 
 ib_status_t ib_ipset4_query(
@@ -511,6 +1126,20 @@ ib_status_t ib_ipset4_query(
         return IB_EINVAL;
     }
 
+    if (set->index != NULL) {
+        return ib_ipset_index_query(
+            set->index,
+            &ip,
+            32,
+            &ib_ipset4_bits,
+            set->positive,
+            sizeof(ib_ipset4_entry_t),
+            out_entry,
+            out_specific_entry,
+            out_general_entry
+        );
+    }
+
     return ib_ipset_query(
         &net,
         set->negative,
@@ -539,6 +1168,20 @@ ib_status_t ib_ipset6_query(
         return IB_EINVAL;
     }
 
+    if (set->index != NULL) {
+        return ib_ipset_index_query(
+            set->index,
+            &ip,
+            128,
+            &ib_ipset6_bits,
+            set->positive,
+            sizeof(ib_ipset6_entry_t),
+            out_entry,
+            out_specific_entry,
+            out_general_entry
+        );
+    }
+
     return ib_ipset_query(
         &net,
         set->negative,
@@ -573,6 +1216,7 @@ ib_status_t ib_ipset4_init(
     set->num_negative = num_negative;
     set->positive     = positive;
     set->num_positive = num_positive;
+    set->index        = NULL;
 
     for (size_t i = 0; i < set->num_negative; ++i) {
         set->negative[i].network.ip =
@@ -620,6 +1264,7 @@ ib_status_t ib_ipset6_init(
     set->num_negative = num_negative;
     set->positive     = positive;
     set->num_positive = num_positive;
+    set->index        = NULL;
 
     for (size_t i = 0; i < set->num_negative; ++i) {
         set->negative[i].network.ip =
@@ -646,3 +1291,49 @@ ib_status_t ib_ipset6_init(
 
     return IB_OK;
 }
+
+ib_status_t ib_ipset4_index(
+    ib_ipset4_t *set,
+    ib_mm_t      mm
+)
+{
+    if (set == NULL) {
+        return IB_EINVAL;
+    }
+
+    return ib_ipset_index_build(
+        &(set->index),
+        mm,
+        32,
+        &ib_ipset4_bits,
+        &ib_ipset4_size,
+        sizeof(ib_ipset4_entry_t),
+        set->negative,
+        set->num_negative,
+        set->positive,
+        set->num_positive
+    );
+}
+
+ib_status_t ib_ipset6_index(
+    ib_ipset6_t *set,
+    ib_mm_t      mm
+)
+{
+    if (set == NULL) {
+        return IB_EINVAL;
+    }
+
+    return ib_ipset_index_build(
+        &(set->index),
+        mm,
+        128,
+        &ib_ipset6_bits,
+        &ib_ipset6_size,
+        sizeof(ib_ipset6_entry_t),
+        set->negative,
+        set->num_negative,
+        set->positive,
+        set->num_positive
+    );
+}
@@ -0,0 +1,684 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Read-through cache of another key-value store.
+ *
+ * Entries are allocated when the cache is created and linked into hash
+ * buckets, a least recently used list and a free list by index.  Each
+ * entry in use owns a lite memory pool holding its key and value, which
+ * is destroyed when the entry is evicted or invalidated.
+ *
+ * The backing store is never called with the cache locked.  A get that
+ * misses records the write generation of the cache before reading the
+ * backing store, and only caches the result if no set or remove happened
+ * meanwhile, so a concurrent write can not be overwritten with the value
+ * it replaced.
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/kvstore_cache.h>
+
+#include "kvstore_private.h"
+
+#include <ironbee/clock.h>
+#include <ironbee/hash.h>
+#include <ironbee/kvstore.h>
+#include <ironbee/lock.h>
+#include <ironbee/mm_mpool_lite.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Marker for no entry in cache indices.
+ */
+#define CACHE_NONE ((size_t)-1)
+
+/**
+ * A cached key and its value.
+ */
+typedef struct {
+    ib_mpool_lite_t    *mp;          /**< Memory of key and value. */
+    const uint8_t      *key;         /**< Key. */
+    size_t              key_length;  /**< Length of @ref key. */
+    uint32_t            hash;        /**< Hash of @ref key. */
+    ib_kvstore_value_t *value;       /**< Value; NULL if key is absent. */
+    ib_time_t           fetched;     /**< When read from the backing store. */
+    size_t              bucket_next; /**< Next in bucket or free list. */
+    size_t              lru_prev;    /**< Next more recently used entry. */
+    size_t              lru_next;    /**< Next less recently used entry. */
+} cache_entry_t;
+
+/**
+ * The cache server object.
+ */
+typedef struct {
+    ib_kvstore_t  *backing;     /**< Backing store. */
+    ib_lock_t     *lock;        /**< Protects everything below. */
+    ib_time_t      max_age;     /**< Maximum age of entries; 0 for none. */
+    cache_entry_t *entries;     /**< Entries. */
+    size_t        *buckets;     /**< First entry of each bucket. */
+    size_t         bucket_mask; /**< Number of buckets minus one. */
+    uint32_t       randomizer;  /**< Hash randomizer. */
+    size_t         free_head;   /**< First unused entry. */
+    size_t         lru_head;    /**< Most recently used entry. */
+    size_t         lru_tail;    /**< Least recently used entry. */
+    uint64_t       generation;  /**< Incremented by every set and remove. */
+} cache_server_t;
+
+/**
+ * Current time.
+ *
+ * @returns Current time.
+ */
+static ib_time_t cache_now(void)
+{
+    ib_timeval_t tv;
+
+    ib_clock_gettimeofday(&tv);
+    return IB_CLOCK_TIMEVAL_TIME(tv);
+}
+
+/**
+ * Find the entry for a key.
+ *
+ * @param[in] server Server.
+ * @param[in] key Key data.
+ * @param[in] key_length Length of @a key.
+ * @param[in] hash Hash of @a key.
+ *
+ * @returns Index of entry or CACHE_NONE.
+ */
+static size_t cache_find(
+    const cache_server_t *server,
+    const uint8_t        *key,
+    size_t                key_length,
+    uint32_t              hash
+)
+{
+    for (
+        size_t i = server->buckets[hash & server->bucket_mask];
+        i != CACHE_NONE;
+        i = server->entries[i].bucket_next
+    ) {
+        const cache_entry_t *entry = &(server->entries[i]);
+
+        if (
+            entry->hash == hash &&
+            entry->key_length == key_length &&
+            (key_length == 0 || memcmp(entry->key, key, key_length) == 0)
+        ) {
+            return i;
+        }
+    }
+
+    return CACHE_NONE;
+}
+
+/**
+ * Remove entry @a i from the LRU list.
+ *
+ * @param[in] server Server.
+ * @param[in] i Index of entry.
+ */
+static void cache_lru_unlink(cache_server_t *server, size_t i)
+{
+    cache_entry_t *entry = &(server->entries[i]);
+
+    if (entry->lru_prev == CACHE_NONE) {
+        server->lru_head = entry->lru_next;
+    }
+    else {
+        server->entries[entry->lru_prev].lru_next = entry->lru_next;
+    }
+    if (entry->lru_next == CACHE_NONE) {
+        server->lru_tail = entry->lru_prev;
+    }
+    else {
+        server->entries[entry->lru_next].lru_prev = entry->lru_prev;
+    }
+}
+
+/**
+ * Make entry @a i the most recently used entry.
+ *
+ * @param[in] server Server.
+ * @param[in] i Index of entry; must not be in the LRU list.
+ */
+static void cache_lru_push(cache_server_t *server, size_t i)
+{
+    cache_entry_t *entry = &(server->entries[i]);
+
+    entry->lru_prev = CACHE_NONE;
+    entry->lru_next = server->lru_head;
+    if (server->lru_head == CACHE_NONE) {
+        server->lru_tail = i;
+    }
+    else {
+        server->entries[server->lru_head].lru_prev = i;
+    }
+    server->lru_head = i;
+}
+
+/**
+ * Drop entry @a i and return it to the free list.
+ *
+ * @param[in] server Server.
+ * @param[in] i Index of entry in use.
+ */
+static void cache_drop(cache_server_t *server, size_t i)
+{
+    cache_entry_t *entry = &(server->entries[i]);
+    size_t        *link;
+
+    link = &(server->buckets[entry->hash & server->bucket_mask]);
+    while (*link != i) {
+        assert(*link != CACHE_NONE);
+        link = &(server->entries[*link].bucket_next);
+    }
+    *link = entry->bucket_next;
+
+    cache_lru_unlink(server, i);
+
+    ib_mpool_lite_destroy(entry->mp);
+    entry->mp    = NULL;
+    entry->value = NULL;
+
+    entry->bucket_next = server->free_head;
+    server->free_head  = i;
+}
+
+/**
+ * Cache @a value as the value of a key.
+ *
+ * Evicts the least recently used entry if there is no free entry.
+ * Failure to allocate is ignored; the value is simply not cached.
+ *
+ * @param[in] server Server.
+ * @param[in] key Key data.
+ * @param[in] key_length Length of @a key.
+ * @param[in] hash Hash of @a key.
+ * @param[in] value Value or NULL if the key is absent.
+ */
+static void cache_insert(
+    cache_server_t           *server,
+    const uint8_t            *key,
+    size_t                    key_length,
+    uint32_t                  hash,
+    const ib_kvstore_value_t *value
+)
+{
+    cache_entry_t   *entry;
+    ib_mpool_lite_t *mp;
+    ib_mm_t          mm;
+    uint8_t         *key_copy;
+    size_t           i;
+
+    if (ib_mpool_lite_create(&mp) != IB_OK) {
+        return;
+    }
+    mm = ib_mm_mpool_lite(mp);
+
+    if (server->free_head == CACHE_NONE) {
+        assert(server->lru_tail != CACHE_NONE);
+        cache_drop(server, server->lru_tail);
+    }
+    i = server->free_head;
+    entry = &(server->entries[i]);
+
+    key_copy = ib_mm_alloc(mm, key_length + 1);
+    entry->value = NULL;
+    if (
+        key_copy == NULL ||
+        (
+            value != NULL &&
+            ib_kvstore_value_dup(mm, value, &(entry->value)) != IB_OK
+        )
+    ) {
+        ib_mpool_lite_destroy(mp);
+        return;
+    }
+    memcpy(key_copy, key, key_length);
+    entry->key = key_copy;
+
+    server->free_head  = entry->bucket_next;
+    entry->mp          = mp;
+    entry->key_length  = key_length;
+    entry->hash        = hash;
+    entry->fetched     = cache_now();
+    entry->bucket_next = server->buckets[hash & server->bucket_mask];
+    server->buckets[hash & server->bucket_mask] = i;
+    cache_lru_push(server, i);
+}
+
+/**
+ * Lookup a key in the cache.
+ *
+ * @param[in] server Server.
+ * @param[in] key Key data.
+ * @param[in] key_length Length of @a key.
+ * @param[in] hash Hash of @a key.
+ * @param[in] mm Memory manager to copy the value into.
+ * @param[out] value Copy of the value, or NULL if the key is absent.
+ *
+ * @returns
+ *   - IB_OK on hit.
+ *   - IB_ENOENT on miss.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t cache_lookup(
+    cache_server_t      *server,
+    const uint8_t       *key,
+    size_t               key_length,
+    uint32_t             hash,
+    ib_mm_t              mm,
+    ib_kvstore_value_t **value
+)
+{
+    ib_time_t      now = cache_now();
+    cache_entry_t *entry;
+    size_t         i;
+
+    i = cache_find(server, key, key_length, hash);
+    if (i == CACHE_NONE) {
+        return IB_ENOENT;
+    }
+    entry = &(server->entries[i]);
+
+    if (
+        (server->max_age > 0 && now - entry->fetched > server->max_age) ||
+        (
+            entry->value != NULL &&
+            ib_kvstore_value_expiration_get(entry->value) < now
+        )
+    ) {
+        cache_drop(server, i);
+        return IB_ENOENT;
+    }
+
+    cache_lru_unlink(server, i);
+    cache_lru_push(server, i);
+
+    if (entry->value == NULL) {
+        *value = NULL;
+        return IB_OK;
+    }
+
+    return ib_kvstore_value_dup(mm, entry->value, value);
+}
+
+/**
+ * Drop the cached value of a key and start a new write generation.
+ *
+ * @param[in] server Server; must be locked.
+ * @param[in] key Key.
+ */
+static void cache_invalidate(cache_server_t *server, const ib_kvstore_key_t *key)
+{
+    const uint8_t *key_data;
+    size_t         key_length;
+    size_t         i;
+
+    ib_kvstore_key_get(key, &key_data, &key_length);
+
+    ++server->generation;
+
+    i = cache_find(
+        server,
+        key_data,
+        key_length,
+        ib_hashfunc_djb2(
+            (const char *)key_data, key_length, server->randomizer, NULL
+        )
+    );
+    if (i != CACHE_NONE) {
+        cache_drop(server, i);
+    }
+}
+
+/**
+ * Trivial merge policy that returns the first value in the list
+ * if the list is size 1 or greater.
+ *
+ * The cache only ever returns one value; the backing store's own merge
+ * policy is applied on a miss.
+ *
+ * @param[in] kvstore Key-value store.
+ * @param[in] key The key that the values are listed under.
+ * @param[in] values Array of @ref ib_kvstore_value_t pointers.
+ * @param[in] value_size The length of values.
+ * @param[out] resultant_value Pointer to values[0] if value_size > 0.
+ * @param[in,out] cbdata Context callback data.
+ * @returns IB_OK
+ */
+static ib_status_t kvstore_cache_merge_policy(
+    ib_kvstore_t            *kvstore,
+    const ib_kvstore_key_t  *key,
+    ib_kvstore_value_t     **values,
+    size_t                   value_size,
+    ib_kvstore_value_t     **resultant_value,
+    ib_kvstore_cbdata_t     *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(key != NULL);
+    assert(resultant_value != NULL);
+
+    if (value_size > 0) {
+        *resultant_value = values[0];
+    }
+
+    return IB_OK;
+}
+
+static ib_status_t kvconnect(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    cache_server_t *server = (cache_server_t *)kvstore->server;
+
+    return ib_kvstore_connect(server->backing);
+}
+
+static ib_status_t kvdisconnect(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    cache_server_t *server = (cache_server_t *)kvstore->server;
+
+    return ib_kvstore_disconnect(server->backing);
+}
+
+/**
+ * Get implementation.
+ *
+ * @param[in] kvstore The key-value store.
+ * @param[in] mm Memory manager to allocate @a values out of.
+ * @param[in] key The key to fetch.
+ * @param[out] values A pointer to an array of pointers.
+ * @param[out] values_length The length of *values.
+ * @param[in,out] cbdata Callback data. Unused.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_ENOENT if @a key has no value.
+ *   - IB_EALLOC on allocation failure.
+ *   - Other on failure of the backing store.
+ */
+static ib_status_t kvget(
+    ib_kvstore_t             *kvstore,
+    ib_mm_t                   mm,
+    const ib_kvstore_key_t   *key,
+    ib_kvstore_value_t     ***values,
+    size_t                   *values_length,
+    ib_kvstore_cbdata_t      *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+    assert(key != NULL);
+
+    cache_server_t      *server = (cache_server_t *)kvstore->server;
+    const uint8_t       *key_data;
+    size_t               key_length;
+    uint32_t             hash;
+    uint64_t             generation;
+    ib_kvstore_value_t  *value = NULL;
+    ib_kvstore_value_t **array;
+    ib_status_t          rc;
+
+    ib_kvstore_key_get(key, &key_data, &key_length);
+    hash = ib_hashfunc_djb2(
+        (const char *)key_data, key_length, server->randomizer, NULL
+    );
+
+    array = ib_mm_alloc(mm, sizeof(*array));
+    if (array == NULL) {
+        return IB_EALLOC;
+    }
+
+    rc = ib_lock_lock(server->lock);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = cache_lookup(server, key_data, key_length, hash, mm, &value);
+    generation = server->generation;
+    ib_lock_unlock(server->lock);
+
+    if (rc == IB_ENOENT) {
+        rc = ib_kvstore_get(server->backing, NULL, mm, key, &value);
+        if (rc != IB_OK && rc != IB_ENOENT) {
+            return rc;
+        }
+
+        if (ib_lock_lock(server->lock) == IB_OK) {
+            if (
+                server->generation == generation &&
+                cache_find(server, key_data, key_length, hash) == CACHE_NONE
+            ) {
+                cache_insert(server, key_data, key_length, hash, value);
+            }
+            ib_lock_unlock(server->lock);
+        }
+    }
+    else if (rc != IB_OK) {
+        return rc;
+    }
+
+    if (value == NULL) {
+        return IB_ENOENT;
+    }
+
+    array[0]       = value;
+    *values        = array;
+    *values_length = 1;
+
+    return IB_OK;
+}
+
+/**
+ * Set implementation.
+ *
+ * Writes through to the backing store and drops the cached value.
+ *
+ * @param[in] kvstore Key-value store.
+ * @param[in] merge_policy Passed to the backing store.
+ * @param[in] key The key to set.
+ * @param[in] value The value to write.
+ * @param[in,out] cbdata Callback data for the user.
+ *
+ * @returns Result of setting the backing store.
+ */
+static ib_status_t kvset(
+    ib_kvstore_t                 *kvstore,
+    ib_kvstore_merge_policy_fn_t  merge_policy,
+    const ib_kvstore_key_t       *key,
+    ib_kvstore_value_t           *value,
+    ib_kvstore_cbdata_t          *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+    assert(key != NULL);
+    assert(value != NULL);
+
+    cache_server_t *server = (cache_server_t *)kvstore->server;
+    ib_status_t     rc;
+
+    /* Cached values carry the absolute expiration the backing store
+     * reports, not the relative one given here, so the value is read
+     * back rather than cached. */
+    rc = ib_kvstore_set(server->backing, merge_policy, key, value);
+
+    if (ib_lock_lock(server->lock) == IB_OK) {
+        cache_invalidate(server, key);
+        ib_lock_unlock(server->lock);
+    }
+
+    return rc;
+}
+
+/**
+ * Remove implementation.
+ *
+ * @param[in] kvstore Store.
+ * @param[in] key Key.
+ * @param[in,out] cbdata Callback data.
+ *
+ * @returns Result of removing from the backing store.
+ */
+static ib_status_t kvremove(
+    ib_kvstore_t *kvstore,
+    const ib_kvstore_key_t *key,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+    assert(key != NULL);
+
+    cache_server_t *server = (cache_server_t *)kvstore->server;
+    ib_status_t     rc;
+
+    rc = ib_kvstore_remove(server->backing, key);
+
+    if (ib_lock_lock(server->lock) == IB_OK) {
+        cache_invalidate(server, key);
+        ib_lock_unlock(server->lock);
+    }
+
+    return rc;
+}
+
+/**
+ * Destroy any allocated elements of the kvstore structure.
+ * @param[out] kvstore to be destroyed. The backing store is untouched.
+ * @param[in] cbdata Unused.
+ */
+static void kvdestroy(ib_kvstore_t* kvstore, ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+
+    cache_server_t *server = (cache_server_t *)(kvstore->server);
+
+    while (server->lru_head != CACHE_NONE) {
+        cache_drop(server, server->lru_head);
+    }
+    ib_lock_destroy_malloc(server->lock);
+    free(server->buckets);
+    free(server->entries);
+    free(server);
+    kvstore->server = NULL;
+
+    return;
+}
+
+ib_status_t ib_kvstore_cache_init(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_t *backing,
+    size_t        capacity,
+    ib_time_t     max_age)
+{
+    assert(kvstore != NULL);
+    assert(backing != NULL);
+
+    ib_status_t     rc;
+    cache_server_t *server;
+    size_t          buckets = 1;
+
+    if (capacity == 0) {
+        return IB_EINVAL;
+    }
+
+    /* There is no callback data used for this implementation. */
+    ib_kvstore_init(kvstore);
+
+    server = calloc(1, sizeof(*server));
+    if (server == NULL) {
+        return IB_EALLOC;
+    }
+
+    while (buckets < capacity) {
+        buckets *= 2;
+    }
+
+    server->entries = calloc(capacity, sizeof(*server->entries));
+    server->buckets = malloc(buckets * sizeof(*server->buckets));
+    if (server->entries == NULL || server->buckets == NULL) {
+        free(server->entries);
+        free(server->buckets);
+        free(server);
+        return IB_EALLOC;
+    }
+
+    rc = ib_lock_create_malloc(&(server->lock));
+    if (rc != IB_OK) {
+        free(server->entries);
+        free(server->buckets);
+        free(server);
+        return rc;
+    }
+
+    for (size_t i = 0; i < buckets; ++i) {
+        server->buckets[i] = CACHE_NONE;
+    }
+    for (size_t i = 0; i < capacity; ++i) {
+        server->entries[i].bucket_next = (i + 1 < capacity) ? i + 1 : CACHE_NONE;
+    }
+
+    server->backing     = backing;
+    server->max_age     = max_age;
+    server->bucket_mask = buckets - 1;
+    server->randomizer  = (uint32_t)clock();
+    server->free_head   = 0;
+    server->lru_head    = CACHE_NONE;
+    server->lru_tail    = CACHE_NONE;
+    server->generation  = 0;
+
+    kvstore->server = (ib_kvstore_server_t *)server;
+    kvstore->get = kvget;
+    kvstore->set = kvset;
+    kvstore->remove = kvremove;
+    kvstore->connect = kvconnect;
+    kvstore->disconnect = kvdisconnect;
+    kvstore->destroy = kvdestroy;
+    kvstore->default_merge_policy = kvstore_cache_merge_policy;
+
+    kvstore->malloc_cbdata = NULL;
+    kvstore->free_cbdata = NULL;
+    kvstore->connect_cbdata = NULL;
+    kvstore->disconnect_cbdata = NULL;
+    kvstore->get_cbdata = NULL;
+    kvstore->set_cbdata = NULL;
+    kvstore->remove_cbdata = NULL;
+    kvstore->merge_policy_cbdata = NULL;
+    kvstore->destroy_cbdata = NULL;
+
+    return IB_OK;
+}
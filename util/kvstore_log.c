@@ -0,0 +1,1194 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Persist to a memory-mapped log file.
+ *
+ * The file starts with @ref LOG_MAGIC and is followed by records, each a
+ * @ref record_header_t, the key, the type and the value, padded to
+ * @ref RECORD_ALIGN bytes.  Records are only ever appended, from a single
+ * @c write() while holding an exclusive @c flock() on the file.
+ *
+ * Readers do not lock the file.  They only index records that are
+ * complete, so a record that another process is still writing is picked up
+ * by a later operation.  A writer that finds an incomplete record at the
+ * end of the file while holding the lock knows it is left over from a
+ * crash and truncates it.
+ *
+ * Compaction writes the current records to a temporary file and renames
+ * it over the log while holding the lock on the old file.  Every operation
+ * compares the inode of the path to that of its open file and reopens the
+ * log if it has been replaced.
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/kvstore_log.h>
+
+#include "kvstore_private.h"
+
+#include <ironbee/clock.h>
+#include <ironbee/hash.h>
+#include <ironbee/kvstore.h>
+#include <ironbee/lock.h>
+#include <ironbee/mm_mpool_lite.h>
+#include <ironbee/util.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * The default fmode for the created log file.
+ */
+static const mode_t DEFAULT_FILE_MODE = 0644;
+
+/**
+ * Magic at the start of a log file.
+ */
+static const char LOG_MAGIC[8] = { 'I', 'B', 'K', 'V', 'L', 'O', 'G', '1' };
+
+/**
+ * Magic at the start of each record.
+ */
+#define RECORD_MAGIC 0x524c564bU
+
+/**
+ * Record flag: the record removes its key.
+ */
+#define RECORD_REMOVE 0x1U
+
+/**
+ * Records are padded to a multiple of this many bytes.
+ */
+#define RECORD_ALIGN 8
+
+/**
+ * Compaction is not considered until this many bytes are dead.
+ */
+#define COMPACT_MIN_DEAD (1024 * 1024)
+
+/**
+ * The file is mapped in multiples of this many bytes.
+ *
+ * Mapping past the end of the file lets the file grow without being mapped
+ * again on every write; pages past the end of the file are never read.
+ */
+#define MAP_CHUNK (1024 * 1024)
+
+/**
+ * Header of each record.
+ */
+typedef struct {
+    uint32_t magic;        /**< RECORD_MAGIC. */
+    uint32_t flags;        /**< RECORD_REMOVE or 0. */
+    uint32_t key_length;   /**< Length of the key. */
+    uint32_t type_length;  /**< Length of the type. */
+    uint64_t value_length; /**< Length of the value. */
+    uint64_t expiration;   /**< Absolute expiration time. */
+    uint64_t creation;     /**< Creation time. */
+} record_header_t;
+
+/**
+ * Index entry: the latest record of a key.
+ */
+typedef struct {
+    size_t offset;  /**< Offset of the record in the file. */
+    size_t length;  /**< Padded length of the record. */
+    bool   removed; /**< The record removes the key. */
+} index_entry_t;
+
+/**
+ * The log server object.
+ */
+typedef struct {
+    char            *path;       /**< Path of the log file. */
+    mode_t           fmode;      /**< Mode of the created log file. */
+    ib_lock_t       *lock;       /**< Serializes threads of this process. */
+    int              fd;         /**< Log file; -1 if not connected. */
+    dev_t            dev;        /**< Device of @ref fd. */
+    ino_t            ino;        /**< Inode of @ref fd. */
+    const uint8_t   *map;        /**< Memory map of @ref fd; may be NULL. */
+    size_t           map_length; /**< Length of @ref map. */
+    size_t           end;        /**< End of the last indexed record. */
+    size_t           live;       /**< Bytes of current records. */
+    size_t           dead;       /**< Bytes of superseded records. */
+    ib_mpool_lite_t *index_mp;   /**< Memory of @ref index. */
+    ib_hash_t       *index;      /**< Key to index_entry_t. */
+} log_server_t;
+
+/**
+ * Padded length of the record with header @a header.
+ *
+ * @param[in] header Record header.
+ *
+ * @returns Length of the record.
+ */
+static size_t record_length(const record_header_t *header)
+{
+    size_t length = sizeof(*header) +
+                    header->key_length +
+                    header->type_length +
+                    header->value_length;
+
+    return (length + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+}
+
+/**
+ * Current time.
+ *
+ * @returns Current time.
+ */
+static ib_time_t log_now(void)
+{
+    ib_timeval_t tv;
+
+    ib_clock_gettimeofday(&tv);
+    return IB_CLOCK_TIMEVAL_TIME(tv);
+}
+
+/**
+ * Discard the index of @a server and start an empty one.
+ *
+ * @param[in] server Server.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t log_index_reset(log_server_t *server)
+{
+    ib_status_t rc;
+
+    if (server->index_mp != NULL) {
+        ib_mpool_lite_destroy(server->index_mp);
+        server->index_mp = NULL;
+        server->index    = NULL;
+    }
+
+    rc = ib_mpool_lite_create(&(server->index_mp));
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_hash_create(&(server->index), ib_mm_mpool_lite(server->index_mp));
+    if (rc != IB_OK) {
+        ib_mpool_lite_destroy(server->index_mp);
+        server->index_mp = NULL;
+        return rc;
+    }
+
+    server->end  = sizeof(LOG_MAGIC);
+    server->live = 0;
+    server->dead = 0;
+
+    return IB_OK;
+}
+
+/**
+ * Make the record at @a offset the latest record of its key.
+ *
+ * @param[in] server Server.
+ * @param[in] offset Offset of the record in @ref log_server_t::map.
+ * @param[in] header Record header.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t log_index_apply(
+    log_server_t          *server,
+    size_t                 offset,
+    const record_header_t *header
+)
+{
+    const char    *key    = (const char *)(server->map + offset +
+                                           sizeof(*header));
+    size_t         length = record_length(header);
+    bool           remove = (header->flags & RECORD_REMOVE) != 0;
+    index_entry_t *entry;
+    ib_status_t    rc;
+
+    rc = ib_hash_get_ex(server->index, &entry, key, header->key_length);
+    if (rc == IB_OK) {
+        if (! entry->removed) {
+            server->live -= entry->length;
+            server->dead += entry->length;
+        }
+    }
+    else {
+        ib_mm_t  mm = ib_mm_mpool_lite(server->index_mp);
+        char    *key_copy;
+
+        entry = ib_mm_alloc(mm, sizeof(*entry));
+        key_copy = ib_mm_alloc(mm, header->key_length + 1);
+        if (entry == NULL || key_copy == NULL) {
+            return IB_EALLOC;
+        }
+        memcpy(key_copy, key, header->key_length);
+        key_copy[header->key_length] = '\0';
+
+        rc = ib_hash_set_ex(
+            server->index, key_copy, header->key_length, entry
+        );
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    entry->offset  = offset;
+    entry->length  = length;
+    entry->removed = remove;
+    if (remove) {
+        server->dead += length;
+    }
+    else {
+        server->live += length;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Unmap the log file of @a server.
+ *
+ * @param[in] server Server.
+ */
+static void log_unmap(log_server_t *server)
+{
+    if (server->map != NULL) {
+        munmap((void *)server->map, server->map_length);
+        server->map        = NULL;
+        server->map_length = 0;
+    }
+}
+
+/**
+ * Index the complete records added to the log file since the last scan.
+ *
+ * The file is mapped again if it has grown.  Scanning stops at the first
+ * incomplete record.
+ *
+ * @param[in] server Server.
+ * @param[out] size If not NULL, the size of the file.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EOTHER on system call failure.
+ *   - IB_EINVAL if a record is corrupt.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t log_scan(log_server_t *server, size_t *size)
+{
+    struct stat sb;
+    size_t      limit;
+    ib_status_t rc;
+
+    if (fstat(server->fd, &sb) != 0) {
+        return IB_EOTHER;
+    }
+
+    if ((size_t)sb.st_size > server->map_length) {
+        size_t  length = ((size_t)sb.st_size + MAP_CHUNK - 1) &
+                         ~(size_t)(MAP_CHUNK - 1);
+        void   *map;
+
+        log_unmap(server);
+        map = mmap(NULL, length, PROT_READ, MAP_SHARED, server->fd, 0);
+        if (map == MAP_FAILED) {
+            return IB_EOTHER;
+        }
+        server->map        = map;
+        server->map_length = length;
+    }
+
+    /* The map is usually longer than the file; never read past its end. */
+    limit = (size_t)sb.st_size;
+
+    while (server->end + sizeof(record_header_t) <= limit) {
+        record_header_t header;
+        size_t          length;
+
+        memcpy(&header, server->map + server->end, sizeof(header));
+        if (header.magic != RECORD_MAGIC) {
+            ib_util_log_error(
+                "kvstore: Corrupt record at offset %zd of \"%s\".",
+                server->end, server->path
+            );
+            return IB_EINVAL;
+        }
+
+        length = record_length(&header);
+        if (server->end + length > limit) {
+            break;
+        }
+
+        rc = log_index_apply(server, server->end, &header);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        server->end += length;
+    }
+
+    if (size != NULL) {
+        *size = limit;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Close the log file of @a server.
+ *
+ * @param[in] server Server.
+ */
+static void log_close(log_server_t *server)
+{
+    log_unmap(server);
+    if (server->fd >= 0) {
+        close(server->fd);
+        server->fd = -1;
+    }
+}
+
+/**
+ * Lock the log file of @a server against other writers.
+ *
+ * Also truncates any incomplete record left at the end of the file, as no
+ * other process can be writing it.
+ *
+ * @param[in] server Server.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EOTHER on system call failure.
+ *   - Other on failure of log_scan().
+ */
+static ib_status_t log_lock(log_server_t *server)
+{
+    ib_status_t rc;
+    size_t      size;
+
+    if (flock(server->fd, LOCK_EX) != 0) {
+        return IB_EOTHER;
+    }
+
+    rc = log_scan(server, &size);
+    if (rc != IB_OK) {
+        flock(server->fd, LOCK_UN);
+        return rc;
+    }
+
+    if (server->end < size) {
+        ib_util_log_error(
+            "kvstore: Truncating incomplete record at offset %zd of \"%s\".",
+            server->end, server->path
+        );
+        if (ftruncate(server->fd, server->end) != 0) {
+            flock(server->fd, LOCK_UN);
+            return IB_EOTHER;
+        }
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Unlock the log file of @a server.
+ *
+ * @param[in] server Server.
+ */
+static void log_unlock(log_server_t *server)
+{
+    flock(server->fd, LOCK_UN);
+}
+
+/**
+ * Open, and if necessary create, the log file of @a server and index it.
+ *
+ * @param[in] server Server.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EOTHER on system call failure.
+ *   - IB_EINVAL if the file is not a log file or is corrupt.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t log_open(log_server_t *server)
+{
+    struct stat sb;
+    ib_status_t rc;
+
+    assert(server->fd < 0);
+
+    rc = log_index_reset(server);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    server->fd = open(
+        server->path, O_RDWR | O_CREAT | O_APPEND, server->fmode
+    );
+    if (server->fd < 0) {
+        ib_util_log_error("kvstore: Failed to open \"%s\": %s",
+                          server->path, strerror(errno));
+        return IB_EOTHER;
+    }
+
+    if (flock(server->fd, LOCK_EX) != 0 || fstat(server->fd, &sb) != 0) {
+        rc = IB_EOTHER;
+        goto fail;
+    }
+    server->dev = sb.st_dev;
+    server->ino = sb.st_ino;
+
+    if (sb.st_size == 0) {
+        if (
+            write(server->fd, LOG_MAGIC, sizeof(LOG_MAGIC)) !=
+            (ssize_t)sizeof(LOG_MAGIC)
+        ) {
+            rc = IB_EOTHER;
+            goto fail;
+        }
+    }
+    else {
+        char magic[sizeof(LOG_MAGIC)];
+
+        if (
+            pread(server->fd, magic, sizeof(magic), 0) !=
+                (ssize_t)sizeof(magic) ||
+            memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0
+        ) {
+            ib_util_log_error("kvstore: \"%s\" is not a log file.",
+                              server->path);
+            rc = IB_EINVAL;
+            goto fail;
+        }
+    }
+
+    flock(server->fd, LOCK_UN);
+
+    rc = log_lock(server);
+    if (rc != IB_OK) {
+        goto fail;
+    }
+    log_unlock(server);
+
+    return IB_OK;
+
+fail:
+    log_close(server);
+    return rc;
+}
+
+/**
+ * Bring @a server up to date with the log file.
+ *
+ * Reopens the log file if it was replaced by compaction.
+ *
+ * @param[in] server Server.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EINVAL if not connected.
+ *   - Other on failure of log_open() or log_scan().
+ */
+static ib_status_t log_refresh(log_server_t *server)
+{
+    struct stat sb;
+
+    if (server->fd < 0) {
+        return IB_EINVAL;
+    }
+
+    if (
+        stat(server->path, &sb) != 0 ||
+        sb.st_dev != server->dev ||
+        sb.st_ino != server->ino
+    ) {
+        log_close(server);
+        return log_open(server);
+    }
+
+    return log_scan(server, NULL);
+}
+
+/**
+ * Lock the current log file of @a server against other writers.
+ *
+ * The log file may be replaced while waiting for the lock, in which case
+ * the new file is opened and locked instead.
+ *
+ * @param[in] server Server.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - Other on failure of log_refresh() or log_lock().
+ */
+static ib_status_t log_lock_current(log_server_t *server)
+{
+    for (;;) {
+        struct stat sb;
+        ib_status_t rc;
+
+        rc = log_refresh(server);
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+        rc = log_lock(server);
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+        if (
+            stat(server->path, &sb) == 0 &&
+            sb.st_dev == server->dev &&
+            sb.st_ino == server->ino
+        ) {
+            return IB_OK;
+        }
+
+        /* Compacted while waiting for the lock. */
+        log_unlock(server);
+    }
+}
+
+/**
+ * Rewrite the log file of @a server with only its current records.
+ *
+ * Must be called with the log file locked.  On success, the new log file
+ * is open and unlocked.  On failure, the old log file is left as it was,
+ * still locked.
+ *
+ * @param[in] server Server.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EOTHER on system call failure.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t log_compact(log_server_t *server)
+{
+    ib_hash_iterator_t *iterator;
+    ib_time_t           now = log_now();
+    char               *tmp_path;
+    int                 tmp_fd;
+    ib_status_t         rc = IB_OK;
+
+    tmp_path = malloc(strlen(server->path) + sizeof(".XXXXXX"));
+    iterator = ib_hash_iterator_create_malloc();
+    if (tmp_path == NULL || iterator == NULL) {
+        free(tmp_path);
+        free(iterator);
+        return IB_EALLOC;
+    }
+    sprintf(tmp_path, "%s.XXXXXX", server->path);
+
+    tmp_fd = mkstemp(tmp_path);
+    if (tmp_fd < 0) {
+        free(tmp_path);
+        free(iterator);
+        return IB_EOTHER;
+    }
+
+    if (
+        fchmod(tmp_fd, server->fmode) != 0 ||
+        write(tmp_fd, LOG_MAGIC, sizeof(LOG_MAGIC)) !=
+            (ssize_t)sizeof(LOG_MAGIC)
+    ) {
+        rc = IB_EOTHER;
+        goto cleanup;
+    }
+
+    for (
+        ib_hash_iterator_first(iterator, server->index);
+        ! ib_hash_iterator_at_end(iterator);
+        ib_hash_iterator_next(iterator)
+    ) {
+        const index_entry_t *entry;
+        record_header_t      header;
+
+        ib_hash_iterator_fetch(NULL, NULL, &entry, iterator);
+        if (entry->removed) {
+            continue;
+        }
+
+        memcpy(&header, server->map + entry->offset, sizeof(header));
+        if (header.expiration < now) {
+            continue;
+        }
+
+        if (
+            write(tmp_fd, server->map + entry->offset, entry->length) !=
+            (ssize_t)entry->length
+        ) {
+            rc = IB_EOTHER;
+            goto cleanup;
+        }
+    }
+
+    if (rename(tmp_path, server->path) != 0) {
+        rc = IB_EOTHER;
+        goto cleanup;
+    }
+
+    /* Releases the lock on the old file; waiting writers will find it
+     * replaced and move to the new one. */
+    log_close(server);
+    rc = log_open(server);
+
+cleanup:
+    close(tmp_fd);
+    /* If the old file is still open, the rename did not happen. */
+    if (rc != IB_OK && server->fd >= 0) {
+        unlink(tmp_path);
+    }
+    free(tmp_path);
+    free(iterator);
+    return rc;
+}
+
+/**
+ * Append @a record to the locked log file of @a server and index it.
+ *
+ * Compacts the log file if most of it is dead.  The log file is unlocked
+ * on return.
+ *
+ * @param[in] server Server.
+ * @param[in] record Record.
+ * @param[in] length Length of @a record.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EOTHER on system call failure.
+ *   - Other on failure of log_scan().
+ */
+static ib_status_t log_append(
+    log_server_t  *server,
+    const uint8_t *record,
+    size_t         length
+)
+{
+    ib_status_t rc;
+
+    if (write(server->fd, record, length) != (ssize_t)length) {
+        /* Do not leave an incomplete record for others to find. */
+        if (ftruncate(server->fd, server->end) != 0) {
+            ib_util_log_error("kvstore: Failed to truncate \"%s\".",
+                              server->path);
+        }
+        log_unlock(server);
+        return IB_EOTHER;
+    }
+
+    rc = log_scan(server, NULL);
+    if (rc != IB_OK) {
+        log_unlock(server);
+        return rc;
+    }
+
+    if (server->dead > COMPACT_MIN_DEAD && server->dead > server->live) {
+        rc = log_compact(server);
+        if (rc == IB_OK) {
+            return IB_OK;
+        }
+        ib_util_log_error("kvstore: Failed to compact \"%s\": %s",
+                          server->path, ib_status_to_string(rc));
+        if (server->fd < 0) {
+            /* The new log file could not be opened. */
+            return rc;
+        }
+    }
+
+    log_unlock(server);
+    return IB_OK;
+}
+
+/**
+ * Build a record.
+ *
+ * @param[in] flags Record flags.
+ * @param[in] key Key.
+ * @param[in] value Value; NULL for a removal.
+ * @param[out] record Record; free with free().
+ * @param[out] length Length of @a record.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ *   - IB_EINVAL if the key or type is too long.
+ */
+static ib_status_t log_record_build(
+    uint32_t                 flags,
+    const ib_kvstore_key_t  *key,
+    ib_kvstore_value_t      *value,
+    uint8_t                **record,
+    size_t                  *length
+)
+{
+    record_header_t  header;
+    const uint8_t   *key_data;
+    size_t           key_length;
+    const char      *type        = NULL;
+    size_t           type_length = 0;
+    const uint8_t   *data        = NULL;
+    size_t           data_length = 0;
+    uint8_t         *buf;
+    uint8_t         *p;
+
+    ib_kvstore_key_get(key, &key_data, &key_length);
+    if (value != NULL) {
+        ib_kvstore_value_type_get(value, &type, &type_length);
+        ib_kvstore_value_value_get(value, &data, &data_length);
+    }
+    if (key_length > UINT32_MAX || type_length > UINT32_MAX) {
+        return IB_EINVAL;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic        = RECORD_MAGIC;
+    header.flags        = flags;
+    header.key_length   = key_length;
+    header.type_length  = type_length;
+    header.value_length = data_length;
+    header.creation     = log_now();
+    if (value != NULL && ib_kvstore_value_expiration_get(value) > 0) {
+        header.expiration =
+            header.creation + ib_kvstore_value_expiration_get(value);
+    }
+
+    *length = record_length(&header);
+    buf = calloc(1, *length);
+    if (buf == NULL) {
+        return IB_EALLOC;
+    }
+
+    p = buf;
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    if (key_length > 0) {
+        memcpy(p, key_data, key_length);
+        p += key_length;
+    }
+    if (type_length > 0) {
+        memcpy(p, type, type_length);
+        p += type_length;
+    }
+    if (data_length > 0) {
+        memcpy(p, data, data_length);
+    }
+
+    *record = buf;
+    return IB_OK;
+}
+
+/**
+ * Trivial merge policy that returns the first value in the list
+ * if the list is size 1 or greater.
+ *
+ * The log store only ever returns one value.
+ *
+ * @param[in] kvstore Key-value store.
+ * @param[in] key The key that the values are listed under.
+ * @param[in] values Array of @ref ib_kvstore_value_t pointers.
+ * @param[in] value_size The length of values.
+ * @param[out] resultant_value Pointer to values[0] if value_size > 0.
+ * @param[in,out] cbdata Context callback data.
+ * @returns IB_OK
+ */
+static ib_status_t kvstore_log_merge_policy(
+    ib_kvstore_t            *kvstore,
+    const ib_kvstore_key_t  *key,
+    ib_kvstore_value_t     **values,
+    size_t                   value_size,
+    ib_kvstore_value_t     **resultant_value,
+    ib_kvstore_cbdata_t     *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(key != NULL);
+    assert(resultant_value != NULL);
+
+    if (value_size > 0) {
+        *resultant_value = values[0];
+    }
+
+    return IB_OK;
+}
+
+static ib_status_t kvconnect(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    log_server_t *server = (log_server_t *)kvstore->server;
+    ib_status_t   rc;
+
+    rc = ib_lock_lock(server->lock);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    if (server->fd < 0) {
+        rc = log_open(server);
+    }
+
+    ib_lock_unlock(server->lock);
+    return rc;
+}
+
+static ib_status_t kvdisconnect(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    log_server_t *server = (log_server_t *)kvstore->server;
+    ib_status_t   rc;
+
+    rc = ib_lock_lock(server->lock);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    log_close(server);
+
+    ib_lock_unlock(server->lock);
+    return IB_OK;
+}
+
+/**
+ * Get implementation.
+ *
+ * @param[in] kvstore The key-value store.
+ * @param[in] mm Memory manager to allocate @a values out of.
+ * @param[in] key The key to fetch.
+ * @param[out] values A pointer to an array of pointers.
+ * @param[out] values_length The length of *values.
+ * @param[in,out] cbdata Callback data. Unused.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_ENOENT if @a key has no current value.
+ *   - IB_EALLOC on allocation failure.
+ *   - Other on failure of log_refresh().
+ */
+static ib_status_t kvget(
+    ib_kvstore_t             *kvstore,
+    ib_mm_t                   mm,
+    const ib_kvstore_key_t   *key,
+    ib_kvstore_value_t     ***values,
+    size_t                   *values_length,
+    ib_kvstore_cbdata_t      *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+    assert(key != NULL);
+
+    log_server_t        *server = (log_server_t *)kvstore->server;
+    const uint8_t       *key_data;
+    size_t               key_length;
+    const index_entry_t *entry;
+    record_header_t      header;
+    const uint8_t       *p;
+    ib_kvstore_value_t  *value;
+    ib_kvstore_value_t **array;
+    char                *type;
+    uint8_t             *data;
+    ib_status_t          rc;
+
+    ib_kvstore_key_get(key, &key_data, &key_length);
+
+    rc = ib_lock_lock(server->lock);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = log_refresh(server);
+    if (rc != IB_OK) {
+        goto exit;
+    }
+
+    rc = ib_hash_get_ex(
+        server->index, &entry, (const char *)key_data, key_length
+    );
+    if (rc != IB_OK || entry->removed) {
+        rc = IB_ENOENT;
+        goto exit;
+    }
+
+    p = server->map + entry->offset;
+    memcpy(&header, p, sizeof(header));
+    if (header.expiration < log_now()) {
+        rc = IB_ENOENT;
+        goto exit;
+    }
+    p += sizeof(header) + header.key_length;
+
+    /* Copy out of the map; it may be replaced as soon as it is unlocked.
+     * Copy one byte more than needed so empty strings are not NULL. */
+    array = ib_mm_alloc(mm, sizeof(*array));
+    type = ib_mm_calloc(mm, 1, header.type_length + 1);
+    data = ib_mm_calloc(mm, 1, header.value_length + 1);
+    rc = ib_kvstore_value_create(&value, mm);
+    if (rc != IB_OK || array == NULL || type == NULL || data == NULL) {
+        rc = IB_EALLOC;
+        goto exit;
+    }
+    memcpy(type, p, header.type_length);
+    memcpy(data, p + header.type_length, header.value_length);
+
+    ib_kvstore_value_type_set(value, type, header.type_length);
+    ib_kvstore_value_value_set(value, data, header.value_length);
+    ib_kvstore_value_expiration_set(value, header.expiration);
+    ib_kvstore_value_creation_set(value, header.creation);
+
+    array[0]       = value;
+    *values        = array;
+    *values_length = 1;
+
+exit:
+    ib_lock_unlock(server->lock);
+    return rc;
+}
+
+/**
+ * Set implementation.
+ *
+ * @param[in] kvstore Key-value store.
+ * @param[in] merge_policy This implementation replaces the value of
+ *            @a key, so the merge policy is not used.
+ * @param[in] key The key to set.
+ * @param[in] value The value to write.
+ * @param[in,out] cbdata Callback data for the user.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ *   - IB_EOTHER on system call failure.
+ *   - IB_EINVAL if not connected or the key or type is too long.
+ */
+static ib_status_t kvset(
+    ib_kvstore_t                 *kvstore,
+    ib_kvstore_merge_policy_fn_t  merge_policy,
+    const ib_kvstore_key_t       *key,
+    ib_kvstore_value_t           *value,
+    ib_kvstore_cbdata_t          *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+    assert(key != NULL);
+    assert(value != NULL);
+
+    log_server_t *server = (log_server_t *)kvstore->server;
+    uint8_t      *record;
+    size_t        length;
+    ib_status_t   rc;
+
+    rc = log_record_build(0, key, value, &record, &length);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_lock_lock(server->lock);
+    if (rc != IB_OK) {
+        free(record);
+        return rc;
+    }
+
+    rc = log_lock_current(server);
+    if (rc == IB_OK) {
+        rc = log_append(server, record, length);
+    }
+
+    ib_lock_unlock(server->lock);
+    free(record);
+    return rc;
+}
+
+/**
+ * Remove a key from the store.
+ *
+ * @param[in] kvstore Store.
+ * @param[in] key Key.
+ * @param[in,out] cbdata Callback data.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ *   - IB_EOTHER on system call failure.
+ *   - IB_EINVAL if not connected.
+ */
+static ib_status_t kvremove(
+    ib_kvstore_t *kvstore,
+    const ib_kvstore_key_t *key,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+    assert(key != NULL);
+
+    log_server_t        *server = (log_server_t *)kvstore->server;
+    const uint8_t       *key_data;
+    size_t               key_length;
+    const index_entry_t *entry;
+    uint8_t             *record;
+    size_t               length;
+    ib_status_t          rc;
+
+    ib_kvstore_key_get(key, &key_data, &key_length);
+
+    rc = log_record_build(RECORD_REMOVE, key, NULL, &record, &length);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_lock_lock(server->lock);
+    if (rc != IB_OK) {
+        free(record);
+        return rc;
+    }
+
+    rc = log_lock_current(server);
+    if (rc != IB_OK) {
+        goto exit;
+    }
+
+    /* Only write a removal if there is something to remove. */
+    if (
+        ib_hash_get_ex(
+            server->index, &entry, (const char *)key_data, key_length
+        ) != IB_OK ||
+        entry->removed
+    ) {
+        log_unlock(server);
+        goto exit;
+    }
+
+    rc = log_append(server, record, length);
+
+exit:
+    ib_lock_unlock(server->lock);
+    free(record);
+    return rc;
+}
+
+/**
+ * Destroy any allocated elements of the kvstore structure.
+ * @param[out] kvstore to be destroyed. The log file is untouched
+ *             and another init of kvstore pointing at that file
+ *             will operate correctly.
+ * @param[in] cbdata Unused.
+ */
+static void kvdestroy(ib_kvstore_t* kvstore, ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+
+    log_server_t *server = (log_server_t *)(kvstore->server);
+
+    log_close(server);
+    if (server->index_mp != NULL) {
+        ib_mpool_lite_destroy(server->index_mp);
+    }
+    ib_lock_destroy_malloc(server->lock);
+    free(server->path);
+    free(server);
+    kvstore->server = NULL;
+
+    return;
+}
+
+ib_status_t ib_kvstore_log_init(
+    ib_kvstore_t* kvstore,
+    const char* path)
+{
+    assert(kvstore != NULL);
+    assert(path != NULL);
+
+    ib_status_t rc;
+
+    /* There is no callback data used for this implementation. */
+    ib_kvstore_init(kvstore);
+
+    log_server_t *server = calloc(1, sizeof(*server));
+
+    if ( server == NULL ) {
+        return IB_EALLOC;
+    }
+
+    server->path  = strdup(path);
+    server->fmode = DEFAULT_FILE_MODE;
+    server->fd    = -1;
+
+    if ( server->path == NULL ) {
+        free(server);
+        return IB_EALLOC;
+    }
+
+    rc = ib_lock_create_malloc(&(server->lock));
+    if (rc != IB_OK) {
+        free(server->path);
+        free(server);
+        return rc;
+    }
+
+    kvstore->server = (ib_kvstore_server_t *)server;
+    kvstore->get = kvget;
+    kvstore->set = kvset;
+    kvstore->remove = kvremove;
+    kvstore->connect = kvconnect;
+    kvstore->disconnect = kvdisconnect;
+    kvstore->destroy = kvdestroy;
+    kvstore->default_merge_policy = kvstore_log_merge_policy;
+
+    kvstore->malloc_cbdata = NULL;
+    kvstore->free_cbdata = NULL;
+    kvstore->connect_cbdata = NULL;
+    kvstore->disconnect_cbdata = NULL;
+    kvstore->get_cbdata = NULL;
+    kvstore->set_cbdata = NULL;
+    kvstore->remove_cbdata = NULL;
+    kvstore->merge_policy_cbdata = NULL;
+    kvstore->destroy_cbdata = NULL;
+
+    return IB_OK;
+}
+
+void ib_kvstore_log_set_file_mode(ib_kvstore_t *kvstore, mode_t mode)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+    log_server_t *server = (log_server_t *)(kvstore->server);
+    server->fmode = mode;
+}
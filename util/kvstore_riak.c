@@ -30,15 +30,19 @@
 
 #include <ctype.h>
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 #define EXPIRATION "X-Riak-Meta-Expiration"
 #define CREATION "X-Riak-Meta-Creation"
 #define VCLOCK "X-Riak-Vclock"
 #define ETAG "ETag"
 #define CONTENT_TYPE "Content-Type"
+#define MULTIPART_MIXED "multipart/mixed"
+#define BOUNDARY "boundary="
 
 /**
  * Convenience function.
@@ -53,6 +57,44 @@ static inline void * kvmalloc(ib_kvstore_t *kvstore, size_t size) {
 static inline void kvfree(ib_kvstore_t *kvstore, void *ptr) {
     kvstore->free(kvstore, ptr, kvstore->free_cbdata);
 }
+
+/**
+ * Set the connection options of a request on @a riak's handle.
+ *
+ * The handle keeps its connections open between requests, including
+ * across curl_easy_reset(), which clears these options, so they are set
+ * at the start of every request.
+ *
+ * @param[in] riak The riak server.
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EOTHER if curl rejects an option.
+ */
+static ib_status_t riak_connection_options(ib_kvstore_riak_server_t *riak)
+{
+    assert(riak != NULL);
+    assert(riak->curl != NULL);
+
+    /* Requests are made from server threads, where signals can not be
+     * used for timeouts. */
+    if (curl_easy_setopt(riak->curl, CURLOPT_NOSIGNAL, 1L)) {
+        return IB_EOTHER;
+    }
+
+    /* Requests are small; do not wait to fill a segment. */
+    if (curl_easy_setopt(riak->curl, CURLOPT_TCP_NODELAY, 1L)) {
+        return IB_EOTHER;
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x071900
+    /* Keep idle connections from being dropped by the network. */
+    if (curl_easy_setopt(riak->curl, CURLOPT_TCP_KEEPALIVE, 1L)) {
+        return IB_EOTHER;
+    }
+#endif
+
+    return IB_OK;
+}
 /**
  * Memory buffer.
  */
@@ -323,6 +365,10 @@ static struct curl_slist* build_custom_headers(
         const char *type;
         size_t      type_length;
 
+        /* Send the value with the request instead of waiting for a
+         * 100 Continue response. */
+        slist = curl_slist_append(slist, "Expect:");
+
         ib_kvstore_value_type_get(value, &type, &type_length);
 
         if (type_length > 0) {
@@ -612,6 +658,10 @@ static ib_status_t riak_get(
     /* Callback data for storing the CURL headers. */
     riak_headers_init(kvstore, riak_headers);
 
+    if (riak_connection_options(riak) != IB_OK) {
+        return IB_EOTHER;
+    }
+
     /* Set url. */
     curl_rc = curl_easy_setopt(riak->curl, CURLOPT_URL, url);
     if (curl_rc) {
@@ -650,13 +700,19 @@ static ib_status_t riak_get(
         return IB_EOTHER;
     }
 
+    /* Ask for all siblings of a conflicted key in the response, rather
+     * than a list of them that must each be fetched. */
     header_list = build_custom_headers(kvstore, riak, NULL);
+    header_list = curl_slist_append(
+        header_list,
+        "Accept: " MULTIPART_MIXED ", */*");
     if (header_list) {
         curl_rc = curl_easy_setopt(
             riak->curl,
             CURLOPT_HTTPHEADER,
             header_list);
         if (curl_rc) {
+            curl_slist_free_all(header_list);
             return IB_EOTHER;
         }
     }
@@ -684,6 +740,204 @@ static ib_status_t riak_get(
     return IB_OK;
 }
 
+/**
+ * Find @a needle in @a haystack.
+ *
+ * @param[in] haystack Bytes to search.
+ * @param[in] haystack_length Length of @a haystack.
+ * @param[in] needle Bytes to find.
+ * @param[in] needle_length Length of @a needle.
+ *
+ * @returns First occurrence of @a needle or NULL.
+ */
+static const char *find_bytes(
+    const char *haystack,
+    size_t      haystack_length,
+    const char *needle,
+    size_t      needle_length)
+{
+    for (
+        ;
+        haystack_length >= needle_length;
+        ++haystack, --haystack_length
+    ) {
+        if (memcmp(haystack, needle, needle_length) == 0) {
+            return haystack;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Convert the siblings in a multipart/mixed @a response to values.
+ *
+ * Riak returns every sibling of a conflicted key in one such response when
+ * it is acceptable, instead of a list of their etags to fetch each of.
+ * Siblings that are deletions are skipped.
+ *
+ * @param[in] kvstore Key-value store.
+ * @param[in] riak kvstore->server object, extracted.
+ * @param[in] response The response from the server.
+ * @param[in] content_type Content-Type of @a response.
+ * @param[in] mm Memory manager @a values are allocated out of.
+ * @param[out] values Array of values.
+ * @param[out] values_length Length of @a values.
+ *
+ * @returns
+ *   - IB_OK success.
+ *   - IB_EINVAL if @a response is not a valid multipart body.
+ *   - IB_EALLOC memory allocation.
+ */
+static ib_status_t multipart_to_kvstore_values(
+    ib_kvstore_t               *kvstore,
+    ib_kvstore_riak_server_t   *riak,
+    const membuffer_t          *response,
+    const char                 *content_type,
+    ib_mm_t                     mm,
+    ib_kvstore_value_t       ***values,
+    size_t                     *values_length)
+{
+    assert(kvstore != NULL);
+    assert(riak != NULL);
+    assert(response != NULL);
+    assert(content_type != NULL);
+    assert(values != NULL);
+    assert(values_length != NULL);
+
+    const char  *end = response->buffer + response->read;
+    const char  *cur;
+    const char  *boundary;
+    size_t       boundary_length;
+    char        *delimiter;
+    size_t       delimiter_length;
+    size_t       parts = 0;
+    ib_status_t  rc = IB_OK;
+
+    boundary = strstr(content_type, BOUNDARY);
+    if (boundary == NULL || response->buffer == NULL) {
+        return IB_EINVAL;
+    }
+    boundary += sizeof(BOUNDARY) - 1;
+    if (*boundary == '"') {
+        ++boundary;
+    }
+    boundary_length = strcspn(boundary, "\"; \t\r\n");
+    if (boundary_length == 0) {
+        return IB_EINVAL;
+    }
+
+    /* CRLF "--" boundary; the first delimiter may lack the CRLF. */
+    delimiter_length = boundary_length + 4;
+    delimiter = kvmalloc(kvstore, delimiter_length + 1);
+    if (delimiter == NULL) {
+        return IB_EALLOC;
+    }
+    sprintf(delimiter, "\r\n--%.*s", (int)boundary_length, boundary);
+
+    /* Every part is followed by a delimiter, so there are fewer parts. */
+    for (
+        cur = response->buffer;
+        (cur = find_bytes(cur, end - cur, delimiter, delimiter_length)) != NULL;
+        cur += delimiter_length
+    ) {
+        ++parts;
+    }
+
+    *values_length = 0;
+    *values = ib_mm_alloc(mm, sizeof(**values) * (parts + 1));
+    if (*values == NULL) {
+        rc = IB_EALLOC;
+        goto exit;
+    }
+
+    cur = find_bytes(
+        response->buffer, response->read, delimiter + 2, delimiter_length - 2);
+    if (cur == NULL) {
+        rc = IB_EINVAL;
+        goto exit;
+    }
+    cur += delimiter_length - 2;
+
+    /* At the end of a delimiter: "--" closes the body, CRLF starts a part. */
+    while (end - cur >= 2 && ! (cur[0] == '-' && cur[1] == '-')) {
+        const char     *headers_end;
+        const char     *body;
+        const char     *next;
+        riak_headers_t  part_headers;
+        membuffer_t     part;
+        bool            deleted = false;
+
+        cur = find_bytes(cur, end - cur, "\r\n", 2);
+        if (cur == NULL) {
+            rc = IB_EINVAL;
+            goto exit;
+        }
+        cur += 2;
+
+        if (end - cur >= 2 && cur[0] == '\r' && cur[1] == '\n') {
+            headers_end = cur;
+        }
+        else {
+            headers_end = find_bytes(cur, end - cur, "\r\n\r\n", 4);
+            if (headers_end == NULL) {
+                rc = IB_EINVAL;
+                goto exit;
+            }
+            headers_end += 2;
+        }
+        body = headers_end + 2;
+
+        next = find_bytes(body, end - body, delimiter, delimiter_length);
+        if (next == NULL) {
+            rc = IB_EINVAL;
+            goto exit;
+        }
+
+        riak_headers_init(kvstore, &part_headers);
+        while (cur < headers_end) {
+            const char *eol = find_bytes(cur, headers_end - cur, "\r\n", 2);
+
+            if (
+                eol - cur >= 20 &&
+                strncasecmp(cur, "X-Riak-Deleted: true", 20) == 0
+            ) {
+                deleted = true;
+            }
+            riak_header_capture((void *)cur, 1, eol + 2 - cur, &part_headers);
+            cur = eol + 2;
+        }
+
+        if (! deleted && part_headers.content_type != NULL) {
+            part.kvstore = kvstore;
+            part.buffer  = (char *)body;
+            part.size    = next - body;
+            part.read    = next - body;
+
+            rc = http_to_kvstore_value(
+                kvstore,
+                riak,
+                &part,
+                &part_headers,
+                mm,
+                &((*values)[*values_length]));
+            if (rc == IB_OK) {
+                ++(*values_length);
+            }
+        }
+        cleanup_riak_headers(&part_headers);
+        if (rc != IB_OK) {
+            goto exit;
+        }
+
+        cur = next + delimiter_length;
+    }
+
+exit:
+    kvfree(kvstore, delimiter);
+    return rc;
+}
+
 static ib_status_t kvget(
     ib_kvstore_t             *kvstore,
     ib_mm_t                   mm,
@@ -734,7 +988,29 @@ static ib_status_t kvget(
         goto exit;
     }
 
-    /* Multiple choices. */
+    /* Multiple choices, all in this response. */
+    else if (
+        riak_headers.status == 300 &&
+        riak_headers.content_type != NULL &&
+        strncmp(
+            riak_headers.content_type,
+            MULTIPART_MIXED,
+            sizeof(MULTIPART_MIXED) - 1) == 0
+    ) {
+        rc = multipart_to_kvstore_values(
+            kvstore,
+            riak,
+            &response,
+            riak_headers.content_type,
+            mm,
+            values,
+            values_length);
+        if (rc != IB_OK) {
+            goto exit;
+        }
+    }
+
+    /* Multiple choices, as a list of etags. */
     else if (riak_headers.status == 300) {
         /* Current line. */
         char *cur;
@@ -878,6 +1154,11 @@ static ib_status_t kvset(
     rc = IB_OK;
     url = build_key_url(kvstore, riak, key);
 
+    rc = riak_connection_options(riak);
+    if (rc != IB_OK) {
+        goto exit;
+    }
+
     /* Set url. */
     curl_rc = curl_easy_setopt(riak->curl, CURLOPT_URL, url);
     if (curl_rc) {
@@ -1000,6 +1281,11 @@ static ib_status_t kvremove(
     riak = (ib_kvstore_riak_server_t *)kvstore->server;
     url = build_key_url(kvstore, riak, key);
 
+    rc = riak_connection_options(riak);
+    if (rc != IB_OK) {
+        goto exit;
+    }
+
     curl_rc = curl_easy_setopt(riak->curl, CURLOPT_URL, url);
     if (curl_rc) {
         rc =IB_EOTHER;
@@ -1307,6 +1593,11 @@ static ib_status_t ib_kvstore_riak_set_bucket_property(
 
     snprintf(url, url_length+1, "%s%s", riak->bucket_url, props_path);
 
+    rc = riak_connection_options(riak);
+    if (rc != IB_OK) {
+        goto exit;
+    }
+
     /* Set url. */
     curl_rc = curl_easy_setopt(riak->curl, CURLOPT_URL, url);
     if (curl_rc) {
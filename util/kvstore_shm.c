@@ -0,0 +1,964 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Persist to a hash table in shared memory.
+ *
+ * The file is a @ref table_header_t followed by a fixed number of slots
+ * of a fixed size.  Each slot is a @ref slot_header_t followed by the key,
+ * type and value of its entry.  A key lives in the first usable slot of
+ * the @ref SHM_WINDOW slots starting at its hash; empty slots end a search
+ * and removed slots do not.
+ *
+ * Every slot has a sequence number that is odd while the slot is being
+ * written.  Readers copy a slot, and retry if the sequence number was odd
+ * or changed meanwhile, so they take no lock.  Writers hold an exclusive
+ * @c fcntl() lock of the file and a lock of the process.  Unlike a
+ * @c flock(), the file lock is not shared with children forked after the
+ * store was connected.  A writer that dies
+ * leaves the sequence number odd; the next writer to see it marks the
+ * slot removed.
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/kvstore_shm.h>
+
+#include "kvstore_private.h"
+
+#include <ironbee/clock.h>
+#include <ironbee/hash.h>
+#include <ironbee/kvstore.h>
+#include <ironbee/lock.h>
+#include <ironbee/util.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * The fmode for the created file.
+ */
+static const mode_t DEFAULT_FILE_MODE = 0644;
+
+/**
+ * Magic at the start of a table file.
+ */
+static const char SHM_MAGIC[8] = { 'I', 'B', 'K', 'V', 'S', 'H', 'M', '1' };
+
+/**
+ * Number of slots a key may be in.
+ */
+#define SHM_WINDOW 32
+
+/**
+ * Times a reader retries a slot that is being written before taking the
+ * writer lock to wait for, or repair, it.
+ */
+#define SHM_READ_TRIES 1000
+
+/**
+ * Slot states.
+ */
+#define SLOT_EMPTY   0 /**< Never used; ends a search. */
+#define SLOT_USED    1 /**< Holds an entry. */
+#define SLOT_REMOVED 2 /**< Held an entry. */
+
+/**
+ * Header of the table file.
+ */
+typedef struct {
+    char     magic[8];   /**< SHM_MAGIC. */
+    uint32_t slots;      /**< Number of slots. */
+    uint32_t slot_size;  /**< Size of each slot. */
+    uint32_t seed;       /**< Hash randomizer. */
+    uint32_t reserved;   /**< Zero. */
+    uint64_t padding[5]; /**< Zero; aligns slots to a cache line. */
+} table_header_t;
+
+/**
+ * Header of each slot.
+ */
+typedef struct {
+    uint64_t seq;          /**< Odd while the slot is written. */
+    uint32_t state;        /**< SLOT_EMPTY, SLOT_USED or SLOT_REMOVED. */
+    uint32_t hash;         /**< Hash of the key. */
+    uint32_t key_length;   /**< Length of the key. */
+    uint32_t type_length;  /**< Length of the type. */
+    uint32_t value_length; /**< Length of the value. */
+    uint32_t reserved;     /**< Zero. */
+    uint64_t expiration;   /**< Absolute expiration time. */
+    uint64_t creation;     /**< Creation time. */
+} slot_header_t;
+
+/**
+ * The shared memory server object.
+ */
+typedef struct {
+    char      *path;       /**< Path of the table file. */
+    size_t     slots;      /**< Number of slots of a new table. */
+    size_t     slot_size;  /**< Slot size of a new table. */
+    ib_lock_t *lock;       /**< Serializes writing threads of this process. */
+    int        fd;         /**< Table file; -1 if not connected. */
+    uint8_t   *map;        /**< Memory map of @ref fd. */
+    size_t     map_length; /**< Length of @ref map. */
+    uint32_t   seed;       /**< Hash randomizer of the table. */
+} shm_server_t;
+
+/**
+ * Current time, as the other stores see it.
+ *
+ * @returns Current time.
+ */
+static ib_time_t shm_now(void)
+{
+    ib_timeval_t tv;
+
+    ib_clock_gettimeofday(&tv);
+    return IB_CLOCK_TIMEVAL_TIME(tv);
+}
+
+/**
+ * Header of the table of @a server.
+ *
+ * @param[in] server Connected server.
+ *
+ * @returns Header.
+ */
+static const table_header_t *shm_table(const shm_server_t *server)
+{
+    return (const table_header_t *)server->map;
+}
+
+/**
+ * Slot @a i of @a server.
+ *
+ * @param[in] server Connected server.
+ * @param[in] i Index of slot, taken modulo the number of slots.
+ *
+ * @returns Slot.
+ */
+static slot_header_t *shm_slot(const shm_server_t *server, size_t i)
+{
+    const table_header_t *table = shm_table(server);
+
+    return (slot_header_t *)(
+        server->map + sizeof(*table) + (i % table->slots) * table->slot_size
+    );
+}
+
+/**
+ * Hash of a key in the table of @a server.
+ *
+ * @param[in] server Connected server.
+ * @param[in] key Key.
+ * @param[out] key_data Data of @a key.
+ * @param[out] key_length Length of @a key.
+ *
+ * @returns Hash.
+ */
+static uint32_t shm_hash(
+    const shm_server_t      *server,
+    const ib_kvstore_key_t  *key,
+    const uint8_t          **key_data,
+    size_t                  *key_length
+)
+{
+    ib_kvstore_key_get(key, key_data, key_length);
+
+    return ib_hashfunc_djb2(
+        (*key_length > 0) ? (const char *)*key_data : "",
+        *key_length,
+        server->seed,
+        NULL
+    );
+}
+
+/**
+ * Lock or unlock the whole file @a fd for this process.
+ *
+ * @param[in] fd File.
+ * @param[in] type @c F_WRLCK to wait for an exclusive lock or @c F_UNLCK.
+ *
+ * @returns 0 on success or -1 with errno set.
+ */
+static int shm_file_lock(int fd, short type)
+{
+    struct flock fl;
+    int          result;
+
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type   = type;
+    fl.l_whence = SEEK_SET;
+    fl.l_start  = 0;
+    fl.l_len    = 0;
+
+    do {
+        result = fcntl(fd, F_SETLKW, &fl);
+    } while (result != 0 && errno == EINTR);
+
+    return result;
+}
+
+/**
+ * Take the writer locks of @a server.
+ *
+ * @param[in] server Connected server.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EOTHER on failure to lock the file.
+ *   - Other on failure to lock the process lock.
+ */
+static ib_status_t shm_lock(shm_server_t *server)
+{
+    ib_status_t rc;
+
+    rc = ib_lock_lock(server->lock);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    if (shm_file_lock(server->fd, F_WRLCK) != 0) {
+        ib_lock_unlock(server->lock);
+        return IB_EOTHER;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Release the writer locks of @a server.
+ *
+ * @param[in] server Server locked by shm_lock().
+ */
+static void shm_unlock(shm_server_t *server)
+{
+    shm_file_lock(server->fd, F_UNLCK);
+    ib_lock_unlock(server->lock);
+}
+
+/**
+ * Mark @a slot as being written.  The writer locks must be held.
+ *
+ * @param[in] slot Slot.
+ */
+static void slot_write_begin(slot_header_t *slot)
+{
+    __atomic_store_n(&(slot->seq), slot->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * Mark @a slot as written.
+ *
+ * @param[in] slot Slot marked by slot_write_begin().
+ */
+static void slot_write_end(slot_header_t *slot)
+{
+    __atomic_store_n(&(slot->seq), slot->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Mark @a slot removed if a writer died while writing it.
+ *
+ * The writer locks must be held, so no one else is writing it.
+ *
+ * @param[in] server Server.
+ * @param[in] slot Slot.
+ */
+static void slot_repair(const shm_server_t *server, slot_header_t *slot)
+{
+    if ((slot->seq & 1) == 0) {
+        return;
+    }
+
+    ib_util_log_error(
+        "kvstore: Removing incompletely written entry from \"%s\".",
+        server->path);
+    slot->state = SLOT_REMOVED;
+    slot_write_end(slot);
+}
+
+/**
+ * Copy the entry of a key from @a slot without locking.
+ *
+ * @param[in] server Server.
+ * @param[in] slot Slot.
+ * @param[in] hash Hash of the key.
+ * @param[in] key_data Key.
+ * @param[in] key_length Length of @a key_data.
+ * @param[in] mm Memory manager to copy the entry into.
+ * @param[out] value Copy of the entry, on IB_OK.
+ * @param[out] state State of @a slot, unless IB_EAGAIN is returned.
+ *
+ * @returns
+ *   - IB_OK if @a slot holds a current entry of the key.
+ *   - IB_ENOENT if it does not.
+ *   - IB_EAGAIN if @a slot is being written; try again.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t slot_read(
+    const shm_server_t   *server,
+    const slot_header_t  *slot,
+    uint32_t              hash,
+    const uint8_t        *key_data,
+    size_t                key_length,
+    ib_mm_t               mm,
+    ib_kvstore_value_t  **value,
+    uint32_t             *state
+)
+{
+    const table_header_t *table = shm_table(server);
+    const uint8_t        *p = (const uint8_t *)(slot + 1);
+    slot_header_t         header;
+    uint64_t              seq;
+    char                 *type;
+    uint8_t              *data;
+    bool                  match;
+
+    seq = __atomic_load_n(&(slot->seq), __ATOMIC_ACQUIRE);
+    if (seq & 1) {
+        return IB_EAGAIN;
+    }
+    memcpy(&header, slot, sizeof(header));
+
+    match =
+        header.state == SLOT_USED &&
+        header.hash == hash &&
+        header.key_length == key_length &&
+        (uint64_t)header.key_length + header.type_length +
+            header.value_length <= table->slot_size - sizeof(header) &&
+        memcmp(p, key_data, key_length) == 0;
+
+    type = NULL;
+    data = NULL;
+    if (match) {
+        /* Copy one byte more than needed so empty strings are not NULL. */
+        type = ib_mm_calloc(mm, 1, header.type_length + 1);
+        data = ib_mm_calloc(mm, 1, header.value_length + 1);
+        if (type == NULL || data == NULL) {
+            return IB_EALLOC;
+        }
+        memcpy(type, p + key_length, header.type_length);
+        memcpy(
+            data, p + key_length + header.type_length, header.value_length);
+    }
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&(slot->seq), __ATOMIC_RELAXED) != seq) {
+        return IB_EAGAIN;
+    }
+
+    *state = header.state;
+    if (! match || header.expiration < (uint64_t)shm_now()) {
+        return IB_ENOENT;
+    }
+
+    if (ib_kvstore_value_create(value, mm) != IB_OK) {
+        return IB_EALLOC;
+    }
+    ib_kvstore_value_type_set(*value, type, header.type_length);
+    ib_kvstore_value_value_set(*value, data, header.value_length);
+    ib_kvstore_value_expiration_set(*value, header.expiration);
+    ib_kvstore_value_creation_set(*value, header.creation);
+
+    return IB_OK;
+}
+
+/**
+ * Find the slot of a key.  The writer locks must be held.
+ *
+ * Repairs slots left being written by a dead writer.
+ *
+ * @param[in] server Server.
+ * @param[in] hash Hash of the key.
+ * @param[in] key_data Key.
+ * @param[in] key_length Length of @a key_data.
+ * @param[out] free_slot If not NULL, set to the slot a new entry of the
+ *             key should be written to: the first removed, expired or
+ *             empty slot of its window, or else the one that expires
+ *             first.
+ *
+ * @returns Slot holding the key or NULL.
+ */
+static slot_header_t *slot_find(
+    const shm_server_t  *server,
+    uint32_t             hash,
+    const uint8_t       *key_data,
+    size_t               key_length,
+    slot_header_t      **free_slot
+)
+{
+    ib_time_t      now = shm_now();
+    slot_header_t *reuse = NULL;
+    slot_header_t *victim = NULL;
+
+    for (size_t i = 0; i < SHM_WINDOW; ++i) {
+        slot_header_t *slot = shm_slot(server, hash + i);
+
+        slot_repair(server, slot);
+
+        if (slot->state == SLOT_EMPTY) {
+            if (reuse == NULL) {
+                reuse = slot;
+            }
+            break;
+        }
+        else if (slot->state == SLOT_REMOVED) {
+            if (reuse == NULL) {
+                reuse = slot;
+            }
+        }
+        else if (
+            slot->hash == hash &&
+            slot->key_length == key_length &&
+            memcmp(slot + 1, key_data, key_length) == 0
+        ) {
+            if (free_slot != NULL) {
+                *free_slot = slot;
+            }
+            return slot;
+        }
+        else if (slot->expiration < (uint64_t)now) {
+            if (reuse == NULL) {
+                reuse = slot;
+            }
+        }
+        else if (victim == NULL || slot->expiration < victim->expiration) {
+            victim = slot;
+        }
+    }
+
+    if (free_slot != NULL) {
+        *free_slot = (reuse != NULL) ? reuse : victim;
+    }
+    return NULL;
+}
+
+/**
+ * Open, and if necessary create, the table file of @a server and map it.
+ *
+ * @param[in] server Server.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EOTHER on system call failure.
+ *   - IB_EINVAL if the file is not a table file.
+ */
+static ib_status_t shm_open_table(shm_server_t *server)
+{
+    table_header_t header;
+    struct stat    sb;
+    ib_status_t    rc = IB_OK;
+
+    assert(server->fd < 0);
+
+    server->fd = open(server->path, O_RDWR | O_CREAT, DEFAULT_FILE_MODE);
+    if (server->fd < 0) {
+        ib_util_log_error("kvstore: Failed to open \"%s\": %s",
+                          server->path, strerror(errno));
+        return IB_EOTHER;
+    }
+
+    if (
+        shm_file_lock(server->fd, F_WRLCK) != 0 ||
+        fstat(server->fd, &sb) != 0
+    ) {
+        rc = IB_EOTHER;
+        goto exit;
+    }
+
+    if (sb.st_size == 0) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SHM_MAGIC, sizeof(SHM_MAGIC));
+        header.slots     = server->slots;
+        header.slot_size = server->slot_size;
+        header.seed      = (uint32_t)clock() ^ (uint32_t)getpid() ^
+                           (uint32_t)shm_now();
+
+        /* The file is extended with zeros: every slot is empty. */
+        if (
+            ftruncate(
+                server->fd,
+                sizeof(header) + (off_t)header.slots * header.slot_size
+            ) != 0 ||
+            pwrite(server->fd, &header, sizeof(header), 0) !=
+                (ssize_t)sizeof(header)
+        ) {
+            ib_util_log_error("kvstore: Failed to size \"%s\": %s",
+                              server->path, strerror(errno));
+            rc = IB_EOTHER;
+            goto exit;
+        }
+    }
+    else if (
+        pread(server->fd, &header, sizeof(header), 0) !=
+            (ssize_t)sizeof(header) ||
+        memcmp(header.magic, SHM_MAGIC, sizeof(SHM_MAGIC)) != 0 ||
+        header.slots == 0 ||
+        header.slot_size <= sizeof(slot_header_t) ||
+        header.slot_size % 8 != 0 ||
+        (uint64_t)sb.st_size !=
+            sizeof(header) + (uint64_t)header.slots * header.slot_size
+    ) {
+        ib_util_log_error("kvstore: \"%s\" is not a shared memory table.",
+                          server->path);
+        rc = IB_EINVAL;
+        goto exit;
+    }
+
+    server->map_length =
+        sizeof(header) + (size_t)header.slots * header.slot_size;
+    server->map = mmap(
+        NULL, server->map_length, PROT_READ | PROT_WRITE, MAP_SHARED,
+        server->fd, 0
+    );
+    if (server->map == MAP_FAILED) {
+        server->map = NULL;
+        rc = IB_EOTHER;
+        goto exit;
+    }
+    server->seed = header.seed;
+
+exit:
+    shm_file_lock(server->fd, F_UNLCK);
+    if (rc != IB_OK) {
+        close(server->fd);
+        server->fd = -1;
+    }
+    return rc;
+}
+
+/**
+ * Unmap and close the table file of @a server, if open.
+ *
+ * @param[in] server Server.
+ */
+static void shm_close_table(shm_server_t *server)
+{
+    if (server->map != NULL) {
+        munmap(server->map, server->map_length);
+        server->map = NULL;
+    }
+    if (server->fd >= 0) {
+        close(server->fd);
+        server->fd = -1;
+    }
+}
+
+/**
+ * Trivial merge policy that returns the first value in the list
+ * if the list is size 1 or greater.
+ *
+ * This implementation never returns more than one value.
+ *
+ * @param[in] kvstore Key-value store.
+ * @param[in] key The key that the values are listed under.
+ * @param[in] values Array of @ref ib_kvstore_value_t pointers.
+ * @param[in] value_size The length of values.
+ * @param[out] resultant_value Pointer to values[0] if value_size > 0.
+ * @param[in,out] cbdata Context callback data.
+ * @returns IB_OK
+ */
+static ib_status_t kvstore_shm_merge_policy(
+    ib_kvstore_t            *kvstore,
+    const ib_kvstore_key_t  *key,
+    ib_kvstore_value_t     **values,
+    size_t                   value_size,
+    ib_kvstore_value_t     **resultant_value,
+    ib_kvstore_cbdata_t     *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(key != NULL);
+    assert(resultant_value != NULL);
+
+    if (value_size > 0) {
+        *resultant_value = values[0];
+    }
+
+    return IB_OK;
+}
+
+static ib_status_t kvconnect(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    shm_server_t *server = (shm_server_t *)kvstore->server;
+    ib_status_t   rc;
+
+    rc = ib_lock_lock(server->lock);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    if (server->fd < 0) {
+        rc = shm_open_table(server);
+    }
+
+    ib_lock_unlock(server->lock);
+    return rc;
+}
+
+static ib_status_t kvdisconnect(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    shm_server_t *server = (shm_server_t *)kvstore->server;
+    ib_status_t   rc;
+
+    rc = ib_lock_lock(server->lock);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    shm_close_table(server);
+
+    ib_lock_unlock(server->lock);
+    return IB_OK;
+}
+
+/**
+ * Get implementation.
+ *
+ * @param[in] kvstore The key-value store.
+ * @param[in] mm Memory manager to allocate @a values out of.
+ * @param[in] key The key to fetch.
+ * @param[out] values A pointer to an array of pointers.
+ * @param[out] values_length The length of *values.
+ * @param[in,out] cbdata Callback data. Unused.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_ENOENT if @a key has no current value.
+ *   - IB_EALLOC on allocation failure.
+ *   - IB_EINVAL if not connected.
+ *   - Other on failure to lock a slot left being written.
+ */
+static ib_status_t kvget(
+    ib_kvstore_t             *kvstore,
+    ib_mm_t                   mm,
+    const ib_kvstore_key_t   *key,
+    ib_kvstore_value_t     ***values,
+    size_t                   *values_length,
+    ib_kvstore_cbdata_t      *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+    assert(key != NULL);
+
+    shm_server_t        *server = (shm_server_t *)kvstore->server;
+    const uint8_t       *key_data;
+    size_t               key_length;
+    uint32_t             hash;
+    ib_kvstore_value_t  *value = NULL;
+    ib_kvstore_value_t **array;
+    ib_status_t          rc = IB_ENOENT;
+
+    if (server->map == NULL) {
+        return IB_EINVAL;
+    }
+
+    array = ib_mm_alloc(mm, sizeof(*array));
+    if (array == NULL) {
+        return IB_EALLOC;
+    }
+
+    hash = shm_hash(server, key, &key_data, &key_length);
+
+    for (size_t i = 0; i < SHM_WINDOW; ++i) {
+        const slot_header_t *slot = shm_slot(server, hash + i);
+        uint32_t             state = SLOT_EMPTY;
+        size_t               tries = 0;
+
+        while (
+            (rc = slot_read(
+                server, slot, hash, key_data, key_length, mm, &value, &state
+            )) == IB_EAGAIN
+        ) {
+            if (++tries < SHM_READ_TRIES) {
+                continue;
+            }
+
+            /* The writer may have died; wait for or repair the slot. */
+            rc = shm_lock(server);
+            if (rc != IB_OK) {
+                return rc;
+            }
+            slot_repair(server, (slot_header_t *)slot);
+            shm_unlock(server);
+            tries = 0;
+        }
+
+        if (rc != IB_ENOENT || state == SLOT_EMPTY) {
+            break;
+        }
+    }
+
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    array[0]       = value;
+    *values        = array;
+    *values_length = 1;
+
+    return IB_OK;
+}
+
+/**
+ * Set implementation.
+ *
+ * @param[in] kvstore Key-value store.
+ * @param[in] merge_policy This implementation replaces the value of
+ *            @a key, so the merge policy is not used.
+ * @param[in] key The key to set.
+ * @param[in] value The value to write.
+ * @param[in,out] cbdata Callback data for the user.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EOTHER on failure to lock the file.
+ *   - IB_EINVAL if not connected or the entry does not fit in a slot.
+ */
+static ib_status_t kvset(
+    ib_kvstore_t                 *kvstore,
+    ib_kvstore_merge_policy_fn_t  merge_policy,
+    const ib_kvstore_key_t       *key,
+    ib_kvstore_value_t           *value,
+    ib_kvstore_cbdata_t          *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+    assert(key != NULL);
+    assert(value != NULL);
+
+    shm_server_t  *server = (shm_server_t *)kvstore->server;
+    const uint8_t *key_data;
+    size_t         key_length;
+    const char    *type;
+    size_t         type_length;
+    const uint8_t *data;
+    size_t         data_length;
+    uint32_t       hash;
+    slot_header_t *slot = NULL;
+    uint8_t       *p;
+    ib_status_t    rc;
+
+    if (server->map == NULL) {
+        return IB_EINVAL;
+    }
+
+    hash = shm_hash(server, key, &key_data, &key_length);
+    ib_kvstore_value_type_get(value, &type, &type_length);
+    ib_kvstore_value_value_get(value, &data, &data_length);
+
+    if (
+        key_length + type_length + data_length >
+        shm_table(server)->slot_size - sizeof(*slot)
+    ) {
+        ib_util_log_error(
+            "kvstore: Entry of %zu bytes does not fit slots of \"%s\".",
+            key_length + type_length + data_length, server->path);
+        return IB_EINVAL;
+    }
+
+    rc = shm_lock(server);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    slot_find(server, hash, key_data, key_length, &slot);
+    assert(slot != NULL);
+
+    slot_write_begin(slot);
+    slot->state        = SLOT_USED;
+    slot->hash         = hash;
+    slot->key_length   = key_length;
+    slot->type_length  = type_length;
+    slot->value_length = data_length;
+    slot->expiration   =
+        shm_now() + ib_kvstore_value_expiration_get(value);
+    slot->creation     = ib_kvstore_value_creation_get(value);
+    p = (uint8_t *)(slot + 1);
+    memcpy(p, key_data, key_length);
+    memcpy(p + key_length, type, type_length);
+    memcpy(p + key_length + type_length, data, data_length);
+    slot_write_end(slot);
+
+    shm_unlock(server);
+    return IB_OK;
+}
+
+/**
+ * Remove a key from the store.
+ *
+ * @param[in] kvstore Store.
+ * @param[in] key Key.
+ * @param[in,out] cbdata Callback data.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EOTHER on failure to lock the file.
+ *   - IB_EINVAL if not connected.
+ */
+static ib_status_t kvremove(
+    ib_kvstore_t *kvstore,
+    const ib_kvstore_key_t *key,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+    assert(key != NULL);
+
+    shm_server_t  *server = (shm_server_t *)kvstore->server;
+    const uint8_t *key_data;
+    size_t         key_length;
+    uint32_t       hash;
+    slot_header_t *slot;
+    ib_status_t    rc;
+
+    if (server->map == NULL) {
+        return IB_EINVAL;
+    }
+
+    hash = shm_hash(server, key, &key_data, &key_length);
+
+    rc = shm_lock(server);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    slot = slot_find(server, hash, key_data, key_length, NULL);
+    if (slot != NULL) {
+        slot_write_begin(slot);
+        slot->state = SLOT_REMOVED;
+        slot_write_end(slot);
+    }
+
+    shm_unlock(server);
+    return IB_OK;
+}
+
+/**
+ * Destroy any allocated elements of the kvstore structure.
+ * @param[out] kvstore to be destroyed. The table file is untouched
+ *             and another init of kvstore pointing at that file
+ *             will operate correctly.
+ * @param[in] cbdata Unused.
+ */
+static void kvdestroy(ib_kvstore_t* kvstore, ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+
+    shm_server_t *server = (shm_server_t *)(kvstore->server);
+
+    shm_close_table(server);
+    ib_lock_destroy_malloc(server->lock);
+    free(server->path);
+    free(server);
+    kvstore->server = NULL;
+
+    return;
+}
+
+ib_status_t ib_kvstore_shm_init(
+    ib_kvstore_t *kvstore,
+    const char   *path,
+    size_t        slots,
+    size_t        slot_size)
+{
+    assert(kvstore != NULL);
+    assert(path != NULL);
+
+    ib_status_t   rc;
+    shm_server_t *server;
+
+    /* Keep slot headers aligned. */
+    slot_size = (slot_size + 7) & ~(size_t)7;
+    if (
+        slots == 0 || slots > UINT32_MAX ||
+        slot_size <= sizeof(slot_header_t) || slot_size > UINT32_MAX
+    ) {
+        return IB_EINVAL;
+    }
+
+    /* There is no callback data used for this implementation. */
+    ib_kvstore_init(kvstore);
+
+    server = calloc(1, sizeof(*server));
+    if (server == NULL) {
+        return IB_EALLOC;
+    }
+
+    server->path      = strdup(path);
+    server->slots     = slots;
+    server->slot_size = slot_size;
+    server->fd        = -1;
+    server->map       = NULL;
+
+    if (server->path == NULL) {
+        free(server);
+        return IB_EALLOC;
+    }
+
+    rc = ib_lock_create_malloc(&(server->lock));
+    if (rc != IB_OK) {
+        free(server->path);
+        free(server);
+        return rc;
+    }
+
+    kvstore->server = (ib_kvstore_server_t *)server;
+    kvstore->get = kvget;
+    kvstore->set = kvset;
+    kvstore->remove = kvremove;
+    kvstore->connect = kvconnect;
+    kvstore->disconnect = kvdisconnect;
+    kvstore->destroy = kvdestroy;
+    kvstore->default_merge_policy = kvstore_shm_merge_policy;
+
+    kvstore->malloc_cbdata = NULL;
+    kvstore->free_cbdata = NULL;
+    kvstore->connect_cbdata = NULL;
+    kvstore->disconnect_cbdata = NULL;
+    kvstore->get_cbdata = NULL;
+    kvstore->set_cbdata = NULL;
+    kvstore->remove_cbdata = NULL;
+    kvstore->merge_policy_cbdata = NULL;
+    kvstore->destroy_cbdata = NULL;
+
+    return IB_OK;
+}
@@ -0,0 +1,735 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Write-behind queue in front of another key-value store.
+ *
+ * Writes are queued in a batch: a lite memory pool holding copies of the
+ * keys and values, a hash of the pending write of each key and a list of
+ * them in order.  The writer thread takes the whole batch, so producers
+ * start a new one, writes it without the lock held and then destroys it.
+ * Until then, the batch being written is still searched by gets, as the
+ * backing store may not have its values yet.
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/kvstore_writebehind.h>
+
+#include "kvstore_private.h"
+
+#include <ironbee/clock.h>
+#include <ironbee/hash.h>
+#include <ironbee/kvstore.h>
+#include <ironbee/list.h>
+#include <ironbee/mm_mpool_lite.h>
+#include <ironbee/util.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/**
+ * A queued write.
+ */
+typedef struct {
+    ib_kvstore_key_t             *key;          /**< Key. */
+    ib_kvstore_value_t           *value;        /**< Value; NULL to remove. */
+    ib_time_t                     expiration;   /**< Absolute expiration. */
+    ib_kvstore_merge_policy_fn_t  merge_policy; /**< Passed to backing set. */
+} pending_t;
+
+/**
+ * A batch of queued writes.
+ */
+typedef struct {
+    ib_mpool_lite_t *mp;     /**< Memory of everything in the batch. */
+    ib_hash_t       *index;  /**< Key to its @ref pending_t. */
+    ib_list_t       *order;  /**< @ref pending_t in order queued. */
+    size_t           writes; /**< Writes queued, including replaced ones. */
+} batch_t;
+
+/**
+ * The write-behind server object.
+ */
+typedef struct {
+    ib_kvstore_t    *backing;     /**< Backing store. */
+    size_t           max_pending; /**< Writes queued before writers wait. */
+    pthread_mutex_t  mutex;       /**< Guards the fields below. */
+    pthread_cond_t   queued;      /**< Signals the writer thread. */
+    pthread_cond_t   written;     /**< Signals that a batch was written. */
+    batch_t         *current;     /**< Batch being queued to or NULL. */
+    batch_t         *flushing;    /**< Batch being written or NULL. */
+    pthread_t        thread;      /**< Writer thread. */
+    pid_t            pid;         /**< Process of thread; 0 if none. */
+    bool             stop;        /**< Thread should exit. */
+} writebehind_server_t;
+
+/**
+ * Current time, as the backing stores see it.
+ *
+ * @returns Current time.
+ */
+static ib_time_t writebehind_now(void)
+{
+    ib_timeval_t tv;
+
+    ib_clock_gettimeofday(&tv);
+    return IB_CLOCK_TIMEVAL_TIME(tv);
+}
+
+/**
+ * Create an empty batch.
+ *
+ * @param[out] batch The new batch.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t batch_create(batch_t **batch)
+{
+    assert(batch != NULL);
+
+    ib_mpool_lite_t *mp;
+    ib_mm_t          mm;
+    batch_t         *new_batch;
+
+    if (ib_mpool_lite_create(&mp) != IB_OK) {
+        return IB_EALLOC;
+    }
+    mm = ib_mm_mpool_lite(mp);
+
+    new_batch = ib_mm_calloc(mm, 1, sizeof(*new_batch));
+    if (
+        new_batch == NULL ||
+        ib_hash_create(&(new_batch->index), mm) != IB_OK ||
+        ib_list_create(&(new_batch->order), mm) != IB_OK
+    ) {
+        ib_mpool_lite_destroy(mp);
+        return IB_EALLOC;
+    }
+    new_batch->mp = mp;
+
+    *batch = new_batch;
+    return IB_OK;
+}
+
+/**
+ * Find the queued write of a key in @a batch.
+ *
+ * @param[in] batch Batch or NULL.
+ * @param[in] key Key.
+ *
+ * @returns Queued write or NULL if there is none.
+ */
+static pending_t *batch_find(const batch_t *batch, const ib_kvstore_key_t *key)
+{
+    const uint8_t *key_data;
+    size_t         key_length;
+    pending_t     *pending;
+
+    if (batch == NULL) {
+        return NULL;
+    }
+
+    ib_kvstore_key_get(key, &key_data, &key_length);
+    if (
+        ib_hash_get_ex(
+            batch->index, &pending, (const char *)key_data, key_length
+        ) != IB_OK
+    ) {
+        return NULL;
+    }
+
+    return pending;
+}
+
+/**
+ * Write every queued write of @a batch to @a backing.
+ *
+ * @param[in] backing Backing store.
+ * @param[in] batch Batch; not modified.
+ */
+static void batch_write(ib_kvstore_t *backing, const batch_t *batch)
+{
+    const ib_list_node_t *node;
+    ib_mpool_lite_t      *mp;
+    ib_mm_t               mm;
+
+    if (ib_mpool_lite_create(&mp) != IB_OK) {
+        ib_util_log_error("kvstore: Failed to allocate write-behind batch.");
+        return;
+    }
+    mm = ib_mm_mpool_lite(mp);
+
+    IB_LIST_LOOP_CONST(batch->order, node) {
+        const pending_t *pending = ib_list_node_data_const(node);
+        ib_status_t      rc;
+
+        if (pending->value == NULL) {
+            rc = ib_kvstore_remove(backing, pending->key);
+            if (rc == IB_ENOENT) {
+                rc = IB_OK;
+            }
+        }
+        else {
+            ib_time_t           now = writebehind_now();
+            ib_kvstore_value_t *value;
+            const uint8_t      *data;
+            size_t              data_length;
+            const char         *type;
+            size_t              type_length;
+
+            /* Backing stores take expiration relative to when they are
+             * written, so give them what remains of it.  Gets may read
+             * the queued value meanwhile, so it is not modified. */
+            rc = ib_kvstore_value_create(&value, mm);
+            if (rc == IB_OK) {
+                ib_kvstore_value_value_get(pending->value, &data, &data_length);
+                ib_kvstore_value_type_get(pending->value, &type, &type_length);
+                ib_kvstore_value_value_set(value, data, data_length);
+                ib_kvstore_value_type_set(value, type, type_length);
+                ib_kvstore_value_creation_set(
+                    value, ib_kvstore_value_creation_get(pending->value));
+                ib_kvstore_value_expiration_set(
+                    value,
+                    (pending->expiration > now) ? pending->expiration - now : 0);
+
+                rc = ib_kvstore_set(
+                    backing, pending->merge_policy, pending->key, value);
+            }
+        }
+
+        if (rc != IB_OK) {
+            const uint8_t *key_data;
+            size_t         key_length;
+
+            ib_kvstore_key_get(pending->key, &key_data, &key_length);
+            ib_util_log_error(
+                "kvstore: Failed to write behind key \"%.*s\": %s",
+                (int)key_length, (const char *)key_data,
+                ib_status_to_string(rc));
+        }
+    }
+
+    ib_mpool_lite_destroy(mp);
+}
+
+/**
+ * Body of the writer thread.
+ *
+ * @param[in] data The @ref writebehind_server_t.
+ *
+ * @returns NULL
+ */
+static void *writebehind_thread(void *data)
+{
+    assert(data != NULL);
+
+    writebehind_server_t *server = (writebehind_server_t *)data;
+
+    pthread_mutex_lock(&(server->mutex));
+    for (;;) {
+        while (server->current == NULL && ! server->stop) {
+            pthread_cond_wait(&(server->queued), &(server->mutex));
+        }
+        /* Drain before honoring a stop request. */
+        if (server->current == NULL) {
+            break;
+        }
+        server->flushing = server->current;
+        server->current  = NULL;
+        /* Writers waiting for room may queue to a new batch. */
+        pthread_cond_broadcast(&(server->written));
+        pthread_mutex_unlock(&(server->mutex));
+
+        batch_write(server->backing, server->flushing);
+
+        pthread_mutex_lock(&(server->mutex));
+        ib_mpool_lite_destroy(server->flushing->mp);
+        server->flushing = NULL;
+        pthread_cond_broadcast(&(server->written));
+    }
+    pthread_mutex_unlock(&(server->mutex));
+
+    return NULL;
+}
+
+/**
+ * Queue a write.
+ *
+ * Starts the writer thread if this process has none.  If it can not be
+ * started, the write is made directly.
+ *
+ * @param[in] server Server.
+ * @param[in] merge_policy Merge policy for the backing set.
+ * @param[in] key Key.
+ * @param[in] value Value or NULL to remove @a key.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ *   - Result of the backing store if the write is made directly.
+ */
+static ib_status_t writebehind_queue(
+    writebehind_server_t         *server,
+    ib_kvstore_merge_policy_fn_t  merge_policy,
+    const ib_kvstore_key_t       *key,
+    ib_kvstore_value_t           *value
+)
+{
+    const uint8_t      *key_data;
+    size_t              key_length;
+    pending_t          *pending;
+    ib_kvstore_value_t *value_copy = NULL;
+    ib_mm_t             mm;
+    ib_status_t         rc = IB_OK;
+
+    pthread_mutex_lock(&(server->mutex));
+
+    if (server->pid != getpid()) {
+        /* Writes queued by a parent process are its own to write. */
+        if (server->pid != 0) {
+            if (server->current != NULL) {
+                ib_mpool_lite_destroy(server->current->mp);
+                server->current = NULL;
+            }
+            if (server->flushing != NULL) {
+                ib_mpool_lite_destroy(server->flushing->mp);
+                server->flushing = NULL;
+            }
+            /* The conditions still count the thread of the parent as a
+             * waiter, which would take the signals meant for ours. */
+            pthread_cond_init(&(server->queued), NULL);
+            pthread_cond_init(&(server->written), NULL);
+        }
+        if (
+            pthread_create(
+                &(server->thread), NULL, writebehind_thread, server) != 0
+        ) {
+            pthread_mutex_unlock(&(server->mutex));
+            ib_util_log_error("kvstore: Failed to start write-behind thread.");
+            if (value == NULL) {
+                return ib_kvstore_remove(server->backing, key);
+            }
+            return ib_kvstore_set(server->backing, merge_policy, key, value);
+        }
+        server->pid = getpid();
+    }
+
+    while (
+        server->current != NULL &&
+        server->current->writes >= server->max_pending
+    ) {
+        pthread_cond_wait(&(server->written), &(server->mutex));
+    }
+
+    if (server->current == NULL) {
+        rc = batch_create(&(server->current));
+        if (rc != IB_OK) {
+            goto exit;
+        }
+    }
+    mm = ib_mm_mpool_lite(server->current->mp);
+
+    if (value != NULL) {
+        rc = ib_kvstore_value_dup(mm, value, &value_copy);
+        if (rc != IB_OK) {
+            goto exit;
+        }
+    }
+
+    /* A queued write of the key is replaced in place, keeping its
+     * position in the order. */
+    pending = batch_find(server->current, key);
+    if (pending == NULL) {
+        uint8_t *key_copy;
+
+        ib_kvstore_key_get(key, &key_data, &key_length);
+        pending  = ib_mm_calloc(mm, 1, sizeof(*pending));
+        key_copy = ib_mm_alloc(mm, key_length + 1);
+        if (pending == NULL || key_copy == NULL) {
+            rc = IB_EALLOC;
+            goto exit;
+        }
+        memcpy(key_copy, key_data, key_length);
+
+        rc = ib_kvstore_key_create(&(pending->key), mm, key_copy, key_length);
+        if (rc != IB_OK) {
+            goto exit;
+        }
+        rc = ib_hash_set_ex(
+            server->current->index,
+            (const char *)key_copy,
+            key_length,
+            pending);
+        if (rc != IB_OK) {
+            goto exit;
+        }
+        rc = ib_list_push(server->current->order, pending);
+        if (rc != IB_OK) {
+            ib_hash_remove_ex(
+                server->current->index, NULL, (const char *)key_copy,
+                key_length);
+            goto exit;
+        }
+    }
+
+    pending->value = value_copy;
+    if (value != NULL) {
+        pending->expiration =
+            writebehind_now() + ib_kvstore_value_expiration_get(value);
+    }
+    pending->merge_policy = merge_policy;
+
+    ++server->current->writes;
+    pthread_cond_signal(&(server->queued));
+
+exit:
+    pthread_mutex_unlock(&(server->mutex));
+    return rc;
+}
+
+/**
+ * Trivial merge policy that returns the first value in the list
+ * if the list is size 1 or greater.
+ *
+ * The write-behind store only ever returns one value; the backing store's
+ * own merge policy is applied when a get goes to it.
+ *
+ * @param[in] kvstore Key-value store.
+ * @param[in] key The key that the values are listed under.
+ * @param[in] values Array of @ref ib_kvstore_value_t pointers.
+ * @param[in] value_size The length of values.
+ * @param[out] resultant_value Pointer to values[0] if value_size > 0.
+ * @param[in,out] cbdata Context callback data.
+ * @returns IB_OK
+ */
+static ib_status_t kvstore_writebehind_merge_policy(
+    ib_kvstore_t            *kvstore,
+    const ib_kvstore_key_t  *key,
+    ib_kvstore_value_t     **values,
+    size_t                   value_size,
+    ib_kvstore_value_t     **resultant_value,
+    ib_kvstore_cbdata_t     *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(key != NULL);
+    assert(resultant_value != NULL);
+
+    if (value_size > 0) {
+        *resultant_value = values[0];
+    }
+
+    return IB_OK;
+}
+
+static ib_status_t kvconnect(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    writebehind_server_t *server = (writebehind_server_t *)kvstore->server;
+
+    return ib_kvstore_connect(server->backing);
+}
+
+static ib_status_t kvdisconnect(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    writebehind_server_t *server = (writebehind_server_t *)kvstore->server;
+
+    ib_kvstore_writebehind_flush(kvstore);
+
+    return ib_kvstore_disconnect(server->backing);
+}
+
+/**
+ * Get implementation.
+ *
+ * Returns the queued write of @a key if there is one, otherwise the value
+ * in the backing store.
+ *
+ * @param[in] kvstore The key-value store.
+ * @param[in] mm Memory manager to allocate @a values out of.
+ * @param[in] key The key to fetch.
+ * @param[out] values A pointer to an array of pointers.
+ * @param[out] values_length The length of *values.
+ * @param[in,out] cbdata Callback data. Unused.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_ENOENT if @a key has no value.
+ *   - IB_EALLOC on allocation failure.
+ *   - Other on failure of the backing store.
+ */
+static ib_status_t kvget(
+    ib_kvstore_t             *kvstore,
+    ib_mm_t                   mm,
+    const ib_kvstore_key_t   *key,
+    ib_kvstore_value_t     ***values,
+    size_t                   *values_length,
+    ib_kvstore_cbdata_t      *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+    assert(key != NULL);
+
+    writebehind_server_t *server = (writebehind_server_t *)kvstore->server;
+    const pending_t      *pending;
+    ib_kvstore_value_t   *value;
+    ib_kvstore_value_t  **array;
+    ib_status_t           rc;
+
+    array = ib_mm_alloc(mm, sizeof(*array));
+    if (array == NULL) {
+        return IB_EALLOC;
+    }
+
+    pthread_mutex_lock(&(server->mutex));
+
+    pending = batch_find(server->current, key);
+    if (pending == NULL) {
+        pending = batch_find(server->flushing, key);
+    }
+
+    if (pending == NULL) {
+        pthread_mutex_unlock(&(server->mutex));
+
+        rc = ib_kvstore_get(server->backing, NULL, mm, key, &value);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+    else if (
+        pending->value == NULL ||
+        pending->expiration < writebehind_now()
+    ) {
+        pthread_mutex_unlock(&(server->mutex));
+        return IB_ENOENT;
+    }
+    else {
+        rc = ib_kvstore_value_dup(mm, pending->value, &value);
+        if (rc == IB_OK) {
+            ib_kvstore_value_expiration_set(value, pending->expiration);
+        }
+        pthread_mutex_unlock(&(server->mutex));
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    array[0]       = value;
+    *values        = array;
+    *values_length = 1;
+
+    return IB_OK;
+}
+
+/**
+ * Set implementation.
+ *
+ * @param[in] kvstore Key-value store.
+ * @param[in] merge_policy Passed to the backing store.
+ * @param[in] key The key to set.
+ * @param[in] value The value to write.
+ * @param[in,out] cbdata Callback data for the user.
+ *
+ * @returns
+ *   - IB_OK once queued.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t kvset(
+    ib_kvstore_t                 *kvstore,
+    ib_kvstore_merge_policy_fn_t  merge_policy,
+    const ib_kvstore_key_t       *key,
+    ib_kvstore_value_t           *value,
+    ib_kvstore_cbdata_t          *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+    assert(key != NULL);
+    assert(value != NULL);
+
+    return writebehind_queue(
+        (writebehind_server_t *)kvstore->server, merge_policy, key, value);
+}
+
+/**
+ * Remove implementation.
+ *
+ * @param[in] kvstore Store.
+ * @param[in] key Key.
+ * @param[in,out] cbdata Callback data.
+ *
+ * @returns
+ *   - IB_OK once queued.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t kvremove(
+    ib_kvstore_t *kvstore,
+    const ib_kvstore_key_t *key,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+    assert(key != NULL);
+
+    return writebehind_queue(
+        (writebehind_server_t *)kvstore->server, NULL, key, NULL);
+}
+
+/**
+ * Destroy any allocated elements of the kvstore structure.
+ *
+ * Waits for queued writes.
+ *
+ * @param[out] kvstore to be destroyed. The backing store is untouched.
+ * @param[in] cbdata Unused.
+ */
+static void kvdestroy(ib_kvstore_t* kvstore, ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+
+    writebehind_server_t *server = (writebehind_server_t *)(kvstore->server);
+    bool                  running;
+
+    pthread_mutex_lock(&(server->mutex));
+    running = (server->pid == getpid());
+    server->stop = true;
+    pthread_cond_signal(&(server->queued));
+    pthread_mutex_unlock(&(server->mutex));
+
+    if (running) {
+        pthread_join(server->thread, NULL);
+    }
+    else {
+        /* Queued by a parent process, which writes them itself. */
+        if (server->current != NULL) {
+            ib_mpool_lite_destroy(server->current->mp);
+        }
+        if (server->flushing != NULL) {
+            ib_mpool_lite_destroy(server->flushing->mp);
+        }
+    }
+
+    pthread_cond_destroy(&(server->written));
+    pthread_cond_destroy(&(server->queued));
+    pthread_mutex_destroy(&(server->mutex));
+    free(server);
+    kvstore->server = NULL;
+
+    return;
+}
+
+void ib_kvstore_writebehind_flush(ib_kvstore_t *kvstore)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    writebehind_server_t *server = (writebehind_server_t *)kvstore->server;
+
+    pthread_mutex_lock(&(server->mutex));
+    if (server->pid == getpid()) {
+        while (server->current != NULL || server->flushing != NULL) {
+            pthread_cond_wait(&(server->written), &(server->mutex));
+        }
+    }
+    pthread_mutex_unlock(&(server->mutex));
+}
+
+ib_status_t ib_kvstore_writebehind_init(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_t *backing,
+    size_t        max_pending)
+{
+    assert(kvstore != NULL);
+    assert(backing != NULL);
+
+    writebehind_server_t *server;
+
+    if (max_pending == 0) {
+        return IB_EINVAL;
+    }
+
+    /* There is no callback data used for this implementation. */
+    ib_kvstore_init(kvstore);
+
+    server = calloc(1, sizeof(*server));
+    if (server == NULL) {
+        return IB_EALLOC;
+    }
+
+    if (pthread_mutex_init(&(server->mutex), NULL) != 0) {
+        free(server);
+        return IB_EOTHER;
+    }
+    if (pthread_cond_init(&(server->queued), NULL) != 0) {
+        pthread_mutex_destroy(&(server->mutex));
+        free(server);
+        return IB_EOTHER;
+    }
+    if (pthread_cond_init(&(server->written), NULL) != 0) {
+        pthread_cond_destroy(&(server->queued));
+        pthread_mutex_destroy(&(server->mutex));
+        free(server);
+        return IB_EOTHER;
+    }
+
+    server->backing     = backing;
+    server->max_pending = max_pending;
+    server->current     = NULL;
+    server->flushing    = NULL;
+    server->pid         = 0;
+    server->stop        = false;
+
+    kvstore->server = (ib_kvstore_server_t *)server;
+    kvstore->get = kvget;
+    kvstore->set = kvset;
+    kvstore->remove = kvremove;
+    kvstore->connect = kvconnect;
+    kvstore->disconnect = kvdisconnect;
+    kvstore->destroy = kvdestroy;
+    kvstore->default_merge_policy = kvstore_writebehind_merge_policy;
+
+    kvstore->malloc_cbdata = NULL;
+    kvstore->free_cbdata = NULL;
+    kvstore->connect_cbdata = NULL;
+    kvstore->disconnect_cbdata = NULL;
+    kvstore->get_cbdata = NULL;
+    kvstore->set_cbdata = NULL;
+    kvstore->remove_cbdata = NULL;
+    kvstore->merge_policy_cbdata = NULL;
+    kvstore->destroy_cbdata = NULL;
+
+    return IB_OK;
+}
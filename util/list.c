@@ -31,6 +31,56 @@
 
 #include <assert.h>
 
+/** Most nodes allocated at once by list_node_alloc(). */
+#define LIST_NODE_CHUNK_MAX 32
+
+/**
+ * Allocate a list node, reusing a node of a cleared list if possible.
+ *
+ * New nodes are allocated in chunks as large as the list, up to
+ * @ref LIST_NODE_CHUNK_MAX, and the rest of the chunk is kept as spares.
+ * A growing list thus takes few allocations and its nodes sit next to each
+ * other in memory, while a list of one element still takes one node.
+ *
+ * @param[in] list List the node is for
+ *
+ * @returns Zeroed node or NULL on allocation failure.
+ */
+static ib_list_node_t *list_node_alloc(ib_list_t *list)
+{
+    ib_list_node_t *node = list->spare;
+
+    if (node == NULL) {
+        size_t count = list->nelts;
+
+        if (count == 0) {
+            count = 1;
+        }
+        else if (count > LIST_NODE_CHUNK_MAX) {
+            count = LIST_NODE_CHUNK_MAX;
+        }
+
+        node = (ib_list_node_t *)ib_mm_calloc(list->mm, count, sizeof(*node));
+        if (node == NULL) {
+            return NULL;
+        }
+
+        /* Spares are used in order of address. */
+        for (size_t i = count - 1; i > 0; --i) {
+            node[i].next = list->spare;
+            list->spare = &(node[i]);
+        }
+
+        return node;
+    }
+
+    list->spare = node->next;
+    node->next = node->prev = NULL;
+    node->data = NULL;
+
+    return node;
+}
+
 ib_status_t ib_list_create(ib_list_t **plist, ib_mm_t mm)
 {
     /* Create the structure. */
@@ -89,14 +139,13 @@ ib_status_t ib_list_copy(const ib_list_t *src,
 
 ib_status_t ib_list_push(ib_list_t *list, void *data)
 {
-    ib_list_node_t *node = (ib_list_node_t *)ib_mm_calloc(list->mm,
-        1, sizeof(*node)
-    );
+    ib_list_node_t *node = list_node_alloc(list);
     if (node == NULL) {
         return IB_EALLOC;
     }
     node->data = data;
 
+    ++list->version;
     if (list->nelts == 0) {
         IB_LIST_GEN_NODE_INSERT_INITIAL(list, node);
         return IB_OK;
@@ -116,6 +165,7 @@ ib_status_t ib_list_pop(ib_list_t *list, void *pdata)
         return IB_ENOENT;
     }
 
+    ++list->version;
     if (pdata != NULL) {
         *(void **)pdata = IB_LIST_GEN_NODE_DATA(list->tail);
     }
@@ -126,14 +176,13 @@ ib_status_t ib_list_pop(ib_list_t *list, void *pdata)
 
 ib_status_t ib_list_unshift(ib_list_t *list, void *data)
 {
-    ib_list_node_t *node = (ib_list_node_t *)ib_mm_calloc(list->mm,
-        1, sizeof(*node)
-    );
+    ib_list_node_t *node = list_node_alloc(list);
     if (node == NULL) {
         return IB_EALLOC;
     }
     node->data = data;
 
+    ++list->version;
     if (list->nelts == 0) {
         IB_LIST_GEN_NODE_INSERT_INITIAL(list, node);
         return IB_OK;
@@ -153,6 +202,7 @@ ib_status_t ib_list_shift(ib_list_t *list, void *pdata)
         return IB_ENOENT;
     }
 
+    ++list->version;
     if (pdata != NULL) {
         *(void **)pdata = IB_LIST_GEN_NODE_DATA(list->head);
     }
@@ -163,6 +213,13 @@ ib_status_t ib_list_shift(ib_list_t *list, void *pdata)
 
 void ib_list_clear(ib_list_t *list)
 {
+    /* Keep the nodes, which are still chained, for reuse. */
+    if (list->tail != NULL) {
+        list->tail->next = list->spare;
+        list->spare = list->head;
+    }
+
+    ++list->version;
     list->nelts = 0;
     list->head = list->tail = NULL;
     return;
@@ -173,6 +230,11 @@ size_t ib_list_elements(const ib_list_t *list)
     return list->nelts;
 }
 
+size_t ib_list_version(const ib_list_t *list)
+{
+    return list->version;
+}
+
 ib_list_node_t *ib_list_first(ib_list_t *list)
 {
     return IB_LIST_GEN_FIRST(list);
@@ -215,6 +277,7 @@ const ib_list_node_t *ib_list_node_prev_const(const ib_list_node_t *node)
 
 void ib_list_node_remove(ib_list_t *list, ib_list_node_t *node)
 {
+    ++list->version;
     IB_LIST_GEN_NODE_REMOVE(list, node);
     return;
 }
@@ -251,13 +314,13 @@ ib_status_t ib_list_insert(ib_list_t *list, void *data, const size_t index)
     }
 
     /* Create the new node. */
-    insert_node =
-        (ib_list_node_t *)ib_mm_calloc(list->mm, 1, sizeof(*insert_node));
+    insert_node = list_node_alloc(list);
     if (insert_node == NULL) {
         return IB_EALLOC;
     }
     insert_node->data = data;
 
+    ++list->version;
     /* If the input is valid and the list is size 0, initialize it. */
     if (IB_LIST_GEN_ELEMENTS(list) == 0) {
         IB_LIST_GEN_NODE_INSERT_INITIAL(list, insert_node);
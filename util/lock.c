@@ -25,6 +25,69 @@
 
 #include <ironbee/lock.h>
 
+#include <errno.h>
+#include <stdlib.h>
+
+/**
+ * Initialize a mutex, making it adaptive where supported.
+ *
+ * @param[in] lock The lock.
+ *
+ * @returns pthread status code.
+ */
+static int lock_init(ib_lock_t *lock)
+{
+#ifdef PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP
+    pthread_mutexattr_t attr;
+    int                 rc;
+
+    rc = pthread_mutexattr_init(&attr);
+    if (rc != 0) {
+        return rc;
+    }
+    rc = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ADAPTIVE_NP);
+    if (rc == 0) {
+        rc = pthread_mutex_init(lock, &attr);
+    }
+    pthread_mutexattr_destroy(&attr);
+
+    return rc;
+#else
+    return pthread_mutex_init(lock, NULL);
+#endif
+}
+
+/**
+ * Initialize a reader-writer lock, preferring writers where supported.
+ *
+ * @param[in] lock The lock.
+ *
+ * @returns pthread status code.
+ */
+static int rwlock_init(ib_rwlock_t *lock)
+{
+#ifdef PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP
+    pthread_rwlockattr_t attr;
+    int                  rc;
+
+    rc = pthread_rwlockattr_init(&attr);
+    if (rc != 0) {
+        return rc;
+    }
+    rc = pthread_rwlockattr_setkind_np(
+        &attr,
+        PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    if (rc == 0) {
+        rc = pthread_rwlock_init(lock, &attr);
+    }
+    pthread_rwlockattr_destroy(&attr);
+
+    return rc;
+#else
+    return pthread_rwlock_init(lock, NULL);
+#endif
+}
+
 static void lock_destroy(void *cbdata)
 {
     ib_lock_t *lock = (ib_lock_t *)cbdata;
@@ -52,7 +115,7 @@ ib_status_t ib_lock_create(ib_lock_t **lock, ib_mm_t mm)
         return IB_EALLOC;
     }
 
-    rc = pthread_mutex_init(l, NULL);
+    rc = lock_init(l);
     if (rc != 0) {
         return IB_EALLOC;
     }
@@ -77,7 +140,7 @@ ib_status_t ib_lock_create_malloc(ib_lock_t **lock)
         return IB_EALLOC;
     }
 
-    rc = pthread_mutex_init(l, NULL);
+    rc = lock_init(l);
     if (rc != 0) {
         free(l);
         return IB_EALLOC;
@@ -107,6 +170,19 @@ ib_status_t ib_lock_lock(ib_lock_t *lock)
     return IB_OK;
 }
 
+ib_status_t ib_lock_trylock(ib_lock_t *lock)
+{
+    int rc = pthread_mutex_trylock(lock);
+    if (rc == EBUSY) {
+        return IB_DECLINED;
+    }
+    if (rc != 0) {
+        return IB_EUNKNOWN;
+    }
+
+    return IB_OK;
+}
+
 ib_status_t ib_lock_unlock(ib_lock_t *lock)
 {
     int rc = pthread_mutex_unlock(lock);
@@ -116,3 +192,99 @@ ib_status_t ib_lock_unlock(ib_lock_t *lock)
 
     return IB_OK;
 }
+
+static void rwlock_destroy(void *cbdata)
+{
+    ib_rwlock_t *lock = (ib_rwlock_t *)cbdata;
+
+    if (lock == NULL) {
+        return;
+    }
+
+    pthread_rwlock_destroy(lock);
+}
+
+ib_status_t ib_rwlock_create(ib_rwlock_t **lock, ib_mm_t mm)
+{
+    ib_rwlock_t *l;
+    int          rc;
+
+    l = ib_mm_alloc(mm, sizeof(*l));
+    if (l == NULL) {
+        return IB_EALLOC;
+    }
+
+    rc = rwlock_init(l);
+    if (rc != 0) {
+        return IB_EALLOC;
+    }
+
+    rc = ib_mm_register_cleanup(mm, &rwlock_destroy, l);
+    if (rc != 0) {
+        return IB_EOTHER;
+    }
+
+    *lock = l;
+
+    return IB_OK;
+}
+
+ib_status_t ib_rwlock_create_malloc(ib_rwlock_t **lock)
+{
+    ib_rwlock_t *l;
+    int          rc;
+
+    l = malloc(sizeof(*l));
+    if (l == NULL) {
+        return IB_EALLOC;
+    }
+
+    rc = rwlock_init(l);
+    if (rc != 0) {
+        free(l);
+        return IB_EALLOC;
+    }
+
+    *lock = l;
+
+    return IB_OK;
+}
+
+void ib_rwlock_destroy_malloc(ib_rwlock_t *lock)
+{
+    if (lock != NULL) {
+        rwlock_destroy(lock);
+
+        free(lock);
+    }
+}
+
+ib_status_t ib_rwlock_rdlock(ib_rwlock_t *lock)
+{
+    int rc = pthread_rwlock_rdlock(lock);
+    if (rc != 0) {
+        return IB_EUNKNOWN;
+    }
+
+    return IB_OK;
+}
+
+ib_status_t ib_rwlock_wrlock(ib_rwlock_t *lock)
+{
+    int rc = pthread_rwlock_wrlock(lock);
+    if (rc != 0) {
+        return IB_EUNKNOWN;
+    }
+
+    return IB_OK;
+}
+
+ib_status_t ib_rwlock_unlock(ib_rwlock_t *lock)
+{
+    int rc = pthread_rwlock_unlock(lock);
+    if (rc != 0) {
+        return IB_EUNKNOWN;
+    }
+
+    return IB_OK;
+}
@@ -30,6 +30,7 @@
 #include <ironbee/logformat.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 typedef enum {
     STATE_NORMAL,
@@ -147,6 +148,53 @@ static ib_status_t create_item_field(ib_logformat_t *lf,
     return IB_OK;
 }
 
+/**
+ * Compile the items of @a lf into its ops.
+ *
+ * @param[in] lf Logformat with parsed items.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static ib_status_t compile_items(ib_logformat_t *lf)
+{
+    assert(lf != NULL);
+
+    const ib_list_node_t *node;
+    ib_logformat_op_t *ops;
+    size_t i = 0;
+
+    ops = (ib_logformat_op_t *)ib_mm_calloc(
+        lf->mm, ib_list_elements(lf->items) + 1, sizeof(*ops));
+    if (ops == NULL) {
+        return IB_EALLOC;
+    }
+
+    IB_LIST_LOOP_CONST(lf->items, node) {
+        const ib_logformat_item_t *item =
+            (const ib_logformat_item_t *)ib_list_node_data_const(node);
+
+        if (item->itype == item_type_literal) {
+            ops[i].len = item->item.literal.len;
+            if (ops[i].len <= IB_LOGFORMAT_MAX_SHORT_LITERAL) {
+                ops[i].str = item->item.literal.buf.short_str;
+            }
+            else {
+                ops[i].str = item->item.literal.buf.str;
+            }
+        }
+        else {
+            ops[i].field = &(item->item.field);
+        }
+        ++i;
+    }
+
+    lf->ops = ops;
+    lf->ops_len = i;
+    return IB_OK;
+}
+
 ib_status_t ib_logformat_parse(ib_logformat_t *lf,
                                const char *format)
 {
@@ -264,6 +312,11 @@ ib_status_t ib_logformat_parse(ib_logformat_t *lf,
 
     /* Add any literal string we might be in the middle of */
     rc = create_item_literal(lf, literal_buf, literal_cur);
+    if (rc != IB_OK) {
+        goto cleanup;
+    }
+
+    rc = compile_items(lf);
 
 cleanup:
     if (literal_buf != NULL) {
@@ -285,47 +338,29 @@ ib_status_t ib_logformat_format(const ib_logformat_t *lf,
     assert(fn != NULL);
 
     ib_status_t rc;
-    const ib_list_node_t *node;
     size_t line_remain = line_size - 1;
     char *line_cur = line;
     bool truncated = false;
 
-    IB_LIST_LOOP_CONST(lf->items, node) {
-        const ib_logformat_item_t *item =
-            (const ib_logformat_item_t *)ib_list_node_data_const(node);
-        const char *str;
-        size_t len;
-
-        switch (item->itype) {
-        case item_type_literal:
-            len = item->item.literal.len;
-            if (len <= IB_LOGFORMAT_MAX_SHORT_LITERAL) {
-                str = item->item.literal.buf.short_str;
-            }
-            else {
-                str = item->item.literal.buf.str;
-            }
-            break;
+    for (size_t i = 0; i < lf->ops_len; ++i) {
+        const ib_logformat_op_t *op = &(lf->ops[i]);
+        const char *str = op->str;
+        size_t len = op->len;
 
-        case item_type_format:
-            rc = fn(lf, &(item->item.field), fndata, &str);
+        if (str == NULL) {
+            rc = fn(lf, op->field, fndata, &str);
             if (rc != IB_OK) {
                 return rc;
             }
             len = strlen(str);
-            break;
-
-        default:
-            assert(0);
-            return IB_EINVAL;
         }
 
         /* Copy into buffer */
-        strncpy(line_cur, str, line_remain);
         if (len > line_remain) {
             len = line_remain;
             truncated = true;
         }
+        memcpy(line_cur, str, len);
         line_cur += len;
         line_remain -= len;
 
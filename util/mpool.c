@@ -36,6 +36,7 @@
 #endif
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -142,6 +143,25 @@ static char s_zero_length_buffer[1];
  **/
 #define IB_MPOOL_TRACK_ZERO_SIZE 8
 
+/**
+ * Number of pages each thread keeps for reuse by any memory pool.
+ *
+ * Pages of destroyed memory pools that use the default page size, malloc()
+ * and free() are kept in a per-thread cache instead of being freed, and new
+ * pages of such pools are taken from the cache before calling malloc().
+ * Short lived pools, such as transaction pools, then rarely call malloc()
+ * and free() for pages.  The cache of a thread is freed when the thread
+ * exits.
+ *
+ * Set to 0 to disable the cache.  Disabled when IB_MPOOL_VALGRIND is defined
+ * so that valgrind sees every page freed.
+ **/
+#ifdef IB_MPOOL_VALGRIND
+#define IB_MPOOL_PAGE_CACHE_SIZE 0
+#else
+#define IB_MPOOL_PAGE_CACHE_SIZE 64
+#endif
+
 /**@}*/
 
 /* Basic Sanity Check -- Otherwise track number calculation fails. */
@@ -177,6 +197,8 @@ struct ib_mpool_page_t
      *  If this address does not match the page address, then this is a
      *  sub-page and MUST NOT be freed. */
     void *slab;
+    /** True iff this page is the only page of its slab. */
+    bool single;
     /**
      * First byte of page.
      *
@@ -357,6 +379,21 @@ struct ib_mpool_t
      **/
     size_t large_allocation_inuse;
 
+    /**
+     * Most bytes that may be in use; 0 means no limit.
+     *
+     * Set via ib_mpool_limit_set().  Allocations that would bring
+     * @ref inuse above it fail.
+     **/
+    size_t limit;
+
+    /**
+     * Has an allocation failed because of @ref limit?
+     *
+     * Reported by ib_mpool_limit_reached(); reset when the pool is cleared.
+     **/
+    bool limit_reached;
+
     /**
      * The parent memory pool.
      **/
@@ -639,6 +676,7 @@ ib_mpool_page_t *ib_mpool_alloc_pages(
 #endif
 
         mpage->slab = slab;
+        mpage->single = (pages == 1);
         mpage->next = mpage_list;
         mpage_list = mpage;
     }
@@ -646,11 +684,172 @@ ib_mpool_page_t *ib_mpool_alloc_pages(
     return mpage_list;
 }
 
+#if IB_MPOOL_PAGE_CACHE_SIZE > 0
+/**
+ * Per-thread page cache.
+ *
+ * @sa IB_MPOOL_PAGE_CACHE_SIZE
+ **/
+typedef struct ib_mpool_page_cache_t ib_mpool_page_cache_t;
+struct ib_mpool_page_cache_t
+{
+    /** Cached pages. */
+    ib_mpool_page_t *pages;
+    /** Number of pages in @c pages. */
+    size_t           num_pages;
+};
+
+/** Key of the page cache of the current thread. */
+static pthread_key_t s_page_cache_key;
+/** Whether s_page_cache_key was created. */
+static bool s_page_cache_key_valid = false;
+/** Creates s_page_cache_key once. */
+static pthread_once_t s_page_cache_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Free a page cache at thread exit.
+ *
+ * @param[in] data Page cache.
+ **/
+static
+void ib_mpool_page_cache_destroy(void *data)
+{
+    ib_mpool_page_cache_t *cache = (ib_mpool_page_cache_t *)data;
+
+    IB_MPOOL_FOREACH(ib_mpool_page_t, mpage, cache->pages) {
+        free(mpage);
+    }
+    free(cache);
+}
+
+/**
+ * Create s_page_cache_key.
+ **/
+static
+void ib_mpool_page_cache_init(void)
+{
+    s_page_cache_key_valid =
+        (pthread_key_create(&s_page_cache_key, ib_mpool_page_cache_destroy)
+         == 0);
+}
+
+/**
+ * Can the pages of @a mp be shared through the page cache?
+ *
+ * @param[in] mp Memory pool.
+ * @return true iff @a mp uses the default page size, malloc() and free().
+ **/
+static
+bool ib_mpool_page_cache_eligible(
+    const ib_mpool_t *mp
+)
+{
+    return
+        mp->pagesize  == IB_MPOOL_DEFAULT_PAGE_SIZE &&
+        mp->malloc_fn == &malloc &&
+        mp->free_fn   == &free
+        ;
+}
+
+/**
+ * Page cache of the current thread.
+ *
+ * @param[in] create Create the cache if the thread has none.
+ * @return Page cache or NULL.
+ **/
+static
+ib_mpool_page_cache_t *ib_mpool_page_cache(bool create)
+{
+    ib_mpool_page_cache_t *cache;
+
+    pthread_once(&s_page_cache_once, ib_mpool_page_cache_init);
+    if (! s_page_cache_key_valid) {
+        return NULL;
+    }
+
+    cache = (ib_mpool_page_cache_t *)pthread_getspecific(s_page_cache_key);
+    if (cache == NULL && create) {
+        cache = (ib_mpool_page_cache_t *)calloc(1, sizeof(*cache));
+        if (cache == NULL) {
+            return NULL;
+        }
+        if (pthread_setspecific(s_page_cache_key, cache) != 0) {
+            free(cache);
+            return NULL;
+        }
+    }
+
+    return cache;
+}
+
+/**
+ * Take a page from the page cache of the current thread.
+ *
+ * @param[in] mp Memory pool the page is for.
+ * @return Page or NULL if none available.
+ **/
+static
+ib_mpool_page_t *ib_mpool_page_cache_get(
+    const ib_mpool_t *mp
+)
+{
+    ib_mpool_page_cache_t *cache;
+    ib_mpool_page_t       *mpage;
+
+    if (! ib_mpool_page_cache_eligible(mp)) {
+        return NULL;
+    }
+    cache = ib_mpool_page_cache(false);
+    if (cache == NULL || cache->pages == NULL) {
+        return NULL;
+    }
+
+    mpage = cache->pages;
+    cache->pages = mpage->next;
+    --cache->num_pages;
+
+    return mpage;
+}
+
+/**
+ * Give a page to the page cache of the current thread.
+ *
+ * @param[in] mp    Memory pool the page belonged to.
+ * @param[in] mpage Page; must be the only page of its slab.
+ * @return true iff the page was cached; if false, caller must free it.
+ **/
+static
+bool ib_mpool_page_cache_put(
+    const ib_mpool_t *mp,
+    ib_mpool_page_t  *mpage
+)
+{
+    ib_mpool_page_cache_t *cache;
+
+    assert(mpage->single);
+
+    if (! ib_mpool_page_cache_eligible(mp)) {
+        return false;
+    }
+    cache = ib_mpool_page_cache(true);
+    if (cache == NULL || cache->num_pages >= IB_MPOOL_PAGE_CACHE_SIZE) {
+        return false;
+    }
+
+    mpage->next = cache->pages;
+    cache->pages = mpage;
+    ++cache->num_pages;
+
+    return true;
+}
+#endif
+
 /**
  * Acquire a new page.
  *
- * Pops a page from the free list if available or allocates a new page if
- * not.  The page returned should be considered uninitialized.
+ * Pops a page from the free list if available, then from the page cache of
+ * the current thread, and allocates a new page if neither has one.  The page
+ * returned should be considered uninitialized.
  *
  * @param[in] mp Memory pool to acquire page for.
  * @return Uninitialized page or NULL on allocation error.
@@ -667,12 +866,17 @@ ib_mpool_page_t *ib_mpool_acquire_page(
     if (mp->free_pages != NULL) {
         mpage = mp->free_pages;
         mp->free_pages = mp->free_pages->next;
+        return mpage;
     }
-    else {
-        mpage = ib_mpool_alloc_pages(mp, 1);
+
+#if IB_MPOOL_PAGE_CACHE_SIZE > 0
+    mpage = ib_mpool_page_cache_get(mp);
+    if (mpage != NULL) {
+        return mpage;
     }
+#endif
 
-    return mpage;
+    return ib_mpool_alloc_pages(mp, 1);
 }
 
 /**
@@ -1538,6 +1742,8 @@ ib_status_t ib_mpool_create_ex(
     mp->free_fn                = free_fn;
     mp->inuse                  = 0;
     mp->large_allocation_inuse = 0;
+    mp->limit                  = 0;
+    mp->limit_reached          = false;
     mp->parent                 = parent;
 
     rc = ib_mpool_setname(mp, name);
@@ -1624,6 +1830,34 @@ size_t ib_mpool_inuse(
     return mp->inuse;
 }
 
+void ib_mpool_limit_set(
+    ib_mpool_t *mp,
+    size_t      limit
+)
+{
+    assert(mp != NULL);
+
+    mp->limit = limit;
+}
+
+size_t ib_mpool_limit(
+    const ib_mpool_t *mp
+)
+{
+    assert(mp != NULL);
+
+    return mp->limit;
+}
+
+bool ib_mpool_limit_reached(
+    const ib_mpool_t *mp
+)
+{
+    assert(mp != NULL);
+
+    return mp->limit_reached;
+}
+
 ib_status_t ib_mpool_prealloc_pages(
     ib_mpool_t *mp,
     int pages
@@ -1677,6 +1911,14 @@ void *ib_mpool_alloc(
         return &s_zero_length_buffer;
     }
 
+    if (
+        mp->limit > 0 &&
+        (mp->inuse >= mp->limit || size > mp->limit - mp->inuse)
+    ) {
+        mp->limit_reached = true;
+        return NULL;
+    }
+
     /* Actual size: will add redzone if small allocation. */
     size_t actual_size = size;
 
@@ -1808,6 +2050,7 @@ void ib_mpool_clear(
 
     mp->inuse                  = 0;
     mp->large_allocation_inuse = 0;
+    mp->limit_reached          = false;
 
     IB_MPOOL_FOREACH(ib_mpool_t, child, mp->children) {
         ib_mpool_clear(child);
@@ -1862,6 +2105,11 @@ void ib_mpool_destroy(
     }
 
     IB_MPOOL_FOREACH(ib_mpool_page_t, mpage, freeable) {
+#if IB_MPOOL_PAGE_CACHE_SIZE > 0
+        if (mpage->single && ib_mpool_page_cache_put(mp, mpage)) {
+            continue;
+        }
+#endif
         mp->free_fn(mpage);
     }
 
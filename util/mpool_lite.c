@@ -29,6 +29,16 @@
 #include <ironbee/mpool_lite.h>
 
 #include <assert.h>
+#include <stdint.h>
+
+/** Largest allocation carved from a slab; larger ones get a block each. */
+#define IB_MPOOL_LITE_SMALL    256
+/** Size of the first slab of a pool. */
+#define IB_MPOOL_LITE_SLAB_MIN 1024
+/** Largest slab; each slab is twice the size of the previous up to this. */
+#define IB_MPOOL_LITE_SLAB_MAX 16384
+/** Alignment of memory carved from slabs; must be a power of 2. */
+#define IB_MPOOL_LITE_ALIGN    16
 
 /** Structure to hold cleanup function. */
 struct ib_mpool_lite_cleanup_t
@@ -58,12 +68,21 @@ struct ib_mpool_lite_t
      * Pointer to first allocated block.
      *
      * Each block is a pointer to the next block followed by the memory
-     * returns to the caller.
+     * returned to the caller: a single allocation or a slab.
      **/
     void *first_block;
 
     /** First cleanup function. */
     ib_mpool_lite_cleanup_t *first_cleanup;
+
+    /** Next free byte of the current slab. */
+    char *slab_next;
+
+    /** Bytes left in the current slab. */
+    size_t slab_left;
+
+    /** Size of the next slab. */
+    size_t slab_size;
 };
 
 ib_status_t ib_mpool_lite_create(ib_mpool_lite_t **pool)
@@ -76,6 +95,9 @@ ib_status_t ib_mpool_lite_create(ib_mpool_lite_t **pool)
     }
     local_pool->first_block = NULL;
     local_pool->first_cleanup = NULL;
+    local_pool->slab_next = NULL;
+    local_pool->slab_left = 0;
+    local_pool->slab_size = IB_MPOOL_LITE_SLAB_MIN;
 
     *pool = local_pool;
 
@@ -107,6 +129,45 @@ void ib_mpool_lite_destroy(ib_mpool_lite_t *pool)
     free(pool);
 }
 
+/**
+ * Start a new slab for small allocations.
+ *
+ * Whatever is left of the current slab is abandoned.
+ *
+ * @param[in] pool Pool to add slab to.
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static ib_status_t ib_mpool_lite_new_slab(ib_mpool_lite_t *pool)
+{
+    assert(pool != NULL);
+
+    ib_mpool_lite_block_t *block;
+    uintptr_t              start;
+
+    /* Extra room to align the start of the slab. */
+    block = malloc(
+        sizeof(block->next) + pool->slab_size + IB_MPOOL_LITE_ALIGN - 1
+    );
+    if (block == NULL) {
+        return IB_EALLOC;
+    }
+    block->next = pool->first_block;
+    pool->first_block = block;
+
+    start = ((uintptr_t)block->data + IB_MPOOL_LITE_ALIGN - 1) &
+            ~(uintptr_t)(IB_MPOOL_LITE_ALIGN - 1);
+    pool->slab_next = (char *)start;
+    pool->slab_left = pool->slab_size;
+
+    if (pool->slab_size < IB_MPOOL_LITE_SLAB_MAX) {
+        pool->slab_size *= 2;
+    }
+
+    return IB_OK;
+}
+
 void *ib_mpool_lite_alloc(ib_mpool_lite_t *pool, size_t size)
 {
     assert(pool != NULL);
@@ -119,6 +180,25 @@ void *ib_mpool_lite_alloc(ib_mpool_lite_t *pool, size_t size)
         return (void *)s_empty_mem;
     }
 
+    if (size <= IB_MPOOL_LITE_SMALL) {
+        void   *p;
+        size_t  aligned_size =
+            (size + IB_MPOOL_LITE_ALIGN - 1) &
+            ~(size_t)(IB_MPOOL_LITE_ALIGN - 1);
+
+        if (
+            aligned_size > pool->slab_left &&
+            ib_mpool_lite_new_slab(pool) != IB_OK
+        ) {
+            return NULL;
+        }
+
+        p = pool->slab_next;
+        pool->slab_next += aligned_size;
+        pool->slab_left -= aligned_size;
+        return p;
+    }
+
     block = malloc(sizeof(block->next) + size);
     if (block == NULL) {
         return NULL;
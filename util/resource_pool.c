@@ -26,11 +26,15 @@
 #include "ironbee_config_auto.h"
 
 #include <ironbee/resource_pool.h>
+#include <ironbee/lock.h>
 #include <ironbee/util.h>
 
 #include <assert.h>
+#include <pthread.h>
 #include <unistd.h>
 
+typedef struct resource_cache_t resource_cache_t;
+
 /**
  * This represents a resource to be managed by an ib_resource_pool_t.
  */
@@ -40,6 +44,22 @@ struct ib_resource_t {
     size_t              use;      /**< Number of times this has been used. */
 };
 
+/**
+ * A per-thread cache of free resources.
+ *
+ * Only the owning thread takes resources from its cache, but
+ * ib_resource_pool_flush() may empty it from any thread, so accesses are
+ * serialized by an (almost always uncontended) lock of the cache's own.
+ */
+struct resource_cache_t {
+    ib_resource_pool_t  *owner;    /**< Pool this cache belongs to. */
+    ib_lock_t           *lock;     /**< Protects items and count. */
+    ib_resource_t      **items;    /**< Cached free resources. */
+    size_t               count;    /**< Number of cached resources. */
+    bool                 attached; /**< Is a thread using this cache? */
+    resource_cache_t    *next;     /**< Next cache of @a owner. */
+};
+
 /**
  * A pool of resources.
  */
@@ -78,8 +98,141 @@ struct ib_resource_pool_t {
      * free queue.
      */
     size_t min_count;
+
+    /**
+     * Pool lock; NULL unless per-thread caching is enabled.
+     *
+     * Protects all fields above and the list of caches.
+     */
+    ib_lock_t        *lock;
+    pthread_key_t     cache_key;  /**< Thread's resource_cache_t. */
+    size_t            cache_size; /**< Max resources per cache; 0 if off. */
+    resource_cache_t *caches;     /**< All caches ever created. */
 };
 
+/**
+ * Lock @a rp if it is shared between threads.
+ *
+ * @param[in] rp The resource pool.
+ */
+static void pool_lock(ib_resource_pool_t *rp)
+{
+    if (rp->lock != NULL) {
+        ib_lock_lock(rp->lock);
+    }
+}
+
+/**
+ * Unlock @a rp if it is shared between threads.
+ *
+ * @param[in] rp The resource pool.
+ */
+static void pool_unlock(ib_resource_pool_t *rp)
+{
+    if (rp->lock != NULL) {
+        ib_lock_unlock(rp->lock);
+    }
+}
+
+/**
+ * Move all resources of @a cache back to the free resources of its pool.
+ *
+ * The caller must hold the pool lock and the cache lock, if needed.
+ *
+ * @param[in] cache The cache.
+ */
+static void cache_drain(resource_cache_t *cache)
+{
+    assert(cache != NULL);
+
+    while (cache->count > 0) {
+        --(cache->count);
+        ib_queue_push_back(cache->owner->resources,
+                           cache->items[cache->count]);
+    }
+}
+
+/**
+ * Thread exit destructor for the per-thread cache.
+ *
+ * Returns the cached resources to the pool and frees the cache for reuse by
+ * another thread.
+ *
+ * @param[in] data The resource_cache_t.
+ */
+static void cache_thread_exit(void *data)
+{
+    resource_cache_t *cache = (resource_cache_t *)data;
+    ib_resource_pool_t *rp = cache->owner;
+
+    pool_lock(rp);
+    ib_lock_lock(cache->lock);
+    cache_drain(cache);
+    cache->attached = false;
+    ib_lock_unlock(cache->lock);
+    pool_unlock(rp);
+}
+
+/**
+ * Get the calling thread's cache of @a rp, creating it if needed.
+ *
+ * @param[in] rp The resource pool.
+ *
+ * @returns The cache or NULL if it can not be created.
+ */
+static resource_cache_t *cache_get(ib_resource_pool_t *rp)
+{
+    assert(rp != NULL);
+    assert(rp->cache_size > 0);
+
+    resource_cache_t *cache = pthread_getspecific(rp->cache_key);
+    ib_status_t       rc;
+
+    if (cache != NULL) {
+        return cache;
+    }
+
+    pool_lock(rp);
+
+    /* Reuse the cache of an exited thread. */
+    for (cache = rp->caches; cache != NULL; cache = cache->next) {
+        if (! cache->attached) {
+            break;
+        }
+    }
+
+    if (cache == NULL) {
+        cache = ib_mm_calloc(rp->mm, 1, sizeof(*cache));
+        if (cache == NULL) {
+            goto failure;
+        }
+        cache->items = ib_mm_alloc(rp->mm,
+                                   rp->cache_size * sizeof(*cache->items));
+        if (cache->items == NULL) {
+            goto failure;
+        }
+        rc = ib_lock_create(&(cache->lock), rp->mm);
+        if (rc != IB_OK) {
+            goto failure;
+        }
+        cache->owner = rp;
+        cache->next = rp->caches;
+        rp->caches = cache;
+    }
+
+    if (pthread_setspecific(rp->cache_key, cache) != 0) {
+        goto failure;
+    }
+    cache->attached = true;
+
+    pool_unlock(rp);
+    return cache;
+
+failure:
+    pool_unlock(rp);
+    return NULL;
+}
+
 /**
  * This is registered with the memory pool passed to ib_resource_pool_create.
  *
@@ -91,6 +244,16 @@ static void ib_resource_pool_destroy(void *data) {
     ib_status_t rc;
     ib_resource_pool_t *rp = (ib_resource_pool_t *)data;
 
+    /* No threads use the pool anymore, so the caches need no locking. */
+    if (rp->cache_size > 0) {
+        resource_cache_t *cache;
+
+        pthread_key_delete(rp->cache_key);
+        for (cache = rp->caches; cache != NULL; cache = cache->next) {
+            cache_drain(cache);
+        }
+    }
+
     while (ib_queue_size(rp->resources) > 0) {
         void *v;
         rc = ib_queue_pop_front(rp->resources, &v);
@@ -275,14 +438,74 @@ ib_status_t ib_resource_pool_create(
     return IB_OK;
 }
 
-ib_status_t ib_resource_acquire(
+/**
+ * Take a resource from the calling thread's cache.
+ *
+ * @param[in] resource_pool The resource pool.
+ *
+ * @returns The resource or NULL if the cache is empty.
+ */
+static ib_resource_t *cache_acquire(ib_resource_pool_t *resource_pool)
+{
+    resource_cache_t *cache = pthread_getspecific(resource_pool->cache_key);
+    ib_resource_t    *resource = NULL;
+
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    ib_lock_lock(cache->lock);
+    if (cache->count > 0) {
+        --(cache->count);
+        resource = cache->items[cache->count];
+    }
+    ib_lock_unlock(cache->lock);
+
+    return resource;
+}
+
+/**
+ * Put a resource in the calling thread's cache.
+ *
+ * @param[in] resource The resource.
+ *
+ * @returns true if @a resource was cached, false if the cache is full.
+ */
+static bool cache_release(ib_resource_t *resource)
+{
+    resource_cache_t *cache = cache_get(resource->owner);
+    bool              cached = false;
+
+    if (cache == NULL) {
+        return false;
+    }
+
+    ib_lock_lock(cache->lock);
+    if (cache->count < resource->owner->cache_size) {
+        cache->items[cache->count] = resource;
+        ++(cache->count);
+        cached = true;
+    }
+    ib_lock_unlock(cache->lock);
+
+    return cached;
+}
+
+/**
+ * Acquire a resource from the shared free queue, creating one if needed.
+ *
+ * The caller must hold the pool lock, if needed.
+ *
+ * @param[in] resource_pool The resource pool.
+ * @param[out] resource The acquired resource.
+ *
+ * @returns See ib_resource_acquire().
+ */
+static ib_status_t shared_acquire(
     ib_resource_pool_t *resource_pool,
     ib_resource_t **resource
 )
 {
-    assert(resource_pool != NULL);
-    assert(resource != NULL);
-
     ib_resource_t *tmp_resource = NULL;
     ib_status_t rc;
 
@@ -329,6 +552,36 @@ ib_status_t ib_resource_acquire(
     }
 
 success:
+    *resource = tmp_resource;
+    return IB_OK;
+
+failure:
+    return rc;
+}
+
+ib_status_t ib_resource_acquire(
+    ib_resource_pool_t *resource_pool,
+    ib_resource_t **resource
+)
+{
+    assert(resource_pool != NULL);
+    assert(resource != NULL);
+
+    ib_resource_t *tmp_resource = NULL;
+    ib_status_t rc;
+
+    if (resource_pool->cache_size > 0) {
+        tmp_resource = cache_acquire(resource_pool);
+    }
+
+    if (tmp_resource == NULL) {
+        pool_lock(resource_pool);
+        rc = shared_acquire(resource_pool, &tmp_resource);
+        pool_unlock(resource_pool);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
 
     if (resource_pool->preuse_fn != NULL) {
         (resource_pool->preuse_fn)(
@@ -339,10 +592,7 @@ success:
     ++(tmp_resource->use);
 
     *resource = tmp_resource;
-    return rc;
-
-failure:
-    return rc;
+    return IB_OK;
 }
 
 /**
@@ -385,21 +635,36 @@ ib_status_t ib_resource_release(
     assert(resource != NULL);
     assert(resource->owner != NULL);
 
-    ib_status_t rc;
+    ib_resource_pool_t *resource_pool = resource->owner;
+    ib_status_t         rc;
 
     /* If a postuse function is defined, handle it. */
-    if (resource->owner->postuse_fn != NULL) {
-        rc = (resource->owner->postuse_fn)(
+    if (resource_pool->postuse_fn != NULL) {
+        rc = (resource_pool->postuse_fn)(
             resource->resource,
-            resource->owner->postuse_data);
+            resource_pool->postuse_data);
 
-        /* If the user says that the resource is invalid, destroy it. */
+        /* If the user says that the resource is invalid, destroy it and,
+         * if that leaves the pool below its minimum, create its replacement
+         * now rather than in a later ib_resource_acquire(). */
         if (rc == IB_EINVAL) {
-            return destroy_resource(resource);
+            pool_lock(resource_pool);
+            rc = destroy_resource(resource);
+            if (rc == IB_OK) {
+                rc = fill_to_min(resource_pool);
+            }
+            pool_unlock(resource_pool);
+            return rc;
         }
     }
 
+    if (resource->owner->cache_size > 0 && cache_release(resource)) {
+        return IB_OK;
+    }
+
+    pool_lock(resource->owner);
     rc = ib_queue_push_back(resource->owner->resources, resource);
+    pool_unlock(resource->owner);
 
     return rc;
 }
@@ -420,27 +685,37 @@ ib_status_t ib_resource_pool_set_min(ib_resource_pool_t *pool, size_t limit)
 {
     assert(pool != NULL);
 
+    ib_status_t rc = IB_OK;
+
+    pool_lock(pool);
     if (pool->max_count != 0 && pool->max_count < limit) {
-        return IB_EINVAL;
+        rc = IB_EINVAL;
     }
+    else {
+        pool->min_count = limit;
+    }
+    pool_unlock(pool);
 
-    pool->min_count = limit;
-
-    return IB_OK;
+    return rc;
 }
 
 ib_status_t ib_resource_pool_set_max(ib_resource_pool_t *pool, size_t limit)
 {
     assert(pool != NULL);
 
+    ib_status_t rc = IB_OK;
+
+    pool_lock(pool);
     /* MAX cannot be less than MIN. */
     if (limit != 0 && limit < pool->min_count) {
-        return IB_EINVAL;
+        rc = IB_EINVAL;
     }
+    else {
+        pool->max_count = limit;
+    }
+    pool_unlock(pool);
 
-    pool->max_count = limit;
-
-    return IB_OK;
+    return rc;
 }
 
 ib_status_t ib_resource_pool_flush(
@@ -449,7 +724,17 @@ ib_status_t ib_resource_pool_flush(
 {
     assert(resource_pool != NULL);
 
-    ib_status_t rc;
+    ib_status_t       rc;
+    resource_cache_t *cache;
+
+    pool_lock(resource_pool);
+
+    /* Return the resources cached by threads to the pool. */
+    for (cache = resource_pool->caches; cache != NULL; cache = cache->next) {
+        ib_lock_lock(cache->lock);
+        cache_drain(cache);
+        ib_lock_unlock(cache->lock);
+    }
 
     /* Destroy all the resources. */
     while (resource_pool->count > 0) {
@@ -457,7 +742,7 @@ ib_status_t ib_resource_pool_flush(
 
         rc = ib_queue_pop_front(resource_pool->resources, &r);
         if (rc != IB_OK) {
-            return rc;
+            goto done;
         }
 
         destroy_resource(r);
@@ -465,10 +750,38 @@ ib_status_t ib_resource_pool_flush(
 
     /* Fill to the minimum. */
     rc = fill_to_min(resource_pool);
+
+done:
+    pool_unlock(resource_pool);
+    return rc;
+}
+
+ib_status_t ib_resource_pool_thread_cache(
+    ib_resource_pool_t *resource_pool,
+    size_t              size
+)
+{
+    assert(resource_pool != NULL);
+
+    ib_status_t rc;
+
+    if (size == 0 || resource_pool->cache_size > 0) {
+        return IB_EINVAL;
+    }
+
+    rc = ib_lock_create(&(resource_pool->lock), resource_pool->mm);
     if (rc != IB_OK) {
         return rc;
     }
 
+    if (pthread_key_create(&(resource_pool->cache_key),
+                           cache_thread_exit) != 0)
+    {
+        return IB_EALLOC;
+    }
+
+    resource_pool->cache_size = size;
+
     return IB_OK;
 }
 
@@ -0,0 +1,333 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Shared Memory Ring Implementation
+ *
+ * The file is a @ref ring_header_t followed by the records.  The head and
+ * tail count the bytes ever pushed and popped, so the ring is empty when
+ * they are equal, and each is written by one side only.  Each record is a
+ * 32 bit length followed by the data, padded to a multiple of 8 bytes.  A
+ * record never wraps: if it does not fit before the end of the ring, a
+ * @ref WRAP_MARK length takes the rest of the ring and the record starts
+ * again at the beginning.
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/shm_ring.h>
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * The fmode for the created file.
+ */
+static const mode_t DEFAULT_FILE_MODE = 0644;
+
+/**
+ * Magic at the start of a ring file.
+ */
+static const char RING_MAGIC[8] = { 'I', 'B', 'S', 'H', 'R', 'N', 'G', '1' };
+
+/**
+ * Length of a record that marks the rest of the ring unused.
+ */
+#define WRAP_MARK UINT32_MAX
+
+/**
+ * Smallest capacity of a ring.
+ */
+#define RING_MIN_CAPACITY 64
+
+/**
+ * Size of a record of @a length bytes.
+ */
+#define RECORD_SIZE(length) ((sizeof(uint32_t) + (length) + 7) & ~(uint64_t)7)
+
+/**
+ * Header of the ring file.
+ *
+ * The head, tail and closed flag are on cache lines of their own, so the
+ * two sides do not contend for them.
+ */
+typedef struct {
+    char     magic[8];    /**< RING_MAGIC. */
+    uint64_t capacity;    /**< Bytes of records. */
+    uint64_t padding1[6]; /**< Zero. */
+    uint64_t head;        /**< Bytes pushed; written by the producer. */
+    uint64_t padding2[7]; /**< Zero. */
+    uint64_t tail;        /**< Bytes popped; written by the consumer. */
+    uint64_t padding3[7]; /**< Zero. */
+    uint32_t closed;      /**< Nonzero once the producer is done. */
+    uint32_t reserved;    /**< Zero. */
+    uint64_t padding4[7]; /**< Zero. */
+} ring_header_t;
+
+struct ib_shm_ring_t {
+    ring_header_t *header;     /**< Mapped file. */
+    uint8_t       *records;    /**< Records; after @ref header. */
+    uint64_t       capacity;   /**< Bytes of records. */
+    size_t         map_length; /**< Length of the mapping. */
+    uint64_t       peeked;     /**< Size of the record peeked at. */
+};
+
+/**
+ * Unmap a ring.
+ *
+ * @param[in] cbdata The ring.
+ */
+static void ring_cleanup(void *cbdata)
+{
+    ib_shm_ring_t *ring = (ib_shm_ring_t *)cbdata;
+
+    munmap(ring->header, ring->map_length);
+}
+
+/**
+ * Initialize a new ring file, or check an existing one.
+ *
+ * The caller holds an exclusive lock on @a fd.
+ *
+ * @param[in]  fd       The file.
+ * @param[in]  capacity Capacity of a new ring.
+ * @param[out] length   Length of the file.
+ * @returns
+ * - IB_OK on success.
+ * - IB_EINVAL if the file is not a ring.
+ * - IB_EOTHER on a system call failure.
+ */
+static ib_status_t ring_init_file(int fd, uint64_t capacity, size_t *length)
+{
+    struct stat   sb;
+    ring_header_t header;
+
+    if (fstat(fd, &sb) != 0) {
+        return IB_EOTHER;
+    }
+
+    if (sb.st_size == 0) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, RING_MAGIC, sizeof(RING_MAGIC));
+        header.capacity = capacity;
+        if (ftruncate(fd, sizeof(header) + capacity) != 0) {
+            return IB_EOTHER;
+        }
+        if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+            return IB_EOTHER;
+        }
+        *length = sizeof(header) + capacity;
+        return IB_OK;
+    }
+
+    if (
+        (size_t)sb.st_size < sizeof(header) ||
+        pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        memcmp(header.magic, RING_MAGIC, sizeof(RING_MAGIC)) != 0 ||
+        header.capacity != (uint64_t)sb.st_size - sizeof(header)
+    ) {
+        return IB_EINVAL;
+    }
+    *length = sb.st_size;
+    return IB_OK;
+}
+
+ib_status_t ib_shm_ring_open(
+    ib_shm_ring_t **ring,
+    ib_mm_t         mm,
+    const char     *path,
+    size_t          capacity
+)
+{
+    assert(ring != NULL);
+    assert(path != NULL);
+
+    ib_shm_ring_t *r;
+    ib_status_t    rc;
+    int            fd;
+    size_t         length;
+    void          *map;
+
+    if (capacity < RING_MIN_CAPACITY) {
+        return IB_EINVAL;
+    }
+
+    r = ib_mm_calloc(mm, 1, sizeof(*r));
+    if (r == NULL) {
+        return IB_EALLOC;
+    }
+
+    fd = open(path, O_RDWR | O_CREAT, DEFAULT_FILE_MODE);
+    if (fd < 0) {
+        return IB_EOTHER;
+    }
+    if (flock(fd, LOCK_EX) != 0) {
+        close(fd);
+        return IB_EOTHER;
+    }
+    rc = ring_init_file(fd, (capacity + 7) & ~(uint64_t)7, &length);
+    if (rc == IB_OK) {
+        map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            rc = IB_EOTHER;
+        }
+    }
+    flock(fd, LOCK_UN);
+    /* The mapping does not need the file to stay open. */
+    close(fd);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    r->header = (ring_header_t *)map;
+    r->records = (uint8_t *)map + sizeof(ring_header_t);
+    r->capacity = r->header->capacity;
+    r->map_length = length;
+
+    rc = ib_mm_register_cleanup(mm, ring_cleanup, r);
+    if (rc != IB_OK) {
+        munmap(map, length);
+        return rc;
+    }
+
+    *ring = r;
+    return IB_OK;
+}
+
+size_t ib_shm_ring_max_record(const ib_shm_ring_t *ring)
+{
+    assert(ring != NULL);
+
+    /* A record of half the ring or less always fits once the ring is
+     * empty, including the end of the ring it may have to skip. */
+    return ((ring->capacity / 2) & ~(uint64_t)7) - sizeof(uint32_t);
+}
+
+ib_status_t ib_shm_ring_push(
+    ib_shm_ring_t *ring,
+    const void    *data,
+    size_t         length
+)
+{
+    assert(ring != NULL);
+    assert(data != NULL || length == 0);
+
+    uint64_t head;
+    uint64_t tail;
+    uint64_t offset;
+    uint64_t skip = 0;
+    uint64_t size;
+    uint32_t length32;
+
+    if (length > ib_shm_ring_max_record(ring)) {
+        return IB_EINVAL;
+    }
+
+    size = RECORD_SIZE(length);
+    head = ring->header->head;
+    tail = __atomic_load_n(&(ring->header->tail), __ATOMIC_ACQUIRE);
+    offset = head % ring->capacity;
+    if (offset + size > ring->capacity) {
+        skip = ring->capacity - offset;
+    }
+    if (head + skip + size - tail > ring->capacity) {
+        return IB_EAGAIN;
+    }
+
+    if (skip > 0) {
+        length32 = WRAP_MARK;
+        memcpy(ring->records + offset, &length32, sizeof(length32));
+        offset = 0;
+    }
+    length32 = (uint32_t)length;
+    memcpy(ring->records + offset, &length32, sizeof(length32));
+    if (length > 0) {
+        memcpy(ring->records + offset + sizeof(length32), data, length);
+    }
+
+    __atomic_store_n(&(ring->header->head), head + skip + size,
+                     __ATOMIC_RELEASE);
+    return IB_OK;
+}
+
+void ib_shm_ring_close(ib_shm_ring_t *ring)
+{
+    assert(ring != NULL);
+
+    __atomic_store_n(&(ring->header->closed), 1, __ATOMIC_RELEASE);
+}
+
+ib_status_t ib_shm_ring_peek(
+    ib_shm_ring_t  *ring,
+    const void    **data,
+    size_t         *length
+)
+{
+    assert(ring != NULL);
+    assert(data != NULL);
+    assert(length != NULL);
+
+    uint64_t head;
+    uint64_t tail;
+    uint64_t offset;
+    uint32_t length32;
+
+    tail = ring->header->tail;
+    head = __atomic_load_n(&(ring->header->head), __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        if (! __atomic_load_n(&(ring->header->closed), __ATOMIC_ACQUIRE)) {
+            return IB_EAGAIN;
+        }
+        /* The producer may have pushed before it closed. */
+        head = __atomic_load_n(&(ring->header->head), __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            return IB_ENOENT;
+        }
+    }
+
+    offset = tail % ring->capacity;
+    memcpy(&length32, ring->records + offset, sizeof(length32));
+    if (length32 == WRAP_MARK) {
+        tail += ring->capacity - offset;
+        __atomic_store_n(&(ring->header->tail), tail, __ATOMIC_RELEASE);
+        offset = 0;
+        memcpy(&length32, ring->records, sizeof(length32));
+    }
+
+    ring->peeked = RECORD_SIZE(length32);
+    *data = ring->records + offset + sizeof(length32);
+    *length = length32;
+    return IB_OK;
+}
+
+void ib_shm_ring_pop(ib_shm_ring_t *ring)
+{
+    assert(ring != NULL);
+    assert(ring->peeked > 0);
+
+    __atomic_store_n(&(ring->header->tail),
+                     ring->header->tail + ring->peeked,
+                     __ATOMIC_RELEASE);
+    ring->peeked = 0;
+}
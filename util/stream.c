@@ -25,6 +25,8 @@
 
 #include <ironbee/stream.h>
 
+#include <assert.h>
+
 ib_status_t ib_stream_create(ib_stream_t **pstream, ib_mm_t mm)
 {
     /* Create the structure. */
@@ -42,6 +44,7 @@ ib_status_t ib_stream_push_sdata(ib_stream_t *s,
                                  ib_sdata_t *sdata)
 {
     s->slen += sdata->dlen;
+    s->tail_avail = 0;
 
     if (IB_LIST_GEN_ELEMENTS(s) == 0) {
         IB_LIST_GEN_NODE_INSERT_INITIAL(s, sdata);
@@ -73,6 +76,50 @@ ib_status_t ib_stream_push(ib_stream_t *s,
     return IB_OK;
 }
 
+ib_status_t ib_stream_append(ib_stream_t *s,
+                             const void *data,
+                             size_t dlen,
+                             size_t segment_size)
+{
+    assert(s != NULL);
+    assert(data != NULL || dlen == 0);
+
+    const uint8_t *src = (const uint8_t *)data;
+    size_t         len;
+    ib_status_t    rc;
+
+    /* Fill the room left in the last segment. */
+    if (s->tail_avail > 0 && dlen > 0) {
+        len = (dlen < s->tail_avail) ? dlen : s->tail_avail;
+        memcpy((uint8_t *)s->tail->data + s->tail->dlen, src, len);
+        s->tail->dlen += len;
+        s->tail_avail -= len;
+        s->slen       += len;
+        src  += len;
+        dlen -= len;
+    }
+
+    if (dlen == 0) {
+        return IB_OK;
+    }
+
+    /* Start a new segment with the rest. */
+    len = (dlen > segment_size) ? dlen : segment_size;
+    uint8_t *buf = (uint8_t *)ib_mm_alloc(s->mm, len);
+    if (buf == NULL) {
+        return IB_EALLOC;
+    }
+    memcpy(buf, src, dlen);
+
+    rc = ib_stream_push(s, IB_STREAM_DATA, buf, dlen);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    s->tail_avail = len - dlen;
+
+    return IB_OK;
+}
+
 ib_status_t ib_stream_pull(ib_stream_t *s,
                            ib_sdata_t **psdata)
 {
@@ -89,6 +136,10 @@ ib_status_t ib_stream_pull(ib_stream_t *s,
     }
 
     IB_LIST_GEN_NODE_REMOVE_FIRST(s);
+    if (s->nelts == 0) {
+        /* The caller now has the segment. */
+        s->tail_avail = 0;
+    }
 
     return IB_OK;
 }
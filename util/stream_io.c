@@ -301,6 +301,63 @@ ib_status_t ib_stream_io_tx_reuse(
     return IB_OK;
 }
 
+ib_status_t ib_stream_io_tx_hold(
+    ib_stream_io_tx_t *io_tx,
+    ib_queue_t        *held
+)
+{
+    assert(io_tx != NULL);
+    assert(io_tx->input != NULL);
+    assert(held != NULL);
+
+    while (ib_queue_size(io_tx->input) > 0) {
+        ib_stream_io_data_t *data;
+        ib_status_t          rc;
+
+        rc = ib_queue_dequeue(io_tx->input, &data);
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+        rc = ib_queue_enqueue(held, data);
+        if (rc != IB_OK) {
+            ib_stream_io_data_unref(io_tx, data);
+            return rc;
+        }
+    }
+
+    return IB_OK;
+}
+
+ib_status_t ib_stream_io_tx_unhold(
+    ib_stream_io_tx_t *io_tx,
+    ib_queue_t        *held
+)
+{
+    assert(io_tx != NULL);
+    assert(io_tx->input != NULL);
+    assert(held != NULL);
+
+    /* Take from the back so that the held data keeps its order. */
+    while (ib_queue_size(held) > 0) {
+        ib_stream_io_data_t *data;
+        ib_status_t          rc;
+
+        rc = ib_queue_pop_back(held, &data);
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+        rc = ib_queue_push_front(io_tx->input, data);
+        if (rc != IB_OK) {
+            ib_stream_io_data_unref(io_tx, data);
+            return rc;
+        }
+    }
+
+    return IB_OK;
+}
+
 void ib_stream_io_tx_cleanup(
     ib_stream_io_tx_t *io_tx
 )
@@ -39,6 +39,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 const char *ib_strstr(
@@ -92,6 +93,91 @@ const char *ib_strstr(
     return NULL;
 }
 
+/**
+ * Precompiled substring search (Boyer-Moore-Horspool).
+ */
+struct ib_strsearch_t {
+    const char *needle;     /**< Needle */
+    size_t      needle_len; /**< Length of @a needle */
+    size_t      shift[256]; /**< Shift for each final byte of a window */
+};
+
+ib_status_t ib_strsearch_create(
+    ib_strsearch_t **search,
+    ib_mm_t          mm,
+    const char      *needle,
+    size_t           needle_len
+)
+{
+    assert(search != NULL);
+    assert(needle != NULL || needle_len == 0);
+
+    ib_strsearch_t *local_search;
+
+    local_search = ib_mm_alloc(mm, sizeof(*local_search));
+    if (local_search == NULL) {
+        return IB_EALLOC;
+    }
+    local_search->needle_len = needle_len;
+    local_search->needle = NULL;
+    if (needle_len > 0) {
+        local_search->needle = ib_mm_memdup(mm, needle, needle_len);
+        if (local_search->needle == NULL) {
+            return IB_EALLOC;
+        }
+    }
+
+    for (size_t i = 0; i < 256; ++i) {
+        local_search->shift[i] = needle_len;
+    }
+    for (size_t i = 0; i + 1 < needle_len; ++i) {
+        local_search->shift[(uint8_t)needle[i]] = needle_len - 1 - i;
+    }
+
+    *search = local_search;
+
+    return IB_OK;
+}
+
+const char *ib_strsearch_find(
+    const ib_strsearch_t *search,
+    const char           *haystack,
+    size_t                haystack_len
+)
+{
+    assert(search != NULL);
+
+    const char   *needle = search->needle;
+    const size_t  needle_len = search->needle_len;
+    size_t        last;
+    size_t        i;
+
+    /* To match ib_strstr(), return the haystack when the needle is empty. */
+    if (needle_len == 0) {
+        return haystack;
+    }
+    if (haystack == NULL || needle_len > haystack_len) {
+        return NULL;
+    }
+    if (needle_len == 1) {
+        return memchr(haystack, needle[0], haystack_len);
+    }
+
+    last = needle_len - 1;
+    for (i = 0; i <= haystack_len - needle_len; ) {
+        uint8_t c = (uint8_t)haystack[i + last];
+
+        if (c == (uint8_t)needle[last] &&
+            memcmp(haystack + i, needle, last) == 0)
+        {
+            return haystack + i;
+        }
+        i += search->shift[c];
+    }
+
+    return NULL;
+}
+
 ib_status_t ib_string_join(
     const char  *join_string,
     ib_list_t   *list,
@@ -26,9 +26,36 @@
 
 #include <ironbee/string_lower.h>
 
+#include "string_private.h"
+
 #include <assert.h>
 #include <ctype.h>
 
+/**
+ * Lowercase @a in_len bytes of @a in into @a out.
+ *
+ * @param[in] in Input.
+ * @param[in] in_len Length of @a in.
+ * @param[out] out Output of @a in_len bytes; may be @a in.
+ */
+static void strlower_copy(
+    const uint8_t *in,
+    size_t         in_len,
+    uint8_t       *out
+)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    for (; i + IB_STR_BLOCK_SIZE <= in_len; i += IB_STR_BLOCK_SIZE) {
+        ib_str_block_lower(in + i, out + i);
+    }
+#endif
+    for (; i < in_len; ++i) {
+        out[i] = tolower(in[i]);
+    }
+}
+
 ib_status_t ib_strlower(
     ib_mm_t         mm,
     const uint8_t  *in,
@@ -39,14 +66,23 @@ ib_status_t ib_strlower(
     assert(in != NULL);
     assert(out != NULL);
 
-    *out = ib_mm_memdup(mm, in, in_len);
+    *out = ib_mm_alloc(mm, in_len);
     if (*out == NULL) {
         return IB_EALLOC;
     }
-    for (size_t i = 0; i < in_len; ++i) {
-        int c = *(in+i);
-        *(*out+i) = tolower(c);
-    }
+    strlower_copy(in, in_len, *out);
 
     return IB_OK;
 }
+
+void ib_strlower_inplace(
+    uint8_t *data,
+    size_t   dlen
+)
+{
+    assert(data != NULL || dlen == 0);
+
+    if (dlen > 0) {
+        strlower_copy(data, dlen, data);
+    }
+}
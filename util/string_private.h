@@ -0,0 +1,80 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef _IB_STRING_PRIVATE_H_
+#define _IB_STRING_PRIVATE_H_
+
+/**
+ * @file
+ * @brief IronBee --- Private String Kernels
+ *
+ * Helpers shared by the string lowercase, trim and whitespace functions to
+ * classify 16 bytes at a time.  They are only available if the compiler
+ * targets SSE2; callers must provide a byte at a time fallback.
+ */
+
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+/** Number of bytes examined by one kernel step. */
+#define IB_STR_BLOCK_SIZE 16
+
+/**
+ * Whitespace mask of a block.
+ *
+ * Whitespace is what isspace() reports in the C locale: space and
+ * the characters from tab to carriage return.
+ *
+ * @param[in] block Block of IB_STR_BLOCK_SIZE bytes; need not be aligned.
+ * @return Bit i is set if @a block[i] is whitespace.
+ */
+static inline uint32_t ib_str_block_space_mask(const uint8_t *block)
+{
+    __m128i data = _mm_loadu_si128((const __m128i *)block);
+    /* Signed compares: bytes with the top bit set are never whitespace. */
+    __m128i ctrl = _mm_and_si128(
+        _mm_cmpgt_epi8(data, _mm_set1_epi8(0x08)),
+        _mm_cmplt_epi8(data, _mm_set1_epi8(0x0e))
+    );
+    __m128i space = _mm_cmpeq_epi8(data, _mm_set1_epi8(' '));
+
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(ctrl, space));
+}
+
+/**
+ * Convert the ASCII uppercase letters of a block to lowercase.
+ *
+ * @param[in] in Input block of IB_STR_BLOCK_SIZE bytes.
+ * @param[out] out Output block; may be @a in.
+ */
+static inline void ib_str_block_lower(const uint8_t *in, uint8_t *out)
+{
+    __m128i data = _mm_loadu_si128((const __m128i *)in);
+    __m128i upper = _mm_and_si128(
+        _mm_cmpgt_epi8(data, _mm_set1_epi8('A' - 1)),
+        _mm_cmplt_epi8(data, _mm_set1_epi8('Z' + 1))
+    );
+
+    data = _mm_add_epi8(data, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    _mm_storeu_si128((__m128i *)out, data);
+}
+
+#endif /* __SSE2__ */
+
+#endif /* _IB_STRING_PRIVATE_H_ */
@@ -27,6 +27,8 @@
 
 #include <ironbee/string_trim.h>
 
+#include "string_private.h"
+
 #include <assert.h>
 #include <ctype.h>
 #include <stddef.h>
@@ -46,9 +48,17 @@ int find_nonws_left(
 )
 {
     assert (str != NULL);
-    int i;
+    int i = 0;
 
-    for (i = 0; i < (int)len; ++i) {
+#ifdef __SSE2__
+    for (; i + IB_STR_BLOCK_SIZE <= (int)len; i += IB_STR_BLOCK_SIZE) {
+        uint32_t nonws = ~ib_str_block_space_mask(str + i) & 0xffff;
+        if (nonws != 0) {
+            return i + __builtin_ctz(nonws);
+        }
+    }
+#endif
+    for (; i < (int)len; ++i) {
         if (isspace(str[i]) == 0) {
             return i;
         }
@@ -72,9 +82,18 @@ int find_nonws_right(
 )
 {
     assert (str != NULL);
-    int i;
-
-    for (i = len - 1; i >= 0; --i) {
+    int i = len - 1;
+
+#ifdef __SSE2__
+    for (; i + 1 >= IB_STR_BLOCK_SIZE; i -= IB_STR_BLOCK_SIZE) {
+        uint32_t nonws = ~ib_str_block_space_mask(
+            str + i + 1 - IB_STR_BLOCK_SIZE) & 0xffff;
+        if (nonws != 0) {
+            return i + 1 - IB_STR_BLOCK_SIZE + (31 - __builtin_clz(nonws));
+        }
+    }
+#endif
+    for (; i >= 0; --i) {
         if (isspace(str[i]) == 0) {
             return i;
         }
@@ -26,53 +26,128 @@
 
 #include <ironbee/string_whitespace.h>
 
+#include "string_private.h"
+
 #include <assert.h>
 #include <ctype.h>
 
 /**
- * Count the total whitespace and number of whitespace regions.
+ * Copy @a data_in to @a data_out without whitespace.
+ *
+ * @param[in] data_in Input data.
+ * @param[in] dlen_in Length of @a data_in.
+ * @param[out] data_out Output of at most @a dlen_in bytes; may be @a data_in.
  *
- * @param[in] data String.
- * @param[in] dlen Length of @a s.
- * @param[out] spaces Number of whitespace characters.
- * @param[out] regions Number of whitespace regions.
+ * @returns Length of the output.
  **/
-void count_ws(
-    const uint8_t *data,
-    size_t         dlen,
-    size_t        *spaces,
-    size_t        *regions
+static size_t ws_remove_copy(
+    const uint8_t *data_in,
+    size_t         dlen_in,
+    uint8_t       *data_out
 )
 {
-    assert(data != NULL);
+    size_t i = 0;
+    size_t out = 0;
+
+#ifdef __SSE2__
+    while (i + IB_STR_BLOCK_SIZE <= dlen_in) {
+        uint32_t mask = ib_str_block_space_mask(data_in + i);
+
+        if (mask == 0) {
+            /* The output never overtakes the input, so this is safe in
+             * place. */
+            _mm_storeu_si128(
+                (__m128i *)(data_out + out),
+                _mm_loadu_si128((const __m128i *)(data_in + i))
+            );
+            out += IB_STR_BLOCK_SIZE;
+        }
+        else if (mask != 0xffff) {
+            for (size_t j = 0; j < IB_STR_BLOCK_SIZE; ++j) {
+                if ((mask & (1U << j)) == 0) {
+                    data_out[out] = data_in[i + j];
+                    ++out;
+                }
+            }
+        }
+        i += IB_STR_BLOCK_SIZE;
+    }
+#endif
+    for (; i < dlen_in; ++i) {
+        uint8_t c = data_in[i];
+        if (! isspace(c)) {
+            data_out[out] = c;
+            ++out;
+        }
+    }
 
-    size_t local_spaces = 0;
-    size_t local_regions = 0;
-    local_spaces = 0;
-    local_regions = 0;
+    return out;
+}
+
+/**
+ * Copy @a data_in to @a data_out with whitespace regions compressed.
+ *
+ * The first character of each whitespace region is kept.
+ *
+ * @param[in] data_in Input data.
+ * @param[in] dlen_in Length of @a data_in.
+ * @param[out] data_out Output of at most @a dlen_in bytes; may be @a data_in.
+ *
+ * @returns Length of the output.
+ **/
+static size_t ws_compress_copy(
+    const uint8_t *data_in,
+    size_t         dlen_in,
+    uint8_t       *data_out
+)
+{
+    size_t i = 0;
+    size_t out = 0;
     bool last_char_is_space = false;
 
-    for (size_t i = 0; i < dlen; ++i) {
-        uint8_t c = data[i];
+#ifdef __SSE2__
+    while (i + IB_STR_BLOCK_SIZE <= dlen_in) {
+        uint32_t mask = ib_str_block_space_mask(data_in + i);
 
-        if (isspace(c)) {
-            ++local_spaces;
+        if (mask == 0) {
+            _mm_storeu_si128(
+                (__m128i *)(data_out + out),
+                _mm_loadu_si128((const __m128i *)(data_in + i))
+            );
+            out += IB_STR_BLOCK_SIZE;
+            last_char_is_space = false;
+        }
+        else if (mask == 0xffff) {
             if (! last_char_is_space) {
-                ++local_regions;
+                data_out[out] = data_in[i];
+                ++out;
             }
             last_char_is_space = true;
         }
         else {
-            last_char_is_space = false;
+            for (size_t j = 0; j < IB_STR_BLOCK_SIZE; ++j) {
+                bool is_space = (mask & (1U << j)) != 0;
+                if (! is_space || ! last_char_is_space) {
+                    data_out[out] = data_in[i + j];
+                    ++out;
+                }
+                last_char_is_space = is_space;
+            }
         }
+        i += IB_STR_BLOCK_SIZE;
     }
+#endif
+    for (; i < dlen_in; ++i) {
+        uint8_t c = data_in[i];
+        if (! isspace(c) || ! last_char_is_space) {
+            data_out[out] = c;
+            ++out;
+        }
 
-    if (spaces != NULL) {
-        *spaces = local_spaces;
-    }
-    if (regions != NULL) {
-        *regions = local_regions;
+        last_char_is_space = isspace(c);
     }
+
+    return out;
 }
 
 ib_status_t ib_str_whitespace_remove(
@@ -87,31 +162,31 @@ ib_status_t ib_str_whitespace_remove(
     assert(data_out != NULL);
     assert(dlen_out != NULL);
 
-    size_t spaces = 0;
     uint8_t *buf;
-    uint8_t *cur;
 
-    count_ws(data_in, dlen_in, &spaces, NULL);
-    buf = ib_mm_alloc(mm, dlen_in - spaces);
-    if (buf == NULL) {
+    /* Sized for the input so that the data is only examined once. */
+    buf = ib_mm_alloc(mm, dlen_in);
+    if (buf == NULL && dlen_in > 0) {
         return IB_EALLOC;
     }
 
-    cur = buf;
-    for (size_t i = 0; i < dlen_in; ++i) {
-        uint8_t c = data_in[i];
-        if (! isspace(c)) {
-            *cur = c;
-            ++cur;
-        }
-    }
-
     *data_out = buf;
-    *dlen_out = dlen_in - spaces;
+    *dlen_out = ws_remove_copy(data_in, dlen_in, buf);
 
     return IB_OK;
 }
 
+void ib_str_whitespace_remove_inplace(
+    uint8_t *data,
+    size_t  *dlen
+)
+{
+    assert(data != NULL);
+    assert(dlen != NULL);
+
+    *dlen = ws_remove_copy(data, *dlen, data);
+}
+
 ib_status_t ib_str_whitespace_compress(
     ib_mm_t         mm,
     const uint8_t  *data_in,
@@ -124,31 +199,27 @@ ib_status_t ib_str_whitespace_compress(
     assert(data_out != NULL);
     assert(dlen_out != NULL);
 
-    size_t spaces = 0;
-    size_t regions = 0;
     uint8_t *buf;
-    uint8_t *cur;
-    bool last_char_is_space = false;
 
-    count_ws(data_in, dlen_in, &spaces, &regions);
-    buf = ib_mm_alloc(mm, dlen_in - spaces + regions);
-    if (buf == NULL) {
+    /* Sized for the input so that the data is only examined once. */
+    buf = ib_mm_alloc(mm, dlen_in);
+    if (buf == NULL && dlen_in > 0) {
         return IB_EALLOC;
     }
 
-    cur = buf;
-    for (size_t i = 0; i < dlen_in; ++i) {
-        uint8_t c = data_in[i];
-        if (! isspace(c) || ! last_char_is_space) {
-            *cur = c;
-            ++cur;
-        }
-
-        last_char_is_space = isspace(c);
-    }
-
     *data_out = buf;
-    *dlen_out = dlen_in - spaces + regions;
+    *dlen_out = ws_compress_copy(data_in, dlen_in, buf);
 
     return IB_OK;
 }
+
+void ib_str_whitespace_compress_inplace(
+    uint8_t *data,
+    size_t  *dlen
+)
+{
+    assert(data != NULL);
+    assert(dlen != NULL);
+
+    *dlen = ws_compress_copy(data, *dlen, data);
+}
@@ -81,6 +81,339 @@ bool less(const ib_stringset_entry_t *a, const ib_stringset_entry_t *b)
     return compare(a, b) < 0;
 }
 
+/**
+ * @name Double-Array Trie
+ *
+ * State @c s has a transition on byte @c c to state
+ * @c t = @c base[s] + @c c if @c check[t] == @c s.  State 0 is the root.
+ * @c value[s] is the index of the entry whose string leads to @c s or
+ * STRINGSET_NONE.
+ */
+/**@{*/
+
+/** No entry / unused slot. */
+#define STRINGSET_NONE UINT32_MAX
+
+/** Check value of the root (never a valid state). */
+#define STRINGSET_ROOT (UINT32_MAX - 1)
+
+/** See ib_stringset_index_t. */
+struct ib_stringset_index_t
+{
+    /** Transition bases. */
+    const uint32_t *base;
+    /** Transition owners. */
+    const uint32_t *check;
+    /** Entry index of each state. */
+    const uint32_t *value;
+    /** Number of slots. */
+    size_t          size;
+};
+
+/** A state yet to be given its transitions. */
+typedef struct stringset_work_t stringset_work_t;
+struct stringset_work_t
+{
+    /** State. */
+    uint32_t state;
+    /** Length of the prefix leading to @c state. */
+    size_t   depth;
+    /** First entry with the prefix. */
+    size_t   first;
+    /** End of entries with the prefix. */
+    size_t   last;
+};
+
+/** Index under construction. */
+typedef struct stringset_builder_t stringset_builder_t;
+struct stringset_builder_t
+{
+    /** Transition bases. */
+    uint32_t *base;
+    /** Transition owners. */
+    uint32_t *check;
+    /** Entry index of each state. */
+    uint32_t *value;
+    /** Number of slots. */
+    size_t    size;
+    /** No slot below this is free. */
+    size_t    first_free;
+};
+
+/**
+ * Grow @a builder to at least @a size slots.
+ *
+ * @return
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static
+ib_status_t stringset_builder_grow(
+    stringset_builder_t *builder,
+    size_t               size
+)
+{
+    size_t    new_size = builder->size;
+    uint32_t *base;
+    uint32_t *check;
+    uint32_t *value;
+
+    if (size <= builder->size) {
+        return IB_OK;
+    }
+    while (new_size < size) {
+        new_size = new_size * 2 + 256;
+    }
+
+    base = realloc(builder->base, new_size * sizeof(*base));
+    if (base == NULL) {
+        return IB_EALLOC;
+    }
+    builder->base = base;
+    check = realloc(builder->check, new_size * sizeof(*check));
+    if (check == NULL) {
+        return IB_EALLOC;
+    }
+    builder->check = check;
+    value = realloc(builder->value, new_size * sizeof(*value));
+    if (value == NULL) {
+        return IB_EALLOC;
+    }
+    builder->value = value;
+
+    for (size_t i = builder->size; i < new_size; ++i) {
+        base[i]  = 0;
+        check[i] = STRINGSET_NONE;
+        value[i] = STRINGSET_NONE;
+    }
+    builder->size = new_size;
+
+    return IB_OK;
+}
+
+/**
+ * Give a state its transitions.
+ *
+ * Finds the first base at which all child slots are free, claims them and
+ * appends the children to @a work.
+ *
+ * @param[in] set Set being indexed.
+ * @param[in,out] builder Index under construction.
+ * @param[in] item State to expand.
+ * @param[out] work Work list; has room for a child per byte value.
+ * @param[in,out] num_work Number of entries in @a work.
+ * @return
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static
+ib_status_t stringset_expand(
+    const ib_stringset_t   *set,
+    stringset_builder_t    *builder,
+    const stringset_work_t *item,
+    stringset_work_t       *work,
+    size_t                 *num_work
+)
+{
+    const ib_stringset_entry_t *entries = set->entries;
+    uint8_t     bytes[256];
+    size_t      firsts[257];
+    size_t      num_children = 0;
+    size_t      first = item->first;
+    size_t      b;
+    ib_status_t rc;
+
+    /* Entries are sorted; the entries ending here come first. */
+    while (first < item->last && entries[first].length == item->depth) {
+        builder->value[item->state] = (uint32_t)first;
+        ++first;
+    }
+
+    /* The entries past here are grouped by their next byte. */
+    for (size_t i = first; i < item->last; ++i) {
+        uint8_t c = (uint8_t)entries[i].string[item->depth];
+
+        if (num_children == 0 || bytes[num_children - 1] != c) {
+            bytes[num_children]  = c;
+            firsts[num_children] = i;
+            ++num_children;
+        }
+    }
+    firsts[num_children] = item->last;
+    if (num_children == 0) {
+        return IB_OK;
+    }
+
+    /* First fit. */
+    b = builder->first_free > bytes[0] ? builder->first_free - bytes[0] : 1;
+    for (;;) {
+        bool fits = true;
+
+        rc = stringset_builder_grow(builder, b + 256);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        for (size_t i = 0; i < num_children; ++i) {
+            if (builder->check[b + bytes[i]] != STRINGSET_NONE) {
+                fits = false;
+                break;
+            }
+        }
+        if (fits) {
+            break;
+        }
+        ++b;
+    }
+
+    builder->base[item->state] = (uint32_t)b;
+    for (size_t i = 0; i < num_children; ++i) {
+        uint32_t child = (uint32_t)(b + bytes[i]);
+
+        builder->check[child] = item->state;
+        work[*num_work].state = child;
+        work[*num_work].depth = item->depth + 1;
+        work[*num_work].first = firsts[i];
+        work[*num_work].last  = firsts[i + 1];
+        ++*num_work;
+    }
+    while (
+        builder->first_free < builder->size &&
+        builder->check[builder->first_free] != STRINGSET_NONE
+    ) {
+        ++builder->first_free;
+    }
+
+    return IB_OK;
+}
+
+ib_status_t ib_stringset_index(
+    ib_stringset_t *set,
+    ib_mm_t         mm
+)
+{
+    assert(set != NULL);
+
+    stringset_builder_t   builder = {NULL, NULL, NULL, 0, 1};
+    stringset_work_t     *work = NULL;
+    size_t                num_work = 0;
+    size_t                work_size = 0;
+    ib_stringset_index_t *index;
+    ib_status_t           rc;
+
+    if (set->num_entries >= STRINGSET_ROOT) {
+        return IB_EINVAL;
+    }
+
+    rc = stringset_builder_grow(&builder, 256);
+    if (rc != IB_OK) {
+        goto finish;
+    }
+    builder.check[0] = STRINGSET_ROOT;
+
+    work_size = 256;
+    work = malloc(work_size * sizeof(*work));
+    if (work == NULL) {
+        rc = IB_EALLOC;
+        goto finish;
+    }
+    work[0].state = 0;
+    work[0].depth = 0;
+    work[0].first = 0;
+    work[0].last  = set->num_entries;
+    num_work = 1;
+
+    /* Depth first, so the work list stays short. */
+    while (num_work > 0) {
+        stringset_work_t item = work[--num_work];
+
+        if (work_size - num_work < 256) {
+            stringset_work_t *new_work =
+                realloc(work, 2 * work_size * sizeof(*work));
+            if (new_work == NULL) {
+                rc = IB_EALLOC;
+                goto finish;
+            }
+            work = new_work;
+            work_size *= 2;
+        }
+
+        rc = stringset_expand(set, &builder, &item, work, &num_work);
+        if (rc != IB_OK) {
+            goto finish;
+        }
+    }
+
+    index = ib_mm_alloc(mm, sizeof(*index));
+    if (index == NULL) {
+        rc = IB_EALLOC;
+        goto finish;
+    }
+    index->size  = builder.size;
+    index->base  = ib_mm_memdup(mm, builder.base,
+                                builder.size * sizeof(*builder.base));
+    index->check = ib_mm_memdup(mm, builder.check,
+                                builder.size * sizeof(*builder.check));
+    index->value = ib_mm_memdup(mm, builder.value,
+                                builder.size * sizeof(*builder.value));
+    if (
+        index->base == NULL ||
+        index->check == NULL ||
+        index->value == NULL
+    ) {
+        rc = IB_EALLOC;
+        goto finish;
+    }
+    set->index = index;
+
+finish:
+    free(work);
+    free(builder.base);
+    free(builder.check);
+    free(builder.value);
+
+    return rc;
+}
+
+/**
+ * Query the trie index of a String Set.
+ *
+ * @sa ib_stringset_query()
+ */
+static
+ib_status_t stringset_index_query(
+    const ib_stringset_t        *set,
+    const char                  *string,
+    size_t                       string_length,
+    const ib_stringset_entry_t **out_entry
+)
+{
+    const ib_stringset_index_t *index = set->index;
+    uint32_t                    state = 0;
+    uint32_t                    best  = index->value[0];
+
+    for (size_t i = 0; i < string_length; ++i) {
+        size_t next = index->base[state] + (uint8_t)string[i];
+
+        if (next >= index->size || index->check[next] != state) {
+            break;
+        }
+        state = (uint32_t)next;
+        if (index->value[state] != STRINGSET_NONE) {
+            best = index->value[state];
+        }
+    }
+
+    if (best == STRINGSET_NONE) {
+        return IB_ENOENT;
+    }
+    if (out_entry != NULL) {
+        *out_entry = &set->entries[best];
+    }
+    return IB_OK;
+}
+
+/**@}*/
+
 ib_status_t ib_stringset_init(
     ib_stringset_t       *set,
     ib_stringset_entry_t *entries,
@@ -92,6 +425,7 @@ ib_status_t ib_stringset_init(
 
     set->entries = entries;
     set->num_entries = num_entries;
+    set->index = NULL;
 
     qsort((void *)set->entries, num_entries, sizeof(*entries), compare);
 
@@ -108,6 +442,10 @@ ib_status_t ib_stringset_query(
     assert(set != NULL);
     assert(string != NULL);
 
+    if (set->index != NULL) {
+        return stringset_index_query(set, string, string_length, out_entry);
+    }
+
     ib_stringset_entry_t key = {string, string_length, NULL};
 
     /* Based on C++ std::upper_bound() */
@@ -0,0 +1,393 @@
+//////////////////////////////////////////////////////////////////////////////
+// Licensed to Qualys, Inc. (QUALYS) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.
+// QUALYS licenses this file to You under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+/// @file
+/// @brief IronBee --- Util Microbenchmarks
+///
+/// Times the basic operations of the util data structures and memory
+/// managers.  Each benchmark does a number of operations in a fresh memory
+/// pool, a number of times, and the minimum and median time per operation
+/// are reported, so that a change to, e.g., the hash or the pools can be
+/// measured alone rather than through an engine run.
+///
+/// Usage: bench_util [-n operations] [-r runs] [name...]
+///
+/// With names, only benchmarks whose names contain one of them are run.
+//////////////////////////////////////////////////////////////////////////////
+#include "ironbee_config_auto.h"
+
+#include <ironbee/array.h>
+#include <ironbee/bytestr.h>
+#include <ironbee/clock.h>
+#include <ironbee/hash.h>
+#include <ironbee/list.h>
+#include <ironbee/mm_mpool.h>
+#include <ironbee/mm_mpool_lite.h>
+#include <ironbee/mpool.h>
+#include <ironbee/mpool_lite.h>
+#include <ironbee/queue.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+//! Keys used by the hash benchmarks; built once, outside the timings.
+vector<string> g_keys;
+
+//! Keep results live, so the compiler does not drop the work.
+volatile size_t g_sink;
+
+//! Throw if @a rc is not IB_OK.
+void check(ib_status_t rc, const char* what)
+{
+    if (rc != IB_OK) {
+        throw runtime_error(string(what) + " failed.");
+    }
+}
+
+/**
+ * A benchmark: do @a n operations with memory from @a mm.
+ *
+ * Setup, such as filling a structure to look up in, is on the benchmark,
+ * so each takes the time of its own operations only: it returns the time
+ * it took, in microseconds, having timed just those.
+ **/
+typedef ib_time_t (*bench_fn_t)(ib_mm_t mm, size_t n);
+
+ib_time_t bench_hash_set(ib_mm_t mm, size_t n)
+{
+    ib_hash_t* hash;
+    check(ib_hash_create(&hash, mm), "ib_hash_create");
+
+    ib_time_t start = ib_clock_precise_get_time();
+    for (size_t i = 0; i < n; ++i) {
+        check(ib_hash_set(hash, g_keys[i].c_str(), &g_keys[i]), "ib_hash_set");
+    }
+    return ib_clock_precise_get_time() - start;
+}
+
+ib_time_t bench_hash_get(ib_mm_t mm, size_t n)
+{
+    ib_hash_t* hash;
+    check(ib_hash_create(&hash, mm), "ib_hash_create");
+    for (size_t i = 0; i < n; ++i) {
+        check(ib_hash_set(hash, g_keys[i].c_str(), &g_keys[i]), "ib_hash_set");
+    }
+
+    ib_time_t start = ib_clock_precise_get_time();
+    for (size_t i = 0; i < n; ++i) {
+        string* value;
+        check(ib_hash_get(hash, &value, g_keys[i].c_str()), "ib_hash_get");
+        g_sink += value->size();
+    }
+    return ib_clock_precise_get_time() - start;
+}
+
+ib_time_t bench_hash_get_nocase(ib_mm_t mm, size_t n)
+{
+    ib_hash_t* hash;
+    check(ib_hash_create_nocase(&hash, mm), "ib_hash_create_nocase");
+    for (size_t i = 0; i < n; ++i) {
+        check(ib_hash_set(hash, g_keys[i].c_str(), &g_keys[i]), "ib_hash_set");
+    }
+
+    ib_time_t start = ib_clock_precise_get_time();
+    for (size_t i = 0; i < n; ++i) {
+        string* value;
+        check(ib_hash_get(hash, &value, g_keys[i].c_str()), "ib_hash_get");
+        g_sink += value->size();
+    }
+    return ib_clock_precise_get_time() - start;
+}
+
+ib_time_t bench_array_append(ib_mm_t mm, size_t n)
+{
+    ib_array_t* array;
+    check(ib_array_create(&array, mm, 16, 16), "ib_array_create");
+
+    ib_time_t start = ib_clock_precise_get_time();
+    for (size_t i = 0; i < n; ++i) {
+        check(ib_array_appendn(array, &g_keys[i]), "ib_array_appendn");
+    }
+    return ib_clock_precise_get_time() - start;
+}
+
+ib_time_t bench_array_get(ib_mm_t mm, size_t n)
+{
+    ib_array_t* array;
+    check(ib_array_create(&array, mm, 16, 16), "ib_array_create");
+    for (size_t i = 0; i < n; ++i) {
+        check(ib_array_appendn(array, &g_keys[i]), "ib_array_appendn");
+    }
+
+    ib_time_t start = ib_clock_precise_get_time();
+    for (size_t i = 0; i < n; ++i) {
+        string* value;
+        check(ib_array_get(array, i, &value), "ib_array_get");
+        g_sink += value->size();
+    }
+    return ib_clock_precise_get_time() - start;
+}
+
+ib_time_t bench_list_push_iterate(ib_mm_t mm, size_t n)
+{
+    ib_list_t* list;
+    const ib_list_node_t* node;
+    check(ib_list_create(&list, mm), "ib_list_create");
+
+    ib_time_t start = ib_clock_precise_get_time();
+    for (size_t i = 0; i < n; ++i) {
+        check(ib_list_push(list, &g_keys[i]), "ib_list_push");
+    }
+    IB_LIST_LOOP_CONST(list, node) {
+        g_sink += reinterpret_cast<const string*>(
+            ib_list_node_data_const(node)
+        )->size();
+    }
+    return ib_clock_precise_get_time() - start;
+}
+
+ib_time_t bench_queue_push_pop(ib_mm_t mm, size_t n)
+{
+    ib_queue_t* queue;
+    check(ib_queue_create(&queue, mm, IB_QUEUE_NONE), "ib_queue_create");
+
+    ib_time_t start = ib_clock_precise_get_time();
+    for (size_t i = 0; i < n; ++i) {
+        check(ib_queue_push_back(queue, &g_keys[i]), "ib_queue_push_back");
+    }
+    for (size_t i = 0; i < n; ++i) {
+        string* value;
+        check(ib_queue_pop_front(queue, &value), "ib_queue_pop_front");
+        g_sink += value->size();
+    }
+    return ib_clock_precise_get_time() - start;
+}
+
+ib_time_t bench_bytestr_append(ib_mm_t mm, size_t n)
+{
+    // Appending copies the whole string to a larger buffer from the pool,
+    // so build strings of a header's worth of pieces rather than one
+    // string of all of them.
+    static const size_t c_pieces = 32;
+    ib_bytestr_t* bs = NULL;
+
+    ib_time_t start = ib_clock_precise_get_time();
+    for (size_t i = 0; i < n; ++i) {
+        if (i % c_pieces == 0) {
+            check(ib_bytestr_create(&bs, mm, 16), "ib_bytestr_create");
+        }
+        check(
+            ib_bytestr_append_mem(
+                bs,
+                reinterpret_cast<const uint8_t*>(g_keys[i].data()),
+                g_keys[i].size()
+            ),
+            "ib_bytestr_append_mem"
+        );
+    }
+    return ib_clock_precise_get_time() - start;
+}
+
+ib_time_t bench_mm_alloc(ib_mm_t mm, size_t n)
+{
+    ib_time_t start = ib_clock_precise_get_time();
+    for (size_t i = 0; i < n; ++i) {
+        void* p = ib_mm_alloc(mm, 8 + i % 120);
+        if (p == NULL) {
+            throw runtime_error("ib_mm_alloc failed.");
+        }
+    }
+    return ib_clock_precise_get_time() - start;
+}
+
+ib_time_t bench_clock(ib_mm_t mm, size_t n)
+{
+    ib_time_t start = ib_clock_precise_get_time();
+    for (size_t i = 0; i < n; ++i) {
+        g_sink += ib_clock_get_time();
+    }
+    return ib_clock_precise_get_time() - start;
+}
+
+ib_time_t bench_clock_precise(ib_mm_t mm, size_t n)
+{
+    ib_time_t start = ib_clock_precise_get_time();
+    for (size_t i = 0; i < n; ++i) {
+        g_sink += ib_clock_precise_get_time();
+    }
+    return ib_clock_precise_get_time() - start;
+}
+
+//! Memory managers to run benchmarks with.
+enum pool_e {
+    //! ib_mpool_t.
+    POOL_MPOOL,
+    //! ib_mpool_lite_t.
+    POOL_MPOOL_LITE
+};
+
+//! A benchmark and how to run it.
+struct benchmark_t
+{
+    const char* name;
+    bench_fn_t  fn;
+    pool_e      pool;
+};
+
+const benchmark_t c_benchmarks[] = {
+    { "hash_set",           bench_hash_set,          POOL_MPOOL },
+    { "hash_get",           bench_hash_get,          POOL_MPOOL },
+    { "hash_get_nocase",    bench_hash_get_nocase,   POOL_MPOOL },
+    { "array_append",       bench_array_append,      POOL_MPOOL },
+    { "array_get",          bench_array_get,         POOL_MPOOL },
+    { "list_push_iterate",  bench_list_push_iterate, POOL_MPOOL },
+    { "queue_push_pop",     bench_queue_push_pop,    POOL_MPOOL },
+    { "bytestr_append",     bench_bytestr_append,    POOL_MPOOL },
+    { "mpool_alloc",        bench_mm_alloc,          POOL_MPOOL },
+    { "mpool_lite_alloc",   bench_mm_alloc,          POOL_MPOOL_LITE },
+    { "clock",              bench_clock,             POOL_MPOOL },
+    { "clock_precise",      bench_clock_precise,     POOL_MPOOL }
+};
+
+//! Run @a benchmark once with a fresh pool; time in microseconds.
+ib_time_t run_once(const benchmark_t& benchmark, size_t n)
+{
+    ib_time_t elapsed;
+
+    if (benchmark.pool == POOL_MPOOL) {
+        ib_mpool_t* mp;
+        check(ib_mpool_create(&mp, "bench_util", NULL), "ib_mpool_create");
+        try {
+            elapsed = benchmark.fn(ib_mm_mpool(mp), n);
+        }
+        catch (...) {
+            ib_mpool_destroy(mp);
+            throw;
+        }
+        ib_mpool_destroy(mp);
+    }
+    else {
+        ib_mpool_lite_t* mpl;
+        check(ib_mpool_lite_create(&mpl), "ib_mpool_lite_create");
+        try {
+            elapsed = benchmark.fn(ib_mm_mpool_lite(mpl), n);
+        }
+        catch (...) {
+            ib_mpool_lite_destroy(mpl);
+            throw;
+        }
+        ib_mpool_lite_destroy(mpl);
+    }
+
+    return elapsed;
+}
+
+//! True if @a name is selected by @a filters.
+bool selected(const char* name, const vector<string>& filters)
+{
+    if (filters.empty()) {
+        return true;
+    }
+    for (size_t i = 0; i < filters.size(); ++i) {
+        if (strstr(name, filters[i].c_str()) != NULL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void usage()
+{
+    fprintf(stderr, "Usage: bench_util [-n operations] [-r runs] [name...]\n");
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = 100000;
+    size_t runs = 10;
+    vector<string> filters;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            runs = strtoul(argv[++i], NULL, 10);
+        }
+        else if (argv[i][0] == '-') {
+            usage();
+            return 1;
+        }
+        else {
+            filters.push_back(argv[i]);
+        }
+    }
+    if (n == 0 || runs == 0) {
+        usage();
+        return 1;
+    }
+
+    g_keys.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        char key[32];
+        snprintf(key, sizeof(key), "Key-%zu", i * 2654435761U % (n * 4));
+        g_keys.push_back(key);
+    }
+
+    printf("%-20s %12s %12s\n", "benchmark", "min ns/op", "median ns/op");
+    try {
+        for (size_t i = 0; i < sizeof(c_benchmarks) / sizeof(*c_benchmarks); ++i) {
+            const benchmark_t& benchmark = c_benchmarks[i];
+            if (! selected(benchmark.name, filters)) {
+                continue;
+            }
+
+            // One run to warm up caches and the allocator.
+            run_once(benchmark, n);
+
+            vector<ib_time_t> times;
+            for (size_t r = 0; r < runs; ++r) {
+                times.push_back(run_once(benchmark, n));
+            }
+            sort(times.begin(), times.end());
+
+            printf("%-20s %12.1f %12.1f\n",
+                benchmark.name,
+                times.front() * 1000.0 / n,
+                times[times.size() / 2] * 1000.0 / n
+            );
+        }
+    }
+    catch (const exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
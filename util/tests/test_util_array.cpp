@@ -156,6 +156,37 @@ TEST_F(TestIBUtilArray, test_array_set_and_get)
     ASSERT_EQ(1000001UL, ib_array_elements(arr));
 }
 
+/// @test Test util array library - sparse ib_array_setn()
+TEST_F(TestIBUtilArray, test_array_sparse)
+{
+    ib_array_t *arr;
+    int v1 = 1;
+    int v2 = 2;
+    int *val;
+
+    ASSERT_EQ(IB_OK, ib_array_create(&arr, MM(), 16, 2));
+
+    ASSERT_EQ(IB_OK, ib_array_setn(arr, 1000, &v1));
+    ASSERT_EQ(1008UL, ib_array_size(arr));
+    ASSERT_EQ(1001UL, ib_array_elements(arr));
+
+    /* Skipped indexes read as NULL whether or not their chunk exists. */
+    ASSERT_EQ(IB_OK, ib_array_get(arr, 500, &val));
+    ASSERT_FALSE(val);
+    ASSERT_EQ(IB_OK, ib_array_get(arr, 999, &val));
+    ASSERT_FALSE(val);
+    ASSERT_EQ(IB_OK, ib_array_get(arr, 1000, &val));
+    ASSERT_EQ(&v1, val);
+
+    /* Filling in a skipped index. */
+    ASSERT_EQ(IB_OK, ib_array_setn(arr, 500, &v2));
+    ASSERT_EQ(IB_OK, ib_array_get(arr, 500, &val));
+    ASSERT_EQ(&v2, val);
+    ASSERT_EQ(IB_OK, ib_array_get(arr, 501, &val));
+    ASSERT_FALSE(val);
+    ASSERT_EQ(1001UL, ib_array_elements(arr));
+}
+
 /// @test Test util array library - IB_ARRAY_LOOP()
 TEST_F(TestIBUtilArray, test_array_loop)
 {
@@ -0,0 +1,128 @@
+//////////////////////////////////////////////////////////////////////////////
+// Licensed to Qualys, Inc. (QUALYS) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.
+// QUALYS licenses this file to You under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+/// @file
+/// @brief IronBee --- Shared Artifact Cache Tests
+//////////////////////////////////////////////////////////////////////////////
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/artifact.h>
+#include <ironbee/mm_mpool_lite.h>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+int g_created;
+int g_destroyed;
+
+extern "C" {
+
+ib_status_t create_fn(void **artifact, void *cbdata)
+{
+    ++g_created;
+    *artifact = cbdata;
+    return (cbdata == NULL) ? IB_EINVAL : IB_OK;
+}
+
+void destroy_fn(void *artifact)
+{
+    ++g_destroyed;
+}
+
+}
+
+class ArtifactTest : public ::testing::Test
+{
+public:
+    virtual void SetUp()
+    {
+        g_created = 0;
+        g_destroyed = 0;
+        ASSERT_EQ(IB_OK, ib_mpool_lite_create(&m_mp1));
+        ASSERT_EQ(IB_OK, ib_mpool_lite_create(&m_mp2));
+    }
+
+    virtual void TearDown()
+    {
+        if (m_mp1 != NULL) {
+            ib_mpool_lite_destroy(m_mp1);
+        }
+        if (m_mp2 != NULL) {
+            ib_mpool_lite_destroy(m_mp2);
+        }
+        ASSERT_EQ(0U, ib_artifact_count());
+    }
+
+protected:
+    ib_mpool_lite_t *m_mp1;
+    ib_mpool_lite_t *m_mp2;
+};
+
+}
+
+TEST_F(ArtifactTest, Shared)
+{
+    int   a;
+    int   b;
+    void *artifact1;
+    void *artifact2;
+
+    ASSERT_EQ(IB_OK, ib_artifact_acquire(
+        &artifact1, ib_mm_mpool_lite(m_mp1), "test", "k", 1,
+        create_fn, &a, destroy_fn));
+    ASSERT_EQ(&a, artifact1);
+
+    /* Same key: the first artifact is reused. */
+    ASSERT_EQ(IB_OK, ib_artifact_acquire(
+        &artifact2, ib_mm_mpool_lite(m_mp2), "test", "k", 1,
+        create_fn, &b, destroy_fn));
+    EXPECT_EQ(&a, artifact2);
+    EXPECT_EQ(1, g_created);
+    EXPECT_EQ(1U, ib_artifact_count());
+
+    /* Other kind, same key: a second artifact. */
+    ASSERT_EQ(IB_OK, ib_artifact_acquire(
+        &artifact2, ib_mm_mpool_lite(m_mp2), "other", "k", 1,
+        create_fn, &b, destroy_fn));
+    EXPECT_EQ(&b, artifact2);
+    EXPECT_EQ(2, g_created);
+    EXPECT_EQ(2U, ib_artifact_count());
+
+    /* The artifact lives as long as any reference. */
+    ib_mpool_lite_destroy(m_mp1);
+    m_mp1 = NULL;
+    EXPECT_EQ(0, g_destroyed);
+
+    ib_mpool_lite_destroy(m_mp2);
+    m_mp2 = NULL;
+    EXPECT_EQ(2, g_destroyed);
+}
+
+TEST_F(ArtifactTest, CreateFailure)
+{
+    void *artifact = NULL;
+
+    ASSERT_EQ(IB_EINVAL, ib_artifact_acquire(
+        &artifact, ib_mm_mpool_lite(m_mp1), "test", "k", 1,
+        create_fn, NULL, destroy_fn));
+    EXPECT_EQ(NULL, artifact);
+    EXPECT_EQ(0U, ib_artifact_count());
+    EXPECT_EQ(0, g_destroyed);
+}
@@ -0,0 +1,216 @@
+//////////////////////////////////////////////////////////////////////////////
+// Licensed to Qualys, Inc. (QUALYS) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.
+// QUALYS licenses this file to You under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+/// @file
+/// @brief IronBee --- Batch Writer Test Functions
+//////////////////////////////////////////////////////////////////////////////
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/batch_writer.h>
+#include <ironbee/mm_mpool_lite.h>
+
+#include "gtest/gtest.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <vector>
+
+namespace {
+//! Items written, and the number of batches they came in.
+struct written_t {
+    pthread_mutex_t    mutex;
+    std::vector<int>   items;
+    int                batches;
+    pthread_t          thread;
+};
+
+extern "C" {
+    //! Record a batch in a written_t.
+    void record_fn(void **items, size_t n_items, void *cbdata)
+    {
+        written_t *written = reinterpret_cast<written_t *>(cbdata);
+
+        pthread_mutex_lock(&written->mutex);
+        for (size_t i = 0; i < n_items; ++i) {
+            written->items.push_back(
+                static_cast<int>(reinterpret_cast<intptr_t>(items[i])));
+        }
+        ++written->batches;
+        written->thread = pthread_self();
+        pthread_mutex_unlock(&written->mutex);
+    }
+}
+
+void *item(int i)
+{
+    return reinterpret_cast<void *>(static_cast<intptr_t>(i));
+}
+
+class TestBatchWriter : public ::testing::Test
+{
+public:
+    void SetUp()
+    {
+        ASSERT_EQ(IB_OK, ib_mpool_lite_create(&m_mpl));
+        ASSERT_EQ(0, pthread_mutex_init(&m_written.mutex, NULL));
+        m_written.batches = 0;
+    }
+
+    void TearDown()
+    {
+        ib_mpool_lite_destroy(m_mpl);
+        pthread_mutex_destroy(&m_written.mutex);
+    }
+
+protected:
+    ib_mpool_lite_t *m_mpl;
+    written_t        m_written;
+};
+}
+
+TEST_F(TestBatchWriter, create)
+{
+    ib_batch_writer_t *writer;
+
+    EXPECT_EQ(
+        IB_EINVAL,
+        ib_batch_writer_create(&writer, ib_mm_mpool_lite(m_mpl), 0,
+                               record_fn, &m_written));
+    ASSERT_EQ(
+        IB_OK,
+        ib_batch_writer_create(&writer, ib_mm_mpool_lite(m_mpl), 4,
+                               record_fn, &m_written));
+
+    // Nothing submitted; stopping writes nothing.
+    ib_batch_writer_stop(writer);
+    ib_batch_writer_stop(writer);
+    EXPECT_EQ(0, m_written.batches);
+}
+
+TEST_F(TestBatchWriter, submit)
+{
+    ib_batch_writer_t *writer;
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_batch_writer_create(&writer, ib_mm_mpool_lite(m_mpl), 4,
+                               record_fn, &m_written));
+
+    // More items than may be queued, so submitters wait for the thread.
+    for (int i = 0; i < 1000; ++i) {
+        ib_batch_writer_submit(writer, item(i));
+    }
+    ib_batch_writer_flush(writer);
+
+    pthread_mutex_lock(&m_written.mutex);
+    ASSERT_EQ(1000U, m_written.items.size());
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(i, m_written.items[i]);
+    }
+    EXPECT_LE(250, m_written.batches);
+    EXPECT_FALSE(pthread_equal(pthread_self(), m_written.thread));
+    pthread_mutex_unlock(&m_written.mutex);
+
+    ib_batch_writer_stop(writer);
+}
+
+TEST_F(TestBatchWriter, stop)
+{
+    ib_batch_writer_t *writer;
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_batch_writer_create(&writer, ib_mm_mpool_lite(m_mpl), 1000,
+                               record_fn, &m_written));
+    for (int i = 0; i < 100; ++i) {
+        ib_batch_writer_submit(writer, item(i));
+    }
+
+    // Stopping writes what is queued.
+    ib_batch_writer_stop(writer);
+    ASSERT_EQ(100U, m_written.items.size());
+
+    // Once stopped, items are written by the submitter.
+    ib_batch_writer_submit(writer, item(100));
+    ASSERT_EQ(101U, m_written.items.size());
+    EXPECT_EQ(100, m_written.items[100]);
+    EXPECT_TRUE(pthread_equal(pthread_self(), m_written.thread));
+}
+
+TEST_F(TestBatchWriter, destroy)
+{
+    ib_batch_writer_t *writer;
+    ib_mpool_lite_t   *mpl;
+
+    ASSERT_EQ(IB_OK, ib_mpool_lite_create(&mpl));
+    ASSERT_EQ(
+        IB_OK,
+        ib_batch_writer_create(&writer, ib_mm_mpool_lite(mpl), 1000,
+                               record_fn, &m_written));
+    for (int i = 0; i < 100; ++i) {
+        ib_batch_writer_submit(writer, item(i));
+    }
+
+    // Destroying the memory manager writes what is queued.
+    ib_mpool_lite_destroy(mpl);
+    EXPECT_EQ(100U, m_written.items.size());
+}
+
+TEST_F(TestBatchWriter, fork)
+{
+    ib_batch_writer_t *writer;
+    pid_t              pid;
+    int                status;
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_batch_writer_create(&writer, ib_mm_mpool_lite(m_mpl), 4,
+                               record_fn, &m_written));
+
+    // Start the thread in this process and let it go idle.
+    ib_batch_writer_submit(writer, item(0));
+    ib_batch_writer_flush(writer);
+
+    pid = fork();
+    ASSERT_LE(0, pid);
+    if (pid == 0) {
+        // The child writes with a thread of its own.
+        alarm(30);
+        m_written.items.clear();
+        for (int i = 0; i < 100; ++i) {
+            ib_batch_writer_submit(writer, item(i));
+        }
+        ib_batch_writer_flush(writer);
+        ib_batch_writer_stop(writer);
+        _exit(m_written.items.size() == 100 ? 0 : 1);
+    }
+
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(0, WEXITSTATUS(status));
+
+    // The parent's thread is unaffected.
+    ib_batch_writer_submit(writer, item(1));
+    ib_batch_writer_stop(writer);
+    EXPECT_EQ(2U, m_written.items.size());
+}
@@ -32,6 +32,7 @@
 
 #include <ironbee/mm.h>
 
+#include <cstdio>
 #include <stdexcept>
 
 class TestIBUtilHash : public SimpleFixture
@@ -384,6 +385,40 @@ TEST_F(TestIBUtilHash, test_hash_collision_delete)
     EXPECT_EQ(c, value);
 }
 
+TEST_F(TestIBUtilHash, test_hash_delete_reinsert)
+{
+    ib_hash_t *hash = NULL;
+    char       keys[1000][8];
+    void      *value;
+
+    ASSERT_EQ(IB_OK, ib_hash_create(&hash, MM()));
+
+    for (int i = 0; i < 1000; ++i) {
+        snprintf(keys[i], sizeof(keys[i]), "k%d", i);
+    }
+
+    // Repeated removal and insertion reuses removed entries.
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 1000; ++i) {
+            ASSERT_EQ(IB_OK, ib_hash_set(hash, keys[i], keys[i]));
+        }
+        ASSERT_EQ(1000UL, ib_hash_size(hash));
+        for (int i = 0; i < 1000; i += 2) {
+            ASSERT_EQ(IB_OK, ib_hash_remove(hash, NULL, keys[i]));
+        }
+        ASSERT_EQ(500UL, ib_hash_size(hash));
+        for (int i = 0; i < 1000; ++i) {
+            if (i % 2 == 0) {
+                EXPECT_EQ(IB_ENOENT, ib_hash_get(hash, &value, keys[i]));
+            }
+            else {
+                ASSERT_EQ(IB_OK, ib_hash_get(hash, &value, keys[i]));
+                EXPECT_EQ(keys[i], value);
+            }
+        }
+    }
+}
+
 TEST_F(TestIBUtilHash, test_hash_remove)
 {
     ib_hash_t *hash          = NULL;
@@ -26,6 +26,7 @@
 
 #include "ironbee_config_auto.h"
 #include "gtest/gtest.h"
+#include "simple_fixture.hpp"
 
 #include <ironbee/ipset.h>
 
@@ -43,7 +44,7 @@
 
 using namespace std;
 
-class TestIPSet : public ::testing::Test
+class TestIPSet : public SimpleFixture
 {
 protected:
     // Helper routines.
@@ -602,6 +603,156 @@ TEST_F(TestIPSet, PositiveSet6)
     }
 }
 
+TEST_F(TestIPSet, Indexed4)
+{
+    static const size_t c_num_networks = 2000;
+    static const size_t c_num_tests = (size_t)1e5;
+
+    ib_status_t rc;
+    ib_ipset4_t set;
+    vector<ib_ipset4_entry_t> positive;
+    vector<ib_ipset4_entry_t> negative;
+
+    // Networks within 10.0.0.0/14 so that they overlap.
+    for (size_t i = 0; i < c_num_networks; ++i) {
+        ib_ipset4_entry_t entry;
+        entry.network.ip = ip4(10, random(0, 3), random(0, 255), random(0, 255));
+        entry.data = NULL;
+        if (random(0, 9) == 0) {
+            entry.network.size = random(20, 32);
+            negative.push_back(entry);
+        }
+        else {
+            entry.network.size = random(14, 32);
+            positive.push_back(entry);
+        }
+    }
+
+    rc = ib_ipset4_init(
+        &set,
+        negative.data(), negative.size(),
+        positive.data(), positive.size()
+    );
+    ASSERT_EQ(IB_OK, rc);
+    ASSERT_EQ(IB_OK, ib_ipset4_index(&set, MM()));
+
+    size_t num_found = 0;
+    for (size_t i = 0; i < c_num_tests; ++i) {
+        ib_ip4_t ip = ip4(10, random(0, 4), random(0, 255), random(0, 255));
+
+        // Brute force.
+        const ib_ipset4_entry_t* expected_specific = NULL;
+        const ib_ipset4_entry_t* expected_general  = NULL;
+        bool in_negative = false;
+        for (size_t j = 0; j < negative.size(); ++j) {
+            ib_ip4_network_t net = {ip, 32};
+            const ib_ip4_network_t& neg = negative[j].network;
+            if (
+                neg.size == 0 ||
+                (net.ip >> (32 - neg.size)) == (neg.ip >> (32 - neg.size))
+            ) {
+                in_negative = true;
+            }
+        }
+        for (size_t j = 0; j < positive.size() && ! in_negative; ++j) {
+            const ib_ip4_network_t& pos = positive[j].network;
+            if ((ip >> (32 - pos.size)) == (pos.ip >> (32 - pos.size))) {
+                if (
+                    ! expected_specific ||
+                    pos.size > expected_specific->network.size
+                ) {
+                    expected_specific = &positive[j];
+                }
+                if (
+                    ! expected_general ||
+                    pos.size < expected_general->network.size
+                ) {
+                    expected_general = &positive[j];
+                }
+            }
+        }
+
+        const ib_ipset4_entry_t* entry    = NULL;
+        const ib_ipset4_entry_t* specific = NULL;
+        const ib_ipset4_entry_t* general  = NULL;
+        rc = ib_ipset4_query(&set, ip, &entry, &specific, &general);
+        if (! expected_specific) {
+            ASSERT_EQ(IB_ENOENT, rc);
+            ASSERT_FALSE(entry);
+            continue;
+        }
+        ASSERT_EQ(IB_OK, rc);
+        ++num_found;
+        ASSERT_EQ(entry, specific);
+        ASSERT_EQ(expected_specific->network.ip, specific->network.ip);
+        ASSERT_EQ(expected_specific->network.size, specific->network.size);
+        ASSERT_EQ(expected_general->network.ip, general->network.ip);
+        ASSERT_EQ(expected_general->network.size, general->network.size);
+    }
+
+    // Both outcomes should be well represented.
+    EXPECT_LT(c_num_tests / 10, num_found);
+    EXPECT_GT(c_num_tests - c_num_tests / 10, num_found);
+}
+
+TEST_F(TestIPSet, Indexed6)
+{
+    ib_status_t rc;
+    ib_ipset6_t set;
+    vector<ib_ipset6_entry_t> positive;
+    vector<ib_ipset6_entry_t> negative;
+
+    static int marker_a = 1;
+    static int marker_b = 2;
+
+    positive.push_back(entry6(0x20010db8, 0, 0, 0, 32, &marker_a));
+    positive.push_back(entry6(0x20010db8, 0x00010000, 0, 0, 48));
+    positive.push_back(entry6(0x20010db8, 0x00010000, 0, 0x10, 126, &marker_b));
+    positive.push_back(entry6(0, 0, 0, 1, 128));
+    negative.push_back(entry6(0x20010db8, 0x00020000, 0, 0, 48));
+
+    rc = ib_ipset6_init(
+        &set,
+        negative.data(), negative.size(),
+        positive.data(), positive.size()
+    );
+    ASSERT_EQ(IB_OK, rc);
+    ASSERT_EQ(IB_OK, ib_ipset6_index(&set, MM()));
+
+    const ib_ipset6_entry_t* entry    = NULL;
+    const ib_ipset6_entry_t* specific = NULL;
+    const ib_ipset6_entry_t* general  = NULL;
+
+    rc = ib_ipset6_query(
+        &set, ip6(0x20010db8, 0x00010000, 0, 0x13),
+        &entry, &specific, &general
+    );
+    ASSERT_EQ(IB_OK, rc);
+    EXPECT_EQ(&marker_b, reinterpret_cast<const int*>(specific->data));
+    EXPECT_EQ(&marker_a, reinterpret_cast<const int*>(general->data));
+    EXPECT_EQ(entry, specific);
+
+    rc = ib_ipset6_query(
+        &set, ip6(0x20010db8, 0x00010000, 0, 0x14),
+        &entry, &specific, &general
+    );
+    ASSERT_EQ(IB_OK, rc);
+    EXPECT_EQ(48, specific->network.size);
+
+    rc = ib_ipset6_query(
+        &set, ip6(0x20010db8, 0x00020000, 0, 1),
+        &entry, &specific, &general
+    );
+    EXPECT_EQ(IB_ENOENT, rc);
+    EXPECT_FALSE(entry);
+
+    EXPECT_EQ(IB_OK, ib_ipset6_query(&set, ip6(0, 0, 0, 1), NULL, NULL, NULL));
+    EXPECT_EQ(
+        IB_ENOENT,
+        ib_ipset6_query(&set, ip6(0, 0, 0, 2), NULL, NULL, NULL)
+    );
+}
+
 TEST_F(TestIPSet, Inval)
 {
     ib_ipset4_t set4;
@@ -611,10 +762,12 @@ TEST_F(TestIPSet, Inval)
     EXPECT_EQ(IB_EINVAL, ib_ipset4_init(&set4, NULL, 1, NULL, 0));
     EXPECT_EQ(IB_EINVAL, ib_ipset4_init(&set4, NULL, 0, NULL, 1));
     EXPECT_EQ(IB_EINVAL, ib_ipset4_query(NULL, 0, NULL, NULL, NULL));
+    EXPECT_EQ(IB_EINVAL, ib_ipset4_index(NULL, MM()));
 
     EXPECT_EQ(IB_EINVAL, ib_ipset6_init(NULL, NULL, 0, NULL, 0));
     EXPECT_EQ(IB_EINVAL, ib_ipset6_init(&set6, NULL, 1, NULL, 0));
     EXPECT_EQ(IB_EINVAL, ib_ipset6_init(&set6, NULL, 0, NULL, 1));
+    EXPECT_EQ(IB_EINVAL, ib_ipset6_index(NULL, MM()));
     EXPECT_EQ(
         IB_EINVAL,
         ib_ipset6_query(NULL, ib_ip6_t(), NULL, NULL, NULL)
@@ -571,4 +571,66 @@ TEST_F(TestIBUtilList, test_insert) {
     ASSERT_EQ(IB_OK, ib_list_shift(list, &p));
     ASSERT_EQ(&k, p) << "k expected";
 
-}
\ No newline at end of file
+}
+/// @test Test util list library - ib_list_clear() and node reuse
+TEST_F(TestIBUtilList, test_list_clear_reuse) {
+    ib_list_t      *list;
+    ib_list_node_t *node;
+    size_t          version;
+    static const int ints1[] = { 0, 1, 2, 3, 4 };
+    static const int ints2[] = { 5, 6, 7 };
+    static const int ints3[] = { 8, 9, 10, 11, 12, 13, 14 };
+
+    ASSERT_EQ(IB_OK, ib_list_create(&list, MM()));
+    populate_list(list, ints1, 5);
+    node = ib_list_first(list);
+
+    version = ib_list_version(list);
+    ib_list_clear(list);
+    ASSERT_NE(version, ib_list_version(list));
+    ASSERT_EQ(0UL, ib_list_elements(list));
+    ASSERT_FALSE(ib_list_first(list));
+    ASSERT_FALSE(ib_list_last(list));
+
+    /* Nodes of the cleared list are reused. */
+    populate_list(list, ints2, 3);
+    check_list(list, ints2, 3);
+    ASSERT_EQ(node, ib_list_first(list));
+    ASSERT_FALSE(ib_list_node_prev(ib_list_first(list)));
+    ASSERT_FALSE(ib_list_node_next(ib_list_last(list)));
+
+    /* Growing past the reused nodes allocates new ones. */
+    ib_list_clear(list);
+    ASSERT_EQ(IB_OK, ib_list_unshift(list, (void *)&ints3[1]));
+    ASSERT_EQ(IB_OK, ib_list_insert(list, (void *)&ints3[0], 0));
+    for (int i = 2; i < 7; ++i) {
+        ASSERT_EQ(IB_OK, ib_list_push(list, (void *)&ints3[i]));
+    }
+    check_list(list, ints3, 7);
+
+    version = ib_list_version(list);
+    ASSERT_EQ(IB_OK, ib_list_pop(list, NULL));
+    ASSERT_NE(version, ib_list_version(list));
+}
+
+TEST_F(TestIBUtilList, test_list_nodes_adjacent) {
+    static int ints[200];
+    ib_list_t *list;
+    ib_list_node_t *node;
+    size_t adjacent = 0;
+
+    ASSERT_EQ(IB_OK, ib_list_create(&list, MM()));
+    for (int i = 0; i < 200; ++i) {
+        ints[i] = i;
+    }
+    populate_list(list, ints, 200);
+    check_list(list, ints, 200);
+
+    /* Nodes are allocated in chunks, so most follow their predecessor. */
+    IB_LIST_LOOP(list, node) {
+        if (node->next == node + 1) {
+            ++adjacent;
+        }
+    }
+    ASSERT_LT(150UL, adjacent);
+}
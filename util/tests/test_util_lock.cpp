@@ -35,6 +35,7 @@
 #include <stdexcept>
 #include <math.h>
 #include <pthread.h>
+#include <sched.h>
 
 using namespace std;
 
@@ -179,6 +180,10 @@ public:
     {
         return ib_lock_lock(m_lock);
     }
+    ib_status_t TryLockLock()
+    {
+        return ib_lock_trylock(m_lock);
+    }
     ib_status_t UnlockLock()
     {
         return ib_lock_unlock(m_lock);
@@ -424,3 +429,103 @@ TEST_F(TestIBUtilLock, test_long)
     ASSERT_EQ(IB_OK, rc);
 #endif
 }
+
+TEST_F(TestIBUtilLock, test_trylock)
+{
+    ib_status_t rc;
+
+    rc = CreateLock( );
+    ASSERT_EQ(IB_OK, rc);
+
+    rc = LockLock( );
+    ASSERT_EQ(IB_OK, rc);
+
+    rc = TryLockLock( );
+    ASSERT_EQ(IB_DECLINED, rc);
+
+    rc = UnlockLock( );
+    ASSERT_EQ(IB_OK, rc);
+
+    rc = TryLockLock( );
+    ASSERT_EQ(IB_OK, rc);
+
+    rc = UnlockLock( );
+    ASSERT_EQ(IB_OK, rc);
+}
+
+namespace {
+
+struct rwlock_test_t
+{
+    ib_rwlock_t  *lock;
+    volatile int  shared;
+    volatile int  readers;
+    volatile int  max_readers;
+    volatile int  errors;
+};
+
+const int c_rwlock_loops = 1000;
+
+void *rwlock_reader(void *data)
+{
+    rwlock_test_t *t = reinterpret_cast<rwlock_test_t *>(data);
+
+    for (int n = 0; n < c_rwlock_loops; ++n) {
+        ib_rwlock_rdlock(t->lock);
+        int readers = __sync_add_and_fetch(&t->readers, 1);
+        if (readers > t->max_readers) {
+            t->max_readers = readers;
+        }
+        if (t->shared != 0) {
+            __sync_add_and_fetch(&t->errors, 1);
+        }
+        sched_yield();
+        __sync_sub_and_fetch(&t->readers, 1);
+        ib_rwlock_unlock(t->lock);
+    }
+
+    return NULL;
+}
+
+void *rwlock_writer(void *data)
+{
+    rwlock_test_t *t = reinterpret_cast<rwlock_test_t *>(data);
+
+    for (int n = 0; n < c_rwlock_loops / 10; ++n) {
+        ib_rwlock_wrlock(t->lock);
+        if (++t->shared != 1 || t->readers != 0) {
+            __sync_add_and_fetch(&t->errors, 1);
+        }
+        sched_yield();
+        --t->shared;
+        ib_rwlock_unlock(t->lock);
+    }
+
+    return NULL;
+}
+
+}
+
+TEST(test_util_lock, rwlock)
+{
+    rwlock_test_t t = { NULL, 0, 0, 0, 0 };
+    pthread_t     threads[8];
+
+    ASSERT_EQ(IB_OK, ib_rwlock_create_malloc(&t.lock));
+
+    for (size_t i = 0; i < sizeof(threads) / sizeof(*threads); ++i) {
+        ASSERT_EQ(
+            0,
+            pthread_create(&threads[i], NULL,
+                           (i % 4 == 0) ? rwlock_writer : rwlock_reader,
+                           &t));
+    }
+    for (size_t i = 0; i < sizeof(threads) / sizeof(*threads); ++i) {
+        ASSERT_EQ(0, pthread_join(threads[i], NULL));
+    }
+
+    EXPECT_EQ(0, t.errors);
+    EXPECT_EQ(0, t.shared);
+
+    ib_rwlock_destroy_malloc(t.lock);
+}
@@ -235,6 +235,7 @@ TEST_F(TestIBUtilLogformat, test_parse_custom1)
     rc = ib_logformat_parse(lf, "MyFormat %s %S %h %f END");
     ASSERT_EQ(IB_OK, rc);
     ASSERT_EQ(9U, ib_list_elements(lf->items));
+    ASSERT_EQ(9U, lf->ops_len);
 
     rc = ib_logformat_format(lf, linebuf, buflen, &len, format_field, NULL);
     ASSERT_EQ(IB_OK, rc);
@@ -114,6 +114,61 @@ TEST(TestMpool, Basic)
     ib_mpool_destroy(mp);
 }
 
+TEST(TestMpool, Limit)
+{
+    ib_mpool_t* mp = NULL;
+
+    ASSERT_EQ(IB_OK, ib_mpool_create(&mp, NULL, NULL));
+    EXPECT_EQ(0U, ib_mpool_limit(mp));
+
+    ib_mpool_limit_set(mp, 10000);
+    EXPECT_EQ(10000U, ib_mpool_limit(mp));
+    EXPECT_TRUE(ib_mpool_alloc(mp, 4000));
+    EXPECT_TRUE(ib_mpool_alloc(mp, 4000));
+    EXPECT_FALSE(ib_mpool_limit_reached(mp));
+
+    // Small and large allocations past the limit fail.
+    EXPECT_FALSE(ib_mpool_alloc(mp, 4000));
+    EXPECT_FALSE(ib_mpool_alloc(mp, 100000));
+    EXPECT_TRUE(ib_mpool_limit_reached(mp));
+    EXPECT_GE(10000U, ib_mpool_inuse(mp));
+    EXPECT_TRUE(ib_mpool_alloc(mp, 100));
+
+    // Clearing keeps the limit but forgets it was reached.
+    ib_mpool_clear(mp);
+    EXPECT_FALSE(ib_mpool_limit_reached(mp));
+    EXPECT_EQ(10000U, ib_mpool_limit(mp));
+    EXPECT_TRUE(ib_mpool_alloc(mp, 8000));
+    EXPECT_FALSE(ib_mpool_alloc(mp, 8000));
+
+    ib_mpool_limit_set(mp, 0);
+    EXPECT_TRUE(ib_mpool_alloc(mp, 8000));
+
+    ib_mpool_destroy(mp);
+}
+
+TEST(TestMpool, PageReuse)
+{
+    // Pages of destroyed pools may be reused by later pools.
+    for (int round = 0; round < 100; ++round) {
+        ib_mpool_t* mp = NULL;
+        char* p[50];
+
+        ASSERT_EQ(IB_OK, ib_mpool_create(&mp, NULL, NULL));
+        for (int i = 0; i < 50; ++i) {
+            p[i] = reinterpret_cast<char*>(ib_mpool_alloc(mp, 1000));
+            ASSERT_TRUE(p[i]);
+            memset(p[i], i, 1000);
+        }
+        for (int i = 0; i < 50; ++i) {
+            for (int j = 0; j < 1000; ++j) {
+                ASSERT_EQ(i, p[i][j]);
+            }
+        }
+        ib_mpool_destroy(mp);
+    }
+}
+
 TEST(TestMpool, CreateDestroy)
 {
     reset_test();
@@ -29,6 +29,9 @@
 
 #include <list>
 
+#include <stdint.h>
+#include <string.h>
+
 using namespace std;
 
 TEST(MpoolLiteTest, alloc)
@@ -53,6 +56,41 @@ TEST(MpoolLiteTest, alloc)
     ib_mpool_lite_destroy(mpl);
 }
 
+TEST(MpoolLiteTest, ManyAllocs)
+{
+    ib_mpool_lite_t* mpl;
+    list<pair<unsigned char*, size_t> > allocs;
+
+    ASSERT_EQ(IB_OK, ib_mpool_lite_create(&mpl));
+
+    /* Small allocations share slabs; large ones do not. */
+    for (size_t i = 0; i < 2000; ++i) {
+        size_t size = (i % 10 == 0) ? 1000 + i : 1 + i % 300;
+        unsigned char* p =
+            reinterpret_cast<unsigned char*>(ib_mpool_lite_alloc(mpl, size));
+        ASSERT_TRUE(p);
+        if (size <= 256) {
+            EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(p) % 16);
+        }
+        memset(p, i & 0xff, size);
+        allocs.push_back(make_pair(p, size));
+    }
+
+    /* No allocation overlaps another. */
+    size_t i = 0;
+    for (
+        list<pair<unsigned char*, size_t> >::const_iterator n = allocs.begin();
+        n != allocs.end();
+        ++n, ++i
+    ) {
+        for (size_t j = 0; j < n->second; ++j) {
+            ASSERT_EQ(i & 0xff, n->first[j]);
+        }
+    }
+
+    ib_mpool_lite_destroy(mpl);
+}
+
 TEST(MpoolLiteTest, ZeroAlloc)
 {
     ib_mpool_lite_t* mpl;
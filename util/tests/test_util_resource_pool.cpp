@@ -30,6 +30,8 @@
 
 #include "gtest/gtest.h"
 
+#include <pthread.h>
+
 namespace {
 extern "C" {
     //! The resource we are going to build and test the resource pool with.
@@ -44,6 +46,7 @@ extern "C" {
     //! Callback data for resource tests.
     struct cbdata_t {
         ib_mm_t mm;
+        int     created;
     };
     typedef struct cbdata_t cbdata_t;
 
@@ -54,6 +57,7 @@ extern "C" {
         resource_t *tmp_r = reinterpret_cast<resource_t *>(
             ib_mm_calloc(cbdata->mm, sizeof(*tmp_r), 1));
         *(resource_t **)resource = tmp_r;
+        ++(cbdata->created);
         return IB_OK;
     }
 
@@ -86,6 +90,7 @@ public:
     {
         ASSERT_EQ(IB_OK, ib_mpool_create(&m_mp, "ResourcePoolTest", NULL));
         m_cbdata.mm = ib_mm_mpool(m_mp);
+        m_cbdata.created = 0;
         void *cbdata = reinterpret_cast<void *>(&m_cbdata);
         ASSERT_EQ(IB_OK, ib_resource_pool_create(
             &m_rp,
@@ -186,6 +191,26 @@ TEST_F(ResourcePoolTest, get_release) {
     ASSERT_EQ(0, r->destroy);
 }
 
+TEST_F(ResourcePoolTest, replace_to_min) {
+    ib_resource_t *ib_r;
+    resource_t *r;
+
+    ASSERT_EQ(1, m_cbdata.created);
+
+    /* Destroying the only resource creates its replacement at once. */
+    ASSERT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r));
+    r = reinterpret_cast<resource_t *>(ib_resource_get(ib_r));
+    r->postuse = 4;
+    ASSERT_EQ(IB_OK, ib_resource_release(ib_r));
+    ASSERT_EQ(1, r->destroy);
+    ASSERT_EQ(2, m_cbdata.created);
+
+    /* The next acquire uses the replacement. */
+    ASSERT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r));
+    ASSERT_EQ(2, m_cbdata.created);
+    ASSERT_EQ(IB_OK, ib_resource_release(ib_r));
+}
+
 TEST_F(ResourcePoolTest, limit_reached) {
     ib_resource_t *ib_r[11];
 
@@ -234,3 +259,81 @@ TEST_F(ResourcePoolTest, create_destroy) {
         }
     }
 }
+
+TEST_F(ResourcePoolTest, thread_cache) {
+    ib_resource_t *ib_r1;
+    ib_resource_t *ib_r2;
+
+    ASSERT_EQ(IB_EINVAL, ib_resource_pool_thread_cache(m_rp, 0));
+    ASSERT_EQ(IB_OK, ib_resource_pool_thread_cache(m_rp, 2));
+    ASSERT_EQ(IB_EINVAL, ib_resource_pool_thread_cache(m_rp, 2));
+
+    /* A released resource is handed back to the same thread. */
+    ASSERT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r1));
+    ASSERT_EQ(IB_OK, ib_resource_release(ib_r1));
+    ASSERT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r2));
+    ASSERT_EQ(ib_r1, ib_r2);
+    ASSERT_EQ(2U, ib_resource_use_get(ib_r2));
+    ASSERT_EQ(IB_OK, ib_resource_release(ib_r2));
+
+    /* Cached resources still count towards the limit and are flushed. */
+    ASSERT_EQ(IB_OK, ib_resource_pool_flush(m_rp));
+    ASSERT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r2));
+    ASSERT_EQ(1U, ib_resource_use_get(ib_r2));
+    ASSERT_EQ(IB_OK, ib_resource_release(ib_r2));
+}
+
+namespace {
+extern "C" {
+    void *thread_cache_worker(void *data) {
+        ib_resource_pool_t *rp = reinterpret_cast<ib_resource_pool_t *>(data);
+        long failures = 0;
+
+        for (int i = 0; i < 1000; ++i) {
+            ib_resource_t *ib_r[2];
+
+            for (int j = 0; j < 2; ++j) {
+                if (ib_resource_acquire(rp, &ib_r[j]) != IB_OK) {
+                    ++failures;
+                    ib_r[j] = NULL;
+                }
+            }
+            for (int j = 0; j < 2; ++j) {
+                if (ib_r[j] != NULL &&
+                    ib_resource_release(ib_r[j]) != IB_OK)
+                {
+                    ++failures;
+                }
+            }
+        }
+
+        return reinterpret_cast<void *>(failures);
+    }
+} /* Close extern "C" */
+} /* Close anonymous namespace. */
+
+TEST_F(ResourcePoolTest, thread_cache_threads) {
+    pthread_t threads[4];
+
+    ASSERT_EQ(IB_OK, ib_resource_pool_thread_cache(m_rp, 2));
+
+    for (size_t i = 0; i < sizeof(threads) / sizeof(*threads); ++i) {
+        ASSERT_EQ(0, pthread_create(&threads[i], NULL,
+                                    thread_cache_worker, m_rp));
+    }
+    for (size_t i = 0; i < sizeof(threads) / sizeof(*threads); ++i) {
+        void *failures;
+        ASSERT_EQ(0, pthread_join(threads[i], &failures));
+        EXPECT_EQ(0, reinterpret_cast<long>(failures));
+    }
+
+    /* All resources were returned when the threads exited. */
+    ib_resource_t *ib_r[11];
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r[i]));
+    }
+    ASSERT_EQ(IB_DECLINED, ib_resource_acquire(m_rp, &ib_r[10]));
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_EQ(IB_OK, ib_resource_release(ib_r[i]));
+    }
+}
@@ -0,0 +1,168 @@
+//////////////////////////////////////////////////////////////////////////////
+// Licensed to Qualys, Inc. (QUALYS) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.
+// QUALYS licenses this file to You under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+/// @file
+/// @brief IronBee --- Shared Memory Ring Test Functions
+//////////////////////////////////////////////////////////////////////////////
+#include "ironbee_config_auto.h"
+
+#include <ironbee/mm_mpool_lite.h>
+#include <ironbee/shm_ring.h>
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+class ShmRingTest : public ::testing::Test {
+public:
+    virtual void SetUp() {
+        char path[] = "test_util_shm_ring.XXXXXX";
+        int fd = mkstemp(path);
+        ASSERT_LE(0, fd);
+        close(fd);
+        unlink(path);
+        m_path = path;
+        ASSERT_EQ(IB_OK, ib_mpool_lite_create(&m_mp));
+    }
+    virtual void TearDown() {
+        ib_mpool_lite_destroy(m_mp);
+        unlink(m_path.c_str());
+    }
+
+protected:
+    ib_shm_ring_t *open_ring(size_t capacity) {
+        ib_shm_ring_t *ring = NULL;
+        EXPECT_EQ(
+            IB_OK,
+            ib_shm_ring_open(
+                &ring, ib_mm_mpool_lite(m_mp), m_path.c_str(), capacity
+            )
+        );
+        return ring;
+    }
+
+    std::string peek(ib_shm_ring_t *ring) {
+        const void *data;
+        size_t length;
+        EXPECT_EQ(IB_OK, ib_shm_ring_peek(ring, &data, &length));
+        return std::string(reinterpret_cast<const char *>(data), length);
+    }
+
+    std::string m_path;
+    ib_mpool_lite_t *m_mp;
+};
+
+TEST_F(ShmRingTest, PushPeekPop) {
+    ib_shm_ring_t *producer = open_ring(1024);
+    ib_shm_ring_t *consumer = open_ring(1024);
+    const void *data;
+    size_t length;
+
+    ASSERT_EQ(IB_EAGAIN, ib_shm_ring_peek(consumer, &data, &length));
+
+    ASSERT_EQ(IB_OK, ib_shm_ring_push(producer, "hello", 5));
+    ASSERT_EQ(IB_OK, ib_shm_ring_push(producer, NULL, 0));
+    ASSERT_EQ(IB_OK, ib_shm_ring_push(producer, "world", 5));
+
+    EXPECT_EQ("hello", peek(consumer));
+    EXPECT_EQ("hello", peek(consumer));
+    ib_shm_ring_pop(consumer);
+    EXPECT_EQ("", peek(consumer));
+    ib_shm_ring_pop(consumer);
+    EXPECT_EQ("world", peek(consumer));
+    ib_shm_ring_pop(consumer);
+
+    ASSERT_EQ(IB_EAGAIN, ib_shm_ring_peek(consumer, &data, &length));
+    ib_shm_ring_close(producer);
+    ASSERT_EQ(IB_ENOENT, ib_shm_ring_peek(consumer, &data, &length));
+}
+
+TEST_F(ShmRingTest, CloseAfterPush) {
+    ib_shm_ring_t *producer = open_ring(1024);
+    ib_shm_ring_t *consumer = open_ring(1024);
+    const void *data;
+    size_t length;
+
+    ASSERT_EQ(IB_OK, ib_shm_ring_push(producer, "last", 4));
+    ib_shm_ring_close(producer);
+    EXPECT_EQ("last", peek(consumer));
+    ib_shm_ring_pop(consumer);
+    ASSERT_EQ(IB_ENOENT, ib_shm_ring_peek(consumer, &data, &length));
+}
+
+TEST_F(ShmRingTest, Full) {
+    ib_shm_ring_t *producer = open_ring(64);
+    ib_shm_ring_t *consumer = open_ring(64);
+    std::string record(ib_shm_ring_max_record(producer), 'x');
+
+    ASSERT_EQ(IB_EINVAL, ib_shm_ring_push(producer, record.data(),
+                                          record.length() + 1));
+    ASSERT_EQ(IB_OK, ib_shm_ring_push(producer, record.data(),
+                                      record.length()));
+    ASSERT_EQ(IB_OK, ib_shm_ring_push(producer, record.data(),
+                                      record.length()));
+    ASSERT_EQ(IB_EAGAIN, ib_shm_ring_push(producer, "x", 1));
+
+    EXPECT_EQ(record, peek(consumer));
+    ib_shm_ring_pop(consumer);
+    ASSERT_EQ(IB_OK, ib_shm_ring_push(producer, "x", 1));
+}
+
+TEST_F(ShmRingTest, Wrap) {
+    ib_shm_ring_t *producer = open_ring(64);
+    ib_shm_ring_t *consumer = open_ring(64);
+
+    // Records of various sizes go round the ring many times, some of them
+    // skipping its end.
+    for (int i = 0; i < 100; ++i) {
+        std::string record(i % 20, 'a' + i % 26);
+        ASSERT_EQ(IB_OK, ib_shm_ring_push(producer, record.data(),
+                                          record.length()));
+        EXPECT_EQ(record, peek(consumer));
+        ib_shm_ring_pop(consumer);
+    }
+}
+
+TEST_F(ShmRingTest, ExistingCapacity) {
+    ib_shm_ring_t *ring = open_ring(128);
+    size_t max_record = ib_shm_ring_max_record(ring);
+
+    ring = open_ring(4096);
+    EXPECT_EQ(max_record, ib_shm_ring_max_record(ring));
+}
+
+TEST_F(ShmRingTest, NotARing) {
+    ib_shm_ring_t *ring;
+    FILE *fp = fopen(m_path.c_str(), "w");
+    ASSERT_TRUE(fp != NULL);
+    fputs("not a ring", fp);
+    fclose(fp);
+
+    EXPECT_EQ(
+        IB_EINVAL,
+        ib_shm_ring_open(&ring, ib_mm_mpool_lite(m_mp), m_path.c_str(), 1024)
+    );
+    EXPECT_EQ(
+        IB_EINVAL,
+        ib_shm_ring_open(&ring, ib_mm_mpool_lite(m_mp), m_path.c_str(), 8)
+    );
+}
@@ -33,6 +33,7 @@
 #include <ironbee/stream.h>
 
 #include <stdexcept>
+#include <string>
 
 TEST_F(SimpleFixture, test_create)
 {
@@ -170,3 +171,39 @@ TEST_F(TestStream, test_multiple)
     ASSERT_EQ(bodylen, sdata->dlen);
     ASSERT_STREQ(bodybuf, (char *)sdata->data);
 }
+
+TEST_F(TestStream, test_append)
+{
+    ib_sdata_t  *sdata;
+    ib_status_t  rc;
+
+    /* Short pieces share a segment until it is full. */
+    ASSERT_EQ(IB_OK, ib_stream_append(m_stream, "abc", 3, 8));
+    ASSERT_EQ(IB_OK, ib_stream_append(m_stream, "defg", 4, 8));
+    ASSERT_EQ(1U, IB_LIST_GEN_ELEMENTS(m_stream));
+    ASSERT_EQ(IB_OK, ib_stream_append(m_stream, "hijk", 4, 8));
+    ASSERT_EQ(2U, IB_LIST_GEN_ELEMENTS(m_stream));
+    ASSERT_EQ(11U, m_stream->slen);
+
+    /* A pushed node is never appended to. */
+    ASSERT_EQ(IB_OK, Push(IB_STREAM_DATA, "lm", 2));
+    ASSERT_EQ(IB_OK, ib_stream_append(m_stream, "nopqrstuvwxyz", 13, 8));
+    ASSERT_EQ(4U, IB_LIST_GEN_ELEMENTS(m_stream));
+    ASSERT_EQ(26U, m_stream->slen);
+
+    std::string result;
+    while ((rc = Pull(&sdata)) == IB_OK) {
+        ASSERT_EQ(IB_STREAM_DATA, sdata->type);
+        result.append((const char *)sdata->data, sdata->dlen);
+    }
+    ASSERT_EQ(IB_ENOENT, rc);
+    ASSERT_EQ("abcdefghijklmnopqrstuvwxyz", result);
+    ASSERT_EQ(0U, m_stream->slen);
+
+    /* A pulled segment belongs to the caller. */
+    ASSERT_EQ(IB_OK, ib_stream_append(m_stream, "ab", 2, 8));
+    ASSERT_EQ(IB_OK, Pull(&sdata));
+    ASSERT_EQ(IB_OK, ib_stream_append(m_stream, "cd", 2, 8));
+    ASSERT_EQ(std::string("ab"), std::string((const char *)sdata->data, 2));
+    ASSERT_EQ(2U, sdata->dlen);
+}
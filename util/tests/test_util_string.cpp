@@ -110,6 +110,36 @@ TEST(TestString, strstr)
     EXPECT_FALSE(result);
 }
 
+TEST(TestString, strsearch)
+{
+    ScopedMemoryPoolLite mpl;
+    ib_mm_t mm = MemoryManager(mpl).ib();
+    const char *needles[] = {
+        "", "h", "d", "el", "ld", "he", "xx", "o w", "world", "abab",
+        "hello world and more"
+    };
+    const char *haystacks[] = {
+        "", "hello world", "abaabababab", "ddd", "xhello worldx"
+    };
+
+    for (size_t n = 0; n < sizeof(needles) / sizeof(*needles); ++n) {
+        ib_strsearch_t *search;
+
+        ASSERT_EQ(
+            IB_OK,
+            ib_strsearch_create(&search, mm, IB_S2SL(needles[n]))
+        );
+        for (size_t h = 0; h < sizeof(haystacks) / sizeof(*haystacks); ++h) {
+            const char *haystack = haystacks[h];
+
+            EXPECT_EQ(
+                ib_strstr(haystack, strlen(haystack), IB_S2SL(needles[n])),
+                ib_strsearch_find(search, haystack, strlen(haystack))
+            ) << "\"" << needles[n] << "\" in \"" << haystack << "\"";
+        }
+    }
+}
+
 TEST(TestString, num_to_string)
 {
     IronBee::ScopedMemoryPoolLite mpl;
@@ -63,3 +63,29 @@ TEST(TestStringLower, strlower)
     EXPECT_EQ("abc", strlower("ABC"));
     EXPECT_EQ("", strlower(""));
 }
+
+TEST(TestStringLower, strlower_long)
+{
+    string input;
+    string expected;
+
+    /* Every byte value, so that each is seen by the block and the tail
+     * code. */
+    for (int i = 0; i < 256 + 7; ++i) {
+        input += static_cast<char>(i % 256);
+        expected += static_cast<char>(tolower(i % 256));
+    }
+    EXPECT_EQ(expected, strlower(input));
+    EXPECT_EQ(
+        "the quick brown fox jumps over the lazy dog",
+        strlower("The Quick Brown Fox Jumps Over The Lazy Dog")
+    );
+}
+
+TEST(TestStringLower, strlower_inplace)
+{
+    string s("Hello, WORLD! This Is LONGER Than One Block.");
+
+    ib_strlower_inplace(reinterpret_cast<uint8_t*>(&s[0]), s.length());
+    EXPECT_EQ("hello, world! this is longer than one block.", s);
+}
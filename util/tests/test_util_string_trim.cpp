@@ -92,3 +92,16 @@ TEST(TestStringTrim, strtrim_lr)
     EXPECT_EQ("", strtrim(ib_strtrim_lr, "  "));
     EXPECT_EQ("", strtrim(ib_strtrim_lr, ""));
 }
+
+TEST(TestStringTrim, strtrim_long)
+{
+    const string ws(" \t\r\n\v\f                               \t\n");
+    const string body("a b\tc \xe0\x85 d e f g h i j k l m n o p");
+
+    EXPECT_EQ(body + ws, strtrim(ib_strtrim_left, ws + body + ws));
+    EXPECT_EQ(ws + body, strtrim(ib_strtrim_right, ws + body + ws));
+    EXPECT_EQ(body, strtrim(ib_strtrim_lr, ws + body + ws));
+    EXPECT_EQ("x", strtrim(ib_strtrim_lr, ws + "x" + ws));
+    EXPECT_EQ("", strtrim(ib_strtrim_lr, ws + ws));
+    EXPECT_EQ("", strtrim(ib_strtrim_right, ws + ws));
+}
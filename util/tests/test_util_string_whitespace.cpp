@@ -83,3 +83,39 @@ TEST(TestStringWhitespace, str_whitespace_compress)
     EXPECT_EQ("a b c", strws(ib_str_whitespace_compress, "a b c"));
     EXPECT_EQ("", strws(ib_str_whitespace_compress, ""));
 }
+
+TEST(TestStringWhitespace, str_whitespace_long)
+{
+    const string ws(" \t\r\n\v\f                 ");
+    const string word("abcdefghijklmnopqrstuvwxyz\xe0\x85");
+
+    EXPECT_EQ(
+        word + word + "xy",
+        strws(ib_str_whitespace_remove, ws + word + ws + word + " x\ty" + ws)
+    );
+    EXPECT_EQ(
+        " " + word + " " + word + " x\ty ",
+        strws(ib_str_whitespace_compress, ws + word + ws + word + " x\ty" + ws)
+    );
+    EXPECT_EQ("", strws(ib_str_whitespace_remove, ws + ws));
+    EXPECT_EQ(" ", strws(ib_str_whitespace_compress, ws + ws));
+}
+
+TEST(TestStringWhitespace, str_whitespace_inplace)
+{
+    const string input("  Lorem ipsum \t dolor   sit amet, consectetur  ");
+    string s;
+    size_t len;
+
+    s = input;
+    len = s.length();
+    ib_str_whitespace_remove_inplace(reinterpret_cast<uint8_t*>(&s[0]), &len);
+    EXPECT_EQ("Loremipsumdolorsitamet,consectetur", s.substr(0, len));
+
+    s = input;
+    len = s.length();
+    ib_str_whitespace_compress_inplace(
+        reinterpret_cast<uint8_t*>(&s[0]), &len
+    );
+    EXPECT_EQ(" Lorem ipsum dolor sit amet, consectetur ", s.substr(0, len));
+}
@@ -26,8 +26,13 @@
 #include "gtest/gtest.h"
 
 #include <ironbee/stringset.h>
+#include <ironbee/mm_mpool_lite.h>
 #include <ironbee/string.h>
 
+#include <cstdlib>
+#include <string>
+#include <vector>
+
 using namespace std;
 
 TEST(TestStringSet, Empty)
@@ -109,3 +114,100 @@ TEST(TestStringSet, AfterEnd)
 
     EXPECT_EQ(IB_ENOENT, ib_stringset_query(&set, IB_S2SL("g"), NULL));
 }
+
+TEST(TestStringSet, Indexed)
+{
+    int a = 1;
+    int b = 2;
+    ib_mpool_lite_t* mp;
+    ib_stringset_t set;
+    ib_stringset_entry_t entries[5] = {
+        {"bar", 3, NULL},
+        {"a", 1, &b},
+        {"aaa", 3, &a},
+        {"aa", 2, NULL},
+        {"", 0, NULL}
+    };
+
+    ASSERT_EQ(IB_OK, ib_mpool_lite_create(&mp));
+    ASSERT_EQ(IB_OK, ib_stringset_init(&set, entries, 5));
+    ASSERT_EQ(IB_OK, ib_stringset_index(&set, ib_mm_mpool_lite(mp)));
+
+    const ib_stringset_entry_t* result;
+
+    ASSERT_EQ(IB_OK, ib_stringset_query(&set, IB_S2SL("aaaaaa"), &result));
+    EXPECT_EQ(&a, result->data);
+    ASSERT_EQ(IB_OK, ib_stringset_query(&set, IB_S2SL("ab"), &result));
+    EXPECT_EQ(&b, result->data);
+    ASSERT_EQ(IB_OK, ib_stringset_query(&set, IB_S2SL("ba"), &result));
+    EXPECT_EQ(0UL, result->length);
+    ASSERT_EQ(IB_OK, ib_stringset_query(&set, IB_S2SL("barn"), &result));
+    EXPECT_EQ("bar", string(result->string, result->length));
+
+    ib_mpool_lite_destroy(mp);
+}
+
+TEST(TestStringSet, IndexedRandom)
+{
+    static const size_t c_num_strings = 5000;
+    static const size_t c_num_tests   = 5000;
+
+    ib_mpool_lite_t* mp;
+    ib_stringset_t set;
+    vector<string> strings;
+    vector<ib_stringset_entry_t> entries;
+
+    srand(42);
+    for (size_t i = 0; i < c_num_strings; ++i) {
+        string s;
+        size_t length = 1 + rand() % 8;
+        for (size_t j = 0; j < length; ++j) {
+            s += static_cast<char>(rand() % 4 + (j % 2 ? 'a' : 0xf0));
+        }
+        strings.push_back(s);
+    }
+    for (size_t i = 0; i < c_num_strings; ++i) {
+        ib_stringset_entry_t entry = {
+            strings[i].data(), strings[i].size(), NULL
+        };
+        entries.push_back(entry);
+    }
+
+    ASSERT_EQ(IB_OK, ib_mpool_lite_create(&mp));
+    ASSERT_EQ(IB_OK, ib_stringset_init(&set, &entries[0], entries.size()));
+    ASSERT_EQ(IB_OK, ib_stringset_index(&set, ib_mm_mpool_lite(mp)));
+
+    for (size_t i = 0; i < c_num_tests; ++i) {
+        string query = strings[rand() % c_num_strings];
+        query.resize(rand() % (query.size() + 1));
+        query += strings[rand() % c_num_strings];
+
+        size_t expected = 0;
+        bool found = false;
+        for (size_t j = 0; j < c_num_strings; ++j) {
+            if (
+                query.compare(0, strings[j].size(), strings[j]) == 0 &&
+                (! found || strings[j].size() > expected)
+            ) {
+                expected = strings[j].size();
+                found = true;
+            }
+        }
+
+        const ib_stringset_entry_t* result = NULL;
+        ib_status_t rc = ib_stringset_query(
+            &set, query.data(), query.size(), &result
+        );
+        if (found) {
+            ASSERT_EQ(IB_OK, rc);
+            ASSERT_EQ(expected, result->length);
+            ASSERT_EQ(0, query.compare(0, result->length,
+                                       result->string, result->length));
+        }
+        else {
+            ASSERT_EQ(IB_ENOENT, rc);
+        }
+    }
+
+    ib_mpool_lite_destroy(mp);
+}
@@ -0,0 +1,146 @@
+//////////////////////////////////////////////////////////////////////////////
+// Licensed to Qualys, Inc. (QUALYS) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.
+// QUALYS licenses this file to You under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+/// @file
+/// @brief IronBee --- Thread Pool Test Functions
+//////////////////////////////////////////////////////////////////////////////
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/thread_pool.h>
+
+#include "gtest/gtest.h"
+
+#include <pthread.h>
+
+namespace {
+extern "C" {
+    //! Count a call atomically.
+    void count_fn(void *cbdata)
+    {
+        __sync_fetch_and_add(reinterpret_cast<int *>(cbdata), 1);
+    }
+
+    //! Work shared between threads.
+    struct work_t {
+        pthread_mutex_t mutex;
+        int             next;
+        int             count;
+        int             done[100];
+    };
+
+    //! Take items from a work_t until there are none left.
+    void work_fn(void *cbdata)
+    {
+        work_t *work = reinterpret_cast<work_t *>(cbdata);
+
+        for (;;) {
+            int item;
+
+            pthread_mutex_lock(&work->mutex);
+            item = work->next++;
+            pthread_mutex_unlock(&work->mutex);
+            if (item >= work->count) {
+                return;
+            }
+            ++work->done[item];
+        }
+    }
+}
+}
+
+TEST(TestThreadPool, create_destroy)
+{
+    ib_thread_pool_t *pool;
+
+    ASSERT_EQ(IB_EINVAL, ib_thread_pool_create(&pool, 0));
+    ASSERT_EQ(IB_OK, ib_thread_pool_create(&pool, 3));
+    EXPECT_EQ(3U, ib_thread_pool_threads(pool));
+    ib_thread_pool_destroy(pool);
+    ib_thread_pool_destroy(NULL);
+}
+
+TEST(TestThreadPool, submit)
+{
+    ib_thread_pool_t *pool;
+    int               calls = 0;
+
+    ASSERT_EQ(IB_OK, ib_thread_pool_create(&pool, 4));
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(IB_OK, ib_thread_pool_submit(pool, count_fn, &calls));
+    }
+
+    // Destroying the pool runs the queued tasks.
+    ib_thread_pool_destroy(pool);
+    EXPECT_EQ(1000, calls);
+}
+
+TEST(TestThreadPool, share)
+{
+    ib_thread_pool_t *pool;
+    work_t            work;
+
+    ASSERT_EQ(IB_OK, ib_thread_pool_create(&pool, 2));
+    ASSERT_EQ(0, pthread_mutex_init(&work.mutex, NULL));
+
+    for (int round = 0; round < 100; ++round) {
+        work.next = 0;
+        work.count = 100;
+        for (int i = 0; i < 100; ++i) {
+            work.done[i] = 0;
+        }
+
+        EXPECT_GE(2U, ib_thread_pool_share(pool, work_fn, &work, 5));
+
+        // Every item is done exactly once by the time share returns.
+        for (int i = 0; i < 100; ++i) {
+            ASSERT_EQ(1, work.done[i]);
+        }
+    }
+
+    pthread_mutex_destroy(&work.mutex);
+    ib_thread_pool_destroy(pool);
+}
+
+TEST(TestThreadPool, share_busy)
+{
+    ib_thread_pool_t *pool;
+    work_t            work;
+    int               calls = 0;
+
+    ASSERT_EQ(IB_OK, ib_thread_pool_create(&pool, 1));
+    ASSERT_EQ(0, pthread_mutex_init(&work.mutex, NULL));
+    work.next = 0;
+    work.count = 10;
+    for (int i = 0; i < 10; ++i) {
+        work.done[i] = 0;
+    }
+
+    // Queue tasks ahead of the helper; sharing still completes the work.
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(IB_OK, ib_thread_pool_submit(pool, count_fn, &calls));
+    }
+    ib_thread_pool_share(pool, work_fn, &work, 1);
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_EQ(1, work.done[i]);
+    }
+
+    ib_thread_pool_destroy(pool);
+    pthread_mutex_destroy(&work.mutex);
+    EXPECT_EQ(100, calls);
+}
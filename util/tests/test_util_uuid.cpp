@@ -28,6 +28,13 @@
 
 #include "gtest/gtest.h"
 
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <set>
+#include <string>
+#include <vector>
+
 #include <string.h>
 
 TEST(TestIBUtilUUID, random)
@@ -49,3 +56,69 @@ TEST(TestIBUtilUUID, random)
 
     ib_uuid_shutdown();
 }
+
+TEST(TestIBUtilUUID, format)
+{
+    char uuid[IB_UUID_LENGTH];
+
+    ib_uuid_initialize();
+
+    for (int n = 0; n < 100; ++n) {
+        ASSERT_EQ(IB_OK, ib_uuid_create_v4(uuid));
+        ASSERT_EQ(IB_UUID_LENGTH - 1, strlen(uuid));
+        for (int i = 0; i < IB_UUID_LENGTH - 1; ++i) {
+            if (i == 8 || i == 13 || i == 18 || i == 23) {
+                EXPECT_EQ('-', uuid[i]);
+            }
+            else {
+                EXPECT_TRUE(strchr("0123456789abcdef", uuid[i]) != NULL);
+            }
+        }
+        EXPECT_EQ('4', uuid[14]);
+        EXPECT_TRUE(strchr("89ab", uuid[19]) != NULL);
+    }
+
+    ib_uuid_shutdown();
+}
+
+namespace {
+
+void create_uuids(std::vector<std::string>* uuids, size_t n)
+{
+    char uuid[IB_UUID_LENGTH];
+
+    for (size_t i = 0; i < n; ++i) {
+        if (ib_uuid_create_v4(uuid) == IB_OK) {
+            uuids->push_back(uuid);
+        }
+    }
+}
+
+}
+
+TEST(TestIBUtilUUID, threads)
+{
+    static const size_t c_num_threads = 4;
+    static const size_t c_num_uuids = 10000;
+
+    std::vector<std::string> uuids[c_num_threads];
+    boost::thread_group threads;
+    std::set<std::string> all;
+
+    ib_uuid_initialize();
+
+    for (size_t i = 0; i < c_num_threads; ++i) {
+        threads.create_thread(
+            boost::bind(create_uuids, &uuids[i], c_num_uuids)
+        );
+    }
+    threads.join_all();
+
+    for (size_t i = 0; i < c_num_threads; ++i) {
+        ASSERT_EQ(c_num_uuids, uuids[i].size());
+        all.insert(uuids[i].begin(), uuids[i].end());
+    }
+    EXPECT_EQ(c_num_threads * c_num_uuids, all.size());
+
+    ib_uuid_shutdown();
+}
@@ -0,0 +1,376 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Thread Pool Utility Functions
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/thread_pool.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**
+ * A queued task.
+ */
+typedef struct thread_pool_task_t thread_pool_task_t;
+struct thread_pool_task_t {
+    ib_thread_pool_task_fn_t  fn;     /**< Task function. */
+    void                     *cbdata; /**< Callback data for @ref fn. */
+    thread_pool_task_t       *next;   /**< Next task in the list. */
+};
+
+struct ib_thread_pool_t {
+    pthread_mutex_t     mutex;       /**< Guards the fields below. */
+    pthread_cond_t      queued;      /**< Signals the worker threads. */
+    pthread_cond_t      finished;    /**< Signals ib_thread_pool_share(). */
+    thread_pool_task_t *head;        /**< First queued task. */
+    thread_pool_task_t *tail;        /**< Last queued task. */
+    thread_pool_task_t *free_tasks;  /**< Tasks for reuse. */
+    bool                stopping;    /**< Are the threads to exit? */
+    pthread_t          *threads;     /**< Worker threads. */
+    size_t              num_threads; /**< Number of worker threads. */
+};
+
+/**
+ * Work shared by ib_thread_pool_share().
+ */
+typedef struct thread_pool_share_t thread_pool_share_t;
+struct thread_pool_share_t {
+    ib_thread_pool_t         *pool;    /**< Pool. */
+    ib_thread_pool_task_fn_t  fn;      /**< Work function. */
+    void                     *cbdata;  /**< Callback data for @ref fn. */
+    size_t                    pending; /**< Queued or running helpers. */
+    size_t                    ran;     /**< Helpers that started. */
+};
+
+/**
+ * Worker thread main loop.
+ *
+ * @param[in] arg The pool.
+ *
+ * @returns NULL
+ */
+static void *thread_pool_worker(void *arg)
+{
+    ib_thread_pool_t *pool = (ib_thread_pool_t *)arg;
+
+    pthread_mutex_lock(&(pool->mutex));
+    for (;;) {
+        thread_pool_task_t *task;
+
+        while (pool->head == NULL && ! pool->stopping) {
+            pthread_cond_wait(&(pool->queued), &(pool->mutex));
+        }
+        task = pool->head;
+        if (task == NULL) {
+            break;
+        }
+        pool->head = task->next;
+        if (pool->head == NULL) {
+            pool->tail = NULL;
+        }
+        pthread_mutex_unlock(&(pool->mutex));
+
+        task->fn(task->cbdata);
+
+        pthread_mutex_lock(&(pool->mutex));
+        task->next = pool->free_tasks;
+        pool->free_tasks = task;
+    }
+    pthread_mutex_unlock(&(pool->mutex));
+
+    return NULL;
+}
+
+/**
+ * Stop and join the threads of @a pool.
+ *
+ * @param[in] pool Pool.
+ */
+static void thread_pool_stop(ib_thread_pool_t *pool)
+{
+    size_t i;
+
+    pthread_mutex_lock(&(pool->mutex));
+    pool->stopping = true;
+    pthread_cond_broadcast(&(pool->queued));
+    pthread_mutex_unlock(&(pool->mutex));
+
+    for (i = 0; i < pool->num_threads; ++i) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pool->num_threads = 0;
+}
+
+/**
+ * Queue a task.  Must be called with the pool mutex held.
+ *
+ * @param[in] pool Pool.
+ * @param[in] fn Task.
+ * @param[in] cbdata Callback data for @a fn.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static ib_status_t thread_pool_push(
+    ib_thread_pool_t         *pool,
+    ib_thread_pool_task_fn_t  fn,
+    void                     *cbdata
+)
+{
+    thread_pool_task_t *task = pool->free_tasks;
+
+    if (task != NULL) {
+        pool->free_tasks = task->next;
+    }
+    else {
+        task = malloc(sizeof(*task));
+        if (task == NULL) {
+            return IB_EALLOC;
+        }
+    }
+
+    task->fn = fn;
+    task->cbdata = cbdata;
+    task->next = NULL;
+    if (pool->tail == NULL) {
+        pool->head = task;
+    }
+    else {
+        pool->tail->next = task;
+    }
+    pool->tail = task;
+    pthread_cond_signal(&(pool->queued));
+
+    return IB_OK;
+}
+
+ib_status_t ib_thread_pool_create(
+    ib_thread_pool_t **pool,
+    size_t             threads
+)
+{
+    assert(pool != NULL);
+
+    ib_thread_pool_t *new_pool;
+
+    if (threads == 0) {
+        return IB_EINVAL;
+    }
+
+    new_pool = calloc(1, sizeof(*new_pool));
+    if (new_pool == NULL) {
+        return IB_EALLOC;
+    }
+    new_pool->threads = calloc(threads, sizeof(*(new_pool->threads)));
+    if (new_pool->threads == NULL) {
+        free(new_pool);
+        return IB_EALLOC;
+    }
+
+    if (pthread_mutex_init(&(new_pool->mutex), NULL) != 0) {
+        goto failed_mutex;
+    }
+    if (pthread_cond_init(&(new_pool->queued), NULL) != 0) {
+        goto failed_queued;
+    }
+    if (pthread_cond_init(&(new_pool->finished), NULL) != 0) {
+        goto failed_finished;
+    }
+
+    while (new_pool->num_threads < threads) {
+        if (pthread_create(&(new_pool->threads[new_pool->num_threads]), NULL,
+                           thread_pool_worker, new_pool) != 0)
+        {
+            thread_pool_stop(new_pool);
+            pthread_cond_destroy(&(new_pool->finished));
+            goto failed_finished;
+        }
+        ++new_pool->num_threads;
+    }
+
+    *pool = new_pool;
+
+    return IB_OK;
+
+failed_finished:
+    pthread_cond_destroy(&(new_pool->queued));
+failed_queued:
+    pthread_mutex_destroy(&(new_pool->mutex));
+failed_mutex:
+    free(new_pool->threads);
+    free(new_pool);
+    return IB_EOTHER;
+}
+
+void ib_thread_pool_destroy(
+    ib_thread_pool_t *pool
+)
+{
+    thread_pool_task_t *task;
+
+    if (pool == NULL) {
+        return;
+    }
+
+    /* Workers only exit once the queue is empty. */
+    thread_pool_stop(pool);
+
+    while (pool->free_tasks != NULL) {
+        task = pool->free_tasks;
+        pool->free_tasks = task->next;
+        free(task);
+    }
+
+    pthread_cond_destroy(&(pool->finished));
+    pthread_cond_destroy(&(pool->queued));
+    pthread_mutex_destroy(&(pool->mutex));
+    free(pool->threads);
+    free(pool);
+}
+
+size_t ib_thread_pool_threads(
+    const ib_thread_pool_t *pool
+)
+{
+    assert(pool != NULL);
+
+    return pool->num_threads;
+}
+
+ib_status_t ib_thread_pool_submit(
+    ib_thread_pool_t         *pool,
+    ib_thread_pool_task_fn_t  fn,
+    void                     *cbdata
+)
+{
+    assert(pool != NULL);
+    assert(fn != NULL);
+
+    ib_status_t rc;
+
+    pthread_mutex_lock(&(pool->mutex));
+    assert(! pool->stopping);
+    rc = thread_pool_push(pool, fn, cbdata);
+    pthread_mutex_unlock(&(pool->mutex));
+
+    return rc;
+}
+
+/**
+ * Helper task of ib_thread_pool_share().
+ *
+ * @param[in] cbdata The shared work.
+ */
+static void thread_pool_share_helper(void *cbdata)
+{
+    thread_pool_share_t *share = (thread_pool_share_t *)cbdata;
+    ib_thread_pool_t    *pool = share->pool;
+
+    pthread_mutex_lock(&(pool->mutex));
+    ++share->ran;
+    pthread_mutex_unlock(&(pool->mutex));
+
+    share->fn(share->cbdata);
+
+    pthread_mutex_lock(&(pool->mutex));
+    --share->pending;
+    if (share->pending == 0) {
+        pthread_cond_broadcast(&(pool->finished));
+    }
+    pthread_mutex_unlock(&(pool->mutex));
+}
+
+size_t ib_thread_pool_share(
+    ib_thread_pool_t         *pool,
+    ib_thread_pool_task_fn_t  fn,
+    void                     *cbdata,
+    size_t                    helpers
+)
+{
+    assert(pool != NULL);
+    assert(fn != NULL);
+
+    thread_pool_share_t  share;
+    thread_pool_task_t  *task;
+    thread_pool_task_t  *prev = NULL;
+    size_t               i;
+
+    share.pool = pool;
+    share.fn = fn;
+    share.cbdata = cbdata;
+    share.pending = 0;
+    share.ran = 0;
+
+    if (helpers > pool->num_threads) {
+        helpers = pool->num_threads;
+    }
+
+    pthread_mutex_lock(&(pool->mutex));
+    assert(! pool->stopping);
+    for (i = 0; i < helpers; ++i) {
+        if (thread_pool_push(pool, thread_pool_share_helper, &share) != IB_OK) {
+            break;
+        }
+        ++share.pending;
+    }
+    pthread_mutex_unlock(&(pool->mutex));
+
+    /* The calling thread works too. */
+    fn(cbdata);
+
+    pthread_mutex_lock(&(pool->mutex));
+
+    /* Drop the helpers that have not started; the work is done. */
+    task = pool->head;
+    while (task != NULL) {
+        thread_pool_task_t *next = task->next;
+
+        if (task->cbdata == &share) {
+            if (prev == NULL) {
+                pool->head = next;
+            }
+            else {
+                prev->next = next;
+            }
+            if (pool->tail == task) {
+                pool->tail = prev;
+            }
+            task->next = pool->free_tasks;
+            pool->free_tasks = task;
+            --share.pending;
+        }
+        else {
+            prev = task;
+        }
+        task = next;
+    }
+
+    while (share.pending > 0) {
+        pthread_cond_wait(&(pool->finished), &(pool->mutex));
+    }
+    pthread_mutex_unlock(&(pool->mutex));
+
+    return share.ran;
+}
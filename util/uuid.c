@@ -31,6 +31,10 @@
 #include <ironbee/lock.h>
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 /*
@@ -42,37 +46,66 @@
 static ib_lock_t *g_uuid_lock;
 static uuid_t    *g_ossp_uuid;
 
-ib_status_t ib_uuid_initialize(void)
-{
-    ib_status_t rc;
+/*
+ * Even one shared OSSP UUID means every connection and transaction of every
+ * thread takes the same lock for its id.  Instead, each thread seeds a
+ * generator of its own from OSSP UUID once, and makes random UUIDs from it
+ * without a lock.  A forked child seeds again, so it does not repeat the
+ * ids of its parent.
+ */
 
-    if (uuid_create(&g_ossp_uuid) != UUID_RC_OK) {
-        return IB_EOTHER;
-    }
+/**
+ * Random UUID generator of a thread: xorshift128+.
+ */
+typedef struct {
+    uint64_t s[2];       /**< State; never all zero. */
+    unsigned generation; /**< g_uuid_generation when seeded. */
+} uuid_generator_t;
 
-    rc = ib_lock_create_malloc(&g_uuid_lock);
-    if ( rc != IB_OK ) {
-        return rc;
-    }
+/** Key of the generator of the current thread. */
+static pthread_key_t g_uuid_generator_key;
+/** Whether g_uuid_generator_key was created. */
+static bool g_uuid_generator_key_valid = false;
+/** Creates g_uuid_generator_key once. */
+static pthread_once_t g_uuid_generator_once = PTHREAD_ONCE_INIT;
+/** Incremented in a forked child, so every generator is seeded again. */
+static unsigned g_uuid_generation = 0;
 
-    return rc;
+/**
+ * Invalidate all generators in a forked child.
+ */
+static void uuid_generator_atfork_child(void)
+{
+    ++g_uuid_generation;
 }
 
-ib_status_t ib_uuid_shutdown(void)
+/**
+ * Create g_uuid_generator_key.
+ */
+static void uuid_generator_init(void)
 {
-    ib_lock_destroy_malloc(g_uuid_lock);
-    uuid_destroy(g_ossp_uuid);
-
-    return IB_OK;
+    g_uuid_generator_key_valid =
+        (pthread_key_create(&g_uuid_generator_key, free) == 0) &&
+        (pthread_atfork(NULL, NULL, uuid_generator_atfork_child) == 0);
 }
 
-ib_status_t ib_uuid_create_v4(char *uuid)
+/**
+ * Make a UUID with the shared OSSP UUID.
+ *
+ * @param[in]  fmt    OSSP UUID export format.
+ * @param[out] data   Where to write the UUID.
+ * @param[in]  length Length of the UUID in @a fmt.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ * - IB_EOTHER on other failure.
+ */
+static ib_status_t uuid_make_locked(uuid_fmt_t fmt, void *data, size_t length)
 {
-    assert(uuid != NULL);
-
     ib_status_t rc;
     uuid_rc_t uuid_rc;
-    size_t uuid_len = UUID_LEN_STR+1;
+    size_t uuid_len = length;
 
     rc = ib_lock_lock(g_uuid_lock);
     if (rc != IB_OK) {
@@ -90,14 +123,14 @@ ib_status_t ib_uuid_create_v4(char *uuid)
     }
 
     uuid_rc = uuid_export(
-        g_ossp_uuid, UUID_FMT_STR,
-        (void *)&uuid, &uuid_len
+        g_ossp_uuid, fmt,
+        (void *)&data, &uuid_len
     );
     if (uuid_rc == UUID_RC_MEM) {
         rc = IB_EALLOC;
         goto finish;
     }
-    else if (uuid_rc != UUID_RC_OK || uuid_len != UUID_LEN_STR+1) {
+    else if (uuid_rc != UUID_RC_OK || uuid_len != length) {
         rc = IB_EOTHER;
         goto finish;
     }
@@ -109,3 +142,132 @@ finish:
 
     return rc;
 }
+
+/**
+ * Generator of the current thread, seeded.
+ *
+ * @returns Generator or NULL if the thread can not have one.
+ */
+static uuid_generator_t *uuid_generator(void)
+{
+    uuid_generator_t *generator;
+    unsigned generation;
+
+    pthread_once(&g_uuid_generator_once, uuid_generator_init);
+    if (! g_uuid_generator_key_valid) {
+        return NULL;
+    }
+
+    generation = __atomic_load_n(&g_uuid_generation, __ATOMIC_RELAXED);
+    generator = (uuid_generator_t *)pthread_getspecific(g_uuid_generator_key);
+    if (generator != NULL && generator->generation == generation) {
+        return generator;
+    }
+
+    if (generator == NULL) {
+        generator = (uuid_generator_t *)malloc(sizeof(*generator));
+        if (generator == NULL) {
+            return NULL;
+        }
+        if (pthread_setspecific(g_uuid_generator_key, generator) != 0) {
+            free(generator);
+            return NULL;
+        }
+    }
+
+    /* Invalid until seeded. */
+    generator->generation = generation - 1;
+    if (
+        uuid_make_locked(
+            UUID_FMT_BIN, generator->s, sizeof(generator->s)
+        ) != IB_OK
+    ) {
+        return NULL;
+    }
+    if (generator->s[0] == 0 && generator->s[1] == 0) {
+        generator->s[1] = 1;
+    }
+    generator->generation = generation;
+
+    return generator;
+}
+
+/**
+ * Next 64 random bits of @a generator.
+ *
+ * @param[in] generator Generator.
+ *
+ * @returns Random bits.
+ */
+static uint64_t uuid_generator_next(uuid_generator_t *generator)
+{
+    uint64_t s1 = generator->s[0];
+    const uint64_t s0 = generator->s[1];
+
+    generator->s[0] = s0;
+    s1 ^= s1 << 23;
+    generator->s[1] = s1 ^ s0 ^ (s1 >> 17) ^ (s0 >> 26);
+
+    return generator->s[1] + s0;
+}
+
+ib_status_t ib_uuid_initialize(void)
+{
+    ib_status_t rc;
+
+    if (uuid_create(&g_ossp_uuid) != UUID_RC_OK) {
+        return IB_EOTHER;
+    }
+
+    rc = ib_lock_create_malloc(&g_uuid_lock);
+    if ( rc != IB_OK ) {
+        return rc;
+    }
+
+    return rc;
+}
+
+ib_status_t ib_uuid_shutdown(void)
+{
+    ib_lock_destroy_malloc(g_uuid_lock);
+    uuid_destroy(g_ossp_uuid);
+
+    return IB_OK;
+}
+
+ib_status_t ib_uuid_create_v4(char *uuid)
+{
+    assert(uuid != NULL);
+
+    static const char hex[] = "0123456789abcdef";
+
+    uuid_generator_t *generator;
+    uint8_t bytes[16];
+    uint64_t bits;
+    char *out = uuid;
+
+    generator = uuid_generator();
+    if (generator == NULL) {
+        return uuid_make_locked(UUID_FMT_STR, uuid, UUID_LEN_STR + 1);
+    }
+
+    bits = uuid_generator_next(generator);
+    memcpy(bytes, &bits, sizeof(bits));
+    bits = uuid_generator_next(generator);
+    memcpy(bytes + 8, &bits, sizeof(bits));
+
+    /* Version 4 and the RFC 4122 variant. */
+    bytes[6] = (bytes[6] & 0x0f) | 0x40;
+    bytes[8] = (bytes[8] & 0x3f) | 0x80;
+
+    for (int i = 0; i < 16; ++i) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            *out++ = '-';
+        }
+        *out++ = hex[bytes[i] >> 4];
+        *out++ = hex[bytes[i] & 0x0f];
+    }
+    *out = '\0';
+
+    return IB_OK;
+}